@@ -0,0 +1,18 @@
+# Run by pgo_train with Clang: merges the .profraw files the training wrote
+# to PROFILE_DIR into OUTPUT, which SAMPLE_PGO=USE compiles with.
+
+file(GLOB raw_profiles "${PROFILE_DIR}/*.profraw")
+if(NOT raw_profiles)
+    message(FATAL_ERROR "No .profraw files in ${PROFILE_DIR}; did the training run?")
+endif()
+
+execute_process(
+    COMMAND "${PROFDATA}" merge "-output=${OUTPUT}" ${raw_profiles}
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "llvm-profdata merge failed: ${result}")
+endif()
+# Stale counts from an older binary would be merged into the next profile.
+file(REMOVE ${raw_profiles})
+message(STATUS "Wrote ${OUTPUT}")
@@ -0,0 +1,60 @@
+# Header sets for SAMPLE_PRECOMPILED_HEADERS: the standard library and Qt
+# headers most of the project's translation units include, so each target
+# parses them once instead of once per source file.
+#
+#   sample_precompile_headers(<set> <owner> [<target>...])
+#
+# <set> is STD, QT_CORE, QT_QML, QT_QUICK, QT_CORE_TEST, QT_QML_TEST or
+# QT_QUICK_TEST. <owner> builds the precompiled header and the other targets
+# reuse it, so they must have the same compile options and definitions as
+# the owner: group targets that link the same libraries.
+
+set(SAMPLE_PCH_STD
+    <algorithm>
+    <cstdint>
+    <cstring>
+    <functional>
+    <memory>
+    <string>
+    <string_view>
+    <unordered_map>
+    <utility>
+    <vector>
+)
+set(SAMPLE_PCH_QT_CORE
+    ${SAMPLE_PCH_STD}
+    <QByteArray>
+    <QHash>
+    <QList>
+    <QObject>
+    <QString>
+    <QStringList>
+    <QVariant>
+)
+set(SAMPLE_PCH_QT_QML
+    ${SAMPLE_PCH_QT_CORE}
+    <QQmlComponent>
+    <QQmlEngine>
+)
+set(SAMPLE_PCH_QT_QUICK
+    ${SAMPLE_PCH_QT_QML}
+    <QGuiApplication>
+    <QQmlApplicationEngine>
+    <QQuickItem>
+    <QQuickWindow>
+)
+set(SAMPLE_PCH_QT_CORE_TEST ${SAMPLE_PCH_QT_CORE} <QtTest>)
+set(SAMPLE_PCH_QT_QML_TEST ${SAMPLE_PCH_QT_QML} <QtTest>)
+set(SAMPLE_PCH_QT_QUICK_TEST ${SAMPLE_PCH_QT_QUICK} <QtTest>)
+
+function(sample_precompile_headers set owner)
+    if(NOT DEFINED SAMPLE_PCH_${set})
+        message(FATAL_ERROR "sample_precompile_headers: unknown header set ${set}")
+    endif()
+    target_precompile_headers(${owner} PRIVATE ${SAMPLE_PCH_${set}})
+    foreach(target IN LISTS ARGN)
+        if(TARGET ${target})
+            target_precompile_headers(${target} REUSE_FROM ${owner})
+        endif()
+    endforeach()
+endfunction()
@@ -0,0 +1,31 @@
+# Compiles fixed QML screens into C++ render functions at build time, for
+# screens whose document never changes at run time. Each <Name>.qml
+# becomes render<Name>(QmlCompiledFrame &, BindingWriter), declared in
+# <Name>_qml.h, with the layout folded into constants and only the
+# bindings left to resolve each frame. See src/qml_render_compiler.h for
+# the elements it accepts; anything else fails the build.
+#
+#   qml_curses_compile(<target> <file.qml>...)
+
+function(qml_curses_compile target)
+    # Per target, so two targets compiling one screen never write the
+    # same files at once.
+    set(dir "${CMAKE_CURRENT_BINARY_DIR}/qml_compiled/${target}")
+    foreach(file IN LISTS ARGN)
+        get_filename_component(path "${file}" ABSOLUTE)
+        get_filename_component(name "${file}" NAME_WE)
+        set(header "${dir}/${name}_qml.h")
+        set(source "${dir}/${name}_qml.cpp")
+        add_custom_command(
+            OUTPUT "${header}" "${source}"
+            COMMAND "${CMAKE_COMMAND}" -E make_directory "${dir}"
+            COMMAND qml2curses --name ${name} --header "${header}" --source "${source}" "${path}"
+            DEPENDS qml2curses "${path}"
+            COMMENT "Compiling ${file} into C++"
+            VERBATIM
+        )
+        target_sources(${target} PRIVATE "${header}" "${source}")
+    endforeach()
+    target_include_directories(${target} PRIVATE "${dir}")
+    target_link_libraries(${target} PRIVATE qml_curses)
+endfunction()
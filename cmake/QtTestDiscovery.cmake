@@ -0,0 +1,57 @@
+# Registers every test function of a QtTest executable as a ctest test of
+# its own, named <target>.<function>, so `ctest -j` spreads one binary's
+# functions across cores. The functions are listed with `<exe> -functions`
+# after each build, so new ones are picked up without reconfiguring.
+#
+#   qt_discover_tests(<target>
+#       [ENVIRONMENT <VAR=value>...]   # for discovery and for the tests
+#       [RESOURCE_LOCK <name>...]      # tests holding a lock never overlap
+#       [LABELS <label>...])           # in addition to <target>
+#
+# Cross-compiled executables cannot be listed; they are registered whole.
+
+set(_qt_discover_tests_script "${CMAKE_CURRENT_LIST_DIR}/QtTestDiscoveryScript.cmake")
+
+function(qt_discover_tests target)
+    cmake_parse_arguments(PARSE_ARGV 1 arg "" "" "ENVIRONMENT;RESOURCE_LOCK;LABELS")
+
+    set(labels ${target} ${arg_LABELS})
+    set(properties "LABELS [==[${labels}]==]")
+    if(arg_ENVIRONMENT)
+        string(APPEND properties " ENVIRONMENT [==[${arg_ENVIRONMENT}]==]")
+    endif()
+    if(arg_RESOURCE_LOCK)
+        string(APPEND properties " RESOURCE_LOCK [==[${arg_RESOURCE_LOCK}]==]")
+    endif()
+
+    if(CMAKE_CROSSCOMPILING)
+        add_test(NAME ${target} COMMAND ${target})
+        cmake_language(EVAL CODE "set_tests_properties(${target} PROPERTIES ${properties})")
+        return()
+    endif()
+
+    set(tests_file "${CMAKE_CURRENT_BINARY_DIR}/${target}_tests.cmake")
+    set(settings_file "${CMAKE_CURRENT_BINARY_DIR}/${target}_discovery.cmake")
+    set(include_file "${CMAKE_CURRENT_BINARY_DIR}/${target}_include.cmake")
+    file(WRITE "${settings_file}"
+        "set(TEST_ENVIRONMENT [==[${arg_ENVIRONMENT}]==])\n"
+        "set(TEST_PROPERTIES [===[${properties}]===])\n")
+    # Until the first build there is nothing to list.
+    file(WRITE "${include_file}"
+        "if(EXISTS [==[${tests_file}]==])\n"
+        "    include([==[${tests_file}]==])\n"
+        "else()\n"
+        "    add_test(${target}_NOT_BUILT ${target}_NOT_BUILT)\n"
+        "endif()\n")
+
+    add_custom_command(TARGET ${target} POST_BUILD
+        COMMAND "${CMAKE_COMMAND}"
+            -D "TEST_TARGET=${target}"
+            -D "TEST_EXECUTABLE=$<TARGET_FILE:${target}>"
+            -D "TEST_SETTINGS=${settings_file}"
+            -D "TEST_FILE=${tests_file}"
+            -P "${_qt_discover_tests_script}"
+        VERBATIM
+    )
+    set_property(DIRECTORY APPEND PROPERTY TEST_INCLUDE_FILES "${include_file}")
+endfunction()
@@ -0,0 +1,42 @@
+# Run by qt_discover_tests() after TEST_TARGET is built: lists the test
+# functions of TEST_EXECUTABLE and writes an add_test() for each to
+# TEST_FILE, which ctest includes.
+
+include("${TEST_SETTINGS}")
+
+# Discovery runs the binary, so it needs the tests' environment too: a
+# QTEST_MAIN binary creates its QGuiApplication before it lists anything.
+foreach(assignment IN LISTS TEST_ENVIRONMENT)
+    string(FIND "${assignment}" "=" split)
+    string(SUBSTRING "${assignment}" 0 ${split} name)
+    math(EXPR split "${split} + 1")
+    string(SUBSTRING "${assignment}" ${split} -1 value)
+    set(ENV{${name}} "${value}")
+endforeach()
+
+execute_process(
+    COMMAND "${TEST_EXECUTABLE}" -functions
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE errors
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Could not list the tests of ${TEST_EXECUTABLE} (${result}):\n${errors}")
+endif()
+
+set(script "")
+string(REPLACE "\r" "" output "${output}")
+string(REPLACE "\n" ";" lines "${output}")
+foreach(line IN LISTS lines)
+    if(line MATCHES "^([A-Za-z_][A-Za-z0-9_]*)\\(\\)$")
+        set(function "${CMAKE_MATCH_1}")
+        set(name "${TEST_TARGET}.${function}")
+        string(APPEND script
+            "add_test([==[${name}]==] [==[${TEST_EXECUTABLE}]==] [==[${function}]==])\n"
+            "set_tests_properties([==[${name}]==] PROPERTIES ${TEST_PROPERTIES})\n")
+    endif()
+endforeach()
+if(script STREQUAL "")
+    message(FATAL_ERROR "${TEST_EXECUTABLE} -functions listed no tests")
+endif()
+file(WRITE "${TEST_FILE}" "${script}")
@@ -0,0 +1,116 @@
+# Link-time and profile-guided optimization for release builds. Include
+# before the project's targets are defined; the settings apply to every
+# target defined after it.
+#
+#   SAMPLE_LTO=ON            IPO in Release, RelWithDebInfo and MinSizeRel
+#   SAMPLE_PGO=GENERATE      instrument; `cmake --build . --target pgo_train`
+#                            runs the training workload into SAMPLE_PGO_DIR
+#   SAMPLE_PGO=USE           optimize with the profiles in SAMPLE_PGO_DIR
+#
+# Run both stages in the same build directory: GCC finds each object's
+# profile by the object's path. MSVC needs whole-program compilation for
+# PGO, so there it turns IPO on as well.
+#
+#   sample_add_pgo_training()   # after the targets; adds pgo_train
+
+set(_sample_pgo_merge_script "${CMAKE_CURRENT_LIST_DIR}/PgoMergeScript.cmake")
+
+string(TOUPPER "${SAMPLE_PGO}" SAMPLE_PGO_STAGE)
+if(NOT SAMPLE_PGO_STAGE MATCHES "^(OFF|GENERATE|USE)$")
+    message(FATAL_ERROR "SAMPLE_PGO must be OFF, GENERATE or USE, not ${SAMPLE_PGO}")
+endif()
+
+set(_sample_ipo OFF)
+if(SAMPLE_LTO OR (MSVC AND NOT SAMPLE_PGO_STAGE STREQUAL "OFF"))
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT _sample_ipo OUTPUT _sample_ipo_output LANGUAGES CXX)
+    if(NOT _sample_ipo)
+        message(WARNING "Link-time optimization is not supported here: ${_sample_ipo_output}")
+    endif()
+endif()
+if(_sample_ipo)
+    foreach(config RELEASE RELWITHDEBINFO MINSIZEREL)
+        set(CMAKE_INTERPROCEDURAL_OPTIMIZATION_${config} ON)
+    endforeach()
+endif()
+
+if(NOT SAMPLE_PGO_STAGE STREQUAL "OFF")
+    file(MAKE_DIRECTORY "${SAMPLE_PGO_DIR}")
+    set(SAMPLE_PGO_CLANG_PROFILE "${SAMPLE_PGO_DIR}/sample.profdata")
+
+    if(MSVC AND CMAKE_CXX_COMPILER_ID STREQUAL "MSVC")
+        if(SAMPLE_PGO_STAGE STREQUAL "GENERATE")
+            add_link_options(/GENPROFILE:PGD=${SAMPLE_PGO_DIR}/$<TARGET_PROPERTY:NAME>.pgd)
+        else()
+            # The .pgc counts from training are merged into each .pgd at link time.
+            add_link_options(/USEPROFILE:PGD=${SAMPLE_PGO_DIR}/$<TARGET_PROPERTY:NAME>.pgd)
+        endif()
+    elseif(CMAKE_CXX_COMPILER_ID MATCHES "Clang" AND NOT CMAKE_CXX_COMPILER_FRONTEND_VARIANT STREQUAL "MSVC")
+        if(SAMPLE_PGO_STAGE STREQUAL "GENERATE")
+            add_compile_options(-fprofile-generate=${SAMPLE_PGO_DIR})
+            add_link_options(-fprofile-generate=${SAMPLE_PGO_DIR})
+            get_filename_component(_sample_compiler_dir "${CMAKE_CXX_COMPILER}" DIRECTORY)
+            find_program(SAMPLE_LLVM_PROFDATA NAMES llvm-profdata HINTS "${_sample_compiler_dir}" REQUIRED)
+        else()
+            if(NOT EXISTS "${SAMPLE_PGO_CLANG_PROFILE}")
+                message(FATAL_ERROR "No ${SAMPLE_PGO_CLANG_PROFILE}; build pgo_train with SAMPLE_PGO=GENERATE first")
+            endif()
+            add_compile_options(-fprofile-use=${SAMPLE_PGO_CLANG_PROFILE} -Wno-profile-instr-unprofiled)
+            add_link_options(-fprofile-use=${SAMPLE_PGO_CLANG_PROFILE})
+        endif()
+    elseif(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        if(SAMPLE_PGO_STAGE STREQUAL "GENERATE")
+            # Atomic counters: the parser and renderer run on worker threads.
+            add_compile_options(-fprofile-generate=${SAMPLE_PGO_DIR} -fprofile-update=atomic)
+            add_link_options(-fprofile-generate=${SAMPLE_PGO_DIR})
+        else()
+            # Code the training never reached is optimized as usual, not for size.
+            add_compile_options(-fprofile-use=${SAMPLE_PGO_DIR} -fprofile-partial-training -Wno-missing-profile)
+            add_link_options(-fprofile-use=${SAMPLE_PGO_DIR})
+        endif()
+    else()
+        message(WARNING "SAMPLE_PGO is not supported for ${CMAKE_CXX_COMPILER_ID}; building without profiles")
+    endif()
+endif()
+
+# Training: synthetic corpora and the repo's own QML through the batch
+# renderer, then the parser benchmarks with a few iterations each.
+function(sample_add_pgo_training)
+    if(NOT SAMPLE_PGO_STAGE STREQUAL "GENERATE")
+        return()
+    endif()
+    if(NOT TARGET sample_cli OR NOT TARGET sample_benchmarks OR NOT TARGET qml_corpus_gen)
+        message(WARNING "SAMPLE_PGO=GENERATE needs the curses targets for training; no pgo_train target")
+        return()
+    endif()
+
+    set(corpus "${SAMPLE_PGO_DIR}/corpus")
+    set(commands
+        COMMAND "${CMAKE_COMMAND}" -E rm -rf "${corpus}" "${SAMPLE_PGO_DIR}/render"
+        COMMAND "${CMAKE_COMMAND}" -E make_directory "${corpus}"
+        COMMAND "${CMAKE_COMMAND}" -E copy_directory "${CMAKE_SOURCE_DIR}/qml" "${corpus}"
+    )
+    foreach(shape mixed deep wide long-lines ids)
+        list(APPEND commands
+            COMMAND qml_corpus_gen --shape ${shape} --bytes 2M --out "${corpus}/${shape}.qml")
+    endforeach()
+    list(APPEND commands
+        COMMAND sample_cli --render-batch "${corpus}" --out "${SAMPLE_PGO_DIR}/render"
+        COMMAND sample_cli --render-batch "${corpus}" --out "${SAMPLE_PGO_DIR}/render" --dump-format ansi
+        COMMAND sample_benchmarks -iterations 3
+    )
+    if(SAMPLE_LLVM_PROFDATA)
+        list(APPEND commands
+            COMMAND "${CMAKE_COMMAND}"
+                -D "PROFDATA=${SAMPLE_LLVM_PROFDATA}"
+                -D "PROFILE_DIR=${SAMPLE_PGO_DIR}"
+                -D "OUTPUT=${SAMPLE_PGO_CLANG_PROFILE}"
+                -P "${_sample_pgo_merge_script}")
+    endif()
+    add_custom_target(pgo_train ${commands}
+        DEPENDS qml_corpus_gen sample_benchmarks sample_cli
+        COMMENT "Running the PGO training workload into ${SAMPLE_PGO_DIR}"
+        USES_TERMINAL
+        VERBATIM
+    )
+endfunction()
@@ -0,0 +1,220 @@
+"""Benchmark runs, stored results and the regression gate behind `dev_tool.py bench`."""
+
+from __future__ import annotations
+
+import json
+import platform
+import re
+import statistics
+import subprocess
+import tempfile
+import xml.etree.ElementTree as ET
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Optional, Sequence
+
+# QtTest metrics where a larger number is better; every other metric
+# (wall time, ticks, instructions, events such as allocations) is a cost.
+HIGHER_IS_BETTER = {"BitsPerSecond", "BytesPerSecond", "FramesPerSecond"}
+
+# Scales the MAD to a standard deviation for normally distributed noise.
+MAD_TO_SIGMA = 1.4826
+
+
+def parse_benchmark_xml(text: str) -> dict[str, tuple[str, float]]:
+    """Map "function/tag" to (metric, value per iteration) from QtTest's -o file,xml output."""
+    results: dict[str, tuple[str, float]] = {}
+    root = ET.fromstring(text)
+    for function in root.iter("TestFunction"):
+        name = function.get("name", "")
+        for result in function.iter("BenchmarkResult"):
+            tag = result.get("tag", "")
+            key = f"{name}/{tag}" if tag else name
+            results[key] = (result.get("metric", ""), float(result.get("value", "nan")))
+    return results
+
+
+def summarize(samples: Sequence[float]) -> dict[str, float]:
+    median = statistics.median(samples)
+    mad = statistics.median(abs(sample - median) for sample in samples)
+    return {"median": median, "mad": mad, "runs": len(samples)}
+
+
+@dataclass
+class Regression:
+    key: str
+    metric: str
+    baseline: float
+    current: float
+
+
+def compare(
+    current: dict,
+    baseline: dict,
+    threshold_percent: float,
+    noise_sigmas: float = 3.0,
+) -> list[Regression]:
+    """Benchmarks that got worse by more than threshold_percent and by more than the noise.
+
+    The noise is noise_sigmas standard deviations, estimated from the larger
+    MAD of the two runs, so a benchmark that jitters by 10% run to run is
+    not reported for a 6% move, however tight the threshold.
+    """
+    regressions: list[Regression] = []
+    for key, now in current["results"].items():
+        before = baseline["results"].get(key)
+        if not before or before["metric"] != now["metric"]:
+            continue
+        worse = now["median"] - before["median"]
+        if now["metric"] in HIGHER_IS_BETTER:
+            worse = -worse
+        noise = noise_sigmas * MAD_TO_SIGMA * max(now["mad"], before["mad"])
+        if worse <= noise or worse <= abs(before["median"]) * threshold_percent / 100.0:
+            continue
+        regressions.append(Regression(key, now["metric"], before["median"], now["median"]))
+    return regressions
+
+
+def machine_id() -> str:
+    raw = f"{platform.node()}-{platform.system()}-{platform.machine()}"
+    return re.sub(r"[^A-Za-z0-9._-]+", "_", raw)
+
+
+def commit_id(repo: Path) -> str:
+    """Short HEAD, with "-dirty" if the working tree has changes; "unknown" outside git."""
+    try:
+        head = subprocess.check_output(
+            ["git", "rev-parse", "--short", "HEAD"], cwd=repo, text=True
+        ).strip()
+        status = subprocess.check_output(
+            ["git", "status", "--porcelain", "--untracked-files=no"], cwd=repo, text=True
+        )
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+    return head + ("-dirty" if status.strip() else "")
+
+
+def run_benchmarks(executable: Path, repetitions: int, extra_args: Sequence[str]) -> dict:
+    """Runs executable repetitions times and summarizes each result across the runs."""
+    samples: dict[str, list[float]] = {}
+    metrics: dict[str, str] = {}
+    with tempfile.TemporaryDirectory() as tmp:
+        output = Path(tmp) / "results.xml"
+        for run in range(repetitions):
+            print(f"\n>>> {executable} ({run + 1}/{repetitions})")
+            subprocess.run(
+                [str(executable), "-o", f"{output},xml", "-o", "-,txt", *extra_args],
+                check=True,
+            )
+            results = parse_benchmark_xml(output.read_text(encoding="utf-8"))
+            for key, (metric, value) in results.items():
+                samples.setdefault(key, []).append(value)
+                metrics[key] = metric
+    return {
+        "results": {
+            key: {"metric": metrics[key], **summarize(values)}
+            for key, values in sorted(samples.items())
+        },
+    }
+
+
+def run_stable(executable: Path, extra_args: Sequence[str]) -> dict:
+    """Runs executable once in its --stable mode, which repeats each result until it settles.
+
+    Its report already carries the median and MAD of each result, next to
+    the mean, confidence interval, hardware counters and machine details.
+    """
+    with tempfile.TemporaryDirectory() as tmp:
+        report = Path(tmp) / "report.json"
+        print(f"\n>>> {executable} --stable")
+        subprocess.run([str(executable), "--stable", "--report", str(report), *extra_args], check=True)
+        return json.loads(report.read_text(encoding="utf-8"))
+
+
+def results_path(results_dir: Path, machine: str, commit: str) -> Path:
+    return results_dir / machine / f"{commit}.json"
+
+
+def resolve_baseline(results_dir: Path, machine: str, baseline: Optional[str]) -> Path:
+    """The baseline: a file, a commit stored for this machine, or this machine's baseline.json."""
+    if baseline:
+        as_file = Path(baseline)
+        if as_file.is_file():
+            return as_file
+        return results_path(results_dir, machine, baseline)
+    return results_dir / machine / "baseline.json"
+
+
+def format_report(current: dict, baseline: Optional[dict], regressions: Sequence[Regression]) -> str:
+    lines = []
+    regressed = {regression.key for regression in regressions}
+    for key, now in current["results"].items():
+        before = baseline["results"].get(key) if baseline else None
+        line = f"{key:<60} {now['median']:>14.6g} ±{now['mad']:<10.3g} {now['metric']}"
+        if before and before["median"]:
+            change = (now["median"] - before["median"]) / before["median"] * 100.0
+            line += f"  {change:+6.1f}% vs {before['median']:.6g}"
+        if key in regressed:
+            line += "  REGRESSION"
+        lines.append(line)
+    return "\n".join(lines)
+
+
+def bench(
+    executable: Path,
+    repo: Path,
+    results_dir: Path,
+    repetitions: int,
+    threshold_percent: float,
+    baseline: Optional[str],
+    save_baseline: bool,
+    extra_args: Sequence[str],
+    stable: bool = False,
+) -> int:
+    """Runs, stores and gates one benchmark session; returns the exit status."""
+    machine = machine_id()
+    commit = commit_id(repo)
+    if stable:
+        current = run_stable(executable, extra_args)
+    else:
+        current = run_benchmarks(executable, repetitions, extra_args)
+    current.update(
+        {
+            "commit": commit,
+            "machine": machine,
+            "executable": executable.name,
+            "repetitions": repetitions,
+            "stable": stable,
+        }
+    )
+
+    stored = results_path(results_dir, machine, commit)
+    stored.parent.mkdir(parents=True, exist_ok=True)
+    stored.write_text(json.dumps(current, indent=2), encoding="utf-8")
+    print(f"\nResults written to {stored}")
+
+    baseline_path = resolve_baseline(results_dir, machine, baseline)
+    reference = None
+    if baseline_path.is_file():
+        reference = json.loads(baseline_path.read_text(encoding="utf-8"))
+    elif baseline:
+        raise SystemExit(f"No baseline at {baseline_path}")
+
+    regressions = compare(current, reference, threshold_percent) if reference else []
+    print(format_report(current, reference, regressions))
+
+    if save_baseline:
+        baseline_file = results_dir / machine / "baseline.json"
+        baseline_file.write_text(json.dumps(current, indent=2), encoding="utf-8")
+        print(f"Saved as the baseline for {machine}")
+    if reference is None:
+        print(f"No baseline for {machine} yet; save one with --save-baseline")
+        return 0
+    if regressions:
+        print(
+            f"\n{len(regressions)} benchmark(s) regressed by more than "
+            f"{threshold_percent}% and the noise"
+        )
+        return 1
+    print(f"\nNo regressions against {reference.get('commit', baseline_path)}")
+    return 0
@@ -0,0 +1,87 @@
+"""Clean and incremental build times with and without precompiled headers and unity batches."""
+
+from __future__ import annotations
+
+import os
+import time
+from pathlib import Path
+from typing import Callable, Optional, Sequence
+
+from .utils import run_command
+
+# Name -> CMake cache entries. Each variant builds in its own directory.
+BUILD_VARIANTS: dict[str, list[str]] = {
+    "plain": [],
+    "pch": ["-DSAMPLE_PRECOMPILED_HEADERS=ON"],
+    "unity": ["-DSAMPLE_UNITY_BUILD=ON"],
+    "pch+unity": ["-DSAMPLE_PRECOMPILED_HEADERS=ON", "-DSAMPLE_UNITY_BUILD=ON"],
+}
+
+# Sources touched before the incremental build: one file from a library
+# with many sources and one test that includes QtTest.
+DEFAULT_TOUCHED = ["src/qml_parser.cpp", "tests/greeter_test.cpp"]
+
+
+def variant_build_dir(build_dir: Path, variant: str) -> Path:
+    return build_dir.parent / f"{build_dir.name}-{variant.replace('+', '-')}"
+
+
+def touch(paths: Sequence[Path]) -> None:
+    now = time.time()
+    for path in paths:
+        os.utime(path, (now, now))
+
+
+def timed(action: Callable[[], None]) -> float:
+    start = time.perf_counter()
+    action()
+    return time.perf_counter() - start
+
+
+def measure_variant(
+    build_dir: Path,
+    configure: Callable[[Path, Sequence[str]], None],
+    build_cmd: Sequence[str],
+    cache_entries: Sequence[str],
+    touched: Sequence[Path],
+) -> tuple[float, float]:
+    """(clean build seconds, incremental rebuild seconds after touching sources)."""
+    configure(build_dir, cache_entries)
+    run_command([*build_cmd, "--target", "clean"])
+    clean = timed(lambda: run_command([*build_cmd]))
+    touch(touched)
+    incremental = timed(lambda: run_command([*build_cmd]))
+    return clean, incremental
+
+
+def format_table(results: dict[str, tuple[float, float]]) -> str:
+    lines = [f"{'variant':<12} {'clean (s)':>10} {'incremental (s)':>16}"]
+    plain = results.get("plain")
+    for name, (clean, incremental) in results.items():
+        line = f"{name:<12} {clean:>10.1f} {incremental:>16.1f}"
+        if plain and name != "plain" and plain[0] and plain[1]:
+            line += f"   {clean / plain[0]:.2f}x / {incremental / plain[1]:.2f}x of plain"
+        lines.append(line)
+    return "\n".join(lines)
+
+
+def build_times(
+    build_dir: Path,
+    variants: Sequence[str],
+    configure: Callable[[Path, Sequence[str]], None],
+    build_command: Callable[[Path], Sequence[str]],
+    touched: Optional[Sequence[Path]] = None,
+) -> dict[str, tuple[float, float]]:
+    """Builds every variant and prints the timings; returns them by variant name."""
+    unknown = [name for name in variants if name not in BUILD_VARIANTS]
+    if unknown:
+        raise SystemExit(f"Unknown build variant(s): {', '.join(unknown)}; pick from {', '.join(BUILD_VARIANTS)}")
+    results: dict[str, tuple[float, float]] = {}
+    for name in variants:
+        directory = variant_build_dir(build_dir, name)
+        print(f"\n>>> {name} in {directory}")
+        results[name] = measure_variant(
+            directory, configure, build_command(directory), BUILD_VARIANTS[name], touched or []
+        )
+    print("\n" + format_table(results))
+    return results
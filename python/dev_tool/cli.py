@@ -6,6 +6,9 @@ Typical usage:
     python dev_tool.py build
     python dev_tool.py run sample_cli -- --help
     python dev_tool.py test
+    python dev_tool.py bench --save-baseline
+    python dev_tool.py bench-startup --build-type Release
+    python dev_tool.py profile sample_cli -- --dump 80x24 qml/Main.qml
 """
 
 from __future__ import annotations
@@ -16,6 +19,11 @@ import sys
 from pathlib import Path
 from typing import Optional, Sequence
 
+from . import probe_cache
+from .bench import bench
+from .build_times import BUILD_VARIANTS, DEFAULT_TOUCHED, build_times
+from .impacted import label_regex, request_codemodel, select_impacted_tests
+from .profile import DEFAULT_FREQUENCY, profile, profile_build_dir
 from .config import (
     USER_SETTINGS,
     _parse_setting_arg,
@@ -24,15 +32,32 @@ from .config import (
     edit_settings_interactive,
     set_settings,
 )
-from .constants import DEFAULT_BUILD_TYPE, DEFAULT_QT_CREATOR_OUTPUT_DIR, DEFAULT_SETTINGS
+from .constants import (
+    DEFAULT_BUILD_TYPE,
+    DEFAULT_QML_INDEX_SERVER,
+    DEFAULT_QT_CREATOR_OUTPUT_DIR,
+    DEFAULT_SETTINGS,
+    ROOT,
+)
 from .project import (
     build_targets,
+    build_with_pgo,
     configure_project,
     find_built_binary,
+    is_multi_config,
     list_runnable_targets,
     run_tests,
 )
-from .qml import choose_qml_file, open_qml_in_qt_creator
+from .qml import (
+    choose_qml_file,
+    expand_qml_paths,
+    format_index_matches,
+    format_qml_index,
+    index_qml_files,
+    load_native_parser,
+    open_qml_in_qt_creator,
+    query_index_server,
+)
 from .qt import (
     check_library_updates,
     detect_compiler_flavor,
@@ -42,6 +67,7 @@ from .qt import (
     enforce_qt_toolchain_match,
     verify_environment,
 )
+from .startup import STARTUP_MODES, STARTUP_TARGETS, bench_startup
 from .utils import prompt_for_choice, prompt_yes_no, run_command
 
 
@@ -63,6 +89,16 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         p.add_argument("--config", help="--config value for multi-config generators")
         p.add_argument("--qt-prefix", help="Path to Qt installation root")
         p.add_argument("--generator", help="CMake generator to use")
+        p.add_argument(
+            "--reconfigure",
+            action="store_true",
+            help="Run CMake configure even if its inputs have not changed since the last one",
+        )
+        p.add_argument(
+            "--refresh-probes",
+            action="store_true",
+            help="Re-detect the compiler, generator, Visual Studio and Qt instead of using the probe cache",
+        )
         p.add_argument(
             "--download-qt-if-missing",
             action="store_true",
@@ -104,6 +140,15 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         help="Build and run tests via ctest",
     )
     add_common_arguments(test_parser)
+    test_parser.add_argument(
+        "--impacted",
+        nargs="?",
+        const="HEAD",
+        metavar="REF",
+        help="Build and run only the test targets that depend on files changed since REF "
+        "(default: HEAD, the uncommitted changes), per CMake's target graph; "
+        "every test runs if a build file changed",
+    )
     test_parser.add_argument(
         "ctest_args",
         nargs=argparse.REMAINDER,
@@ -111,6 +156,115 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         help="Arguments passed through to ctest",
     )
 
+    bench_parser = subparsers.add_parser(
+        "bench",
+        help="Build and run benchmarks, store the results and fail on regressions",
+    )
+    add_common_arguments(bench_parser)
+    bench_parser.add_argument(
+        "--target",
+        default="sample_benchmarks",
+        help="QtTest benchmark executable to build and run (default: sample_benchmarks)",
+    )
+    bench_parser.add_argument(
+        "--repetitions",
+        type=int,
+        default=5,
+        help="Runs to take the median and MAD over (default: 5)",
+    )
+    bench_parser.add_argument(
+        "--stable",
+        action="store_true",
+        help="Run the benchmark's own --stable mode once instead: pinned threads, warmups, "
+        "runs until results settle, hardware counters",
+    )
+    bench_parser.add_argument(
+        "--threshold",
+        type=float,
+        default=5.0,
+        help="Percent a benchmark may get worse before it fails the run (default: 5)",
+    )
+    bench_parser.add_argument(
+        "--baseline",
+        help="Results file or stored commit to compare with (default: this machine's baseline.json)",
+    )
+    bench_parser.add_argument(
+        "--save-baseline",
+        action="store_true",
+        help="Also store these results as this machine's baseline",
+    )
+    bench_parser.add_argument(
+        "--results-dir",
+        type=Path,
+        default=None,
+        help="Where results are stored, per machine and commit (default: <build-dir>/bench-results)",
+    )
+    bench_parser.add_argument(
+        "bench_args",
+        nargs=argparse.REMAINDER,
+        default=[],
+        help="Arguments passed to the benchmark, e.g. test function names",
+    )
+
+    startup_parser = subparsers.add_parser(
+        "bench-startup",
+        help="Time sample_cli and sample_app from launch to first frame, cold and warm",
+    )
+    add_common_arguments(startup_parser)
+    startup_parser.add_argument(
+        "--target",
+        action="append",
+        choices=list(STARTUP_TARGETS),
+        help="Executable to launch; repeat for both (default: both)",
+    )
+    startup_parser.add_argument(
+        "--mode",
+        action="append",
+        choices=list(STARTUP_MODES),
+        help="cold: empty caches every run; warm: caches kept from a first, unreported run (default: both)",
+    )
+    startup_parser.add_argument(
+        "--runs",
+        type=int,
+        default=10,
+        help="Launches per target and mode (default: 10)",
+    )
+    startup_parser.add_argument(
+        "startup_args",
+        nargs=argparse.REMAINDER,
+        default=[],
+        help="Arguments passed to every launch, e.g. a QML file",
+    )
+
+    times_parser = subparsers.add_parser(
+        "build-times",
+        help="Time clean and incremental builds with and without precompiled headers and unity batches",
+    )
+    add_common_arguments(times_parser)
+    times_parser.add_argument(
+        "--variant",
+        action="append",
+        choices=list(BUILD_VARIANTS),
+        help="Variant to time; repeat for several (default: all). Each builds in <build-dir>-<variant>",
+    )
+    times_parser.add_argument(
+        "--touch",
+        action="append",
+        type=Path,
+        help=f"Source to touch before the incremental build (default: {', '.join(DEFAULT_TOUCHED)})",
+    )
+
+    pgo_parser = subparsers.add_parser(
+        "pgo",
+        help="Release build in <build-dir>-pgo with profile-guided and link-time optimization",
+    )
+    add_common_arguments(pgo_parser)
+    pgo_parser.add_argument(
+        "--no-lto",
+        action="store_true",
+        help="Profile-guided optimization only, without link-time optimization",
+    )
+
     run_parser = subparsers.add_parser(
         "run",
         help="Build (unless --skip-build) and run a built target",
@@ -133,6 +287,41 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         help="Run without rebuilding first",
     )
 
+    profile_parser = subparsers.add_parser(
+        "profile",
+        help="RelWithDebInfo build in <build-dir>-profile, then run a target under the sampling profiler "
+        "and write a flame graph",
+    )
+    add_common_arguments(profile_parser)
+    profile_parser.add_argument(
+        "target",
+        nargs="?",
+        help="Executable target to profile (omit to pick from detected list)",
+    )
+    profile_parser.add_argument(
+        "program_args",
+        nargs=argparse.REMAINDER,
+        default=[],
+        help="Arguments passed to the executable after '--'",
+    )
+    profile_parser.add_argument(
+        "--frequency",
+        type=int,
+        default=DEFAULT_FREQUENCY,
+        help=f"Samples per second (default: {DEFAULT_FREQUENCY}; perf only)",
+    )
+    profile_parser.add_argument(
+        "--output-dir",
+        type=Path,
+        default=None,
+        help="Where recordings, folded stacks and flame graphs go (default: <build-dir>-profile/profiles)",
+    )
+    profile_parser.add_argument(
+        "--skip-build",
+        action="store_true",
+        help="Profile without rebuilding first",
+    )
+
     verify_parser = subparsers.add_parser(
         "verify",
         help="Check environment (compiler, cmake, generator, Qt prefix) and suggest fixes",
@@ -203,6 +392,42 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         help="Install location for auto-downloaded Qt Creator (default: third_party/qtcreator).",
     )
 
+    index_parser = subparsers.add_parser(
+        "qml-index",
+        help="Parse QML files with the native sample_qml extension and summarize their objects",
+    )
+    add_common_arguments(index_parser)
+    index_parser.add_argument(
+        "paths",
+        nargs="*",
+        type=Path,
+        help="QML files or directories to index (default: the project's QML files)",
+    )
+    index_parser.add_argument(
+        "--threads",
+        type=int,
+        default=0,
+        help="Parser threads (default: one per core)",
+    )
+    index_parser.add_argument(
+        "--skip-build",
+        action="store_true",
+        help="Use the extension already in <build-dir>/python instead of building it first",
+    )
+
+    query_parser = subparsers.add_parser(
+        "qml-query",
+        help="Ask a running `sample_cli --index-server` about the project's QML",
+        description="Requests: id NAME, type NAME, definition FILE LINE COLUMN, bindings FILE [ID], "
+        "uses TEXT..., update FILE, files.",
+    )
+    query_parser.add_argument("request", nargs="+", help="The request and its arguments")
+    query_parser.add_argument(
+        "--server",
+        default=DEFAULT_QML_INDEX_SERVER,
+        help=f"Local socket name the server was started with (default: {DEFAULT_QML_INDEX_SERVER})",
+    )
+
     settings_parser = subparsers.add_parser(
         "settings",
         help="View or edit persisted defaults",
@@ -241,6 +466,7 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         args.target = []
     if args.command == "test" and not hasattr(args, "ctest_args"):
         args.ctest_args = []
+        args.impacted = None
     if args.command == "run":
         args.target = getattr(args, "target", None)
         args.program_args = getattr(args, "program_args", [])
@@ -266,6 +492,22 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         _print_settings(new_settings)
         return 0
 
+    if args.command == "qml-query":
+        request = list(args.request)
+        # The server resolves relative paths against its own directory.
+        if request[0] in {"definition", "bindings", "update"} and len(request) > 1:
+            request[1] = str(Path(request[1]).resolve())
+        # The text may have been given as several words.
+        if request[0] == "uses" and len(request) > 2:
+            request = ["uses", " ".join(request[1:])]
+        try:
+            matches = query_index_server(args.server, request)
+        except (OSError, RuntimeError) as exc:
+            raise SystemExit(f"qml-query: {exc}")
+        if matches:
+            print(format_index_matches(matches, ROOT))
+        return 0 if matches or request[0] == "update" else 1
+
     if args.command == "download-qt":
         compiler_arg = args.compiler
         if not compiler_arg and sys.platform.startswith("win"):
@@ -281,6 +523,9 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         )
         return 0
 
+    if args.refresh_probes:
+        probe_cache.clear()
+
     build_dir = args.build_dir.resolve()
     generator = detect_generator(args.generator)
     generator_is_strict = bool(args.generator or os.environ.get("CMAKE_GENERATOR"))
@@ -313,11 +558,66 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
             build_type,
             qt_prefix,
             generator_is_strict=generator_is_strict,
+            reconfigure=args.reconfigure,
         )
         build_targets(build_dir, generator, build_type, args.target, args.config)
         return 0
 
     if args.command == "test":
+        enforce_qt_toolchain_match(qt_prefix, generator)
+        if args.impacted:
+            # Before configuring, so that the configure answers it.
+            request_codemodel(build_dir)
+        generator = configure_project(
+            build_dir,
+            generator,
+            build_type,
+            qt_prefix,
+            generator_is_strict=generator_is_strict,
+            reconfigure=args.reconfigure,
+        )
+        tests = None
+        if args.impacted:
+            multi = is_multi_config(generator, build_dir)
+            tests = select_impacted_tests(
+                build_dir, ROOT, args.impacted, args.config or (build_type if multi else None)
+            )
+            if tests == []:
+                return 0
+        build_targets(build_dir, generator, build_type, tests or [], args.config)
+        ctest_args = list(args.ctest_args)
+        if tests:
+            ctest_args = ["-L", label_regex(tests), *ctest_args]
+        run_tests(build_dir, generator, build_type, args.config, ctest_args)
+        return 0
+
+    if args.command == "bench":
+        enforce_qt_toolchain_match(qt_prefix, generator)
+        generator = configure_project(
+            build_dir,
+            generator,
+            build_type,
+            qt_prefix,
+            generator_is_strict=generator_is_strict,
+            reconfigure=args.reconfigure,
+        )
+        if build_type == "Debug" and not args.config:
+            print("Warning: benchmarking a Debug build; pass --build-type Release for numbers worth keeping.")
+        build_targets(build_dir, generator, build_type, [args.target], args.config)
+        exe_path = find_built_binary(build_dir, args.target, generator, build_type, args.config)
+        return bench(
+            exe_path,
+            ROOT,
+            args.results_dir or build_dir / "bench-results",
+            args.repetitions,
+            args.threshold,
+            args.baseline,
+            args.save_baseline,
+            [arg for arg in args.bench_args if arg != "--"],
+            stable=args.stable,
+        )
+
+    if args.command == "bench-startup":
         enforce_qt_toolchain_match(qt_prefix, generator)
         generator = configure_project(
             build_dir,
@@ -325,11 +625,118 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
             build_type,
             qt_prefix,
             generator_is_strict=generator_is_strict,
+            reconfigure=args.reconfigure,
+        )
+        if build_type == "Debug" and not args.config:
+            print("Warning: timing a Debug build; pass --build-type Release for numbers worth keeping.")
+        targets = args.target or list(STARTUP_TARGETS)
+        build_targets(build_dir, generator, build_type, targets, args.config)
+        return bench_startup(
+            {target: find_built_binary(build_dir, target, generator, build_type, args.config) for target in targets},
+            args.runs,
+            args.mode,
+            [arg for arg in args.startup_args if arg != "--"],
+        )
+
+    if args.command == "build-times":
+        enforce_qt_toolchain_match(qt_prefix, generator)
+
+        def configure_variant(variant_dir: Path, cache_entries: Sequence[str]) -> None:
+            configure_project(
+                variant_dir,
+                generator,
+                build_type,
+                qt_prefix,
+                generator_is_strict=generator_is_strict,
+                reconfigure=args.reconfigure,
+                cache_entries=cache_entries,
+            )
+
+        def build_command(variant_dir: Path) -> list[str]:
+            config = args.config or (build_type if is_multi_config(generator, variant_dir) else None)
+            return ["cmake", "--build", str(variant_dir), *(["--config", config] if config else [])]
+
+        build_times(
+            build_dir,
+            args.variant or list(BUILD_VARIANTS),
+            configure_variant,
+            build_command,
+            [ROOT / path for path in (args.touch or DEFAULT_TOUCHED)],
+        )
+        return 0
+
+    if args.command == "pgo":
+        enforce_qt_toolchain_match(qt_prefix, generator)
+        # Its own directory: the instrumented stage would otherwise replace the everyday build.
+        pgo_dir = build_dir.parent / f"{build_dir.name}-pgo"
+        pgo_type = build_type if build_type in {"Release", "RelWithDebInfo", "MinSizeRel"} else "Release"
+        build_with_pgo(
+            pgo_dir,
+            generator,
+            pgo_type,
+            qt_prefix,
+            args.config or (pgo_type if is_multi_config(generator, pgo_dir) else None),
+            lto=not args.no_lto,
+            generator_is_strict=generator_is_strict,
+        )
+        return 0
+
+    if args.command == "profile":
+        enforce_qt_toolchain_match(qt_prefix, generator)
+        # Its own directory, so profiling never turns the everyday build into an optimized one.
+        profile_dir = profile_build_dir(build_dir)
+        profile_type = "RelWithDebInfo"
+        generator = configure_project(
+            profile_dir,
+            generator,
+            profile_type,
+            qt_prefix,
+            generator_is_strict=generator_is_strict,
+            reconfigure=args.reconfigure,
+        )
+        config = args.config or (profile_type if is_multi_config(generator, profile_dir) else None)
+        target = args.target or prompt_for_choice(
+            list_runnable_targets(profile_dir, generator, profile_type, config),
+            prompt="Select target to profile",
+        )
+        if not args.skip_build:
+            build_targets(profile_dir, generator, profile_type, [target], config)
+        exe_path = find_built_binary(profile_dir, target, generator, profile_type, config)
+        program_args = list(args.program_args)
+        if program_args[:1] == ["--"]:
+            program_args = program_args[1:]
+        profile(
+            exe_path,
+            program_args,
+            args.output_dir or profile_dir / "profiles",
+            args.frequency,
         )
-        build_targets(build_dir, generator, build_type, [], args.config)
-        run_tests(build_dir, generator, build_type, args.config, args.ctest_args)
         return 0
 
+    if args.command == "qml-index":
+        if not args.skip_build:
+            enforce_qt_toolchain_match(qt_prefix, generator)
+            generator = configure_project(
+                build_dir,
+                generator,
+                build_type,
+                qt_prefix,
+                generator_is_strict=generator_is_strict,
+                reconfigure=args.reconfigure,
+                cache_entries=["-DSAMPLE_PYTHON_BINDINGS=ON"],
+            )
+            build_targets(build_dir, generator, build_type, ["sample_qml"], args.config)
+        native = load_native_parser(build_dir)
+        if native is None:
+            raise SystemExit(
+                f"The sample_qml extension is not in {build_dir / 'python'}; "
+                "build it with -DSAMPLE_PYTHON_BINDINGS=ON (drop --skip-build to have qml-index do so)."
+            )
+        paths = expand_qml_paths([path.resolve() for path in args.paths] or [ROOT])
+        entries = index_qml_files(native, paths, args.threads)
+        print(format_qml_index(entries, ROOT))
+        return 1 if any(entry.error for entry in entries) else 0
+
     if args.command == "run":
         enforce_qt_toolchain_match(qt_prefix, generator)
         generator = configure_project(
@@ -338,6 +745,7 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
             build_type,
             qt_prefix,
             generator_is_strict=generator_is_strict,
+            reconfigure=args.reconfigure,
         )
         available_targets = list_runnable_targets(
             build_dir, generator, build_type, args.config
@@ -371,6 +779,7 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
                 build_type,
                 qt_prefix,
                 generator_is_strict=generator_is_strict,
+                reconfigure=args.reconfigure,
             )
             build_targets(build_dir, generator, build_type, [], args.config)
             return 0
@@ -382,6 +791,7 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
                 build_type,
                 qt_prefix,
                 generator_is_strict=generator_is_strict,
+                reconfigure=args.reconfigure,
             )
             build_targets(build_dir, generator, build_type, [], args.config)
             run_tests(build_dir, generator, build_type, args.config, [])
@@ -395,6 +805,7 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
                 build_type,
                 qt_prefix,
                 generator_is_strict=generator_is_strict,
+                reconfigure=args.reconfigure,
             )
             available_targets = list_runnable_targets(
                 build_dir, generator, build_type, args.config
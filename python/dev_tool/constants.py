@@ -49,6 +49,8 @@ PACKAGE_NAMES = {
     },
 }
 QML_EXCLUDE_DIRS = {".git", ".idea", ".vscode", "__pycache__", "build", "third_party"}
+# Local socket name `sample_cli --index-server` is started with for qml-query.
+DEFAULT_QML_INDEX_SERVER = "sample_qml_index"
 DEFAULT_QT_CREATOR_OUTPUT_DIR = ROOT / "third_party" / "qtcreator"
 QT_CREATOR_EXECUTABLE_NAMES = ["qtcreator.exe", "qtcreator", "Qt Creator"]
 
@@ -63,6 +65,8 @@ DEFAULT_SETTINGS = {
     "download_qt_version": None,
     "download_qt_compiler": None,
     "default_run_targets": DEFAULT_RUN_TARGETS,
+    "compiler_launcher": "auto",
+    "linker": "auto",
 }
 SETTING_DESCRIPTIONS: dict[str, str] = {
     "build_dir": "Build directory (default: settings file or ./build)",
@@ -73,4 +77,10 @@ SETTING_DESCRIPTIONS: dict[str, str] = {
     "download_qt_version": "Qt version to fetch when automatically downloading",
     "download_qt_compiler": "Qt compiler flavor/arch used for downloads (e.g. win64_msvc2022_64)",
     "default_run_targets": "Default targets to offer when running or launching the menu",
+    "compiler_launcher": "Compiler cache for CMAKE_<LANG>_COMPILER_LAUNCHER: auto (ccache, sccache or buildcache "
+    "from PATH), none, or a program",
+    "linker": "Linker for GCC/Clang builds: auto (mold, then lld, from PATH), none, or a -fuse-ld name",
 }
+# Tried in this order by the "auto" settings above.
+COMPILER_LAUNCHERS = ("ccache", "sccache", "buildcache")
+FAST_LINKERS = {"mold": "mold", "lld": "ld.lld"}  # -fuse-ld name: program on PATH
@@ -0,0 +1,165 @@
+"""Test selection behind `dev_tool.py test --impacted`: only the tests a change can reach."""
+
+from __future__ import annotations
+
+import json
+import re
+import subprocess
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Iterable, Optional, Sequence
+
+from .utils import run_command
+
+# Asking CMake for its code model: the file API answers under reply/ at the
+# next configure.
+CODEMODEL_QUERY = Path(".cmake/api/v1/query/codemodel-v2")
+CODEMODEL_REPLY = Path(".cmake/api/v1/reply")
+
+# A change to these can change the build graph itself, so every test runs.
+BUILD_FILE_NAMES = ("CMakeLists.txt", "CMakePresets.json", "CMakeUserPresets.json")
+BUILD_FILE_SUFFIXES = (".cmake",)
+# Files no ctest test builds from or reads.
+UNTESTED_SUFFIXES = (".md", ".py")
+# What qt_discover_tests() registers for a target not built yet.
+NOT_BUILT_SUFFIX = "_NOT_BUILT"
+
+
+@dataclass
+class TargetGraph:
+    """Each target's sources, relative to the source tree, and the targets it depends on."""
+
+    sources: dict[str, set[str]] = field(default_factory=dict)
+    dependencies: dict[str, set[str]] = field(default_factory=dict)
+
+
+def request_codemodel(build_dir: Path) -> None:
+    query = build_dir / CODEMODEL_QUERY
+    query.parent.mkdir(parents=True, exist_ok=True)
+    query.touch()
+
+
+def read_target_graph(build_dir: Path, config: Optional[str]) -> Optional[TargetGraph]:
+    """The graph from the file API's latest codemodel reply, for config or the first one; None without a reply."""
+    reply = build_dir / CODEMODEL_REPLY
+    indexes = sorted(reply.glob("index-*.json"))
+    if not indexes:
+        return None
+    index = json.loads(indexes[-1].read_text(encoding="utf-8"))
+    codemodel = next((entry for entry in index.get("objects", []) if entry.get("kind") == "codemodel"), None)
+    if codemodel is None:
+        return None
+    model = json.loads((reply / codemodel["jsonFile"]).read_text(encoding="utf-8"))
+    configurations = model.get("configurations", [])
+    if not configurations:
+        return None
+    configuration = next((c for c in configurations if c.get("name") == config), configurations[0])
+
+    graph = TargetGraph()
+    names = {target["id"]: target["name"] for target in configuration.get("targets", [])}
+    for target in configuration.get("targets", []):
+        detail = json.loads((reply / target["jsonFile"]).read_text(encoding="utf-8"))
+        # Generated sources, such as moc's, have absolute paths in the build tree.
+        graph.sources[target["name"]] = {
+            Path(source["path"]).as_posix()
+            for source in detail.get("sources", [])
+            if not Path(source["path"]).is_absolute()
+        }
+        graph.dependencies[target["name"]] = {
+            names[dependency["id"]] for dependency in detail.get("dependencies", []) if dependency["id"] in names
+        }
+    return graph
+
+
+def is_build_file(path: str) -> bool:
+    return Path(path).name in BUILD_FILE_NAMES or path.endswith(BUILD_FILE_SUFFIXES)
+
+
+def impacted_targets(graph: TargetGraph, changed: Iterable[str]) -> tuple[Optional[set[str]], str]:
+    """Targets built from a changed file, and every target depending on one of them.
+
+    Returns None, with the reason, when every test should run: a build file
+    changed, or a file no target lists, such as test data or a header only
+    included, where what it reaches cannot be told.
+    """
+    owners: dict[str, set[str]] = {}
+    for target, sources in graph.sources.items():
+        for source in sources:
+            owners.setdefault(source, set()).add(target)
+    dependents: dict[str, set[str]] = {}
+    for target, dependencies in graph.dependencies.items():
+        for dependency in dependencies:
+            dependents.setdefault(dependency, set()).add(target)
+
+    reached: set[str] = set()
+    for path in changed:
+        if is_build_file(path):
+            return None, f"{path} is a build file"
+        if path in owners:
+            reached |= owners[path]
+        elif not path.endswith(UNTESTED_SUFFIXES):
+            return None, f"no target lists {path}"
+    pending = list(reached)
+    while pending:
+        for dependent in dependents.get(pending.pop(), ()):
+            if dependent not in reached:
+                reached.add(dependent)
+                pending.append(dependent)
+    return reached, ""
+
+
+def changed_files(repo: Path, since: str) -> list[str]:
+    """Files that differ from the commit since, committed or not, and untracked files; relative to repo."""
+    diff = subprocess.check_output(["git", "diff", "--name-only", since, "--"], cwd=repo, text=True)
+    untracked = subprocess.check_output(["git", "ls-files", "--others", "--exclude-standard"], cwd=repo, text=True)
+    return sorted({line.strip() for line in (diff + untracked).splitlines() if line.strip()})
+
+
+def list_test_targets(build_dir: Path, config: Optional[str]) -> set[str]:
+    """Targets with tests in ctest.
+
+    qt_discover_tests() labels a target's tests with its name first, and
+    registers one unlabelled <target>_NOT_BUILT until the target is built.
+    """
+    cmd = ["ctest", "--test-dir", str(build_dir), "--show-only=json-v1"]
+    if config:
+        cmd += ["-C", config]
+    listing = json.loads(subprocess.check_output(cmd, text=True))
+    targets: set[str] = set()
+    for test in listing.get("tests", []):
+        labels = next((p["value"] for p in test.get("properties", []) if p.get("name") == "LABELS"), [])
+        if labels:
+            targets.add(labels[0])
+        elif test["name"].endswith(NOT_BUILT_SUFFIX):
+            targets.add(test["name"][: -len(NOT_BUILT_SUFFIX)])
+    return targets
+
+
+def label_regex(targets: Sequence[str]) -> str:
+    """A ctest -L expression matching exactly the given targets' labels."""
+    return "^(" + "|".join(re.escape(target) for target in sorted(targets)) + ")$"
+
+
+def select_impacted_tests(build_dir: Path, repo: Path, since: str, config: Optional[str]) -> Optional[list[str]]:
+    """The test targets the changes since since can affect; None to run them all.
+
+    Regenerates the build system once if it has not answered the code model
+    query yet.
+    """
+    graph = read_target_graph(build_dir, config)
+    if graph is None:
+        request_codemodel(build_dir)
+        run_command(["cmake", str(build_dir)])
+        graph = read_target_graph(build_dir, config)
+    if graph is None:
+        print("CMake did not report its target graph; running every test")
+        return None
+
+    changed = changed_files(repo, since)
+    reached, reason = impacted_targets(graph, changed)
+    if reached is None:
+        print(f"{reason}; running every test")
+        return None
+    tests = sorted(reached & list_test_targets(build_dir, config))
+    print(f"{len(changed)} file(s) changed since {since}; tests affected: {', '.join(tests) or 'none'}")
+    return tests
@@ -0,0 +1,120 @@
+"""Persistent cache for the toolchain and Qt probes in qt.py.
+
+Each entry records a hash of PATH and the mtimes of the files and
+directories its probe looked at; it is used only while all of them are
+unchanged. Set DEV_TOOL_NO_PROBE_CACHE=1 to probe every time.
+"""
+
+from __future__ import annotations
+
+import hashlib
+import json
+import os
+from pathlib import Path
+from typing import Any, Callable, Iterable, Optional, Sequence
+
+from .config import _config_dir
+
+CACHE_FILE_NAME = "probe_cache.json"
+# Bump when a probe's result format changes.
+CACHE_VERSION = 1
+
+_MISSING = -1
+
+
+def cache_path() -> Path:
+    return _config_dir() / CACHE_FILE_NAME
+
+
+def enabled() -> bool:
+    return os.environ.get("DEV_TOOL_NO_PROBE_CACHE", "") in {"", "0"}
+
+
+def path_hash() -> str:
+    return hashlib.sha256(os.environ.get("PATH", "").encode("utf-8")).hexdigest()
+
+
+def path_dirs() -> list[Path]:
+    """PATH's directories; a tool installed into one changes its mtime."""
+    return [Path(entry) for entry in os.environ.get("PATH", "").split(os.pathsep) if entry]
+
+
+def _mtime_ns(path: str) -> int:
+    try:
+        return os.stat(path).st_mtime_ns
+    except OSError:
+        return _MISSING
+
+
+def _load() -> dict:
+    try:
+        data = json.loads(cache_path().read_text(encoding="utf-8"))
+    except (OSError, ValueError):
+        return {}
+    if not isinstance(data, dict) or data.get("version") != CACHE_VERSION:
+        return {}
+    entries = data.get("entries")
+    return entries if isinstance(entries, dict) else {}
+
+
+def _store(entries: dict) -> None:
+    path = cache_path()
+    try:
+        path.parent.mkdir(parents=True, exist_ok=True)
+        tmp = path.with_suffix(".tmp")
+        tmp.write_text(json.dumps({"version": CACHE_VERSION, "entries": entries}, indent=2), encoding="utf-8")
+        os.replace(tmp, path)
+    except OSError:
+        pass
+
+
+def clear() -> None:
+    try:
+        cache_path().unlink()
+    except OSError:
+        pass
+
+
+def _is_fresh(entry: Any) -> bool:
+    if not isinstance(entry, dict) or entry.get("path_hash") != path_hash():
+        return False
+    mtimes = entry.get("mtimes")
+    if not isinstance(mtimes, dict):
+        return False
+    return all(_mtime_ns(path) == mtime for path, mtime in mtimes.items())
+
+
+def cached_probe(
+    name: str,
+    key: Sequence[Optional[str]],
+    probe: Callable[[], Any],
+    watched: Callable[[Any], Iterable[Optional[Path]]],
+    encode: Callable[[Any], Any] = lambda value: value,
+    decode: Callable[[Any], Any] = lambda value: value,
+) -> Any:
+    """probe()'s result, from the cache while PATH and the watched paths are unchanged.
+
+    key holds the probe's arguments and the environment variables it reads;
+    watched(result) names the paths whose mtimes invalidate the entry.
+    """
+    if not enabled():
+        return probe()
+
+    entry_key = json.dumps([name, *key])
+    entries = _load()
+    entry = entries.get(entry_key)
+    if _is_fresh(entry):
+        try:
+            return decode(entry["result"])
+        except (KeyError, TypeError, ValueError):
+            pass
+
+    result = probe()
+    paths = {str(path) for path in watched(result) if path}
+    entries[entry_key] = {
+        "result": encode(result),
+        "path_hash": path_hash(),
+        "mtimes": {path: _mtime_ns(path) for path in sorted(paths)},
+    }
+    _store(entries)
+    return result
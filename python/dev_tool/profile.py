@@ -0,0 +1,240 @@
+"""Sampling profiles and flame graphs behind `dev_tool.py profile`."""
+
+from __future__ import annotations
+
+import html
+import platform
+import re
+import shutil
+import subprocess
+import time
+import xml.etree.ElementTree as ET
+import zlib
+from collections import Counter
+from pathlib import Path
+from typing import Optional, Sequence
+
+from .utils import run_command
+
+# Samples per second; odd, so sampling does not lock step with timers.
+DEFAULT_FREQUENCY = 999
+
+# perf script sample headers start with the thread's name, which may hold spaces, then its pid.
+_PERF_HEADER = re.compile(r"^(?P<comm>\S.*?)\s+\d+(?:/\d+)?\s")
+# perf script frame lines: "\t  55d0c1a2b3c4 QmlParser::parseString+0x1f (/path/sample_cli)".
+_PERF_FRAME = re.compile(r"^\s*[0-9a-fA-F]+\s+(?P<symbol>.*?)(?:\+0x[0-9a-fA-F]+)?\s+\((?P<dso>[^()]*)\)\s*$")
+
+FLAME_WIDTH = 1200
+FRAME_HEIGHT = 16
+MIN_FRAME_WIDTH = 0.1  # pixels; narrower frames are left out of the SVG
+
+
+def profile_build_dir(build_dir: Path) -> Path:
+    """RelWithDebInfo builds go next to the everyday build, which may well be Debug."""
+    return build_dir.parent / f"{build_dir.name}-profile"
+
+
+def record_commands(
+    system: str, exe: Path, program_args: Sequence[str], data_path: Path, frequency: int
+) -> list[list[str]]:
+    """Commands that run exe under the platform's sampling profiler and record to data_path."""
+    if system == "Linux":
+        return [[
+            "perf", "record", "-F", str(frequency), "--call-graph", "dwarf", "-o", str(data_path),
+            "--", str(exe), *program_args,
+        ]]
+    if system == "Darwin":
+        return [[
+            "xcrun", "xctrace", "record", "--template", "Time Profiler", "--output", str(data_path),
+            "--launch", "--", str(exe), *program_args,
+        ]]
+    if system == "Windows":
+        # WPR profiles the whole machine between start and stop.
+        return [
+            ["wpr", "-start", "CPU", "-filemode"],
+            [str(exe), *program_args],
+            ["wpr", "-stop", str(data_path)],
+        ]
+    raise SystemExit(f"profile: no sampling profiler known for {system}")
+
+
+def required_tool(system: str) -> str:
+    return {"Linux": "perf", "Darwin": "xcrun", "Windows": "wpr"}.get(system, "")
+
+
+def collapse_perf_script(text: str) -> Counter:
+    """Folded stacks ("comm;outer;...;leaf" -> samples) from `perf script` output."""
+    stacks: Counter = Counter()
+    comm: Optional[str] = None
+    frames: list[str] = []
+
+    def finish() -> None:
+        if comm is not None and frames:
+            stacks[";".join([comm, *reversed(frames)])] += 1
+
+    for line in text.splitlines():
+        if not line.strip():
+            finish()
+            comm, frames = None, []
+        elif not line[0].isspace():
+            finish()
+            header = _PERF_HEADER.match(line)
+            comm, frames = (header.group("comm") if header else line.split()[0]).replace(";", ":"), []
+        else:
+            match = _PERF_FRAME.match(line)
+            if match:
+                symbol = match.group("symbol")
+                if symbol in ("", "[unknown]"):
+                    symbol = f"[{Path(match.group('dso')).name or 'unknown'}]"
+                frames.append(symbol.replace(";", ":"))
+    finish()
+    return stacks
+
+
+def collapse_xctrace(text: str) -> Counter:
+    """Folded stacks from `xctrace export` of a Time Profiler table.
+
+    The export names each frame and backtrace once and refers back to it by id afterwards.
+    """
+    root = ET.fromstring(text)
+    by_id: dict[str, ET.Element] = {}
+    for element in root.iter():
+        if "id" in element.attrib:
+            by_id[element.attrib["id"]] = element
+
+    def resolve(element: ET.Element) -> ET.Element:
+        return by_id.get(element.attrib["ref"], element) if "ref" in element.attrib else element
+
+    stacks: Counter = Counter()
+    for row in root.iter("row"):
+        thread = row.find("thread")
+        backtrace = row.find("backtrace")
+        if backtrace is None:
+            continue
+        backtrace = resolve(backtrace)
+        names = [resolve(frame).attrib.get("name", "[unknown]") for frame in backtrace.findall("frame")]
+        if not names:
+            continue
+        label = resolve(thread).attrib.get("fmt", "thread") if thread is not None else "thread"
+        stacks[";".join([label.replace(";", ":"), *(name.replace(";", ":") for name in reversed(names))])] += 1
+    return stacks
+
+
+def write_folded(stacks: Counter, path: Path) -> None:
+    lines = [f"{stack} {count}" for stack, count in sorted(stacks.items())]
+    path.write_text("\n".join(lines) + "\n", encoding="utf-8")
+
+
+def _color(name: str) -> str:
+    # Warm colours, stable per name so runs compare side by side.
+    hash_ = zlib.crc32(name.encode("utf-8"))
+    return f"rgb({205 + hash_ % 50},{(hash_ >> 8) % 180},{(hash_ >> 16) % 55})"
+
+
+def render_flamegraph(stacks: Counter, title: str) -> str:
+    """An SVG flame graph: callers below callees, widths in proportion to samples."""
+    tree: dict = {}
+    total = 0
+    for stack, count in stacks.items():
+        total += count
+        node = tree
+        for frame in stack.split(";"):
+            entry = node.setdefault(frame, [0, {}])
+            entry[0] += count
+            node = entry[1]
+
+    frames: list[tuple[str, int, float, int, float]] = []  # name, samples, x, level, width
+    scale = FLAME_WIDTH / total if total else 0.0
+
+    def layout(node: dict, x: float, level: int) -> None:
+        for name, (count, children) in sorted(node.items()):
+            width = count * scale
+            if width >= MIN_FRAME_WIDTH:
+                frames.append((name, count, x, level, width))
+                layout(children, x, level + 1)
+            x += width
+
+    layout(tree, 0.0, 0)
+    depth = max((frame[3] for frame in frames), default=0) + 1
+    height = (depth + 2) * FRAME_HEIGHT
+    lines = [
+        f'<svg xmlns="http://www.w3.org/2000/svg" width="{FLAME_WIDTH}" height="{height}" '
+        f'font-family="Verdana" font-size="11">',
+        '<rect width="100%" height="100%" fill="#f8f8f8"/>',
+        f'<text x="{FLAME_WIDTH / 2}" y="{FRAME_HEIGHT - 3}" text-anchor="middle" font-size="14">'
+        f"{html.escape(title)} ({total} samples)</text>",
+    ]
+    for name, count, x, level, width in frames:
+        # SVG's y grows downwards; the roots sit on the bottom row.
+        y = height - (level + 1) * FRAME_HEIGHT
+        lines.append(_frame_svg(name, count, total, x, y, width))
+    lines.append("</svg>")
+    return "\n".join(lines) + "\n"
+
+
+def _frame_svg(name: str, count: int, total: int, x: float, y: int, width: float) -> str:
+    # About 7 pixels per character at this font size.
+    chars = int(width / 7)
+    text = ""
+    if chars >= 3:
+        shown = name if len(name) <= chars else name[: chars - 2] + ".."
+        text = f'<text x="{x + 3:.1f}" y="{y + 12}">{html.escape(shown)}</text>'
+    return (
+        f"<g><title>{html.escape(name)} ({count} samples, {100.0 * count / total:.2f}%)</title>"
+        f'<rect x="{x:.1f}" y="{y}" width="{width:.1f}" height="{FRAME_HEIGHT - 1}" fill="{_color(name)}"/>'
+        f"{text}</g>"
+    )
+
+
+def profile(
+    exe: Path,
+    program_args: Sequence[str],
+    output_dir: Path,
+    frequency: int = DEFAULT_FREQUENCY,
+    system: Optional[str] = None,
+) -> Path:
+    """Profiles one run of exe and returns the flame graph, or the raw recording where there is none."""
+    system = system or platform.system()
+    tool = required_tool(system)
+    if tool and shutil.which(tool) is None:
+        raise SystemExit(f"profile: {tool} is not on PATH")
+    output_dir.mkdir(parents=True, exist_ok=True)
+    stem = f"{exe.stem}-{time.strftime('%Y%m%d-%H%M%S')}"
+    suffix = {"Linux": ".perf.data", "Darwin": ".trace", "Windows": ".etl"}.get(system, ".data")
+    data_path = output_dir / (stem + suffix)
+    commands = record_commands(system, exe, program_args, data_path, frequency)
+    if len(commands) == 1:
+        run_command(commands[0])
+    else:
+        start, run, stop = commands
+        run_command(start)
+        try:
+            run_command(run)
+        finally:
+            run_command(stop)  # even when the run fails, or the profiler keeps recording
+
+    if system == "Linux":
+        script = subprocess.run(
+            ["perf", "script", "-i", str(data_path)], check=True, capture_output=True, text=True, errors="replace"
+        ).stdout
+        stacks = collapse_perf_script(script)
+    elif system == "Darwin":
+        export = subprocess.run(
+            [
+                "xcrun", "xctrace", "export", "--input", str(data_path), "--xpath",
+                '/trace-toc/run[@number="1"]/data/table[@schema="time-profile"]',
+            ],
+            check=True, capture_output=True, text=True,
+        ).stdout
+        stacks = collapse_xctrace(export)
+    else:
+        # Symbolizing an ETL takes the Windows Performance Analyzer, whose
+        # Flame Graph view works straight from the recording.
+        print(f"Recorded {data_path}; open it in Windows Performance Analyzer (wpa) for its flame graph.")
+        return data_path
+
+    write_folded(stacks, output_dir / (stem + ".folded"))
+    svg_path = output_dir / (stem + ".svg")
+    svg_path.write_text(render_flamegraph(stacks, f"{exe.name} {' '.join(program_args)}".strip()), encoding="utf-8")
+    print(f"Flame graph: {svg_path} ({sum(stacks.values())} samples)")
+    return svg_path
@@ -1,14 +1,22 @@
+import hashlib
+import json
 import os
 import shutil
 import subprocess
+import sys
 from pathlib import Path
 from typing import Iterable, Optional, Sequence
 
-from .config import default_run_targets
-from .constants import NON_RUN_TARGETS, ROOT
+from . import probe_cache
+from .config import default_run_targets, get_setting
+from .constants import COMPILER_LAUNCHERS, FAST_LINKERS, NON_RUN_TARGETS, ROOT
 from .utils import prompt_yes_no, run_command
 
 
+# Written next to CMakeCache.txt after each configure dev_tool runs.
+CONFIGURE_STAMP = ".dev_tool_configure.json"
+
+
 def is_multi_config(generator: Optional[str], build_dir: Path) -> bool:
     if generator and (
         "Visual Studio" in generator
@@ -76,6 +84,47 @@ def _resolve_generator_for_build_dir(
     return requested_generator
 
 
+def detect_compiler_launcher() -> Optional[str]:
+    """The compiler cache to launch compilers through, per the compiler_launcher setting."""
+    setting = str(get_setting("compiler_launcher") or "auto")
+    if setting == "none":
+        return None
+    if setting != "auto":
+        return shutil.which(setting) or setting
+    for name in COMPILER_LAUNCHERS:
+        found = shutil.which(name)
+        if found:
+            return found
+    return None
+
+
+def detect_fast_linker() -> Optional[str]:
+    """The -fuse-ld linker to ask for, per the linker setting. Not used on Windows and macOS."""
+    setting = str(get_setting("linker") or "auto")
+    if setting == "none":
+        return None
+    if setting != "auto":
+        return setting
+    if sys.platform.startswith("win") or sys.platform == "darwin":
+        return None
+    for name, program in FAST_LINKERS.items():
+        if shutil.which(program):
+            return name
+    return None
+
+
+def build_speed_entries() -> list[str]:
+    """Cache entries for the compiler cache and linker; CMakeLists.txt embeds MSVC debug info (/Z7) under a cache."""
+    entries: list[str] = []
+    launcher = detect_compiler_launcher()
+    if launcher:
+        entries += [f"-DCMAKE_C_COMPILER_LAUNCHER={launcher}", f"-DCMAKE_CXX_COMPILER_LAUNCHER={launcher}"]
+    linker = detect_fast_linker()
+    if linker:
+        entries.append(f"-DSAMPLE_LINKER={linker}")
+    return entries
+
+
 def configure_project(
     build_dir: Path,
     generator: Optional[str],
@@ -83,6 +132,8 @@ def configure_project(
     qt_prefix: Optional[Path],
     *,
     generator_is_strict: bool = False,
+    reconfigure: bool = False,
+    cache_entries: Sequence[str] = (),
 ) -> Optional[str]:
     if build_dir.exists() and not build_dir.is_dir():
         raise SystemExit(f"Build path exists and is not a directory: {build_dir}")
@@ -100,11 +151,62 @@ def configure_project(
         cmd.append(f"-DCMAKE_PREFIX_PATH={qt_prefix}")
     if build_type:
         cmd.append(f"-DCMAKE_BUILD_TYPE={build_type}")
+    cmd += build_speed_entries()
+    cmd += cache_entries
+
+    fingerprint = configure_fingerprint(cmd)
+    if not reconfigure and is_configured_with(build_dir, fingerprint):
+        print(f"Build directory {build_dir} is configured and its inputs are unchanged; skipping configure")
+        return generator
 
     run_command(cmd)
+    _write_configure_stamp(build_dir, fingerprint)
     return generator
 
 
+def configure_inputs() -> list[Path]:
+    """Files whose contents decide what configure produces: CMake scripts and the toolchain file."""
+    inputs = [ROOT / "CMakeLists.txt", *sorted((ROOT / "cmake").glob("**/*.cmake"))]
+    toolchain = os.environ.get("CMAKE_TOOLCHAIN_FILE")
+    if toolchain:
+        inputs.append(Path(toolchain))
+    return inputs
+
+
+def configure_fingerprint(cmd: Sequence[str]) -> str:
+    """Hash of the configure command (generator, Qt prefix, build type) and of configure_inputs()."""
+    digest = hashlib.sha256()
+    digest.update("\0".join(cmd).encode("utf-8"))
+    for path in configure_inputs():
+        digest.update(b"\0" + str(path).encode("utf-8") + b"\0")
+        if path.is_file():
+            digest.update(path.read_bytes())
+    return digest.hexdigest()
+
+
+def is_configured_with(build_dir: Path, fingerprint: str) -> bool:
+    """True if build_dir's cache was written by a configure with this fingerprint."""
+    cache = build_dir / "CMakeCache.txt"
+    stamp = build_dir / CONFIGURE_STAMP
+    if not cache.exists() or not stamp.exists():
+        return False
+    try:
+        recorded = json.loads(stamp.read_text(encoding="utf-8"))
+    except (OSError, ValueError):
+        return False
+    # A cache edited or regenerated since (cmake-gui, a build's own rerun) no
+    # longer matches what was recorded.
+    return recorded.get("fingerprint") == fingerprint and recorded.get("cache_mtime_ns") == cache.stat().st_mtime_ns
+
+
+def _write_configure_stamp(build_dir: Path, fingerprint: str) -> None:
+    cache = build_dir / "CMakeCache.txt"
+    if not cache.exists():
+        return
+    stamp = {"fingerprint": fingerprint, "cache_mtime_ns": cache.stat().st_mtime_ns}
+    (build_dir / CONFIGURE_STAMP).write_text(json.dumps(stamp), encoding="utf-8")
+
+
 def build_targets(
     build_dir: Path,
     generator: Optional[str],
@@ -122,6 +224,71 @@ def build_targets(
         cmd += ["--config", config]
 
     run_command(cmd)
+    print_compiler_cache_stats(build_dir)
+
+
+# Statistics command of each compiler cache, by program name.
+_CACHE_STATS_ARGS = {"ccache": ["--show-stats"], "sccache": ["--show-stats"], "buildcache": ["-s"]}
+
+
+def read_compiler_launcher_from_cache(build_dir: Path) -> Optional[str]:
+    cache = build_dir / "CMakeCache.txt"
+    if not cache.exists():
+        return None
+    for line in cache.read_text(encoding="utf-8", errors="ignore").splitlines():
+        if line.startswith("CMAKE_CXX_COMPILER_LAUNCHER:"):
+            return line.partition("=")[2].strip() or None
+    return None
+
+
+def print_compiler_cache_stats(build_dir: Path) -> None:
+    """Prints the hit rate of the compiler cache build_dir was configured with, if any."""
+    launcher = read_compiler_launcher_from_cache(build_dir)
+    if not launcher:
+        return
+    name = Path(launcher).stem.lower()
+    stats_args = _CACHE_STATS_ARGS.get(name)
+    if stats_args is None:
+        return
+    try:
+        result = subprocess.run([launcher, *stats_args], capture_output=True, text=True, timeout=10)
+    except (OSError, subprocess.TimeoutExpired):
+        return
+    if result.returncode == 0 and result.stdout.strip():
+        print(f"\n{name} statistics:\n{result.stdout.rstrip()}")
+
+
+def build_with_pgo(
+    build_dir: Path,
+    generator: Optional[str],
+    build_type: str,
+    qt_prefix: Optional[Path],
+    config_override: Optional[str],
+    *,
+    lto: bool = True,
+    generator_is_strict: bool = False,
+) -> Optional[str]:
+    """Two-stage PGO build: instrument and run pgo_train, then rebuild everything with the profiles."""
+    lto_entry = f"-DSAMPLE_LTO={'ON' if lto else 'OFF'}"
+    for stage, targets in (("GENERATE", ["pgo_train"]), ("USE", [])):
+        print(f"\n=== PGO stage {stage} ===")
+        generator = configure_project(
+            build_dir,
+            generator,
+            build_type,
+            qt_prefix,
+            generator_is_strict=generator_is_strict,
+            cache_entries=[lto_entry, f"-DSAMPLE_PGO={stage}"],
+        )
+        build_targets(build_dir, generator, build_type, targets, config_override)
+    return generator
+
+
+def has_parallel_flag(ctest_args: Sequence[str]) -> bool:
+    return any(
+        arg in ("-j", "--parallel") or arg.startswith("-j") or arg.startswith("--parallel=")
+        for arg in ctest_args
+    )
 
 
 def run_tests(
@@ -137,6 +304,9 @@ def run_tests(
     cmd: list[str] = ["ctest", "--test-dir", str(build_dir)]
     if config:
         cmd += ["-C", config]
+    if not has_parallel_flag(extra_ctest):
+        # Every QtTest function is its own ctest entry; spread them.
+        cmd += ["--parallel", str(os.cpu_count() or 1)]
     cmd += list(extra_ctest)
 
     run_command(cmd)
@@ -182,7 +352,29 @@ def read_generator_from_cache(build_dir: Path) -> Optional[str]:
     return None
 
 
+# The generated build files a target listing comes from; regenerating the
+# build system rewrites them, which invalidates the cached listing.
+def _build_system_files(build_dir: Path) -> list[Path]:
+    return [
+        build_dir / "CMakeCache.txt",
+        build_dir / "build.ninja",
+        build_dir / "Makefile",
+        build_dir / "CMakeFiles" / "Makefile.cmake",
+        *build_dir.glob("*.sln"),
+    ]
+
+
 def list_targets_with_ninja(build_dir: Path) -> list[str]:
+    """Ninja's targets, from the probe cache while build.ninja is unchanged."""
+    return probe_cache.cached_probe(
+        "ninja-targets",
+        [str(build_dir)],
+        lambda: _list_targets_with_ninja(build_dir),
+        lambda _: _build_system_files(build_dir),
+    )
+
+
+def _list_targets_with_ninja(build_dir: Path) -> list[str]:
     if not shutil.which("ninja"):
         return []
     try:
@@ -201,6 +393,16 @@ def list_targets_with_ninja(build_dir: Path) -> list[str]:
 
 
 def list_targets_with_cmake(build_dir: Path, config: Optional[str]) -> list[str]:
+    """`cmake --build --target help`'s targets, cached like list_targets_with_ninja()."""
+    return probe_cache.cached_probe(
+        "cmake-targets",
+        [str(build_dir), config],
+        lambda: _list_targets_with_cmake(build_dir, config),
+        lambda _: _build_system_files(build_dir),
+    )
+
+
+def _list_targets_with_cmake(build_dir: Path, config: Optional[str]) -> list[str]:
     cmd = ["cmake", "--build", str(build_dir), "--target", "help"]
     if config:
         cmd += ["--config", config]
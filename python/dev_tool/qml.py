@@ -1,9 +1,19 @@
+import importlib
+import json
 import os
+import re
 import shutil
+import socket
 import sys
+import tempfile
+import time
+from collections import Counter
+from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Optional
+from types import ModuleType
+from typing import Callable, Optional, Sequence
 
+from . import probe_cache
 from .constants import (
     DEFAULT_QT_CREATOR_OUTPUT_DIR,
     HELP_URLS,
@@ -14,22 +24,243 @@ from .constants import (
 from .utils import prompt_for_choice, run_command
 
 
+QML_FILES_CACHE_NAME = "qml_files.json"
+# Bump when the entry layout changes.
+QML_FILES_CACHE_VERSION = 1
+# A directory changed this recently may change again within the same mtime
+# tick; its listing is kept but not trusted by the next call.
+_SETTLE_NS = 2_000_000_000
+
+
+def _qml_files_cache_path() -> Path:
+    return probe_cache.cache_path().with_name(QML_FILES_CACHE_NAME)
+
+
+def _load_qml_files_cache() -> dict:
+    try:
+        data = json.loads(_qml_files_cache_path().read_text(encoding="utf-8"))
+    except (OSError, ValueError):
+        return {}
+    if not isinstance(data, dict) or data.get("version") != QML_FILES_CACHE_VERSION:
+        return {}
+    roots = data.get("roots")
+    return roots if isinstance(roots, dict) else {}
+
+
+def _store_qml_files_cache(roots: dict) -> None:
+    path = _qml_files_cache_path()
+    try:
+        path.parent.mkdir(parents=True, exist_ok=True)
+        tmp = path.with_suffix(".tmp")
+        tmp.write_text(json.dumps({"version": QML_FILES_CACHE_VERSION, "roots": roots}), encoding="utf-8")
+        os.replace(tmp, path)
+    except OSError:
+        pass
+
+
+def _scan_qml_dir(path: str) -> tuple[list[str], list[str]]:
+    """A directory's subdirectories worth descending into, and its QML files; symlinks are not descended."""
+    dirs: list[str] = []
+    files: list[str] = []
+    with os.scandir(path) as entries:
+        for entry in entries:
+            try:
+                is_dir = entry.is_dir()
+            except OSError:
+                continue
+            if is_dir:
+                if not entry.is_symlink() and entry.name not in QML_EXCLUDE_DIRS and not entry.name.startswith("."):
+                    dirs.append(entry.name)
+            elif entry.name.lower().endswith(".qml"):
+                files.append(entry.name)
+    return sorted(dirs), sorted(files)
+
+
 def find_qml_files(root: Path) -> list[Path]:
     """
     Locate QML files under the project while skipping generated/vendor trees.
     Avoids crawling heavy third_party/build directories to keep menus snappy.
+
+    Each directory's listing is cached in qml_files.json beside the probe cache, keyed by its mtime, which
+    changes whenever an entry is added, removed or renamed; a later call stats every directory but lists
+    only the ones that changed. DEV_TOOL_NO_PROBE_CACHE=1 lists everything every time.
     """
+    use_cache = probe_cache.enabled()
+    roots = _load_qml_files_cache() if use_cache else {}
+    key = str(root.resolve())
+    cached = roots.get(key)
+    cached = cached if isinstance(cached, dict) else {}
+
+    listings: dict[str, list] = {}
     qml_files: list[Path] = []
-    for dirpath, dirnames, filenames in os.walk(root):
-        dirnames[:] = [
-            d for d in dirnames if d not in QML_EXCLUDE_DIRS and not d.startswith(".")
-        ]
-        for filename in filenames:
-            if filename.lower().endswith(".qml"):
-                qml_files.append(Path(dirpath) / filename)
+    rescanned = 0
+    pending = [""]
+    while pending:
+        relative = pending.pop()
+        path = os.path.join(root, relative)
+        try:
+            mtime = os.stat(path).st_mtime_ns
+        except OSError:
+            continue
+        listing = cached.get(relative)
+        if not (isinstance(listing, list) and len(listing) == 3 and listing[0] == mtime):
+            try:
+                dirs, files = _scan_qml_dir(path)
+            except OSError:
+                continue
+            settled = time.time_ns() - mtime >= _SETTLE_NS
+            listing = [mtime if settled else -1, dirs, files]
+            rescanned += 1
+        listings[relative] = listing
+        pending.extend(os.path.join(relative, name) for name in listing[1])
+        qml_files.extend(Path(path) / name for name in listing[2])
+
+    if use_cache and (rescanned or len(listings) != len(cached)):
+        roots[key] = listings
+        _store_qml_files_cache(roots)
     return sorted(qml_files, key=lambda p: p.relative_to(root))
 
 
+def load_native_parser(build_dir: Path) -> Optional[ModuleType]:
+    """
+    The sample_qml extension from build_dir/python, built with -DSAMPLE_PYTHON_BINDINGS=ON;
+    None when it is not built. See src/qml_python.cpp for its API.
+    """
+    module_dir = str(build_dir / "python")
+    if Path(module_dir).is_dir() and module_dir not in sys.path:
+        sys.path.insert(0, module_dir)
+    try:
+        return importlib.import_module("sample_qml")
+    except ImportError:
+        return None
+
+
+@dataclass
+class QmlFileIndex:
+    path: Path
+    objects: int = 0
+    ids: list[str] = field(default_factory=list)
+    types: Counter = field(default_factory=Counter)
+    error: Optional[str] = None
+
+
+def expand_qml_paths(paths: Sequence[Path]) -> list[Path]:
+    """Files as given; directories expanded with find_qml_files()."""
+    expanded: list[Path] = []
+    for path in paths:
+        expanded.extend(find_qml_files(path) if path.is_dir() else [path])
+    return expanded
+
+
+def index_qml_files(native: ModuleType, paths: Sequence[Path], threads: int = 0) -> list[QmlFileIndex]:
+    """Parses every file on the native parser's threads and tallies its objects, types and ids."""
+    entries: list[QmlFileIndex] = []
+    for path, document, error in native.parse_files([str(p) for p in paths], threads):
+        entry = QmlFileIndex(Path(path), error=error)
+        if document is not None:
+            for node in document.nodes():
+                entry.objects += 1
+                entry.types[node.type] += 1
+                if node.id:
+                    entry.ids.append(node.id)
+        entries.append(entry)
+    return entries
+
+
+def format_qml_index(entries: Sequence[QmlFileIndex], root: Path, top_types: int = 10) -> str:
+    lines: list[str] = []
+    for entry in entries:
+        try:
+            label = str(entry.path.relative_to(root))
+        except ValueError:
+            label = str(entry.path)
+        if entry.error:
+            lines.append(f"{label}: error: {entry.error}")
+        else:
+            lines.append(f"{label}: {entry.objects} objects, {len(entry.ids)} ids")
+    totals: Counter = Counter()
+    for entry in entries:
+        totals.update(entry.types)
+    failed = sum(1 for entry in entries if entry.error)
+    lines.append(
+        f"{len(entries)} files ({failed} failed), {sum(totals.values())} objects, "
+        f"{sum(len(entry.ids) for entry in entries)} ids"
+    )
+    if totals:
+        lines.append("Most used types: " + ", ".join(f"{name} {count}" for name, count in totals.most_common(top_types)))
+    return "\n".join(lines)
+
+
+@dataclass
+class QmlIndexMatch:
+    path: str
+    line: int
+    column: int
+    text: str
+
+
+def index_server_address(name: str) -> str:
+    """Where QLocalServer listens under name: a named pipe on Windows, a socket in the temp directory elsewhere."""
+    if os.name == "nt":
+        return name if name.startswith("\\\\.\\pipe\\") else "\\\\.\\pipe\\" + name
+    return name if os.path.isabs(name) else os.path.join(tempfile.gettempdir(), name)
+
+
+def _unescape(text: str) -> str:
+    return re.sub(r"\\(.)", lambda m: {"t": "\t", "n": "\n"}.get(m.group(1), m.group(1)), text)
+
+
+def _read_answer(read: Callable[[int], bytes]) -> bytes:
+    """Reads up to the empty line that ends every answer."""
+    data = b""
+    while not (data == b"\n" or data.endswith(b"\n\n")):
+        chunk = read(65536)
+        if not chunk:
+            raise RuntimeError("The index server closed the connection mid-answer")
+        data += chunk
+    return data
+
+
+def parse_index_answer(answer: bytes) -> list[QmlIndexMatch]:
+    """The matches of one answer; see QmlIndexService::answer() for the format."""
+    matches: list[QmlIndexMatch] = []
+    for line in answer.decode("utf-8", errors="replace").split("\n"):
+        if not line:
+            break
+        if line.startswith("error\t"):
+            raise RuntimeError(_unescape(line[len("error\t"):]))
+        path, line_number, column, text = line.split("\t", 3)
+        matches.append(QmlIndexMatch(_unescape(path), int(line_number), int(column), _unescape(text)))
+    return matches
+
+
+def query_index_server(name: str, fields: Sequence[str], timeout: float = 5.0) -> list[QmlIndexMatch]:
+    """Sends one request to `sample_cli --index-server name` and returns the matches of its answer."""
+    request = ("\t".join(fields) + "\n").encode("utf-8")
+    address = index_server_address(name)
+    if os.name == "nt":
+        with open(address, "r+b", buffering=0) as pipe:
+            pipe.write(request)
+            return parse_index_answer(_read_answer(pipe.read))
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as connection:
+        connection.settimeout(timeout)
+        connection.connect(address)
+        connection.sendall(request)
+        return parse_index_answer(_read_answer(connection.recv))
+
+
+def format_index_matches(matches: Sequence[QmlIndexMatch], root: Path) -> str:
+    lines: list[str] = []
+    for match in matches:
+        try:
+            label = str(Path(match.path).relative_to(root))
+        except ValueError:
+            label = match.path
+        place = f"{label}:{match.line}:{match.column}"
+        lines.append(f"{place}: {match.text}" if match.text else place)
+    return "\n".join(lines)
+
+
 def _ensure_aqt() -> None:
     """Ensure the aqtinstall package is available for downloading Qt Creator."""
     try:
@@ -5,9 +5,11 @@ import re
 import shutil
 import subprocess
 import sys
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 from typing import Iterable, List, Optional, Sequence, Tuple
 
+from . import probe_cache
 from .constants import (
     DEFAULT_QT_CREATOR_OUTPUT_DIR,
     HELP_URLS,
@@ -81,6 +83,19 @@ def _vswhere_info() -> Optional[tuple[Optional[str], Optional[str]]]:
         _maybe_warn_missing_vswhere()
         return None
 
+    def watched(info: Optional[tuple[Optional[str], Optional[str]]]) -> list[Optional[Path]]:
+        return [vswhere, Path(info[0]) if info and info[0] else None]
+
+    return probe_cache.cached_probe(
+        "vswhere_info",
+        [str(vswhere)],
+        lambda: _query_vswhere(vswhere),
+        watched,
+        decode=lambda value: tuple(value) if value else None,
+    )
+
+
+def _query_vswhere(vswhere: Path) -> Optional[tuple[Optional[str], Optional[str]]]:
     cmd = [
         str(vswhere),
         "-latest",
@@ -118,26 +133,9 @@ def _has_visual_studio_install() -> bool:
     if any(os.environ.get(var) for var in ("VCToolsInstallDir", "VCINSTALLDIR", "VSINSTALLDIR")):
         return True
 
-    vswhere = _vswhere_path()
-    if not vswhere:
-        _maybe_warn_missing_vswhere()
-        return False
-
-    cmd = [
-        str(vswhere),
-        "-latest",
-        "-products",
-        "*",
-        "-requires",
-        "Microsoft.Component.MSBuild",
-        "-property",
-        "installationVersion",
-    ]
-    try:
-        output = subprocess.check_output(cmd, text=True, encoding="utf-8").strip()
-    except (subprocess.CalledProcessError, FileNotFoundError):
-        return False
-    return bool(output)
+    # Same query as _vswhere_info (latest install with MSBuild), so it shares its cache entry.
+    info = _vswhere_info()
+    return bool(info and info[1])
 
 
 def _detect_visual_studio_generator() -> Optional[str]:
@@ -290,7 +288,28 @@ def detect_compiler(
     """
     Locate a usable C++ compiler. Returns (description, hint/warning).
     The hint is non-empty when the compiler is missing or needs setup.
+    Cached until PATH, a PATH directory or the compiler's library dirs change.
     """
+    env_vars = ("CXX", "CC", "CMAKE_GENERATOR", "ProgramFiles(x86)")
+    vs_vars = ("VCToolsInstallDir", "VCINSTALLDIR", "VSINSTALLDIR")
+    env = [os.environ.get(var) for var in (*env_vars, *vs_vars)]
+
+    def watched(result: tuple[Optional[str], Optional[str], list[Path]]) -> list[Optional[Path]]:
+        return [*probe_cache.path_dirs(), _vswhere_path(), *result[2]]
+
+    return probe_cache.cached_probe(
+        "compiler",
+        [generator, *env],
+        lambda: _probe_compiler(generator),
+        watched,
+        encode=lambda result: [result[0], result[1], [str(path) for path in result[2]]],
+        decode=lambda value: (value[0], value[1], [Path(path) for path in value[2]]),
+    )
+
+
+def _probe_compiler(
+    generator: Optional[str],
+) -> tuple[Optional[str], Optional[str], list[Path]]:
     for env_var in ("CXX", "CC"):
         compiler = os.environ.get(env_var)
         if not compiler:
@@ -430,6 +449,22 @@ def autodetect_qt_prefix(preferred_flavor: Optional[str] = None) -> Optional[Pat
     if not qt_root.exists():
         return None
 
+    def watched(prefix: Optional[Path]) -> list[Optional[Path]]:
+        # Qt installs as qt6/<version>/<flavor>: a new one changes one of these mtimes.
+        versions = [child for child in qt_root.iterdir() if child.is_dir()]
+        return [qt_root, *versions, prefix / "lib" / "cmake" / "Qt6" if prefix else None]
+
+    return probe_cache.cached_probe(
+        "qt_prefix",
+        [str(qt_root), preferred_flavor],
+        lambda: _scan_qt_prefixes(qt_root, preferred_flavor),
+        watched,
+        encode=lambda prefix: str(prefix) if prefix else None,
+        decode=lambda value: Path(value) if value else None,
+    )
+
+
+def _scan_qt_prefixes(qt_root: Path, preferred_flavor: Optional[str]) -> Optional[Path]:
     candidates: list[tuple[Tuple[int, ...], Optional[str], Path]] = []
     for cmake_dir in qt_root.rglob("lib/cmake/Qt6"):
         prefix = cmake_dir.parents[2]
@@ -549,6 +584,15 @@ def detect_generator(cli_value: Optional[str]) -> Optional[str]:
         return cli_value
     if os.environ.get("CMAKE_GENERATOR"):
         return os.environ["CMAKE_GENERATOR"]
+    return probe_cache.cached_probe(
+        "generator",
+        [os.environ.get("ProgramFiles(x86)")],
+        _probe_generator,
+        lambda _: [*probe_cache.path_dirs(), _vswhere_path()],
+    )
+
+
+def _probe_generator() -> Optional[str]:
     if sys.platform.startswith("win"):
         vs_generator = _detect_visual_studio_generator()
         if vs_generator:
@@ -675,8 +719,15 @@ def check_library_updates(qt_prefix_value: Optional[str]) -> bool:
     print("\nChecking library updates (Qt 6, PDCursesMod):")
     ok = True
 
-    local_qt_version, qt_prefix = detect_local_qt_version(qt_prefix_value)
-    latest_qt_version, qt_source, qt_error = fetch_latest_qt_version()
+    # Both upstreams are asked at once, while the local versions are read.
+    with ThreadPoolExecutor(max_workers=2) as pool:
+        latest_qt = pool.submit(fetch_latest_qt_version)
+        latest_pdc = pool.submit(fetch_latest_pdcurses_version)
+        local_qt_version, qt_prefix = detect_local_qt_version(qt_prefix_value)
+        local_pdc_version = detect_local_pdcurses_version()
+        latest_qt_version, qt_source, qt_error = latest_qt.result()
+        latest_pdc_version, pdc_source, pdc_error = latest_pdc.result()
+
     if qt_prefix:
         version_label = local_qt_version or "unknown version"
         print(f" - Qt local: {version_label} at {qt_prefix}")
@@ -700,8 +751,6 @@ def check_library_updates(qt_prefix_value: Optional[str]) -> bool:
         ok = False
         print(f" - Qt latest: unavailable ({qt_error or 'unknown error'})")
 
-    local_pdc_version = detect_local_pdcurses_version()
-    latest_pdc_version, pdc_source, pdc_error = fetch_latest_pdcurses_version()
     if local_pdc_version:
         print(f" - PDCursesMod local: {local_pdc_version} (third_party/PDCursesMod)")
     else:
@@ -0,0 +1,165 @@
+"""Cold and warm startup runs behind `dev_tool.py bench-startup`."""
+
+from __future__ import annotations
+
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import threading
+from pathlib import Path
+from typing import Optional, Sequence
+
+STARTUP_TARGETS = ("sample_cli", "sample_app")
+STARTUP_MODES = ("cold", "warm")
+# The phase both executables mark once their first frame is on screen.
+FIRST_FRAME = "firstFrame"
+LAUNCH_TIMEOUT_SECONDS = 60
+
+
+def startup_command(
+    target: str, exe: Path, timing_path: Path, cache_dir: Path, extra_args: Sequence[str]
+) -> list[str]:
+    """Runs target until its first frame, writing its startup phases to timing_path.
+
+    Every cache the executable keeps on disk goes under cache_dir, so a fresh
+    directory starts it cold and a reused one warm.
+    """
+    command = [str(exe), "--startup-timing", str(timing_path), "--quit-after-startup"]
+    if target == "sample_cli":
+        command += ["--cache-dir", str(cache_dir / "qmlc")]
+    else:
+        command += ["--pipeline-cache-dir", str(cache_dir / "pipelines")]
+    return command + list(extra_args)
+
+
+def startup_env(target: str, cache_dir: Path) -> dict[str, str]:
+    env = dict(os.environ)
+    if target == "sample_app":
+        env["QML_DISK_CACHE_PATH"] = str(cache_dir / "qmlcache")
+    else:
+        env.setdefault("TERM", "xterm-256color")
+    return env
+
+
+def launch(command: Sequence[str], env: dict[str, str], terminal: bool) -> None:
+    """Runs command to completion; with terminal, on a pseudo-terminal or a console of its own.
+
+    curses needs a terminal to draw the first frame on. The terminal's output
+    is read and dropped, so the child never blocks on a full buffer.
+    """
+    if not terminal:
+        subprocess.run(command, env=env, check=True, timeout=LAUNCH_TIMEOUT_SECONDS)
+        return
+    if sys.platform == "win32":
+        subprocess.run(
+            command,
+            env=env,
+            check=True,
+            timeout=LAUNCH_TIMEOUT_SECONDS,
+            creationflags=subprocess.CREATE_NEW_CONSOLE,
+        )
+        return
+
+    import pty
+
+    controller, child = pty.openpty()
+
+    def drain() -> None:
+        try:
+            while os.read(controller, 65536):
+                pass
+        except OSError:  # the child side closed
+            pass
+
+    reader = threading.Thread(target=drain, daemon=True)
+    reader.start()
+    try:
+        subprocess.run(
+            command, env=env, check=True, timeout=LAUNCH_TIMEOUT_SECONDS, stdin=child, stdout=child, stderr=child
+        )
+    finally:
+        os.close(child)
+        reader.join(timeout=5)
+        os.close(controller)
+
+
+def parse_timing(text: str) -> dict[str, float]:
+    """Milliseconds since main() by phase, from a --startup-timing report."""
+    return {phase["phase"]: float(phase["ms"]) for phase in json.loads(text)["phases"]}
+
+
+def run_startup(target: str, exe: Path, runs: int, mode: str, extra_args: Sequence[str]) -> list[dict[str, float]]:
+    """Launches exe runs times and returns each run's phases.
+
+    Cold runs each get an empty cache directory; warm runs share one that a
+    first, unreported run fills. The OS page cache is left alone.
+    """
+    samples = []
+    with tempfile.TemporaryDirectory(prefix="startup-") as tmp:
+        root = Path(tmp)
+        timing_path = root / "timing.json"
+        warm_dir = root / "warm"
+        launches = runs if mode == "cold" else runs + 1
+        for index in range(launches):
+            cache_dir = root / f"cold{index}" if mode == "cold" else warm_dir
+            timing_path.unlink(missing_ok=True)
+            launch(
+                startup_command(target, exe, timing_path, cache_dir, extra_args),
+                startup_env(target, cache_dir),
+                terminal=target == "sample_cli",
+            )
+            if mode == "warm" and index == 0:
+                continue
+            if not timing_path.is_file():
+                raise SystemExit(f"bench-startup: {exe} exited without writing its startup timing")
+            samples.append(parse_timing(timing_path.read_text(encoding="utf-8")))
+            print(f"{target} {mode} {len(samples)}/{runs}: {samples[-1].get(FIRST_FRAME, float('nan')):.1f} ms")
+    return samples
+
+
+def summarize_startup(values: Sequence[float]) -> dict[str, float]:
+    return {
+        "mean": statistics.fmean(values),
+        "median": statistics.median(values),
+        "stdev": statistics.stdev(values) if len(values) > 1 else 0.0,
+        "min": min(values),
+        "max": max(values),
+    }
+
+
+def format_startup_report(results: Sequence[tuple[str, str, list[dict[str, float]]]]) -> str:
+    """One row per target, mode and phase, in the order the phases were marked."""
+    lines = [f"{'target':<12} {'mode':<6} {'phase':<14} {'mean':>9} {'median':>9} {'stdev':>9} {'min':>9} {'max':>9}"]
+    for target, mode, samples in results:
+        phases: list[str] = []
+        for sample in samples:
+            phases += [phase for phase in sample if phase not in phases]
+        for phase in phases:
+            values = [sample[phase] for sample in samples if phase in sample]
+            summary = summarize_startup(values)
+            lines.append(
+                f"{target:<12} {mode:<6} {phase:<14} {summary['mean']:>9.1f} {summary['median']:>9.1f} "
+                f"{summary['stdev']:>9.1f} {summary['min']:>9.1f} {summary['max']:>9.1f}"
+            )
+    return "\n".join(lines)
+
+
+def bench_startup(
+    executables: dict[str, Path],
+    runs: int,
+    modes: Optional[Sequence[str]],
+    extra_args: Sequence[str],
+) -> int:
+    """Runs each executable cold and warm and prints the phases in milliseconds since main()."""
+    if runs < 1:
+        raise SystemExit("bench-startup: --runs must be at least 1")
+    results = []
+    for target, exe in executables.items():
+        for mode in modes or STARTUP_MODES:
+            results.append((target, mode, run_startup(target, exe, runs, mode, extra_args)))
+    print()
+    print(format_startup_report(results))
+    return 0
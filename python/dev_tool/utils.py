@@ -1,13 +1,16 @@
+import http.client
 import json
 import os
 import re
 import subprocess
 import sys
-import urllib.error
-import urllib.request
+import threading
+import urllib.parse
 from pathlib import Path
 from typing import Iterable, Optional, Sequence, Tuple
 
+from . import probe_cache
+
 
 def run_command(cmd: Sequence[str], *, cwd: Optional[Path] = None) -> None:
     """Invoke a shell command and exit on failure."""
@@ -57,14 +60,104 @@ def _latest_version_string(versions: Iterable[str]) -> Optional[str]:
     return max(cleaned, key=lambda v: parse_version_string(v))
 
 
-def _fetch_url(url: str, *, timeout: float = 10.0) -> tuple[Optional[str], Optional[str]]:
-    """Fetch text content from a URL, returning (body, error)."""
+HTTP_CACHE_FILE_NAME = "http_cache.json"
+_MAX_REDIRECTS = 5
+_http_cache_lock = threading.Lock()
+# Keep-alive connections by (scheme, host), one set per thread.
+_http_connections = threading.local()
+
+
+def _http_cache_path() -> Path:
+    return probe_cache.cache_path().with_name(HTTP_CACHE_FILE_NAME)
+
+
+def _load_http_cache() -> dict:
     try:
-        with urllib.request.urlopen(url, timeout=timeout) as resp:
-            charset = resp.headers.get_content_charset() or "utf-8"
-            return resp.read().decode(charset, errors="ignore"), None
-    except (urllib.error.URLError, urllib.error.HTTPError, TimeoutError, OSError) as exc:
-        return None, str(exc)
+        entries = json.loads(_http_cache_path().read_text(encoding="utf-8"))
+    except (OSError, ValueError):
+        return {}
+    return entries if isinstance(entries, dict) else {}
+
+
+def _remember_response(url: str, entry: dict) -> None:
+    with _http_cache_lock:
+        entries = _load_http_cache()
+        entries[url] = entry
+        path = _http_cache_path()
+        try:
+            path.parent.mkdir(parents=True, exist_ok=True)
+            tmp = path.with_suffix(f".{threading.get_ident()}.tmp")
+            tmp.write_text(json.dumps(entries), encoding="utf-8")
+            os.replace(tmp, path)
+        except OSError:
+            pass
+
+
+def _http_connection(scheme: str, host: str, timeout: float, *, fresh: bool) -> http.client.HTTPConnection:
+    pool = getattr(_http_connections, "pool", None)
+    if pool is None:
+        pool = _http_connections.pool = {}
+    key = (scheme, host)
+    connection = pool.get(key)
+    if connection is None or fresh:
+        if connection is not None:
+            connection.close()
+        factory = http.client.HTTPSConnection if scheme == "https" else http.client.HTTPConnection
+        connection = pool[key] = factory(host, timeout=timeout)
+    return connection
+
+
+def _fetch_url(url: str, *, timeout: float = 10.0) -> tuple[Optional[str], Optional[str]]:
+    """
+    Fetch text content from a URL, returning (body, error).
+
+    Bodies served with an ETag or Last-Modified are kept in http_cache.json beside the probe cache and
+    revalidated with a conditional request, so an unchanged page costs a 304 and no body. Connections are
+    kept alive per thread and host.
+    """
+    with _http_cache_lock:
+        cached = _load_http_cache().get(url)
+    headers = {"User-Agent": "dev_tool", "Accept-Encoding": "identity"}
+    if isinstance(cached, dict):
+        if cached.get("etag"):
+            headers["If-None-Match"] = cached["etag"]
+        if cached.get("last_modified"):
+            headers["If-Modified-Since"] = cached["last_modified"]
+
+    target = url
+    for _ in range(_MAX_REDIRECTS + 1):
+        parts = urllib.parse.urlsplit(target)
+        path = urllib.parse.urlunsplit(("", "", parts.path or "/", parts.query, ""))
+        # A kept-alive connection the server has since closed fails once; retry on a new one.
+        for attempt in range(2):
+            connection = _http_connection(parts.scheme, parts.netloc, timeout, fresh=attempt > 0)
+            try:
+                connection.request("GET", path, headers=headers)
+                response = connection.getresponse()
+                body = response.read()
+                break
+            except (http.client.HTTPException, OSError) as exc:
+                connection.close()
+                if attempt:
+                    return None, str(exc)
+        if response.status in (301, 302, 303, 307, 308) and response.getheader("Location"):
+            target = urllib.parse.urljoin(target, response.getheader("Location"))
+            continue
+        break
+    else:
+        return None, f"Too many redirects from {url}"
+
+    if response.status == 304 and isinstance(cached, dict):
+        return cached.get("body"), None
+    if response.status != 200:
+        return None, f"HTTP Error {response.status}: {response.reason}"
+    charset = response.headers.get_content_charset() or "utf-8"
+    text = body.decode(charset, errors="ignore")
+    etag = response.getheader("ETag")
+    last_modified = response.getheader("Last-Modified")
+    if etag or last_modified:
+        _remember_response(url, {"etag": etag, "last_modified": last_modified, "body": text})
+    return text, None
 
 
 def _extract_versions_from_listing(html: str, *, segments: Optional[int] = None) -> list[str]:
@@ -0,0 +1,251 @@
+"""
+Content-addressed cache for Qt repository archives, served to aqtinstall as a local mirror.
+
+aqtinstall is pointed at the mirror with --base. Metadata (Updates.xml,
+checksum files) is passed through from the upstream repository; archives
+are looked up by the SHA-256 the repository publishes next to them and
+stored as sha256/<ab>/<digest>, so every Qt version and checkout on the
+machine shares one copy of each archive. A download that is cut off keeps
+its bytes in partial/<digest>.part and resumes with a Range request the
+next time aqtinstall asks for the archive. The digest is computed as the
+bytes stream through, so checking it costs no extra pass over the file.
+"""
+
+from __future__ import annotations
+
+import contextlib
+import hashlib
+import os
+import re
+import shutil
+import sys
+import threading
+import urllib.error
+import urllib.parse
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from pathlib import Path
+from typing import BinaryIO, Optional
+
+DEFAULT_UPSTREAM = "https://download.qt.io"
+ARCHIVE_SUFFIXES = (".7z", ".zip", ".tar.gz", ".tar.xz", ".tar.bz2", ".tgz")
+CHUNK_SIZE = 1 << 20
+_SHA256_RE = re.compile(r"\b([0-9a-fA-F]{64})\b")
+
+
+def default_cache_dir() -> Path:
+    """User cache directory shared by all checkouts."""
+    if sys.platform.startswith("win"):
+        base = os.environ.get("LOCALAPPDATA") or os.environ.get("APPDATA")
+        if base:
+            return Path(base) / "CPlusPlusQT6Skel" / "qt-archives"
+    base = os.environ.get("XDG_CACHE_HOME")
+    if base:
+        return Path(base) / "CPlusPlusQT6Skel" / "qt-archives"
+    return Path.home() / ".cache" / "CPlusPlusQT6Skel" / "qt-archives"
+
+
+def is_archive(path: str) -> bool:
+    return path.endswith(ARCHIVE_SUFFIXES)
+
+
+class ArchiveCache:
+    """Archives by SHA-256 under root, fetched from upstream on a miss."""
+
+    def __init__(self, root: Path, upstream: str = DEFAULT_UPSTREAM, timeout: Optional[float] = None) -> None:
+        self.root = Path(root)
+        self.upstream = upstream.rstrip("/")
+        self.timeout = timeout or 60.0
+        self._locks: dict[str, threading.Lock] = {}
+        self._locks_guard = threading.Lock()
+
+    def blob_path(self, digest: str) -> Path:
+        return self.root / "sha256" / digest[:2] / digest
+
+    def partial_path(self, digest: str) -> Path:
+        return self.root / "partial" / f"{digest}.part"
+
+    def _index_path(self, path: str) -> Path:
+        # Repository paths carry the Qt version, so an archive path always names the same bytes.
+        return self.root / "index" / f"{path.strip('/')}.sha256"
+
+    def _lock(self, digest: str) -> threading.Lock:
+        with self._locks_guard:
+            return self._locks.setdefault(digest, threading.Lock())
+
+    def open_upstream(self, path: str, offset: int = 0):
+        request = urllib.request.Request(self.upstream + path)
+        if offset:
+            request.add_header("Range", f"bytes={offset}-")
+        return urllib.request.urlopen(request, timeout=self.timeout)
+
+    def expected_digest(self, path: str) -> Optional[str]:
+        """The SHA-256 the repository publishes for path, remembered after the first lookup."""
+        index = self._index_path(path)
+        try:
+            return index.read_text(encoding="utf-8").strip()
+        except OSError:
+            pass
+        try:
+            with self.open_upstream(path + ".sha256") as response:
+                match = _SHA256_RE.search(response.read().decode("utf-8", "replace"))
+        except (urllib.error.URLError, OSError):
+            return None
+        if not match:
+            return None
+        digest = match.group(1).lower()
+        index.parent.mkdir(parents=True, exist_ok=True)
+        index.write_text(digest, encoding="utf-8")
+        return digest
+
+    def fetch(self, digest: str, path: str, sink: Optional[BinaryIO] = None, on_size=None) -> Path:
+        """Returns the blob for digest, downloading path into it if needed.
+
+        Bytes are also written to sink as they arrive (after on_size(total)
+        is called), so a client is served while the cache fills. Raises
+        OSError, or ValueError on a checksum mismatch.
+        """
+        blob = self.blob_path(digest)
+        with self._lock(digest):
+            if not blob.exists():
+                self._download(digest, path, sink, on_size)
+                return blob
+        if sink is not None:
+            if on_size:
+                on_size(blob.stat().st_size)
+            with blob.open("rb") as source:
+                shutil.copyfileobj(source, sink, CHUNK_SIZE)
+        return blob
+
+    def _download(self, digest: str, path: str, sink: Optional[BinaryIO], on_size) -> None:
+        partial = self.partial_path(digest)
+        partial.parent.mkdir(parents=True, exist_ok=True)
+        offset = partial.stat().st_size if partial.exists() else 0
+        try:
+            response = self.open_upstream(path, offset)
+        except urllib.error.HTTPError as exc:
+            if exc.code != 416 or not offset:
+                raise
+            # The partial file already holds every byte; only the check is left.
+            response = None
+
+        with response if response is not None else contextlib.nullcontext():
+            if response is not None and response.status != 206:
+                offset = 0
+            total = offset
+            if response is not None:
+                length = response.headers.get("Content-Length")
+                total = offset + int(length) if length is not None else -1
+            if on_size:
+                on_size(total)
+
+            hasher = hashlib.sha256()
+            with partial.open("r+b" if offset else "wb") as out:
+                # Resume: hash (and serve) the bytes already on disk before appending.
+                remaining = offset
+                while remaining:
+                    chunk = out.read(min(CHUNK_SIZE, remaining))
+                    if not chunk:
+                        break
+                    remaining -= len(chunk)
+                    hasher.update(chunk)
+                    sink = _write(sink, chunk)
+                out.seek(offset)
+                out.truncate()
+                while response is not None:
+                    chunk = response.read(CHUNK_SIZE)
+                    if not chunk:
+                        break
+                    out.write(chunk)
+                    hasher.update(chunk)
+                    sink = _write(sink, chunk)
+
+        if hasher.hexdigest() != digest:
+            partial.unlink()
+            raise ValueError(f"Checksum mismatch for {path}; discarded the download")
+        blob = self.blob_path(digest)
+        blob.parent.mkdir(parents=True, exist_ok=True)
+        os.replace(partial, blob)
+
+
+def _write(sink: Optional[BinaryIO], chunk: bytes) -> Optional[BinaryIO]:
+    """Writes chunk to sink; a client that hung up stops getting bytes but the download goes on."""
+    if sink is None:
+        return None
+    try:
+        sink.write(chunk)
+        return sink
+    except OSError:
+        return None
+
+
+class CachingMirror:
+    """Serves an ArchiveCache over HTTP on localhost for aqtinstall's --base."""
+
+    def __init__(self, cache: ArchiveCache) -> None:
+        self.cache = cache
+        handler = type("Handler", (_MirrorHandler,), {"cache": cache})
+        self._server = ThreadingHTTPServer(("127.0.0.1", 0), handler)
+        self._server.daemon_threads = True
+        self._thread = threading.Thread(target=self._server.serve_forever, daemon=True)
+
+    @property
+    def url(self) -> str:
+        host, port = self._server.server_address[:2]
+        return f"http://{host}:{port}"
+
+    def __enter__(self) -> "CachingMirror":
+        self._thread.start()
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self._server.shutdown()
+        self._server.server_close()
+
+
+class _MirrorHandler(BaseHTTPRequestHandler):
+    cache: ArchiveCache
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, format: str, *args) -> None:
+        pass
+
+    def do_GET(self) -> None:
+        path = urllib.parse.urlsplit(self.path).path
+        digest = self.cache.expected_digest(path) if is_archive(path) else None
+        try:
+            if digest:
+                self._serve_cached(digest, path)
+            else:
+                self._pass_through(path)
+        except urllib.error.HTTPError as exc:
+            self._send_error(exc.code)
+        except (urllib.error.URLError, OSError, ValueError) as exc:
+            print(f"archive cache: {path}: {exc}")
+            self.close_connection = True
+
+    def _serve_cached(self, digest: str, path: str) -> None:
+        def on_size(total: int) -> None:
+            self.send_response(200)
+            self.send_header("Content-Type", "application/octet-stream")
+            if total >= 0:
+                self.send_header("Content-Length", str(total))
+            else:
+                self.close_connection = True
+            self.end_headers()
+
+        self.cache.fetch(digest, path, self.wfile, on_size)
+
+    def _pass_through(self, path: str) -> None:
+        with self.cache.open_upstream(path) as response:
+            body = response.read()
+        self.send_response(200)
+        self.send_header("Content-Type", response.headers.get("Content-Type", "application/octet-stream"))
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def _send_error(self, code: int) -> None:
+        self.send_response(code)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
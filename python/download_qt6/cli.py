@@ -1,15 +1,22 @@
 import argparse
+import contextlib
 import os
 import subprocess
-from typing import Optional, Sequence
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+from typing import List, Optional, Sequence
 
+from .archive_cache import DEFAULT_UPSTREAM, ArchiveCache, CachingMirror, default_cache_dir
 from .downloader import (
     DEFAULT_MODULES,
     DEFAULT_QT_VERSION,
+    LIST_CACHE_TTL,
+    AqtListCache,
     build_install_qt_cmd,
     build_install_src_cmd,
     build_install_tools_cmds,
     check_build_dependencies,
+    default_list_cache_path,
     detect_host,
     detect_latest_qt_version,
     ensure_aqtinstall,
@@ -63,6 +70,13 @@ def parse_args(argv: Optional[Sequence[str]] = None) -> argparse.Namespace:
         type=int,
         help="Download timeout (seconds) forwarded to aqtinstall.",
     )
+    parser.add_argument(
+        "--list-cache-ttl",
+        type=float,
+        default=LIST_CACHE_TTL,
+        help="Seconds a cached `aqt list-qt` answer is reused when auto-detecting the Qt version "
+        "(default: 6 hours; 0 always asks, falling back to the cache when offline).",
+    )
     parser.add_argument(
         "--with-tools",
         action="store_true",
@@ -83,6 +97,23 @@ def parse_args(argv: Optional[Sequence[str]] = None) -> argparse.Namespace:
         nargs="*",
         help="Specific source archives (omit to fetch the whole Qt source bundle).",
     )
+    parser.add_argument(
+        "--parallel",
+        action="store_true",
+        help="Download Qt, tools and sources at the same time, through the shared archive cache.",
+    )
+    parser.add_argument(
+        "--archive-cache",
+        type=Path,
+        default=None,
+        help="Content-addressed archive cache shared across Qt versions and checkouts "
+        "(default: the user cache directory). Used with --parallel.",
+    )
+    parser.add_argument(
+        "--no-archive-cache",
+        action="store_true",
+        help="With --parallel, download straight from the mirror without the archive cache.",
+    )
     parser.add_argument(
         "--check-build-deps",
         action="store_true",
@@ -124,6 +155,7 @@ def main(argv: Optional[Sequence[str]] = None) -> None:
             base_url=args.base_url,
             timeout=args.timeout,
             compiler=args.compiler,
+            list_cache=AqtListCache(default_list_cache_path(), args.list_cache_ttl),
         )
         if detected_qt:
             print(f"Detected latest Qt version: {detected_qt}")
@@ -133,24 +165,34 @@ def main(argv: Optional[Sequence[str]] = None) -> None:
             print(f"Could not detect latest Qt version; defaulting to {DEFAULT_QT_VERSION}")
             args.qt_version = DEFAULT_QT_VERSION
 
+    fallback_qt_version: Optional[str] = None
+    if (
+        not user_supplied_qt_version
+        and auto_detected_qt_version
+        and auto_detected_qt_version != DEFAULT_QT_VERSION
+    ):
+        fallback_qt_version = DEFAULT_QT_VERSION
+
+    if args.parallel:
+        install_parallel(args, fallback_qt_version)
+    else:
+        install_sequential(args, fallback_qt_version)
+
+    print("Done. Qt is in:", os.path.abspath(args.output_dir))
+
+
+def install_sequential(args: argparse.Namespace, fallback_qt_version: Optional[str]) -> None:
+    """Qt, then the tools, then the sources, one aqtinstall command at a time."""
     install_qt_cmd = build_install_qt_cmd(args)
     try:
         run(install_qt_cmd, dry_run=args.dry_run)
     except subprocess.CalledProcessError:
-        if (
-            not user_supplied_qt_version
-            and auto_detected_qt_version
-            and auto_detected_qt_version != DEFAULT_QT_VERSION
-        ):
-            print(
-                f"Failed to install detected Qt version {auto_detected_qt_version}; "
-                f"falling back to {DEFAULT_QT_VERSION}."
-            )
-            args.qt_version = DEFAULT_QT_VERSION
-            install_qt_cmd = build_install_qt_cmd(args)
-            run(install_qt_cmd, dry_run=args.dry_run)
-        else:
+        if not fallback_qt_version:
             raise
+        print(f"Failed to install detected Qt version {args.qt_version}; falling back to {fallback_qt_version}.")
+        args.qt_version = fallback_qt_version
+        install_qt_cmd = build_install_qt_cmd(args)
+        run(install_qt_cmd, dry_run=args.dry_run)
 
     if args.with_tools:
         for cmd in build_install_tools_cmds(args):
@@ -160,4 +202,50 @@ def main(argv: Optional[Sequence[str]] = None) -> None:
         install_src_cmd = build_install_src_cmd(args)
         run(install_src_cmd, dry_run=args.dry_run)
 
-    print("Done. Qt is in:", os.path.abspath(args.output_dir))
+
+def install_parallel(args: argparse.Namespace, fallback_qt_version: Optional[str]) -> None:
+    """
+    Run the Qt, tools and sources commands concurrently. Unless disabled,
+    aqtinstall downloads through a local mirror backed by the archive cache,
+    so archives are fetched once per machine and interrupted ones resume.
+    """
+    mirror: contextlib.AbstractContextManager = contextlib.nullcontext()
+    if not args.no_archive_cache and not args.dry_run:
+        cache_dir = args.archive_cache or default_cache_dir()
+        cache = ArchiveCache(cache_dir, args.base_url or DEFAULT_UPSTREAM, args.timeout)
+        mirror = CachingMirror(cache)
+        print(f"Archive cache: {cache_dir}")
+
+    with mirror as served:
+        if served is not None:
+            args.base_url = served.url
+
+        def install(cmds: List[List[str]]) -> None:
+            for cmd in cmds:
+                run(cmd, dry_run=args.dry_run)
+
+        def jobs() -> dict[str, List[List[str]]]:
+            planned = {"qt": [build_install_qt_cmd(args)]}
+            if args.with_tools:
+                planned["tools"] = list(build_install_tools_cmds(args))
+            if args.with_src:
+                planned["src"] = [build_install_src_cmd(args)]
+            return planned
+
+        planned = jobs()
+        # A dry run only prints, so keep its output in order.
+        with ThreadPoolExecutor(max_workers=1 if args.dry_run else len(planned)) as pool:
+            futures = {name: pool.submit(install, cmds) for name, cmds in planned.items()}
+        failed = {name for name, future in futures.items() if future.exception()}
+
+        if "qt" in failed and fallback_qt_version:
+            print(f"Failed to install detected Qt version {args.qt_version}; falling back to {fallback_qt_version}.")
+            args.qt_version = fallback_qt_version
+            retry = {name: cmds for name, cmds in jobs().items() if name in {"qt", "src"}}
+            with ThreadPoolExecutor(max_workers=len(retry)) as pool:
+                futures.update({name: pool.submit(install, cmds) for name, cmds in retry.items()})
+            failed = {name for name, future in futures.items() if future.exception()}
+
+        for name in ("qt", "tools", "src"):
+            if name in failed:
+                raise futures[name].exception()
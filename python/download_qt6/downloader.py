@@ -16,12 +16,19 @@ from __future__ import annotations
 
 import argparse
 import importlib.util
+import json
 import os
 import re
 import shutil
 import subprocess
 import sys
-from typing import Iterable, List, Optional, Tuple
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional, Tuple
+
+from .archive_cache import default_cache_dir
 
 
 DEFAULT_MODULES = [
@@ -200,6 +207,73 @@ def detect_msvc_compiler() -> Tuple[Optional[str], Optional[int], Optional[str]]
     return None, major, raw_version
 
 
+LIST_CACHE_TTL = 6 * 3600
+LIST_FAILURE_TTL = 600
+LIST_PROBE_WORKERS = 8
+
+
+def default_list_cache_path() -> Path:
+    """Beside the archive cache, shared by all checkouts."""
+    return default_cache_dir().parent / "aqt-list.json"
+
+
+class AqtListCache:
+    """
+    Outputs of `aqt list-qt` commands on disk, by command line. Entries
+    younger than ttl seconds are used without running aqt, failures for
+    ten minutes at most; older ones are refreshed, and still used when aqt
+    fails, e.g. offline. Safe to use from several threads; save() writes
+    what changed.
+    """
+
+    def __init__(self, path: Path, ttl: float = LIST_CACHE_TTL) -> None:
+        self.path = path
+        self.ttl = ttl
+        self._lock = threading.Lock()
+        self._dirty = False
+        try:
+            entries = json.loads(path.read_text(encoding="utf-8"))
+        except (OSError, ValueError):
+            entries = {}
+        self._entries: Dict[str, dict] = entries if isinstance(entries, dict) else {}
+
+    def output(self, cmd: List[str], timeout: Optional[int]) -> Optional[str]:
+        """cmd's output, or None if it failed and nothing was cached for it."""
+        key = json.dumps(cmd[1:])  # not the interpreter's path
+        with self._lock:
+            entry = self._entries.get(key)
+        if not isinstance(entry, dict):
+            entry = None
+        if entry is not None:
+            ttl = self.ttl if entry.get("output") is not None else min(self.ttl, LIST_FAILURE_TTL)
+            if time.time() - entry.get("time", 0) < ttl:
+                return entry.get("output")
+        try:
+            output = subprocess.check_output(cmd, text=True, encoding="utf-8", timeout=timeout if timeout else None)
+        except (subprocess.CalledProcessError, FileNotFoundError, subprocess.TimeoutExpired):
+            # What was listed before is a better guess than nothing, e.g. offline.
+            if entry is not None and entry.get("output") is not None:
+                return entry["output"]
+            output = None  # e.g. a version without archives for this host
+        with self._lock:
+            self._entries[key] = {"time": time.time(), "output": output}
+            self._dirty = True
+        return output
+
+    def save(self) -> None:
+        with self._lock:
+            if not self._dirty:
+                return
+            try:
+                self.path.parent.mkdir(parents=True, exist_ok=True)
+                tmp = self.path.with_suffix(".tmp")
+                tmp.write_text(json.dumps(self._entries), encoding="utf-8")
+                os.replace(tmp, self.path)
+                self._dirty = False
+            except OSError:
+                pass
+
+
 def detect_latest_qt_version(
     *,
     host: str,
@@ -207,16 +281,20 @@ def detect_latest_qt_version(
     base_url: Optional[str],
     timeout: Optional[int],
     compiler: Optional[str],
+    list_cache: Optional[AqtListCache] = None,
 ) -> Optional[str]:
-    """Ask aqt for the newest Qt version available for the given host/target, validating availability."""
+    """
+    Ask aqt for the newest Qt version available for the given host/target, validating availability.
+    Candidate versions are probed concurrently, newest first, through list_cache (by default the one
+    at default_list_cache_path()).
+    """
 
     if importlib.util.find_spec("aqt") is None:
         return None
+    cache = list_cache or AqtListCache(default_list_cache_path())
 
-    def _build_cmd(extra: Optional[str] = None) -> List[str]:
-        cmd = [sys.executable, "-m", "aqt", "list-qt", host, target]
-        if extra:
-            cmd.append(extra)
+    def _build_cmd(*extra: str) -> List[str]:
+        cmd = [sys.executable, "-m", "aqt", "list-qt", host, target, *extra]
         if base_url:
             cmd.extend(["--base", base_url])
         if timeout:
@@ -237,14 +315,8 @@ def detect_latest_qt_version(
         return tuple(nums)
 
     def _list_versions() -> List[str]:
-        try:
-            output = subprocess.check_output(
-                _build_cmd(),
-                text=True,
-                encoding="utf-8",
-                timeout=timeout if timeout else None,
-            )
-        except (subprocess.CalledProcessError, FileNotFoundError, subprocess.TimeoutExpired):
+        output = cache.output(_build_cmd(), timeout)
+        if output is None:
             return []
         versions: List[str] = []
         for line in output.splitlines():
@@ -255,21 +327,8 @@ def detect_latest_qt_version(
 
     def _version_has_archives(version: str) -> bool:
         # Validate by asking aqt for available architectures for the version; if it errors, skip it.
-        cmd = [sys.executable, "-m", "aqt", "list-qt", host, target, "--arch", version]
-        if base_url:
-            cmd.extend(["--base", base_url])
-        if timeout:
-            cmd.extend(["--timeout", str(timeout)])
-        try:
-            output = subprocess.check_output(
-                cmd,
-                text=True,
-                encoding="utf-8",
-                timeout=timeout if timeout else None,
-            )
-        except (subprocess.CalledProcessError, FileNotFoundError, subprocess.TimeoutExpired):
-            return False
-        if not output.strip():
+        output = cache.output(_build_cmd("--arch", version), timeout)
+        if not output or not output.strip():
             return False
         if compiler:
             archs = {token for line in output.splitlines() for token in line.strip().split() if token}
@@ -277,12 +336,19 @@ def detect_latest_qt_version(
                 return False
         return True
 
-    versions = _list_versions()
-    for version in sorted(versions, key=_version_key, reverse=True):
-        if _version_has_archives(version):
-            return version
-
-    return None
+    try:
+        versions = sorted(_list_versions(), key=_version_key, reverse=True)
+        if not versions:
+            return None
+        # Results are taken newest first; once one has archives, probes not started yet are dropped.
+        with ThreadPoolExecutor(max_workers=min(LIST_PROBE_WORKERS, len(versions))) as pool:
+            for version, available in zip(versions, pool.map(_version_has_archives, versions)):
+                if available:
+                    pool.shutdown(wait=True, cancel_futures=True)
+                    return version
+        return None
+    finally:
+        cache.save()
 
 
 def _read_os_release() -> Tuple[Optional[str], Optional[str]]:
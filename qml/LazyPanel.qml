@@ -0,0 +1,11 @@
+import QtQuick
+
+// A panel whose content is created off the critical path: the Loader
+// incubates it asynchronously, across frames under the engine's incubation
+// controller (FrameIncubator in sample_app), and the panel stays hidden
+// until it is complete. Set source or sourceComponent as on any Loader;
+// leave active false to defer a panel that is off-screen until it is needed.
+Loader {
+    asynchronous: true
+    visible: status === Loader.Ready
+}
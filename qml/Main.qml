@@ -3,6 +3,9 @@ import QtQuick.Controls
 
 ApplicationWindow {
     id: window
+
+    readonly property Greeter greeter: Greeter
+
     width: 400
     height: 260
     visible: true
@@ -30,14 +33,21 @@ ApplicationWindow {
             id: helloButton
             objectName: "helloButton"
             text: "Say hello"
-            onClicked: outputLabel.text = greeter.greet(nameField.text)
+            onClicked: greeter.greetAsync(nameField.text)
         }
 
-        Label {
-            id: outputLabel
-            objectName: "outputLabel"
-            text: "Press the button"
-            wrapMode: Text.Wrap
+        ListView {
+            id: historyView
+            objectName: "historyView"
+            width: 300
+            height: 120
+            clip: true
+            reuseItems: true
+            model: greeter.history
+            onCountChanged: positionViewAtEnd()
+            delegate: Label {
+                text: model.greeting
+            }
         }
     }
 }
@@ -0,0 +1,184 @@
+#include "binding_profiler.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMetaProperty>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QStringList>
+#include <QUrl>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// The method index qt_metacall() takes as the changed slot.
+const int kChangedSlot = QObject::staticMetaObject.methodCount();
+
+}  // namespace
+
+BindingProfiler::BindingProfiler(QObject *parent) : QObject(parent) {}
+
+void BindingProfiler::attach(QQuickWindow *window) {
+    watch(window);
+    watch(window->contentItem());
+    connect(window, &QQuickWindow::afterAnimating, this, [this] { endFrame(); });
+}
+
+void BindingProfiler::watch(QObject *object) {
+    if (!object || watched_.contains(object)) {
+        return;
+    }
+    QList<int> &connected = watched_[object];
+    if (qmlContext(object)) {
+        // Properties sharing a notify signal share a counter.
+        const QMetaObject *meta = object->metaObject();
+        QMap<int, QString> properties;
+        for (int i = QObject::staticMetaObject.propertyCount(); i < meta->propertyCount(); ++i) {
+            const QMetaProperty property = meta->property(i);
+            if (property.hasNotifySignal()) {
+                QString &names = properties[property.notifySignalIndex()];
+                names += (names.isEmpty() ? QString() : QStringLiteral("/")) + QString::fromLatin1(property.name());
+            }
+        }
+        const QString label = describe(object);
+        for (auto it = properties.cbegin(); it != properties.cend(); ++it) {
+            const QString name = label + QLatin1Char('\n') + it.value();
+            auto counter = byName_.constFind(name);
+            if (counter == byName_.constEnd()) {
+                counters_.push_back(Counter{Entry{label, it.value()}});
+                counter = byName_.insert(name, counters_.size() - 1);
+            }
+            bySignal_.insert(qMakePair(static_cast<const QObject *>(object), it.key()), *counter);
+            QMetaObject::connect(object, it.key(), this, kChangedSlot, Qt::DirectConnection);
+            connected.append(it.key());
+        }
+    }
+    connect(object, &QObject::destroyed, this, [this](QObject *gone) { forget(gone); });
+
+    // Delegates and loaded items are parented to items after creation.
+    if (auto *item = qobject_cast<QQuickItem *>(object)) {
+        connect(item, &QQuickItem::childrenChanged, this, [this, item] {
+            for (QQuickItem *child : item->childItems()) {
+                watch(child);
+            }
+        });
+        for (QQuickItem *child : item->childItems()) {
+            watch(child);
+        }
+    }
+    for (QObject *child : object->children()) {
+        watch(child);
+    }
+}
+
+std::vector<BindingProfiler::Entry> BindingProfiler::entries() const {
+    std::vector<Entry> entries;
+    for (const Counter &counter : counters_) {
+        if (counter.entry.changes > 0) {
+            entries.push_back(counter.entry);
+            entries.back().maxPerFrame = std::max(counter.entry.maxPerFrame, counter.thisFrame);
+        }
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry &a, const Entry &b) { return a.changes > b.changes; });
+    return entries;
+}
+
+QByteArray BindingProfiler::toJson() const {
+    QJsonArray properties;
+    for (const Entry &entry : entries()) {
+        properties.append(QJsonObject{
+            {QStringLiteral("object"), entry.object},
+            {QStringLiteral("property"), entry.property},
+            {QStringLiteral("changes"), static_cast<double>(entry.changes)},
+            {QStringLiteral("maxPerFrame"), entry.maxPerFrame},
+            {QStringLiteral("framesChanged"), entry.framesChanged},
+        });
+    }
+    const QJsonObject report{
+        {QStringLiteral("frames"), frames_},
+        {QStringLiteral("properties"), properties},
+    };
+    return QJsonDocument(report).toJson(QJsonDocument::Indented);
+}
+
+bool BindingProfiler::write(const QString &path) const {
+    const QByteArray json = toJson();
+    if (path == QLatin1String("-")) {
+        std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+        std::fflush(stdout);
+        return true;
+    }
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(json) == json.size();
+}
+
+int BindingProfiler::qt_metacall(QMetaObject::Call call, int id, void **arguments) {
+    id = QObject::qt_metacall(call, id, arguments);
+    if (id < 0) {
+        return id;
+    }
+    if (call == QMetaObject::InvokeMetaMethod) {
+        if (id == 0) {
+            changed(sender(), senderSignalIndex());
+        }
+        --id;
+    }
+    return id;
+}
+
+void BindingProfiler::changed(const QObject *object, int signal) {
+    const auto it = bySignal_.constFind(qMakePair(object, signal));
+    if (it == bySignal_.constEnd()) {
+        return;
+    }
+    Counter &counter = counters_[*it];
+    ++counter.entry.changes;
+    if (counter.thisFrame++ == 0) {
+        touched_.push_back(*it);
+    }
+}
+
+void BindingProfiler::endFrame() {
+    for (const size_t index : touched_) {
+        Counter &counter = counters_[index];
+        counter.entry.maxPerFrame = std::max(counter.entry.maxPerFrame, counter.thisFrame);
+        ++counter.entry.framesChanged;
+        counter.thisFrame = 0;
+    }
+    touched_.clear();
+    ++frames_;
+}
+
+void BindingProfiler::forget(const QObject *object) {
+    for (const int signal : watched_.value(object)) {
+        bySignal_.remove(qMakePair(object, signal));
+    }
+    watched_.remove(object);
+}
+
+QString BindingProfiler::describe(const QObject *object) {
+    QStringList parts;
+    if (const QQmlContext *context = qmlContext(object)) {
+        parts.append(context->baseUrl().fileName());
+        const QString id = context->nameForObject(object);
+        if (!id.isEmpty()) {
+            parts.append(id);
+        }
+    }
+    // QML types, and objects that declare properties, have a generated
+    // suffix: Main_QMLTYPE_0, QQuickItem_QML_3.
+    QString type = QString::fromLatin1(object->metaObject()->className());
+    const qsizetype suffix = type.indexOf(QLatin1String("_QML"));
+    if (suffix > 0) {
+        type.truncate(suffix);
+    }
+    parts.append(QLatin1Char('(') + type + QLatin1Char(')'));
+    return parts.join(QLatin1Char(' '));
+}
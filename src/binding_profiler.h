@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <vector>
+
+class QQuickWindow;
+
+// Counts how often each property of a window's QML objects changes, per
+// object and property, to find binding storms: a binding evaluated over
+// and over within a frame, or a property that sets off many others. Each
+// change is a notify signal, emitted when a binding's new value differs
+// from the old one or when the property is written, so a binding that
+// re-evaluates to the same value is not counted.
+//
+//   BindingProfiler profiler;
+//   profiler.attach(window);            // e.g. on objectCreated
+//   ...
+//   profiler.write("bindings.json");    // or "-" for stdout
+//
+// Objects are counted by where they were declared: their file, id and
+// type, so the delegates of a view add up under one entry. Objects that
+// Loaders and views create later are watched as they appear. Debugging
+// aid only: connecting to every notify signal makes emitting them cost
+// more, and some items do extra work once a signal is connected.
+class BindingProfiler : public QObject {
+public:
+    struct Entry {
+        QString object;  // "Main.qml greetingText (QQuickText)"
+        QString property;
+        quint64 changes = 0;
+        int maxPerFrame = 0;    // most changes within one frame
+        int framesChanged = 0;  // frames with at least one change
+    };
+
+    explicit BindingProfiler(QObject *parent = nullptr);
+
+    // Watches the window, its items and the QML objects they own, and ends
+    // a frame each time the window's animations advance.
+    void attach(QQuickWindow *window);
+    // Watches object and the QML objects under it.
+    void watch(QObject *object);
+
+    // Entries that changed, most changes first.
+    std::vector<Entry> entries() const;
+    int frames() const { return frames_; }
+
+    // {"frames": 120, "properties": [{"object": "Main.qml greetingText
+    // (QQuickText)", "property": "text", "changes": 4, "maxPerFrame": 1,
+    // "framesChanged": 4}, ...]}, most changes first.
+    QByteArray toJson() const;
+    // Writes toJson() to path, or stdout for "-"; false if it cannot.
+    bool write(const QString &path) const;
+
+    // The slot every notify signal is connected to, past QObject's own
+    // methods, as QSignalSpy does it.
+    int qt_metacall(QMetaObject::Call call, int id, void **arguments) override;
+
+private:
+    struct Counter {
+        Entry entry;
+        int thisFrame = 0;
+    };
+
+    void changed(const QObject *object, int signal);
+    void endFrame();
+    void forget(const QObject *object);
+    static QString describe(const QObject *object);
+
+    std::vector<Counter> counters_;
+    QHash<QString, size_t> byName_;                        // object and property, to counters_
+    QHash<QPair<const QObject *, int>, size_t> bySignal_;  // sender and notify signal, to counters_
+    QHash<const QObject *, QList<int>> watched_;           // the notify signals connected, per object
+    std::vector<size_t> touched_;                          // counters changed this frame
+    int frames_ = 0;
+};
@@ -1,28 +1,112 @@
+#include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMetaObject>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <curses.h>
+#include <deque>
+#include <functional>
 #include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #include "greeter.h"
+#include "mapped_file.h"
+#include "memory_pressure.h"
+#include "metrics_endpoint.h"
+#include "prefork_supervisor.h"
+#include "qml_ast_cache.h"
+#include "qml_buffer_screen.h"
+#include "qml_bundle.h"
+#include "qml_cache_budget.h"
+#include "qml_cell_grid.h"
+#include "qml_compressed_document.h"
 #include "qml_curses_frontend.h"
+#include "qml_document_handle.h"
+#include "qml_executor.h"
+#include "qml_export.h"
+#include "qml_frame_scheduler.h"
+#include "qml_index_service.h"
+#include "qml_input_coalescer.h"
+#include "qml_log.h"
+#include "qml_meta_resolver.h"
+#include "qml_metrics.h"
+#include "qml_notify_bridge.h"
 #include "qml_parser.h"
+#include "qml_project_index.h"
+#include "qml_qt_coroutine.h"
+#include "qml_qt_list_model.h"
+#include "qml_qt_resources.h"
+#include "qml_remote_screen.h"
+#include "qml_screen_trace.h"
+#include "qml_session_memory.h"
+#include "qml_spsc_queue.h"
+#include "qml_telnet.h"
+#include "qml_timeline.h"
+#include "qml_trace.h"
+#include "qml_vt_screen.h"
+
+#ifdef _WIN32
+#include <QWinEventNotifier>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#undef MOUSE_MOVED  // curses.h and wincon.h both define it
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <QSocketNotifier>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace {
 
-std::string resolveBinding(const Greeter &greeter, const std::string &binding) {
-    if (binding == "greeter.message") {
-        return greeter.message().toStdString();
-    }
-    if (binding == "greeter.greet" || binding == "greeter.greet()") {
-        return greeter.greet("").toStdString();
+// Main.qml of the Sample module, compiled in through sample_support; see
+// qt_add_qml_module in CMakeLists.txt.
+constexpr const char *kEmbeddedMainQml = ":/qt/qml/Sample/Main.qml";
+
+std::string defaultQmlPath(const std::filesystem::path &exeDir, bool onDisk) {
+    // The embedded copy is read in place without touching the disk; --watch
+    // needs a file that can change.
+    if (!onDisk && MappedFile::exists(kEmbeddedMainQml)) {
+        return kEmbeddedMainQml;
     }
-    return binding;
-}
 
-std::string defaultQmlPath(const std::filesystem::path &exeDir) {
     // Try a sibling "qml" folder first (matches source layout).
     const std::filesystem::path repoPath = exeDir / "qml" / "Main.qml";
     if (std::filesystem::exists(repoPath)) {
@@ -38,22 +122,2000 @@ std::string defaultQmlPath(const std::filesystem::path &exeDir) {
     return "qml/Main.qml";
 }
 
+MappedFile openSource(const std::string &path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        throw std::runtime_error("Failed to open QML file: " + path);
+    }
+    return file;
+}
+
+std::string readSource(const std::string &path) {
+    return std::string(openSource(path).view());
+}
+
+// Directories named by import "relative/path" lines; components in them
+// are part of what the file renders.
+QStringList localImportDirectories(std::string_view source, const std::filesystem::path &baseDir) {
+    QStringList directories;
+    for (const QmlImport &import : QmlProjectIndex::imports(source)) {
+        const std::filesystem::path dir = baseDir / import.uri;
+        if (import.local && std::filesystem::is_directory(dir)) {
+            directories << QString::fromStdWString(dir.wstring());
+        }
+    }
+    return directories;
+}
+
+// How long a burst of resize events must pause before the screen is redrawn.
+constexpr int kResizeSettleMs = 30;
+
+// ncurses resizes stdscr itself before reporting KEY_RESIZE; PDCurses
+// leaves that to the application.
+void acknowledgeResize() {
+#ifdef PDCURSES
+    resize_term(0, 0);
+#endif
+}
+
+// Hands a curses mouse event to the frontend: the wheel is reported as
+// presses of buttons 4 and 5.
+bool handleMouse(QmlFrontendCore &frontend, const MEVENT &mouse) {
+    using Action = QmlFrontendCore::MouseAction;
+    if (mouse.bstate & BUTTON4_PRESSED) {
+        return frontend.handleMouse(Action::WheelUp, mouse.y, mouse.x);
+    }
+#ifdef BUTTON5_PRESSED
+    if (mouse.bstate & BUTTON5_PRESSED) {
+        return frontend.handleMouse(Action::WheelDown, mouse.y, mouse.x);
+    }
+#endif
+    if (mouse.bstate & (BUTTON1_PRESSED | BUTTON1_CLICKED)) {
+        return frontend.handleMouse(Action::Press, mouse.y, mouse.x);
+    }
+    return false;
+}
+
+// A QML file open in the interactive frontend, one per file named. Each
+// tab keeps its document, compiled plan, binding cache and last frame
+// while another is shown, so switching back costs a compose and a full
+// repaint rather than a load, a layout and a resolve. Only the shown tab
+// renders: a hidden one's bindings are marked stale as their sources
+// change and resolved once it is shown again, and its timeline, which
+// holds its animations and cursor blink, sleeps until then.
+struct DocumentTab {
+    std::string path;
+    std::string source;  // read only for reloads and full expansion
+    QmlDocument document;
+    // Ids such as nameField resolve to the nodes of the document as it was
+    // loaded; the resolver keeps a pointer, so it gets its own snapshot.
+    QmlDocument resolverDocument;
+    // Holds the frontend's tracks, so it outlives it.
+    std::unique_ptr<QmlTimeline> timeline;
+    std::unique_ptr<QmlCursesFrontend> frontend;
+    bool timelineParked = false;  // asked to wake while hidden
+    // While hidden, the document may be held compressed instead; both
+    // documents are then empty.
+    QmlCompressedDocument compressed;
+    uint64_t lastShown = 0;  // the tab switch that last hid or showed it; 0 for never
+};
+
+#ifndef _WIN32
+// SIGWINCH does not make stdin readable, so the handler wakes the event
+// loop through a pipe. It chains to the handler curses installed, which
+// is what makes the next getch() report KEY_RESIZE.
+int resizePipe[2] = {-1, -1};
+struct sigaction previousWinch;
+
+void onWinch(int signal) {
+    if (previousWinch.sa_handler != SIG_DFL && previousWinch.sa_handler != SIG_IGN) {
+        previousWinch.sa_handler(signal);
+    }
+    const char byte = 0;
+    [[maybe_unused]] const ssize_t written = ::write(resizePipe[1], &byte, 1);
+}
+#endif
+
+// Delivers curses keystrokes from the Qt event loop. The loop sleeps until
+// stdin (the console input handle on Windows) has input or the terminal is
+// resized, and every key queued by then is handed to the handler as one
+// batch, with the time the first was read. Nothing polls, so an idle CLI
+// uses no CPU.
+class TerminalInput {
+public:
+    using KeyHandler = std::function<void(const std::vector<int> &keys, std::chrono::steady_clock::time_point readAt)>;
+
+    explicit TerminalInput(KeyHandler handler)
+        : handler_(std::move(handler)),
+#ifdef _WIN32
+          notifier_(GetStdHandle(STD_INPUT_HANDLE))
+#else
+          notifier_(STDIN_FILENO, QSocketNotifier::Read)
+#endif
+    {
+        nodelay(stdscr, TRUE);
+#ifdef _WIN32
+        QObject::connect(&notifier_, &QWinEventNotifier::activated, [this] { drain(); });
+#else
+        QObject::connect(&notifier_, &QSocketNotifier::activated, [this] { drain(); });
+        if (pipe(resizePipe) == 0) {
+            fcntl(resizePipe[0], F_SETFL, O_NONBLOCK);
+            fcntl(resizePipe[1], F_SETFL, O_NONBLOCK);
+            struct sigaction action {};
+            action.sa_handler = onWinch;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGWINCH, &action, &previousWinch);
+            resizeNotifier_ = std::make_unique<QSocketNotifier>(resizePipe[0], QSocketNotifier::Read);
+            QObject::connect(resizeNotifier_.get(), &QSocketNotifier::activated, [this] {
+                char bytes[64];
+                while (::read(resizePipe[0], bytes, sizeof bytes) > 0) {
+                }
+                drain();
+            });
+        }
+#endif
+        // Keys typed before the loop started do not trigger the notifier.
+        QTimer::singleShot(0, [this] { drain(); });
+    }
+
+    ~TerminalInput() {
+#ifndef _WIN32
+        if (resizeNotifier_) {
+            resizeNotifier_.reset();
+            sigaction(SIGWINCH, &previousWinch, nullptr);
+            close(resizePipe[0]);
+            close(resizePipe[1]);
+            resizePipe[0] = resizePipe[1] = -1;
+        }
+#endif
+    }
+
+    TerminalInput(const TerminalInput &) = delete;
+    TerminalInput &operator=(const TerminalInput &) = delete;
+
+private:
+    void drain() {
+        keys_.clear();
+        int key = getch();
+        const auto readAt = std::chrono::steady_clock::now();
+        for (; key != ERR; key = getch()) {
+            keys_.push_back(key);
+        }
+        if (!keys_.empty()) {
+            handler_(keys_, readAt);
+        }
+    }
+
+    KeyHandler handler_;
+#ifdef _WIN32
+    QWinEventNotifier notifier_;
+#else
+    QSocketNotifier notifier_;
+    std::unique_ptr<QSocketNotifier> resizeNotifier_;
+#endif
+    std::vector<int> keys_;
+};
+
+// Keeps the screen in sync with a QML file while it is being edited.
+// Change notifications are debounced, the reparse and diff run on a worker
+// thread, and the UI thread only applies finished results to the frontend
+// and publishes them; readers on any thread take the current version from
+// the handle without waiting for a reparse. The component files the
+// frontend instantiated are watched too; a change to one drops it from the
+// project index and the frontend's instances, and the screen is redrawn.
+class HotReloader {
+public:
+    HotReloader(std::string path, std::string source, QmlDocument document, QmlProjectIndex &project,
+                QmlCursesFrontend &frontend)
+        : path_(std::move(path)),
+          source_(std::move(source)),
+          document_(std::move(document)),
+          project_(project),
+          frontend_(frontend) {
+        debounce_.setSingleShot(true);
+        debounce_.setInterval(kDebounceMs);
+        QObject::connect(&debounce_, &QTimer::timeout, [this] { startReparse(); });
+
+        // Editors often save by replacing the file, which drops it from
+        // the watch list; watching its directory catches that case.
+        const std::filesystem::path file(path_);
+        QStringList paths{QString::fromStdString(path_)};
+        paths << QString::fromStdWString(file.parent_path().empty() ? L"." : file.parent_path().wstring());
+        paths << localImportDirectories(source_, file.parent_path());
+        watcher_.addPaths(paths);
+        watchComponents();
+        const auto changed = [this](const QString &changedPath) { onChanged(changedPath); };
+        QObject::connect(&watcher_, &QFileSystemWatcher::fileChanged, changed);
+        QObject::connect(&watcher_, &QFileSystemWatcher::directoryChanged, changed);
+    }
+
+    ~HotReloader() {
+        if (reparse_.valid()) {
+            reparse_.wait();
+        }
+    }
+
+    // An O(1) snapshot of the current version.
+    QmlDocument document() const { return document_.snapshot(); }
+    // The text the current version was parsed from.
+    const std::string &source() const { return source_; }
+
+    // Adds the component files parsed since the last call, and their
+    // directories, to the watch list. Cheap when there are none; call it
+    // after each frame, since the frontend instantiates as it scrolls.
+    void watchComponents() {
+        const size_t parsed = project_.parseCount();
+        if (parsed == watchedParseCount_) {
+            return;
+        }
+        watchedParseCount_ = parsed;
+        QStringList paths;
+        for (const std::string &component : project_.dependenciesOf(path_)) {
+            paths << QString::fromStdString(component)
+                  << QString::fromStdWString(std::filesystem::path(component).parent_path().wstring());
+        }
+        const QStringList watched = watcher_.files() + watcher_.directories();
+        paths.removeDuplicates();
+        paths.erase(std::remove_if(paths.begin(), paths.end(),
+                                   [&watched](const QString &path) { return watched.contains(path); }),
+                    paths.end());
+        if (!paths.isEmpty()) {
+            watcher_.addPaths(paths);
+        }
+    }
+
+private:
+    static constexpr int kDebounceMs = 150;
+
+    struct Result {
+        std::string source;
+        QmlDocument previous;
+        QmlDocument document;
+        QmlDocumentDiff diff;  // points into previous and document
+    };
+
+    void onChanged(const QString &changed) {
+        if (changed.toStdString() != path_ && project_.invalidate(changed.toStdString()) > 0) {
+            componentsChanged_ = true;
+        }
+        if (!watcher_.files().contains(QString::fromStdString(path_))) {
+            watcher_.addPath(QString::fromStdString(path_));
+        }
+        debounce_.start();  // restarts: a burst of saves reparses once
+    }
+
+    void startReparse() {
+        if (busy_) {
+            pending_ = true;
+            return;
+        }
+        std::string source;
+        try {
+            source = readSource(path_);
+        } catch (const std::exception &ex) {
+            QmlLog::debug("Could not read {} yet: {}", path_, ex.what());
+            return;  // mid-save; the next notification retries
+        }
+        if (componentsChanged_) {
+            componentsChanged_ = false;
+            QmlLog::info("Components used by {} changed", path_);
+            frontend_.invalidateComponents();
+            if (source == source_) {
+                frontend_.render(document());
+                return;
+            }
+        }
+        if (source == source_) {
+            return;
+        }
+        // The file's imports may have changed with it.
+        project_.invalidate(path_);
+
+        busy_ = true;
+        reparse_ = QmlExecutor::shared().submit(
+            "HotReloader::reparse", QmlExecutor::Priority::Normal,
+            [this, previous = document_.snapshot(), oldSource = source_, source = std::move(source)]() mutable {
+                auto result = std::make_shared<Result>();
+                const QmlTextEdit edit = QmlTextEdit::between(oldSource, source);
+                result->document = parser_.reparse(previous, oldSource, edit);
+                result->diff = QmlDocumentDiff::compute(previous, result->document);
+                result->previous = std::move(previous);
+                result->source = std::move(source);
+                QMetaObject::invokeMethod(QCoreApplication::instance(), [this, result] { apply(*result); },
+                                          Qt::QueuedConnection);
+            });
+    }
+
+    void apply(Result &result) {
+        QmlLog::info("Reloaded {}: {} bytes", path_, result.source.size());
+        frontend_.update(result.document, result.diff);
+        // Moving keeps the nodes where the diff and the frontend saw them.
+        document_.publish(std::move(result.document));
+        source_ = std::move(result.source);
+        busy_ = false;
+        if (pending_) {
+            pending_ = false;
+            startReparse();
+        }
+    }
+
+    std::string path_;
+    std::string source_;
+    QmlDocumentHandle document_;
+    QmlParser parser_;  // kept so each reparse reuses its scratch buffers
+    QmlProjectIndex &project_;
+    QmlCursesFrontend &frontend_;
+    QFileSystemWatcher watcher_;
+    QTimer debounce_;
+    std::future<void> reparse_;  // on the shared executor
+    size_t watchedParseCount_ = 0;
+    bool busy_ = false;
+    bool pending_ = false;
+    bool componentsChanged_ = false;
+};
+
+// With --trace, records spans from startup on and writes them as Chrome
+// trace_event JSON when main() returns, whichever way it does.
+class TraceFile {
+public:
+    explicit TraceFile(std::filesystem::path path) : path_(std::move(path)) {
+        QmlTrace::setEnabled(!path_.empty());
+        if (!path_.empty()) {
+            // Each task on the shared executor is a span on its worker's
+            // track, and how long it waited a counter.
+            QmlExecutor::shared().setTaskHook([](const QmlExecutor::TaskEvent &event) {
+                if (!QmlTrace::enabled()) {
+                    return;
+                }
+                QmlTrace::record(event.name, event.begin, event.end);
+                QmlTrace::counter("QmlExecutor queue wait", "us", event.begin,
+                                  std::chrono::duration_cast<std::chrono::microseconds>(event.begin - event.queued)
+                                      .count());
+            });
+        }
+    }
+    ~TraceFile() {
+        if (path_.empty()) {
+            return;
+        }
+        QmlTrace::setEnabled(false);
+        const std::string json = QmlTrace::chromeJson();
+        std::ofstream file(path_, std::ios::binary | std::ios::trunc);
+        file.write(json.data(), static_cast<std::streamsize>(json.size()));
+        if (!file) {
+            std::cerr << "Could not write " << path_.string() << std::endl;
+        }
+    }
+
+    TraceFile(const TraceFile &) = delete;
+    TraceFile &operator=(const TraceFile &) = delete;
+
+private:
+    std::filesystem::path path_;
+};
+
+// With --log, writes diagnostics to a file, or to stderr for "-", from the
+// logger's writer thread, so the event loop never waits on the disk. The
+// curses screen owns the terminal, so "-" suits only the headless modes.
+class LogFile {
+public:
+    LogFile(const std::string &path, QmlLogLevel level) {
+        if (path.empty()) {
+            return;
+        }
+        file_ = path == "-" ? stderr : std::fopen(path.c_str(), "a");
+        if (file_ == nullptr) {
+            std::cerr << "Could not open " << path << " for logging" << std::endl;
+            return;
+        }
+        QmlLog::start(QmlLog::fileSink(file_), level);
+    }
+    ~LogFile() {
+        if (file_ == nullptr) {
+            return;
+        }
+        QmlLog::stop();
+        if (file_ != stderr) {
+            std::fclose(file_);
+        }
+    }
+
+    LogFile(const LogFile &) = delete;
+    LogFile &operator=(const LogFile &) = delete;
+
+private:
+    std::FILE *file_ = nullptr;
+};
+
+// Parses a --log-level name.
+bool parseLogLevel(const QString &text, QmlLogLevel &level) {
+    static const std::pair<const char *, QmlLogLevel> kLevels[] = {{"debug", QmlLogLevel::Debug},
+                                                                    {"info", QmlLogLevel::Info},
+                                                                    {"warning", QmlLogLevel::Warning},
+                                                                    {"error", QmlLogLevel::Error}};
+    for (const auto &entry : kLevels) {
+        if (text == QLatin1String(entry.first)) {
+            level = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Bytes a viewer's socket may have queued before frames to it are
+// dropped; it is caught up with a keyframe once the queue drains.
+constexpr qint64 kViewerBacklogBytes = 64 * 1024;
+
+// Parses "COLSxROWS".
+bool parseSize(const QString &text, int &rows, int &cols) {
+    const QStringList parts = text.split(QLatin1Char('x'));
+    bool colsOk = false;
+    bool rowsOk = false;
+    if (parts.size() == 2) {
+        cols = parts[0].toInt(&colsOk);
+        rows = parts[1].toInt(&rowsOk);
+    }
+    return colsOk && rowsOk && rows > 0 && cols > 0;
+}
+
+// Document loads, for --metrics: how long they took and how many the AST
+// cache answered.
+struct LoadMetrics {
+    QmlLatencyHistogram loadTime;
+    uint64_t cacheHits = 0;
+    uint64_t cacheMisses = 0;
+};
+
+// What --metrics exports besides each mode's own counters.
+struct MetricsSource {
+    QString endpoint;  // [ADDRESS:]PORT; empty when not exporting
+    std::string path;  // of the document
+    LoadMetrics loads;
+};
+
+// A frontend and the labels its families carry, e.g. view="80x24".
+struct LabelledFrontend {
+    std::string labels;
+    const QmlFrontendCore *frontend;
+};
+
+// Starts the --metrics endpoint; null, having said why, if it cannot
+// listen.
+std::unique_ptr<MetricsEndpoint> startMetrics(const QString &endpoint, MetricsEndpoint::Collect collect) {
+    auto metrics = std::make_unique<MetricsEndpoint>(std::move(collect));
+    if (!metrics->listen(endpoint)) {
+        std::cerr << "Could not serve metrics on " << endpoint.toStdString() << ": "
+                  << metrics->errorString().toStdString() << std::endl;
+        return nullptr;
+    }
+    std::cerr << "Serving metrics on http://" << metrics->address().toString().toStdString() << ":"
+              << metrics->port() << "/metrics" << std::endl;
+    return metrics;
+}
+
+// The families every mode exports: the document and its loads, and the
+// frames its scheduler committed.
+void collectCommon(QmlMetricsText &text, const MetricsSource &source, const QmlDocument &document,
+                   const QmlFrameScheduler &scheduler) {
+    using Type = QmlMetricsText::Type;
+    text.family("qml_load_seconds", Type::Histogram, "Time to load a document, parsed or from the AST cache.",
+                "seconds");
+    text.histogram(source.loads.loadTime);
+    text.family("qml_ast_cache_hits", Type::Counter, "Loads answered by the AST cache.");
+    text.counter(static_cast<double>(source.loads.cacheHits));
+    text.family("qml_ast_cache_misses", Type::Counter, "Loads the AST cache could not answer.");
+    text.counter(static_cast<double>(source.loads.cacheMisses));
+    const std::string label = QmlMetricsText::label("document", source.path);
+    const QmlMemoryUsage memory = document.memoryUsage();
+    text.family("qml_document_bytes", Type::Gauge, "Memory the parsed document holds.", "bytes");
+    text.gauge(static_cast<double>(memory.total()), label);
+    text.family("qml_document_nodes", Type::Gauge, "Nodes in the parsed document.");
+    text.gauge(static_cast<double>(memory.nodeCount), label);
+
+    text.family("qml_frame_seconds", Type::Histogram, "Time to render and commit a frame.", "seconds");
+    text.histogram(scheduler.frameTimes());
+    text.family("qml_frames_committed", Type::Counter, "Frames committed.");
+    text.counter(static_cast<double>(scheduler.framesCommitted()));
+    text.family("qml_frames_dropped", Type::Counter, "Frame deadlines missed.");
+    text.counter(static_cast<double>(scheduler.droppedFrames()));
+    text.family("qml_frame_requests_coalesced", Type::Counter, "Redraw requests folded into a pending frame.");
+    text.counter(static_cast<double>(scheduler.requestsCoalesced()));
+}
+
+void collectFrontends(QmlMetricsText &text, const std::vector<LabelledFrontend> &frontends) {
+    using Type = QmlMetricsText::Type;
+    text.family("qml_resolve_seconds", Type::Histogram, "Time to resolve a frame's changed bindings.", "seconds");
+    for (const LabelledFrontend &entry : frontends) {
+        text.histogram(entry.frontend->resolveLatency(), entry.labels);
+    }
+    text.family("qml_input_latency_seconds", Type::Histogram, "Time from reading input to showing its frame.",
+                "seconds");
+    for (const LabelledFrontend &entry : frontends) {
+        text.histogram(entry.frontend->inputLatency(), entry.labels);
+    }
+    text.family("qml_frontend_frames", Type::Counter, "Frames drawn.");
+    for (const LabelledFrontend &entry : frontends) {
+        text.counter(static_cast<double>(entry.frontend->frameCount()), entry.labels);
+    }
+    text.family("qml_frontend_identical_frames", Type::Counter, "Frames that changed no cell and were not sent.");
+    for (const LabelledFrontend &entry : frontends) {
+        text.counter(static_cast<double>(entry.frontend->identicalFrameCount()), entry.labels);
+    }
+}
+
+// Renders the document once per frame into a QmlRemoteScreen and streams
+// it to every viewer that connects; the server needs no terminal.
+int serve(QCoreApplication &app, const QmlDocument &document, quint16 port, int rows, int cols, int frameRate,
+          const MetricsSource &metricsSource) {
+    QmlRemoteScreen screen(rows, cols);
+    Greeter greeter;
+    QmlMetaResolver resolver;
+    resolver.addObject("greeter", &greeter);
+    QmlNotifyBridge bridge(resolver);
+    bridge.addObject("greeter", &greeter);
+    QmlQtListModel history(greeter.history());
+    QmlCursesFrontend frontend(screen, bridge);
+    frontend.setModel("greeter.history", &history);
+
+    QmlFrameScheduler scheduler([&] { frontend.render(document); },
+                                [&](std::chrono::microseconds delay) {
+                                    QTimer::singleShot(std::chrono::ceil<std::chrono::milliseconds>(delay),
+                                                       [&scheduler] { scheduler.tick(); });
+                                });
+    scheduler.setFrameRate(frameRate);
+    bridge.setChangedHandler([&](const std::string &binding) {
+        frontend.invalidateBinding(binding);
+        scheduler.requestFrame();
+    });
+    history.setChangedHandler([&scheduler] { scheduler.requestFrame(); });
+    frontend.render(document);
+
+    QTcpServer server;
+    if (!server.listen(QHostAddress::Any, port)) {
+        std::cerr << "Could not listen on port " << port << ": " << server.errorString().toStdString() << std::endl;
+        return 1;
+    }
+    QObject::connect(&server, &QTcpServer::newConnection, [&] {
+        while (QTcpSocket *socket = server.nextPendingConnection()) {
+            socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            const QmlRemoteScreen::ViewerId viewer = screen.addViewer([socket](std::string_view message) {
+                if (socket->bytesToWrite() > kViewerBacklogBytes) {
+                    return false;
+                }
+                socket->write(message.data(), static_cast<qint64>(message.size()));
+                return true;
+            });
+            QObject::connect(socket, &QTcpSocket::bytesWritten, [&screen, socket, viewer] {
+                if (socket->bytesToWrite() == 0) {
+                    screen.viewerReady(viewer);
+                }
+            });
+            QObject::connect(socket, &QTcpSocket::disconnected, [&screen, socket, viewer] {
+                screen.removeViewer(viewer);
+                QmlLog::info("Viewer {} disconnected; {} left", viewer, screen.viewerCount());
+                socket->deleteLater();
+            });
+            QmlLog::info("Viewer {} connected from {}", viewer, socket->peerAddress().toString().toStdString());
+        }
+    });
+    std::cerr << "Serving " << cols << "x" << rows << " on port " << server.serverPort() << std::endl;
+    std::unique_ptr<MetricsEndpoint> metrics;
+    if (!metricsSource.endpoint.isEmpty()) {
+        metrics = startMetrics(metricsSource.endpoint, [&](QmlMetricsText &text) {
+            collectCommon(text, metricsSource, document, scheduler);
+            collectFrontends(text, {LabelledFrontend{std::string(), &frontend}});
+            text.family("qml_viewers", QmlMetricsText::Type::Gauge, "Connected viewers.");
+            text.gauge(static_cast<double>(screen.viewerCount()));
+        });
+        if (!metrics) {
+            return 1;
+        }
+    }
+    return app.exec();
+}
+
+// Largest terminal a session may report; bigger NAWS sizes are clamped.
+constexpr int kMaxSessionRows = 500;
+constexpr int kMaxSessionCols = 1000;
+
+// Serves the document to any number of telnet clients, each at its own
+// terminal size, from one event loop. The parsed document and the binding
+// backend are shared by everyone. Sessions of the same size share a view
+// (a frontend with its layout, plan and binding cache) that renders each
+// frame once; every session then diffs the view's cells against its own
+// damage buffer, which records what its terminal was actually sent. A
+// session whose socket is backed up skips frames and is caught up with
+// one diff once it drains.
+//
+// Each session is charged the memory it holds alone (damage buffer,
+// terminal, queued output) and an even share of its view's. Checked once a
+// second against --session-memory-limit, a session over it has its view's
+// binding cache evicted and, if that is not enough, is disconnected.
+class SessionServer {
+public:
+    SessionServer(const QmlDocument &document, int rows, int cols, int frameRate, size_t bandwidth,
+                  size_t sessionLimit, const MetricsSource &metricsSource)
+        : document_(document), metricsSource_(metricsSource), defaultRows_(rows), defaultCols_(cols),
+          bandwidth_(bandwidth),
+          scheduler_([this] { renderFrame(); },
+                     [this](std::chrono::microseconds delay) {
+                         QTimer::singleShot(std::chrono::ceil<std::chrono::milliseconds>(delay),
+                                            [this] { scheduler_.tick(); });
+                     }) {
+        resolver_.addObject("greeter", &greeter_);
+        bridge_.addObject("greeter", &greeter_);
+        history_.setChangedHandler([this] { scheduler_.requestFrame(); });
+        scheduler_.setFrameRate(frameRate);
+        bridge_.setChangedHandler([this](const std::string &binding) {
+            for (auto &entry : views_) {
+                entry.second->frontend.invalidateBinding(binding);
+            }
+            scheduler_.requestFrame();
+        });
+        QObject::connect(&server_, &QTcpServer::newConnection, [this] { acceptSessions(); });
+        memory_.setLimit(sessionLimit);
+        if (sessionLimit > 0) {
+            QObject::connect(&memoryTimer_, &QTimer::timeout, [this] { enforceMemoryLimit(); });
+            memoryTimer_.start(1000);
+        }
+    }
+
+    bool listen(quint16 port) {
+        if (!server_.listen(QHostAddress::Any, port)) {
+            std::cerr << "Could not listen on port " << port << ": " << server_.errorString().toStdString()
+                      << std::endl;
+            return false;
+        }
+        std::cerr << "Accepting telnet sessions on port " << server_.serverPort() << std::endl;
+        if (!metricsSource_.endpoint.isEmpty()) {
+            metrics_ = startMetrics(metricsSource_.endpoint, [this](QmlMetricsText &text) { collect(text); });
+            return metrics_ != nullptr;
+        }
+        return true;
+    }
+
+    // A prefork worker's: accepts from a socket that is already listening.
+    bool listen(qintptr descriptor) {
+        if (!server_.setSocketDescriptor(descriptor)) {
+            std::cerr << "Could not accept on the shared socket: " << server_.errorString().toStdString()
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Takes over a connected socket, which may have been accepted on
+    // another thread; it must have been made on this server's.
+    void adopt(QTcpSocket *socket) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        auto session = std::make_unique<Session>(socket, nextSession_++);
+        Session *raw = session.get();
+        sessions_.push_back(std::move(session));
+        memory_.add(
+            raw->id, [raw] { return raw->ownBytes(); },
+            [raw] { return raw->view ? raw->view->byteSize() / raw->view->sessions : 0; },
+            [raw](size_t bytes) {
+                View *view = raw->view;
+                return view ? view->frontend.evictBindings(bytes * view->sessions) / view->sessions : 0;
+            });
+        const std::string_view negotiation = QmlTelnetParser::negotiation();
+        socket->write(negotiation.data(), static_cast<qint64>(negotiation.size()));
+        socket->write("\x1b[?25l");
+        resizeSession(*raw, defaultRows_, defaultCols_);
+        QmlLog::info("Session from {} opened; {} open", socket->peerAddress().toString().toStdString(),
+                     sessions_.size());
+
+#if defined(QML_COROUTINES)
+        serve(*raw).start();
+#else
+        QObject::connect(socket, &QTcpSocket::readyRead, [this, raw] { readSession(*raw, raw->socket->readAll()); });
+        QObject::connect(socket, &QTcpSocket::disconnected, [this, raw] { closeSession(*raw); });
+#endif
+        QObject::connect(socket, &QTcpSocket::bytesWritten, [this, raw] {
+            if (raw->stale && raw->socket->bytesToWrite() == 0) {
+                sendFrame(*raw);
+            }
+        });
+        QObject::connect(&raw->pacing, &QTimer::timeout, [this, raw] {
+            if (raw->stale) {
+                sendFrame(*raw);
+            }
+        });
+    }
+
+    void collect(QmlMetricsText &text) const {
+        collectCommon(text, metricsSource_, document_, scheduler_);
+        std::vector<LabelledFrontend> frontends;
+        for (const auto &entry : views_) {
+            const std::string size = std::to_string(entry.first.second) + "x" + std::to_string(entry.first.first);
+            frontends.push_back(LabelledFrontend{QmlMetricsText::label("view", size), &entry.second->frontend});
+        }
+        collectFrontends(text, frontends);
+        text.family("qml_sessions", QmlMetricsText::Type::Gauge, "Connected telnet sessions.");
+        text.gauge(static_cast<double>(sessions_.size()));
+        text.family("qml_views", QmlMetricsText::Type::Gauge, "Views rendered, one per session size.");
+        text.gauge(static_cast<double>(views_.size()));
+        memory_.appendMetrics(text);
+    }
+
+private:
+    struct View {
+        View(int rows, int cols, QmlNotifyBridge &bridge) : screen(rows, cols), frontend(screen, bridge) {}
+
+        size_t byteSize() const { return screen.byteSize() + frontend.bindingCacheBytes(); }
+
+        QmlBufferScreen screen;
+        QmlCursesFrontend frontend;
+        size_t sessions = 0;
+    };
+    using ViewKey = std::pair<int, int>;  // rows, cols
+
+    struct Session {
+        Session(QTcpSocket *socket, uint64_t id) : socket(socket), id(id) { pacing.setSingleShot(true); }
+
+        size_t ownBytes() const {
+            return grid.byteSize() + (terminal ? terminal->byteSize() : 0) +
+                   static_cast<size_t>(socket->bytesToWrite());
+        }
+
+        QTcpSocket *socket;
+        uint64_t id;  // for the memory accounts and metrics
+        QmlTelnetParser telnet;
+        QmlCellGrid grid;  // what this client's terminal shows
+        std::unique_ptr<VtScreen> terminal;
+        View *view = nullptr;
+        bool stale = true;  // the view has changed since the last send
+        // With a bandwidth budget, no frame is sent before the link has
+        // had time to carry the previous one.
+        VtScreen::Clock::time_point nextSend{};
+        QTimer pacing;
+    };
+
+    void acceptSessions() {
+        while (QTcpSocket *socket = server_.nextPendingConnection()) {
+            adopt(socket);
+        }
+    }
+
+#if defined(QML_COROUTINES)
+    // A session's input as one straight line: read until the client has
+    // gone, then close.
+    QmlTask<> serve(Session &session) {
+        for (QByteArray bytes; !(bytes = co_await qmlReadable(*session.socket)).isEmpty();) {
+            readSession(session, bytes);
+        }
+        closeSession(session);
+    }
+#endif
+
+    void readSession(Session &session, const QByteArray &bytes) {
+        std::string input;
+        if (session.telnet.feed(std::string_view(bytes.constData(), static_cast<size_t>(bytes.size())), input)) {
+            resizeSession(session, std::min(session.telnet.rows(), kMaxSessionRows),
+                          std::min(session.telnet.cols(), kMaxSessionCols));
+        }
+        // q, Ctrl-C or Ctrl-D ends the session.
+        if (input.find_first_of("q\x03\x04") != std::string::npos) {
+            session.socket->write("\x1b[0m\x1b[?25h\x1b[H\x1b[2J");
+            session.socket->disconnectFromHost();
+        }
+    }
+
+    // Moves the session to the view for its new size, creating the view if
+    // it is the first session of that size.
+    void resizeSession(Session &session, int rows, int cols) {
+        if (session.view != nullptr && session.grid.rows() == rows && session.grid.cols() == cols) {
+            return;
+        }
+        releaseView(session);
+        std::unique_ptr<View> &view = views_[ViewKey(rows, cols)];
+        QmlLog::debug("Session resized to {}x{}{}", cols, rows, view ? "" : ", a new view");
+        if (!view) {
+            view = std::make_unique<View>(rows, cols, bridge_);
+            view->frontend.setModel("greeter.history", &history_);
+            view->frontend.render(document_);
+        }
+        ++view->sessions;
+        session.view = view.get();
+        session.grid.resize(rows, cols);
+        QTcpSocket *socket = session.socket;
+        session.terminal = std::make_unique<VtScreen>(rows, cols, [socket](std::string_view bytes) {
+            socket->write(bytes.data(), static_cast<qint64>(bytes.size()));
+        });
+        session.terminal->setBandwidthBudget(bandwidth_);
+        session.stale = true;
+        sendFrame(session);
+    }
+
+    void releaseView(Session &session) {
+        if (session.view == nullptr) {
+            return;
+        }
+        const auto entry = views_.find(ViewKey(session.grid.rows(), session.grid.cols()));
+        if (--session.view->sessions == 0) {
+            views_.erase(entry);
+        }
+        session.view = nullptr;
+    }
+
+    void closeSession(Session &session) {
+        memory_.remove(session.id);
+        releaseView(session);
+        session.socket->disconnect();
+        session.socket->deleteLater();
+        sessions_.erase(std::find_if(sessions_.begin(), sessions_.end(),
+                                     [&session](const std::unique_ptr<Session> &s) { return s.get() == &session; }));
+        QmlLog::info("Session closed; {} open, {} views", sessions_.size(), views_.size());
+    }
+
+    // Between frames. Output still queued for a session over the limit is
+    // part of what it holds, so it is dropped rather than flushed.
+    void enforceMemoryLimit() {
+        for (const uint64_t id : memory_.enforce()) {
+            const auto session = std::find_if(sessions_.begin(), sessions_.end(),
+                                              [id](const std::unique_ptr<Session> &s) { return s->id == id; });
+            if (session != sessions_.end()) {
+                QmlLog::warning("Session {} holds {} bytes, over its limit of {}; disconnecting it", id,
+                                memory_.usage(id).total(), memory_.limit());
+                (*session)->socket->abort();
+            }
+        }
+    }
+
+    void renderFrame() {
+        for (auto &entry : views_) {
+            entry.second->frontend.render(document_);
+        }
+        for (const std::unique_ptr<Session> &session : sessions_) {
+            session->stale = true;
+            sendFrame(*session);
+        }
+    }
+
+    void sendFrame(Session &session) {
+        if (session.view == nullptr || session.socket->bytesToWrite() > kViewerBacklogBytes) {
+            return;  // caught up when the socket drains
+        }
+        const VtScreen::Clock::time_point now = VtScreen::Clock::now();
+        if (now < session.nextSend) {
+            // Over budget: this session's frame rate drops, and the frames
+            // it misses collapse into the one sent when the link is free.
+            if (!session.pacing.isActive()) {
+                session.pacing.start(std::chrono::ceil<std::chrono::milliseconds>(session.nextSend - now));
+            }
+            return;
+        }
+        session.grid.blit(session.view->screen.cells(), 0, 0, session.grid.rows());
+        session.grid.flush(*session.terminal);
+        session.terminal->refresh();
+        session.nextSend = now + session.terminal->frameDelay();
+        session.stale = false;
+    }
+
+    const QmlDocument &document_;
+    const MetricsSource &metricsSource_;
+    const int defaultRows_;
+    const int defaultCols_;
+    const size_t bandwidth_;
+    Greeter greeter_;
+    QmlMetaResolver resolver_;
+    QmlNotifyBridge bridge_{resolver_};
+    QmlQtListModel history_{greeter_.history()};
+    QmlFrameScheduler scheduler_;
+    QTcpServer server_;
+    std::map<ViewKey, std::unique_ptr<View>> views_;
+    std::vector<std::unique_ptr<Session>> sessions_;
+    uint64_t nextSession_ = 0;
+    QmlSessionMemory memory_;
+    QTimer memoryTimer_;
+    std::unique_ptr<MetricsEndpoint> metrics_;
+};
+
+// Pins the calling thread to the index-th of the cores the process may
+// run on, wrapping around; a no-op where the OS has no thread affinity, as
+// on macOS.
+void pinToCore(int index) {
+#if defined(__linux__)
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof allowed, &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return;
+    }
+    int wanted = index % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && wanted-- == 0) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            pthread_setaffinity_np(pthread_self(), sizeof one, &one);
+            return;
+        }
+    }
+#elif defined(_WIN32)
+    DWORD_PTR process = 0;
+    DWORD_PTR system = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system) || process == 0) {
+        return;
+    }
+    int count = 0;
+    for (DWORD_PTR mask = process; mask != 0; mask &= mask - 1) {
+        ++count;
+    }
+    int wanted = index % count;
+    for (DWORD_PTR bit = 1; bit != 0; bit <<= 1) {
+        if ((process & bit) != 0 && wanted-- == 0) {
+            SetThreadAffinityMask(GetCurrentThread(), bit);
+            return;
+        }
+    }
+#else
+    (void)index;
+#endif
+}
+
+// Hands each connection it accepts to a callback as a bare descriptor, so
+// that the socket can be made on another thread.
+class DescriptorServer : public QTcpServer {
+public:
+    explicit DescriptorServer(std::function<void(qintptr descriptor)> accepted) : accepted_(std::move(accepted)) {}
+
+protected:
+    void incomingConnection(qintptr descriptor) override { accepted_(descriptor); }
+
+private:
+    std::function<void(qintptr descriptor)> accepted_;
+};
+
+// --sessions with --shards: one thread per shard, each pinned to a core
+// and running its own event loop and SessionServer, so a shard's sessions,
+// their views' binding caches and their damage buffers are only ever
+// touched by one core, and allocated from that thread's malloc arena. The
+// document is shared read-only. The accepting thread picks a connection's
+// shard by a hash of its sequence number and passes the descriptor
+// through the shard's lock-free queue; the first descriptor since the
+// shard last drained it wakes the shard with one queued call. Shards share
+// nothing else and never wait for one another.
+class ShardedSessionServer {
+public:
+    ShardedSessionServer(const QmlDocument &document, int shards, int rows, int cols, int frameRate,
+                         size_t bandwidth, size_t sessionLimit, const MetricsSource &metricsSource)
+        : metricsSource_(metricsSource), acceptor_([this](qintptr descriptor) { dispatch(descriptor); }) {
+        for (int i = 0; i < shards; ++i) {
+            auto shard = std::make_unique<Shard>();
+            Shard *raw = shard.get();
+            raw->context.moveToThread(&raw->thread);
+            raw->thread.setObjectName(QStringLiteral("shard %1").arg(i));
+            raw->thread.start();
+            QMetaObject::invokeMethod(
+                &raw->context,
+                [&, raw, i] {
+                    pinToCore(i);
+                    raw->server = std::make_unique<SessionServer>(document, rows, cols, frameRate, bandwidth,
+                                                                  sessionLimit, metricsSource);
+                },
+                Qt::BlockingQueuedConnection);
+            shards_.push_back(std::move(shard));
+        }
+    }
+
+    ~ShardedSessionServer() {
+        acceptor_.close();
+        for (const std::unique_ptr<Shard> &shard : shards_) {
+            Shard *raw = shard.get();
+            QMetaObject::invokeMethod(&raw->context, [raw] { raw->server.reset(); }, Qt::BlockingQueuedConnection);
+            raw->thread.quit();
+            raw->thread.wait();
+        }
+    }
+
+    bool listen(quint16 port) {
+        if (!acceptor_.listen(QHostAddress::Any, port)) {
+            std::cerr << "Could not listen on port " << port << ": " << acceptor_.errorString().toStdString()
+                      << std::endl;
+            return false;
+        }
+        std::cerr << "Accepting telnet sessions on port " << acceptor_.serverPort() << " in " << shards_.size()
+                  << " shards" << std::endl;
+        if (!metricsSource_.endpoint.isEmpty()) {
+            metrics_ = startMetrics(metricsSource_.endpoint, [this](QmlMetricsText &text) { collect(text); });
+            return metrics_ != nullptr;
+        }
+        return true;
+    }
+
+    // A prefork worker's: accepts from a socket that is already listening.
+    bool listen(qintptr descriptor) {
+        if (!acceptor_.setSocketDescriptor(descriptor)) {
+            std::cerr << "Could not accept on the shared socket: " << acceptor_.errorString().toStdString()
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Each shard's families, labelled shard="N"; the scrape waits for each
+    // shard to collect on its own thread.
+    void collect(QmlMetricsText &text) const {
+        QmlMetricsMerger merger;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            Shard *shard = shards_[i].get();
+            QmlMetricsText shardText;
+            QMetaObject::invokeMethod(
+                &shard->context, [shard, &shardText] { shard->server->collect(shardText); },
+                Qt::BlockingQueuedConnection);
+            merger.add(shardText.finish(), QmlMetricsText::label("shard", std::to_string(i)));
+        }
+        text.family("qml_shards", QmlMetricsText::Type::Gauge, "Session threads, each pinned to a core.");
+        text.gauge(static_cast<double>(shards_.size()));
+        merger.appendTo(text);
+    }
+
+private:
+    // Descriptors handed over and not yet taken, per shard.
+    static constexpr size_t kShardBacklog = 1024;
+
+    struct Shard {
+        QThread thread;
+        QObject context;  // lives on thread
+        std::unique_ptr<SessionServer> server;  // made, used and destroyed on thread
+        QmlSpscQueue<qintptr> incoming{kShardBacklog};
+        std::atomic<bool> woken{false};
+    };
+
+    size_t shardFor(uint64_t connection) const {
+        // splitmix64's finalizer: consecutive numbers land far apart.
+        uint64_t x = connection + 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<size_t>((x ^ (x >> 31)) % shards_.size());
+    }
+
+    void dispatch(qintptr descriptor) {
+        const size_t index = shardFor(connections_++);
+        Shard *shard = shards_[index].get();
+        if (!shard->incoming.tryPush(qintptr(descriptor))) {
+            QmlLog::warning("Shard {} is {} connections behind; refusing one", index, kShardBacklog);
+            QTcpSocket refused;
+            refused.setSocketDescriptor(descriptor);
+            refused.abort();
+            return;
+        }
+        if (!shard->woken.exchange(true, std::memory_order_acq_rel)) {
+            QMetaObject::invokeMethod(&shard->context, [shard] { drain(*shard); }, Qt::QueuedConnection);
+        }
+    }
+
+    // On the shard's thread. The flag is cleared before draining, so a
+    // descriptor pushed meanwhile either is drained now or wakes it again.
+    static void drain(Shard &shard) {
+        shard.woken.exchange(false, std::memory_order_acq_rel);
+        qintptr descriptor = 0;
+        while (shard.incoming.tryPop(descriptor)) {
+            auto *socket = new QTcpSocket;
+            if (!socket->setSocketDescriptor(descriptor)) {
+                delete socket;
+                continue;
+            }
+            shard.server->adopt(socket);
+        }
+    }
+
+    const MetricsSource &metricsSource_;
+    DescriptorServer acceptor_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    uint64_t connections_ = 0;
+    std::unique_ptr<MetricsEndpoint> metrics_;
+};
+
+// Runs a SessionServer or ShardedSessionServer on port or, in a prefork
+// worker (workerSpec set), on the socket the supervisor arranged.
+template <typename Server>
+int runSessions(QCoreApplication &app, Server &server, quint16 port, const QString &workerSpec) {
+    if (workerSpec.isEmpty()) {
+        return server.listen(port) ? app.exec() : 1;
+    }
+    PreforkWorkerSpec spec;
+    if (!PreforkWorkerSpec::parse(workerSpec, spec)) {
+        std::cerr << "Malformed --prefork-worker" << std::endl;
+        return 1;
+    }
+    PreforkWorker worker(spec, [&server](QmlMetricsText &text) { server.collect(text); });
+    QString error;
+    const qintptr listener = worker.listener(&error);
+    if (listener < 0) {
+        std::cerr << "Could not listen on port " << spec.port << ": " << error.toStdString() << std::endl;
+        return 1;
+    }
+    return server.listen(listener) ? app.exec() : 1;
+}
+
+// arguments without the named options and their values, given as
+// --name VALUE or --name=VALUE.
+QStringList withoutOptions(const QStringList &arguments, const QStringList &names) {
+    QStringList kept;
+    for (qsizetype i = 0; i < arguments.size(); ++i) {
+        const QString &argument = arguments[i];
+        bool dropped = false;
+        for (const QString &name : names) {
+            const QString option = QStringLiteral("--") + name;
+            if (argument == option) {
+                ++i;  // and its value
+                dropped = true;
+            } else if (argument.startsWith(option + QLatin1Char('='))) {
+                dropped = true;
+            }
+        }
+        if (!dropped) {
+            kept.push_back(argument);
+        }
+    }
+    return kept;
+}
+
+// --sessions with --workers: the sessions are served by worker processes,
+// which are this program again with the same arguments, and the supervisor
+// only restarts them and, with --metrics, merges what they report.
+int supervise(QCoreApplication &app, quint16 port, int workers, const QString &metricsEndpoint) {
+    PreforkSupervisor::Options options;
+    options.workers = workers;
+    options.port = port;
+    options.workerArguments =
+        withoutOptions(app.arguments().mid(1), {QStringLiteral("workers"), QStringLiteral("metrics")});
+    options.reportMetrics = !metricsEndpoint.isEmpty();
+    PreforkSupervisor supervisor(std::move(options), [](int index, const QString &status) {
+        QmlLog::warning("Worker {} {}; restarting it", index, status.toStdString());
+    });
+    QString error;
+    if (!supervisor.start(&error)) {
+        std::cerr << "Could not listen on port " << port << ": " << error.toStdString() << std::endl;
+        return 1;
+    }
+    std::cerr << "Accepting telnet sessions on port " << supervisor.port() << " in " << workers << " workers"
+              << std::endl;
+    std::unique_ptr<MetricsEndpoint> metrics;
+    if (!metricsEndpoint.isEmpty()) {
+        metrics = startMetrics(metricsEndpoint,
+                               [&supervisor](QmlMetricsText &text) { supervisor.appendMetrics(text); });
+        if (!metrics) {
+            return 1;
+        }
+    }
+    return app.exec();
+}
+
+// Renders each file once into memory and writes the screens to stdout, as
+// plain text or with ANSI attributes. Nothing touches the terminal, so it
+// runs in CI and pipelines; several files render in one process, each
+// under a "==> file <==" header.
+int dump(const QStringList &files, const std::function<QmlDocument(const std::string &)> &load, int rows, int cols,
+         bool ansi) {
+    Greeter greeter;
+    QmlMetaResolver resolver;
+    resolver.addObject("greeter", &greeter);
+    QmlBufferScreen screen(rows, cols);
+    int status = 0;
+    std::string out;
+    for (const QString &file : files) {
+        const std::string path = file.toStdString();
+        QmlDocument document;
+        try {
+            document = load(path);
+        } catch (const std::exception &ex) {
+            std::cerr << "Failed to load " << path << ": " << ex.what() << std::endl;
+            status = 1;
+            continue;
+        }
+        screen.clear();
+        QmlCursesFrontend frontend(screen, resolver);
+        frontend.render(document);
+
+        out.clear();
+        if (files.size() > 1) {
+            out.append("==> ").append(path).append(" <==\n");
+        }
+        out.append(ansi ? screen.ansi() : screen.text());
+        std::fwrite(out.data(), 1, out.size(), stdout);
+    }
+    std::fflush(stdout);
+    return status;
+}
+
+// Writes each file's parsed tree to stdout as it is read, one JSON value
+// per line or one MessagePack value after another, for analysis tools.
+// Script bodies come from the mapped source, which is never copied.
+int exportTrees(const QStringList &files, QmlExporter::Format format) {
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    const auto sink = [](std::string_view chunk) { std::fwrite(chunk.data(), 1, chunk.size(), stdout); };
+    int status = 0;
+    for (const QString &file : files) {
+        const std::string path = file.toStdString();
+        try {
+            const MappedFile source = openSource(path);
+            const QmlDocument document = QmlParser().parseString(source.view());
+            QmlExporter exporter(sink, QmlExporter::Options{format});
+            exporter.write(document, source.view());
+            if (format == QmlExporter::Format::Json) {
+                exporter.flush();
+                std::fputc('\n', stdout);
+            }
+        } catch (const std::exception &ex) {
+            std::cerr << "Failed to load " << path << ": " << ex.what() << std::endl;
+            status = 1;
+        }
+    }
+    std::fflush(stdout);
+    return status;
+}
+
+// Rendered screens waiting for the writer thread; workers block while it
+// is full, so a slow disk holds back rendering instead of memory growing.
+constexpr size_t kMaxQueuedOutputs = 256;
+
+// Renders every .qml file under dir into out, mirroring the tree: a.qml
+// becomes out/a.txt, or out/a.ans with ANSI attributes. The shared
+// executor's threads claim files from a shared cursor, each with its own
+// parser, backend and screen, and hand the text to one writer thread, so
+// file output overlaps rendering.
+int renderBatch(const std::filesystem::path &dir, const std::filesystem::path &out, int rows, int cols, bool ansi) {
+    std::vector<std::filesystem::path> files;
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(dir, error), end; !error && it != end; it.increment(error)) {
+        if (it->is_regular_file() && it->path().extension() == ".qml") {
+            files.push_back(it->path());
+        }
+    }
+    if (error) {
+        std::cerr << "Could not read " << dir.string() << ": " << error.message() << std::endl;
+        return 1;
+    }
+    std::sort(files.begin(), files.end());
+
+    struct Output {
+        std::filesystem::path path;
+        std::string text;
+    };
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Output> queue;
+    bool rendering = true;
+    std::vector<std::string> failures;
+
+    std::thread writer([&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            changed.wait(lock, [&] { return !queue.empty() || !rendering; });
+            if (queue.empty()) {
+                return;
+            }
+            Output output = std::move(queue.front());
+            queue.pop_front();
+            changed.notify_all();
+            lock.unlock();
+            std::error_code created;
+            std::filesystem::create_directories(output.path.parent_path(), created);
+            std::ofstream file(output.path, std::ios::binary | std::ios::trunc);
+            file.write(output.text.data(), static_cast<std::streamsize>(output.text.size()));
+            const bool written = file.good();
+            lock.lock();
+            if (!written) {
+                failures.push_back("Could not write " + output.path.string());
+            }
+        }
+    });
+
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        QmlParser parser;
+        Greeter greeter;
+        QmlMetaResolver resolver;
+        resolver.addObject("greeter", &greeter);
+        QmlBufferScreen screen(rows, cols);
+        // Each document is built in this arena and released with it before
+        // the next file, in a few large frees rather than one per list.
+        std::pmr::monotonic_buffer_resource arena;
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < files.size();
+             i = next.fetch_add(1, std::memory_order_relaxed)) {
+            arena.release();
+            Output output;
+            output.path = out / files[i].lexically_relative(dir);
+            output.path.replace_extension(ansi ? ".ans" : ".txt");
+            try {
+                const QmlDocument document = parser.parseFile(files[i].string(), &arena);
+                screen.clear();
+                QmlCursesFrontend frontend(screen, resolver);
+                frontend.render(document);
+                output.text = ansi ? screen.ansi() : screen.text();
+            } catch (const std::exception &ex) {
+                std::lock_guard<std::mutex> lock(mutex);
+                failures.push_back("Failed to load " + files[i].string() + ": " + ex.what());
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return queue.size() < kMaxQueuedOutputs; });
+            queue.push_back(std::move(output));
+            changed.notify_all();
+        }
+    };
+    QmlExecutor &executor = QmlExecutor::shared();
+    executor.parallelFor("renderBatch", std::min(executor.workerCount() + 1, files.size()), [&](size_t) { work(); },
+                         0, QmlExecutor::Priority::Normal);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rendering = false;
+    }
+    changed.notify_all();
+    writer.join();
+
+    for (const std::string &failure : failures) {
+        std::cerr << failure << std::endl;
+    }
+    std::cerr << "Rendered " << files.size() - failures.size() << " of " << files.size() << " files into "
+              << out.string() << std::endl;
+    return failures.empty() ? 0 : 1;
+}
+
+// Keeps every QML file under the given directories parsed and answers
+// QmlIndexService requests on a local socket (a Unix domain socket, or a
+// named pipe on Windows): one answer per request line, for any number of
+// clients at once. The files and the directories holding them are
+// watched, so answers follow edits as they are saved, and each edit
+// reparses only the object it falls in.
+class IndexServer {
+public:
+    explicit IndexServer(const QStringList &dirs) {
+        for (const QString &dir : dirs) {
+            service_.addDirectory(dir.toStdString());
+            roots_ << QDir(dir).absolutePath();
+        }
+        watchFiles();
+        QObject::connect(&watcher_, &QFileSystemWatcher::fileChanged, [this](const QString &path) {
+            service_.update(path.toStdString());
+            // Editors that save by replacing the file drop it from the
+            // watch list.
+            watchFiles();
+        });
+        QObject::connect(&watcher_, &QFileSystemWatcher::directoryChanged, [this](const QString &dir) {
+            service_.refreshDirectory(dir.toStdString());
+            watchFiles();
+        });
+        QObject::connect(&server_, &QLocalServer::newConnection, [this] { acceptClients(); });
+    }
+
+    bool listen(const QString &name) {
+        if (!server_.listen(name) && server_.serverError() == QAbstractSocket::AddressInUseError) {
+            // Left behind by a server that did not shut down, unless one
+            // still answers on it.
+            QLocalSocket probe;
+            probe.connectToServer(name);
+            if (!probe.waitForConnected(1000)) {
+                QLocalServer::removeServer(name);
+                server_.listen(name);
+            }
+        }
+        if (!server_.isListening()) {
+            std::cerr << "Could not listen on " << name.toStdString() << ": " << server_.errorString().toStdString()
+                      << std::endl;
+            return false;
+        }
+        std::cerr << "Indexed " << service_.fileCount() << " QML files; serving on "
+                  << server_.fullServerName().toStdString() << std::endl;
+        return true;
+    }
+
+private:
+    void watchFiles() {
+        QStringList paths = roots_;
+        for (const std::string &file : service_.files()) {
+            paths << QString::fromStdString(file)
+                  << QString::fromStdWString(std::filesystem::path(file).parent_path().wstring());
+        }
+        const QStringList watched = watcher_.files() + watcher_.directories();
+        paths.removeDuplicates();
+        paths.erase(std::remove_if(paths.begin(), paths.end(),
+                                   [&watched](const QString &path) { return watched.contains(path); }),
+                    paths.end());
+        if (!paths.isEmpty()) {
+            watcher_.addPaths(paths);
+        }
+    }
+
+    void acceptClients() {
+        while (QLocalSocket *socket = server_.nextPendingConnection()) {
+            QObject::connect(socket, &QLocalSocket::readyRead, [this, socket] {
+                while (socket->canReadLine()) {
+                    const QByteArray line = socket->readLine();
+                    const std::string answer =
+                        service_.answer(std::string_view(line.constData(), static_cast<size_t>(line.size()) - 1));
+                    socket->write(answer.data(), static_cast<qint64>(answer.size()));
+                }
+            });
+            QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+    QmlIndexService service_;
+    QStringList roots_;
+    QFileSystemWatcher watcher_;
+    QLocalServer server_;
+};
+
+// Replays a screen trace recorded with --record. By default it drives a
+// VtScreen whose output is only counted, as fast as it will go, for at
+// least a second, and reports the backend's throughput. With printFrames
+// it prints the screen after every frame instead, for diffing the frames
+// of two versions.
+int replayTrace(const std::string &path, bool printFrames, bool ansi) {
+    MappedFile file;
+    QmlScreenReplay replay;
+    if (!file.open(path) || !replay.load(file.view())) {
+        std::cerr << "Could not read a screen trace from " << path << std::endl;
+        return 1;
+    }
+
+    if (printFrames) {
+        QmlBufferScreen screen(replay.rows(), replay.cols());
+        std::string out;
+        replay.play(screen, [&](size_t frame, std::chrono::microseconds) {
+            out.clear();
+            out.append("==> frame ").append(std::to_string(frame)).append(" <==\n");
+            out.append(ansi ? screen.ansi() : screen.text());
+            std::fwrite(out.data(), 1, out.size(), stdout);
+        });
+        std::fflush(stdout);
+        return 0;
+    }
+
+    size_t bytes = 0;
+    VtScreen screen(replay.rows(), replay.cols(), [&bytes](std::string_view frame) { bytes += frame.size(); });
+    size_t passes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{0};
+    do {
+        replay.play(screen);
+        ++passes;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < std::chrono::seconds(1));
+
+    const double seconds = elapsed.count();
+    std::cerr << replay.frames() << " frames, " << replay.calls() << " calls over "
+              << replay.duration().count() / 1000 << " ms recorded; replayed " << passes << " times: "
+              << static_cast<double>(replay.frames() * passes) / seconds << " frames/s, "
+              << static_cast<double>(replay.calls() * passes) / seconds << " calls/s, "
+              << static_cast<double>(bytes) / seconds / (1024 * 1024) << " MiB/s of VT output" << std::endl;
+    return 0;
+}
+
+// Shows a served UI on the local terminal until a key is pressed or the
+// server goes away.
+int connectTo(QCoreApplication &app, const QString &address) {
+    const int colon = address.lastIndexOf(QLatin1Char(':'));
+    bool portOk = false;
+    const quint16 port = colon > 0 ? address.mid(colon + 1).toUShort(&portOk) : 0;
+    if (!portOk) {
+        std::cerr << "Expected host:port, got " << address.toStdString() << std::endl;
+        return 1;
+    }
+
+    QTcpSocket socket;
+    socket.connectToHost(address.left(colon), port);
+    if (!socket.waitForConnected(5000)) {
+        std::cerr << "Could not connect to " << address.toStdString() << ": " << socket.errorString().toStdString()
+                  << std::endl;
+        return 1;
+    }
+
+    if (initscr() == nullptr) {
+        std::cerr << "Could not initialize curses screen." << std::endl;
+        return 1;
+    }
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+
+    int status = 0;
+    PdcursesScreen screen;
+    QmlRemoteDecoder decoder(screen);
+    QObject::connect(&socket, &QTcpSocket::readyRead, [&] {
+        const QByteArray bytes = socket.readAll();
+        if (!decoder.feed(std::string_view(bytes.constData(), static_cast<size_t>(bytes.size())))) {
+            status = 1;
+            app.quit();
+        }
+    });
+    QObject::connect(&socket, &QTcpSocket::disconnected, &app, &QCoreApplication::quit);
+    TerminalInput input([&](const std::vector<int> &keys, std::chrono::steady_clock::time_point) {
+        for (const int key : keys) {
+            if (key != KEY_RESIZE) {
+                app.quit();
+                return;
+            }
+        }
+        acknowledgeResize();
+    });
+
+    app.exec();
+    endwin();
+    if (status != 0) {
+        std::cerr << "Malformed stream from " << address.toStdString() << std::endl;
+    }
+    return status;
+}
+
+// --startup-timing: milliseconds from main() to each startup phase (app,
+// load, curses, firstFrame), in the JSON sample_app writes, so that
+// `dev_tool.py bench-startup` reads both the same way.
+class StartupMarks {
+public:
+    StartupMarks() { clock_.start(); }
+
+    void mark(const char *phase) { phases_.emplace_back(phase, clock_.nsecsElapsed()); }
+
+    // To path, or stdout for "-"; false if the file cannot be written.
+    bool write(const QString &path) const {
+        QJsonArray phases;
+        for (const auto &[name, nsecs] : phases_) {
+            phases.append(QJsonObject{
+                {QStringLiteral("phase"), QString::fromLatin1(name)},
+                {QStringLiteral("ms"), static_cast<double>(nsecs) / 1e6},
+            });
+        }
+        const QJsonObject report{{QStringLiteral("unit"), QStringLiteral("ms")}, {QStringLiteral("phases"), phases}};
+        const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+        if (path == QLatin1String("-")) {
+            std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+            std::fflush(stdout);
+            return true;
+        }
+        QFile file(path);
+        return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(json) == json.size();
+    }
+
+private:
+    QElapsedTimer clock_;
+    std::vector<std::pair<const char *, qint64>> phases_;
+};
+
 }  // namespace
 
 int main(int argc, char *argv[]) {
+    StartupMarks startup;
     QCoreApplication app(argc, argv);
+    startup.mark("app");
+    // ":/..." and "qrc:/..." paths read Qt resources wherever a file is read.
+    QmlQtResources::install();
+
+    QCommandLineParser options;
+    options.setApplicationDescription(QStringLiteral("Render a QML layout in the terminal with curses."));
+    options.addHelpOption();
+    options.addPositionalArgument(QStringLiteral("file"), QStringLiteral("QML file to render (defaults to qml/Main.qml); several open as tabs, --dump renders each, --index-server takes directories."));
+    const QCommandLineOption noCacheOption(QStringLiteral("no-cache"),
+                                           QStringLiteral("Always parse the QML source; skip the binary AST cache."));
+    const QCommandLineOption cacheDirOption(QStringLiteral("cache-dir"),
+                                            QStringLiteral("Directory for binary AST cache entries."),
+                                            QStringLiteral("dir"));
+    const QCommandLineOption watchOption(QStringLiteral("watch"),
+                                         QStringLiteral("Re-render whenever the QML file or its local imports change."));
+    options.addOption(noCacheOption);
+    options.addOption(cacheDirOption);
+    const QCommandLineOption frameRateOption(QStringLiteral("frame-rate"),
+                                             QStringLiteral("Maximum redraws per second (default 60; lower it over SSH)."),
+                                             QStringLiteral("hz"), QStringLiteral("60"));
+    const QCommandLineOption metricsOption(
+        QStringLiteral("metrics"),
+        QStringLiteral("Serve OpenMetrics counters at http://[ADDRESS:]PORT/metrics (localhost by default)."),
+        QStringLiteral("[address:]port"));
+    const QCommandLineOption idleFrameRateOption(
+        QStringLiteral("idle-frame-rate"),
+        QStringLiteral("Redraws per second after 2 s without input or while unfocused (default 2; 0 turns it off)."),
+        QStringLiteral("hz"), QStringLiteral("2"));
+    const QCommandLineOption serveOption(QStringLiteral("serve"),
+                                         QStringLiteral("Serve the rendered UI to remote viewers on a TCP port."),
+                                         QStringLiteral("port"));
+    const QCommandLineOption sizeOption(
+        QStringLiteral("size"),
+        QStringLiteral("Screen size for --serve, --render-batch and sizeless --sessions clients (default 80x24)."),
+        QStringLiteral("COLSxROWS"), QStringLiteral("80x24"));
+    const QCommandLineOption sessionsOption(QStringLiteral("sessions"),
+                                            QStringLiteral("Serve a session to each telnet client on a TCP port."),
+                                            QStringLiteral("port"));
+    const QCommandLineOption shardsOption(
+        QStringLiteral("shards"),
+        QStringLiteral("Serve --sessions from this many threads, each pinned to a core (default 1; 0 for one per "
+                       "core)."),
+        QStringLiteral("count"), QStringLiteral("1"));
+    const QCommandLineOption workersOption(
+        QStringLiteral("workers"),
+        QStringLiteral("Serve --sessions from this many processes, restarting any that exit (default 1)."),
+        QStringLiteral("count"), QStringLiteral("1"));
+    // How a --workers supervisor starts each worker; see PreforkWorkerSpec.
+    QCommandLineOption preforkWorkerOption(QStringLiteral("prefork-worker"), QStringLiteral("Internal."),
+                                           QStringLiteral("spec"));
+    preforkWorkerOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    const QCommandLineOption bandwidthOption(
+        QStringLiteral("bandwidth"),
+        QStringLiteral("Per-client output budget for --sessions, in bytes per second (default unlimited)."),
+        QStringLiteral("bytes"), QStringLiteral("0"));
+    const QCommandLineOption sessionMemoryLimitOption(
+        QStringLiteral("session-memory-limit"),
+        QStringLiteral("Disconnect a --sessions client holding more than this many MiB once its view's caches are "
+                       "evicted (default: no limit)."),
+        QStringLiteral("MiB"), QStringLiteral("0"));
+    const QCommandLineOption dumpOption(QStringLiteral("dump"),
+                                        QStringLiteral("Render each file once at this size and print it; no terminal."),
+                                        QStringLiteral("COLSxROWS"));
+    const QCommandLineOption dumpFormatOption(QStringLiteral("dump-format"),
+                                              QStringLiteral("Output of --dump and --render-batch: plain or ansi (default plain)."),
+                                              QStringLiteral("format"), QStringLiteral("plain"));
+    const QCommandLineOption exportOption(
+        QStringLiteral("export"),
+        QStringLiteral("Write each file's parsed tree to stdout as json (one line per file) or msgpack; no terminal."),
+        QStringLiteral("format"));
+    const QCommandLineOption renderBatchOption(
+        QStringLiteral("render-batch"),
+        QStringLiteral("Render every .qml file under dir at --size, in parallel, into --out; no terminal."),
+        QStringLiteral("dir"));
+    const QCommandLineOption outOption(QStringLiteral("out"),
+                                       QStringLiteral("Output directory for --render-batch, or file for --pack-bundle."),
+                                       QStringLiteral("path"));
+    const QCommandLineOption packBundleOption(
+        QStringLiteral("pack-bundle"),
+        QStringLiteral("Pack every .qml file under dir, with its parsed tree, into one bundle file at --out."),
+        QStringLiteral("dir"));
+    const QCommandLineOption bundleOption(
+        QStringLiteral("bundle"),
+        QStringLiteral("Read QML out of a --pack-bundle file, as if it were a directory; shows its Main.qml by default."),
+        QStringLiteral("file"));
+    const QCommandLineOption recordOption(QStringLiteral("record"),
+                                          QStringLiteral("Record every screen call of the session to a trace file."),
+                                          QStringLiteral("file"));
+    const QCommandLineOption replayOption(QStringLiteral("replay"),
+                                          QStringLiteral("Replay a --record trace on the VT backend and report throughput."),
+                                          QStringLiteral("file"));
+    const QCommandLineOption replayFramesOption(
+        QStringLiteral("replay-frames"),
+        QStringLiteral("Print every frame of a --record trace, in --dump-format, for diffing."),
+        QStringLiteral("file"));
+    const QCommandLineOption statsHudOption(QStringLiteral("stats-hud"),
+                                            QStringLiteral("Show per-frame layout, binding and draw costs on the bottom row."));
+    const QCommandLineOption traceOption(
+        QStringLiteral("trace"),
+        QStringLiteral("Write parse, layout and render spans as Chrome trace JSON on exit (chrome://tracing, Perfetto)."),
+        QStringLiteral("file"));
+    const QCommandLineOption logOption(
+        QStringLiteral("log"),
+        QStringLiteral("Append diagnostics to a file (- for stderr), written from a background thread."),
+        QStringLiteral("file"));
+    const QCommandLineOption logLevelOption(QStringLiteral("log-level"),
+                                            QStringLiteral("Least severe --log level: debug, info, warning or error."),
+                                            QStringLiteral("level"), QStringLiteral("info"));
+    const QCommandLineOption indexServerOption(
+        QStringLiteral("index-server"),
+        QStringLiteral("Keep the QML files under the given directories (default .) indexed and answer queries on a "
+                       "local socket."),
+        QStringLiteral("name"));
+    const QCommandLineOption cacheBudgetOption(
+        QStringLiteral("cache-budget"),
+        QStringLiteral("Keep the in-memory component and binding caches, and hidden tabs' documents, within this "
+                       "many MiB (default: no limit; OS memory pressure still trims them)."),
+        QStringLiteral("MiB"));
+    const QCommandLineOption compressHiddenTabsOption(
+        QStringLiteral("compress-hidden-tabs"),
+        QStringLiteral("Keep the documents of hidden tabs LZ4-compressed in memory, and restore them when shown."));
+    const QCommandLineOption threadsOption(
+        QStringLiteral("threads"),
+        QStringLiteral("Worker threads for parsing, rendering and resolving in parallel (default: one fewer than the "
+                       "hardware threads)."),
+        QStringLiteral("count"), QStringLiteral("0"));
+    const QCommandLineOption cpusOption(QStringLiteral("cpus"),
+                                        QStringLiteral("Pin the worker threads to these CPUs, such as 0-3,6."),
+                                        QStringLiteral("list"));
+    const QCommandLineOption startupTimingOption(
+        QStringLiteral("startup-timing"),
+        QStringLiteral("Write startup phase timestamps as JSON to file (- for stdout, at exit) after the first frame."),
+        QStringLiteral("file"));
+    const QCommandLineOption quitAfterStartupOption(QStringLiteral("quit-after-startup"),
+                                                    QStringLiteral("Exit once the first frame is drawn."));
+    const QCommandLineOption connectOption(QStringLiteral("connect"),
+                                           QStringLiteral("Show a UI served by --serve at host:port."),
+                                           QStringLiteral("host:port"));
+    options.addOption(watchOption);
+    options.addOption(startupTimingOption);
+    options.addOption(quitAfterStartupOption);
+    options.addOption(frameRateOption);
+    options.addOption(idleFrameRateOption);
+    options.addOption(metricsOption);
+    options.addOption(serveOption);
+    options.addOption(sessionsOption);
+    options.addOption(shardsOption);
+    options.addOption(workersOption);
+    options.addOption(preforkWorkerOption);
+    options.addOption(bandwidthOption);
+    options.addOption(sessionMemoryLimitOption);
+    options.addOption(sizeOption);
+    options.addOption(dumpOption);
+    options.addOption(exportOption);
+    options.addOption(dumpFormatOption);
+    options.addOption(renderBatchOption);
+    options.addOption(packBundleOption);
+    options.addOption(bundleOption);
+    options.addOption(outOption);
+    options.addOption(statsHudOption);
+    options.addOption(traceOption);
+    options.addOption(logOption);
+    options.addOption(logLevelOption);
+    options.addOption(cacheBudgetOption);
+    options.addOption(compressHiddenTabsOption);
+    options.addOption(threadsOption);
+    options.addOption(cpusOption);
+    options.addOption(recordOption);
+    options.addOption(replayOption);
+    options.addOption(replayFramesOption);
+    options.addOption(connectOption);
+    options.addOption(indexServerOption);
+    options.process(app);
+    QmlExecutor::Options executorOptions;
+    bool threadsValid = false;
+    executorOptions.threads = options.value(threadsOption).toUInt(&threadsValid);
+    if (!threadsValid ||
+        (options.isSet(cpusOption) &&
+         !QmlExecutor::parseCpuList(options.value(cpusOption).toStdString(), executorOptions.cpus))) {
+        std::cerr << "Expected --threads <count> and --cpus <list>, such as 0-3,6" << std::endl;
+        return 1;
+    }
+    QmlExecutor::configure(std::move(executorOptions));
+    const TraceFile trace(options.isSet(traceOption) ? options.value(traceOption).toStdWString() : std::wstring());
+    QmlLogLevel logLevel = QmlLogLevel::Info;
+    if (!parseLogLevel(options.value(logLevelOption), logLevel)) {
+        std::cerr << "Expected --log-level debug, info, warning or error" << std::endl;
+        return 1;
+    }
+    const LogFile log(options.value(logOption).toStdString(), logLevel);
+
+    if (options.isSet(connectOption)) {
+        return connectTo(app, options.value(connectOption));
+    }
+
+    if (options.isSet(replayOption) || options.isSet(replayFramesOption)) {
+        const bool printFrames = options.isSet(replayFramesOption);
+        return replayTrace(options.value(printFrames ? replayFramesOption : replayOption).toStdString(), printFrames,
+                           options.value(dumpFormatOption) == QLatin1String("ansi"));
+    }
+
+    if (options.isSet(indexServerOption)) {
+        const QStringList dirs = options.positionalArguments();
+        IndexServer server(dirs.isEmpty() ? QStringList{QStringLiteral(".")} : dirs);
+        return server.listen(options.value(indexServerOption)) ? app.exec() : 1;
+    }
+
+    if (options.isSet(renderBatchOption)) {
+        int rows = 0;
+        int cols = 0;
+        const QString format = options.value(dumpFormatOption);
+        if (!options.isSet(outOption) || !parseSize(options.value(sizeOption), rows, cols) ||
+            (format != QLatin1String("plain") && format != QLatin1String("ansi"))) {
+            std::cerr << "Expected --render-batch DIR --out DIR, --size COLSxROWS and --dump-format plain or ansi"
+                      << std::endl;
+            return 1;
+        }
+        return renderBatch(options.value(renderBatchOption).toStdWString(), options.value(outOption).toStdWString(),
+                           rows, cols, format == QLatin1String("ansi"));
+    }
+
+    if (options.isSet(packBundleOption)) {
+        if (!options.isSet(outOption)) {
+            std::cerr << "Expected --pack-bundle DIR --out FILE" << std::endl;
+            return 1;
+        }
+        try {
+            QmlBundle::write(options.value(packBundleOption).toStdString(), options.value(outOption).toStdString());
+        } catch (const std::exception &ex) {
+            std::cerr << ex.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // A bundle's members read as files under its path from here on, with
+    // one open for all of them; it outlives everything that reads them.
+    QmlBundle bundle;
+    if (options.isSet(bundleOption)) {
+        const std::string bundlePath = options.value(bundleOption).toStdString();
+        if (!bundle.open(bundlePath)) {
+            std::cerr << "Could not open the bundle " << bundlePath << std::endl;
+            return 1;
+        }
+        bundle.install();
+    }
 
     const std::filesystem::path exeDir = std::filesystem::path(app.applicationDirPath().toStdWString());
-    const std::string qmlPath = (argc > 1) ? argv[1] : defaultQmlPath(exeDir);
+    const QStringList positional = options.positionalArguments();
+    const bool watch = options.isSet(watchOption);
+    const std::string qmlPath = !positional.isEmpty() ? positional.first().toStdString()
+                                : bundle.isOpen()     ? bundle.mountPoint() + "/Main.qml"
+                                                      : defaultQmlPath(exeDir, watch);
+    if (watch && QmlQtResources::isResourcePath(qmlPath)) {
+        std::cerr << "--watch needs a file on disk, not the resource " << qmlPath << std::endl;
+        return 1;
+    }
+    if (watch && bundle.contains(qmlPath)) {
+        std::cerr << "--watch needs a file on disk, not the bundle member " << qmlPath << std::endl;
+        return 1;
+    }
+    if (watch && positional.size() > 1) {
+        std::cerr << "--watch takes a single file" << std::endl;
+        return 1;
+    }
+
+    const bool noCache = options.isSet(noCacheOption);
+    const QString cacheDir = options.isSet(cacheDirOption)
+                                 ? options.value(cacheDirOption)
+                                 : QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+                                       QStringLiteral("/qmlc");
+    // Resources are parsed in place; caching their trees would only add a
+    // disk lookup. Bundle members come with theirs.
+    MetricsSource metricsSource{options.value(metricsOption), qmlPath, {}};
+    LoadMetrics &loads = metricsSource.loads;
+    const auto parse = [&](const std::string &path) {
+        const auto start = std::chrono::steady_clock::now();
+        QmlDocument document;
+        if (bundle.contains(path)) {
+            bool precompiled = false;
+            document = bundle.load(path, &precompiled);
+            ++(precompiled ? loads.cacheHits : loads.cacheMisses);
+        } else if (noCache || QmlQtResources::isResourcePath(path)) {
+            document = QmlParser().parseFile(path);
+        } else {
+            bool cacheHit = false;
+            document = QmlAstCache(QDir::toNativeSeparators(cacheDir).toStdString()).loadFile(path, &cacheHit);
+            ++(cacheHit ? loads.cacheHits : loads.cacheMisses);
+        }
+        loads.loadTime.record(std::chrono::steady_clock::now() - start);
+        return document;
+    };
+    // Component files are parsed once however many screens use them.
+    QmlProjectIndex project;
+    const auto load = [&](const std::string &path) {
+        return project.expand(parse(path), openSource(path).view(), path);
+    };
+
+    if (options.isSet(dumpOption)) {
+        int rows = 0;
+        int cols = 0;
+        const QString format = options.value(dumpFormatOption);
+        if (!parseSize(options.value(dumpOption), rows, cols) ||
+            (format != QLatin1String("plain") && format != QLatin1String("ansi"))) {
+            std::cerr << "Expected --dump COLSxROWS and --dump-format plain or ansi" << std::endl;
+            return 1;
+        }
+        const QStringList files = !positional.isEmpty() ? positional : QStringList{QString::fromStdString(qmlPath)};
+        return dump(files, load, rows, cols, format == QLatin1String("ansi"));
+    }
+    if (options.isSet(exportOption)) {
+        const QString format = options.value(exportOption);
+        if (format != QLatin1String("json") && format != QLatin1String("msgpack")) {
+            std::cerr << "Expected --export json or msgpack" << std::endl;
+            return 1;
+        }
+        const QStringList files = !positional.isEmpty() ? positional : QStringList{QString::fromStdString(qmlPath)};
+        return exportTrees(files, format == QLatin1String("json") ? QmlExporter::Format::Json
+                                                                  : QmlExporter::Format::MessagePack);
+    }
 
-    QmlParser parser;
+    // Only reloads and full expansion need the text; the rest parse it
+    // where it lies.
+    const bool expandAll = options.isSet(serveOption) || options.isSet(sessionsOption);
+    std::string source;
     QmlDocument document;
     try {
-        document = parser.parseFile(qmlPath);
+        // Reloads diff against the text the document came from, so parse
+        // exactly what was read.
+        if (watch || expandAll) {
+            source = readSource(qmlPath);
+        }
+        if (watch) {
+            const auto start = std::chrono::steady_clock::now();
+            document = QmlParser().parseString(source);
+            loads.loadTime.record(std::chrono::steady_clock::now() - start);
+        } else {
+            document = parse(qmlPath);
+        }
     } catch (const std::exception &ex) {
         std::cerr << "Failed to load " << qmlPath << ": " << ex.what() << std::endl;
         return 1;
     }
+    startup.mark("load");
+    // Remote screens get the whole tree expanded; the terminal frontend
+    // instantiates components as they come into view.
+    if (expandAll) {
+        document = project.expand(std::move(document), source, qmlPath);
+    }
+
+    if (options.isSet(serveOption)) {
+        int rows = 0;
+        int cols = 0;
+        bool portOk = false;
+        const quint16 port = options.value(serveOption).toUShort(&portOk);
+        if (!portOk || !parseSize(options.value(sizeOption), rows, cols)) {
+            std::cerr << "Expected --serve PORT and --size COLSxROWS" << std::endl;
+            return 1;
+        }
+        return serve(app, document, port, rows, cols, options.value(frameRateOption).toInt(), metricsSource);
+    }
+
+    if (options.isSet(sessionsOption)) {
+        int rows = 0;
+        int cols = 0;
+        bool portOk = false;
+        const quint16 port = options.value(sessionsOption).toUShort(&portOk);
+        if (!portOk || !parseSize(options.value(sizeOption), rows, cols)) {
+            std::cerr << "Expected --sessions PORT and --size COLSxROWS" << std::endl;
+            return 1;
+        }
+        bool workersOk = false;
+        const int workers = options.value(workersOption).toInt(&workersOk);
+        if (!workersOk || workers < 1) {
+            std::cerr << "Expected --workers COUNT of at least 1" << std::endl;
+            return 1;
+        }
+        bool shardsOk = false;
+        int shards = options.value(shardsOption).toInt(&shardsOk);
+        if (!shardsOk || shards < 0) {
+            std::cerr << "Expected --shards COUNT, or 0 for one per core" << std::endl;
+            return 1;
+        }
+        if (shards == 0) {
+            shards = QThread::idealThreadCount();
+        }
+        // The supervisor has loaded the document once already, so the
+        // workers find it in the AST cache.
+        if (workers > 1 && !options.isSet(preforkWorkerOption)) {
+            return supervise(app, port, workers, metricsSource.endpoint);
+        }
+        const int frameRate = options.value(frameRateOption).toInt();
+        const size_t bandwidth = options.value(bandwidthOption).toULongLong();
+        const size_t sessionLimit = static_cast<size_t>(options.value(sessionMemoryLimitOption).toULongLong()) << 20;
+        const QString workerSpec = options.value(preforkWorkerOption);
+        if (shards > 1) {
+            ShardedSessionServer server(document, shards, rows, cols, frameRate, bandwidth, sessionLimit,
+                                        metricsSource);
+            return runSessions(app, server, port, workerSpec);
+        }
+        SessionServer server(document, rows, cols, frameRate, bandwidth, sessionLimit, metricsSource);
+        return runSessions(app, server, port, workerSpec);
+    }
+
+    // Every file named opens in a tab of its own; the first is shown.
+    std::vector<std::unique_ptr<DocumentTab>> opened;
+    opened.push_back(std::make_unique<DocumentTab>());
+    opened.front()->path = qmlPath;
+    opened.front()->source = std::move(source);
+    opened.front()->document = std::move(document);
+    for (qsizetype i = 1; i < positional.size(); ++i) {
+        auto tab = std::make_unique<DocumentTab>();
+        tab->path = positional[i].toStdString();
+        try {
+            tab->document = parse(tab->path);
+        } catch (const std::exception &ex) {
+            std::cerr << "Failed to load " << tab->path << ": " << ex.what() << std::endl;
+            return 1;
+        }
+        opened.push_back(std::move(tab));
+    }
+    size_t active = 0;
+
+    // Started before curses takes the terminal, so that a failure can be
+    // reported; it collects only once the event loop runs, when collect
+    // has been set.
+    MetricsEndpoint::Collect collect;
+    std::unique_ptr<MetricsEndpoint> metrics;
+    if (!metricsSource.endpoint.isEmpty()) {
+        metrics = startMetrics(metricsSource.endpoint, [&collect](QmlMetricsText &text) { collect(text); });
+        if (!metrics) {
+            return 1;
+        }
+    }
 
     if (initscr() == nullptr) {
         std::cerr << "Could not initialize curses screen." << std::endl;
@@ -62,19 +2124,418 @@ int main(int argc, char *argv[]) {
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
+    // Clicks and the wheel arrive as KEY_MOUSE; reporting presses rather
+    // than clicks means no wait to tell a click from a drag.
+    mouseinterval(0);
+#ifdef BUTTON5_PRESSED
+    mousemask(BUTTON1_PRESSED | BUTTON4_PRESSED | BUTTON5_PRESSED, nullptr);
+#else
+    mousemask(BUTTON1_PRESSED | BUTTON4_PRESSED, nullptr);
+#endif
+    // Colour pairs are set up as they are first drawn; default backgrounds
+    // show through.
+    if (has_colors()) {
+        start_color();
+        use_default_colors();
+    }
+    startup.mark("curses");
 
     Greeter greeter;
     PdcursesScreen screen;  // defaults to stdscr
-    QmlCursesFrontend frontend(screen, [&greeter](const std::string &binding) {
-        return resolveBinding(greeter, binding);
+    // With --record, frames go through a recorder that forwards to the
+    // terminal; it flushes to the file as it is destroyed, before the file.
+    std::ofstream recording;
+    std::unique_ptr<QmlRecordingScreen> recorder;
+    if (options.isSet(recordOption)) {
+        const std::filesystem::path recordPath(options.value(recordOption).toStdWString());
+        recording.open(recordPath, std::ios::binary | std::ios::trunc);
+        if (!recording) {
+            endwin();
+            std::cerr << "Could not write " << recordPath.string() << std::endl;
+            return 1;
+        }
+        recorder = std::make_unique<QmlRecordingScreen>(screen, [&recording](std::string_view bytes) {
+            recording.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        });
+    }
+    // The frontends keep a reference to the writer, so it lives out here.
+    // It resolves ids against the shown tab's document.
+    QmlMetaResolver resolver;
+    resolver.addObject("greeter", &greeter);
+    for (auto &tab : opened) {
+        tab->resolverDocument = tab->document;
+    }
+    resolver.setDocument(&opened[active]->resolverDocument);
+    // Bindings on NOTIFY properties are invalidated when they change.
+    QmlNotifyBridge bridge(resolver);
+    bridge.addObject("greeter", &greeter);
+    // Greeter's history feeds ListViews bound to greeter.history.
+    QmlQtListModel history(greeter.history());
+    // Each tab's timers, animations and cursor blink share its timeline,
+    // which only wakes while one of them runs, and only while the tab is
+    // shown; a tick that moved anything asks for a frame. It wakes no more
+    // often than the scheduler commits, so an idle UI also ticks at the
+    // idle rate.
+    std::function<void()> animated;
+    const QmlFrameScheduler *pace = nullptr;
+    // Held from here on, after everything the frontends refer to, so that
+    // they go first.
+    std::vector<std::unique_ptr<DocumentTab>> tabs = std::move(opened);
+    std::function<void(DocumentTab &, std::chrono::microseconds)> wakeTimeline =
+        [&](DocumentTab &tab, std::chrono::microseconds delay) {
+            if (&tab != tabs[active].get()) {
+                tab.timelineParked = true;
+                return;
+            }
+            if (pace != nullptr) {
+                delay = std::max(delay, pace->currentInterval());
+            }
+            QTimer::singleShot(std::chrono::ceil<std::chrono::milliseconds>(delay), [&, owner = &tab] {
+                if (owner->timeline->tick() && owner == tabs[active].get() && animated) {
+                    animated();
+                }
+            });
+        };
+    std::unique_ptr<HotReloader> reloader;
+    for (auto &tab : tabs) {
+        DocumentTab &owner = *tab;
+        tab->timeline = std::make_unique<QmlTimeline>(
+            [&wakeTimeline, &owner](std::chrono::microseconds delay) { wakeTimeline(owner, delay); });
+        tab->frontend =
+            std::make_unique<QmlCursesFrontend>(recorder ? static_cast<ICursesScreen &>(*recorder) : screen, bridge);
+        QmlCursesFrontend &frontend = *tab->frontend;
+        frontend.setStatsHud(options.isSet(statsHudOption));
+        frontend.setTimeline(tab->timeline.get());
+        frontend.setModel("greeter.history", &history);
+        frontend.setComponentInstantiator([&project, &owner](const QmlNode &use, QmlNode &instance) {
+            return project.instantiate(use, owner.path, instance);
+        });
+    }
+    const auto current = [&]() -> QmlCursesFrontend & { return *tabs[active]->frontend; };
+    // With --watch there is one tab, and the reloader holds its document.
+    const auto currentDocument = [&]() -> const QmlDocument & {
+        return reloader ? reloader->document() : tabs[active]->document;
+    };
+    // The bottom row names the tabs, the shown one in brackets, and what
+    // the keys do; the tab list is rebuilt only when another tab is shown.
+    std::string tabBar;
+    const auto layoutTabBar = [&] {
+        tabBar.clear();
+        if (tabs.size() < 2) {
+            return;
+        }
+        for (size_t i = 0; i < tabs.size(); ++i) {
+            const std::string name = std::filesystem::path(tabs[i]->path).filename().string();
+            tabBar.append(i == active ? "[" : " ").append(name).append(i == active ? "] " : "  ");
+        }
+        tabBar.append(" F6 switches tabs; ");
+    };
+    layoutTabBar();
+    std::string instructions;
+    std::function<void()> resume;  // requests the rest of a time-sliced frame
+    const auto redraw = [&] {
+        QmlCursesFrontend &frontend = current();
+        frontend.render(currentDocument());
+        if (frontend.frameIncomplete() && resume) {
+            resume();
+        }
+        if (reloader) {
+            reloader->watchComponents();
+        }
+        if (!frontend.statsEnabled()) {  // the HUD has the bottom row
+            const char *hint = frontend.focusableCount() > 0 ? "Tab moves focus, Enter presses, Esc exits"
+                               : watch                       ? "Watching for changes; press any key to exit"
+                                                             : "Press any key to exit";
+            instructions.assign(tabBar).append(hint);
+            mvprintw(std::max(0, screen.rows() - 1), 1, "%s", instructions.c_str());
+        }
+        refresh();
+    };
+    redraw();
+    startup.mark("firstFrame");
+    // Written to a file now, while the session runs; stdout has to wait
+    // for curses to let go of the terminal.
+    const QString startupTiming = options.value(startupTimingOption);
+    if (!startupTiming.isEmpty() && startupTiming != QLatin1String("-") && !startup.write(startupTiming)) {
+        QmlLog::warning("Could not write startup timing to {}", startupTiming.toStdString());
+    }
+    if (options.isSet(quitAfterStartupOption)) {
+        QTimer::singleShot(0, &app, &QCoreApplication::quit);
+    }
+    if (watch) {
+        DocumentTab &tab = *tabs.front();
+        reloader = std::make_unique<HotReloader>(tab.path, std::move(tab.source), std::move(tab.document), project,
+                                                 *tab.frontend);
+    }
+
+    // Redraws are requested by marking the screen dirty; however many
+    // requests arrive within one frame interval, it is drawn once.
+    QmlFrameScheduler scheduler(redraw, [&](std::chrono::microseconds delay) {
+        QTimer::singleShot(std::chrono::ceil<std::chrono::milliseconds>(delay), [&scheduler] { scheduler.tick(); });
     });
-    frontend.render(document);
+    scheduler.setFrameRate(options.value(frameRateOption).toInt());
+    scheduler.setIdleFrameRate(options.value(idleFrameRateOption).toInt());
+    pace = &scheduler;
+    const auto requestRedraw = [&scheduler] { scheduler.requestFrame(); };
+    animated = requestRedraw;
+    resume = requestRedraw;
+    // A hidden tab's bindings are only marked stale; it resolves them when
+    // it is next drawn.
+    const auto invalidate = [&tabs](const std::string &binding) {
+        for (auto &tab : tabs) {
+            tab->frontend->invalidateBinding(binding);
+        }
+    };
+    for (auto &tab : tabs) {
+        QmlCursesFrontend &frontend = *tab->frontend;
+        const DocumentTab &owner = *tab;
+        // A long frame stops at half the interval, or as soon as a key
+        // waits, and goes on in the next one once the key is handled.
+#ifdef _WIN32
+        frontend.setFrameBudget(scheduler.interval() / 2);
+#else
+        frontend.setFrameBudget(scheduler.interval() / 2, [] {
+            pollfd input{STDIN_FILENO, POLLIN, 0};
+            return poll(&input, 1, 0) > 0;
+        });
+#endif
+        // Typed text feeds bindings such as greeter.greet(nameField.text),
+        // and handlers assign to the items they name.
+        frontend.setTextEditedHandler([&resolver, &invalidate](const std::string &id, const std::string &text) {
+            if (!id.empty()) {
+                resolver.setValue(id, "text", text);
+                resolver.commit(invalidate);
+            }
+        });
+        frontend.setActionHandler([&resolver, &reloader, &invalidate, &owner, &frontend](
+                                      const std::string &, const QmlScriptBlock &script) {
+            resolver.run(script.body(reloader ? reloader->source() : owner.source),
+                         [&frontend](const std::string &id, const std::string &property, const std::string &value) {
+                             if (property == "text") {
+                                 frontend.setItemText(id, value);
+                             }
+                         });
+            resolver.commit(invalidate);
+        });
+    }
+    history.setChangedHandler(requestRedraw);
+    bridge.setChangedHandler([&](const std::string &binding) {
+        invalidate(binding);
+        requestRedraw();
+    });
+    // A hidden tab's document can be held LZ4-compressed, its plan and
+    // instances dropped with it; showing it decompresses it, which takes
+    // well under a frame for a screen, and lays it out again. Returns the
+    // bytes given back.
+    uint64_t tabSwitches = 0;
+    const auto compressTab = [&](DocumentTab &tab) -> size_t {
+        if (&tab == tabs[active].get() || !tab.compressed.empty()) {
+            return 0;
+        }
+        const size_t before = tab.document.memoryUsage().total();
+        tab.compressed = QmlCompressedDocument(tab.document);
+        tab.frontend->releasePlan();
+        tab.document = QmlDocument();
+        tab.resolverDocument = QmlDocument();
+        return before > tab.compressed.byteSize() ? before - tab.compressed.byteSize() : 0;
+    };
+    // The shown tab's frontend has drawn over the screen, so the next one
+    // is told to send its whole frame. Its plan, bindings and grid are as
+    // it left them, so that frame is a compose and a repaint; bindings
+    // that went stale meanwhile are resolved in it, and its timeline
+    // catches up.
+    const auto showTab = [&](size_t index) {
+        if (index == active) {
+            return;
+        }
+        DocumentTab &hidden = *tabs[active];
+        hidden.lastShown = ++tabSwitches;
+        active = index;
+        DocumentTab &tab = *tabs[active];
+        tab.lastShown = tabSwitches;
+        if (!tab.compressed.empty()) {
+            tab.document = tab.compressed.decompress();
+            tab.resolverDocument = tab.document;
+            tab.compressed = QmlCompressedDocument();
+        }
+        resolver.setDocument(&tab.resolverDocument);
+        tab.frontend->forgetScreen();
+        layoutTabBar();
+        if (tab.timelineParked) {
+            tab.timelineParked = false;
+            wakeTimeline(tab, std::chrono::microseconds(0));
+        }
+        if (options.isSet(compressHiddenTabsOption)) {
+            compressTab(hidden);
+        }
+    };
 
-    const int instructionRow = std::max(0, screen.rows() - 1);
-    mvprintw(instructionRow, 1, "Press any key to exit");
-    refresh();
-    getch();
-    endwin();
+    // Dragging a pane sends a burst of KEY_RESIZE; wait for it to go quiet
+    // and redraw once.
+    QTimer resizeSettle;
+    resizeSettle.setSingleShot(true);
+    resizeSettle.setInterval(kResizeSettleMs);
+    QObject::connect(&resizeSettle, &QTimer::timeout, [&] {
+        acknowledgeResize();
+        QmlLog::debug("Terminal resized to {}x{}", COLS, LINES);
+        requestRedraw();
+    });
 
-    return 0;
+    // Keys go to the focused item, and clicks to the item under them; Esc,
+    // or any key when nothing takes focus, exits. F6 and Shift-F6 show the
+    // next and previous tab. Typed bursts and pastes reach a TextField as
+    // one edit each, so they cost one frame. Redraws count toward the input latency,
+    // a resize's settling time included, as that is what the operator
+    // waits for.
+    constexpr int kEscape = 27;
+    constexpr int kShiftF6 = KEY_F(18);  // as xterm and the Linux console report it
+    QmlInputCoalescer coalescer;
+#ifndef _WIN32
+    // Asks the terminal to bracket pastes and report focus changes for the
+    // coalescer.
+    std::fwrite(QmlInputCoalescer::kEnablePaste.data(), 1, QmlInputCoalescer::kEnablePaste.size(), stdout);
+    std::fwrite(QmlInputCoalescer::kEnableFocus.data(), 1, QmlInputCoalescer::kEnableFocus.size(), stdout);
+    std::fflush(stdout);
+#endif
+    TerminalInput input([&](const std::vector<int> &keys, std::chrono::steady_clock::time_point readAt) {
+        bool resized = false;
+        bool handled = false;
+        bool quit = false;
+        coalescer.feed(keys);
+        coalescer.drain([&](const QmlInputCoalescer::Event &event) {
+            if (quit) {
+                return;
+            }
+            if (event.kind == QmlInputCoalescer::Event::Kind::Focus) {
+                scheduler.setFocused(event.key != 0, readAt);
+                return;
+            }
+            scheduler.noteInput(readAt);
+            QmlCursesFrontend &frontend = current();
+            if (event.kind == QmlInputCoalescer::Event::Kind::Text) {
+                if (frontend.focusableCount() == 0) {
+                    quit = true;
+                } else if (frontend.insertText(event.text)) {
+                    handled = true;
+                } else if (!event.pasted) {
+                    // Not a field: the keys may still mean something, such
+                    // as Space pressing a button.
+                    for (const char key : event.text) {
+                        handled |= frontend.handleKey(static_cast<unsigned char>(key));
+                    }
+                }
+            } else if (event.key == KEY_RESIZE) {
+                resized = true;
+            } else if (tabs.size() > 1 && (event.key == KEY_F(6) || event.key == kShiftF6)) {
+                const size_t step = event.key == KEY_F(6) ? 1 : tabs.size() - 1;
+                showTab((active + step) % tabs.size());
+                handled = true;
+            } else if (event.key == KEY_MOUSE) {
+                MEVENT mouse;
+                if (getmouse(&mouse) == OK) {
+                    handled |= handleMouse(frontend, mouse);
+                }
+            } else if (event.key == kEscape || frontend.focusableCount() == 0) {
+                quit = true;
+            } else {
+                handled |= frontend.handleKey(event.key);
+            }
+        });
+        if (quit) {
+            app.quit();
+            return;
+        }
+        if (resized || handled) {
+            current().markInput(readAt);
+        }
+        if (resized) {
+            resizeSettle.start();
+        }
+        if (handled) {
+            requestRedraw();
+        }
+    });
+
+    // The caches are held to --cache-budget, checked once a second between
+    // frames, and give memory back when the OS runs short. Components cost
+    // a read and a parse to rebuild, hidden tabs' documents a decompression
+    // and a layout, bindings a resolver call. Hidden tabs give up their
+    // bindings before the shown one, and are compressed rather than
+    // dropped, the longest hidden first.
+    QmlCacheBudget cacheBudget(static_cast<size_t>(options.value(cacheBudgetOption).toULongLong()) << 20);
+    cacheBudget.attach("components", 8.0, [&project] { return project.byteSize(); },
+                       [&project](size_t bytes) { return project.evict(bytes); });
+    cacheBudget.attach(
+        "bindings", 2.0,
+        [&tabs] {
+            size_t bytes = 0;
+            for (const auto &tab : tabs) {
+                bytes += tab->frontend->bindingCacheBytes();
+            }
+            return bytes;
+        },
+        [&](size_t bytes) {
+            size_t freed = 0;
+            for (size_t i = 1; i <= tabs.size() && freed < bytes; ++i) {
+                freed += tabs[(active + i) % tabs.size()]->frontend->evictBindings(bytes - freed);
+            }
+            return freed;
+        });
+    cacheBudget.attach(
+        "documents", 4.0,
+        [&tabs] {
+            size_t bytes = 0;
+            for (const auto &tab : tabs) {
+                bytes += tab->compressed.empty() ? tab->document.memoryUsage().total() : tab->compressed.byteSize();
+            }
+            return bytes;
+        },
+        [&](size_t bytes) {
+            std::vector<DocumentTab *> hidden;
+            for (const auto &tab : tabs) {
+                if (tab.get() != tabs[active].get() && tab->compressed.empty()) {
+                    hidden.push_back(tab.get());
+                }
+            }
+            std::sort(hidden.begin(), hidden.end(),
+                      [](const DocumentTab *a, const DocumentTab *b) { return a->lastShown < b->lastShown; });
+            size_t freed = 0;
+            for (size_t i = 0; i < hidden.size() && freed < bytes; ++i) {
+                freed += compressTab(*hidden[i]);
+            }
+            return freed;
+        });
+    MemoryPressureWatcher memoryPressure([&cacheBudget](QmlCacheBudget::Pressure pressure) {
+        const size_t freed = cacheBudget.relieve(pressure);
+        QmlLog::warning("Memory pressure: {} cache bytes freed", freed);
+    });
+    QTimer cacheBudgetTimer;
+    if (cacheBudget.limit() > 0) {
+        QObject::connect(&cacheBudgetTimer, &QTimer::timeout, [&cacheBudget] { cacheBudget.enforce(); });
+        cacheBudgetTimer.start(1000);
+    }
+
+    collect = [&](QmlMetricsText &text) {
+        collectCommon(text, metricsSource, currentDocument(), scheduler);
+        // A single file keeps the unlabelled series; tabs are labelled by path.
+        std::vector<LabelledFrontend> frontends;
+        for (const auto &tab : tabs) {
+            frontends.push_back(LabelledFrontend{
+                tabs.size() > 1 ? QmlMetricsText::label("tab", tab->path) : std::string(), tab->frontend.get()});
+        }
+        collectFrontends(text, frontends);
+        cacheBudget.appendMetrics(text);
+    };
+
+    const int status = app.exec();
+#ifndef _WIN32
+    std::fwrite(QmlInputCoalescer::kDisablePaste.data(), 1, QmlInputCoalescer::kDisablePaste.size(), stdout);
+    std::fwrite(QmlInputCoalescer::kDisableFocus.data(), 1, QmlInputCoalescer::kDisableFocus.size(), stdout);
+    std::fflush(stdout);
+#endif
+    endwin();
+    if (startupTiming == QLatin1String("-")) {
+        startup.write(startupTiming);
+    }
+    return status;
 }
@@ -0,0 +1,37 @@
+#include "frame_incubator.h"
+
+#include <QQuickWindow>
+
+FrameIncubator::FrameIncubator(std::chrono::milliseconds budget, QObject *parent)
+    : QObject(parent), budget_(budget) {}
+
+void FrameIncubator::attach(QQuickWindow *window) {
+    if (window_) {
+        disconnect(window_, nullptr, this, nullptr);
+    }
+    window_ = window;
+    if (!window_) {
+        return;
+    }
+    connect(window_, &QQuickWindow::afterAnimating, this, &FrameIncubator::incubateFrame);
+    if (incubatingObjectCount() > 0) {
+        window_->update();
+    }
+}
+
+void FrameIncubator::incubatingObjectCountChanged(int count) {
+    if (count > 0 && window_) {
+        window_->update();
+    }
+}
+
+void FrameIncubator::incubateFrame() {
+    if (incubatingObjectCount() == 0) {
+        return;
+    }
+    ++framesUsed_;
+    incubateFor(static_cast<int>(budget_.count()));
+    if (incubatingObjectCount() > 0 && window_) {
+        window_->update();  // keep frames coming until it is done
+    }
+}
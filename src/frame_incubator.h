@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QQmlIncubationController>
+#include <chrono>
+
+class QQuickWindow;
+
+// Incubation controller that creates asynchronously loaded QML, such as
+// LazyPanel's content, a slice at a time on the GUI thread: at most budget
+// per frame of the attached window, right after its animations advance.
+// While anything is incubating it asks the window for another frame, so
+// heavy panels fill in over a few frames instead of stalling one.
+//
+//   FrameIncubator incubator;
+//   engine.setIncubationController(&incubator);  // before loading
+//   incubator.attach(window);                     // e.g. on objectCreated
+//
+// Objects incubate only while a window is attached.
+class FrameIncubator : public QObject, public QQmlIncubationController {
+public:
+    explicit FrameIncubator(std::chrono::milliseconds budget = std::chrono::milliseconds(4),
+                            QObject *parent = nullptr);
+
+    void attach(QQuickWindow *window);
+    std::chrono::milliseconds budget() const { return budget_; }
+    // Frames that incubated something.
+    int framesUsed() const { return framesUsed_; }
+
+protected:
+    void incubatingObjectCountChanged(int count) override;
+
+private:
+    void incubateFrame();
+
+    QPointer<QQuickWindow> window_;
+    std::chrono::milliseconds budget_;
+    int framesUsed_ = 0;
+};
@@ -0,0 +1,116 @@
+#include "frame_property_batch.h"
+
+#include <QMetaProperty>
+#include <QProperty>
+#include <QQuickWindow>
+#include <utility>
+
+FramePropertyBatch::FramePropertyBatch(QObject *parent) : QObject(parent) {}
+
+void FramePropertyBatch::attach(QQuickWindow *window) {
+    if (window_) {
+        disconnect(window_, nullptr, this, nullptr);
+    }
+    window_ = window;
+    if (!window_) {
+        return;
+    }
+    connect(window_, &QQuickWindow::afterAnimating, this, [this] { flush(); });
+    if (pending() > 0) {
+        window_->update();
+    }
+}
+
+bool FramePropertyBatch::set(QObject *object, const char *name, QVariant value) {
+    if (!object) {
+        return false;
+    }
+    const QMetaObject *meta = object->metaObject();
+    const int property = meta->indexOfProperty(name);
+    if (property < 0 || !meta->property(property).isWritable()) {
+        return false;
+    }
+    set(object, property, std::move(value));
+    return true;
+}
+
+void FramePropertyBatch::set(QObject *object, int property, QVariant value) {
+    bool schedule = false;
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        const auto key = qMakePair(static_cast<const QObject *>(object), property);
+        const auto it = queued_.constFind(key);
+        if (it != queued_.constEnd()) {
+            Update &update = queue_[*it];
+            // A new object at a destroyed one's address takes its place.
+            update.object = object;
+            update.value = std::move(value);
+            ++coalesced_;
+            return;
+        }
+        queued_.insert(key, queue_.size());
+        queue_.push_back(Update{object, property, std::move(value)});
+        schedule = !scheduled_;
+        scheduled_ = true;
+    }
+    if (schedule) {
+        // Queued even from this thread, so that the sets of one turn of the
+        // event loop wait for the same frame.
+        QMetaObject::invokeMethod(this, [this] { scheduleFlush(); }, Qt::QueuedConnection);
+    }
+}
+
+void FramePropertyBatch::scheduleFlush() {
+    if (window_) {
+        window_->update();
+    } else {
+        flush();
+    }
+}
+
+int FramePropertyBatch::flush() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        applying_.swap(queue_);
+        queued_.clear();
+        scheduled_ = false;
+    }
+    if (applying_.empty()) {
+        return 0;
+    }
+    int written = 0;
+    Qt::beginPropertyUpdateGroup();
+    for (const Update &update : applying_) {
+        QObject *object = update.object;
+        if (object && object->metaObject()->property(update.property).write(object, update.value)) {
+            ++written;
+        }
+    }
+    Qt::endPropertyUpdateGroup();
+    applying_.clear();
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+    applied_ += static_cast<quint64>(written);
+    ++framesApplied_;
+    return written;
+}
+
+int FramePropertyBatch::pending() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(queue_.size());
+}
+
+quint64 FramePropertyBatch::coalescedCount() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return coalesced_;
+}
+
+quint64 FramePropertyBatch::appliedCount() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return applied_;
+}
+
+int FramePropertyBatch::framesApplied() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return framesApplied_;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QVariant>
+#include <mutex>
+#include <vector>
+
+class QQuickWindow;
+
+// Property writes from C++ collected and applied once per frame of the
+// attached window, on the GUI thread right after its animations advance,
+// just before the scene graph synchronizes. A backend pushing thousands
+// of updates a second then costs the UI one write per property per frame:
+// a property set again before the frame keeps its place in the queue and
+// takes the newest value. A frame's writes are one property update group
+// (Qt::beginPropertyUpdateGroup()), so bindings on bindable properties are
+// evaluated once, after all of them; QML bindings fed by NOTIFY signals
+// run once per property written.
+//
+//   FramePropertyBatch batch;
+//   batch.attach(window);               // e.g. on objectCreated
+//   batch.set(ticker, "price", 101.5);  // from any thread
+//
+// set() may be called from any thread; objects are written on the batch's
+// thread, and writes to objects destroyed meanwhile are dropped. While an
+// attached window is hidden they wait for its next frame; without a
+// window, they are applied on the next turn of that thread's event loop.
+class FramePropertyBatch : public QObject {
+public:
+    explicit FramePropertyBatch(QObject *parent = nullptr);
+
+    void attach(QQuickWindow *window);
+
+    // Queues writing value to object's property name. Returns false, and
+    // queues nothing, if object has no writable property of that name.
+    bool set(QObject *object, const char *name, QVariant value);
+    // property is the index in object's metaObject().
+    void set(QObject *object, int property, QVariant value);
+
+    // Applies what is queued now; returns the number of properties written.
+    int flush();
+
+    // Writes waiting for the next frame.
+    int pending() const;
+    // Sets merged into a write that was already waiting.
+    quint64 coalescedCount() const;
+    // Properties written, and frames that wrote any.
+    quint64 appliedCount() const;
+    int framesApplied() const;
+
+private:
+    struct Update {
+        QPointer<QObject> object;
+        int property;
+        QVariant value;
+    };
+
+    // On this object's thread: asks the window for a frame, or flushes.
+    void scheduleFlush();
+
+    QPointer<QQuickWindow> window_;
+    mutable std::mutex mutex_;
+    std::vector<Update> queue_;  // in the order first set
+    QHash<QPair<const QObject *, int>, size_t> queued_;  // index in queue_
+    bool scheduled_ = false;
+    quint64 coalesced_ = 0;
+    quint64 applied_ = 0;
+    int framesApplied_ = 0;
+    std::vector<Update> applying_;  // this thread only; swapped with queue_ to keep both buffers
+};
@@ -0,0 +1,22 @@
+#include "frame_timing.h"
+
+#include <QQuickWindow>
+#include <chrono>
+
+void FrameTiming::attach(QQuickWindow *window) {
+    QObject::connect(window, &QQuickWindow::beforeFrameBegin, window, [this] { frame_.start(); },
+                     Qt::DirectConnection);
+    QObject::connect(
+        window, &QQuickWindow::afterFrameEnd, window,
+        [this] {
+            const std::chrono::nanoseconds elapsed(frame_.nsecsElapsed());
+            const std::lock_guard<std::mutex> lock(mutex_);
+            frameTimes_.record(elapsed);
+        },
+        Qt::DirectConnection);
+}
+
+QmlLatencyHistogram FrameTiming::frameTimes() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return frameTimes_;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <mutex>
+
+#include "qml_latency_histogram.h"
+
+class QQuickWindow;
+
+// Times each frame a window renders, from beforeFrameBegin to afterFrameEnd.
+// With the threaded render loop both come from the render thread, so the
+// histogram is kept behind a mutex and read as a copy.
+//
+//   FrameTiming timing;
+//   timing.attach(window);  // e.g. on objectCreated
+class FrameTiming {
+public:
+    void attach(QQuickWindow *window);
+    QmlLatencyHistogram frameTimes() const;
+
+private:
+    mutable std::mutex mutex_;
+    QmlLatencyHistogram frameTimes_;
+    QElapsedTimer frame_;  // render thread only
+};
@@ -0,0 +1,61 @@
+#include "glyph_prewarmer.h"
+
+#include <QRawFont>
+#include <QSet>
+
+#include "qml_executor.h"
+
+namespace {
+
+// The characters of text, each once.
+QString distinct(const QString &text) {
+    QString characters;
+    QSet<char32_t> seen;
+    for (const char32_t ch : text.toUcs4()) {
+        if (!seen.contains(ch)) {
+            seen.insert(ch);
+            characters += QString::fromUcs4(&ch, 1);
+        }
+    }
+    return characters;
+}
+
+}  // namespace
+
+GlyphPrewarmer::GlyphPrewarmer() = default;
+
+GlyphPrewarmer::~GlyphPrewarmer() {
+    wait();
+}
+
+// Both what the raster text path caches (alpha maps) and what distance
+// field text is built from (outlines).
+void GlyphPrewarmer::start(std::function<void(int glyphs)> done) {
+    wait();
+    work_ = QmlExecutor::shared().submit(
+        "GlyphPrewarmer", QmlExecutor::Priority::Background,
+        [fonts = fonts_, text = distinct(text_), done = std::move(done)] {
+            int glyphs = 0;
+            for (const QFont &font : fonts) {
+                const QRawFont raw = QRawFont::fromFont(font);
+                if (!raw.isValid()) {
+                    continue;
+                }
+                for (const quint32 glyph : raw.glyphIndexesForString(text)) {
+                    raw.alphaMapForGlyph(glyph);
+                    raw.pathForGlyph(glyph);
+                    ++glyphs;
+                }
+            }
+            if (done) {
+                done(glyphs);
+            }
+        });
+}
+
+void GlyphPrewarmer::wait() {
+    if (work_.valid()) {
+        work_.wait();
+        work_ = std::future<void>();
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QFont>
+#include <QList>
+#include <QString>
+#include <functional>
+#include <future>
+
+// Loads fonts and rasterizes the glyphs of text the first frame is known
+// to show, as a Background task on the shared QmlExecutor, while the GUI
+// thread creates the engine and loads Main.qml. The first frame then finds the font database populated,
+// the font files read and the rasterizer's caches filled, rather than
+// doing all of it before it can draw text.
+//
+//   GlyphPrewarmer prewarmer;
+//   prewarmer.addFont(QGuiApplication::font());
+//   prewarmer.addText(QStringLiteral("Say hello"));
+//   prewarmer.start([](int glyphs) { ... });  // before loading
+class GlyphPrewarmer {
+public:
+    GlyphPrewarmer();
+    // Waits for the worker.
+    ~GlyphPrewarmer();
+    GlyphPrewarmer(const GlyphPrewarmer &) = delete;
+    GlyphPrewarmer &operator=(const GlyphPrewarmer &) = delete;
+
+    // Before start(). Each character is rasterized once per font.
+    void addFont(const QFont &font) { fonts_.append(font); }
+    void addText(const QString &text) { text_ += text; }
+
+    // done is called on the worker thread with the number of glyphs
+    // rasterized.
+    void start(std::function<void(int glyphs)> done = nullptr);
+    void wait();
+
+private:
+    QList<QFont> fonts_;
+    QString text_;
+    std::future<void> work_;
+};
@@ -1,15 +1,176 @@
 #include "greeter.h"
 
-Greeter::Greeter(QObject *parent) : QObject(parent) {}
+#include <QPromise>
+#include <QThread>
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "qml_executor.h"
+
+namespace {
+
+constexpr QStringView kHello = u"Hello, ";
+constexpr QStringView kNobody = u"Hello, Qt 6!";
+// Below this many names per thread, splitting costs more than it saves.
+constexpr qsizetype kNamesPerTask = 8192;
+
+qsizetype greetingSize(QStringView trimmed) {
+    return trimmed.isEmpty() ? kNobody.size() : kHello.size() + trimmed.size() + 1;
+}
+
+// Writes the greeting for an already trimmed name; out has
+// greetingSize(trimmed) characters.
+void writeGreeting(QStringView trimmed, QChar *out) {
+    if (trimmed.isEmpty()) {
+        std::copy(kNobody.begin(), kNobody.end(), out);
+        return;
+    }
+    out = std::copy(kHello.begin(), kHello.end(), out);
+    out = std::copy(trimmed.begin(), trimmed.end(), out);
+    *out = QLatin1Char('!');
+}
+
+QString helloTo(QStringView name) {
+    const QStringView trimmed = name.trimmed();
+    QString greeting(greetingSize(trimmed), Qt::Uninitialized);
+    writeGreeting(trimmed, greeting.data());
+    return greeting;
+}
+
+QString greetCached(GreetingCache *cache, const QString &name) {
+    if (cache == nullptr) {
+        return helloTo(name);
+    }
+    // Shares name's data when there is nothing to trim.
+    const QString trimmed = name.trimmed();
+    QString greeting;
+    if (!cache->find(trimmed, greeting)) {
+        greeting = helloTo(trimmed);
+        cache->insert(trimmed, greeting);
+    }
+    return greeting;
+}
+
+// Calls work(begin, end) over [0, count), on up to maxThreads threads of
+// the shared executor if count is large enough to be worth it.
+template <typename Work>
+void forEachSlice(qsizetype count, int maxThreads, Work work) {
+    if (count < 2 * kNamesPerTask || maxThreads == 1) {
+        work(qsizetype(0), count);
+        return;
+    }
+    QmlExecutor &executor = QmlExecutor::shared();
+    const qsizetype tasks =
+        std::min<qsizetype>(count / kNamesPerTask, static_cast<qsizetype>(executor.workerCount()) + 1);
+    const auto slice = [&](size_t task) {
+        const auto index = static_cast<qsizetype>(task);
+        work(count * index / tasks, count * (index + 1) / tasks);
+    };
+    executor.parallelFor("Greeter::greetMany", static_cast<size_t>(tasks), slice, static_cast<size_t>(maxThreads),
+                         QmlExecutor::Priority::Normal);
+}
+
+template <typename Name>
+GreetingBatch greetAll(const Name *names, qsizetype count, int maxThreads) {
+    // Sizes first, so the text is allocated once at its final size.
+    std::vector<qsizetype> offsets(static_cast<size_t>(count) + 1);
+    forEachSlice(count, maxThreads, [&](qsizetype begin, qsizetype end) {
+        for (qsizetype i = begin; i < end; ++i) {
+            offsets[i + 1] = greetingSize(QStringView(names[i]).trimmed());
+        }
+    });
+    for (qsizetype i = 0; i < count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+    QString text(offsets.back(), Qt::Uninitialized);
+    QChar *out = text.data();  // detach once, before the workers write
+    forEachSlice(count, maxThreads, [&](qsizetype begin, qsizetype end) {
+        for (qsizetype i = begin; i < end; ++i) {
+            writeGreeting(QStringView(names[i]).trimmed(), out + offsets[i]);
+        }
+    });
+    return GreetingBatch(std::move(text), std::move(offsets));
+}
+
+}  // namespace
+
+QStringList GreetingBatch::toStringList() const {
+    QStringList greetings;
+    greetings.reserve(size());
+    for (qsizetype i = 0; i < size(); ++i) {
+        greetings.append(at(i).toString());
+    }
+    return greetings;
+}
+
+Greeter::Greeter(QObject *parent) : QObject(parent), history_(this) {
+    greeting_.setBinding([this] { return greet(name_.value()); });
+    connect(&pending_, &QFutureWatcher<QString>::finished, this, [this] {
+        if (!pending_.isCanceled() && pending_.resultCount() > 0) {
+            reply_ = pending_.result();
+            history_.append(reply_);
+            emit replyChanged();
+        }
+        emit busyChanged();
+    });
+}
+
+Greeter::~Greeter() {
+    pending_.cancel();
+}
 
 QString Greeter::message() const {
     return QStringLiteral("Hello from C++");
 }
 
 QString Greeter::greet(const QString &name) const {
-    const QString trimmed = name.trimmed();
-    if (trimmed.isEmpty()) {
-        return QStringLiteral("Hello, Qt 6!");
+    return greetCached(cache_.get(), name);
+}
+
+GreetingBatch Greeter::greetMany(const QStringList &names) const {
+    return greetAll(names.constData(), names.size(), batchThreads_);
+}
+
+GreetingBatch Greeter::greetMany(const QStringView *names, qsizetype count) const {
+    return greetAll(names, count, batchThreads_);
+}
+
+QFuture<QString> Greeter::greetLater(const QString &name) const {
+    // Only values cross to the worker, so it never touches this object.
+    auto promise = std::make_shared<QPromise<QString>>();
+    QFuture<QString> future = promise->future();
+    promise->start();
+    QmlExecutor::shared().post(
+        "Greeter::greetLater", QmlExecutor::Priority::Normal,
+        [promise, name, latency = latency_, cache = cache_] {
+            // Wait in slices so a cancelled request gives its thread back.
+            constexpr std::chrono::milliseconds kSlice(10);
+            for (auto waited = std::chrono::milliseconds(0); waited < latency; waited += kSlice) {
+                if (promise->isCanceled()) {
+                    promise->finish();
+                    return;
+                }
+                QThread::msleep(static_cast<unsigned long>(std::min(kSlice, latency - waited).count()));
+            }
+            promise->addResult(greetCached(cache.get(), name));
+            promise->finish();
+        });
+    return future;
+}
+
+void Greeter::setCacheCapacity(qsizetype capacity) {
+    cache_ = capacity > 0 ? std::make_shared<GreetingCache>(capacity) : nullptr;
+}
+
+void Greeter::greetAsync(const QString &name) {
+    const bool wasBusy = busy();
+    if (wasBusy) {
+        pending_.cancel();
+    }
+    // Replacing the future also drops any finished() still queued for it.
+    pending_.setFuture(greetLater(name));
+    if (!wasBusy) {
+        emit busyChanged();
     }
-    return QStringLiteral("Hello, %1!").arg(trimmed);
 }
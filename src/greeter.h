@@ -1,15 +1,114 @@
 #pragma once
 
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QObject>
+#include <QProperty>
 #include <QString>
+#include <QtQml/qqmlregistration.h>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "greeting_cache.h"
+#include "greeting_history.h"
+
+// Greetings from Greeter::greetMany(), back to back in one string.
+class GreetingBatch {
+public:
+    GreetingBatch() = default;
+    // offsets has one more entry than there are greetings, the first 0.
+    GreetingBatch(QString text, std::vector<qsizetype> offsets)
+        : text_(std::move(text)), offsets_(std::move(offsets)) {}
+
+    qsizetype size() const { return static_cast<qsizetype>(offsets_.size()) - 1; }
+    // Valid while the batch is.
+    QStringView at(qsizetype i) const { return QStringView(text_).sliced(offsets_[i], offsets_[i + 1] - offsets_[i]); }
+    const QString &text() const { return text_; }
+    QStringList toStringList() const;
+
+private:
+    QString text_;
+    std::vector<qsizetype> offsets_{0};  // greeting i is [offsets_[i], offsets_[i + 1])
+};
 
 class Greeter : public QObject {
     Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
     Q_PROPERTY(QString message READ message CONSTANT)
+    Q_PROPERTY(QString name READ name WRITE setName NOTIFY nameChanged BINDABLE bindableName)
+    // greet(name) through a binding: it is re-evaluated when name changes
+    // and reads return the cached result.
+    Q_PROPERTY(QString greeting READ greeting NOTIFY greetingChanged BINDABLE bindableGreeting)
+    // Result of the latest greetAsync(); empty until one completes.
+    Q_PROPERTY(QString reply READ reply NOTIFY replyChanged)
+    Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
+    // Every reply so far.
+    Q_PROPERTY(GreetingHistory *history READ history CONSTANT)
 
 public:
     explicit Greeter(QObject *parent = nullptr);
+    ~Greeter() override;
 
     QString message() const;
     Q_INVOKABLE QString greet(const QString &name) const;
+
+    // greet() for every name, for batch jobs. Each greeting's size is
+    // computed first and all are written into one buffer of the total size;
+    // inputs of many thousands of names are split across the shared
+    // QmlExecutor.
+    GreetingBatch greetMany(const QStringList &names) const;
+    GreetingBatch greetMany(const QStringView *names, qsizetype count) const;
+
+    QString name() const { return name_.value(); }
+    void setName(const QString &name) { name_ = name; }
+    QBindable<QString> bindableName() { return &name_; }
+
+    QString greeting() const { return greeting_.value(); }
+    QBindable<QString> bindableGreeting() { return &greeting_; }
+
+    // greet(name) on the shared QmlExecutor, after the service latency.
+    // Cancelling the future abandons the wait.
+    QFuture<QString> greetLater(const QString &name) const;
+    // For QML: greetLater(name) with the result delivered to reply on this
+    // object's thread. A newer call cancels the one in flight, whose
+    // result is dropped, so the GUI thread never waits on the service.
+    Q_INVOKABLE void greetAsync(const QString &name);
+    QString reply() const { return reply_; }
+    bool busy() const { return pending_.isRunning(); }
+    GreetingHistory *history() { return &history_; }
+
+    // The most threads greetMany() splits a batch across, the calling one
+    // included; 0, the default, for all the executor's.
+    void setBatchThreads(int threads) { batchThreads_ = threads; }
+
+    // Stands in for the round trip to the greeting service; 0 by default.
+    void setServiceLatency(std::chrono::milliseconds latency) { latency_ = latency; }
+
+    // Keeps up to capacity greetings from greet() and greetLater() in a
+    // GreetingCache, so names seen again return the stored string; 0, the
+    // default, turns the cache off. greetMany() writes into one buffer and
+    // never uses it. Set it before greet() is called from other threads.
+    void setCacheCapacity(qsizetype capacity);
+    // Null while the cache is off.
+    GreetingCache *cache() { return cache_.get(); }
+    const GreetingCache *cache() const { return cache_.get(); }
+
+signals:
+    void nameChanged();
+    void greetingChanged();
+    void replyChanged();
+    void busyChanged();
+
+private:
+    QFutureWatcher<QString> pending_;
+    QString reply_;
+    GreetingHistory history_;  // parented, so QML never takes ownership
+    std::chrono::milliseconds latency_{0};
+    int batchThreads_ = 0;
+    std::shared_ptr<GreetingCache> cache_;  // shared with greetLater() workers
+    Q_OBJECT_BINDABLE_PROPERTY(Greeter, QString, name_, &Greeter::nameChanged)
+    Q_OBJECT_BINDABLE_PROPERTY(Greeter, QString, greeting_, &Greeter::greetingChanged)
 };
@@ -0,0 +1,128 @@
+#include "greeting_cache.h"
+
+#include <algorithm>
+
+namespace {
+
+// Shards hash with a seed of their own, so the names of one shard still
+// spread over its QHash's buckets.
+constexpr size_t kShardSeed = 0x9e3779b9;
+
+}  // namespace
+
+GreetingCache::GreetingCache(qsizetype capacity)
+    : capacity_(std::max<qsizetype>(capacity, 1)),
+      shardCount_(static_cast<int>(std::min<qsizetype>(capacity_, kShards))),
+      perShard_((capacity_ + shardCount_ - 1) / shardCount_),
+      shards_(std::make_unique<Shard[]>(static_cast<size_t>(shardCount_))) {}
+
+GreetingCache::Shard &GreetingCache::shardFor(const QString &trimmed) const {
+    return shards_[qHash(trimmed, kShardSeed) % static_cast<size_t>(shardCount_)];
+}
+
+bool GreetingCache::find(const QString &trimmed, QString &greeting) {
+    Shard &shard = shardFor(trimmed);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto found = shard.index.constFind(trimmed);
+    if (found == shard.index.cend()) {
+        ++shard.misses;
+        return false;
+    }
+    ++shard.hits;
+    shard.entries.splice(shard.entries.begin(), shard.entries, found.value());
+    greeting = found.value()->second;
+    return true;
+}
+
+void GreetingCache::insert(const QString &trimmed, const QString &greeting) {
+    Shard &shard = shardFor(trimmed);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto found = shard.index.constFind(trimmed);
+    if (found != shard.index.cend()) {
+        shard.bytes += entryBytes(trimmed, greeting) - entryBytes(trimmed, found.value()->second);
+        found.value()->second = greeting;
+        shard.entries.splice(shard.entries.begin(), shard.entries, found.value());
+        return;
+    }
+    if (static_cast<qsizetype>(shard.entries.size()) == perShard_) {
+        shard.bytes -= entryBytes(shard.entries.back().first, shard.entries.back().second);
+        shard.index.remove(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+    shard.bytes += entryBytes(trimmed, greeting);
+    shard.entries.emplace_front(trimmed, greeting);
+    shard.index.insert(trimmed, shard.entries.begin());
+}
+
+quint64 GreetingCache::hits() const {
+    quint64 hits = 0;
+    for (int i = 0; i < shardCount_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        hits += shards_[i].hits;
+    }
+    return hits;
+}
+
+quint64 GreetingCache::misses() const {
+    quint64 misses = 0;
+    for (int i = 0; i < shardCount_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        misses += shards_[i].misses;
+    }
+    return misses;
+}
+
+qsizetype GreetingCache::size() const {
+    qsizetype size = 0;
+    for (int i = 0; i < shardCount_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        size += static_cast<qsizetype>(shards_[i].entries.size());
+    }
+    return size;
+}
+
+void GreetingCache::clear() {
+    for (int i = 0; i < shardCount_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        shards_[i].entries.clear();
+        shards_[i].index.clear();
+        shards_[i].bytes = 0;
+    }
+}
+
+size_t GreetingCache::entryBytes(const QString &trimmed, const QString &greeting) {
+    // The index's key shares the name's text.
+    constexpr size_t kNodes = sizeof(Entries::value_type) + 2 * sizeof(void *) +
+                              sizeof(QString) + sizeof(Entries::iterator) + sizeof(void *);
+    return kNodes + static_cast<size_t>(trimmed.size() + greeting.size()) * sizeof(QChar);
+}
+
+size_t GreetingCache::byteSize() const {
+    size_t bytes = 0;
+    for (int i = 0; i < shardCount_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        bytes += shards_[i].bytes;
+    }
+    return bytes;
+}
+
+size_t GreetingCache::evict(size_t bytes) {
+    size_t freed = 0;
+    for (bool dropped = true; dropped && freed < bytes;) {
+        dropped = false;
+        for (int i = 0; i < shardCount_ && freed < bytes; ++i) {
+            Shard &shard = shards_[i];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.entries.empty()) {
+                continue;
+            }
+            const size_t entry = entryBytes(shard.entries.back().first, shard.entries.back().second);
+            shard.index.remove(shard.entries.back().first);
+            shard.entries.pop_back();
+            shard.bytes -= entry;
+            freed += entry;
+            dropped = true;
+        }
+    }
+    return freed;
+}
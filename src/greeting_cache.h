@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QtGlobal>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// Greetings by trimmed name, keeping the most recently used. Entries are
+// spread by hash over up to kShards shards, each an LRU list with its own
+// lock and an equal share of the capacity, so threads greeting different
+// names rarely wait on each other. A hit returns the stored QString, which
+// shares its data rather than copying it. Thread-safe.
+class GreetingCache {
+public:
+    static constexpr int kShards = 16;
+
+    // capacity is at least 1.
+    explicit GreetingCache(qsizetype capacity);
+
+    qsizetype capacity() const { return capacity_; }
+
+    // Sets greeting to the one cached for trimmed and makes it the most
+    // recent; false, counted as a miss, when there is none.
+    bool find(const QString &trimmed, QString &greeting);
+    // Caches greeting for trimmed, dropping the shard's least recently used
+    // entry if it is full. Replaces an entry another thread added since
+    // find() missed.
+    void insert(const QString &trimmed, const QString &greeting);
+
+    quint64 hits() const;
+    quint64 misses() const;
+    qsizetype size() const;
+    void clear();
+
+    // Bytes the entries hold: list and index nodes and the text of names
+    // and greetings.
+    size_t byteSize() const;
+    // Drops least recently used entries, a shard at a time in turn, until
+    // at least bytes are freed or the cache is empty. Returns the bytes
+    // freed. For a QmlCacheBudget.
+    size_t evict(size_t bytes);
+
+private:
+    using Entries = std::list<std::pair<QString, QString>>;  // most recent first
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        Entries entries;
+        QHash<QString, Entries::iterator> index;
+        quint64 hits = 0;
+        quint64 misses = 0;
+        size_t bytes = 0;
+    };
+
+    Shard &shardFor(const QString &trimmed) const;
+    static size_t entryBytes(const QString &trimmed, const QString &greeting);
+
+    qsizetype capacity_;
+    int shardCount_;
+    qsizetype perShard_;
+    std::unique_ptr<Shard[]> shards_;
+};
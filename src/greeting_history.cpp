@@ -0,0 +1,86 @@
+#include "greeting_history.h"
+
+#include <algorithm>
+
+GreetingHistory::GreetingHistory(QObject *parent) : QAbstractListModel(parent) {}
+
+int GreetingHistory::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : loaded_;
+}
+
+QVariant GreetingHistory::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= loaded_ || (role != GreetingRole && role != Qt::DisplayRole)) {
+        return QVariant();
+    }
+    return at(index.row());
+}
+
+QHash<int, QByteArray> GreetingHistory::roleNames() const {
+    // Views ask for these once per model; build them once per process.
+    static const QHash<int, QByteArray> names{{GreetingRole, QByteArrayLiteral("greeting")},
+                                              {Qt::DisplayRole, QByteArrayLiteral("display")}};
+    return names;
+}
+
+bool GreetingHistory::canFetchMore(const QModelIndex &parent) const {
+    return !parent.isValid() && loaded_ < size_;
+}
+
+void GreetingHistory::fetchMore(const QModelIndex &parent) {
+    if (!parent.isValid()) {
+        announce(kPageRows);
+    }
+}
+
+void GreetingHistory::store(const QString &greeting) {
+    if (!flushPending_) {
+        flushPending_ = true;
+        batchStart_ = size_;
+    }
+    if (size_ % kChunkRows == 0) {
+        chunks_.push_back(std::make_unique<QString[]>(kChunkRows));
+    }
+    chunks_.back()[size_ % kChunkRows] = greeting;
+    ++size_;
+}
+
+void GreetingHistory::append(const QString &greeting) {
+    const bool scheduled = flushPending_;
+    store(greeting);
+    emit countChanged();
+    if (!scheduled) {
+        QMetaObject::invokeMethod(this, &GreetingHistory::flush, Qt::QueuedConnection);
+    }
+}
+
+void GreetingHistory::append(const QStringList &greetings) {
+    if (greetings.isEmpty()) {
+        return;
+    }
+    for (const QString &greeting : greetings) {
+        store(greeting);
+    }
+    emit countChanged();
+    flush();
+}
+
+void GreetingHistory::flush() {
+    if (!flushPending_) {
+        return;
+    }
+    flushPending_ = false;
+    // Views that had not scrolled to the end fetch the rest when they do.
+    if (loaded_ == batchStart_) {
+        announce(kPageRows);
+    }
+}
+
+void GreetingHistory::announce(int rows) {
+    const int count = std::min(rows, size_ - loaded_);
+    if (count <= 0) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), loaded_, loaded_ + count - 1);
+    loaded_ += count;
+    endInsertRows();
+}
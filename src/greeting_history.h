@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QtQml/qqmlregistration.h>
+#include <memory>
+#include <vector>
+
+// Every greeting so far, oldest first, for a ListView. Rows live in
+// fixed-size chunks that never move, so an append is O(1) amortized however
+// long the history grows. Views see it a page at a time: rowCount() is the
+// rows announced so far, and canFetchMore()/fetchMore() announce the next
+// page as a view scrolls towards the end. Appends made in one event-loop
+// turn reach views as a single rowsInserted, and only if the views were
+// already at the end; otherwise they wait for fetchMore().
+class GreetingHistory : public QAbstractListModel {
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("GreetingHistory is owned by Greeter")
+    // Greetings stored, announced to views or not.
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum Role { GreetingRole = Qt::UserRole + 1 };
+    static constexpr int kChunkRows = 1024;
+    static constexpr int kPageRows = 256;
+
+    explicit GreetingHistory(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    int count() const { return size_; }
+    const QString &at(int row) const { return chunks_[row / kChunkRows][row % kChunkRows]; }
+
+    void append(const QString &greeting);
+    // Stores every greeting and announces them in one batch.
+    void append(const QStringList &greetings);
+    // Announces the appends so far now rather than on the next event-loop
+    // turn.
+    void flush();
+
+signals:
+    void countChanged();
+
+private:
+    void store(const QString &greeting);
+    void announce(int rows);
+
+    std::vector<std::unique_ptr<QString[]>> chunks_;
+    int size_ = 0;
+    int loaded_ = 0;  // rows views know about
+    int batchStart_ = 0;  // size_ when the unflushed appends began
+    bool flushPending_ = false;
+};
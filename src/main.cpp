@@ -1,32 +1,273 @@
+#include <QCommandLineParser>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQuickWindow>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QtQml/qqmlextensionplugin.h>
+#include <memory>
+#include <utility>
 
+#include "binding_profiler.h"
+#include "frame_incubator.h"
+#include "frame_timing.h"
+#include "glyph_prewarmer.h"
 #include "greeter.h"
+#include "memory_pressure.h"
+#include "metrics_endpoint.h"
+#include "pipeline_cache.h"
+#include "qml_executor.h"
+#include "single_instance.h"
+#include "startup_timing.h"
+#include "window_keeper.h"
+
+// Main.qml lives in the Sample module, compiled ahead of time at build time.
+Q_IMPORT_QML_PLUGIN(SamplePlugin)
 
 int main(int argc, char *argv[]) {
+    StartupTiming timing;
     QGuiApplication app(argc, argv);
+    app.setApplicationVersion(QStringLiteral(SAMPLE_APP_VERSION));
+    timing.mark("app");
+
+    QCommandLineParser options;
+    options.setApplicationDescription(QStringLiteral("Qt 6 QML + C++ sample."));
+    options.addHelpOption();
+    const QCommandLineOption startupTimingOption(
+        QStringLiteral("startup-timing"),
+        QStringLiteral("Write startup phase timestamps as JSON to file (- for stdout) after the first frame."),
+        QStringLiteral("file"));
+    const QCommandLineOption quitAfterStartupOption(QStringLiteral("quit-after-startup"),
+                                                    QStringLiteral("Exit once the first frame is shown."));
+    const QCommandLineOption pipelineCacheDirOption(
+        QStringLiteral("pipeline-cache-dir"),
+        QStringLiteral("Directory for the graphics pipeline cache (default: the user cache directory)."),
+        QStringLiteral("dir"));
+    const QCommandLineOption noPipelineCacheOption(QStringLiteral("no-pipeline-cache"),
+                                                   QStringLiteral("Build every graphics pipeline from scratch."));
+    const QCommandLineOption metricsOption(
+        QStringLiteral("metrics"),
+        QStringLiteral("Serve OpenMetrics counters at http://[ADDRESS:]PORT/metrics (localhost by default)."),
+        QStringLiteral("[address:]port"));
+    const QCommandLineOption greetingCacheOption(
+        QStringLiteral("greeting-cache"),
+        QStringLiteral("Remember the greetings of up to this many recently greeted names (default: off)."),
+        QStringLiteral("names"));
+    const QCommandLineOption cacheBudgetOption(
+        QStringLiteral("cache-budget"),
+        QStringLiteral("Keep the in-memory caches within this many MiB (default: no limit; OS memory pressure still "
+                       "trims them)."),
+        QStringLiteral("MiB"));
+    options.addOption(startupTimingOption);
+    options.addOption(quitAfterStartupOption);
+    options.addOption(pipelineCacheDirOption);
+    options.addOption(noPipelineCacheOption);
+    options.addOption(metricsOption);
+    options.addOption(greetingCacheOption);
+    const QCommandLineOption prewarmGlyphsOption(
+        QStringLiteral("prewarm-glyphs"),
+        QStringLiteral("Rasterize the glyphs of the window's text on a worker thread while the engine loads."));
+    const QCommandLineOption threadsOption(
+        QStringLiteral("threads"),
+        QStringLiteral("Worker threads for greetings and prewarming (default: one fewer than the hardware threads)."),
+        QStringLiteral("count"), QStringLiteral("0"));
+    const QCommandLineOption cpusOption(QStringLiteral("cpus"),
+                                        QStringLiteral("Pin the worker threads to these CPUs, such as 0-3,6."),
+                                        QStringLiteral("list"));
+    const QCommandLineOption singleInstanceOption(
+        QStringLiteral("single-instance"),
+        QStringLiteral("Hand the launch to a running sample_app, or keep running with the window ready for later "
+                       "launches."));
+    const QCommandLineOption residentOption(
+        QStringLiteral("resident"),
+        QStringLiteral("With --single-instance, start with the window hidden but ready, e.g. at login."));
+    const QCommandLineOption quitResidentOption(QStringLiteral("quit-resident"),
+                                                QStringLiteral("Stop the running single-instance sample_app."));
+    const QCommandLineOption profileBindingsOption(
+        QStringLiteral("profile-bindings"),
+        QStringLiteral("Count how often each QML object's properties change, and write the counts as JSON to file (- "
+                       "for stdout) on exit."),
+        QStringLiteral("file"));
+    options.addOption(cacheBudgetOption);
+    options.addOption(prewarmGlyphsOption);
+    options.addOption(singleInstanceOption);
+    options.addOption(residentOption);
+    options.addOption(quitResidentOption);
+    options.addOption(profileBindingsOption);
+    options.addOption(threadsOption);
+    options.addOption(cpusOption);
+    options.process(app);
+    QmlExecutor::Options executorOptions;
+    bool threadsValid = false;
+    executorOptions.threads = options.value(threadsOption).toUInt(&threadsValid);
+    if (!threadsValid ||
+        (options.isSet(cpusOption) &&
+         !QmlExecutor::parseCpuList(options.value(cpusOption).toStdString(), executorOptions.cpus))) {
+        qCritical("Expected --threads <count> and --cpus <list>, such as 0-3,6");
+        return 1;
+    }
+    QmlExecutor::configure(std::move(executorOptions));
+    timing.setOutput(options.value(startupTimingOption));
+    timing.setQuitAfterStartup(options.isSet(quitAfterStartupOption));
+
+    // A launch with a resident instance only hands over its arguments.
+    SingleInstance instance;
+    const bool singleInstance = options.isSet(singleInstanceOption) || options.isSet(quitResidentOption);
+    if (singleInstance && instance.forward(app.arguments())) {
+        return 0;
+    }
+    if (options.isSet(quitResidentOption)) {
+        return 0;  // none running
+    }
 
+    // Main.qml's fonts: the default one, and greetingText's. Greetings and
+    // typed names are mostly ASCII.
+    GlyphPrewarmer prewarmer;
+    if (options.isSet(prewarmGlyphsOption)) {
+        QFont greetingFont = QGuiApplication::font();
+        greetingFont.setPixelSize(20);
+        prewarmer.addFont(QGuiApplication::font());
+        prewarmer.addFont(greetingFont);
+        prewarmer.addText(QStringLiteral("Qt 6 QML + C++ sample"));
+        prewarmer.addText(QStringLiteral("Type your name"));
+        prewarmer.addText(QStringLiteral("Say hello"));
+        for (char ch = ' '; ch <= '~'; ++ch) {
+            prewarmer.addText(QString(QLatin1Char(ch)));
+        }
+        prewarmer.start([&timing](int glyphs) { timing.glyphsPrewarmed(glyphs); });
+    }
+
+    // Outlives the engine, and so the window whose render thread records
+    // into it.
+    FrameTiming frames;
+    // Also outlives the engine, whose objects it forgets as they go.
+    std::unique_ptr<BindingProfiler> bindingProfiler;
+    if (options.isSet(profileBindingsOption)) {
+        bindingProfiler = std::make_unique<BindingProfiler>();
+    }
     QQmlApplicationEngine engine;
-    Greeter greeter;
-    engine.rootContext()->setContextProperty("greeter", &greeter);
+    timing.mark("engine");
+    // Asynchronous Loaders (LazyPanel) incubate within 4 ms of each frame.
+    FrameIncubator incubator;
+    engine.setIncubationController(&incubator);
+    // Only created this early when it has something to set up.
+    Greeter *greeter = nullptr;
+    if (options.isSet(greetingCacheOption)) {
+        greeter = engine.singletonInstance<Greeter *>("Sample", "Greeter");
+        greeter->setCacheCapacity(options.value(greetingCacheOption).toLongLong());
+    }
+    QmlCacheBudget cacheBudget(static_cast<size_t>(options.value(cacheBudgetOption).toULongLong()) << 20);
+    if (greeter != nullptr) {
+        cacheBudget.attach(
+            "greetings", 1.0, [greeter] { return greeter->cache() ? greeter->cache()->byteSize() : 0; },
+            [greeter](size_t bytes) { return greeter->cache() ? greeter->cache()->evict(bytes) : 0; });
+    }
+    // Secondary windows keep their scene graphs while hidden, within the
+    // cache budget.
+    WindowKeeper windowKeeper(&cacheBudget);
+    MemoryPressureWatcher memoryPressure([&cacheBudget](QmlCacheBudget::Pressure pressure) {
+        const size_t freed = cacheBudget.relieve(pressure);
+        qInfo("Memory pressure: freed %zu cache bytes", freed);
+    });
+    QTimer cacheBudgetTimer;
+    if (cacheBudget.limit() > 0) {
+        QObject::connect(&cacheBudgetTimer, &QTimer::timeout, &app, [&cacheBudget] { cacheBudget.enforce(); });
+        cacheBudgetTimer.start(1000);
+    }
+#ifdef SAMPLE_GREETER_CONTEXT_PROPERTY
+    // For QML written against the old untyped "greeter" context property.
+    engine.rootContext()->setContextProperty(QStringLiteral("greeter"),
+                                             engine.singletonInstance<Greeter *>("Sample", "Greeter"));
+#endif
 
-    const QUrl mainUrl(QStringLiteral("qrc:/qml/Main.qml"));
     QObject::connect(
         &engine,
-        &QQmlApplicationEngine::objectCreated,
+        &QQmlApplicationEngine::objectCreationFailed,
         &app,
-        [mainUrl](QObject *obj, const QUrl &objUrl) {
-            if (!obj && objUrl == mainUrl) {
-                QCoreApplication::exit(-1);
-            }
-        },
+        []() { QCoreApplication::exit(-1); },
         Qt::QueuedConnection);
+    timing.watch(engine);
+    QObject::connect(&engine, &QQmlApplicationEngine::objectCreated, &incubator,
+                     [&incubator, &frames, &bindingProfiler](QObject *object, const QUrl &) {
+                         if (auto *window = qobject_cast<QQuickWindow *>(object)) {
+                             incubator.attach(window);
+                             frames.attach(window);
+                             if (bindingProfiler) {
+                                 bindingProfiler->attach(window);
+                             }
+                         }
+                     });
+
+    std::unique_ptr<MetricsEndpoint> metrics;
+    if (options.isSet(metricsOption)) {
+        metrics = std::make_unique<MetricsEndpoint>([&](QmlMetricsText &text) {
+            timing.appendMetrics(text);
+            text.family("qml_frame_seconds", QmlMetricsText::Type::Histogram,
+                        "Time the scene graph took to render a frame.", "seconds");
+            text.histogram(frames.frameTimes());
+            text.family("qml_incubation_frames", QmlMetricsText::Type::Counter,
+                        "Frames that incubated asynchronously loaded QML.");
+            text.counter(incubator.framesUsed());
+            if (const GreetingCache *cache = greeter ? greeter->cache() : nullptr) {
+                text.family("greeter_cache_hits", QmlMetricsText::Type::Counter, "Greetings served from the cache.");
+                text.counter(static_cast<double>(cache->hits()));
+                text.family("greeter_cache_misses", QmlMetricsText::Type::Counter, "Greetings built and cached.");
+                text.counter(static_cast<double>(cache->misses()));
+            }
+            cacheBudget.appendMetrics(text);
+        });
+        if (!metrics->listen(options.value(metricsOption))) {
+            qCritical("Could not serve metrics on %s: %s", qPrintable(options.value(metricsOption)),
+                      qPrintable(metrics->errorString()));
+            return -1;
+        }
+    }
 
-    engine.load(mainUrl);
+    if (!options.isSet(noPipelineCacheOption)) {
+        const QString cacheDir = options.isSet(pipelineCacheDirOption)
+                                     ? options.value(pipelineCacheDirOption)
+                                     : QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+                                           QStringLiteral("/pipelines");
+        // The window is shown during creation but not exposed until the
+        // event loop runs, so this is early enough.
+        QObject::connect(&engine, &QQmlApplicationEngine::objectCreated, &app,
+                         [path = pipelineCacheFile(cacheDir)](QObject *object, const QUrl &) {
+                             if (auto *window = qobject_cast<QQuickWindow *>(object)) {
+                                 usePipelineCache(*window, path);
+                             }
+                         });
+    }
+
+    engine.loadFromModule("Sample", "Main");
+    timing.mark("load");
     if (engine.rootObjects().isEmpty()) {
         return -1;
     }
+    windowKeeper.keepChildren(engine.rootObjects().constFirst());
 
-    return app.exec();
+    if (auto *window = qobject_cast<QQuickWindow *>(engine.rootObjects().constFirst()); window && singleInstance) {
+        // Closing the window hides it; its scene graph is kept for the
+        // next launch, which then takes one frame.
+        app.setQuitOnLastWindowClosed(false);
+        windowKeeper.keep(window);
+        auto *resident = new ResidentWindow(window);
+        if (options.isSet(residentOption)) {
+            window->hide();  // shown during creation, not yet exposed
+            resident->warm();
+        }
+        instance.listen([&app, resident](const QStringList &arguments) {
+            if (arguments.contains(QStringLiteral("--quit-resident"))) {
+                app.quit();
+            } else {
+                resident->present();
+            }
+        });
+    }
+
+    const int status = app.exec();
+    if (bindingProfiler && !bindingProfiler->write(options.value(profileBindingsOption))) {
+        qCritical("Could not write binding counts to %s", qPrintable(options.value(profileBindingsOption)));
+    }
+    return status;
 }
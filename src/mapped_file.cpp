@@ -0,0 +1,202 @@
+#include "mapped_file.h"
+
+#include <atomic>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<const MappedFileProvider *> fileProvider{nullptr};
+
+// The provider, if there is one and it handles path.
+const MappedFileProvider *providerFor(const std::string &path) {
+    const MappedFileProvider *provider = fileProvider.load(std::memory_order_acquire);
+    return provider && provider->handles(path) ? provider : nullptr;
+}
+
+} // namespace
+
+void MappedFile::setProvider(const MappedFileProvider *provider) {
+    fileProvider.store(provider, std::memory_order_release);
+}
+
+const MappedFileProvider *MappedFile::provider() {
+    return fileProvider.load(std::memory_order_acquire);
+}
+
+bool MappedFile::exists(const std::string &path) {
+    if (const MappedFileProvider *provider = providerFor(path)) {
+        return provider->exists(path);
+    }
+    std::error_code error;
+    return std::filesystem::is_regular_file(path, error);
+}
+
+bool MappedFile::openProvided(const MappedFileProvider &provider, const std::string &path) {
+    std::string_view view;
+    if (!provider.read(path, view, storage_)) {
+        storage_.clear();
+        return false;
+    }
+    if (view.empty()) {
+        view = storage_;
+    }
+    data_ = view.data();
+    size_ = view.size();
+    open_ = true;
+    return true;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        // Copied bytes move with the string; a small one's address changes.
+        const bool copied = !other.storage_.empty() && other.data_ == other.storage_.data();
+        storage_ = std::move(other.storage_);
+        other.storage_.clear();
+        data_ = copied ? storage_.data() : other.data_;
+        other.data_ = nullptr;
+        size_ = std::exchange(other.size_, 0);
+        open_ = std::exchange(other.open_, false);
+        mapped_ = std::exchange(other.mapped_, false);
+#ifdef _WIN32
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path) {
+    close();
+    if (const MappedFileProvider *provider = providerFor(path)) {
+        return openProvided(*provider, path);
+    }
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    if (fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        open_ = true;
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    mapping_ = mapping;
+    data_ = static_cast<const char *>(view);
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+    open_ = true;
+    mapped_ = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapped_ && data_) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+        CloseHandle(mapping_);
+    }
+    mapping_ = nullptr;
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+    mapped_ = false;
+    storage_.clear();
+}
+
+#else
+
+bool MappedFile::open(const std::string &path) {
+    close();
+    if (const MappedFileProvider *provider = providerFor(path)) {
+        return openProvided(*provider, path);
+    }
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    if (info.st_size == 0) {
+        ::close(fd);
+        open_ = true;
+        return true;
+    }
+
+    void *view = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    // The parser reads front to back exactly once.
+    ::madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+    data_ = static_cast<const char *>(view);
+    size_ = static_cast<size_t>(info.st_size);
+    open_ = true;
+    mapped_ = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapped_ && data_) {
+        ::munmap(const_cast<char *>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+    mapped_ = false;
+    storage_.clear();
+}
+
+#endif
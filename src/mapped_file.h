@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Supplies the bytes of paths that are not files, such as Qt resources.
+// See MappedFile::setProvider().
+class MappedFileProvider {
+public:
+    virtual ~MappedFileProvider() = default;
+
+    // Whether path names one of this provider's entries, from the name
+    // alone; such paths never reach the filesystem.
+    virtual bool handles(std::string_view path) const = 0;
+    virtual bool exists(const std::string &path) const = 0;
+    // Bytes that live as long as the process, such as resource data
+    // compiled into the binary, are returned in view without copying; any
+    // others are written to storage. Returns false if there is no entry.
+    virtual bool read(const std::string &path, std::string_view &view, std::string &storage) const = 0;
+};
+
+// Read-only memory mapping of a whole file. Uses mmap on POSIX and
+// MapViewOfFile on Windows; the mapped bytes stay valid until the object is
+// closed or destroyed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // Returns false if the file cannot be opened or mapped. Empty files open
+    // successfully and yield an empty view.
+    bool open(const std::string &path);
+    void close();
+
+    // Paths the provider handles are opened through it instead of mapped,
+    // so everything that reads through MappedFile, QmlParser::parseFile()
+    // included, takes them. Process-wide; null removes it. The provider is
+    // not owned and must outlive every open() call.
+    static void setProvider(const MappedFileProvider *provider);
+    static const MappedFileProvider *provider();
+    // A regular file, or an entry of the provider.
+    static bool exists(const std::string &path);
+
+    bool isOpen() const { return open_; }
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    bool openProvided(const MappedFileProvider &provider, const std::string &path);
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+    bool mapped_ = false;  // data_ is a view this object unmaps
+    std::string storage_;  // provided bytes that had to be copied
+#ifdef _WIN32
+    void *mapping_ = nullptr;
+#endif
+};
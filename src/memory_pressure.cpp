@@ -0,0 +1,170 @@
+#include "memory_pressure.h"
+
+#include <QtGlobal>
+#include <utility>
+
+#if defined(Q_OS_WIN)
+#include <QTimer>
+#include <QWinEventNotifier>
+#include <windows.h>
+#elif defined(Q_OS_MACOS)
+#include <dispatch/dispatch.h>
+#else
+#include <QSocketNotifier>
+#include <cstring>
+#include <vector>
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#endif
+
+#if defined(Q_OS_WIN)
+
+struct MemoryPressureWatcher::Sources {
+    HANDLE lowMemory = nullptr;
+    std::unique_ptr<QWinEventNotifier> notifier;
+};
+
+MemoryPressureWatcher::MemoryPressureWatcher(Notify notify)
+    : notify_(std::move(notify)), sources_(std::make_unique<Sources>()) {
+    sources_->lowMemory = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+    if (sources_->lowMemory == nullptr) {
+        return;
+    }
+    sources_->notifier = std::make_unique<QWinEventNotifier>(sources_->lowMemory);
+    QWinEventNotifier *notifier = sources_->notifier.get();
+    // The handle stays signalled while memory is low, so the notifier is
+    // rested between reports.
+    QObject::connect(notifier, &QWinEventNotifier::activated, notifier, [this, notifier] {
+        notifier->setEnabled(false);
+        QTimer::singleShot(5000, notifier, [notifier] { notifier->setEnabled(true); });
+        notify_(QmlCacheBudget::Pressure::Moderate);
+    });
+}
+
+MemoryPressureWatcher::~MemoryPressureWatcher() {
+    sources_->notifier.reset();
+    if (sources_->lowMemory != nullptr) {
+        CloseHandle(sources_->lowMemory);
+    }
+}
+
+bool MemoryPressureWatcher::available() const {
+    return sources_->notifier != nullptr;
+}
+
+#elif defined(Q_OS_MACOS)
+
+namespace {
+
+// The dispatch source's context.
+struct PressureSource {
+    dispatch_source_t source = nullptr;
+    const MemoryPressureWatcher::Notify *notify = nullptr;
+};
+
+void pressureEvent(void *context) {
+    const auto *pressure = static_cast<const PressureSource *>(context);
+    const unsigned long level = dispatch_source_get_data(pressure->source);
+    if (level & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+        (*pressure->notify)(QmlCacheBudget::Pressure::Critical);
+    } else if (level & DISPATCH_MEMORYPRESSURE_WARN) {
+        (*pressure->notify)(QmlCacheBudget::Pressure::Moderate);
+    }
+}
+
+}  // namespace
+
+struct MemoryPressureWatcher::Sources : PressureSource {};
+
+MemoryPressureWatcher::MemoryPressureWatcher(Notify notify)
+    : notify_(std::move(notify)), sources_(std::make_unique<Sources>()) {
+    // The main queue is served by the main thread's run loop, which Qt's
+    // event loop runs.
+    sources_->source = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                              DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                              dispatch_get_main_queue());
+    if (sources_->source == nullptr) {
+        return;
+    }
+    sources_->notify = &notify_;
+    dispatch_set_context(sources_->source, static_cast<PressureSource *>(sources_.get()));
+    dispatch_source_set_event_handler_f(sources_->source, pressureEvent);
+    dispatch_resume(sources_->source);
+}
+
+MemoryPressureWatcher::~MemoryPressureWatcher() {
+    if (sources_->source != nullptr) {
+        dispatch_source_cancel(sources_->source);
+        dispatch_release(sources_->source);
+    }
+}
+
+bool MemoryPressureWatcher::available() const {
+    return sources_->source != nullptr;
+}
+
+#else
+
+struct MemoryPressureWatcher::Sources {
+    std::vector<int> fds;
+    std::vector<std::unique_ptr<QSocketNotifier>> notifiers;
+};
+
+namespace {
+
+#if defined(Q_OS_LINUX)
+// A PSI trigger: the kernel marks the file urgent (POLLPRI) whenever the
+// stall it describes happens. Unprivileged processes need a window that is
+// a multiple of 2 s.
+int openTrigger(const char *trigger) {
+    const int fd = ::open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::write(fd, trigger, std::strlen(trigger) + 1) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+#endif
+
+}  // namespace
+
+MemoryPressureWatcher::MemoryPressureWatcher(Notify notify)
+    : notify_(std::move(notify)), sources_(std::make_unique<Sources>()) {
+#if defined(Q_OS_LINUX)
+    const std::pair<const char *, QmlCacheBudget::Pressure> triggers[] = {
+        {"some 200000 2000000", QmlCacheBudget::Pressure::Moderate},
+        {"full 200000 2000000", QmlCacheBudget::Pressure::Critical},
+    };
+    for (const auto &trigger : triggers) {
+        const int fd = openTrigger(trigger.first);
+        if (fd < 0) {
+            continue;
+        }
+        sources_->fds.push_back(fd);
+        auto notifier = std::make_unique<QSocketNotifier>(fd, QSocketNotifier::Exception);
+        QObject::connect(notifier.get(), &QSocketNotifier::activated, notifier.get(),
+                         [this, pressure = trigger.second] { notify_(pressure); });
+        sources_->notifiers.push_back(std::move(notifier));
+    }
+#endif
+}
+
+MemoryPressureWatcher::~MemoryPressureWatcher() {
+    sources_->notifiers.clear();
+#if defined(Q_OS_LINUX)
+    for (const int fd : sources_->fds) {
+        ::close(fd);
+    }
+#endif
+}
+
+bool MemoryPressureWatcher::available() const {
+    return !sources_->notifiers.empty();
+}
+
+#endif
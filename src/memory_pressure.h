@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "qml_cache_budget.h"
+
+// Passes on the OS's memory-pressure notifications: PSI triggers on
+// /proc/pressure/memory on Linux (moderate when some tasks, critical when
+// all of them, stall on memory for 200 ms within 2 s), a dispatch source on
+// macOS and the low-memory resource notification on Windows, reported as
+// moderate and at most every 5 s while it lasts. Notifications are
+// delivered from the event loop of the thread the watcher was made on.
+// Where the OS offers none, as in containers that hide PSI, available() is
+// false and notify is never called.
+class MemoryPressureWatcher {
+public:
+    using Notify = std::function<void(QmlCacheBudget::Pressure pressure)>;
+
+    explicit MemoryPressureWatcher(Notify notify);
+    ~MemoryPressureWatcher();
+    MemoryPressureWatcher(const MemoryPressureWatcher &) = delete;
+    MemoryPressureWatcher &operator=(const MemoryPressureWatcher &) = delete;
+
+    bool available() const;
+
+private:
+    struct Sources;  // per platform
+
+    Notify notify_;
+    std::unique_ptr<Sources> sources_;
+};
@@ -0,0 +1,134 @@
+#include "metrics_endpoint.h"
+
+#include <QFile>
+#include <QTcpSocket>
+#include <algorithm>
+#include <utility>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_MACOS)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// Longest request head read before the connection is dropped.
+constexpr qint64 kMaxRequestBytes = 8192;
+
+void respond(QTcpSocket *socket, const char *status, const char *contentType, const QByteArray &body) {
+    QByteArray head("HTTP/1.1 ");
+    head.append(status).append("\r\nContent-Type: ").append(contentType);
+    head.append("\r\nContent-Length: ").append(QByteArray::number(body.size()));
+    head.append("\r\nConnection: close\r\n\r\n");
+    socket->write(head);
+    socket->write(body);
+    socket->disconnectFromHost();
+}
+
+}  // namespace
+
+void residentMemory(qint64 &currentKiB, qint64 &peakKiB) {
+    currentKiB = -1;
+    peakKiB = -1;
+#if defined(Q_OS_LINUX)
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return;
+    }
+    for (QByteArray line = status.readLine(); !line.isEmpty(); line = status.readLine()) {
+        if (line.startsWith("VmRSS:")) {
+            currentKiB = line.mid(6).trimmed().split(' ').first().toLongLong();
+        } else if (line.startsWith("VmHWM:")) {
+            peakKiB = line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        currentKiB = static_cast<qint64>(counters.WorkingSetSize / 1024);
+        peakKiB = static_cast<qint64>(counters.PeakWorkingSetSize / 1024);
+    }
+#elif defined(Q_OS_MACOS)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) ==
+        KERN_SUCCESS) {
+        currentKiB = static_cast<qint64>(info.resident_size / 1024);
+    }
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        peakKiB = static_cast<qint64>(usage.ru_maxrss / 1024);  // bytes on macOS
+    }
+#endif
+}
+
+MetricsEndpoint::MetricsEndpoint(Collect collect) : collect_(std::move(collect)) {
+    QObject::connect(&server_, &QTcpServer::newConnection, [this] {
+        while (QTcpSocket *socket = server_.nextPendingConnection()) {
+            QObject::connect(socket, &QTcpSocket::readyRead, [this, socket] { read(socket); });
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    });
+}
+
+bool MetricsEndpoint::listen(quint16 port, const QHostAddress &address) {
+    return server_.listen(address, port);
+}
+
+bool MetricsEndpoint::listen(const QString &endpoint) {
+    const int colon = endpoint.lastIndexOf(QLatin1Char(':'));
+    QHostAddress address(QHostAddress::LocalHost);
+    bool portOk = false;
+    const quint16 port = endpoint.mid(colon + 1).toUShort(&portOk);
+    QString host = endpoint.left(std::max(colon, 0));
+    if (host.startsWith(QLatin1Char('[')) && host.endsWith(QLatin1Char(']'))) {
+        host = host.mid(1, host.size() - 2);  // [::1]:9100
+    }
+    if (!portOk || (colon >= 0 && !address.setAddress(host))) {
+        error_ = QStringLiteral("expected [ADDRESS:]PORT");
+        return false;
+    }
+    error_.clear();
+    return listen(port, address);
+}
+
+void MetricsEndpoint::read(QTcpSocket *socket) {
+    const QByteArray head = socket->peek(kMaxRequestBytes);
+    if (!head.contains("\r\n\r\n")) {
+        if (head.size() >= kMaxRequestBytes) {
+            socket->abort();
+        }
+        return;  // the rest of the request is still on its way
+    }
+    QObject::disconnect(socket, &QTcpSocket::readyRead, nullptr, nullptr);
+    socket->readAll();
+    if (!head.startsWith("GET /metrics ") && !head.startsWith("GET /metrics?")) {
+        respond(socket, "404 Not Found", "text/plain; charset=utf-8", "Not found; try /metrics\n");
+        return;
+    }
+    ++scrapes_;
+    text_.clear();
+    qint64 residentKiB;
+    qint64 peakResidentKiB;
+    residentMemory(residentKiB, peakResidentKiB);
+    if (residentKiB >= 0) {
+        text_.family("process_resident_memory_bytes", QmlMetricsText::Type::Gauge, "Resident memory size.", "bytes");
+        text_.gauge(static_cast<double>(residentKiB) * 1024);
+    }
+    if (peakResidentKiB >= 0) {
+        text_.family("process_peak_resident_memory_bytes", QmlMetricsText::Type::Gauge,
+                     "Largest resident memory size so far.", "bytes");
+        text_.gauge(static_cast<double>(peakResidentKiB) * 1024);
+    }
+    text_.family("qml_metrics_scrapes", QmlMetricsText::Type::Counter, "Scrapes of this endpoint.");
+    text_.counter(static_cast<double>(scrapes_));
+    if (collect_) {
+        collect_(text_);
+    }
+    const std::string &text = text_.finish();
+    respond(socket, "200 OK", "application/openmetrics-text; version=1.0.0; charset=utf-8",
+            QByteArray(text.data(), static_cast<qsizetype>(text.size())));
+}
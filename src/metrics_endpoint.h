@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QHostAddress>
+#include <QTcpServer>
+#include <cstdint>
+#include <functional>
+
+#include "qml_metrics.h"
+
+class QTcpSocket;
+
+// Current and peak resident set size in KiB; -1 where the platform does
+// not say.
+void residentMemory(qint64 &currentKiB, qint64 &peakKiB);
+
+// Serves runtime counters over HTTP for Prometheus to scrape. GET /metrics
+// answers with collect's families in the OpenMetrics text format, after
+// the process's own: resident memory and the scrapes served. Any other
+// request gets a 404. Requests are answered from the event loop, one per
+// connection, so collect runs on the thread the endpoint lives in and can
+// read that thread's stats as they are. It listens on localhost unless
+// given another address.
+class MetricsEndpoint {
+public:
+    using Collect = std::function<void(QmlMetricsText &text)>;
+
+    explicit MetricsEndpoint(Collect collect);
+
+    bool listen(quint16 port, const QHostAddress &address = QHostAddress(QHostAddress::LocalHost));
+    // Listens on "[ADDRESS:]PORT", as given on a command line.
+    bool listen(const QString &endpoint);
+    quint16 port() const { return server_.serverPort(); }
+    QHostAddress address() const { return server_.serverAddress(); }
+    QString errorString() const { return error_.isEmpty() ? server_.errorString() : error_; }
+    uint64_t scrapes() const { return scrapes_; }
+
+private:
+    void read(QTcpSocket *socket);
+
+    Collect collect_;
+    QTcpServer server_;
+    QString error_;        // of a malformed endpoint
+    QmlMetricsText text_;  // kept to reuse its capacity
+    uint64_t scrapes_ = 0;
+};
@@ -0,0 +1,55 @@
+#include "pipeline_cache.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QQuickGraphicsConfiguration>
+#include <QQuickWindow>
+
+namespace {
+
+const char *apiName(QSGRendererInterface::GraphicsApi api) {
+    switch (api) {
+    case QSGRendererInterface::OpenGL:
+        return "opengl";
+    case QSGRendererInterface::Vulkan:
+        return "vulkan";
+    case QSGRendererInterface::Direct3D11:
+        return "d3d11";
+    case QSGRendererInterface::Metal:
+        return "metal";
+    case QSGRendererInterface::Null:
+        return "null";
+    default:
+        return "default";
+    }
+}
+
+}  // namespace
+
+QString pipelineCacheFile(const QString &dir) {
+    return QDir(dir).filePath(QStringLiteral("pipelines-%1-qt%2-%3.bin")
+                                  .arg(QCoreApplication::applicationVersion(), QString::fromLatin1(qVersion()),
+                                       QString::fromLatin1(apiName(QQuickWindow::graphicsApi()))));
+}
+
+void usePipelineCache(QQuickWindow &window, const QString &path) {
+    const QFileInfo file(path);
+    QDir dir = file.dir();
+    if (!dir.mkpath(QStringLiteral("."))) {
+        return;
+    }
+    const QStringList stale = dir.entryList({QStringLiteral("pipelines-*.bin")}, QDir::Files);
+    for (const QString &name : stale) {
+        if (name != file.fileName()) {
+            dir.remove(name);
+        }
+    }
+
+    QQuickGraphicsConfiguration config = window.graphicsConfiguration();
+    if (file.exists()) {
+        config.setPipelineCacheLoadFile(path);
+    }
+    config.setPipelineCacheSaveFile(path);
+    window.setGraphicsConfiguration(config);
+}
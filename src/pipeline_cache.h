@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QString>
+
+class QQuickWindow;
+
+// Where sample_app keeps its scene graph pipeline cache in dir. The name
+// carries the app version, the Qt version and the graphics API, so any of
+// them changing starts a new file. QRhi stamps the data with the device
+// and driver and ignores a blob from another one, which the save on exit
+// then replaces, so a driver update invalidates it too.
+QString pipelineCacheFile(const QString &dir);
+
+// Loads window's graphics pipelines from path if it exists and saves them
+// there when the window's scene graph is released, then deletes caches
+// for other versions in the same directory. Call before the window is
+// first exposed.
+void usePipelineCache(QQuickWindow &window, const QString &path);
@@ -0,0 +1,376 @@
+#include "prefork_supervisor.h"
+
+#include <QCoreApplication>
+#include <QtGlobal>
+#include <cstdio>
+#include <utility>
+
+#if defined(Q_OS_WIN)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "metrics_endpoint.h"
+
+namespace {
+
+// Only Linux spreads connections evenly across SO_REUSEPORT listeners;
+// elsewhere the workers share one inherited socket.
+#if defined(Q_OS_LINUX)
+constexpr bool kReusePort = true;
+#else
+constexpr bool kReusePort = false;
+#endif
+
+#if defined(Q_OS_WIN)
+using NativeSocket = SOCKET;
+constexpr NativeSocket kNoSocket = INVALID_SOCKET;
+
+QString socketError() {
+    return QStringLiteral("socket error %1").arg(WSAGetLastError());
+}
+
+void closeSocket(NativeSocket socket) {
+    closesocket(socket);
+}
+#else
+using NativeSocket = int;
+constexpr NativeSocket kNoSocket = -1;
+
+QString socketError() {
+    return QString::fromLocal8Bit(std::strerror(errno));
+}
+
+void closeSocket(NativeSocket socket) {
+    ::close(socket);
+}
+#endif
+
+// A TCP socket bound to port on every address, IPv6 and IPv4 where the
+// host has both, and listening if asked. With kReusePort, other sockets
+// of this user can bind the port too.
+qintptr openSocket(quint16 port, bool listen, QString *error) {
+#if defined(Q_OS_WIN)
+    static const bool started = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    Q_UNUSED(started);
+#endif
+    [[maybe_unused]] const int on = 1;
+    const int off = 0;
+    for (const int family : {AF_INET6, AF_INET}) {
+        const NativeSocket fd = ::socket(family, SOCK_STREAM, IPPROTO_TCP);
+        if (fd == kNoSocket) {
+            *error = socketError();
+            continue;
+        }
+#if !defined(Q_OS_WIN)
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&on), sizeof on);
+#endif
+#if defined(SO_REUSEPORT)
+        if (kReusePort) {
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char *>(&on), sizeof on);
+        }
+#endif
+        sockaddr_storage address{};
+        socklen_t length = 0;
+        if (family == AF_INET6) {
+            ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char *>(&off), sizeof off);
+            auto *any = reinterpret_cast<sockaddr_in6 *>(&address);
+            any->sin6_family = AF_INET6;
+            any->sin6_port = htons(port);
+            any->sin6_addr = in6addr_any;
+            length = sizeof(sockaddr_in6);
+        } else {
+            auto *any = reinterpret_cast<sockaddr_in *>(&address);
+            any->sin_family = AF_INET;
+            any->sin_port = htons(port);
+            any->sin_addr.s_addr = htonl(INADDR_ANY);
+            length = sizeof(sockaddr_in);
+        }
+        if (::bind(fd, reinterpret_cast<const sockaddr *>(&address), length) == 0 &&
+            (!listen || ::listen(fd, SOMAXCONN) == 0)) {
+            return static_cast<qintptr>(fd);
+        }
+        *error = socketError();
+        closeSocket(fd);
+    }
+    return -1;
+}
+
+quint16 localPort(qintptr socket) {
+    sockaddr_storage address{};
+    socklen_t length = sizeof address;
+    if (::getsockname(static_cast<NativeSocket>(socket), reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+        return 0;
+    }
+    return ntohs(address.ss_family == AF_INET6 ? reinterpret_cast<const sockaddr_in6 *>(&address)->sin6_port
+                                               : reinterpret_cast<const sockaddr_in *>(&address)->sin_port);
+}
+
+// Workers frame each report on stdout as "metrics SIZE\n" and SIZE bytes.
+constexpr char kReportHead[] = "metrics ";
+
+}  // namespace
+
+QString PreforkWorkerSpec::toString() const {
+    QString text = QString::number(index);
+    text += descriptor >= 0 ? QStringLiteral(",fd:%1").arg(descriptor) : QStringLiteral(",port:%1").arg(port);
+    if (reportMetrics) {
+        text += QStringLiteral(",metrics");
+    }
+    return text;
+}
+
+bool PreforkWorkerSpec::parse(const QString &text, PreforkWorkerSpec &spec) {
+    const QStringList fields = text.split(QLatin1Char(','));
+    if (fields.size() < 2 || fields.size() > 3 || (fields.size() == 3 && fields[2] != QLatin1String("metrics"))) {
+        return false;
+    }
+    PreforkWorkerSpec parsed;
+    bool ok = false;
+    parsed.index = fields[0].toInt(&ok);
+    if (!ok || parsed.index < 0) {
+        return false;
+    }
+    if (fields[1].startsWith(QLatin1String("port:"))) {
+        parsed.port = fields[1].mid(5).toUShort(&ok);
+    } else if (fields[1].startsWith(QLatin1String("fd:"))) {
+        parsed.descriptor = static_cast<qintptr>(fields[1].mid(3).toLongLong(&ok));
+        ok = ok && parsed.descriptor >= 0;
+    } else {
+        ok = false;
+    }
+    parsed.reportMetrics = fields.size() == 3;
+    if (ok) {
+        spec = parsed;
+    }
+    return ok;
+}
+
+PreforkSupervisor::PreforkSupervisor(Options options, Notify notify)
+    : options_(std::move(options)), notify_(std::move(notify)) {}
+
+PreforkSupervisor::~PreforkSupervisor() {
+    stopping_ = true;
+    for (const auto &worker : workers_) {
+        worker->restart.stop();
+        if (worker->process && worker->process->state() != QProcess::NotRunning) {
+#if defined(Q_OS_WIN)
+            worker->process->kill();  // console workers have no window to close
+#else
+            worker->process->terminate();
+#endif
+        }
+    }
+    for (const auto &worker : workers_) {
+        if (worker->process && !worker->process->waitForFinished(3000)) {
+            worker->process->kill();
+            worker->process->waitForFinished(1000);
+        }
+    }
+    if (socket_ >= 0) {
+        closeSocket(static_cast<NativeSocket>(socket_));
+    }
+#if defined(Q_OS_WIN)
+    if (job_ != nullptr) {
+        CloseHandle(job_);
+    }
+#endif
+}
+
+bool PreforkSupervisor::start(QString *error) {
+    // With SO_REUSEPORT the supervisor only binds, which holds the port
+    // without taking any of its connections; otherwise its socket is the
+    // one the workers accept from.
+    socket_ = openSocket(options_.port, !kReusePort, error);
+    if (socket_ < 0) {
+        return false;
+    }
+    port_ = localPort(socket_);
+#if defined(Q_OS_WIN)
+    SetHandleInformation(reinterpret_cast<HANDLE>(socket_), HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+    job_ = CreateJobObjectW(nullptr, nullptr);
+    if (job_ != nullptr) {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+        limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+        SetInformationJobObject(job_, JobObjectExtendedLimitInformation, &limits, sizeof limits);
+    }
+#endif
+    for (int i = 0; i < options_.workers; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->index = i;
+        worker->restart.setSingleShot(true);
+        Worker *raw = worker.get();
+        QObject::connect(&worker->restart, &QTimer::timeout, [this, raw] { spawn(*raw); });
+        workers_.push_back(std::move(worker));
+        spawn(*raw);
+    }
+    return true;
+}
+
+int PreforkSupervisor::running() const {
+    int count = 0;
+    for (const auto &worker : workers_) {
+        count += worker->process && worker->process->state() == QProcess::Running ? 1 : 0;
+    }
+    return count;
+}
+
+void PreforkSupervisor::spawn(Worker &worker) {
+    PreforkWorkerSpec spec;
+    spec.index = worker.index;
+    spec.reportMetrics = options_.reportMetrics;
+    if (kReusePort) {
+        spec.port = port_;
+    } else {
+        spec.descriptor = socket_;
+    }
+    worker.pending.clear();
+    worker.metrics.clear();
+    worker.process = std::make_unique<QProcess>();
+    QProcess *process = worker.process.get();
+    process->setProgram(QCoreApplication::applicationFilePath());
+    process->setArguments(options_.workerArguments + QStringList{QStringLiteral("--prefork-worker"), spec.toString()});
+    process->setProcessChannelMode(options_.reportMetrics ? QProcess::ForwardedErrorChannel
+                                                          : QProcess::ForwardedChannels);
+    QObject::connect(process, &QProcess::readyReadStandardOutput, [this, &worker] { read(worker); });
+    QObject::connect(process, &QProcess::finished, [this, &worker] { exited(worker); });
+    QObject::connect(process, &QProcess::errorOccurred, [this, &worker](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            exited(worker);
+        }
+    });
+#if defined(Q_OS_WIN)
+    QObject::connect(process, &QProcess::started, [this, process] {
+        if (job_ == nullptr) {
+            return;
+        }
+        const HANDLE handle = OpenProcess(PROCESS_SET_QUOTA | PROCESS_TERMINATE, FALSE,
+                                          static_cast<DWORD>(process->processId()));
+        if (handle != nullptr) {
+            AssignProcessToJobObject(job_, handle);
+            CloseHandle(handle);
+        }
+    });
+#endif
+    worker.startedAt = std::chrono::steady_clock::now();
+    process->start();
+}
+
+void PreforkSupervisor::read(Worker &worker) {
+    worker.pending += worker.process->readAllStandardOutput();
+    for (;;) {
+        const qsizetype headEnd = worker.pending.indexOf('\n');
+        if (headEnd < 0) {
+            return;
+        }
+        constexpr qsizetype headSize = sizeof kReportHead - 1;
+        bool ok = false;
+        const qint64 size = worker.pending.startsWith(kReportHead)
+                                ? worker.pending.mid(headSize, headEnd - headSize).toLongLong(&ok)
+                                : 0;
+        if (!ok || size < 0) {
+            worker.pending.remove(0, headEnd + 1);  // not a report; skip the line
+            continue;
+        }
+        if (worker.pending.size() - headEnd - 1 < size) {
+            return;  // the rest of the report is still on its way
+        }
+        worker.metrics = worker.pending.mid(headEnd + 1, size);
+        worker.pending.remove(0, headEnd + 1 + size);
+    }
+}
+
+void PreforkSupervisor::exited(Worker &worker) {
+    if (stopping_) {
+        return;
+    }
+    const QProcess &process = *worker.process;
+    const QString status = process.error() == QProcess::FailedToStart ? QStringLiteral("failed to start")
+                           : process.exitStatus() == QProcess::CrashExit
+                               ? QStringLiteral("crashed")
+                               : QStringLiteral("exited with %1").arg(process.exitCode());
+    worker.metrics.clear();
+    ++restarts_;
+    if (notify_) {
+        notify_(worker.index, status);
+    }
+    // Replaced from the timer, as the process is still emitting.
+    const bool lasted = std::chrono::steady_clock::now() - worker.startedAt >= std::chrono::seconds(1);
+    worker.restart.start(lasted ? 0 : 1000);
+}
+
+void PreforkSupervisor::appendMetrics(QmlMetricsText &text) const {
+    using Type = QmlMetricsText::Type;
+    text.family("qml_workers", Type::Gauge, "Worker processes running.");
+    text.gauge(running());
+    text.family("qml_worker_restarts", Type::Counter, "Workers restarted after exiting.");
+    text.counter(static_cast<double>(restarts_));
+    QmlMetricsMerger merger;
+    for (const auto &worker : workers_) {
+        if (!worker->metrics.isEmpty()) {
+            merger.add(std::string_view(worker->metrics.constData(), static_cast<size_t>(worker->metrics.size())),
+                       QmlMetricsText::label("worker", std::to_string(worker->index)));
+        }
+    }
+    merger.appendTo(text);
+}
+
+PreforkWorker::PreforkWorker(const PreforkWorkerSpec &spec, Collect collect)
+    : spec_(spec), collect_(std::move(collect)) {
+#if defined(Q_OS_WIN)
+    _setmode(_fileno(stdout), _O_BINARY);  // reports are sized in bytes
+#else
+    parent_ = ::getppid();
+#endif
+    timer_.setInterval(1000);
+    QObject::connect(&timer_, &QTimer::timeout, [this] { tick(); });
+    timer_.start();
+}
+
+qintptr PreforkWorker::listener(QString *error) const {
+    return spec_.descriptor >= 0 ? spec_.descriptor : openSocket(spec_.port, true, error);
+}
+
+void PreforkWorker::tick() {
+#if !defined(Q_OS_WIN)
+    // An orphan is adopted by another process; on Windows the supervisor's
+    // job ends its workers instead.
+    if (::getppid() != parent_) {
+        QCoreApplication::quit();
+        return;
+    }
+#endif
+    if (!spec_.reportMetrics) {
+        return;
+    }
+    text_.clear();
+    if (collect_) {
+        collect_(text_);
+    }
+    qint64 residentKiB;
+    qint64 peakResidentKiB;
+    residentMemory(residentKiB, peakResidentKiB);
+    if (residentKiB >= 0) {
+        text_.family("qml_worker_resident_memory_bytes", QmlMetricsText::Type::Gauge, "Resident memory size.",
+                     "bytes");
+        text_.gauge(static_cast<double>(residentKiB) * 1024);
+    }
+    const std::string &text = text_.finish();
+    std::fprintf(stdout, "%s%zu\n", kReportHead, text.size());
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    if (std::fflush(stdout) != 0) {
+        QCoreApplication::quit();  // the supervisor's end of the pipe is gone
+    }
+}
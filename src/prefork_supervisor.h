@@ -0,0 +1,114 @@
+#pragma once
+
+#include <QByteArray>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "qml_metrics.h"
+
+// How the supervisor starts a worker, passed on the worker's command line
+// as "INDEX,port:N" or "INDEX,fd:N", with ",metrics" appended when the
+// worker reports its metrics. A port means the worker opens its own
+// SO_REUSEPORT listener, and the kernel spreads connections across the
+// workers' listeners (Linux); a descriptor is a listening socket inherited
+// from the supervisor, which every worker accepts from (elsewhere).
+struct PreforkWorkerSpec {
+    int index = 0;
+    quint16 port = 0;
+    qintptr descriptor = -1;
+    bool reportMetrics = false;
+
+    QString toString() const;
+    static bool parse(const QString &text, PreforkWorkerSpec &spec);
+};
+
+// Runs a TCP server in several processes, so it scales across cores with
+// no state shared between them and a crash takes down only the sessions of
+// one worker. The workers are this program again, started with
+// workerArguments and --prefork-worker; the supervisor accepts nothing
+// itself. A worker that exits is restarted, after a second if it did not
+// last one, so a worker that cannot start does not spin. The workers end
+// with the supervisor, even when it is killed. Lives on the thread whose
+// event loop runs it.
+class PreforkSupervisor {
+public:
+    // Called as a worker is restarted, with how it ended, e.g. "crashed".
+    using Notify = std::function<void(int index, const QString &status)>;
+
+    struct Options {
+        int workers = 2;
+        quint16 port = 0;  // 0 picks one
+        QStringList workerArguments;
+        bool reportMetrics = false;  // workers send their metrics for appendMetrics()
+    };
+
+    PreforkSupervisor(Options options, Notify notify);
+    ~PreforkSupervisor();
+    PreforkSupervisor(const PreforkSupervisor &) = delete;
+    PreforkSupervisor &operator=(const PreforkSupervisor &) = delete;
+
+    // Takes the port and starts the workers; false, with error set, if the
+    // port cannot be had.
+    bool start(QString *error);
+    quint16 port() const { return port_; }
+    int running() const;
+    uint64_t restarts() const { return restarts_; }
+
+    // qml_workers and qml_worker_restarts, then the families the workers
+    // last reported, each sample labelled with its worker="N". Workers
+    // report once a second, so their figures are up to a second old.
+    void appendMetrics(QmlMetricsText &text) const;
+
+private:
+    struct Worker {
+        int index;
+        std::unique_ptr<QProcess> process;
+        QByteArray pending;  // stdout not yet framed
+        QByteArray metrics;  // the last report
+        std::chrono::steady_clock::time_point startedAt;
+        QTimer restart;
+    };
+
+    void spawn(Worker &worker);
+    void read(Worker &worker);
+    void exited(Worker &worker);
+
+    Options options_;
+    Notify notify_;
+    quint16 port_ = 0;
+    qintptr socket_ = -1;  // bound to port_; listening when inherited
+    std::vector<std::unique_ptr<Worker>> workers_;
+    uint64_t restarts_ = 0;
+    bool stopping_ = false;
+    void *job_ = nullptr;  // Windows: a job that ends the workers with the supervisor
+};
+
+// A worker's side of PreforkSupervisor: ends the process once the
+// supervisor is gone and, with reportMetrics, writes collect's families
+// and its resident memory to stdout once a second.
+class PreforkWorker {
+public:
+    using Collect = std::function<void(QmlMetricsText &text)>;
+
+    PreforkWorker(const PreforkWorkerSpec &spec, Collect collect);
+
+    // A listening socket for QTcpServer::setSocketDescriptor(); -1, with
+    // error set, if none could be opened.
+    qintptr listener(QString *error) const;
+
+private:
+    void tick();
+
+    PreforkWorkerSpec spec_;
+    Collect collect_;
+    QTimer timer_;
+    QmlMetricsText text_;  // kept to reuse its capacity
+    qint64 parent_ = 0;
+};
@@ -0,0 +1,74 @@
+// Compiles a fixed QML screen into a C++ render function:
+//
+//   qml2curses --name NAME --header FILE --source FILE SCREEN.qml
+//
+// Writes render<NAME>() into the two files; see src/qml_render_compiler.h
+// for what it accepts. Run by qml_curses_compile() in CMake.
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "qml_parser.h"
+#include "qml_render_compiler.h"
+
+namespace {
+
+int usage() {
+    std::fprintf(stderr, "usage: qml2curses --name NAME --header FILE --source FILE SCREEN.qml\n");
+    return 2;
+}
+
+bool writeFile(const char *path, const std::string &contents) {
+    FILE *out = std::fopen(path, "wb");
+    if (!out) {
+        std::perror(path);
+        return false;
+    }
+    bool ok = std::fwrite(contents.data(), 1, contents.size(), out) == contents.size();
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::perror(path);
+    }
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const char *name = nullptr;
+    const char *headerPath = nullptr;
+    const char *sourcePath = nullptr;
+    const char *qmlPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char **option = std::strcmp(arg, "--name") == 0     ? &name
+                              : std::strcmp(arg, "--header") == 0 ? &headerPath
+                              : std::strcmp(arg, "--source") == 0 ? &sourcePath
+                                                                  : nullptr;
+        if (option) {
+            if (i + 1 == argc) {
+                return usage();
+            }
+            *option = argv[++i];
+        } else if (!qmlPath && arg[0] != '-') {
+            qmlPath = arg;
+        } else {
+            return usage();
+        }
+    }
+    if (!name || !headerPath || !sourcePath || !qmlPath) {
+        return usage();
+    }
+
+    QmlRenderCompiler::Output output;
+    try {
+        const QmlDocument document = QmlParser().parseFile(qmlPath);
+        output = QmlRenderCompiler::compile(document, name, qmlPath);
+    } catch (const std::exception &error) {
+        std::fprintf(stderr, "qml2curses: %s\n", error.what());
+        return 1;
+    }
+    return writeFile(headerPath, output.header) && writeFile(sourcePath, output.source) ? 0 : 1;
+}
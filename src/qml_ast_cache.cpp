@@ -0,0 +1,614 @@
+#include "qml_ast_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+#include "qml_trace.h"
+
+namespace {
+
+constexpr char kMagic[4] = {'Q', 'M', 'L', 'C'};
+
+// All sections are arrays of 32-bit fields written in host byte order; an
+// entry written on a different-endian host fails the magic check.
+struct Header {
+    char magic[4];
+    uint32_t formatVersion;
+    uint32_t grammarVersion;
+    uint32_t atomCount;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t payloadHash;
+    uint32_t nodeCount;
+    uint32_t propertyCount;
+    uint32_t stringBytes;
+    uint32_t scriptCount;
+};
+
+struct AtomRecord {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// Stands for QmlAtoms::Invalid where an atom is optional.
+constexpr uint32_t kNoAtom = UINT32_MAX;
+
+// Nodes are stored in pre-order; childCount lets the reader rebuild the
+// tree without any link fields.
+struct NodeRecord {
+    uint32_t typeAtom;
+    uint32_t bindingAtom;  // kNoAtom for a plain child
+    uint32_t childCount;
+    uint32_t propertyCount;
+    uint32_t sourceBegin;
+    uint32_t sourceEnd;
+    uint32_t scriptCount;
+};
+
+struct PropertyRecord {
+    uint32_t keyAtom;
+    uint32_t valueOffset;
+    uint32_t valueLength;
+    uint32_t valueKind;  // QmlValueKind
+};
+
+struct ScriptRecord {
+    uint32_t kind;  // QmlScriptKind
+    uint32_t nameAtom;
+    uint32_t parametersOffset;
+    uint32_t parametersLength;
+    uint32_t bodyBegin;
+    uint32_t bodyEnd;
+};
+
+constexpr char kFlatMagic[4] = {'Q', 'M', 'L', 'F'};
+
+// A flat entry is the header, an AtomRecord for each atom the document uses
+// that is not predefined, then the QmlFlatDocument block as it is laid out
+// in memory: nodes, properties, the child index table (roots first, one
+// entry per node) and the string pool, which also holds the atom names.
+// Predefined atoms are stored as they are, the others as PredefinedCount
+// plus their index in the name table.
+struct FlatHeader {
+    char magic[4];
+    uint32_t formatVersion;
+    uint32_t grammarVersion;
+    uint32_t atomCount;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t payloadHash;
+    uint64_t predefinedHash;
+    uint32_t nodeCount;
+    uint32_t propertyCount;
+    uint32_t rootCount;
+    uint32_t stringBytes;
+};
+
+static_assert(sizeof(FlatHeader) % alignof(QmlFlatNode) == 0 && sizeof(AtomRecord) % alignof(QmlFlatNode) == 0,
+              "flat entry sections must stay aligned");
+
+uint64_t fnv1a(std::string_view bytes) {
+    uint64_t hash = 1469598103934665603ull;
+    for (const char ch : bytes) {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Predefined atoms are stored by number, which only means the same to a
+// build with the same list of them.
+uint64_t predefinedAtomsHash() {
+    static const uint64_t hash = [] {
+        std::string names;
+        for (QmlAtom atom = 1; atom < QmlAtoms::PredefinedCount; ++atom) {
+            names += QmlAtomTable::global().name(atom);
+            names += '\0';
+        }
+        return fnv1a(names);
+    }();
+    return hash;
+}
+
+// Writes to a temporary name and renames, so concurrent readers only ever
+// see complete entries. The temporary name is unique, as processes loading
+// the same source write the same entry at once.
+bool publish(const std::string &cachePath, std::string_view bytes) {
+    std::error_code ec;
+    const std::filesystem::path target(cachePath);
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), ec);
+    }
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%08x.tmp", static_cast<unsigned>(std::random_device()()));
+    const std::string tempPath = cachePath + suffix;
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, target, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+void append(std::string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+T read(const char *at) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+class Writer {
+public:
+    std::string write(const QmlDocument &document, uint64_t sourceHash, uint64_t sourceSize) {
+        std::vector<const QmlNode *> pending;
+        for (auto it = document.roots.rbegin(); it != document.roots.rend(); ++it) {
+            pending.push_back(&*it);
+        }
+        while (!pending.empty()) {
+            const QmlNode *node = pending.back();
+            pending.pop_back();
+            nodes_.push_back(NodeRecord{fileAtom(node->typeAtom, node->type),
+                                        node->binding == QmlAtoms::Invalid
+                                            ? kNoAtom
+                                            : fileAtom(node->binding, QmlAtomTable::global().name(node->binding)),
+                                        static_cast<uint32_t>(node->children.size()),
+                                        static_cast<uint32_t>(node->properties.size()),
+                                        static_cast<uint32_t>(node->sourceBegin),
+                                        static_cast<uint32_t>(node->sourceEnd),
+                                        static_cast<uint32_t>(node->scripts.size())});
+            for (const auto &prop : node->properties) {
+                const uint32_t key = fileAtom(prop.key, QmlAtomTable::global().name(prop.key));
+                properties_.push_back(PropertyRecord{key, addString(prop.value), static_cast<uint32_t>(prop.value.size()),
+                                                     static_cast<uint32_t>(prop.typed.kind)});
+            }
+            for (const auto &script : node->scripts) {
+                const uint32_t name = fileAtom(script.name, QmlAtomTable::global().name(script.name));
+                scripts_.push_back(ScriptRecord{static_cast<uint32_t>(script.kind), name, addString(script.parameters),
+                                                static_cast<uint32_t>(script.parameters.size()),
+                                                static_cast<uint32_t>(script.bodyBegin),
+                                                static_cast<uint32_t>(script.bodyEnd)});
+            }
+            for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+                pending.push_back(&*it);
+            }
+        }
+
+        std::string payload;
+        for (const auto &atom : atoms_) {
+            append(payload, atom);
+        }
+        for (const auto &node : nodes_) {
+            append(payload, node);
+        }
+        for (const auto &prop : properties_) {
+            append(payload, prop);
+        }
+        for (const auto &script : scripts_) {
+            append(payload, script);
+        }
+        payload += strings_;
+
+        Header header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.formatVersion = QmlAstCache::kFormatVersion;
+        header.grammarVersion = QmlParser::kGrammarVersion;
+        header.atomCount = static_cast<uint32_t>(atoms_.size());
+        header.sourceHash = sourceHash;
+        header.sourceSize = sourceSize;
+        header.payloadHash = fnv1a(payload);
+        header.nodeCount = static_cast<uint32_t>(nodes_.size());
+        header.propertyCount = static_cast<uint32_t>(properties_.size());
+        header.stringBytes = static_cast<uint32_t>(strings_.size());
+        header.scriptCount = static_cast<uint32_t>(scripts_.size());
+
+        std::string out;
+        out.reserve(sizeof(Header) + payload.size());
+        append(out, header);
+        out += payload;
+        return out;
+    }
+
+private:
+    uint32_t addString(std::string_view text) {
+        const auto offset = static_cast<uint32_t>(strings_.size());
+        strings_.append(text.data(), text.size());
+        return offset;
+    }
+
+    // Atoms are process-local, so entries carry their own name table.
+    uint32_t fileAtom(QmlAtom atom, std::string_view name) {
+        const auto it = atomIndex_.find(atom);
+        if (it != atomIndex_.end()) {
+            return it->second;
+        }
+        const auto index = static_cast<uint32_t>(atoms_.size());
+        atoms_.push_back(AtomRecord{addString(name), static_cast<uint32_t>(name.size())});
+        atomIndex_.emplace(atom, index);
+        return index;
+    }
+
+    std::unordered_map<QmlAtom, uint32_t> atomIndex_;
+    std::vector<AtomRecord> atoms_;
+    std::vector<NodeRecord> nodes_;
+    std::vector<PropertyRecord> properties_;
+    std::vector<ScriptRecord> scripts_;
+    std::string strings_;
+};
+
+}  // namespace
+
+QmlAstCache::QmlAstCache(std::string directory) : directory_(std::move(directory)) {}
+
+uint64_t QmlAstCache::contentHash(std::string_view bytes) {
+    return fnv1a(bytes);
+}
+
+std::string QmlAstCache::serialize(const QmlDocument &document, uint64_t sourceHash, uint64_t sourceSize) {
+    return Writer().write(document, sourceHash, sourceSize);
+}
+
+bool QmlAstCache::deserialize(std::string_view bytes, uint64_t sourceHash, uint64_t sourceSize, QmlDocument &document) {
+    if (bytes.size() < sizeof(Header)) {
+        return false;
+    }
+    const Header header = read<Header>(bytes.data());
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.formatVersion != kFormatVersion ||
+        header.grammarVersion != QmlParser::kGrammarVersion || header.sourceHash != sourceHash ||
+        header.sourceSize != sourceSize) {
+        return false;
+    }
+
+    const uint64_t atomBytes = uint64_t(header.atomCount) * sizeof(AtomRecord);
+    const uint64_t nodeBytes = uint64_t(header.nodeCount) * sizeof(NodeRecord);
+    const uint64_t propertyBytes = uint64_t(header.propertyCount) * sizeof(PropertyRecord);
+    const uint64_t scriptBytes = uint64_t(header.scriptCount) * sizeof(ScriptRecord);
+    const uint64_t payloadSize = atomBytes + nodeBytes + propertyBytes + scriptBytes + header.stringBytes;
+    if (bytes.size() - sizeof(Header) != payloadSize) {
+        return false;
+    }
+    const std::string_view payload = bytes.substr(sizeof(Header));
+    if (fnv1a(payload) != header.payloadHash) {
+        return false;
+    }
+
+    const char *atomsAt = payload.data();
+    const char *nodesAt = atomsAt + atomBytes;
+    const char *propertiesAt = nodesAt + nodeBytes;
+    const char *scriptsAt = propertiesAt + propertyBytes;
+    const std::string_view strings =
+        payload.substr(static_cast<size_t>(atomBytes + nodeBytes + propertyBytes + scriptBytes));
+
+    auto stringAt = [&](uint32_t offset, uint32_t length, std::string_view &out) {
+        if (uint64_t(offset) + length > strings.size()) {
+            return false;
+        }
+        out = strings.substr(offset, length);
+        return true;
+    };
+
+    std::vector<std::string_view> atomNames(header.atomCount);
+    std::vector<QmlAtom> atoms(header.atomCount);
+    for (uint32_t i = 0; i < header.atomCount; ++i) {
+        const auto record = read<AtomRecord>(atomsAt + i * sizeof(AtomRecord));
+        if (!stringAt(record.offset, record.length, atomNames[i])) {
+            return false;
+        }
+        atoms[i] = QmlAtomTable::global().intern(atomNames[i]);
+    }
+
+    struct Open {
+        QmlNode *node;
+        uint32_t remainingChildren;
+    };
+
+    QmlDocument result;
+    std::vector<Open> stack;
+    uint32_t nextProperty = 0;
+    uint32_t nextScript = 0;
+    for (uint32_t i = 0; i < header.nodeCount; ++i) {
+        const auto record = read<NodeRecord>(nodesAt + i * sizeof(NodeRecord));
+        if (record.typeAtom >= header.atomCount ||
+            (record.bindingAtom != kNoAtom && record.bindingAtom >= header.atomCount) ||
+            record.propertyCount > header.propertyCount - nextProperty ||
+            record.scriptCount > header.scriptCount - nextScript ||
+            record.childCount > header.nodeCount || record.sourceBegin > record.sourceEnd ||
+            record.sourceEnd > sourceSize) {
+            return false;
+        }
+
+        QmlNode *node = nullptr;
+        if (stack.empty()) {
+            result.roots.emplace_back();
+            node = &result.roots.back();
+        } else {
+            stack.back().node->children.emplace_back();
+            node = &stack.back().node->children.back();
+            --stack.back().remainingChildren;
+        }
+        node->type.assign(atomNames[record.typeAtom].data(), atomNames[record.typeAtom].size());
+        node->typeAtom = atoms[record.typeAtom];
+        node->binding = record.bindingAtom == kNoAtom ? QmlAtoms::Invalid : atoms[record.bindingAtom];
+        node->sourceBegin = record.sourceBegin;
+        node->sourceEnd = record.sourceEnd;
+
+        node->properties.reserve(record.propertyCount);
+        for (uint32_t p = 0; p < record.propertyCount; ++p, ++nextProperty) {
+            const auto prop = read<PropertyRecord>(propertiesAt + nextProperty * sizeof(PropertyRecord));
+            std::string_view value;
+            if (prop.keyAtom >= header.atomCount || !stringAt(prop.valueOffset, prop.valueLength, value)) {
+                return false;
+            }
+            // Only the kind is stored. Unquoted values are their own source
+            // text, so the numbers are recovered by classifying them again.
+            QmlValue typed;
+            if (prop.valueKind != static_cast<uint32_t>(QmlValueKind::String)) {
+                typed = QmlValue::classify(value);
+                if (static_cast<uint32_t>(typed.kind) != prop.valueKind) {
+                    return false;
+                }
+            }
+            node->setProperty(atoms[prop.keyAtom], std::string(value), typed);
+        }
+
+        node->scripts.reserve(record.scriptCount);
+        for (uint32_t k = 0; k < record.scriptCount; ++k, ++nextScript) {
+            const auto script = read<ScriptRecord>(scriptsAt + nextScript * sizeof(ScriptRecord));
+            std::string_view parameters;
+            if (script.kind > static_cast<uint32_t>(QmlScriptKind::Function) || script.nameAtom >= header.atomCount ||
+                !stringAt(script.parametersOffset, script.parametersLength, parameters) ||
+                script.bodyBegin > script.bodyEnd || script.bodyEnd > sourceSize) {
+                return false;
+            }
+            node->scripts.push_back(QmlScriptBlock{static_cast<QmlScriptKind>(script.kind), atoms[script.nameAtom],
+                                                   std::string(parameters), script.bodyBegin, script.bodyEnd});
+        }
+
+        while (!stack.empty() && stack.back().remainingChildren == 0) {
+            stack.pop_back();
+        }
+        if (record.childCount > 0) {
+            node->children.reserve(record.childCount);
+            stack.push_back(Open{node, record.childCount});
+        }
+    }
+    if (!stack.empty() || nextProperty != header.propertyCount || nextScript != header.scriptCount) {
+        return false;
+    }
+
+    result.reindex();
+    document = std::move(result);
+    return true;
+}
+
+std::string QmlAstCache::cachePathFor(const std::string &sourcePath, uint64_t sourceHash,
+                                      std::string_view extension) const {
+    if (directory_.empty()) {
+        return sourcePath + std::string(extension);
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(sourceHash));
+    return (std::filesystem::path(directory_) / (name + std::string(extension))).string();
+}
+
+std::string QmlAstCache::serializeFlat(const QmlFlatDocument &document, uint64_t sourceHash, uint64_t sourceSize) {
+    std::string strings(document.strings_, document.stringBytes_);
+    std::vector<AtomRecord> atoms;
+    std::unordered_map<QmlAtom, uint32_t> atomIndex;
+    auto fileAtom = [&](QmlAtom atom) -> uint32_t {
+        if (atom < QmlAtoms::PredefinedCount) {
+            return atom;
+        }
+        auto it = atomIndex.find(atom);
+        if (it == atomIndex.end()) {
+            const std::string_view name = QmlAtomTable::global().name(atom);
+            atoms.push_back(AtomRecord{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(name.size())});
+            strings.append(name.data(), name.size());
+            it = atomIndex.emplace(atom, static_cast<uint32_t>(atoms.size() - 1)).first;
+        }
+        return QmlAtoms::PredefinedCount + it->second;
+    };
+
+    std::string payload;
+    std::vector<QmlFlatNode> nodes(document.nodeCount_);
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        nodes[i] = document.nodes_[i];
+        nodes[i].typeAtom = fileAtom(document.typeAtom(i));
+    }
+    std::vector<QmlFlatProperty> properties(document.propertyCount_);
+    for (uint32_t i = 0; i < properties.size(); ++i) {
+        properties[i] = document.properties_[i];
+        properties[i].key = fileAtom(document.key(properties[i]));
+    }
+    for (const auto &atom : atoms) {
+        append(payload, atom);
+    }
+    for (const auto &node : nodes) {
+        append(payload, node);
+    }
+    for (const auto &prop : properties) {
+        append(payload, prop);
+    }
+    for (size_t i = 0; i < document.nodeCount_; ++i) {
+        append(payload, document.childIndices_[i]);
+    }
+    payload += strings;
+
+    FlatHeader header{};
+    std::memcpy(header.magic, kFlatMagic, sizeof(kFlatMagic));
+    header.formatVersion = kFlatFormatVersion;
+    header.grammarVersion = QmlParser::kGrammarVersion;
+    header.atomCount = static_cast<uint32_t>(atoms.size());
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.payloadHash = fnv1a(payload);
+    header.predefinedHash = predefinedAtomsHash();
+    header.nodeCount = static_cast<uint32_t>(nodes.size());
+    header.propertyCount = static_cast<uint32_t>(properties.size());
+    header.rootCount = document.rootCount_;
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+
+    std::string out;
+    out.reserve(sizeof(FlatHeader) + payload.size());
+    append(out, header);
+    out += payload;
+    return out;
+}
+
+bool QmlAstCache::mapFlat(std::string_view bytes, uint64_t sourceHash, uint64_t sourceSize, QmlFlatDocument &document) {
+    if (bytes.size() < sizeof(FlatHeader) || reinterpret_cast<uintptr_t>(bytes.data()) % alignof(QmlFlatNode) != 0) {
+        return false;
+    }
+    const FlatHeader header = read<FlatHeader>(bytes.data());
+    if (std::memcmp(header.magic, kFlatMagic, sizeof(kFlatMagic)) != 0 || header.formatVersion != kFlatFormatVersion ||
+        header.grammarVersion != QmlParser::kGrammarVersion || header.predefinedHash != predefinedAtomsHash() ||
+        header.sourceHash != sourceHash || header.sourceSize != sourceSize || header.rootCount > header.nodeCount) {
+        return false;
+    }
+
+    const uint64_t atomBytes = uint64_t(header.atomCount) * sizeof(AtomRecord);
+    const uint64_t nodeBytes = uint64_t(header.nodeCount) * sizeof(QmlFlatNode);
+    const uint64_t propertyBytes = uint64_t(header.propertyCount) * sizeof(QmlFlatProperty);
+    const uint64_t childBytes = uint64_t(header.nodeCount) * sizeof(uint32_t);
+    if (bytes.size() - sizeof(FlatHeader) != atomBytes + nodeBytes + propertyBytes + childBytes + header.stringBytes) {
+        return false;
+    }
+    const std::string_view payload = bytes.substr(sizeof(FlatHeader));
+    if (fnv1a(payload) != header.payloadHash) {
+        return false;
+    }
+
+    const char *atomsAt = payload.data();
+    const auto *nodes = reinterpret_cast<const QmlFlatNode *>(atomsAt + atomBytes);
+    const auto *properties = reinterpret_cast<const QmlFlatProperty *>(atomsAt + atomBytes + nodeBytes);
+    const auto *childIndices = reinterpret_cast<const uint32_t *>(atomsAt + atomBytes + nodeBytes + propertyBytes);
+    const char *strings = atomsAt + atomBytes + nodeBytes + propertyBytes + childBytes;
+    auto inStrings = [&](uint32_t offset, uint32_t length) { return uint64_t(offset) + length <= header.stringBytes; };
+    const uint64_t atomLimit = uint64_t(QmlAtoms::PredefinedCount) + header.atomCount;
+
+    // Every offset is checked once here, so lookups need no bounds checks.
+    std::vector<QmlAtom> atoms(header.atomCount);
+    for (uint32_t i = 0; i < header.atomCount; ++i) {
+        const auto record = read<AtomRecord>(atomsAt + i * sizeof(AtomRecord));
+        if (!inStrings(record.offset, record.length)) {
+            return false;
+        }
+        atoms[i] = QmlAtomTable::global().intern(std::string_view(strings + record.offset, record.length));
+    }
+    for (uint32_t i = 0; i < header.nodeCount; ++i) {
+        const QmlFlatNode &node = nodes[i];
+        if (node.typeAtom >= atomLimit || !inStrings(node.id.offset, node.id.length) ||
+            uint64_t(node.firstProperty) + node.propertyCount > header.propertyCount ||
+            uint64_t(node.firstChild) + node.childCount > header.nodeCount || node.subtreeEnd <= i ||
+            node.subtreeEnd > header.nodeCount) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.propertyCount; ++i) {
+        if (properties[i].key >= atomLimit || !inStrings(properties[i].value.offset, properties[i].value.length)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.nodeCount; ++i) {
+        if (childIndices[i] >= header.nodeCount) {
+            return false;
+        }
+    }
+
+    QmlFlatDocument result;
+    result.nodes_ = nodes;
+    result.properties_ = properties;
+    result.childIndices_ = childIndices;
+    result.strings_ = strings;
+    result.nodeCount_ = header.nodeCount;
+    result.propertyCount_ = header.propertyCount;
+    result.rootCount_ = header.rootCount;
+    result.stringBytes_ = header.stringBytes;
+    result.byteSize_ = bytes.size();
+    result.imageAtoms_ = std::move(atoms);
+    document = std::move(result);
+    return true;
+}
+
+QmlDocument QmlAstCache::loadFile(const std::string &path, bool *cacheHit) const {
+    const QmlTraceSpan span("QmlAstCache::loadFile");
+    MappedFile source;
+    if (!source.open(path)) {
+        throw std::runtime_error("Failed to open QML file: " + path);
+    }
+    const uint64_t hash = contentHash(source.view());
+    const std::string cachePath = cachePathFor(path, hash);
+
+    QmlDocument document;
+    MappedFile cached;
+    if (cached.open(cachePath) && deserialize(cached.view(), hash, source.size(), document)) {
+        if (cacheHit) {
+            *cacheHit = true;
+        }
+        return document;
+    }
+    cached.close();
+
+    document = QmlParser().parseString(source.view());
+    if (cacheHit) {
+        *cacheHit = false;
+    }
+
+    publish(cachePath, serialize(document, hash, source.size()));
+    return document;
+}
+
+QmlFlatDocument QmlAstCache::loadFlatFile(const std::string &path, bool *cacheHit) const {
+    const QmlTraceSpan span("QmlAstCache::loadFlatFile");
+    MappedFile source;
+    if (!source.open(path)) {
+        throw std::runtime_error("Failed to open QML file: " + path);
+    }
+    const uint64_t hash = contentHash(source.view());
+    const std::string cachePath = cachePathFor(path, hash, ".qmlf");
+
+    auto mapEntry = [&](QmlFlatDocument &document) {
+        auto image = std::make_shared<MappedFile>();
+        if (!image->open(cachePath) || !mapFlat(image->view(), hash, source.size(), document)) {
+            return false;
+        }
+        document.image_ = std::move(image);
+        return true;
+    };
+
+    QmlFlatDocument document;
+    const bool hit = mapEntry(document);
+    if (cacheHit) {
+        *cacheHit = hit;
+    }
+    if (!hit) {
+        document = QmlParser().parseStringFlat(source.view());
+        // Mapping the entry just written, in place of the parsed block,
+        // lets later processes share this one's pages.
+        if (publish(cachePath, serializeFlat(document, hash, source.size()))) {
+            mapEntry(document);
+        }
+    }
+    return document;
+}
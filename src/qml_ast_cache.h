@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "qml_parser.h"
+
+// Versioned binary serialization of QmlDocument, in the spirit of
+// qmlcachegen's .qmlc files. A cache entry is keyed by the source's content
+// hash and QmlParser::kGrammarVersion; stale, foreign or corrupt entries are
+// rejected and the source is parsed instead.
+//
+// QmlFlatDocument entries (".qmlf") are the document's own block behind a
+// header and an atom name table, so they are used where they are mapped:
+// processes loading the same source share one copy of its pages.
+class QmlAstCache {
+public:
+    static constexpr uint32_t kFormatVersion = 5;
+    static constexpr uint32_t kFlatFormatVersion = 1;
+
+    // An empty directory stores caches next to the source as "<file>.qmlc".
+    explicit QmlAstCache(std::string directory = std::string());
+
+    // Loads path through the cache: a valid entry is mapped and decoded,
+    // otherwise the source is parsed and a fresh entry is written. cacheHit
+    // reports which path was taken. Throws std::runtime_error if the source
+    // cannot be read; failing to write the cache is not an error.
+    QmlDocument loadFile(const std::string &path, bool *cacheHit = nullptr) const;
+    // The same for QmlParser::parseFileFlat(). The document points into the
+    // mapped entry, which it keeps mapped; a fresh entry is written and then
+    // mapped too, so the first process shares its pages with later ones.
+    QmlFlatDocument loadFlatFile(const std::string &path, bool *cacheHit = nullptr) const;
+
+    std::string cachePathFor(const std::string &sourcePath, uint64_t sourceHash,
+                             std::string_view extension = ".qmlc") const;
+
+    static uint64_t contentHash(std::string_view bytes);
+    static std::string serialize(const QmlDocument &document, uint64_t sourceHash, uint64_t sourceSize);
+    // Returns false, leaving document untouched, unless bytes is a complete,
+    // well-formed entry for exactly this source.
+    static bool deserialize(std::string_view bytes, uint64_t sourceHash, uint64_t sourceSize, QmlDocument &document);
+
+    static std::string serializeFlat(const QmlFlatDocument &document, uint64_t sourceHash, uint64_t sourceSize);
+    // Like deserialize(), but document points into bytes instead of copying
+    // them, so bytes must outlive it. Fails unless bytes is 4-byte aligned,
+    // as mappings and heap blocks are.
+    static bool mapFlat(std::string_view bytes, uint64_t sourceHash, uint64_t sourceSize, QmlFlatDocument &document);
+
+private:
+    std::string directory_;
+};
@@ -0,0 +1,81 @@
+#include "qml_atoms.h"
+
+namespace {
+
+// Every predefined name finds its atom through the perfect hash.
+constexpr bool predefinedNamesHash() {
+    for (QmlAtom atom = 1; atom < QmlAtoms::PredefinedCount; ++atom) {
+        if (QmlAtoms::predefined(QmlAtoms::kNames[atom]) != atom) {
+            return false;
+        }
+    }
+    return QmlAtoms::predefined("") == QmlAtoms::Invalid && QmlAtoms::predefined("Rectangle") == QmlAtoms::Invalid;
+}
+static_assert(predefinedNamesHash(), "the perfect hash must map each predefined name to its atom");
+
+}  // namespace
+
+QmlAtomTable &QmlAtomTable::global() {
+    static QmlAtomTable table;
+    return table;
+}
+
+QmlAtomTable::QmlAtomTable() {
+    for (const std::string_view name : QmlAtoms::kNames) {
+        names_.emplace_back(name);
+        index_.emplace(names_.back(), static_cast<QmlAtom>(names_.size() - 1));
+    }
+}
+
+// Predefined names, most of what a parse interns, skip the lock.
+QmlAtom QmlAtomTable::intern(std::string_view name) {
+    std::string_view stored;
+    return intern(name, stored);
+}
+
+QmlAtom QmlAtomTable::intern(std::string_view name, std::string_view &stored) {
+    if (name.empty()) {
+        stored = {};
+        return QmlAtoms::Invalid;
+    }
+    if (const QmlAtom atom = QmlAtoms::predefined(name)) {
+        stored = QmlAtoms::kNames[atom];
+        return atom;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(name);
+    if (it != index_.end()) {
+        stored = it->first;
+        return it->second;
+    }
+    names_.emplace_back(name);
+    const auto atom = static_cast<QmlAtom>(names_.size() - 1);
+    index_.emplace(names_.back(), atom);
+    stored = names_.back();
+    return atom;
+}
+
+QmlAtom QmlAtomTable::find(std::string_view name) const {
+    if (const QmlAtom atom = QmlAtoms::predefined(name)) {
+        return atom;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(name);
+    return it == index_.end() ? QmlAtoms::Invalid : it->second;
+}
+
+std::string_view QmlAtomTable::name(QmlAtom atom) const {
+    if (atom < QmlAtoms::PredefinedCount) {
+        return QmlAtoms::kNames[atom];
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (atom >= names_.size()) {
+        return {};
+    }
+    return names_[atom];
+}
+
+size_t QmlAtomTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return names_.size();
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Interned identifier for a QML type name or property key. Atoms are plain
+// integers, so comparing two of them is a single integer compare.
+using QmlAtom = uint32_t;
+
+// Atoms with fixed values, available without a table lookup. The order must
+// match kNames below.
+namespace QmlAtoms {
+enum : QmlAtom {
+    Invalid = 0,
+
+    // Property keys.
+    id,
+    text,
+    title,
+    spacing,
+    placeholderText,
+    width,
+    height,
+    visible,
+    columns,
+    anchorsCenterIn,  // "anchors.centerIn"
+    wrapMode,
+    model,
+    focus,
+    onClicked,
+    onAccepted,
+    interval,
+    running,
+    repeat,
+    onTriggered,
+    target,
+    property,
+    from,
+    to,
+    duration,
+    loops,
+    opacity,
+    x,
+    color,
+    fontBold,  // "font.bold"
+    delegate,
+
+    // Element types.
+    ApplicationWindow,
+    Column,
+    Row,
+    Text,
+    Label,
+    Button,
+    TextField,
+    Grid,
+    Repeater,
+    ListView,
+    Timer,
+    NumberAnimation,
+    BusyIndicator,
+    LogView,
+
+    PredefinedCount
+};
+
+// Names of the predefined atoms, by atom.
+inline constexpr std::string_view kNames[] = {
+    "",
+    "id",
+    "text",
+    "title",
+    "spacing",
+    "placeholderText",
+    "width",
+    "height",
+    "visible",
+    "columns",
+    "anchors.centerIn",
+    "wrapMode",
+    "model",
+    "focus",
+    "onClicked",
+    "onAccepted",
+    "interval",
+    "running",
+    "repeat",
+    "onTriggered",
+    "target",
+    "property",
+    "from",
+    "to",
+    "duration",
+    "loops",
+    "opacity",
+    "x",
+    "color",
+    "font.bold",
+    "delegate",
+    "ApplicationWindow",
+    "Column",
+    "Row",
+    "Text",
+    "Label",
+    "Button",
+    "TextField",
+    "Grid",
+    "Repeater",
+    "ListView",
+    "Timer",
+    "NumberAnimation",
+    "BusyIndicator",
+    "LogView",
+};
+static_assert(sizeof(kNames) / sizeof(kNames[0]) == PredefinedCount, "kNames must list every predefined atom");
+
+namespace detail {
+
+constexpr uint32_t hashName(std::string_view name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;  // FNV-1a
+    for (const char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+// Atom by slot for the first seed that gives every predefined name a slot
+// of its own; found by the compiler.
+struct PerfectHash {
+    static constexpr size_t kSlots = 256;
+    uint32_t seed = 0;
+    uint8_t atoms[kSlots] = {};
+};
+
+constexpr PerfectHash buildPerfectHash() {
+    for (uint32_t seed = 0;; ++seed) {
+        PerfectHash table;
+        table.seed = seed;
+        bool distinct = true;
+        for (QmlAtom atom = 1; atom < PredefinedCount && distinct; ++atom) {
+            uint8_t &slot = table.atoms[hashName(kNames[atom], seed) % PerfectHash::kSlots];
+            distinct = slot == Invalid;
+            slot = static_cast<uint8_t>(atom);
+        }
+        if (distinct) {
+            return table;
+        }
+    }
+}
+
+inline constexpr PerfectHash kPerfectHash = buildPerfectHash();
+
+}  // namespace detail
+
+// The predefined atom named name, or Invalid, with one hash and one
+// compare: no table and no lock. Usable in constant expressions.
+constexpr QmlAtom predefined(std::string_view name) {
+    const QmlAtom atom =
+        detail::kPerfectHash.atoms[detail::hashName(name, detail::kPerfectHash.seed) % detail::PerfectHash::kSlots];
+    return atom != Invalid && kNames[atom] == name ? atom : Invalid;
+}
+}  // namespace QmlAtoms
+
+// Process-wide intern table shared by every QmlDocument, so atoms from
+// different documents (reloads, batch parses, diffs) compare directly.
+// Entries are never removed; names are stored at stable addresses.
+class QmlAtomTable {
+public:
+    static QmlAtomTable &global();
+
+    // Returns the atom for name, adding it if needed. Thread-safe.
+    QmlAtom intern(std::string_view name);
+    // As above; stored is set to the table's own copy of the name, which
+    // lives as long as the process.
+    QmlAtom intern(std::string_view name, std::string_view &stored);
+    // Returns QmlAtoms::Invalid if name was never interned.
+    QmlAtom find(std::string_view name) const;
+    // Empty view for atoms that were not handed out by this table.
+    std::string_view name(QmlAtom atom) const;
+    size_t size() const;
+
+private:
+    QmlAtomTable();
+
+    mutable std::mutex mutex_;
+    std::deque<std::string> names_;
+    std::unordered_map<std::string_view, QmlAtom> index_;
+};
+
+// Per-parse front cache for QmlAtomTable::global(). Repeated names are
+// resolved without touching the shared table's lock, which keeps parallel
+// parses from serializing on it. Keys view the table's copies of the
+// names, so the text a name was interned from may go away, as a streamed
+// parse's buffer does. Not thread-safe; use one per parse at a time. Its
+// entries come from the given memory resource, so a parse can keep them in
+// a buffer on its stack, or the cache can outlive the parse to serve the
+// next one.
+class QmlAtomCache {
+public:
+    QmlAtomCache() = default;
+    explicit QmlAtomCache(std::pmr::memory_resource *resource) : cache_(resource) {}
+
+    QmlAtom intern(std::string_view name) {
+        if (const QmlAtom atom = QmlAtoms::predefined(name)) {
+            return atom;
+        }
+        const auto it = cache_.find(name);
+        if (it != cache_.end()) {
+            return it->second;
+        }
+        std::string_view stored;
+        const QmlAtom atom = table_.intern(name, stored);
+        cache_.emplace(stored, atom);
+        return atom;
+    }
+
+    size_t size() const { return cache_.size(); }
+
+private:
+    QmlAtomTable &table_ = QmlAtomTable::global();
+    std::pmr::unordered_map<std::string_view, QmlAtom> cache_;
+};
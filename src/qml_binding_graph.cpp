@@ -0,0 +1,146 @@
+#include "qml_binding_graph.h"
+
+#include "qml_parser.h"
+
+namespace {
+
+template <typename Visit>
+void forEachNode(const QmlNode &node, Visit &visit) {
+    visit(node);
+    for (const QmlNode &child : node.children) {
+        forEachNode(child, visit);
+    }
+}
+
+}  // namespace
+
+void QmlBindingGraph::clear() {
+    vertices_.clear();
+    order_.clear();
+    byKey_.clear();
+    readers_.clear();
+    changed_.clear();
+    queued_.clear();
+    visited_.clear();
+    ready_ = {};
+}
+
+void QmlBindingGraph::build(const QmlDocument &document, QmlExpressionProgram &program) {
+    clear();
+    QmlAtomTable &atoms = QmlAtomTable::global();
+    const auto addVertices = [&](const QmlNode &node) {
+        const QmlAtom object = node.id.empty() ? QmlAtoms::Invalid : atoms.intern(node.id);
+        for (const QmlProperty &property : node.properties) {
+            if (property.typed.kind != QmlValueKind::Binding || property.key == QmlAtoms::id) {
+                continue;
+            }
+            const uint32_t expression = program.compile(property.value);
+            if (expression == QmlExpressionProgram::kInvalid) {
+                continue;
+            }
+            Vertex vertex;
+            vertex.node = &node;
+            vertex.object = object;
+            vertex.property = property.key;
+            vertex.binding = &property.value;
+            vertex.expression = expression;
+            if (object != QmlAtoms::Invalid) {
+                byKey_.emplace(key(object, property.key), static_cast<uint32_t>(vertices_.size()));
+            }
+            vertices_.push_back(vertex);
+        }
+    };
+    for (const QmlNode &root : document.roots) {
+        forEachNode(root, addVertices);
+    }
+
+    // Kahn's algorithm over the vertex-to-vertex edges; reads of outside
+    // sources only feed readers_.
+    std::vector<uint32_t> inputs(vertices_.size(), 0);
+    std::vector<std::vector<uint32_t>> dependents(vertices_.size());
+    std::vector<std::pair<QmlAtom, QmlAtom>> reads;
+    for (uint32_t v = 0; v < vertices_.size(); ++v) {
+        reads.clear();
+        program.dependencies(vertices_[v].expression, reads);
+        for (const auto &read : reads) {
+            std::vector<uint32_t> &readers = readers_[key(read.first, read.second)];
+            if (!readers.empty() && readers.back() == v) {
+                continue;  // the same value read twice
+            }
+            readers.push_back(v);
+            const auto source = byKey_.find(key(read.first, read.second));
+            if (source != byKey_.end()) {
+                dependents[source->second].push_back(v);
+                ++inputs[v];
+            }
+        }
+    }
+    order_.reserve(vertices_.size());
+    for (uint32_t v = 0; v < vertices_.size(); ++v) {
+        if (inputs[v] == 0) {
+            order_.push_back(v);
+        }
+    }
+    for (size_t i = 0; i < order_.size(); ++i) {
+        for (const uint32_t dependent : dependents[order_[i]]) {
+            if (--inputs[dependent] == 0) {
+                order_.push_back(dependent);
+            }
+        }
+    }
+    for (uint32_t v = 0; v < vertices_.size(); ++v) {
+        if (inputs[v] > 0) {
+            order_.push_back(v);  // on a cycle
+        }
+    }
+    for (uint32_t rank = 0; rank < order_.size(); ++rank) {
+        vertices_[order_[rank]].rank = rank;
+    }
+    queued_.assign(vertices_.size(), false);
+}
+
+uint32_t QmlBindingGraph::find(QmlAtom object, QmlAtom property) const {
+    const auto it = byKey_.find(key(object, property));
+    return it == byKey_.end() ? kNone : it->second;
+}
+
+void QmlBindingGraph::changed(QmlAtom object, QmlAtom member) {
+    changed_.push_back(key(object, member));
+}
+
+void QmlBindingGraph::enqueue(uint64_t source) {
+    const auto readers = readers_.find(source);
+    if (readers == readers_.end()) {
+        return;
+    }
+    for (const uint32_t v : readers->second) {
+        if (!queued_[v]) {
+            queued_[v] = true;
+            ready_.emplace(vertices_[v].rank, v);
+        }
+    }
+}
+
+size_t QmlBindingGraph::propagate(const std::function<bool(uint32_t vertex)> &reevaluate) {
+    for (const uint64_t source : changed_) {
+        enqueue(source);
+    }
+    changed_.clear();
+
+    // Popping in rank order means every input of a vertex has settled
+    // before the vertex itself is evaluated. A vertex is visited at most
+    // once per batch, which also bounds cycles.
+    visited_.clear();
+    while (!ready_.empty()) {
+        const uint32_t v = ready_.top().second;
+        ready_.pop();
+        visited_.push_back(v);
+        if (reevaluate(v) && vertices_[v].object != QmlAtoms::Invalid) {
+            enqueue(key(vertices_[v].object, vertices_[v].property));
+        }
+    }
+    for (const uint32_t v : visited_) {
+        queued_[v] = false;
+    }
+    return visited_.size();
+}
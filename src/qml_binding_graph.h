@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "qml_atoms.h"
+#include "qml_expression.h"
+
+class QmlDocument;
+struct QmlNode;
+
+// Which property bindings of a document read which values, for
+// re-evaluating only what a change affects. Every Binding-valued property
+// is a vertex; it depends on each name.member its expression reads, which
+// is either another vertex (an id in the document) or an outside source
+// such as greeter.message. Vertices are ranked topologically when the
+// graph is built, so a batch of changes is propagated in rank order and
+// each affected binding is evaluated once, after all of its inputs
+// (no glitches from half-updated intermediate values). Bindings on a
+// dependency cycle are ranked after everything else.
+class QmlBindingGraph {
+public:
+    struct Vertex {
+        const QmlNode *node = nullptr;
+        QmlAtom object = QmlAtoms::Invalid;  // the node's id; Invalid if it has none
+        QmlAtom property = QmlAtoms::Invalid;
+        const std::string *binding = nullptr;  // the expression text, in the document
+        uint32_t expression = QmlExpressionProgram::kInvalid;
+        uint32_t rank = 0;
+    };
+
+    // Compiles every binding in document into program. The document must
+    // outlive the graph or be rebuilt first.
+    void build(const QmlDocument &document, QmlExpressionProgram &program);
+    void clear();
+
+    size_t vertexCount() const { return vertices_.size(); }
+    const Vertex &vertex(uint32_t index) const { return vertices_[index]; }
+    // Vertices in an order that evaluates each one after its inputs.
+    const std::vector<uint32_t> &topologicalOrder() const { return order_; }
+    // Index of the binding on object.property, or kNone.
+    static constexpr uint32_t kNone = UINT32_MAX;
+    uint32_t find(QmlAtom object, QmlAtom property) const;
+
+    // Records that object.member changed. Changes are batched until
+    // propagate().
+    void changed(QmlAtom object, QmlAtom member);
+    bool hasChanges() const { return !changed_.empty(); }
+
+    // Calls reevaluate(index) for each binding downstream of the recorded
+    // changes, in rank order. It returns whether the binding's value
+    // changed; the bindings that read an unchanged value are skipped.
+    // Returns the number of bindings re-evaluated.
+    size_t propagate(const std::function<bool(uint32_t vertex)> &reevaluate);
+
+private:
+    static uint64_t key(QmlAtom object, QmlAtom member) { return (uint64_t(object) << 32) | member; }
+    void enqueue(uint64_t source);
+
+    std::vector<Vertex> vertices_;
+    std::vector<uint32_t> order_;
+    std::unordered_map<uint64_t, uint32_t> byKey_;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> readers_;  // source -> vertices reading it
+    std::vector<uint64_t> changed_;
+    std::vector<bool> queued_;
+    std::vector<uint32_t> visited_;
+    std::priority_queue<std::pair<uint32_t, uint32_t>, std::vector<std::pair<uint32_t, uint32_t>>,
+                        std::greater<std::pair<uint32_t, uint32_t>>>
+        ready_;  // (rank, vertex)
+};
@@ -0,0 +1,105 @@
+#include "qml_buffer_screen.h"
+
+#include <curses.h>
+#include <string>
+
+#include "qml_color_pairs.h"
+
+namespace {
+
+// As in VtScreen: curses attribute bits and the SGR parameters for them.
+struct SgrCode {
+    chtype attribute;
+    char parameter;
+};
+constexpr SgrCode kSgrCodes[] = {
+    {A_BOLD, '1'}, {A_DIM, '2'}, {A_UNDERLINE, '4'}, {A_BLINK, '5'}, {A_REVERSE, '7'}, {A_STANDOUT, '7'},
+};
+
+// Sets the attributes from scratch, so each change reads on its own.
+void appendSgr(std::string &out, uint32_t attributes) {
+    out.append("\x1b[0");
+    char last = 0;
+    for (const auto &mapping : kSgrCodes) {
+        if ((attributes & mapping.attribute) != 0 && mapping.parameter != last) {
+            out.push_back(';');
+            out.push_back(mapping.parameter);
+            last = mapping.parameter;
+        }
+    }
+    int foreground;
+    int background;
+    if (QmlColorPairs::global().colors(static_cast<uint32_t>(PAIR_NUMBER(attributes)), foreground, background)) {
+        for (const int parameter : {foreground < 0 ? 0 : QmlColorPairs::sgrForeground(foreground),
+                                    background < 0 ? 0 : QmlColorPairs::sgrBackground(background)}) {
+            if (parameter != 0) {
+                out.push_back(';');
+                out.append(std::to_string(parameter));
+            }
+        }
+    }
+    out.push_back('m');
+}
+
+}  // namespace
+
+void QmlBufferScreen::drawText(int row, int col, const std::string &text) {
+    cells_.put(row, col, text);
+}
+
+void QmlBufferScreen::drawStyledText(int row, int col, const std::string &text, uint32_t attributes) {
+    cells_.put(row, col, text, attributes);
+}
+
+void QmlBufferScreen::drawRuns(const ScreenRun *runs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        cells_.put(runs[i].row, runs[i].col, runs[i].text, runs[i].attributes);
+    }
+}
+
+std::string QmlBufferScreen::row(int row) const {
+    std::string out;
+    appendRow(out, row, false);
+    return out;
+}
+
+std::string QmlBufferScreen::text() const {
+    std::string out;
+    out.reserve(static_cast<size_t>(rows()) * (cols() + 1));
+    for (int row = 0; row < rows(); ++row) {
+        appendRow(out, row, false);
+        out.push_back('\n');
+    }
+    return out;
+}
+
+std::string QmlBufferScreen::ansi() const {
+    std::string out;
+    out.reserve(static_cast<size_t>(rows()) * (cols() + 8));
+    for (int row = 0; row < rows(); ++row) {
+        appendRow(out, row, true);
+        out.push_back('\n');
+    }
+    return out;
+}
+
+void QmlBufferScreen::appendRow(std::string &out, int row, bool styled) const {
+    const QmlCell *cells = cells_.row(row);
+    int end = cols();
+    while (end > 0 && cells[end - 1].glyph == ' ' && (!styled || cells[end - 1].attributes == 0)) {
+        --end;
+    }
+    uint32_t attributes = 0;
+    for (int col = 0; col < end; ++col) {
+        if (styled && cells[col].attributes != attributes) {
+            attributes = cells[col].attributes;
+            appendSgr(out, attributes);
+        }
+        for (uint32_t glyph = cells[col].glyph; glyph != 0; glyph >>= 8) {
+            out.push_back(static_cast<char>(glyph & 0xFF));
+        }
+    }
+    if (attributes != 0) {
+        out.append("\x1b[0m");
+    }
+}
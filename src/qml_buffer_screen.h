@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "qml_cell_grid.h"
+#include "qml_curses_frontend.h"
+
+// ICursesScreen that renders into memory: no terminal and no curses calls,
+// so it works without initscr() and costs no more than composing the
+// cells. After a frame, text() or ansi() reads the screen back, for
+// snapshots, logs and batch jobs.
+class QmlBufferScreen : public ICursesScreen {
+public:
+    QmlBufferScreen(int rows, int cols) { cells_.resize(rows, cols); }
+
+    void clear() override { cells_.clear(); }
+    void drawText(int row, int col, const std::string &text) override;
+    void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override;
+    void drawRuns(const ScreenRun *runs, size_t count) override;
+    bool scrollRows(int top, int bottom, int count) override {
+        cells_.scrollRows(top, bottom, count);
+        return true;
+    }
+    void refresh() override { ++refreshes_; }
+    int rows() const override { return cells_.rows(); }
+    int cols() const override { return cells_.cols(); }
+
+    // Blanks the screen at the new size; the frontend repaints it all.
+    void resize(int rows, int cols) { cells_.resize(rows, cols); }
+    const QmlCellPad &cells() const { return cells_; }
+    size_t byteSize() const { return cells_.byteSize(); }
+    size_t refreshes() const { return refreshes_; }
+
+    // One row as UTF-8, without trailing blanks.
+    std::string row(int row) const;
+    // Every row, each ending in a newline.
+    std::string text() const;
+    // As text(), with SGR sequences for the cells' attributes; styled
+    // trailing blanks are kept and each styled line ends with a reset.
+    std::string ansi() const;
+
+private:
+    void appendRow(std::string &out, int row, bool styled) const;
+
+    QmlCellPad cells_;
+    size_t refreshes_ = 0;
+};
@@ -0,0 +1,306 @@
+#include "qml_bundle.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "qml_ast_cache.h"
+#include "qml_trace.h"
+
+namespace {
+
+constexpr char kMagic[4] = {'Q', 'M', 'L', 'B'};
+
+struct Header {
+    char magic[4];
+    uint32_t formatVersion;
+    uint32_t memberCount;
+    uint32_t nameBytes;
+    uint64_t fileSize;
+    uint64_t indexHash;  // of the index records and the names
+};
+
+// Offsets are from the start of the bundle.
+struct IndexRecord {
+    uint64_t nameHash;
+    uint32_t nameOffset;  // into the names
+    uint32_t nameSize;
+    uint64_t sourceOffset;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t treeOffset;
+    uint64_t treeSize;
+};
+
+static_assert(sizeof(Header) == 32 && sizeof(IndexRecord) == 56, "bundle sections are packed by hand");
+
+template <typename T>
+T decode(const char *at) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void append(std::string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void padToPage(std::string &out) {
+    out.resize((out.size() + QmlBundle::kPageSize - 1) / QmlBundle::kPageSize * QmlBundle::kPageSize, '\0');
+}
+
+bool within(uint64_t offset, uint64_t size, uint64_t limit) {
+    return offset <= limit && size <= limit - offset;
+}
+
+std::string normalized(std::string_view path) {
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+}  // namespace
+
+std::string QmlBundle::pack(const std::string &directory) {
+    const QmlTraceSpan span("QmlBundle::pack");
+    struct Entry {
+        std::string name;
+        std::string source;
+        std::string tree;
+        uint64_t nameHash = 0;
+        uint64_t sourceHash = 0;
+    };
+    std::vector<Entry> entries;
+    std::error_code error;
+    const std::filesystem::path root(directory);
+    for (std::filesystem::recursive_directory_iterator it(root, error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file(error) || it->path().extension() != ".qml") {
+            continue;
+        }
+        Entry entry;
+        entry.name = it->path().lexically_relative(root).generic_string();
+        MappedFile file;
+        if (!file.open(it->path().string())) {
+            throw std::runtime_error("Failed to read " + it->path().string());
+        }
+        entry.source.assign(file.view());
+        entries.push_back(std::move(entry));
+    }
+    if (error) {
+        throw std::runtime_error("Failed to list " + directory + ": " + error.message());
+    }
+
+    const QmlParser parser;
+    for (Entry &entry : entries) {
+        entry.nameHash = QmlAstCache::contentHash(entry.name);
+        entry.sourceHash = QmlAstCache::contentHash(entry.source);
+        entry.tree = QmlAstCache::serialize(parser.parseString(entry.source), entry.sourceHash, entry.source.size());
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.nameHash != b.nameHash ? a.nameHash < b.nameHash : a.name < b.name;
+    });
+
+    std::string names;
+    for (const Entry &entry : entries) {
+        names += entry.name;
+    }
+    const size_t indexBytes = entries.size() * sizeof(IndexRecord);
+    uint64_t offset = (sizeof(Header) + indexBytes + names.size() + kPageSize - 1) / kPageSize * kPageSize;
+    std::string index;
+    index.reserve(indexBytes + names.size());
+    uint32_t nameOffset = 0;
+    for (const Entry &entry : entries) {
+        IndexRecord record{};
+        record.nameHash = entry.nameHash;
+        record.nameOffset = nameOffset;
+        record.nameSize = static_cast<uint32_t>(entry.name.size());
+        record.sourceOffset = offset;
+        record.sourceSize = entry.source.size();
+        record.sourceHash = entry.sourceHash;
+        offset += (entry.source.size() + kPageSize - 1) / kPageSize * kPageSize;
+        record.treeOffset = offset;
+        record.treeSize = entry.tree.size();
+        offset += (entry.tree.size() + kPageSize - 1) / kPageSize * kPageSize;
+        nameOffset += record.nameSize;
+        append(index, record);
+    }
+    index += names;
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.formatVersion = kFormatVersion;
+    header.memberCount = static_cast<uint32_t>(entries.size());
+    header.nameBytes = static_cast<uint32_t>(names.size());
+    header.fileSize = offset;
+    header.indexHash = QmlAstCache::contentHash(index);
+
+    std::string out;
+    out.reserve(offset);
+    append(out, header);
+    out += index;
+    padToPage(out);
+    for (const Entry &entry : entries) {
+        out += entry.source;
+        padToPage(out);
+        out += entry.tree;
+        padToPage(out);
+    }
+    return out;
+}
+
+void QmlBundle::write(const std::string &directory, const std::string &path) {
+    const std::string bytes = pack(directory);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+QmlBundle::~QmlBundle() {
+    if (MappedFile::provider() == this) {
+        MappedFile::setProvider(next_);
+    }
+}
+
+bool QmlBundle::open(const std::string &path) {
+    const QmlTraceSpan span("QmlBundle::open");
+    file_.close();
+    mountPoint_.clear();
+    index_ = nullptr;
+    names_ = nullptr;
+    memberCount_ = 0;
+
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(Header)) {
+        return false;
+    }
+    const Header header = decode<Header>(file.data());
+    const uint64_t size = file.size();
+    const uint64_t indexBytes = static_cast<uint64_t>(header.memberCount) * sizeof(IndexRecord);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.formatVersion != kFormatVersion ||
+        header.fileSize != size || !within(sizeof(Header), indexBytes + header.nameBytes, size) ||
+        QmlAstCache::contentHash(file.view().substr(sizeof(Header), indexBytes + header.nameBytes)) !=
+            header.indexHash) {
+        return false;
+    }
+    // The index is checked once here, so that lookups need not.
+    const char *index = file.data() + sizeof(Header);
+    for (uint32_t i = 0; i < header.memberCount; ++i) {
+        const IndexRecord record = decode<IndexRecord>(index + i * sizeof(IndexRecord));
+        if (!within(record.nameOffset, record.nameSize, header.nameBytes) ||
+            !within(record.sourceOffset, record.sourceSize, size) || !within(record.treeOffset, record.treeSize, size)) {
+            return false;
+        }
+    }
+    file_ = std::move(file);
+    mountPoint_ = normalized(path);
+    index_ = file_.data() + sizeof(Header);
+    names_ = index_ + indexBytes;
+    memberCount_ = header.memberCount;
+    return true;
+}
+
+bool QmlBundle::find(std::string_view name, Member &member) const {
+    const uint64_t hash = QmlAstCache::contentHash(name);
+    size_t first = 0;
+    size_t count = memberCount_;
+    while (count > 0) {
+        const size_t half = count / 2;
+        if (decode<IndexRecord>(index_ + (first + half) * sizeof(IndexRecord)).nameHash < hash) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    for (; first < memberCount_; ++first) {
+        const IndexRecord record = decode<IndexRecord>(index_ + first * sizeof(IndexRecord));
+        if (record.nameHash != hash) {
+            break;
+        }
+        const std::string_view recordName(names_ + record.nameOffset, record.nameSize);
+        if (recordName == name) {
+            member.name = recordName;
+            member.source = std::string_view(file_.data() + record.sourceOffset, record.sourceSize);
+            member.tree = std::string_view(file_.data() + record.treeOffset, record.treeSize);
+            member.sourceHash = record.sourceHash;
+            return true;
+        }
+    }
+    return false;
+}
+
+QmlDocument QmlBundle::load(const std::string &path, bool *precompiled) const {
+    std::string name;
+    Member member;
+    if (!memberName(path, name) || !find(name, member)) {
+        throw std::runtime_error("No member " + path + " in the bundle " + mountPoint_);
+    }
+    QmlDocument document;
+    const bool hit = !member.tree.empty() &&
+                     QmlAstCache::deserialize(member.tree, member.sourceHash, member.source.size(), document);
+    if (!hit) {
+        document = QmlParser().parseString(member.source);
+    }
+    if (precompiled) {
+        *precompiled = hit;
+    }
+    return document;
+}
+
+void QmlBundle::install() {
+    const MappedFileProvider *current = MappedFile::provider();
+    if (current != this) {
+        next_ = current;
+        MappedFile::setProvider(this);
+    }
+}
+
+bool QmlBundle::memberName(std::string_view path, std::string &name) const {
+    if (mountPoint_.empty()) {
+        return false;
+    }
+    const std::string normal = normalized(path);
+    if (normal.size() <= mountPoint_.size() || normal.compare(0, mountPoint_.size(), mountPoint_) != 0 ||
+        normal[mountPoint_.size()] != '/') {
+        return false;
+    }
+    name.assign(normal, mountPoint_.size() + 1, std::string::npos);
+    return true;
+}
+
+bool QmlBundle::handles(std::string_view path) const {
+    std::string name;
+    return memberName(path, name) || (next_ && next_->handles(path));
+}
+
+bool QmlBundle::exists(const std::string &path) const {
+    std::string name;
+    if (!memberName(path, name)) {
+        return next_ && next_->exists(path);
+    }
+    Member member;
+    return find(name, member);
+}
+
+bool QmlBundle::read(const std::string &path, std::string_view &view, std::string &storage) const {
+    std::string name;
+    if (!memberName(path, name)) {
+        return next_ && next_->read(path, view, storage);
+    }
+    Member member;
+    if (!find(name, member)) {
+        return false;
+    }
+    if (member.source.empty()) {
+        storage.clear();  // an empty view means the bytes are in storage
+    }
+    view = member.source;
+    return true;
+}
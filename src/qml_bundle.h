@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "mapped_file.h"
+#include "qml_parser.h"
+
+// Many QML files packed into one, so that a deployment of hundreds of
+// screens and components costs one open and one mapping at startup rather
+// than an open and a read per file, which is what dominates cold starts
+// on network filesystems.
+//
+// A bundle is a header, an index of its members sorted by the hash of
+// their names, the names, and then each member's source and its
+// precompiled tree (an AST cache entry, see QmlAstCache), every one
+// starting on a page boundary. open() maps it and checks the index once;
+// a member is then found by a binary search of the hashes and read in
+// place from the mapping.
+//
+// Once install()ed, the bundle reads like a directory at its own path:
+// "dist/app.qmlb/Main.qml" is the member Main.qml of dist/app.qmlb, so
+// QmlParser::parseFile(), QmlProjectIndex and everything else that reads
+// through MappedFile take members without being told about bundles, and
+// components next to a screen are looked up inside the bundle.
+//
+//   QmlBundle::write("qml", "dist/app.qmlb");       // at build time
+//
+//   QmlBundle bundle;
+//   if (bundle.open("dist/app.qmlb")) {
+//       bundle.install();
+//       const QmlDocument main = bundle.load("dist/app.qmlb/Main.qml");
+//   }
+//
+// Sections are written in host byte order, as AST cache entries are; a
+// bundle from a host of the other byte order fails the magic check.
+class QmlBundle : public MappedFileProvider {
+public:
+    static constexpr uint32_t kFormatVersion = 1;
+    static constexpr size_t kPageSize = 4096;
+
+    struct Member {
+        std::string_view name;  // relative to the bundle, with '/' separators
+        std::string_view source;
+        std::string_view tree;  // an AST cache entry; empty if there is none
+        uint64_t sourceHash = 0;
+    };
+
+    // The bundle of every .qml file under directory, named by its path
+    // relative to it, each with its precompiled tree. Throws
+    // std::runtime_error if the directory or a file cannot be read.
+    static std::string pack(const std::string &directory);
+    // Writes pack(directory) to path; throws std::runtime_error on failure.
+    static void write(const std::string &directory, const std::string &path);
+
+    QmlBundle() = default;
+    ~QmlBundle() override;
+
+    QmlBundle(const QmlBundle &) = delete;
+    QmlBundle &operator=(const QmlBundle &) = delete;
+
+    // Maps the bundle at path. Returns false, leaving the bundle closed, if
+    // it cannot be read or is not a complete bundle of this format.
+    bool open(const std::string &path);
+    bool isOpen() const { return file_.isOpen(); }
+    // Where members are found, the bundle's path as opened.
+    const std::string &mountPoint() const { return mountPoint_; }
+    size_t memberCount() const { return memberCount_; }
+    // Whether path lies under mountPoint(), member or not.
+    bool contains(std::string_view path) const {
+        std::string name;
+        return memberName(path, name);
+    }
+
+    // By name relative to the bundle. The views point into the mapping.
+    bool find(std::string_view name, Member &member) const;
+    // The member at path, under mountPoint(), from its precompiled tree if
+    // it was built by this parser's grammar, else parsed from its source.
+    // precompiled reports which. Throws std::runtime_error if there is no
+    // such member.
+    QmlDocument load(const std::string &path, bool *precompiled = nullptr) const;
+
+    // Makes the bundle MappedFile's provider; paths outside it go on to
+    // the provider installed before, such as QmlQtResources. Members are
+    // read in place, so the bundle must stay open and alive while files
+    // opened from it are.
+    void install();
+
+    bool handles(std::string_view path) const override;
+    bool exists(const std::string &path) const override;
+    bool read(const std::string &path, std::string_view &view, std::string &storage) const override;
+
+private:
+    // The member name of path if it lies under mountPoint(), else false.
+    bool memberName(std::string_view path, std::string &name) const;
+
+    MappedFile file_;
+    std::string mountPoint_;
+    const char *index_ = nullptr;  // the first index record
+    const char *names_ = nullptr;
+    size_t memberCount_ = 0;
+    const MappedFileProvider *next_ = nullptr;
+};
@@ -0,0 +1,103 @@
+#include "qml_cache_budget.h"
+
+#include <algorithm>
+
+#include "qml_metrics.h"
+
+int QmlCacheBudget::attach(std::string name, double cost, Bytes bytes, Evict evict) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int id = nextId_++;
+    caches_.push_back(Cache{id, std::move(name), std::max(cost, 1e-9), std::move(bytes), std::move(evict)});
+    return id;
+}
+
+void QmlCacheBudget::detach(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    caches_.erase(std::remove_if(caches_.begin(), caches_.end(), [id](const Cache &cache) { return cache.id == id; }),
+                  caches_.end());
+}
+
+size_t QmlCacheBudget::limit() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_;
+}
+
+void QmlCacheBudget::setLimit(size_t limit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    limit_ = limit;
+}
+
+size_t QmlCacheBudget::used() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t used = 0;
+    for (const Cache &cache : caches_) {
+        used += cache.bytes();
+    }
+    return used;
+}
+
+size_t QmlCacheBudget::enforce() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_ == 0 ? 0 : trimTo(limit_);
+}
+
+size_t QmlCacheBudget::relieve(Pressure pressure) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pressure == Pressure::Critical) {
+        return trimTo(0);
+    }
+    size_t used = 0;
+    for (const Cache &cache : caches_) {
+        used += cache.bytes();
+    }
+    return trimTo((limit_ == 0 ? used : std::min(used, limit_)) / 2);
+}
+
+size_t QmlCacheBudget::trimTo(size_t target) {
+    std::vector<size_t> bytes(caches_.size());
+    std::vector<bool> spent(caches_.size());  // evicted nothing when asked
+    size_t used = 0;
+    for (size_t i = 0; i < caches_.size(); ++i) {
+        bytes[i] = caches_[i].bytes();
+        used += bytes[i];
+    }
+    size_t freed = 0;
+    while (used > target) {
+        size_t victim = caches_.size();
+        double worst = 0;
+        for (size_t i = 0; i < caches_.size(); ++i) {
+            const double weight = static_cast<double>(bytes[i]) / caches_[i].cost;
+            if (!spent[i] && bytes[i] > 0 && weight > worst) {
+                victim = i;
+                worst = weight;
+            }
+        }
+        if (victim == caches_.size()) {
+            break;
+        }
+        Cache &cache = caches_[victim];
+        const size_t evicted = cache.evict(std::min(used - target, bytes[victim]));
+        cache.evicted += evicted;
+        freed += evicted;
+        spent[victim] = evicted == 0;
+        used -= bytes[victim];
+        bytes[victim] = cache.bytes();
+        used += bytes[victim];
+    }
+    return freed;
+}
+
+void QmlCacheBudget::appendMetrics(QmlMetricsText &text) const {
+    using Type = QmlMetricsText::Type;
+    std::lock_guard<std::mutex> lock(mutex_);
+    text.family("qml_cache_limit_bytes", Type::Gauge, "Memory the caches may hold; 0 for no limit.", "bytes");
+    text.gauge(static_cast<double>(limit_));
+    text.family("qml_cache_bytes", Type::Gauge, "Memory each cache holds.", "bytes");
+    for (const Cache &cache : caches_) {
+        text.gauge(static_cast<double>(cache.bytes()), QmlMetricsText::label("cache", cache.name));
+    }
+    text.family("qml_cache_evicted_bytes", Type::Counter, "Memory freed by evicting cache entries.", "bytes");
+    for (const Cache &cache : caches_) {
+        text.counter(static_cast<double>(cache.evicted), QmlMetricsText::label("cache", cache.name));
+    }
+}
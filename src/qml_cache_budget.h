@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class QmlMetricsText;
+
+// One memory limit for several in-memory caches, so a long-running
+// process stays inside a fixed envelope however its caches grow. Each
+// cache is attached with a function reporting the bytes it holds and one
+// evicting its least recently used entries, and with a cost: how dear its
+// entries are to rebuild per byte, relative to the others. enforce() asks
+// each cache for its bytes and, while their sum is over the limit, evicts
+// from the cache holding the most bytes per unit of cost, so cheap entries
+// go before dear ones of the same size.
+//
+// The caches' functions run on the thread calling the budget, one call at
+// a time, so a cache that is not thread-safe must only be attached to a
+// budget used from its own thread; caches never call into the budget
+// themselves. A limit of 0 means none, and only relieve() evicts.
+// Thread-safe.
+class QmlCacheBudget {
+public:
+    using Bytes = std::function<size_t()>;
+    // Frees at least bytes if it can; returns the bytes freed.
+    using Evict = std::function<size_t(size_t bytes)>;
+
+    // How hard the system is pressed for memory, as the OS reports it.
+    enum class Pressure : uint8_t { Moderate, Critical };
+
+    explicit QmlCacheBudget(size_t limit = 0) : limit_(limit) {}
+
+    // Returns an id for detach(); cost must be positive.
+    int attach(std::string name, double cost, Bytes bytes, Evict evict);
+    void detach(int id);
+
+    size_t limit() const;
+    // Takes effect at the next enforce().
+    void setLimit(size_t limit);
+
+    // The bytes the caches hold now.
+    size_t used() const;
+    // Evicts until the caches fit the limit; returns the bytes freed.
+    size_t enforce();
+    // Answers an OS memory-pressure signal: moderate pressure trims the
+    // caches to half of what the limit, or their size if smaller, allows,
+    // and critical pressure empties them. Returns the bytes freed.
+    size_t relieve(Pressure pressure);
+
+    // Per cache: qml_cache_bytes and qml_cache_evicted_bytes, labelled
+    // with its name, and the budget's qml_cache_limit_bytes.
+    void appendMetrics(QmlMetricsText &text) const;
+
+private:
+    struct Cache {
+        int id;
+        std::string name;
+        double cost;
+        Bytes bytes;
+        Evict evict;
+        uint64_t evicted = 0;  // bytes, over the budget's life
+    };
+
+    size_t trimTo(size_t target);
+
+    // Held while calling the caches' functions.
+    mutable std::mutex mutex_;
+    std::vector<Cache> caches_;
+    size_t limit_;
+    int nextId_ = 1;
+};
@@ -0,0 +1,364 @@
+#include "qml_cell_grid.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+
+#include "qml_text_width.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define QML_GRID_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QML_GRID_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define QML_GRID_NEON 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+void QmlCellGrid::resize(int rows, int cols) {
+    rows_ = std::max(0, rows);
+    cols_ = std::max(0, cols);
+    front_.assign(static_cast<size_t>(rows_) * cols_, QmlCell{});
+    back_.assign(front_.size(), QmlCell{});
+    frontHashes_.assign(static_cast<size_t>(rows_), 0);
+    backHashes_.assign(static_cast<size_t>(rows_), 0);
+    blankHash_ = rows_ > 0 ? rowHash(front_.data()) : 0;
+    frontValid_ = false;
+    scrollable_ = true;
+}
+
+void QmlCellGrid::clear() {
+    std::fill(back_.begin(), back_.end(), QmlCell{});
+}
+
+namespace {
+
+static_assert(sizeof(QmlCell) == 8, "the row kernels compare a cell as two 32-bit words");
+
+#if defined(QML_GRID_AVX2) || defined(QML_GRID_SSE2)
+int countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Index of the first of count cells where a and b differ, or count if none
+// does. Compares four cells a step with AVX2, two with SSE2 or NEON; a row
+// of a wide terminal is a few dozen steps.
+size_t firstDifference(const QmlCell *a, const QmlCell *b, size_t count) {
+    size_t i = 0;
+#if defined(QML_GRID_AVX2)
+    for (; i + 4 <= count; i += 4) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        const uint32_t equal = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi32(x, y)));
+        if (equal != 0xFFFFFFFFu) {
+            return i + static_cast<size_t>(countTrailingZeros(~equal)) / sizeof(QmlCell);
+        }
+    }
+#elif defined(QML_GRID_SSE2)
+    for (; i + 2 <= count; i += 2) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        const uint32_t equal = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi32(x, y)));
+        if (equal != 0xFFFFu) {
+            return i + static_cast<size_t>(countTrailingZeros(~equal)) / sizeof(QmlCell);
+        }
+    }
+#elif defined(QML_GRID_NEON)
+    for (; i + 2 <= count; i += 2) {
+        const uint32x4_t x = vld1q_u32(reinterpret_cast<const uint32_t *>(a + i));
+        const uint32x4_t y = vld1q_u32(reinterpret_cast<const uint32_t *>(b + i));
+        if (vminvq_u32(vceqq_u32(x, y)) == 0) {
+            break;  // the scalar loop finds which of the two
+        }
+    }
+#endif
+    while (i < count && a[i] == b[i]) {
+        ++i;
+    }
+    return i;
+}
+
+// Moves whole rows of a rows x cols page within top..bottom - 1 and blanks
+// the rows uncovered; shared by the grid and the pad.
+void scrollPage(std::vector<QmlCell> &cells, int rows, int cols, int top, int bottom, int count) {
+    top = std::max(0, top);
+    bottom = std::min(rows, bottom);
+    if (count == 0 || top >= bottom) {
+        return;
+    }
+    count = std::clamp(count, top - bottom, bottom - top);
+    const int moved = bottom - top - std::abs(count);
+    const auto at = [&cells, cols](int row) { return cells.begin() + static_cast<ptrdiff_t>(row) * cols; };
+    if (count > 0) {
+        std::copy(at(top + count), at(top + count + moved), at(top));
+        std::fill(at(top + moved), at(bottom), QmlCell{});
+    } else {
+        std::copy_backward(at(top), at(top + moved), at(bottom));
+        std::fill(at(top), at(bottom - moved), QmlCell{});
+    }
+}
+
+// Writes text into one row of cols cells; shared by the grid and the pad.
+int putLine(QmlCell *line, int cols, int col, std::string_view text, uint32_t attributes) {
+    const int start = col;
+    // Overwriting either half of a wide character blanks the other half.
+    const auto set = [cols, line](int at, QmlCell cell) {
+        if (at > 0 && line[at].glyph == QmlCell::kContinuation) {
+            line[at - 1].glyph = ' ';
+        }
+        if (at + 1 < cols && line[at + 1].glyph == QmlCell::kContinuation) {
+            line[at + 1].glyph = ' ';
+        }
+        line[at] = cell;
+    };
+
+    int lastCell = -1;  // where a following zero-width character attaches
+    for (size_t pos = 0; pos < text.size();) {
+        uint32_t codePoint = 0;
+        const size_t length = QmlTextWidth::decode(text, pos, codePoint);
+        const int width = QmlTextWidth::codePoint(codePoint);
+        uint32_t glyph = 0;
+        if (codePoint == 0xFFFD && length == 1) {
+            glyph = '?';  // malformed byte; keeps the output valid UTF-8
+        } else {
+            for (size_t i = 0; i < length; ++i) {
+                glyph |= uint32_t(static_cast<unsigned char>(text[pos + i])) << (8 * i);
+            }
+        }
+        pos += length;
+
+        if (width == 0) {
+            if (lastCell >= 0 && codePoint >= 0x20) {
+                uint32_t &target = line[lastCell].glyph;
+                int used = 1;
+                while (used < 4 && ((target >> (8 * used)) & 0xFF) != 0) {
+                    ++used;
+                }
+                if (used + static_cast<int>(length) <= 4) {
+                    target |= glyph << (8 * used);
+                }
+            }
+            continue;
+        }
+
+        lastCell = -1;
+        if (col >= 0 && col + width <= cols) {
+            if (width == 2) {
+                set(col + 1, QmlCell{' ', attributes});
+            }
+            set(col, QmlCell{glyph, attributes});
+            if (width == 2) {
+                line[col + 1] = QmlCell{QmlCell::kContinuation, attributes};
+            }
+            lastCell = col;
+        } else if (width == 2 && (col + 1 == cols || col == -1)) {
+            // Half of the character is clipped; the visible half is blank.
+            set(col < 0 ? 0 : col, QmlCell{' ', attributes});
+        }
+        col += width;
+    }
+    return col - start;
+}
+
+}  // namespace
+
+int QmlCellGrid::put(int row, int col, std::string_view text, uint32_t attributes) {
+    if (row < 0 || row >= rows_) {
+        return QmlTextWidth::of(text);
+    }
+    return putLine(&back_[index(row, 0)], cols_, col, text, attributes);
+}
+
+void QmlCellGrid::blit(const QmlCellPad &pad, int padRow, int row, int rows) {
+    const int width = std::min(cols_, pad.cols());
+    for (int i = std::max(0, -row); i < rows && row + i < rows_; ++i) {
+        if (padRow + i < 0 || padRow + i >= pad.rows()) {
+            continue;
+        }
+        const QmlCell *source = pad.row(padRow + i);
+        std::copy(source, source + width, &back_[index(row + i, 0)]);
+    }
+}
+
+void QmlCellGrid::resetFront() {
+    std::fill(front_.begin(), front_.end(), QmlCell{});
+    std::fill(frontHashes_.begin(), frontHashes_.end(), blankHash_);
+    frontValid_ = true;
+}
+
+const char *QmlCellGrid::kernelName() {
+#if defined(QML_GRID_AVX2)
+    return "avx2";
+#elif defined(QML_GRID_SSE2)
+    return "sse2";
+#elif defined(QML_GRID_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+// A row equal to its front row has the front's hash, so only the rows that
+// changed are hashed; in most frames that is a few of them.
+void QmlCellGrid::hashBack() {
+    const size_t cols = static_cast<size_t>(cols_);
+    for (int row = 0; row < rows_; ++row) {
+        const QmlCell *back = &back_[index(row, 0)];
+        const bool same = firstDifference(&front_[index(row, 0)], back, cols) == cols;
+        backHashes_[row] = same ? frontHashes_[row] : rowHash(back);
+    }
+}
+
+// Tries every distance: back row r showing what front row r + count did
+// puts r in a band moved by count. A band's worth is the rows in it that
+// would otherwise be sent; matching rows that did not change, such as
+// blank ones, widen it but save nothing.
+QmlCellGrid::Band QmlCellGrid::findBand() const {
+    Band best;
+    int changed = 0;
+    for (int row = 0; row < rows_; ++row) {
+        changed += backHashes_[row] != frontHashes_[row];
+    }
+    if (changed < kMinScrollRows) {
+        return best;
+    }
+    int bestSaved = kMinScrollRows - 1;
+    for (int count = 1 - rows_; count < rows_; ++count) {
+        if (count == 0) {
+            continue;
+        }
+        const int first = std::max(0, -count);
+        const int last = std::min(rows_, rows_ - count);
+        int start = -1;
+        int saved = 0;
+        for (int row = first; row <= last; ++row) {
+            if (row < last && backHashes_[row] == frontHashes_[row + count]) {
+                if (start < 0) {
+                    start = row;
+                    saved = 0;
+                }
+                saved += backHashes_[row] != frontHashes_[row];
+                continue;
+            }
+            if (start >= 0 && saved > bestSaved) {
+                bestSaved = saved;
+                best = count > 0 ? Band{start, row + count, count} : Band{start + count, row, count};
+            }
+            start = -1;
+        }
+    }
+    return best;
+}
+
+void QmlCellGrid::scrollFront(const Band &band) {
+    scrollPage(front_, rows_, cols_, band.top, band.bottom, band.count);
+    const int moved = band.bottom - band.top - std::abs(band.count);
+    const auto hashes = frontHashes_.begin();
+    if (band.count > 0) {
+        std::copy(hashes + band.top + band.count, hashes + band.bottom, hashes + band.top);
+        std::fill(hashes + band.top + moved, hashes + band.bottom, blankHash_);
+    } else {
+        std::copy_backward(hashes + band.top, hashes + band.top + moved, hashes + band.bottom);
+        std::fill(hashes + band.top, hashes + band.bottom - moved, blankHash_);
+    }
+}
+
+// Multiply-rotate hash over the cells' two words. A collision would hide a
+// changed row, which 64 bits make negligible for screen-sized rows.
+uint64_t QmlCellGrid::rowHash(const QmlCell *cells) const {
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for (int col = 0; col < cols_; ++col) {
+        const uint64_t word = (uint64_t(cells[col].attributes) << 32) | cells[col].glyph;
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+void QmlCellGrid::collectRuns() {
+    runText_.clear();
+    runText_.reserve(back_.size() * 4);
+    runs_.clear();
+    runCells_ = 0;
+    for (int row = 0; row < rows_; ++row) {
+        QmlCell *front = &front_[index(row, 0)];
+        const QmlCell *back = &back_[index(row, 0)];
+        const uint64_t hash = backHashes_[row];
+        if (hash == frontHashes_[row]) {
+            continue;
+        }
+        frontHashes_[row] = hash;
+        int col = 0;
+        while (col < cols_) {
+            col += static_cast<int>(firstDifference(front + col, back + col, static_cast<size_t>(cols_ - col)));
+            if (col == cols_) {
+                break;
+            }
+
+            // Extend the run over changed cells and short unchanged gaps
+            // with the same attributes. Runs start and end on whole
+            // characters, never inside a wide one.
+            int start = col;
+            if (start > 0 && back[start].glyph == QmlCell::kContinuation) {
+                --start;
+            }
+            const uint32_t attributes = back[start].attributes;
+            int end = col + 1;
+            for (int next = end; next < cols_ && next - end <= kMaxGap && back[next].attributes == attributes; ++next) {
+                if (front[next] != back[next]) {
+                    end = next + 1;
+                }
+            }
+            while (end < cols_ && back[end].glyph == QmlCell::kContinuation) {
+                ++end;
+            }
+
+            const size_t offset = runText_.size();
+            for (int i = start; i < end; ++i) {
+                for (uint32_t glyph = back[i].glyph; glyph != 0; glyph >>= 8) {
+                    runText_.push_back(static_cast<char>(glyph & 0xFF));
+                }
+            }
+            runs_.push_back(
+                ScreenRun{row, start, std::string_view(runText_).substr(offset), attributes, end - start});
+            runCells_ += static_cast<size_t>(end - start);
+            col = end;
+        }
+        std::copy(back, back + cols_, front);
+    }
+}
+
+void QmlCellPad::resize(int rows, int cols) {
+    rows_ = std::max(0, rows);
+    cols_ = std::max(0, cols);
+    cells_.assign(static_cast<size_t>(rows_) * cols_, QmlCell{});
+}
+
+void QmlCellPad::clear() {
+    std::fill(cells_.begin(), cells_.end(), QmlCell{});
+}
+
+int QmlCellPad::put(int row, int col, std::string_view text, uint32_t attributes) {
+    if (row < 0 || row >= rows_) {
+        return QmlTextWidth::of(text);
+    }
+    return putLine(&cells_[static_cast<size_t>(row) * cols_], cols_, col, text, attributes);
+}
+
+void QmlCellPad::scrollRows(int top, int bottom, int count) {
+    scrollPage(cells_, rows_, cols_, top, bottom, count);
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Span of same-attribute text for ICursesScreen::drawRuns().
+struct ScreenRun {
+    int row = 0;
+    int col = 0;
+    std::string_view text;    // UTF-8
+    uint32_t attributes = 0;  // curses A_* bits
+    int width = -1;           // in cells; -1 if not known
+};
+
+// One terminal cell. glyph packs the cell's UTF-8 bytes, first byte
+// lowest, so the common cell is compared as two integers. A character two
+// cells wide sits in its first cell; the second holds kContinuation.
+struct QmlCell {
+    static constexpr uint32_t kContinuation = 0;
+
+    uint32_t glyph = ' ';
+    uint32_t attributes = 0;  // curses A_* bits
+
+    bool operator==(const QmlCell &other) const { return glyph == other.glyph && attributes == other.attributes; }
+    bool operator!=(const QmlCell &other) const { return !(*this == other); }
+};
+
+// Off-screen page of cells that can be taller than the screen, like a
+// curses pad. Content is composed into it once; each frame copies a
+// window of its rows into a QmlCellGrid, so scrolling costs a copy
+// rather than a re-layout.
+class QmlCellPad {
+public:
+    // Resizing blanks every cell.
+    void resize(int rows, int cols);
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+    void clear();
+    // As QmlCellGrid::put().
+    int put(int row, int col, std::string_view text, uint32_t attributes = 0);
+    const QmlCell *row(int row) const { return &cells_[static_cast<size_t>(row) * cols_]; }
+    // As ICursesScreen::scrollRows(), clipped to the pad.
+    void scrollRows(int top, int bottom, int count);
+    // Heap bytes held, for memory accounting.
+    size_t byteSize() const { return cells_.capacity() * sizeof(QmlCell); }
+
+private:
+    int rows_ = 0;
+    int cols_ = 0;
+    std::vector<QmlCell> cells_;
+};
+
+// Off-screen copy of the terminal. Frames are composed into the back
+// buffer; flush() compares it with the front buffer (what the terminal
+// shows) and sends only the runs of cells that differ. Rows are compared
+// several cells at a time with SIMD (see kernelName()): an unchanged row
+// costs one pass over its cells and no copy, a changed one is skipped to
+// its differing spans, and a frame whose rows all match sends nothing at
+// all. Each front row also keeps a hash of its cells, which shows rows that
+// moved: when a band of rows reappears a few rows up or down, as in a
+// tailed log, the screen is asked to scroll the band (see
+// ICursesScreen::scrollRows()) and only the rows uncovered are sent. Bands
+// span whole rows, so a pane scrolling beside unchanged content is still
+// redrawn.
+class QmlCellGrid {
+public:
+    // Resizing forgets the front buffer, so the next flush repaints all.
+    void resize(int rows, int cols);
+    // For when something else has drawn on the screen: the next flush
+    // clears it and sends the whole back buffer, as after resize().
+    void forgetFront() { frontValid_ = false; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+    // Blanks the back buffer.
+    void clear();
+    // Writes UTF-8 text into the back buffer, clipped to the grid, one
+    // cell per column of display width (see QmlTextWidth). Zero-width
+    // characters join the previous cell while it has room for their bytes
+    // and are dropped otherwise. Returns the number of columns advanced,
+    // including any clipped off.
+    int put(int row, int col, std::string_view text, uint32_t attributes = 0);
+    const QmlCell &at(int row, int col) const { return back_[index(row, col)]; }
+    void set(int row, int col, QmlCell cell) { back_[index(row, col)] = cell; }
+    // Copies rows rows of pad, starting at padRow, into the back buffer
+    // starting at row. Rows outside either are skipped.
+    void blit(const QmlCellPad &pad, int padRow, int row, int rows);
+
+    // Sends the differences to screen and records the back buffer as the
+    // new front, handing all runs to the screen in one drawRuns() call.
+    // Returns the number of cells written. After resize() the
+    // screen is cleared first and only non-blank cells are written.
+    // Screen is ICursesScreen or a concrete screen type, which is then
+    // called without virtual dispatch.
+    template <typename Screen>
+    size_t flush(Screen &screen) {
+        if (!frontValid_) {
+            // The terminal's contents are unknown; start from a blank screen.
+            screen.clear();
+            resetFront();
+        }
+        // Changed rows are copied to the front as they are collected. The
+        // back buffer keeps the frame, so the next one can either clear()
+        // and redraw everything or patch a few cells.
+        hashBack();
+        if (scrollable_) {
+            const Band band = findBand();
+            if (band.count != 0) {
+                if (screen.scrollRows(band.top, band.bottom, band.count)) {
+                    scrollFront(band);
+                    ++scrollCount_;
+                } else {
+                    scrollable_ = false;  // until resize(); the screen cannot scroll
+                }
+            }
+        }
+        collectRuns();
+        ++flushCount_;
+        if (runs_.empty()) {
+            ++identicalFlushCount_;
+        } else {
+            screen.drawRuns(runs_.data(), runs_.size());
+        }
+        return runCells_;
+    }
+
+    // Flushes since construction, and those whose row hashes all matched.
+    // False after resize() or forgetFront(), until the next flush clears
+    // the screen.
+    bool frontValid() const { return frontValid_; }
+    // Runs and bytes of UTF-8 text the last flush sent.
+    size_t runsLastFlush() const { return runs_.size(); }
+    size_t bytesLastFlush() const { return runText_.size(); }
+    size_t flushCount() const { return flushCount_; }
+    size_t identicalFlushCount() const { return identicalFlushCount_; }
+    // Flushes that scrolled the screen before sending their runs.
+    size_t scrollCount() const { return scrollCount_; }
+    // Name of the row comparison kernel compiled into this build.
+    static const char *kernelName();
+    // Heap bytes held by both buffers, their hashes and the flush scratch,
+    // for memory accounting.
+    size_t byteSize() const {
+        return (front_.capacity() + back_.capacity()) * sizeof(QmlCell) +
+               (frontHashes_.capacity() + backHashes_.capacity()) * sizeof(uint64_t) + runText_.capacity() +
+               runs_.capacity() * sizeof(ScreenRun);
+    }
+
+private:
+    // Unchanged cells between two changed runs are resent rather than
+    // splitting the run; a cursor move costs more than a few characters.
+    static constexpr int kMaxGap = 3;
+    // Changed rows a scroll must save before it is worth its escape
+    // sequences and the cursor moves after it.
+    static constexpr int kMinScrollRows = 2;
+
+    // Rows top to bottom - 1 moved up by count, or down when negative.
+    struct Band {
+        int top = 0;
+        int bottom = 0;
+        int count = 0;  // 0 when nothing moved
+    };
+
+    void resetFront();
+    void hashBack();
+    // The band whose scroll leaves the most changed rows matching.
+    Band findBand() const;
+    void scrollFront(const Band &band);
+    // Fills runs_ with the cells that differ between front and back, and
+    // brings the front and its row hashes up to date.
+    void collectRuns();
+    uint64_t rowHash(const QmlCell *cells) const;
+
+    size_t index(int row, int col) const { return static_cast<size_t>(row) * static_cast<size_t>(cols_) + col; }
+
+    int rows_ = 0;
+    int cols_ = 0;
+    bool frontValid_ = false;
+    bool scrollable_ = true;
+    std::vector<QmlCell> front_;
+    std::vector<QmlCell> back_;
+    std::vector<uint64_t> frontHashes_;
+    std::vector<uint64_t> backHashes_;  // per flush
+    uint64_t blankHash_ = 0;
+    // Per-flush scratch, kept to reuse its capacity. runText_ is reserved
+    // for a full grid of four-byte glyphs up front so the runs' views stay
+    // valid.
+    std::string runText_;
+    std::vector<ScreenRun> runs_;
+    size_t runCells_ = 0;
+    size_t flushCount_ = 0;
+    size_t identicalFlushCount_ = 0;
+    size_t scrollCount_ = 0;
+};
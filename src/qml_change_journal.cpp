@@ -0,0 +1,94 @@
+#include "qml_change_journal.h"
+
+#include <algorithm>
+
+const QmlNode *QmlJournalChange::resolve(const QmlDocument &document) const {
+    const QmlNodeList *list = &document.roots;
+    const QmlNode *node = nullptr;
+    for (const size_t index : path) {
+        if (index >= list->size()) {
+            return nullptr;
+        }
+        node = &(*list)[index];
+        list = &node->children;
+    }
+    return node;
+}
+
+uint64_t QmlChangeJournal::record(const QmlDocument &before, const QmlDocument &after, const QmlDocumentDiff &diff) {
+    const uint64_t revision = ++revision_;
+    if (std::none_of(consumers_.begin(), consumers_.end(), [](uint64_t seen) { return seen != kUnsubscribed; })) {
+        trimmedThrough_ = revision;
+        return revision;
+    }
+    for (const QmlChange &change : diff.changes) {
+        const bool removed = change.kind == QmlChange::Kind::Removed;
+        const QmlNodePath path = removed ? QmlDocumentTransaction::pathOf(before, *change.oldNode)
+                                         : QmlDocumentTransaction::pathOf(after, *change.newNode);
+        append(revision, change.kind, change.property, path);
+    }
+    return revision;
+}
+
+bool QmlChangeJournal::changesSince(uint64_t since,
+                                    QmlFunctionRef<void(const QmlJournalChange &change)> visit) const {
+    if (since < trimmedThrough_) {
+        return false;
+    }
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), since,
+                               [](uint64_t revision, const Entry &entry) { return revision < entry.revision; });
+    QmlJournalChange change;
+    for (; it != entries_.end(); ++it) {
+        change.revision = it->revision;
+        change.kind = it->kind;
+        change.property = it->property;
+        const auto first = steps_.begin() + static_cast<std::ptrdiff_t>(it->pathBegin - stepsBase_);
+        change.path.assign(first, first + it->depth);
+        visit(change);
+    }
+    return true;
+}
+
+size_t QmlChangeJournal::subscribe() {
+    const auto free = std::find(consumers_.begin(), consumers_.end(), kUnsubscribed);
+    if (free != consumers_.end()) {
+        *free = revision_;
+        return static_cast<size_t>(free - consumers_.begin());
+    }
+    consumers_.push_back(revision_);
+    return consumers_.size() - 1;
+}
+
+void QmlChangeJournal::unsubscribe(size_t consumer) {
+    consumers_[consumer] = kUnsubscribed;
+    trim();
+}
+
+void QmlChangeJournal::acknowledge(size_t consumer, uint64_t revision) {
+    consumers_[consumer] = std::max(consumers_[consumer], std::min(revision, revision_));
+    trim();
+}
+
+void QmlChangeJournal::append(uint64_t revision, QmlChange::Kind kind, QmlAtom property, const QmlNodePath &path) {
+    entries_.push_back(Entry{revision, stepsBase_ + steps_.size(), static_cast<uint32_t>(path.size()), kind, property});
+    for (const size_t index : path) {
+        steps_.push_back(static_cast<uint32_t>(index));
+    }
+}
+
+void QmlChangeJournal::trim() {
+    uint64_t seen = revision_;
+    for (const uint64_t consumer : consumers_) {
+        if (consumer != kUnsubscribed) {
+            seen = std::min(seen, consumer);
+        }
+    }
+    while (!entries_.empty() && entries_.front().revision <= seen) {
+        const Entry &front = entries_.front();
+        const uint64_t pathEnd = front.pathBegin + front.depth;
+        steps_.erase(steps_.begin(), steps_.begin() + static_cast<std::ptrdiff_t>(pathEnd - stepsBase_));
+        stepsBase_ = pathEnd;
+        entries_.pop_front();
+    }
+    trimmedThrough_ = std::max(trimmedThrough_, seen);
+}
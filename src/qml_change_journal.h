@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "qml_diff.h"
+#include "qml_document_transaction.h"
+#include "qml_function_ref.h"
+
+// One journaled change. The node is named by its path rather than a
+// pointer, so the entry outlives the documents it was computed from: for
+// Inserted, PropertyChanged and Moved it is the path in the document as of
+// revision, and for Removed the path it had the revision before.
+struct QmlJournalChange {
+    uint64_t revision = 0;
+    QmlChange::Kind kind = QmlChange::Kind::Inserted;
+    QmlAtom property = QmlAtoms::Invalid;  // PropertyChanged only
+    QmlNodePath path;
+
+    // The node the change names in document, or null if path does not fit.
+    const QmlNode *resolve(const QmlDocument &document) const;
+};
+
+// Log of the changes made to one document, for consumers that update
+// incrementally instead of rescanning it: the frontend, a value index, a
+// remote session. Each record() is one revision, numbered from 1 with no
+// gaps. A consumer reads what it has not seen with changesSince() and then
+// acknowledges it; an entry is trimmed once every consumer has, so the
+// log holds only the revisions the slowest consumer is behind by. With no
+// consumers nothing is kept.
+//
+//   QmlChangeJournal journal;
+//   const size_t frontendSeen = journal.subscribe();
+//   QmlDocumentTransaction transaction(document, &journal);
+//   ...
+//   uint64_t seen = journal.acknowledged(frontendSeen);
+//   if (!journal.changesSince(seen, apply)) rescan(document);
+//   journal.acknowledge(frontendSeen, journal.revision());
+//
+// Paths are stored flattened, so an entry costs a few words plus one per
+// level of its node's depth. Not thread-safe.
+class QmlChangeJournal {
+public:
+    // Appends the changes diff found between two versions of the document
+    // and returns the new revision, even when diff is empty.
+    uint64_t record(const QmlDocument &before, const QmlDocument &after, const QmlDocumentDiff &diff);
+    uint64_t revision() const { return revision_; }
+
+    // Calls visit with each change made after revision since, in order. The
+    // change is reused between calls. Returns false without visiting
+    // anything if some of them were already trimmed, when the consumer has
+    // to rescan the document instead.
+    bool changesSince(uint64_t since, QmlFunctionRef<void(const QmlJournalChange &change)> visit) const;
+
+    // A new consumer that has seen everything up to revision().
+    size_t subscribe();
+    void unsubscribe(size_t consumer);
+    // Records that consumer has seen every change up to revision and trims
+    // what all consumers have seen. A consumer never moves backwards.
+    void acknowledge(size_t consumer, uint64_t revision);
+    uint64_t acknowledged(size_t consumer) const { return consumers_[consumer]; }
+
+    // Entries held, and the oldest revision changesSince() can start after.
+    size_t size() const { return entries_.size(); }
+    uint64_t trimmedThrough() const { return trimmedThrough_; }
+
+private:
+    static constexpr uint64_t kUnsubscribed = UINT64_MAX;
+
+    struct Entry {
+        uint64_t revision;
+        uint64_t pathBegin;  // absolute position in the flattened steps
+        uint32_t depth;
+        QmlChange::Kind kind;
+        QmlAtom property;
+    };
+
+    void append(uint64_t revision, QmlChange::Kind kind, QmlAtom property, const QmlNodePath &path);
+    void trim();
+
+    uint64_t revision_ = 0;
+    uint64_t trimmedThrough_ = 0;
+    std::deque<Entry> entries_;
+    std::deque<uint32_t> steps_;
+    uint64_t stepsBase_ = 0;  // absolute position of steps_.front()
+    std::vector<uint64_t> consumers_;  // acknowledged revision, by consumer
+};
@@ -0,0 +1,48 @@
+#include "qml_change_queue.h"
+
+#include <thread>
+
+QmlChangeQueue::QmlChangeQueue(uint32_t capacity)
+    : capacity_(capacity),
+      queued_(std::make_unique<std::atomic<bool>[]>(capacity)),
+      slots_(std::make_unique<std::atomic<uint64_t>[]>(capacity)) {
+    for (uint32_t i = 0; i < capacity_; ++i) {
+        queued_[i].store(false, std::memory_order_relaxed);
+        slots_[i].store(UINT64_MAX, std::memory_order_relaxed);
+    }
+}
+
+// Each key holds at most one slot, so the claimed slots never lap the
+// ones the consumer has yet to read.
+bool QmlChangeQueue::post(uint32_t key) {
+    if (key >= capacity_) {
+        return false;
+    }
+    if (queued_[key].exchange(true, std::memory_order_acq_rel)) {
+        coalesced_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const uint64_t slot = tail_.fetch_add(1, std::memory_order_seq_cst);
+    slots_[slot % capacity_].store(slot << 32 | key, std::memory_order_release);
+    // Last, so a drain that cleared pending_ before this sees the slot.
+    return !pending_.exchange(true, std::memory_order_seq_cst);
+}
+
+size_t QmlChangeQueue::drain(QmlFunctionRef<void(uint32_t key)> visit) {
+    pending_.store(false, std::memory_order_seq_cst);
+    const uint64_t tail = tail_.load(std::memory_order_seq_cst);
+    size_t visited = 0;
+    for (; head_ < tail; ++head_) {
+        const std::atomic<uint64_t> &slot = slots_[head_ % capacity_];
+        uint64_t entry = slot.load(std::memory_order_acquire);
+        while (static_cast<uint32_t>(entry >> 32) != static_cast<uint32_t>(head_)) {  // claimed, not filled yet
+            std::this_thread::yield();
+            entry = slot.load(std::memory_order_acquire);
+        }
+        const auto key = static_cast<uint32_t>(entry);
+        queued_[key].store(false, std::memory_order_release);
+        visit(key);
+        ++visited;
+    }
+    return visited;
+}
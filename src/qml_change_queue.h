@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "qml_function_ref.h"
+
+// Bounded multi-producer, single-consumer queue of change keys in
+// [0, capacity), such as one key per watched property. It coalesces: a key
+// that is already waiting is not queued again, so any number of updates
+// to it before the next drain() arrive as one, the queue never holds more
+// than capacity entries, and post() never fails, locks, waits or
+// allocates. Only drain() may wait, for the few instructions between a
+// producer claiming a slot and filling it.
+class QmlChangeQueue {
+public:
+    explicit QmlChangeQueue(uint32_t capacity);
+    QmlChangeQueue(const QmlChangeQueue &) = delete;
+    QmlChangeQueue &operator=(const QmlChangeQueue &) = delete;
+
+    uint32_t capacity() const { return capacity_; }
+
+    // From any thread. Returns true for the first post since the last
+    // drain(), when the consumer should be woken; later posts ride along.
+    bool post(uint32_t key);
+
+    // From the consumer. Calls visit(key) for each waiting key in the order
+    // they were first posted. A key is re-armed before its visit, so a
+    // change made while visiting it is queued again. Returns the number of
+    // keys visited.
+    size_t drain(QmlFunctionRef<void(uint32_t key)> visit);
+
+    // Posts merged into a key that was already waiting.
+    uint64_t coalescedCount() const { return coalesced_.load(std::memory_order_relaxed); }
+
+private:
+    uint32_t capacity_;
+    std::unique_ptr<std::atomic<bool>[]> queued_;  // per key
+    // Ring of keys, each tagged with the low half of its slot's position so
+    // a slot left from the previous lap is never taken for a new one.
+    std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+    alignas(64) std::atomic<uint64_t> tail_{0};  // next slot to claim
+    alignas(64) uint64_t head_ = 0;              // consumer only
+    std::atomic<bool> pending_{false};
+    std::atomic<uint64_t> coalesced_{0};
+};
@@ -0,0 +1,156 @@
+#include "qml_color_pairs.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <curses.h>
+
+namespace {
+
+struct Rgb {
+    int red;
+    int green;
+    int blue;
+};
+
+// xterm's defaults for the sixteen colours.
+constexpr Rgb kTerminalColors[QmlColorPairs::kColors] = {
+    {0, 0, 0},       {205, 0, 0},     {0, 205, 0},     {205, 205, 0},   {0, 0, 238},     {205, 0, 205},
+    {0, 205, 205},   {229, 229, 229}, {127, 127, 127}, {255, 0, 0},     {0, 255, 0},     {255, 255, 0},
+    {92, 92, 255},   {255, 0, 255},   {0, 255, 255},   {255, 255, 255},
+};
+
+struct NamedColor {
+    std::string_view name;
+    Rgb rgb;
+};
+
+// The SVG colours dashboards reach for most; others can be given as hex.
+constexpr NamedColor kNamedColors[] = {
+    {"aqua", {0, 255, 255}},        {"black", {0, 0, 0}},           {"blue", {0, 0, 255}},
+    {"brown", {165, 42, 42}},       {"coral", {255, 127, 80}},      {"crimson", {220, 20, 60}},
+    {"cyan", {0, 255, 255}},        {"darkblue", {0, 0, 139}},      {"darkcyan", {0, 139, 139}},
+    {"darkgray", {169, 169, 169}},  {"darkgreen", {0, 100, 0}},     {"darkgrey", {169, 169, 169}},
+    {"darkmagenta", {139, 0, 139}}, {"darkorange", {255, 140, 0}},  {"darkred", {139, 0, 0}},
+    {"dimgray", {105, 105, 105}},   {"dimgrey", {105, 105, 105}},   {"fuchsia", {255, 0, 255}},
+    {"gold", {255, 215, 0}},        {"gray", {128, 128, 128}},      {"green", {0, 128, 0}},
+    {"grey", {128, 128, 128}},      {"indigo", {75, 0, 130}},       {"khaki", {240, 230, 140}},
+    {"lightblue", {173, 216, 230}}, {"lightgray", {211, 211, 211}}, {"lightgreen", {144, 238, 144}},
+    {"lightgrey", {211, 211, 211}}, {"lime", {0, 255, 0}},          {"magenta", {255, 0, 255}},
+    {"maroon", {128, 0, 0}},        {"navy", {0, 0, 128}},          {"olive", {128, 128, 0}},
+    {"orange", {255, 165, 0}},      {"pink", {255, 192, 203}},      {"purple", {128, 0, 128}},
+    {"red", {255, 0, 0}},           {"salmon", {250, 128, 114}},    {"silver", {192, 192, 192}},
+    {"skyblue", {135, 206, 235}},   {"steelblue", {70, 130, 180}},  {"teal", {0, 128, 128}},
+    {"tomato", {255, 99, 71}},      {"violet", {238, 130, 238}},    {"white", {255, 255, 255}},
+    {"yellow", {255, 255, 0}},
+};
+
+int nearest(Rgb rgb) {
+    int best = 0;
+    int bestDistance = INT_MAX;
+    for (int color = 0; color < QmlColorPairs::kColors; ++color) {
+        const Rgb &terminal = kTerminalColors[color];
+        const int red = rgb.red - terminal.red;
+        const int green = rgb.green - terminal.green;
+        const int blue = rgb.blue - terminal.blue;
+        const int distance = red * red + green * green + blue * blue;
+        if (distance < bestDistance) {
+            best = color;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+}  // namespace
+
+QmlColorPairs &QmlColorPairs::global() {
+    static QmlColorPairs pairs;
+    return pairs;
+}
+
+int QmlColorPairs::parse(std::string_view color) {
+    if (!color.empty() && color[0] == '#') {
+        color.remove_prefix(1);
+        int digits[8];
+        for (size_t i = 0; i < color.size() && i < 8; ++i) {
+            digits[i] = hexDigit(color[i]);
+            if (digits[i] < 0) {
+                return kDefault;
+            }
+        }
+        switch (color.size()) {
+        case 3:
+            return nearest(Rgb{digits[0] * 17, digits[1] * 17, digits[2] * 17});
+        case 6:
+            return nearest(Rgb{digits[0] * 16 + digits[1], digits[2] * 16 + digits[3], digits[4] * 16 + digits[5]});
+        case 8:  // alpha first; a transparent colour draws nothing over the default
+            if (digits[0] == 0 && digits[1] == 0) {
+                return kDefault;
+            }
+            return nearest(Rgb{digits[2] * 16 + digits[3], digits[4] * 16 + digits[5], digits[6] * 16 + digits[7]});
+        default:
+            return kDefault;
+        }
+    }
+    for (const NamedColor &named : kNamedColors) {
+        if (named.name.size() == color.size() &&
+            std::equal(color.begin(), color.end(), named.name.begin(), [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == b;
+            })) {
+            return nearest(named.rgb);
+        }
+    }
+    return kDefault;
+}
+
+int QmlColorPairs::sgrForeground(int color) {
+    return color < 0 ? 39 : color < 8 ? 30 + color : 90 + color - 8;
+}
+
+int QmlColorPairs::sgrBackground(int color) {
+    return color < 0 ? 49 : color < 8 ? 40 + color : 100 + color - 8;
+}
+
+uint32_t QmlColorPairs::attributes(int foreground, int background) {
+    if (foreground < kDefault || foreground >= kColors || background < kDefault || background >= kColors ||
+        (foreground == kDefault && background == kDefault)) {
+        return 0;
+    }
+    std::atomic<uint8_t> &slot = pairs_[foreground + 1][background + 1];
+    uint32_t pair = slot.load(std::memory_order_acquire);
+    if (pair == 0) {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        pair = slot.load(std::memory_order_relaxed);
+        if (pair == 0) {
+            const uint32_t count = count_.load(std::memory_order_relaxed);
+            if (count == kMaxPairs) {
+                return 0;
+            }
+            pair = count + 1;
+            colors_[pair].store(static_cast<uint16_t>((foreground + 1) | (background + 1) << 8),
+                                std::memory_order_relaxed);
+            count_.store(pair, std::memory_order_release);
+            slot.store(static_cast<uint8_t>(pair), std::memory_order_release);
+        }
+    }
+    return static_cast<uint32_t>(COLOR_PAIR(pair));
+}
+
+bool QmlColorPairs::colors(uint32_t pair, int &foreground, int &background) const {
+    if (pair == 0 || pair > pairCount()) {
+        return false;
+    }
+    const uint16_t packed = colors_[pair].load(std::memory_order_relaxed);
+    foreground = (packed & 0xff) - 1;
+    background = (packed >> 8) - 1;
+    return true;
+}
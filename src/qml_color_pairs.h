@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+
+// Terminal colours for QML color values, and the curses colour pairs that
+// draw them. A cell's colours travel in the A_COLOR bits of its attributes
+// as a pair number, which every screen reads back through this table, so
+// it is process-wide like QmlAtomTable. A pair is allocated the first time
+// its colours are asked for and keeps its number for good; looking up one
+// that exists takes no lock.
+class QmlColorPairs {
+public:
+    static constexpr int kDefault = -1;  // the terminal's own colour
+    // The eight ANSI colours, then their bright forms.
+    static constexpr int kColors = 16;
+    // Pair numbers that fit in A_COLOR; 0 means no colour.
+    static constexpr uint32_t kMaxPairs = 255;
+
+    static QmlColorPairs &global();
+
+    // The nearest terminal colour to a QML color: an SVG colour name such
+    // as "red" or "darkgray", or "#rgb", "#rrggbb" or "#aarrggbb".
+    // kDefault for "transparent" and anything it does not know.
+    static int parse(std::string_view color);
+    // SGR parameters that select a colour (39 and 49 for kDefault).
+    static int sgrForeground(int color);
+    static int sgrBackground(int color);
+
+    // COLOR_PAIR bits for foreground on background, allocating the pair
+    // the first time; 0 if both are kDefault or every pair is taken.
+    uint32_t attributes(int foreground, int background = kDefault);
+    // Colours of pair; false if it was never allocated.
+    bool colors(uint32_t pair, int &foreground, int &background) const;
+    uint32_t pairCount() const { return count_.load(std::memory_order_acquire); }
+
+private:
+    QmlColorPairs() = default;
+
+    std::mutex mutex_;  // serializes allocation
+    // Pair by foreground + 1 and background + 1; 0 until allocated.
+    std::atomic<uint8_t> pairs_[kColors + 1][kColors + 1] = {};
+    // (foreground + 1) | (background + 1) << 8 by pair.
+    std::atomic<uint16_t> colors_[kMaxPairs + 1] = {};
+    std::atomic<uint32_t> count_{0};
+};
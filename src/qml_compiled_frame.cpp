@@ -0,0 +1,41 @@
+#include "qml_compiled_frame.h"
+
+#include <algorithm>
+
+#include "qml_text_width.h"
+
+void QmlCompiledFrame::compose(int rows, int cols, QmlCompiledRender render, BindingWriter resolve) {
+    if (grid_.rows() != rows || grid_.cols() != cols) {
+        grid_.resize(rows, cols);
+    }
+    grid_.clear();
+    render(*this, resolve);
+}
+
+QmlCompiledText QmlCompiledFrame::resolve(size_t slot, std::string_view binding, int bindingWidth,
+                                          BindingWriter write) {
+    if (slot >= values_.size()) {
+        values_.resize(slot + 1);
+    }
+    std::string &value = values_[slot];
+    value.clear();
+    write(binding, value);
+    if (value.empty()) {
+        return QmlCompiledText{binding, bindingWidth};
+    }
+    return QmlCompiledText{value, QmlTextWidth::of(value)};
+}
+
+// As the interpreter's framed placements, without a cursor.
+void QmlCompiledFrame::putFramed(int row, int col, QmlCompiledText text, int padTo, uint32_t attributes) {
+    const int textCol = col + 2;
+    padTo = std::max(padTo, text.width);
+    grid_.put(row, col, "[ ", attributes);
+    grid_.put(row, textCol, text.text, attributes);
+    if (attributes != 0) {
+        for (int cell = textCol + text.width; cell < textCol + padTo; ++cell) {
+            grid_.put(row, cell, " ", attributes);
+        }
+    }
+    grid_.put(row, textCol + padTo, " ]", attributes);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+#include "qml_cell_grid.h"
+#include "qml_curses_frontend.h"
+
+// A binding's text as a compiled render function draws it.
+struct QmlCompiledText {
+    std::string_view text;
+    int width = 0;  // in cells
+};
+
+class QmlCompiledFrame;
+
+// What qml2curses generates for each screen (see
+// cmake/QmlCursesCompile.cmake): composes the screen into frame, calling
+// resolve once per distinct binding.
+using QmlCompiledRender = void (*)(QmlCompiledFrame &frame, BindingWriter resolve);
+
+// Target of the compiled render functions. It keeps the grid and the
+// binding buffers between frames, so a frame allocates nothing once the
+// values stop growing, and the screen gets only the cells that changed,
+// as from QmlCursesFrontend.
+class QmlCompiledFrame {
+public:
+    // Composes one frame with render and sends the difference to screen.
+    // Returns the number of cells written.
+    template <typename Screen>
+    size_t render(Screen &screen, QmlCompiledRender render, BindingWriter resolve) {
+        compose(screen.rows(), screen.cols(), render, resolve);
+        return present(screen);
+    }
+
+    // Blanks the back buffer, resized to rows by cols, and draws into it.
+    void compose(int rows, int cols, QmlCompiledRender render, BindingWriter resolve);
+    template <typename Screen>
+    size_t present(Screen &screen) {
+        const bool repaint = !grid_.frontValid();
+        const size_t written = grid_.flush(screen);
+        if (written > 0 || repaint) {
+            screen.refresh();
+        }
+        return written;
+    }
+
+    int rows() const { return grid_.rows(); }
+    int cols() const { return grid_.cols(); }
+    const QmlCellGrid &grid() const { return grid_; }
+
+    // Resolves binding into buffer slot. An empty value shows the binding
+    // itself, bindingWidth cells wide, as the interpreter does.
+    QmlCompiledText resolve(size_t slot, std::string_view binding, int bindingWidth, BindingWriter write);
+
+    void put(int row, int col, std::string_view text, uint32_t attributes) { grid_.put(row, col, text, attributes); }
+    // A TextField or Button: "[ text ]", the text padded to padTo cells.
+    void putFramed(int row, int col, QmlCompiledText text, int padTo, uint32_t attributes);
+
+private:
+    QmlCellGrid grid_;
+    std::deque<std::string> values_;  // growing keeps earlier texts in place
+};
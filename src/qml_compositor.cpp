@@ -0,0 +1,187 @@
+#include "qml_compositor.h"
+
+#include <algorithm>
+
+void QmlCompositor::Surface::clear() {
+    cells_.clear();
+    damage(0, 0, rows(), cols());
+}
+
+void QmlCompositor::Surface::drawText(int row, int col, const std::string &text) {
+    drawStyledText(row, col, text, 0);
+}
+
+void QmlCompositor::Surface::drawStyledText(int row, int col, const std::string &text, uint32_t attributes) {
+    const ScreenRun run{row, col, text, attributes};
+    drawRuns(&run, 1);
+}
+
+void QmlCompositor::Surface::drawRuns(const ScreenRun *runs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const ScreenRun &run = runs[i];
+        const int width = cells_.put(run.row, run.col, run.text, run.attributes);
+        // One more cell on either side: writing half of a wide character
+        // blanks its other half.
+        damage(run.row, run.col - 1, 1, width + 2);
+    }
+}
+
+void QmlCompositor::Surface::move(int row, int col) {
+    if (row != row_ || col != col_) {
+        row_ = row;
+        col_ = col;
+        compositor_.geometryChanged_ = true;
+    }
+}
+
+void QmlCompositor::Surface::resize(int rows, int cols) {
+    if (rows != this->rows() || cols != this->cols()) {
+        cells_.resize(rows, cols);
+        compositor_.geometryChanged_ = true;
+    }
+}
+
+void QmlCompositor::Surface::setVisible(bool visible) {
+    if (visible != visible_) {
+        visible_ = visible;
+        compositor_.geometryChanged_ = true;
+    }
+}
+
+void QmlCompositor::Surface::damage(int row, int col, int rows, int cols) {
+    const int top = std::max(0, row);
+    const int bottom = std::min(this->rows(), row + rows) - 1;
+    const int left = std::max(0, col);
+    const int right = std::min(this->cols(), col + cols) - 1;
+    if (top > bottom || left > right) {
+        return;
+    }
+    if (damageTop_ > damageBottom_) {
+        damageTop_ = top;
+        damageBottom_ = bottom;
+        damageLeft_ = left;
+        damageRight_ = right;
+        return;
+    }
+    damageTop_ = std::min(damageTop_, top);
+    damageBottom_ = std::max(damageBottom_, bottom);
+    damageLeft_ = std::min(damageLeft_, left);
+    damageRight_ = std::max(damageRight_, right);
+}
+
+QmlCompositor::Surface &QmlCompositor::addLayer(int z, int row, int col, int rows, int cols) {
+    std::unique_ptr<Surface> surface(new Surface(*this, z));
+    surface->row_ = row;
+    surface->col_ = col;
+    surface->cells_.resize(rows, cols);
+    const auto above = std::upper_bound(layers_.begin(), layers_.end(), z,
+                                        [](int value, const std::unique_ptr<Surface> &layer) { return value < layer->z_; });
+    Surface &added = **layers_.insert(above, std::move(surface));
+    geometryChanged_ = true;
+    return added;
+}
+
+void QmlCompositor::removeLayer(Surface &surface) {
+    const auto it = std::find_if(layers_.begin(), layers_.end(),
+                                 [&surface](const std::unique_ptr<Surface> &layer) { return layer.get() == &surface; });
+    if (it != layers_.end()) {
+        layers_.erase(it);
+        geometryChanged_ = true;
+    }
+}
+
+// Paints the layers' rectangles bottom to top, so each cell ends up with
+// the topmost one.
+void QmlCompositor::computeOwners() {
+    owners_.assign(static_cast<size_t>(grid_.rows()) * grid_.cols(), kNoLayer);
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        const Surface &layer = *layers_[i];
+        if (!layer.visible_) {
+            continue;
+        }
+        const int top = std::max(0, layer.row_);
+        const int bottom = std::min(grid_.rows(), layer.row_ + layer.rows());
+        const int left = std::max(0, layer.col_);
+        const int right = std::min(grid_.cols(), layer.col_ + layer.cols());
+        for (int row = top; row < bottom; ++row) {
+            uint32_t *owners = &owners_[static_cast<size_t>(row) * grid_.cols()];
+            std::fill(owners + left, owners + std::max(left, right), static_cast<uint32_t>(i));
+        }
+    }
+}
+
+// Copies the screen cell at (row, col) from layer. A wide character cut
+// by the edge of a higher layer would leave half a glyph, so its visible
+// half is drawn blank.
+void QmlCompositor::composeCell(int row, int col, uint32_t layer) {
+    if (layer == kNoLayer) {
+        grid_.set(row, col, QmlCell{});
+        return;
+    }
+    const Surface &surface = *layers_[layer];
+    const int surfaceRow = row - surface.row_;
+    const int surfaceCol = col - surface.col_;
+    const QmlCell *cells = surface.cells_.row(surfaceRow);
+    QmlCell cell = cells[surfaceCol];
+    const uint32_t *owners = &owners_[static_cast<size_t>(row) * grid_.cols()];
+    if (cell.glyph == QmlCell::kContinuation && (surfaceCol == 0 || col == 0 || owners[col - 1] != layer)) {
+        cell.glyph = ' ';
+    } else if (surfaceCol + 1 < surface.cols() && cells[surfaceCol + 1].glyph == QmlCell::kContinuation &&
+               (col + 1 >= grid_.cols() || owners[col + 1] != layer)) {
+        cell.glyph = ' ';
+    }
+    grid_.set(row, col, cell);
+    ++cellsComposed_;
+}
+
+size_t QmlCompositor::commit(ICursesScreen &screen) {
+    cellsComposed_ = 0;
+    cellsOccluded_ = 0;
+    const bool repaint = grid_.rows() != screen.rows() || grid_.cols() != screen.cols();
+    if (repaint) {
+        grid_.resize(screen.rows(), screen.cols());
+        geometryChanged_ = true;
+    }
+
+    if (geometryChanged_) {
+        // Uncovered or moved areas come from the surfaces' retained cells.
+        computeOwners();
+        for (int row = 0; row < grid_.rows(); ++row) {
+            for (int col = 0; col < grid_.cols(); ++col) {
+                composeCell(row, col, owners_[static_cast<size_t>(row) * grid_.cols() + col]);
+            }
+        }
+        geometryChanged_ = false;
+    } else {
+        for (uint32_t i = 0; i < layers_.size(); ++i) {
+            const Surface &layer = *layers_[i];
+            if (!layer.visible_ || layer.damageTop_ > layer.damageBottom_) {
+                continue;
+            }
+            const int top = std::max(0, layer.row_ + layer.damageTop_);
+            const int bottom = std::min(grid_.rows() - 1, layer.row_ + layer.damageBottom_);
+            const int left = std::max(0, layer.col_ + layer.damageLeft_);
+            const int right = std::min(grid_.cols() - 1, layer.col_ + layer.damageRight_);
+            for (int row = top; row <= bottom; ++row) {
+                const uint32_t *owners = &owners_[static_cast<size_t>(row) * grid_.cols()];
+                for (int col = left; col <= right; ++col) {
+                    if (owners[col] == i) {
+                        composeCell(row, col, i);
+                    } else {
+                        ++cellsOccluded_;
+                    }
+                }
+            }
+        }
+    }
+    for (const auto &layer : layers_) {
+        layer->damageTop_ = 0;
+        layer->damageBottom_ = -1;
+    }
+
+    const size_t written = grid_.flush(screen);
+    if (written > 0 || repaint) {
+        screen.refresh();
+    }
+    return written;
+}
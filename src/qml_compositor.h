@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "qml_cell_grid.h"
+#include "qml_curses_frontend.h"
+
+// Stacks several surfaces (the main window, popups, dialogs, status bars)
+// on one terminal. Each surface is an ICursesScreen of its own, so a
+// frontend renders into it unchanged, and keeps its cells after drawing:
+// opening a dialog over a document does not make the document render
+// again. Surfaces are opaque rectangles ordered by z; commit() works out
+// which surface owns each screen cell, composes only the damaged cells
+// that are not hidden under a higher surface, and sends the result to the
+// screen as one batch of runs with one refresh.
+class QmlCompositor {
+public:
+    class Surface : public ICursesScreen {
+    public:
+        void clear() override;
+        void drawText(int row, int col, const std::string &text) override;
+        void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override;
+        void drawRuns(const ScreenRun *runs, size_t count) override;
+        // Drawing lands in the surface's cells; commit() shows it.
+        void refresh() override {}
+        int rows() const override { return cells_.rows(); }
+        int cols() const override { return cells_.cols(); }
+
+        int row() const { return row_; }
+        int col() const { return col_; }
+        int z() const { return z_; }
+        bool visible() const { return visible_; }
+        // Geometry changes re-compose the screen from the surfaces' cells
+        // on the next commit; nothing is re-rendered.
+        void move(int row, int col);
+        void resize(int rows, int cols);
+        void setVisible(bool visible);
+
+    private:
+        friend class QmlCompositor;
+        Surface(QmlCompositor &compositor, int z) : compositor_(compositor), z_(z) {}
+
+        void damage(int row, int col, int rows, int cols);
+
+        QmlCompositor &compositor_;
+        QmlCellPad cells_;
+        int row_ = 0;
+        int col_ = 0;
+        int z_ = 0;
+        bool visible_ = true;
+        // Damaged rectangle in surface coordinates; empty when top > bottom.
+        int damageTop_ = 0;
+        int damageBottom_ = -1;
+        int damageLeft_ = 0;
+        int damageRight_ = -1;
+    };
+
+    // Surfaces with a higher z are drawn over lower ones; equal z stacks
+    // in the order added. The reference stays valid until removeLayer().
+    Surface &addLayer(int z, int row, int col, int rows, int cols);
+    void removeLayer(Surface &surface);
+
+    // Composes the damage and flushes it to screen; returns the number of
+    // cells written to the terminal.
+    size_t commit(ICursesScreen &screen);
+
+    // Cells copied from surfaces, and damaged cells skipped because a
+    // higher surface covers them, in the last commit().
+    size_t cellsComposed() const { return cellsComposed_; }
+    size_t cellsOccluded() const { return cellsOccluded_; }
+
+private:
+    static constexpr uint32_t kNoLayer = UINT32_MAX;
+
+    void computeOwners();
+    void composeCell(int row, int col, uint32_t layer);
+
+    std::vector<std::unique_ptr<Surface>> layers_;  // bottom to top
+    // Topmost visible layer covering each screen cell, row-major.
+    std::vector<uint32_t> owners_;
+    QmlCellGrid grid_;
+    bool geometryChanged_ = true;
+    size_t cellsComposed_ = 0;
+    size_t cellsOccluded_ = 0;
+};
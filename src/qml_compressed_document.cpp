@@ -0,0 +1,36 @@
+#include "qml_compressed_document.h"
+
+#include <limits>
+#include <stdexcept>
+
+#include "qml_ast_cache.h"
+#include "qml_lz4.h"
+#include "qml_trace.h"
+
+namespace {
+
+// The entry is keyed to no source, so source offsets are bounded by
+// nothing; its grammar version and structure are still checked when it is
+// decoded.
+constexpr uint64_t kNoSourceHash = 0;
+constexpr uint64_t kNoSourceSize = std::numeric_limits<uint64_t>::max();
+
+}  // namespace
+
+QmlCompressedDocument::QmlCompressedDocument(const QmlDocument &document) {
+    const QmlTraceSpan span("QmlCompressedDocument::compress");
+    const std::string entry = QmlAstCache::serialize(document, kNoSourceHash, kNoSourceSize);
+    block_ = QmlLz4::compress(entry);
+    block_.shrink_to_fit();
+    entrySize_ = entry.size();
+}
+
+QmlDocument QmlCompressedDocument::decompress() const {
+    const QmlTraceSpan span("QmlCompressedDocument::decompress");
+    std::string entry;
+    QmlDocument document;
+    if (!QmlLz4::decompress(block_, entrySize_, entry) || !QmlAstCache::deserialize(entry, kNoSourceHash, kNoSourceSize, document)) {
+        throw std::runtime_error("Corrupt compressed document");
+    }
+    return document;
+}
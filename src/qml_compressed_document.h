@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "qml_parser.h"
+
+// A document held as an LZ4 block (QmlLz4) of its AST cache entry, for
+// documents that stay loaded but are not shown, such as the other screens
+// of a kiosk or sample_cli's hidden tabs. The tree, its strings and its
+// index are freed; the block is typically under a tenth of their size.
+// decompress() rebuilds the tree in well under a millisecond for a typical
+// screen (see the compressed_document_restore benchmark), so a screen can
+// come back within the frame that shows it.
+//
+//   QmlCompressedDocument cold(document);
+//   document = QmlDocument();  // frees the tree
+//   ...
+//   document = cold.decompress();
+//
+// The rebuilt tree has new nodes and a new revision(), so whatever was
+// cached against the old one, such as a frontend's plan, is rebuilt too.
+class QmlCompressedDocument {
+public:
+    QmlCompressedDocument() = default;
+    explicit QmlCompressedDocument(const QmlDocument &document);
+
+    bool empty() const { return entrySize_ == 0; }
+    // The document, on the default resource. Throws std::runtime_error if
+    // the block is corrupt.
+    QmlDocument decompress() const;
+
+    // Bytes held, and the size of the entry they decode to.
+    size_t byteSize() const { return block_.capacity(); }
+    size_t entrySize() const { return entrySize_; }
+
+private:
+    std::string block_;
+    size_t entrySize_ = 0;
+};
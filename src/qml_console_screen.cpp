@@ -0,0 +1,216 @@
+#include "qml_console_screen.h"
+
+#include <algorithm>
+#include <curses.h>
+#include <utility>
+
+#include "qml_color_pairs.h"
+#include "qml_text_width.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#undef MOUSE_MOVED  // curses.h and wincon.h both define it
+#include <windows.h>
+#endif
+
+namespace {
+
+// wincon.h's attribute bits, spelled out so the screen builds everywhere.
+constexpr uint16_t kForegroundBlue = 0x0001;
+constexpr uint16_t kForegroundIntensity = 0x0008;
+constexpr uint16_t kForegroundMask = 0x000f;
+constexpr uint16_t kBackgroundMask = 0x00f0;
+constexpr uint16_t kLeadingByte = 0x0100;
+constexpr uint16_t kTrailingByte = 0x0200;
+constexpr uint16_t kReverseVideo = 0x4000;
+constexpr uint16_t kUnderscore = 0x8000;
+
+#ifdef _WIN32
+static_assert(sizeof(QmlConsoleCell) == sizeof(CHAR_INFO) && alignof(QmlConsoleCell) == alignof(CHAR_INFO),
+              "QmlConsoleCell must be laid out as CHAR_INFO");
+static_assert(kForegroundBlue == FOREGROUND_BLUE && kForegroundIntensity == FOREGROUND_INTENSITY &&
+                  kLeadingByte == COMMON_LVB_LEADING_BYTE && kTrailingByte == COMMON_LVB_TRAILING_BYTE &&
+                  kReverseVideo == COMMON_LVB_REVERSE_VIDEO && kUnderscore == COMMON_LVB_UNDERSCORE,
+              "console attribute bits");
+#endif
+
+// Foreground bits for a QmlColorPairs colour: ANSI numbers red as 1 and
+// blue as 4, the console the other way round.
+uint16_t consoleColor(int color) {
+    const auto ansi = static_cast<uint16_t>(color & 7);
+    const auto swapped = static_cast<uint16_t>((ansi & 2) | (ansi & 1) << 2 | (ansi & 4) >> 2);
+    return static_cast<uint16_t>(swapped | (color >= 8 ? kForegroundIntensity : 0));
+}
+
+}  // namespace
+
+#ifdef _WIN32
+QmlConsoleScreen::QmlConsoleScreen() : defaultAttributes_(0x07), lastConsole_(0x07) {
+    output_ = GetStdHandle(STD_OUTPUT_HANDLE);
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    int rows = 25;
+    int cols = 80;
+    if (GetConsoleScreenBufferInfo(output_, &info)) {
+        defaultAttributes_ = info.wAttributes & (kForegroundMask | kBackgroundMask);
+        lastConsole_ = defaultAttributes_;
+        rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+        cols = info.srWindow.Right - info.srWindow.Left + 1;
+    }
+    resize(rows, cols);
+}
+#endif
+
+QmlConsoleScreen::QmlConsoleScreen(int rows, int cols, Commit commit, uint16_t defaultAttributes)
+    : commit_(std::move(commit)), defaultAttributes_(defaultAttributes), lastConsole_(defaultAttributes) {
+    resize(rows, cols);
+}
+
+void QmlConsoleScreen::clear() {
+    const QmlConsoleCell blank{u' ', defaultAttributes_};
+    for (int row = 0; row < rows_; ++row) {
+        for (int col = 0; col < cols_; ++col) {
+            put(row, col, blank);
+        }
+    }
+}
+
+void QmlConsoleScreen::drawText(int row, int col, const std::string &text) {
+    drawRun(ScreenRun{row, col, text, 0});
+}
+
+void QmlConsoleScreen::drawStyledText(int row, int col, const std::string &text, uint32_t attributes) {
+    drawRun(ScreenRun{row, col, text, attributes});
+}
+
+void QmlConsoleScreen::drawRuns(const ScreenRun *runs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        drawRun(runs[i]);
+    }
+}
+
+void QmlConsoleScreen::drawRun(const ScreenRun &run) {
+    if (run.row < 0 || run.row >= rows_ || run.col < 0 || run.col >= cols_) {
+        return;
+    }
+    const uint16_t attributes = consoleAttributes(run.attributes);
+    int col = run.col;
+    for (size_t pos = 0; pos < run.text.size() && col < cols_;) {
+        uint32_t codePoint = 0;
+        pos += QmlTextWidth::decode(run.text, pos, codePoint);
+        const int width = QmlTextWidth::codePoint(codePoint);
+        if (width == 0) {
+            continue;
+        }
+        const char16_t character = codePoint > 0xffff ? u'\uFFFD' : static_cast<char16_t>(codePoint);
+        if (width == 1) {
+            put(run.row, col++, QmlConsoleCell{character, attributes});
+        } else if (col + 1 < cols_) {
+            put(run.row, col++, QmlConsoleCell{character, static_cast<uint16_t>(attributes | kLeadingByte)});
+            put(run.row, col++, QmlConsoleCell{character, static_cast<uint16_t>(attributes | kTrailingByte)});
+        } else {
+            break;
+        }
+    }
+}
+
+void QmlConsoleScreen::put(int row, int col, QmlConsoleCell cell) {
+    QmlConsoleCell &current = cells_[static_cast<size_t>(row * cols_ + col)];
+    if (current == cell) {
+        return;
+    }
+    current = cell;
+    dirtyBegin_[static_cast<size_t>(row)] = std::min(dirtyBegin_[static_cast<size_t>(row)], col);
+    dirtyEnd_[static_cast<size_t>(row)] = std::max(dirtyEnd_[static_cast<size_t>(row)], col + 1);
+}
+
+void QmlConsoleScreen::refresh() {
+    commitsLastFrame_ = 0;
+    for (int row = 0; row < rows_;) {
+        if (dirtyBegin_[static_cast<size_t>(row)] >= dirtyEnd_[static_cast<size_t>(row)]) {
+            ++row;
+            continue;
+        }
+        QmlConsoleRect rect{row, cols_, row, -1};
+        for (; row < rows_ && dirtyBegin_[static_cast<size_t>(row)] < dirtyEnd_[static_cast<size_t>(row)]; ++row) {
+            rect.bottom = row;
+            rect.left = std::min(rect.left, dirtyBegin_[static_cast<size_t>(row)]);
+            rect.right = std::max(rect.right, dirtyEnd_[static_cast<size_t>(row)] - 1);
+            dirtyBegin_[static_cast<size_t>(row)] = cols_;
+            dirtyEnd_[static_cast<size_t>(row)] = 0;
+        }
+        ++commitsLastFrame_;
+        if (commit_) {
+            commit_(cells_.data(), cols_, rect);
+            continue;
+        }
+#ifdef _WIN32
+        SMALL_RECT region{static_cast<SHORT>(rect.left), static_cast<SHORT>(rect.top), static_cast<SHORT>(rect.right),
+                          static_cast<SHORT>(rect.bottom)};
+        WriteConsoleOutputW(output_, reinterpret_cast<const CHAR_INFO *>(cells_.data()),
+                            COORD{static_cast<SHORT>(cols_), static_cast<SHORT>(rows_)},
+                            COORD{static_cast<SHORT>(rect.left), static_cast<SHORT>(rect.top)}, &region);
+#endif
+    }
+#ifdef _WIN32
+    // The frontend clears and repaints when the size changes; the new
+    // buffer starts out all changed, like the first.
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!commit_ && GetConsoleScreenBufferInfo(output_, &info)) {
+        const int rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+        const int cols = info.srWindow.Right - info.srWindow.Left + 1;
+        if (rows != rows_ || cols != cols_) {
+            resize(rows, cols);
+        }
+    }
+#endif
+}
+
+uint16_t QmlConsoleScreen::consoleAttributes(uint32_t attributes) const {
+    if (attributes == lastCurses_) {
+        return lastConsole_;
+    }
+    uint16_t foreground = defaultAttributes_ & kForegroundMask;
+    uint16_t background = defaultAttributes_ & kBackgroundMask;
+    const auto pair = static_cast<uint32_t>(PAIR_NUMBER(attributes));
+    int foregroundColor = QmlColorPairs::kDefault;
+    int backgroundColor = QmlColorPairs::kDefault;
+    if (pair != 0 && QmlColorPairs::global().colors(pair, foregroundColor, backgroundColor)) {
+        if (foregroundColor != QmlColorPairs::kDefault) {
+            foreground = consoleColor(foregroundColor);
+        }
+        if (backgroundColor != QmlColorPairs::kDefault) {
+            background = static_cast<uint16_t>(consoleColor(backgroundColor) << 4);
+        }
+    }
+    uint16_t console = foreground | background;
+    if (attributes & A_BOLD) {
+        console |= kForegroundIntensity;
+    }
+    if (attributes & A_UNDERLINE) {
+        console |= kUnderscore;
+    }
+    if (attributes & (A_REVERSE | A_STANDOUT)) {
+        console |= kReverseVideo;
+    }
+    lastCurses_ = attributes;
+    lastConsole_ = console;
+    return console;
+}
+
+void QmlConsoleScreen::markAll() {
+    std::fill(dirtyBegin_.begin(), dirtyBegin_.end(), 0);
+    std::fill(dirtyEnd_.begin(), dirtyEnd_.end(), cols_);
+}
+
+void QmlConsoleScreen::resize(int rows, int cols) {
+    rows_ = std::max(rows, 1);
+    cols_ = std::max(cols, 1);
+    cells_.assign(static_cast<size_t>(rows_ * cols_), QmlConsoleCell{u' ', defaultAttributes_});
+    dirtyBegin_.assign(static_cast<size_t>(rows_), 0);
+    dirtyEnd_.assign(static_cast<size_t>(rows_), 0);
+    // What the console shows is not known yet, so the first frame writes
+    // every cell.
+    markAll();
+}
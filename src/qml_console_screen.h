@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "qml_curses_frontend.h"
+
+// One console cell, laid out like the Win32 CHAR_INFO it is handed to
+// WriteConsoleOutputW as: a UTF-16 unit, then FOREGROUND_*, BACKGROUND_*
+// and COMMON_LVB_* bits.
+struct QmlConsoleCell {
+    char16_t character = u' ';
+    uint16_t attributes = 0x07;
+
+    bool operator==(const QmlConsoleCell &other) const {
+        return character == other.character && attributes == other.attributes;
+    }
+    bool operator!=(const QmlConsoleCell &other) const { return !(*this == other); }
+};
+
+// Cells [left, right] of rows [top, bottom], inclusive like SMALL_RECT.
+struct QmlConsoleRect {
+    int top = 0;
+    int left = 0;
+    int bottom = 0;
+    int right = 0;
+};
+
+// ICursesScreen for the Windows console that bypasses PDCursesMod's WinCon
+// layer. Draw calls compose into a CHAR_INFO buffer, marking the columns
+// each row changed; refresh() merges consecutive changed rows into one
+// rectangle and commits each with a single WriteConsoleOutputW call, so a
+// full-screen frame is one call however many runs it took. Consoles with
+// VT processing can use VtScreen instead, which this does not replace.
+//
+// Curses attributes map to console ones: A_BOLD brightens the foreground,
+// A_UNDERLINE underscores, A_REVERSE and A_STANDOUT reverse, and colour
+// pairs pick from the sixteen console colours, with the console's own
+// colours for QmlColorPairs::kDefault. A wide character fills two cells as
+// a leading and a trailing half; characters outside the BMP, which do not
+// fit a cell, are drawn as U+FFFD, and combining marks are dropped.
+class QmlConsoleScreen : public ICursesScreen {
+public:
+    // Receives the cells of rect, read from the screen's cells, a buffer
+    // cols() wide: the arguments of one WriteConsoleOutputW call.
+    using Commit = std::function<void(const QmlConsoleCell *cells, int cols, const QmlConsoleRect &rect)>;
+
+#ifdef _WIN32
+    // Draws to the console attached to stdout, at its window's size. Its
+    // attributes when the screen is made are the default colours.
+    QmlConsoleScreen();
+#endif
+    // Fixed-size screen whose rectangles go to commit; used by tests and
+    // benchmarks. defaultAttributes stand for the console's own colours.
+    QmlConsoleScreen(int rows, int cols, Commit commit, uint16_t defaultAttributes = 0x07);
+
+    void clear() override;
+    void drawText(int row, int col, const std::string &text) override;
+    void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override;
+    void drawRuns(const ScreenRun *runs, size_t count) override;
+    void refresh() override;
+    int rows() const override { return rows_; }
+    int cols() const override { return cols_; }
+
+    const QmlConsoleCell &cell(int row, int col) const { return cells_[static_cast<size_t>(row * cols_ + col)]; }
+    // Rectangles the last refresh() committed.
+    size_t commitsLastFrame() const { return commitsLastFrame_; }
+
+    // The console attributes for curses attributes.
+    uint16_t consoleAttributes(uint32_t attributes) const;
+
+private:
+    void drawRun(const ScreenRun &run);
+    void put(int row, int col, QmlConsoleCell cell);
+    void markAll();
+    void resize(int rows, int cols);
+
+    Commit commit_;
+    int rows_ = 0;
+    int cols_ = 0;
+    uint16_t defaultAttributes_;
+    std::vector<QmlConsoleCell> cells_;
+    // Changed columns [dirtyBegin_, dirtyEnd_) by row; empty when equal.
+    std::vector<int> dirtyBegin_;
+    std::vector<int> dirtyEnd_;
+    size_t commitsLastFrame_ = 0;
+    // The last mapping consoleAttributes() was asked for, since runs in a
+    // row mostly share theirs.
+    mutable uint32_t lastCurses_ = 0;
+    mutable uint16_t lastConsole_;
+#ifdef _WIN32
+    void *output_ = nullptr;  // the console's HANDLE, when not committing to a callback
+#endif
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+// Coroutine forms of the frontend's callback APIs, for code that reads
+// better as a straight line than as a chain of callbacks. Only compiled as
+// C++20 (SAMPLE_CXX20); QML_COROUTINES is defined when they are available.
+// Nothing here runs an event loop of its own: awaiters resume from whatever
+// calls back into them, which in the CLI is Qt's event loop.
+
+#if defined(__cpp_impl_coroutine)
+
+#define QML_COROUTINES 1
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "qml_curses_frontend.h"
+
+template <typename T>
+class QmlTask;
+
+namespace qml_coroutine_detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+    bool detached = false;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    void unhandled_exception() {
+        if (detached) {
+            std::terminate();
+        }
+        error = std::current_exception();
+    }
+
+    // Resumes the awaiting coroutine, or frees a detached task's frame.
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            PromiseBase &promise = handle.promise();
+            if (promise.detached) {
+                handle.destroy();
+                return std::noop_coroutine();
+            }
+            return promise.continuation ? promise.continuation : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    QmlTask<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U &&result) {
+        value.emplace(std::forward<U>(result));
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    QmlTask<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+};
+
+}  // namespace qml_coroutine_detail
+
+// A lazily started coroutine. Awaiting it runs it to completion and
+// returns its result, rethrowing what it threw; start() runs it on its own,
+// to free itself when it finishes. A task that is neither is destroyed
+// unstarted.
+template <typename T = void>
+class QmlTask {
+public:
+    using promise_type = qml_coroutine_detail::Promise<T>;
+
+    QmlTask(QmlTask &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    QmlTask &operator=(QmlTask &&other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~QmlTask() { reset(); }
+
+    // Runs until the first suspension and lets go; whatever it awaits
+    // resumes it. An exception escaping a started task terminates.
+    void start() && {
+        std::coroutine_handle<promise_type> handle = std::exchange(handle_, nullptr);
+        handle.promise().detached = true;
+        handle.resume();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    T await_resume() {
+        promise_type &promise = handle_.promise();
+        if (promise.error) {
+            std::rethrow_exception(promise.error);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*promise.value);
+        }
+    }
+
+private:
+    friend promise_type;
+    explicit QmlTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    void reset() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T>
+QmlTask<T> qml_coroutine_detail::Promise<T>::get_return_object() noexcept {
+    return QmlTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline QmlTask<void> qml_coroutine_detail::Promise<void>::get_return_object() noexcept {
+    return QmlTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// Runs a function on the thread that should resume a coroutine, such as
+// QMetaObject::invokeMethod(context, ...) for a QObject's thread.
+using QmlPost = std::function<void(std::function<void()> run)>;
+
+// `co_await qmlResolveBindings(resolver, bindings)` asks an async resolver
+// for values and resumes with them, result i belonging to bindings[i]. The
+// coroutine resumes inside done(), on the delivering thread, unless post
+// moves it elsewhere.
+class QmlResolveAwaiter {
+public:
+    QmlResolveAwaiter(const AsyncBindingResolver &resolver, std::vector<std::string> bindings, QmlPost post)
+        : resolver_(resolver), bindings_(std::move(bindings)), post_(std::move(post)) {}
+
+    bool await_ready() const noexcept { return bindings_.empty(); }
+    void await_suspend(std::coroutine_handle<> awaiting) {
+        // done() may resume, and so free this awaiter, before the resolver
+        // returns; nothing of it is touched after the call.
+        const std::vector<std::string> bindings = std::move(bindings_);
+        resolver_(bindings, [this, awaiting](std::vector<std::string> values) {
+            values_ = std::move(values);
+            if (post_) {
+                // The posted resume may free this awaiter, and post_ with it.
+                const QmlPost post = std::move(post_);
+                post([awaiting] { awaiting.resume(); });
+            } else {
+                awaiting.resume();
+            }
+        });
+    }
+    std::vector<std::string> await_resume() { return std::move(values_); }
+
+private:
+    const AsyncBindingResolver &resolver_;
+    std::vector<std::string> bindings_;
+    QmlPost post_;
+    std::vector<std::string> values_;
+};
+
+inline QmlResolveAwaiter qmlResolveBindings(const AsyncBindingResolver &resolver, std::vector<std::string> bindings,
+                                            QmlPost post = nullptr) {
+    return QmlResolveAwaiter(resolver, std::move(bindings), std::move(post));
+}
+
+// Lets coroutines wait for frames: the frame scheduler's commit calls
+// notify() after drawing, and `co_await frames.next()` resumes after the
+// next one. Single-threaded, like the scheduler.
+class QmlFrameSignal {
+public:
+    QmlFrameSignal() = default;
+    QmlFrameSignal(const QmlFrameSignal &) = delete;
+    QmlFrameSignal &operator=(const QmlFrameSignal &) = delete;
+
+    class Awaiter {
+    public:
+        explicit Awaiter(QmlFrameSignal &signal) : signal_(signal) {}
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> awaiting) { signal_.waiting_.push_back(awaiting); }
+        uint64_t await_resume() const noexcept { return signal_.frames_; }
+
+    private:
+        QmlFrameSignal &signal_;
+    };
+
+    Awaiter next() { return Awaiter(*this); }
+
+    // Resumes every coroutine waiting now; ones that wait again from there
+    // wait for the frame after.
+    void notify() {
+        ++frames_;
+        resuming_.swap(waiting_);
+        for (std::coroutine_handle<> handle : resuming_) {
+            handle.resume();
+        }
+        resuming_.clear();
+    }
+
+    size_t waiting() const { return waiting_.size(); }
+    uint64_t frames() const { return frames_; }
+
+private:
+    std::vector<std::coroutine_handle<>> waiting_;
+    std::vector<std::coroutine_handle<>> resuming_;  // kept to reuse its capacity
+    uint64_t frames_ = 0;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+// Implicitly shared vector, in the manner of Qt's QSharedDataPointer:
+// copies share one buffer, and the first non-const access through a copy
+// whose buffer is shared detaches it. T may be incomplete where the class
+// is named, so a node type can hold a QmlCowVector of itself.
+//
+// Detaching copies this level only. When T itself holds QmlCowVectors,
+// as QmlNode does, the copied elements keep sharing their own children,
+// so writing one node of a shared tree copies the lists on its path and
+// nothing else.
+//
+// As with Qt's containers, copy or detach on one thread at a time per
+// object; separate copies can be used from separate threads, since a
+// buffer referenced from more than one copy is never written.
+//
+// The buffer and its shared count are allocated from the memory resource
+// given at construction, or the default one. Like a std::pmr container, a
+// copy does not inherit the resource: when it detaches, it allocates from
+// the default resource, so an arena is only ever used by its owner.
+template <typename T>
+class QmlCowVector {
+public:
+    using Storage = std::pmr::vector<T>;
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = typename Storage::iterator;
+    using const_iterator = typename Storage::const_iterator;
+    using reverse_iterator = typename Storage::reverse_iterator;
+    using const_reverse_iterator = typename Storage::const_reverse_iterator;
+
+    QmlCowVector() = default;
+    explicit QmlCowVector(std::pmr::memory_resource *resource) : resource_(resource) {}
+    QmlCowVector(std::initializer_list<T> items) {
+        detach().assign(items);
+    }
+    QmlCowVector(const QmlCowVector &other) : data_(other.data_) {}
+    QmlCowVector &operator=(const QmlCowVector &other) {
+        data_ = other.data_;
+        return *this;
+    }
+    QmlCowVector(QmlCowVector &&other) noexcept : data_(std::move(other.data_)), resource_(other.resource_) {}
+    QmlCowVector &operator=(QmlCowVector &&other) noexcept {
+        data_ = std::move(other.data_);
+        return *this;
+    }
+
+    std::pmr::memory_resource *resource() const { return resource_ ? resource_ : std::pmr::get_default_resource(); }
+
+    // Read access never copies.
+    size_t size() const { return data_ ? data_->size() : 0; }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return data_ ? data_->capacity() : 0; }
+    const T &operator[](size_t i) const { return (*data_)[i]; }
+    const T &front() const { return data_->front(); }
+    const T &back() const { return data_->back(); }
+    const_iterator begin() const { return vector().begin(); }
+    const_iterator end() const { return vector().end(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    const_reverse_iterator rbegin() const { return vector().rbegin(); }
+    const_reverse_iterator rend() const { return vector().rend(); }
+    const Storage &vector() const { return data_ ? *data_ : emptyVector(); }
+
+    // Write access detaches first.
+    T &operator[](size_t i) { return detach()[i]; }
+    T &front() { return detach().front(); }
+    T &back() { return detach().back(); }
+    iterator begin() { return detach().begin(); }
+    iterator end() { return detach().end(); }
+    reverse_iterator rbegin() { return detach().rbegin(); }
+    reverse_iterator rend() { return detach().rend(); }
+    void push_back(const T &item) { detach().push_back(item); }
+    void push_back(T &&item) { detach().push_back(std::move(item)); }
+    template <typename... Args>
+    T &emplace_back(Args &&...args) {
+        return detach().emplace_back(std::forward<Args>(args)...);
+    }
+    void insert(size_t index, T item) {
+        Storage &items = detach();
+        items.insert(items.begin() + static_cast<std::ptrdiff_t>(index), std::move(item));
+    }
+    void erase(size_t index) {
+        Storage &items = detach();
+        items.erase(items.begin() + static_cast<std::ptrdiff_t>(index));
+    }
+    void resize(size_t count) { detach().resize(count); }
+    void reserve(size_t count) { detach().reserve(count); }
+    void clear() { data_.reset(); }
+
+    // True when another copy holds the same buffer.
+    bool isShared() const { return data_ && data_.use_count() > 1; }
+    bool sharesWith(const QmlCowVector &other) const { return data_ && data_ == other.data_; }
+
+private:
+    static const Storage &emptyVector() {
+        static const Storage empty;
+        return empty;
+    }
+
+    // The polymorphic allocator hands itself on to the vector it builds.
+    Storage &detach() {
+        if (!data_) {
+            data_ = std::allocate_shared<Storage>(std::pmr::polymorphic_allocator<Storage>(resource()));
+        } else if (data_.use_count() > 1) {
+            data_ = std::allocate_shared<Storage>(std::pmr::polymorphic_allocator<Storage>(resource()), *data_);
+        }
+        return *data_;
+    }
+
+    std::shared_ptr<Storage> data_;
+    std::pmr::memory_resource *resource_ = nullptr;  // null for the default
+};
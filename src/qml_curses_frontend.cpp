@@ -2,28 +2,68 @@
 
 #include <algorithm>
 #include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
 #include <curses.h>
-#include <stdexcept>
+#include <iterator>
 #include <utility>
 #include <vector>
 
 namespace {
 
-int parseIntOr(const std::string &text, int fallback) {
-    try {
-        size_t consumed = 0;
-        const int value = std::stoi(text, &consumed);
-        if (consumed == text.size()) {
-            return value;
-        }
-    } catch (const std::exception &) {
-        // Fall through to fallback.
+constexpr char kSpinner[] = "|/-\\";  // a BusyIndicator's frames
+
+// Rotates text right by shift characters (left if negative), into out
+// unless that leaves it as it is.
+std::string_view rotate(std::string_view text, int shift, std::string &out) {
+    const auto isLead = [](char c) { return (static_cast<unsigned char>(c) & 0xc0) != 0x80; };
+    const long count = std::count_if(text.begin(), text.end(), isLead);
+    const long by = count == 0 ? 0 : ((shift % count) + count) % count;
+    if (by == 0) {
+        return text;
     }
-    return fallback;
+    // The last `by` characters move to the front.
+    size_t split = text.size();
+    for (long moved = 0; moved < by;) {
+        --split;
+        moved += isLead(text[split]) ? 1 : 0;
+    }
+    out.assign(text.substr(split));
+    out.append(text.substr(0, split));
+    return out;
+}
+
+size_t heapBytes(const std::string &text) {
+    static const size_t inlineCapacity = std::string().capacity();
+    return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+}
+
+// A binding cache entry: its hash node, a next pointer and the pair, and
+// the key's and value's heap buffers.
+template <typename Entry>
+size_t bindingEntryBytes(const Entry &entry) {
+    return sizeof(void *) + sizeof(Entry) + heapBytes(entry.first) + heapBytes(entry.second.value);
 }
 
 }  // namespace
 
+void ICursesScreen::drawStyledText(int row, int col, const std::string &text, uint32_t) {
+    drawText(row, col, text);
+}
+
+void ICursesScreen::drawRuns(const ScreenRun *runs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        runText_.assign(runs[i].text);
+        drawStyledText(runs[i].row, runs[i].col, runText_, runs[i].attributes);
+    }
+}
+
+bool ICursesScreen::scrollRows(int, int, int) {
+    return false;
+}
+
 PdcursesScreen::PdcursesScreen(void *window) : window_(window ? window : stdscr) {}
 
 void PdcursesScreen::clear() {
@@ -40,6 +80,75 @@ void PdcursesScreen::drawText(int row, int col, const std::string &text) {
     mvwaddnstr(static_cast<WINDOW *>(window_), row, col, text.c_str(), static_cast<int>(text.size()));
 }
 
+void PdcursesScreen::drawStyledText(int row, int col, const std::string &text, uint32_t attributes) {
+    if (!window_) {
+        return;
+    }
+    drawRun(ScreenRun{row, col, text, attributes});
+    setAttributes(0);
+}
+
+// The grid's runs come sorted by position, so neighbours often share
+// attributes; the window's are left plain after the batch for whoever
+// draws next.
+void PdcursesScreen::drawRuns(const ScreenRun *runs, size_t count) {
+    if (!window_) {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        drawRun(runs[i]);
+    }
+    setAttributes(0);
+}
+
+bool PdcursesScreen::scrollRows(int top, int bottom, int count) {
+    auto *window = static_cast<WINDOW *>(window_);
+    if (!window || wsetscrreg(window, top, bottom - 1) == ERR) {
+        return false;
+    }
+    idlok(window, TRUE);
+    scrollok(window, TRUE);
+    wscrl(window, count);
+    scrollok(window, FALSE);
+    wsetscrreg(window, 0, rows() - 1);
+    return true;
+}
+
+void PdcursesScreen::drawRun(const ScreenRun &run) {
+    setAttributes(run.attributes);
+    mvwaddnstr(static_cast<WINDOW *>(window_), run.row, run.col, run.text.data(), static_cast<int>(run.text.size()));
+}
+
+void PdcursesScreen::setAttributes(uint32_t attributes) {
+    if (attributes == attributes_) {
+        return;
+    }
+    const auto pair = static_cast<uint32_t>(PAIR_NUMBER(attributes));
+    if (pair != 0) {
+        if (pair >= pairs_.size()) {
+            pairs_.resize(pair + 1, 0);
+        }
+        if (pairs_[pair] == 0) {
+            int foreground = QmlColorPairs::kDefault;
+            int background = QmlColorPairs::kDefault;
+            // Bright colours fold onto the basic eight on 8-colour terminals.
+            const bool ok = has_colors() && static_cast<int>(pair) < COLOR_PAIRS &&
+                            QmlColorPairs::global().colors(pair, foreground, background) &&
+                            init_pair(static_cast<short>(pair), static_cast<short>(foreground < 0 ? -1 : foreground % COLORS),
+                                      static_cast<short>(background < 0 ? -1 : background % COLORS)) != ERR;
+            pairs_[pair] = ok ? 1 : -1;
+        }
+        if (pairs_[pair] < 0) {
+            attributes &= ~static_cast<uint32_t>(A_COLOR);
+            if (attributes == attributes_) {
+                return;
+            }
+        }
+    }
+    wattrset(static_cast<WINDOW *>(window_), static_cast<int>(attributes));
+    attributes_ = attributes;
+}
+
 void PdcursesScreen::refresh() {
     if (!window_) {
         return;
@@ -67,91 +176,2024 @@ int PdcursesScreen::cols() const {
     return x;
 }
 
-QmlCursesFrontend::QmlCursesFrontend(ICursesScreen &screen, BindingResolver resolver)
-    : screen_(screen), resolver_(std::move(resolver)) {}
+void QmlFrontendCore::slotFor(const QmlNode &node, QmlAtom key, TextSlot &slot) {
+    const QmlProperty *prop = node.findProperty(key);
+    slot.width = -1;
+    slot.role = 0;
+    if (!prop) {
+        slot.source = TextSlot::Missing;
+        slot.text.clear();
+        return;
+    }
+    slot.source = prop->typed.kind == QmlValueKind::Binding ? TextSlot::Binding : TextSlot::Literal;
+    slot.text.assign(prop->value.data(), prop->value.size());
+}
+
+// Colours are mapped to a pair when the plan compiles, so drawing a
+// coloured op costs what a plain one does.
+uint32_t QmlFrontendCore::styleFor(const QmlNode &node) {
+    uint32_t style = node.boolProperty(QmlAtoms::fontBold, false) ? static_cast<uint32_t>(A_BOLD) : 0;
+    const QmlProperty *color = node.findProperty(QmlAtoms::color);
+    if (color && color->typed.kind == QmlValueKind::String) {
+        style |= QmlColorPairs::global().attributes(QmlColorPairs::parse(color->value));
+    }
+    return style;
+}
+
+// Frames fetch their bindings before composing, so this only reads the
+// cache: in-flight bindings show the placeholder, the rest their
+// expression.
+QmlFrontendCore::ResolvedText QmlFrontendCore::resolve(const TextSlot &slot, std::string_view defaultValue) const {
+    const auto measured = [](std::string_view text, int &width) {
+        if (width < 0) {
+            width = QmlTextWidth::of(text);
+        }
+        return ResolvedText{text, width};
+    };
+    switch (slot.source) {
+    case TextSlot::Missing:
+        return ResolvedText{defaultValue, QmlTextWidth::of(defaultValue)};
+    case TextSlot::Binding:
+        // Literals are shown as written; only expressions go to the resolver.
+        if (resolves_) {
+            const auto it = bindingCache_.find(slot.text);
+            if (it != bindingCache_.end() && it->second.fresh) {
+                if (!it->second.value.empty()) {
+                    return measured(it->second.value, it->second.width);
+                }
+            } else if (deferring_ || pendingBindings_.count(slot.text) > 0) {
+                return ResolvedText{pendingPlaceholder_, pendingPlaceholderWidth_};
+            }
+        }
+        break;
+    case TextSlot::Literal:
+    case TextSlot::Role:
+        break;
+    }
+    return measured(slot.text, slot.width);
+}
+
+QmlFrontendCore::ResolvedText QmlFrontendCore::resolveIn(size_t item, const TextSlot &slot,
+                                                         std::string_view defaultValue) const {
+    if (slot.source != TextSlot::Role) {
+        return resolve(slot, defaultValue);
+    }
+    const Repeater &repeater = plan_.repeaters[plan_.itemRepeater[item]];
+    const Repeater::Row &row = repeater.rows[item - repeater.firstItem];
+    int &width = row.widths[slot.role];
+    if (width < 0) {
+        width = QmlTextWidth::of(row.values[slot.role]);
+    }
+    return ResolvedText{row.values[slot.role], width};
+}
+
+template <typename Visit>
+void QmlFrontendCore::forEachByPriority(Visit &&visit) const {
+    size_t first, begin, end;
+    window(first, begin, end);
+    const size_t viewEnd = scrollMode_ == ScrollMode::Rows ? end : std::min(end, first + itemsFrom(first));
+    const size_t focus = focus_ < plan_.focusOrder.size() ? plan_.focusOrder[focus_].item : viewEnd;
+    const bool focusInView = focus >= first && focus < viewEnd;
+    const size_t focused = focusInView ? focus : first;
+    if (focusInView) {
+        visit(focused);
+    }
+    visit(kTitleItem);
+    if (!focusInView && focused < viewEnd) {
+        visit(focused);
+    }
+    for (size_t step = 1; step < viewEnd - first; ++step) {
+        if (focused >= first + step) {
+            visit(focused - step);
+        }
+        if (focused + step < viewEnd) {
+            visit(focused + step);
+        }
+    }
+    for (size_t i = first; i > begin; --i) {
+        visit(i - 1);
+    }
+    for (size_t i = viewEnd; i < end; ++i) {
+        visit(i);
+    }
+}
+
+// Calls visit(slot) for the window's binding slots that are neither fresh
+// in the cache nor in flight, in the order of forEachByPriority().
+template <typename Visit>
+void QmlFrontendCore::forEachUnresolved(bool fallbacks, Visit &&visit) const {
+    if (!resolves_) {
+        return;
+    }
+    const auto check = [this, &visit](const TextSlot &slot) {
+        if (slot.source != TextSlot::Binding) {
+            return;
+        }
+        const auto it = bindingCache_.find(slot.text);
+        if ((it == bindingCache_.end() || !it->second.fresh) && pendingBindings_.count(slot.text) == 0) {
+            visit(slot);
+        }
+    };
+
+    forEachByPriority([&](size_t i) {
+        if (i == kTitleItem) {
+            if (!fallbacks) {
+                check(plan_.title);
+            }
+            return;
+        }
+        const uint32_t item = plan_.items[i];
+        for (uint32_t index = item; index < plan_.layout.node(item).end; ++index) {
+            const QmlLayout::Node &node = plan_.layout.node(index);
+            if (node.kind != QmlLayout::Kind::Leaf) {
+                continue;
+            }
+            const DrawOp &op = plan_.ops[node.leaf];
+            if (!fallbacks) {
+                check(op.text);
+            } else if (op.blankIfEmpty && op.fallback.source == TextSlot::Binding &&
+                       resolveIn(i, op.text, op.missingText).empty()) {
+                check(op.fallback);
+            }
+        }
+    });
+}
+
+// Gathers the unresolved bindings without duplicates. The vector is
+// reused as scratch space.
+void QmlFrontendCore::collectUnresolved(bool fallbacks, std::vector<std::string> &bindings) const {
+    bindings.clear();
+    forEachUnresolved(fallbacks, [&bindings](const TextSlot &slot) {
+        if (std::find(bindings.begin(), bindings.end(), slot.text) == bindings.end()) {
+            bindings.push_back(slot.text);
+        }
+    });
+}
+
+// Resolves the unresolved bindings straight into their cache entries; only
+// a binding's first frame allocates its entry.
+size_t QmlFrontendCore::writeUnresolved(bool fallbacks, BindingWriter write) {
+    if (resolveExecutor_) {
+        return writeUnresolvedInParallel(fallbacks, write);
+    }
+    size_t written = 0;
+    forEachUnresolved(fallbacks, [this, &write, &written](const TextSlot &slot) {
+        // Each pass writes one at least, so a sliced frame still progresses.
+        if (deferring_ || (written > 0 && sliceExpired())) {
+            deferring_ = true;
+            return;
+        }
+        auto it = bindingCache_.find(slot.text);
+        if (it == bindingCache_.end()) {
+            it = bindingCache_.emplace(slot.text, CachedBinding{}).first;
+        } else if (it->second.fresh) {
+            return;  // a duplicate written earlier in this pass
+        }
+        it->second.value.clear();
+        write(it->first, it->second.value);
+        ++written;
+        ++contentVersion_;
+        it->second.width = -1;
+        it->second.fresh = true;
+    });
+    return written;
+}
 
-std::string QmlCursesFrontend::resolveValue(const std::string &value) const {
-    if (resolver_) {
-        const std::string resolved = resolver_(value);
-        if (!resolved.empty()) {
-            return resolved;
+// Entries are created and claimed here, on the rendering thread; the workers
+// then write each value into its own entry, so the writes share nothing.
+size_t QmlFrontendCore::writeUnresolvedInParallel(bool fallbacks, BindingWriter write) {
+    writes_.clear();
+    forEachUnresolved(fallbacks, [this](const TextSlot &slot) {
+        auto it = bindingCache_.find(slot.text);
+        if (it == bindingCache_.end()) {
+            it = bindingCache_.emplace(slot.text, CachedBinding{}).first;
+        } else if (it->second.fresh) {
+            return;  // a duplicate claimed earlier in this pass
         }
+        it->second.fresh = true;
+        writes_.push_back(&*it);
+    });
+    const auto writeOne = [this, &write](size_t index) {
+        std::pair<const std::string, CachedBinding> &entry = *writes_[index];
+        entry.second.value.clear();
+        write(entry.first, entry.second.value);
+    };
+    if (writes_.size() >= parallelMinimum_) {
+        resolveExecutor_->parallelFor("QmlFrontendCore::resolve", writes_.size(), writeOne);
+    } else {
+        for (size_t index = 0; index < writes_.size(); ++index) {
+            writeOne(index);
+        }
+    }
+    for (const auto *entry : writes_) {
+        entry->second.width = -1;
+    }
+    contentVersion_ += writes_.size();
+    return writes_.size();
+}
+
+void QmlFrontendCore::storeResolved(std::vector<std::string> &bindings, std::vector<std::string> values) {
+    values.resize(bindings.size());
+    for (size_t i = 0; i < bindings.size(); ++i) {
+        CachedBinding &entry = bindingCache_[std::move(bindings[i])];
+        entry.value = std::move(values[i]);
+        entry.width = -1;
+        entry.fresh = true;
+    }
+    bindings.clear();
+    ++contentVersion_;
+}
+
+void QmlFrontendCore::markPending(const std::vector<std::string> &bindings) {
+    pendingBindings_.insert(bindings.begin(), bindings.end());
+    ++contentVersion_;
+}
+
+bool QmlFrontendCore::acceptPending(uint64_t generation, std::string binding, std::string value) {
+    // A binding invalidated while in flight is no longer pending; its
+    // stale value is dropped and the next frame asks again.
+    if (generation != bindingGeneration_ || pendingBindings_.erase(binding) == 0) {
+        return false;
     }
-    return value;
+    CachedBinding &entry = bindingCache_[std::move(binding)];
+    entry.value = std::move(value);
+    entry.width = -1;
+    entry.fresh = true;
+    ++contentVersion_;
+    return true;
 }
 
-void QmlCursesFrontend::drawCentered(int row, const std::string &text, int paddedWidth) {
+void QmlFrontendCore::placeCentered(int row, ResolvedText text, bool framed, int paddedWidth) {
     if (text.empty()) {
         return;
     }
 
-    const int length = static_cast<int>(text.size());
+    const int length = text.width + (framed ? 4 : 0);
     const int width = paddedWidth > 0 ? paddedWidth : length;
-    const int leftPadding = std::max(0, (screen_.cols() - width) / 2);
+    const int leftPadding = std::max(0, (plan_.cols - width) / 2);
     const int offset = std::max(0, (width - length) / 2);
-    screen_.drawText(row, leftPadding + offset, text);
+    frame_.push_back(Placement{row, leftPadding + offset, text.text, text.width, framed});
 }
 
-void QmlCursesFrontend::render(const QmlDocument &document) {
-    screen_.clear();
+void QmlFrontendCore::compilePlan(const QmlDocument &document, int rows, int cols) {
+    beginPlan(document, rows, cols);
+    continuePlan(false);
+}
 
-    const QmlNode *window = document.firstRootOfType("ApplicationWindow");
+void QmlFrontendCore::beginPlan(const QmlDocument &document, int rows, int cols) {
+    removeTracks();
+    recyclePlan();
+    hits_.clear();
+    focus_ = kNoFocus;
+    resetCursor();
+    plan_.document = &document;
+    plan_.revision = document.revision();
+    ++contentVersion_;
+    ++planCompileCount_;
+    plan_.rows = rows;
+    plan_.cols = cols;
+    compileContent_ = nullptr;
+    compileNext_ = 0;
+
+    const QmlNode *window = document.firstRootOfType(QmlAtoms::ApplicationWindow);
     if (!window) {
-        screen_.refresh();
         return;
     }
+    slotFor(*window, QmlAtoms::title, plan_.title);
 
-    const std::string title = resolveValue(window->property("title"));
-    int row = 0;
-    if (!title.empty()) {
-        drawCentered(row, title);
-        row += 2;
+    const QmlNode *content = nullptr;
+    for (const auto &child : window->children) {
+        if (child.typeAtom == QmlAtoms::Timer || child.typeAtom == QmlAtoms::NumberAnimation) {
+            compileAnimated(child);
+            continue;
+        }
+        if (child.typeAtom == QmlAtoms::Column || child.typeAtom == QmlAtoms::Row || child.typeAtom == QmlAtoms::Grid ||
+            child.typeAtom == QmlAtoms::Repeater || child.typeAtom == QmlAtoms::ListView ||
+            child.typeAtom == QmlAtoms::LogView) {
+            content = &child;
+            break;
+        }
     }
-
-    const QmlNode *column = window->findChildByType("Column");
-    if (!column) {
-        screen_.refresh();
+    if (!content) {
         return;
     }
+    plan_.centered = content->findProperty(QmlAtoms::anchorsCenterIn) != nullptr;
+
+    if (content->typeAtom == QmlAtoms::Column) {
+        // The top-level Column's children are stacked as separate items so
+        // that it can be virtualized, and compiled by continuePlan().
+        plan_.spacing = std::max(0, content->intProperty(QmlAtoms::spacing, 1));
+        plan_.items.reserve(content->children.size());
+        compileContent_ = content;
+    } else if (content->typeAtom == QmlAtoms::Repeater || content->typeAtom == QmlAtoms::ListView) {
+        plan_.spacing = std::max(0, content->intProperty(QmlAtoms::spacing, 0));
+        compileRepeater(*content);
+    } else {
+        const uint32_t item = compileNode(*content, QmlLayout::kNoParent);
+        if (item != QmlLayout::kNoParent) {
+            plan_.items.push_back(item);
+            plan_.itemRepeater.push_back(kNoRepeater);
+        }
+    }
+}
+
+void QmlFrontendCore::releasePlan() {
+    removeTracks();
+    recyclePlan();
+    hits_.clear();
+    focus_ = kNoFocus;
+    resetCursor();
+    compileContent_ = nullptr;
+    compileNext_ = 0;
+    instances_.clear();
+    instanceCount_ = 0;
+    instancesDocument_ = nullptr;
+    instancesRevision_ = 0;
+}
+
+void QmlFrontendCore::recyclePlan() {
+    opPool_.giveAll(plan_.ops);
+    for (Repeater &repeater : plan_.repeaters) {
+        rowPool_.giveAll(repeater.rows);
+    }
+    QmlLayout layout = std::move(plan_.layout);
+    layout.clear();
+    plan_ = RenderPlan{};
+    plan_.layout = std::move(layout);
+}
+
+QmlFrontendCore::DrawOp QmlFrontendCore::takeOp() {
+    DrawOp pooled = opPool_.take();
+    DrawOp op;
+    op.text.text = std::move(pooled.text.text);
+    op.text.text.clear();
+    op.fallback.text = std::move(pooled.fallback.text);
+    op.fallback.text.clear();
+    op.rotated = std::move(pooled.rotated);
+    op.rotated.clear();
+    return op;
+}
+
+// Compiles the top-level Column's children one item at a time. Sliced, it
+// stops once the frame's slice runs out, leaving a plan of the items so
+// far that the next frame continues.
+void QmlFrontendCore::continuePlan(bool sliced) {
+    if (compileContent_) {
+        const QmlNodeList &children = compileContent_->children;
+        while (compileNext_ < children.size()) {
+            const QmlNode &child = children[compileNext_++];
+            if (child.typeAtom == QmlAtoms::Repeater || child.typeAtom == QmlAtoms::ListView) {
+                compileRepeater(child);
+            } else {
+                const uint32_t item = compileNode(child, QmlLayout::kNoParent);
+                if (item != QmlLayout::kNoParent) {
+                    plan_.items.push_back(item);
+                    plan_.itemRepeater.push_back(kNoRepeater);
+                }
+            }
+            if (sliced && compileNext_ < children.size() && sliceExpired()) {
+                extendItemTops();
+                ++contentVersion_;
+                return;
+            }
+        }
+        compileContent_ = nullptr;
+        ++contentVersion_;
+    }
+
+    updateItemTops();
+    for (const QmlNode *animation : animations_) {
+        const auto target = plan_.textOps.find(animation->property(QmlAtoms::target));
+        if (target != plan_.textOps.end()) {
+            const QmlAtom property = QmlAtomTable::global().intern(animation->property(QmlAtoms::property));
+            compileAnimation(*animation, target->second, property, animation->boolProperty(QmlAtoms::running, false));
+        }
+    }
+    animations_.clear();
+    // The focus stays on the same item, or goes to the initial one.
+    for (size_t i = 0; i < plan_.focusOrder.size() && focus_ == kNoFocus; ++i) {
+        if (!focusKey_.empty() && plan_.focusOrder[i].key == focusKey_) {
+            focus_ = i;
+        }
+    }
+    if (focus_ == kNoFocus && plan_.initialFocus != kNoFocus) {
+        focus_ = plan_.initialFocus;
+        focusKey_ = plan_.focusOrder[focus_].key;
+    }
+    resetCursor();
+}
+
+void QmlFrontendCore::updateItemTops() {
+    plan_.itemTop.clear();
+    extendItemTops();
+}
+
+// Adds the tops of the items appended since the last call.
+void QmlFrontendCore::extendItemTops() {
+    std::vector<int> &tops = plan_.itemTop;
+    int top = tops.empty() ? 0 : tops.back() + plan_.layout.node(plan_.items[tops.size() - 1]).height + plan_.spacing;
+    tops.reserve(plan_.items.size());
+    for (size_t i = tops.size(); i < plan_.items.size(); ++i) {
+        tops.push_back(top);
+        top += plan_.layout.node(plan_.items[i]).height + plan_.spacing;
+    }
+}
+
+void QmlFrontendCore::setFrameBudget(std::chrono::nanoseconds budget, InputPending inputPending) {
+    frameBudget_ = budget;
+    inputWaiting_ = std::move(inputPending);
+}
 
-    const int spacing = parseIntOr(column->property("spacing", "1"), 1);
-    std::vector<std::string> lines;
-    lines.reserve(column->children.size());
+bool QmlFrontendCore::sliceExpired() {
+    if (frameBudget_.count() <= 0) {
+        return false;
+    }
+    // Input is checked less often than the clock, as it may take a call
+    // into the system.
+    if (!sliceStopped_) {
+        sliceStopped_ = std::chrono::steady_clock::now() >= sliceDeadline_ ||
+                        (inputWaiting_ && ++sliceChecks_ % kInputCheckInterval == 0 && inputWaiting_());
+    }
+    return sliceStopped_;
+}
 
-    for (const auto &child : column->children) {
-        if (child.type == "Text" || child.type == "Label") {
-            lines.push_back(resolveValue(child.property("text")));
-        } else if (child.type == "TextField") {
-            std::string content = resolveValue(child.property("text"));
-            if (content.empty()) {
-                content = resolveValue(child.property("placeholderText"));
+// Appends node's subtree to the layout; returns its index, or kNoParent
+// for elements the frontend does not draw.
+uint32_t QmlFrontendCore::compileNode(const QmlNode &node, uint32_t parent) {
+    if (!node.boolProperty(QmlAtoms::visible, true)) {
+        return QmlLayout::kNoParent;
+    }
+    QmlLayout::Kind kind;
+    switch (node.typeAtom) {
+    case QmlAtoms::Column:
+        kind = QmlLayout::Kind::Column;
+        break;
+    case QmlAtoms::Row:
+        kind = QmlLayout::Kind::Row;
+        break;
+    case QmlAtoms::Grid:
+        kind = QmlLayout::Kind::Grid;
+        break;
+    default: {
+        DrawOp op = takeOp();
+        switch (node.typeAtom) {
+        case QmlAtoms::Text:
+        case QmlAtoms::Label: {
+            compileSlot(node, QmlAtoms::text, op.text);
+            const QmlProperty *wrapMode = node.findProperty(QmlAtoms::wrapMode);
+            // A wrap caches one text's lines, so delegates shared by rows
+            // cannot have one.
+            if (wrapMode && wrapMode->typed.kind == QmlValueKind::Enum && compilingRepeater_ == kNoRepeater) {
+                const QmlTextWrap::Mode mode = QmlTextWrap::modeFor(wrapMode->value);
+                if (mode != QmlTextWrap::Mode::NoWrap) {
+                    op.wrap = static_cast<uint32_t>(plan_.wraps.size());
+                    plan_.wraps.emplace_back(mode);
+                }
+            }
+            break;
+        }
+        case QmlAtoms::TextField:
+            compileSlot(node, QmlAtoms::text, op.text);
+            compileSlot(node, QmlAtoms::placeholderText, op.fallback);
+            op.framed = true;
+            op.blankIfEmpty = true;
+            break;
+        case QmlAtoms::Button:
+            compileSlot(node, QmlAtoms::text, op.text);
+            op.missingText = "Button";
+            op.framed = true;
+            break;
+        case QmlAtoms::BusyIndicator:
+            op.text.source = TextSlot::Literal;
+            op.text.text.assign(1, kSpinner[0]);
+            op.hidden = !node.boolProperty(QmlAtoms::running, true);
+            break;
+        case QmlAtoms::Timer:
+        case QmlAtoms::NumberAnimation:
+            compileAnimated(node);
+            return QmlLayout::kNoParent;
+        case QmlAtoms::LogView: {
+            const QmlProperty *model = node.findProperty(QmlAtoms::model);
+            const auto ring = model ? logRings_.find(model->value) : logRings_.end();
+            if (ring == logRings_.end() || compilingRepeater_ != kNoRepeater) {
+                return QmlLayout::kNoParent;
+            }
+            op.log = static_cast<uint32_t>(plan_.logs.size());
+            plan_.logs.push_back(LogPane{ring->second, std::max(1, node.intProperty(QmlAtoms::height, 10)),
+                                         std::max(0, node.intProperty(QmlAtoms::width, 0)), ring->second->appended()});
+            break;
+        }
+        default: {
+            const auto custom = elementRenderers_.find(node.typeAtom);
+            if (custom == elementRenderers_.end()) {
+                return compileReference(node, parent);
+            }
+            ElementDraw draw = custom->second(node);
+            op.text = TextSlot{draw.binding ? TextSlot::Binding : TextSlot::Literal, std::move(draw.text)};
+            op.framed = draw.framed;
+            op.style = draw.attributes;
+            break;
+        }
+        }
+        op.style |= styleFor(node);
+        plan_.ops.push_back(std::move(op));
+        const auto leaf = static_cast<uint32_t>(plan_.ops.size() - 1);
+        if (compilingRepeater_ == kNoRepeater) {
+            compileInteractive(node, leaf);
+            if (timeline_ && node.typeAtom == QmlAtoms::BusyIndicator && !plan_.ops[leaf].hidden) {
+                // One turn of the spinner every 400 ms.
+                const QmlTimeline::Track track = timeline_->addAnimation(
+                    0, 4, std::chrono::milliseconds(400), QmlTimeline::kInfinite, [this, leaf](double value) {
+                        std::string &glyph = plan_.ops[leaf].text.text;
+                        const char next = kSpinner[static_cast<int>(value) % 4];
+                        if (glyph.size() != 1 || glyph[0] == next) {
+                            return false;  // also if setItemText() replaced it
+                        }
+                        glyph[0] = next;
+                        ++contentVersion_;
+                        return true;
+                    });
+                plan_.tracks.push_back(track);
+                timeline_->start(track);
             }
-            if (content.empty()) {
-                content = " ";
+            // The parser keeps "NumberAnimation on x {" as a child of that type.
+            constexpr std::string_view kOn = "NumberAnimation on ";
+            for (const auto &child : node.children) {
+                if (std::string_view(child.type).substr(0, kOn.size()) == kOn) {
+                    const QmlAtom property = QmlAtomTable::global().intern(std::string_view(child.type).substr(kOn.size()));
+                    compileAnimation(child, leaf, property, child.boolProperty(QmlAtoms::running, true));
+                }
             }
-            lines.push_back("[ " + content + " ]");
-        } else if (child.type == "Button") {
-            std::string label = child.property("text", "Button");
-            label = resolveValue(label);
-            lines.push_back("[ " + label + " ]");
         }
+        const uint32_t index = plan_.layout.addLeaf(parent, leaf);
+        if (plan_.ops[leaf].log != DrawOp::kNoLog) {
+            plan_.layout.setLeafHeight(index, plan_.logs[plan_.ops[leaf].log].rows);
+        }
+        return index;
+    }
+    }
+
+    // Qt's Grid defaults to four columns.
+    const uint32_t index = plan_.layout.open(kind, parent, node.intProperty(QmlAtoms::spacing, 1),
+                                             node.intProperty(QmlAtoms::columns, 4));
+    for (const auto &child : node.children) {
+        compileNode(child, index);
     }
+    plan_.layout.close(index);
+    return index;
+}
 
-    const int paddedWidth = lines.empty()
-                                ? 0
-                                : static_cast<int>(
-                                      std::max_element(lines.begin(), lines.end(), [](const std::string &a, const std::string &b) {
-                                          return a.size() < b.size();
-                                      })
-                                          ->size());
+// A component use is compiled from its instance once that is made, and
+// as a blank row until then.
+uint32_t QmlFrontendCore::compileReference(const QmlNode &node, uint32_t parent) {
+    // Instances arrive expanded, so nothing inside one is a use.
+    if (!instantiator_ || compilingInstance_ || compilingRepeater_ != kNoRepeater) {
+        return QmlLayout::kNoParent;
+    }
+    const auto it = instances_.find(&node);
+    if (it != instances_.end()) {
+        if (!it->second) {
+            return QmlLayout::kNoParent;
+        }
+        compilingInstance_ = true;
+        const uint32_t index = compileNode(*it->second, parent);
+        compilingInstance_ = false;
+        return index;
+    }
+    // plan_.items gets the item being compiled once it is done.
+    plan_.references.push_back(Reference{plan_.items.size(), &node});
+    plan_.ops.push_back(takeOp());
+    return plan_.layout.addLeaf(parent, static_cast<uint32_t>(plan_.ops.size() - 1));
+}
 
-    for (const auto &line : lines) {
-        if (row >= screen_.rows()) {
+// The delegate is compiled once, outside any item, and each row's item is
+// a copy of its layout.
+void QmlFrontendCore::compileRepeater(const QmlNode &node) {
+    const QmlProperty *model = node.findProperty(QmlAtoms::model);
+    const auto it = model ? models_.find(model->value) : models_.end();
+    if (it == models_.end() || node.children.empty() || !node.boolProperty(QmlAtoms::visible, true)) {
+        return;
+    }
+    // The object bound to delegate:, else the first child.
+    const QmlNode *delegate = &node.children[0];
+    for (const QmlNode &child : node.children) {
+        if (child.binding == QmlAtoms::delegate) {
+            delegate = &child;
             break;
         }
-        drawCentered(row, line, paddedWidth);
-        row += 1 + spacing;
     }
 
-    screen_.refresh();
+    const uint32_t index = static_cast<uint32_t>(plan_.repeaters.size());
+    plan_.repeaters.emplace_back();
+    plan_.repeaters.back().model = &it->second->model();
+    plan_.repeaters.back().firstItem = plan_.items.size();
+    compilingRepeater_ = index;
+    const uint32_t root = compileNode(*delegate, QmlLayout::kNoParent);
+    compilingRepeater_ = kNoRepeater;
+    if (root == QmlLayout::kNoParent) {
+        plan_.repeaters.pop_back();
+        return;
+    }
+
+    Repeater &repeater = plan_.repeaters.back();
+    repeater.delegate = root;
+    const size_t rowCount = repeater.model->rowCount();
+    repeater.rows.reserve(rowCount);
+    for (size_t row = 0; row < rowCount; ++row) {
+        repeater.rows.push_back(rowPool_.take());
+        fetchRow(repeater, row, repeater.rows[row]);
+        plan_.items.push_back(plan_.layout.cloneSubtree(root));
+        plan_.itemRepeater.push_back(index);
+    }
+}
+
+// Inside a delegate, model.<role> bindings read the row rather than going
+// to the resolver.
+void QmlFrontendCore::compileSlot(const QmlNode &node, QmlAtom key, TextSlot &slot) {
+    slotFor(node, key, slot);
+    constexpr std::string_view kModel = "model.";
+    if (compilingRepeater_ == kNoRepeater || slot.source != TextSlot::Binding ||
+        std::string_view(slot.text).substr(0, kModel.size()) != kModel) {
+        return;
+    }
+    std::vector<QmlAtom> &roles = plan_.repeaters[compilingRepeater_].roles;
+    const QmlAtom role = QmlAtomTable::global().intern(std::string_view(slot.text).substr(kModel.size()));
+    slot.source = TextSlot::Role;
+    slot.role = static_cast<uint32_t>(std::find(roles.begin(), roles.end(), role) - roles.begin());
+    if (slot.role == roles.size()) {
+        roles.push_back(role);
+    }
+}
+
+// Items compile before they are added, so the one being compiled is the
+// next in plan_.items.
+void QmlFrontendCore::compileInteractive(const QmlNode &node, uint32_t op) {
+    DrawOp &draw = plan_.ops[op];
+    const std::string id = node.property(QmlAtoms::id);
+    std::string key = id;
+    const bool field = node.typeAtom == QmlAtoms::TextField;
+    if (field || node.typeAtom == QmlAtoms::Button) {
+        if (key.empty()) {
+            key = "#" + std::to_string(plan_.focusOrder.size());
+        }
+        if (plan_.initialFocus == kNoFocus && node.boolProperty(QmlAtoms::focus, false)) {
+            plan_.initialFocus = plan_.focusOrder.size();
+        }
+        const QmlScriptBlock *action = node.findScript(field ? QmlAtoms::onAccepted : QmlAtoms::onClicked);
+        draw.focus = static_cast<uint32_t>(plan_.focusOrder.size());
+        plan_.focusOrder.push_back(
+            Focusable{op, plan_.items.size(), field, id, key, action ? *action : QmlScriptBlock{}});
+    }
+    if (!id.empty()) {
+        plan_.textOps[id] = op;
+    }
+    const auto text = itemText_.find(key);
+    if (text != itemText_.end()) {
+        draw.text = TextSlot{TextSlot::Literal, text->second};
+    }
+}
+
+void QmlFrontendCore::compileAnimated(const QmlNode &node) {
+    if (node.typeAtom == QmlAtoms::NumberAnimation) {
+        animations_.push_back(&node);  // its target may come later
+        return;
+    }
+    const QmlScriptBlock *script = node.findScript(QmlAtoms::onTriggered);
+    if (!timeline_ || !script || compilingRepeater_ != kNoRepeater) {
+        return;
+    }
+    // Qt's defaults: a second, once, stopped.
+    const auto interval = std::chrono::milliseconds(std::max(0, node.intProperty(QmlAtoms::interval, 1000)));
+    const QmlTimeline::Track track = timeline_->addTimer(
+        interval, node.boolProperty(QmlAtoms::repeat, false),
+        [this, id = node.property(QmlAtoms::id), script = *script] {
+            if (action_) {
+                action_(id, script);
+            }
+        });
+    plan_.tracks.push_back(track);
+    if (node.boolProperty(QmlAtoms::running, false)) {
+        timeline_->start(track);
+    }
+}
+
+void QmlFrontendCore::compileAnimation(const QmlNode &node, uint32_t op, QmlAtom property, bool running) {
+    if (!timeline_ || (property != QmlAtoms::opacity && property != QmlAtoms::x)) {
+        return;
+    }
+    // from and to default to the property's resting value.
+    const double from = node.realProperty(QmlAtoms::from, property == QmlAtoms::opacity ? 1.0 : 0.0);
+    const QmlProperty *loops = node.findProperty(QmlAtoms::loops);
+    int count = 1;
+    if (loops && loops->value == "Animation.Infinite") {
+        count = QmlTimeline::kInfinite;
+    } else if (loops) {
+        count = std::max(1, node.intProperty(QmlAtoms::loops, 1));
+    }
+    const auto duration = std::chrono::milliseconds(std::max(0, node.intProperty(QmlAtoms::duration, 250)));
+    const QmlTimeline::Track track =
+        timeline_->addAnimation(from, node.realProperty(QmlAtoms::to, from), duration, count,
+                                [this, op, property](double value) { return animate(op, property, value); });
+    plan_.tracks.push_back(track);
+    if (running) {
+        timeline_->start(track);
+    }
+}
+
+// Returns whether the op will look different.
+bool QmlFrontendCore::animate(uint32_t op, QmlAtom property, double value) {
+    DrawOp &draw = plan_.ops[op];
+    if (property == QmlAtoms::opacity) {
+        const bool hidden = value < 0.5;
+        if (hidden == draw.hidden) {
+            return false;
+        }
+        draw.hidden = hidden;
+    } else {
+        const int shift = static_cast<int>(std::floor(value));
+        if (shift == draw.shift) {
+            return false;
+        }
+        draw.shift = shift;
+    }
+    ++contentVersion_;
+    return true;
+}
+
+void QmlFrontendCore::removeTracks() {
+    if (timeline_) {
+        for (const QmlTimeline::Track track : plan_.tracks) {
+            timeline_->remove(track);
+        }
+    }
+    plan_.tracks.clear();
+}
+
+void QmlFrontendCore::setTimeline(QmlTimeline *timeline) {
+    if (timeline == timeline_) {
+        return;
+    }
+    if (timeline_) {
+        removeTracks();
+        timeline_->remove(cursorTrack_);
+        cursorTrack_ = QmlTimeline::kNoTrack;
+    }
+    timeline_ = timeline;
+    if (timeline_) {
+        // Qt's cursor flash time is a second: half on, half off.
+        cursorTrack_ = timeline_->addTimer(std::chrono::milliseconds(500), true, [this] {
+            cursorShown_ = !cursorShown_;
+            ++contentVersion_;
+        });
+    }
+    invalidatePlan();
+}
+
+QmlFrontendCore::~QmlFrontendCore() {
+    setTimeline(nullptr);
+}
+
+void QmlFrontendCore::resetCursor() {
+    if (!timeline_) {
+        return;
+    }
+    cursorShown_ = true;
+    if (focus_ != kNoFocus && plan_.focusOrder[focus_].field) {
+        timeline_->start(cursorTrack_);
+    } else {
+        timeline_->stop(cursorTrack_);
+    }
+}
+
+void QmlFrontendCore::fetchRow(const Repeater &repeater, size_t row, Repeater::Row &values) {
+    values.values.resize(repeater.roles.size());
+    values.widths.assign(repeater.roles.size(), -1);
+    for (size_t role = 0; role < repeater.roles.size(); ++role) {
+        values.values[role].clear();
+        repeater.model->data(row, repeater.roles[role], values.values[role]);
+    }
+}
+
+// Items from the index from on move by by, along with the repeaters after
+// the one at repeater and the references into them.
+void QmlFrontendCore::shiftItems(size_t from, size_t repeater, long by) {
+    for (size_t later = repeater + 1; later < plan_.repeaters.size(); ++later) {
+        plan_.repeaters[later].firstItem += by;
+    }
+    for (Reference &reference : plan_.references) {
+        if (reference.item >= from) {
+            reference.item += by;
+        }
+    }
+    for (Focusable &focusable : plan_.focusOrder) {
+        if (focusable.item >= from) {
+            focusable.item += by;
+        }
+    }
+}
+
+// Without a plan there is nothing to patch; the next render compiles the
+// rows as they are then. Notifications that do not fit the rows the plan
+// has fall back to recompiling.
+void QmlFrontendCore::insertRows(const QmlListModel &model, size_t first, size_t count) {
+    if (!plan_.document) {
+        return;
+    }
+    for (size_t index = 0; index < plan_.repeaters.size(); ++index) {
+        Repeater &repeater = plan_.repeaters[index];
+        if (repeater.model != &model) {
+            continue;
+        }
+        if (first > repeater.rows.size()) {
+            invalidatePlan();
+            return;
+        }
+        std::vector<Repeater::Row> rows;
+        rows.reserve(count);
+        std::vector<uint32_t> items(count);
+        for (size_t row = 0; row < count; ++row) {
+            rows.push_back(rowPool_.take());
+            fetchRow(repeater, first + row, rows[row]);
+            uint32_t spare = QmlLayout::kNoParent;
+            if (!repeater.spares.empty()) {
+                spare = repeater.spares.back();
+                repeater.spares.pop_back();
+            }
+            items[row] = plan_.layout.cloneSubtree(repeater.delegate, spare);
+        }
+        const size_t at = repeater.firstItem + first;
+        repeater.rows.insert(repeater.rows.begin() + static_cast<std::ptrdiff_t>(first),
+                             std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+        plan_.items.insert(plan_.items.begin() + static_cast<std::ptrdiff_t>(at), items.begin(), items.end());
+        plan_.itemRepeater.insert(plan_.itemRepeater.begin() + static_cast<std::ptrdiff_t>(at), count,
+                                  static_cast<uint32_t>(index));
+        shiftItems(at, index, static_cast<long>(count));
+    }
+    updateItemTops();
+    ++contentVersion_;
+}
+
+void QmlFrontendCore::removeRows(const QmlListModel &model, size_t first, size_t count) {
+    if (!plan_.document) {
+        return;
+    }
+    for (size_t index = 0; index < plan_.repeaters.size(); ++index) {
+        Repeater &repeater = plan_.repeaters[index];
+        if (repeater.model != &model) {
+            continue;
+        }
+        if (first + count > repeater.rows.size()) {
+            invalidatePlan();
+            return;
+        }
+        const auto at = static_cast<std::ptrdiff_t>(repeater.firstItem + first);
+        const auto last = at + static_cast<std::ptrdiff_t>(count);
+        repeater.spares.insert(repeater.spares.end(), plan_.items.begin() + at, plan_.items.begin() + last);
+        for (size_t row = first; row < first + count; ++row) {
+            rowPool_.give(std::move(repeater.rows[row]));
+        }
+        repeater.rows.erase(repeater.rows.begin() + static_cast<std::ptrdiff_t>(first),
+                            repeater.rows.begin() + static_cast<std::ptrdiff_t>(first + count));
+        plan_.items.erase(plan_.items.begin() + at, plan_.items.begin() + last);
+        plan_.itemRepeater.erase(plan_.itemRepeater.begin() + at, plan_.itemRepeater.begin() + last);
+        shiftItems(static_cast<size_t>(last), index, -static_cast<long>(count));
+    }
+    updateItemTops();
+    ++contentVersion_;
+}
+
+void QmlFrontendCore::moveRows(const QmlListModel &model, size_t first, size_t count, size_t destination) {
+    if (!plan_.document) {
+        return;
+    }
+    for (Repeater &repeater : plan_.repeaters) {
+        if (repeater.model != &model) {
+            continue;
+        }
+        if (first + count > repeater.rows.size() || destination + count > repeater.rows.size()) {
+            invalidatePlan();
+            return;
+        }
+        const auto move = [&](auto begin) {
+            if (destination < first) {
+                std::rotate(begin + destination, begin + first, begin + first + count);
+            } else {
+                std::rotate(begin + first, begin + first + count, begin + destination + count);
+            }
+        };
+        move(repeater.rows.begin());
+        move(plan_.items.begin() + static_cast<std::ptrdiff_t>(repeater.firstItem));
+    }
+    updateItemTops();
+    ++contentVersion_;
+}
+
+void QmlFrontendCore::updateRows(const QmlListModel &model, size_t first, size_t count) {
+    if (!plan_.document) {
+        return;
+    }
+    for (Repeater &repeater : plan_.repeaters) {
+        if (repeater.model != &model) {
+            continue;
+        }
+        if (first + count > repeater.rows.size()) {
+            invalidatePlan();
+            return;
+        }
+        for (size_t row = first; row < first + count; ++row) {
+            fetchRow(repeater, row, repeater.rows[row]);
+        }
+    }
+    ++contentVersion_;
+}
+
+void QmlFrontendCore::instantiateInView() {
+    while (!plan_.references.empty()) {
+        size_t first, begin, end;
+        window(first, begin, end);
+        bool made = false;
+        for (const Reference &reference : plan_.references) {
+            if (reference.item < begin || reference.item >= end) {
+                continue;
+            }
+            auto instance = std::make_unique<QmlNode>();
+            if (instantiator_(*reference.use, *instance)) {
+                ++instanceCount_;
+            } else {
+                instance.reset();
+            }
+            instances_.emplace(reference.use, std::move(instance));
+            made = true;
+        }
+        if (!made) {
+            return;
+        }
+        // Instances change the heights of their items, and so the window.
+        compilePlan(*plan_.document, plan_.rows, plan_.cols);
+        scrollOffset_ = std::min(scrollOffset_, maxScrollOffset());
+    }
+}
+
+size_t QmlFrontendCore::itemsFrom(size_t first) const {
+    const int available = plan_.rows - (plan_.title.source == TextSlot::Missing ? 0 : 2);
+    if (available <= 0 || first >= plan_.items.size()) {
+        return 0;
+    }
+    const auto begin = plan_.itemTop.begin() + static_cast<std::ptrdiff_t>(first);
+    return static_cast<size_t>(std::lower_bound(begin, plan_.itemTop.end(), *begin + available) - begin);
+}
+
+// The last offset whose items run to the end of the list.
+size_t QmlFrontendCore::maxScrollOffset() const {
+    const int available = plan_.rows - (plan_.title.source == TextSlot::Missing ? 0 : 2);
+    if (plan_.items.empty() || available <= 0) {
+        return plan_.items.size();
+    }
+    const int lastTop = plan_.itemTop.back();
+    return static_cast<size_t>(
+        std::lower_bound(plan_.itemTop.begin(), plan_.itemTop.end(), lastTop - available + 1) - plan_.itemTop.begin());
+}
+
+size_t QmlFrontendCore::itemsInView() const {
+    return itemsFrom(std::min(scrollOffset_, maxScrollOffset()));
+}
+
+void QmlFrontendCore::setPrefetch(size_t frames, size_t budget, PrefetchCancelled cancelled) {
+    prefetchFrames_ = frames;
+    prefetchBudget_ = budget;
+    prefetchCancelled_ = std::move(cancelled);
+}
+
+void QmlFrontendCore::trackScroll() {
+    const long moved = static_cast<long>(scrollOffset_) - static_cast<long>(lastOffset_);
+    scrollVelocity_ = moved != 0 ? moved : scrollVelocity_ / 2;
+    lastOffset_ = scrollOffset_;
+}
+
+// Values still to come for the other direction are dropped on arrival,
+// as for an invalidated binding.
+void QmlFrontendCore::cancelPrefetch() {
+    unresolved_.clear();
+    for (const auto &[item, binding] : prefetched_) {
+        if (pendingBindings_.erase(binding) > 0) {
+            unresolved_.push_back(binding);
+        }
+    }
+    prefetched_.clear();
+    if (!unresolved_.empty()) {
+        prefetchCancelCount_ += unresolved_.size();
+        ++contentVersion_;
+        if (prefetchCancelled_) {
+            prefetchCancelled_(unresolved_);
+        }
+    }
+}
+
+void QmlFrontendCore::collectPrefetch(std::vector<std::string> &bindings) {
+    bindings.clear();
+    if (prefetchFrames_ == 0 || scrollMode_ != ScrollMode::Items || compileContent_ || deferring_) {
+        return;
+    }
+    size_t first, begin, end;
+    window(first, begin, end);
+    // Ones that arrived, or that the window has come to, are no longer
+    // the prefetch's to cancel.
+    prefetched_.erase(std::remove_if(prefetched_.begin(), prefetched_.end(),
+                                     [&](const std::pair<size_t, std::string> &entry) {
+                                         return (entry.first >= begin && entry.first < end) ||
+                                                pendingBindings_.count(entry.second) == 0;
+                                     }),
+                      prefetched_.end());
+    const int direction = (scrollVelocity_ > 0) - (scrollVelocity_ < 0);
+    if (direction != 0 && direction != prefetchDirection_) {
+        cancelPrefetch();
+        prefetchDirection_ = direction;
+    }
+    if (direction == 0 || !resolves_) {
+        return;
+    }
+
+    const size_t reach = static_cast<size_t>(std::abs(scrollVelocity_)) * prefetchFrames_;
+    const size_t count = direction > 0 ? std::min(reach, plan_.items.size() - end) : std::min(reach, begin);
+    for (size_t step = 0; step < count && bindings.size() < prefetchBudget_; ++step) {
+        const size_t i = direction > 0 ? end + step : begin - 1 - step;
+        const uint32_t item = plan_.items[i];
+        const uint32_t itemEnd = plan_.layout.node(item).end;
+        for (uint32_t index = item; index < itemEnd && bindings.size() < prefetchBudget_; ++index) {
+            const QmlLayout::Node &node = plan_.layout.node(index);
+            if (node.kind != QmlLayout::Kind::Leaf) {
+                continue;
+            }
+            const TextSlot &slot = plan_.ops[node.leaf].text;
+            if (slot.source != TextSlot::Binding || pendingBindings_.count(slot.text) > 0 ||
+                std::find(bindings.begin(), bindings.end(), slot.text) != bindings.end()) {
+                continue;
+            }
+            const auto cached = bindingCache_.find(slot.text);
+            if (cached == bindingCache_.end() || !cached->second.fresh) {
+                bindings.push_back(slot.text);
+                prefetched_.emplace_back(i, slot.text);
+            }
+        }
+    }
+    prefetchCount_ += bindings.size();
+}
+
+void QmlFrontendCore::scrollBy(long items) {
+    if (items < 0 && static_cast<size_t>(-items) > scrollOffset_) {
+        scrollOffset_ = 0;
+    } else {
+        scrollOffset_ += items;
+    }
+}
+
+// Only the items in view and the overscan around them are resolved and
+// measured, so the padded width follows what is on screen.
+void QmlFrontendCore::window(size_t &first, size_t &begin, size_t &end) const {
+    if (scrollMode_ == ScrollMode::Rows) {
+        first = 0;
+        begin = 0;
+        end = plan_.items.size();
+        return;
+    }
+    first = std::min(scrollOffset_, maxScrollOffset());
+    begin = first - std::min(first, overscan_);
+    end = std::min(plan_.items.size(), first + itemsFrom(first) + overscan_);
+}
+
+int QmlFrontendCore::replayPlan() {
+    size_t first, begin, end;
+    window(first, begin, end);
+    // The pad holds all of the content; the screen clips the rest.
+    const int lastRow = scrollMode_ == ScrollMode::Rows ? INT_MAX : plan_.rows;
+
+    frame_.clear();
+    const ResolvedText title = resolve(plan_.title);
+    int firstRow = 0;
+    if (!title.empty()) {
+        placeCentered(0, title);
+        firstRow = 2;
+    }
+
+    // Measure: update the leaves' widths, then re-measure only the items
+    // whose leaves changed.
+    QmlLayout &layout = plan_.layout;
+    leaves_.clear();
+    int blockWidth = 0;
+    bool heightsChanged = false;
+    for (size_t i = begin; i < end; ++i) {
+        const uint32_t item = plan_.items[i];
+        for (uint32_t index = item; index < layout.node(item).end; ++index) {
+            if (layout.node(index).kind != QmlLayout::Kind::Leaf) {
+                continue;
+            }
+            const DrawOp &op = plan_.ops[layout.node(index).leaf];
+            if (op.log != DrawOp::kNoLog) {
+                const LogPane &pane = plan_.logs[op.log];
+                layout.setLeafWidth(index, pane.width > 0 ? pane.width : plan_.cols);
+                if (i >= first) {
+                    leaves_.push_back(LeafText{index, ResolvedText{}, false, DrawOp::kNoWrap, 0, op.style, -1, op.log});
+                }
+                continue;
+            }
+            ResolvedText content = resolveIn(i, op.text, op.missingText);
+            int padTo = 0;
+            bool typed = true;  // the text, not the placeholder
+            if (content.empty() && op.blankIfEmpty) {
+                typed = false;
+                content = resolveIn(i, op.fallback);
+                if (content.empty()) {
+                    content = ResolvedText{" ", 1};
+                }
+            } else if (op.blankIfEmpty && op.fallback.source == TextSlot::Literal) {
+                // A field is as wide as its placeholder, so typing into it
+                // does not move everything around it.
+                padTo = resolve(op.fallback).width;
+            }
+            padTo = std::max(padTo, content.width);
+            if (op.shift != 0) {
+                content.text = rotate(content.text, op.shift, op.rotated);
+            }
+            const bool focused = op.focus != DrawOp::kNoFocus && op.focus == focus_;
+            const uint32_t attributes = (focused ? A_REVERSE : 0) | op.style;
+            const bool cursor = focused && timeline_ && cursorShown_ && plan_.focusOrder[focus_].field;
+            int width = padTo + (op.framed ? 4 : 0);
+            if (op.wrap != DrawOp::kNoWrap) {
+                // Re-wraps only when the text or the screen width changed.
+                QmlTextWrap &wrap = plan_.wraps[op.wrap];
+                const size_t lines = wrap.wrap(content.text, plan_.cols).size();
+                width = wrap.widest();
+                heightsChanged |= layout.setLeafHeight(index, std::max(1, static_cast<int>(lines)));
+            }
+            layout.setLeafWidth(index, width);
+            if (i >= first && !content.empty() && !op.hidden) {
+                leaves_.push_back(LeafText{index, content, op.framed, op.wrap, padTo, attributes,
+                                           cursor ? (typed ? content.width : 0) : -1});
+            }
+        }
+        blockWidth = std::max(blockWidth, layout.measure(item));
+    }
+
+    if (heightsChanged) {
+        updateItemTops();
+    }
+
+    // Arrange: items are centred within the widest one, and the block is
+    // centred on screen.
+    int verticalOffset = 0;
+    if (plan_.centered && !plan_.items.empty()) {
+        const int available = plan_.rows - firstRow;
+        const int total = plan_.itemTop.back() + layout.node(plan_.items.back()).height;
+        verticalOffset = std::max(0, (available - total) / 2);
+    }
+    const int leftPadding = std::max(0, (plan_.cols - blockWidth) / 2);
+    for (size_t i = first; i < end; ++i) {
+        const uint32_t item = plan_.items[i];
+        const int x = leftPadding + std::max(0, (blockWidth - layout.node(item).width) / 2);
+        layout.arrange(item, x, firstRow + verticalOffset + plan_.itemTop[i] - plan_.itemTop[first]);
+    }
+
+    hits_.clear();
+    for (const LeafText &leaf : leaves_) {
+        const QmlLayout::Node &node = layout.node(leaf.node);
+        const uint32_t focus = plan_.ops[node.leaf].focus;
+        if (focus != DrawOp::kNoFocus) {
+            for (int row = node.y; row < node.y + node.height && row < lastRow; ++row) {
+                hits_.push_back(HitSpan{row, node.x, node.x + node.width, focus});
+            }
+        }
+        if (leaf.log != DrawOp::kNoLog) {
+            placeLog(leaf, node, lastRow);
+            continue;
+        }
+        if (leaf.wrap == DrawOp::kNoWrap) {
+            if (node.y < lastRow) {
+                frame_.push_back(Placement{node.y, node.x, leaf.text.text, leaf.text.width, leaf.framed, leaf.padTo,
+                                           leaf.attributes, leaf.cursor});
+            }
+            continue;
+        }
+        // Wrapped lines are left-aligned within the leaf, as in Qt.
+        const std::vector<QmlTextWrap::Line> &lines = plan_.wraps[leaf.wrap].lines();
+        for (size_t line = 0; line < lines.size() && node.y + static_cast<int>(line) < lastRow; ++line) {
+            frame_.push_back(Placement{node.y + static_cast<int>(line), node.x, lines[line].text, lines[line].width, false,
+                                       0, leaf.attributes});
+        }
+    }
+    // Items are stacked down the screen, so this is mostly in order already.
+    std::sort(hits_.begin(), hits_.end(), [](const HitSpan &a, const HitSpan &b) {
+        return a.row < b.row || (a.row == b.row && a.begin < b.begin);
+    });
+    return firstRow;
+}
+
+void QmlFrontendCore::placeLog(const LeafText &leaf, const QmlLayout::Node &node, int lastRow) {
+    QmlLogRing *ring = plan_.logs[leaf.log].ring;
+    if (std::find(pinnedRings_.begin(), pinnedRings_.end(), ring) != pinnedRings_.end()) {
+        return;  // shown by another LogView
+    }
+    pinnedRings_.push_back(ring);
+    const size_t lines = ring->pin(static_cast<size_t>(node.height));
+    for (size_t line = 0; line < lines && node.y + static_cast<int>(line) < lastRow; ++line) {
+        const std::string_view text = ring->line(line);
+        int width = 0;
+        const size_t length = QmlTextWidth::fit(text, node.width, width);
+        const int row = node.y + static_cast<int>(line);
+        frame_.push_back(Placement{row, node.x, text.substr(0, length), width, false, 0, leaf.attributes});
+    }
+}
+
+void QmlFrontendCore::unpinLogs() {
+    for (QmlLogRing *ring : pinnedRings_) {
+        ring->unpin();
+    }
+    pinnedRings_.clear();
+}
+
+template <typename Target>
+void QmlFrontendCore::putPlacement(Target &target, const Placement &placement, int rowOffset) {
+    const int row = placement.row - rowOffset;
+    if (placement.framed) {
+        // The brackets go straight into the grid; no framed string is built.
+        const int textCol = placement.col + 2;
+        const int padTo = std::max(placement.padTo, placement.width);
+        target.put(row, placement.col, "[ ", placement.attributes);
+        target.put(row, textCol, placement.text, placement.attributes);
+        if (placement.attributes != 0) {  // blank cells are plain already
+            for (int col = textCol + placement.width; col < textCol + padTo; ++col) {
+                target.put(row, col, " ", placement.attributes);
+            }
+        }
+        target.put(row, textCol + padTo, " ]", placement.attributes);
+        if (placement.cursor >= 0) {
+            // The cursor is the cell under it in the opposite video.
+            std::string_view under = " ";
+            if (placement.cursor < placement.width) {
+                size_t end = 1;
+                while (end < placement.text.size() && (static_cast<unsigned char>(placement.text[end]) & 0xc0) == 0x80) {
+                    ++end;
+                }
+                under = placement.text.substr(0, end);
+            }
+            target.put(row, textCol + placement.cursor, under, placement.attributes ^ A_REVERSE);
+        }
+    } else {
+        target.put(row, placement.col, placement.text, placement.attributes);
+    }
+}
+
+void QmlFrontendCore::composeFrame() {
+    if (scrollMode_ == ScrollMode::Rows) {
+        composePadFrame();
+        return;
+    }
+    replayPlan();
+    grid_.clear();
+    for (const auto &placement : frame_) {
+        putPlacement(grid_, placement, 0);
+    }
+    unpinLogs();
+    if (searching_) {
+        updateSearch();
+        showSearch();
+    }
+}
+
+// Re-composes the pad only when the content changed; frame_ keeps the
+// placements, whose views stay valid until then, so the title can be
+// redrawn from it.
+void QmlFrontendCore::composePadFrame() {
+    if (padVersion_ != contentVersion_ || padScreenRows_ != plan_.rows || pad_.cols() != plan_.cols) {
+        ++padComposeCount_;
+        padTop_ = replayPlan();
+        int bottom = padTop_;
+        for (const auto &placement : frame_) {
+            if (placement.row >= padTop_) {
+                bottom = std::max(bottom, placement.row + 1);
+            }
+        }
+        pad_.resize(bottom - padTop_, plan_.cols);
+        for (const auto &placement : frame_) {
+            if (placement.row >= padTop_) {
+                putPlacement(pad_, placement, padTop_);
+            }
+        }
+        unpinLogs();
+        padVersion_ = contentVersion_;
+        padScreenRows_ = plan_.rows;
+    }
+    if (searching_) {
+        updateSearch();  // may scroll to the current match
+    }
+
+    const int visible = std::max(0, plan_.rows - padTop_);
+    scrollRow_ = std::min(scrollRow_, std::max(0, pad_.rows() - visible));
+    grid_.clear();
+    for (const auto &placement : frame_) {
+        if (placement.row < padTop_) {
+            putPlacement(grid_, placement, 0);
+        }
+    }
+    grid_.blit(pad_, scrollRow_, padTop_, visible);
+    if (searching_) {
+        showSearch();
+    }
+}
+
+void QmlFrontendCore::openSearch() {
+    if (!searching_) {
+        searching_ = true;
+        searchQueryChanged_ = true;
+        searchPadCompose_ = SIZE_MAX;
+    }
+}
+
+void QmlFrontendCore::closeSearch() {
+    searching_ = false;
+    searchQuery_.clear();
+    searchCurrent_ = 0;
+}
+
+void QmlFrontendCore::setSearchQuery(std::string_view query) {
+    openSearch();
+    searchQuery_.assign(query);
+    searchQueryChanged_ = true;
+}
+
+void QmlFrontendCore::stepSearch(bool forward) {
+    const size_t count = searchMatchCount();
+    if (count == 0) {
+        return;
+    }
+    searchCurrent_ = forward ? (searchCurrent_ + 1) % count : (searchCurrent_ + count - 1) % count;
+    revealSearchMatch();
+}
+
+void QmlFrontendCore::revealSearchMatch() {
+    if (scrollMode_ != ScrollMode::Rows || searchCurrent_ >= search_.matches().size()) {
+        return;
+    }
+    // The query line covers the bottom row.
+    const int visible = std::max(1, plan_.rows - padTop_ - 1);
+    const int line = static_cast<int>(search_.matches()[searchCurrent_].line);
+    if (line < scrollRow_ || line >= scrollRow_ + visible) {
+        scrollRow_ = std::max(0, line - visible / 2);
+    }
+}
+
+bool QmlFrontendCore::handleSearchKey(int key) {
+    if (key == 27) {
+        closeSearch();
+    } else if (key == '\n' || key == '\r' || key == KEY_ENTER || key == KEY_DOWN) {
+        stepSearch(true);
+    } else if (key == KEY_UP) {
+        stepSearch(false);
+    } else if (key == KEY_BACKSPACE || key == 127 || key == '\b') {
+        size_t end = searchQuery_.size();
+        while (end > 0 && (static_cast<unsigned char>(searchQuery_[--end]) & 0xc0) == 0x80) {
+        }
+        searchQuery_.erase(end);
+        searchQueryChanged_ = true;
+    } else if (key >= 0x20 && key < 0x100) {
+        searchQuery_.push_back(static_cast<char>(key));
+        searchQueryChanged_ = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// A line is its cells' UTF-8 bytes without the trailing blanks, so byte
+// offsets into it map back to cells by walking the row.
+bool QmlFrontendCore::indexSearchLine(size_t line, const QmlCell *cells, int cols) {
+    searchLine_.clear();
+    for (int col = 0; col < cols; ++col) {
+        for (uint32_t glyph = cells[col].glyph; glyph != 0; glyph >>= 8) {
+            searchLine_.push_back(static_cast<char>(glyph & 0xff));
+        }
+    }
+    searchLine_.erase(searchLine_.find_last_not_of(' ') + 1);
+    return search_.setLine(line, searchLine_);
+}
+
+void QmlFrontendCore::updateSearch() {
+    bool changed = false;
+    if (scrollMode_ == ScrollMode::Rows) {
+        if (searchPadCompose_ != padComposeCount_) {
+            searchPadCompose_ = padComposeCount_;
+            const auto lines = static_cast<size_t>(pad_.rows());
+            changed = search_.lineCount() != lines;
+            search_.resize(lines);
+            for (size_t line = 0; line < lines; ++line) {
+                changed |= indexSearchLine(line, pad_.row(static_cast<int>(line)), pad_.cols());
+            }
+        }
+    } else {
+        // Every row but the query line's.
+        const auto lines = static_cast<size_t>(std::max(0, grid_.rows() - 1));
+        changed = search_.lineCount() != lines;
+        search_.resize(lines);
+        for (size_t line = 0; line < lines; ++line) {
+            changed |= indexSearchLine(line, &grid_.at(static_cast<int>(line), 0), grid_.cols());
+        }
+    }
+    if (!changed && !searchQueryChanged_) {
+        return;
+    }
+    const std::vector<QmlTextSearch::Match> &matches = search_.find(searchQuery_);
+    if (searchQueryChanged_) {
+        // A new query starts from the first match at or below the top of
+        // the view, as incremental search does.
+        searchQueryChanged_ = false;
+        const size_t top = scrollMode_ == ScrollMode::Rows ? static_cast<size_t>(scrollRow_) : 0;
+        searchCurrent_ = static_cast<size_t>(
+            std::lower_bound(matches.begin(), matches.end(), top,
+                             [](const QmlTextSearch::Match &match, size_t line) { return match.line < line; }) -
+            matches.begin());
+        if (searchCurrent_ == matches.size()) {
+            searchCurrent_ = 0;
+        }
+        revealSearchMatch();
+    } else if (searchCurrent_ >= matches.size()) {
+        searchCurrent_ = 0;
+    }
+}
+
+void QmlFrontendCore::showSearch() {
+    const int rows = grid_.rows();
+    const int bar = rows - 1 - (statsHud_ ? 1 : 0);
+    if (bar < 0) {
+        return;
+    }
+    // Lines map to screen rows: pad rows from padTop_ on in Rows mode.
+    const int shift = scrollMode_ == ScrollMode::Rows ? padTop_ - scrollRow_ : 0;
+    const int top = scrollMode_ == ScrollMode::Rows ? padTop_ : 0;
+    const std::vector<QmlTextSearch::Match> &matches = search_.matches();
+    auto match = std::lower_bound(
+        matches.begin(), matches.end(), static_cast<size_t>(std::max(0, top - shift)),
+        [](const QmlTextSearch::Match &entry, size_t line) { return entry.line < line; });
+    for (; match != matches.end() && static_cast<int>(match->line) + shift < bar; ++match) {
+        const int row = static_cast<int>(match->line) + shift;
+        const uint32_t attributes =
+            A_REVERSE | (static_cast<size_t>(match - matches.begin()) == searchCurrent_ ? A_BOLD : 0);
+        const size_t end = match->offset + match->length;
+        size_t offset = 0;
+        bool inside = false;
+        for (int col = 0; col < grid_.cols(); ++col) {
+            QmlCell cell = grid_.at(row, col);
+            if (cell.glyph != QmlCell::kContinuation) {
+                if (offset >= end) {
+                    break;
+                }
+                inside = offset >= match->offset;
+                for (uint32_t glyph = cell.glyph; glyph != 0; glyph >>= 8) {
+                    ++offset;
+                }
+            }
+            if (inside) {
+                cell.attributes |= attributes;
+                grid_.set(row, col, cell);
+            }
+        }
+    }
+
+    searchBar_.assign(" Find: ");
+    searchBar_.append(searchQuery_);
+    const size_t count = search_.matches().size();
+    if (!searchQuery_.empty()) {
+        char matches[64] = "  no matches";
+        if (count > 0) {
+            std::snprintf(matches, sizeof matches, "  %zu of %zu", searchCurrent_ + 1, count);
+        }
+        searchBar_.append(matches);
+    }
+    searchBar_.resize(std::max(searchBar_.size(), static_cast<size_t>(grid_.cols())), ' ');
+    grid_.put(bar, 0, searchBar_, A_REVERSE);
+}
+
+void QmlFrontendCore::setScrollMode(ScrollMode mode) {
+    if (mode != scrollMode_) {
+        scrollMode_ = mode;
+        pad_.resize(0, 0);
+        padVersion_ = UINT64_MAX;
+    }
+}
+
+void QmlFrontendCore::scrollRowsBy(long rows) {
+    setScrollRow(static_cast<int>(std::clamp<long>(scrollRow_ + rows, 0, INT_MAX)));
+}
+
+void QmlFrontendCore::setFocus(size_t index) {
+    if (index >= plan_.focusOrder.size()) {
+        index = kNoFocus;
+    }
+    if (index == focus_) {
+        return;
+    }
+    focus_ = index;
+    ++contentVersion_;
+    resetCursor();
+    if (index == kNoFocus) {
+        focusKey_.clear();
+        return;
+    }
+    const Focusable &focused = plan_.focusOrder[index];
+    focusKey_ = focused.key;
+    if (scrollMode_ == ScrollMode::Items) {
+        const size_t first = std::min(scrollOffset_, maxScrollOffset());
+        if (focused.item < first || focused.item >= first + itemsFrom(first)) {
+            scrollOffset_ = focused.item;
+        }
+    }
+}
+
+bool QmlFrontendCore::handleKey(int key) {
+    if (searching_) {
+        return handleSearchKey(key);
+    }
+    if (key == kFindKey) {
+        openSearch();
+        return true;
+    }
+    const size_t count = plan_.focusOrder.size();
+    if (count == 0) {
+        return false;
+    }
+    if (key == '\t' || key == KEY_BTAB) {
+        const bool forward = key == '\t';
+        if (focus_ == kNoFocus) {
+            setFocus(forward ? 0 : count - 1);
+        } else {
+            setFocus(forward ? (focus_ + 1) % count : (focus_ + count - 1) % count);
+        }
+        return true;
+    }
+    if (focus_ == kNoFocus) {
+        return false;
+    }
+    const Focusable &focused = plan_.focusOrder[focus_];
+    if (key == '\n' || key == '\r' || key == KEY_ENTER || (key == ' ' && !focused.field)) {
+        if (!action_ || focused.action.name == QmlAtoms::Invalid) {
+            return false;
+        }
+        action_(focused.id, focused.action);
+        return true;
+    }
+    return focused.field && editField(focused, key);
+}
+
+bool QmlFrontendCore::handleMouse(MouseAction action, int row, int col) {
+    if (action != MouseAction::Press) {
+        const long step = action == MouseAction::WheelUp ? -kWheelStep : kWheelStep;
+        if (scrollMode_ == ScrollMode::Rows) {
+            scrollRowsBy(step);
+        } else {
+            scrollBy(step);
+        }
+        return true;
+    }
+    const size_t index = focusableAt(row, col);
+    if (index == kNoFocus) {
+        return false;
+    }
+    setFocus(index);
+    const Focusable &target = plan_.focusOrder[index];
+    if (!target.field && action_ && target.action.name != QmlAtoms::Invalid) {
+        action_(target.id, target.action);
+    }
+    return true;
+}
+
+size_t QmlFrontendCore::focusableAt(int row, int col) const {
+    if (scrollMode_ == ScrollMode::Rows && row >= padTop_) {
+        row += scrollRow_;  // the pad row shown there
+    }
+    // The last span starting at or before the cell.
+    auto hit = std::upper_bound(hits_.begin(), hits_.end(), std::make_pair(row, col),
+                                [](const std::pair<int, int> &cell, const HitSpan &span) {
+                                    return cell.first < span.row || (cell.first == span.row && cell.second < span.begin);
+                                });
+    if (hit == hits_.begin()) {
+        return kNoFocus;
+    }
+    --hit;
+    if (hit->row != row || col >= hit->end || hit->focus >= plan_.focusOrder.size()) {
+        return kNoFocus;
+    }
+    return hit->focus;
+}
+
+// Edits replace whatever the field showed; typing into a bound field
+// breaks the binding, as in Qt.
+bool QmlFrontendCore::editField(const Focusable &field, int key) {
+    std::string &value = fieldText(field);
+    if (key == KEY_BACKSPACE || key == 127 || key == '\b') {
+        if (value.empty()) {
+            return true;
+        }
+        // Back to the lead byte of the last UTF-8 sequence.
+        size_t end = value.size() - 1;
+        while (end > 0 && (static_cast<unsigned char>(value[end]) & 0xc0) == 0x80) {
+            --end;
+        }
+        value.erase(end);
+    } else if (key >= 0x20 && key < 0x100 && key != 127) {
+        value.push_back(static_cast<char>(key));
+    } else {
+        return false;
+    }
+    fieldEdited(field, value);
+    return true;
+}
+
+bool QmlFrontendCore::insertText(std::string_view text) {
+    if (focus_ == kNoFocus || !plan_.focusOrder[focus_].field) {
+        return false;
+    }
+    const Focusable &field = plan_.focusOrder[focus_];
+    std::string &value = fieldText(field);
+    value.reserve(value.size() + text.size());
+    for (const char ch : text) {
+        const auto byte = static_cast<unsigned char>(ch);
+        if (byte == '\n' || byte == '\r' || byte == '\t') {
+            value.push_back(' ');
+        } else if (byte >= 0x20 && byte != 127) {
+            value.push_back(ch);
+        }
+    }
+    fieldEdited(field, value);
+    return true;
+}
+
+std::string &QmlFrontendCore::fieldText(const Focusable &field) {
+    auto text = itemText_.find(field.key);
+    if (text == itemText_.end()) {
+        text = itemText_.emplace(field.key, std::string(resolve(plan_.ops[field.op].text).text)).first;
+    }
+    return text->second;
+}
+
+void QmlFrontendCore::fieldEdited(const Focusable &field, const std::string &value) {
+    plan_.ops[field.op].text = TextSlot{TextSlot::Literal, value};
+    ++contentVersion_;
+    resetCursor();
+    if (textEdited_) {
+        textEdited_(field.id, value);
+    }
+}
+
+void QmlFrontendCore::setItemText(const std::string &id, std::string text) {
+    std::string &value = itemText_[id];
+    value = std::move(text);
+    const auto op = plan_.textOps.find(id);
+    if (op != plan_.textOps.end()) {
+        plan_.ops[op->second].text = TextSlot{TextSlot::Literal, value};
+        ++contentVersion_;
+    }
+}
+
+const std::string *QmlFrontendCore::itemText(const std::string &id) const {
+    const auto it = itemText_.find(id);
+    return it == itemText_.end() ? nullptr : &it->second;
+}
+
+void QmlFrontendCore::invalidateBinding(const std::string &binding) {
+    const auto it = bindingCache_.find(binding);
+    if (it != bindingCache_.end()) {
+        it->second.fresh = false;
+    }
+    pendingBindings_.erase(binding);
+    ++contentVersion_;
+}
+
+size_t QmlFrontendCore::bindingCacheBytes() const {
+    size_t bytes = bindingCache_.bucket_count() * sizeof(void *);
+    for (const auto &entry : bindingCache_) {
+        bytes += bindingEntryBytes(entry);
+    }
+    return bytes;
+}
+
+size_t QmlFrontendCore::evictBindings(size_t bytes) {
+    size_t freed = 0;
+    for (const bool fresh : {false, true}) {
+        for (auto it = bindingCache_.begin(); it != bindingCache_.end() && freed < bytes;) {
+            if (it->second.fresh == fresh && pendingBindings_.count(it->first) == 0) {
+                freed += bindingEntryBytes(*it);
+                it = bindingCache_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (freed > 0) {
+        // Placements may view the values just dropped.
+        invalidatePlan();
+        ++contentVersion_;
+    }
+    return freed;
+}
+
+void QmlFrontendCore::dropAllBindings() {
+    for (auto &entry : bindingCache_) {
+        entry.second.fresh = false;
+    }
+    pendingBindings_.clear();
+    ++bindingGeneration_;
+    ++contentVersion_;
+}
+
+void QmlFrontendCore::setComponentInstantiator(ComponentInstantiator instantiator) {
+    instantiator_ = std::move(instantiator);
+    invalidateComponents();
+}
+
+void QmlFrontendCore::invalidateComponents() {
+    instances_.clear();
+    instanceCount_ = 0;
+    invalidatePlan();
+}
+
+void QmlFrontendCore::registerElement(std::string_view type, ElementRenderer renderer) {
+    const QmlAtom atom = QmlAtomTable::global().intern(type);
+    if (renderer) {
+        elementRenderers_[atom] = std::move(renderer);
+    } else {
+        elementRenderers_.erase(atom);
+    }
+    invalidatePlan();
+}
+
+void QmlFrontendCore::setModel(const std::string &name, QmlListModel *model) {
+    const auto it = models_.find(name);
+    if (it != models_.end() && model == &it->second->model()) {
+        return;
+    }
+    if (model) {
+        models_[name] = std::make_unique<ModelObserver>(*this, *model);
+    } else {
+        models_.erase(name);
+    }
+    invalidatePlan();
+}
+
+void QmlFrontendCore::setLogRing(const std::string &name, QmlLogRing *ring) {
+    if (ring) {
+        logRings_[name] = ring;
+    } else {
+        logRings_.erase(name);
+    }
+    invalidatePlan();
+}
+
+void QmlFrontendCore::setBindingVersion(BindingVersion version) {
+    bindingVersion_ = std::move(version);
+    lastBindingVersion_ = bindingVersion_ ? bindingVersion_() : 0;
+    dropAllBindings();
+}
+
+void QmlFrontendCore::setStatsHud(bool shown) {
+    statsHud_ = shown;
+    statsEnabled_ |= shown;
+}
+
+QmlFrontendCore::PhaseTimer QmlFrontendCore::beginFrameStats() {
+    if (statsEnabled_) {
+        frameStats_ = QmlFrameStats{};
+        allocationsAtStart_ = allocationCounter_ ? allocationCounter_() : 0;
+    }
+    return PhaseTimer(statsEnabled_);
+}
+
+void QmlFrontendCore::finishFrameStats(bool cleared, bool refreshed) {
+    frameStats_.runs = grid_.runsLastFlush();
+    frameStats_.drawCalls = (cleared ? 1 : 0) + (frameStats_.runs > 0 ? 1 : 0) + (refreshed ? 1 : 0);
+    frameStats_.cellsChanged = cellsWritten_;
+    frameStats_.bytesEmitted = grid_.bytesLastFlush();
+    frameStats_.allocations = allocationCounter_ ? allocationCounter_() - allocationsAtStart_ : 0;
+    lastFrameStats_ = frameStats_;
+}
+
+void QmlFrontendCore::finishInputLatency() {
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::nanoseconds latency = now - inputAt_;
+    inputPending_ = false;
+    inputLatency_.record(latency);
+    frameStats_.inputLatency = latency;
+    if (QmlTrace::enabled()) {
+        QmlTrace::record("input to refresh", inputAt_, now);
+        const auto micros = [](std::chrono::nanoseconds time) { return static_cast<int64_t>(time.count() / 1000); };
+        QmlTrace::counter("input latency", "p50 us", now, micros(inputLatency_.percentile(0.5)));
+        QmlTrace::counter("input latency", "p99 us", now, micros(inputLatency_.percentile(0.99)));
+    }
+}
+
+// One reverse-video row at the bottom, over whatever the frame put there.
+void QmlFrontendCore::drawStatsHud() {
+    if (grid_.rows() == 0) {
+        return;
+    }
+    const QmlFrameStats &stats = lastFrameStats_;
+    const auto micros = [](std::chrono::nanoseconds time) { return static_cast<long long>(time.count() / 1000); };
+    char line[200];
+    const int length = std::snprintf(line, sizeof line,
+                                     " frame %zu  layout %lldus  resolve %lldus (%zu calls, %zu bindings)  "
+                                     "draw %lldus (%zu calls)  %zu cells  %zu bytes  %llu allocs  "
+                                     "input p50 %lldus p99 %lldus",
+                                     frameCount_, micros(stats.layoutTime), micros(stats.resolveTime),
+                                     stats.resolverCalls, stats.bindingsResolved, micros(stats.drawTime),
+                                     stats.drawCalls, stats.cellsChanged, stats.bytesEmitted,
+                                     static_cast<unsigned long long>(stats.allocations),
+                                     micros(inputLatency_.percentile(0.5)), micros(inputLatency_.percentile(0.99)));
+    hud_.assign(line, static_cast<size_t>(std::clamp(length, 0, static_cast<int>(sizeof line) - 1)));
+    hud_.resize(std::max(hud_.size(), static_cast<size_t>(grid_.cols())), ' ');
+    grid_.put(grid_.rows() - 1, 0, hud_, A_REVERSE);
+}
+
+bool QmlFrontendCore::prepareFrame(const QmlDocument &document, int rows, int cols) {
+    if (bindingVersion_) {
+        const uint64_t version = bindingVersion_();
+        if (version != lastBindingVersion_) {
+            lastBindingVersion_ = version;
+            dropAllBindings();
+        }
+    }
+    const bool repaint = !rendered_ || grid_.rows() != rows || grid_.cols() != cols;
+    if (repaint) {
+        grid_.resize(rows, cols);
+    }
+    // Snapshots of an indexed document share its nodes, and so its
+    // instances; other documents are told apart by address.
+    const bool sameNodes = document.revision() != 0 ? document.revision() == instancesRevision_
+                                                    : &document == instancesDocument_;
+    if (!sameNodes) {
+        instances_.clear();
+        instanceCount_ = 0;
+        instancesDocument_ = &document;
+        instancesRevision_ = document.revision();
+    }
+    sliceStopped_ = false;
+    deferring_ = false;
+    holdFrame_ = false;
+    if (frameBudget_.count() > 0) {
+        sliceDeadline_ = std::chrono::steady_clock::now() + frameBudget_;
+    }
+    if (plan_.document != &document || plan_.revision != document.revision()) {
+        beginPlan(document, rows, cols);
+        continuePlan(true);
+    } else if (compileContent_) {
+        continuePlan(true);
+    }
+    // Widths do not depend on the terminal size, so a resize keeps the
+    // plan and its measurements and only re-arranges.
+    plan_.rows = rows;
+    plan_.cols = cols;
+    // Rearmed first, so a line appended from here on requests another frame.
+    for (LogPane &pane : plan_.logs) {
+        pane.ring->rearm();
+        const uint64_t appended = pane.ring->appended();
+        if (appended != pane.seen) {
+            pane.seen = appended;
+            ++contentVersion_;
+        }
+    }
+    if (compileContent_) {
+        // The offset may lie among items not compiled yet.
+        holdFrame_ = rendered_ && scrollMode_ == ScrollMode::Items && scrollOffset_ > maxScrollOffset();
+        return repaint;
+    }
+    scrollOffset_ = std::min(scrollOffset_, maxScrollOffset());
+    instantiateInView();
+    trackScroll();
+    return repaint;
+}
+
+bool QmlFrontendCore::skipUpdate(const QmlDocumentDiff &diff) {
+    if (rendered_ && diff.empty()) {
+        cellsWritten_ = 0;
+        return true;
+    }
+    invalidatePlan();
+    return false;
+}
+
+QmlCursesFrontend::QmlCursesFrontend(ICursesScreen &screen, BindingResolver resolver) : screen_(screen) {
+    if (resolver) {
+        resolver_ = [single = std::move(resolver)](const std::vector<std::string> &bindings) {
+            std::vector<std::string> values;
+            values.reserve(bindings.size());
+            for (const auto &binding : bindings) {
+                values.push_back(single(binding));
+            }
+            return values;
+        };
+        setResolves(true);
+    }
+}
+
+QmlCursesFrontend::QmlCursesFrontend(ICursesScreen &screen, BatchBindingResolver resolver)
+    : screen_(screen), resolver_(std::move(resolver)) {
+    setResolves(static_cast<bool>(resolver_));
+}
+
+QmlCursesFrontend::QmlCursesFrontend(ICursesScreen &screen, AsyncBindingResolver resolver)
+    : screen_(screen), asyncResolver_(std::move(resolver)), inbox_(std::make_shared<AsyncInbox>()) {
+    setResolves(static_cast<bool>(asyncResolver_));
+}
+
+QmlCursesFrontend::QmlCursesFrontend(ICursesScreen &screen, BindingWriter writer) : screen_(screen), writer_(writer) {
+    setResolves(static_cast<bool>(writer_));
+}
+
+void QmlCursesFrontend::fetch(std::vector<std::string> &bindings) {
+    if (asyncResolver_) {
+        requestAsync(bindings);
+    } else if (resolver_) {
+        std::vector<std::string> values = resolver_(bindings);
+        storeResolved(bindings, std::move(values));
+    }
+}
+
+void QmlCursesFrontend::requestAsync(std::vector<std::string> &bindings) {
+    markPending(bindings);
+
+    // The resolver may call done before returning, so the names it maps
+    // results back to are shared rather than moved into the call.
+    auto names = std::make_shared<const std::vector<std::string>>(std::move(bindings));
+    bindings.clear();
+    std::weak_ptr<AsyncInbox> weakInbox = inbox_;
+    asyncResolver_(*names, [weakInbox, names, generation = bindingGeneration()](std::vector<std::string> values) {
+        const std::shared_ptr<AsyncInbox> inbox = weakInbox.lock();
+        if (!inbox) {
+            return;
+        }
+        std::function<void()> notifier;
+        {
+            std::lock_guard<std::mutex> lock(inbox->mutex);
+            values.resize(names->size());
+            for (size_t i = 0; i < names->size(); ++i) {
+                inbox->values.push_back(AsyncInbox::Delivery{generation, (*names)[i], std::move(values[i])});
+            }
+            notifier = inbox->notifier;
+        }
+        if (notifier) {
+            notifier();
+        }
+    });
+}
+
+bool QmlCursesFrontend::drainInbox() {
+    if (!inbox_) {
+        return false;
+    }
+    std::vector<AsyncInbox::Delivery> values;
+    {
+        std::lock_guard<std::mutex> lock(inbox_->mutex);
+        values.swap(inbox_->values);
+    }
+    bool accepted = false;
+    for (auto &delivery : values) {
+        accepted |= acceptPending(delivery.generation, std::move(delivery.binding), std::move(delivery.value));
+    }
+    return accepted;
+}
+
+void QmlCursesFrontend::setBindingsReadyNotifier(std::function<void()> notifier) {
+    if (!inbox_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(inbox_->mutex);
+    inbox_->notifier = std::move(notifier);
+}
+
+bool QmlCursesFrontend::applyResolvedBindings() {
+    if (!drainInbox()) {
+        return false;
+    }
+    if (rendered()) {
+        auto fetcher = [this](std::vector<std::string> &bindings) { fetch(bindings); };
+        drawFrame(screen_, false, fetcher);
+    }
+    return true;
+}
+
+void QmlCursesFrontend::render(const QmlDocument &document) {
+    if (writer_) {
+        renderFrame(document, screen_, writer_);
+        return;
+    }
+    drainInbox();
+    renderFrame(document, screen_, [this](std::vector<std::string> &bindings) { fetch(bindings); });
+    if (asyncResolver_) {
+        collectPrefetch(prefetch_);
+        if (!prefetch_.empty()) {
+            requestAsync(prefetch_);
+        }
+    }
+}
+
+void QmlCursesFrontend::update(const QmlDocument &document, const QmlDocumentDiff &diff) {
+    if (!skipUpdate(diff)) {
+        render(document);
+    }
 }
@@ -1,9 +1,35 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "qml_cell_grid.h"
+#include "qml_color_pairs.h"
+#include "qml_diff.h"
+#include "qml_executor.h"
+#include "qml_free_list.h"
+#include "qml_function_ref.h"
+#include "qml_latency_histogram.h"
+#include "qml_layout.h"
+#include "qml_list_model.h"
+#include "qml_log_ring.h"
+#include "qml_text_search.h"
+#include "qml_text_width.h"
+#include "qml_text_wrap.h"
+#include "qml_timeline.h"
+#include "qml_trace.h"
 #include "qml_parser.h"
 
 class ICursesScreen {
@@ -12,38 +38,1007 @@ public:
 
     virtual void clear() = 0;
     virtual void drawText(int row, int col, const std::string &text) = 0;
+    // attributes are curses A_* bits, colours as QmlColorPairs pairs;
+    // screens without styling ignore them.
+    virtual void drawStyledText(int row, int col, const std::string &text, uint32_t attributes);
+    // Draws a batch of runs in one call. The default copies each run into
+    // one reused string for drawStyledText(); backends override it to write
+    // the views directly.
+    virtual void drawRuns(const ScreenRun *runs, size_t count);
+    // Moves rows top to bottom - 1 up by count rows, or down for a negative
+    // count, blanking the rows uncovered. Returns false, having done
+    // nothing, if the screen cannot scroll; the default.
+    virtual bool scrollRows(int top, int bottom, int count);
     virtual void refresh() = 0;
     virtual int rows() const = 0;
     virtual int cols() const = 0;
+
+private:
+    std::string runText_;  // the default drawRuns()'s copy, kept to reuse its capacity
 };
 
-// Thin adapter over a PDCursesMod WINDOW*.
+// Thin adapter over a PDCursesMod WINDOW*. Attributes are set once per
+// change rather than per run, and the colour pairs in them are initialized
+// from QmlColorPairs the first time each is drawn; call start_color() (and
+// use_default_colors()) first, or colours are left out.
 class PdcursesScreen : public ICursesScreen {
 public:
     explicit PdcursesScreen(void *window = nullptr);
 
     void clear() override;
     void drawText(int row, int col, const std::string &text) override;
+    void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override;
+    void drawRuns(const ScreenRun *runs, size_t count) override;
+    // wscrl() within a scrolling region, with idlok() on so curses moves
+    // the lines on the terminal too.
+    bool scrollRows(int top, int bottom, int count) override;
     void refresh() override;
     int rows() const override;
     int cols() const override;
 
 private:
+    void drawRun(const ScreenRun &run);
+    void setAttributes(uint32_t attributes);
+
     void *window_;
+    uint32_t attributes_ = 0;  // set on the window
+    std::vector<int8_t> pairs_;  // by pair: 0 not yet, 1 initialized, -1 failed
 };
 
 using BindingResolver = std::function<std::string(const std::string &binding)>;
+// Resolves many bindings in one call; result i belongs to bindings[i].
+// Missing or empty results fall back to showing the expression itself.
+using BatchBindingResolver = std::function<std::vector<std::string>(const std::vector<std::string> &bindings)>;
+// Starts resolving bindings and returns without waiting; done(values) is
+// called once, from any thread, with result i belonging to bindings[i].
+using BindingsReady = std::function<void(std::vector<std::string> values)>;
+using AsyncBindingResolver = std::function<void(const std::vector<std::string> &bindings, BindingsReady done)>;
+// Writes the value of binding into value, which arrives cleared and keeps
+// its capacity from earlier frames. Reusing the buffer is what lets
+// steady-state frames render without heap allocations.
+using BindingWriter = QmlFunctionRef<void(std::string_view binding, std::string &value)>;
+// Returns a counter that the binding source bumps whenever any of its
+// values may have changed.
+using BindingVersion = std::function<uint64_t()>;
+
+// Cost of one frame; see QmlFrontendCore::setStatsEnabled(). Layout covers
+// compiling the plan, measuring, arranging and composing the grid; draw
+// covers the diff and the screen's draw calls and refresh. Bytes are the
+// UTF-8 text handed to the screen, before any escape sequences the backend
+// adds.
+struct QmlFrameStats {
+    std::chrono::nanoseconds layoutTime{0};
+    std::chrono::nanoseconds resolveTime{0};
+    std::chrono::nanoseconds drawTime{0};
+    size_t resolverCalls = 0;  // batch or async calls, or one per written binding
+    size_t bindingsResolved = 0;
+    size_t drawCalls = 0;  // clear, drawRuns and refresh calls on the screen
+    size_t runs = 0;
+    size_t cellsChanged = 0;
+    size_t bytesEmitted = 0;
+    uint64_t allocations = 0;  // 0 without an allocation counter
+    // From the oldest input the frame answers to its refresh; 0 if none.
+    std::chrono::nanoseconds inputLatency{0};
+};
+
+// Plan compilation, layout, binding cache and damage-tracked grid shared by
+// the frontends. The frontends own the screen and the resolver and pass
+// them into renderFrame(), which is a template so that a concrete screen
+// type and resolver get called directly rather than through a vtable or a
+// std::function.
+class QmlFrontendCore {
+public:
+    // render() compiles the document into a plan of draw ops and replays it
+    // on later frames, re-resolving only the bindings. The plan is rebuilt
+    // when a different document is passed or update() sees changes; call
+    // this after editing a document in place. A terminal resize keeps the
+    // plan, its cached measurements and the resolved bindings, re-arranges,
+    // and repaints through the cell grid.
+    void invalidatePlan() { plan_.document = nullptr; }
+    // Something else, such as another tab's frontend, has drawn on the
+    // screen since this one's last frame. The next frame clears it and
+    // sends every cell; the plan and the binding cache are kept, so that
+    // frame costs a compose rather than a load and a resolve.
+    void forgetScreen() { grid_.forgetFront(); }
+    // Frees the plan and the component instances made for the document,
+    // which is about to be freed, as a hidden tab's is when it is
+    // compressed (see QmlCompressedDocument). Bindings and the grid are
+    // kept; the next frame compiles the plan again.
+    void releasePlan();
+
+    // Resolved bindings are cached, so frames whose bindings did not change
+    // make no resolver calls. Invalidate entries when their source changes
+    // (e.g. from a NOTIFY signal), or install a version counter that drops
+    // the whole cache whenever it moves.
+    void invalidateBinding(const std::string &binding);
+    void invalidateAllBindings() { dropAllBindings(); }
+    void setBindingVersion(BindingVersion version);
+    // Bytes the binding cache holds, keys and values; O(entries).
+    size_t bindingCacheBytes() const;
+    // Drops the stale entries and then, if they were fewer than bytes, the
+    // rest, which the next frame resolves again after rebuilding the plan.
+    // Returns the bytes freed. For a QmlCacheBudget; call it between
+    // frames.
+    size_t evictBindings(size_t bytes);
+
+    // With an executor, usually QmlExecutor::shared(), a frontend that
+    // resolves through a BindingWriter writes a frame's uncached bindings
+    // in parallel, at High priority, once there are at least minimumBatch
+    // of them. Each value goes straight into its own cache entry from a
+    // worker, so the writer must be safe to call from several threads at
+    // once. Entries are claimed beforehand, and measuring, composing and
+    // drawing stay on the rendering thread. The executor is not owned; pass
+    // nullptr to resolve serially again.
+    void setResolveExecutor(QmlExecutor *executor, size_t minimumBatch = 64) {
+        resolveExecutor_ = executor;
+        parallelMinimum_ = std::max<size_t>(1, minimumBatch);
+    }
+
+    // Elements the frontend does not draw may be component uses (see
+    // QmlProjectIndex::instantiate()). With an instantiator set, each one
+    // stays an unexpanded reference holding a blank row until its
+    // top-level item comes into view at a render(); only then is the
+    // instance made, kept and laid out, so startup and memory follow what
+    // is on screen. Instances are dropped when the document changes.
+    // Subtrees with visible: false are neither laid out nor instantiated.
+    // The instantiator returns false for types that are not components,
+    // which are skipped as before.
+    using ComponentInstantiator = std::function<bool(const QmlNode &use, QmlNode &instance)>;
+    void setComponentInstantiator(ComponentInstantiator instantiator);
+    // Drops every instance, e.g. after a component file changed; they are
+    // made again as they come into view.
+    void invalidateComponents();
+    size_t componentInstanceCount() const { return instanceCount_; }
+
+    // Known types are dispatched by atom; a type the frontend does not
+    // know, such as a ProgressBar, can be drawn as one leaf by a renderer
+    // registered for its name. The renderer is called with the node when
+    // the plan compiles; a binding text is resolved each frame like a text
+    // property. font.bold and color apply as usual. Registered types are
+    // not component uses; a null renderer unregisters the type.
+    struct ElementDraw {
+        std::string text;
+        bool binding = false;     // text is an expression for the resolver
+        bool framed = false;      // drawn as "[ text ]", like a Button
+        uint32_t attributes = 0;  // curses A_* bits
+    };
+    using ElementRenderer = std::function<ElementDraw(const QmlNode &node)>;
+    void registerElement(std::string_view type, ElementRenderer renderer);
+
+    // A Repeater or ListView among the top-level Column's children, or in
+    // its place, stands for one item per row of the model its model
+    // property names. Its delegate, the object bound to delegate: or else
+    // its first child, is compiled once into a template whose
+    // draw ops every row shares; model.<role> bindings in it show the row's
+    // values. The frontend follows the model's notifications: inserted,
+    // removed and moved rows only patch the plan, and changed rows only
+    // re-read their values, so the next render() re-measures and redraws
+    // just those rows. Delegates do not wrap text or instantiate
+    // components, and repeaters nested deeper are not drawn. The model is
+    // not owned; pass nullptr to unset it before it goes away.
+    void setModel(const std::string &name, QmlListModel *model);
+    // A LogView shows the newest lines of the QmlLogRing its model property
+    // names, oldest at the top, in a pane height rows tall (10 by default)
+    // and width cells wide (the screen's by default). Each frame pins just
+    // the lines in view and composes them straight from the ring, so a
+    // frame costs the same however fast lines arrive, and as the tail moves
+    // up the cell grid scrolls it on the terminal rather than redrawing it.
+    // Frames are not requested on their own: have the ring's appended
+    // handler request one, and render() rather than update(). A ring is
+    // shown by one LogView at a time, and LogViews in repeaters are not
+    // drawn. The ring is not owned; pass nullptr to unset it before it
+    // goes away.
+    void setLogRing(const std::string &name, QmlLogRing *ring);
+    // Number of times the plan was compiled; lets tests check that model
+    // notifications do not rebuild it.
+    size_t planCompileCount() const { return planCompileCount_; }
+    // A rebuilt plan takes its draw ops and its repeaters' rows from free
+    // lists that the old plan and removed rows were given back to, strings
+    // and all, and lays out in the old plan's layout nodes, so reloads and
+    // rows scrolling through a model stop allocating once they are warm.
+    // Each list keeps at most capacity objects (4096 by default).
+    void setRecycleCapacity(size_t capacity) {
+        opPool_.setCapacity(capacity);
+        rowPool_.setCapacity(capacity);
+    }
+    size_t recycledOpCount() const { return opPool_.reused(); }
+    size_t recycledRowCount() const { return rowPool_.reused(); }
+
+    // Keyboard focus. TextFields and Buttons outside repeaters take focus
+    // in document order, which the plan keeps as an array, so moving it is
+    // an index step; the first with focus: true has it to begin with, and
+    // the focused one is drawn in reverse video. handleKey() takes curses
+    // key codes: Tab and Shift-Tab (KEY_BTAB) move the focus, printable
+    // bytes and Backspace edit the focused TextField's text at its end, and
+    // Enter runs the focused field's onAccepted or button's onClicked
+    // handler (Space presses a button too). Returns whether the key was
+    // used; the next frame then repaints only the cells that changed.
+    static constexpr size_t kNoFocus = SIZE_MAX;
+    bool handleKey(int key);
+    // Appends text to the focused TextField as a single edit, so a paste
+    // or a burst of typing (see QmlInputCoalescer) costs one text change,
+    // one TextEditedHandler call and one repaint. The field is one line:
+    // line breaks and tabs become spaces and other control characters are
+    // dropped. Returns false, changing nothing, unless a TextField has
+    // focus.
+    bool insertText(std::string_view text);
+    void setFocus(size_t index);
+    size_t focusIndex() const { return focus_; }
+    size_t focusableCount() const { return plan_.focusOrder.size(); }
+
+    // Mouse input, in screen cells. Each frame indexes the cells its
+    // focusable items cover as spans sorted by row and column, so a hit
+    // test is a binary search rather than a walk of the plan. A press
+    // focuses the item under it and presses a Button, as Enter does; the
+    // wheel scrolls by kWheelStep items, or rows in Rows mode. Returns
+    // whether the event was used. Hits are against the last frame drawn.
+    enum class MouseAction : uint8_t { Press, WheelUp, WheelDown };
+    static constexpr long kWheelStep = 3;
+    bool handleMouse(MouseAction action, int row, int col);
+    // The focusable item drawn at a cell, or kNoFocus.
+    size_t focusableAt(int row, int col) const;
+
+    // Shows text in place of the text property of the item with the given
+    // id, as typing into a TextField does, across plan rebuilds. Returns
+    // null for items whose text was never set.
+    void setItemText(const std::string &id, std::string text);
+    const std::string *itemText(const std::string &id) const;
+    // Called after each edit of a TextField, with its id (empty without
+    // one); e.g. to hand the text to the resolver for bindings such as
+    // greeter.greet(nameField.text).
+    using TextEditedHandler = std::function<void(const std::string &id, const std::string &text)>;
+    void setTextEditedHandler(TextEditedHandler handler) { textEdited_ = std::move(handler); }
+    // Runs a handler; its body is a range of the source the item was
+    // parsed from.
+    using ActionHandler = std::function<void(const std::string &id, const QmlScriptBlock &script)>;
+    void setActionHandler(ActionHandler handler) { action_ = std::move(handler); }
+
+    // Animations, all driven by one shared timeline. With one set, a Timer
+    // runs its onTriggered handler through the action handler; a
+    // NumberAnimation animates the opacity or x of a Text, Label or Button,
+    // either its target's or, as "NumberAnimation on opacity" inside the
+    // item, its parent's; a BusyIndicator spins; and the focused TextField
+    // shows a blinking cursor. Opacity below 0.5 leaves the item blank, so
+    // it blinks without moving anything around it, and x rotates the text
+    // right by that many characters within its own width, for a marquee.
+    // Each is a track registered when the plan compiles and removed with
+    // it, so the timeline only wakes while something runs, and a tick only
+    // changes the animated items' cells. Request a frame whenever
+    // QmlTimeline::tick() returns true. Items in repeaters are not
+    // animated, and without a timeline nothing moves. The timeline is not
+    // owned; pass nullptr to unset it before it goes away.
+    void setTimeline(QmlTimeline *timeline);
+
+    void setPendingPlaceholder(std::string placeholder) {
+        pendingPlaceholder_ = std::move(placeholder);
+        pendingPlaceholderWidth_ = QmlTextWidth::of(pendingPlaceholder_);
+        ++contentVersion_;
+    }
+    size_t pendingBindingCount() const { return pendingBindings_.size(); }
+
+    // The window's content is a Column, Row or Grid; Row, Column and Grid
+    // nest freely inside it. anchors.centerIn on it also centres it
+    // vertically. A Column at the top is virtualized: each frame resolves
+    // and lays out only the items in view plus an overscan margin on either
+    // side, so frame cost follows the screen height rather than the item
+    // count. The offset is the first item shown; it persists across renders
+    // and plan rebuilds and is clamped so the last item stays on screen.
+    void setScrollOffset(size_t firstItem) { scrollOffset_ = firstItem; }
+    void scrollBy(long items);
+    size_t scrollOffset() const { return scrollOffset_; }
+    void setOverscan(size_t items) { overscan_ = items; }
+    size_t itemCount() const { return plan_.items.size(); }
+    size_t itemsInView() const;
+
+    // Rows mode lays the whole content out once into an off-screen pad
+    // below the title and scrolls it by rows: a frame whose content did
+    // not change (no binding re-resolved, same plan and screen size) only
+    // copies the rows in view into the grid. It suits long reports and
+    // logs that are paged through more often than they change; Items mode
+    // suits lists too long to lay out in full. The row offset is clamped
+    // so the last row stays on screen.
+    enum class ScrollMode : uint8_t { Items, Rows };
+    void setScrollMode(ScrollMode mode);
+    ScrollMode scrollMode() const { return scrollMode_; }
+    void setScrollRow(int row) { scrollRow_ = std::max(0, row); }
+    void scrollRowsBy(long rows);
+    int scrollRow() const { return scrollRow_; }
+    // Height of the content in the pad; 0 in Items mode.
+    int contentRows() const { return pad_.rows(); }
+    // Number of times the pad was laid out and composed.
+    size_t padComposeCount() const { return padComposeCount_; }
+
+    // Find. Ctrl-F (kFindKey) or openSearch() shows a query line on the
+    // bottom row, and while it is open handleKey() edits the query rather
+    // than the focused field: Enter or Down steps to the next match, Up to
+    // the previous one and Escape closes it. The text searched is what the
+    // frame composed, in Rows mode the whole pad, which stepping scrolls
+    // to the current match, and in Items mode the items in view. Its index
+    // follows that text line by line (see QmlTextSearch), so a frame
+    // re-indexes only the lines that changed and a longer query only
+    // rescans the lines the shorter one matched. Matches are drawn in
+    // reverse video, the current one bold too, by patching the composed
+    // grid, so the screen only gets the cells they change.
+    static constexpr int kFindKey = 'F' & 0x1f;
+    void openSearch();
+    void closeSearch();
+    bool searching() const { return searching_; }
+    // Opens the search if it is closed.
+    void setSearchQuery(std::string_view query);
+    const std::string &searchQuery() const { return searchQuery_; }
+    // Matches as of the last frame, and the current one.
+    size_t searchMatchCount() const { return searching_ ? search_.matches().size() : 0; }
+    size_t searchMatchIndex() const { return searchCurrent_; }
+    void stepSearch(bool forward);
+    const QmlTextSearch &textSearch() const { return search_; }
+
+    size_t cellsWrittenLastFrame() const { return cellsWritten_; }
+    // Frames drawn, and those identical to the previous one, which made no
+    // draw calls and skipped the refresh.
+    size_t frameCount() const { return frameCount_; }
+    size_t identicalFrameCount() const { return identicalFrameCount_; }
+    double identicalFrameRate() const {
+        return frameCount_ == 0 ? 0.0 : static_cast<double>(identicalFrameCount_) / static_cast<double>(frameCount_);
+    }
+    // See QmlLayout::measureCount().
+    size_t layoutMeasureCount() const { return plan_.layout.measureCount(); }
+
+    // Per-frame stats are off by default, and while off a frame pays one
+    // predictable branch per phase for them. The HUD turns them on and
+    // shows the previous frame's stats in reverse video over the bottom
+    // row; as its text changes, no frame is identical while it is shown.
+    void setStatsEnabled(bool enabled) { statsEnabled_ = enabled; }
+    bool statsEnabled() const { return statsEnabled_; }
+    void setStatsHud(bool shown);
+    // Returns the number of heap allocations so far, e.g. from a replaced
+    // operator new; sampled around each frame while stats are on.
+    using AllocationCounter = uint64_t (*)();
+    void setAllocationCounter(AllocationCounter counter) { allocationCounter_ = counter; }
+    // The last frame drawn with stats on.
+    const QmlFrameStats &lastFrameStats() const { return lastFrameStats_; }
+
+    // Input-to-refresh latency. Call markInput() with the time a key or
+    // other input was read; the next frame drawn records the time from the
+    // oldest input marked since the previous frame to the end of its
+    // refresh, or of its diff when nothing changed. Latencies are kept in
+    // a histogram whether or not stats are on, and while tracing each one
+    // is a span and updates the p50 and p99 of an "input latency" counter.
+    void markInput(std::chrono::steady_clock::time_point readAt = std::chrono::steady_clock::now()) {
+        if (!inputPending_ || readAt < inputAt_) {
+            inputAt_ = readAt;
+        }
+        inputPending_ = true;
+    }
+    const QmlLatencyHistogram &inputLatency() const { return inputLatency_; }
+    void resetInputLatency() { inputLatency_.reset(); }
+    // Time spent resolving the bindings of each frame that had any to
+    // resolve, in the resolver and the writes into the cache; kept
+    // whether or not stats are on.
+    const QmlLatencyHistogram &resolveLatency() const { return resolveLatency_; }
+
+    // Time-slicing, for documents whose frames would outlast the frame
+    // interval and keep keys waiting. With a budget, compiling the plan
+    // goes one top-level item at a time and a BindingWriter resolves one
+    // binding at a time; between them the frame stops once the budget
+    // since it began is spent or inputPending() reports waiting input. It
+    // then commits what it has, consistent as far as it goes: the items
+    // compiled so far, with the bindings not resolved yet drawn as the
+    // pending placeholder. If the view is scrolled past the items compiled
+    // so far, the previous frame stays on screen instead. Each later
+    // render() goes on where the last one stopped; frameIncomplete() tells
+    // the caller to request one after handling the input. A budget of 0,
+    // the default, turns slicing off. Rows mode still composes the whole
+    // pad in each frame.
+    using InputPending = std::function<bool()>;
+    void setFrameBudget(std::chrono::nanoseconds budget, InputPending inputPending = nullptr);
+    std::chrono::nanoseconds frameBudget() const { return frameBudget_; }
+    bool frameIncomplete() const { return compileContent_ != nullptr || deferring_; }
+
+    // Scroll prefetch, for an async resolver. The scroll velocity is the
+    // change of the offset in the last frame that moved it, halved for
+    // each frame that did not. After each frame, the bindings of the items
+    // it will bring past the overscan within the next frames are requested
+    // in one batch, nearest first and at most budget of them. When the
+    // scroll turns around, prefetches still in flight are cancelled: their
+    // values are dropped on arrival, and cancelled(bindings) may abort them
+    // at the source. Items mode only; 0 frames, the default, turns it off.
+    using PrefetchCancelled = std::function<void(const std::vector<std::string> &bindings)>;
+    void setPrefetch(size_t frames, size_t budget, PrefetchCancelled cancelled = nullptr);
+    long scrollVelocity() const { return scrollVelocity_; }
+    size_t prefetchCount() const { return prefetchCount_; }          // bindings requested ahead
+    size_t prefetchCancelCount() const { return prefetchCancelCount_; }  // of them, cancelled
+
+protected:
+    QmlFrontendCore() = default;
+    ~QmlFrontendCore();
+
+    // Times a frame's phases while stats are on; otherwise each lap() is
+    // one branch.
+    class PhaseTimer {
+    public:
+        explicit PhaseTimer(bool enabled) : enabled_(enabled) {
+            if (enabled_) {
+                last_ = std::chrono::steady_clock::now();
+            }
+        }
+        void lap(std::chrono::nanoseconds &phase) {
+            if (enabled_) {
+                const auto now = std::chrono::steady_clock::now();
+                phase += now - last_;
+                last_ = now;
+            }
+        }
+
+    private:
+        bool enabled_;
+        std::chrono::steady_clock::time_point last_;
+    };
+
+    // Composes the document into an off-screen grid and sends the screen
+    // only the cells that changed since the previous frame. fetch(bindings)
+    // is called with the bindings that are neither cached nor pending and
+    // must storeResolved() them or markPending() them. A fetch callable as
+    // a BindingWriter is handed each such binding's cache entry instead.
+    template <typename Screen, typename Fetch>
+    void renderFrame(const QmlDocument &document, Screen &screen, Fetch &&fetch) {
+        const QmlTraceSpan span("QmlFrontend::render");
+        PhaseTimer timer = beginFrameStats();
+        const bool repaint = prepareFrame(document, screen.rows(), screen.cols());
+        timer.lap(frameStats_.layoutTime);
+        if (holdFrame_) {
+            return;  // see setFrameBudget()
+        }
+        drawFrame(screen, repaint, fetch, timer);
+    }
+
+    // Replays the compiled plan; the grid turns it into a minimal patch.
+    template <typename Screen, typename Fetch>
+    void drawFrame(Screen &screen, bool repaint, Fetch &fetch) {
+        const QmlTraceSpan span("QmlFrontend::redraw");
+        drawFrame(screen, repaint, fetch, beginFrameStats());
+    }
+
+    template <typename Screen, typename Fetch>
+    void drawFrame(Screen &screen, bool repaint, Fetch &fetch, PhaseTimer timer) {
+        // Fallbacks are only needed where the primary text came out empty,
+        // which is known once the first batch is in.
+        std::chrono::nanoseconds resolving{0};
+        for (const bool fallbacks : {false, true}) {
+            if constexpr (std::is_invocable_v<Fetch &, std::string_view, std::string &>) {
+                const QmlTraceSpan resolveSpan("resolve bindings");
+                const auto start = std::chrono::steady_clock::now();
+                const size_t written = writeUnresolved(fallbacks, fetch);
+                if (written > 0) {
+                    resolving += std::chrono::steady_clock::now() - start;
+                }
+                frameStats_.resolverCalls += written;
+                frameStats_.bindingsResolved += written;
+            } else {
+                collectUnresolved(fallbacks, unresolved_);
+                if (!unresolved_.empty()) {
+                    const QmlTraceSpan resolveSpan("resolve bindings");
+                    const auto start = std::chrono::steady_clock::now();
+                    ++frameStats_.resolverCalls;
+                    frameStats_.bindingsResolved += unresolved_.size();
+                    fetch(unresolved_);
+                    resolving += std::chrono::steady_clock::now() - start;
+                }
+            }
+        }
+        if (resolving.count() > 0) {
+            resolveLatency_.record(resolving);
+        }
+        timer.lap(frameStats_.resolveTime);
+        {
+            const QmlTraceSpan composeSpan("compose");
+            composeFrame();
+            if (statsHud_) {
+                drawStatsHud();
+            }
+        }
+        timer.lap(frameStats_.layoutTime);
+        const QmlTraceSpan drawSpan("draw");
+        const bool cleared = !grid_.frontValid();
+        cellsWritten_ = grid_.flush(screen);
+        ++frameCount_;
+        const bool refreshed = cellsWritten_ > 0 || repaint;
+        if (refreshed) {
+            screen.refresh();
+        } else {
+            ++identicalFrameCount_;
+        }
+        rendered_ = true;
+        timer.lap(frameStats_.drawTime);
+        if (inputPending_) {
+            finishInputLatency();
+        }
+        if (statsEnabled_) {
+            finishFrameStats(cleared, refreshed);
+        }
+    }
+
+    // Whether update() can skip the frame; otherwise drops the plan.
+    bool skipUpdate(const QmlDocumentDiff &diff);
+
+    void storeResolved(std::vector<std::string> &bindings, std::vector<std::string> values);
+    void markPending(const std::vector<std::string> &bindings);
+    // Caches a value that was pending; stale ones (invalidated while in
+    // flight, or from an older generation) are ignored.
+    bool acceptPending(uint64_t generation, std::string binding, std::string value);
+    uint64_t bindingGeneration() const { return bindingGeneration_; }
+    // The bindings to prefetch after this frame, for markPending(); cancels
+    // the ones in flight first if the scroll turned around.
+    void collectPrefetch(std::vector<std::string> &bindings);
+    bool rendered() const { return rendered_; }
+    void setResolves(bool resolves) { resolves_ = resolves; }
 
-class QmlCursesFrontend {
+    PhaseTimer beginFrameStats();
+    void finishFrameStats(bool cleared, bool refreshed);
+    void finishInputLatency();
+
+private:
+    // Views into the plan, the binding cache or string literals; valid
+    // until the next frame. Widths are display widths in cells.
+    struct Placement {
+        int row;
+        int col;
+        std::string_view text;
+        int width;
+        bool framed;  // drawn as "[ text ]", which makes it 4 cells wider
+        int padTo = 0;  // framed text is padded with blanks to this width
+        uint32_t attributes = 0;
+        int cursor = -1;  // cell of the text under a cursor: 0, or width after it
+    };
+    using Frame = std::vector<Placement>;
+
+    // Where an op's text comes from; bindings are resolved on every replay.
+    // width caches the display width of text once it is first shown.
+    // Role slots read the row's value of RenderPlan::Repeater::roles[role].
+    struct TextSlot {
+        enum Source : uint8_t { Missing, Literal, Binding, Role };
+        Source source = Missing;
+        std::string text;
+        mutable int width = -1;
+        uint32_t role = 0;
+    };
+
+    struct ResolvedText {
+        std::string_view text;
+        int width = 0;
+
+        bool empty() const { return text.empty(); }
+    };
+
+    struct DrawOp {
+        static constexpr uint32_t kNoWrap = UINT32_MAX;
+        static constexpr uint32_t kNoFocus = UINT32_MAX;
+        static constexpr uint32_t kNoLog = UINT32_MAX;
+
+        TextSlot text;
+        TextSlot fallback;            // used when text comes out empty
+        const char *missingText = "";  // when the text property is absent
+        bool framed = false;           // drawn as "[ text ]"
+        bool blankIfEmpty = false;     // falls back, then shows a blank field
+        uint32_t wrap = kNoWrap;       // index into RenderPlan::wraps
+        uint32_t focus = kNoFocus;     // index into RenderPlan::focusOrder
+        uint32_t log = kNoLog;         // index into RenderPlan::logs
+        uint32_t style = 0;            // A_BOLD and colour pair bits
+        bool hidden = false;           // animated opacity below 0.5
+        int shift = 0;                 // animated x: rotates the text right
+        mutable std::string rotated;   // the rotated text, shown this frame
+    };
+
+    // A TextField or Button that takes focus. key names its text in
+    // itemText_: the id, or "#" and the position for fields without one.
+    struct Focusable {
+        uint32_t op;
+        size_t item;  // in plan_.items
+        bool field;
+        std::string id;
+        std::string key;
+        QmlScriptBlock action;  // onAccepted or onClicked; name is Invalid if none
+    };
+
+    // Cells [begin, end) of a row that focusOrder[focus] was drawn on; rows
+    // are the frame's, which in Rows mode are the pad's offset by padTop_.
+    struct HitSpan {
+        int row;
+        int begin;
+        int end;
+        uint32_t focus;
+    };
+
+    // ops holds one DrawOp per layout leaf, except that a repeater's rows
+    // share their delegate's. items are the layout subtrees stacked down
+    // the screen: the top-level Column's children and repeater rows, or the
+    // single top-level Row or Grid.
+    // A component use compiled as a blank row; item is its top-level item.
+    struct Reference {
+        size_t item;
+        const QmlNode *use;
+    };
+
+    // Items [firstItem, firstItem + rows.size()) are the model's rows, each
+    // a copy of the delegate's layout subtree at delegate. Copies of
+    // removed rows are kept in spares for rows inserted later.
+    struct Repeater {
+        struct Row {
+            std::vector<std::string> values;  // one per role
+            mutable std::vector<int> widths;
+        };
+
+        QmlListModel *model = nullptr;
+        size_t firstItem = 0;
+        uint32_t delegate = 0;
+        std::vector<QmlAtom> roles;
+        std::vector<Row> rows;
+        std::vector<uint32_t> spares;
+    };
+    static constexpr uint32_t kNoRepeater = UINT32_MAX;
+
+    // A LogView's ring; seen is its appended() as of the last frame.
+    struct LogPane {
+        QmlLogRing *ring;
+        int rows;
+        int width;  // 0 for the screen's
+        uint64_t seen;
+    };
+
+    struct RenderPlan {
+        const QmlDocument *document = nullptr;
+        uint64_t revision = 0;
+        int rows = 0;
+        int cols = 0;
+        int spacing = 0;       // between items
+        bool centered = false;  // anchors.centerIn on the top-level item
+        TextSlot title;
+        std::vector<DrawOp> ops;
+        // Line-break caches of the ops with a wrapMode. They wrap at the
+        // screen width and outlive resizes with the rest of the plan.
+        std::vector<QmlTextWrap> wraps;
+        QmlLayout layout;
+        std::vector<uint32_t> items;
+        std::vector<int> itemTop;  // row of each item, relative to the first
+        std::vector<Reference> references;
+        std::vector<Repeater> repeaters;
+        std::vector<uint32_t> itemRepeater;  // per item; kNoRepeater if static
+        std::vector<LogPane> logs;
+        std::vector<Focusable> focusOrder;
+        std::unordered_map<std::string, uint32_t> textOps;  // ops by item id
+        size_t initialFocus = kNoFocus;                     // focus: true
+        std::vector<QmlTimeline::Track> tracks;             // on timeline_
+    };
+
+    // Forwards one model's notifications to the plan.
+    class ModelObserver final : public QmlListModel::Observer {
+    public:
+        ModelObserver(QmlFrontendCore &core, QmlListModel &model) : core_(core), model_(model) {
+            model_.addObserver(this);
+        }
+        ~ModelObserver() { model_.removeObserver(this); }
+        ModelObserver(const ModelObserver &) = delete;
+        ModelObserver &operator=(const ModelObserver &) = delete;
+
+        QmlListModel &model() const { return model_; }
+
+        void rowsInserted(size_t first, size_t count) override { core_.insertRows(model_, first, count); }
+        void rowsRemoved(size_t first, size_t count) override { core_.removeRows(model_, first, count); }
+        void rowsMoved(size_t first, size_t count, size_t destination) override {
+            core_.moveRows(model_, first, count, destination);
+        }
+        void dataChanged(size_t first, size_t count) override { core_.updateRows(model_, first, count); }
+        void modelReset() override { core_.invalidatePlan(); }
+
+    private:
+        QmlFrontendCore &core_;
+        QmlListModel &model_;
+    };
+
+    struct LeafText {
+        uint32_t node;
+        ResolvedText text;
+        bool framed;
+        uint32_t wrap;  // DrawOp::wrap
+        int padTo;
+        uint32_t attributes;
+        int cursor;
+        uint32_t log = DrawOp::kNoLog;
+    };
+
+    // Invalidated entries are kept, marked stale, so re-resolving them can
+    // reuse the value's buffer. width is the value's display width, -1
+    // until a frame measures it; storing a value resets it.
+    struct CachedBinding {
+        std::string value;
+        mutable int width = -1;
+        bool fresh = false;
+    };
+
+    std::unordered_set<std::string> pendingBindings_;
+    std::string pendingPlaceholder_ = "...";
+    int pendingPlaceholderWidth_ = 3;
+    BindingVersion bindingVersion_;
+    uint64_t lastBindingVersion_ = 0;
+    uint64_t bindingGeneration_ = 0;
+    std::unordered_map<std::string, CachedBinding> bindingCache_;
+    QmlExecutor *resolveExecutor_ = nullptr;
+    size_t parallelMinimum_ = 64;
+    RenderPlan plan_;
+    QmlCellGrid grid_;
+    // Instances by the use they were made for, valid while the document
+    // keeps its nodes; null for uses that are not components.
+    ComponentInstantiator instantiator_;
+    std::unordered_map<const QmlNode *, std::unique_ptr<QmlNode>> instances_;
+    const QmlDocument *instancesDocument_ = nullptr;
+    uint64_t instancesRevision_ = 0;
+    size_t instanceCount_ = 0;
+    bool compilingInstance_ = false;
+    std::unordered_map<std::string, std::unique_ptr<ModelObserver>> models_;
+    std::unordered_map<std::string, QmlLogRing *> logRings_;
+    std::vector<QmlLogRing *> pinnedRings_;  // until the frame is composed
+    std::unordered_map<QmlAtom, ElementRenderer> elementRenderers_;
+    uint32_t compilingRepeater_ = kNoRepeater;
+    size_t planCompileCount_ = 0;
+    // Rows mode: the pad, and what it was composed from. contentVersion_
+    // moves whenever something the content is drawn from changes.
+    QmlCellPad pad_;
+    ScrollMode scrollMode_ = ScrollMode::Items;
+    int scrollRow_ = 0;
+    int padTop_ = 0;  // screen row of the pad's first row
+    int padScreenRows_ = -1;
+    uint64_t contentVersion_ = 0;
+    uint64_t padVersion_ = UINT64_MAX;
+    size_t padComposeCount_ = 0;
+    // Find: the index over the composed lines, which are the pad's rows in
+    // Rows mode and the screen's otherwise, and the pad compose it read.
+    QmlTextSearch search_;
+    bool searching_ = false;
+    bool searchQueryChanged_ = false;
+    std::string searchQuery_;
+    size_t searchCurrent_ = 0;
+    size_t searchPadCompose_ = SIZE_MAX;
+    size_t cellsWritten_ = 0;
+    size_t frameCount_ = 0;
+    size_t identicalFrameCount_ = 0;
+    size_t scrollOffset_ = 0;
+    size_t overscan_ = 4;
+    bool rendered_ = false;
+    bool resolves_ = false;
+    bool statsEnabled_ = false;
+    bool statsHud_ = false;
+    AllocationCounter allocationCounter_ = nullptr;
+    uint64_t allocationsAtStart_ = 0;
+    QmlFrameStats frameStats_;  // the frame being drawn
+    QmlFrameStats lastFrameStats_;
+    std::string hud_;
+    size_t focus_ = kNoFocus;
+    std::string focusKey_;  // finds the focused item again after a rebuild
+    std::unordered_map<std::string, std::string> itemText_;
+    std::vector<HitSpan> hits_;  // sorted by row, then column
+    TextEditedHandler textEdited_;
+    ActionHandler action_;
+    QmlTimeline *timeline_ = nullptr;
+    QmlTimeline::Track cursorTrack_ = QmlTimeline::kNoTrack;
+    bool cursorShown_ = true;
+    std::vector<const QmlNode *> animations_;  // targeted ones, while compiling
+    bool inputPending_ = false;
+    std::chrono::steady_clock::time_point inputAt_;
+    // Time-slicing: the budget, the slice of the frame being drawn, and
+    // the top-level Column while its items are still being compiled.
+    static constexpr uint32_t kInputCheckInterval = 16;
+    std::chrono::nanoseconds frameBudget_{0};
+    InputPending inputWaiting_;
+    std::chrono::steady_clock::time_point sliceDeadline_;
+    uint32_t sliceChecks_ = 0;
+    bool sliceStopped_ = false;
+    bool deferring_ = false;   // bindings were left unresolved this frame
+    bool holdFrame_ = false;   // the previous frame stays on screen
+    const QmlNode *compileContent_ = nullptr;
+    size_t compileNext_ = 0;  // its next child
+    // Scroll prefetch: the offset of the last frame, and the bindings
+    // requested ahead in the direction, by item, until they arrive, come
+    // into the window or are cancelled.
+    size_t prefetchFrames_ = 0;
+    size_t prefetchBudget_ = 0;
+    PrefetchCancelled prefetchCancelled_;
+    size_t lastOffset_ = 0;
+    long scrollVelocity_ = 0;
+    int prefetchDirection_ = 0;
+    std::vector<std::pair<size_t, std::string>> prefetched_;
+    size_t prefetchCount_ = 0;
+    size_t prefetchCancelCount_ = 0;
+    QmlLatencyHistogram inputLatency_;
+    QmlLatencyHistogram resolveLatency_;
+    // Free lists for the plan's draw ops and repeater rows; see
+    // setRecycleCapacity().
+    QmlFreeList<DrawOp> opPool_;
+    QmlFreeList<Repeater::Row> rowPool_;
+    // Per-frame scratch, kept to reuse its capacity.
+    std::vector<std::string> unresolved_;
+    std::vector<LeafText> leaves_;
+    std::vector<std::pair<const std::string, CachedBinding> *> writes_;
+    Frame frame_;
+    std::string searchLine_;
+    std::string searchBar_;
+
+    // Checks the binding version, resizes the grid and recompiles the plan
+    // as needed. Returns whether the whole screen will be repainted.
+    bool prepareFrame(const QmlDocument &document, int rows, int cols);
+    void compilePlan(const QmlDocument &document, int rows, int cols);
+    void beginPlan(const QmlDocument &document, int rows, int cols);
+    // Gives the plan's ops and rows to the free lists and empties it,
+    // keeping its layout's capacity.
+    void recyclePlan();
+    // A cleared op, with a pooled one's string buffers if there is one.
+    DrawOp takeOp();
+    void continuePlan(bool sliced);
+    // Whether the frame's slice ran out; see setFrameBudget().
+    bool sliceExpired();
+    uint32_t compileNode(const QmlNode &node, uint32_t parent);
+    uint32_t compileReference(const QmlNode &node, uint32_t parent);
+    void compileRepeater(const QmlNode &node);
+    void compileSlot(const QmlNode &node, QmlAtom key, TextSlot &slot);
+    // Registers a static op's id, set text and focus.
+    void compileInteractive(const QmlNode &node, uint32_t op);
+    bool editField(const Focusable &field, int key);
+    // The text the field shows, taken from its binding on the first edit.
+    std::string &fieldText(const Focusable &field);
+    void fieldEdited(const Focusable &field, const std::string &value);
+    // Timers and targeted animations register their tracks; "on" animations
+    // and BusyIndicators are compiled with their op.
+    void compileAnimated(const QmlNode &node);
+    void compileAnimation(const QmlNode &node, uint32_t op, QmlAtom property, bool running);
+    bool animate(uint32_t op, QmlAtom property, double value);
+    void removeTracks();
+    // Shows the cursor and restarts its blink, or stops it when no field
+    // has focus.
+    void resetCursor();
+    static void fetchRow(const Repeater &repeater, size_t row, Repeater::Row &values);
+    // Patch the plan for a model's notifications.
+    void insertRows(const QmlListModel &model, size_t first, size_t count);
+    void removeRows(const QmlListModel &model, size_t first, size_t count);
+    void moveRows(const QmlListModel &model, size_t first, size_t count, size_t destination);
+    void updateRows(const QmlListModel &model, size_t first, size_t count);
+    void shiftItems(size_t from, size_t repeater, long by);
+    // Instantiates the references in the items in view, recompiling the
+    // plan until none are left there.
+    void instantiateInView();
+    void trackScroll();
+    void cancelPrefetch();
+    void updateItemTops();
+    void extendItemTops();
+    size_t itemsFrom(size_t first) const;
+    size_t maxScrollOffset() const;
+    void dropAllBindings();
+    // Items [begin, end) are resolved and measured; [first, end) are shown.
+    void window(size_t &first, size_t &begin, size_t &end) const;
+    // Calls visit(item) for the window's items, most wanted first: the
+    // focused item, the title, the items in view outward from the focused
+    // one, then the overscan. The title is passed as kTitleItem, and comes
+    // first when no focused item is in view.
+    static constexpr size_t kTitleItem = SIZE_MAX;
+    template <typename Visit>
+    void forEachByPriority(Visit &&visit) const;
+    template <typename Visit>
+    void forEachUnresolved(bool fallbacks, Visit &&visit) const;
+    void collectUnresolved(bool fallbacks, std::vector<std::string> &bindings) const;
+    // Returns the number of bindings written.
+    size_t writeUnresolved(bool fallbacks, BindingWriter write);
+    size_t writeUnresolvedInParallel(bool fallbacks, BindingWriter write);
+    void composeFrame();
+    void composePadFrame();
+    bool handleSearchKey(int key);
+    // Re-indexes the lines that changed and finds the query again if they
+    // or it did; then highlights the matches in view and draws the query.
+    void updateSearch();
+    void showSearch();
+    bool indexSearchLine(size_t line, const QmlCell *cells, int cols);
+    // Scrolls the pad so the current match is in view.
+    void revealSearchMatch();
+    void drawStatsHud();
+    // Fills frame_; returns the screen row the content starts at.
+    int replayPlan();
+    // Pins a LogView's lines in view and places them; unpinLogs() lets them
+    // go once they are composed.
+    void placeLog(const LeafText &leaf, const QmlLayout::Node &node, int lastRow);
+    void unpinLogs();
+    template <typename Target>
+    static void putPlacement(Target &target, const Placement &placement, int rowOffset);
+    void placeCentered(int row, ResolvedText text, bool framed = false, int paddedWidth = -1);
+
+    // Overwrites slot, reusing its text's buffer.
+    static void slotFor(const QmlNode &node, QmlAtom key, TextSlot &slot);
+    // Attributes for a literal color and font.bold.
+    static uint32_t styleFor(const QmlNode &node);
+    ResolvedText resolve(const TextSlot &slot, std::string_view defaultValue = {}) const;
+    // Like resolve(), for a slot drawn in plan_.items[item].
+    ResolvedText resolveIn(size_t item, const TextSlot &slot, std::string_view defaultValue = {}) const;
+};
+
+// Frontend for a screen and a resolver known at compile time, which are
+// called directly. Resolver is called like a BatchBindingResolver, or like
+// a BindingWriter if it accepts those arguments.
+template <typename Screen, typename Resolver>
+class BasicQmlCursesFrontend : public QmlFrontendCore {
+public:
+    BasicQmlCursesFrontend(Screen &screen, Resolver resolver) : screen_(screen), resolver_(std::move(resolver)) {
+        setResolves(true);
+    }
+
+    void render(const QmlDocument &document) {
+        if constexpr (std::is_invocable_v<Resolver &, std::string_view, std::string &>) {
+            renderFrame(document, screen_, resolver_);
+        } else {
+            renderFrame(document, screen_, [this](std::vector<std::string> &bindings) {
+                std::vector<std::string> values = resolver_(static_cast<const std::vector<std::string> &>(bindings));
+                storeResolved(bindings, std::move(values));
+            });
+        }
+    }
+    void update(const QmlDocument &document, const QmlDocumentDiff &diff) {
+        if (!skipUpdate(diff)) {
+            render(document);
+        }
+    }
+
+private:
+    Screen &screen_;
+    Resolver resolver_;
+};
+
+// Type-erased frontend over any ICursesScreen, with single, batch or
+// asynchronous resolvers.
+class QmlCursesFrontend : public QmlFrontendCore {
 public:
     QmlCursesFrontend(ICursesScreen &screen, BindingResolver resolver = nullptr);
+    // Each frame collects the distinct bindings that are not cached yet
+    // and resolves them with a single call (two if a TextField's text comes
+    // out empty and its placeholder needs resolving too).
+    QmlCursesFrontend(ICursesScreen &screen, BatchBindingResolver resolver);
+    // Frames never wait on the resolver: bindings still in flight are drawn
+    // as the pending placeholder, and applyResolvedBindings() patches in the
+    // values once they arrive.
+    QmlCursesFrontend(ICursesScreen &screen, AsyncBindingResolver resolver);
+    // Resolves each uncached binding in place into its reused cache buffer.
+    // The writer is not copied and must outlive the frontend.
+    QmlCursesFrontend(ICursesScreen &screen, BindingWriter writer);
 
+    // Composes the document into an off-screen grid and sends the screen
+    // only the cells that changed since the previous frame. The screen is
+    // cleared on the first frame and whenever its size changes.
     void render(const QmlDocument &document);
+    // Same as render(), but skips the frame entirely for an empty diff.
+    void update(const QmlDocument &document, const QmlDocumentDiff &diff);
+
+    // Moves values delivered by the async resolver into the cache and, if
+    // any arrived, redraws the last frame; only the cells that changed are
+    // sent to the screen. Call it from the thread that renders, typically
+    // in response to the ready notifier. Returns whether anything arrived.
+    bool applyResolvedBindings();
+    // Called from the delivering thread each time async values arrive.
+    void setBindingsReadyNotifier(std::function<void()> notifier);
 
 private:
+    // Shared with in-flight callbacks, which may outlive the frontend.
+    struct AsyncInbox {
+        struct Delivery {
+            uint64_t generation;
+            std::string binding;
+            std::string value;
+        };
+        std::mutex mutex;
+        std::vector<Delivery> values;
+        std::function<void()> notifier;
+    };
+
     ICursesScreen &screen_;
-    BindingResolver resolver_;
+    BatchBindingResolver resolver_;
+    AsyncBindingResolver asyncResolver_;
+    BindingWriter writer_;
+    std::shared_ptr<AsyncInbox> inbox_;
+    std::vector<std::string> prefetch_;  // scratch
 
-    std::string resolveValue(const std::string &value) const;
-    void drawCentered(int row, const std::string &text, int paddedWidth = -1);
+    void fetch(std::vector<std::string> &bindings);
+    void requestAsync(std::vector<std::string> &bindings);
+    bool drainInbox();
 };
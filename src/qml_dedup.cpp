@@ -0,0 +1,224 @@
+#include "qml_dedup.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+
+uint64_t mix(uint64_t hash, uint64_t value) {
+    return (hash ^ value) * 0x100000001b3ULL;
+}
+
+size_t stringHeapBytes(const std::string &text) {
+    static const size_t inlineCapacity = std::string().capacity();
+    return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+}
+
+bool sameProperty(const QmlProperty &a, const QmlProperty &b) {
+    return a.key == b.key && a.value == b.value && a.typed.kind == b.typed.kind && a.typed.intValue == b.typed.intValue &&
+           a.typed.realValue == b.typed.realValue;
+}
+
+bool sameScript(const QmlScriptBlock &a, const QmlScriptBlock &b) {
+    return a.kind == b.kind && a.name == b.name && a.parameters == b.parameters;
+}
+
+}  // namespace
+
+// Interns subtrees bottom-up: a node's children are interned first, so two
+// subtrees are identical exactly when their own fields and child shape
+// indices are, and each comparison is shallow.
+class QmlDedupBuilder {
+public:
+    explicit QmlDedupBuilder(QmlDedupedDocument &doc) : doc_(doc) {}
+
+    uint32_t intern(const QmlNode &node) {
+        const auto preorder = static_cast<uint32_t>(doc_.nodeCount_++);
+        if (!node.id.empty()) {
+            doc_.ids_.emplace_back(preorder, node.id);
+        }
+
+        std::vector<uint32_t> children;
+        children.reserve(node.children.size());
+        uint32_t nodeCount = 1;
+        for (const auto &child : node.children) {
+            children.push_back(intern(child));
+            nodeCount += doc_.shapes_[children.back()].nodeCount;
+        }
+
+        uint64_t hash = mix(mix(0xcbf29ce484222325ULL, node.typeAtom), node.binding);
+        for (const auto &property : node.properties) {
+            hash = mix(hash, property.key);
+            if (property.key != QmlAtoms::id) {
+                hash = mix(hash, std::hash<std::string>()(property.value));
+            }
+        }
+        for (const auto &script : node.scripts) {
+            hash = mix(hash, script.name);
+        }
+        for (const uint32_t child : children) {
+            hash = mix(hash, child);
+        }
+
+        const auto candidates = index_.equal_range(hash);
+        for (auto it = candidates.first; it != candidates.second; ++it) {
+            if (matches(doc_.shapes_[it->second], node, children)) {
+                return it->second;
+            }
+        }
+
+        QmlShape shape;
+        shape.type = node.typeAtom;
+        shape.binding = node.binding;
+        shape.firstProperty = static_cast<uint32_t>(doc_.properties_.size());
+        shape.propertyCount = static_cast<uint32_t>(node.properties.size());
+        for (const auto &property : node.properties) {
+            doc_.properties_.push_back(property);
+            if (property.key == QmlAtoms::id) {
+                doc_.properties_.back().value.clear();
+            }
+        }
+        shape.firstScript = static_cast<uint32_t>(doc_.scripts_.size());
+        shape.scriptCount = static_cast<uint32_t>(node.scripts.size());
+        for (const auto &script : node.scripts) {
+            doc_.scripts_.push_back(QmlScriptBlock{script.kind, script.name, script.parameters, 0, 0});
+        }
+        shape.firstChild = static_cast<uint32_t>(doc_.childShapes_.size());
+        shape.childCount = static_cast<uint32_t>(children.size());
+        doc_.childShapes_.insert(doc_.childShapes_.end(), children.begin(), children.end());
+        shape.nodeCount = nodeCount;
+
+        const auto index = static_cast<uint32_t>(doc_.shapes_.size());
+        doc_.shapes_.push_back(shape);
+        index_.emplace(hash, index);
+        return index;
+    }
+
+private:
+    bool matches(const QmlShape &shape, const QmlNode &node, const std::vector<uint32_t> &children) const {
+        if (shape.type != node.typeAtom || shape.binding != node.binding ||
+            shape.propertyCount != node.properties.size() || shape.scriptCount != node.scripts.size() ||
+            shape.childCount != children.size()) {
+            return false;
+        }
+        for (uint32_t i = 0; i < shape.propertyCount; ++i) {
+            const QmlProperty &stored = doc_.properties_[shape.firstProperty + i];
+            const QmlProperty &property = node.properties[i];
+            // Ids are per instance; only their position has to match.
+            if (property.key == QmlAtoms::id ? stored.key != QmlAtoms::id : !sameProperty(stored, property)) {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < shape.scriptCount; ++i) {
+            if (!sameScript(doc_.scripts_[shape.firstScript + i], node.scripts[i])) {
+                return false;
+            }
+        }
+        return std::equal(children.begin(), children.end(), doc_.childShapes_.begin() + shape.firstChild);
+    }
+
+    QmlDedupedDocument &doc_;
+    std::unordered_multimap<uint64_t, uint32_t> index_;
+};
+
+namespace {
+
+void expandShape(const QmlDedupedDocument &doc, uint32_t shapeIndex, QmlNode &node, uint32_t &nextNode) {
+    const QmlShape &shape = doc.shape(shapeIndex);
+    const std::string_view id = doc.id(nextNode++);
+    node.setType(QmlAtomTable::global().name(shape.type));
+    node.binding = shape.binding;
+    node.id.assign(id.data(), id.size());
+    node.properties.assign(doc.propertiesBegin(shapeIndex), doc.propertiesEnd(shapeIndex));
+    for (auto &property : node.properties) {
+        if (property.key == QmlAtoms::id) {
+            property.value = node.id;
+        }
+    }
+    node.scripts.assign(doc.scriptsBegin(shapeIndex), doc.scriptsEnd(shapeIndex));
+    const QmlFlatIndexRange children = doc.children(shapeIndex);
+    node.children.resize(children.size());
+    for (size_t i = 0; i < children.size(); ++i) {
+        expandShape(doc, children[i], node.children[i], nextNode);
+    }
+}
+
+}  // namespace
+
+QmlDedupedDocument QmlDedupedDocument::build(const QmlDocument &document) {
+    QmlDedupedDocument doc;
+    QmlDedupBuilder builder(doc);
+    for (const auto &root : document.roots) {
+        doc.roots_.push_back(builder.intern(root));
+    }
+    return doc;
+}
+
+QmlDocument QmlDedupedDocument::expand() const {
+    QmlDocument document;
+    document.roots.resize(roots_.size());
+    uint32_t nextNode = 0;
+    for (size_t i = 0; i < roots_.size(); ++i) {
+        expandShape(*this, roots_[i], document.roots[i], nextNode);
+    }
+    document.reindex();
+    return document;
+}
+
+QmlFlatIndexRange QmlDedupedDocument::roots() const {
+    return QmlFlatIndexRange{roots_.data(), roots_.data() + roots_.size()};
+}
+
+QmlFlatIndexRange QmlDedupedDocument::children(uint32_t shapeIndex) const {
+    const uint32_t *first = childShapes_.data() + shapes_[shapeIndex].firstChild;
+    return QmlFlatIndexRange{first, first + shapes_[shapeIndex].childCount};
+}
+
+const QmlProperty *QmlDedupedDocument::propertiesBegin(uint32_t shapeIndex) const {
+    return properties_.data() + shapes_[shapeIndex].firstProperty;
+}
+
+const QmlProperty *QmlDedupedDocument::propertiesEnd(uint32_t shapeIndex) const {
+    return propertiesBegin(shapeIndex) + shapes_[shapeIndex].propertyCount;
+}
+
+const QmlScriptBlock *QmlDedupedDocument::scriptsBegin(uint32_t shapeIndex) const {
+    return scripts_.data() + shapes_[shapeIndex].firstScript;
+}
+
+const QmlScriptBlock *QmlDedupedDocument::scriptsEnd(uint32_t shapeIndex) const {
+    return scriptsBegin(shapeIndex) + shapes_[shapeIndex].scriptCount;
+}
+
+std::string_view QmlDedupedDocument::id(uint32_t node) const {
+    const auto it = std::lower_bound(ids_.begin(), ids_.end(), node,
+                                     [](const auto &entry, uint32_t wanted) { return entry.first < wanted; });
+    return it != ids_.end() && it->first == node ? std::string_view(it->second) : std::string_view();
+}
+
+uint32_t QmlDedupedDocument::findById(std::string_view wantedId) const {
+    for (const auto &entry : ids_) {
+        if (entry.second == wantedId) {
+            return entry.first;
+        }
+    }
+    return npos;
+}
+
+size_t QmlDedupedDocument::byteSize() const {
+    size_t bytes = sizeof(QmlDedupedDocument) + shapes_.capacity() * sizeof(QmlShape) +
+                   properties_.capacity() * sizeof(QmlProperty) + scripts_.capacity() * sizeof(QmlScriptBlock) +
+                   (childShapes_.capacity() + roots_.capacity()) * sizeof(uint32_t) +
+                   ids_.capacity() * sizeof(ids_[0]);
+    for (const auto &property : properties_) {
+        bytes += stringHeapBytes(property.value);
+    }
+    for (const auto &script : scripts_) {
+        bytes += stringHeapBytes(script.parameters);
+    }
+    for (const auto &entry : ids_) {
+        bytes += stringHeapBytes(entry.second);
+    }
+    return bytes;
+}
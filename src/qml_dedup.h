@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "qml_flat_document.h"
+#include "qml_parser.h"
+
+// One structurally distinct subtree of a QmlDedupedDocument: a type, its
+// properties, script signatures and child shapes. An id property is kept
+// as a placeholder with an empty value; each instance's id is stored
+// apart from the shape.
+struct QmlShape {
+    QmlAtom type = QmlAtoms::Invalid;
+    QmlAtom binding = QmlAtoms::Invalid;
+    uint32_t firstProperty = 0;
+    uint32_t propertyCount = 0;
+    uint32_t firstScript = 0;
+    uint32_t scriptCount = 0;
+    uint32_t firstChild = 0;  // into the child shape table
+    uint32_t childCount = 0;
+    uint32_t nodeCount = 1;   // nodes in one instance, this one included
+};
+
+// Read-only, hash-consed form of a QmlDocument, for generated screens that
+// repeat the same delegate thousands of times with only the ids differing.
+// Structurally identical subtrees are stored once, as a shape; ids are
+// kept per instance in a side table keyed by pre-order node index. Memory
+// grows with the number of distinct shapes plus the number of ids.
+//
+// Source ranges and script body offsets differ between instances and are
+// not kept; expand() leaves them zero, like a document built in code.
+class QmlDedupedDocument {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    static QmlDedupedDocument build(const QmlDocument &document);
+    QmlDocument expand() const;
+
+    // Nodes in the expanded document, and the shapes they share.
+    size_t nodeCount() const { return nodeCount_; }
+    size_t shapeCount() const { return shapes_.size(); }
+
+    const QmlShape &shape(uint32_t index) const { return shapes_[index]; }
+    QmlFlatIndexRange roots() const;
+    QmlFlatIndexRange children(uint32_t shapeIndex) const;
+    const QmlProperty *propertiesBegin(uint32_t shapeIndex) const;
+    const QmlProperty *propertiesEnd(uint32_t shapeIndex) const;
+    const QmlScriptBlock *scriptsBegin(uint32_t shapeIndex) const;
+    const QmlScriptBlock *scriptsEnd(uint32_t shapeIndex) const;
+
+    // Node indices count the expanded document in pre-order.
+    std::string_view id(uint32_t node) const;
+    uint32_t findById(std::string_view wantedId) const;
+
+    // Bytes held, counted as in QmlDocument::memoryUsage().
+    size_t byteSize() const;
+
+private:
+    friend class QmlDedupBuilder;
+
+    std::vector<QmlShape> shapes_;
+    std::vector<QmlProperty> properties_;
+    std::vector<QmlScriptBlock> scripts_;
+    std::vector<uint32_t> childShapes_;
+    std::vector<uint32_t> roots_;
+    std::vector<std::pair<uint32_t, std::string>> ids_;  // sorted by node
+    size_t nodeCount_ = 0;
+};
@@ -0,0 +1,143 @@
+#include "qml_diff.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+class Differ {
+public:
+    explicit Differ(std::vector<QmlChange> &changes) : changes_(changes) {}
+
+    void diffChildren(const QmlNodeList &before, const QmlNodeList &after, const QmlNode *newParent) {
+        // Snapshots of one document share every list off the edited paths,
+        // and a shared list holds the same subtrees on both sides.
+        if (before.sharesWith(after)) {
+            return;
+        }
+        // match[i] is the index in before of the node paired with after[i].
+        std::vector<size_t> match(after.size(), kUnmatched);
+        std::vector<bool> taken(before.size(), false);
+
+        std::unordered_map<std::string_view, size_t> beforeById;
+        for (size_t i = 0; i < before.size(); ++i) {
+            if (!before[i].id.empty()) {
+                beforeById.emplace(before[i].id, i);
+            }
+        }
+        for (size_t i = 0; i < after.size(); ++i) {
+            if (after[i].id.empty()) {
+                continue;
+            }
+            const auto it = beforeById.find(after[i].id);
+            if (it != beforeById.end() && !taken[it->second] && kindOf(before[it->second]) == kindOf(after[i])) {
+                match[i] = it->second;
+                taken[it->second] = true;
+            }
+        }
+
+        // Pair the remaining nodes of each type in order. Nodes with an id
+        // only pair with the same id, so a renamed object is replaced.
+        struct Candidates {
+            std::vector<size_t> indices;
+            size_t next = 0;
+        };
+        std::unordered_map<uint64_t, Candidates> beforeByType;
+        for (size_t i = 0; i < before.size(); ++i) {
+            if (!taken[i] && before[i].id.empty()) {
+                beforeByType[kindOf(before[i])].indices.push_back(i);
+            }
+        }
+        for (size_t i = 0; i < after.size(); ++i) {
+            if (match[i] != kUnmatched || !after[i].id.empty()) {
+                continue;
+            }
+            const auto it = beforeByType.find(kindOf(after[i]));
+            if (it != beforeByType.end() && it->second.next < it->second.indices.size()) {
+                match[i] = it->second.indices[it->second.next++];
+                taken[match[i]] = true;
+            }
+        }
+
+        for (size_t i = 0; i < before.size(); ++i) {
+            if (!taken[i]) {
+                changes_.push_back(QmlChange{QmlChange::Kind::Removed, &before[i], nullptr, nullptr, QmlAtoms::Invalid});
+            }
+        }
+        const std::vector<bool> inOrder = keptInOrder(match);
+        for (size_t i = 0; i < after.size(); ++i) {
+            if (match[i] == kUnmatched) {
+                changes_.push_back(QmlChange{QmlChange::Kind::Inserted, nullptr, &after[i], newParent, QmlAtoms::Invalid});
+                continue;
+            }
+            if (!inOrder[i]) {
+                changes_.push_back(
+                    QmlChange{QmlChange::Kind::Moved, &before[match[i]], &after[i], newParent, QmlAtoms::Invalid});
+            }
+            diffNode(before[match[i]], after[i]);
+        }
+    }
+
+private:
+    static constexpr size_t kUnmatched = static_cast<size_t>(-1);
+
+    // Nodes only pair with their own type bound to the same property, so
+    // an object moved to another property is replaced.
+    static uint64_t kindOf(const QmlNode &node) { return uint64_t(node.binding) << 32 | node.typeAtom; }
+
+    // Marks the paired nodes of the longest subsequence whose old indices
+    // still ascend, patience-sorting style; the other pairs moved.
+    static std::vector<bool> keptInOrder(const std::vector<size_t> &match) {
+        std::vector<size_t> tails;  // after-index ending the best run of each length
+        std::vector<size_t> previous(match.size(), kUnmatched);
+        for (size_t i = 0; i < match.size(); ++i) {
+            if (match[i] == kUnmatched) {
+                continue;
+            }
+            const auto at = std::lower_bound(tails.begin(), tails.end(), match[i],
+                                             [&match](size_t tail, size_t old) { return match[tail] < old; });
+            if (at != tails.begin()) {
+                previous[i] = *(at - 1);
+            }
+            if (at == tails.end()) {
+                tails.push_back(i);
+            } else {
+                *at = i;
+            }
+        }
+        std::vector<bool> inOrder(match.size(), false);
+        for (size_t i = tails.empty() ? kUnmatched : tails.back(); i != kUnmatched; i = previous[i]) {
+            inOrder[i] = true;
+        }
+        return inOrder;
+    }
+
+    void diffNode(const QmlNode &before, const QmlNode &after) {
+        for (const auto &prop : after.properties) {
+            const QmlProperty *old = before.findProperty(prop.key);
+            if (!old || old->value != prop.value || old->typed.kind != prop.typed.kind) {
+                propertyChanged(before, after, prop.key);
+            }
+        }
+        for (const auto &prop : before.properties) {
+            if (!after.findProperty(prop.key)) {
+                propertyChanged(before, after, prop.key);
+            }
+        }
+        diffChildren(before.children, after.children, &after);
+    }
+
+    void propertyChanged(const QmlNode &before, const QmlNode &after, QmlAtom key) {
+        changes_.push_back(QmlChange{QmlChange::Kind::PropertyChanged, &before, &after, nullptr, key});
+    }
+
+    std::vector<QmlChange> &changes_;
+};
+
+}  // namespace
+
+QmlDocumentDiff QmlDocumentDiff::compute(const QmlDocument &before, const QmlDocument &after) {
+    QmlDocumentDiff diff;
+    Differ(diff.changes).diffChildren(before.roots, after.roots, nullptr);
+    return diff;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "qml_parser.h"
+
+// One difference between two versions of a document. Node pointers refer
+// to the documents that were compared and are valid as long as they are.
+struct QmlChange {
+    enum class Kind : uint8_t {
+        Inserted,         // newNode and its subtree are new
+        Removed,          // oldNode and its subtree are gone
+        PropertyChanged,  // property was added, removed or given a new value
+        Moved,            // oldNode is newNode, now in another order among its siblings
+    };
+
+    Kind kind = Kind::Inserted;
+    const QmlNode *oldNode = nullptr;    // Removed, PropertyChanged, Moved
+    const QmlNode *newNode = nullptr;    // Inserted, PropertyChanged, Moved
+    const QmlNode *newParent = nullptr;  // Inserted, Moved; null for a root
+    QmlAtom property = QmlAtoms::Invalid;
+};
+
+// Structural diff between two documents. Objects are matched by id first,
+// then by type in order of appearance among their siblings; an object
+// whose type changed is reported as removed and re-inserted. When paired
+// siblings change order, the fewest that account for it are reported as
+// Moved: those outside the longest run kept in order. Script blocks
+// and source ranges are not compared. Child lists the two documents share
+// (see QmlCowVector) are skipped, so diffing two snapshots of one document
+// only visits the paths edited between them.
+struct QmlDocumentDiff {
+    std::vector<QmlChange> changes;
+
+    bool empty() const { return changes.empty(); }
+
+    static QmlDocumentDiff compute(const QmlDocument &before, const QmlDocument &after);
+};
@@ -0,0 +1,118 @@
+#include "qml_document_handle.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <utility>
+
+QmlDocumentHandle::QmlDocumentHandle(QmlDocument initial) : current_(new Version{std::move(initial), 1}) {}
+
+QmlDocumentHandle::~QmlDocumentHandle() {
+    for (Version *version : retired_) {
+        delete version;
+    }
+    delete current_.load();
+}
+
+size_t QmlDocumentHandle::claimSlot() const {
+    // Start where this thread's hash points, so concurrent readers rarely
+    // contend for the same slot.
+    const size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % kReaderSlots;
+    for (;;) {
+        for (size_t i = 0; i < kReaderSlots; ++i) {
+            Slot &slot = slots_[(start + i) % kReaderSlots];
+            if (!slot.claimed.load(std::memory_order_relaxed) &&
+                !slot.claimed.exchange(true, std::memory_order_acquire)) {
+                return (start + i) % kReaderSlots;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void QmlDocumentHandle::release(size_t slot) const {
+    slots_[slot].hazard.store(nullptr, std::memory_order_release);
+    slots_[slot].claimed.store(false, std::memory_order_release);
+
+    // The last reader of a replaced version frees it, unless a writer is
+    // busy; that writer, or the next, will.
+    if (retiredCount_.load(std::memory_order_acquire) != 0) {
+        std::unique_lock<std::mutex> lock(writeMutex_, std::try_to_lock);
+        if (lock.owns_lock()) {
+            reclaimLocked();
+        }
+    }
+}
+
+QmlDocumentHandle::ReadGuard QmlDocumentHandle::read() const {
+    const size_t slot = claimSlot();
+    // Announce the version, then check it is still current: a writer that
+    // replaced it before the announcement was visible may already have
+    // looked at this slot and freed it.
+    const Version *version = current_.load(std::memory_order_seq_cst);
+    for (;;) {
+        slots_[slot].hazard.store(version, std::memory_order_seq_cst);
+        const Version *again = current_.load(std::memory_order_seq_cst);
+        if (again == version) {
+            return ReadGuard(this, slot, version);
+        }
+        version = again;
+    }
+}
+
+QmlDocument QmlDocumentHandle::snapshot() const {
+    const ReadGuard guard = read();
+    return *guard;
+}
+
+uint64_t QmlDocumentHandle::version() const {
+    return read().version();
+}
+
+uint64_t QmlDocumentHandle::publish(QmlDocument document) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    Version *next = new Version{std::move(document), current_.load(std::memory_order_relaxed)->number + 1};
+    retired_.push_back(current_.exchange(next, std::memory_order_seq_cst));
+    retiredCount_.store(retired_.size(), std::memory_order_release);
+    reclaimLocked();
+    return next->number;
+}
+
+size_t QmlDocumentHandle::retiredCount() const {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    return retired_.size();
+}
+
+void QmlDocumentHandle::reclaimLocked() const {
+    std::vector<const Version *> held;
+    for (const Slot &slot : slots_) {
+        if (const Version *version = slot.hazard.load(std::memory_order_seq_cst)) {
+            held.push_back(version);
+        }
+    }
+    const auto freed = std::partition(retired_.begin(), retired_.end(), [&held](const Version *version) {
+        return std::find(held.begin(), held.end(), version) != held.end();
+    });
+    for (auto it = freed; it != retired_.end(); ++it) {
+        delete *it;
+    }
+    retired_.erase(freed, retired_.end());
+    retiredCount_.store(retired_.size(), std::memory_order_release);
+}
+
+QmlDocumentHandle::ReadGuard::ReadGuard(ReadGuard &&other) noexcept
+    : handle_(std::exchange(other.handle_, nullptr)), slot_(other.slot_), version_(other.version_) {}
+
+QmlDocumentHandle::ReadGuard::~ReadGuard() {
+    if (handle_) {
+        handle_->release(slot_);
+    }
+}
+
+const QmlDocument &QmlDocumentHandle::ReadGuard::operator*() const {
+    return version_->document;
+}
+
+uint64_t QmlDocumentHandle::ReadGuard::version() const {
+    return version_->number;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "qml_parser.h"
+
+// The current version of a document, read by many threads and replaced by
+// a reload thread: read-copy-update with hazard pointers. Readers never
+// take a lock and never wait for a writer; they announce the version they
+// are reading in a slot of their own, and a replaced version is freed
+// once no slot names it, by the next publish() or by its last reader on
+// the way out.
+//
+//   // render threads
+//   const auto guard = handle.read();
+//   frontend.render(*guard);
+//
+//   // reload thread
+//   handle.publish(parser.parseFile(path));
+//
+// Slots are claimed per read() and there are kReaderSlots of them; a
+// reader that finds every slot busy waits for another reader, never for a
+// writer. publish() calls are serialized among themselves.
+class QmlDocumentHandle {
+    struct Version;
+
+public:
+    static constexpr size_t kReaderSlots = 64;
+
+    explicit QmlDocumentHandle(QmlDocument initial = {});
+    // No reader may still hold a guard.
+    ~QmlDocumentHandle();
+
+    QmlDocumentHandle(const QmlDocumentHandle &) = delete;
+    QmlDocumentHandle &operator=(const QmlDocumentHandle &) = delete;
+
+    // Keeps one version alive while it is held. Hold it for a frame, not
+    // for a session: a guard delays freeing its version, and occupies a
+    // slot. Copy the document for anything longer; copies are O(1).
+    class ReadGuard {
+    public:
+        ReadGuard(ReadGuard &&other) noexcept;
+        ReadGuard &operator=(ReadGuard &&) = delete;
+        ~ReadGuard();
+
+        const QmlDocument &operator*() const;
+        const QmlDocument *operator->() const { return &**this; }
+        uint64_t version() const;
+
+    private:
+        friend class QmlDocumentHandle;
+        ReadGuard(const QmlDocumentHandle *handle, size_t slot, const Version *version)
+            : handle_(handle), slot_(slot), version_(version) {}
+
+        const QmlDocumentHandle *handle_;
+        size_t slot_;
+        const Version *version_;
+    };
+
+    ReadGuard read() const;
+    // An O(1) copy of the current version that outlives any guard.
+    QmlDocument snapshot() const;
+    uint64_t version() const;
+
+    // Makes document the current version and returns its number; the
+    // first version is 1. Frees the replaced versions no reader holds.
+    uint64_t publish(QmlDocument document);
+    // Replaced versions still waiting for their readers.
+    size_t retiredCount() const;
+
+private:
+    struct Version {
+        QmlDocument document;
+        uint64_t number = 0;
+    };
+    struct Slot {
+        std::atomic<bool> claimed{false};
+        std::atomic<const Version *> hazard{nullptr};
+    };
+
+    size_t claimSlot() const;
+    void release(size_t slot) const;
+    // Frees every retired version no slot names. Caller holds writeMutex_.
+    void reclaimLocked() const;
+
+    std::atomic<Version *> current_;
+    mutable std::array<Slot, kReaderSlots> slots_;
+    mutable std::mutex writeMutex_;
+    mutable std::vector<Version *> retired_;  // guarded by writeMutex_
+    mutable std::atomic<size_t> retiredCount_{0};
+};
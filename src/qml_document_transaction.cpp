@@ -0,0 +1,106 @@
+#include "qml_document_transaction.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "qml_change_journal.h"
+
+QmlDocumentTransaction::QmlDocumentTransaction(QmlDocument &document, QmlChangeJournal *journal)
+    : document_(document), before_(document), staged_(document), journal_(journal) {}
+
+void QmlDocumentTransaction::setProperty(const QmlNodePath &path, QmlAtom key, std::string value, QmlValue typed) {
+    stage();
+    stagedNode(path).setProperty(key, std::move(value), typed);
+    ++edits_;
+}
+
+void QmlDocumentTransaction::insert(const QmlNodePath &parent, size_t index, QmlNode node) {
+    stage();
+    const QmlNodeList *children = childrenAt(parent);
+    if (!children || index > children->size()) {
+        throw std::out_of_range("QmlDocumentTransaction: no place at path");
+    }
+    stagedChildren(parent).insert(index, std::move(node));
+    ++edits_;
+}
+
+void QmlDocumentTransaction::remove(const QmlNodePath &path) {
+    stage();
+    if (path.empty() || !childrenAt(path)) {
+        throw std::out_of_range("QmlDocumentTransaction: no node at path");
+    }
+    stagedChildren(QmlNodePath(path.begin(), path.end() - 1)).erase(path.back());
+    ++edits_;
+}
+
+QmlDocumentDiff QmlDocumentTransaction::commit() {
+    if (edits_ == 0) {
+        return {};
+    }
+    staged_.reindex();
+    QmlDocumentDiff diff = QmlDocumentDiff::compute(before_, staged_);
+    if (journal_) {
+        journal_->record(before_, staged_, diff);
+    }
+    // A copy, not a move: the document keeps its memory resource, and the
+    // diff's new nodes are in lists the two now share.
+    document_ = staged_;
+    edits_ = 0;
+    return diff;
+}
+
+void QmlDocumentTransaction::rollback() {
+    staged_ = document_;
+    edits_ = 0;
+}
+
+QmlNodePath QmlDocumentTransaction::pathOf(const QmlDocument &document, const QmlNode &node) {
+    QmlNodePath path;
+    for (const QmlNode *at = &node; at;) {
+        const QmlNode *parent = document.parentOf(*at);
+        const QmlNodeList &siblings = parent ? parent->children : document.roots;
+        const QmlNode *first = siblings.vector().data();
+        if (at < first || at >= first + siblings.size()) {
+            throw std::out_of_range("QmlDocumentTransaction: node is not in the document");
+        }
+        path.push_back(static_cast<size_t>(at - first));
+        at = parent;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+const QmlNodeList *QmlDocumentTransaction::childrenAt(const QmlNodePath &path) const {
+    const QmlNodeList *list = &staged_.roots;
+    for (const size_t index : path) {
+        if (index >= list->size()) {
+            return nullptr;
+        }
+        list = &(*list)[index].children;
+    }
+    return list;
+}
+
+QmlNode &QmlDocumentTransaction::stagedNode(const QmlNodePath &path) {
+    if (path.empty() || !childrenAt(path)) {
+        throw std::out_of_range("QmlDocumentTransaction: no node at path");
+    }
+    return stagedChildren(QmlNodePath(path.begin(), path.end() - 1))[path.back()];
+}
+
+QmlNodeList &QmlDocumentTransaction::stagedChildren(const QmlNodePath &parent) {
+    QmlNodeList *children = &staged_.roots;
+    for (const size_t index : parent) {
+        children = &(*children)[index].children;
+    }
+    return *children;
+}
+
+void QmlDocumentTransaction::stage() {
+    if (edits_ == 0) {
+        before_ = document_;
+        staged_ = document_;
+        staged_.dropIndex();
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "qml_diff.h"
+#include "qml_parser.h"
+
+class QmlChangeJournal;
+
+// A node's position: the index of its root, then of each child on the way
+// down to it.
+using QmlNodePath = std::vector<size_t>;
+
+// Edits to one document staged on a snapshot and applied all at once, so
+// a designer step that moves forty buttons costs one reindex, one diff and
+// one frame rather than forty of each:
+//
+//   QmlDocumentTransaction transaction(document);
+//   for (const QmlNode *button : document.nodesOfType(QmlAtoms::Button)) {
+//       transaction.setProperty(QmlDocumentTransaction::pathOf(document, *button), QmlAtoms::x, "12");
+//   }
+//   frontend.update(document, transaction.commit());
+//
+// The document is left untouched until commit(). An edit whose path does
+// not fit the staged tree throws std::out_of_range and changes nothing, and
+// a transaction destroyed without committing, as when an exception
+// unwinds past it, is rolled back. The document must not be edited by
+// anything else while a transaction on it is open.
+//
+// Paths are resolved against the staged tree as it stands after the edits
+// before them, so an insert or remove shifts the paths of the siblings
+// after it as it would in a vector.
+class QmlDocumentTransaction {
+public:
+    // Each commit() is recorded in journal, if given, which must outlive
+    // the transaction.
+    explicit QmlDocumentTransaction(QmlDocument &document, QmlChangeJournal *journal = nullptr);
+
+    QmlDocumentTransaction(const QmlDocumentTransaction &) = delete;
+    QmlDocumentTransaction &operator=(const QmlDocumentTransaction &) = delete;
+
+    // Assigns a property, adding it if the node has none of that key.
+    void setProperty(const QmlNodePath &path, QmlAtom key, std::string value, QmlValue typed = {});
+    // Inserts node as the index-th child of the node at parent; an empty
+    // parent inserts a root. index may be the child count, to append.
+    void insert(const QmlNodePath &parent, size_t index, QmlNode node);
+    void remove(const QmlNodePath &path);
+
+    // Edits staged since the last commit() or rollback().
+    size_t size() const { return edits_; }
+    bool empty() const { return edits_ == 0; }
+    // The tree as the edits so far leave it. Once edited it is no longer
+    // indexed, so its lookups walk the tree.
+    const QmlDocument &staged() const { return staged_; }
+    // The document as it was before the first of those edits.
+    const QmlDocument &before() const { return before_; }
+
+    // Reindexes the staged tree once, makes it the document and returns
+    // what changed. The diff's old nodes are those of before(), kept until
+    // the next edit. Committing no edits leaves the document as it is,
+    // index and revision included. The transaction can then stage more.
+    QmlDocumentDiff commit();
+    // Drops every staged edit.
+    void rollback();
+
+    // The path of a node of document, as its lookups and walks return it.
+    // Throws std::out_of_range for a node of another document.
+    static QmlNodePath pathOf(const QmlDocument &document, const QmlNode &node);
+
+private:
+    // The children of the node at path in the staged tree, the roots for an
+    // empty path; null if the path does not fit it.
+    const QmlNodeList *childrenAt(const QmlNodePath &path) const;
+    // The same lists unshared for writing. The path must fit, so a failed
+    // edit unshares nothing.
+    QmlNode &stagedNode(const QmlNodePath &path);
+    QmlNodeList &stagedChildren(const QmlNodePath &parent);
+    // Called before each edit; the first one snapshots the document.
+    void stage();
+
+    QmlDocument &document_;
+    QmlDocument before_;
+    QmlDocument staged_;
+    QmlChangeJournal *journal_;
+    size_t edits_ = 0;
+};
@@ -0,0 +1,320 @@
+#include "qml_executor.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace {
+
+// The executor and worker the calling thread belongs to, if any.
+thread_local const QmlExecutor *currentExecutor = nullptr;
+thread_local size_t currentWorker = 0;
+
+std::mutex sharedMutex;
+QmlExecutor::Options sharedOptions;
+bool sharedStarted = false;
+
+uint64_t pack(uint32_t begin, uint32_t end) {
+    return (uint64_t(begin) << 32) | end;
+}
+
+uint32_t beginOf(uint64_t bounds) {
+    return static_cast<uint32_t>(bounds >> 32);
+}
+
+uint32_t endOf(uint64_t bounds) {
+    return static_cast<uint32_t>(bounds);
+}
+
+// Pins the calling thread to cpu; a no-op where the OS has no thread
+// affinity, as on macOS.
+void pinToCpu(int cpu) {
+#if defined(__linux__)
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        pthread_setaffinity_np(pthread_self(), sizeof one, &one);
+    }
+#elif defined(_WIN32)
+    if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+    }
+#else
+    (void)cpu;
+#endif
+}
+
+}  // namespace
+
+// One parallelFor() call. Each thread works through its own range and
+// then steals; helpers queued behind other work may start after the range
+// is done, so the job is shared with them and outlives the call.
+class QmlExecutor::Job {
+public:
+    Job(size_t count, size_t parts, QmlFunctionRef<void(size_t)> task, std::atomic<size_t> &steals)
+        : ranges_(std::make_unique<Range[]>(parts)), parts_(parts), task_(task), remaining_(count), steals_(steals) {
+        for (size_t part = 0; part < parts; ++part) {
+            ranges_[part].bounds.store(pack(static_cast<uint32_t>(count * part / parts),
+                                            static_cast<uint32_t>(count * (part + 1) / parts)),
+                                       std::memory_order_relaxed);
+        }
+    }
+
+    void work(size_t self) {
+        size_t index = 0;
+        do {
+            while (next(self, index)) {
+                task_(index);
+                if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    done_.notify_all();
+                }
+            }
+        } while (steal(self));
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return remaining_.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    // [begin, end) packed as begin << 32 | end, aligned to keep the ranges
+    // on separate cache lines.
+    struct alignas(64) Range {
+        std::atomic<uint64_t> bounds{0};
+    };
+
+    // Takes the first index of the thread's own range.
+    bool next(size_t self, size_t &index) {
+        std::atomic<uint64_t> &bounds = ranges_[self].bounds;
+        uint64_t current = bounds.load(std::memory_order_acquire);
+        while (beginOf(current) < endOf(current)) {
+            if (bounds.compare_exchange_weak(current, pack(beginOf(current) + 1, endOf(current)),
+                                             std::memory_order_acq_rel, std::memory_order_acquire)) {
+                index = beginOf(current);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves the upper half of another thread's range, or its last index,
+    // into this thread's empty one.
+    bool steal(size_t self) {
+        for (size_t offset = 1; offset < parts_; ++offset) {
+            std::atomic<uint64_t> &bounds = ranges_[(self + offset) % parts_].bounds;
+            uint64_t current = bounds.load(std::memory_order_acquire);
+            while (beginOf(current) < endOf(current)) {
+                const uint32_t begin = beginOf(current);
+                const uint32_t middle = begin + (endOf(current) - begin) / 2;
+                if (bounds.compare_exchange_weak(current, pack(begin, middle), std::memory_order_acq_rel,
+                                                 std::memory_order_acquire)) {
+                    ranges_[self].bounds.store(pack(middle, endOf(current)), std::memory_order_release);
+                    steals_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    std::unique_ptr<Range[]> ranges_;  // one per helper, then the caller's
+    size_t parts_;
+    QmlFunctionRef<void(size_t)> task_;
+    std::atomic<size_t> remaining_;
+    std::atomic<size_t> &steals_;
+    std::mutex mutex_;
+    std::condition_variable done_;
+};
+
+QmlExecutor::QmlExecutor(Options options) {
+    size_t threads = options.threads;
+    if (threads == 0) {
+        threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    // Started once every worker exists, as they steal from each other.
+    for (size_t i = 0; i < threads; ++i) {
+        const int cpu = options.cpus.empty() ? -1 : options.cpus[i % options.cpus.size()];
+        workers_[i]->thread = std::thread([this, i, cpu] {
+            if (cpu >= 0) {
+                pinToCpu(cpu);
+            }
+            workerLoop(i);
+        });
+    }
+}
+
+QmlExecutor::~QmlExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (const auto &worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+QmlExecutor &QmlExecutor::shared() {
+    static QmlExecutor executor([] {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedStarted = true;
+        return sharedOptions;
+    }());
+    return executor;
+}
+
+bool QmlExecutor::configure(Options options) {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (sharedStarted) {
+        return false;
+    }
+    sharedOptions = std::move(options);
+    return true;
+}
+
+bool QmlExecutor::parseCpuList(std::string_view list, std::vector<int> &cpus) {
+    std::vector<int> parsed;
+    const auto number = [&list](size_t &pos, int &value) {
+        const size_t start = pos;
+        value = 0;
+        while (pos < list.size() && list[pos] >= '0' && list[pos] <= '9' && value < 100000) {
+            value = value * 10 + (list[pos++] - '0');
+        }
+        return pos > start;
+    };
+    size_t pos = 0;
+    while (pos < list.size()) {
+        int first = 0;
+        if (!number(pos, first)) {
+            return false;
+        }
+        int last = first;
+        if (pos < list.size() && list[pos] == '-' && (!number(++pos, last) || last < first)) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            parsed.push_back(cpu);
+        }
+        if (pos < list.size() && (list[pos] != ',' || ++pos == list.size())) {
+            return false;
+        }
+    }
+    if (parsed.empty()) {
+        return false;
+    }
+    cpus = std::move(parsed);
+    return true;
+}
+
+void QmlExecutor::post(const char *name, Priority priority, std::function<void()> task) {
+    const size_t target = currentExecutor == this ? currentWorker
+                                                  : nextWorker_.fetch_add(1, std::memory_order_relaxed) %
+                                                        workers_.size();
+    queued_.fetch_add(1, std::memory_order_release);
+    {
+        Worker &worker = *workers_[target];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[static_cast<size_t>(priority)].push_back(
+            Task{std::move(task), name, priority, std::chrono::steady_clock::now()});
+    }
+    // Taking the lock orders this with a worker checking queued_ before it
+    // sleeps, so the wake-up is not lost.
+    { std::lock_guard<std::mutex> lock(sleepMutex_); }
+    wake_.notify_one();
+}
+
+void QmlExecutor::parallelFor(const char *name, size_t count, QmlFunctionRef<void(size_t index)> task,
+                              size_t maxThreads, Priority priority) {
+    // Ranges hold 32-bit indices, so larger counts run in slices.
+    constexpr size_t kSlice = UINT32_MAX;
+    if (count > kSlice) {
+        for (size_t offset = 0; offset < count; offset += kSlice) {
+            const auto slice = [&task, offset](size_t index) { task(offset + index); };
+            parallelFor(name, std::min(kSlice, count - offset), slice, maxThreads, priority);
+        }
+        return;
+    }
+    size_t parts = std::min(count, workers_.size() + 1);
+    if (maxThreads > 0) {
+        parts = std::min(parts, maxThreads);
+    }
+    if (parts <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    const auto job = std::make_shared<Job>(count, parts, task, steals_);
+    for (size_t helper = 0; helper + 1 < parts; ++helper) {
+        post(name, priority, [job, helper] { job->work(helper); });
+    }
+    job->work(parts - 1);
+    job->wait();
+}
+
+bool QmlExecutor::take(size_t self, Task &task, bool &stolen) {
+    for (size_t priority = 0; priority < kPriorities; ++priority) {
+        for (size_t offset = 0; offset < workers_.size(); ++offset) {
+            Worker &worker = *workers_[(self + offset) % workers_.size()];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            std::deque<Task> &queue = worker.queues[priority];
+            if (queue.empty()) {
+                continue;
+            }
+            // Its owner works from the front, thieves from the back.
+            stolen = offset != 0;
+            if (stolen) {
+                task = std::move(queue.back());
+                queue.pop_back();
+                steals_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void QmlExecutor::workerLoop(size_t self) {
+    currentExecutor = this;
+    currentWorker = self;
+    for (;;) {
+        Task task;
+        bool stolen = false;
+        if (take(self, task, stolen)) {
+            const auto begin = std::chrono::steady_clock::now();
+            task.run();
+            if (hook_) {
+                hook_(TaskEvent{task.name, task.priority, self, stolen, task.queued, begin,
+                                std::chrono::steady_clock::now()});
+            }
+            continue;
+        }
+        // queued_ counts a task before it is queued, so a worker may find
+        // none yet and come round again.
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_.load(std::memory_order_acquire) > 0; });
+        if (stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "qml_function_ref.h"
+
+// The process's worker threads, shared by everything that runs work in
+// parallel: the batch and chunked parsers, binding resolution, watch-mode
+// reparses, batch rendering and the Greeter's batch and async calls. One
+// set of threads sized to the machine replaces a pool per feature, which
+// together would run several threads per core and switch between them.
+//
+// Each worker has a queue per priority. post() from a worker queues on its
+// own, from any other thread on the next worker's in turn. An idle worker
+// takes the oldest task of the highest priority from its own queue, or
+// else steals the newest from another's, so a High task anywhere runs
+// before a Normal one, and a worker with a backlog does not hold up the
+// others. parallelFor() splits an index range between the workers and the
+// calling thread in equal shares; a thread whose share runs out takes half
+// of another's, with a compare-and-swap rather than a lock.
+//
+//   QmlExecutor::configure({4, {0, 1, 2, 3}});     // before first use
+//   QmlExecutor::shared().post("reload", QmlExecutor::Priority::Normal, [] { ... });
+//   QmlExecutor::shared().parallelFor("resolve", count, [&](size_t i) { ... });
+//
+// A task that blocks holds its worker; parallelFor() may be called from a
+// task, since its caller works through the range itself. Thread-safe.
+class QmlExecutor {
+public:
+    // Frame work, such as a frame's bindings; batch jobs and replies; and
+    // work nobody waits for.
+    enum class Priority : uint8_t { High, Normal, Background };
+    static constexpr size_t kPriorities = 3;
+
+    struct Options {
+        // Worker threads; 0 for one fewer than the hardware threads, as
+        // the thread calling parallelFor() works too, and at least one.
+        size_t threads = 0;
+        // Worker i runs only on CPU cpus[i % cpus.size()], on Linux and
+        // Windows; empty leaves placement to the OS.
+        std::vector<int> cpus;
+    };
+
+    // What a task cost, for tracing: when it was queued, started and
+    // finished, and on which worker.
+    struct TaskEvent {
+        const char *name;
+        Priority priority;
+        size_t worker;
+        bool stolen;  // taken from another worker's queue
+        std::chrono::steady_clock::time_point queued;
+        std::chrono::steady_clock::time_point begin;
+        std::chrono::steady_clock::time_point end;
+    };
+    // Called on the worker after each task.
+    using TaskHook = std::function<void(const TaskEvent &event)>;
+
+    QmlExecutor() : QmlExecutor(Options()) {}
+    explicit QmlExecutor(Options options);
+    // Runs the tasks still queued, then stops the workers.
+    ~QmlExecutor();
+    QmlExecutor(const QmlExecutor &) = delete;
+    QmlExecutor &operator=(const QmlExecutor &) = delete;
+
+    // The process's executor, started on first use with the options given
+    // to configure().
+    static QmlExecutor &shared();
+    // Sets shared()'s options; false, changing nothing, once it has started.
+    static bool configure(Options options);
+    // Reads a CPU list such as "0-3,6" into cpus; false if it is malformed.
+    static bool parseCpuList(std::string_view list, std::vector<int> &cpus);
+
+    size_t workerCount() const { return workers_.size(); }
+
+    // Set before tasks are posted, as workers read it without locking.
+    void setTaskHook(TaskHook hook) { hook_ = std::move(hook); }
+
+    // Runs task on a worker. name, which the task hook sees, must outlive
+    // the executor (a literal).
+    void post(const char *name, Priority priority, std::function<void()> task);
+    // post() with a future for the task's result, or its exception.
+    template <typename Work>
+    std::future<std::invoke_result_t<Work>> submit(const char *name, Priority priority, Work work) {
+        auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<Work>()>>(std::move(work));
+        auto future = packaged->get_future();
+        post(name, priority, [packaged] { (*packaged)(); });
+        return future;
+    }
+
+    // Calls task(i) once for each i in [0, count), on up to maxThreads
+    // threads (0 for all the workers), the calling one included, and
+    // returns when all calls are done.
+    void parallelFor(const char *name, size_t count, QmlFunctionRef<void(size_t index)> task, size_t maxThreads = 0,
+                     Priority priority = Priority::High);
+
+    // Tasks and parallelFor() ranges taken from other threads so far.
+    size_t stealCount() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Task {
+        std::function<void()> run;
+        const char *name = nullptr;
+        Priority priority = Priority::Normal;
+        std::chrono::steady_clock::time_point queued;
+    };
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> queues[kPriorities];
+        std::thread thread;
+    };
+    class Job;
+
+    bool take(size_t self, Task &task, bool &stolen);
+    void workerLoop(size_t self);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    TaskHook hook_;
+    std::atomic<size_t> queued_{0};  // counted before they are queued
+    std::atomic<size_t> nextWorker_{0};
+    std::atomic<size_t> steals_{0};
+
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
@@ -0,0 +1,505 @@
+#include "qml_export.h"
+
+#include <algorithm>
+#include <cmath>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define QML_EXPORT_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QML_EXPORT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define QML_EXPORT_NEON 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr char kHex[] = "0123456789abcdef";
+
+// Keys and fixed values, encoded up front in both formats: "type": and
+// fixstr "type". A hex digit after \x would continue the escape, hence the
+// split literals.
+struct Key {
+    std::string_view json;
+    std::string_view messagePack;
+};
+
+constexpr Key kRoots{"\"roots\":", "\xa5roots"};
+constexpr Key kType{"\"type\":", "\xa4type"};
+constexpr Key kId{",\"id\":", "\xa2id"};
+constexpr Key kBinding{",\"binding\":", "\xa7" "binding"};
+constexpr Key kSourceRange{",\"sourceRange\":", "\xabsourceRange"};
+constexpr Key kProperties{",\"properties\":", "\xaaproperties"};
+constexpr Key kScripts{",\"scripts\":", "\xa7scripts"};
+constexpr Key kChildren{",\"children\":", "\xa8" "children"};
+constexpr Key kName{"\"name\":", "\xa4name"};
+constexpr Key kKind{",\"kind\":", "\xa4kind"};
+constexpr Key kValue{",\"value\":", "\xa5value"};
+constexpr Key kScriptKind{"\"kind\":", "\xa4kind"};
+constexpr Key kScriptName{",\"name\":", "\xa4name"};
+constexpr Key kParameters{",\"parameters\":", "\xaaparameters"};
+constexpr Key kBody{",\"body\":", "\xa4" "body"};
+constexpr Key kHandler{"\"handler\"", "\xa7handler"};
+constexpr Key kFunction{"\"function\"", "\xa8" "function"};
+// By QmlValueKind.
+constexpr Key kKinds[] = {
+    {"\"string\"", "\xa6string"}, {"\"int\"", "\xa3int"},   {"\"real\"", "\xa4real"},
+    {"\"bool\"", "\xa4" "bool"},  {"\"enum\"", "\xa4" "enum"}, {"\"binding\"", "\xa7" "binding"},
+};
+
+bool needsEscape(char ch) {
+    return ch == '"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20;
+}
+
+#if defined(QML_EXPORT_AVX2) || defined(QML_EXPORT_SSE2)
+int countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Length of the prefix of text that JSON takes as it is: no quote,
+// backslash or control character.
+size_t cleanPrefix(const char *text, size_t size) {
+    size_t i = 0;
+#if defined(QML_EXPORT_AVX2)
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1f);
+    for (; i + 32 <= size; i += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text + i));
+        const __m256i special =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, quote), _mm256_cmpeq_epi8(bytes, backslash)),
+                            _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, control), bytes));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(special));
+        if (mask != 0) {
+            return i + static_cast<size_t>(countTrailingZeros(mask));
+        }
+    }
+#elif defined(QML_EXPORT_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    for (; i + 16 <= size; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+        // min(byte, 0x1f) == byte for control characters alone, unsigned.
+        const __m128i special =
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash)),
+                         _mm_cmpeq_epi8(_mm_min_epu8(bytes, control), bytes));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+        if (mask != 0) {
+            return i + static_cast<size_t>(countTrailingZeros(mask));
+        }
+    }
+#elif defined(QML_EXPORT_NEON)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    for (; i + 16 <= size; i += 16) {
+        const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(text + i));
+        const uint8x16_t special =
+            vorrq_u8(vorrq_u8(vceqq_u8(bytes, quote), vceqq_u8(bytes, backslash)), vcltq_u8(bytes, space));
+        if (vmaxvq_u8(special) != 0) {
+            break;  // the scalar loop finds which byte
+        }
+    }
+#endif
+    while (i < size && !needsEscape(text[i])) {
+        ++i;
+    }
+    return i;
+}
+
+bool hasBody(const QmlScriptBlock &script, std::string_view source) {
+    return !source.empty() && script.bodyBegin <= script.bodyEnd && script.bodyEnd <= source.size();
+}
+
+}  // namespace
+
+QmlExporter::QmlExporter(QmlWriteSink sink, const Options &options) : sink_(sink), options_(options) {
+    options_.chunkSize = std::max<size_t>(options_.chunkSize, 16);
+    buffer_.reserve(options_.chunkSize);
+}
+
+QmlExporter::~QmlExporter() {
+    flush();
+}
+
+const char *QmlExporter::kernelName() {
+#if defined(QML_EXPORT_AVX2)
+    return "avx2";
+#elif defined(QML_EXPORT_SSE2)
+    return "sse2";
+#elif defined(QML_EXPORT_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void QmlExporter::write(const QmlDocument &document, std::string_view source) {
+    beginMap(1);
+    appendKey(kRoots);
+    beginArray(document.roots.size());
+    for (size_t i = 0; i < document.roots.size(); ++i) {
+        if (i > 0) {
+            comma();
+        }
+        writeTree(document.roots[i], source);
+    }
+    endArray();
+    endMap();
+}
+
+void QmlExporter::write(const QmlNode &node, std::string_view source) {
+    writeTree(node, source);
+}
+
+void QmlExporter::flush() {
+    if (!buffer_.empty()) {
+        sink_(buffer_);
+        buffer_.clear();
+    }
+}
+
+std::string QmlExporter::toString(const QmlDocument &document, std::string_view source, Format format) {
+    std::string text;
+    const auto sink = [&text](std::string_view chunk) { text.append(chunk); };
+    QmlExporter(sink, Options{format}).write(document, source);
+    return text;
+}
+
+std::string QmlExporter::toString(const QmlNode &node, std::string_view source, Format format) {
+    std::string text;
+    const auto sink = [&text](std::string_view chunk) { text.append(chunk); };
+    QmlExporter(sink, Options{format}).write(node, source);
+    return text;
+}
+
+void QmlExporter::writeTree(const QmlNode &node, std::string_view source) {
+    hasChild_.clear();
+    open(node, source);
+    node.walkDescendants(
+        [&](const QmlNode &descendant) {
+            open(descendant, source);
+            return QmlVisit::Continue;
+        },
+        [&](const QmlNode &) { close(); });
+    close();
+}
+
+// Everything up to the children, which the walk writes before close().
+// JSON's commas between a node's fields come with the keys.
+void QmlExporter::open(const QmlNode &node, std::string_view source) {
+    if (!hasChild_.empty()) {
+        if (hasChild_.back()) {
+            comma();
+        }
+        hasChild_.back() = true;
+    }
+    beginMap(node.binding == QmlAtoms::Invalid ? 6 : 7);
+    appendKey(kType);
+    appendString(node.type);
+    appendKey(kId);
+    appendString(node.id);
+    if (node.binding != QmlAtoms::Invalid) {
+        appendKey(kBinding);
+        appendString(atomName(node.binding));
+    }
+    appendKey(kSourceRange);
+    beginArray(2);
+    appendUnsigned(node.sourceBegin);
+    comma();
+    appendUnsigned(node.sourceEnd);
+    endArray();
+
+    appendKey(kProperties);
+    beginArray(node.properties.size());
+    for (size_t i = 0; i < node.properties.size(); ++i) {
+        const QmlProperty &property = node.properties[i];
+        if (i > 0) {
+            comma();
+        }
+        beginMap(3);
+        appendKey(kName);
+        appendString(atomName(property.key));
+        appendKey(kKind);
+        appendKey(kKinds[static_cast<size_t>(property.typed.kind)]);
+        appendKey(kValue);
+        switch (property.typed.kind) {
+        case QmlValueKind::Int:
+            appendInt(property.typed.intValue);
+            break;
+        case QmlValueKind::Real:
+            appendReal(property.typed.realValue);
+            break;
+        case QmlValueKind::Bool:
+            appendBool(property.typed.intValue != 0);
+            break;
+        default:
+            appendString(property.value);
+            break;
+        }
+        endMap();
+    }
+    endArray();
+
+    appendKey(kScripts);
+    beginArray(node.scripts.size());
+    for (size_t i = 0; i < node.scripts.size(); ++i) {
+        const QmlScriptBlock &script = node.scripts[i];
+        const bool function = script.kind == QmlScriptKind::Function;
+        const bool body = hasBody(script, source);
+        if (i > 0) {
+            comma();
+        }
+        beginMap(2 + (function ? 1 : 0) + (body ? 1 : 0));
+        appendKey(kScriptKind);
+        appendKey(function ? kFunction : kHandler);
+        appendKey(kScriptName);
+        appendString(atomName(script.name));
+        if (function) {
+            appendKey(kParameters);
+            appendString(script.parameters);
+        }
+        if (body) {
+            appendKey(kBody);
+            appendString(script.body(source));
+        }
+        endMap();
+    }
+    endArray();
+
+    appendKey(kChildren);
+    beginArray(node.children.size());
+    hasChild_.push_back(false);
+}
+
+void QmlExporter::close() {
+    hasChild_.pop_back();
+    endArray();
+    endMap();
+}
+
+std::string_view QmlExporter::atomName(QmlAtom atom) {
+    if (atom >= names_.size()) {
+        names_.resize(atom + 1);
+    }
+    std::string_view &name = names_[atom];
+    if (name.data() == nullptr) {
+        name = QmlAtomTable::global().name(atom);
+    }
+    return name;
+}
+
+void QmlExporter::appendSlow(std::string_view bytes) {
+    flush();
+    if (bytes.size() >= options_.chunkSize) {
+        sink_(bytes);
+    } else {
+        buffer_.append(bytes);
+    }
+}
+
+void QmlExporter::appendString(std::string_view text) {
+    if (options_.format == Format::MessagePack) {
+        const size_t size = text.size();
+        if (size < 32) {
+            appendByte(static_cast<uint8_t>(0xa0 | size));
+        } else if (size <= 0xff) {
+            appendByte(0xd9);
+            appendBigEndian(size, 1);
+        } else if (size <= 0xffff) {
+            appendByte(0xda);
+            appendBigEndian(size, 2);
+        } else {
+            appendByte(0xdb);
+            appendBigEndian(size, 4);
+        }
+        append(text);
+        return;
+    }
+    appendByte('"');
+    while (!text.empty()) {
+        const size_t clean = cleanPrefix(text.data(), text.size());
+        append(text.substr(0, clean));
+        if (clean == text.size()) {
+            break;
+        }
+        const unsigned char ch = static_cast<unsigned char>(text[clean]);
+        char escape[6] = {'\\', static_cast<char>(ch), 0, 0, 0, 0};
+        size_t length = 2;
+        switch (ch) {
+        case '"':
+        case '\\':
+            break;
+        case '\n':
+            escape[1] = 'n';
+            break;
+        case '\r':
+            escape[1] = 'r';
+            break;
+        case '\t':
+            escape[1] = 't';
+            break;
+        case '\b':
+            escape[1] = 'b';
+            break;
+        case '\f':
+            escape[1] = 'f';
+            break;
+        default:
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = kHex[ch >> 4];
+            escape[5] = kHex[ch & 0xf];
+            length = 6;
+            break;
+        }
+        append(std::string_view(escape, length));
+        text.remove_prefix(clean + 1);
+    }
+    appendByte('"');
+}
+
+void QmlExporter::appendInt(int64_t value) {
+    if (value >= 0) {
+        appendUnsigned(static_cast<uint64_t>(value));
+        return;
+    }
+    if (options_.format == Format::Json) {
+        char number[24];
+        const char *end = std::to_chars(number, number + sizeof number, value).ptr;
+        append(std::string_view(number, static_cast<size_t>(end - number)));
+    } else if (value >= -32) {
+        appendByte(static_cast<uint8_t>(value));  // negative fixint
+    } else if (value >= INT8_MIN) {
+        appendByte(0xd0);
+        appendBigEndian(static_cast<uint64_t>(value), 1);
+    } else if (value >= INT16_MIN) {
+        appendByte(0xd1);
+        appendBigEndian(static_cast<uint64_t>(value), 2);
+    } else if (value >= INT32_MIN) {
+        appendByte(0xd2);
+        appendBigEndian(static_cast<uint64_t>(value), 4);
+    } else {
+        appendByte(0xd3);
+        appendBigEndian(static_cast<uint64_t>(value), 8);
+    }
+}
+
+void QmlExporter::appendUnsigned(uint64_t value) {
+    if (options_.format == Format::Json) {
+        char number[24];
+        const char *end = std::to_chars(number, number + sizeof number, value).ptr;
+        append(std::string_view(number, static_cast<size_t>(end - number)));
+    } else if (value < 0x80) {
+        appendByte(static_cast<uint8_t>(value));  // positive fixint
+    } else if (value <= 0xff) {
+        appendByte(0xcc);
+        appendBigEndian(value, 1);
+    } else if (value <= 0xffff) {
+        appendByte(0xcd);
+        appendBigEndian(value, 2);
+    } else if (value <= 0xffffffffu) {
+        appendByte(0xce);
+        appendBigEndian(value, 4);
+    } else {
+        appendByte(0xcf);
+        appendBigEndian(value, 8);
+    }
+}
+
+void QmlExporter::appendReal(double value) {
+    if (options_.format == Format::MessagePack) {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof bits);
+        appendByte(0xcb);
+        appendBigEndian(bits, 8);
+        return;
+    }
+    if (!std::isfinite(value)) {
+        append("null");  // JSON has no infinities
+        return;
+    }
+    char number[32];
+    const int length = std::snprintf(number, sizeof number, "%.17g", value);
+    append(std::string_view(number, static_cast<size_t>(length)));
+}
+
+void QmlExporter::appendBool(bool value) {
+    if (options_.format == Format::MessagePack) {
+        appendByte(value ? 0xc3 : 0xc2);
+    } else {
+        append(value ? "true" : "false");
+    }
+}
+
+void QmlExporter::beginArray(size_t size) {
+    if (options_.format == Format::Json) {
+        appendByte('[');
+    } else if (size < 16) {
+        appendByte(static_cast<uint8_t>(0x90 | size));
+    } else if (size <= 0xffff) {
+        appendByte(0xdc);
+        appendBigEndian(size, 2);
+    } else {
+        appendByte(0xdd);
+        appendBigEndian(size, 4);
+    }
+}
+
+void QmlExporter::beginMap(size_t size) {
+    if (options_.format == Format::Json) {
+        appendByte('{');
+    } else if (size < 16) {
+        appendByte(static_cast<uint8_t>(0x80 | size));
+    } else if (size <= 0xffff) {
+        appendByte(0xde);
+        appendBigEndian(size, 2);
+    } else {
+        appendByte(0xdf);
+        appendBigEndian(size, 4);
+    }
+}
+
+void QmlExporter::comma() {
+    if (options_.format == Format::Json) {
+        appendByte(',');
+    }
+}
+
+void QmlExporter::endArray() {
+    if (options_.format == Format::Json) {
+        appendByte(']');
+    }
+}
+
+void QmlExporter::endMap() {
+    if (options_.format == Format::Json) {
+        appendByte('}');
+    }
+}
+
+void QmlExporter::appendBigEndian(uint64_t value, size_t bytes) {
+    char encoded[8];
+    for (size_t i = 0; i < bytes; ++i) {
+        encoded[i] = static_cast<char>(value >> (8 * (bytes - 1 - i)));
+    }
+    append(std::string_view(encoded, bytes));
+}
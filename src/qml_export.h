@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qml_parser.h"
+#include "qml_writer.h"
+
+// Streams documents and subtrees as JSON or MessagePack, for analysis
+// tools that want the parsed tree without linking the parser. The tree is
+// walked once and encoded straight into one buffer of chunkSize bytes,
+// handed to the sink whenever it fills, as QmlWriter does; no DOM is
+// built, and nesting depth is bounded by memory rather than by the call
+// stack. JSON strings are scanned for bytes that need escaping 16 or 32 at
+// a time (SSE2/AVX2, NEON, else scalar), and clean runs are copied whole.
+//
+// Both formats carry the same tree. A document is {"roots": [node...]};
+// each node is
+//
+//   {"type": "Text", "id": "label", "sourceRange": [begin, end],
+//    "properties": [{"name": "width", "kind": "int", "value": 640}, ...],
+//    "scripts": [{"kind": "handler", "name": "onClicked", "body": "{ ... }"}, ...],
+//    "children": [node...]}
+//
+// with keys always in that order. An object that is a property's value, as
+// in "background: Rectangle {", also has "binding": "background" after
+// "id". A property's kind is string, int, real, bool, enum or binding;
+// ints, reals and bools are numbers and booleans, the rest their unquoted
+// text. Functions' scripts also have "parameters".
+// "body" is there only when the source the document was parsed from is
+// passed. Strings are written as the document holds them, which for
+// parsed text is UTF-8.
+//
+//   std::ofstream out(path, std::ios::binary);
+//   const auto sink = [&out](std::string_view chunk) { out.write(chunk.data(), chunk.size()); };
+//   QmlExporter exporter(sink, {QmlExporter::Format::MessagePack});
+//   exporter.write(document, source);
+class QmlExporter {
+public:
+    enum class Format : uint8_t { Json, MessagePack };
+
+    struct Options {
+        Format format = Format::Json;
+        size_t chunkSize = 64 * 1024;
+    };
+
+    // The sink is not copied and must outlive the exporter.
+    explicit QmlExporter(QmlWriteSink sink) : QmlExporter(sink, Options()) {}
+    QmlExporter(QmlWriteSink sink, const Options &options);
+    // Flushes what is still buffered.
+    ~QmlExporter();
+
+    QmlExporter(const QmlExporter &) = delete;
+    QmlExporter &operator=(const QmlExporter &) = delete;
+
+    // One value per call: write a document, or a node, to each sink once.
+    void write(const QmlDocument &document, std::string_view source = {});
+    void write(const QmlNode &node, std::string_view source = {});
+    // Hands whatever is buffered to the sink.
+    void flush();
+
+    // Bytes written so far, buffered ones included.
+    uint64_t bytesWritten() const { return bytesWritten_; }
+
+    static std::string toString(const QmlDocument &document, std::string_view source = {},
+                                Format format = Format::Json);
+    static std::string toString(const QmlNode &node, std::string_view source = {}, Format format = Format::Json);
+
+    // Name of the JSON escaping kernel compiled into this build.
+    static const char *kernelName();
+
+private:
+    void writeTree(const QmlNode &node, std::string_view source);
+    void open(const QmlNode &node, std::string_view source);
+    void close();
+    // The atom table's names, kept here so that names outside the
+    // predefined set are looked up under its lock once per exporter.
+    std::string_view atomName(QmlAtom atom);
+
+    void append(std::string_view bytes) {
+        bytesWritten_ += bytes.size();
+        if (buffer_.size() + bytes.size() > options_.chunkSize) {
+            appendSlow(bytes);
+        } else {
+            buffer_.append(bytes);
+        }
+    }
+    void appendByte(uint8_t byte) {
+        ++bytesWritten_;
+        if (buffer_.size() == options_.chunkSize) {
+            flush();
+        }
+        buffer_.push_back(static_cast<char>(byte));
+    }
+    // Flushes first; bytes of a chunk or more go to the sink directly.
+    void appendSlow(std::string_view bytes);
+    void appendString(std::string_view text);
+    // A key and, in JSON, the separators around it, encoded beforehand.
+    template <typename Key>
+    void appendKey(const Key &key) {
+        append(options_.format == Format::Json ? key.json : key.messagePack);
+    }
+    void appendInt(int64_t value);
+    void appendUnsigned(uint64_t value);
+    void appendReal(double value);
+    void appendBool(bool value);
+    // MessagePack headers; in JSON, the opening bracket.
+    void beginArray(size_t size);
+    void beginMap(size_t size);
+    // JSON's separators; nothing in MessagePack.
+    void comma();
+    void endArray();
+    void endMap();
+    // Big-endian, as MessagePack stores its lengths and numbers.
+    void appendBigEndian(uint64_t value, size_t bytes);
+
+    QmlWriteSink sink_;
+    Options options_;
+    std::string buffer_;
+    uint64_t bytesWritten_ = 0;
+    // Per open node: whether a child has been written, for JSON's commas.
+    std::vector<bool> hasChild_;
+    std::vector<std::string_view> names_;  // by atom; null until looked up
+};
@@ -0,0 +1,281 @@
+#include "qml_expression.h"
+
+namespace {
+
+constexpr unsigned kMaxRegisters = 255;
+
+bool isNameStart(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch == '$';
+}
+
+bool isNameChar(char ch) {
+    return isNameStart(ch) || (ch >= '0' && ch <= '9');
+}
+
+bool isDigit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+// Recursive descent straight to bytecode. Each subexpression is compiled
+// into a target register and may use the registers above it as scratch.
+class Compiler {
+public:
+    Compiler(std::string_view source, std::vector<QmlInstruction> &code, std::vector<std::string> &constants)
+        : source_(source), code_(code), constants_(constants) {}
+
+    bool run(uint8_t &registers) {
+        if (!expression(0)) {
+            return false;
+        }
+        skipSpace();
+        registers = static_cast<uint8_t>(maxRegister_ + 1);
+        return pos_ == source_.size();
+    }
+
+private:
+    std::string_view source_;
+    size_t pos_ = 0;
+    std::vector<QmlInstruction> &code_;
+    std::vector<std::string> &constants_;
+    QmlAtomCache atoms_;
+    unsigned maxRegister_ = 0;
+
+    void skipSpace() {
+        while (pos_ < source_.size() && (source_[pos_] == ' ' || source_[pos_] == '\t' || source_[pos_] == '\n' ||
+                                         source_[pos_] == '\r')) {
+            ++pos_;
+        }
+    }
+
+    bool accept(char ch) {
+        skipSpace();
+        if (pos_ < source_.size() && source_[pos_] == ch) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool use(unsigned reg) {
+        if (reg >= kMaxRegisters) {
+            return false;
+        }
+        maxRegister_ = reg > maxRegister_ ? reg : maxRegister_;
+        return true;
+    }
+
+    void emit(QmlOpcode op, unsigned a, unsigned b, unsigned count, uint32_t operand) {
+        code_.push_back(QmlInstruction{op, static_cast<uint8_t>(a), static_cast<uint8_t>(b),
+                                       static_cast<uint8_t>(count), operand});
+    }
+
+    bool name(QmlAtom &atom) {
+        skipSpace();
+        if (pos_ >= source_.size() || !isNameStart(source_[pos_])) {
+            return false;
+        }
+        const size_t begin = pos_;
+        while (pos_ < source_.size() && isNameChar(source_[pos_])) {
+            ++pos_;
+        }
+        atom = atoms_.intern(source_.substr(begin, pos_ - begin));
+        return true;
+    }
+
+    void loadConstant(unsigned reg, std::string text) {
+        emit(QmlOpcode::LoadString, reg, 0, 0, static_cast<uint32_t>(constants_.size()));
+        constants_.push_back(std::move(text));
+    }
+
+    bool expression(unsigned reg) {
+        if (!postfix(reg)) {
+            return false;
+        }
+        while (accept('+')) {
+            if (!use(reg + 1) || !postfix(reg + 1)) {
+                return false;
+            }
+            emit(QmlOpcode::Concat, reg, reg + 1, 0, 0);
+        }
+        return true;
+    }
+
+    bool postfix(unsigned reg) {
+        if (!primary(reg)) {
+            return false;
+        }
+        while (accept('.')) {
+            QmlAtom member = QmlAtoms::Invalid;
+            if (!name(member)) {
+                return false;
+            }
+            if (!accept('(')) {
+                emit(QmlOpcode::GetMember, reg, reg, 0, member);
+                continue;
+            }
+            // The object stays in reg; arguments go in the registers above.
+            unsigned count = 0;
+            if (!accept(')')) {
+                do {
+                    ++count;
+                    if (count > kMaxRegisters || !use(reg + count) || !expression(reg + count)) {
+                        return false;
+                    }
+                } while (accept(','));
+                if (!accept(')')) {
+                    return false;
+                }
+            }
+            emit(QmlOpcode::Call, reg, reg, count, member);
+        }
+        return true;
+    }
+
+    bool primary(unsigned reg) {
+        if (!use(reg)) {
+            return false;
+        }
+        skipSpace();
+        if (pos_ >= source_.size()) {
+            return false;
+        }
+        const char ch = source_[pos_];
+        if (ch == '"' || ch == '\'') {
+            return string(reg, ch);
+        }
+        if (isDigit(ch) || (ch == '-' && pos_ + 1 < source_.size() && isDigit(source_[pos_ + 1]))) {
+            const size_t begin = pos_++;
+            while (pos_ < source_.size() && (isDigit(source_[pos_]) || source_[pos_] == '.')) {
+                ++pos_;
+            }
+            loadConstant(reg, std::string(source_.substr(begin, pos_ - begin)));
+            return true;
+        }
+        if (accept('(')) {
+            return expression(reg) && accept(')');
+        }
+        QmlAtom atom = QmlAtoms::Invalid;
+        if (!name(atom)) {
+            return false;
+        }
+        emit(QmlOpcode::LoadName, reg, 0, 0, atom);
+        return true;
+    }
+
+    bool string(unsigned reg, char quote) {
+        std::string text;
+        for (++pos_; pos_ < source_.size(); ++pos_) {
+            char ch = source_[pos_];
+            if (ch == quote) {
+                ++pos_;
+                loadConstant(reg, std::move(text));
+                return true;
+            }
+            if (ch == '\\') {
+                if (++pos_ >= source_.size()) {
+                    return false;
+                }
+                ch = source_[pos_];
+                ch = ch == 'n' ? '\n' : ch == 't' ? '\t' : ch;
+            }
+            text.push_back(ch);
+        }
+        return false;
+    }
+};
+
+}  // namespace
+
+uint32_t QmlExpressionProgram::compile(std::string_view source) {
+    key_.assign(source);
+    const auto existing = bySource_.find(key_);
+    if (existing != bySource_.end()) {
+        return existing->second;
+    }
+
+    const size_t codeSize = code_.size();
+    const size_t constantCount = constants_.size();
+    Expression expression;
+    expression.begin = static_cast<uint32_t>(codeSize);
+    if (!Compiler(source, code_, constants_).run(expression.registers)) {
+        code_.resize(codeSize);
+        constants_.resize(constantCount);
+        // Remembered too, as bindings such as qsTr("x") are offered again
+        // every frame.
+        bySource_.emplace(key_, kInvalid);
+        return kInvalid;
+    }
+    expression.end = static_cast<uint32_t>(code_.size());
+    expressions_.push_back(expression);
+    const uint32_t index = static_cast<uint32_t>(expressions_.size() - 1);
+    bySource_.emplace(key_, index);
+    return index;
+}
+
+void QmlExpressionProgram::clear() {
+    code_.clear();
+    constants_.clear();
+    expressions_.clear();
+    bySource_.clear();
+}
+
+void QmlExpressionProgram::dependencies(uint32_t expression, std::vector<std::pair<QmlAtom, QmlAtom>> &out) const {
+    const Expression &range = expressions_[expression];
+    // The name each register holds straight from LoadName, if any.
+    std::vector<QmlAtom> names(range.registers, QmlAtoms::Invalid);
+    for (uint32_t pc = range.begin; pc < range.end; ++pc) {
+        const QmlInstruction &in = code_[pc];
+        if (in.op == QmlOpcode::GetMember && names[in.b] != QmlAtoms::Invalid) {
+            out.emplace_back(names[in.b], in.operand);
+        }
+        names[in.a] = in.op == QmlOpcode::LoadName ? in.operand : QmlAtoms::Invalid;
+    }
+}
+
+bool QmlExpressionVm::evaluate(const QmlExpressionProgram &program, uint32_t expression, QmlExpressionHost &host,
+                               std::string &out) {
+    const QmlExpressionProgram::Expression &range = program.expression(expression);
+    if (registers_.size() < range.registers) {
+        registers_.resize(range.registers);
+    }
+    QmlExpressionValue *r = registers_.data();
+
+    const QmlInstruction *code = program.code();
+    for (uint32_t pc = range.begin; pc < range.end; ++pc) {
+        const QmlInstruction &in = code[pc];
+        switch (in.op) {
+        case QmlOpcode::LoadString:
+            r[in.a].text.assign(program.constant(in.operand));
+            r[in.a].setString();
+            break;
+        case QmlOpcode::LoadName:
+            if (!host.lookup(in.operand, r[in.a])) {
+                return false;
+            }
+            break;
+        case QmlOpcode::GetMember:
+            if (r[in.b].kind != QmlExpressionValue::Kind::Object ||
+                !host.member(r[in.b].object, r[in.b].objectTag, in.operand, r[in.a])) {
+                return false;
+            }
+            break;
+        case QmlOpcode::Call:
+            if (r[in.b].kind != QmlExpressionValue::Kind::Object ||
+                !host.call(r[in.b].object, r[in.b].objectTag, in.operand, r + in.b + 1, in.count, r[in.a])) {
+                return false;
+            }
+            break;
+        case QmlOpcode::Concat:
+            if (r[in.a].kind != QmlExpressionValue::Kind::String || r[in.b].kind != QmlExpressionValue::Kind::String) {
+                return false;
+            }
+            r[in.a].text.append(r[in.b].text);
+            break;
+        }
+    }
+    if (r[0].kind != QmlExpressionValue::Kind::String) {
+        return false;
+    }
+    out.assign(r[0].text);
+    return true;
+}
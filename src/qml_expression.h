@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "qml_atoms.h"
+
+// Binding expressions compiled to register bytecode. The grammar covers
+// what bindings in this project use:
+//
+//   expression := postfix ('+' postfix)*         string concatenation
+//   postfix    := primary ('.' name ['(' arguments ')'])*
+//   primary    := "string" | 'string' | number | name | '(' expression ')'
+//
+// Names are interned as QmlAtoms, so a host can cache whatever it looks up
+// per atom and evaluation never touches the expression's text again.
+
+enum class QmlOpcode : uint8_t {
+    LoadString,  // r[a] = constants[operand]
+    LoadName,    // r[a] = host.lookup(operand)
+    GetMember,   // r[a] = r[b].operand
+    Call,        // r[a] = r[b].operand(r[b + 1] .. r[b + count])
+    Concat,      // r[a] = r[a] + r[b]
+};
+
+struct QmlInstruction {
+    QmlOpcode op;
+    uint8_t a;
+    uint8_t b;
+    uint8_t count;
+    uint32_t operand;  // constant index or name atom
+};
+
+struct QmlExpressionValue {
+    enum class Kind : uint8_t { Undefined, String, Object };
+
+    Kind kind = Kind::Undefined;
+    uint32_t objectTag = 0;  // for the host, e.g. to tell object kinds apart
+    const void *object = nullptr;
+    std::string text;
+
+    void setString() {
+        kind = Kind::String;
+        object = nullptr;
+    }
+    void setObject(const void *target, uint32_t tag = 0) {
+        kind = Kind::Object;
+        object = target;
+        objectTag = tag;
+        text.clear();
+    }
+};
+
+// Everything an expression can see. Each call returns false when the name
+// does not resolve, which fails the evaluation.
+class QmlExpressionHost {
+public:
+    virtual ~QmlExpressionHost() = default;
+
+    // A name at the start of a chain: an object id or a context property.
+    virtual bool lookup(QmlAtom name, QmlExpressionValue &out) = 0;
+    // object and tag come from a value the host produced. out may be the
+    // register that held that value.
+    virtual bool member(const void *object, uint32_t tag, QmlAtom name, QmlExpressionValue &out) = 0;
+    virtual bool call(const void *object, uint32_t tag, QmlAtom method, const QmlExpressionValue *arguments,
+                      size_t count, QmlExpressionValue &out) = 0;
+};
+
+// Code for any number of expressions in one buffer. Compiling the same
+// text twice returns the same expression, or kInvalid again without
+// reparsing it.
+class QmlExpressionProgram {
+public:
+    static constexpr uint32_t kInvalid = UINT32_MAX;
+
+    struct Expression {
+        uint32_t begin = 0;  // instructions [begin, end)
+        uint32_t end = 0;
+        uint8_t registers = 0;
+    };
+
+    // Returns kInvalid if source is not a valid expression.
+    uint32_t compile(std::string_view source);
+    void clear();
+
+    size_t expressionCount() const { return expressions_.size(); }
+    size_t instructionCount() const { return code_.size(); }
+    const Expression &expression(uint32_t index) const { return expressions_[index]; }
+    const QmlInstruction *code() const { return code_.data(); }
+    const std::string &constant(uint32_t index) const { return constants_[index]; }
+
+    // The name.member pairs the expression reads, e.g. (nameField, text)
+    // for greeter.greet(nameField.text). Method calls are not included.
+    void dependencies(uint32_t expression, std::vector<std::pair<QmlAtom, QmlAtom>> &out) const;
+
+private:
+    std::vector<QmlInstruction> code_;
+    std::vector<std::string> constants_;
+    std::vector<Expression> expressions_;
+    std::unordered_map<std::string, uint32_t> bySource_;
+    std::string key_;  // reused for bySource_ lookups
+};
+
+// Evaluates compiled expressions. Registers keep their string buffers
+// between evaluations; use one VM per thread.
+class QmlExpressionVm {
+public:
+    // Writes the result's text to out. Returns false if a name did not
+    // resolve or the result is not a string.
+    bool evaluate(const QmlExpressionProgram &program, uint32_t expression, QmlExpressionHost &host,
+                  std::string &out);
+
+private:
+    std::vector<QmlExpressionValue> registers_;
+};
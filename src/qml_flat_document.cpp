@@ -0,0 +1,245 @@
+#include "qml_flat_document.h"
+
+#include <cstring>
+
+static_assert(sizeof(QmlFlatNode) == 32, "QmlFlatNode should stay two to a cache line");
+
+namespace {
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+std::string_view QmlFlatDocument::type(uint32_t index) const {
+    return QmlAtomTable::global().name(typeAtom(index));
+}
+
+QmlAtom QmlFlatDocument::storedAtom(QmlAtom atom) const {
+    if (atom < QmlAtoms::PredefinedCount || imageAtoms_.empty()) {
+        return atom;
+    }
+    for (size_t i = 0; i < imageAtoms_.size(); ++i) {
+        if (imageAtoms_[i] == atom) {
+            return static_cast<QmlAtom>(QmlAtoms::PredefinedCount + i);
+        }
+    }
+    return QmlAtoms::Invalid;
+}
+
+QmlFlatIndexRange QmlFlatDocument::roots() const {
+    return QmlFlatIndexRange{childIndices_, childIndices_ + rootCount_};
+}
+
+QmlFlatIndexRange QmlFlatDocument::children(uint32_t index) const {
+    const QmlFlatNode &n = nodes_[index];
+    const uint32_t *first = childIndices_ + n.firstChild;
+    return QmlFlatIndexRange{first, first + n.childCount};
+}
+
+const QmlFlatProperty *QmlFlatDocument::propertiesBegin(uint32_t index) const {
+    return properties_ + nodes_[index].firstProperty;
+}
+
+const QmlFlatProperty *QmlFlatDocument::propertiesEnd(uint32_t index) const {
+    return propertiesBegin(index) + nodes_[index].propertyCount;
+}
+
+std::string_view QmlFlatDocument::property(uint32_t index, QmlAtom key, std::string_view defaultValue) const {
+    const QmlAtom stored = storedAtom(key);
+    if (stored == QmlAtoms::Invalid) {
+        return defaultValue;
+    }
+    for (const QmlFlatProperty *it = propertiesBegin(index), *end = propertiesEnd(index); it != end; ++it) {
+        if (it->key == stored) {
+            return text(it->value);
+        }
+    }
+    return defaultValue;
+}
+
+std::string_view QmlFlatDocument::property(uint32_t index, std::string_view key, std::string_view defaultValue) const {
+    const QmlAtom atom = QmlAtomTable::global().find(key);
+    return atom == QmlAtoms::Invalid ? defaultValue : property(index, atom, defaultValue);
+}
+
+uint32_t QmlFlatDocument::findChildByType(uint32_t index, QmlAtom wantedType) const {
+    const QmlAtom stored = storedAtom(wantedType);
+    if (stored == QmlAtoms::Invalid) {
+        return npos;
+    }
+    for (uint32_t i = index + 1; i < nodes_[index].subtreeEnd; ++i) {
+        if (nodes_[i].typeAtom == stored) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+uint32_t QmlFlatDocument::findChildByType(uint32_t index, std::string_view wantedType) const {
+    const QmlAtom atom = QmlAtomTable::global().find(wantedType);
+    return atom == QmlAtoms::Invalid ? npos : findChildByType(index, atom);
+}
+
+uint32_t QmlFlatDocument::findChildById(uint32_t index, std::string_view wantedId) const {
+    for (uint32_t i = index + 1; i < nodes_[index].subtreeEnd; ++i) {
+        if (id(i) == wantedId) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+uint32_t QmlFlatDocument::firstRootOfType(QmlAtom wantedType) const {
+    const QmlAtom stored = storedAtom(wantedType);
+    if (stored == QmlAtoms::Invalid) {
+        return npos;
+    }
+    for (uint32_t i = 0; i < nodeCount_; ++i) {
+        if (nodes_[i].typeAtom == stored) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+uint32_t QmlFlatDocument::firstRootOfType(std::string_view wantedType) const {
+    const QmlAtom atom = QmlAtomTable::global().find(wantedType);
+    return atom == QmlAtoms::Invalid ? npos : firstRootOfType(atom);
+}
+
+uint32_t QmlFlatDocument::findById(std::string_view wantedId) const {
+    for (uint32_t i = 0; i < nodeCount_; ++i) {
+        if (id(i) == wantedId) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+QmlFlatString QmlFlatDocumentBuilder::intern(std::string_view text) {
+    const QmlFlatString str{static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(text.size())};
+    strings_.append(text.data(), text.size());
+    return str;
+}
+
+void QmlFlatDocumentBuilder::beginObject(std::string_view type) {
+    const auto index = static_cast<uint32_t>(nodes_.size());
+    QmlFlatNode node;
+    node.typeAtom = atoms_.intern(type);
+    nodes_.push_back(node);
+
+    if (open_.empty()) {
+        roots_.push_back(index);
+    } else {
+        pendingChildren_.push_back(index);
+    }
+    open_.push_back(OpenNode{index, pendingProperties_.size(), pendingChildren_.size()});
+}
+
+void QmlFlatDocumentBuilder::property(std::string_view key, std::string_view value) {
+    if (open_.empty()) {
+        return;
+    }
+    const QmlAtom atom = atoms_.intern(key);
+    // Later assignments to the same key replace earlier ones, as in QmlNode.
+    const size_t start = open_.back().propertiesStart;
+    const size_t count = pendingProperties_.size() - start;
+    const size_t slot = keys_.find(open_.size() - 1, atom, count,
+                                   [this, start](size_t i) { return pendingProperties_[start + i].key; });
+
+    const QmlFlatString storedValue = intern(value);
+    if (slot < count) {
+        pendingProperties_[start + slot].value = storedValue;
+    } else {
+        pendingProperties_.push_back(QmlFlatProperty{atom, storedValue});
+    }
+    if (atom == QmlAtoms::id) {
+        nodes_[open_.back().index].id = storedValue;
+    }
+}
+
+void QmlFlatDocumentBuilder::endObject() {
+    if (open_.empty()) {
+        return;
+    }
+    const OpenNode open = open_.back();
+    keys_.close(open_.size() - 1);
+    open_.pop_back();
+
+    // A node's pending properties and children sit on top of the scratch
+    // stacks, so they can be moved out as contiguous ranges.
+    QmlFlatNode &node = nodes_[open.index];
+    node.firstProperty = static_cast<uint32_t>(properties_.size());
+    node.propertyCount = static_cast<uint32_t>(pendingProperties_.size() - open.propertiesStart);
+    properties_.insert(properties_.end(), pendingProperties_.begin() + static_cast<std::ptrdiff_t>(open.propertiesStart),
+                       pendingProperties_.end());
+    pendingProperties_.resize(open.propertiesStart);
+
+    node.firstChild = static_cast<uint32_t>(childIndices_.size());
+    node.childCount = static_cast<uint32_t>(pendingChildren_.size() - open.childrenStart);
+    childIndices_.insert(childIndices_.end(), pendingChildren_.begin() + static_cast<std::ptrdiff_t>(open.childrenStart),
+                         pendingChildren_.end());
+    pendingChildren_.resize(open.childrenStart);
+
+    node.subtreeEnd = static_cast<uint32_t>(nodes_.size());
+}
+
+QmlFlatDocument QmlFlatDocumentBuilder::finish() {
+    // Unterminated objects are closed implicitly, matching the tree parser.
+    while (!open_.empty()) {
+        endObject();
+    }
+
+    // Roots go first in the child index table so roots() is a plain range.
+    const uint32_t rootCount = static_cast<uint32_t>(roots_.size());
+    for (auto &node : nodes_) {
+        node.firstChild += rootCount;
+    }
+
+    const size_t nodeBytes = nodes_.size() * sizeof(QmlFlatNode);
+    const size_t propertyOffset = alignUp(nodeBytes, alignof(QmlFlatProperty));
+    const size_t propertyBytes = properties_.size() * sizeof(QmlFlatProperty);
+    const size_t childOffset = alignUp(propertyOffset + propertyBytes, alignof(uint32_t));
+    const size_t childBytes = (roots_.size() + childIndices_.size()) * sizeof(uint32_t);
+    const size_t stringOffset = childOffset + childBytes;
+    const size_t total = stringOffset + strings_.size();
+
+    QmlFlatDocument doc;
+    doc.block_.reset(new unsigned char[total > 0 ? total : 1]);
+    unsigned char *base = doc.block_.get();
+    if (!nodes_.empty()) {
+        std::memcpy(base, nodes_.data(), nodeBytes);
+    }
+    if (!properties_.empty()) {
+        std::memcpy(base + propertyOffset, properties_.data(), propertyBytes);
+    }
+    if (!roots_.empty()) {
+        std::memcpy(base + childOffset, roots_.data(), roots_.size() * sizeof(uint32_t));
+    }
+    if (!childIndices_.empty()) {
+        std::memcpy(base + childOffset + roots_.size() * sizeof(uint32_t), childIndices_.data(),
+                    childIndices_.size() * sizeof(uint32_t));
+    }
+    if (!strings_.empty()) {
+        std::memcpy(base + stringOffset, strings_.data(), strings_.size());
+    }
+
+    doc.nodes_ = reinterpret_cast<const QmlFlatNode *>(base);
+    doc.properties_ = reinterpret_cast<const QmlFlatProperty *>(base + propertyOffset);
+    doc.childIndices_ = reinterpret_cast<const uint32_t *>(base + childOffset);
+    doc.strings_ = reinterpret_cast<const char *>(base + stringOffset);
+    doc.nodeCount_ = nodes_.size();
+    doc.propertyCount_ = properties_.size();
+    doc.rootCount_ = rootCount;
+    doc.stringBytes_ = strings_.size();
+    doc.byteSize_ = total;
+
+    nodes_.clear();
+    properties_.clear();
+    childIndices_.clear();
+    roots_.clear();
+    strings_.clear();
+    return doc;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qml_atoms.h"
+#include "qml_key_slots.h"
+
+// Offset/length pair into the flat document's string pool.
+struct QmlFlatString {
+    uint32_t offset = 0;
+    uint32_t length = 0;
+};
+
+// Nodes are stored in pre-order, so a node's descendants occupy the index
+// range (index, subtreeEnd) and a depth-first walk is a linear scan. 32
+// bytes, all 32-bit fields; the type name is not stored, the atom names it.
+struct QmlFlatNode {
+    QmlAtom typeAtom = QmlAtoms::Invalid;
+    QmlFlatString id;
+    uint32_t firstProperty = 0;
+    uint32_t propertyCount = 0;
+    uint32_t firstChild = 0;  // into the child index table
+    uint32_t childCount = 0;
+    uint32_t subtreeEnd = 0;
+};
+
+struct QmlFlatProperty {
+    QmlAtom key = QmlAtoms::Invalid;
+    QmlFlatString value;
+};
+
+// Pointer range over node indices, used for children and roots.
+struct QmlFlatIndexRange {
+    const uint32_t *first = nullptr;
+    const uint32_t *last = nullptr;
+
+    const uint32_t *begin() const { return first; }
+    const uint32_t *end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+    uint32_t operator[](size_t i) const { return first[i]; }
+};
+
+// Alternative, read-only storage for a parsed document. Nodes, properties,
+// child index lists and string bytes all live in one heap block, so a
+// document is released with a single deallocation. The block holds offsets
+// rather than pointers, so QmlAstCache can also map it from a cache file
+// that several processes share (QmlAstCache::loadFlatFile).
+class QmlFlatDocument {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    QmlFlatDocument() = default;
+    QmlFlatDocument(QmlFlatDocument &&) noexcept = default;
+    QmlFlatDocument &operator=(QmlFlatDocument &&) noexcept = default;
+
+    size_t nodeCount() const { return nodeCount_; }
+    size_t propertyCount() const { return propertyCount_; }
+    size_t byteSize() const { return byteSize_; }
+
+    const QmlFlatNode &node(uint32_t index) const { return nodes_[index]; }
+    // A mapped document numbers the atoms that are not predefined itself,
+    // so node().typeAtom and QmlFlatProperty::key hold this process's atoms
+    // only for documents parsed here. These translate for either kind.
+    QmlAtom typeAtom(uint32_t index) const { return processAtom(nodes_[index].typeAtom); }
+    QmlAtom key(const QmlFlatProperty &property) const { return processAtom(property.key); }
+    // Looked up in QmlAtomTable::global(); compare typeAtom on hot paths.
+    std::string_view type(uint32_t index) const;
+    std::string_view id(uint32_t index) const { return text(nodes_[index].id); }
+
+    QmlFlatIndexRange roots() const;
+    QmlFlatIndexRange children(uint32_t index) const;
+    const QmlFlatProperty *propertiesBegin(uint32_t index) const;
+    const QmlFlatProperty *propertiesEnd(uint32_t index) const;
+
+    std::string_view property(uint32_t index, QmlAtom key, std::string_view defaultValue = {}) const;
+    std::string_view property(uint32_t index, std::string_view key, std::string_view defaultValue = {}) const;
+    std::string_view text(QmlFlatString str) const { return std::string_view(strings_ + str.offset, str.length); }
+
+    // Same first-match semantics as the QmlNode/QmlDocument lookups; return
+    // npos when nothing matches.
+    uint32_t findChildByType(uint32_t index, QmlAtom wantedType) const;
+    uint32_t findChildByType(uint32_t index, std::string_view wantedType) const;
+    uint32_t findChildById(uint32_t index, std::string_view wantedId) const;
+    uint32_t firstRootOfType(QmlAtom wantedType) const;
+    uint32_t firstRootOfType(std::string_view wantedType) const;
+    uint32_t findById(std::string_view wantedId) const;
+
+private:
+    friend class QmlFlatDocumentBuilder;
+    friend class QmlAstCache;
+
+    QmlAtom processAtom(QmlAtom stored) const {
+        return stored < QmlAtoms::PredefinedCount || imageAtoms_.empty()
+                   ? stored
+                   : imageAtoms_[stored - QmlAtoms::PredefinedCount];
+    }
+    // Invalid if no node or property of the document uses atom.
+    QmlAtom storedAtom(QmlAtom atom) const;
+
+    std::unique_ptr<unsigned char[]> block_;
+    std::shared_ptr<const void> image_;  // keeps a mapped block mapped
+    std::vector<QmlAtom> imageAtoms_;    // process atoms for stored atoms from PredefinedCount on
+    const QmlFlatNode *nodes_ = nullptr;
+    const QmlFlatProperty *properties_ = nullptr;
+    const uint32_t *childIndices_ = nullptr;
+    const char *strings_ = nullptr;
+    size_t nodeCount_ = 0;
+    size_t propertyCount_ = 0;
+    uint32_t rootCount_ = 0;
+    size_t stringBytes_ = 0;
+    size_t byteSize_ = 0;
+};
+
+// Receives parser events and packs them into a QmlFlatDocument. Scratch
+// vectors are only used while building; finish() copies everything into
+// the document's single block.
+class QmlFlatDocumentBuilder {
+public:
+    void beginObject(std::string_view type);
+    void property(std::string_view key, std::string_view value);
+    void endObject();
+
+    QmlFlatDocument finish();
+
+private:
+    struct OpenNode {
+        uint32_t index;
+        size_t propertiesStart;
+        size_t childrenStart;
+    };
+
+    QmlFlatString intern(std::string_view text);
+
+    std::vector<QmlFlatNode> nodes_;
+    std::vector<QmlFlatProperty> properties_;
+    std::vector<uint32_t> childIndices_;
+    std::vector<uint32_t> roots_;
+    std::vector<QmlFlatProperty> pendingProperties_;
+    std::vector<uint32_t> pendingChildren_;
+    std::vector<OpenNode> open_;
+    QmlKeySlots keys_;
+    std::string strings_;
+    QmlAtomCache atoms_;
+};
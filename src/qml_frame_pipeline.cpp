@@ -0,0 +1,143 @@
+#include "qml_frame_pipeline.h"
+
+void QmlFrameDelta::reset() {
+    clear = false;
+    refresh = false;
+    text.clear();
+    runs.clear();
+}
+
+void QmlFramePipeline::DeltaScreen::clear() {
+    // Whatever the frame drew before is cleared along with the screen.
+    pipeline_.building_.reset();
+    pipeline_.building_.clear = true;
+}
+
+void QmlFramePipeline::DeltaScreen::drawText(int row, int col, const std::string &text) {
+    append(ScreenRun{row, col, text, 0, -1});
+}
+
+void QmlFramePipeline::DeltaScreen::drawStyledText(int row, int col, const std::string &text, uint32_t attributes) {
+    append(ScreenRun{row, col, text, attributes, -1});
+}
+
+void QmlFramePipeline::DeltaScreen::drawRuns(const ScreenRun *runs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        append(runs[i]);
+    }
+}
+
+void QmlFramePipeline::DeltaScreen::append(const ScreenRun &run) {
+    QmlFrameDelta &delta = pipeline_.building_;
+    delta.runs.push_back(QmlFrameDelta::Run{run.row, run.col, static_cast<uint32_t>(delta.text.size()),
+                                            static_cast<uint32_t>(run.text.size()), run.attributes, run.width});
+    delta.text.append(run.text);
+}
+
+void QmlFramePipeline::DeltaScreen::refresh() {
+    pipeline_.building_.refresh = true;
+    pipeline_.publish();
+}
+
+QmlFramePipeline::~QmlFramePipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_.store(true, std::memory_order_relaxed);
+    }
+    wake_.notify_all();
+    worker_.join();
+}
+
+bool QmlFramePipeline::post(Job job) {
+    if (!jobs_.tryPush(std::move(job))) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++posted_;
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void QmlFramePipeline::setScreenSize(int rows, int cols) {
+    rows_.store(rows, std::memory_order_relaxed);
+    cols_.store(cols, std::memory_order_relaxed);
+}
+
+size_t QmlFramePipeline::apply(ICursesScreen &screen) {
+    setScreenSize(screen.rows(), screen.cols());
+    size_t applied = 0;
+    bool refresh = false;
+    QmlFrameDelta delta;
+    while (frames_.tryPop(delta)) {
+        if (delta.clear) {
+            screen.clear();
+        }
+        runs_.clear();
+        for (const QmlFrameDelta::Run &run : delta.runs) {
+            runs_.push_back(ScreenRun{run.row, run.col, std::string_view(delta.text).substr(run.offset, run.length),
+                                      run.attributes, run.width});
+        }
+        if (!runs_.empty()) {
+            screen.drawRuns(runs_.data(), runs_.size());
+        }
+        refresh |= delta.refresh;
+        delta.reset();
+        spares_.tryPush(std::move(delta));  // dropped if the worker has enough
+        ++applied;
+    }
+    if (refresh) {
+        screen.refresh();
+    }
+    return applied;
+}
+
+void QmlFramePipeline::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return finished_ == posted_; });
+}
+
+void QmlFramePipeline::publish() {
+    while (!frames_.tryPush(std::move(building_))) {
+        if (stopping_.load(std::memory_order_relaxed)) {
+            building_.reset();
+            return;
+        }
+        std::this_thread::yield();
+    }
+    if (!spares_.tryPop(building_)) {
+        building_ = QmlFrameDelta{};
+    }
+    if (notifier_) {
+        notifier_();
+    }
+}
+
+void QmlFramePipeline::run() {
+    Job job;
+    Job previous;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_.load(std::memory_order_relaxed) || !jobs_.empty(); });
+            if (stopping_.load(std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        while (jobs_.tryPop(job)) {
+            job(frontend_);
+            // Calls made outside a refreshed frame still reach the screen.
+            if (!building_.empty()) {
+                publish();
+            }
+            previous = std::move(job);
+            job = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++finished_;
+            }
+            idle_.notify_all();
+        }
+    }
+}
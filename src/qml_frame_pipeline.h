@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "qml_curses_frontend.h"
+#include "qml_spsc_queue.h"
+
+// One frame's screen calls, recorded by the worker of a QmlFramePipeline.
+// Runs point into text by offset, so the delta can be moved between
+// threads.
+struct QmlFrameDelta {
+    struct Run {
+        int row = 0;
+        int col = 0;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        uint32_t attributes = 0;
+        int width = -1;
+    };
+
+    bool clear = false;  // before the runs
+    bool refresh = false;
+    std::string text;
+    std::vector<Run> runs;
+
+    bool empty() const { return !clear && !refresh && runs.empty(); }
+    // Keeps the buffers' capacity.
+    void reset();
+};
+
+// Splits a frontend in two: a worker thread resolves, lays out and diffs
+// frames, and the thread that owns the terminal only applies the finished
+// deltas to its screen. Curses is not thread-safe, so it is only touched
+// in apply(); an expensive frame on the worker leaves that thread free to
+// handle input. Deltas go through a lock-free single-producer,
+// single-consumer queue, and their buffers come back through a second one
+// for reuse, so steady-state frames allocate nothing for them.
+//
+// Work reaches the frontend as jobs, such as rendering a document
+// snapshot, posted from the owning thread. They run in order on the
+// worker, so everything the frontend calls (the resolver, instantiators,
+// models) is called there. Each job is kept until the next one has run,
+// so a document it captured outlives the plan compiled from it. If
+// capacity deltas are waiting, the worker waits for apply().
+class QmlFramePipeline {
+public:
+    using Job = std::function<void(QmlCursesFrontend &frontend)>;
+
+    // Arguments after the capacity go to the frontend's constructor after
+    // the screen, e.g. a BindingResolver.
+    template <typename... Resolver>
+    explicit QmlFramePipeline(size_t capacity, Resolver &&...resolver)
+        : jobs_(capacity),
+          frames_(capacity),
+          spares_(capacity),
+          screen_(*this),
+          frontend_(screen_, std::forward<Resolver>(resolver)...) {
+        worker_ = std::thread([this] { run(); });
+    }
+    ~QmlFramePipeline();
+    QmlFramePipeline(const QmlFramePipeline &) = delete;
+    QmlFramePipeline &operator=(const QmlFramePipeline &) = delete;
+
+    // The rest is called from the owning thread.
+
+    // Returns false if capacity jobs are already waiting.
+    bool post(Job job);
+    // The size frames are laid out for; apply() keeps it current.
+    void setScreenSize(int rows, int cols);
+    // Updates the size, then makes the calls of every ready frame on
+    // screen, with one refresh at the end. Returns the frames applied.
+    size_t apply(ICursesScreen &screen);
+    // Called on the worker each time a frame is ready, e.g. to post an
+    // event that calls apply(). Set it before posting jobs.
+    void setFrameReadyNotifier(std::function<void()> notifier) { notifier_ = std::move(notifier); }
+    // Blocks until every posted job has run.
+    void waitIdle();
+
+private:
+    // Records the frontend's screen calls into the delta being built.
+    class DeltaScreen : public ICursesScreen {
+    public:
+        explicit DeltaScreen(QmlFramePipeline &pipeline) : pipeline_(pipeline) {}
+
+        void clear() override;
+        void drawText(int row, int col, const std::string &text) override;
+        void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override;
+        void drawRuns(const ScreenRun *runs, size_t count) override;
+        void refresh() override;
+        int rows() const override { return pipeline_.rows_.load(std::memory_order_relaxed); }
+        int cols() const override { return pipeline_.cols_.load(std::memory_order_relaxed); }
+
+    private:
+        void append(const ScreenRun &run);
+
+        QmlFramePipeline &pipeline_;
+    };
+
+    void run();
+    // Hands the delta being built to apply() and starts a new one.
+    void publish();
+
+    QmlSpscQueue<Job> jobs_;
+    QmlSpscQueue<QmlFrameDelta> frames_;
+    QmlSpscQueue<QmlFrameDelta> spares_;  // applied deltas, back to the worker
+    std::atomic<int> rows_{0};
+    std::atomic<int> cols_{0};
+    // Worker side.
+    DeltaScreen screen_;
+    QmlCursesFrontend frontend_;
+    QmlFrameDelta building_;
+    std::function<void()> notifier_;
+    // Owner side.
+    std::vector<ScreenRun> runs_;
+
+    std::mutex mutex_;  // only for sleeping, waking and the counts
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    size_t posted_ = 0;
+    size_t finished_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::thread worker_;
+};
@@ -0,0 +1,100 @@
+#include "qml_frame_scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+QmlFrameScheduler::QmlFrameScheduler(Commit commit, Wake wake) : commit_(std::move(commit)), wake_(std::move(wake)) {}
+
+void QmlFrameScheduler::setInterval(microseconds interval) {
+    interval_ = std::max(interval, microseconds(0));
+}
+
+void QmlFrameScheduler::setFrameRate(int hz) {
+    setInterval(hz > 0 ? microseconds(1000000 / hz) : microseconds(0));
+}
+
+void QmlFrameScheduler::setIdleFrameRate(int hz, std::chrono::milliseconds idleAfter) {
+    idleInterval_ = hz > 0 ? microseconds(1000000 / hz) : microseconds(0);
+    idleAfter_ = std::max(duration_cast<microseconds>(idleAfter), microseconds(0));
+}
+
+void QmlFrameScheduler::noteInput(Clock::time_point now) {
+    lastInput_ = now;
+    // A frame armed at the idle rate is due sooner now.
+    if (dirty_ && (!armed_ || due_ > std::max(now, lastCommit_ + interval_))) {
+        arm(now);
+    }
+}
+
+void QmlFrameScheduler::setFocused(bool focused, Clock::time_point now) {
+    focused_ = focused;
+    if (focused) {
+        noteInput(now);
+    }
+}
+
+bool QmlFrameScheduler::idle(Clock::time_point now) const {
+    // The first frame counts as input, so a UI starts out at the full rate.
+    return idleInterval_.count() > 0 && committedOnce_ && (!focused_ || now - lastInput_ >= idleAfter_);
+}
+
+microseconds QmlFrameScheduler::currentInterval(Clock::time_point now) const {
+    return idle(now) ? std::max(interval_, idleInterval_) : interval_;
+}
+
+void QmlFrameScheduler::requestFrame(Clock::time_point now) {
+    if (dirty_) {
+        ++requestsCoalesced_;
+        return;
+    }
+    dirty_ = true;
+    if (!armed_) {
+        arm(now);
+    }
+}
+
+// The first frame, and any frame after an idle stretch longer than the
+// interval, is due at once; otherwise it waits out the interval.
+void QmlFrameScheduler::arm(Clock::time_point now) {
+    due_ = committedOnce_ ? std::max(now, lastCommit_ + currentInterval(now)) : now;
+    armed_ = true;
+    wake_(duration_cast<microseconds>(due_ - now));
+}
+
+void QmlFrameScheduler::tick(Clock::time_point now) {
+    armed_ = false;
+    if (!dirty_) {
+        return;
+    }
+    if (now < due_) {
+        // Woken early (timers round to milliseconds); wait out the rest.
+        arm(now);
+        return;
+    }
+    const microseconds interval = currentInterval(now);
+    if (interval.count() > 0) {
+        droppedFrames_ += static_cast<uint64_t>((now - due_) / interval);
+    }
+
+    dirty_ = false;
+    armed_ = true;  // requests made by commit() itself wait for the next frame
+    commit_();
+    armed_ = false;
+    const Clock::time_point done = Clock::now();
+    lastFrameTime_ = duration_cast<microseconds>(done - now);
+    frameTimes_.record(done - now);
+    maxFrameTime_ = std::max(maxFrameTime_, lastFrameTime_);
+    lastCommit_ = now;
+    if (!committedOnce_) {
+        lastInput_ = now;
+    }
+    committedOnce_ = true;
+    ++framesCommitted_;
+
+    if (dirty_) {
+        arm(now);
+    }
+}
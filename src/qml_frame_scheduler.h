@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "qml_latency_histogram.h"
+
+// Coalesces redraw requests into at most one committed frame per interval.
+// Updates call requestFrame() as they arrive (after invalidating whatever
+// they changed); the scheduler asks its owner to wake it once, and the
+// wake-up commits a single frame for every request made since the last
+// one. The scheduler owns no timer: wake(delay) is expected to arm a
+// one-shot timer (QTimer::singleShot in the CLI) that calls tick().
+class QmlFrameScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Commit = std::function<void()>;
+    using Wake = std::function<void(std::chrono::microseconds delay)>;
+
+    // 60 Hz by default.
+    QmlFrameScheduler(Commit commit, Wake wake);
+
+    void setInterval(std::chrono::microseconds interval);
+    void setFrameRate(int hz);
+    std::chrono::microseconds interval() const { return interval_; }
+
+    // Marks the screen dirty. Only the first request after a commit arms a
+    // wake-up; later ones are coalesced into the same frame.
+    void requestFrame(Clock::time_point now = Clock::now());
+    // Commits the pending frame if the interval since the last commit has
+    // passed, otherwise re-arms for the remainder.
+    void tick(Clock::time_point now = Clock::now());
+    bool framePending() const { return dirty_; }
+
+    // Idle throttling. Once no input has been noted for idleAfter, or while
+    // the terminal reports that it lost focus, frames are committed at most
+    // hz times a second: animations and model updates still show, at a
+    // cost next to nothing on a host shared by many UIs. noteInput(), or
+    // regaining focus, restores the full rate at once, bringing a pending
+    // frame forward. A rate of 0 or less turns throttling off, as it is by
+    // default.
+    void setIdleFrameRate(int hz, std::chrono::milliseconds idleAfter = std::chrono::seconds(2));
+    void noteInput(Clock::time_point now = Clock::now());
+    void setFocused(bool focused, Clock::time_point now = Clock::now());
+    bool focused() const { return focused_; }
+    bool idle(Clock::time_point now = Clock::now()) const;
+    // The interval frames are committed at: interval(), or the idle one.
+    std::chrono::microseconds currentInterval(Clock::time_point now = Clock::now()) const;
+
+    uint64_t framesCommitted() const { return framesCommitted_; }
+    uint64_t requestsCoalesced() const { return requestsCoalesced_; }
+    // Frame deadlines that passed without a commit because a wake-up ran
+    // late or the previous frame overran the interval.
+    uint64_t droppedFrames() const { return droppedFrames_; }
+    // Time spent in commit(), for the last frame and the slowest one.
+    std::chrono::microseconds lastFrameTime() const { return lastFrameTime_; }
+    std::chrono::microseconds maxFrameTime() const { return maxFrameTime_; }
+    // Of every frame committed.
+    const QmlLatencyHistogram &frameTimes() const { return frameTimes_; }
+
+private:
+    void arm(Clock::time_point now);
+
+    Commit commit_;
+    Wake wake_;
+    std::chrono::microseconds interval_{16667};
+    std::chrono::microseconds idleInterval_{0};  // 0 when not throttling
+    std::chrono::microseconds idleAfter_{0};
+    Clock::time_point lastInput_{};
+    bool focused_ = true;
+    Clock::time_point lastCommit_{};
+    Clock::time_point due_{};
+    bool dirty_ = false;
+    bool armed_ = false;
+    bool committedOnce_ = false;
+    uint64_t framesCommitted_ = 0;
+    uint64_t requestsCoalesced_ = 0;
+    uint64_t droppedFrames_ = 0;
+    std::chrono::microseconds lastFrameTime_{0};
+    std::chrono::microseconds maxFrameTime_{0};
+    QmlLatencyHistogram frameTimes_;
+};
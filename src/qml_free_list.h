@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Objects of one type given back when they go out of use, and taken again
+// instead of building new ones, in the manner of ListView.reuseItems. An
+// object keeps whatever it held when it was given back, so the strings
+// and vectors inside it keep their heap buffers and the taker only has to
+// overwrite them; a session that rebuilds its plan on every reload or
+// scrolls rows in and out stops allocating once the lists are warm.
+//
+// One list per type keeps like-sized blocks together. At most capacity
+// objects are kept; the rest are destroyed as they are given, so an idle
+// list never holds more than the busiest moment needed up to that bound.
+// Not thread-safe.
+template <typename T>
+class QmlFreeList {
+public:
+    explicit QmlFreeList(size_t capacity = 4096) : capacity_(capacity) {}
+
+    // A given-back object in the state it was given in, or a new T.
+    T take() {
+        if (free_.empty()) {
+            ++created_;
+            return T();
+        }
+        ++reused_;
+        T object = std::move(free_.back());
+        free_.pop_back();
+        return object;
+    }
+
+    void give(T &&object) {
+        if (free_.size() < capacity_) {
+            free_.push_back(std::move(object));
+        }
+    }
+    // Gives every element of objects and clears it.
+    void giveAll(std::vector<T> &objects) {
+        for (T &object : objects) {
+            give(std::move(object));
+        }
+        objects.clear();
+    }
+
+    size_t size() const { return free_.size(); }
+    size_t capacity() const { return capacity_; }
+    // Destroys the objects over the new capacity.
+    void setCapacity(size_t capacity) {
+        capacity_ = capacity;
+        if (free_.size() > capacity_) {
+            free_.resize(capacity_);
+        }
+    }
+    void clear() { free_.clear(); }
+
+    // Objects handed out by take(), reused ones and new ones.
+    size_t reused() const { return reused_; }
+    size_t created() const { return created_; }
+
+private:
+    std::vector<T> free_;
+    size_t capacity_;
+    size_t reused_ = 0;
+    size_t created_ = 0;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature>
+class QmlFunctionRef;
+
+// Non-owning reference to a callable, like a std::function that never
+// allocates. It stores a pointer to the callable, which must outlive the
+// reference; bind named lambdas or functor objects, not temporaries.
+template <typename R, typename... Args>
+class QmlFunctionRef<R(Args...)> {
+public:
+    QmlFunctionRef() = default;
+
+    template <typename F,
+              typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, QmlFunctionRef> &&
+                                          !std::is_function_v<std::remove_reference_t<F>> &&
+                                          std::is_invocable_r_v<R, F &, Args...>>>
+    QmlFunctionRef(F &&callable) noexcept
+        : object_(const_cast<void *>(static_cast<const void *>(std::addressof(callable)))),
+          call_([](void *object, Args... args) -> R {
+              return (*static_cast<std::remove_reference_t<F> *>(object))(std::forward<Args>(args)...);
+          }) {}
+
+    R operator()(Args... args) const { return call_(object_, std::forward<Args>(args)...); }
+    explicit operator bool() const { return call_ != nullptr; }
+
+private:
+    void *object_ = nullptr;
+    R (*call_)(void *, Args...) = nullptr;
+};
@@ -0,0 +1,359 @@
+#include "qml_index_service.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include "mapped_file.h"
+#include "qml_ast_cache.h"
+
+namespace {
+
+std::string keyOf(const std::string &path) {
+    std::error_code error;
+    const std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    return (error ? std::filesystem::path(path) : absolute).lexically_normal().string();
+}
+
+bool isHidden(const std::filesystem::path &path) {
+    const std::string name = path.filename().string();
+    return name.size() > 1 && name[0] == '.';
+}
+
+bool isQmlFile(const std::filesystem::directory_entry &entry) {
+    std::error_code error;
+    return entry.is_regular_file(error) && entry.path().extension() == ".qml";
+}
+
+bool isIdentifier(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' || ch == '$';
+}
+
+std::vector<std::string_view> splitFields(std::string_view line) {
+    std::vector<std::string_view> fields;
+    for (;;) {
+        const size_t tab = line.find('\t');
+        fields.push_back(line.substr(0, tab));
+        if (tab == std::string_view::npos) {
+            return fields;
+        }
+        line.remove_prefix(tab + 1);
+    }
+}
+
+bool parseNumber(std::string_view text, size_t &out) {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+void appendEscaped(std::string &out, std::string_view text) {
+    for (const char ch : text) {
+        switch (ch) {
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            break;
+        default:
+            out += ch;
+        }
+    }
+}
+
+std::string errorAnswer(std::string_view message) {
+    std::string out = "error\t";
+    appendEscaped(out, message);
+    out += "\n\n";
+    return out;
+}
+
+}  // namespace
+
+bool QmlIndexService::update(const std::string &path) {
+    const std::string key = keyOf(path);
+    MappedFile file;
+    if (!file.open(key)) {
+        remove(key);
+        return false;
+    }
+    const auto it = files_.find(key);
+    if (it == files_.end() || it->second.source != file.view()) {
+        update(key, std::string(file.view()));
+    }
+    return true;
+}
+
+void QmlIndexService::update(const std::string &path, std::string source) {
+    const std::string key = keyOf(path);
+    const auto [it, added] = files_.try_emplace(key);
+    File &file = it->second;
+    if (!added && file.source == source) {
+        return;
+    }
+    // Its imports, and the types resolved through them, may have changed.
+    project_.invalidate(key);
+    if (added) {
+        file.document = parser_.parseString(source);
+    } else {
+        const QmlTextEdit edit = QmlTextEdit::between(file.source, source);
+        file.document = parser_.reparse(std::move(file.document), file.source, edit);
+    }
+    store(file, std::move(source));
+    values_.update(key, file.document, QmlAstCache::contentHash(file.source));
+}
+
+void QmlIndexService::store(File &file, std::string source) {
+    file.source = std::move(source);
+    file.lineStarts.assign(1, 0);
+    for (size_t pos = file.source.find('\n'); pos != std::string::npos; pos = file.source.find('\n', pos + 1)) {
+        file.lineStarts.push_back(pos + 1);
+    }
+    file.objects.clear();
+    for (const QmlNode &node : file.document.nodes()) {
+        file.objects.push_back(&node);
+    }
+}
+
+void QmlIndexService::remove(const std::string &path) {
+    const std::string key = keyOf(path);
+    if (files_.erase(key) != 0) {
+        project_.invalidate(key);
+        values_.remove(key);
+    }
+}
+
+size_t QmlIndexService::addDirectory(const std::string &dir) {
+    size_t read = 0;
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(keyOf(dir), error), end; !error && it != end;
+         it.increment(error)) {
+        if (it->is_directory(error) && isHidden(it->path())) {
+            it.disable_recursion_pending();
+        } else if (isQmlFile(*it)) {
+            read += update(it->path().string()) ? 1 : 0;
+        }
+    }
+    return read;
+}
+
+size_t QmlIndexService::refreshDirectory(const std::string &dir) {
+    const std::string key = keyOf(dir);
+    const std::string prefix = (std::filesystem::path(key) / "").string();
+    std::error_code error;
+    auto it = files_.lower_bound(prefix);
+    while (it != files_.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+        if (!std::filesystem::exists(it->first, error)) {
+            project_.invalidate(it->first);
+            values_.remove(it->first);
+            it = files_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    size_t read = 0;
+    for (std::filesystem::directory_iterator entry(key, error), end; !error && entry != end; entry.increment(error)) {
+        if (isQmlFile(*entry)) {
+            read += update(entry->path().string()) ? 1 : 0;
+        } else if (entry->is_directory(error) && !isHidden(entry->path())) {
+            const std::string below = (entry->path() / "").string();
+            const auto held = files_.lower_bound(below);
+            if (held == files_.end() || held->first.compare(0, below.size(), below) != 0) {
+                read += addDirectory(entry->path().string());
+            }
+        }
+    }
+    return read;
+}
+
+QmlIndexMatch QmlIndexService::locate(const std::string &path, const File &file, const QmlNode &node,
+                                      std::string text) const {
+    const auto line = std::upper_bound(file.lineStarts.begin(), file.lineStarts.end(), node.sourceBegin);
+    const size_t lineStart = *(line - 1);
+    const size_t first = file.source.find_first_not_of(" \t", lineStart);
+    const size_t column = first == std::string::npos ? 0 : first - lineStart;
+    return QmlIndexMatch{path, static_cast<size_t>(line - file.lineStarts.begin()), column + 1, std::move(text)};
+}
+
+std::vector<QmlIndexMatch> QmlIndexService::findId(std::string_view id) const {
+    std::vector<QmlIndexMatch> matches;
+    const std::string wanted(id);
+    for (const auto &[path, file] : files_) {
+        if (const QmlNode *node = file.document.findById(wanted)) {
+            matches.push_back(locate(path, file, *node, node->type));
+        }
+    }
+    return matches;
+}
+
+std::vector<QmlIndexMatch> QmlIndexService::findType(std::string_view type) const {
+    std::vector<QmlIndexMatch> matches;
+    const QmlAtom atom = QmlAtomTable::global().find(type);
+    if (atom == QmlAtoms::Invalid) {
+        return matches;
+    }
+    for (const auto &[path, file] : files_) {
+        for (const QmlNode *node : file.document.nodesOfType(atom)) {
+            matches.push_back(locate(path, file, *node, node->id));
+        }
+    }
+    return matches;
+}
+
+std::vector<QmlIndexMatch> QmlIndexService::definition(const std::string &path, size_t line, size_t column) {
+    const std::string key = keyOf(path);
+    const auto it = files_.find(key);
+    if (it == files_.end() || line == 0 || line > it->second.lineStarts.size() || column == 0) {
+        return {};
+    }
+    const File &file = it->second;
+    const std::string_view source = file.source;
+    const size_t offset = std::min(file.lineStarts[line - 1] + column - 1, source.size());
+
+    size_t begin = offset;
+    while (begin > 0 && isIdentifier(source[begin - 1])) {
+        --begin;
+    }
+    size_t end = offset;
+    while (end < source.size() && isIdentifier(source[end])) {
+        ++end;
+    }
+    if (begin == end) {
+        return {};
+    }
+    const std::string_view word = source.substr(begin, end - begin);
+    std::string_view qualifier;
+    if (begin > 1 && source[begin - 1] == '.' && isIdentifier(source[begin - 2])) {
+        size_t qualifierBegin = begin - 1;
+        while (qualifierBegin > 0 && isIdentifier(source[qualifierBegin - 1])) {
+            --qualifierBegin;
+        }
+        qualifier = source.substr(qualifierBegin, begin - 1 - qualifierBegin);
+    }
+
+    // name.member: the object is what the id names.
+    const std::string name(qualifier.empty() ? word : qualifier);
+    if (const QmlNode *node = file.document.findById(name)) {
+        return {locate(key, file, *node, "id " + name)};
+    }
+
+    const std::string type = qualifier.empty() ? std::string(word) : name + '.' + std::string(word);
+    const std::string component = project_.componentFile(type, key);
+    if (component.empty()) {
+        return {};
+    }
+    const auto target = files_.find(component);
+    if (target != files_.end() && !target->second.document.roots.empty()) {
+        return {locate(component, target->second, target->second.document.roots[0], "component " + type)};
+    }
+    return {QmlIndexMatch{component, 1, 1, "component " + type}};
+}
+
+std::vector<QmlIndexMatch> QmlIndexService::bindings(const std::string &path, std::string_view id) const {
+    std::vector<QmlIndexMatch> matches;
+    const std::string key = keyOf(path);
+    const auto it = files_.find(key);
+    if (it == files_.end()) {
+        return matches;
+    }
+    const File &file = it->second;
+    const auto add = [&](const QmlNode &node) {
+        for (const QmlProperty &property : node.properties) {
+            std::string text(QmlAtomTable::global().name(property.key));
+            matches.push_back(locate(key, file, node, text.append(": ").append(property.value)));
+        }
+        for (const QmlScriptBlock &script : node.scripts) {
+            if (script.kind == QmlScriptKind::Handler) {
+                std::string text(QmlAtomTable::global().name(script.name));
+                matches.push_back(locate(key, file, node, text.append(": ").append(script.body(file.source))));
+            }
+        }
+    };
+    if (!id.empty()) {
+        if (const QmlNode *node = file.document.findById(std::string(id))) {
+            add(*node);
+        }
+        return matches;
+    }
+    for (const QmlNode &node : file.document.nodes()) {
+        add(node);
+    }
+    return matches;
+}
+
+std::vector<QmlIndexMatch> QmlIndexService::uses(std::string_view text) const {
+    std::vector<QmlIndexMatch> matches;
+    for (const QmlValueHit &hit : values_.find(text)) {
+        const File &file = files_.at(hit.path);
+        const QmlNode &node = *file.objects[hit.node];
+        const QmlProperty *property = node.findProperty(hit.key);
+        if (property && property->value.find(text) != std::string::npos) {
+            std::string found(QmlAtomTable::global().name(property->key));
+            matches.push_back(locate(hit.path, file, node, found.append(": ").append(property->value)));
+        }
+    }
+    return matches;
+}
+
+std::vector<std::string> QmlIndexService::files() const {
+    std::vector<std::string> paths;
+    paths.reserve(files_.size());
+    for (const auto &entry : files_) {
+        paths.push_back(entry.first);
+    }
+    return paths;
+}
+
+std::string QmlIndexService::answer(std::string_view request) {
+    if (!request.empty() && request.back() == '\r') {
+        request.remove_suffix(1);
+    }
+    const std::vector<std::string_view> fields = splitFields(request);
+    const std::string_view command = fields[0];
+    std::vector<QmlIndexMatch> matches;
+    if (command == "id" && fields.size() == 2) {
+        matches = findId(fields[1]);
+    } else if (command == "type" && fields.size() == 2) {
+        matches = findType(fields[1]);
+    } else if (command == "definition" && fields.size() == 4) {
+        size_t line = 0;
+        size_t column = 0;
+        if (!parseNumber(fields[2], line) || !parseNumber(fields[3], column)) {
+            return errorAnswer("expected definition PATH LINE COLUMN");
+        }
+        matches = definition(std::string(fields[1]), line, column);
+    } else if (command == "bindings" && (fields.size() == 2 || fields.size() == 3)) {
+        matches = bindings(std::string(fields[1]), fields.size() == 3 ? fields[2] : std::string_view());
+    } else if (command == "uses" && fields.size() == 2) {
+        matches = uses(fields[1]);
+    } else if (command == "update" && fields.size() == 2) {
+        if (!update(std::string(fields[1]))) {
+            return errorAnswer("cannot read " + std::string(fields[1]));
+        }
+    } else if (command == "files" && fields.size() == 1) {
+        for (const std::string &path : files()) {
+            matches.push_back(QmlIndexMatch{path, 1, 1, std::string()});
+        }
+    } else {
+        return errorAnswer("unknown request: " + std::string(request));
+    }
+
+    std::string out;
+    for (const QmlIndexMatch &match : matches) {
+        appendEscaped(out, match.path);
+        out.append("\t").append(std::to_string(match.line)).append("\t").append(std::to_string(match.column));
+        out += '\t';
+        appendEscaped(out, match.text);
+        out += '\n';
+    }
+    out += '\n';
+    return out;
+}
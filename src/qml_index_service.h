@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qml_parser.h"
+#include "qml_project_index.h"
+#include "qml_value_index.h"
+
+// A place in a held file; line and column are 1-based, columns count bytes.
+struct QmlIndexMatch {
+    std::string path;
+    size_t line = 0;
+    size_t column = 0;
+    std::string text;  // what matched, as each query describes
+};
+
+// Every QML file of a project, parsed and kept in memory for tools that
+// query it over and over, such as editors and linters; sample_cli
+// --index-server serves one over a local socket. update() reparses only
+// the object an edit falls in (see QmlParser::reparse), and queries are
+// answered from the documents' id and type indices, a QmlValueIndex over
+// their property values and a table of line starts per file, without
+// touching the disk.
+//
+// Objects are placed at the first non-blank of the line they open on.
+// Paths are made absolute and normalized. Not thread-safe; the server
+// calls it from its event loop only.
+class QmlIndexService {
+public:
+    // Reads and parses path, or reparses it against the text held for it.
+    // A file that cannot be read is dropped; returns false then.
+    bool update(const std::string &path);
+    // As update(path), with the text given, such as an unsaved buffer.
+    void update(const std::string &path, std::string source);
+    void remove(const std::string &path);
+    // Adds every .qml file under dir, skipping hidden directories. Returns
+    // the number of files read.
+    size_t addDirectory(const std::string &dir);
+    // Brings the files directly in dir in line with the disk: new and
+    // changed ones are parsed, deleted ones dropped, and subdirectories
+    // not held yet are added whole. Returns the number of files read.
+    size_t refreshDirectory(const std::string &dir);
+
+    // Objects with this id, in path order; text is their type.
+    std::vector<QmlIndexMatch> findId(std::string_view id) const;
+    // Objects of this type; text is their id, if any.
+    std::vector<QmlIndexMatch> findType(std::string_view type) const;
+    // What the identifier at line and column of path names: an id of the
+    // file ("id name"), the object of a qualified member such as
+    // name.text, or a component type ("component Type", at the root of
+    // its file). Empty if it names none of these.
+    std::vector<QmlIndexMatch> definition(const std::string &path, size_t line, size_t column);
+    // The properties of every object of path, or of the one with id; text
+    // is "key: value".
+    std::vector<QmlIndexMatch> bindings(const std::string &path, std::string_view id = {}) const;
+    // Properties whose value contains text, such as greeter.message or
+    // Say hello, found through the value index; text is "key: value".
+    std::vector<QmlIndexMatch> uses(std::string_view text) const;
+
+    // Answers one request line of the server's protocol. Fields are
+    // separated by tabs:
+    //
+    //   id NAME | type NAME | definition PATH LINE COLUMN |
+    //   bindings PATH [ID] | uses TEXT | update PATH | files
+    //
+    // The answer is a line of "path, line, column, text" per match, tabs
+    // and newlines in the text escaped as \t and \n, then an empty line.
+    // A bad request is answered with "error<TAB>message" instead.
+    std::string answer(std::string_view request);
+
+    std::vector<std::string> files() const;
+    size_t fileCount() const { return files_.size(); }
+    const QmlValueIndex &values() const { return values_; }
+
+private:
+    struct File {
+        std::string source;
+        QmlDocument document;
+        std::vector<size_t> lineStarts;
+        std::vector<const QmlNode *> objects;  // in pre-order, as the value index numbers them
+    };
+
+    QmlIndexMatch locate(const std::string &path, const File &file, const QmlNode &node, std::string text) const;
+    // Keeps source as file's text and indexes its lines and objects.
+    static void store(File &file, std::string source);
+
+    QmlParser parser_;
+    QmlProjectIndex project_;  // resolves component types
+    std::map<std::string, File> files_;
+    QmlValueIndex values_;
+};
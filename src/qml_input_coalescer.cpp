@@ -0,0 +1,106 @@
+#include "qml_input_coalescer.h"
+
+#include <utility>
+
+namespace {
+
+constexpr int kEscape = 27;
+constexpr std::string_view kMarkerPrefix = "\x1b[20";
+constexpr size_t kMarkerLength = kMarkerPrefix.size() + 2;  // then the digit and '~'
+
+bool isPrintable(int key) {
+    return key >= 0x20 && key < 0x100 && key != 127;
+}
+
+}  // namespace
+
+void QmlInputCoalescer::feed(const int *keys, size_t count) {
+    pending_.insert(pending_.end(), keys, keys + count);
+    size_t at = 0;
+    while (at < pending_.size()) {
+        const int key = pending_[at];
+        if (key == kEscape && !pasting_ && pending_.size() - at >= 3 && pending_[at + 1] == '[' &&
+            (pending_[at + 2] == 'I' || pending_[at + 2] == 'O')) {
+            push(Event::Kind::Focus, pending_[at + 2] == 'I' ? 1 : 0);
+            at += 3;
+            continue;
+        }
+        if (key == kEscape) {
+            int digit = 0;
+            const int marker = matchMarker(at, digit);
+            // Inside a paste even a lone ESC may start the closing marker.
+            if (marker == 0 && (pasting_ || pending_.size() - at >= 2)) {
+                break;
+            }
+            if (marker > 0) {
+                if (digit == 0 && !pasting_) {
+                    pasting_ = true;
+                    paste_.clear();
+                } else if (digit == 1 && pasting_) {
+                    pasting_ = false;
+                    push(Event::Kind::Text, 0);
+                    events_.back().text = std::move(paste_);
+                    events_.back().pasted = true;
+                    paste_.clear();
+                }
+                at += kMarkerLength;
+                continue;
+            }
+        }
+        if (pasting_) {
+            if (key >= 0 && key < 0x100) {
+                paste_.push_back(static_cast<char>(key));
+            }
+        } else if (isPrintable(key)) {
+            type(key);
+        } else {
+            push(Event::Kind::Key, key);
+        }
+        ++at;
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(at));
+}
+
+size_t QmlInputCoalescer::drain(QmlFunctionRef<void(const Event &event)> visit) {
+    const size_t count = events_.size();
+    for (const Event &event : events_) {
+        visit(event);
+    }
+    events_.clear();
+    return count;
+}
+
+void QmlInputCoalescer::type(int key) {
+    if (events_.empty() || events_.back().kind != Event::Kind::Text || events_.back().pasted) {
+        push(Event::Kind::Text, 0);
+    }
+    events_.back().text.push_back(static_cast<char>(key));
+}
+
+void QmlInputCoalescer::push(Event::Kind kind, int key) {
+    events_.emplace_back();
+    events_.back().kind = kind;
+    events_.back().key = key;
+}
+
+int QmlInputCoalescer::matchMarker(size_t at, int &digit) const {
+    for (size_t i = 0; i < kMarkerLength; ++i) {
+        if (at + i == pending_.size()) {
+            return 0;
+        }
+        const int key = pending_[at + i];
+        if (i < kMarkerPrefix.size()) {
+            if (key != kMarkerPrefix[i]) {
+                return -1;
+            }
+        } else if (i == kMarkerPrefix.size()) {
+            if (key != '0' && key != '1') {
+                return -1;
+            }
+            digit = key - '0';
+        } else if (key != '~') {
+            return -1;
+        }
+    }
+    return 1;
+}
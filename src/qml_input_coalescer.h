@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qml_function_ref.h"
+
+// Turns the curses key codes read from the terminal into the events the
+// frontend applies, so that a burst of input costs one text change and
+// one frame rather than one per key. Printable keys read together become
+// one Text event, and a bracketed paste, which terminals send between
+// ESC [200~ and ESC [201~ once kEnablePaste has been written to them,
+// becomes one Text event however many reads it spans: its keys are held
+// until the closing marker arrives. Other keys pass through one by one.
+//
+// With kEnableFocus written too, the terminal reports losing and gaining
+// focus as ESC [O and ESC [I, which become Focus events.
+//
+// Bytes are kept as read, so UTF-8 arrives whole in the text. A lone ESC
+// is the Escape key; ESC [ at the very end of a read is held in case the
+// rest of a paste marker or focus report follows in the next.
+class QmlInputCoalescer {
+public:
+    static constexpr std::string_view kEnablePaste = "\x1b[?2004h";
+    static constexpr std::string_view kDisablePaste = "\x1b[?2004l";
+    static constexpr std::string_view kEnableFocus = "\x1b[?1004h";
+    static constexpr std::string_view kDisableFocus = "\x1b[?1004l";
+
+    struct Event {
+        enum class Kind : uint8_t { Key, Text, Focus };
+
+        Kind kind = Kind::Key;
+        int key = 0;           // Key; for Focus, 1 when gained and 0 when lost
+        std::string text;      // Text, as UTF-8 bytes
+        bool pasted = false;   // Text from a bracketed paste
+    };
+
+    // Adds the keys of one read.
+    void feed(const int *keys, size_t count);
+    void feed(const std::vector<int> &keys) { feed(keys.data(), keys.size()); }
+
+    // Calls visit with each complete event in order, then forgets them.
+    // Returns the number visited.
+    size_t drain(QmlFunctionRef<void(const Event &event)> visit);
+
+    // Inside a paste whose closing marker has not arrived.
+    bool pasting() const { return pasting_; }
+
+private:
+    // Appends key to the typed text run, starting one if needed.
+    void type(int key);
+    void push(Event::Kind kind, int key);
+    // Matches the marker ESC [ 20<digit> ~ at pending_[at], whose final
+    // digit is returned in digit: 0 for an opening, 1 for a closing. -1
+    // when it cannot be one, 0 when the keys run out before it is settled.
+    int matchMarker(size_t at, int &digit) const;
+
+    std::vector<Event> events_;
+    std::vector<int> pending_;  // keys fed but not yet turned into events
+    std::string paste_;
+    bool pasting_ = false;
+};
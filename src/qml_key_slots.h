@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "qml_atoms.h"
+
+// Finds a key among the properties of the objects a builder has open, so
+// that a later assignment replaces the earlier one. A few properties are
+// searched in place; once an object has kScanned, its keys go into a hash
+// table, so an object with thousands of them still builds in linear time.
+// Only the innermost object of each nesting level is open, so there is one
+// table per level, emptied when its object closes. The tables are open
+// addressed and keep their buffers when emptied, so a builder that is
+// reused for the next parse stops allocating once it saw the largest object.
+class QmlKeySlots {
+public:
+    static constexpr size_t kScanned = 16;
+
+    // The index of key among the count properties of the object open at
+    // depth, whose keys keyAt(i) returns, or count if it has none; the
+    // caller then appends it there.
+    template <typename KeyAt>
+    size_t find(size_t depth, QmlAtom key, size_t count, const KeyAt &keyAt) {
+        if (count < kScanned || key == QmlAtoms::Invalid) {
+            for (size_t i = 0; i < count; ++i) {
+                if (keyAt(i) == key) {
+                    return i;
+                }
+            }
+            return count;
+        }
+        if (tables_.size() <= depth) {
+            tables_.resize(depth + 1);
+        }
+        Table &table = tables_[depth];
+        if (table.used == 0) {
+            for (size_t i = 0; i < count; ++i) {
+                if (keyAt(i) != QmlAtoms::Invalid) {
+                    table.insert(keyAt(i), i);
+                }
+            }
+        }
+        return table.insert(key, count);
+    }
+
+    void close(size_t depth) {
+        if (depth < tables_.size() && tables_[depth].used != 0) {
+            tables_[depth].clear();
+        }
+    }
+
+    // Empties every table, as if every object had closed.
+    void reset() {
+        for (size_t depth = 0; depth < tables_.size(); ++depth) {
+            close(depth);
+        }
+    }
+
+private:
+    struct Slot {
+        QmlAtom key = QmlAtoms::Invalid;  // Invalid marks a free slot
+        size_t index = 0;
+    };
+
+    struct Table {
+        std::vector<Slot> cells;  // a power of two, at most half full
+        size_t used = 0;
+
+        // The index stored for key, storing index first if there is none.
+        size_t insert(QmlAtom key, size_t index) {
+            if ((used + 1) * 2 > cells.size()) {
+                grow();
+            }
+            const size_t mask = cells.size() - 1;
+            for (size_t i = (key * size_t(0x9E3779B1u)) & mask;; i = (i + 1) & mask) {
+                Slot &slot = cells[i];
+                if (slot.key == key) {
+                    return slot.index;
+                }
+                if (slot.key == QmlAtoms::Invalid) {
+                    slot = Slot{key, index};
+                    ++used;
+                    return index;
+                }
+            }
+        }
+
+        void grow() {
+            std::vector<Slot> old(std::max<size_t>(cells.size() * 2, kScanned * 4));
+            old.swap(cells);
+            used = 0;
+            for (const Slot &slot : old) {
+                if (slot.key != QmlAtoms::Invalid) {
+                    insert(slot.key, slot.index);
+                }
+            }
+        }
+
+        void clear() {
+            std::fill(cells.begin(), cells.end(), Slot{});
+            used = 0;
+        }
+    };
+
+    std::vector<Table> tables_;
+};
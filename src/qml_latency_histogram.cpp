@@ -0,0 +1,74 @@
+#include "qml_latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Values below 16 ns get a bucket each. Above, a value whose highest set
+// bit is b lands in row b - 3, at the column given by its next four bits.
+size_t QmlLatencyHistogram::bucketOf(uint64_t nanos) {
+    constexpr uint64_t kSub = uint64_t(1) << kSubBits;
+    if (nanos < kSub) {
+        return static_cast<size_t>(nanos);
+    }
+    int top = 63;
+    while ((nanos >> top) == 0) {
+        --top;
+    }
+    const int shift = top - kSubBits;
+    return (static_cast<size_t>(shift + 1) << kSubBits) + static_cast<size_t>((nanos >> shift) - kSub);
+}
+
+uint64_t QmlLatencyHistogram::bucketUpperBound(size_t bucket) {
+    constexpr uint64_t kSub = uint64_t(1) << kSubBits;
+    if (bucket < kSub) {
+        return bucket;
+    }
+    const int shift = static_cast<int>(bucket >> kSubBits) - 1;
+    const uint64_t column = kSub + (bucket & (kSub - 1));
+    return ((column + 1) << shift) - 1;  // wraps to UINT64_MAX for the last bucket
+}
+
+void QmlLatencyHistogram::record(std::chrono::nanoseconds latency) {
+    const uint64_t nanos = static_cast<uint64_t>(std::max<int64_t>(0, latency.count()));
+    ++buckets_[bucketOf(nanos)];
+    ++count_;
+    min_ = std::min(min_, nanos);
+    max_ = std::max(max_, nanos);
+    sum_ += nanos;
+}
+
+void QmlLatencyHistogram::reset() {
+    *this = QmlLatencyHistogram();
+}
+
+std::chrono::nanoseconds QmlLatencyHistogram::mean() const {
+    return std::chrono::nanoseconds(count_ == 0 ? 0 : static_cast<int64_t>(sum_ / count_));
+}
+
+std::chrono::nanoseconds QmlLatencyHistogram::percentile(double q) const {
+    if (count_ == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    const auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count_))));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        seen += buckets_[bucket];
+        if (seen >= rank) {
+            return std::chrono::nanoseconds(static_cast<int64_t>(std::min(bucketUpperBound(bucket), max_)));
+        }
+    }
+    return max();
+}
+
+uint64_t QmlLatencyHistogram::countAtMost(std::chrono::nanoseconds bound) const {
+    if (bound.count() < 0) {
+        return 0;
+    }
+    const auto nanos = static_cast<uint64_t>(bound.count());
+    uint64_t count = 0;
+    for (size_t bucket = 0; bucket < kBuckets && bucketUpperBound(bucket) <= nanos; ++bucket) {
+        count += buckets_[bucket];
+    }
+    return nanos >= max_ ? count_ : count;
+}
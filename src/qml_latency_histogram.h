@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Distribution of durations in log-linear buckets: 16 per power of two,
+// so a reported percentile is within 1/16 (6.25%) of the sample it
+// stands for, over the whole range from nanoseconds to years, in a fixed
+// 8 KB and without allocating. Not thread-safe.
+class QmlLatencyHistogram {
+public:
+    void record(std::chrono::nanoseconds latency);
+    void reset();
+
+    uint64_t count() const { return count_; }
+    std::chrono::nanoseconds min() const { return std::chrono::nanoseconds(count_ == 0 ? 0 : min_); }
+    std::chrono::nanoseconds max() const { return std::chrono::nanoseconds(max_); }
+    std::chrono::nanoseconds mean() const;
+    // The upper bound of the bucket holding the sample at fraction q of the
+    // count (0.5 for p50, 0.99 for p99), capped at max(); 0 when empty.
+    // Rounding up keeps it on the safe side of an SLA.
+    std::chrono::nanoseconds percentile(double q) const;
+    // Samples in buckets wholly at or below bound, so within 1/16 of the
+    // number at or below it; the cumulative buckets of an exported
+    // histogram.
+    uint64_t countAtMost(std::chrono::nanoseconds bound) const;
+    // Of all samples, for an exported histogram's _sum.
+    std::chrono::duration<double> sum() const { return std::chrono::duration<double>(sum_ * 1e-9L); }
+
+private:
+    static constexpr int kSubBits = 4;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) << kSubBits;
+
+    static size_t bucketOf(uint64_t nanos);
+    static uint64_t bucketUpperBound(size_t bucket);
+
+    std::array<uint64_t, kBuckets> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+    long double sum_ = 0;
+};
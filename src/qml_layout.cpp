@@ -0,0 +1,209 @@
+#include "qml_layout.h"
+
+#include <algorithm>
+
+void QmlLayout::clear() {
+    nodes_.clear();
+}
+
+uint32_t QmlLayout::open(Kind kind, uint32_t parent, int spacing, int columns) {
+    Node node;
+    node.kind = kind;
+    node.parent = parent;
+    node.spacing = std::max(0, spacing);
+    node.columns = std::max(1, columns);
+    nodes_.push_back(node);
+    return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+void QmlLayout::close(uint32_t index) {
+    nodes_[index].end = static_cast<uint32_t>(nodes_.size());
+    if (nodes_[index].kind != Kind::Leaf) {
+        nodes_[index].height = contentHeight(index);
+    }
+}
+
+// A container's height from its children's.
+int QmlLayout::contentHeight(uint32_t index) {
+    const Node &node = nodes_[index];
+    int count = 0;
+    int height = 0;
+    switch (node.kind) {
+    case Kind::Leaf:
+        return node.height;
+    case Kind::Column:
+        for (uint32_t child = index + 1; child < node.end; child = nodes_[child].end, ++count) {
+            height += nodes_[child].height;
+        }
+        height += node.spacing * std::max(0, count - 1);
+        break;
+    case Kind::Row:
+        for (uint32_t child = index + 1; child < node.end; child = nodes_[child].end) {
+            height = std::max(height, nodes_[child].height);
+        }
+        break;
+    case Kind::Grid:
+        gridTracks(index);
+        for (const int rowHeight : rowHeights_) {
+            height += rowHeight;
+        }
+        height += node.spacing * std::max(0, static_cast<int>(rowHeights_.size()) - 1);
+        break;
+    }
+    return height;
+}
+
+uint32_t QmlLayout::addLeaf(uint32_t parent, uint32_t leaf) {
+    Node node;
+    node.parent = parent;
+    node.leaf = leaf;
+    node.end = static_cast<uint32_t>(nodes_.size() + 1);
+    nodes_.push_back(node);
+    return node.end - 1;
+}
+
+uint32_t QmlLayout::cloneSubtree(uint32_t index, uint32_t reuse) {
+    const uint32_t root = reuse == kNoParent ? static_cast<uint32_t>(nodes_.size()) : reuse;
+    const uint32_t end = nodes_[index].end;
+    if (reuse == kNoParent) {
+        nodes_.resize(nodes_.size() + (end - index));
+    }
+    for (uint32_t i = index; i < end; ++i) {
+        Node &node = nodes_[i - index + root];
+        node = nodes_[i];
+        node.end = node.end - index + root;
+        node.parent = i == index ? kNoParent : node.parent - index + root;
+    }
+    return root;
+}
+
+void QmlLayout::setLeafWidth(uint32_t index, int width) {
+    Node &node = nodes_[index];
+    node.dirty = false;
+    if (node.width == width) {
+        return;
+    }
+    node.width = width;
+    // Ancestors of a dirty container are already dirty.
+    for (uint32_t parent = node.parent; parent != kNoParent && !nodes_[parent].dirty; parent = nodes_[parent].parent) {
+        nodes_[parent].dirty = true;
+    }
+}
+
+bool QmlLayout::setLeafHeight(uint32_t index, int height) {
+    if (nodes_[index].height == height) {
+        return false;
+    }
+    nodes_[index].height = height;
+    for (uint32_t parent = nodes_[index].parent; parent != kNoParent; parent = nodes_[parent].parent) {
+        const int parentHeight = contentHeight(parent);
+        if (nodes_[parent].height == parentHeight) {
+            break;
+        }
+        nodes_[parent].height = parentHeight;
+    }
+    return true;
+}
+
+// Column widths from the children's measured widths, row heights from
+// their structural heights. Children are laid out row-major.
+void QmlLayout::gridTracks(uint32_t index) {
+    const Node &node = nodes_[index];
+    columnWidths_.assign(static_cast<size_t>(node.columns), 0);
+    rowHeights_.clear();
+    size_t cell = 0;
+    for (uint32_t child = index + 1; child < node.end; child = nodes_[child].end, ++cell) {
+        const size_t column = cell % columnWidths_.size();
+        if (column == 0) {
+            rowHeights_.push_back(0);
+        }
+        columnWidths_[column] = std::max(columnWidths_[column], nodes_[child].width);
+        rowHeights_.back() = std::max(rowHeights_.back(), nodes_[child].height);
+    }
+    if (cell < columnWidths_.size()) {
+        columnWidths_.resize(cell);
+    }
+}
+
+int QmlLayout::measure(uint32_t index) {
+    Node &node = nodes_[index];
+    if (node.kind == Kind::Leaf || !node.dirty) {
+        return node.width;
+    }
+    ++measureCount_;
+
+    int width = 0;
+    int count = 0;
+    for (uint32_t child = index + 1; child < node.end; child = nodes_[child].end, ++count) {
+        const int childWidth = measure(child);
+        if (node.kind == Kind::Column) {
+            width = std::max(width, childWidth);
+        } else if (node.kind == Kind::Row) {
+            width += childWidth;
+        }
+    }
+    if (node.kind == Kind::Row) {
+        width += node.spacing * std::max(0, count - 1);
+    } else if (node.kind == Kind::Grid) {
+        gridTracks(index);
+        for (const int columnWidth : columnWidths_) {
+            width += columnWidth;
+        }
+        width += node.spacing * std::max(0, static_cast<int>(columnWidths_.size()) - 1);
+    }
+    nodes_[index].width = width;
+    nodes_[index].dirty = false;
+    return width;
+}
+
+void QmlLayout::arrange(uint32_t index, int x, int y) {
+    Node &node = nodes_[index];
+    node.x = x;
+    node.y = y;
+    if (node.kind == Kind::Leaf) {
+        return;
+    }
+
+    // Place the direct children first, then recurse, so nested grids can
+    // reuse the track scratch space.
+    if (node.kind == Kind::Grid) {
+        gridTracks(index);
+    }
+    int cursor = node.kind == Kind::Row ? x : y;
+    size_t cell = 0;
+    int rowTop = y;
+    for (uint32_t child = index + 1; child < node.end; child = nodes_[child].end, ++cell) {
+        Node &item = nodes_[child];
+        switch (node.kind) {
+        case Kind::Column:
+            item.x = x + (node.width - item.width) / 2;
+            item.y = cursor;
+            cursor += item.height + node.spacing;
+            break;
+        case Kind::Row:
+            item.x = cursor;
+            item.y = y;
+            cursor += item.width + node.spacing;
+            break;
+        case Kind::Grid: {
+            const size_t column = cell % columnWidths_.size();
+            const size_t row = cell / columnWidths_.size();
+            if (column == 0) {
+                cursor = x;
+                if (row > 0) {
+                    rowTop += rowHeights_[row - 1] + node.spacing;
+                }
+            }
+            item.x = cursor;
+            item.y = rowTop;
+            cursor += columnWidths_[column] + node.spacing;
+            break;
+        }
+        case Kind::Leaf:
+            break;
+        }
+    }
+    for (uint32_t child = index + 1; child < node.end; child = nodes_[child].end) {
+        arrange(child, nodes_[child].x, nodes_[child].y);
+    }
+}
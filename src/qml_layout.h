@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Box layout for the curses frontend over a flat, preorder node array.
+// Every node's subtree is the contiguous range [index, end). Heights are
+// structural (a leaf is one row unless its text wraps), so they are
+// summed when a container is closed and only updated when a wrapped
+// leaf's line count changes; widths depend on the leaves' text and are
+// measured lazily.
+// measure() caches each container's width until one of its leaves
+// changes width, so a frame that changes one label re-measures just the
+// containers above it.
+class QmlLayout {
+public:
+    enum class Kind : uint8_t { Leaf, Column, Row, Grid };
+
+    static constexpr uint32_t kNoParent = UINT32_MAX;
+
+    struct Node {
+        Kind kind = Kind::Leaf;
+        bool dirty = true;  // width needs measuring
+        uint32_t parent = kNoParent;
+        uint32_t end = 0;    // one past the last node of the subtree
+        uint32_t leaf = 0;   // caller's index for leaves
+        int spacing = 0;     // between children, in cells
+        int columns = 1;     // Grid only
+        int width = 0;
+        int height = 1;
+        int x = 0;           // set by arrange()
+        int y = 0;
+    };
+
+    void clear();
+    // Containers are built by open(), their children, then close().
+    uint32_t open(Kind kind, uint32_t parent, int spacing, int columns = 1);
+    void close(uint32_t index);
+    uint32_t addLeaf(uint32_t parent, uint32_t leaf);
+    // Appends a copy of the closed subtree at index, with no parent, and
+    // returns its root. The copy is laid out and measured on its own. A
+    // reuse root of an earlier copy of the same subtree is overwritten
+    // instead of appending.
+    uint32_t cloneSubtree(uint32_t index, uint32_t reuse = kNoParent);
+
+    size_t size() const { return nodes_.size(); }
+    const Node &node(uint32_t index) const { return nodes_[index]; }
+
+    // Marks the containers above the leaf dirty if its width changed.
+    void setLeafWidth(uint32_t index, int width);
+    // Updates the heights of the containers above the leaf if its height
+    // changed, and returns whether it did.
+    bool setLeafHeight(uint32_t index, int height);
+    // Re-measures the dirty containers in the subtree; returns its width.
+    int measure(uint32_t index);
+    // Positions the measured subtree with its top-left corner at (x, y).
+    // Column children are centred horizontally; Row and Grid children are
+    // top-left aligned in their cells.
+    void arrange(uint32_t index, int x, int y);
+
+    // Number of container measurements since construction; lets tests
+    // check that clean subtrees are skipped.
+    size_t measureCount() const { return measureCount_; }
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<int> columnWidths_;
+    std::vector<int> rowHeights_;
+    size_t measureCount_ = 0;
+
+    void gridTracks(uint32_t index);
+    int contentHeight(uint32_t index);
+};
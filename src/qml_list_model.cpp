@@ -0,0 +1,112 @@
+#include "qml_list_model.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+void QmlListModel::addObserver(Observer *observer) {
+    observers_.push_back(observer);
+}
+
+void QmlListModel::removeObserver(Observer *observer) {
+    observers_.erase(std::remove(observers_.begin(), observers_.end(), observer), observers_.end());
+}
+
+void QmlListModel::notifyRowsInserted(size_t first, size_t count) {
+    for (Observer *observer : observers_) {
+        observer->rowsInserted(first, count);
+    }
+}
+
+void QmlListModel::notifyRowsRemoved(size_t first, size_t count) {
+    for (Observer *observer : observers_) {
+        observer->rowsRemoved(first, count);
+    }
+}
+
+void QmlListModel::notifyRowsMoved(size_t first, size_t count, size_t destination) {
+    for (Observer *observer : observers_) {
+        observer->rowsMoved(first, count, destination);
+    }
+}
+
+void QmlListModel::notifyDataChanged(size_t first, size_t count) {
+    for (Observer *observer : observers_) {
+        observer->dataChanged(first, count);
+    }
+}
+
+void QmlListModel::notifyModelReset() {
+    for (Observer *observer : observers_) {
+        observer->modelReset();
+    }
+}
+
+QmlBasicListModel::QmlBasicListModel(const std::vector<std::string> &roles) {
+    roles_.reserve(roles.size());
+    for (const std::string &role : roles) {
+        roles_.push_back(QmlAtomTable::global().intern(role));
+    }
+}
+
+size_t QmlBasicListModel::column(QmlAtom role) const {
+    return static_cast<size_t>(std::find(roles_.begin(), roles_.end(), role) - roles_.begin());
+}
+
+bool QmlBasicListModel::data(size_t row, QmlAtom role, std::string &value) const {
+    const size_t index = column(role);
+    if (index == roles_.size() || row >= rowCount()) {
+        return false;
+    }
+    value.append(values_[row * roles_.size() + index]);
+    return true;
+}
+
+void QmlBasicListModel::insertRow(size_t row, std::vector<std::string> values) {
+    row = std::min(row, rowCount());
+    values.resize(roles_.size());
+    values_.insert(values_.begin() + static_cast<std::ptrdiff_t>(row * roles_.size()),
+                   std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+    notifyRowsInserted(row, 1);
+}
+
+void QmlBasicListModel::removeRows(size_t first, size_t count) {
+    count = std::min(count, rowCount() - std::min(first, rowCount()));
+    if (count == 0) {
+        return;
+    }
+    const auto begin = values_.begin() + static_cast<std::ptrdiff_t>(first * roles_.size());
+    values_.erase(begin, begin + static_cast<std::ptrdiff_t>(count * roles_.size()));
+    notifyRowsRemoved(first, count);
+}
+
+void QmlBasicListModel::moveRows(size_t first, size_t count, size_t destination) {
+    const size_t rows = rowCount();
+    if (count == 0 || first + count > rows || destination + count > rows || destination == first) {
+        return;
+    }
+    const auto at = [this](size_t row) { return values_.begin() + static_cast<std::ptrdiff_t>(row * roles_.size()); };
+    if (destination < first) {
+        std::rotate(at(destination), at(first), at(first + count));
+    } else {
+        std::rotate(at(first), at(first + count), at(destination + count));
+    }
+    notifyRowsMoved(first, count, destination);
+}
+
+void QmlBasicListModel::setData(size_t row, std::string_view role, std::string value) {
+    const size_t index = column(QmlAtomTable::global().find(role));
+    if (index == roles_.size() || row >= rowCount()) {
+        return;
+    }
+    std::string &current = values_[row * roles_.size() + index];
+    if (current != value) {
+        current = std::move(value);
+        notifyDataChanged(row, 1);
+    }
+}
+
+void QmlBasicListModel::clear() {
+    values_.clear();
+    notifyModelReset();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qml_atoms.h"
+
+// Rows of named values behind a Repeater or ListView, in the spirit of
+// QAbstractItemModel but without Qt. A delegate reads a row's values as
+// model.<role>. Models report each change to their observers after making
+// it, with the row numbers as they are once it is made, so an observer
+// can patch what it built from the rows instead of rebuilding it.
+class QmlListModel {
+public:
+    class Observer {
+    public:
+        virtual void rowsInserted(size_t first, size_t count) = 0;
+        virtual void rowsRemoved(size_t first, size_t count) = 0;
+        // The count rows that were at first now start at destination.
+        virtual void rowsMoved(size_t first, size_t count, size_t destination) = 0;
+        virtual void dataChanged(size_t first, size_t count) = 0;
+        // Anything may have changed.
+        virtual void modelReset() = 0;
+
+    protected:
+        ~Observer() = default;
+    };
+
+    virtual ~QmlListModel() = default;
+
+    virtual size_t rowCount() const = 0;
+    // Writes the value of role in row into value, which arrives cleared and
+    // keeps its capacity. Returns false if the model has no such role.
+    virtual bool data(size_t row, QmlAtom role, std::string &value) const = 0;
+
+    // Observers are not owned and must be removed before they are gone.
+    void addObserver(Observer *observer);
+    void removeObserver(Observer *observer);
+
+protected:
+    void notifyRowsInserted(size_t first, size_t count);
+    void notifyRowsRemoved(size_t first, size_t count);
+    void notifyRowsMoved(size_t first, size_t count, size_t destination);
+    void notifyDataChanged(size_t first, size_t count);
+    void notifyModelReset();
+
+private:
+    std::vector<Observer *> observers_;
+};
+
+// A QmlListModel that keeps its rows in memory, one string per role.
+class QmlBasicListModel : public QmlListModel {
+public:
+    explicit QmlBasicListModel(const std::vector<std::string> &roles);
+
+    size_t rowCount() const override { return roles_.empty() ? 0 : values_.size() / roles_.size(); }
+    bool data(size_t row, QmlAtom role, std::string &value) const override;
+
+    // values are in the order of the roles; missing ones are empty.
+    void insertRow(size_t row, std::vector<std::string> values);
+    void appendRow(std::vector<std::string> values) { insertRow(rowCount(), std::move(values)); }
+    void removeRows(size_t first, size_t count);
+    void moveRows(size_t first, size_t count, size_t destination);
+    // Notifies only if the value changed. Unknown roles are ignored.
+    void setData(size_t row, std::string_view role, std::string value);
+    void clear();
+
+private:
+    size_t column(QmlAtom role) const;
+
+    std::vector<QmlAtom> roles_;
+    std::vector<std::string> values_;  // row-major
+};
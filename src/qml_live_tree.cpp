@@ -0,0 +1,266 @@
+#include "qml_live_tree.h"
+
+#include <QMetaMethod>
+#include <QQmlListReference>
+#include <QVariant>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// The frontend's element for the C++ class behind an item, most derived
+// first, so a Label is not taken for the Text it derives from.
+QmlAtom liveType(const QMetaObject *meta) {
+    static const std::pair<const char *, QmlAtom> kTypes[] = {
+        {"QQuickWindow", QmlAtoms::ApplicationWindow},
+        {"QQuickColumn", QmlAtoms::Column},
+        {"QQuickRow", QmlAtoms::Row},
+        {"QQuickGrid", QmlAtoms::Grid},
+        {"QQuickListView", QmlAtoms::ListView},
+        {"QQuickLabel", QmlAtoms::Label},
+        {"QQuickText", QmlAtoms::Text},
+        {"QQuickTextInput", QmlAtoms::TextField},  // TextField derives from it
+        {"QQuickAbstractButton", QmlAtoms::Button},
+        {"QQuickBusyIndicator", QmlAtoms::BusyIndicator},
+    };
+    for (; meta != nullptr; meta = meta->superClass()) {
+        for (const auto &[className, type] : kTypes) {
+            if (std::strcmp(meta->className(), className) == 0) {
+                return type;
+            }
+        }
+    }
+    return QmlAtoms::Invalid;
+}
+
+QObject *objectProperty(const QObject *object, const char *name) {
+    return object->property(name).value<QObject *>();
+}
+
+// Visual children, in stacking order.
+std::vector<QObject *> childItems(QObject *item) {
+    std::vector<QObject *> items;
+    const QQmlListReference children(item, "children");
+    if (children.isValid()) {
+        items.reserve(static_cast<size_t>(children.count()));
+        for (qsizetype i = 0; i < children.count(); ++i) {
+            items.push_back(children.at(i));
+        }
+    }
+    return items;
+}
+
+bool isIdentifier(const QString &name) {
+    if (name.isEmpty() || name.front().isDigit()) {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [](QChar ch) { return ch.isLetterOrNumber() || ch == u'_'; });
+}
+
+void setBinding(QmlNode &node, QmlAtom key, const std::string &name) {
+    node.setProperty(key, name + '.' + std::string(QmlAtomTable::global().name(key)),
+                     QmlValue{QmlValueKind::Binding});
+}
+
+void setLiteral(QmlNode &node, QmlAtom key, const std::string &value) {
+    node.setProperty(key, value, QmlValue::classify(value));
+}
+
+}  // namespace
+
+QmlLiveTree::QmlLiveTree(QObject *root, QObject *parent)
+    : QObject(parent),
+      bridge_(resolver_),
+      root_(root),
+      structureSlot_(staticMetaObject.indexOfSlot("onStructureChanged()")) {}
+
+QmlLiveTree::~QmlLiveTree() {
+    for (const QMetaObject::Connection &connection : watched_) {
+        disconnect(connection);
+    }
+}
+
+QObject *QmlLiveTree::object(const std::string &id) const {
+    const auto found = objects_.find(id);
+    return found == objects_.end() ? nullptr : found->second.data();
+}
+
+void QmlLiveTree::onStructureChanged() {
+    if (stale_) {
+        return;
+    }
+    stale_ = true;
+    if (structureChanged_) {
+        structureChanged_();
+    }
+}
+
+const QmlDocument &QmlLiveTree::document() {
+    if (!stale_) {
+        return document_;
+    }
+    stale_ = false;
+    ++rebuildCount_;
+    for (const QMetaObject::Connection &connection : watched_) {
+        disconnect(connection);
+    }
+    watched_.clear();
+
+    QmlNode top;
+    if (root_) {
+        mirror(root_, top);
+    }
+    document_.roots = std::move(top.children);
+    document_.reindex();
+    return document_;
+}
+
+const std::string &QmlLiveTree::nameOf(QObject *object) {
+    const auto known = names_.find(object);
+    if (known != names_.end()) {
+        return known->second;
+    }
+    std::string name;
+    const QString objectName = object->objectName();
+    if (isIdentifier(objectName) && objects_.count(objectName.toStdString()) == 0) {
+        name = objectName.toStdString();
+    } else {
+        do {
+            name = "item" + std::to_string(nextName_++);
+        } while (objects_.count(name) != 0);
+    }
+    objects_.emplace(name, object);
+    bridge_.addObject(name, object);
+    resolver_.addObject(name, object);
+    // Dropped with the item, so the maps do not grow with every delegate
+    // created and its name is free again.
+    connect(object, &QObject::destroyed, this, [this, object] {
+        const auto gone = names_.find(object);
+        if (gone != names_.end()) {
+            objects_.erase(gone->second);
+            names_.erase(gone);
+        }
+    });
+    return names_.emplace(object, std::move(name)).first->second;
+}
+
+void QmlLiveTree::watch(QObject *object, const char *signal) {
+    const QMetaObject *meta = object->metaObject();
+    const int index = meta->indexOfSignal(signal);
+    if (index >= 0) {
+        watched_.push_back(connect(object, meta->method(index), this, staticMetaObject.method(structureSlot_)));
+    }
+}
+
+void QmlLiveTree::mirror(QObject *object, QmlNode &parent) {
+    const QmlAtom type = liveType(object->metaObject());
+    if (type == QmlAtoms::ApplicationWindow) {
+        QmlNode &node = parent.children.emplace_back();
+        node.setType("ApplicationWindow");
+        node.id = nameOf(object);
+        setBinding(node, QmlAtoms::title, node.id);
+        if (QObject *content = objectProperty(object, "contentItem")) {
+            mirrorChildren(content, node);
+        }
+        return;
+    }
+
+    watch(object, "visibleChanged()");
+    if (!object->property("visible").toBool()) {
+        return;
+    }
+    if (type == QmlAtoms::Invalid) {
+        mirrorChildren(object, parent);
+        return;
+    }
+
+    QmlNode &node = parent.children.emplace_back();
+    node.id = nameOf(object);
+    if (type == QmlAtoms::ListView) {
+        // Its delegates, as a Column: the frontend's own ListView draws a model.
+        node.setType("Column");
+        setLiteral(node, QmlAtoms::spacing, "0");
+        mirrorView(object, node);
+        return;
+    }
+    node.setType(QmlAtomTable::global().name(type));
+    if (type == QmlAtoms::Column || type == QmlAtoms::Row || type == QmlAtoms::Grid) {
+        // Pixels apart is one cell apart.
+        setLiteral(node, QmlAtoms::spacing, object->property("spacing").toReal() > 0 ? "1" : "0");
+        if (type == QmlAtoms::Grid) {
+            setLiteral(node, QmlAtoms::columns, std::to_string(object->property("columns").toInt()));
+        }
+        const QObject *anchors = objectProperty(object, "anchors");
+        if (anchors && objectProperty(anchors, "centerIn")) {
+            setLiteral(node, QmlAtoms::anchorsCenterIn, "parent");
+        }
+        mirrorChildren(object, node);
+    } else if (type == QmlAtoms::TextField) {
+        setBinding(node, QmlAtoms::text, node.id);
+        setBinding(node, QmlAtoms::placeholderText, node.id);
+        if (object->property("focus").toBool()) {
+            setLiteral(node, QmlAtoms::focus, "true");
+        }
+        node.scripts.push_back(QmlScriptBlock{QmlScriptKind::Handler, QmlAtoms::onAccepted, {}, 0, 0});
+    } else if (type == QmlAtoms::Button) {
+        setBinding(node, QmlAtoms::text, node.id);
+        node.scripts.push_back(QmlScriptBlock{QmlScriptKind::Handler, QmlAtoms::onClicked, {}, 0, 0});
+    } else if (type == QmlAtoms::Text || type == QmlAtoms::Label) {
+        setBinding(node, QmlAtoms::text, node.id);
+    }
+}
+
+void QmlLiveTree::mirrorChildren(QObject *item, QmlNode &node) {
+    watch(item, "childrenChanged()");
+    for (QObject *child : childItems(item)) {
+        mirror(child, node);
+    }
+}
+
+// Only the delegates in view, top to bottom; pooled ones are hidden.
+void QmlLiveTree::mirrorView(QObject *view, QmlNode &node) {
+    watch(view, "contentYChanged()");
+    watch(view, "heightChanged()");
+    QObject *content = objectProperty(view, "contentItem");
+    if (!content) {
+        return;
+    }
+    watch(content, "childrenChanged()");
+    const qreal top = view->property("contentY").toReal();
+    const qreal bottom = top + view->property("height").toReal();
+    std::vector<std::pair<qreal, QObject *>> delegates;
+    for (QObject *child : childItems(content)) {
+        const qreal y = child->property("y").toReal();
+        if (y < bottom && y + child->property("height").toReal() > top) {
+            delegates.emplace_back(y, child);
+        }
+    }
+    std::stable_sort(delegates.begin(), delegates.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+    for (const auto &[y, delegate] : delegates) {
+        watch(delegate, "yChanged()");
+        mirror(delegate, node);
+    }
+}
+
+void QmlLiveTree::textEdited(const std::string &id, const std::string &text) {
+    if (QObject *target = object(id)) {
+        target->setProperty("text", QString::fromStdString(text));
+    }
+}
+
+void QmlLiveTree::activate(const std::string &id, const QmlScriptBlock &script) {
+    QObject *target = object(id);
+    if (!target) {
+        return;
+    }
+    if (script.name == QmlAtoms::onClicked) {
+        // click() runs the press and release a mouse would, where there is one.
+        if (!QMetaObject::invokeMethod(target, "click")) {
+            QMetaObject::invokeMethod(target, "clicked");
+        }
+    } else if (script.name == QmlAtoms::onAccepted) {
+        QMetaObject::invokeMethod(target, "accepted");
+    }
+}
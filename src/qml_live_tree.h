@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "qml_meta_resolver.h"
+#include "qml_notify_bridge.h"
+#include "qml_parser.h"
+
+// Curses view of a live QML object tree, e.g. a window the QML engine
+// created on the offscreen platform. document() mirrors the visible items
+// the frontend can draw (window, Column/Row/Grid, Text/Label, TextField,
+// Button, BusyIndicator, a ListView's delegates in order) as a QmlDocument
+// whose text-like properties are bindings on the items themselves, such as
+// "greetingText.text"; other items are see-through and their children take
+// their place. The bindings resolve through a QmlMetaResolver wrapped in a
+// QmlNotifyBridge, so the values drawn are the ones the engine evaluated,
+// and each NOTIFY the engine emits reaches the changed handler, to
+// invalidate that binding and the cells drawn from it. Items added,
+// removed, shown or hidden, and scrolled views, only mark the mirror stale:
+// the structure handler is called and the next document() rebuilds it.
+//
+// Items are named by objectName when it is free, "item<N>" otherwise; a
+// name is not given to another item while its item lives, and "item<N>"
+// names are never reused. Styles are left to the terminal.
+class QmlLiveTree : public QObject {
+    Q_OBJECT
+
+public:
+    explicit QmlLiveTree(QObject *root, QObject *parent = nullptr);
+    ~QmlLiveTree() override;
+
+    // The frontend's BindingWriter; pass it by reference. Typically its
+    // changed handler calls QmlCursesFrontend::invalidateBinding().
+    QmlNotifyBridge &bridge() { return bridge_; }
+    // Typically requests a frame.
+    void setStructureChangedHandler(std::function<void()> handler) { structureChanged_ = std::move(handler); }
+
+    // Rebuilt first if the tree changed since the last call.
+    const QmlDocument &document();
+    size_t rebuildCount() const { return rebuildCount_; }
+    QObject *object(const std::string &id) const;
+
+    // For QmlCursesFrontend::setTextEditedHandler() and setActionHandler():
+    // edits write the item's text, and activating a Button clicks it, a
+    // TextField's Enter accepts it, through the engine.
+    void textEdited(const std::string &id, const std::string &text);
+    void activate(const std::string &id, const QmlScriptBlock &script);
+
+private slots:
+    void onStructureChanged();
+
+private:
+    void mirror(QObject *object, QmlNode &parent);
+    void mirrorChildren(QObject *item, QmlNode &node);
+    void mirrorView(QObject *view, QmlNode &node);
+    void watch(QObject *object, const char *signal);
+    const std::string &nameOf(QObject *object);
+
+    QmlMetaResolver resolver_;
+    QmlNotifyBridge bridge_;  // wraps resolver_
+    QPointer<QObject> root_;
+    QmlDocument document_;
+    bool stale_ = true;
+    size_t rebuildCount_ = 0;
+    std::function<void()> structureChanged_;
+    std::unordered_map<const QObject *, std::string> names_;
+    std::unordered_map<std::string, QPointer<QObject>> objects_;  // every living item's name
+    uint32_t nextName_ = 0;
+    std::vector<QMetaObject::Connection> watched_;  // structure signals of the current mirror
+    int structureSlot_;
+};
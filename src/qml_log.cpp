@@ -0,0 +1,265 @@
+#include "qml_log.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One thread's records, a single-producer single-consumer ring: only the
+// owning thread advances head, after writing the slot, and only a drain
+// advances tail, after reading it. They sit on lines of their own so the
+// two sides do not share one.
+struct QmlLog::Buffer {
+    explicit Buffer(uint32_t id) : id(id), records(kCapacity) {}
+
+    std::atomic<uint32_t> id;  // changes when another thread takes it over
+    std::vector<Record> records;
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> reported{0};  // of dropped, by drains
+    std::atomic<bool> retired{false};   // its thread has exited
+};
+
+// Buffers outlive their threads, so a pool's last records are still
+// written after it has been joined. Once they have been, a new thread
+// takes the buffer over, so threads that come and go reuse a few buffers
+// rather than each leaving one behind. The mutex is taken once per thread,
+// on its first record, and by drains, which the drain mutex serialises so
+// flush() may run beside the writer thread.
+struct QmlLog::Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    uint32_t lastId = 0;
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    std::mutex drain;
+    Sink sink;
+    std::vector<Buffer *> draining;
+    std::vector<std::pair<Record, uint32_t>> batch;  // with the thread's id
+    std::string text;
+
+    std::mutex control;  // of the writer thread
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread writer;
+};
+
+std::atomic<uint8_t> QmlLog::threshold_{QmlLog::kOff};
+thread_local QmlLog::Buffer *QmlLog::buffer_ = nullptr;
+
+namespace {
+
+constexpr const char *kLevelNames[] = {"debug", "info", "warning", "error"};
+
+// What a drain reports for a thread whose buffer filled up.
+constexpr const char *kDroppedFormat = "{} log records dropped; the buffer was full";
+
+// Marks the thread's buffer retired when the thread exits.
+struct RetireOnExit {
+    std::atomic<bool> *retired = nullptr;
+
+    ~RetireOnExit() {
+        if (retired) {
+            retired->store(true, std::memory_order_release);
+        }
+    }
+};
+
+int64_t nanosSince(std::chrono::steady_clock::time_point epoch) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+}  // namespace
+
+QmlLog::Registry &QmlLog::registry() {
+    static Registry instance;
+    return instance;
+}
+
+QmlLog::Record *QmlLog::claim() {
+    Registry &r = registry();
+    if (buffer_ == nullptr) {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto &buffer : r.buffers) {
+            // Drained of its records and its drop count, so no drain
+            // still attributes anything in it to the old thread.
+            if (buffer->retired.load(std::memory_order_acquire) &&
+                buffer->tail.load(std::memory_order_acquire) == buffer->head.load(std::memory_order_relaxed) &&
+                buffer->reported.load(std::memory_order_acquire) == buffer->dropped.load(std::memory_order_relaxed)) {
+                buffer->retired.store(false, std::memory_order_relaxed);
+                buffer->id.store(++r.lastId, std::memory_order_relaxed);
+                buffer_ = buffer.get();
+                break;
+            }
+        }
+        if (buffer_ == nullptr) {
+            r.buffers.push_back(std::make_unique<Buffer>(++r.lastId));
+            buffer_ = r.buffers.back().get();
+        }
+        thread_local RetireOnExit retire;
+        retire.retired = &buffer_->retired;
+    }
+    const uint64_t head = buffer_->head.load(std::memory_order_relaxed);
+    if (head - buffer_->tail.load(std::memory_order_acquire) == kCapacity) {
+        buffer_->dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Record &record = buffer_->records[head % kCapacity];
+    record.at = nanosSince(r.epoch);
+    return &record;
+}
+
+void QmlLog::publish() {
+    buffer_->head.store(buffer_->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void QmlLog::start(Sink sink, QmlLogLevel level, std::chrono::milliseconds interval) {
+    stop();
+    Registry &r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.drain);
+        r.sink = std::move(sink);
+    }
+    r.stopping = false;
+    threshold_.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    r.writer = std::thread([&r, interval] {
+        std::unique_lock<std::mutex> lock(r.control);
+        while (!r.stopping) {
+            r.wake.wait_for(lock, interval, [&r] { return r.stopping; });
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    });
+}
+
+void QmlLog::stop() {
+    threshold_.store(kOff, std::memory_order_relaxed);
+    Registry &r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.control);
+        r.stopping = true;
+    }
+    r.wake.notify_all();
+    if (r.writer.joinable()) {
+        r.writer.join();
+    }
+    drain();
+    std::lock_guard<std::mutex> lock(r.drain);
+    r.sink = nullptr;
+}
+
+void QmlLog::flush() {
+    drain();
+}
+
+QmlLog::Sink QmlLog::fileSink(std::FILE *file) {
+    return [file](std::string_view text) {
+        std::fwrite(text.data(), 1, text.size(), file);
+        std::fflush(file);
+    };
+}
+
+size_t QmlLog::bufferCount() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.buffers.size();
+}
+
+uint64_t QmlLog::dropped() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    uint64_t dropped = 0;
+    for (const auto &buffer : r.buffers) {
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void QmlLog::drain() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> drainLock(r.drain);
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.draining.clear();
+        for (const auto &buffer : r.buffers) {
+            r.draining.push_back(buffer.get());
+        }
+    }
+    r.batch.clear();
+    for (Buffer *buffer : r.draining) {
+        const uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i < head; ++i) {
+            r.batch.emplace_back(buffer->records[i % kCapacity], buffer->id.load(std::memory_order_relaxed));
+        }
+        buffer->tail.store(head, std::memory_order_release);
+        const uint64_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+        const uint64_t reported = buffer->reported.load(std::memory_order_relaxed);
+        if (dropped != reported) {
+            Record record;
+            record.at = nanosSince(r.epoch);
+            record.level = QmlLogLevel::Warning;
+            record.format = kDroppedFormat;
+            put(record, dropped - reported);
+            r.batch.emplace_back(record, buffer->id.load(std::memory_order_relaxed));
+            buffer->reported.store(dropped, std::memory_order_release);
+        }
+    }
+    if (r.batch.empty() || !r.sink) {
+        return;
+    }
+    // Each thread's records are in order already; this interleaves them.
+    std::stable_sort(r.batch.begin(), r.batch.end(),
+                     [](const auto &a, const auto &b) { return a.first.at < b.first.at; });
+    r.text.clear();
+    for (const auto &entry : r.batch) {
+        const Record &record = entry.first;
+        char prefix[64];
+        std::snprintf(prefix, sizeof prefix, "%lld.%06lld %s t%u: ", static_cast<long long>(record.at / 1000000000),
+                      static_cast<long long>(record.at / 1000 % 1000000),
+                      kLevelNames[static_cast<size_t>(record.level)], entry.second);
+        r.text.append(prefix);
+        appendText(r.text, record);
+        r.text.push_back('\n');
+    }
+    r.sink(r.text);
+}
+
+void QmlLog::appendText(std::string &out, const Record &record) {
+    size_t arg = 0;
+    for (const char *ch = record.format; *ch != '\0'; ++ch) {
+        if (ch[0] != '{' || ch[1] != '}' || arg == record.count) {
+            out.push_back(*ch);
+            continue;
+        }
+        ++ch;
+        const uint64_t value = record.values[arg];
+        char number[32];
+        switch (record.types[arg++]) {
+        case ArgType::Bool:
+            out.append(value != 0 ? "true" : "false");
+            break;
+        case ArgType::Int:
+            std::snprintf(number, sizeof number, "%lld", static_cast<long long>(static_cast<int64_t>(value)));
+            out.append(number);
+            break;
+        case ArgType::UInt:
+            std::snprintf(number, sizeof number, "%llu", static_cast<unsigned long long>(value));
+            out.append(number);
+            break;
+        case ArgType::Double: {
+            double real;
+            std::memcpy(&real, &value, sizeof real);
+            std::snprintf(number, sizeof number, "%g", real);
+            out.append(number);
+            break;
+        }
+        case ArgType::Text:
+            out.append(record.text + (value & 0xffffffffu), static_cast<size_t>(value >> 32));
+            break;
+        }
+    }
+}
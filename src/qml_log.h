@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class QmlLogLevel : uint8_t { Debug, Info, Warning, Error };
+
+// Structured logging that keeps formatting and I/O off the logging thread.
+// A call stores a binary record, its timestamp, format string and raw
+// arguments, in the calling thread's own fixed-size ring buffer, without
+// locking or allocating; a writer thread started by start() collects the
+// records of every thread, orders them by time, formats them and hands the
+// text to a sink. A full buffer drops the record and counts it rather than
+// wait, and the writer reports the count.
+//
+// The format must be a string literal: its address is the record's format
+// id. Each {} in it is replaced by the next argument, which may be a bool,
+// a char, an integer, a floating-point number or a string. Strings are copied, up
+// to kTextBytes per record in all; longer ones are cut short.
+//
+// Logging is off until start(); a call then costs one relaxed atomic load.
+class QmlLog {
+public:
+    static constexpr size_t kCapacity = 1 << 12;  // records per thread
+    static constexpr size_t kMaxArgs = 6;
+    static constexpr size_t kTextBytes = 48;
+
+    using Sink = std::function<void(std::string_view text)>;
+
+    // Starts the writer thread, which passes whatever has been logged at
+    // level or above to sink every interval, a batch of lines at a time.
+    // A running writer is stopped first.
+    static void start(Sink sink, QmlLogLevel level = QmlLogLevel::Info,
+                      std::chrono::milliseconds interval = std::chrono::milliseconds(50));
+    // Stops logging, writes out what is left and joins the writer thread.
+    static void stop();
+    // Writes out everything logged so far, on the calling thread.
+    static void flush();
+    // A sink writing to file, which must stay open until stop().
+    static Sink fileSink(std::FILE *file);
+
+    static bool enabled(QmlLogLevel level) {
+        return static_cast<uint8_t>(level) >= threshold_.load(std::memory_order_relaxed);
+    }
+    // Records dropped because their thread's buffer was full.
+    static uint64_t dropped();
+    // Ring buffers allocated so far. A thread's is handed to a later
+    // thread once the thread has exited and its records are written out.
+    static size_t bufferCount();
+
+    template <typename... Args>
+    static void write(QmlLogLevel level, const char *format, const Args &...args) {
+        static_assert(sizeof...(Args) <= kMaxArgs, "too many log arguments");
+        if (!enabled(level)) {
+            return;
+        }
+        Record *record = claim();
+        if (record == nullptr) {
+            return;
+        }
+        record->level = level;
+        record->format = format;
+        record->count = 0;
+        record->textUsed = 0;
+        (put(*record, args), ...);
+        publish();
+    }
+
+    template <typename... Args>
+    static void debug(const char *format, const Args &...args) {
+        write(QmlLogLevel::Debug, format, args...);
+    }
+    template <typename... Args>
+    static void info(const char *format, const Args &...args) {
+        write(QmlLogLevel::Info, format, args...);
+    }
+    template <typename... Args>
+    static void warning(const char *format, const Args &...args) {
+        write(QmlLogLevel::Warning, format, args...);
+    }
+    template <typename... Args>
+    static void error(const char *format, const Args &...args) {
+        write(QmlLogLevel::Error, format, args...);
+    }
+
+    // Formats format with the arguments as the writer would; for tests.
+    template <typename... Args>
+    static std::string format(const char *format, const Args &...args) {
+        static_assert(sizeof...(Args) <= kMaxArgs, "too many log arguments");
+        Record record;
+        record.format = format;
+        (put(record, args), ...);
+        std::string text;
+        appendText(text, record);
+        return text;
+    }
+
+private:
+    enum class ArgType : uint8_t { Bool, Int, UInt, Double, Text };
+
+    // Two cache lines. A Text argument's value holds its offset into text
+    // in the low half and its length in the high half.
+    struct alignas(64) Record {
+        int64_t at = 0;  // ns since the log epoch
+        const char *format = nullptr;
+        QmlLogLevel level = QmlLogLevel::Info;
+        uint8_t count = 0;
+        uint8_t textUsed = 0;
+        ArgType types[kMaxArgs] = {};
+        uint64_t values[kMaxArgs] = {};
+        char text[kTextBytes] = {};
+    };
+
+    struct Buffer;
+    struct Registry;
+    static Registry &registry();
+
+    // The calling thread's next free record, timestamped, or null when its
+    // buffer is full; publish() hands it to the writer.
+    static Record *claim();
+    static void publish();
+    // Formats and writes out every published record.
+    static void drain();
+    static void appendText(std::string &out, const Record &record);
+
+    static void put(Record &record, bool value) { push(record, ArgType::Bool, value ? 1 : 0); }
+    static void put(Record &record, char value) { put(record, std::string_view(&value, 1)); }
+    template <typename T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>, int> = 0>
+    static void put(Record &record, T value) {
+        if constexpr (std::is_enum_v<T>) {
+            put(record, static_cast<std::underlying_type_t<T>>(value));
+        } else if constexpr (std::is_signed_v<T>) {
+            push(record, ArgType::Int, static_cast<uint64_t>(static_cast<int64_t>(value)));
+        } else {
+            push(record, ArgType::UInt, static_cast<uint64_t>(value));
+        }
+    }
+    template <typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    static void put(Record &record, T value) {
+        const double number = static_cast<double>(value);
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof bits);
+        push(record, ArgType::Double, bits);
+    }
+    static void put(Record &record, const char *value) { put(record, std::string_view(value ? value : "")); }
+    static void put(Record &record, const std::string &value) { put(record, std::string_view(value)); }
+    static void put(Record &record, std::string_view value) {
+        const size_t length = std::min(value.size(), kTextBytes - record.textUsed);
+        std::memcpy(record.text + record.textUsed, value.data(), length);
+        push(record, ArgType::Text, record.textUsed | static_cast<uint64_t>(length) << 32);
+        record.textUsed = static_cast<uint8_t>(record.textUsed + length);
+    }
+    static void push(Record &record, ArgType type, uint64_t value) {
+        record.types[record.count] = type;
+        record.values[record.count] = value;
+        ++record.count;
+    }
+
+    static constexpr uint8_t kOff = 0xff;
+    static std::atomic<uint8_t> threshold_;
+    static thread_local Buffer *buffer_;
+};
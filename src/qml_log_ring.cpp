@@ -0,0 +1,94 @@
+#include "qml_log_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+QmlLogRing::QmlLogRing(size_t capacity, size_t lineBytes) : lineBytes_(std::max<size_t>(lineBytes, 4)) {
+    size_t size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    mask_ = size - 1;
+    slots_ = std::make_unique<Slot[]>(size);
+    bytes_ = std::make_unique<char[]>(size * lineBytes_);
+}
+
+// A producer may claim line n only while n - floor < capacity, which
+// leaves every line from the floor on alone. A stale floor is lower, so
+// the check only gets stricter. Unpinned, a full ring raises the floor to
+// make room; pinned, the floor stays put and the line is dropped.
+bool QmlLogRing::append(std::string_view line) {
+    uint64_t floor = floor_.load(std::memory_order_acquire);
+    uint64_t claimed = head_.load(std::memory_order_relaxed);
+    for (;;) {
+        if (claimed - (floor >> 1) > mask_) {
+            if ((floor & 1) != 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            floor_.compare_exchange_weak(floor, (claimed - mask_) << 1, std::memory_order_acq_rel);
+            continue;
+        }
+        if (head_.compare_exchange_weak(claimed, claimed + 1, std::memory_order_acq_rel)) {
+            break;
+        }
+        floor = floor_.load(std::memory_order_acquire);
+    }
+
+    // The slot's previous line may still be in its writer's hands, if that
+    // writer stalled for a whole capacity of lines; this one gives way.
+    Slot &slot = slots_[claimed & mask_];
+    uint64_t previous = slot.written.load(std::memory_order_acquire);
+    if (previous == Slot::kBusy ||
+        !slot.written.compare_exchange_strong(previous, Slot::kBusy, std::memory_order_acquire)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t length = std::min(line.size(), lineBytes_);
+    if (length < line.size()) {
+        while (length > 0 && (static_cast<unsigned char>(line[length]) & 0xC0) == 0x80) {
+            --length;
+        }
+    }
+    std::memcpy(bytes(claimed), line.data(), length);
+    slot.length = static_cast<uint32_t>(length);
+    slot.written.store(claimed + 1, std::memory_order_release);
+
+    if (appendedHandler_ && !woken_.load(std::memory_order_relaxed) && !woken_.exchange(true)) {
+        appendedHandler_();
+    }
+    return true;
+}
+
+size_t QmlLogRing::pin(size_t count) {
+    count = std::min(count, capacity());
+    uint64_t floor = floor_.load(std::memory_order_acquire);
+    uint64_t first = 0;
+    do {
+        const uint64_t head = head_.load(std::memory_order_acquire);
+        first = std::max(floor >> 1, head - std::min<uint64_t>(head, count));
+    } while (!floor_.compare_exchange_weak(floor, (first << 1) | 1, std::memory_order_acq_rel));
+
+    // Lines claimed since are above the floor too. Ones not written yet
+    // are skipped; they show from the next frame on.
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    pinned_.clear();
+    for (uint64_t line = std::max(first, head - std::min<uint64_t>(head, count)); line < head; ++line) {
+        if (slots_[line & mask_].written.load(std::memory_order_acquire) == line + 1) {
+            pinned_.push_back(line);
+        }
+    }
+    return pinned_.size();
+}
+
+std::string_view QmlLogRing::line(size_t index) const {
+    const uint64_t line = pinned_[index];
+    return std::string_view(bytes(line), slots_[line & mask_].length);
+}
+
+// Only the reader changes a pinned floor, so a plain store clears the pin.
+void QmlLogRing::unpin() {
+    floor_.store(floor_.load(std::memory_order_relaxed) & ~uint64_t(1), std::memory_order_release);
+    pinned_.clear();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Fixed-capacity ring of text lines behind a LogView: any number of
+// threads append without locking, and the render thread reads the newest
+// lines where they lie. Each line has a slot of lineBytes bytes, longer
+// ones being cut at a character boundary, so appending never allocates.
+// New lines overwrite the oldest, except while the reader has them
+// pinned: a producer that would overwrite a pinned line drops its own
+// instead, which only happens if a whole capacity of lines arrives while
+// one frame draws, or while one producer is stalled mid-line.
+class QmlLogRing {
+public:
+    // The capacity is rounded up to a power of two.
+    explicit QmlLogRing(size_t capacity, size_t lineBytes = 256);
+    QmlLogRing(const QmlLogRing &) = delete;
+    QmlLogRing &operator=(const QmlLogRing &) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+    size_t lineBytes() const { return lineBytes_; }
+
+    // Any thread. The line should not contain line breaks. Returns false
+    // if it was dropped.
+    bool append(std::string_view line);
+    // Lines that took a place in the ring since construction, and lines
+    // dropped.
+    uint64_t appended() const { return head_.load(std::memory_order_acquire); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // Called on an appending thread for the first line after rearm(), e.g.
+    // to request a frame. Set it before the producers start.
+    void setAppendedHandler(std::function<void()> handler) { appendedHandler_ = std::move(handler); }
+    void rearm() { woken_.store(false); }
+
+    // Reader side, one thread. Pins up to count of the newest lines, and
+    // returns how many: line(0) is the oldest of them. Lines still being
+    // written are left out. The views stay valid until unpin().
+    size_t pin(size_t count);
+    std::string_view line(size_t index) const;
+    void unpin();
+
+private:
+    struct Slot {
+        static constexpr uint64_t kBusy = UINT64_MAX;  // being written
+
+        std::atomic<uint64_t> written{0};  // one past the line it holds, once complete
+        uint32_t length = 0;
+    };
+
+    char *bytes(uint64_t line) const { return bytes_.get() + (line & mask_) * lineBytes_; }
+
+    size_t mask_;
+    size_t lineBytes_;
+    std::unique_ptr<Slot[]> slots_;
+    std::unique_ptr<char[]> bytes_;
+    std::atomic<uint64_t> head_{0};  // lines claimed
+    // Lines from the floor on are intact; shifted left by one, with the low
+    // bit set while the reader pins them. Only rises.
+    std::atomic<uint64_t> floor_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> woken_{false};
+    std::function<void()> appendedHandler_;
+    std::vector<uint64_t> pinned_;  // the pinned lines, kept to reuse its capacity
+};
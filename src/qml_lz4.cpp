@@ -0,0 +1,157 @@
+#include "qml_lz4.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr size_t kMinMatch = 4;
+// The format's end rules: the last five bytes are literals, and no match
+// starts in the last twelve.
+constexpr size_t kLastLiterals = 5;
+constexpr size_t kMatchLimit = 12;
+constexpr size_t kMaxOffset = 65535;
+constexpr int kHashBits = 14;
+
+uint32_t load32(const char *at) {
+    uint32_t value;
+    std::memcpy(&value, at, sizeof(value));
+    return value;
+}
+
+uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+void appendLength(std::string &out, size_t length) {
+    for (; length >= 255; length -= 255) {
+        out.push_back(static_cast<char>(255));
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+// A token, the literals, and unless matchLength is 0 the match.
+void appendSequence(std::string &out, const char *literals, size_t literalLength, size_t offset,
+                    size_t matchLength) {
+    const size_t matchCode = matchLength == 0 ? 0 : matchLength - kMinMatch;
+    out.push_back(static_cast<char>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+    if (literalLength >= 15) {
+        appendLength(out, literalLength - 15);
+    }
+    out.append(literals, literalLength);
+    if (matchLength == 0) {
+        return;
+    }
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (matchCode >= 15) {
+        appendLength(out, matchCode - 15);
+    }
+}
+
+bool readLength(std::string_view block, size_t &pos, size_t &length) {
+    unsigned char byte = 255;
+    while (byte == 255) {
+        if (pos >= block.size()) {
+            return false;
+        }
+        byte = static_cast<unsigned char>(block[pos++]);
+        length += byte;
+    }
+    return true;
+}
+
+}  // namespace
+
+std::string QmlLz4::compress(std::string_view input) {
+    std::string out;
+    out.reserve(bound(input.size()));
+    const char *base = input.data();
+    const size_t size = input.size();
+    size_t anchor = 0;  // first byte not yet emitted
+    if (size > kMatchLimit) {
+        std::vector<uint32_t> table(size_t(1) << kHashBits, 0);
+        const size_t lastMatchStart = size - kMatchLimit;
+        const size_t matchEnd = size - kLastLiterals;
+        size_t pos = 0;
+        while (pos < lastMatchStart) {
+            const uint32_t sequence = load32(base + pos);
+            uint32_t &slot = table[hash(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(pos);
+            if (candidate >= pos || pos - candidate > kMaxOffset || load32(base + candidate) != sequence) {
+                // Incompressible stretches are skipped faster the longer they run.
+                pos += 1 + ((pos - anchor) >> 6);
+                continue;
+            }
+            size_t length = kMinMatch;
+            while (pos + length < matchEnd && base[candidate + length] == base[pos + length]) {
+                ++length;
+            }
+            while (pos > anchor && candidate > 0 && base[pos - 1] == base[candidate - 1]) {
+                --pos;
+                --candidate;
+                ++length;
+            }
+            appendSequence(out, base + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+            if (pos >= 2 && pos < lastMatchStart) {
+                table[hash(load32(base + pos - 2))] = static_cast<uint32_t>(pos - 2);
+            }
+        }
+    }
+    appendSequence(out, base + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool QmlLz4::decompress(std::string_view block, size_t size, std::string &output) {
+    output.resize(size);
+    char *out = output.data();
+    size_t written = 0;
+    size_t pos = 0;
+    while (pos < block.size()) {
+        const auto token = static_cast<unsigned char>(block[pos++]);
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(block, pos, literals)) {
+            return false;
+        }
+        if (literals > block.size() - pos || literals > size - written) {
+            return false;
+        }
+        std::memcpy(out + written, block.data() + pos, literals);
+        pos += literals;
+        written += literals;
+        if (pos == block.size()) {
+            break;  // the last sequence has no match
+        }
+
+        if (block.size() - pos < 2) {
+            return false;
+        }
+        const size_t offset =
+            static_cast<unsigned char>(block[pos]) | size_t(static_cast<unsigned char>(block[pos + 1])) << 8;
+        pos += 2;
+        size_t length = token & 15;
+        if (length == 15 && !readLength(block, pos, length)) {
+            return false;
+        }
+        length += kMinMatch;
+        if (offset == 0 || offset > written || length > size - written) {
+            return false;
+        }
+        // A match may overlap its own output, as a run does; copying at
+        // most offset bytes at a time only reads bytes already written.
+        char *target = out + written;
+        const char *source = target - offset;
+        for (size_t copied = 0; copied < length;) {
+            const size_t chunk = std::min(length - copied, offset);
+            std::memcpy(target + copied, source + copied, chunk);
+            copied += chunk;
+        }
+        written += length;
+    }
+    return written == size;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// LZ4 block format: sequences of literals and back-references of at least
+// four bytes within the previous 64 KiB. Decoding is a copy loop with no
+// entropy stage, a few GB/s, which is why it suits data that must come back
+// within a frame. compress() is the greedy single-pass matcher of the
+// reference "fast" mode; its blocks decode with any LZ4 implementation and
+// it decodes theirs. Blocks carry no size or checksum: the caller stores
+// the original size and passes it back.
+class QmlLz4 {
+public:
+    // Worst-case size of a block of size input bytes.
+    static size_t bound(size_t size) { return size + size / 255 + 16; }
+
+    static std::string compress(std::string_view input);
+    // Decodes block into output, which is resized to size. False if the
+    // block is malformed or does not decode to exactly size bytes; output
+    // is then unspecified.
+    static bool decompress(std::string_view block, size_t size, std::string &output);
+};
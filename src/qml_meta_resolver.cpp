@@ -0,0 +1,374 @@
+#include "qml_meta_resolver.h"
+
+#include <QByteArray>
+#include <QMetaMethod>
+#include <QMetaProperty>
+#include <QVariant>
+#include <cctype>
+
+#include "qml_parser.h"
+
+namespace {
+
+constexpr size_t kMaxArguments = 3;
+
+bool takesOnlyStrings(const QMetaMethod &method) {
+    for (int i = 0; i < method.parameterCount(); ++i) {
+        if (method.parameterMetaType(i) != QMetaType::fromType<QString>()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void assignUtf8(std::string &value, const QString &text) {
+    const QByteArray utf8 = text.toUtf8();
+    value.assign(utf8.constData(), static_cast<size_t>(utf8.size()));
+}
+
+uint64_t valueKey(QmlAtom object, QmlAtom property) {
+    return (uint64_t(object) << 32) | property;
+}
+
+std::string_view trimmed(std::string_view text) {
+    const size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+// Calls visit(position) for each character of text outside string
+// literals and brackets that matches one of stops.
+template <typename Visit>
+void forEachTopLevel(std::string_view text, std::string_view stops, Visit &&visit) {
+    int depth = 0;
+    char quote = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char ch = text[i];
+        if (quote != 0) {
+            if (ch == '\\') {
+                ++i;
+            } else if (ch == quote) {
+                quote = 0;
+            }
+        } else if (ch == '"' || ch == '\'') {
+            quote = ch;
+        } else if (ch == '(' || ch == '[' || ch == '{') {
+            ++depth;
+        } else if (ch == ')' || ch == ']' || ch == '}') {
+            --depth;
+        } else if (depth == 0 && stops.find(ch) != std::string_view::npos) {
+            visit(i);
+        }
+    }
+}
+
+bool isIdentifier(std::string_view text) {
+    if (text.empty() || std::isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+    for (const char ch : text) {
+        if (!std::isalnum(static_cast<unsigned char>(ch)) && ch != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray atomName(QmlAtom atom) {
+    const std::string_view name = QmlAtomTable::global().name(atom);
+    return QByteArray(name.data(), static_cast<qsizetype>(name.size()));
+}
+
+}  // namespace
+
+QmlMetaResolver::QmlMetaResolver(QObject *parent) : QObject(parent) {}
+
+void QmlMetaResolver::addObject(const std::string &name, QObject *object) {
+    objects_[QmlAtomTable::global().intern(name)] = object;
+    connect(object, &QObject::destroyed, this, [this, object] { forget(object); });
+}
+
+void QmlMetaResolver::setDocument(const QmlDocument *document) {
+    document_ = document;
+    nodes_.clear();
+    overrides_.clear();
+    graph_.clear();
+    bindingValues_.clear();
+    if (document == nullptr) {
+        return;
+    }
+    graph_.build(*document, program_);
+    bindingValues_.resize(graph_.vertexCount());
+    for (const uint32_t vertex : graph_.topologicalOrder()) {
+        reevaluate(vertex);
+    }
+}
+
+void QmlMetaResolver::setValue(const std::string &id, const std::string &property, std::string value) {
+    QmlAtomTable &atoms = QmlAtomTable::global();
+    const QmlAtom object = atoms.intern(id);
+    const QmlAtom key = atoms.intern(property);
+    std::string &current = overrides_[valueKey(object, key)];
+    if (current != value) {
+        current = std::move(value);
+        graph_.changed(object, key);
+    }
+}
+
+void QmlMetaResolver::sourceChanged(const std::string &object, const std::string &member) {
+    QmlAtomTable &atoms = QmlAtomTable::global();
+    graph_.changed(atoms.intern(object), atoms.intern(member));
+}
+
+size_t QmlMetaResolver::commit(const InvalidateBinding &invalidate) {
+    return graph_.propagate([&](uint32_t vertex) {
+        if (!reevaluate(vertex)) {
+            return false;
+        }
+        if (invalidate) {
+            invalidate(*graph_.vertex(vertex).binding);
+        }
+        return true;
+    });
+}
+
+bool QmlMetaResolver::reevaluate(uint32_t vertex) {
+    const QmlBindingGraph::Vertex &binding = graph_.vertex(vertex);
+    scratch_.clear();
+    if (!vm_.evaluate(program_, binding.expression, *this, scratch_)) {
+        scratch_.assign(*binding.binding);
+    }
+    if (scratch_ == bindingValues_[vertex]) {
+        return false;
+    }
+    bindingValues_[vertex].swap(scratch_);
+    return true;
+}
+
+void QmlMetaResolver::operator()(std::string_view binding, std::string &value) {
+    const uint32_t expression = program_.compile(binding);
+    if (expression == QmlExpressionProgram::kInvalid || !vm_.evaluate(program_, expression, *this, value)) {
+        value.assign(binding);
+    }
+}
+
+size_t QmlMetaResolver::run(std::string_view script, const Assigned &assigned) {
+    script = trimmed(script);
+    if (script.size() >= 2 && script.front() == '{' && script.back() == '}') {
+        script = script.substr(1, script.size() - 2);
+    }
+    size_t count = 0;
+    size_t start = 0;
+    const auto statement = [&](size_t end) {
+        count += runStatement(trimmed(script.substr(start, end - start)), assigned) ? 1 : 0;
+        start = end + 1;
+    };
+    forEachTopLevel(script, ";\n", statement);
+    statement(script.size());
+    return count;
+}
+
+bool QmlMetaResolver::runStatement(std::string_view statement, const Assigned &assigned) {
+    if (statement.empty()) {
+        return false;
+    }
+    size_t equals = std::string_view::npos;
+    forEachTopLevel(statement, "=", [&](size_t at) {
+        const bool comparison = (at > 0 && std::string_view("=!<>").find(statement[at - 1]) != std::string_view::npos) ||
+                                (at + 1 < statement.size() && statement[at + 1] == '=');
+        if (!comparison && equals == std::string_view::npos) {
+            equals = at;
+        }
+    });
+    if (equals == std::string_view::npos) {
+        std::string ignored;
+        (*this)(statement, ignored);  // for its effect
+        return true;
+    }
+    const std::string_view target = trimmed(statement.substr(0, equals));
+    const size_t dot = target.find('.');
+    if (dot == std::string_view::npos || !isIdentifier(target.substr(0, dot)) ||
+        !isIdentifier(target.substr(dot + 1))) {
+        return false;
+    }
+    std::string value;
+    (*this)(trimmed(statement.substr(equals + 1)), value);
+    const std::string id(target.substr(0, dot));
+    const std::string property(target.substr(dot + 1));
+    setValue(id, property, value);
+    if (assigned) {
+        assigned(id, property, value);
+    }
+    return true;
+}
+
+bool QmlMetaResolver::lookup(QmlAtom name, QmlExpressionValue &out) {
+    const auto object = objects_.find(name);
+    if (object != objects_.end()) {
+        out.setObject(object->second, QObjectTag);
+        return true;
+    }
+    if (document_ == nullptr) {
+        return false;
+    }
+    auto node = nodes_.find(name);
+    if (node == nodes_.end()) {
+        node = nodes_.emplace(name, document_->findById(std::string(QmlAtomTable::global().name(name)))).first;
+    }
+    if (node->second == nullptr) {
+        return false;
+    }
+    out.setObject(node->second, name);  // nodes are tagged with their id
+    return true;
+}
+
+bool QmlMetaResolver::member(const void *object, uint32_t tag, QmlAtom name, QmlExpressionValue &out) {
+    if (tag != QObjectTag) {
+        const QmlNode *node = static_cast<const QmlNode *>(object);
+        const QmlAtom id = tag;
+        const auto overridden = overrides_.find(valueKey(id, name));
+        if (overridden != overrides_.end()) {
+            out.text.assign(overridden->second);
+        } else if (const uint32_t vertex = graph_.find(id, name); vertex != QmlBindingGraph::kNone) {
+            out.text.assign(bindingValues_[vertex]);
+        } else {
+            const QmlProperty *property = node->findProperty(name);
+            out.text.assign(property != nullptr ? property->value : std::string());
+        }
+        out.setString();
+        return true;
+    }
+
+    QObject *target = const_cast<QObject *>(static_cast<const QObject *>(object));
+    const QMetaObject *meta = target->metaObject();
+    const int index = propertyIndex(meta, name);
+    if (index < 0) {
+        return false;
+    }
+    const QVariant value = meta->property(index).read(target);
+    if (value.canConvert<QObject *>() && value.value<QObject *>() != nullptr) {
+        out.setObject(value.value<QObject *>(), QObjectTag);
+        return true;
+    }
+    writeText(target, index, value, out.text);
+    out.setString();
+    return true;
+}
+
+bool QmlMetaResolver::call(const void *object, uint32_t tag, QmlAtom method, const QmlExpressionValue *arguments,
+                           size_t count, QmlExpressionValue &out) {
+    if (tag != QObjectTag || count > kMaxArguments) {
+        return false;
+    }
+    QObject *target = const_cast<QObject *>(static_cast<const QObject *>(object));
+    const QMetaObject *meta = target->metaObject();
+    const int index = methodIndex(meta, method, count);
+    if (index < 0) {
+        return false;
+    }
+
+    const QMetaMethod metaMethod = meta->method(index);
+    QString strings[kMaxArguments];
+    QGenericArgument generic[kMaxArguments];
+    for (int i = 0; i < metaMethod.parameterCount(); ++i) {
+        const size_t slot = static_cast<size_t>(i);
+        if (slot < count) {
+            if (arguments[slot].kind != QmlExpressionValue::Kind::String) {
+                return false;
+            }
+            strings[slot] = QString::fromUtf8(arguments[slot].text.data(),
+                                              static_cast<qsizetype>(arguments[slot].text.size()));
+        }
+        generic[slot] = QGenericArgument("QString", &strings[slot]);
+    }
+    // A void method, such as one that starts work, evaluates to "".
+    const bool returns = metaMethod.returnMetaType().id() != QMetaType::Void;
+    QVariant result(metaMethod.returnMetaType(), nullptr);
+    if (!metaMethod.invoke(target, Qt::DirectConnection,
+                           returns ? QGenericReturnArgument(metaMethod.typeName(), result.data())
+                                   : QGenericReturnArgument(),
+                           generic[0], generic[1], generic[2])) {
+        return false;
+    }
+    if (returns) {
+        writeText(target, -1 - index, result, out.text);
+    } else {
+        out.text.clear();
+    }
+    out.setString();
+    return true;
+}
+
+// QString values are cached with their UTF-8 encoding. The cached copy
+// shares the backend's buffer and keeps it alive, so a value with the same
+// data pointer and length is the same unmodified string (a write would
+// have detached it) and the encoding is reused.
+void QmlMetaResolver::writeText(const QObject *object, int site, const QVariant &value, std::string &out) {
+    if (value.metaType() != QMetaType::fromType<QString>()) {
+        assignUtf8(out, value.toString());
+        return;
+    }
+    const QString text = value.toString();
+    Utf8Entry &entry = utf8_[SiteKey{object, site}];
+    if (!entry.filled || entry.source.constData() != text.constData() || entry.source.size() != text.size()) {
+        entry.filled = true;
+        entry.source = text;
+        assignUtf8(entry.utf8, text);
+        ++utf8Conversions_;
+    }
+    out.assign(entry.utf8);
+}
+
+int QmlMetaResolver::propertyIndex(const QMetaObject *meta, QmlAtom name) {
+    const MemberKey key{meta, name, 0};
+    const auto cached = properties_.find(key);
+    if (cached != properties_.end()) {
+        return cached->second;
+    }
+    int index = meta->indexOfProperty(atomName(name).constData());
+    if (index >= 0 && !meta->property(index).isReadable()) {
+        index = -1;
+    }
+    properties_.emplace(key, index);
+    return index;
+}
+
+// Prefers an exact arity match; otherwise takes a method with more QString
+// parameters, which are passed empty.
+int QmlMetaResolver::methodIndex(const QMetaObject *meta, QmlAtom name, size_t count) {
+    const MemberKey key{meta, name, static_cast<uint32_t>(count)};
+    const auto cached = methods_.find(key);
+    if (cached != methods_.end()) {
+        return cached->second;
+    }
+    const QByteArray wanted = atomName(name);
+    int match = -1;
+    for (int i = 0; i < meta->methodCount(); ++i) {
+        const QMetaMethod method = meta->method(i);
+        const size_t parameters = static_cast<size_t>(method.parameterCount());
+        if (method.name() != wanted || parameters < count || parameters > kMaxArguments || !takesOnlyStrings(method) ||
+            method.returnMetaType() == QMetaType::fromType<void>()) {
+            continue;
+        }
+        if (parameters == count) {
+            match = i;
+            break;
+        }
+        if (match < 0) {
+            match = i;
+        }
+    }
+    methods_.emplace(key, match);
+    return match;
+}
+
+void QmlMetaResolver::forget(const QObject *object) {
+    for (auto it = utf8_.begin(); it != utf8_.end();) {
+        it = it->first.object == object ? utf8_.erase(it) : std::next(it);
+    }
+    for (auto it = objects_.begin(); it != objects_.end();) {
+        it = it->second == object ? objects_.erase(it) : std::next(it);
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "qml_binding_graph.h"
+#include "qml_expression.h"
+
+class QVariant;
+class QmlDocument;
+struct QmlNode;
+
+// BindingWriter callable that evaluates bindings against registered
+// QObjects through their meta-objects. Each distinct binding is compiled
+// to bytecode the first time it is seen (see qml_expression.h), so member
+// access, method calls, string literals and '+' concatenation are
+// supported, e.g. greeter.greet(nameField.text). Property and method
+// lookups are cached per meta-object and name; later evaluations run the
+// bytecode and go straight to QMetaProperty::read and QMetaMethod::invoke.
+// A call that passes fewer arguments than a method takes fills the rest
+// with empty QStrings when all its parameters are QStrings. Anything that
+// does not evaluate is written back as its own text.
+class QmlMetaResolver : public QObject, private QmlExpressionHost {
+    Q_OBJECT
+
+public:
+    explicit QmlMetaResolver(QObject *parent = nullptr);
+
+    // Makes object reachable as "name". An object is dropped when it is
+    // destroyed.
+    void addObject(const std::string &name, QObject *object);
+    // Ids in document resolve to its nodes. Registered objects take
+    // precedence. The document's bindings are compiled into a dependency
+    // graph and evaluated once, so a node member is its literal value, the
+    // value set with setValue(), or its binding's current value. The
+    // document must outlive the resolver or be replaced first.
+    void setDocument(const QmlDocument *document);
+
+    // Changes a node's property, e.g. the text typed into a TextField.
+    void setValue(const std::string &id, const std::string &property, std::string value);
+    // Reports that an outside source such as greeter.message changed.
+    void sourceChanged(const std::string &object, const std::string &member);
+    // Re-evaluates the document bindings downstream of the changes since
+    // the last commit, in dependency order, and calls invalidate with the
+    // text of each binding whose value changed; pass the frontend's
+    // invalidateBinding. Call it before rendering. Returns the number of
+    // bindings re-evaluated.
+    using InvalidateBinding = std::function<void(const std::string &binding)>;
+    size_t commit(const InvalidateBinding &invalidate);
+
+    void operator()(std::string_view binding, std::string &value);
+
+    // Runs a signal handler body, such as the onClicked of
+    // "outputLabel.text = greeter.greet(nameField.text)". Statements are
+    // separated by ';' or newlines, and the body may be in braces. Each is
+    // either an assignment to an id's property, which goes through
+    // setValue() and is reported to assigned (e.g. to show it), or an
+    // expression evaluated for its effect, such as a method call. Returns
+    // the number of statements run. Call commit() afterwards.
+    using Assigned = std::function<void(const std::string &id, const std::string &property, const std::string &value)>;
+    size_t run(std::string_view script, const Assigned &assigned = nullptr);
+
+    // Number of distinct bindings compiled so far.
+    size_t expressionCount() const { return program_.expressionCount(); }
+    // QString values converted to UTF-8. Strings that did not change since
+    // their last read (same shared buffer) reuse the earlier conversion.
+    size_t utf8Conversions() const { return utf8Conversions_; }
+
+private:
+    // Values for QObjects carry this tag; document nodes carry their id's
+    // atom, which is never Invalid.
+    static constexpr uint32_t QObjectTag = QmlAtoms::Invalid;
+
+    struct MemberKey {
+        const QMetaObject *meta;
+        QmlAtom name;
+        uint32_t arguments;  // methods only
+
+        bool operator==(const MemberKey &other) const {
+            return meta == other.meta && name == other.name && arguments == other.arguments;
+        }
+    };
+    struct MemberKeyHash {
+        size_t operator()(const MemberKey &key) const {
+            return std::hash<const void *>()(key.meta) ^ (size_t(key.name) << 8) ^ key.arguments;
+        }
+    };
+
+    // A property (its index) or method (-1 - index) of one object.
+    struct SiteKey {
+        const QObject *object;
+        int site;
+
+        bool operator==(const SiteKey &other) const { return object == other.object && site == other.site; }
+    };
+    struct SiteKeyHash {
+        size_t operator()(const SiteKey &key) const {
+            return std::hash<const void *>()(key.object) ^ (size_t(uint32_t(key.site)) * 0x9e3779b9u);
+        }
+    };
+    struct Utf8Entry {
+        QString source;  // shares the backend's buffer
+        std::string utf8;
+        bool filled = false;
+    };
+
+    bool lookup(QmlAtom name, QmlExpressionValue &out) override;
+    bool member(const void *object, uint32_t tag, QmlAtom name, QmlExpressionValue &out) override;
+    bool call(const void *object, uint32_t tag, QmlAtom method, const QmlExpressionValue *arguments, size_t count,
+              QmlExpressionValue &out) override;
+
+    int propertyIndex(const QMetaObject *meta, QmlAtom name);
+    int methodIndex(const QMetaObject *meta, QmlAtom name, size_t count);
+    void forget(const QObject *object);
+    void writeText(const QObject *object, int site, const QVariant &value, std::string &out);
+
+    QmlExpressionProgram program_;
+    QmlExpressionVm vm_;
+    std::unordered_map<QmlAtom, QObject *> objects_;
+    const QmlDocument *document_ = nullptr;
+    std::unordered_map<QmlAtom, const QmlNode *> nodes_;  // findById results, misses included
+    std::unordered_map<MemberKey, int, MemberKeyHash> properties_;  // -1 when absent
+    std::unordered_map<MemberKey, int, MemberKeyHash> methods_;
+    QmlBindingGraph graph_;
+    std::vector<std::string> bindingValues_;  // per graph vertex
+    std::unordered_map<uint64_t, std::string> overrides_;  // (id, property) from setValue()
+    std::string scratch_;
+    std::unordered_map<SiteKey, Utf8Entry, SiteKeyHash> utf8_;
+    size_t utf8Conversions_ = 0;
+
+    bool reevaluate(uint32_t vertex);
+    bool runStatement(std::string_view statement, const Assigned &assigned);
+};
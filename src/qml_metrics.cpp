@@ -0,0 +1,159 @@
+#include "qml_metrics.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// Integers exactly, fractions to 12 digits, and with a decimal point
+// whatever LC_NUMERIC says.
+std::string_view formatNumber(double value, char (&number)[32]) {
+    if (std::nearbyint(value) == value && std::fabs(value) < 9007199254740992.0) {
+        std::snprintf(number, sizeof number, "%lld", static_cast<long long>(value));
+    } else {
+        std::snprintf(number, sizeof number, "%.12g", value);
+    }
+    for (char *ch = number; *ch != '\0'; ++ch) {
+        if (*ch == ',') {
+            *ch = '.';
+        }
+    }
+    return number;
+}
+
+}  // namespace
+
+void QmlMetricsText::family(std::string_view name, Type type, std::string_view help, std::string_view unit) {
+    name_.assign(name);
+    static constexpr std::string_view kTypes[] = {"counter", "gauge", "histogram"};
+    text_.append("# TYPE ").append(name).append(" ").append(kTypes[static_cast<size_t>(type)]).append("\n");
+    if (!unit.empty()) {
+        text_.append("# UNIT ").append(name).append(" ").append(unit).append("\n");
+    }
+    text_.append("# HELP ").append(name).append(" ").append(help).append("\n");
+}
+
+void QmlMetricsText::counter(double value, std::string_view labels) {
+    sample("_total", labels, value);
+}
+
+void QmlMetricsText::gauge(double value, std::string_view labels) {
+    sample({}, labels, value);
+}
+
+void QmlMetricsText::histogram(const QmlLatencyHistogram &histogram, std::string_view labels) {
+    std::string bucketLabels(labels);
+    if (!bucketLabels.empty()) {
+        bucketLabels.push_back(',');
+    }
+    const size_t prefix = bucketLabels.size();
+    for (const double bound : kBounds) {
+        bucketLabels.resize(prefix);
+        bucketLabels.append("le=\"");
+        char number[32];
+        bucketLabels.append(formatNumber(bound, number)).append("\"");
+        const auto nanos = std::chrono::nanoseconds(static_cast<int64_t>(std::llround(bound * 1e9)));
+        sample("_bucket", bucketLabels, static_cast<double>(histogram.countAtMost(nanos)));
+    }
+    bucketLabels.resize(prefix);
+    bucketLabels.append("le=\"+Inf\"");
+    sample("_bucket", bucketLabels, static_cast<double>(histogram.count()));
+    sample("_count", labels, static_cast<double>(histogram.count()));
+    sample("_sum", labels, histogram.sum().count());
+}
+
+std::string QmlMetricsText::label(std::string_view name, std::string_view value) {
+    std::string text(name);
+    text.append("=\"");
+    for (const char ch : value) {
+        if (ch == '\\' || ch == '"') {
+            text.push_back('\\');
+            text.push_back(ch);
+        } else if (ch == '\n') {
+            text.append("\\n");
+        } else {
+            text.push_back(ch);
+        }
+    }
+    text.push_back('"');
+    return text;
+}
+
+const std::string &QmlMetricsText::finish() {
+    text_.append("# EOF\n");
+    return text_;
+}
+
+void QmlMetricsText::clear() {
+    text_.clear();
+    name_.clear();
+}
+
+void QmlMetricsText::sample(std::string_view suffix, std::string_view labels, double value) {
+    text_.append(name_).append(suffix);
+    if (!labels.empty()) {
+        text_.append("{").append(labels).append("}");
+    }
+    char number[32];
+    text_.append(" ").append(formatNumber(value, number)).append("\n");
+}
+
+void QmlMetricsMerger::add(std::string_view exposition, std::string_view labels) {
+    Family *family = nullptr;
+    bool metadata = false;  // whether this process's metadata lines are the family's
+    while (!exposition.empty()) {
+        const size_t end = exposition.find('\n');
+        const std::string_view line = exposition.substr(0, end);
+        exposition.remove_prefix(end == std::string_view::npos ? exposition.size() : end + 1);
+        if (line.empty() || line == "# EOF") {
+            continue;
+        }
+        if (line.compare(0, 7, "# TYPE ") == 0) {
+            const std::string_view rest = line.substr(7);
+            const std::string name(rest.substr(0, rest.find(' ')));
+            const auto inserted = index_.emplace(name, families_.size());
+            if (inserted.second) {
+                families_.emplace_back();
+            }
+            family = &families_[inserted.first->second];
+            metadata = inserted.second;
+        }
+        if (family == nullptr) {
+            continue;
+        }
+        if (line.front() == '#') {
+            if (metadata) {
+                family->metadata.append(line).append("\n");
+            }
+            continue;
+        }
+        // name{labels} value, or name value.
+        const size_t nameEnd = line.find_first_of("{ ");
+        if (nameEnd == std::string_view::npos) {
+            continue;
+        }
+        if (labels.empty()) {
+            family->samples.append(line).append("\n");
+            continue;
+        }
+        family->samples.append(line.substr(0, nameEnd));
+        if (line[nameEnd] == '{') {
+            family->samples.append("{").append(labels).append(",").append(line.substr(nameEnd + 1));
+        } else {
+            family->samples.append("{").append(labels).append("}").append(line.substr(nameEnd));
+        }
+        family->samples.append("\n");
+    }
+}
+
+void QmlMetricsMerger::appendTo(QmlMetricsText &text) const {
+    for (const Family &family : families_) {
+        text.text_.append(family.metadata).append(family.samples);
+    }
+    text.name_.clear();
+}
+
+void QmlMetricsMerger::clear() {
+    families_.clear();
+    index_.clear();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "qml_latency_histogram.h"
+
+// Builds an OpenMetrics text exposition, the format Prometheus scrapes.
+// Each metric is a family, started by family() with its TYPE, UNIT and
+// HELP lines, whose samples follow; labels are passed already formatted,
+// as label() makes them ("document=\"Main.qml\"", comma-separated for
+// several). A family with a unit is named after it, as qml_frame_seconds
+// is, and a counter's sample gets the _total suffix. finish() ends the
+// text with the # EOF line the format requires. Not thread-safe.
+class QmlMetricsText {
+public:
+    enum class Type : uint8_t { Counter, Gauge, Histogram };
+
+    // Latency histograms are exported with these bucket bounds, in
+    // seconds: 1, 2.5 and 5 per decade from 10 µs to 10 s, then +Inf.
+    static constexpr double kBounds[] = {1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2,
+                                         2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+    void family(std::string_view name, Type type, std::string_view help, std::string_view unit = {});
+    void counter(double value, std::string_view labels = {});
+    void gauge(double value, std::string_view labels = {});
+    // The _bucket, _count and _sum samples of a histogram family in
+    // seconds.
+    void histogram(const QmlLatencyHistogram &histogram, std::string_view labels = {});
+
+    // name="value", with backslashes, quotes and line breaks escaped.
+    static std::string label(std::string_view name, std::string_view value);
+
+    const std::string &finish();
+    const std::string &text() const { return text_; }
+    void clear();
+
+private:
+    friend class QmlMetricsMerger;
+
+    void sample(std::string_view suffix, std::string_view labels, double value);
+
+    std::string text_;
+    std::string name_;  // of the current family
+};
+
+// Combines the expositions of several processes, such as prefork workers,
+// into one: each family appears once, in the order it was first seen,
+// with every process's samples under it, labelled to tell them apart
+// (worker="2"). A family's TYPE, UNIT and HELP come from the first
+// process that exported it. Not thread-safe.
+class QmlMetricsMerger {
+public:
+    // exposition is a finished QmlMetricsText; labels, formatted as for
+    // QmlMetricsText, are added to each of its samples.
+    void add(std::string_view exposition, std::string_view labels);
+    // Appends the merged families; the text must not hold any of them.
+    void appendTo(QmlMetricsText &text) const;
+    void clear();
+
+private:
+    struct Family {
+        std::string metadata;  // TYPE, UNIT and HELP lines
+        std::string samples;
+    };
+
+    std::vector<Family> families_;
+    std::unordered_map<std::string, size_t> index_;  // family name to families_
+};
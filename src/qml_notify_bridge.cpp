@@ -0,0 +1,144 @@
+#include "qml_notify_bridge.h"
+
+#include <QMetaMethod>
+#include <QMetaProperty>
+#include <QThread>
+
+namespace {
+
+const QMetaMethod &notifySlot() {
+    static const QMetaMethod slot =
+        QmlNotifyRelay::staticMetaObject.method(QmlNotifyRelay::staticMetaObject.indexOfSlot("onNotify()"));
+    return slot;
+}
+
+}  // namespace
+
+// Runs on the emitting thread; only the change queue and the relay's own
+// fields are touched from there.
+void QmlNotifyRelay::onNotify() {
+    if (QThread::currentThread() == bridge_.thread()) {
+        bridge_.changed(bindings_);
+        return;
+    }
+    if (key_ == kNoKey) {
+        QMetaObject::invokeMethod(this, [this] { bridge_.changed(bindings_); }, Qt::QueuedConnection);
+        return;
+    }
+    if (bridge_.changes_.post(key_)) {
+        QmlNotifyBridge *bridge = &bridge_;
+        QMetaObject::invokeMethod(bridge, [bridge] { bridge->drainChanges(); }, Qt::QueuedConnection);
+    }
+}
+
+QmlNotifyBridge::QmlNotifyBridge(BindingWriter writer, QObject *parent, uint32_t changeCapacity)
+    : QObject(parent), writer_(writer), changes_(changeCapacity) {}
+
+// Out of line for the relays' destructor.
+QmlNotifyBridge::~QmlNotifyBridge() = default;
+
+void QmlNotifyBridge::addObject(const std::string &name, QObject *object) {
+    objects_[name] = object;
+    connect(object, &QObject::destroyed, this, [this, object] { forget(object); });
+}
+
+void QmlNotifyBridge::operator()(std::string_view binding, std::string &value) {
+    writer_(binding, value);
+    key_.assign(binding);
+    if (seen_.insert(key_).second) {
+        subscribe(key_);
+    }
+}
+
+// Only plain "object.property" bindings are subscribed. Method calls and
+// CONSTANT properties have nothing to listen to and stay cached; so do
+// properties without a NOTIFY signal, which need invalidating by hand.
+void QmlNotifyBridge::subscribe(const std::string &binding) {
+    const size_t dot = binding.find('.');
+    if (dot == std::string::npos || binding.find_first_of(".()", dot + 1) != std::string::npos) {
+        return;
+    }
+    const auto object = objects_.find(binding.substr(0, dot));
+    if (object == objects_.end()) {
+        return;
+    }
+    const QMetaObject *meta = object->second->metaObject();
+    const int index = meta->indexOfProperty(binding.c_str() + dot + 1);
+    if (index < 0) {
+        return;
+    }
+    const QMetaProperty property = meta->property(index);
+    if (!property.hasNotifySignal()) {
+        return;
+    }
+
+    const QMetaMethod signal = property.notifySignal();
+    Subscription &subscription = dependents_[SignalKey(object->second, signal.methodIndex())];
+    subscription.bindings.push_back(binding);
+    if (subscription.relay) {
+        return;
+    }
+    uint32_t key = QmlNotifyRelay::kNoKey;
+    if (!freeKeys_.empty()) {
+        key = freeKeys_.back();
+        freeKeys_.pop_back();
+    } else if (keyed_.size() < changes_.capacity()) {
+        key = static_cast<uint32_t>(keyed_.size());
+        keyed_.push_back(nullptr);
+    }
+    if (key != QmlNotifyRelay::kNoKey) {
+        keyed_[key] = &subscription.bindings;
+    }
+    subscription.relay = std::make_unique<QmlNotifyRelay>(*this, subscription.bindings, key);
+    // Direct, so emitters on other threads reach the relay without a
+    // queued event each; the relay decides how to get to this thread.
+    connect(object->second, signal, subscription.relay.get(), notifySlot(), Qt::DirectConnection);
+}
+
+void QmlNotifyBridge::changed(const std::vector<std::string> &bindings) {
+    if (!changed_) {
+        return;
+    }
+    for (const std::string &binding : bindings) {
+        changed_(binding);
+    }
+}
+
+// A key freed and reused while still queued only costs its new bindings
+// a spurious invalidation.
+size_t QmlNotifyBridge::drainChanges() {
+    return changes_.drain([this](uint32_t key) {
+        if (key < keyed_.size() && keyed_[key]) {
+            changed(*keyed_[key]);
+        }
+    });
+}
+
+void QmlNotifyBridge::forget(const QObject *object) {
+    for (auto it = objects_.begin(); it != objects_.end();) {
+        it = it->second == object ? objects_.erase(it) : std::next(it);
+    }
+    for (auto it = dependents_.begin(); it != dependents_.end();) {
+        if (it->first.first != object) {
+            ++it;
+            continue;
+        }
+        for (const std::string &binding : it->second.bindings) {
+            seen_.erase(binding);
+        }
+        const uint32_t key = it->second.relay->key();
+        if (key != QmlNotifyRelay::kNoKey) {
+            keyed_[key] = nullptr;
+            freeKeys_.push_back(key);
+        }
+        it = dependents_.erase(it);
+    }
+}
+
+size_t QmlNotifyBridge::subscriptionCount() const {
+    size_t count = 0;
+    for (const auto &entry : dependents_) {
+        count += entry.second.bindings.size();
+    }
+    return count;
+}
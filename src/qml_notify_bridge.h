@@ -0,0 +1,112 @@
+#pragma once
+
+#include <QObject>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "qml_change_queue.h"
+#include "qml_curses_frontend.h"
+
+class QmlNotifyBridge;
+
+// Receives one subscribed notify signal, directly on the emitting thread,
+// and hands its bindings to the bridge.
+class QmlNotifyRelay : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr uint32_t kNoKey = UINT32_MAX;  // change queue was full
+
+    QmlNotifyRelay(QmlNotifyBridge &bridge, const std::vector<std::string> &bindings, uint32_t key)
+        : bridge_(bridge), bindings_(bindings), key_(key) {}
+
+    uint32_t key() const { return key_; }
+
+public slots:
+    void onNotify();
+
+private:
+    QmlNotifyBridge &bridge_;
+    const std::vector<std::string> &bindings_;
+    uint32_t key_;
+};
+
+// Resolver adapter that turns Qt NOTIFY signals into frontend invalidation.
+// It forwards every binding to the wrapped writer and, the first time it
+// sees an "object.property" binding on a registered object whose property
+// has a notify signal, connects that signal. When the signal fires, the
+// changed handler is called with each binding that depends on it, so the
+// caller invalidates just those cache entries (and the cells drawn from
+// them) instead of re-resolving every binding each frame.
+//
+// Signals emitted on the bridge's thread call the handler straight away.
+// Those emitted on other threads only post the signal's key to a
+// lock-free, coalescing QmlChangeQueue, which never blocks the emitter and
+// allocates nothing; the first post since the last drain schedules one
+// queued drainChanges() on the bridge's thread, which calls the handler
+// once per changed binding however many times it changed in between. A
+// frame scheduler fed by the handler so gets each binding once per frame.
+//
+// The bridge is itself a BindingWriter callable; pass it to the frontend
+// by reference. The wrapped writer is not copied and must outlive it.
+class QmlNotifyBridge : public QObject {
+    Q_OBJECT
+
+public:
+    using ChangedHandler = std::function<void(const std::string &binding)>;
+
+    // Signals beyond changeCapacity subscribed at once are delivered
+    // through Qt's queued connections instead.
+    explicit QmlNotifyBridge(BindingWriter writer, QObject *parent = nullptr, uint32_t changeCapacity = 4096);
+    ~QmlNotifyBridge() override;
+
+    // Makes object's properties reachable as "name.property". The object
+    // may be destroyed before the bridge; its subscriptions go with it.
+    void addObject(const std::string &name, QObject *object);
+    // Typically invalidates the binding and requests a frame.
+    void setChangedHandler(ChangedHandler changed) { changed_ = std::move(changed); }
+
+    void operator()(std::string_view binding, std::string &value);
+
+    // Number of bindings currently connected to a notify signal.
+    size_t subscriptionCount() const;
+
+    // Calls the handler for the signals other threads posted since the
+    // last call; returns how many there were. Runs by itself after a post,
+    // and may be called early, e.g. at the start of a frame.
+    size_t drainChanges();
+    // Emissions from other threads merged into one already waiting.
+    uint64_t coalescedChangeCount() const { return changes_.coalescedCount(); }
+
+private:
+    friend class QmlNotifyRelay;
+    using SignalKey = std::pair<const QObject *, int>;  // sender, signal index
+
+    struct Subscription {
+        std::vector<std::string> bindings;
+        std::unique_ptr<QmlNotifyRelay> relay;
+    };
+
+    void subscribe(const std::string &binding);
+    void forget(const QObject *object);
+    void changed(const std::vector<std::string> &bindings);
+
+    BindingWriter writer_;
+    ChangedHandler changed_;
+    std::unordered_map<std::string, QObject *> objects_;
+    std::unordered_set<std::string> seen_;
+    std::map<SignalKey, Subscription> dependents_;  // nodes stay put for the relays
+    std::string key_;  // reused for seen_ lookups
+    QmlChangeQueue changes_;
+    // Bindings by subscription key; null for keys that are free.
+    std::vector<const std::vector<std::string> *> keyed_;
+    std::vector<uint32_t> freeKeys_;
+};
@@ -2,212 +2,1901 @@
 
 #include <algorithm>
 #include <cctype>
-#include <fstream>
-#include <sstream>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <optional>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "mapped_file.h"
+#include "qml_executor.h"
+#include "qml_key_slots.h"
+#include "qml_structural_scanner.h"
+#include "qml_trace.h"
+
+// What a parse needs besides the document: the line scanner's window, the
+// stack of open objects, the atom and key caches and the list reindex()
+// walks the tree in. A QmlParser keeps one
+// between calls, and each thread one for the parses it runs for a batch,
+// so repeated parses stop allocating once the buffers fit the largest
+// input (see ScratchLease).
+struct QmlParseScratch {
+    struct Level {
+        QmlNode *node;
+        size_t children = 0;
+        size_t properties = 0;
+        size_t scripts = 0;
+    };
+
+    // Names the atom cache may hold between parses; past that, as for a
+    // watched tree of generated files, it starts over.
+    static constexpr size_t kCachedAtoms = 4096;
+
+    QmlParseScratch() : arena(arenaStorage, sizeof(arenaStorage)) {
+        atoms.emplace(&arena);
+        stack.reserve(16);
+        walk.reserve(64);
+    }
+
+    void trimAtoms() {
+        if (atoms->size() > kCachedAtoms) {
+            atoms.reset();
+            arena.release();
+            atoms.emplace(&arena);
+        }
+    }
+
+    std::vector<size_t> window;
+    std::vector<Level> stack;
+    std::vector<const QmlNode *> walk;  // reindex()'s
+    // The atoms of a typical file fit here; more spill to the heap.
+    alignas(std::max_align_t) char arenaStorage[4096];
+    std::pmr::monotonic_buffer_resource arena;
+    std::optional<QmlAtomCache> atoms;
+    QmlKeySlots keys;
+};
 
 namespace {
 
-std::string ltrim(const std::string &text) {
-    const auto it = std::find_if_not(text.begin(), text.end(), [](unsigned char ch) {
-        return std::isspace(ch) != 0;
-    });
-    return std::string(it, text.end());
+bool isSpace(char ch) {
+    return std::isspace(static_cast<unsigned char>(ch)) != 0;
 }
 
-std::string rtrim(const std::string &text) {
-    const auto it = std::find_if_not(text.rbegin(), text.rend(), [](unsigned char ch) {
-        return std::isspace(ch) != 0;
-    });
-    return std::string(text.begin(), it.base());
+std::string_view ltrim(std::string_view text) {
+    const auto it = std::find_if_not(text.begin(), text.end(), isSpace);
+    text.remove_prefix(static_cast<size_t>(it - text.begin()));
+    return text;
 }
 
-std::string trim(const std::string &text) {
+std::string_view rtrim(std::string_view text) {
+    const auto it = std::find_if_not(text.rbegin(), text.rend(), isSpace);
+    text.remove_suffix(static_cast<size_t>(it - text.rbegin()));
+    return text;
+}
+
+std::string_view trim(std::string_view text) {
     return rtrim(ltrim(text));
 }
 
-std::string stripQuotes(const std::string &value) {
-    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+// Double- or single-quoted, as in JavaScript.
+std::string_view stripQuotes(std::string_view value) {
+    if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front()) {
         return value.substr(1, value.size() - 2);
     }
     return value;
 }
 
-void parseInlineProperties(const std::string &propertiesText, QmlNode &node) {
-    std::stringstream stream(propertiesText);
-    std::string segment;
+// QML signal handlers are "on" followed by a capitalized signal name,
+// attached ones such as "Component.onCompleted" included.
+bool isHandlerName(std::string_view key) {
+    key.remove_prefix(key.rfind('.') + 1);
+    return key.size() > 2 && key[0] == 'o' && key[1] == 'n' && key[2] >= 'A' && key[2] <= 'Z';
+}
 
-    while (std::getline(stream, segment, ';')) {
-        const auto trimmed = trim(segment);
-        if (trimmed.empty()) {
-            continue;
+bool isFunctionDeclaration(std::string_view head) {
+    return head.size() > 8 && head.substr(0, 8) == "function" && isSpace(head[8]);
+}
+
+bool startsWith(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+// Segments without a ':' that are still valid QML, and so not diagnosed.
+bool isBareStatement(std::string_view segment, bool topLevel) {
+    if (startsWith(segment, "//") || startsWith(segment, "/*") || startsWith(segment, "*")) {
+        return true;
+    }
+    if (topLevel) {
+        return startsWith(segment, "import ") || startsWith(segment, "pragma ");
+    }
+    for (std::string_view keyword : {"property ", "readonly ", "required ", "default ", "signal "}) {
+        if (startsWith(segment, keyword)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fills in line and column, sorting diagnostics into source order.
+void locate(std::vector<QmlDiagnostic> &diagnostics, std::string_view source) {
+    std::stable_sort(diagnostics.begin(), diagnostics.end(),
+                     [](const QmlDiagnostic &a, const QmlDiagnostic &b) { return a.offset < b.offset; });
+    size_t line = 1;
+    size_t lineBegin = 0;
+    size_t pos = 0;
+    for (QmlDiagnostic &diagnostic : diagnostics) {
+        for (; pos < diagnostic.offset && pos < source.size(); ++pos) {
+            if (source[pos] == '\n') {
+                ++line;
+                lineBegin = pos + 1;
+            }
+        }
+        diagnostic.line = line;
+        diagnostic.column = diagnostic.offset - lineBegin + 1;
+    }
+}
+
+// Builds the owning QmlNode tree. This is the only place where parsed
+// text is materialized into owned strings.
+//
+// Nodes, properties and scripts already in the document are overwritten
+// in place rather than rebuilt, and whatever the new source does not
+// reach is trimmed by finish(). Parsing into an empty document appends as
+// usual; parsing the same shape again reuses every buffer.
+class TreeBuilder {
+public:
+    TreeBuilder(QmlDocument &document, QmlParseScratch &scratch)
+        : document_(document), atoms_(*scratch.atoms), stack_(scratch.stack), keys_(scratch.keys) {
+        stack_.clear();
+        keys_.reset();
+    }
+
+    void beginObject(std::string_view type) {
+        QmlNodeList &list = stack_.empty() ? document_.roots : stack_.back().node->children;
+        size_t &used = stack_.empty() ? rootsUsed_ : stack_.back().children;
+        QmlNode &node = used < list.size() ? list[used] : list.emplace_back(document_.resource());
+        ++used;
+        setTypeOf(node, type);
+        node.id.clear();
+        node.binding = binding_;
+        binding_ = QmlAtoms::Invalid;
+        node.sourceBegin = lineBegin_;
+        stack_.push_back(Level{&node});
+    }
+
+    // The next object is the value of key.
+    void bindObject(std::string_view key) {
+        binding_ = atoms_.intern(key);
+    }
+
+    // Takes the value as written so quoted literals can be told apart from
+    // expressions. Keys stay unique, first assignment order, as with
+    // QmlNode::setProperty().
+    void typedProperty(std::string_view key, std::string_view source) {
+        Level &level = stack_.back();
+        std::pmr::vector<QmlProperty> &properties = level.node->properties;
+        const QmlAtom atom = atoms_.intern(key);
+        const size_t slot = keys_.find(stack_.size() - 1, atom, level.properties,
+                                       [&properties](size_t i) { return properties[i].key; });
+        if (slot == level.properties) {
+            if (slot == properties.size()) {
+                properties.emplace_back();
+            }
+            ++level.properties;
+            properties[slot].key = atom;
+        }
+        const auto it = properties.begin() + static_cast<std::ptrdiff_t>(slot);
+        const std::string_view value = stripQuotes(source);
+        it->value.assign(value.data(), value.size());
+        it->typed = QmlValue::classify(source);
+        if (atom == QmlAtoms::id) {
+            level.node->id.assign(value.data(), value.size());
+        }
+    }
+
+    void setTypeOf(QmlNode &node, std::string_view type) {
+        node.type.assign(type.data(), type.size());
+        node.typeAtom = atoms_.intern(type);
+    }
+
+    void endObject() {
+        const Level &level = stack_.back();
+        QmlNode &node = *level.node;
+        node.sourceEnd = lineEnd_;
+        node.properties.resize(level.properties);
+        node.scripts.resize(level.scripts);
+        trim(node.children, level.children);
+        keys_.close(stack_.size() - 1);
+        stack_.pop_back();
+    }
+
+    void atLine(size_t begin, size_t end) {
+        lineBegin_ = begin;
+        lineEnd_ = end;
+    }
+
+    void script(QmlScriptKind kind, std::string_view name, std::string_view parameters, size_t bodyBegin, size_t bodyEnd) {
+        Level &level = stack_.back();
+        std::pmr::vector<QmlScriptBlock> &scripts = level.node->scripts;
+        QmlScriptBlock &block = level.scripts < scripts.size() ? scripts[level.scripts] : scripts.emplace_back();
+        ++level.scripts;
+        block.kind = kind;
+        block.name = atoms_.intern(name);
+        block.parameters.assign(parameters.data(), parameters.size());
+        block.bodyBegin = bodyBegin;
+        block.bodyEnd = bodyEnd;
+    }
+
+    // Drops the roots the source did not reach. The line parser has closed
+    // every object by then.
+    void finish() {
+        trim(document_.roots, rootsUsed_);
+    }
+
+private:
+    using Level = QmlParseScratch::Level;
+
+    // Shrinking only, so a node that never had children stays without a
+    // buffer.
+    static void trim(QmlNodeList &list, size_t size) {
+        if (list.size() > size) {
+            list.resize(size);
+        }
+    }
+
+    QmlDocument &document_;
+    QmlAtomCache &atoms_;
+    std::vector<Level> &stack_;
+    QmlKeySlots &keys_;
+    size_t rootsUsed_ = 0;
+    size_t lineBegin_ = 0;
+    size_t lineEnd_ = 0;
+    QmlAtom binding_ = QmlAtoms::Invalid;
+};
+
+// Adapts the public event handler to the builder interface and remembers
+// when the handler asks to stop.
+class EventBuilder {
+public:
+    explicit EventBuilder(QmlEventHandler &handler) : handler_(handler) {}
+
+    void beginObject(std::string_view type) {
+        stopped_ = stopped_ || !handler_.beginObject(type);
+    }
+
+    void property(std::string_view key, std::string_view value) {
+        stopped_ = stopped_ || !handler_.property(key, value);
+    }
+
+    void endObject() {
+        stopped_ = stopped_ || !handler_.endObject();
+    }
+
+    void bindObject(std::string_view key) {
+        stopped_ = stopped_ || !handler_.bindObject(key);
+    }
+
+    void script(QmlScriptKind kind, std::string_view name, std::string_view parameters, size_t bodyBegin, size_t bodyEnd) {
+        stopped_ = stopped_ || !handler_.script(kind, name, parameters, bodyBegin, bodyEnd);
+    }
+
+    bool stopped() const { return stopped_; }
+
+private:
+    QmlEventHandler &handler_;
+    bool stopped_ = false;
+};
+
+template <typename Builder, typename = void>
+struct WantsTypedValues : std::false_type {};
+
+template <typename Builder>
+struct WantsTypedValues<Builder, std::void_t<decltype(std::declval<Builder &>().typedProperty(std::string_view(), std::string_view()))>>
+    : std::true_type {};
+
+template <typename Builder, typename = void>
+struct TracksLines : std::false_type {};
+
+template <typename Builder>
+struct TracksLines<Builder, std::void_t<decltype(std::declval<Builder &>().atLine(size_t(), size_t()))>> : std::true_type {};
+
+template <typename Builder, typename = void>
+struct TakesScripts : std::false_type {};
+
+template <typename Builder>
+struct TakesScripts<Builder,
+                    std::void_t<decltype(std::declval<Builder &>().script(QmlScriptKind(), std::string_view(),
+                                                                          std::string_view(), size_t(), size_t()))>>
+    : std::true_type {};
+
+template <typename Builder, typename = void>
+struct BindsObjects : std::false_type {};
+
+template <typename Builder>
+struct BindsObjects<Builder, std::void_t<decltype(std::declval<Builder &>().bindObject(std::string_view()))>>
+    : std::true_type {};
+
+template <typename Builder, typename = void>
+struct CanStop : std::false_type {};
+
+template <typename Builder>
+struct CanStop<Builder, std::void_t<decltype(std::declval<const Builder &>().stopped())>> : std::true_type {};
+
+// Line-oriented grammar shared by every storage mode. The builder receives
+// beginObject/property/endObject events; the parser guarantees properties
+// and endObject only arrive while an object is open.
+template <typename Builder>
+class LineParser {
+public:
+    explicit LineParser(Builder &builder, const QmlParseLimits &limits = {}) : builder_(builder), limits_(limits) {}
+
+    // Collects what the grammar skips or repairs into diagnostics, by
+    // offset only (see locate()). Null, the default, collects nothing.
+    void reportTo(std::vector<QmlDiagnostic> *diagnostics) { diagnostics_ = diagnostics; }
+    // The scanner's window buffer, kept by the caller to reuse it.
+    void scanIn(std::vector<size_t> &window) { window_ = &window; }
+
+    // Returns false if the builder stopped the parse early or a limit was
+    // exceeded. Whatever is open is closed either way.
+    bool parse(std::string_view source) {
+        const bool read = parseLines(source, 0, 0);
+        return finish() && read;
+    }
+
+    // Parses the lines of window from offset from on, for input that
+    // arrives in pieces. window starts base bytes into the input and must
+    // still hold it from retainFrom() on. Unless this is the last window,
+    // a line that may go on past its end is left for the next one (see
+    // parsedTo()), as is one whose next line has yet to show whether it
+    // starts with an operator. Builders get offsets into the whole input.
+    bool parseLines(std::string_view window, size_t base, size_t from, bool last = true) {
+        source_ = window;
+        base_ = base;
+        if (exceeded_) {
+            return false;
+        }
+        if (window.size() > limits_.maxBytes - std::min(base, limits_.maxBytes)) {
+            exceed(limits_.maxBytes, "input is over " + std::to_string(limits_.maxBytes) + " bytes");
+            return false;
         }
+        QmlStructuralScanner scanner(window, from, window_);
+        QmlScannedLine line;
+        parsedTo_ = window.size();
+        while (scanner.nextLine(line)) {
+            const size_t lineEnd = line.offset + line.text.size();
+            if (!last && window.find_first_not_of(" \t\r", lineEnd + 1) == std::string_view::npos) {
+                parsedTo_ = line.offset;
+                break;
+            }
+            if (line.text.size() > limits_.maxLineLength) {
+                exceed(base_ + line.offset, "line is over " + std::to_string(limits_.maxLineLength) + " bytes");
+                return false;
+            }
+            if constexpr (TracksLines<Builder>::value) {
+                builder_.atLine(base_ + line.offset, base_ + lineEnd);
+            }
+            parseLine(line);
+            if (stopped() || exceeded_) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-        const auto colonPos = trimmed.find(':');
-        if (colonPos == std::string::npos) {
+    // Ends the input, closing whatever is still open.
+    bool finish() {
+        // Past a limit, the input was cut short rather than left open.
+        if (inScript_ && !exceeded_) {
+            // Unterminated body: it runs to the end of the input.
+            reportAt(pendingScript_.bodyBegin, "script body is never closed");
+            finishScript(source_.size());
+        }
+        if (skipDepth_ > 0 && !exceeded_) {
+            ++topLevelStrays_;
+            reportAt(skipBegin_, "'{' is never closed");
+        }
+        for (size_t i = 0; i < openTypes_.size() && !exceeded_; ++i) {
+            report(offsetOf(openTypes_[i]), "'" + std::string(openTypes_[i]) + "' is never closed");
+        }
+        unclosedAtEnd_ = depth_;
+        if constexpr (TracksLines<Builder>::value) {
+            builder_.atLine(base_ + source_.size(), base_ + source_.size());
+        }
+        while (depth_ > 0) {
+            endObject();
+        }
+        return !stopped() && !exceeded_;
+    }
+
+    // For input still arriving, which parseLines() only sees once a line
+    // is complete: checks the bytes up to inputEnd and the unfinished line
+    // from lineBegin on. Returns false once a limit is exceeded.
+    bool withinLimits(size_t lineBegin, size_t inputEnd) {
+        if (inputEnd > limits_.maxBytes) {
+            exceed(limits_.maxBytes, "input is over " + std::to_string(limits_.maxBytes) + " bytes");
+        } else if (inputEnd - lineBegin > limits_.maxLineLength) {
+            exceed(lineBegin, "line is over " + std::to_string(limits_.maxLineLength) + " bytes");
+        }
+        return !exceeded_;
+    }
+
+    // Throws QmlParseLimitError if a limit stopped the parse.
+    void throwIfExceeded() const {
+        if (exceeded_) {
+            throw QmlParseLimitError(limitMessage_, limitOffset_);
+        }
+    }
+
+    // Objects that were still open when the input ran out.
+    size_t unclosedAtEnd() const { return unclosedAtEnd_; }
+
+    // Properties, scripts and '}' found outside any object, and a skipped
+    // '{' left open, which a parse in context would have placed elsewhere.
+    size_t topLevelStrays() const { return topLevelStrays_; }
+
+    // Whether the next line starts at nesting depth, outside any script.
+    bool idleAt(size_t depth) const { return depth_ == depth && !inScript_ && skipDepth_ == 0; }
+
+    // Offset in the last window where its unparsed lines start.
+    size_t parsedTo() const { return parsedTo_; }
+
+    // Earliest input offset the next window must hold: an open script
+    // body's text is read again when it closes. npos if none.
+    size_t retainFrom() const { return inScript_ ? pendingScript_.nameBegin : std::string_view::npos; }
+
+private:
+    Builder &builder_;
+    const QmlParseLimits limits_;
+    std::string_view source_;  // the current window
+    size_t base_ = 0;          // input offset of source_
+    size_t depth_ = 0;
+    size_t objects_ = 0;
+    bool exceeded_ = false;
+    size_t limitOffset_ = 0;  // input offset
+    std::string limitMessage_;
+    size_t unclosedAtEnd_ = 0;
+    size_t topLevelStrays_ = 0;
+    size_t parsedTo_ = 0;
+
+    // Script body still being brace-matched across lines, by input offset
+    // so it survives a change of window.
+    struct PendingScript {
+        QmlScriptKind kind;
+        size_t nameBegin;
+        size_t nameLength;
+        size_t parametersBegin;
+        size_t parametersLength;
+        size_t bodyBegin;
+        bool binding;  // "key: { ... }", whose body is the property's value
+    };
+    PendingScript pendingScript_{};
+    size_t scriptDepth_ = 0;
+    bool inScript_ = false;
+
+    // A '{' without a type and everything up to its matching '}' are
+    // skipped; skipDepth_ counts the braces still open.
+    size_t skipDepth_ = 0;
+    size_t skipBegin_ = 0;  // input offset
+
+    std::vector<QmlDiagnostic> *diagnostics_ = nullptr;
+    std::vector<size_t> *window_ = nullptr;
+    std::vector<std::string_view> openTypes_;  // only kept while reporting, which needs the whole source
+
+    void reportAt(size_t inputOffset, std::string message) {
+        if (diagnostics_) {
+            diagnostics_->push_back(QmlDiagnostic{inputOffset, 0, 0, std::move(message)});
+        }
+    }
+
+    void report(size_t offset, std::string message) { reportAt(base_ + offset, std::move(message)); }
+
+    // Stops the parse at inputOffset; see QmlParseLimits.
+    void exceed(size_t inputOffset, std::string message) {
+        exceeded_ = true;
+        limitOffset_ = inputOffset;
+        limitMessage_ = "parse limit: " + message;
+        reportAt(inputOffset, limitMessage_);
+    }
+
+    // Structural offsets of the current line, from the scanner. Characters
+    // inside string literals never appear here.
+    const size_t *structuralsBegin_ = nullptr;
+    const size_t *structuralsEnd_ = nullptr;
+
+    // The first structural at or after offset. Statements on a line are
+    // parsed left to right, so starting each search here rather than at
+    // the line's first structural keeps long lines linear.
+    const size_t *structuralAt(size_t offset) const {
+        return std::lower_bound(structuralsBegin_, structuralsEnd_, offset);
+    }
+
+    // Offset of the first structural ch in [from, to), or npos.
+    size_t findStructural(char ch, size_t from, size_t to) const {
+        for (const size_t *it = structuralAt(from); it != structuralsEnd_ && *it < to; ++it) {
+            if (source_[*it] == ch) {
+                return *it;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    size_t offsetOf(std::string_view view) const { return static_cast<size_t>(view.data() - source_.data()); }
+
+    std::string_view windowText(size_t inputOffset, size_t length) const {
+        return length == 0 ? std::string_view() : source_.substr(inputOffset - base_, length);
+    }
+
+    bool stopped() const {
+        if constexpr (CanStop<Builder>::value) {
+            return builder_.stopped();
+        } else {
+            return false;
+        }
+    }
+
+    void beginObject(std::string_view type) {
+        if (depth_ >= limits_.maxDepth) {
+            exceed(base_ + offsetOf(type), "objects nest over " + std::to_string(limits_.maxDepth) + " deep");
+            return;
+        }
+        if (++objects_ > limits_.maxObjects) {
+            exceed(base_ + offsetOf(type), "over " + std::to_string(limits_.maxObjects) + " objects");
+            return;
+        }
+        builder_.beginObject(type);
+        ++depth_;
+        if (diagnostics_) {
+            openTypes_.push_back(type);
+        }
+    }
+
+    void endObject() {
+        if (depth_ > 0) {
+            builder_.endObject();
+            --depth_;
+            if (!openTypes_.empty()) {
+                openTypes_.pop_back();
+            }
+        }
+    }
+
+    void script(QmlScriptKind kind, std::string_view name, std::string_view parameters, size_t bodyBegin, size_t bodyEnd) {
+        if (depth_ == 0) {
+            ++topLevelStrays_;
+            report(bodyBegin, "script outside any object");
+            return;
+        }
+        if constexpr (TakesScripts<Builder>::value) {
+            builder_.script(kind, name, parameters, base_ + bodyBegin, base_ + bodyEnd);
+        }
+    }
+
+    // Follows the skipped braces over [from, end). Returns the offset just
+    // past the one that closes the skip, or npos if it stays open.
+    size_t continueSkip(size_t from, size_t end) {
+        for (const size_t *it = structuralAt(from); it != structuralsEnd_ && *it < end; ++it) {
+            if (source_[*it] == '{') {
+                ++skipDepth_;
+            } else if (source_[*it] == '}' && --skipDepth_ == 0) {
+                return *it + 1;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    void startScript(QmlScriptKind kind, std::string_view name, std::string_view parameters, size_t bodyBegin,
+                     bool binding = false) {
+        pendingScript_ = PendingScript{kind,
+                                       base_ + offsetOf(name),
+                                       name.size(),
+                                       parameters.empty() ? 0 : base_ + offsetOf(parameters),
+                                       parameters.size(),
+                                       base_ + bodyBegin,
+                                       binding};
+        scriptDepth_ = 0;
+        inScript_ = true;
+    }
+
+    void finishScript(size_t stop) {
+        const PendingScript &pending = pendingScript_;
+        const size_t bodyBegin = pending.bodyBegin - base_;
+        const size_t bodyEnd = bodyBegin + rtrim(source_.substr(bodyBegin, stop - bodyBegin)).size();
+        inScript_ = false;
+        if (pending.binding) {
+            // Left out if bindable() reported it when the body opened.
+            if (depth_ > 0 && pending.nameLength > 0) {
+                property(windowText(pending.nameBegin, pending.nameLength),
+                         source_.substr(bodyBegin, bodyEnd - bodyBegin));
+            }
+            return;
+        }
+        script(pending.kind, windowText(pending.nameBegin, pending.nameLength),
+               windowText(pending.parametersBegin, pending.parametersLength), bodyBegin, bodyEnd);
+    }
+
+    // Brace-matches the open script over [from, end). The body stops at a
+    // ';' or '}' outside any brace it opened, or at the end of a line where
+    // all its braces are closed. Returns the stop offset, or npos if the
+    // body carries on past this line.
+    size_t continueScript(size_t from, size_t end) {
+        for (const size_t *it = structuralAt(from); it != structuralsEnd_ && *it < end; ++it) {
+            const char ch = source_[*it];
+            if (ch == '{') {
+                ++scriptDepth_;
+            } else if ((ch == '}' || ch == ';') && scriptDepth_ == 0) {
+                finishScript(*it);
+                return *it;
+            } else if (ch == '}') {
+                --scriptDepth_;
+            }
+        }
+        if (scriptDepth_ > 0) {
+            return std::string_view::npos;
+        }
+        finishScript(end);
+        return end;
+    }
+
+    // rawValue is trimmed but still quoted.
+    void property(std::string_view key, std::string_view rawValue) {
+        if constexpr (WantsTypedValues<Builder>::value) {
+            builder_.typedProperty(key, rawValue);
+        } else {
+            builder_.property(key, stripQuotes(rawValue));
+        }
+    }
+
+    // Offset of the first structural in [from, to) that is one of chars,
+    // or npos.
+    size_t findStructuralOf(std::string_view chars, size_t from, size_t to) const {
+        for (const size_t *it = structuralAt(from); it != structuralsEnd_ && *it < to; ++it) {
+            if (chars.find(source_[*it]) != std::string_view::npos) {
+                return *it;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    // Narrows [start, end) to its code: leading comments and a trailing
+    // line or block comment are dropped, using the scanner's markers. A
+    // line comment ends with its physical line, so one inside a joined
+    // line stays in the code around it.
+    void stripComments(size_t &start, size_t &end) const {
+        const std::string_view text = trim(source_.substr(start, end - start));
+        start = offsetOf(text);
+        end = start + text.size();
+        for (const size_t *it = structuralAt(start); it != structuralsEnd_ && *it < end; ++it) {
+            if (source_[*it] != '/' || *it < start) {
+                continue;
+            }
+            size_t after;
+            if (source_[*it + 1] == '/') {
+                const size_t newline = source_.find('\n', *it);
+                after = newline < end ? newline + 1 : end;
+            } else {
+                const size_t close = findStructural('*', *it + 2, end);
+                after = close == std::string_view::npos ? end : close + 2;
+            }
+            if (*it == start) {
+                start = offsetOf(ltrim(source_.substr(after, end - after)));
+            } else if (trim(source_.substr(after, end - after)).empty()) {
+                end = *it;
+                break;
+            }
+        }
+        if (start >= end) {
+            end = start;
+            return;
+        }
+        end = start + rtrim(source_.substr(start, end - start)).size();
+    }
+
+    // Reports a statement the grammar has no place for, if it is not one
+    // that needs none.
+    void bareStatement(size_t from, size_t to) {
+        if (!diagnostics_) {
+            return;
+        }
+        const std::string_view segment = trim(source_.substr(from, to - from));
+        if (!segment.empty() && !isBareStatement(segment, depth_ == 0)) {
+            report(offsetOf(segment), depth_ > 0 ? "expected 'name: value'" : "expected an object");
+        }
+    }
+
+    // Opens an object whose '{' is at bracePos. Returns where the
+    // statements go on, or npos if the rest of the line is used up.
+    size_t openObject(std::string_view type, size_t bracePos, size_t end) {
+        if (!type.empty()) {
+            beginObject(type);
+            return bracePos + 1;
+        }
+        report(bracePos, "object has no type; skipped to its '}'");
+        skipBegin_ = base_ + bracePos;
+        skipDepth_ = 1;
+        return continueSkip(bracePos + 1, end);
+    }
+
+    void closeObject(size_t bracePos) {
+        if (depth_ == 0) {
+            ++topLevelStrays_;
+            report(bracePos, "unexpected '}'");
+        }
+        endObject();
+    }
+
+    // function name(parameters) { body }
+    size_t parseFunction(size_t from, size_t end) {
+        const size_t bracePos = findStructural('{', from, end);
+        const size_t headEnd = bracePos == std::string_view::npos ? end : bracePos;
+        const std::string_view head = source_.substr(from + 8, headEnd - from - 8);
+        const size_t open = head.find('(');
+        const size_t close = head.rfind(')');
+        const std::string_view name = trim(head.substr(0, open));
+        const std::string_view parameters = open != std::string_view::npos && close != std::string_view::npos &&
+                                                    close > open
+                                                ? trim(head.substr(open + 1, close - open - 1))
+                                                : std::string_view();
+        startScript(QmlScriptKind::Function, name, parameters, headEnd);
+        return continueScript(headEnd, end);
+    }
+
+    // Whether a binding of key has an object to go to and a name; reports
+    // it if not. statement runs from the key to the end of the value.
+    bool bindable(std::string_view key, size_t colonPos, std::string_view statement) {
+        if (depth_ > 0 && !key.empty()) {
+            return true;
+        }
+        topLevelStrays_ += depth_ == 0;
+        if (diagnostics_ && !isBareStatement(statement, depth_ == 0)) {
+            report(key.empty() ? colonPos : offsetOf(key),
+                   key.empty() ? "missing property name" : "property outside any object");
+        }
+        return false;
+    }
+
+    // "key: value", a handler, "key: { block }" or "key: Type {" for an
+    // object-valued property.
+    size_t parseBinding(size_t from, size_t colonPos, size_t end) {
+        const std::string_view key = trim(source_.substr(from, colonPos - from));
+        const std::string_view rest = ltrim(source_.substr(colonPos + 1, end - colonPos - 1));
+        const bool handler = isHandlerName(key);
+        if (handler || startsWith(rest, "{")) {
+            // The body may contain ';' and braces of its own.
+            if (!handler) {
+                bindable(key, colonPos, source_.substr(from, end - from));
+            }
+            startScript(QmlScriptKind::Handler, key, {}, offsetOf(rest), !handler);
+            return continueScript(offsetOf(rest), end);
+        }
+        const size_t stop = findStructuralOf("{};", colonPos + 1, end);
+        if (stop != std::string_view::npos && source_[stop] == '{') {
+            if (bindable(key, colonPos, source_.substr(from, stop - from))) {
+                if constexpr (BindsObjects<Builder>::value) {
+                    builder_.bindObject(key);
+                }
+            }
+            return openObject(trim(source_.substr(colonPos + 1, stop - colonPos - 1)), stop, end);
+        }
+        const size_t valueEnd = stop == std::string_view::npos ? end : stop;
+        if (bindable(key, colonPos, source_.substr(from, valueEnd - from))) {
+            property(key, trim(source_.substr(colonPos + 1, valueEnd - colonPos - 1)));
+        }
+        return valueEnd;
+    }
+
+    // Parses the statements in [from, end): objects opening and closing,
+    // bindings, handlers and functions, any number to a line, separated by
+    // ';' where nothing else divides them.
+    void parseStatements(size_t from, size_t end) {
+        while (from < end && !exceeded_) {
+            const std::string_view rest = ltrim(source_.substr(from, end - from));
+            if (rest.empty()) {
+                return;
+            }
+            from = offsetOf(rest);
+            if (isFunctionDeclaration(rest)) {
+                from = parseFunction(from, end);
+                continue;
+            }
+            const size_t stop = findStructuralOf("{};:", from, end);
+            if (stop == std::string_view::npos) {
+                bareStatement(from, end);
+                return;
+            }
+            switch (source_[stop]) {
+            case ':':
+                from = parseBinding(from, stop, end);
+                break;
+            case '{':
+                from = openObject(trim(source_.substr(from, stop - from)), stop, end);
+                break;
+            case '}':
+                bareStatement(from, stop);
+                closeObject(stop);
+                from = stop + 1;
+                break;
+            default:
+                bareStatement(from, stop);
+                from = stop + 1;
+                break;
+            }
+        }
+    }
+
+    void parseLine(const QmlScannedLine &line) {
+        structuralsBegin_ = line.structuralsBegin;
+        structuralsEnd_ = line.structuralsEnd;
+        size_t start = line.offset;
+        size_t end = line.offset + line.text.size();
+        stripComments(start, end);
+        if (start == end) {
+            return;
+        }
+        if (inScript_) {
+            start = continueScript(start, end);
+        } else if (skipDepth_ > 0) {
+            start = continueSkip(start, end);
+        }
+        if (start != std::string_view::npos) {
+            parseStatements(start, end);
+        }
+    }
+};
+
+// A forest given as a plain array of nodes.
+struct NodeSpan {
+    const QmlNode *first;
+    const QmlNode *last;
+
+    const QmlNode *begin() const { return first; }
+    std::reverse_iterator<const QmlNode *> rbegin() const { return std::reverse_iterator<const QmlNode *>(last); }
+    std::reverse_iterator<const QmlNode *> rend() const { return std::reverse_iterator<const QmlNode *>(first); }
+};
+
+// Iterative pre-order walk over a forest; safe for arbitrarily deep trees.
+// Works on const and mutable forests alike. pending, a vector of node
+// pointers, holds the nodes still to visit; a caller that walks again keeps
+// it to reuse its capacity.
+template <typename Forest, typename Visitor, typename Pending>
+void forEachPreorder(Forest &roots, Visitor &&visit, Pending &pending) {
+    pending.clear();
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it) {
+        pending.push_back(&*it);
+    }
+    while (!pending.empty()) {
+        const auto node = pending.back();
+        pending.pop_back();
+        visit(*node);
+        for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+            pending.push_back(&*it);
+        }
+    }
+}
+
+// The pending list of a typical document stays in a buffer on the stack.
+template <typename Forest, typename Visitor>
+void forEachPreorder(Forest &roots, Visitor &&visit) {
+    using NodePointer = decltype(&*roots.begin());
+    constexpr size_t kInlinePending = 64;
+    alignas(NodePointer) char storage[kInlinePending * sizeof(NodePointer)];
+    std::pmr::monotonic_buffer_resource buffer(storage, sizeof(storage));
+    std::pmr::vector<NodePointer> pending(&buffer);
+    pending.reserve(kInlinePending);
+    forEachPreorder(roots, visit, pending);
+}
+
+// Backs the walk() methods. Each frame holds the siblings still to enter
+// at one level and the node to leave once they are done.
+bool walkForest(const QmlNodeList &roots, QmlNodeVisitor enter, QmlNodeLeaveVisitor leave) {
+    struct Frame {
+        const QmlNode *next;
+        const QmlNode *end;
+        const QmlNode *parent;
+    };
+    constexpr size_t kInlineFrames = 32;
+    alignas(Frame) char storage[kInlineFrames * sizeof(Frame)];
+    std::pmr::monotonic_buffer_resource buffer(storage, sizeof(storage));
+    std::pmr::vector<Frame> frames(&buffer);
+    frames.reserve(kInlineFrames);
+
+    const auto push = [&frames](const QmlNodeList &list, const QmlNode *parent) {
+        const QmlNode *first = list.vector().data();
+        frames.push_back(Frame{first, first + list.size(), parent});
+    };
+    push(roots, nullptr);
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        if (frame.next == frame.end) {
+            const QmlNode *parent = frame.parent;
+            frames.pop_back();
+            if (parent && leave) {
+                leave(*parent);
+            }
             continue;
         }
+        const QmlNode &node = *frame.next++;
+        const QmlVisit visit = enter(node);
+        if (visit == QmlVisit::Stop) {
+            return false;
+        }
+        if (visit == QmlVisit::Continue && !node.children.empty()) {
+            push(node.children, &node);
+        } else if (leave) {
+            leave(node);
+        }
+    }
+    return true;
+}
+
+struct ThreadScratch {
+    QmlParseScratch scratch;
+    bool leased = false;
+};
+
+ThreadScratch &threadScratch() {
+    thread_local ThreadScratch slot;
+    return slot;
+}
+
+// Scratch for one parse: the parser's own while no other call uses it,
+// else the calling thread's, else, for a parse nested in another on the
+// same thread, one of its own.
+class ScratchLease {
+public:
+    ScratchLease() { takeThreadScratch(); }
+
+    ScratchLease(std::unique_ptr<QmlParseScratch> &owned, std::atomic<bool> &leased) {
+        if (leased.exchange(true, std::memory_order_acquire)) {
+            takeThreadScratch();
+            return;
+        }
+        if (!owned) {
+            owned = std::make_unique<QmlParseScratch>();
+        }
+        scratch_ = owned.get();
+        ownerLeased_ = &leased;
+    }
+
+    ScratchLease(const ScratchLease &) = delete;
+    ScratchLease &operator=(const ScratchLease &) = delete;
+
+    ~ScratchLease() {
+        scratch_->trimAtoms();
+        if (ownerLeased_) {
+            ownerLeased_->store(false, std::memory_order_release);
+        } else if (thread_) {
+            thread_->leased = false;
+        }
+    }
 
-        const std::string key = trim(trimmed.substr(0, colonPos));
-        const std::string rawValue = trim(trimmed.substr(colonPos + 1));
-        const std::string value = stripQuotes(rawValue);
+    QmlParseScratch &operator*() const { return *scratch_; }
+    QmlParseScratch *operator->() const { return scratch_; }
 
-        node.properties[key] = value;
-        if (key == "id") {
-            node.id = value;
+private:
+    void takeThreadScratch() {
+        ThreadScratch &slot = threadScratch();
+        if (slot.leased) {
+            scratch_ = &own_.emplace();
+            return;
         }
+        slot.leased = true;
+        thread_ = &slot;
+        scratch_ = &slot.scratch;
     }
+
+    QmlParseScratch *scratch_ = nullptr;
+    std::atomic<bool> *ownerLeased_ = nullptr;
+    ThreadScratch *thread_ = nullptr;
+    std::optional<QmlParseScratch> own_;
+};
+
+// Throws QmlParseLimitError once document and diagnostics are complete.
+void buildDocument(QmlDocument &document, std::string_view source, const QmlParseLimits &limits,
+                   QmlParseScratch &scratch, std::vector<QmlDiagnostic> *diagnostics = nullptr) {
+    TreeBuilder builder(document, scratch);
+    LineParser<TreeBuilder> parser(builder, limits);
+    parser.scanIn(scratch.window);
+    parser.reportTo(diagnostics);
+    parser.parse(source);
+    builder.finish();
+    document.reindex(scratch.walk);
+    if (diagnostics) {
+        locate(*diagnostics, source);
+    }
+    parser.throwIfExceeded();
+}
+
+// Where parseStringParallel() cuts the input: the lines from begin to end
+// hold the children of one object, at depth, and every boundary starts
+// one of them. Chunks run from one boundary to the next, the last to end.
+struct SplitPlan {
+    size_t depth = 0;
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<size_t> boundaries;
+};
+
+// A line that opens an object: its first structural is a '{' after a type
+// such as "Text" or "Behavior on x", which rules out most script lines.
+bool opensObject(std::string_view source, const QmlScannedLine &line, std::string_view trimmed) {
+    if (line.structuralsBegin == line.structuralsEnd || source[*line.structuralsBegin] != '{') {
+        return false;
+    }
+    const std::string_view type =
+        rtrim(trimmed.substr(0, *line.structuralsBegin - static_cast<size_t>(trimmed.data() - source.data())));
+    if (type.empty() || isFunctionDeclaration(trimmed)) {
+        return false;
+    }
+    return std::all_of(type.begin(), type.end(),
+                       [](char ch) { return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '.' || ch == ' '; });
+}
+
+// One scan over the structurals, counting braces the way the parser nests
+// objects, finds the first object at each depth whose children span most
+// of the input, and object-starting lines among them at least chunkBytes
+// apart. The shallowest such depth wins. Braces the count gets wrong, say
+// in a trailing comment, only make a chunk fail its check later.
+bool planSplit(std::string_view source, size_t chunkBytes, SplitPlan &plan) {
+    constexpr size_t kMaxDepth = 8;
+    struct Region {
+        size_t begin = std::string_view::npos;
+        size_t end = std::string_view::npos;
+        std::vector<size_t> boundaries;
+    };
+    Region regions[kMaxDepth];
+
+    QmlStructuralScanner scanner(source);
+    QmlScannedLine line;
+    size_t depth = 0;
+    while (scanner.nextLine(line)) {
+        const std::string_view trimmed = trim(line.text);
+        if (trimmed.empty() || trimmed.rfind("//", 0) == 0) {
+            continue;
+        }
+        if (depth < kMaxDepth && opensObject(source, line, trimmed)) {
+            Region &region = regions[depth];
+            if (region.begin == std::string_view::npos) {
+                region.begin = line.offset;
+                region.boundaries.push_back(line.offset);
+            } else if (region.end == std::string_view::npos && line.offset - region.boundaries.back() >= chunkBytes) {
+                region.boundaries.push_back(line.offset);
+            }
+        }
+        for (const size_t *it = line.structuralsBegin; it != line.structuralsEnd; ++it) {
+            if (source[*it] == '{') {
+                ++depth;
+            } else if (source[*it] == '}' && depth > 0) {
+                // The first object to close below a region's depth is its parent.
+                if (depth < kMaxDepth && regions[depth].begin != std::string_view::npos &&
+                    regions[depth].end == std::string_view::npos) {
+                    regions[depth].end = line.offset;
+                }
+                --depth;
+            }
+        }
+    }
+
+    for (size_t d = 0; d < kMaxDepth; ++d) {
+        Region &region = regions[d];
+        if (region.begin == std::string_view::npos) {
+            break;
+        }
+        if (region.end == std::string_view::npos) {
+            region.end = source.size();
+        }
+        if (region.boundaries.size() > 1 && region.end - region.begin >= source.size() / 2) {
+            plan.depth = d;
+            plan.begin = region.begin;
+            plan.end = region.end;
+            plan.boundaries = std::move(region.boundaries);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether the opening line of an object reparsed on its own holds nothing
+// before its type but the "key:" it is the value of, which goes to key
+// (empty for a plain child). Anything else, such as "z: 1;" in
+// "z: 1; Text {", belongs to the parent, which the fragment does not show.
+bool splitOpening(std::string_view slice, std::string_view type, std::string_view &key) {
+    const auto opens = [type](std::string_view text) {
+        return startsWith(text, type) && startsWith(ltrim(text.substr(type.size())), "{");
+    };
+    const std::string_view line = ltrim(slice.substr(0, slice.find('\n')));
+    key = {};
+    if (opens(line)) {
+        return true;
+    }
+    const size_t colon = line.find(':');
+    if (colon == std::string_view::npos) {
+        return false;
+    }
+    key = rtrim(line.substr(0, colon));
+    const auto isNameChar = [](char ch) {
+        return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '.';
+    };
+    return !key.empty() && std::all_of(key.begin(), key.end(), isNameChar) && opens(ltrim(line.substr(colon + 1)));
 }
 
 }  // namespace
 
+bool QmlEventHandler::script(QmlScriptKind, std::string_view, std::string_view, size_t, size_t) {
+    return true;
+}
+
+bool QmlEventHandler::bindObject(std::string_view) {
+    return true;
+}
+
+void QmlNode::setType(std::string_view newType) {
+    type.assign(newType.data(), newType.size());
+    typeAtom = QmlAtomTable::global().intern(newType);
+}
+
+void QmlNode::setProperty(QmlAtom key, std::string value, QmlValue typed) {
+    if (key == QmlAtoms::id) {
+        id = value;
+    }
+    for (auto &prop : properties) {
+        if (prop.key == key) {
+            prop.value = std::move(value);
+            prop.typed = typed;
+            return;
+        }
+    }
+    properties.push_back(QmlProperty{key, std::move(value), typed});
+}
+
+const QmlProperty *QmlNode::findProperty(QmlAtom key) const {
+    for (const auto &prop : properties) {
+        if (prop.key == key) {
+            return &prop;
+        }
+    }
+    return nullptr;
+}
+
+std::string QmlNode::property(QmlAtom key, const std::string &defaultValue) const {
+    const QmlProperty *prop = findProperty(key);
+    return prop ? prop->value : defaultValue;
+}
+
 std::string QmlNode::property(const std::string &key, const std::string &defaultValue) const {
-    const auto it = properties.find(key);
-    if (it == properties.end()) {
+    const QmlAtom atom = QmlAtomTable::global().find(key);
+    return atom == QmlAtoms::Invalid ? defaultValue : property(atom, defaultValue);
+}
+
+int QmlNode::intProperty(QmlAtom key, int defaultValue) const {
+    const QmlProperty *prop = findProperty(key);
+    if (!prop || prop->typed.kind != QmlValueKind::Int || prop->typed.intValue < std::numeric_limits<int>::min() ||
+        prop->typed.intValue > std::numeric_limits<int>::max()) {
         return defaultValue;
     }
-    return it->second;
+    return static_cast<int>(prop->typed.intValue);
 }
 
-const QmlNode *QmlNode::findChildByType(const std::string &wantedType) const {
-    for (const auto &child : children) {
-        if (child.type == wantedType) {
-            return &child;
+double QmlNode::realProperty(QmlAtom key, double defaultValue) const {
+    const QmlProperty *prop = findProperty(key);
+    return prop && prop->typed.isNumber() ? prop->typed.realValue : defaultValue;
+}
+
+bool QmlNode::boolProperty(QmlAtom key, bool defaultValue) const {
+    const QmlProperty *prop = findProperty(key);
+    return prop && prop->typed.kind == QmlValueKind::Bool ? prop->typed.intValue != 0 : defaultValue;
+}
+
+const QmlScriptBlock *QmlNode::findScript(QmlAtom name) const {
+    for (const auto &script : scripts) {
+        if (script.name == name) {
+            return &script;
         }
-        if (const auto *nested = child.findChildByType(wantedType)) {
-            return nested;
+    }
+    return nullptr;
+}
+
+const QmlNode *QmlNode::findChildByType(QmlAtom wantedType) const {
+    for (const QmlNode &node : descendants()) {
+        if (node.typeAtom == wantedType) {
+            return &node;
         }
     }
     return nullptr;
 }
 
+const QmlNode *QmlNode::findChildByType(const std::string &wantedType) const {
+    const QmlAtom atom = QmlAtomTable::global().find(wantedType);
+    return atom == QmlAtoms::Invalid ? nullptr : findChildByType(atom);
+}
+
 const QmlNode *QmlNode::findChildById(const std::string &wantedId) const {
-    for (const auto &child : children) {
-        if (child.id == wantedId) {
-            return &child;
-        }
-        if (const auto *nested = child.findChildById(wantedId)) {
-            return nested;
+    for (const QmlNode &node : descendants()) {
+        if (node.id == wantedId) {
+            return &node;
         }
     }
     return nullptr;
 }
 
-const QmlNode *QmlDocument::firstRootOfType(const std::string &wantedType) const {
-    for (const auto &root : roots) {
-        if (root.type == wantedType) {
-            return &root;
+std::vector<const QmlNode *> QmlNode::findChildrenByType(QmlAtom wantedType) const {
+    std::vector<const QmlNode *> result;
+    for (const QmlNode &node : descendants()) {
+        if (node.typeAtom == wantedType) {
+            result.push_back(&node);
+        }
+    }
+    return result;
+}
+
+bool QmlNode::walkDescendants(QmlNodeVisitor enter, QmlNodeLeaveVisitor leave) const {
+    return walkForest(children, enter, leave);
+}
+
+QmlNodeRange QmlNode::descendants() const {
+    return QmlNodeRange(children);
+}
+
+QmlNodeIterator::QmlNodeIterator(const QmlNodeList &roots) {
+    push(roots);
+    popFinished();
+}
+
+QmlNodeIterator &QmlNodeIterator::operator++() {
+    const QmlNode &node = *frames_.back().next++;
+    push(node.children);
+    popFinished();
+    return *this;
+}
+
+QmlNodeIterator &QmlNodeIterator::skipChildren() {
+    ++frames_.back().next;
+    popFinished();
+    return *this;
+}
+
+void QmlNodeIterator::push(const QmlNodeList &list) {
+    if (!list.empty()) {
+        const QmlNode *first = list.vector().data();
+        frames_.push_back(Frame{first, first + list.size()});
+    }
+}
+
+void QmlNodeIterator::popFinished() {
+    while (!frames_.empty() && frames_.back().next == frames_.back().end) {
+        frames_.pop_back();
+    }
+}
+
+void QmlDocument::reindex() {
+    // The pending list of a typical document stays in a buffer on the stack.
+    constexpr size_t kInlinePending = 64;
+    alignas(const QmlNode *) char storage[kInlinePending * sizeof(const QmlNode *)];
+    std::pmr::monotonic_buffer_resource buffer(storage, sizeof(storage));
+    std::pmr::vector<const QmlNode *> pending(&buffer);
+    pending.reserve(kInlinePending);
+    reindexIn(pending);
+}
+
+void QmlDocument::reindex(std::vector<const QmlNode *> &pending) {
+    reindexIn(pending);
+}
+
+template <typename Pending>
+void QmlDocument::reindexIn(Pending &pending) {
+    // An index no snapshot shares is refilled in place, so its buckets,
+    // pooled entries and the node lists of types that come again are
+    // reused.
+    std::shared_ptr<Index> index;
+    if (index_ && index_.use_count() == 1) {
+        index = std::move(index_);
+        index->ids.clear();
+        for (auto &entry : index->types) {
+            entry.second.clear();
         }
-        if (const auto *nested = root.findChildByType(wantedType)) {
-            return nested;
+        index->parents.clear();
+        index->parentsBuilt = false;
+    } else {
+        index = std::allocate_shared<Index>(std::pmr::polymorphic_allocator<Index>(resource()), resource());
+    }
+    // Pre-order, so the first entry per key matches the first-match order
+    // of the recursive lookups. Walked through a const reference so a
+    // shared tree stays shared.
+    forEachPreorder(
+        std::as_const(roots),
+        [&index](const QmlNode &node) {
+            if (!node.id.empty()) {
+                index->ids.emplace(node.id, &node);
+            }
+            index->types[node.typeAtom].push_back(&node);
+        },
+        pending);
+    for (auto it = index->types.begin(); it != index->types.end();) {
+        it = it->second.empty() ? index->types.erase(it) : std::next(it);
+    }
+    static std::atomic<uint64_t> lastRevision{0};
+    index->revision = lastRevision.fetch_add(1, std::memory_order_relaxed) + 1;
+    index->firstRoot = std::as_const(roots).vector().data();
+    index->rootCount = roots.size();
+    index_ = std::move(index);
+}
+
+const QmlNode *QmlDocument::firstRootOfType(QmlAtom wantedType) const {
+    if (index_) {
+        const auto it = index_->types.find(wantedType);
+        return it == index_->types.end() ? nullptr : it->second.front();
+    }
+    for (const QmlNode &node : nodes()) {
+        if (node.typeAtom == wantedType) {
+            return &node;
         }
     }
     return nullptr;
 }
 
+const QmlNode *QmlDocument::firstRootOfType(const std::string &wantedType) const {
+    const QmlAtom atom = QmlAtomTable::global().find(wantedType);
+    return atom == QmlAtoms::Invalid ? nullptr : firstRootOfType(atom);
+}
+
 const QmlNode *QmlDocument::findById(const std::string &wantedId) const {
-    for (const auto &root : roots) {
-        if (root.id == wantedId) {
-            return &root;
+    if (index_) {
+        const auto it = index_->ids.find(wantedId);
+        return it == index_->ids.end() ? nullptr : it->second;
+    }
+    for (const QmlNode &node : nodes()) {
+        if (node.id == wantedId) {
+            return &node;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<const QmlNode *> QmlDocument::nodesOfType(QmlAtom wantedType) const {
+    if (index_) {
+        const auto it = index_->types.find(wantedType);
+        return it == index_->types.end() ? std::vector<const QmlNode *>()
+                                         : std::vector<const QmlNode *>(it->second.begin(), it->second.end());
+    }
+    std::vector<const QmlNode *> result;
+    forEachPreorder(roots, [&](const QmlNode &node) {
+        if (node.typeAtom == wantedType) {
+            result.push_back(&node);
+        }
+    });
+    return result;
+}
+
+bool QmlDocument::walk(QmlNodeVisitor enter, QmlNodeLeaveVisitor leave) const {
+    return walkForest(roots, enter, leave);
+}
+
+const QmlNode *QmlDocument::parentOf(const QmlNode &node) const {
+    if (index_) {
+        const Index &index = *index_;
+        if (!index.parentsBuilt.load(std::memory_order_acquire)) {
+            const std::lock_guard<std::mutex> lock(index.parentsMutex);
+            if (!index.parentsBuilt.load(std::memory_order_relaxed)) {
+                const NodeSpan indexed{index.firstRoot, index.firstRoot + index.rootCount};
+                forEachPreorder(indexed, [&index](const QmlNode &parent) {
+                    for (const QmlNode &child : parent.children) {
+                        index.parents.emplace(&child, &parent);
+                    }
+                });
+                index.parentsBuilt.store(true, std::memory_order_release);
+            }
         }
-        if (const auto *nested = root.findChildById(wantedId)) {
-            return nested;
+        const auto it = index.parents.find(&node);
+        return it == index.parents.end() ? nullptr : it->second;
+    }
+    for (const QmlNode &candidate : nodes()) {
+        const QmlNode *first = candidate.children.vector().data();
+        if (&node >= first && &node < first + candidate.children.size()) {
+            return &candidate;
         }
     }
     return nullptr;
 }
 
-QmlDocument QmlParser::parseFile(const std::string &path) const {
-    std::ifstream file(path);
-    if (!file) {
-        throw std::runtime_error("Failed to open QML file: " + path);
+const QmlNodeList *QmlDocument::siblingsOf(const QmlNode &node) const {
+    const QmlNode *first = roots.vector().data();
+    if (&node >= first && &node < first + roots.size()) {
+        return &roots;
     }
+    const QmlNode *parent = parentOf(node);
+    return parent ? &parent->children : nullptr;
+}
 
-    std::ostringstream buffer;
-    buffer << file.rdbuf();
-    return parseString(buffer.str());
+const QmlNode *QmlDocument::nextSiblingOf(const QmlNode &node) const {
+    const QmlNodeList *siblings = siblingsOf(node);
+    return siblings && &node + 1 != siblings->vector().data() + siblings->size() ? &node + 1 : nullptr;
 }
 
-QmlDocument QmlParser::parseString(const std::string &source) const {
-    QmlDocument document;
-    std::vector<QmlNode *> stack;
+const QmlNode *QmlDocument::previousSiblingOf(const QmlNode &node) const {
+    const QmlNodeList *siblings = siblingsOf(node);
+    return siblings && &node != siblings->vector().data() ? &node - 1 : nullptr;
+}
 
-    auto pushNode = [&](const std::string &type) -> QmlNode & {
-        if (stack.empty()) {
-            document.roots.push_back(QmlNode{});
-            stack.push_back(&document.roots.back());
-        } else {
-            stack.back()->children.push_back(QmlNode{});
-            stack.push_back(&stack.back()->children.back());
+const QmlNode *QmlDocument::enclosingOfType(const QmlNode &node, QmlAtom wantedType) const {
+    for (const QmlNode *parent = parentOf(node); parent; parent = parentOf(*parent)) {
+        if (parent->typeAtom == wantedType) {
+            return parent;
         }
-        stack.back()->type = type;
-        return *stack.back();
-    };
+    }
+    return nullptr;
+}
 
-    std::istringstream input(source);
-    std::string line;
-    while (std::getline(input, line)) {
-        std::string trimmed = trim(line);
-        if (trimmed.empty() || trimmed.rfind("//", 0) == 0) {
-            continue;
-        }
+namespace {
 
-        // Handle inline opening brace.
-        const auto bracePos = trimmed.find('{');
-        if (bracePos != std::string::npos) {
-            const std::string type = trim(trimmed.substr(0, bracePos));
-            if (type.empty()) {
-                continue;
-            }
+// Strings short enough for the small-string buffer own no heap memory.
+size_t heapBytes(const std::string &text) {
+    static const size_t inlineCapacity = std::string().capacity();
+    return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+}
 
-            QmlNode &node = pushNode(type);
-            std::string remainder = trim(trimmed.substr(bracePos + 1));
-            bool closesInline = false;
-            if (!remainder.empty() && remainder.back() == '}') {
-                closesInline = true;
-                remainder = trim(remainder.substr(0, remainder.size() - 1));
-            }
+// Buckets plus one node per entry, each a next pointer and the pair; a
+// close estimate for the common node-based implementations.
+template <typename Map>
+size_t hashMapBytes(const Map &map) {
+    return map.bucket_count() * sizeof(void *) + map.size() * (sizeof(void *) + sizeof(typename Map::value_type));
+}
 
-            if (!remainder.empty()) {
-                parseInlineProperties(remainder, node);
-            }
+void addNodeUsage(const QmlNode &node, QmlMemoryUsage &usage) {
+    ++usage.nodeCount;
+    usage.nodes += sizeof(QmlNode);
+    usage.childVectors += (node.children.capacity() - node.children.size()) * sizeof(QmlNode);
+    usage.properties += node.properties.capacity() * sizeof(QmlProperty);
+    usage.scripts += node.scripts.capacity() * sizeof(QmlScriptBlock);
+    usage.strings += heapBytes(node.type) + heapBytes(node.id);
+    for (const auto &property : node.properties) {
+        usage.strings += heapBytes(property.value);
+    }
+    for (const auto &script : node.scripts) {
+        usage.strings += heapBytes(script.parameters);
+    }
+}
+
+}  // namespace
 
-            if (closesInline && !stack.empty()) {
-                stack.pop_back();
+QmlMemoryUsage QmlDocument::memoryUsage() const {
+    QmlMemoryUsage usage;
+    usage.document = sizeof(QmlDocument);
+    usage.childVectors = (roots.capacity() - roots.size()) * sizeof(QmlNode);
+    forEachPreorder(roots, [&usage](const QmlNode &node) { addNodeUsage(node, usage); });
+    if (!index_) {
+        return usage;
+    }
+    usage.indices =
+        sizeof(Index) + hashMapBytes(index_->ids) + hashMapBytes(index_->types) + hashMapBytes(index_->parents);
+    for (const auto &entry : index_->types) {
+        usage.indices += entry.second.capacity() * sizeof(const QmlNode *);
+    }
+    return usage;
+}
+
+QmlParser::QmlParser() = default;
+
+QmlParser::QmlParser(const QmlParseLimits &limits) : limits_(limits) {}
+
+QmlParser::QmlParser(const QmlParser &other) : limits_(other.limits_) {}
+
+QmlParser &QmlParser::operator=(const QmlParser &other) {
+    limits_ = other.limits_;
+    return *this;
+}
+
+QmlParser::~QmlParser() = default;
+
+QmlDocument QmlParser::parseFile(const std::string &path, std::pmr::memory_resource *resource) const {
+    const QmlTraceSpan span("QmlParser::parseFile");
+    // Parse straight out of the page cache; nothing is copied until values
+    // are stored in the resulting nodes.
+    MappedFile file;
+    if (!file.open(path)) {
+        throw std::runtime_error("Failed to open QML file: " + path);
+    }
+    return parseString(file.view(), resource);
+}
+
+QmlDocument QmlParser::parseString(std::string_view source, std::pmr::memory_resource *resource) const {
+    const QmlTraceSpan span("QmlParser::parseString");
+    QmlDocument document(resource);
+    const ScratchLease scratch(scratch_, scratchLeased_);
+    buildDocument(document, source, limits_, *scratch);
+    return document;
+}
+
+void QmlParser::parseInto(QmlDocument &document, std::string_view source) const {
+    const QmlTraceSpan span("QmlParser::parseInto");
+    const ScratchLease scratch(scratch_, scratchLeased_);
+    buildDocument(document, source, limits_, *scratch);
+}
+
+QmlParseResult QmlParser::parseStringChecked(std::string_view source, std::pmr::memory_resource *resource) const noexcept {
+    const QmlTraceSpan span("QmlParser::parseStringChecked");
+    QmlDocument document(resource);
+    std::vector<QmlDiagnostic> diagnostics;
+    std::string error;
+    try {
+        const ScratchLease scratch(scratch_, scratchLeased_);
+        buildDocument(document, source, limits_, *scratch, &diagnostics);
+    } catch (const QmlParseLimitError &limit) {
+        error = limit.what();
+    }
+    return QmlParseResult{std::string(), std::move(document), std::move(error), std::move(diagnostics)};
+}
+
+QmlParseResult QmlParser::parseFileChecked(const std::string &path, std::pmr::memory_resource *resource) const noexcept {
+    MappedFile file;
+    if (!file.open(path)) {
+        return QmlParseResult{path, QmlDocument(resource), "Failed to open QML file: " + path, {}};
+    }
+    QmlParseResult result = parseStringChecked(file.view(), resource);
+    result.path = path;
+    return result;
+}
+
+QmlTextEdit QmlTextEdit::between(std::string_view before, std::string_view after) {
+    const size_t limit = std::min(before.size(), after.size());
+    size_t prefix = 0;
+    while (prefix < limit && before[prefix] == after[prefix]) {
+        ++prefix;
+    }
+    size_t suffix = 0;
+    while (suffix < limit - prefix && before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) {
+        ++suffix;
+    }
+    return QmlTextEdit{prefix, before.size() - prefix - suffix,
+                       std::string(after.substr(prefix, after.size() - prefix - suffix))};
+}
+
+QmlDocument QmlParser::reparse(QmlDocument previous, std::string_view oldSource, const QmlTextEdit &edit) const {
+    if (edit.offset > oldSource.size() || edit.removedLength > oldSource.size() - edit.offset) {
+        throw std::out_of_range("QML text edit lies outside the source");
+    }
+    const size_t editEnd = edit.offset + edit.removedLength;
+
+    // Objects whose lines contain the whole edit, outermost first. Limits
+    // bound the whole document, which a fragment does not show.
+    std::vector<QmlNode *> enclosing;
+    for (QmlNodeList *level = limits_.bounded() ? nullptr : &previous.roots; level;) {
+        QmlNodeList *next = nullptr;
+        for (QmlNode &node : *level) {
+            if (node.sourceBegin <= edit.offset && editEnd <= node.sourceEnd) {
+                enclosing.push_back(&node);
+                next = &node.children;
+                break;
             }
-            continue;
         }
+        level = next;
+    }
 
-        if (trimmed == "}") {
-            if (!stack.empty()) {
-                stack.pop_back();
-            }
+    // Reparse the innermost candidate first and widen until the edited lines
+    // still form exactly one object that spans all of them; only then do
+    // they parse the same way here as they would in the full file.
+    for (auto it = enclosing.rbegin(); it != enclosing.rend(); ++it) {
+        QmlNode &target = **it;
+        std::string slice;
+        slice.reserve(target.sourceEnd - target.sourceBegin + edit.insertedText.size());
+        slice.append(oldSource.substr(target.sourceBegin, edit.offset - target.sourceBegin));
+        slice += edit.insertedText;
+        slice.append(oldSource.substr(editEnd, target.sourceEnd - editEnd));
+
+        QmlDocument fragment(previous.resource());
+        const ScratchLease scratch(scratch_, scratchLeased_);
+        TreeBuilder builder(fragment, *scratch);
+        LineParser<TreeBuilder> parser(builder);
+        parser.scanIn(scratch->window);
+        parser.parse(slice);
+        if (parser.unclosedAtEnd() != 0 || fragment.roots.size() != 1 || fragment.roots.front().sourceBegin != 0 ||
+            fragment.roots.front().sourceEnd != slice.size()) {
             continue;
         }
-
-        const auto colonPos = trimmed.find(':');
-        if (colonPos == std::string::npos || stack.empty()) {
+        // Statements sharing the object's first or last line go to the
+        // parent in the full parse; here they would be strays or dropped.
+        // The key of an object-valued property is the one stray allowed.
+        QmlNode &root = fragment.roots.front();
+        std::string_view key;
+        if (!splitOpening(slice, root.type, key) || parser.topLevelStrays() != (key.empty() ? 0 : 1)) {
             continue;
         }
 
-        const std::string key = trim(trimmed.substr(0, colonPos));
-        std::string rawValue = trim(trimmed.substr(colonPos + 1));
-        bool closesScope = false;
-        if (!rawValue.empty() && rawValue.back() == '}') {
-            closesScope = true;
-            rawValue = trim(rawValue.substr(0, rawValue.size() - 1));
-        }
+        // Everything from the end of the old object onwards moves by the
+        // edit's length change; that includes the ends of its ancestors.
+        const size_t base = target.sourceBegin;
+        const size_t oldEnd = target.sourceEnd;
+        const size_t newEnd = base + slice.size();
+        forEachPreorder(previous.roots, [oldEnd, newEnd](QmlNode &node) {
+            if (node.sourceBegin >= oldEnd) {
+                node.sourceBegin = node.sourceBegin - oldEnd + newEnd;
+            }
+            if (node.sourceEnd >= oldEnd) {
+                node.sourceEnd = node.sourceEnd - oldEnd + newEnd;
+            }
+            for (auto &script : node.scripts) {
+                if (script.bodyBegin >= oldEnd) {
+                    script.bodyBegin = script.bodyBegin - oldEnd + newEnd;
+                    script.bodyEnd = script.bodyEnd - oldEnd + newEnd;
+                }
+            }
+        });
+        forEachPreorder(fragment.roots, [base](QmlNode &node) {
+            node.sourceBegin += base;
+            node.sourceEnd += base;
+            for (auto &script : node.scripts) {
+                script.bodyBegin += base;
+                script.bodyEnd += base;
+            }
+        });
 
-        const std::string value = stripQuotes(rawValue);
-        stack.back()->properties[key] = value;
-        if (key == "id") {
-            stack.back()->id = value;
+        // A root binds nothing in the full parse either.
+        if (&target != enclosing.front() && !key.empty()) {
+            root.binding = scratch->atoms->intern(key);
         }
+        target = std::move(root);
+        previous.reindex();
+        return previous;
+    }
+
+    std::string newSource;
+    newSource.reserve(oldSource.size() - edit.removedLength + edit.insertedText.size());
+    newSource.append(oldSource.substr(0, edit.offset));
+    newSource += edit.insertedText;
+    newSource.append(oldSource.substr(editEnd));
+    return parseString(newSource, previous.resource());
+}
+
+QmlFlatDocument QmlParser::parseStringFlat(std::string_view source) const {
+    QmlFlatDocumentBuilder builder;
+    LineParser<QmlFlatDocumentBuilder> parser(builder, limits_);
+    const ScratchLease scratch(scratch_, scratchLeased_);
+    parser.scanIn(scratch->window);
+    parser.parse(source);
+    parser.throwIfExceeded();
+    return builder.finish();
+}
 
-        if (closesScope && !stack.empty()) {
-            stack.pop_back();
+QmlFlatDocument QmlParser::parseFileFlat(const std::string &path) const {
+    MappedFile file;
+    if (!file.open(path)) {
+        throw std::runtime_error("Failed to open QML file: " + path);
+    }
+    return parseStringFlat(file.view());
+}
+
+bool QmlParser::parseEvents(std::string_view source, QmlEventHandler &handler) const {
+    EventBuilder builder(handler);
+    LineParser<EventBuilder> parser(builder, limits_);
+    const ScratchLease scratch(scratch_, scratchLeased_);
+    parser.scanIn(scratch->window);
+    const bool finished = parser.parse(source);
+    parser.throwIfExceeded();
+    return finished;
+}
+
+bool QmlParser::parseFileEvents(const std::string &path, QmlEventHandler &handler) const {
+    MappedFile file;
+    if (!file.open(path)) {
+        throw std::runtime_error("Failed to open QML file: " + path);
+    }
+    return parseEvents(file.view(), handler);
+}
+
+std::vector<QmlParseResult> QmlParser::parseFiles(const std::vector<std::string> &paths, unsigned threadCount) const {
+    std::vector<QmlParseResult> results(paths.size());
+    if (paths.empty()) {
+        return results;
+    }
+
+    // Threads that finish their share take half of another's, so a few
+    // huge files don't leave the others idle. Each result slot is written
+    // by exactly one thread.
+    QmlExecutor::shared().parallelFor(
+        "QmlParser::parseFiles", paths.size(), [&](size_t i) { results[i] = parseFileChecked(paths[i]); },
+        threadCount, QmlExecutor::Priority::Normal);
+    return results;
+}
+
+QmlDocument QmlParser::parseStringParallel(std::string_view source, unsigned threadCount,
+                                           std::pmr::memory_resource *resource) const {
+    const QmlTraceSpan span("QmlParser::parseStringParallel");
+    // Smaller chunks cost more to hand out than they save.
+    constexpr size_t kMinChunkBytes = 32 * 1024;
+    QmlExecutor &executor = QmlExecutor::shared();
+    if (threadCount == 0) {
+        threadCount = static_cast<unsigned>(executor.workerCount() + 1);
+    }
+    SplitPlan plan;
+    // A few chunks per thread even out their differing costs.
+    if (threadCount < 2 || limits_.bounded() ||
+        !planSplit(source, std::max(kMinChunkBytes, source.size() / (threadCount * 4)), plan)) {
+        return parseString(source, resource);
+    }
+
+    struct Chunk {
+        size_t begin = 0;
+        size_t end = 0;
+        QmlDocument document;
+        bool whole = false;  // complete objects only, as parsed in place
+    };
+    std::vector<Chunk> chunks(plan.boundaries.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].begin = plan.boundaries[i];
+        chunks[i].end = i + 1 < chunks.size() ? plan.boundaries[i + 1] : plan.end;
+    }
+
+    // Task 0 is the input around the chunks, parsed as one with a gap; the
+    // others are the chunks.
+    QmlDocument document(resource);
+    bool stitched = false;
+    const auto work = [&](size_t task) {
+        if (task == 0) {
+            const ScratchLease scratch(scratch_, scratchLeased_);
+            TreeBuilder builder(document, *scratch);
+            LineParser<TreeBuilder> parser(builder);
+            parser.scanIn(scratch->window);
+            parser.parseLines(source.substr(0, plan.begin), 0, 0);
+            stitched = parser.idleAt(plan.depth);
+            if (stitched) {
+                parser.parseLines(source, 0, plan.end);
+                parser.finish();
+            }
+            builder.finish();
+            return;
         }
+        Chunk &chunk = chunks[task - 1];
+        const ScratchLease scratch;
+        TreeBuilder builder(chunk.document, *scratch);
+        LineParser<TreeBuilder> parser(builder);
+        parser.scanIn(scratch->window);
+        parser.parseLines(source.substr(0, chunk.end), 0, chunk.begin);
+        parser.finish();
+        builder.finish();
+        chunk.whole = parser.unclosedAtEnd() == 0 && parser.topLevelStrays() == 0;
+    };
+    executor.parallelFor("QmlParser::parseStringParallel", chunks.size() + 1, work, threadCount,
+                         QmlExecutor::Priority::Normal);
+    if (!stitched ||
+        !std::all_of(chunks.begin(), chunks.end(), [](const Chunk &chunk) { return chunk.whole; })) {
+        return parseString(source, resource);
     }
 
+    // At each level, the object still open at the gap is the last to start
+    // before it.
+    QmlNodeList *list = &document.roots;
+    for (size_t level = 0; level < plan.depth; ++level) {
+        QmlNode *parent = nullptr;
+        for (QmlNode &node : *list) {
+            if (node.sourceBegin < plan.begin) {
+                parent = &node;
+            }
+        }
+        list = &parent->children;
+    }
+    size_t before = 0;
+    while (before < list->size() && (*list)[before].sourceBegin < plan.begin) {
+        ++before;
+    }
+    QmlNodeList merged(list->resource());
+    size_t total = list->size();
+    for (const Chunk &chunk : chunks) {
+        total += chunk.document.roots.size();
+    }
+    merged.reserve(total);
+    for (size_t i = 0; i < before; ++i) {
+        merged.push_back(std::move((*list)[i]));
+    }
+    for (Chunk &chunk : chunks) {
+        for (QmlNode &node : chunk.document.roots) {
+            merged.push_back(std::move(node));
+        }
+    }
+    for (size_t i = before; i < list->size(); ++i) {
+        merged.push_back(std::move((*list)[i]));
+    }
+    *list = std::move(merged);
+    document.reindex();
     return document;
 }
+
+QmlDocument QmlParser::parseFileParallel(const std::string &path, unsigned threadCount,
+                                         std::pmr::memory_resource *resource) const {
+    MappedFile file;
+    if (!file.open(path)) {
+        throw std::runtime_error("Failed to open QML file: " + path);
+    }
+    return parseStringParallel(file.view(), threadCount, resource);
+}
+
+// One of the two builders and its line parser.
+struct QmlFeedParser::State {
+    QmlParseScratch scratch;
+    std::optional<TreeBuilder> tree;
+    std::optional<LineParser<TreeBuilder>> treeParser;
+    std::optional<EventBuilder> events;
+    std::optional<LineParser<EventBuilder>> eventParser;
+
+    template <typename Visit>
+    auto apply(Visit &&visit) {
+        return treeParser ? visit(*treeParser) : visit(*eventParser);
+    }
+};
+
+QmlFeedParser::QmlFeedParser(std::pmr::memory_resource *resource, const QmlParseLimits &limits)
+    : document_(resource), state_(std::make_unique<State>()) {
+    state_->treeParser.emplace(state_->tree.emplace(document_, state_->scratch), limits);
+    state_->treeParser->scanIn(state_->scratch.window);
+}
+
+QmlFeedParser::QmlFeedParser(QmlEventHandler &handler, const QmlParseLimits &limits)
+    : state_(std::make_unique<State>()) {
+    state_->eventParser.emplace(state_->events.emplace(handler), limits);
+    state_->eventParser->scanIn(state_->scratch.window);
+}
+
+QmlFeedParser::~QmlFeedParser() = default;
+
+bool QmlFeedParser::feed(std::string_view bytes) {
+    if (!running_) {
+        return false;
+    }
+    const size_t lastBreak = bytes.rfind('\n');
+    pending_.append(bytes);
+    if (lastBreak != std::string_view::npos) {
+        // The unfinished line stays in view: whether it starts with an
+        // operator decides where the line before it ends.
+        running_ = state_->apply([&](auto &parser) { return parser.parseLines(pending_, base_, parsed_, false); });
+        parsed_ = state_->apply([](auto &parser) { return parser.parsedTo(); });
+    }
+    // The unfinished line is held to the limits before it ends.
+    if (!state_->apply([&](auto &parser) { return parser.withinLimits(base_ + parsed_, base_ + pending_.size()); })) {
+        stopAtLimit();
+    }
+    if (lastBreak == std::string_view::npos) {
+        return running_;
+    }
+
+    // Drop the parsed lines, keeping the text of a script body still open.
+    const size_t retain = state_->apply([](auto &parser) { return parser.retainFrom(); });
+    const size_t drop = retain == std::string_view::npos ? parsed_ : std::min(parsed_, retain - base_);
+    pending_.erase(0, drop);
+    base_ += drop;
+    parsed_ -= drop;
+    return running_;
+}
+
+void QmlFeedParser::stopAtLimit() {
+    running_ = false;
+    state_->apply([](auto &parser) { return parser.finish(); });
+    if (state_->tree) {
+        state_->tree->finish();
+        document_.reindex();
+    }
+    pending_.clear();
+    state_->apply([](auto &parser) {
+        parser.throwIfExceeded();
+        return true;
+    });
+}
+
+bool QmlFeedParser::finish() {
+    if (!running_) {
+        return false;
+    }
+    running_ = false;
+    const bool finished = state_->apply([&](auto &parser) {
+        const bool read = parser.parseLines(pending_, base_, parsed_);
+        return parser.finish() && read;
+    });
+    if (state_->tree) {
+        state_->tree->finish();
+        document_.reindex();
+    }
+    pending_.clear();
+    state_->apply([](auto &parser) {
+        parser.throwIfExceeded();
+        return true;
+    });
+    return finished;
+}
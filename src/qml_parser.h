@@ -1,32 +1,499 @@
 #pragma once
 
-#include <map>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "qml_atoms.h"
+#include "qml_cow_vector.h"
+#include "qml_flat_document.h"
+#include "qml_function_ref.h"
+#include "qml_value.h"
+
+struct QmlProperty {
+    QmlAtom key = QmlAtoms::Invalid;
+    std::string value;  // unquoted text
+    QmlValue typed;
+};
+
+enum class QmlScriptKind : uint8_t {
+    Handler,   // onSomething: ...
+    Function,  // function name(args) { ... }
+};
+
+// A signal handler or function declaration. The parser only brace-matches
+// the body and records where it is, so JavaScript is never tokenized or
+// copied unless a consumer asks for it with body().
+struct QmlScriptBlock {
+    QmlScriptKind kind = QmlScriptKind::Handler;
+    QmlAtom name = QmlAtoms::Invalid;  // the handler, or the function's name
+    std::string parameters;            // functions only, without parentheses
+    size_t bodyBegin = 0;              // byte range in the parsed source;
+    size_t bodyEnd = 0;                // braces are included when present
+
+    std::string_view body(std::string_view source) const { return source.substr(bodyBegin, bodyEnd - bodyBegin); }
+};
+
 // Minimal QML AST representation that is easy to traverse without pulling
-// in a full QML runtime.
+// in a full QML runtime. Children are implicitly shared: copying a node
+// copies no descendants, and editing a copy unshares only the lists on
+// the path to the edit (see QmlCowVector).
+//
+// A node made with a memory resource keeps its property, script and child
+// lists there; strings longer than the small-string buffer still come from
+// the heap. Copies use the default resource, as std::pmr containers do.
+struct QmlNode;
+using QmlNodeList = QmlCowVector<QmlNode>;
+class QmlNodeRange;
+
+// What a walk does after entering a node.
+enum class QmlVisit : uint8_t {
+    Continue,      // into the node's children, then on
+    SkipChildren,  // straight on to the node's next sibling
+    Stop,          // ends the walk
+};
+using QmlNodeVisitor = QmlFunctionRef<QmlVisit(const QmlNode &node)>;
+using QmlNodeLeaveVisitor = QmlFunctionRef<void(const QmlNode &node)>;
+
 struct QmlNode {
+    QmlNode() = default;
+    explicit QmlNode(std::pmr::memory_resource *resource) : properties(resource), children(resource), scripts(resource) {}
+
     std::string type;
+    QmlAtom typeAtom = QmlAtoms::Invalid;  // kept in sync with type by setType()
     std::string id;
-    std::map<std::string, std::string> properties;
-    std::vector<QmlNode> children;
+    // The property the object is the value of ("background" in
+    // "background: Rectangle {"), or Invalid for a plain child.
+    QmlAtom binding = QmlAtoms::Invalid;
+    std::pmr::vector<QmlProperty> properties;  // in first-assignment order, keys unique
+    QmlNodeList children;
+    std::pmr::vector<QmlScriptBlock> scripts;  // in source order
+    // Byte range of the lines the object spans in the source it was parsed
+    // from, from the start of its opening line to the end of its closing one.
+    size_t sourceBegin = 0;
+    size_t sourceEnd = 0;
+
+    void setType(std::string_view newType);
+    void setProperty(QmlAtom key, std::string value, QmlValue typed = {});
 
+    const QmlProperty *findProperty(QmlAtom key) const;
+    std::string property(QmlAtom key, const std::string &defaultValue = "") const;
     std::string property(const std::string &key, const std::string &defaultValue = "") const;
+    // Typed reads return defaultValue when the property is missing or of
+    // another kind. Ints are accepted where a real is asked for.
+    int intProperty(QmlAtom key, int defaultValue = 0) const;
+    double realProperty(QmlAtom key, double defaultValue = 0.0) const;
+    bool boolProperty(QmlAtom key, bool defaultValue = false) const;
+    const QmlScriptBlock *findScript(QmlAtom name) const;
+    // Searches descendants in pre-order and returns the first match.
+    const QmlNode *findChildByType(QmlAtom wantedType) const;
     const QmlNode *findChildByType(const std::string &wantedType) const;
     const QmlNode *findChildById(const std::string &wantedId) const;
+    // Every descendant of the given type, in pre-order.
+    std::vector<const QmlNode *> findChildrenByType(QmlAtom wantedType) const;
+
+    // Traversals of the descendants, not including this node. They keep
+    // their own stack, so nesting depth is bounded by memory rather than
+    // by the call stack.
+    //
+    // walkDescendants() calls enter on each node in pre-order and leave,
+    // if given, in post-order once the node's subtree is done (right after
+    // enter for a node whose children are skipped). Returns false if enter
+    // stopped the walk; the nodes it was inside of are not left then.
+    bool walkDescendants(QmlNodeVisitor enter, QmlNodeLeaveVisitor leave = {}) const;
+    // Pre-order iteration, for range-for loops that break on a match.
+    QmlNodeRange descendants() const;
 };
 
+// Forward iterator over a forest of nodes in pre-order. It keeps one frame
+// per level it is inside of; a default-constructed iterator is the end.
+class QmlNodeIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = QmlNode;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const QmlNode *;
+    using reference = const QmlNode &;
+
+    QmlNodeIterator() = default;
+    explicit QmlNodeIterator(const QmlNodeList &roots);
+
+    reference operator*() const { return *frames_.back().next; }
+    pointer operator->() const { return frames_.back().next; }
+    QmlNodeIterator &operator++();
+    QmlNodeIterator operator++(int) {
+        QmlNodeIterator previous = *this;
+        ++*this;
+        return previous;
+    }
+    // Like ++, but passes over the current node's children.
+    QmlNodeIterator &skipChildren();
+    // Levels below the forest the iteration started from; its roots are 0.
+    size_t depth() const { return frames_.size() - 1; }
+
+    bool operator==(const QmlNodeIterator &other) const {
+        return frames_.empty() ? other.frames_.empty()
+                               : !other.frames_.empty() && frames_.back().next == other.frames_.back().next;
+    }
+    bool operator!=(const QmlNodeIterator &other) const { return !(*this == other); }
+
+private:
+    struct Frame {
+        const QmlNode *next;
+        const QmlNode *end;
+    };
+    void push(const QmlNodeList &list);
+    // Leaves every exhausted level.
+    void popFinished();
+
+    std::vector<Frame> frames_;
+};
+
+class QmlNodeRange {
+public:
+    explicit QmlNodeRange(const QmlNodeList &roots) : roots_(&roots) {}
+
+    QmlNodeIterator begin() const { return QmlNodeIterator(*roots_); }
+    QmlNodeIterator end() const { return QmlNodeIterator(); }
+
+private:
+    const QmlNodeList *roots_;
+};
+
+// Bytes a QmlDocument holds, by what holds them. Computed from sizes and
+// capacities, so it is exact for the objects themselves but leaves out
+// allocator headers and rounding.
+struct QmlMemoryUsage {
+    size_t nodeCount = 0;
+    size_t nodes = 0;         // QmlNode objects, inline in roots and children
+    size_t childVectors = 0;  // unused capacity in roots and children
+    size_t properties = 0;    // QmlProperty elements, allocated capacity
+    size_t scripts = 0;       // QmlScriptBlock elements, allocated capacity
+    size_t strings = 0;       // heap buffers of types, ids, values and parameters
+    size_t indices = 0;       // id and type lookup tables
+    size_t document = 0;      // the QmlDocument object itself
+
+    size_t total() const { return nodes + childVectors + properties + scripts + strings + indices + document; }
+};
+
+// Copies are O(1) snapshots: the tree and its indices are shared until a
+// copy is written to, and then only the node lists on the path to the
+// edit are duplicated. A snapshot handed to another thread stays valid and
+// unchanged while the original keeps being edited. Read shared documents
+// through a const reference; non-const access unshares, like an edit.
+//
+// A document built on a memory resource allocates its nodes' lists and its
+// index there, so a monotonic_buffer_resource on the stack or a per-file
+// arena releases a whole document at once. The resource must outlive the
+// document and every snapshot of it; a snapshot's own edits use the
+// default resource.
 class QmlDocument {
 public:
-    std::vector<QmlNode> roots;
+    QmlDocument() = default;
+    explicit QmlDocument(std::pmr::memory_resource *resource) : roots(resource), resource_(resource) {}
+    QmlDocument(const QmlDocument &other) : roots(other.roots), index_(other.index_) {}
+    QmlDocument &operator=(const QmlDocument &other) {
+        roots = other.roots;
+        index_ = other.index_;
+        return *this;
+    }
+    QmlDocument(QmlDocument &&) noexcept = default;
+    QmlDocument &operator=(QmlDocument &&) noexcept = default;
 
+    QmlNodeList roots;
+
+    // Where new nodes and the index are allocated; never null.
+    std::pmr::memory_resource *resource() const {
+        return resource_ ? resource_ : std::pmr::get_default_resource();
+    }
+
+    // Lookups are answered from hash indices when the document is indexed
+    // (parsed documents always are). Code that edits roots directly must call
+    // reindex() afterwards, or lookups may return the nodes of an older
+    // snapshot; documents that were never indexed walk the tree.
+    const QmlNode *firstRootOfType(QmlAtom wantedType) const;
     const QmlNode *firstRootOfType(const std::string &wantedType) const;
     const QmlNode *findById(const std::string &wantedId) const;
+    // Every node of the given type, in document (pre-)order.
+    std::vector<const QmlNode *> nodesOfType(QmlAtom wantedType) const;
+
+    // Every node, roots included, in document order; see
+    // QmlNode::walkDescendants() and QmlNode::descendants().
+    bool walk(QmlNodeVisitor enter, QmlNodeLeaveVisitor leave = {}) const;
+    QmlNodeRange nodes() const { return QmlNodeRange(roots); }
+
+    // Moves up and sideways from a node of this document, as returned by
+    // its lookups and walks. Parents come from the index, and siblings are
+    // neighbours in the parent's child list, so each step is O(1) on an
+    // indexed document. Null for a root's parent, past either end of a
+    // sibling list, and for nodes of other documents.
+    const QmlNode *parentOf(const QmlNode &node) const;
+    const QmlNode *nextSiblingOf(const QmlNode &node) const;
+    const QmlNode *previousSiblingOf(const QmlNode &node) const;
+    // Nearest ancestor of the given type, such as the Column a Text is in.
+    const QmlNode *enclosingOfType(const QmlNode &node, QmlAtom wantedType) const;
+
+    void reindex();
+    // The same, walking the tree in pending, which a caller that reindexes
+    // often, as the parser does, keeps to reuse it.
+    void reindex(std::vector<const QmlNode *> &pending);
+    bool isIndexed() const { return index_ != nullptr; }
+    // Releases this document's hold on its indices; lookups walk the tree
+    // until the next reindex().
+    void dropIndex() { index_.reset(); }
+    // A process-wide unique number for each reindex(), shared by the
+    // snapshots that share the index; 0 when the document is not indexed.
+    // Anything computed from an indexed document can be cached against it.
+    uint64_t revision() const { return index_ ? index_->revision : 0; }
+
+    QmlMemoryUsage memoryUsage() const;
+
+private:
+    // Keys view the ids stored in the nodes themselves, which keep their
+    // addresses for as long as the tree is not modified. Shared between
+    // snapshots along with the nodes it points into, and only written by
+    // reindex() while it is not. Entries come from a pool, so refilling it
+    // reuses the memory of the entries it held before.
+    struct Index {
+        explicit Index(std::pmr::memory_resource *resource)
+            : pool(resource), ids(&pool), types(&pool), parents(&pool) {}
+
+        std::pmr::unsynchronized_pool_resource pool;
+        uint64_t revision = 0;
+        std::pmr::unordered_map<std::string_view, const QmlNode *> ids;
+        std::pmr::unordered_map<QmlAtom, std::pmr::vector<const QmlNode *>> types;
+        // Built by the first parentOf() call rather than by reindex(), so
+        // parsing does not pay for it, from the roots that were indexed.
+        const QmlNode *firstRoot = nullptr;
+        size_t rootCount = 0;
+        mutable std::mutex parentsMutex;
+        mutable std::atomic<bool> parentsBuilt{false};
+        mutable std::pmr::unordered_map<const QmlNode *, const QmlNode *> parents;  // roots have none
+    };
+    template <typename Pending>
+    void reindexIn(Pending &pending);
+    // The list node sits in: its parent's children, or the roots.
+    const QmlNodeList *siblingsOf(const QmlNode &node) const;
+    std::shared_ptr<Index> index_;
+    std::pmr::memory_resource *resource_ = nullptr;  // null for the default
+};
+
+// Receives parse events in document order. Views passed to the callbacks
+// point into the source buffer and are only valid during the call. Return
+// false from any callback to stop parsing; no further events are delivered.
+class QmlEventHandler {
+public:
+    virtual ~QmlEventHandler() = default;
+
+    virtual bool beginObject(std::string_view type) = 0;
+    virtual bool property(std::string_view key, std::string_view value) = 0;
+    virtual bool endObject() = 0;
+    // Comes right before the beginObject() of an object that is the value
+    // of property key. Ignored unless overridden.
+    virtual bool bindObject(std::string_view key);
+    // Handlers and functions of the innermost open object; see
+    // QmlScriptBlock. The body offsets index the parsed source. Ignored
+    // unless overridden.
+    virtual bool script(QmlScriptKind kind, std::string_view name, std::string_view parameters, size_t bodyBegin,
+                        size_t bodyEnd);
+};
+
+// Replaces removedLength bytes at offset with insertedText.
+struct QmlTextEdit {
+    size_t offset = 0;
+    size_t removedLength = 0;
+    std::string insertedText;
+
+    // The single edit that turns before into after: everything between
+    // their common prefix and common suffix.
+    static QmlTextEdit between(std::string_view before, std::string_view after);
+};
+
+// Something the grammar could not place, with how the parse recovered.
+// Line and column are 1-based; columns count bytes.
+struct QmlDiagnostic {
+    size_t offset = 0;
+    size_t line = 0;
+    size_t column = 0;
+    std::string message;
+};
+
+struct QmlParseResult {
+    std::string path;
+    QmlDocument document;
+    std::string error;                        // empty on success
+    std::vector<QmlDiagnostic> diagnostics;  // in source order
+
+    bool ok() const { return error.empty(); }
+    bool clean() const { return error.empty() && diagnostics.empty(); }
+};
+
+// Bounds on one parse, for input from untrusted sources such as uploads.
+// Each is checked once per line or object, and the defaults bound nothing.
+// A parse that exceeds one stops where it did, closing the objects still
+// open: parseStringChecked() and parseFileChecked() return the document
+// so far with error set and a diagnostic at that point; the other entry
+// points throw QmlParseLimitError.
+struct QmlParseLimits {
+    size_t maxBytes = std::numeric_limits<size_t>::max();
+    size_t maxLineLength = std::numeric_limits<size_t>::max();  // a logical line, continuations included
+    size_t maxDepth = std::numeric_limits<size_t>::max();       // objects open at once
+    size_t maxObjects = std::numeric_limits<size_t>::max();
+
+    bool bounded() const {
+        return maxBytes != std::numeric_limits<size_t>::max() || maxLineLength != std::numeric_limits<size_t>::max() ||
+               maxDepth != std::numeric_limits<size_t>::max() || maxObjects != std::numeric_limits<size_t>::max();
+    }
+};
+
+class QmlParseLimitError : public std::runtime_error {
+public:
+    QmlParseLimitError(const std::string &message, size_t offset) : std::runtime_error(message), offset_(offset) {}
+
+    // Input offset where the parse stopped.
+    size_t offset() const { return offset_; }
+
+private:
+    size_t offset_;
 };
 
+struct QmlParseScratch;
+
 class QmlParser {
 public:
-    QmlDocument parseString(const std::string &source) const;
-    QmlDocument parseFile(const std::string &path) const;
+    // Bump whenever a change to the grammar alters the trees it produces;
+    // cached ASTs from other versions are discarded.
+    static constexpr uint32_t kGrammarVersion = 8;
+
+    QmlParser();
+    explicit QmlParser(const QmlParseLimits &limits);
+    // Copies take the limits, not the scratch.
+    QmlParser(const QmlParser &other);
+    QmlParser &operator=(const QmlParser &other);
+    ~QmlParser();
+
+    const QmlParseLimits &limits() const { return limits_; }
+
+    // The source is only borrowed for the duration of the call; strings are
+    // copied out of it when they are stored in a QmlNode. With a resource,
+    // the document is built on it (see QmlDocument); null means the default.
+    QmlDocument parseString(std::string_view source, std::pmr::memory_resource *resource = nullptr) const;
+    QmlDocument parseFile(const std::string &path, std::pmr::memory_resource *resource = nullptr) const;
+    // Replaces document's tree with the one parsed from source, reusing the
+    // nodes, lists, strings and index it already holds. Reloading a file
+    // whose shape did not change then allocates nothing; the result is the
+    // same as parseString(source). Snapshots of document keep their tree.
+    void parseInto(QmlDocument &document, std::string_view source) const;
+
+    // As parseString/parseFile, never throwing: the document comes with a
+    // diagnostic for every line the grammar skipped, every stray or missing
+    // brace and every unterminated script. A bad segment is dropped up to
+    // the next ';' or line end, and a '{' without a type up to its matching
+    // '}', so the rest of the file still parses. A file that cannot be read
+    // sets error instead.
+    QmlParseResult parseStringChecked(std::string_view source,
+                                      std::pmr::memory_resource *resource = nullptr) const noexcept;
+    QmlParseResult parseFileChecked(const std::string &path,
+                                    std::pmr::memory_resource *resource = nullptr) const noexcept;
+
+    // Applies edit to a document parsed from oldSource and returns the tree
+    // for the edited text, identical to parsing it from scratch. Only the
+    // innermost object whose lines contain the edit is reparsed and spliced
+    // in, widening to its ancestors when the edit changes the structure
+    // around it; edits outside every object parse the whole text, as do
+    // all edits under bounded limits(), which apply to the whole document.
+    // Throws std::out_of_range if the edit does not fit oldSource.
+    QmlDocument reparse(QmlDocument previous, std::string_view oldSource, const QmlTextEdit &edit) const;
+
+    // Same grammar, packed into a single contiguous allocation. Script
+    // blocks are skipped but not recorded.
+    QmlFlatDocument parseStringFlat(std::string_view source) const;
+    QmlFlatDocument parseFileFlat(const std::string &path) const;
+
+    // Streams events without building a tree, so memory stays bounded by the
+    // nesting depth. Objects still open at the end of input are closed.
+    // Returns false if the handler stopped the parse early.
+    bool parseEvents(std::string_view source, QmlEventHandler &handler) const;
+    bool parseFileEvents(const std::string &path, QmlEventHandler &handler) const;
+
+    // Parses every path on up to threadCount threads of
+    // QmlExecutor::shared() (0 = all of them), the calling thread included.
+    // Results are returned in input order, as from parseFileChecked(); a
+    // file that fails to load reports its error without affecting others.
+    std::vector<QmlParseResult> parseFiles(const std::vector<std::string> &paths, unsigned threadCount = 0) const;
+
+    // Parses one large input on up to threadCount threads of the shared
+    // executor (0 = all of them). A scan over the structurals finds the
+    // object whose children make up most of the input and cuts them into
+    // chunks, which are parsed in parallel into documents of their own and
+    // then moved into place. The result is the same as from parseString().
+    // If a chunk turns out not to hold whole objects, as when a brace in a
+    // comment throws the scan's count off, the input is parsed on one
+    // thread instead; so is all input under bounded limits(). Nodes built
+    // by the workers come from the default resource.
+    QmlDocument parseStringParallel(std::string_view source, unsigned threadCount = 0,
+                                    std::pmr::memory_resource *resource = nullptr) const;
+    QmlDocument parseFileParallel(const std::string &path, unsigned threadCount = 0,
+                                  std::pmr::memory_resource *resource = nullptr) const;
+
+private:
+    QmlParseLimits limits_;
+    // The buffers a parse works in besides its document, kept for the next
+    // call: reparsing the same input, as on every save in watch mode, then
+    // allocates nothing outside the document. A call made while another
+    // has them, from a parseFiles() worker for one, uses its thread's.
+    mutable std::unique_ptr<QmlParseScratch> scratch_;
+    mutable std::atomic<bool> scratchLeased_{false};
+};
+
+// Push parser for input that arrives in pieces, such as a network stream.
+// Each complete line is parsed once feed() delivers the start of the next,
+// which may continue it, so parsing overlaps the I/O; between calls only
+// the unfinished last lines, and an open script body, are kept. Chunks may split the input anywhere, inside
+// a string included, and the result is the same as parsing it in one go.
+class QmlFeedParser {
+public:
+    // Builds a document, available from document() as it grows; its index
+    // is only built by finish().
+    explicit QmlFeedParser(std::pmr::memory_resource *resource = nullptr, const QmlParseLimits &limits = {});
+    // Streams events to handler instead, as QmlParser::parseEvents() does.
+    // The handler is not owned.
+    explicit QmlFeedParser(QmlEventHandler &handler, const QmlParseLimits &limits = {});
+    ~QmlFeedParser();
+
+    QmlFeedParser(const QmlFeedParser &) = delete;
+    QmlFeedParser &operator=(const QmlFeedParser &) = delete;
+
+    // Returns false once the handler has stopped the parse; further input
+    // is ignored. Throws QmlParseLimitError once the input exceeds limits,
+    // which an unfinished line is held to as well; the document keeps
+    // what was parsed, closed and indexed.
+    bool feed(std::string_view bytes);
+    // Parses the last line and closes whatever is still open.
+    bool finish();
+
+    QmlDocument &document() { return document_; }
+
+private:
+    struct State;
+
+    // Closes what is open and throws the limit the input exceeded.
+    void stopAtLimit();
+
+    QmlDocument document_;
+    std::unique_ptr<State> state_;
+    std::string pending_;  // input from base_ on
+    size_t base_ = 0;
+    size_t parsed_ = 0;    // offset in pending_ of the first unparsed line
+    bool running_ = true;
 };
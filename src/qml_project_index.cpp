@@ -0,0 +1,414 @@
+#include "qml_project_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <utility>
+
+#include "mapped_file.h"
+
+namespace {
+
+// Component types are capitalized, like every QML object type; the last
+// segment is the name and anything before it a qualifier.
+bool isComponentType(std::string_view type) {
+    const size_t dot = type.rfind('.');
+    const size_t name = dot == std::string_view::npos ? 0 : dot + 1;
+    return name < type.size() && std::isupper(static_cast<unsigned char>(type[name])) != 0;
+}
+
+std::string normalized(const std::string &path) {
+    return std::filesystem::path(path).lexically_normal().string();
+}
+
+std::string directoryOf(const std::string &path) {
+    const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    return parent.empty() ? std::string(".") : parent.string();
+}
+
+bool readFile(const std::string &path, std::string &source) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    source.assign(file.view());
+    return true;
+}
+
+std::string_view trimmed(std::string_view text) {
+    const size_t first = text.find_first_not_of(" \t\r;");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(first, text.find_last_not_of(" \t\r;") - first + 1);
+}
+
+// Splits off the next space-separated word of text.
+std::string_view nextWord(std::string_view &text) {
+    text = trimmed(text);
+    const size_t end = std::min(text.find_first_of(" \t"), text.size());
+    const std::string_view word = text.substr(0, end);
+    text.remove_prefix(end);
+    return word;
+}
+
+}  // namespace
+
+// Replaces component uses in one file's tree, copying only the nodes on
+// the paths down to them; lists without a use stay shared with the input.
+class QmlProjectIndex::Expander {
+public:
+    Expander(QmlProjectIndex &index, std::string directory, std::vector<QmlImport> imports,
+             std::vector<std::string> &loading, std::unordered_set<std::string> &uses)
+        : index_(index),
+          directory_(std::move(directory)),
+          imports_(std::move(imports)),
+          loading_(loading),
+          uses_(uses) {}
+
+    void run(QmlNodeList &roots) { expandList(roots); }
+
+    // Like expanding use, but fails unless use itself is a component use.
+    bool instantiate(const QmlNode &use, QmlNode &out) {
+        QmlNode root;
+        if (!isComponentType(use.type) || !instance(use.type, root)) {
+            return false;
+        }
+        QmlNodeList children = use.children;
+        expandList(children);
+        out = merged(std::move(root), use, children);
+        return true;
+    }
+
+private:
+    // Returns whether any element changed; unchanged ones stay shared.
+    bool expandList(QmlNodeList &list) {
+        bool changed = false;
+        for (size_t i = 0; i < list.size(); ++i) {
+            QmlNode expanded;
+            if (expand(std::as_const(list)[i], expanded)) {
+                list[i] = std::move(expanded);
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // Returns false, leaving out alone, if nothing in node's subtree
+    // changes.
+    bool expand(const QmlNode &node, QmlNode &out) {
+        QmlNodeList children = node.children;
+        const bool changed = expandList(children);
+        QmlNode root;
+        if (isComponentType(node.type) && instance(node.type, root)) {
+            out = merged(std::move(root), node, children);
+            return true;
+        }
+        if (changed) {
+            out = node;
+            out.children = std::move(children);
+        }
+        return changed;
+    }
+
+    // The component's root with the use's own parts taking precedence.
+    static QmlNode merged(QmlNode root, const QmlNode &use, const QmlNodeList &children) {
+        root.id = use.id;
+        for (const QmlProperty &property : use.properties) {
+            root.setProperty(property.key, property.value, property.typed);
+        }
+        root.scripts.assign(use.scripts.begin(), use.scripts.end());
+        for (const QmlNode &child : children) {
+            root.children.push_back(child);
+        }
+        root.sourceBegin = use.sourceBegin;
+        root.sourceEnd = use.sourceEnd;
+        return root;
+    }
+
+    bool instance(const std::string &type, QmlNode &root) {
+        const std::string path = index_.resolve(type, directory_, imports_);
+        if (path.empty() || std::find(loading_.begin(), loading_.end(), path) != loading_.end()) {
+            return false;
+        }
+        return index_.component(path, loading_, uses_, root);
+    }
+
+    QmlProjectIndex &index_;
+    std::string directory_;
+    std::vector<QmlImport> imports_;
+    std::vector<std::string> &loading_;
+    std::unordered_set<std::string> &uses_;
+};
+
+QmlDocument QmlProjectIndex::expand(QmlDocument document, std::string_view source, const std::string &path) {
+    const std::string file = normalized(path);
+    std::vector<std::string> loading{file};
+    std::unordered_set<std::string> uses;
+    std::vector<QmlImport> fileImports = imports(source);
+    Expander(*this, directoryOf(file), fileImports, loading, uses).run(document.roots);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        expandedUses_[file] = std::move(uses);
+        imports_[file] = std::move(fileImports);
+    }
+    document.reindex();
+    return document;
+}
+
+bool QmlProjectIndex::instantiate(const QmlNode &use, const std::string &path, QmlNode &instance) {
+    const std::string file = normalized(path);
+    std::vector<std::string> loading{file};
+    std::unordered_set<std::string> uses;
+    if (!Expander(*this, directoryOf(file), importsOf(file), loading, uses).instantiate(use, instance)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    expandedUses_[file].insert(uses.begin(), uses.end());
+    return true;
+}
+
+std::string QmlProjectIndex::componentFile(std::string_view type, const std::string &path) {
+    if (!isComponentType(type)) {
+        return std::string();
+    }
+    const std::string file = normalized(path);
+    return resolve(type, directoryOf(file), importsOf(file));
+}
+
+std::vector<QmlImport> QmlProjectIndex::importsOf(const std::string &file) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = imports_.find(file);
+        if (it != imports_.end()) {
+            return it->second;
+        }
+    }
+    std::vector<QmlImport> fileImports;
+    std::string source;
+    if (readFile(file, source)) {
+        fileImports = imports(source);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    imports_.emplace(file, fileImports);
+    return fileImports;
+}
+
+bool QmlProjectIndex::component(const std::string &path, std::vector<std::string> &loading,
+                                std::unordered_set<std::string> &uses, QmlNode &root) {
+    size_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = components_.find(path);
+        if (it != components_.end()) {
+            it->second.lastUse = ++useClock_;
+            if (!it->second.valid) {
+                return false;
+            }
+            root = it->second.root;
+            uses.insert(it->second.uses.begin(), it->second.uses.end());
+            uses.insert(path);
+            return true;
+        }
+        generation = generation_;
+    }
+
+    std::string source;
+    if (!readFile(path, source)) {
+        return false;
+    }
+    QmlDocument document = QmlParser().parseString(source);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++parseCount_;
+    }
+
+    Component component;
+    component.valid = document.roots.size() == 1;
+    if (component.valid) {
+        loading.push_back(path);
+        Expander(*this, directoryOf(path), imports(source), loading, component.uses).run(document.roots);
+        loading.pop_back();
+        const QmlMemoryUsage usage = document.memoryUsage();
+        component.bytes = usage.total() - usage.indices - usage.document;
+        component.root = std::move(document.roots[0]);
+        root = component.root;
+        uses.insert(component.uses.begin(), component.uses.end());
+        uses.insert(path);
+    }
+    const bool valid = component.valid;
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A change reported while the file was being read may not be in it.
+    if (generation == generation_) {
+        component.lastUse = ++useClock_;
+        const size_t bytes = component.bytes;
+        if (components_.emplace(path, std::move(component)).second) {
+            componentBytes_ += bytes;
+        }
+    }
+    return valid;
+}
+
+std::string QmlProjectIndex::resolve(std::string_view type, const std::string &directory,
+                                     const std::vector<QmlImport> &imports) {
+    const size_t dot = type.rfind('.');
+    const std::string_view qualifier = dot == std::string_view::npos ? std::string_view() : type.substr(0, dot);
+    const std::string fileName = std::string(type.substr(qualifier.empty() ? 0 : dot + 1)) + ".qml";
+
+    const auto lookIn = [&](const std::string &searchDirectory) {
+        const std::string key = searchDirectory + '/' + fileName;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = resolved_.find(key);
+            if (it != resolved_.end()) {
+                return it->second;
+            }
+        }
+        std::string file = (std::filesystem::path(searchDirectory) / fileName).lexically_normal().string();
+        if (!MappedFile::exists(file)) {
+            file.clear();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        resolved_.emplace(key, file);
+        return file;
+    };
+
+    if (qualifier.empty()) {
+        const std::string own = lookIn(directory);
+        if (!own.empty()) {
+            return own;
+        }
+    }
+    for (const QmlImport &import : imports) {
+        if (!import.local || import.qualifier != qualifier) {
+            continue;
+        }
+        const std::string file = lookIn((std::filesystem::path(directory) / import.uri).lexically_normal().string());
+        if (!file.empty()) {
+            return file;
+        }
+    }
+    return std::string();
+}
+
+size_t QmlProjectIndex::invalidate(const std::string &path) {
+    const std::string changed = normalized(path);
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    resolved_.clear();
+    imports_.erase(changed);
+
+    std::unordered_set<std::string> dropped;
+    for (const auto &entry : components_) {
+        if (entry.first == changed || directoryOf(entry.first) == changed) {
+            dropped.insert(entry.first);
+        }
+    }
+    // uses is transitive, so one pass finds every component built on them.
+    std::vector<std::string> users;
+    for (const auto &entry : components_) {
+        for (const std::string &file : dropped) {
+            if (entry.second.uses.count(file) != 0) {
+                users.push_back(entry.first);
+                break;
+            }
+        }
+    }
+    dropped.insert(users.begin(), users.end());
+    for (const std::string &file : dropped) {
+        const auto it = components_.find(file);
+        componentBytes_ -= it->second.bytes;
+        components_.erase(it);
+    }
+    return dropped.size();
+}
+
+std::vector<std::string> QmlProjectIndex::dependenciesOf(const std::string &path) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = expandedUses_.find(normalized(path));
+    if (it == expandedUses_.end()) {
+        return {};
+    }
+    std::vector<std::string> files(it->second.begin(), it->second.end());
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+size_t QmlProjectIndex::parseCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return parseCount_;
+}
+
+size_t QmlProjectIndex::componentCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return components_.size();
+}
+
+size_t QmlProjectIndex::byteSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return componentBytes_;
+}
+
+size_t QmlProjectIndex::evict(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<uint64_t, const std::string *>> byUse;
+    byUse.reserve(components_.size());
+    for (const auto &entry : components_) {
+        byUse.emplace_back(entry.second.lastUse, &entry.first);
+    }
+    std::sort(byUse.begin(), byUse.end());
+    size_t freed = 0;
+    for (const auto &use : byUse) {
+        if (freed >= bytes) {
+            break;
+        }
+        const auto it = components_.find(*use.second);
+        freed += it->second.bytes;
+        components_.erase(it);
+    }
+    componentBytes_ -= freed;
+    return freed;
+}
+
+std::vector<QmlImport> QmlProjectIndex::imports(std::string_view source) {
+    std::vector<QmlImport> result;
+    size_t lineStart = 0;
+    while (lineStart < source.size()) {
+        size_t lineEnd = source.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = source.size();
+        }
+        std::string_view line = source.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        if (nextWord(line) != "import") {
+            continue;
+        }
+        QmlImport import;
+        line = trimmed(line);
+        if (!line.empty() && line.front() == '"') {
+            const size_t close = line.find('"', 1);
+            if (close == std::string_view::npos) {
+                continue;
+            }
+            import.uri.assign(line.substr(1, close - 1));
+            import.local = true;
+            line.remove_prefix(close + 1);
+        } else {
+            import.uri.assign(nextWord(line));
+            std::string_view rest = line;
+            const std::string_view word = nextWord(rest);
+            if (!word.empty() && word != "as") {
+                import.version.assign(word);
+                line = rest;
+            }
+        }
+        if (nextWord(line) == "as") {
+            import.qualifier.assign(nextWord(line));
+        }
+        if (!import.uri.empty()) {
+            result.push_back(std::move(import));
+        }
+    }
+    return result;
+}
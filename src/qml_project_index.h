@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "qml_parser.h"
+
+// One import line. Local imports name a directory relative to the file,
+// e.g. import "widgets" as W; anything else is a module such as QtQuick.
+struct QmlImport {
+    std::string uri;        // module name, or the directory as written
+    std::string version;    // modules only; may be empty
+    std::string qualifier;  // the name after "as"; empty if none
+    bool local = false;
+};
+
+// Resolves the component types a project's files use, such as MyCard
+// standing for MyCard.qml, and keeps every component file it has parsed.
+// A type used in a file resolves, as in QML, to Type.qml in the file's own
+// directory and then in its unqualified local imports in order; Q.Type
+// looks only in the import qualified as Q. Module imports and qmldir files
+// are not resolved, so their types are left as they are.
+//
+// expand() replaces each use of a component with an instance of it: the
+// component's root, with the use's id, properties, script blocks, source
+// range and children taking precedence. The component's own children are
+// not copied but shared with every instance (see QmlCowVector), and each
+// component file is read, parsed and expanded once however many times it
+// is used, until invalidate() drops it. Components that use themselves,
+// directly or not, are left unexpanded at the point they recur.
+//
+// Ids inside a component are repeated in each instance, so findById() on
+// an expanded document returns the first. Safe to call from several
+// threads; two threads expanding a file that is not cached yet may both
+// parse it.
+class QmlProjectIndex {
+public:
+    // Expands the components used in document, which was parsed from
+    // source at path. Component files that cannot be read are left
+    // unresolved. The result is reindexed.
+    QmlDocument expand(QmlDocument document, std::string_view source, const std::string &path);
+    // Makes the instance one component use in the file at path stands for,
+    // expanding the uses among its children; the rest of the file is not
+    // touched. For callers that expand lazily, such as a frontend that
+    // only instantiates what it shows. The file's imports are read from
+    // disk the first time, or taken from the last expand() of it. Returns
+    // false, leaving instance alone, if use is not a component use.
+    bool instantiate(const QmlNode &use, const std::string &path, QmlNode &instance);
+    // The component file type stands for where the file at path uses it,
+    // resolved as expand() does, or "" for a module type or a missing file.
+    std::string componentFile(std::string_view type, const std::string &path);
+
+    // Drops the cached component at path, or every component directly in
+    // it if path is a directory, along with the components that use them,
+    // and forgets how types were resolved and path's imports. Call it when the watcher reports
+    // a change. Returns the number of components dropped.
+    size_t invalidate(const std::string &path);
+
+    // Component files the last expand() of path, and the instantiate()
+    // calls since, used directly or through other components, so a watcher
+    // can follow them.
+    std::vector<std::string> dependenciesOf(const std::string &path) const;
+
+    // Component files read and parsed so far, and those cached now.
+    size_t parseCount() const;
+    size_t componentCount() const;
+
+    // Bytes the cached components hold, counted as in
+    // QmlDocument::memoryUsage() when they are parsed; children shared with
+    // the components they use are counted in each.
+    size_t byteSize() const;
+    // Drops the least recently used components until at least bytes are
+    // freed or none are left; they are parsed again when next used.
+    // Returns the bytes freed. For a QmlCacheBudget.
+    size_t evict(size_t bytes);
+
+    static std::vector<QmlImport> imports(std::string_view source);
+
+private:
+    struct Component {
+        QmlNode root;                          // expanded
+        std::unordered_set<std::string> uses;  // component files, transitively
+        bool valid = true;                     // false if not a single object
+        size_t bytes = 0;
+        uint64_t lastUse = 0;  // of useClock_
+    };
+    class Expander;
+
+    // Copies the expanded root of the component at path into root, sharing
+    // its children, and adds the files it was built from to uses. Returns
+    // false if the file cannot be read or holds more than one object.
+    bool component(const std::string &path, std::vector<std::string> &loading, std::unordered_set<std::string> &uses,
+                   QmlNode &root);
+    // The imports of the file at path, read from disk the first time.
+    std::vector<QmlImport> importsOf(const std::string &file);
+    // The component file type stands for in a file in directory, or "".
+    std::string resolve(std::string_view type, const std::string &directory, const std::vector<QmlImport> &imports);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Component> components_;
+    // "<directory>/<type>" to the file it resolves to, or "" for none.
+    std::unordered_map<std::string, std::string> resolved_;
+    std::unordered_map<std::string, std::unordered_set<std::string>> expandedUses_;
+    std::unordered_map<std::string, std::vector<QmlImport>> imports_;  // of expanded files
+    size_t generation_ = 0;  // bumped by invalidate()
+    size_t parseCount_ = 0;
+    size_t componentBytes_ = 0;
+    uint64_t useClock_ = 0;  // ticks once per component lookup
+};
@@ -0,0 +1,512 @@
+// The sample_qml Python extension: QmlParser, QmlDocument lookups and the
+// batch parser for project tooling, without spawning sample_cli. Built by
+// SAMPLE_PYTHON_BINDINGS; see python/dev_tool/qml.py for its use.
+//
+//   import sample_qml
+//   for path, document, error in sample_qml.parse_files(paths):
+//       for node in document.nodes(): ...
+//
+// Nodes are views into their document and keep it alive. Documents are
+// never modified from Python, so the views stay valid.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <exception>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "qml_atoms.h"
+#include "qml_parser.h"
+
+namespace {
+
+struct DocumentObject {
+    PyObject_HEAD
+    QmlDocument document;
+};
+
+struct NodeObject {
+    PyObject_HEAD
+    DocumentObject *owner;
+    const QmlNode *node;
+};
+
+PyTypeObject DocumentType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+PyTypeObject NodeType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+PyObject *fromString(std::string_view text) {
+    return PyUnicode_DecodeUTF8(text.data(), static_cast<Py_ssize_t>(text.size()), "replace");
+}
+
+// Sets the Python error for a C++ exception; returns null. Exceptions
+// caught with the GIL released are raised once it is held again.
+PyObject *raiseException(std::exception_ptr failure) {
+    try {
+        std::rethrow_exception(failure);
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+    } catch (const std::exception &ex) {
+        PyErr_SetString(PyExc_RuntimeError, ex.what());
+    }
+    return nullptr;
+}
+
+PyObject *newDocument(QmlDocument document) {
+    auto *self = PyObject_New(DocumentObject, &DocumentType);
+    if (!self) {
+        return nullptr;
+    }
+    new (&self->document) QmlDocument(std::move(document));
+    return reinterpret_cast<PyObject *>(self);
+}
+
+// Null node -> None.
+PyObject *newNode(DocumentObject *owner, const QmlNode *node) {
+    if (!node) {
+        Py_RETURN_NONE;
+    }
+    auto *self = PyObject_New(NodeObject, &NodeType);
+    if (!self) {
+        return nullptr;
+    }
+    Py_INCREF(owner);
+    self->owner = owner;
+    self->node = node;
+    return reinterpret_cast<PyObject *>(self);
+}
+
+template <typename Nodes>
+PyObject *nodeList(DocumentObject *owner, const Nodes &nodes) {
+    PyObject *list = PyList_New(0);
+    if (!list) {
+        return nullptr;
+    }
+    for (const auto &entry : nodes) {
+        const QmlNode *node;
+        if constexpr (std::is_pointer_v<std::decay_t<decltype(entry)>>) {
+            node = entry;
+        } else {
+            node = &entry;
+        }
+        PyObject *item = newNode(owner, node);
+        if (!item || PyList_Append(list, item) < 0) {
+            Py_XDECREF(item);
+            Py_DECREF(list);
+            return nullptr;
+        }
+        Py_DECREF(item);
+    }
+    return list;
+}
+
+PyObject *typedValue(const QmlProperty &property) {
+    switch (property.typed.kind) {
+    case QmlValueKind::Int:
+        return PyLong_FromLongLong(property.typed.intValue);
+    case QmlValueKind::Real:
+        return PyFloat_FromDouble(property.typed.realValue);
+    case QmlValueKind::Bool:
+        return PyBool_FromLong(property.typed.intValue != 0);
+    default:
+        return fromString(property.value);
+    }
+}
+
+// Document
+
+void documentDealloc(PyObject *object) {
+    auto *self = reinterpret_cast<DocumentObject *>(object);
+    self->document.~QmlDocument();
+    Py_TYPE(object)->tp_free(object);
+}
+
+PyObject *documentRoots(PyObject *object, void *) {
+    auto *self = reinterpret_cast<DocumentObject *>(object);
+    return nodeList(self, self->document.roots);
+}
+
+PyObject *documentNodes(PyObject *object, PyObject *) {
+    auto *self = reinterpret_cast<DocumentObject *>(object);
+    return nodeList(self, self->document.nodes());
+}
+
+PyObject *documentFindById(PyObject *object, PyObject *arg) {
+    auto *self = reinterpret_cast<DocumentObject *>(object);
+    const char *id = PyUnicode_AsUTF8(arg);
+    if (!id) {
+        return nullptr;
+    }
+    return newNode(self, self->document.findById(id));
+}
+
+PyObject *documentNodesOfType(PyObject *object, PyObject *arg) {
+    auto *self = reinterpret_cast<DocumentObject *>(object);
+    Py_ssize_t length = 0;
+    const char *type = PyUnicode_AsUTF8AndSize(arg, &length);
+    if (!type) {
+        return nullptr;
+    }
+    // A type no document has used was never interned, so none has it.
+    const QmlAtom atom = QmlAtomTable::global().find(std::string_view(type, static_cast<size_t>(length)));
+    if (atom == QmlAtoms::Invalid) {
+        return PyList_New(0);
+    }
+    try {
+        return nodeList(self, self->document.nodesOfType(atom));
+    } catch (...) {
+        return raiseException(std::current_exception());
+    }
+}
+
+// Null if arg is not a node of this document, with the error set.
+const QmlNode *ownNode(DocumentObject *self, PyObject *arg) {
+    if (!PyObject_TypeCheck(arg, &NodeType)) {
+        PyErr_SetString(PyExc_TypeError, "expected a sample_qml.Node");
+        return nullptr;
+    }
+    auto *node = reinterpret_cast<NodeObject *>(arg);
+    if (node->owner != self) {
+        PyErr_SetString(PyExc_ValueError, "the node belongs to another document");
+        return nullptr;
+    }
+    return node->node;
+}
+
+PyObject *documentParentOf(PyObject *object, PyObject *arg) {
+    auto *self = reinterpret_cast<DocumentObject *>(object);
+    const QmlNode *node = ownNode(self, arg);
+    return node ? newNode(self, self->document.parentOf(*node)) : nullptr;
+}
+
+PyObject *documentEnclosingOfType(PyObject *object, PyObject *args) {
+    auto *self = reinterpret_cast<DocumentObject *>(object);
+    PyObject *arg = nullptr;
+    const char *type = nullptr;
+    Py_ssize_t length = 0;
+    if (!PyArg_ParseTuple(args, "Os#", &arg, &type, &length)) {
+        return nullptr;
+    }
+    const QmlNode *node = ownNode(self, arg);
+    if (!node) {
+        return nullptr;
+    }
+    const QmlAtom atom = QmlAtomTable::global().find(std::string_view(type, static_cast<size_t>(length)));
+    return newNode(self, atom == QmlAtoms::Invalid ? nullptr : self->document.enclosingOfType(*node, atom));
+}
+
+PyGetSetDef documentGetSet[] = {
+    {"roots", documentRoots, nullptr, "Top-level objects, in source order.", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+PyMethodDef documentMethods[] = {
+    {"nodes", documentNodes, METH_NOARGS, "nodes() -> list[Node]: every node, roots included, in pre-order."},
+    {"find_by_id", documentFindById, METH_O, "find_by_id(id) -> Node | None"},
+    {"nodes_of_type", documentNodesOfType, METH_O, "nodes_of_type(type) -> list[Node], in pre-order."},
+    {"parent_of", documentParentOf, METH_O, "parent_of(node) -> Node | None; None for roots."},
+    {"enclosing_of_type", documentEnclosingOfType, METH_VARARGS,
+     "enclosing_of_type(node, type) -> Node | None: the nearest ancestor of the type."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+// Node
+
+void nodeDealloc(PyObject *object) {
+    auto *self = reinterpret_cast<NodeObject *>(object);
+    Py_DECREF(self->owner);
+    Py_TYPE(object)->tp_free(object);
+}
+
+PyObject *nodeType(PyObject *object, void *) {
+    return fromString(reinterpret_cast<NodeObject *>(object)->node->type);
+}
+
+PyObject *nodeId(PyObject *object, void *) {
+    return fromString(reinterpret_cast<NodeObject *>(object)->node->id);
+}
+
+PyObject *nodeBinding(PyObject *object, void *) {
+    return fromString(QmlAtomTable::global().name(reinterpret_cast<NodeObject *>(object)->node->binding));
+}
+
+PyObject *nodeChildren(PyObject *object, void *) {
+    auto *self = reinterpret_cast<NodeObject *>(object);
+    return nodeList(self->owner, self->node->children);
+}
+
+PyObject *nodeDocument(PyObject *object, void *) {
+    auto *owner = reinterpret_cast<PyObject *>(reinterpret_cast<NodeObject *>(object)->owner);
+    Py_INCREF(owner);
+    return owner;
+}
+
+PyObject *nodeSourceRange(PyObject *object, void *) {
+    const QmlNode *node = reinterpret_cast<NodeObject *>(object)->node;
+    return Py_BuildValue("(nn)", static_cast<Py_ssize_t>(node->sourceBegin), static_cast<Py_ssize_t>(node->sourceEnd));
+}
+
+PyObject *nodeProperties(PyObject *object, void *) {
+    const QmlNode *node = reinterpret_cast<NodeObject *>(object)->node;
+    PyObject *dict = PyDict_New();
+    if (!dict) {
+        return nullptr;
+    }
+    const QmlAtomTable &atoms = QmlAtomTable::global();
+    for (const QmlProperty &property : node->properties) {
+        PyObject *key = fromString(atoms.name(property.key));
+        PyObject *value = fromString(property.value);
+        if (!key || !value || PyDict_SetItem(dict, key, value) < 0) {
+            Py_XDECREF(key);
+            Py_XDECREF(value);
+            Py_DECREF(dict);
+            return nullptr;
+        }
+        Py_DECREF(key);
+        Py_DECREF(value);
+    }
+    return dict;
+}
+
+PyObject *nodeScripts(PyObject *object, void *) {
+    const QmlNode *node = reinterpret_cast<NodeObject *>(object)->node;
+    PyObject *list = PyList_New(0);
+    if (!list) {
+        return nullptr;
+    }
+    const QmlAtomTable &atoms = QmlAtomTable::global();
+    for (const QmlScriptBlock &script : node->scripts) {
+        const std::string_view name = atoms.name(script.name);
+        PyObject *item = Py_BuildValue("(ss#)", script.kind == QmlScriptKind::Function ? "function" : "handler",
+                                       name.data(), static_cast<Py_ssize_t>(name.size()));
+        if (!item || PyList_Append(list, item) < 0) {
+            Py_XDECREF(item);
+            Py_DECREF(list);
+            return nullptr;
+        }
+        Py_DECREF(item);
+    }
+    return list;
+}
+
+PyObject *nodeValue(PyObject *object, PyObject *args) {
+    const QmlNode *node = reinterpret_cast<NodeObject *>(object)->node;
+    const char *key = nullptr;
+    Py_ssize_t length = 0;
+    PyObject *defaultValue = Py_None;
+    if (!PyArg_ParseTuple(args, "s#|O", &key, &length, &defaultValue)) {
+        return nullptr;
+    }
+    const QmlAtom atom = QmlAtomTable::global().find(std::string_view(key, static_cast<size_t>(length)));
+    const QmlProperty *property = atom == QmlAtoms::Invalid ? nullptr : node->findProperty(atom);
+    if (!property) {
+        Py_INCREF(defaultValue);
+        return defaultValue;
+    }
+    return typedValue(*property);
+}
+
+PyObject *nodeRepr(PyObject *object) {
+    const QmlNode *node = reinterpret_cast<NodeObject *>(object)->node;
+    if (node->id.empty()) {
+        return PyUnicode_FromFormat("<sample_qml.Node %s>", node->type.c_str());
+    }
+    return PyUnicode_FromFormat("<sample_qml.Node %s id=%s>", node->type.c_str(), node->id.c_str());
+}
+
+PyGetSetDef nodeGetSet[] = {
+    {"type", nodeType, nullptr, "Object type as written, e.g. \"Text\" or \"QtQuick.Text\".", nullptr},
+    {"id", nodeId, nullptr, "The id, or an empty string.", nullptr},
+    {"binding", nodeBinding, nullptr, "The property the object is the value of, or an empty string.", nullptr},
+    {"children", nodeChildren, nullptr, "Child objects, in source order.", nullptr},
+    {"document", nodeDocument, nullptr, "The Document the node belongs to.", nullptr},
+    {"properties", nodeProperties, nullptr, "Property name -> unquoted text, in assignment order.", nullptr},
+    {"scripts", nodeScripts, nullptr, "(\"handler\" | \"function\", name) pairs, in source order.", nullptr},
+    {"source_range", nodeSourceRange, nullptr, "(begin, end) byte offsets of the object's lines.", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+PyMethodDef nodeMethods[] = {
+    {"value", nodeValue, METH_VARARGS,
+     "value(name, default=None): the property as int, float or bool where it is one, text otherwise."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+// Module
+
+PyObject *parseString(PyObject *, PyObject *arg) {
+    Py_ssize_t length = 0;
+    const char *source = PyUnicode_AsUTF8AndSize(arg, &length);
+    if (!source) {
+        return nullptr;
+    }
+    QmlDocument document;
+    std::exception_ptr failure;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        document = QmlParser().parseString(std::string_view(source, static_cast<size_t>(length)));
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    Py_END_ALLOW_THREADS
+    if (failure) {
+        return raiseException(failure);
+    }
+    return newDocument(std::move(document));
+}
+
+PyObject *parseFile(PyObject *, PyObject *arg) {
+    PyObject *encoded = nullptr;
+    if (!PyUnicode_FSConverter(arg, &encoded)) {
+        return nullptr;
+    }
+    const std::string path = PyBytes_AS_STRING(encoded);
+    Py_DECREF(encoded);
+
+    QmlDocument document;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        document = QmlParser().parseFile(path);
+    } catch (const std::exception &ex) {
+        error = ex.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return nullptr;
+    }
+    return newDocument(std::move(document));
+}
+
+PyObject *parseFiles(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = {"paths", "threads", nullptr};
+    PyObject *iterable = nullptr;
+    unsigned int threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|I", const_cast<char **>(keywords), &iterable, &threads)) {
+        return nullptr;
+    }
+    PyObject *sequence = PySequence_Fast(iterable, "paths must be iterable");
+    if (!sequence) {
+        return nullptr;
+    }
+    std::vector<std::string> paths;
+    const Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+    paths.reserve(static_cast<size_t>(count));
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        PyObject *encoded = nullptr;
+        if (!PyUnicode_FSConverter(PySequence_Fast_GET_ITEM(sequence, i), &encoded)) {
+            Py_DECREF(sequence);
+            return nullptr;
+        }
+        paths.emplace_back(PyBytes_AS_STRING(encoded));
+        Py_DECREF(encoded);
+    }
+    Py_DECREF(sequence);
+
+    std::vector<QmlParseResult> results;
+    std::exception_ptr failure;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        results = QmlParser().parseFiles(paths, threads);
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    Py_END_ALLOW_THREADS
+    if (failure) {
+        return raiseException(failure);
+    }
+
+    PyObject *list = PyList_New(static_cast<Py_ssize_t>(results.size()));
+    if (!list) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+        QmlParseResult &result = results[i];
+        PyObject *path = PyUnicode_DecodeFSDefault(result.path.c_str());
+        PyObject *document = nullptr;
+        PyObject *error = nullptr;
+        if (result.ok()) {
+            document = newDocument(std::move(result.document));
+            error = Py_None;
+            Py_INCREF(error);
+        } else {
+            document = Py_None;
+            Py_INCREF(document);
+            error = fromString(result.error);
+        }
+        if (!path || !document || !error) {
+            Py_XDECREF(path);
+            Py_XDECREF(document);
+            Py_XDECREF(error);
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), PyTuple_Pack(3, path, document, error));
+        Py_DECREF(path);
+        Py_DECREF(document);
+        Py_DECREF(error);
+        if (!PyList_GET_ITEM(list, static_cast<Py_ssize_t>(i))) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+    }
+    return list;
+}
+
+PyMethodDef moduleMethods[] = {
+    {"parse_string", parseString, METH_O, "parse_string(source) -> Document"},
+    {"parse_file", parseFile, METH_O, "parse_file(path) -> Document; OSError if it cannot be read."},
+    {"parse_files", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(parseFiles)),
+     METH_VARARGS | METH_KEYWORDS,
+     "parse_files(paths, threads=0) -> list[(path, Document | None, error | None)]\n\n"
+     "Parses on up to threads threads (0 = one per core) without holding the GIL. "
+     "Results are in input order; a file that fails reports its error without affecting others."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef moduleDef = {
+    PyModuleDef_HEAD_INIT, "sample_qml", "Native QmlParser for project tooling.", -1, moduleMethods,
+    nullptr, nullptr, nullptr, nullptr,
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_sample_qml() {
+    DocumentType.tp_name = "sample_qml.Document";
+    DocumentType.tp_basicsize = sizeof(DocumentObject);
+    DocumentType.tp_flags = Py_TPFLAGS_DEFAULT;
+    DocumentType.tp_doc = "A parsed QML document; see QmlDocument.";
+    DocumentType.tp_dealloc = documentDealloc;
+    DocumentType.tp_getset = documentGetSet;
+    DocumentType.tp_methods = documentMethods;
+
+    NodeType.tp_name = "sample_qml.Node";
+    NodeType.tp_basicsize = sizeof(NodeObject);
+    NodeType.tp_flags = Py_TPFLAGS_DEFAULT;
+    NodeType.tp_doc = "A QML object in a Document; see QmlNode.";
+    NodeType.tp_dealloc = nodeDealloc;
+    NodeType.tp_repr = nodeRepr;
+    NodeType.tp_getset = nodeGetSet;
+    NodeType.tp_methods = nodeMethods;
+
+    if (PyType_Ready(&DocumentType) < 0 || PyType_Ready(&NodeType) < 0) {
+        return nullptr;
+    }
+    PyObject *module = PyModule_Create(&moduleDef);
+    if (!module) {
+        return nullptr;
+    }
+    Py_INCREF(&DocumentType);
+    Py_INCREF(&NodeType);
+    if (PyModule_AddObject(module, "Document", reinterpret_cast<PyObject *>(&DocumentType)) < 0 ||
+        PyModule_AddObject(module, "Node", reinterpret_cast<PyObject *>(&NodeType)) < 0 ||
+        PyModule_AddIntConstant(module, "GRAMMAR_VERSION", QmlParser::kGrammarVersion) < 0) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "qml_coroutine.h"
+
+#if defined(QML_COROUTINES)
+
+#include <QAbstractSocket>
+#include <QByteArray>
+#include <QObject>
+#include <coroutine>
+
+// Socket awaiters for coroutines that serve a connection, resumed from the
+// event loop of the socket's thread by its own signals. One coroutine at a
+// time may wait on a socket; deleting the socket under it leaves it
+// suspended, so close the socket and let the coroutine see that instead.
+
+// `co_await qmlReadable(socket)` resumes with what has arrived, once
+// anything has; empty once the socket is closed.
+class QmlReadableAwaiter {
+public:
+    explicit QmlReadableAwaiter(QAbstractSocket &socket) : socket_(&socket) {}
+
+    bool await_ready() const {
+        return socket_->bytesAvailable() > 0 || socket_->state() == QAbstractSocket::UnconnectedState;
+    }
+    void await_suspend(std::coroutine_handle<> awaiting) {
+        awaiting_ = awaiting;
+        connections_[0] = QObject::connect(socket_, &QAbstractSocket::readyRead, [this] { resume(); });
+        connections_[1] = QObject::connect(socket_, &QAbstractSocket::disconnected, [this] { resume(); });
+    }
+    QByteArray await_resume() { return socket_->readAll(); }
+
+private:
+    void resume() {
+        for (const QMetaObject::Connection &connection : connections_) {
+            QObject::disconnect(connection);
+        }
+        awaiting_.resume();
+    }
+
+    QAbstractSocket *socket_;
+    std::coroutine_handle<> awaiting_;
+    QMetaObject::Connection connections_[2];
+};
+
+inline QmlReadableAwaiter qmlReadable(QAbstractSocket &socket) {
+    return QmlReadableAwaiter(socket);
+}
+
+// `co_await qmlDrained(socket, backlog)` resumes once no more than backlog
+// bytes wait to be written, or the socket is closed; it resumes with
+// whether the socket can still be written to.
+class QmlDrainedAwaiter {
+public:
+    QmlDrainedAwaiter(QAbstractSocket &socket, qint64 backlog) : socket_(&socket), backlog_(backlog) {}
+
+    bool await_ready() const {
+        return socket_->bytesToWrite() <= backlog_ || socket_->state() == QAbstractSocket::UnconnectedState;
+    }
+    void await_suspend(std::coroutine_handle<> awaiting) {
+        awaiting_ = awaiting;
+        connections_[0] = QObject::connect(socket_, &QAbstractSocket::bytesWritten, [this] {
+            if (socket_->bytesToWrite() <= backlog_) {
+                resume();
+            }
+        });
+        connections_[1] = QObject::connect(socket_, &QAbstractSocket::disconnected, [this] { resume(); });
+    }
+    bool await_resume() const { return socket_->state() == QAbstractSocket::ConnectedState; }
+
+private:
+    void resume() {
+        for (const QMetaObject::Connection &connection : connections_) {
+            QObject::disconnect(connection);
+        }
+        awaiting_.resume();
+    }
+
+    QAbstractSocket *socket_;
+    qint64 backlog_;
+    std::coroutine_handle<> awaiting_;
+    QMetaObject::Connection connections_[2];
+};
+
+inline QmlDrainedAwaiter qmlDrained(QAbstractSocket &socket, qint64 backlog = 0) {
+    return QmlDrainedAwaiter(socket, backlog);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "qml_qt_list_model.h"
+
+#include <QAbstractItemModel>
+
+QmlQtListModel::QmlQtListModel(QAbstractItemModel *model, QObject *parent) : QObject(parent), model_(model) {
+    cacheRoles();
+    if (!model) {
+        return;
+    }
+    connect(model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &parent, int first, int last) {
+        if (!parent.isValid()) {
+            notifyRowsInserted(static_cast<size_t>(first), static_cast<size_t>(last - first + 1));
+            changed();
+        }
+    });
+    connect(model, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &parent, int first, int last) {
+        if (!parent.isValid()) {
+            notifyRowsRemoved(static_cast<size_t>(first), static_cast<size_t>(last - first + 1));
+            changed();
+        }
+    });
+    connect(model, &QAbstractItemModel::rowsMoved, this,
+            [this](const QModelIndex &source, int first, int last, const QModelIndex &target, int row) {
+                if (source.isValid() || target.isValid()) {
+                    return;
+                }
+                // Qt gives the destination before the move, QmlListModel
+                // the row the first moved one ends up at.
+                const int count = last - first + 1;
+                const int destination = row > first ? row - count : row;
+                notifyRowsMoved(static_cast<size_t>(first), static_cast<size_t>(count),
+                                static_cast<size_t>(destination));
+                changed();
+            });
+    connect(model, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex &top, const QModelIndex &bottom) {
+        if (!top.parent().isValid()) {
+            notifyDataChanged(static_cast<size_t>(top.row()), static_cast<size_t>(bottom.row() - top.row() + 1));
+            changed();
+        }
+    });
+    connect(model, &QAbstractItemModel::modelReset, this, [this] {
+        cacheRoles();
+        notifyModelReset();
+        changed();
+    });
+    connect(model, &QAbstractItemModel::layoutChanged, this, [this] {
+        notifyModelReset();
+        changed();
+    });
+}
+
+void QmlQtListModel::cacheRoles() {
+    roles_.clear();
+    if (!model_) {
+        return;
+    }
+    const QHash<int, QByteArray> names = model_->roleNames();
+    for (auto it = names.begin(); it != names.end(); ++it) {
+        roles_.emplace_back(QmlAtomTable::global().intern(std::string_view(it.value().constData(),
+                                                                           static_cast<size_t>(it.value().size()))),
+                            it.key());
+    }
+}
+
+size_t QmlQtListModel::rowCount() const {
+    return model_ ? static_cast<size_t>(model_->rowCount()) : 0;
+}
+
+bool QmlQtListModel::data(size_t row, QmlAtom role, std::string &value) const {
+    if (!model_) {
+        return false;
+    }
+    for (const auto &entry : roles_) {
+        if (entry.first == role) {
+            const QVariant data = model_->data(model_->index(static_cast<int>(row), 0), entry.second);
+            value.append(data.toString().toStdString());
+            return true;
+        }
+    }
+    return false;
+}
+
+void QmlQtListModel::changed() {
+    if (changed_) {
+        changed_();
+    }
+}
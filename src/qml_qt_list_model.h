@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <functional>
+#include <vector>
+
+#include "qml_list_model.h"
+
+class QAbstractItemModel;
+
+// QmlListModel over the top-level rows of a QAbstractItemModel, so a C++
+// list model such as Greeter's history feeds a Repeater or ListView in the
+// curses frontend as it feeds one in Qt Quick. Row signals are forwarded
+// as the matching observer calls, and a role is looked up by its
+// roleNames() name once per reset. Only the rows the model has announced
+// are shown; nothing calls fetchMore(). The model is not owned.
+class QmlQtListModel : public QObject, public QmlListModel {
+public:
+    explicit QmlQtListModel(QAbstractItemModel *model, QObject *parent = nullptr);
+
+    size_t rowCount() const override;
+    bool data(size_t row, QmlAtom role, std::string &value) const override;
+
+    // Called after every forwarded change, e.g. to request a frame.
+    void setChangedHandler(std::function<void()> changed) { changed_ = std::move(changed); }
+
+private:
+    void cacheRoles();
+    void changed();
+
+    QPointer<QAbstractItemModel> model_;
+    std::vector<std::pair<QmlAtom, int>> roles_;  // atom to Qt role
+    std::function<void()> changed_;
+};
@@ -0,0 +1,47 @@
+#include "qml_qt_resources.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QResource>
+
+namespace {
+
+// ":/a/b" for either spelling. Component paths are put together with
+// std::filesystem, which uses native separators on Windows.
+QString resourceName(std::string_view path) {
+    if (path.substr(0, 4) == "qrc:") {
+        path.remove_prefix(3);
+    }
+    return QDir::fromNativeSeparators(QString::fromUtf8(path.data(), static_cast<qsizetype>(path.size())));
+}
+
+} // namespace
+
+void QmlQtResources::install() {
+    static const QmlQtResources resources;
+    MappedFile::setProvider(&resources);
+}
+
+bool QmlQtResources::isResourcePath(std::string_view path) {
+    return path.substr(0, 2) == ":/" || path.substr(0, 2) == ":\\" || path.substr(0, 5) == "qrc:/";
+}
+
+bool QmlQtResources::exists(const std::string &path) const {
+    return QFileInfo(resourceName(path)).isFile();
+}
+
+bool QmlQtResources::read(const std::string &path, std::string_view &view, std::string &storage) const {
+    const QString name = resourceName(path);
+    if (!QFileInfo(name).isFile()) {
+        return false;
+    }
+    const QResource resource(name);
+    if (resource.compressionAlgorithm() == QResource::NoCompression) {
+        // Resource data compiled into the binary lives as long as the process.
+        view = std::string_view(reinterpret_cast<const char *>(resource.data()), static_cast<size_t>(resource.size()));
+        return true;
+    }
+    const QByteArray bytes = resource.uncompressedData();
+    storage.assign(bytes.constData(), static_cast<size_t>(bytes.size()));
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "mapped_file.h"
+
+// Reads QML out of Qt resources, so QmlParser::parseFile(), the AST cache
+// and QmlProjectIndex take ":/path" and "qrc:/path" names once install()
+// has run. Uncompressed resources are parsed in place, straight from the
+// data compiled into the binary; compressed ones are inflated on each read.
+// Nothing on disk is looked at for these names.
+class QmlQtResources : public MappedFileProvider {
+public:
+    // Makes the process-wide instance MappedFile's provider.
+    static void install();
+    static bool isResourcePath(std::string_view path);
+
+    bool handles(std::string_view path) const override { return isResourcePath(path); }
+    bool exists(const std::string &path) const override;
+    bool read(const std::string &path, std::string_view &view, std::string &storage) const override;
+};
@@ -0,0 +1,282 @@
+#include "qml_remote_screen.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "qml_varint.h"
+
+namespace {
+
+// Frames larger than this are treated as a corrupt stream.
+constexpr uint64_t kMaxFrameBytes = 64u << 20;
+
+}  // namespace
+
+QmlRemoteScreen::QmlRemoteScreen(int rows, int cols) {
+    screen_.resize(rows, cols);
+}
+
+void QmlRemoteScreen::clear() {
+    screen_.clear();
+    runs_.clear();
+    runCount_ = 0;
+    flags_ |= QmlRemoteProtocol::kClear;
+    keyframeValid_ = false;
+}
+
+void QmlRemoteScreen::drawText(int row, int col, const std::string &text) {
+    drawStyledText(row, col, text, 0);
+}
+
+void QmlRemoteScreen::drawStyledText(int row, int col, const std::string &text, uint32_t attributes) {
+    const ScreenRun run{row, col, text, attributes};
+    drawRuns(&run, 1);
+}
+
+void QmlRemoteScreen::drawRuns(const ScreenRun *runs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const ScreenRun &run = runs[i];
+        if (run.row < 0 || run.row >= rows() || run.col < 0 || run.col >= cols() || run.text.empty()) {
+            continue;
+        }
+        screen_.put(run.row, run.col, run.text, run.attributes);
+        encodeRun(run.row, run.col, run.attributes, run.text);
+    }
+    if (count > 0) {
+        keyframeValid_ = false;
+    }
+}
+
+void QmlRemoteScreen::encodeRun(int row, int col, uint32_t attributes, std::string_view text) {
+    QmlVarint::append(runs_, static_cast<uint64_t>(row));
+    QmlVarint::append(runs_, static_cast<uint64_t>(col));
+    QmlVarint::append(runs_, attributes);
+    QmlVarint::append(runs_, text.size());
+    runs_.append(text);
+    ++runCount_;
+}
+
+std::string QmlRemoteScreen::finishFrame(uint8_t flags, int rows, int cols, size_t runCount, std::string_view runs) {
+    std::string payload;
+    payload.reserve(runs.size() + 16);
+    payload.push_back(static_cast<char>(flags));
+    QmlVarint::append(payload, static_cast<uint64_t>(rows));
+    QmlVarint::append(payload, static_cast<uint64_t>(cols));
+    QmlVarint::append(payload, runCount);
+    payload.append(runs);
+
+    std::string frame;
+    frame.reserve(payload.size() + 5);
+    QmlVarint::append(frame, payload.size());
+    frame.append(payload);
+    return frame;
+}
+
+void QmlRemoteScreen::refresh() {
+    if (runCount_ == 0 && flags_ == 0) {
+        for (Viewer &viewer : viewers_) {
+            if (viewer.behind) {
+                catchUp(viewer);
+            }
+        }
+        return;
+    }
+    const std::string frame = finishFrame(flags_, rows(), cols(), runCount_, runs_);
+    runs_.clear();
+    runCount_ = 0;
+    flags_ = 0;
+
+    for (Viewer &viewer : viewers_) {
+        // A lagging viewer skips the delta; the keyframe already has it.
+        if (viewer.behind ? catchUp(viewer) : viewer.send(frame)) {
+            ++framesSent_;
+        } else {
+            viewer.behind = true;
+            ++framesDropped_;
+        }
+    }
+}
+
+void QmlRemoteScreen::resize(int rows, int cols) {
+    if (rows == this->rows() && cols == this->cols()) {
+        return;
+    }
+    screen_.resize(rows, cols);
+    runs_.clear();
+    runCount_ = 0;
+    flags_ |= QmlRemoteProtocol::kClear;
+    keyframeValid_ = false;
+}
+
+// The whole screen as one frame: per row, one run per attribute change
+// between the first and last non-blank cells.
+const std::string &QmlRemoteScreen::keyframe() {
+    if (keyframeValid_) {
+        return keyframe_;
+    }
+    std::string runs;
+    size_t runCount = 0;
+    std::string text;
+    for (int row = 0; row < rows(); ++row) {
+        const QmlCell *cells = screen_.row(row);
+        int first = 0;
+        int last = cols();
+        while (first < last && cells[first] == QmlCell{}) {
+            ++first;
+        }
+        while (last > first && cells[last - 1] == QmlCell{}) {
+            --last;
+        }
+        for (int col = first; col < last;) {
+            const uint32_t attributes = cells[col].attributes;
+            const int start = col;
+            text.clear();
+            for (; col < last && cells[col].attributes == attributes; ++col) {
+                for (uint32_t glyph = cells[col].glyph; glyph != 0; glyph >>= 8) {
+                    text.push_back(static_cast<char>(glyph & 0xFF));
+                }
+            }
+            QmlVarint::append(runs, static_cast<uint64_t>(row));
+            QmlVarint::append(runs, static_cast<uint64_t>(start));
+            QmlVarint::append(runs, attributes);
+            QmlVarint::append(runs, text.size());
+            runs.append(text);
+            ++runCount;
+        }
+    }
+    keyframe_ = finishFrame(QmlRemoteProtocol::kClear | QmlRemoteProtocol::kKeyframe, rows(), cols(), runCount, runs);
+    keyframeValid_ = true;
+    return keyframe_;
+}
+
+bool QmlRemoteScreen::catchUp(Viewer &viewer) {
+    const std::string &frame = keyframe();
+    bool sent = false;
+    if (viewer.greeted) {
+        sent = viewer.send(frame);
+    } else {
+        std::string message;
+        message.reserve(QmlRemoteProtocol::kMagic.size() + frame.size());
+        message.append(QmlRemoteProtocol::kMagic);
+        message.append(frame);
+        sent = viewer.send(message);
+    }
+    if (sent) {
+        viewer.greeted = true;
+        viewer.behind = false;
+        ++keyframesSent_;
+    }
+    return sent;
+}
+
+QmlRemoteScreen::ViewerId QmlRemoteScreen::addViewer(Send send) {
+    viewers_.push_back(Viewer{nextViewer_++, std::move(send)});
+    catchUp(viewers_.back());
+    return viewers_.back().id;
+}
+
+void QmlRemoteScreen::removeViewer(ViewerId viewer) {
+    viewers_.erase(std::remove_if(viewers_.begin(), viewers_.end(),
+                                  [viewer](const Viewer &entry) { return entry.id == viewer; }),
+                   viewers_.end());
+}
+
+void QmlRemoteScreen::viewerReady(ViewerId viewer) {
+    for (Viewer &entry : viewers_) {
+        if (entry.id == viewer && entry.behind) {
+            catchUp(entry);
+        }
+    }
+}
+
+bool QmlRemoteDecoder::feed(std::string_view bytes) {
+    if (failed_) {
+        return false;
+    }
+    buffer_.append(bytes);
+    const std::string_view data(buffer_);
+    size_t pos = 0;
+    if (!greeted_) {
+        const std::string_view magic = QmlRemoteProtocol::kMagic;
+        if (data.size() < magic.size()) {
+            failed_ = data != magic.substr(0, data.size());
+            return !failed_;
+        }
+        if (data.substr(0, magic.size()) != magic) {
+            failed_ = true;
+            return false;
+        }
+        pos = magic.size();
+        greeted_ = true;
+    }
+    while (pos < data.size()) {
+        size_t payload = pos;
+        uint64_t length = 0;
+        const QmlVarint::Status status = QmlVarint::read(data, payload, length);
+        if (status == QmlVarint::Status::Incomplete) {
+            break;
+        }
+        if (status == QmlVarint::Status::Malformed || length > kMaxFrameBytes) {
+            failed_ = true;
+            return false;
+        }
+        if (data.size() - payload < length) {
+            break;
+        }
+        if (!applyFrame(data.substr(payload, length))) {
+            failed_ = true;
+            return false;
+        }
+        pos = payload + length;
+    }
+    buffer_.erase(0, pos);
+    return true;
+}
+
+bool QmlRemoteDecoder::applyFrame(std::string_view payload) {
+    if (payload.empty()) {
+        return false;
+    }
+    const auto flags = static_cast<uint8_t>(payload[0]);
+    size_t pos = 1;
+    int rows = 0;
+    int cols = 0;
+    uint64_t count = 0;
+    if (!QmlVarint::readInt(payload, pos, rows) || !QmlVarint::readInt(payload, pos, cols) ||
+        QmlVarint::read(payload, pos, count) != QmlVarint::Status::Ok || count > payload.size()) {
+        return false;
+    }
+    runs_.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+        ScreenRun run;
+        uint64_t attributes = 0;
+        uint64_t length = 0;
+        if (!QmlVarint::readInt(payload, pos, run.row) || !QmlVarint::readInt(payload, pos, run.col) ||
+            QmlVarint::read(payload, pos, attributes) != QmlVarint::Status::Ok || attributes > UINT32_MAX ||
+            QmlVarint::read(payload, pos, length) != QmlVarint::Status::Ok || length > payload.size() - pos) {
+            return false;
+        }
+        run.attributes = static_cast<uint32_t>(attributes);
+        run.text = payload.substr(pos, length);
+        pos += length;
+        runs_.push_back(run);
+    }
+    if (pos != payload.size()) {
+        return false;
+    }
+
+    rows_ = rows;
+    cols_ = cols;
+    if (flags & QmlRemoteProtocol::kClear) {
+        screen_.clear();
+    }
+    if (!runs_.empty()) {
+        screen_.drawRuns(runs_.data(), runs_.size());
+    }
+    screen_.refresh();
+    ++framesApplied_;
+    if (flags & QmlRemoteProtocol::kKeyframe) {
+        ++keyframesApplied_;
+    }
+    return true;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qml_cell_grid.h"
+#include "qml_curses_frontend.h"
+
+// Wire format shared by QmlRemoteScreen and QmlRemoteDecoder. A stream
+// opens with kMagic and is then a sequence of frames, each a LEB128
+// varint payload length followed by the payload:
+//
+//   flags    u8      kClear: blank the screen first
+//                    kKeyframe: the frame repaints the whole screen
+//   rows     varint
+//   cols     varint
+//   count    varint  number of runs
+//   runs     count times: row, col, attributes (varints), byte length
+//                    (varint), then that many bytes of UTF-8 text
+//
+// The runs are the cell grid's damage: a frame carries only what changed
+// since the previous one, unless it is a keyframe.
+namespace QmlRemoteProtocol {
+constexpr std::string_view kMagic = "QRS1";
+constexpr uint8_t kClear = 1;
+constexpr uint8_t kKeyframe = 2;
+}  // namespace QmlRemoteProtocol
+
+// ICursesScreen that serves one rendered UI to any number of viewers. Each
+// refresh() encodes the frame's runs once and hands the same bytes to
+// every viewer. A viewer whose link cannot take a frame misses it, as do
+// all frames until the link drains; it is then caught up with a single
+// keyframe of the current screen, so a slow viewer costs dropped frames
+// rather than a growing queue.
+class QmlRemoteScreen : public ICursesScreen {
+public:
+    using ViewerId = uint32_t;
+    // Sends one whole message, or returns false without sending any of it
+    // when the link is too backed up to take it now.
+    using Send = std::function<bool(std::string_view message)>;
+
+    QmlRemoteScreen(int rows, int cols);
+
+    void clear() override;
+    void drawText(int row, int col, const std::string &text) override;
+    void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override;
+    void drawRuns(const ScreenRun *runs, size_t count) override;
+    void refresh() override;
+    int rows() const override { return screen_.rows(); }
+    int cols() const override { return screen_.cols(); }
+
+    // Viewers see the new size with the frontend's next, repainted frame.
+    void resize(int rows, int cols);
+
+    // A new viewer gets the stream header and a keyframe straight away.
+    ViewerId addViewer(Send send);
+    void removeViewer(ViewerId viewer);
+    // Call when a viewer's link has drained, to catch it up now rather
+    // than with the next frame.
+    void viewerReady(ViewerId viewer);
+    size_t viewerCount() const { return viewers_.size(); }
+
+    size_t framesSent() const { return framesSent_; }
+    size_t framesDropped() const { return framesDropped_; }
+    size_t keyframesSent() const { return keyframesSent_; }
+
+private:
+    struct Viewer {
+        ViewerId id;
+        Send send;
+        bool greeted = false;
+        bool behind = true;  // needs a keyframe
+    };
+
+    void beginFrame();
+    void encodeRun(int row, int col, uint32_t attributes, std::string_view text);
+    static std::string finishFrame(uint8_t flags, int rows, int cols, size_t runCount, std::string_view runs);
+    const std::string &keyframe();
+    bool catchUp(Viewer &viewer);
+
+    QmlCellPad screen_;  // what the viewers should be showing
+    std::vector<Viewer> viewers_;
+    ViewerId nextViewer_ = 1;
+    // The frame being drawn.
+    std::string runs_;
+    size_t runCount_ = 0;
+    uint8_t flags_ = 0;
+    // Encoded keyframe of screen_, built on demand and dropped on change.
+    std::string keyframe_;
+    bool keyframeValid_ = false;
+    size_t framesSent_ = 0;
+    size_t framesDropped_ = 0;
+    size_t keyframesSent_ = 0;
+};
+
+// Client side: decodes a QmlRemoteScreen stream and replays each frame on
+// a local screen, such as a VtScreen, ending with one refresh().
+class QmlRemoteDecoder {
+public:
+    explicit QmlRemoteDecoder(ICursesScreen &screen) : screen_(screen) {}
+
+    // Appends bytes as they arrive, in chunks of any size, and applies
+    // every complete frame. Returns false once the stream is malformed.
+    bool feed(std::string_view bytes);
+
+    size_t framesApplied() const { return framesApplied_; }
+    size_t keyframesApplied() const { return keyframesApplied_; }
+    // Size of the server's screen, from the last frame.
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+private:
+    bool applyFrame(std::string_view payload);
+
+    ICursesScreen &screen_;
+    std::string buffer_;
+    bool greeted_ = false;
+    bool failed_ = false;
+    std::vector<ScreenRun> runs_;
+    int rows_ = 0;
+    int cols_ = 0;
+    size_t framesApplied_ = 0;
+    size_t keyframesApplied_ = 0;
+};
@@ -0,0 +1,573 @@
+#include "qml_render_compiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "qml_atoms.h"
+#include "qml_color_pairs.h"
+#include "qml_text_width.h"
+#include "qml_text_wrap.h"
+
+namespace {
+
+// An int in the generated code: a constant plus, unless term is empty, a
+// C++ expression only known at run time.
+struct Value {
+    int constant = 0;
+    std::string term;
+
+    bool isConstant() const { return term.empty(); }
+    std::string code() const {
+        if (term.empty()) {
+            return std::to_string(constant);
+        }
+        if (constant == 0) {
+            return term;
+        }
+        return term + (constant > 0 ? " + " : " - ") + std::to_string(constant > 0 ? constant : -constant);
+    }
+    // A single name or number.
+    bool isSimple() const { return term.empty() || (constant == 0 && term.find(' ') == std::string::npos); }
+    // For use as an operand.
+    std::string operand() const { return isSimple() ? code() : "(" + code() + ")"; }
+};
+
+Value operator+(Value a, const Value &b) {
+    a.constant += b.constant;
+    if (a.term.empty()) {
+        a.term = b.term;
+    } else if (!b.term.empty()) {
+        a.term += " + " + b.term;
+    }
+    return a;
+}
+
+std::string quoted(std::string_view text) {
+    std::string out = "\"";
+    for (const char c : text) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (byte < 0x20 || byte >= 0x7f || c == '?') {
+            // Octal escapes stop after three digits, so the next character
+            // cannot run into them; '?' so no trigraph forms.
+            char escape[5];
+            std::snprintf(escape, sizeof(escape), "\\%03o", byte);
+            out += escape;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// Joins (name, line) pairs, leaving out the named lines that no line
+// kept reads; a line with no name is always kept.
+std::string withoutUnused(const std::vector<std::pair<std::string, std::string>> &lines) {
+    std::set<std::string> read;
+    std::vector<bool> kept(lines.size());
+    for (size_t i = lines.size(); i-- > 0;) {
+        kept[i] = lines[i].first.empty() || read.count(lines[i].first) > 0;
+        if (!kept[i]) {
+            continue;
+        }
+        const std::string &line = lines[i].second;
+        for (size_t pos = 0; pos < line.size();) {
+            if (!std::isalpha(static_cast<unsigned char>(line[pos])) && line[pos] != '_') {
+                ++pos;
+                continue;
+            }
+            size_t end = pos;
+            while (end < line.size() && (std::isalnum(static_cast<unsigned char>(line[end])) || line[end] == '_')) {
+                ++end;
+            }
+            read.insert(line.substr(pos, end - pos));
+            pos = end;
+        }
+    }
+    std::string out;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (kept[i]) {
+            out += lines[i].second;
+        }
+    }
+    return out;
+}
+
+// A leaf's text: a literal, or a binding resolved each frame.
+struct Text {
+    bool binding = false;
+    std::string literal;
+    int width = 0;
+    size_t slot = 0;
+
+    bool empty() const { return !binding && literal.empty(); }
+};
+
+enum class Kind { Leaf, Column, Row, Grid };
+
+struct Box {
+    Kind kind = Kind::Leaf;
+    int spacing = 0;
+    int columns = 1;
+    std::vector<Box> children;
+    int height = 1;
+    Value width;
+    std::vector<Value> tracks;  // a Grid's column widths
+    // Leaves only.
+    Text text;
+    bool framed = false;
+    bool drawn = true;
+    Value padTo;
+    std::string attributes = "0";
+};
+
+class Generator {
+public:
+    Generator(const std::string &name, const std::string &sourcePath) : name_(name), sourcePath_(sourcePath) {}
+
+    std::string source(const QmlDocument &document);
+
+private:
+    [[noreturn]] void unsupported(const QmlNode &node, const std::string &why) const;
+    Text slot(const QmlNode &node, QmlAtom key, std::string_view defaultValue = "");
+    Text literal(std::string_view text) const { return Text{false, std::string(text), QmlTextWidth::of(text)}; }
+    Value widthOf(const Text &text) const;
+    std::string textCode(const Text &text);
+    std::string style(const QmlNode &node);
+
+    bool compileNode(const QmlNode &node, Box &box);
+    void compileLeaf(const QmlNode &node, Box &box);
+    void measure(Box &box);
+    void arrange(const Box &box, const Value &x, const Value &y);
+    void draw(const Box &box, const Value &x, const Value &y);
+
+    Value local(const char *prefix, const std::string &expression);
+    Value maxOf(const std::vector<Value> &values);
+    Value centred(const Value &x, const Value &outer, const Value &inner);
+
+    const std::string &name_;
+    const std::string &sourcePath_;
+    std::vector<std::string> bindings_;  // by slot
+    std::vector<std::pair<std::string, std::string>> constants_;
+    std::vector<std::pair<std::string, std::string>> statics_;
+    // Statements in order; a local's has its name. Locals nothing reads
+    // are left out.
+    std::vector<std::pair<std::string, std::string>> body_;
+    std::map<std::string, std::string> locals_;  // name by expression
+    bool focused_ = false;
+};
+
+void Generator::unsupported(const QmlNode &node, const std::string &why) const {
+    throw std::runtime_error(sourcePath_ + ": " + node.type + (node.id.empty() ? "" : " " + node.id) + ": " + why);
+}
+
+Text Generator::slot(const QmlNode &node, QmlAtom key, std::string_view defaultValue) {
+    const QmlProperty *prop = node.findProperty(key);
+    if (!prop) {
+        return literal(defaultValue);
+    }
+    if (prop->typed.kind != QmlValueKind::Binding) {
+        return literal(prop->value);
+    }
+    Text text{true, prop->value, QmlTextWidth::of(prop->value)};
+    text.slot = static_cast<size_t>(std::find(bindings_.begin(), bindings_.end(), prop->value) - bindings_.begin());
+    if (text.slot == bindings_.size()) {
+        bindings_.push_back(prop->value);
+    }
+    return text;
+}
+
+Value Generator::widthOf(const Text &text) const {
+    return text.binding ? Value{0, "binding" + std::to_string(text.slot) + ".width"} : Value{text.width, {}};
+}
+
+std::string Generator::textCode(const Text &text) {
+    if (text.binding) {
+        return "binding" + std::to_string(text.slot);
+    }
+    const std::string name = "text" + std::to_string(constants_.size());
+    constants_.emplace_back(name, "    constexpr QmlCompiledText " + name + "{" + quoted(text.literal) + ", " +
+                                      std::to_string(text.width) + "};\n");
+    return name;
+}
+
+// Colour pairs keep their numbers for good, so each is looked up once.
+std::string Generator::style(const QmlNode &node) {
+    std::string style = node.boolProperty(QmlAtoms::fontBold, false) ? "A_BOLD" : "";
+    const QmlProperty *color = node.findProperty(QmlAtoms::color);
+    if (color && color->typed.kind == QmlValueKind::String) {
+        const std::string name = "style" + std::to_string(statics_.size());
+        statics_.emplace_back(name, "    static const uint32_t " + name + " = " + (style.empty() ? "" : style + " | ") +
+                                        "QmlColorPairs::global().attributes(" +
+                                        std::to_string(QmlColorPairs::parse(color->value)) + ");\n");
+        return name;
+    }
+    return style;
+}
+
+Value Generator::local(const char *prefix, const std::string &expression) {
+    auto it = locals_.find(expression);
+    if (it == locals_.end()) {
+        const std::string name = prefix + std::to_string(locals_.size());
+        it = locals_.emplace(expression, name).first;
+        body_.emplace_back(name, "    const int " + name + " = " + expression + ";\n");
+    }
+    return Value{0, it->second};
+}
+
+Value Generator::maxOf(const std::vector<Value> &values) {
+    std::vector<std::string> terms;
+    bool anyConstant = false;
+    int constant = 0;
+    for (const Value &value : values) {
+        if (value.isConstant()) {
+            constant = anyConstant ? std::max(constant, value.constant) : value.constant;
+            anyConstant = true;
+        } else {
+            terms.push_back(value.code());
+        }
+    }
+    if (terms.empty()) {
+        return Value{constant, {}};
+    }
+    // Widths are never negative, so a zero bound is no bound.
+    if (anyConstant && constant > 0) {
+        terms.insert(terms.begin(), std::to_string(constant));
+    }
+    if (terms.size() == 1) {
+        return Value{0, terms[0]};
+    }
+    std::string expression = terms.size() == 2 ? "std::max(" : "std::max({";
+    for (size_t i = 0; i < terms.size(); ++i) {
+        expression += (i ? ", " : "") + terms[i];
+    }
+    return local("width", expression + (terms.size() == 2 ? ")" : "})"));
+}
+
+// x of something inner wide, centred in outer at x; outer is never the
+// narrower.
+Value Generator::centred(const Value &x, const Value &outer, const Value &inner) {
+    if (outer.isConstant() && inner.isConstant()) {
+        return x + Value{(outer.constant - inner.constant) / 2, {}};
+    }
+    if (outer.code() == inner.code()) {
+        return x;
+    }
+    return local("x", x.operand() + " + (" + outer.code() + " - " + inner.operand() + ") / 2");
+}
+
+// As QmlFrontendCore::compileNode(); false for what the interpreter skips.
+bool Generator::compileNode(const QmlNode &node, Box &box) {
+    if (!node.boolProperty(QmlAtoms::visible, true)) {
+        return false;
+    }
+    switch (node.typeAtom) {
+    case QmlAtoms::Column:
+    case QmlAtoms::Row:
+    case QmlAtoms::Grid:
+        box.kind = node.typeAtom == QmlAtoms::Column ? Kind::Column
+                   : node.typeAtom == QmlAtoms::Row  ? Kind::Row
+                                                     : Kind::Grid;
+        box.spacing = std::max(0, node.intProperty(QmlAtoms::spacing, 1));
+        box.columns = std::max(1, node.intProperty(QmlAtoms::columns, 4));
+        for (const auto &child : node.children) {
+            Box item;
+            if (compileNode(child, item)) {
+                box.children.push_back(std::move(item));
+            }
+        }
+        return true;
+    case QmlAtoms::Text:
+    case QmlAtoms::Label:
+    case QmlAtoms::TextField:
+    case QmlAtoms::Button:
+    case QmlAtoms::BusyIndicator:
+        compileLeaf(node, box);
+        return true;
+    case QmlAtoms::Repeater:
+    case QmlAtoms::ListView:
+    case QmlAtoms::LogView:
+        unsupported(node, "models are only drawn by the interpreter");
+    case QmlAtoms::Timer:
+    case QmlAtoms::NumberAnimation:
+        unsupported(node, "animations need the interpreter's timeline");
+    default:
+        return false;
+    }
+}
+
+void Generator::compileLeaf(const QmlNode &node, Box &box) {
+    constexpr std::string_view kOn = "NumberAnimation on ";
+    for (const auto &child : node.children) {
+        if (std::string_view(child.type).substr(0, kOn.size()) == kOn) {
+            unsupported(node, "animations need the interpreter's timeline");
+        }
+    }
+    std::string attributes = style(node);
+    switch (node.typeAtom) {
+    case QmlAtoms::TextField: {
+        box.framed = true;
+        box.text = slot(node, QmlAtoms::text);
+        const QmlProperty *placeholder = node.findProperty(QmlAtoms::placeholderText);
+        if (box.text.empty()) {
+            box.text = slot(node, QmlAtoms::placeholderText);
+            if (box.text.empty()) {
+                box.text = literal(" ");
+            }
+            box.padTo = widthOf(box.text);
+        } else if (placeholder && placeholder->typed.kind != QmlValueKind::Binding) {
+            // A field is as wide as its placeholder.
+            box.padTo = maxOf({Value{QmlTextWidth::of(placeholder->value), {}}, widthOf(box.text)});
+        } else {
+            box.padTo = widthOf(box.text);
+        }
+        break;
+    }
+    case QmlAtoms::Button:
+        box.framed = true;
+        box.text = slot(node, QmlAtoms::text, "Button");
+        box.padTo = widthOf(box.text);
+        break;
+    case QmlAtoms::BusyIndicator:
+        box.text = literal("|");
+        box.drawn = node.boolProperty(QmlAtoms::running, true);
+        break;
+    default: {
+        const QmlProperty *wrapMode = node.findProperty(QmlAtoms::wrapMode);
+        if (wrapMode && wrapMode->typed.kind == QmlValueKind::Enum &&
+            QmlTextWrap::modeFor(wrapMode->value) != QmlTextWrap::Mode::NoWrap) {
+            unsupported(node, "wrapped text is only laid out by the interpreter");
+        }
+        box.text = slot(node, QmlAtoms::text);
+        break;
+    }
+    }
+    box.drawn = box.drawn && !box.text.empty();
+    // Only the first field or button with focus: true has it.
+    if (box.framed && !focused_ && node.boolProperty(QmlAtoms::focus, false)) {
+        focused_ = true;
+        attributes = attributes.empty() ? "A_REVERSE" : "A_REVERSE | " + attributes;
+    }
+    box.attributes = attributes.empty() ? "0" : attributes;
+}
+
+// Widths bottom-up, as QmlLayout::measure(); heights are all constants.
+void Generator::measure(Box &box) {
+    if (box.kind == Kind::Leaf) {
+        box.width = box.framed ? box.padTo + Value{4, {}} : widthOf(box.text);
+        return;
+    }
+    std::vector<Value> widths;
+    for (Box &child : box.children) {
+        measure(child);
+        widths.push_back(child.width);
+    }
+    const int count = static_cast<int>(box.children.size());
+    const int gaps = box.spacing * std::max(0, count - 1);
+    box.height = 0;
+    switch (box.kind) {
+    case Kind::Column:
+        box.width = maxOf(widths);
+        for (const Box &child : box.children) {
+            box.height += child.height;
+        }
+        box.height += gaps;
+        break;
+    case Kind::Row:
+        box.width = Value{gaps, {}};
+        for (const Box &child : box.children) {
+            box.width = box.width + child.width;
+            box.height = std::max(box.height, child.height);
+        }
+        if (!box.width.isConstant()) {
+            box.width = local("width", box.width.code());
+        }
+        break;
+    case Kind::Grid: {
+        const int columns = std::min(box.columns, count);
+        const int rows = columns ? (count + columns - 1) / columns : 0;
+        box.width = Value{box.spacing * std::max(0, columns - 1), {}};
+        for (int column = 0; column < columns; ++column) {
+            std::vector<Value> cells;
+            for (int cell = column; cell < count; cell += box.columns) {
+                cells.push_back(widths[static_cast<size_t>(cell)]);
+            }
+            box.tracks.push_back(maxOf(cells));
+            box.width = box.width + box.tracks.back();
+        }
+        for (int row = 0; row < rows; ++row) {
+            int height = 0;
+            for (int cell = row * box.columns; cell < std::min(count, (row + 1) * box.columns); ++cell) {
+                height = std::max(height, box.children[static_cast<size_t>(cell)].height);
+            }
+            box.height += height;
+        }
+        box.height += box.spacing * std::max(0, rows - 1);
+        if (!box.width.isConstant()) {
+            box.width = local("width", box.width.code());
+        }
+        break;
+    }
+    case Kind::Leaf:
+        break;
+    }
+}
+
+// Positions top-down, as QmlLayout::arrange(); leaves are drawn in the
+// interpreter's order.
+void Generator::arrange(const Box &box, const Value &x, const Value &y) {
+    if (box.kind == Kind::Leaf) {
+        draw(box, x, y);
+        return;
+    }
+    std::vector<Value> xs;
+    std::vector<int> tops;
+    const size_t columns = std::max<size_t>(1, box.tracks.size());
+    Value cursor = x;
+    int top = 0;
+    int rowHeight = 0;
+    for (size_t i = 0; i < box.children.size(); ++i) {
+        const Box &child = box.children[i];
+        switch (box.kind) {
+        case Kind::Column:
+            xs.push_back(centred(x, box.width, child.width));
+            tops.push_back(top);
+            top += child.height + box.spacing;
+            break;
+        case Kind::Row:
+            xs.push_back(cursor.isSimple() ? cursor : local("x", cursor.code()));
+            tops.push_back(0);
+            cursor = xs.back() + child.width + Value{box.spacing, {}};
+            break;
+        case Kind::Grid: {
+            const size_t column = i % columns;
+            if (column == 0) {
+                cursor = x;
+                if (i > 0) {
+                    top += rowHeight + box.spacing;
+                }
+                rowHeight = 0;
+            }
+            xs.push_back(cursor.isSimple() ? cursor : local("x", cursor.code()));
+            tops.push_back(top);
+            rowHeight = std::max(rowHeight, child.height);
+            cursor = xs.back() + box.tracks[column] + Value{box.spacing, {}};
+            break;
+        }
+        case Kind::Leaf:
+            break;
+        }
+    }
+    for (size_t i = 0; i < box.children.size(); ++i) {
+        arrange(box.children[i], xs[i], y + Value{tops[i], {}});
+    }
+}
+
+void Generator::draw(const Box &box, const Value &x, const Value &y) {
+    if (!box.drawn) {
+        return;
+    }
+    const std::string text = textCode(box.text);
+    if (box.framed) {
+        body_.emplace_back(std::string(), "    frame.putFramed(" + y.code() + ", " + x.code() + ", " + text + ", " +
+                                              box.padTo.code() + ", " + box.attributes + ");\n");
+    } else {
+        body_.emplace_back(std::string(), "    frame.put(" + y.code() + ", " + x.code() + ", " + text + ".text, " +
+                                              box.attributes + ");\n");
+    }
+}
+
+// As QmlFrontendCore::compilePlan() and replayPlan().
+std::string Generator::source(const QmlDocument &document) {
+    const QmlNode *window = document.firstRootOfType(QmlAtoms::ApplicationWindow);
+    if (!window) {
+        throw std::runtime_error(sourcePath_ + ": no ApplicationWindow to compile");
+    }
+    const Text title = slot(*window, QmlAtoms::title);
+    const int firstRow = title.empty() ? 0 : 2;
+
+    const QmlNode *content = nullptr;
+    for (const auto &child : window->children) {
+        if (child.typeAtom == QmlAtoms::Timer || child.typeAtom == QmlAtoms::NumberAnimation) {
+            unsupported(child, "animations need the interpreter's timeline");
+        }
+        if (child.typeAtom == QmlAtoms::Column || child.typeAtom == QmlAtoms::Row || child.typeAtom == QmlAtoms::Grid ||
+            child.typeAtom == QmlAtoms::Repeater || child.typeAtom == QmlAtoms::ListView) {
+            content = &child;
+            break;
+        }
+    }
+
+    // The top-level Column's children are the items, each centred in the
+    // widest; anything else is one item.
+    Box block;
+    block.kind = Kind::Column;
+    if (content && content->typeAtom == QmlAtoms::Column) {
+        block.spacing = std::max(0, content->intProperty(QmlAtoms::spacing, 1));
+        for (const auto &child : content->children) {
+            Box item;
+            if (compileNode(child, item)) {
+                block.children.push_back(std::move(item));
+            }
+        }
+    } else if (content) {
+        Box item;
+        if (compileNode(*content, item)) {
+            block.children.push_back(std::move(item));
+        }
+    }
+    const bool centered = content && content->findProperty(QmlAtoms::anchorsCenterIn) != nullptr;
+
+    if (!title.empty()) {
+        const std::string text = textCode(title);
+        body_.emplace_back(std::string(), "    frame.put(0, std::max(0, (frame.cols() - " + widthOf(title).operand() +
+                                              ") / 2), " + text + ".text, 0);\n");
+    }
+    if (!block.children.empty()) {
+        measure(block);
+        const Value left = local("left", "std::max(0, (frame.cols() - " + block.width.operand() + ") / 2)");
+        Value top{firstRow, {}};
+        if (centered) {
+            top = local("top", "std::max(0, (frame.rows() - " + std::to_string(firstRow + block.height) + ") / 2)") +
+                  Value{firstRow, {}};
+        }
+        arrange(block, left, top);
+    }
+
+    std::string out = "// Generated by qml2curses from " + sourcePath_ + "; do not edit.\n\n#include \"" + name_ +
+                      "_qml.h\"\n\n#include <algorithm>\n#include <curses.h>\n\n#include \"qml_color_pairs.h\"\n\n";
+    out += "void render" + name_ + "(QmlCompiledFrame &frame, BindingWriter resolve) {\n";
+    std::vector<std::pair<std::string, std::string>> lines = std::move(statics_);
+    lines.insert(lines.end(), constants_.begin(), constants_.end());
+    for (size_t i = 0; i < bindings_.size(); ++i) {
+        // Resolved even if unread, as the interpreter would.
+        const std::string index = std::to_string(i);
+        lines.emplace_back(std::string(), "    const QmlCompiledText binding" + index + " = frame.resolve(" + index +
+                                              ", " + quoted(bindings_[i]) + ", " +
+                                              std::to_string(QmlTextWidth::of(bindings_[i])) + ", resolve);\n");
+    }
+    lines.insert(lines.end(), body_.begin(), body_.end());
+    return out + withoutUnused(lines) + "}\n";
+}
+
+}  // namespace
+
+QmlRenderCompiler::Output QmlRenderCompiler::compile(const QmlDocument &document, const std::string &name,
+                                                     const std::string &sourcePath) {
+    Generator generator(name, sourcePath);
+    Output output;
+    output.source = generator.source(document);
+    output.header = "// Generated by qml2curses from " + sourcePath + "; do not edit.\n\n#pragma once\n\n"
+                    "#include \"qml_compiled_frame.h\"\n\n"
+                    "// Draws the screen as QmlCursesFrontend::render() would; see QmlCompiledFrame::render().\n"
+                    "void render" + name + "(QmlCompiledFrame &frame, BindingWriter resolve);\n";
+    return output;
+}
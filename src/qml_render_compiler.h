@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include "qml_parser.h"
+
+// Compiles a fixed screen into C++: a QmlCompiledRender function that
+// draws what QmlCursesFrontend::render() would, with no plan and no tree
+// walk. The layout is folded into constants wherever it does not depend
+// on a binding's width or the screen size, static text becomes string
+// literals, and each frame only resolves the bindings, measures them and
+// places the leaves. Run by qml2curses; see cmake/QmlCursesCompile.cmake.
+//
+// It accepts what the interpreter draws without models, components or a
+// timeline: Column, Row and Grid; Text, Label, TextField, Button and
+// BusyIndicator; font.bold, color, visible and an initial focus: true.
+// Other types are skipped, as the interpreter skips them. Repeaters, list
+// views, wrapped text and animations throw std::runtime_error, as does a
+// document with no ApplicationWindow.
+class QmlRenderCompiler {
+public:
+    struct Output {
+        std::string header;
+        std::string source;
+    };
+
+    // name is the screen's: the function is render<name>(), declared in
+    // <name>_qml.h. sourcePath only goes into the comments.
+    static Output compile(const QmlDocument &document, const std::string &name, const std::string &sourcePath);
+};
@@ -0,0 +1,212 @@
+#include "qml_screen_trace.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "qml_varint.h"
+
+QmlRecordingScreen::QmlRecordingScreen(ICursesScreen &target, Sink sink)
+    : target_(target), sink_(std::move(sink)), last_(Clock::now()) {
+    buffer_.append(QmlScreenTrace::kMagic);
+    QmlVarint::append(buffer_, static_cast<uint64_t>(std::max(0, target_.rows())));
+    QmlVarint::append(buffer_, static_cast<uint64_t>(std::max(0, target_.cols())));
+}
+
+QmlRecordingScreen::~QmlRecordingScreen() {
+    flush();
+}
+
+void QmlRecordingScreen::beginRecord(QmlScreenTrace::Op op) {
+    const Clock::time_point now = Clock::now();
+    QmlVarint::append(buffer_, static_cast<uint64_t>(
+                                   std::chrono::duration_cast<std::chrono::microseconds>(now - last_).count()));
+    last_ = now;
+    buffer_.push_back(static_cast<char>(op));
+    ++calls_;
+}
+
+void QmlRecordingScreen::appendText(int row, int col, uint32_t attributes, std::string_view text) {
+    // Negative positions are recorded as 0; screens clip them anyway.
+    QmlVarint::append(buffer_, static_cast<uint64_t>(std::max(0, row)));
+    QmlVarint::append(buffer_, static_cast<uint64_t>(std::max(0, col)));
+    QmlVarint::append(buffer_, attributes);
+    QmlVarint::append(buffer_, text.size());
+    buffer_.append(text);
+}
+
+void QmlRecordingScreen::clear() {
+    beginRecord(QmlScreenTrace::kClear);
+    target_.clear();
+}
+
+void QmlRecordingScreen::drawText(int row, int col, const std::string &text) {
+    beginRecord(QmlScreenTrace::kText);
+    appendText(row, col, 0, text);
+    target_.drawText(row, col, text);
+}
+
+void QmlRecordingScreen::drawStyledText(int row, int col, const std::string &text, uint32_t attributes) {
+    beginRecord(QmlScreenTrace::kStyledText);
+    appendText(row, col, attributes, text);
+    target_.drawStyledText(row, col, text, attributes);
+}
+
+void QmlRecordingScreen::drawRuns(const ScreenRun *runs, size_t count) {
+    beginRecord(QmlScreenTrace::kRuns);
+    QmlVarint::append(buffer_, count);
+    for (size_t i = 0; i < count; ++i) {
+        const ScreenRun &run = runs[i];
+        QmlVarint::append(buffer_, static_cast<uint64_t>(std::max(0, run.row)));
+        QmlVarint::append(buffer_, static_cast<uint64_t>(std::max(0, run.col)));
+        QmlVarint::append(buffer_, run.attributes);
+        QmlVarint::append(buffer_, static_cast<uint64_t>(std::max(0, run.width + 1)));
+        QmlVarint::append(buffer_, run.text.size());
+        buffer_.append(run.text);
+    }
+    target_.drawRuns(runs, count);
+}
+
+void QmlRecordingScreen::refresh() {
+    beginRecord(QmlScreenTrace::kRefresh);
+    target_.refresh();
+    flush();
+}
+
+void QmlRecordingScreen::flush() {
+    if (!buffer_.empty() && sink_) {
+        sink_(buffer_);
+    }
+    buffer_.clear();
+}
+
+void QmlScreenReplay::reset() {
+    trace_.clear();
+    calls_.clear();
+    runs_.clear();
+    texts_.clear();
+    rows_ = 0;
+    cols_ = 0;
+    frames_ = 0;
+    duration_ = std::chrono::microseconds(0);
+}
+
+bool QmlScreenReplay::load(std::string_view trace) {
+    reset();
+    if (trace.substr(0, QmlScreenTrace::kMagic.size()) != QmlScreenTrace::kMagic) {
+        return false;
+    }
+    trace_.assign(trace);
+    const std::string_view data = trace_;
+    size_t pos = QmlScreenTrace::kMagic.size();
+    if (!QmlVarint::readInt(data, pos, rows_) || !QmlVarint::readInt(data, pos, cols_)) {
+        reset();
+        return false;
+    }
+
+    // Reads one positioned text: row, col, attributes, the width if
+    // recorded, the length and the bytes.
+    const auto readText = [&](ScreenRun &run, bool withWidth) {
+        uint64_t attributes = 0;
+        uint64_t length = 0;
+        if (!QmlVarint::readInt(data, pos, run.row) || !QmlVarint::readInt(data, pos, run.col) ||
+            QmlVarint::read(data, pos, attributes) != QmlVarint::Status::Ok || attributes > UINT32_MAX) {
+            return false;
+        }
+        if (withWidth && !QmlVarint::readInt(data, pos, run.width)) {
+            return false;
+        }
+        if (QmlVarint::read(data, pos, length) != QmlVarint::Status::Ok || length > data.size() - pos) {
+            return false;
+        }
+        run.attributes = static_cast<uint32_t>(attributes);
+        run.text = data.substr(pos, static_cast<size_t>(length));
+        pos += static_cast<size_t>(length);
+        return true;
+    };
+
+    std::chrono::microseconds at{0};
+    bool ok = true;
+    while (ok && pos < data.size()) {
+        uint64_t delta = 0;
+        if (QmlVarint::read(data, pos, delta) != QmlVarint::Status::Ok || pos >= data.size()) {
+            ok = false;
+            break;
+        }
+        at += std::chrono::microseconds(static_cast<int64_t>(delta));
+        Call call{static_cast<QmlScreenTrace::Op>(data[pos++])};
+        call.at = at;
+        switch (call.op) {
+        case QmlScreenTrace::kClear:
+            break;
+        case QmlScreenTrace::kRefresh:
+            ++frames_;
+            break;
+        case QmlScreenTrace::kText:
+        case QmlScreenTrace::kStyledText: {
+            ScreenRun run;
+            ok = readText(run, false);
+            call.first = static_cast<uint32_t>(runs_.size());
+            call.count = 1;
+            runs_.push_back(run);
+            texts_.emplace_back(run.text);
+            break;
+        }
+        case QmlScreenTrace::kRuns: {
+            uint64_t count = 0;
+            ok = QmlVarint::read(data, pos, count) == QmlVarint::Status::Ok && count <= data.size() - pos;
+            call.first = static_cast<uint32_t>(runs_.size());
+            call.count = static_cast<uint32_t>(count);
+            for (uint64_t i = 0; ok && i < count; ++i) {
+                ScreenRun run;
+                ok = readText(run, true);
+                --run.width;  // recorded as width + 1
+                runs_.push_back(run);
+            }
+            break;
+        }
+        default:
+            ok = false;
+            break;
+        }
+        calls_.push_back(call);
+    }
+    if (!ok) {
+        reset();
+        return false;
+    }
+    duration_ = at;
+    return true;
+}
+
+void QmlScreenReplay::play(ICursesScreen &screen,
+                           const std::function<void(size_t frame, std::chrono::microseconds at)> &onFrame) const {
+    size_t frame = 0;
+    size_t text = 0;
+    for (const Call &call : calls_) {
+        switch (call.op) {
+        case QmlScreenTrace::kClear:
+            screen.clear();
+            break;
+        case QmlScreenTrace::kText: {
+            const ScreenRun &run = runs_[call.first];
+            screen.drawText(run.row, run.col, texts_[text++]);
+            break;
+        }
+        case QmlScreenTrace::kStyledText: {
+            const ScreenRun &run = runs_[call.first];
+            screen.drawStyledText(run.row, run.col, texts_[text++], run.attributes);
+            break;
+        }
+        case QmlScreenTrace::kRuns:
+            screen.drawRuns(runs_.data() + call.first, call.count);
+            break;
+        case QmlScreenTrace::kRefresh:
+            screen.refresh();
+            if (onFrame) {
+                onFrame(frame, call.at);
+            }
+            ++frame;
+            break;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qml_curses_frontend.h"
+
+// Trace format written by QmlRecordingScreen and read by QmlScreenReplay:
+// kMagic, the screen's rows and cols as varints (see qml_varint.h), then
+// one record per screen call:
+//
+//   time     varint  microseconds since the previous record
+//   op       u8      an Op
+//   payload          kText, kStyledText: row, col, attributes, byte
+//                    length (varints), then the UTF-8 text
+//                    kRuns: count, then per run row, col, attributes,
+//                    width + 1, byte length (varints) and the text
+//                    kClear, kRefresh: nothing
+namespace QmlScreenTrace {
+constexpr std::string_view kMagic = "QST1";
+enum Op : uint8_t { kClear = 1, kText = 2, kStyledText = 3, kRuns = 4, kRefresh = 5 };
+}  // namespace QmlScreenTrace
+
+// ICursesScreen decorator that forwards every call to a target screen and
+// records it, with its time, as a screen trace. Records are buffered and
+// handed to the sink once per refresh(), and on destruction.
+class QmlRecordingScreen : public ICursesScreen {
+public:
+    using Sink = std::function<void(std::string_view bytes)>;
+    using Clock = std::chrono::steady_clock;
+
+    QmlRecordingScreen(ICursesScreen &target, Sink sink);
+    ~QmlRecordingScreen() override;
+
+    QmlRecordingScreen(const QmlRecordingScreen &) = delete;
+    QmlRecordingScreen &operator=(const QmlRecordingScreen &) = delete;
+
+    void clear() override;
+    void drawText(int row, int col, const std::string &text) override;
+    void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override;
+    void drawRuns(const ScreenRun *runs, size_t count) override;
+    void refresh() override;
+    int rows() const override { return target_.rows(); }
+    int cols() const override { return target_.cols(); }
+
+    size_t callsRecorded() const { return calls_; }
+
+private:
+    void beginRecord(QmlScreenTrace::Op op);
+    void appendText(int row, int col, uint32_t attributes, std::string_view text);
+    void flush();
+
+    ICursesScreen &target_;
+    Sink sink_;
+    std::string buffer_;
+    Clock::time_point last_;
+    size_t calls_ = 0;
+};
+
+// Reads a screen trace and replays it on any screen, as fast as the screen
+// takes it: for measuring a backend on recorded sessions, or for dumping
+// each frame to compare two versions. The trace is decoded up front, so
+// play() only makes the screen calls and allocates nothing.
+class QmlScreenReplay {
+public:
+    QmlScreenReplay() = default;
+    // The decoded runs view the trace's bytes.
+    QmlScreenReplay(const QmlScreenReplay &) = delete;
+    QmlScreenReplay &operator=(const QmlScreenReplay &) = delete;
+
+    // Returns false, leaving nothing loaded, if the trace is malformed.
+    bool load(std::string_view trace);
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    size_t calls() const { return calls_.size(); }
+    size_t frames() const { return frames_; }
+    // Time between the first and the last recorded call.
+    std::chrono::microseconds duration() const { return duration_; }
+
+    // Makes every recorded call on screen; onFrame, if given, runs after
+    // each refresh() with the frame's index and its time in the trace.
+    void play(ICursesScreen &screen,
+              const std::function<void(size_t frame, std::chrono::microseconds at)> &onFrame = nullptr) const;
+
+private:
+    void reset();
+
+    struct Call {
+        QmlScreenTrace::Op op;
+        uint32_t first = 0;  // into texts_ (kText, kStyledText) or runs_ (kRuns)
+        uint32_t count = 0;
+        std::chrono::microseconds at{0};
+    };
+
+    std::string trace_;  // runs_ view into it
+    std::vector<Call> calls_;
+    std::vector<ScreenRun> runs_;
+    std::vector<std::string> texts_;  // drawText() takes a std::string
+    int rows_ = 0;
+    int cols_ = 0;
+    size_t frames_ = 0;
+    std::chrono::microseconds duration_{0};
+};
@@ -0,0 +1,271 @@
+#include "qml_selector.h"
+
+#include <cctype>
+
+namespace {
+
+bool isSelectorNameStart(char ch) {
+    return std::isalpha(static_cast<unsigned char>(ch)) != 0 || ch == '_';
+}
+
+bool isSelectorNameChar(char ch) {
+    return std::isalnum(static_cast<unsigned char>(ch)) != 0 || ch == '_' || ch == '.';
+}
+
+bool isSelectorSpace(char ch) {
+    return std::isspace(static_cast<unsigned char>(ch)) != 0;
+}
+
+}  // namespace
+
+// Recursive descent over the grammar in the header; any error leaves the
+// selector empty.
+class QmlSelector::Parser {
+public:
+    Parser(std::string_view text, QmlSelector &selector) : text_(text), selector_(selector) {}
+
+    bool parse() {
+        skipSpace();
+        Combinator combinator = Combinator::Descendant;
+        for (;;) {
+            if (!compound(combinator)) {
+                return false;
+            }
+            const bool spaced = skipSpace();
+            if (atEnd()) {
+                return true;
+            }
+            if (text_[pos_] == '>') {
+                ++pos_;
+                skipSpace();
+                combinator = Combinator::Child;
+            } else if (spaced) {
+                combinator = Combinator::Descendant;
+            } else {
+                return false;
+            }
+        }
+    }
+
+private:
+    bool compound(Combinator combinator) {
+        Compound compound;
+        compound.combinator = combinator;
+        compound.firstAttribute = static_cast<uint32_t>(selector_.attributes_.size());
+        const size_t start = pos_;
+        if (!atEnd() && text_[pos_] == '*') {
+            ++pos_;
+        } else if (!atEnd() && isSelectorNameStart(text_[pos_])) {
+            compound.type = QmlAtomTable::global().intern(name());
+        }
+        if (!atEnd() && text_[pos_] == '#') {
+            ++pos_;
+            const std::string_view id = name();
+            if (id.empty()) {
+                return false;
+            }
+            compound.id.assign(id.data(), id.size());
+        }
+        while (!atEnd() && text_[pos_] == '[') {
+            ++pos_;
+            if (!attribute()) {
+                return false;
+            }
+            ++compound.attributeCount;
+        }
+        if (pos_ == start) {
+            return false;
+        }
+        selector_.compounds_.push_back(std::move(compound));
+        return true;
+    }
+
+    // After the '['.
+    bool attribute() {
+        skipSpace();
+        const std::string_view key = name();
+        if (key.empty()) {
+            return false;
+        }
+        Attribute attribute;
+        attribute.key = QmlAtomTable::global().intern(key);
+        skipSpace();
+        if (consume("]")) {
+            selector_.attributes_.push_back(std::move(attribute));
+            return true;
+        }
+        if (consume("=")) {
+            attribute.op = Attribute::Op::Equals;
+        } else if (consume("^=")) {
+            attribute.op = Attribute::Op::Prefix;
+        } else if (consume("*=")) {
+            attribute.op = Attribute::Op::Contains;
+        } else {
+            return false;
+        }
+        skipSpace();
+        if (!value(attribute.value)) {
+            return false;
+        }
+        skipSpace();
+        if (!consume("]")) {
+            return false;
+        }
+        selector_.attributes_.push_back(std::move(attribute));
+        return true;
+    }
+
+    bool value(std::string &out) {
+        if (!atEnd() && (text_[pos_] == '"' || text_[pos_] == '\'')) {
+            const char quote = text_[pos_++];
+            const size_t end = text_.find(quote, pos_);
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            out.assign(text_.data() + pos_, end - pos_);
+            pos_ = end + 1;
+            return true;
+        }
+        const size_t start = pos_;
+        while (!atEnd() && text_[pos_] != ']' && !isSelectorSpace(text_[pos_])) {
+            ++pos_;
+        }
+        out.assign(text_.data() + start, pos_ - start);
+        return pos_ > start;
+    }
+
+    std::string_view name() {
+        const size_t start = pos_;
+        if (!atEnd() && isSelectorNameStart(text_[pos_])) {
+            while (!atEnd() && isSelectorNameChar(text_[pos_])) {
+                ++pos_;
+            }
+        }
+        return text_.substr(start, pos_ - start);
+    }
+
+    bool consume(std::string_view token) {
+        if (text_.substr(pos_, token.size()) != token) {
+            return false;
+        }
+        pos_ += token.size();
+        return true;
+    }
+
+    bool skipSpace() {
+        const size_t start = pos_;
+        while (!atEnd() && isSelectorSpace(text_[pos_])) {
+            ++pos_;
+        }
+        return pos_ > start;
+    }
+
+    bool atEnd() const { return pos_ == text_.size(); }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    QmlSelector &selector_;
+};
+
+QmlSelector QmlSelector::compile(std::string_view text) {
+    QmlSelector selector;
+    if (!Parser(text, selector).parse()) {
+        return QmlSelector();
+    }
+    return selector;
+}
+
+const std::vector<const QmlNode *> &QmlSelector::select(const QmlDocument &document) const {
+    const uint64_t revision = document.revision();
+    if (revision != 0 && revision == cachedRevision_) {
+        return results_;
+    }
+    cachedRevision_ = revision;
+    results_.clear();
+    if (!isValid()) {
+        return results_;
+    }
+
+    // Candidates for the rightmost compound, in document order.
+    const Compound &last = compounds_.back();
+    const auto consider = [&](const QmlNode &node) {
+        if (matchesCompound(node, last) && matchesLeftOf(document, node, compounds_.size() - 1)) {
+            results_.push_back(&node);
+        }
+    };
+    if (!last.id.empty()) {
+        if (const QmlNode *node = document.findById(last.id)) {
+            consider(*node);
+        }
+    } else if (last.type != QmlAtoms::Invalid) {
+        for (const QmlNode *node : document.nodesOfType(last.type)) {
+            consider(*node);
+        }
+    } else {
+        for (const QmlNode &node : document.nodes()) {
+            consider(node);
+        }
+    }
+    return results_;
+}
+
+const QmlNode *QmlSelector::first(const QmlDocument &document) const {
+    const std::vector<const QmlNode *> &results = select(document);
+    return results.empty() ? nullptr : results.front();
+}
+
+bool QmlSelector::matches(const QmlDocument &document, const QmlNode &node) const {
+    return isValid() && matchesCompound(node, compounds_.back()) &&
+           matchesLeftOf(document, node, compounds_.size() - 1);
+}
+
+bool QmlSelector::matchesCompound(const QmlNode &node, const Compound &compound) const {
+    if ((compound.type != QmlAtoms::Invalid && node.typeAtom != compound.type) ||
+        (!compound.id.empty() && node.id != compound.id)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < compound.attributeCount; ++i) {
+        const Attribute &attribute = attributes_[compound.firstAttribute + i];
+        const QmlProperty *property = node.findProperty(attribute.key);
+        if (!property) {
+            return false;
+        }
+        const std::string &value = property->value;
+        switch (attribute.op) {
+        case Attribute::Op::Exists:
+            break;
+        case Attribute::Op::Equals:
+            if (value != attribute.value) {
+                return false;
+            }
+            break;
+        case Attribute::Op::Prefix:
+            if (value.compare(0, attribute.value.size(), attribute.value) != 0) {
+                return false;
+            }
+            break;
+        case Attribute::Op::Contains:
+            if (value.find(attribute.value) == std::string::npos) {
+                return false;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+bool QmlSelector::matchesLeftOf(const QmlDocument &document, const QmlNode &node, size_t index) const {
+    if (index == 0) {
+        return true;
+    }
+    const Compound &left = compounds_[index - 1];
+    for (const QmlNode *ancestor = document.parentOf(node); ancestor; ancestor = document.parentOf(*ancestor)) {
+        if (matchesCompound(*ancestor, left) && matchesLeftOf(document, *ancestor, index - 1)) {
+            return true;
+        }
+        if (compounds_[index].combinator == Combinator::Child) {
+            return false;
+        }
+    }
+    return false;
+}
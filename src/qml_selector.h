@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qml_atoms.h"
+#include "qml_parser.h"
+
+// Compiled query over a QmlDocument, in a small subset of CSS:
+//
+//   selector  := compound (combinator compound)*
+//   combinator:= whitespace        descendant
+//              | '>'               child
+//   compound  := (Type | '*')? ('#' id)? attribute*
+//   attribute := '[' key ']'               the property is set
+//              | '[' key '=' value ']'     equals
+//              | '[' key '^=' value ']'    starts with
+//              | '[' key '*=' value ']'    contains
+//
+// Values are compared with the property's unquoted text and may be quoted
+// themselves. "Column Button[text^=greeter.]" finds every Button under a
+// Column whose text is bound to greeter.
+//
+// Matching starts from the rightmost compound's candidates, taken from the
+// document's id or type index when it names one, and checks the rest
+// right to left through QmlDocument::parentOf(). Results are cached per
+// document revision, so asking an unchanged document again is free. A
+// selector caches for one document at a time and is not thread-safe; use
+// one per thread.
+class QmlSelector {
+public:
+    // Returns an invalid selector, which matches nothing, if text does not
+    // parse.
+    static QmlSelector compile(std::string_view text);
+
+    bool isValid() const { return !compounds_.empty(); }
+
+    // Every matching node in document order. The reference stays valid
+    // until the next call with another document or revision.
+    const std::vector<const QmlNode *> &select(const QmlDocument &document) const;
+    const QmlNode *first(const QmlDocument &document) const;
+    bool matches(const QmlDocument &document, const QmlNode &node) const;
+
+private:
+    enum class Combinator : uint8_t { Descendant, Child };
+
+    struct Attribute {
+        enum class Op : uint8_t { Exists, Equals, Prefix, Contains };
+        QmlAtom key = QmlAtoms::Invalid;
+        Op op = Op::Exists;
+        std::string value;
+    };
+
+    struct Compound {
+        QmlAtom type = QmlAtoms::Invalid;  // Invalid matches any type
+        std::string id;                    // empty matches any id
+        uint32_t firstAttribute = 0;
+        uint32_t attributeCount = 0;
+        Combinator combinator = Combinator::Descendant;  // to the compound before
+    };
+
+    class Parser;
+
+    bool matchesCompound(const QmlNode &node, const Compound &compound) const;
+    // Whether the compounds left of index match around node, which matched
+    // compounds_[index].
+    bool matchesLeftOf(const QmlDocument &document, const QmlNode &node, size_t index) const;
+
+    std::vector<Compound> compounds_;
+    std::vector<Attribute> attributes_;
+
+    mutable uint64_t cachedRevision_ = 0;
+    mutable std::vector<const QmlNode *> results_;
+};
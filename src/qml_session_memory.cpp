@@ -0,0 +1,74 @@
+#include "qml_session_memory.h"
+
+#include <algorithm>
+#include <string>
+
+#include "qml_metrics.h"
+
+void QmlSessionMemory::add(uint64_t session, Bytes own, Bytes shared, Evict evict) {
+    accounts_.push_back(Account{session, std::move(own), std::move(shared), std::move(evict)});
+}
+
+void QmlSessionMemory::remove(uint64_t session) {
+    accounts_.erase(std::remove_if(accounts_.begin(), accounts_.end(),
+                                   [session](const Account &account) { return account.session == session; }),
+                    accounts_.end());
+}
+
+QmlSessionMemory::Usage QmlSessionMemory::usage(uint64_t session) const {
+    for (const Account &account : accounts_) {
+        if (account.session == session) {
+            return Usage{account.own(), account.shared()};
+        }
+    }
+    return Usage{};
+}
+
+size_t QmlSessionMemory::used() const {
+    size_t used = 0;
+    for (const Account &account : accounts_) {
+        used += account.own() + account.shared();
+    }
+    return used;
+}
+
+std::vector<uint64_t> QmlSessionMemory::enforce() {
+    std::vector<uint64_t> over;
+    if (limit_ == 0) {
+        return over;
+    }
+    for (const Account &account : accounts_) {
+        const size_t own = account.own();
+        const size_t shared = account.shared();
+        if (own + shared <= limit_) {
+            continue;
+        }
+        if (shared > 0 && account.evict) {
+            evicted_ += account.evict(std::min(own + shared - limit_, shared));
+        }
+        if (own + account.shared() > limit_) {
+            over.push_back(account.session);
+            ++overLimit_;
+        }
+    }
+    return over;
+}
+
+void QmlSessionMemory::appendMetrics(QmlMetricsText &text) const {
+    using Type = QmlMetricsText::Type;
+    text.family("qml_session_limit_bytes", Type::Gauge, "Memory each session may hold; 0 for no limit.", "bytes");
+    text.gauge(static_cast<double>(limit_));
+    text.family("qml_session_bytes", Type::Gauge,
+                "Memory held for each session: its own, and its share of what sessions share.", "bytes");
+    for (const Account &account : accounts_) {
+        const std::string session = QmlMetricsText::label("session", std::to_string(account.session));
+        text.gauge(static_cast<double>(account.own()), session + "," + QmlMetricsText::label("kind", "own"));
+        text.gauge(static_cast<double>(account.shared()), session + "," + QmlMetricsText::label("kind", "shared"));
+    }
+    text.family("qml_session_evicted_bytes", Type::Counter,
+                "Memory freed by evicting shared caches of sessions over the limit.", "bytes");
+    text.counter(static_cast<double>(evicted_));
+    text.family("qml_session_limit_disconnects", Type::Counter,
+                "Sessions disconnected for holding more than the limit.");
+    text.counter(static_cast<double>(overLimit_));
+}
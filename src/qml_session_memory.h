@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class QmlMetricsText;
+
+// Memory a multi-session server holds on behalf of each of its sessions,
+// and a limit per session, so that one runaway client cannot take the
+// memory every other session needs. A session is charged the bytes it
+// holds alone (its damage buffer, its terminal and the output queued for
+// it) plus its share of what it shares with other sessions, such as a
+// view's screen and binding cache split evenly between the sessions
+// showing it. Each is reported by a function, so the accounts are always
+// those of the moment.
+//
+// enforce() checks every session against the limit. One over it first has
+// its shared caches evicted, by as much as it is over; if its own bytes
+// alone keep it over, it is returned for the server to disconnect. Not
+// thread-safe: a server keeps one on the thread that owns its sessions.
+// A limit of 0 means none.
+class QmlSessionMemory {
+public:
+    using Bytes = std::function<size_t()>;
+    // Frees at least bytes of the session's share if it can; returns the
+    // share freed.
+    using Evict = std::function<size_t(size_t bytes)>;
+
+    struct Usage {
+        size_t own = 0;
+        size_t shared = 0;
+
+        size_t total() const { return own + shared; }
+    };
+
+    explicit QmlSessionMemory(size_t limit = 0) : limit_(limit) {}
+
+    // Opens an account for session, an id the server never reuses.
+    void add(uint64_t session, Bytes own, Bytes shared, Evict evict);
+    void remove(uint64_t session);
+    size_t sessionCount() const { return accounts_.size(); }
+
+    size_t limit() const { return limit_; }
+    // Takes effect at the next enforce().
+    void setLimit(size_t limit) { limit_ = limit; }
+
+    Usage usage(uint64_t session) const;
+    // Every session's, summed.
+    size_t used() const;
+
+    // The sessions still over the limit once their shared caches have been
+    // evicted, in the order they were added.
+    std::vector<uint64_t> enforce();
+
+    // qml_session_bytes per session and kind (own or shared), the limit,
+    // and the bytes evicted and sessions disconnected for it.
+    void appendMetrics(QmlMetricsText &text) const;
+
+private:
+    struct Account {
+        uint64_t session;
+        Bytes own;
+        Bytes shared;
+        Evict evict;
+    };
+
+    std::vector<Account> accounts_;
+    size_t limit_;
+    uint64_t evicted_ = 0;  // bytes, over the ledger's life
+    uint64_t overLimit_ = 0;  // sessions enforce() gave up on
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded single-producer, single-consumer queue. One thread pushes and
+// one thread pops, neither ever locks or waits: each side owns one index
+// and only reads the other's. Elements are moved in and out of a fixed
+// ring, so values that own buffers can be passed back and forth through a
+// second queue and reused.
+template <typename T>
+class QmlSpscQueue {
+public:
+    // The capacity is rounded up to a power of two.
+    explicit QmlSpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+    QmlSpscQueue(const QmlSpscQueue &) = delete;
+    QmlSpscQueue &operator=(const QmlSpscQueue &) = delete;
+
+    size_t capacity() const { return slots_.size(); }
+
+    // Producer only. Returns false, leaving value alone, if the queue is
+    // full.
+    bool tryPush(T &&value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty.
+    bool tryPop(T &value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Exact from either side when the other is idle; a snapshot otherwise.
+    bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};  // next to pop
+    alignas(64) std::atomic<size_t> tail_{0};  // next to push
+};
@@ -0,0 +1,431 @@
+#include "qml_structural_scanner.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define QML_SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QML_SCAN_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define QML_SCAN_NEON 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr size_t kBlock = 64;
+constexpr size_t kWindow = 16 * 1024;
+
+// Characters the lexer has to see: structure, string delimiters, escapes,
+// comment delimiters, brackets and line ends.
+constexpr char kClassified[] = {'{', '}', ':', ';', '"', '\'', '`', '\\', '/', '(', ')', '[', ']', '\n'};
+
+// Lexer input classes of the classified bytes.
+enum CharClass : uint8_t { Structural, Quote, Backslash, Slash, Open, Close, Newline, kClassCount };
+
+constexpr CharClass classOf(char ch) {
+    switch (ch) {
+    case '"':
+    case '\'':
+    case '`':
+        return Quote;
+    case '\\':
+        return Backslash;
+    case '/':
+        return Slash;
+    case '(':
+    case '[':
+        return Open;
+    case ')':
+    case ']':
+        return Close;
+    case '\n':
+        return Newline;
+    default:
+        return Structural;
+    }
+}
+
+// What a classified byte does in each lexer state.
+enum Action : uint8_t {
+    Ignore,
+    Emit,          // a structural character, unless inside brackets
+    OpenString,
+    CloseString,   // if it matches the opening quote
+    Escape,
+    OpenComment,   // "//" or "/*", or a regex literal where an operand goes; otherwise division
+    CloseComment,  // the '/' of "*/"
+    CloseRegex,    // unless inside a character class
+    RegexClass,    // '[' or ']' of a character class
+    OpenBracket,
+    CloseBracket,
+    EndLine,
+    EndStringLine, // unterminated, except in a template string
+    EndCommentLine,
+};
+
+constexpr Action kActions[5][kClassCount] = {
+    // Structural, Quote, Backslash, Slash, Open, Close, Newline
+    {Emit, OpenString, Ignore, OpenComment, OpenBracket, CloseBracket, EndLine},  // Code
+    {Ignore, CloseString, Escape, Ignore, Ignore, Ignore, EndStringLine},         // String
+    {Ignore, Ignore, Ignore, Ignore, Ignore, Ignore, EndCommentLine},             // LineComment
+    {Ignore, Ignore, Ignore, CloseComment, Ignore, Ignore, Ignore},               // BlockComment
+    {Ignore, Ignore, Escape, CloseRegex, RegexClass, RegexClass, EndStringLine},  // Regex
+};
+
+// Continuation lines joined because of open brackets or an operator at
+// the break stop here, so a stray '(' cannot swallow the rest of a file.
+constexpr size_t kMaxJoinedLines = 256;
+
+bool isBlank(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+bool isWordChar(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' || ch == '$';
+}
+
+// Keywords an operand follows, so a '/' after them opens a regex literal.
+bool precedesOperand(std::string_view word) {
+    for (std::string_view keyword : {"return", "typeof", "instanceof", "in", "of", "new", "delete", "void", "throw",
+                                     "case", "do", "else", "yield", "await"}) {
+        if (word == keyword) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int countTrailingZeros(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+#if defined(QML_SCAN_AVX2)
+
+uint64_t classify(const char *p) {
+    uint64_t mask = 0;
+    for (int half = 0; half < 2; ++half) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + half * 32));
+        __m256i hits = _mm256_setzero_si256();
+        for (const char ch : kClassified) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(ch)));
+        }
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hits))) << (half * 32);
+    }
+    return mask;
+}
+
+#elif defined(QML_SCAN_SSE2)
+
+uint64_t classify(const char *p) {
+    uint64_t mask = 0;
+    for (int quarter = 0; quarter < 4; ++quarter) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + quarter * 16));
+        __m128i hits = _mm_setzero_si128();
+        for (const char ch : kClassified) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(ch)));
+        }
+        mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(hits))) << (quarter * 16);
+    }
+    return mask;
+}
+
+#elif defined(QML_SCAN_NEON)
+
+uint64_t classify(const char *p) {
+    // NEON has no movemask; weight each lane by its bit and add across.
+    static const uint8_t kWeights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t weights = vld1q_u8(kWeights);
+    uint64_t mask = 0;
+    for (int quarter = 0; quarter < 4; ++quarter) {
+        const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(p + quarter * 16));
+        uint8x16_t hits = vdupq_n_u8(0);
+        for (const char ch : kClassified) {
+            hits = vorrq_u8(hits, vceqq_u8(bytes, vdupq_n_u8(static_cast<uint8_t>(ch))));
+        }
+        const uint8x16_t bits = vandq_u8(hits, weights);
+        const uint64_t low = vaddv_u8(vget_low_u8(bits));
+        const uint64_t high = vaddv_u8(vget_high_u8(bits));
+        mask |= (low | (high << 8)) << (quarter * 16);
+    }
+    return mask;
+}
+
+#else
+
+uint64_t classify(const char *p) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < kBlock; ++i) {
+        const char ch = p[i];
+        if (std::find(std::begin(kClassified), std::end(kClassified), ch) != std::end(kClassified)) {
+            mask |= uint64_t(1) << i;
+        }
+    }
+    return mask;
+}
+
+#endif
+
+}  // namespace
+
+const char *QmlStructuralScanner::kernelName() {
+#if defined(QML_SCAN_AVX2)
+    return "avx2";
+#elif defined(QML_SCAN_SSE2)
+    return "sse2";
+#elif defined(QML_SCAN_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+QmlStructuralScanner::QmlStructuralScanner(std::string_view source, size_t from, std::vector<size_t> *window)
+    : source_(source), scanPos_(from), lineStart_(from), positions_(window ? *window : ownPositions_) {
+    positions_.clear();
+    positions_.reserve(kWindow / 8);
+}
+
+void QmlStructuralScanner::visitBlock(uint64_t mask, size_t base) {
+    while (mask != 0) {
+        const size_t pos = base + static_cast<size_t>(countTrailingZeros(mask));
+        mask &= mask - 1;
+        if (pos == escapedPos_) {
+            continue;
+        }
+
+        const char ch = source_[pos];
+        switch (kActions[static_cast<int>(state_)][classOf(ch)]) {
+        case Ignore:
+            break;
+        case Emit:
+            if (brackets_ == 0) {
+                positions_.push_back(pos);
+            }
+            break;
+        case OpenString:
+            state_ = Lex::String;
+            quote_ = ch;
+            break;
+        case CloseString:
+            if (ch == quote_) {
+                state_ = Lex::Code;
+            }
+            break;
+        case Escape:
+            escapedPos_ = pos + 1;
+            break;
+        case OpenComment: {
+            const char next = pos + 1 < source_.size() ? source_[pos + 1] : '\0';
+            if (next == '/' || next == '*') {
+                state_ = next == '/' ? Lex::LineComment : Lex::BlockComment;
+                commentStart_ = pos;
+                positions_.push_back(pos);
+            } else if (opensRegex(pos)) {
+                // Lexed like a quoted string, which also ends with the line.
+                state_ = Lex::Regex;
+                quote_ = '/';
+                regexClass_ = false;
+            }
+            break;
+        }
+        case CloseComment:
+            // Not the '*' that opened it, as in "/*/".
+            if (pos >= commentStart_ + 3 && source_[pos - 1] == '*') {
+                state_ = Lex::Code;
+                positions_.push_back(pos - 1);
+            }
+            break;
+        case CloseRegex:
+            if (!regexClass_) {
+                state_ = Lex::Code;
+                regexEnd_ = pos;
+            }
+            break;
+        case RegexClass:
+            if (ch == '[' || ch == ']') {
+                regexClass_ = ch == '[';
+            }
+            break;
+        case OpenBracket:
+            ++brackets_;
+            break;
+        case CloseBracket:
+            brackets_ -= brackets_ > 0;
+            break;
+        case EndLine:
+            endLine(pos, pos);
+            break;
+        case EndStringLine:
+            // Quoted strings end with the line, so an unterminated one
+            // cannot swallow the rest of the file; template strings go on.
+            if (quote_ != '`') {
+                state_ = Lex::Code;
+                endLine(pos, pos);
+            }
+            break;
+        case EndCommentLine:
+            state_ = Lex::Code;
+            endLine(pos, commentStart_);
+            break;
+        }
+    }
+}
+
+// A physical line ends at pos, its code at codeEnd. It also ends the
+// logical line unless the statement plainly goes on.
+void QmlStructuralScanner::endLine(size_t pos, size_t codeEnd) {
+    if ((brackets_ > 0 || endsWithOperator(codeEnd) || nextStartsWithOperator(pos + 1)) &&
+        joinedLines_ < kMaxJoinedLines) {
+        ++joinedLines_;
+        return;
+    }
+    brackets_ = 0;
+    joinedLines_ = 0;
+    positions_.push_back(pos);
+}
+
+bool QmlStructuralScanner::endsWithOperator(size_t codeEnd) const {
+    // A blank line stops at the previous line's '\n'.
+    while (codeEnd > 0 && isBlank(source_[codeEnd - 1])) {
+        --codeEnd;
+    }
+    if (codeEnd == 0) {
+        return false;
+    }
+    const char last = source_[codeEnd - 1];
+    if (last == '/' && ((codeEnd >= 2 && source_[codeEnd - 2] == '*') || codeEnd - 1 == regexEnd_)) {
+        return false;  // the end of a block comment or regex literal
+    }
+    return last != '\0' && std::strchr("+-*/%&|^=<>!?:,.", last) != nullptr;
+}
+
+// Whether the physical line from from on starts with a binary or ternary
+// operator, as a wrapped "? a : b" or "&& b" does; lines holding only a
+// line comment are looked past. "++", "--" and '!' start statements of
+// their own, "//" and "/*" comments.
+bool QmlStructuralScanner::nextStartsWithOperator(size_t from) const {
+    char first = '\0';
+    char second = '\0';
+    for (;;) {
+        while (from < source_.size() && isBlank(source_[from])) {
+            ++from;
+        }
+        if (from >= source_.size()) {
+            return false;
+        }
+        first = source_[from];
+        second = from + 1 < source_.size() ? source_[from + 1] : '\0';
+        if (first != '/' || second != '/') {
+            break;
+        }
+        from = source_.find('\n', from);
+        if (from == std::string_view::npos) {
+            return false;
+        }
+        ++from;
+    }
+    switch (first) {
+    case '+':
+    case '-':
+        return second != first;
+    case '/':
+        return second != '/' && second != '*';
+    case '!':
+        return second == '=';
+    default:
+        return first != '\0' && std::strchr("?:.&|^*%=<>,", first) != nullptr;
+    }
+}
+
+// Whether the '/' at pos starts a regex literal rather than dividing: it
+// does where an operand is due, after an operator, an opening bracket or
+// one of a few keywords. After a ')', ']', '}' or an operand it divides.
+bool QmlStructuralScanner::opensRegex(size_t pos) const {
+    size_t end = pos;
+    while (end > 0 && (isBlank(source_[end - 1]) || source_[end - 1] == '\n')) {
+        --end;
+    }
+    if (end == 0) {
+        return true;
+    }
+    const char last = source_[end - 1];
+    if (isWordChar(last)) {
+        size_t begin = end - 1;
+        while (begin > 0 && isWordChar(source_[begin - 1])) {
+            --begin;
+        }
+        return (begin == 0 || source_[begin - 1] != '.') && precedesOperand(source_.substr(begin, end - begin));
+    }
+    if ((last == '+' || last == '-') && end >= 2 && source_[end - 2] == last) {
+        return false;  // a postfix "++" or "--"
+    }
+    return std::strchr("(,=:[!&|?{;+-*%<>~^", last) != nullptr;
+}
+
+void QmlStructuralScanner::scanWindow() {
+    const size_t end = std::min(source_.size(), scanPos_ + kWindow);
+    while (scanPos_ + kBlock <= end) {
+        visitBlock(classify(source_.data() + scanPos_), scanPos_);
+        scanPos_ += kBlock;
+    }
+    if (scanPos_ < end && end == source_.size()) {
+        // Pad the final partial block; spaces are never classified.
+        char tail[kBlock];
+        std::memset(tail, ' ', sizeof(tail));
+        std::memcpy(tail, source_.data() + scanPos_, end - scanPos_);
+        visitBlock(classify(tail), scanPos_);
+        scanPos_ = end;
+    }
+}
+
+bool QmlStructuralScanner::nextLine(QmlScannedLine &line) {
+    if (lineStart_ >= source_.size()) {
+        return false;
+    }
+
+    for (;;) {
+        for (size_t i = cursor_; i < positions_.size(); ++i) {
+            const size_t pos = positions_[i];
+            if (source_[pos] != '\n') {
+                continue;
+            }
+            line.text = source_.substr(lineStart_, pos - lineStart_);
+            line.offset = lineStart_;
+            line.structuralsBegin = positions_.data() + cursor_;
+            line.structuralsEnd = positions_.data() + i;
+            cursor_ = i + 1;
+            lineStart_ = pos + 1;
+            return true;
+        }
+
+        if (scanPos_ >= source_.size()) {
+            break;
+        }
+        // Drop the lines already handed out before scanning further.
+        positions_.erase(positions_.begin(), positions_.begin() + static_cast<std::ptrdiff_t>(cursor_));
+        cursor_ = 0;
+        scanWindow();
+    }
+
+    line.text = source_.substr(lineStart_);
+    line.offset = lineStart_;
+    line.structuralsBegin = positions_.data() + cursor_;
+    line.structuralsEnd = positions_.data() + positions_.size();
+    cursor_ = positions_.size();
+    lineStart_ = source_.size();
+    return true;
+}
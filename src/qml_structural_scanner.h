@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// One logical source line plus the structural characters ('{', '}', ':',
+// ';') that appear in it as code, as absolute source offsets. A logical
+// line runs over several physical ones while a '(' or '[' is open, a
+// block comment or template string is, or a line ends in a binary or
+// ternary operator or ',' or the next begins with one. Comments are marked among the structurals: '/' where
+// one opens ("//" or "/*") and '*' where a block comment's "*/" closes.
+struct QmlScannedLine {
+    std::string_view text;  // without the trailing newline
+    size_t offset = 0;      // of text within the source
+    const size_t *structuralsBegin = nullptr;
+    const size_t *structuralsEnd = nullptr;
+};
+
+// Stage-one scanner in the style of simdjson: 64-byte blocks are classified
+// with SSE2/AVX2 (x86) or NEON (ARM), falling back to a scalar loop, and
+// only the set bits of the resulting masks are visited. A table-driven
+// state machine runs over those bytes alone to lex strings in all three
+// quotes with their escapes, regex literals, line and block comments and
+// bracket nesting, in a single pass over the buffer. The source is scanned in
+// fixed-size windows, so memory use does not grow with input size.
+class QmlStructuralScanner {
+public:
+    // Lines start at offset from, which must begin a line; offsets are
+    // still relative to source. Given a window buffer, the scanner works
+    // in it instead of one of its own, so a caller that scans again keeps
+    // its capacity.
+    explicit QmlStructuralScanner(std::string_view source, size_t from = 0, std::vector<size_t> *window = nullptr);
+    QmlStructuralScanner(const QmlStructuralScanner &) = delete;
+    QmlStructuralScanner &operator=(const QmlStructuralScanner &) = delete;
+
+    // Follows std::getline semantics. The structural range stays valid
+    // until the next call.
+    bool nextLine(QmlScannedLine &line);
+
+    // Name of the classification kernel compiled into this build.
+    static const char *kernelName();
+
+private:
+    enum class Lex : uint8_t { Code, String, LineComment, BlockComment, Regex };
+
+    void scanWindow();
+    void visitBlock(uint64_t mask, size_t base);
+    void endLine(size_t pos, size_t codeEnd);
+    bool endsWithOperator(size_t codeEnd) const;
+    bool nextStartsWithOperator(size_t from) const;
+    bool opensRegex(size_t pos) const;
+
+    std::string_view source_;
+    size_t scanPos_ = 0;
+    size_t lineStart_ = 0;
+    size_t cursor_ = 0;
+    std::vector<size_t> ownPositions_;
+    std::vector<size_t> &positions_;  // structurals and line ends, in order
+    Lex state_ = Lex::Code;
+    char quote_ = 0;
+    size_t escapedPos_ = SIZE_MAX;
+    size_t commentStart_ = 0;     // of the open comment
+    size_t regexEnd_ = SIZE_MAX;  // the closing '/' of the last regex literal
+    bool regexClass_ = false;     // inside a regex literal's "[...]"
+    size_t brackets_ = 0;         // '(' and '[' still open
+    size_t joinedLines_ = 0;      // physical lines joined to the current one
+};
@@ -0,0 +1,81 @@
+#include "qml_telnet.h"
+
+namespace {
+
+constexpr uint8_t kIac = 255;
+constexpr uint8_t kDont = 254;
+constexpr uint8_t kWill = 251;
+constexpr uint8_t kSb = 250;
+constexpr uint8_t kSe = 240;
+constexpr uint8_t kNaws = 31;
+// Ignore anything longer; a NAWS report is four bytes.
+constexpr size_t kMaxSubnegotiation = 64;
+
+}  // namespace
+
+std::string_view QmlTelnetParser::negotiation() {
+    // IAC WILL ECHO, IAC WILL SUPPRESS-GO-AHEAD, IAC DO NAWS.
+    static constexpr char kBytes[] = "\xff\xfb\x01\xff\xfb\x03\xff\xfd\x1f";
+    return std::string_view(kBytes, sizeof kBytes - 1);
+}
+
+bool QmlTelnetParser::feed(std::string_view input, std::string &data) {
+    bool resized = false;
+    for (const char ch : input) {
+        const auto byte = static_cast<uint8_t>(ch);
+        switch (state_) {
+        case State::Data:
+            if (byte == kIac) {
+                state_ = State::Command;
+            } else {
+                data.push_back(ch);
+            }
+            break;
+        case State::Command:
+            if (byte == kIac) {
+                data.push_back(ch);  // escaped 0xFF
+                state_ = State::Data;
+            } else if (byte == kSb) {
+                subnegotiation_.clear();
+                state_ = State::Subnegotiation;
+            } else if (byte >= kWill && byte <= kDont) {
+                state_ = State::Option;
+            } else {
+                state_ = State::Data;  // a two-byte command such as NOP
+            }
+            break;
+        case State::Option:
+            // Replies to our negotiation; nothing to do.
+            state_ = State::Data;
+            break;
+        case State::Subnegotiation:
+            if (byte == kIac) {
+                state_ = State::SubnegotiationCommand;
+            } else if (subnegotiation_.size() <= kMaxSubnegotiation) {
+                subnegotiation_.push_back(ch);
+            }
+            break;
+        case State::SubnegotiationCommand:
+            if (byte == kIac) {
+                if (subnegotiation_.size() <= kMaxSubnegotiation) {
+                    subnegotiation_.push_back(ch);
+                }
+                state_ = State::Subnegotiation;
+                break;
+            }
+            if (byte == kSe && subnegotiation_.size() == 5 && static_cast<uint8_t>(subnegotiation_[0]) == kNaws) {
+                const auto at = [this](size_t i) { return static_cast<uint8_t>(subnegotiation_[i]); };
+                const int cols = at(1) << 8 | at(2);
+                const int rows = at(3) << 8 | at(4);
+                if (rows > 0 && cols > 0 && (rows != rows_ || cols != cols_)) {
+                    rows_ = rows;
+                    cols_ = cols;
+                    resized = true;
+                }
+            }
+            state_ = State::Data;
+            break;
+        }
+    }
+    return resized;
+}
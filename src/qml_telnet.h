@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// The client side of a telnet session, as far as a full-screen UI needs
+// it: strips IAC commands out of the input and tracks the terminal size
+// the client reports through NAWS (RFC 1073). Works incrementally, so
+// commands may arrive split across reads.
+class QmlTelnetParser {
+public:
+    // Sent when a session opens: the server echoes and suppresses go-ahead
+    // (character mode) and asks for window size reports.
+    static std::string_view negotiation();
+
+    // Appends the plain data bytes in input to data. Returns whether the
+    // client reported a new window size.
+    bool feed(std::string_view input, std::string &data);
+
+    // Last reported size; 0 until the client sends one.
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+private:
+    enum class State : uint8_t { Data, Command, Option, Subnegotiation, SubnegotiationCommand };
+
+    State state_ = State::Data;
+    std::string subnegotiation_;  // option byte, then its data
+    int rows_ = 0;
+    int cols_ = 0;
+};
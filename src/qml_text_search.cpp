@@ -0,0 +1,119 @@
+#include "qml_text_search.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+char fold(char ch) {
+    return ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+void foldInto(std::string_view text, std::string &folded) {
+    folded.resize(text.size());
+    std::transform(text.begin(), text.end(), folded.begin(), fold);
+}
+
+}  // namespace
+
+void QmlTextSearch::resize(size_t lines) {
+    lines_.resize(lines);
+    changed_.erase(std::remove_if(changed_.begin(), changed_.end(), [lines](size_t line) { return line >= lines; }),
+                   changed_.end());
+    full_ = true;
+}
+
+bool QmlTextSearch::setLine(size_t index, std::string_view text) {
+    Line &line = lines_[index];
+    if (line.folded.size() == text.size() &&
+        std::equal(text.begin(), text.end(), line.folded.begin(), [](char a, char b) { return fold(a) == b; })) {
+        return false;
+    }
+    foldInto(text, line.folded);
+    line.signature = signatureOf(line.folded);
+    if (!line.changed) {
+        line.changed = true;
+        changed_.push_back(index);
+    }
+    ++linesIndexed_;
+    return true;
+}
+
+// One bit per byte pair, hashed to 256 bits. A line of 200 characters sets
+// about half of them, so a three-character query still skips most lines
+// that do not hold it.
+QmlTextSearch::Signature QmlTextSearch::signatureOf(std::string_view folded) {
+    Signature signature{};
+    for (size_t i = 1; i < folded.size(); ++i) {
+        const uint32_t pair = static_cast<uint8_t>(folded[i - 1]) << 8 | static_cast<uint8_t>(folded[i]);
+        const uint32_t bit = (pair * 0x9E3779B1u) >> 24;
+        signature[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+    return signature;
+}
+
+const std::vector<QmlTextSearch::Match> &QmlTextSearch::find(std::string_view query) {
+    foldInto(query, folded_);
+    const bool narrow = !full_ && !query_.empty() && folded_.size() >= query_.size() &&
+                        folded_.compare(0, query_.size(), query_) == 0;
+    candidates_.clear();
+    if (narrow) {
+        std::sort(changed_.begin(), changed_.end());
+        std::set_union(matched_.begin(), matched_.end(), changed_.begin(), changed_.end(),
+                       std::back_inserter(candidates_));
+    } else {
+        candidates_.resize(lines_.size());
+        for (size_t line = 0; line < lines_.size(); ++line) {
+            candidates_[line] = line;
+        }
+    }
+    for (const size_t line : changed_) {
+        lines_[line].changed = false;
+    }
+    changed_.clear();
+    full_ = false;
+    query_ = folded_;
+
+    matches_.clear();
+    matched_.clear();
+    linesScanned_ = 0;
+    if (query_.empty()) {
+        return matches_;
+    }
+    const Signature signature = signatureOf(query_);
+    for (const size_t line : candidates_) {
+        scan(line, signature);
+    }
+    return matches_;
+}
+
+void QmlTextSearch::scan(size_t index, const Signature &signature) {
+    const Line &line = lines_[index];
+    for (size_t word = 0; word < signature.size(); ++word) {
+        if ((line.signature[word] & signature[word]) != signature[word]) {
+            return;
+        }
+    }
+    ++linesScanned_;
+    const char *const begin = line.folded.data();
+    const char *const end = begin + line.folded.size();
+    const size_t length = query_.size();
+    const size_t matchesBefore = matches_.size();
+    const char *at = begin;
+    while (static_cast<size_t>(end - at) >= length) {
+        at = static_cast<const char *>(std::memchr(at, query_[0], static_cast<size_t>(end - at) - length + 1));
+        if (!at) {
+            break;
+        }
+        if (std::memcmp(at + 1, query_.data() + 1, length - 1) == 0) {
+            matches_.push_back(Match{index, static_cast<size_t>(at - begin), length});
+            at += length;
+        } else {
+            ++at;
+        }
+    }
+    if (matches_.size() != matchesBefore) {
+        matched_.push_back(index);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Incremental find over lines of rendered text, ignoring ASCII case. Each
+// line keeps a case-folded copy and a 256-bit signature of the byte pairs
+// in it: a query is only scanned for, with memchr() on its first byte, in
+// lines whose signature holds all of its pairs. setLine() re-indexes a
+// line only when its text changed, and a query that extends the previous
+// one is looked for only in the lines that matched that one and the lines
+// changed since, so typing one more character narrows the last result
+// rather than scanning everything again.
+class QmlTextSearch {
+public:
+    // Offsets and lengths are bytes in the line's text.
+    struct Match {
+        size_t line;
+        size_t offset;
+        size_t length;
+    };
+
+    // New lines are empty. The next find() scans every line.
+    void resize(size_t lines);
+    size_t lineCount() const { return lines_.size(); }
+    // Returns whether the line changed.
+    bool setLine(size_t line, std::string_view text);
+
+    // Every occurrence of query, without overlaps, by line and offset; an
+    // empty query matches nothing.
+    const std::vector<Match> &find(std::string_view query);
+    const std::vector<Match> &matches() const { return matches_; }
+
+    // Counters for tests: lines whose text the last find() scanned, and
+    // lines re-indexed since construction.
+    size_t linesScanned() const { return linesScanned_; }
+    size_t linesIndexed() const { return linesIndexed_; }
+
+private:
+    using Signature = std::array<uint64_t, 4>;
+
+    struct Line {
+        std::string folded;
+        Signature signature{};
+        bool changed = false;  // since the last find()
+    };
+
+    static Signature signatureOf(std::string_view folded);
+    void scan(size_t line, const Signature &signature);
+
+    std::vector<Line> lines_;
+    std::vector<size_t> changed_;
+    std::string query_;  // folded, as last found
+    bool full_ = true;   // the next find() scans every line
+    std::vector<Match> matches_;
+    // Per-find scratch, kept to reuse its capacity.
+    std::string folded_;
+    std::vector<size_t> candidates_;
+    std::vector<size_t> matched_;  // lines with matches, ascending
+    size_t linesScanned_ = 0;
+    size_t linesIndexed_ = 0;
+};
@@ -0,0 +1,222 @@
+#include "qml_text_width.h"
+
+#include <algorithm>
+#include <iterator>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define QML_WIDTH_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QML_WIDTH_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define QML_WIDTH_NEON 1
+#endif
+
+namespace {
+
+struct Range {
+    uint32_t first;
+    uint32_t last;
+};
+
+// Zero-width code points: combining marks of the common scripts, format
+// characters and variation selectors. Not the full Unicode table, but it
+// covers accents, Hebrew/Arabic points, Indic vowel signs and emoji
+// modifiers that labels are likely to contain.
+constexpr Range kZeroWidth[] = {
+    {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2},
+    {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0610, 0x061A}, {0x064B, 0x065F}, {0x0670, 0x0670},
+    {0x06D6, 0x06DC}, {0x06DF, 0x06E4}, {0x06E7, 0x06E8}, {0x06EA, 0x06ED}, {0x0900, 0x0902},
+    {0x093A, 0x093A}, {0x093C, 0x093C}, {0x0941, 0x0948}, {0x094D, 0x094D}, {0x0951, 0x0957},
+    {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF},
+    {0x200B, 0x200F}, {0x202A, 0x202E}, {0x2060, 0x2064}, {0x20D0, 0x20FF}, {0xFE00, 0xFE0F},
+    {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0x1F3FB, 0x1F3FF}, {0xE0000, 0xE0FFF},
+};
+
+// East Asian Wide and Fullwidth blocks, and the emoji blocks terminals
+// draw two cells wide.
+constexpr Range kWide[] = {
+    {0x1100, 0x115F},   {0x231A, 0x231B},   {0x2329, 0x232A},   {0x23E9, 0x23EC},   {0x23F0, 0x23F0},
+    {0x23F3, 0x23F3},   {0x25FD, 0x25FE},   {0x2614, 0x2615},   {0x2648, 0x2653},   {0x267F, 0x267F},
+    {0x2693, 0x2693},   {0x26A1, 0x26A1},   {0x26AA, 0x26AB},   {0x26BD, 0x26BE},   {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE},   {0x26D4, 0x26D4},   {0x26EA, 0x26EA},   {0x26F2, 0x26F3},   {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA},   {0x26FD, 0x26FD},   {0x2705, 0x2705},   {0x270A, 0x270B},   {0x2728, 0x2728},
+    {0x274C, 0x274C},   {0x274E, 0x274E},   {0x2753, 0x2755},   {0x2757, 0x2757},   {0x2795, 0x2797},
+    {0x27B0, 0x27B0},   {0x27BF, 0x27BF},   {0x2B1B, 0x2B1C},   {0x2B50, 0x2B50},   {0x2B55, 0x2B55},
+    {0x2E80, 0x303E},   {0x3041, 0x33FF},   {0x3400, 0x4DBF},   {0x4E00, 0x9FFF},   {0xA000, 0xA4CF},
+    {0xA960, 0xA97F},   {0xAC00, 0xD7A3},   {0xF900, 0xFAFF},   {0xFE10, 0xFE19},   {0xFE30, 0xFE6F},
+    {0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},   {0x16FE0, 0x16FE4}, {0x17000, 0x18AFF}, {0x1B000, 0x1B2FF},
+    {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251},
+    {0x1F300, 0x1F3FA}, {0x1F400, 0x1F64F}, {0x1F680, 0x1F6FF}, {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F9FF},
+    {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+};
+
+template <size_t N>
+bool inRanges(const Range (&ranges)[N], uint32_t codePoint) {
+    const Range *it = std::upper_bound(std::begin(ranges), std::end(ranges), codePoint,
+                                       [](uint32_t value, const Range &range) { return value < range.first; });
+    return it != std::begin(ranges) && codePoint <= std::prev(it)->last;
+}
+
+bool isPrintableAscii(unsigned char ch) {
+    return ch >= 0x20 && ch < 0x7F;
+}
+
+// Length of the printable-ASCII prefix of [p, end), found a vector at a
+// time; the tail shorter than one vector is left to the caller.
+size_t asciiPrefix(const char *p, const char *end) {
+    const char *start = p;
+#if defined(QML_WIDTH_AVX2)
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    for (; end - p >= 32; p += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        // Signed compare: bytes >= 0x80 are negative, so "< 0x20" catches
+        // them along with the controls.
+        const __m256i bad = _mm256_or_si256(_mm256_cmpgt_epi8(space, bytes), _mm256_cmpeq_epi8(bytes, del));
+        if (_mm256_movemask_epi8(bad) != 0) {
+            break;
+        }
+    }
+#elif defined(QML_WIDTH_SSE2)
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    for (; end - p >= 16; p += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i bad = _mm_or_si128(_mm_cmplt_epi8(bytes, space), _mm_cmpeq_epi8(bytes, del));
+        if (_mm_movemask_epi8(bad) != 0) {
+            break;
+        }
+    }
+#elif defined(QML_WIDTH_NEON)
+    for (; end - p >= 16; p += 16) {
+        const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+        const uint8x16_t bad = vorrq_u8(vcltq_u8(bytes, vdupq_n_u8(0x20)), vcgeq_u8(bytes, vdupq_n_u8(0x7F)));
+        if (vmaxvq_u8(bad) != 0) {
+            break;
+        }
+    }
+#else
+    (void)end;
+#endif
+    return static_cast<size_t>(p - start);
+}
+
+}  // namespace
+
+const char *QmlTextWidth::kernelName() {
+#if defined(QML_WIDTH_AVX2)
+    return "avx2";
+#elif defined(QML_WIDTH_SSE2)
+    return "sse2";
+#elif defined(QML_WIDTH_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+int QmlTextWidth::codePoint(uint32_t codePoint) {
+    if (codePoint < 0x7F) {
+        return codePoint >= 0x20 ? 1 : 0;
+    }
+    if (codePoint < 0xA0 || inRanges(kZeroWidth, codePoint)) {
+        return 0;
+    }
+    return inRanges(kWide, codePoint) ? 2 : 1;
+}
+
+size_t QmlTextWidth::decode(std::string_view utf8, size_t pos, uint32_t &codePoint) {
+    const auto byte = [&](size_t i) { return static_cast<unsigned char>(utf8[i]); };
+    const unsigned char lead = byte(pos);
+    codePoint = 0xFFFD;
+    size_t length = 0;
+    uint32_t value = 0;
+    uint32_t minimum = 0;
+    if (lead < 0x80) {
+        codePoint = lead;
+        return 1;
+    } else if ((lead & 0xE0) == 0xC0) {
+        length = 2;
+        value = lead & 0x1F;
+        minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        length = 3;
+        value = lead & 0x0F;
+        minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        length = 4;
+        value = lead & 0x07;
+        minimum = 0x10000;
+    } else {
+        return 1;
+    }
+    if (pos + length > utf8.size()) {
+        return 1;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        if ((byte(pos + i) & 0xC0) != 0x80) {
+            return 1;
+        }
+        value = (value << 6) | (byte(pos + i) & 0x3F);
+    }
+    // Overlong forms, surrogates and values past U+10FFFF are malformed.
+    if (value < minimum || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF)) {
+        return 1;
+    }
+    codePoint = value;
+    return length;
+}
+
+int QmlTextWidth::of(std::string_view utf8) {
+    const char *data = utf8.data();
+    const char *end = data + utf8.size();
+    size_t pos = 0;
+    int width = 0;
+    while (pos < utf8.size()) {
+        const size_t ascii = asciiPrefix(data + pos, end);
+        width += static_cast<int>(ascii);
+        pos += ascii;
+        if (pos == utf8.size()) {
+            break;
+        }
+        // One byte or code point that stopped the vector loop, or the
+        // tail shorter than a vector.
+        const unsigned char ch = static_cast<unsigned char>(data[pos]);
+        if (ch < 0x80) {
+            width += isPrintableAscii(ch) ? 1 : 0;
+            ++pos;
+            continue;
+        }
+        uint32_t codePoint = 0;
+        pos += decode(utf8, pos, codePoint);
+        width += QmlTextWidth::codePoint(codePoint);
+    }
+    return width;
+}
+
+size_t QmlTextWidth::fit(std::string_view utf8, int columns, int &width) {
+    const char *data = utf8.data();
+    const char *end = data + utf8.size();
+    size_t pos = 0;
+    width = 0;
+    while (pos < utf8.size()) {
+        const size_t ascii = std::min(asciiPrefix(data + pos, end), static_cast<size_t>(std::max(0, columns - width)));
+        width += static_cast<int>(ascii);
+        pos += ascii;
+        if (pos == utf8.size()) {
+            break;
+        }
+        uint32_t codePoint = 0;
+        const size_t length = decode(utf8, pos, codePoint);
+        const int cells = QmlTextWidth::codePoint(codePoint);
+        if (width + cells > columns) {
+            break;
+        }
+        width += cells;
+        pos += length;
+    }
+    return pos;
+}
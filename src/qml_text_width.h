@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Terminal display width of UTF-8 text, in cells. East Asian Wide and
+// Fullwidth characters (and emoji) take two cells; combining marks,
+// zero-width spaces, joiners, variation selectors and control characters
+// take none; everything else takes one. Malformed bytes count as one cell
+// each. Runs of printable ASCII, the common case, are checked 32 bytes at
+// a time with AVX2, 16 with SSE2 or NEON, and counted without decoding.
+class QmlTextWidth {
+public:
+    static int of(std::string_view utf8);
+    static int codePoint(uint32_t codePoint);
+    // Length in bytes of the longest prefix of utf8 that fits in columns
+    // cells, including the zero-width characters that follow it; its
+    // width is stored in width.
+    static size_t fit(std::string_view utf8, int columns, int &width);
+
+    // Decodes the code point starting at utf8[pos] and returns its length
+    // in bytes; malformed input decodes as U+FFFD with length 1.
+    static size_t decode(std::string_view utf8, size_t pos, uint32_t &codePoint);
+
+    // Name of the ASCII kernel compiled into this build.
+    static const char *kernelName();
+};
@@ -0,0 +1,156 @@
+#include "qml_text_wrap.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "qml_text_width.h"
+
+namespace {
+
+bool isWrapSpace(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+}  // namespace
+
+QmlTextWrap::Mode QmlTextWrap::modeFor(std::string_view value) {
+    // Label and the other Text-derived types share Text's enum.
+    const size_t dot = value.rfind('.');
+    if (dot != std::string_view::npos) {
+        value.remove_prefix(dot + 1);
+    }
+    if (value == "Wrap" || value == "WrapAtWordBoundaryOrAnywhere") {
+        return Mode::Wrap;
+    }
+    if (value == "WordWrap") {
+        return Mode::WordWrap;
+    }
+    if (value == "WrapAnywhere") {
+        return Mode::WrapAnywhere;
+    }
+    return Mode::NoWrap;
+}
+
+const std::vector<QmlTextWrap::Line> &QmlTextWrap::wrap(std::string_view text, int width) {
+    if (!scanned_ || text != text_) {
+        text_.assign(text.data(), text.size());
+        scan();
+        scanned_ = true;
+        width_ = -1;
+    }
+    if (mode_ == Mode::NoWrap) {
+        width = std::numeric_limits<int>::max();
+    }
+    width = std::max(1, width);
+    if (width != width_) {
+        fit(width);
+        width_ = width;
+    }
+    return lines_;
+}
+
+// Splits the text into words once; fit() only walks the segments.
+void QmlTextWrap::scan() {
+    ++scans_;
+    segments_.clear();
+    const std::string_view text(text_);
+    const size_t size = text.size();
+    bool paragraphStart = true;
+    size_t pos = 0;
+    while (pos < size) {
+        Segment segment;
+        segment.begin = static_cast<uint32_t>(pos);
+        if (paragraphStart) {
+            while (pos < size && isWrapSpace(text[pos])) {
+                ++pos;
+            }
+        }
+        while (pos < size && !isWrapSpace(text[pos]) && text[pos] != '\n') {
+            ++pos;
+        }
+        segment.wordEnd = static_cast<uint32_t>(pos);
+        const size_t spaceBegin = pos;
+        while (pos < size && isWrapSpace(text[pos])) {
+            ++pos;
+        }
+        segment.wordWidth = QmlTextWidth::of(text.substr(segment.begin, segment.wordEnd - segment.begin));
+        segment.spaceWidth = QmlTextWidth::of(text.substr(spaceBegin, pos - spaceBegin));
+        paragraphStart = pos < size && text[pos] == '\n';
+        if (paragraphStart) {
+            segment.hardBreak = true;
+            ++pos;
+        }
+        segment.end = static_cast<uint32_t>(pos);
+        segments_.push_back(segment);
+    }
+}
+
+void QmlTextWrap::fit(int width) {
+    ++fits_;
+    lines_.clear();
+    widest_ = 0;
+    const std::string_view text(text_);
+    const bool splitWords = mode_ == Mode::Wrap || mode_ == Mode::WrapAnywhere;
+
+    // The line being built is [lineStart, contentEnd), lineWidth cells
+    // wide; the spaces after it are only counted once a word follows.
+    size_t lineStart = 0;
+    size_t contentEnd = 0;
+    int lineWidth = 0;
+    int pendingSpace = 0;
+    bool hasContent = false;
+    const auto endLine = [&](size_t next) {
+        lines_.push_back(Line{text.substr(lineStart, contentEnd - lineStart), lineWidth});
+        widest_ = std::max(widest_, lineWidth);
+        lineStart = next;
+        contentEnd = next;
+        lineWidth = 0;
+        pendingSpace = 0;
+        hasContent = false;
+    };
+
+    for (const Segment &segment : segments_) {
+        int used = hasContent ? lineWidth + pendingSpace : 0;
+        if (hasContent && used + segment.wordWidth > width && mode_ != Mode::WrapAnywhere) {
+            endLine(segment.begin);
+            used = 0;
+        }
+        if (!splitWords || used + segment.wordWidth <= width) {
+            if (segment.wordEnd > segment.begin) {
+                contentEnd = segment.wordEnd;
+                lineWidth = used + segment.wordWidth;
+                hasContent = true;
+            }
+        } else {
+            // The word does not fit: fill the line and carry the rest.
+            size_t pos = segment.begin;
+            while (pos < segment.wordEnd) {
+                int cells = 0;
+                size_t length = QmlTextWidth::fit(text.substr(pos, segment.wordEnd - pos), width - used, cells);
+                if (length == 0 && !hasContent) {
+                    // A character wider than the whole line gets one anyway.
+                    uint32_t codePoint = 0;
+                    length = QmlTextWidth::decode(text, pos, codePoint);
+                    cells = QmlTextWidth::codePoint(codePoint);
+                }
+                if (length > 0) {
+                    pos += length;
+                    contentEnd = pos;
+                    lineWidth = used + cells;
+                    hasContent = true;
+                }
+                if (pos < segment.wordEnd) {
+                    endLine(pos);
+                    used = 0;
+                }
+            }
+        }
+        pendingSpace = segment.spaceWidth;
+        if (segment.hardBreak) {
+            endLine(segment.end);
+        }
+    }
+    if (hasContent) {
+        endLine(text.size());
+    }
+}
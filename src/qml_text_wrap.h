@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Line breaking for a Text or Label with a wrapMode. Newlines always end
+// a line; otherwise lines break after spaces, and in the modes that allow
+// it, inside words that do not fit. Widths are display widths in cells
+// (see QmlTextWidth).
+//
+// Each instance caches one string. Its break opportunities are found once
+// per distinct text, and its lines once per text and width: wrapping the
+// same text again returns the cached lines, and a new width re-fits the
+// cached words without rescanning the text.
+class QmlTextWrap {
+public:
+    // Qt's Text.WrapMode values. Wrap breaks at word boundaries when it
+    // can and anywhere when a word is wider than the line.
+    enum class Mode : uint8_t { NoWrap, WordWrap, WrapAnywhere, Wrap };
+
+    struct Line {
+        std::string_view text;  // trailing spaces dropped
+        int width = 0;
+    };
+
+    explicit QmlTextWrap(Mode mode = Mode::Wrap) : mode_(mode) {}
+
+    // Mode for a wrapMode value as written, e.g. "Text.Wrap"; NoWrap for
+    // values it does not know.
+    static Mode modeFor(std::string_view value);
+
+    Mode mode() const { return mode_; }
+
+    // Lines of text broken to fit width cells. Lines view the cached copy
+    // of text, so they stay valid until text changes.
+    const std::vector<Line> &wrap(std::string_view text, int width);
+    // The lines from the last wrap() and the width of the widest.
+    const std::vector<Line> &lines() const { return lines_; }
+    int widest() const { return widest_; }
+
+    // Counters for tests: text scans and line fits since construction.
+    size_t scans() const { return scans_; }
+    size_t fits() const { return fits_; }
+
+private:
+    // A word, the spaces after it and whether a newline ends its line.
+    // A paragraph's leading spaces belong to its first word.
+    struct Segment {
+        uint32_t begin = 0;
+        uint32_t wordEnd = 0;
+        uint32_t end = 0;  // past the spaces and the newline
+        int wordWidth = 0;
+        int spaceWidth = 0;
+        bool hardBreak = false;
+    };
+
+    void scan();
+    void fit(int width);
+
+    Mode mode_;
+    std::string text_;
+    bool scanned_ = false;
+    int width_ = -1;
+    int widest_ = 0;
+    std::vector<Segment> segments_;
+    std::vector<Line> lines_;
+    size_t scans_ = 0;
+    size_t fits_ = 0;
+};
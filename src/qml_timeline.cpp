@@ -0,0 +1,174 @@
+#include "qml_timeline.h"
+
+#include <algorithm>
+#include <utility>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+QmlTimeline::QmlTimeline(Wake wake, microseconds step)
+    : wake_(std::move(wake)), step_(std::max(step, microseconds(1))) {}
+
+QmlTimeline::Track QmlTimeline::addAnimation(double from, double to, microseconds duration, int loops,
+                                             Update update) {
+    Entry entry;
+    entry.update = std::move(update);
+    entry.from = from;
+    entry.to = to;
+    entry.value = from;
+    entry.period = stepsFor(duration);
+    entry.loops = loops;
+    return add(std::move(entry));
+}
+
+QmlTimeline::Track QmlTimeline::addTimer(microseconds interval, bool repeat, Triggered triggered) {
+    Entry entry;
+    entry.triggered = std::move(triggered);
+    entry.period = stepsFor(interval);
+    entry.repeat = repeat;
+    return add(std::move(entry));
+}
+
+QmlTimeline::Track QmlTimeline::add(Entry entry) {
+    entry.live = true;
+    if (!free_.empty()) {
+        const Track track = free_.back();
+        free_.pop_back();
+        entries_[track] = std::move(entry);
+        return track;
+    }
+    entries_.push_back(std::move(entry));
+    return static_cast<Track>(entries_.size() - 1);
+}
+
+// Durations round to whole steps; nothing is shorter than one.
+int64_t QmlTimeline::stepsFor(microseconds duration) const {
+    return std::max<int64_t>(1, (duration.count() + step_.count() / 2) / step_.count());
+}
+
+int64_t QmlTimeline::stepAt(Clock::time_point now) const {
+    return now <= origin_ ? 0 : static_cast<int64_t>((now - origin_) / step_);
+}
+
+void QmlTimeline::start(Track track, Clock::time_point now) {
+    if (track >= entries_.size() || !entries_[track].live) {
+        return;
+    }
+    if (running_ == 0) {
+        // Steps count from the first start after an idle stretch.
+        origin_ = now;
+        lastStep_ = 0;
+    }
+    Entry &entry = entries_[track];
+    if (!entry.running) {
+        entry.running = true;
+        ++running_;
+    }
+    entry.startStep = stepAt(now);
+    entry.fired = 0;
+    if (entry.update) {
+        entry.value = entry.from;
+        entry.update(entry.value);
+    }
+    if (!armed_) {
+        arm(now);
+    }
+}
+
+void QmlTimeline::stop(Track track) {
+    if (track < entries_.size() && entries_[track].running) {
+        entries_[track].running = false;
+        --running_;
+    }
+}
+
+void QmlTimeline::remove(Track track) {
+    if (track >= entries_.size() || !entries_[track].live) {
+        return;
+    }
+    stop(track);
+    entries_[track].live = false;
+    if (ticking_) {
+        sweep_ = true;  // its callback may be the one running
+        return;
+    }
+    entries_[track] = Entry{};
+    free_.push_back(track);
+}
+
+bool QmlTimeline::isRunning(Track track) const {
+    return track < entries_.size() && entries_[track].running;
+}
+
+void QmlTimeline::arm(Clock::time_point now) {
+    armed_ = true;
+    const Clock::time_point due = origin_ + step_ * (stepAt(now) + 1);
+    wake_(duration_cast<microseconds>(due - now));
+}
+
+bool QmlTimeline::tick(Clock::time_point now) {
+    armed_ = false;
+    if (running_ == 0) {
+        return false;  // idle: no further wake-ups
+    }
+    const int64_t step = stepAt(now);
+    if (step > lastStep_) {
+        stepsTaken_ += static_cast<uint64_t>(step - lastStep_);
+        lastStep_ = step;
+    }
+    bool changed = false;
+    ticking_ = true;
+    for (Entry &entry : entries_) {
+        if (entry.running) {
+            changed |= advance(entry, step);
+        }
+    }
+    ticking_ = false;
+    if (sweep_) {
+        sweep_ = false;
+        for (Track track = 0; track < entries_.size(); ++track) {
+            if (!entries_[track].live && (entries_[track].update || entries_[track].triggered)) {
+                entries_[track] = Entry{};
+                free_.push_back(track);
+            }
+        }
+    }
+    if (running_ > 0) {
+        arm(now);
+    }
+    return changed;
+}
+
+// Missed steps are skipped rather than replayed: an animation jumps to
+// where it should be, and a timer that missed several intervals fires once.
+bool QmlTimeline::advance(Entry &entry, int64_t step) {
+    const int64_t elapsed = std::max<int64_t>(0, step - entry.startStep);
+    if (entry.triggered) {
+        const int64_t intervals = elapsed / entry.period;
+        if (intervals <= entry.fired) {
+            return false;
+        }
+        entry.fired = intervals;
+        if (!entry.repeat) {
+            entry.running = false;
+            --running_;
+        }
+        entry.triggered();
+        return true;
+    }
+
+    double value;
+    if (entry.loops != kInfinite && elapsed >= entry.period * std::max(1, entry.loops)) {
+        value = entry.to;
+        entry.running = false;
+        --running_;
+    } else {
+        const double phase = static_cast<double>(elapsed % entry.period) / static_cast<double>(entry.period);
+        value = entry.from + (entry.to - entry.from) * phase;
+    }
+    if (value == entry.value) {
+        return false;
+    }
+    entry.value = value;
+    return entry.update(value);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// One clock for every animation and timer, advanced in fixed steps. Tracks
+// are not timers of their own: each tick() moves the timeline to the last
+// whole step before now and updates every running track from the same step
+// count, so animations that started together stay in phase however late a
+// wake-up runs. Like QmlFrameScheduler it owns no timer; wake(delay) is
+// expected to arm a one-shot timer that calls tick(). It is armed only
+// while a track runs, so a timeline with nothing running costs nothing.
+class QmlTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Wake = std::function<void(std::chrono::microseconds delay)>;
+    // Called with the animated value on each step it changes; returns
+    // whether that changed anything on screen. Callbacks may start, stop
+    // and remove tracks but not add them.
+    using Update = std::function<bool(double value)>;
+    using Triggered = std::function<void()>;
+    using Track = uint32_t;
+
+    static constexpr int kInfinite = -1;  // Animation.Infinite
+    static constexpr Track kNoTrack = UINT32_MAX;
+
+    // 20 Hz by default, enough for cursors, spinners and marquees.
+    explicit QmlTimeline(Wake wake, std::chrono::microseconds step = std::chrono::milliseconds(50));
+
+    std::chrono::microseconds step() const { return step_; }
+
+    // Runs from `from` to `to` over duration, loops times or for ever;
+    // the value holds at `to` once done.
+    Track addAnimation(double from, double to, std::chrono::microseconds duration, int loops, Update update);
+    // Calls triggered every interval, or once unless repeat.
+    Track addTimer(std::chrono::microseconds interval, bool repeat, Triggered triggered);
+    // Stopped tracks keep their callbacks; start() restarts from the top.
+    void start(Track track, Clock::time_point now = Clock::now());
+    void stop(Track track);
+    void remove(Track track);
+    bool isRunning(Track track) const;
+    size_t runningCount() const { return running_; }
+    bool armed() const { return armed_; }
+
+    // Advances to now and re-arms for the next step while anything runs.
+    // Returns whether an update reported a change or a timer fired.
+    bool tick(Clock::time_point now = Clock::now());
+    uint64_t stepsTaken() const { return stepsTaken_; }
+
+private:
+    struct Entry {
+        Update update;  // animations
+        Triggered triggered;  // timers
+        double from = 0;
+        double to = 0;
+        int64_t period = 1;  // in steps: duration or interval
+        int loops = 1;
+        bool repeat = false;
+        bool running = false;
+        bool live = false;
+        int64_t startStep = 0;
+        int64_t fired = 0;  // timer intervals elapsed so far
+        double value = 0;
+    };
+
+    Track add(Entry entry);
+    int64_t stepAt(Clock::time_point now) const;
+    int64_t stepsFor(std::chrono::microseconds duration) const;
+    bool advance(Entry &entry, int64_t step);
+    void arm(Clock::time_point now);
+
+    Wake wake_;
+    std::chrono::microseconds step_;
+    std::vector<Entry> entries_;
+    std::vector<Track> free_;
+    Clock::time_point origin_{};  // step 0; reset when the timeline idles
+    int64_t lastStep_ = 0;
+    size_t running_ = 0;
+    bool armed_ = false;
+    bool ticking_ = false;
+    bool sweep_ = false;  // tracks removed during a tick await reuse
+    uint64_t stepsTaken_ = 0;
+};
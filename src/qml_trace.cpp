@@ -0,0 +1,149 @@
+#include "qml_trace.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char *name;
+    const char *series;  // counters only; null for spans
+    int64_t begin;       // ns since the trace epoch
+    int64_t duration;    // ns, or a counter's value
+};
+
+// One thread's events. Only the owning thread writes; head counts every
+// event ever recorded and is published after the slot is written, so a
+// reader sees complete events up to head.
+struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t id) : id(id), events(QmlTrace::kCapacity) {}
+
+    uint32_t id;
+    std::vector<Event> events;
+    std::atomic<uint64_t> head{0};
+};
+
+// Buffers outlive their threads, so a pool's events can be written out
+// after it has been joined. The mutex is taken once per thread, on its
+// first event, and by readers.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadBuffer &threadBuffer() {
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer == nullptr) {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<uint32_t>(r.buffers.size() + 1)));
+        buffer = r.buffers.back().get();
+    }
+    return *buffer;
+}
+
+void appendEscaped(std::string &out, const char *text) {
+    for (; *text != '\0'; ++text) {
+        const char ch = *text;
+        if (ch == '"' || ch == '\\') {
+            out.push_back('\\');
+            out.push_back(ch);
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof escaped, "\\u%04x", ch);
+            out.append(escaped);
+        } else {
+            out.push_back(ch);
+        }
+    }
+}
+
+// Microseconds with nanosecond precision, as trace_event expects.
+void appendMicros(std::string &out, int64_t nanos) {
+    char number[32];
+    std::snprintf(number, sizeof number, "%lld.%03lld", static_cast<long long>(nanos / 1000),
+                  static_cast<long long>(nanos % 1000));
+    out.append(number);
+}
+
+}  // namespace
+
+std::atomic<bool> QmlTrace::enabled_{false};
+
+namespace {
+
+int64_t sinceEpoch(std::chrono::steady_clock::time_point at) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(at - registry().epoch).count();
+}
+
+void append(const Event &event) {
+    ThreadBuffer &buffer = threadBuffer();
+    const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % QmlTrace::kCapacity] = event;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+}  // namespace
+
+void QmlTrace::record(const char *name, std::chrono::steady_clock::time_point begin,
+                      std::chrono::steady_clock::time_point end) {
+    const int64_t at = sinceEpoch(begin);
+    append(Event{name, nullptr, at, sinceEpoch(end) - at});
+}
+
+void QmlTrace::counter(const char *name, const char *series, std::chrono::steady_clock::time_point at,
+                       int64_t value) {
+    append(Event{name, series, sinceEpoch(at), value});
+}
+
+std::string QmlTrace::chromeJson() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto &buffer : r.buffers) {
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        const uint64_t begin = head > kCapacity ? head - kCapacity : 0;
+        for (uint64_t i = begin; i < head; ++i) {
+            const Event &event = buffer->events[i % kCapacity];
+            out.append(first ? "\n" : ",\n");
+            first = false;
+            out.append("{\"name\":\"");
+            appendEscaped(out, event.name);
+            out.append(event.series ? "\",\"cat\":\"qml\",\"ph\":\"C\",\"pid\":1,\"tid\":"
+                                    : "\",\"cat\":\"qml\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+            out.append(std::to_string(buffer->id));
+            out.append(",\"ts\":");
+            appendMicros(out, event.begin);
+            if (event.series) {
+                out.append(",\"args\":{\"");
+                appendEscaped(out, event.series);
+                out.append("\":");
+                out.append(std::to_string(event.duration));
+                out.append("}}");
+            } else {
+                out.append(",\"dur\":");
+                appendMicros(out, event.duration);
+                out.push_back('}');
+            }
+        }
+    }
+    out.append("\n]}\n");
+    return out;
+}
+
+void QmlTrace::clear() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &buffer : r.buffers) {
+        buffer->head.store(0, std::memory_order_relaxed);
+    }
+}
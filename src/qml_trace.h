@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Lightweight timeline tracing. A QmlTraceSpan on the stack records its
+// name, start and duration when it goes out of scope; the parser, the
+// frontends and their resolver calls are instrumented. Counters record a
+// value over time, such as a running latency percentile. Each thread appends
+// to its own fixed-size ring buffer without locking, keeping the latest
+// kCapacity events, and chromeJson() reads them all as Chrome trace_event
+// JSON, which chrome://tracing and the Perfetto UI both load.
+//
+// Tracing is off until enabled; a span then costs one relaxed atomic load.
+class QmlTrace {
+public:
+    static constexpr size_t kCapacity = 1 << 16;  // events per thread
+
+    static void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Records a finished span; name must outlive the trace (a literal).
+    static void record(const char *name, std::chrono::steady_clock::time_point begin,
+                       std::chrono::steady_clock::time_point end);
+    // Records one sample of a counter track; name and series must outlive
+    // the trace. Series of the same name are drawn on one track.
+    static void counter(const char *name, const char *series, std::chrono::steady_clock::time_point at,
+                        int64_t value);
+
+    // Every buffered event, as a Chrome trace_event JSON object. Events a
+    // thread records while this runs may or may not be included.
+    static std::string chromeJson();
+    // Drops every buffered event; call while no thread is tracing.
+    static void clear();
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+class QmlTraceSpan {
+public:
+    // name must outlive the trace; pass a string literal.
+    explicit QmlTraceSpan(const char *name) : name_(name) {
+        if (QmlTrace::enabled()) {
+            begin_ = std::chrono::steady_clock::now();
+            active_ = true;
+        }
+    }
+    ~QmlTraceSpan() {
+        if (active_) {
+            QmlTrace::record(name_, begin_, std::chrono::steady_clock::now());
+        }
+    }
+
+    QmlTraceSpan(const QmlTraceSpan &) = delete;
+    QmlTraceSpan &operator=(const QmlTraceSpan &) = delete;
+
+private:
+    const char *name_;
+    std::chrono::steady_clock::time_point begin_;
+    bool active_ = false;
+};
@@ -0,0 +1,69 @@
+#include "qml_undo_history.h"
+
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+QmlUndoHistory::QmlUndoHistory(QmlDocument initial, size_t limit) : limit_(limit) {
+    if (!initial.isIndexed()) {
+        initial.reindex();
+    }
+    steps_.push_back(std::move(initial));
+}
+
+void QmlUndoHistory::commit(QmlDocument document) {
+    if (!document.isIndexed()) {
+        document.reindex();
+    }
+    steps_.erase(steps_.begin() + static_cast<std::ptrdiff_t>(position_) + 1, steps_.end());
+    steps_[position_].dropIndex();
+    steps_.push_back(std::move(document));
+    if (limit_ != 0 && steps_.size() > limit_) {
+        steps_.pop_front();
+    }
+    position_ = steps_.size() - 1;
+}
+
+const QmlDocument &QmlUndoHistory::undo() {
+    if (canUndo()) {
+        moveTo(position_ - 1);
+    }
+    return current();
+}
+
+const QmlDocument &QmlUndoHistory::redo() {
+    if (canRedo()) {
+        moveTo(position_ + 1);
+    }
+    return current();
+}
+
+void QmlUndoHistory::moveTo(size_t position) {
+    steps_[position_].dropIndex();
+    position_ = position;
+    steps_[position_].reindex();
+}
+
+size_t QmlUndoHistory::retainedBytes() const {
+    // A list seen before is shared, and so is everything below it.
+    std::unordered_set<const QmlNode *> seen;
+    std::vector<const QmlNodeList *> pending;
+    size_t bytes = 0;
+    for (const QmlDocument &step : steps_) {
+        pending.push_back(&step.roots);
+        while (!pending.empty()) {
+            const QmlNodeList &list = *pending.back();
+            pending.pop_back();
+            if (list.empty() || !seen.insert(list.vector().data()).second) {
+                continue;
+            }
+            bytes += list.capacity() * sizeof(QmlNode);
+            for (const QmlNode &node : list) {
+                bytes += node.properties.capacity() * sizeof(QmlProperty) +
+                         node.scripts.capacity() * sizeof(QmlScriptBlock);
+                pending.push_back(&node.children);
+            }
+        }
+    }
+    return bytes;
+}
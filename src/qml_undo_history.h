@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+
+#include "qml_parser.h"
+
+// Undo and redo over snapshots of one document. QmlDocument copies share
+// every node list until written, so a step made by copying current(),
+// editing the copy and committing it holds only the lists on the paths to
+// its edits: memory per step grows with the edit's depth and the sibling
+// counts along it, not with the document.
+//
+//   QmlDocument next = history.current();
+//   next.roots[0].children[2].setProperty(QmlAtoms::text, "Saved");
+//   next.reindex();
+//   history.commit(std::move(next));
+//
+// Only the current step keeps its indices; the others drop them, since an
+// index covers the whole tree, and get them back when undo() or redo()
+// makes them current. Any step can be rendered or diffed as it is.
+class QmlUndoHistory {
+public:
+    // limit caps the number of steps kept, the current one included; the
+    // oldest are dropped first. 0 keeps every step.
+    explicit QmlUndoHistory(QmlDocument initial = {}, size_t limit = 0);
+
+    const QmlDocument &current() const { return steps_[position_]; }
+    // Makes document the current step and drops the steps that could have
+    // been redone.
+    void commit(QmlDocument document);
+
+    bool canUndo() const { return position_ > 0; }
+    bool canRedo() const { return position_ + 1 < steps_.size(); }
+    // Move one step and return the new current document. Calling either
+    // when there is nothing to move to returns current() unchanged.
+    const QmlDocument &undo();
+    const QmlDocument &redo();
+
+    size_t size() const { return steps_.size(); }
+    size_t position() const { return position_; }
+    const QmlDocument &step(size_t index) const { return steps_[index]; }
+
+    // Bytes of node lists, properties and scripts held by all steps, with
+    // each list shared between steps counted once. Strings are left out.
+    size_t retainedBytes() const;
+
+private:
+    void moveTo(size_t position);
+
+    std::deque<QmlDocument> steps_;
+    size_t position_ = 0;
+    size_t limit_;
+};
@@ -0,0 +1,94 @@
+#include "qml_value.h"
+
+#include <charconv>
+#include <system_error>
+
+namespace {
+
+bool isIdentifierStart(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+}
+
+bool isIdentifierChar(char ch) {
+    return isIdentifierStart(ch) || (ch >= '0' && ch <= '9');
+}
+
+bool isUpper(char ch) {
+    return ch >= 'A' && ch <= 'Z';
+}
+
+// Type.Value, with both the qualifier and the value capitalized. Longer
+// chains such as QtQuick.Controls.Button.Flat are accepted as well.
+bool isEnumReference(std::string_view text) {
+    size_t segments = 0;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('.', start);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        const std::string_view segment = text.substr(start, end - start);
+        if (segment.empty() || !isIdentifierStart(segment.front())) {
+            return false;
+        }
+        for (const char ch : segment) {
+            if (!isIdentifierChar(ch)) {
+                return false;
+            }
+        }
+        if ((segments == 0 || end == text.size()) && !isUpper(segment.front())) {
+            return false;
+        }
+        ++segments;
+        start = end + 1;
+    }
+    return segments >= 2;
+}
+
+template <typename T>
+bool parseWhole(std::string_view text, T &out) {
+    const char *first = text.data();
+    const char *last = first + text.size();
+    const auto result = std::from_chars(first, last, out);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+}  // namespace
+
+QmlValue QmlValue::classify(std::string_view source) {
+    QmlValue value;
+    const bool quoted = source.size() >= 2 && (source.front() == '"' || source.front() == '\'') &&
+                        source.back() == source.front();
+    if (source.empty() || quoted) {
+        return value;
+    }
+
+    if (source == "true" || source == "false") {
+        value.kind = QmlValueKind::Bool;
+        value.intValue = source == "true" ? 1 : 0;
+        value.realValue = static_cast<double>(value.intValue);
+        return value;
+    }
+
+    // from_chars also accepts "inf" and "nan" (optionally signed), which
+    // are not QML literals.
+    const char first = source.front();
+    if (((first >= '0' && first <= '9') || first == '-' || first == '.') &&
+        source.find_first_of("iInN") == std::string_view::npos) {
+        if (parseWhole(source, value.intValue)) {
+            value.kind = QmlValueKind::Int;
+            value.realValue = static_cast<double>(value.intValue);
+            return value;
+        }
+        if (parseWhole(source, value.realValue)) {
+            value.kind = QmlValueKind::Real;
+            value.intValue = 0;
+            return value;
+        }
+        value.intValue = 0;
+        value.realValue = 0.0;
+    }
+
+    value.kind = isEnumReference(source) ? QmlValueKind::Enum : QmlValueKind::Binding;
+    return value;
+}
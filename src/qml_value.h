@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+enum class QmlValueKind : uint8_t {
+    String,   // quoted literal, or empty
+    Int,
+    Real,
+    Bool,
+    Enum,     // Type.Value, e.g. Text.Wrap
+    Binding,  // any other expression, e.g. greeter.message
+};
+
+// Classification of a property value, computed once when the document is
+// built so consumers never reparse the text. The text itself stays in
+// QmlProperty::value.
+struct QmlValue {
+    QmlValueKind kind = QmlValueKind::String;
+    int64_t intValue = 0;     // Int, and Bool as 0/1
+    double realValue = 0.0;   // Real, and Int widened
+
+    // source is the trimmed value as written, quotes included. Never
+    // throws; numbers go through std::from_chars.
+    static QmlValue classify(std::string_view source);
+
+    bool isNumber() const { return kind == QmlValueKind::Int || kind == QmlValueKind::Real; }
+};
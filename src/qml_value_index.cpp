@@ -0,0 +1,384 @@
+#include "qml_value_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "qml_ast_cache.h"
+
+namespace {
+
+constexpr char kMagic[4] = {'Q', 'M', 'L', 'V'};
+
+// Laid out like a QmlAstCache entry: a header, then arrays of 32-bit
+// fields in host byte order, then the strings they point into.
+struct Header {
+    char magic[4];
+    uint32_t formatVersion;
+    uint32_t fileCount;
+    uint32_t tokenCount;
+    uint32_t keyCount;
+    uint32_t postingCount;
+    uint32_t stringBytes;
+    uint64_t payloadHash;
+};
+
+struct FileRecord {
+    uint64_t sourceHash;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+struct StringRecord {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// A token's postings follow those of the tokens before it.
+struct TokenRecord {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t postingCount;
+};
+
+struct PostingRecord {
+    uint32_t file;
+    uint32_t node;
+    uint32_t sourceBegin;
+    uint32_t keyAtom;
+};
+
+bool isIdentifier(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' || ch == '$';
+}
+
+template <typename T>
+void append(std::string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+T read(const char *at) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+}  // namespace
+
+std::vector<std::string_view> QmlValueIndex::tokenize(std::string_view value) {
+    std::vector<std::string_view> tokens;
+    std::vector<std::pair<size_t, size_t>> chain;  // words joined by single dots
+    const auto endChain = [&] {
+        for (size_t first = 0; first < chain.size(); ++first) {
+            for (size_t last = first + 1; last < chain.size(); ++last) {
+                tokens.push_back(value.substr(chain[first].first, chain[last].second - chain[first].first));
+            }
+        }
+        chain.clear();
+    };
+    size_t pos = 0;
+    while (pos < value.size()) {
+        if (!isIdentifier(value[pos])) {
+            ++pos;
+            continue;
+        }
+        const size_t begin = pos;
+        while (pos < value.size() && isIdentifier(value[pos])) {
+            ++pos;
+        }
+        if (!chain.empty() && (begin != chain.back().second + 1 || value[begin - 1] != '.')) {
+            endChain();
+        }
+        chain.emplace_back(begin, pos);
+        tokens.push_back(value.substr(begin, pos - begin));
+    }
+    endChain();
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    return tokens;
+}
+
+uint32_t QmlValueIndex::tokenId(std::string_view token) {
+    const auto it = tokenIds_.find(token);
+    if (it != tokenIds_.end()) {
+        return it->second;
+    }
+    const auto id = static_cast<uint32_t>(tokens_.size());
+    tokens_.emplace_back(token);
+    postings_.emplace_back();
+    tokenIds_.emplace(tokens_.back(), id);
+    return id;
+}
+
+void QmlValueIndex::clear(uint32_t file) {
+    for (const uint32_t token : files_[file].tokens) {
+        std::vector<Posting> &list = postings_[token];
+        const auto begin = std::lower_bound(list.begin(), list.end(), Posting{file, 0, 0, 0});
+        const auto end = std::lower_bound(begin, list.end(), Posting{file + 1, 0, 0, 0});
+        list.erase(begin, end);
+    }
+    files_[file].tokens.clear();
+}
+
+void QmlValueIndex::update(const std::string &path, const QmlDocument &document, uint64_t sourceHash) {
+    uint32_t file = 0;
+    const auto known = fileIds_.find(path);
+    if (known != fileIds_.end()) {
+        file = known->second;
+        clear(file);
+    } else if (!freeFiles_.empty()) {
+        file = freeFiles_.back();
+        freeFiles_.pop_back();
+    } else {
+        file = static_cast<uint32_t>(files_.size());
+        files_.emplace_back();
+    }
+    fileIds_[path] = file;
+    files_[file].path = path;
+    files_[file].sourceHash = sourceHash;
+
+    std::vector<std::pair<uint32_t, Posting>> added;
+    uint32_t node = 0;
+    for (const QmlNode &object : document.nodes()) {
+        for (const QmlProperty &property : object.properties) {
+            for (const std::string_view token : tokenize(property.value)) {
+                added.emplace_back(tokenId(token),
+                                   Posting{file, node, static_cast<uint32_t>(object.sourceBegin), property.key});
+            }
+        }
+        ++node;
+    }
+    std::sort(added.begin(), added.end());
+
+    // The file's postings are contiguous in each list, so each token gets
+    // one insertion.
+    std::vector<uint32_t> &tokens = files_[file].tokens;
+    std::vector<Posting> block;
+    for (auto group = added.begin(); group != added.end();) {
+        const uint32_t token = group->first;
+        auto next = group;
+        while (next != added.end() && next->first == token) {
+            ++next;
+        }
+        block.clear();
+        for (; group != next; ++group) {
+            block.push_back(group->second);
+        }
+        std::vector<Posting> &list = postings_[token];
+        list.insert(std::lower_bound(list.begin(), list.end(), Posting{file, 0, 0, 0}), block.begin(), block.end());
+        tokens.push_back(token);
+    }
+}
+
+void QmlValueIndex::remove(const std::string &path) {
+    const auto it = fileIds_.find(path);
+    if (it == fileIds_.end()) {
+        return;
+    }
+    const uint32_t file = it->second;
+    clear(file);
+    files_[file].path.clear();
+    files_[file].sourceHash = 0;
+    freeFiles_.push_back(file);
+    fileIds_.erase(it);
+}
+
+uint64_t QmlValueIndex::sourceHash(const std::string &path) const {
+    const auto it = fileIds_.find(path);
+    return it == fileIds_.end() ? 0 : files_[it->second].sourceHash;
+}
+
+std::vector<QmlValueHit> QmlValueIndex::find(std::string_view text) const {
+    std::vector<const std::vector<Posting> *> lists;
+    for (const std::string_view token : tokenize(text)) {
+        const auto it = tokenIds_.find(token);
+        if (it == tokenIds_.end() || postings_[it->second].empty()) {
+            return {};
+        }
+        lists.push_back(&postings_[it->second]);
+    }
+    if (lists.empty()) {
+        return {};
+    }
+    // Candidates come from the shortest list and are looked up in the
+    // others, so a common word costs a binary search rather than a scan.
+    std::sort(lists.begin(), lists.end(), [](const auto *a, const auto *b) { return a->size() < b->size(); });
+    std::vector<Posting> matches = *lists[0];
+    for (size_t i = 1; i < lists.size() && !matches.empty(); ++i) {
+        const std::vector<Posting> &list = *lists[i];
+        matches.erase(std::remove_if(matches.begin(), matches.end(),
+                                     [&list](const Posting &posting) {
+                                         return !std::binary_search(list.begin(), list.end(), posting);
+                                     }),
+                      matches.end());
+    }
+
+    std::vector<QmlValueHit> hits;
+    hits.reserve(matches.size());
+    for (const Posting &posting : matches) {
+        hits.push_back(QmlValueHit{files_[posting.file].path, posting.node, posting.sourceBegin, posting.key});
+    }
+    return hits;
+}
+
+std::string QmlValueIndex::serialize() const {
+    std::string strings;
+    const auto addString = [&strings](std::string_view text) {
+        const auto offset = static_cast<uint32_t>(strings.size());
+        strings.append(text.data(), text.size());
+        return StringRecord{offset, static_cast<uint32_t>(text.size())};
+    };
+
+    // Removed slots are left out; live files keep their relative order,
+    // and with it the order of the postings.
+    std::vector<uint32_t> fileIndex(files_.size(), 0);
+    std::vector<FileRecord> files;
+    for (uint32_t file = 0; file < files_.size(); ++file) {
+        if (!files_[file].path.empty()) {
+            fileIndex[file] = static_cast<uint32_t>(files.size());
+            const StringRecord path = addString(files_[file].path);
+            files.push_back(FileRecord{files_[file].sourceHash, path.offset, path.length});
+        }
+    }
+
+    std::unordered_map<QmlAtom, uint32_t> keyIndex;
+    std::vector<StringRecord> keys;
+    std::vector<TokenRecord> tokens;
+    std::vector<PostingRecord> postings;
+    for (uint32_t token = 0; token < tokens_.size(); ++token) {
+        if (postings_[token].empty()) {
+            continue;
+        }
+        const StringRecord name = addString(tokens_[token]);
+        tokens.push_back(TokenRecord{name.offset, name.length, static_cast<uint32_t>(postings_[token].size())});
+        for (const Posting &posting : postings_[token]) {
+            const auto [key, added] = keyIndex.emplace(posting.key, static_cast<uint32_t>(keys.size()));
+            if (added) {
+                keys.push_back(addString(QmlAtomTable::global().name(posting.key)));
+            }
+            postings.push_back(PostingRecord{fileIndex[posting.file], posting.node, posting.sourceBegin, key->second});
+        }
+    }
+
+    std::string payload;
+    for (const auto &file : files) {
+        append(payload, file);
+    }
+    for (const auto &token : tokens) {
+        append(payload, token);
+    }
+    for (const auto &key : keys) {
+        append(payload, key);
+    }
+    for (const auto &posting : postings) {
+        append(payload, posting);
+    }
+    payload += strings;
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.formatVersion = kFormatVersion;
+    header.fileCount = static_cast<uint32_t>(files.size());
+    header.tokenCount = static_cast<uint32_t>(tokens.size());
+    header.keyCount = static_cast<uint32_t>(keys.size());
+    header.postingCount = static_cast<uint32_t>(postings.size());
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+    header.payloadHash = QmlAstCache::contentHash(payload);
+
+    std::string out;
+    out.reserve(sizeof(Header) + payload.size());
+    append(out, header);
+    out += payload;
+    return out;
+}
+
+bool QmlValueIndex::deserialize(std::string_view bytes) {
+    if (bytes.size() < sizeof(Header)) {
+        return false;
+    }
+    const Header header = read<Header>(bytes.data());
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.formatVersion != kFormatVersion) {
+        return false;
+    }
+    const uint64_t fileBytes = uint64_t(header.fileCount) * sizeof(FileRecord);
+    const uint64_t tokenBytes = uint64_t(header.tokenCount) * sizeof(TokenRecord);
+    const uint64_t keyBytes = uint64_t(header.keyCount) * sizeof(StringRecord);
+    const uint64_t postingBytes = uint64_t(header.postingCount) * sizeof(PostingRecord);
+    if (bytes.size() - sizeof(Header) != fileBytes + tokenBytes + keyBytes + postingBytes + header.stringBytes) {
+        return false;
+    }
+    const std::string_view payload = bytes.substr(sizeof(Header));
+    if (QmlAstCache::contentHash(payload) != header.payloadHash) {
+        return false;
+    }
+    const char *filesAt = payload.data();
+    const char *tokensAt = filesAt + fileBytes;
+    const char *keysAt = tokensAt + tokenBytes;
+    const char *postingsAt = keysAt + keyBytes;
+    const std::string_view strings =
+        payload.substr(static_cast<size_t>(fileBytes + tokenBytes + keyBytes + postingBytes));
+    const auto stringAt = [&strings](uint32_t offset, uint32_t length, std::string_view &out) {
+        if (uint64_t(offset) + length > strings.size()) {
+            return false;
+        }
+        out = strings.substr(offset, length);
+        return true;
+    };
+
+    QmlValueIndex result;
+    for (uint32_t i = 0; i < header.fileCount; ++i) {
+        const auto record = read<FileRecord>(filesAt + i * sizeof(FileRecord));
+        std::string_view path;
+        if (!stringAt(record.pathOffset, record.pathLength, path) || path.empty() ||
+            !result.fileIds_.emplace(std::string(path), i).second) {
+            return false;
+        }
+        result.files_.push_back(File{std::string(path), record.sourceHash, {}});
+    }
+    std::vector<QmlAtom> keys(header.keyCount);
+    for (uint32_t i = 0; i < header.keyCount; ++i) {
+        const auto record = read<StringRecord>(keysAt + i * sizeof(StringRecord));
+        std::string_view name;
+        if (!stringAt(record.offset, record.length, name)) {
+            return false;
+        }
+        keys[i] = QmlAtomTable::global().intern(name);
+    }
+
+    uint32_t nextPosting = 0;
+    for (uint32_t i = 0; i < header.tokenCount; ++i) {
+        const auto record = read<TokenRecord>(tokensAt + i * sizeof(TokenRecord));
+        std::string_view name;
+        if (!stringAt(record.offset, record.length, name) || record.postingCount == 0 ||
+            record.postingCount > header.postingCount - nextPosting || result.tokenIds_.count(name) != 0) {
+            return false;
+        }
+        const uint32_t token = result.tokenId(name);
+        std::vector<Posting> &list = result.postings_[token];
+        list.reserve(record.postingCount);
+        for (uint32_t p = 0; p < record.postingCount; ++p, ++nextPosting) {
+            const auto posting = read<PostingRecord>(postingsAt + nextPosting * sizeof(PostingRecord));
+            if (posting.file >= header.fileCount || posting.keyAtom >= header.keyCount) {
+                return false;
+            }
+            list.push_back(Posting{posting.file, posting.node, posting.sourceBegin, keys[posting.keyAtom]});
+        }
+        // Keys are atoms of this process, which order differently from the
+        // writer's.
+        std::sort(list.begin(), list.end());
+        for (size_t p = 0; p < list.size(); ++p) {
+            if (p > 0 && list[p] == list[p - 1]) {
+                return false;
+            }
+            if (p == 0 || list[p].file != list[p - 1].file) {
+                result.files_[list[p].file].tokens.push_back(token);
+            }
+        }
+    }
+    if (nextPosting != header.postingCount) {
+        return false;
+    }
+    *this = std::move(result);
+    return true;
+}
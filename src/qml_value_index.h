@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "qml_atoms.h"
+#include "qml_parser.h"
+
+// A property whose value holds every token of a query.
+struct QmlValueHit {
+    std::string path;
+    uint32_t node = 0;        // pre-order number of the object in its document
+    size_t sourceBegin = 0;   // the object's QmlNode::sourceBegin
+    QmlAtom key = QmlAtoms::Invalid;
+};
+
+// Inverted index over the property values of many documents: token ->
+// (file, object, property). A value's tokens are its words, runs of
+// identifier characters such as greeter or hello, and every dotted chain
+// of two or more words in it, so greeter.message is a token of
+// "root.greeter.message.length" but not of "greeter.messages". Tokens are
+// case-sensitive; quotes and operators only separate them.
+//
+// Postings are kept sorted per token, so a lookup intersects the lists of
+// the query's tokens without touching the documents, and update() only
+// rewrites the lists of the tokens the file had or has.
+//
+// serialize() writes the index in the style of QmlAstCache entries, with
+// each file's content hash; a tool reloading it updates the files whose
+// hash no longer matches. Not thread-safe.
+class QmlValueIndex {
+public:
+    static constexpr uint32_t kFormatVersion = 1;
+
+    // Replaces the postings of path with those of document. sourceHash is
+    // that of the text it was parsed from; see QmlAstCache::contentHash().
+    void update(const std::string &path, const QmlDocument &document, uint64_t sourceHash = 0);
+    void remove(const std::string &path);
+
+    // Properties holding every token of text, by path, object and key. The
+    // tokens need not be adjacent or in order; callers wanting the text
+    // itself check the values of the few properties returned.
+    std::vector<QmlValueHit> find(std::string_view text) const;
+
+    bool contains(const std::string &path) const { return fileIds_.count(path) != 0; }
+    // The hash update() was given for path; 0 if it is not indexed.
+    uint64_t sourceHash(const std::string &path) const;
+    size_t fileCount() const { return fileIds_.size(); }
+    size_t tokenCount() const { return tokenIds_.size(); }
+
+    // The tokens of one value, as update() indexes them, each once.
+    static std::vector<std::string_view> tokenize(std::string_view value);
+
+    std::string serialize() const;
+    // Returns false, leaving the index untouched, unless bytes is a
+    // complete, well-formed index of this format version.
+    bool deserialize(std::string_view bytes);
+
+private:
+    struct Posting {
+        uint32_t file;
+        uint32_t node;
+        uint32_t sourceBegin;
+        QmlAtom key;
+
+        bool operator<(const Posting &other) const {
+            return file != other.file ? file < other.file : node != other.node ? node < other.node : key < other.key;
+        }
+        bool operator==(const Posting &other) const {
+            return file == other.file && node == other.node && key == other.key;
+        }
+    };
+    struct File {
+        std::string path;  // empty once removed; the slot is reused
+        uint64_t sourceHash = 0;
+        std::vector<uint32_t> tokens;  // that have postings of this file
+    };
+
+    uint32_t tokenId(std::string_view token);
+    // Drops the postings of file from the lists of its tokens.
+    void clear(uint32_t file);
+
+    std::vector<File> files_;
+    std::unordered_map<std::string, uint32_t> fileIds_;
+    std::vector<uint32_t> freeFiles_;
+    std::deque<std::string> tokens_;
+    std::unordered_map<std::string_view, uint32_t> tokenIds_;  // views tokens_, which never move
+    std::vector<std::vector<Posting>> postings_;  // by token, sorted
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// LEB128 varints: seven bits per byte, low bits first, high bit set on all
+// but the last byte. Used by the remote screen stream and screen traces.
+namespace QmlVarint {
+
+enum class Status { Ok, Incomplete, Malformed };
+
+inline void append(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline Status read(std::string_view data, size_t &pos, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) {
+            return Status::Incomplete;
+        }
+        const auto byte = static_cast<unsigned char>(data[pos++]);
+        value |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return Status::Ok;
+        }
+    }
+    return Status::Malformed;
+}
+
+// Reads a varint that must fit in a non-negative int.
+inline bool readInt(std::string_view data, size_t &pos, int &value) {
+    uint64_t raw = 0;
+    if (read(data, pos, raw) != Status::Ok || raw > static_cast<uint64_t>(INT_MAX)) {
+        return false;
+    }
+    value = static_cast<int>(raw);
+    return true;
+}
+
+}  // namespace QmlVarint
@@ -0,0 +1,375 @@
+#include "qml_vt_screen.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <curses.h>
+#include <utility>
+
+#include "qml_color_pairs.h"
+#include "qml_text_width.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#undef MOUSE_MOVED  // curses.h and wincon.h both define it
+#include <windows.h>
+#else
+#include <cerrno>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::string_view kBeginSynchronized = "\x1b[?2026h";
+constexpr std::string_view kEndSynchronized = "\x1b[?2026l";
+constexpr std::string_view kEraseLine = "\x1b[K";
+
+int digitCount(int value) {
+    int count = 1;
+    for (; value >= 10; value /= 10) {
+        ++count;
+    }
+    return count;
+}
+
+void appendNumber(std::string &out, int value) {
+    char digits[12];
+    int length = 0;
+    do {
+        digits[length++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (length > 0) {
+        out.push_back(digits[--length]);
+    }
+}
+
+// Curses attribute bits and the SGR parameters that turn them on. Colour
+// pairs are looked up in QmlColorPairs.
+struct SgrMapping {
+    chtype attribute;
+    int parameter;
+};
+constexpr SgrMapping kSgrMappings[] = {
+    {A_BOLD, 1}, {A_DIM, 2}, {A_UNDERLINE, 4}, {A_BLINK, 5}, {A_REVERSE, 7}, {A_STANDOUT, 7},
+};
+
+}  // namespace
+
+VtScreen::VtScreen() : ownsTerminal_(true) {
+#ifdef _WIN32
+    HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (GetConsoleMode(output, &mode)) {
+        SetConsoleMode(output, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
+    querySize();
+    write("\x1b[?25l");
+}
+
+VtScreen::VtScreen(int rows, int cols, Sink sink) : sink_(std::move(sink)), rows_(rows), cols_(cols) {}
+
+VtScreen::~VtScreen() {
+    if (ownsTerminal_) {
+        write("\x1b[0m\x1b[?25h");
+    }
+}
+
+void VtScreen::beginFrame() {
+    if (frame_.empty() && synchronized_) {
+        frame_.append(kBeginSynchronized);
+    }
+}
+
+void VtScreen::clear() {
+    beginFrame();
+    frame_.append("\x1b[0m\x1b[H\x1b[2J");
+    attributes_ = 0;
+    cursorRow_ = 0;
+    cursorCol_ = 0;
+}
+
+void VtScreen::drawText(int row, int col, const std::string &text) {
+    drawStyledText(row, col, text, 0);
+}
+
+void VtScreen::drawStyledText(int row, int col, const std::string &text, uint32_t attributes) {
+    drawRun(ScreenRun{row, col, text, attributes});
+}
+
+void VtScreen::drawRuns(const ScreenRun *runs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        drawRun(runs[i]);
+    }
+}
+
+void VtScreen::drawRun(const ScreenRun &run) {
+    const int row = run.row;
+    const int col = run.col;
+    if (row < 0 || row >= rows_ || col < 0 || col >= cols_ || run.text.empty()) {
+        return;
+    }
+    // Runs from the cell grid carry their width and already fit the row.
+    int width = run.width;
+    size_t length = run.text.size();
+    if (width < 0 || col + width > cols_) {
+        length = QmlTextWidth::fit(run.text, cols_ - col, width);
+    }
+
+    beginFrame();
+    moveTo(row, col);
+    setAttributes(run.attributes);
+    if (budget_ > 0) {
+        cursorCol_ = col + appendCompact(run.text.substr(0, length), col + width == cols_, run.attributes);
+    } else {
+        frame_.append(run.text.substr(0, length));
+        cursorCol_ = col + width;
+    }
+    if (cursorCol_ >= cols_) {
+        // Terminals differ on where the cursor sits after the last column.
+        cursorRow_ = -1;
+        cursorCol_ = -1;
+    }
+}
+
+bool VtScreen::scrollRows(int top, int bottom, int count) {
+    top = std::max(0, top);
+    bottom = std::min(rows_, bottom);
+    if (count == 0 || top >= bottom) {
+        return true;
+    }
+    beginFrame();
+    setAttributes(0);  // the uncovered rows take the current background
+    const bool region = top > 0 || bottom < rows_;
+    if (region) {
+        frame_.append("\x1b[");
+        appendNumber(frame_, top + 1);
+        frame_.push_back(';');
+        appendNumber(frame_, bottom);
+        frame_.push_back('r');
+    }
+    frame_.append("\x1b[");
+    if (std::abs(count) > 1) {
+        appendNumber(frame_, std::abs(count));
+    }
+    frame_.push_back(count > 0 ? 'S' : 'T');
+    if (region) {
+        // Resetting the region homes the cursor.
+        frame_.append("\x1b[r");
+        cursorRow_ = 0;
+        cursorCol_ = 0;
+    }
+    return true;
+}
+
+// Appends text, sending each run of a repeated one-cell character as one
+// copy and REP (CSI n b) when that is shorter. Blanks that end the row
+// are sent as EL where that is shorter; EL erases to the default
+// background, so only for unstyled text. Returns the columns the cursor
+// advances.
+int VtScreen::appendCompact(std::string_view text, bool endsRow, uint32_t attributes) {
+    const size_t kept = text.find_last_not_of(' ') + 1;  // 0 when all blank
+    const bool erase = endsRow && attributes == 0 && text.size() - kept > kEraseLine.size();
+    if (erase) {
+        text = text.substr(0, kept);
+    }
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        uint32_t codePoint = 0;
+        const size_t length = QmlTextWidth::decode(text, pos, codePoint);
+        const std::string_view glyph = text.substr(pos, length);
+        size_t next = pos + length;
+        int repeats = 0;
+        if (QmlTextWidth::codePoint(codePoint) == 1) {
+            while (text.compare(next, length, glyph) == 0) {
+                next += length;
+                ++repeats;
+            }
+            // A zero-width character after the last copy belongs to it.
+            if (repeats > 0 && next < text.size()) {
+                uint32_t following = 0;
+                QmlTextWidth::decode(text, next, following);
+                if (QmlTextWidth::codePoint(following) == 0) {
+                    next -= length;
+                    --repeats;
+                }
+            }
+        }
+        frame_.append(glyph);
+        const size_t literal = static_cast<size_t>(repeats) * length;
+        if (repeats > 0 && static_cast<size_t>(3 + digitCount(repeats)) < literal) {
+            frame_.append("\x1b[");
+            appendNumber(frame_, repeats);
+            frame_.push_back('b');
+        } else {
+            frame_.append(text.substr(pos + length, literal));
+        }
+        pos = next;
+    }
+
+    if (erase) {
+        frame_.append(kEraseLine);
+    }
+    return QmlTextWidth::of(text);
+}
+
+// Picks the shortest sequence that gets the cursor from where it is to
+// (row, col): nothing, a carriage return, a relative move along the row,
+// or an absolute CUP.
+void VtScreen::moveTo(int row, int col) {
+    if (row == cursorRow_ && col == cursorCol_) {
+        return;
+    }
+
+    std::string absolute = "\x1b[";
+    appendNumber(absolute, row + 1);
+    if (col > 0) {
+        absolute.push_back(';');
+        appendNumber(absolute, col + 1);
+    }
+    absolute.push_back('H');
+
+    std::string best = std::move(absolute);
+    if (row == cursorRow_) {
+        std::string relative;
+        if (col == 0) {
+            relative = "\r";
+        } else {
+            relative = "\x1b[";
+            appendNumber(relative, std::abs(col - cursorCol_));
+            relative.push_back(col > cursorCol_ ? 'C' : 'D');
+        }
+        if (relative.size() < best.size()) {
+            best = std::move(relative);
+        }
+    }
+    frame_.append(best);
+    cursorRow_ = row;
+    cursorCol_ = col;
+}
+
+// Emits only the SGR change: added attributes are switched on directly;
+// removing any of them resets and re-applies the ones that stay. A new
+// colour pair sets both colours.
+void VtScreen::setAttributes(uint32_t attributes) {
+    if (attributes == attributes_) {
+        return;
+    }
+    const auto color = static_cast<uint32_t>(A_COLOR);
+    const bool removed = (attributes_ & ~attributes & ~color) != 0;
+    const uint32_t wanted = removed ? attributes : attributes & ~attributes_;
+
+    frame_.append("\x1b[");
+    bool first = true;
+    const auto append = [&](int parameter) {
+        if (!first) {
+            frame_.push_back(';');
+        }
+        appendNumber(frame_, parameter);
+        first = false;
+    };
+    if (removed) {
+        append(0);
+    }
+    int lastParameter = 0;
+    for (const auto &mapping : kSgrMappings) {
+        if ((wanted & mapping.attribute) == 0 || mapping.parameter == lastParameter) {
+            continue;
+        }
+        append(mapping.parameter);
+        lastParameter = mapping.parameter;
+    }
+    const uint32_t pair = static_cast<uint32_t>(PAIR_NUMBER(attributes));
+    if ((attributes & color) != (attributes_ & color) || (removed && pair != 0)) {
+        int foreground = QmlColorPairs::kDefault;
+        int background = QmlColorPairs::kDefault;
+        QmlColorPairs::global().colors(pair, foreground, background);
+        append(QmlColorPairs::sgrForeground(foreground));
+        append(QmlColorPairs::sgrBackground(background));
+    }
+    if (first) {
+        frame_.push_back('0');
+    }
+    frame_.push_back('m');
+    attributes_ = attributes;
+}
+
+void VtScreen::refresh() {
+    bytesLastFrame_ = 0;
+    frameDelay_ = std::chrono::microseconds(0);
+    if (frame_.empty()) {
+        return;
+    }
+    if (synchronized_) {
+        frame_.append(kEndSynchronized);
+    }
+    write(frame_);
+    bytesLastFrame_ = frame_.size();
+    frame_.clear();
+    if (budget_ > 0) {
+        frameDelay_ = std::chrono::microseconds(static_cast<int64_t>(bytesLastFrame_ * 1000000 / budget_));
+    }
+    const Clock::time_point now = Clock::now();
+    written_.emplace_back(now, bytesLastFrame_);
+    writtenBytes_ += bytesLastFrame_;
+    bytesPerSecond(now);
+    if (ownsTerminal_) {
+        querySize();
+    }
+}
+
+size_t VtScreen::bytesPerSecond(Clock::time_point now) {
+    while (!written_.empty() && now - written_.front().first >= std::chrono::seconds(1)) {
+        writtenBytes_ -= written_.front().second;
+        written_.pop_front();
+    }
+    return writtenBytes_;
+}
+
+void VtScreen::write(std::string_view bytes) {
+    if (sink_) {
+        sink_(bytes);
+        return;
+    }
+#ifdef _WIN32
+    HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+    while (!bytes.empty()) {
+        DWORD written = 0;
+        if (!WriteFile(output, bytes.data(), static_cast<DWORD>(bytes.size()), &written, nullptr) || written == 0) {
+            return;
+        }
+        bytes.remove_prefix(written);
+    }
+#else
+    while (!bytes.empty()) {
+        const ssize_t written = ::write(STDOUT_FILENO, bytes.data(), bytes.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        bytes.remove_prefix(static_cast<size_t>(written));
+    }
+#endif
+}
+
+void VtScreen::querySize() {
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        rows_ = info.srWindow.Bottom - info.srWindow.Top + 1;
+        cols_ = info.srWindow.Right - info.srWindow.Left + 1;
+    }
+#else
+    winsize size{};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        rows_ = size.ws_row;
+        cols_ = size.ws_col;
+    }
+#endif
+}
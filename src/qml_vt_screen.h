@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "qml_curses_frontend.h"
+
+// ICursesScreen that writes VT/ANSI escape sequences directly instead of
+// going through curses. Draw calls append to one frame buffer, which
+// refresh() hands to the terminal in a single write (WriteFile on
+// Windows). Cursor moves and SGR attribute changes are emitted only as
+// deltas from the terminal state the screen has already produced.
+class VtScreen : public ICursesScreen {
+public:
+    using Sink = std::function<void(std::string_view bytes)>;
+    using Clock = std::chrono::steady_clock;
+
+    // Writes to stdout and takes its size from the terminal. The cursor is
+    // hidden while the screen exists.
+    VtScreen();
+    // Fixed-size screen whose frames go to sink; used by tests and
+    // benchmarks.
+    VtScreen(int rows, int cols, Sink sink);
+    ~VtScreen() override;
+
+    VtScreen(const VtScreen &) = delete;
+    VtScreen &operator=(const VtScreen &) = delete;
+
+    void clear() override;
+    void drawText(int row, int col, const std::string &text) override;
+    void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override;
+    void drawRuns(const ScreenRun *runs, size_t count) override;
+    // SU or SD, inside a DECSTBM scrolling region unless the rows are the
+    // whole screen.
+    bool scrollRows(int top, int bottom, int count) override;
+    void refresh() override;
+    int rows() const override { return rows_; }
+    int cols() const override { return cols_; }
+
+    // Wraps each frame in DEC mode 2026 (synchronized output) so the
+    // terminal presents it atomically. Terminals without the mode ignore
+    // it, so it is on by default.
+    void setSynchronizedOutput(bool enabled) { synchronized_ = enabled; }
+    size_t bytesLastFrame() const { return bytesLastFrame_; }
+
+    // Budget for slow links, in bytes per second; 0, the default, is
+    // unlimited. With a budget, rows are encoded compactly: a character
+    // repeated across a row becomes one copy and a REP sequence, and
+    // blanks running to the end of a row become EL, wherever that is
+    // shorter. (Short unchanged gaps are already rewritten rather than
+    // skipped over, by the cell grid, where that is cheaper than a cursor
+    // move.) refresh() then works out how long the link needs to carry
+    // each frame; frameDelay() is the time to wait before sending the
+    // next, so a caller lowers its frame rate instead of queueing output.
+    void setBandwidthBudget(size_t bytesPerSecond) { budget_ = bytesPerSecond; }
+    size_t bandwidthBudget() const { return budget_; }
+    std::chrono::microseconds frameDelay() const { return frameDelay_; }
+    // Bytes written in the second up to now.
+    size_t bytesPerSecond(Clock::time_point now = Clock::now());
+    // Heap bytes held by the frame being encoded and the send history,
+    // for memory accounting.
+    size_t byteSize() const {
+        return frame_.capacity() + written_.size() * sizeof(std::pair<Clock::time_point, size_t>);
+    }
+
+private:
+    void beginFrame();
+    void drawRun(const ScreenRun &run);
+    int appendCompact(std::string_view text, bool endsRow, uint32_t attributes);
+    void moveTo(int row, int col);
+    void setAttributes(uint32_t attributes);
+    void write(std::string_view bytes);
+    void querySize();
+
+    Sink sink_;
+    std::string frame_;
+    int rows_ = 24;
+    int cols_ = 80;
+    // Where the terminal cursor is after the bytes produced so far; -1
+    // when unknown (startup, or after writing into the last column).
+    int cursorRow_ = -1;
+    int cursorCol_ = -1;
+    uint32_t attributes_ = 0;
+    bool synchronized_ = true;
+    bool ownsTerminal_ = false;
+    size_t bytesLastFrame_ = 0;
+    size_t budget_ = 0;
+    std::chrono::microseconds frameDelay_{0};
+    // Frames written in the last second, for bytesPerSecond().
+    std::deque<std::pair<Clock::time_point, size_t>> written_;
+    size_t writtenBytes_ = 0;
+};
@@ -0,0 +1,166 @@
+#include "qml_writer.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr std::string_view kSpaces = "                                                                ";
+
+// Whether text holds quote without a backslash escaping it.
+bool hasBareQuote(std::string_view text, char quote) {
+    bool escaped = false;
+    for (const char ch : text) {
+        if (ch == quote && !escaped) {
+            return true;
+        }
+        escaped = ch == '\\' && !escaped;
+    }
+    return false;
+}
+
+}  // namespace
+
+QmlWriter::QmlWriter(QmlWriteSink sink, const Options &options) : sink_(sink), options_(options) {
+    options_.chunkSize = std::max<size_t>(options_.chunkSize, 1);
+    buffer_.reserve(options_.chunkSize);
+}
+
+QmlWriter::~QmlWriter() {
+    flush();
+}
+
+void QmlWriter::write(const QmlDocument &document, std::string_view source) {
+    for (const QmlNode &root : document.roots) {
+        write(root, source);
+    }
+}
+
+void QmlWriter::write(const QmlNode &node, std::string_view source, size_t depth) {
+    open(node, source, depth);
+    size_t level = depth + 1;
+    node.walkDescendants(
+        [&](const QmlNode &descendant) {
+            open(descendant, source, level++);
+            return QmlVisit::Continue;
+        },
+        [&](const QmlNode &) { close(--level); });
+    close(depth);
+}
+
+void QmlWriter::flush() {
+    if (!buffer_.empty()) {
+        sink_(buffer_);
+        buffer_.clear();
+    }
+}
+
+std::string QmlWriter::toString(const QmlDocument &document, std::string_view source) {
+    std::string text;
+    const auto sink = [&text](std::string_view chunk) { text.append(chunk); };
+    QmlWriter(sink).write(document, source);
+    return text;
+}
+
+std::string QmlWriter::toString(const QmlNode &node, std::string_view source) {
+    std::string text;
+    const auto sink = [&text](std::string_view chunk) { text.append(chunk); };
+    QmlWriter(sink).write(node, source);
+    return text;
+}
+
+void QmlWriter::append(std::string_view text) {
+    bytesWritten_ += text.size();
+    if (buffer_.size() + text.size() > options_.chunkSize) {
+        flush();
+        if (text.size() >= options_.chunkSize) {
+            sink_(text);
+            return;
+        }
+    }
+    buffer_.append(text);
+}
+
+void QmlWriter::appendIndent(size_t depth) {
+    for (size_t spaces = depth * options_.indent; spaces > 0;) {
+        const size_t run = std::min(spaces, kSpaces.size());
+        append(kSpaces.substr(0, run));
+        spaces -= run;
+    }
+}
+
+void QmlWriter::open(const QmlNode &node, std::string_view source, size_t depth) {
+    appendIndent(depth);
+    if (node.binding != QmlAtoms::Invalid) {
+        append(QmlAtomTable::global().name(node.binding));
+        append(": ");
+    }
+    append(node.type);
+    append(" {\n");
+    if (!node.id.empty() && !node.findProperty(QmlAtoms::id)) {
+        QmlProperty id;
+        id.value = node.id;
+        id.typed.kind = QmlValueKind::Binding;
+        appendProperty("id", id, depth + 1);
+    }
+    const QmlAtomTable &atoms = QmlAtomTable::global();
+    for (const QmlProperty &property : node.properties) {
+        appendProperty(atoms.name(property.key), property, depth + 1);
+    }
+    for (const QmlScriptBlock &script : node.scripts) {
+        if (script.bodyEnd > source.size() || script.bodyBegin > script.bodyEnd) {
+            continue;
+        }
+        appendIndent(depth + 1);
+        if (script.kind == QmlScriptKind::Function) {
+            append("function ");
+            append(atoms.name(script.name));
+            append("(");
+            append(script.parameters);
+            append(") ");
+        } else {
+            append(atoms.name(script.name));
+            append(": ");
+        }
+        append(script.body(source));
+        append("\n");
+    }
+}
+
+void QmlWriter::close(size_t depth) {
+    appendIndent(depth);
+    append("}\n");
+}
+
+void QmlWriter::appendProperty(std::string_view key, const QmlProperty &property, size_t depth) {
+    appendIndent(depth);
+    append(key);
+    append(": ");
+    if (property.typed.kind != QmlValueKind::String) {
+        append(property.value);
+    } else if (!hasBareQuote(property.value, '"')) {
+        append("\"");
+        append(property.value);
+        append("\"");
+    } else if (!hasBareQuote(property.value, '\'')) {
+        append("'");
+        append(property.value);
+        append("'");
+    } else {
+        // Holds both kinds bare, so it was not parsed; escape the doubles.
+        append("\"");
+        size_t from = 0;
+        bool escaped = false;
+        for (size_t i = 0; i < property.value.size(); ++i) {
+            const char ch = property.value[i];
+            if (ch == '"' && !escaped) {
+                append(std::string_view(property.value).substr(from, i - from));
+                append("\\\"");
+                from = i + 1;
+            }
+            escaped = ch == '\\' && !escaped;
+        }
+        append(std::string_view(property.value).substr(from));
+        append("\"");
+    }
+    append("\n");
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "qml_function_ref.h"
+#include "qml_parser.h"
+
+// Receives the writer's output in order, one chunk at a time. The view is
+// only valid during the call.
+using QmlWriteSink = QmlFunctionRef<void(std::string_view chunk)>;
+
+// Serializes documents and subtrees back to QML that QmlParser reads into
+// the same tree. Output is gathered in one buffer of chunkSize bytes and
+// handed to the sink whenever it fills, so a file of any size is written
+// without building it in memory; values longer than a chunk go to the sink
+// straight from the node.
+//
+// String values are quoted with whichever of " and ' they hold no
+// unescaped instance of, so parsed text comes back byte for byte; other
+// values are written as they are. Each object's properties come in order,
+// then its scripts and its children; an id set on the node alone is
+// written first. Scripts need the source the document was parsed from,
+// since nodes only record where their bodies are; without it they are left
+// out. Imports are not part of the tree: write them to the sink first.
+// Nesting depth is bounded by memory rather than by the call stack.
+//
+//   std::ofstream out(path, std::ios::binary);
+//   const auto sink = [&out](std::string_view chunk) { out.write(chunk.data(), chunk.size()); };
+//   QmlWriter writer(sink);
+//   writer.write(document, source);
+class QmlWriter {
+public:
+    struct Options {
+        size_t indent = 4;  // spaces per nesting level
+        size_t chunkSize = 64 * 1024;
+    };
+
+    // The sink is not copied and must outlive the writer.
+    explicit QmlWriter(QmlWriteSink sink) : QmlWriter(sink, Options()) {}
+    QmlWriter(QmlWriteSink sink, const Options &options);
+    // Flushes what is still buffered.
+    ~QmlWriter();
+
+    QmlWriter(const QmlWriter &) = delete;
+    QmlWriter &operator=(const QmlWriter &) = delete;
+
+    // Every root in order.
+    void write(const QmlDocument &document, std::string_view source = {});
+    // One object and its subtree, indented as if depth levels deep.
+    void write(const QmlNode &node, std::string_view source = {}, size_t depth = 0);
+    // Hands whatever is buffered to the sink.
+    void flush();
+
+    // Bytes written so far, buffered ones included.
+    uint64_t bytesWritten() const { return bytesWritten_; }
+
+    static std::string toString(const QmlDocument &document, std::string_view source = {});
+    static std::string toString(const QmlNode &node, std::string_view source = {});
+
+private:
+    void append(std::string_view text);
+    void appendIndent(size_t depth);
+    void open(const QmlNode &node, std::string_view source, size_t depth);
+    void close(size_t depth);
+    void appendProperty(std::string_view key, const QmlProperty &property, size_t depth);
+
+    QmlWriteSink sink_;
+    Options options_;
+    std::string buffer_;
+    uint64_t bytesWritten_ = 0;
+};
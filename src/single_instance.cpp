@@ -0,0 +1,106 @@
+#include "single_instance.h"
+
+#include <QCloseEvent>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QQuickWindow>
+
+QString SingleInstance::defaultName() {
+    QString user = qEnvironmentVariable("USER");
+    if (user.isEmpty()) {
+        user = qEnvironmentVariable("USERNAME");
+    }
+    return QStringLiteral("sample_app-") + user;
+}
+
+bool SingleInstance::forward(const QStringList &arguments, int timeoutMs) const {
+    QLocalSocket socket;
+    socket.connectToServer(name_);
+    if (!socket.waitForConnected(timeoutMs)) {
+        return false;
+    }
+    socket.write(QJsonDocument(QJsonArray::fromStringList(arguments)).toJson(QJsonDocument::Compact) + '\n');
+    while (!socket.canReadLine()) {
+        if (!socket.waitForReadyRead(timeoutMs)) {
+            return false;
+        }
+    }
+    return socket.readLine().trimmed() == "ok";
+}
+
+bool SingleInstance::listen(Launched launched) {
+    launched_ = std::move(launched);
+    server_.setSocketOptions(QLocalServer::UserAccessOption);
+    if (!server_.listen(name_) && server_.serverError() == QAbstractSocket::AddressInUseError) {
+        // Left behind by an instance that did not shut down; forward()
+        // already found no one answering on it.
+        QLocalServer::removeServer(name_);
+        server_.listen(name_);
+    }
+    if (!server_.isListening()) {
+        qWarning("Could not listen on %s: %s", qPrintable(name_), qPrintable(server_.errorString()));
+        return false;
+    }
+    QObject::connect(&server_, &QLocalServer::newConnection, &server_, [this] { acceptLaunches(); });
+    return true;
+}
+
+void SingleInstance::acceptLaunches() {
+    while (QLocalSocket *socket = server_.nextPendingConnection()) {
+        QObject::connect(socket, &QLocalSocket::readyRead, socket, [this, socket] {
+            while (socket->canReadLine()) {
+                const QJsonDocument arguments = QJsonDocument::fromJson(socket->readLine());
+                socket->write("ok\n");
+                if (launched_) {
+                    launched_(arguments.toVariant().toStringList());
+                }
+            }
+        });
+        QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+ResidentWindow::ResidentWindow(QQuickWindow *window) : QObject(window), window_(window) {
+    window_->installEventFilter(this);
+}
+
+void ResidentWindow::warm() {
+    if (!window_ || window_->isVisible()) {
+        return;
+    }
+    warming_ = true;
+    window_->setOpacity(0.0);
+    // frameSwapped comes from the render thread with the threaded loop.
+    connect(
+        window_, &QQuickWindow::frameSwapped, this,
+        [this] {
+            if (warming_ && window_) {
+                warming_ = false;
+                window_->hide();
+                window_->setOpacity(1.0);
+            }
+        },
+        static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::SingleShotConnection));
+    window_->show();
+}
+
+void ResidentWindow::present() {
+    if (!window_) {
+        return;
+    }
+    warming_ = false;
+    window_->setOpacity(1.0);
+    window_->show();
+    window_->raise();
+    window_->requestActivate();
+}
+
+bool ResidentWindow::eventFilter(QObject *watched, QEvent *event) {
+    if (event->type() == QEvent::Close && watched == window_) {
+        event->ignore();
+        window_->hide();
+        return true;
+    }
+    return QObject::eventFilter(watched, event);
+}
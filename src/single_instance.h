@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QLocalServer>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class QQuickWindow;
+
+// Single-instance mode. A launch first offers its arguments to a resident
+// sample_app listening on a per-user local socket (a Unix domain socket,
+// or a named pipe on Windows) and exits once that one has them; the
+// resident process shows its window, already created and warmed, so the
+// launch costs a frame rather than Qt and QML startup. The protocol is one
+// line per launch, the arguments as a JSON array, answered with "ok".
+class SingleInstance {
+public:
+    using Launched = std::function<void(const QStringList &arguments)>;
+
+    // The socket name, unique per user.
+    static QString defaultName();
+
+    explicit SingleInstance(QString name = defaultName()) : name_(std::move(name)) {}
+
+    // Hands the arguments to a resident instance; returns whether one took
+    // them within the timeout.
+    bool forward(const QStringList &arguments, int timeoutMs = 1000) const;
+    // Becomes the resident instance; launched is called on this thread
+    // for each later launch. Returns false, with a warning, if it cannot.
+    bool listen(Launched launched);
+
+private:
+    void acceptLaunches();
+
+    QString name_;
+    QLocalServer server_;
+    Launched launched_;
+};
+
+// Keeps a window for a resident process: closing it hides it instead of
+// destroying its platform window, and warm() renders one invisible frame
+// up front, so that with a persistent scene graph (see WindowKeeper)
+// present() shows a window whose scene graph, pipelines and glyphs are
+// ready.
+class ResidentWindow : public QObject {
+public:
+    explicit ResidentWindow(QQuickWindow *window);
+
+    // Shows the window at zero opacity until its first frame is swapped,
+    // then hides it. Call it while the window is not shown yet.
+    void warm();
+    // Shows, raises and activates the window.
+    void present();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    QPointer<QQuickWindow> window_;
+    bool warming_ = false;
+};
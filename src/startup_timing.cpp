@@ -0,0 +1,122 @@
+#include "startup_timing.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQmlApplicationEngine>
+#include <QQuickWindow>
+#include <cstdio>
+
+#include "metrics_endpoint.h"
+
+StartupTiming::StartupTiming() {
+    clock_.start();
+    phases_.reserve(7);
+}
+
+void StartupTiming::mark(const char *phase) {
+    record(phase, clock_.nsecsElapsed());
+}
+
+void StartupTiming::glyphsPrewarmed(int glyphs) {
+    const qint64 nsecs = clock_.nsecsElapsed();
+    QMetaObject::invokeMethod(
+        this,
+        [this, glyphs, nsecs] {
+            record("glyphsWarm", nsecs);
+            prewarmedGlyphs_ = glyphs;
+        },
+        Qt::QueuedConnection);
+}
+
+void StartupTiming::record(const char *phase, qint64 nsecs) {
+    phases_.push_back(Phase{phase, nsecs});
+}
+
+void StartupTiming::watch(QQmlApplicationEngine &engine) {
+    connect(&engine, &QQmlApplicationEngine::objectCreated, this, [this](QObject *object, const QUrl &) {
+        mark("objectCreated");
+        auto *window = qobject_cast<QQuickWindow *>(object);
+        if (!window) {
+            return;
+        }
+        window->installEventFilter(this);
+        // With the threaded render loop frameSwapped comes from the render
+        // thread: read the clock there, record on this one.
+        connect(
+            window, &QQuickWindow::frameSwapped, window,
+            [this] {
+                const qint64 nsecs = clock_.nsecsElapsed();
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, nsecs] {
+                        record("firstFrame", nsecs);
+                        finish();
+                    },
+                    Qt::QueuedConnection);
+            },
+            static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::SingleShotConnection));
+    });
+}
+
+bool StartupTiming::eventFilter(QObject *watched, QEvent *event) {
+    if (event->type() == QEvent::Expose && !exposed_ && static_cast<QWindow *>(watched)->isExposed()) {
+        exposed_ = true;
+        mark("exposed");
+        watched->removeEventFilter(this);
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+QByteArray StartupTiming::toJson() const {
+    QJsonArray phases;
+    for (const Phase &phase : phases_) {
+        phases.append(QJsonObject{
+            {QStringLiteral("phase"), QString::fromLatin1(phase.name)},
+            {QStringLiteral("ms"), static_cast<double>(phase.nsecs) / 1e6},
+        });
+    }
+    qint64 residentKiB;
+    qint64 peakResidentKiB;
+    residentMemory(residentKiB, peakResidentKiB);
+    QJsonObject report{
+        {QStringLiteral("unit"), QStringLiteral("ms")},
+        {QStringLiteral("phases"), phases},
+        {QStringLiteral("residentKiB"), residentKiB},
+        {QStringLiteral("peakResidentKiB"), peakResidentKiB},
+    };
+    if (prewarmedGlyphs_ >= 0) {
+        report.insert(QStringLiteral("prewarmedGlyphs"), prewarmedGlyphs_);
+    }
+    return QJsonDocument(report).toJson(QJsonDocument::Indented);
+}
+
+void StartupTiming::appendMetrics(QmlMetricsText &text) const {
+    text.family("qml_startup_seconds", QmlMetricsText::Type::Gauge, "Time from main() to each startup phase.",
+                "seconds");
+    for (const Phase &phase : phases_) {
+        text.gauge(static_cast<double>(phase.nsecs) / 1e9, QmlMetricsText::label("phase", phase.name));
+    }
+}
+
+void StartupTiming::finish() {
+    if (output_.isEmpty()) {
+        return;
+    }
+    const QByteArray json = toJson();
+    if (output_ == QLatin1String("-")) {
+        std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+        std::fflush(stdout);
+    } else {
+        QFile file(output_);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+            std::fprintf(stderr, "Could not write startup timing to %s\n", qPrintable(output_));
+        }
+    }
+    if (quit_) {
+        QCoreApplication::quit();
+    }
+}
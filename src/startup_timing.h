@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <vector>
+
+class QQmlApplicationEngine;
+class QmlMetricsText;
+
+// Timestamps of sample_app's startup phases, in milliseconds since main()
+// constructed it: app, engine, load, objectCreated, exposed and
+// firstFrame, and glyphsWarm when glyphs are prewarmed. Marking is always
+// on and costs a clock read; the report is written only if an output is
+// set, as JSON once the first frame has been swapped:
+//
+//   {"unit": "ms", "phases": [{"phase": "app", "ms": 41.7}, ...],
+//    "prewarmedGlyphs": 190, "residentKiB": 61230, "peakResidentKiB": 63014}
+//
+// Memory is read when the report is written; -1 where unknown. Run it
+// against a cold and a warm disk cache for the two startup numbers, and
+// with and without --prewarm-glyphs for what prewarming saves the first
+// frame. glyphsWarm and prewarmedGlyphs are only there if prewarming
+// finished before the first frame.
+class StartupTiming : public QObject {
+public:
+    StartupTiming();
+
+    // Records phase now. GUI thread only.
+    void mark(const char *phase);
+    // Marks glyphsWarm now, for a GlyphPrewarmer's done callback; any
+    // thread.
+    void glyphsPrewarmed(int glyphs);
+    // Marks objectCreated, and exposed and firstFrame for the window the
+    // engine creates. Call before loading.
+    void watch(QQmlApplicationEngine &engine);
+
+    // File for the report, or "-" for stdout; empty writes nothing.
+    void setOutput(const QString &path) { output_ = path; }
+    // Quits the application once the report is written.
+    void setQuitAfterStartup(bool quit) { quit_ = quit; }
+
+    QByteArray toJson() const;
+    // Each phase so far as a qml_startup_seconds gauge labelled by phase.
+    void appendMetrics(QmlMetricsText &text) const;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Phase {
+        const char *name;
+        qint64 nsecs;
+    };
+
+    void record(const char *phase, qint64 nsecs);
+    void finish();
+
+    QElapsedTimer clock_;
+    std::vector<Phase> phases_;
+    QString output_;
+    bool quit_ = false;
+    bool exposed_ = false;
+    int prewarmedGlyphs_ = -1;  // -1 when not prewarming
+};
@@ -0,0 +1,111 @@
+#include "window_keeper.h"
+
+#include <QQuickWindow>
+#include <algorithm>
+
+#include "qml_cache_budget.h"
+
+namespace {
+
+// Two colour buffers and a depth-stencil buffer, four bytes a pixel each.
+constexpr size_t kBytesPerPixel = 12;
+
+void setPersistent(QQuickWindow &window, bool persistent) {
+    window.setPersistentSceneGraph(persistent);
+    window.setPersistentGraphics(persistent);
+}
+
+}  // namespace
+
+WindowKeeper::WindowKeeper(QmlCacheBudget *budget, QObject *parent) : QObject(parent), budget_(budget) {
+    if (budget_) {
+        // Dearer than cached greetings: rebuilding means compiling shaders
+        // and uploading textures while the window is being shown.
+        budgetId_ = budget_->attach(
+            "hidden windows", 4.0, [this] { return hiddenBytes(); }, [this](size_t bytes) { return release(bytes); });
+    }
+}
+
+WindowKeeper::~WindowKeeper() {
+    if (budget_) {
+        budget_->detach(budgetId_);
+    }
+}
+
+void WindowKeeper::keep(QQuickWindow *window) {
+    const bool known = std::any_of(windows_.begin(), windows_.end(),
+                                   [window](const Kept &kept) { return kept.window == window; });
+    if (!window || known) {
+        return;
+    }
+    setPersistent(*window, true);
+    windows_.push_back(Kept{window, window->isVisible() ? 0 : ++hides_, false});
+    connect(window, &QWindow::visibleChanged, this,
+            [this, window](bool visible) { visibilityChanged(window, visible); });
+    connect(window, &QObject::destroyed, this, [this] {
+        windows_.erase(std::remove_if(windows_.begin(), windows_.end(), [](const Kept &kept) { return !kept.window; }),
+                       windows_.end());
+    });
+}
+
+void WindowKeeper::keepChildren(QObject *root) {
+    if (!root) {
+        return;
+    }
+    for (QQuickWindow *window : root->findChildren<QQuickWindow *>()) {
+        keep(window);
+    }
+}
+
+void WindowKeeper::visibilityChanged(QQuickWindow *window, bool visible) {
+    for (Kept &kept : windows_) {
+        if (kept.window != window) {
+            continue;
+        }
+        kept.hiddenAt = visible ? 0 : ++hides_;
+        if (visible && kept.released) {
+            kept.released = false;
+            setPersistent(*window, true);
+        }
+        return;
+    }
+}
+
+size_t WindowKeeper::bytesOf(const QQuickWindow &window) {
+    const double ratio = window.devicePixelRatio();
+    return static_cast<size_t>(window.width() * ratio) * static_cast<size_t>(window.height() * ratio) *
+           kBytesPerPixel;
+}
+
+size_t WindowKeeper::hiddenBytes() const {
+    size_t bytes = 0;
+    for (const Kept &kept : windows_) {
+        if (kept.window && kept.hiddenAt != 0 && !kept.released) {
+            bytes += bytesOf(*kept.window);
+        }
+    }
+    return bytes;
+}
+
+// A hidden window only gives its scene graph and graphics up once they
+// are no longer persistent; releaseResources() then drops them.
+size_t WindowKeeper::release(size_t bytes) {
+    size_t freed = 0;
+    while (freed < bytes) {
+        Kept *oldest = nullptr;
+        for (Kept &kept : windows_) {
+            if (kept.window && kept.hiddenAt != 0 && !kept.released &&
+                (!oldest || kept.hiddenAt < oldest->hiddenAt)) {
+                oldest = &kept;
+            }
+        }
+        if (!oldest) {
+            break;
+        }
+        freed += bytesOf(*oldest->window);
+        oldest->released = true;
+        setPersistent(*oldest->window, false);
+        oldest->window->releaseResources();
+    }
+    return freed;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class QQuickWindow;
+class QmlCacheBudget;
+
+// Keeps the scene graph and graphics resources of secondary windows and
+// popups that are hidden and shown often (setPersistentSceneGraph() and
+// setPersistentGraphics()), so showing one again takes a single frame
+// rather than rebuilding its nodes, textures, pipelines and swap chain.
+// What hidden windows keep counts against a QmlCacheBudget as "hidden
+// windows", estimated from the swap chain's size; when the budget or
+// memory pressure evicts it, the longest-hidden windows let their
+// resources go and rebuild them when next shown, after which they are
+// kept again.
+//
+//   WindowKeeper keeper(&cacheBudget);
+//   keeper.keep(settingsWindow);
+class WindowKeeper : public QObject {
+public:
+    explicit WindowKeeper(QmlCacheBudget *budget = nullptr, QObject *parent = nullptr);
+    ~WindowKeeper() override;
+
+    void keep(QQuickWindow *window);
+    // Keeps every Window declared inside root, such as the secondary
+    // windows of Main.qml.
+    void keepChildren(QObject *root);
+
+    // Estimated bytes the hidden windows keep.
+    size_t hiddenBytes() const;
+    // Releases hidden windows' resources, longest hidden first, until at
+    // least bytes are freed; returns the bytes freed.
+    size_t release(size_t bytes);
+
+private:
+    struct Kept {
+        QPointer<QQuickWindow> window;
+        uint64_t hiddenAt = 0;  // hides counted so far; 0 while shown
+        bool released = false;
+    };
+
+    static size_t bytesOf(const QQuickWindow &window);
+    void visibilityChanged(QQuickWindow *window, bool visible);
+
+    QmlCacheBudget *budget_;
+    int budgetId_ = 0;
+    std::vector<Kept> windows_;
+    uint64_t hides_ = 0;
+};
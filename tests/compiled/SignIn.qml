@@ -0,0 +1,52 @@
+import QtQuick
+import QtQuick.Controls
+
+// A fixed screen for qml_curses_compile(): the compiled render function
+// must draw exactly what the interpreter does.
+ApplicationWindow {
+    title: "Sign in"
+
+    Column {
+        anchors.centerIn: parent
+        spacing: 1
+
+        Text {
+            text: session.greeting
+            font.bold: true
+        }
+
+        Grid {
+            columns: 2
+            spacing: 1
+
+            Label { text: "User" }
+            TextField {
+                text: session.user
+                placeholderText: "name"
+                focus: true
+            }
+            Label { text: "Password" }
+            TextField { placeholderText: "password" }
+        }
+
+        Row {
+            spacing: 2
+
+            Button { text: "Sign in" }
+            Button {
+                text: "Cancel"
+                color: "red"
+            }
+        }
+
+        Text {
+            text: "Offline"
+            visible: false
+        }
+
+        Text {
+            text: "Prüfung \"läuft\" ✓"
+            color: "gray"
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <random>
+#include <vector>
+
+#include "greeter.h"
+
+namespace {
+
+// Names per run; GREETER_BENCH_NAMES overrides it.
+int nameCount() {
+    const int requested = qEnvironmentVariableIntValue("GREETER_BENCH_NAMES");
+    return requested > 0 ? requested : 1000000;
+}
+
+QStringList makeNames(int count) {
+    QStringList names;
+    names.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        names.append(QStringLiteral(" Person %1 ").arg(i));
+    }
+    return names;
+}
+
+// count names drawn from distinct ones with Zipf-like frequencies: the
+// name of rank r turns up in proportion to 1/r, as a few regulars do.
+QStringList makeSkewedNames(int count, int distinct) {
+    std::vector<double> weights(static_cast<size_t>(distinct));
+    for (int rank = 0; rank < distinct; ++rank) {
+        weights[static_cast<size_t>(rank)] = 1.0 / (rank + 1);
+    }
+    std::mt19937 random(42);
+    std::discrete_distribution<int> pick(weights.begin(), weights.end());
+    QStringList names;
+    names.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        names.append(QStringLiteral(" Person %1 ").arg(pick(random)));
+    }
+    return names;
+}
+
+// Reports names per second as the result, counted as events.
+void report(const char *what, qsizetype names, qint64 nsecs) {
+    const double perSecond = static_cast<double>(names) * 1e9 / static_cast<double>(nsecs);
+    qInfo("%s: %lld names in %.3f ms, %.0f names/s", what, static_cast<long long>(names),
+          static_cast<double>(nsecs) / 1e6, perSecond);
+    QTest::setBenchmarkResult(perSecond, QTest::Events);
+}
+
+}  // namespace
+
+// Greeting a batch job's worth of names through greet() one at a time
+// against greetMany(), single-threaded and across the thread pool.
+class GreeterBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void greet_one_by_one();
+    void greet_many_data();
+    void greet_many();
+    void greet_skewed_names_data();
+    void greet_skewed_names();
+
+private:
+    QStringList names_;
+};
+
+void GreeterBenchmark::initTestCase() {
+    names_ = makeNames(nameCount());
+}
+
+void GreeterBenchmark::greet_one_by_one() {
+    Greeter greeter;
+    QStringList greetings;
+    greetings.reserve(names_.size());
+    QElapsedTimer clock;
+    clock.start();
+    for (const QString &name : std::as_const(names_)) {
+        greetings.append(greeter.greet(name));
+    }
+    report("greet", greetings.size(), clock.nsecsElapsed());
+}
+
+void GreeterBenchmark::greet_many_data() {
+    QTest::addColumn<int>("threads");
+    QTest::newRow("one_thread") << 1;
+    QTest::newRow("executor") << 0;  // all of QmlExecutor::shared()
+}
+
+void GreeterBenchmark::greet_many() {
+    QFETCH(int, threads);
+    Greeter greeter;
+    greeter.setBatchThreads(threads);
+    QElapsedTimer clock;
+    clock.start();
+    const GreetingBatch batch = greeter.greetMany(names_);
+    report("greetMany", batch.size(), clock.nsecsElapsed());
+    QCOMPARE(batch.at(0), greeter.greet(names_.first()));
+}
+
+void GreeterBenchmark::greet_skewed_names_data() {
+    QTest::addColumn<int>("capacity");
+    QTest::newRow("uncached") << 0;
+    QTest::newRow("cache_1k") << 1024;
+}
+
+// greet() one at a time over a skewed stream of 10,000 distinct names,
+// with and without the LRU cache.
+void GreeterBenchmark::greet_skewed_names() {
+    QFETCH(int, capacity);
+    const QStringList names = makeSkewedNames(static_cast<int>(names_.size()), 10000);
+    Greeter greeter;
+    greeter.setCacheCapacity(capacity);
+    QStringList greetings;
+    greetings.reserve(names.size());
+    QElapsedTimer clock;
+    clock.start();
+    for (const QString &name : names) {
+        greetings.append(greeter.greet(name));
+    }
+    report("greet", greetings.size(), clock.nsecsElapsed());
+    if (const GreetingCache *cache = greeter.cache()) {
+        qInfo("cache: %llu hits, %llu misses", static_cast<unsigned long long>(cache->hits()),
+              static_cast<unsigned long long>(cache->misses()));
+    }
+}
+
+QTEST_GUILESS_MAIN(GreeterBenchmark)
+#include "greeter_benchmark.moc"
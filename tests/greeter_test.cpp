@@ -1,6 +1,9 @@
 #include <QtTest>
+#include <thread>
+#include <vector>
 
 #include "greeter.h"
+#include "greeting_history.h"
 
 class GreeterTest : public QObject {
     Q_OBJECT
@@ -9,6 +12,16 @@ private slots:
     void message_is_constant();
     void greet_formats_name();
     void greet_handles_empty_input();
+    void greet_many_matches_greet();
+    void greet_many_splits_large_inputs();
+    void greet_memoizes_recent_names();
+    void greeting_follows_name();
+    void greeting_is_cached();
+    void greet_async_sets_reply();
+    void newer_request_replaces_older();
+    void history_batches_appends();
+    void history_pages_through_chunks();
+    void replies_are_kept_in_history();
 };
 
 void GreeterTest::message_is_constant() {
@@ -28,5 +41,232 @@ void GreeterTest::greet_handles_empty_input() {
     QCOMPARE(greeter.greet(QStringLiteral("   ")), QStringLiteral("Hello, Qt 6!"));
 }
 
+void GreeterTest::greet_many_matches_greet() {
+    Greeter greeter;
+    const QStringList names{QStringLiteral("Ada"), QString(), QStringLiteral("  Sam  "), QStringLiteral("\u00c9mile")};
+    const GreetingBatch batch = greeter.greetMany(names);
+    QCOMPARE(batch.size(), names.size());
+    for (qsizetype i = 0; i < names.size(); ++i) {
+        QCOMPARE(batch.at(i), greeter.greet(names.at(i)));
+    }
+    QCOMPARE(batch.text(), QStringLiteral("Hello, Ada!Hello, Qt 6!Hello, Sam!Hello, \u00c9mile!"));
+
+    const QStringView views[] = {u"Bo", u" "};
+    QCOMPARE(greeter.greetMany(views, 2).toStringList(),
+             (QStringList{QStringLiteral("Hello, Bo!"), QStringLiteral("Hello, Qt 6!")}));
+    QCOMPARE(greeter.greetMany(QStringList()).size(), qsizetype(0));
+}
+
+void GreeterTest::greet_many_splits_large_inputs() {
+    Greeter greeter;
+    QStringList names;
+    for (int i = 0; i < 100000; ++i) {
+        names.append(i % 7 == 0 ? QString() : QStringLiteral(" name%1 ").arg(i));
+    }
+    const GreetingBatch batch = greeter.greetMany(names);
+    QCOMPARE(batch.size(), names.size());
+    for (qsizetype i = 0; i < names.size(); i += 997) {
+        QCOMPARE(batch.at(i), greeter.greet(names.at(i)));
+    }
+    QCOMPARE(batch.at(names.size() - 1), greeter.greet(names.last()));
+}
+
+void GreeterTest::greet_memoizes_recent_names() {
+    Greeter greeter;
+    QVERIFY(greeter.cache() == nullptr);
+    greeter.setCacheCapacity(1);
+    const GreetingCache *cache = greeter.cache();
+    QVERIFY(cache != nullptr);
+
+    // Keyed by the trimmed name; a hit shares the stored string.
+    const QString first = greeter.greet(QStringLiteral("  Ada "));
+    QCOMPARE(first, QStringLiteral("Hello, Ada!"));
+    const QString again = greeter.greet(QStringLiteral("Ada"));
+    QVERIFY(again.isSharedWith(first));
+    QCOMPARE(cache->hits(), quint64(1));
+    QCOMPARE(cache->misses(), quint64(1));
+    QCOMPARE(greeter.greet(QStringLiteral("Bo")), QStringLiteral("Hello, Bo!"));
+    QCOMPARE(cache->size(), qsizetype(1));
+    QVERIFY(!greeter.greet(QStringLiteral("Ada")).isSharedWith(first));  // evicted by Bo
+    QCOMPARE(greeter.greet(QString()), QStringLiteral("Hello, Qt 6!"));
+
+    // A name used between others stays while the rest are evicted.
+    greeter.setCacheCapacity(64);
+    cache = greeter.cache();
+    const QString kept = greeter.greet(QStringLiteral("Kept"));
+    for (int i = 0; i < 1000; ++i) {
+        greeter.greet(QStringLiteral("name%1").arg(i));
+        QVERIFY(greeter.greet(QStringLiteral("Kept")).isSharedWith(kept));
+    }
+    QCOMPARE(cache->size(), qsizetype(64));
+    QCOMPARE(cache->hits(), quint64(1000));
+    QCOMPARE(greeter.greet(QStringLiteral("name0")), QStringLiteral("Hello, name0!"));
+    QCOMPARE(cache->misses(), quint64(1002));
+
+    // Threads share it, through greetLater() too.
+    greeter.setCacheCapacity(256);
+    cache = greeter.cache();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&greeter] {
+            for (int i = 0; i < 1000; ++i) {
+                const QString name = QStringLiteral("name%1").arg(i % 50);
+                if (greeter.greet(name) != QStringLiteral("Hello, %1!").arg(name)) {
+                    qFatal("wrong greeting for %s", qPrintable(name));
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    QFuture<QString> later = greeter.greetLater(QStringLiteral("name7"));
+    QCOMPARE(later.result(), QStringLiteral("Hello, name7!"));
+    QCOMPARE(cache->hits() + cache->misses(), quint64(4001));
+    QVERIFY(cache->misses() >= 50 && cache->misses() <= 200);
+    QCOMPARE(cache->size(), qsizetype(50));
+
+    // A QmlCacheBudget frees bytes, least recently used entries first.
+    GreetingCache *budgeted = greeter.cache();
+    const size_t bytes = budgeted->byteSize();
+    const size_t freed = budgeted->evict(bytes / 2);
+    QVERIFY(freed >= bytes / 2 && freed < bytes);
+    QCOMPARE(budgeted->byteSize(), bytes - freed);
+    QVERIFY(budgeted->size() < 50);
+    QCOMPARE(budgeted->evict(bytes), bytes - freed);
+    QCOMPARE(budgeted->size(), qsizetype(0));
+    QCOMPARE(budgeted->byteSize(), size_t(0));
+
+    greeter.setCacheCapacity(0);
+    QVERIFY(greeter.cache() == nullptr);
+}
+
+void GreeterTest::greeting_follows_name() {
+    Greeter greeter;
+    QCOMPARE(greeter.greeting(), QStringLiteral("Hello, Qt 6!"));
+
+    QSignalSpy changed(&greeter, &Greeter::greetingChanged);
+    greeter.setName(QStringLiteral("Ada"));
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(greeter.greeting(), QStringLiteral("Hello, Ada!"));
+
+    QProperty<QString> source(QStringLiteral("Bo"));
+    greeter.bindableName().setBinding([&source] { return source.value(); });
+    QCOMPARE(greeter.greeting(), QStringLiteral("Hello, Bo!"));
+    source = QStringLiteral("Cy");
+    QCOMPARE(greeter.name(), QStringLiteral("Cy"));
+    QCOMPARE(greeter.greeting(), QStringLiteral("Hello, Cy!"));
+}
+
+void GreeterTest::greeting_is_cached() {
+    Greeter greeter;
+    int evaluations = 0;
+    QProperty<QString> echo;
+    echo.setBinding([&] {
+        ++evaluations;
+        return greeter.bindableGreeting().value();
+    });
+    QCOMPARE(evaluations, 1);
+
+    // Reads between changes are served from the cached value.
+    QCOMPARE(echo.value(), QStringLiteral("Hello, Qt 6!"));
+    QCOMPARE(echo.value(), QStringLiteral("Hello, Qt 6!"));
+    QCOMPARE(evaluations, 1);
+
+    // Changes inside a group update once, when it ends.
+    Qt::beginPropertyUpdateGroup();
+    greeter.setName(QStringLiteral("A"));
+    greeter.setName(QStringLiteral("Ada"));
+    Qt::endPropertyUpdateGroup();
+    QCOMPARE(echo.value(), QStringLiteral("Hello, Ada!"));
+    QCOMPARE(evaluations, 2);
+}
+
+void GreeterTest::greet_async_sets_reply() {
+    Greeter greeter;
+    QSignalSpy busy(&greeter, &Greeter::busyChanged);
+    greeter.greetAsync(QStringLiteral("Ada"));
+    QVERIFY(greeter.busy());
+    QTRY_COMPARE(greeter.reply(), QStringLiteral("Hello, Ada!"));
+    QVERIFY(!greeter.busy());
+    QCOMPARE(busy.count(), 2);
+
+    QCOMPARE(greeter.greetLater(QStringLiteral("Bo")).result(), QStringLiteral("Hello, Bo!"));
+}
+
+void GreeterTest::newer_request_replaces_older() {
+    Greeter greeter;
+    greeter.setServiceLatency(std::chrono::milliseconds(100));
+    QSignalSpy replies(&greeter, &Greeter::replyChanged);
+    QSignalSpy busy(&greeter, &Greeter::busyChanged);
+    greeter.greetAsync(QStringLiteral("Ada"));
+    greeter.greetAsync(QStringLiteral("Bo"));
+    QTRY_VERIFY(!greeter.busy());
+    QCOMPARE(replies.count(), 1);
+    QCOMPARE(greeter.reply(), QStringLiteral("Hello, Bo!"));
+    QCOMPARE(busy.count(), 2);
+
+    QFuture<QString> cancelled = greeter.greetLater(QStringLiteral("Cy"));
+    cancelled.cancel();
+    cancelled.waitForFinished();
+    QVERIFY(cancelled.isCanceled());
+    QCOMPARE(cancelled.resultCount(), 0);
+}
+
+void GreeterTest::history_batches_appends() {
+    GreetingHistory history;
+    QSignalSpy inserted(&history, &QAbstractItemModel::rowsInserted);
+    history.append(QStringLiteral("a"));
+    history.append(QStringLiteral("b"));
+    history.append(QStringLiteral("c"));
+    QCOMPARE(history.count(), 3);
+    QCOMPARE(history.rowCount(), 0);  // announced on the next turn
+
+    QTRY_COMPARE(inserted.count(), 1);
+    QCOMPARE(inserted.first().at(1).toInt(), 0);
+    QCOMPARE(inserted.first().at(2).toInt(), 2);
+    QCOMPARE(history.rowCount(), 3);
+    QCOMPARE(history.data(history.index(1), GreetingHistory::GreetingRole).toString(), QStringLiteral("b"));
+    QCOMPARE(history.roleNames().value(GreetingHistory::GreetingRole), QByteArrayLiteral("greeting"));
+}
+
+void GreeterTest::history_pages_through_chunks() {
+    GreetingHistory history;
+    QStringList greetings;
+    const int total = 3 * GreetingHistory::kChunkRows + 7;
+    for (int i = 0; i < total; ++i) {
+        greetings.append(QString::number(i));
+    }
+    QSignalSpy inserted(&history, &QAbstractItemModel::rowsInserted);
+    history.append(greetings);
+    QCOMPARE(history.count(), total);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(history.rowCount(), GreetingHistory::kPageRows);
+    QVERIFY(history.canFetchMore(QModelIndex()));
+    QVERIFY(!history.data(history.index(GreetingHistory::kPageRows)).isValid());
+
+    while (history.canFetchMore(QModelIndex())) {
+        history.fetchMore(QModelIndex());
+    }
+    QCOMPARE(history.rowCount(), total);
+    for (int row : {0, GreetingHistory::kChunkRows - 1, GreetingHistory::kChunkRows, total - 1}) {
+        QCOMPARE(history.at(row), QString::number(row));
+    }
+
+    // The views are at the end, so the next append reaches them.
+    history.append(QStringLiteral("last"));
+    QTRY_COMPARE(history.rowCount(), total + 1);
+}
+
+void GreeterTest::replies_are_kept_in_history() {
+    Greeter greeter;
+    GreetingHistory *history = greeter.history();
+    QVERIFY(history);
+    QCOMPARE(history->parent(), &greeter);
+    greeter.greetAsync(QStringLiteral("Ada"));
+    QTRY_COMPARE(history->rowCount(), 1);
+    QCOMPARE(history->at(0), QStringLiteral("Hello, Ada!"));
+}
+
 QTEST_GUILESS_MAIN(GreeterTest)
 #include "greeter_test.moc"
@@ -1,66 +1,325 @@
 #include <QtTest>
-#include <QQmlApplicationEngine>
-#include <QQmlContext>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQmlComponent>
+#include <QQmlEngine>
 #include <QQuickItem>
 #include <QQuickWindow>
+#include <QtQml/qqmlextensionplugin.h>
 
+#include <memory>
+#include <thread>
+
+#include "binding_profiler.h"
+#include "frame_incubator.h"
+#include "frame_property_batch.h"
 #include "greeter.h"
+#include "qml_test_fixture.h"
+
+#ifdef SAMPLE_HAVE_QML_CURSES
+#include "qml_buffer_screen.h"
+#include "qml_curses_frontend.h"
+#include "qml_live_tree.h"
+#endif
+
+Q_IMPORT_QML_PLUGIN(SamplePlugin)
 
 class MainQmlTest : public QObject {
     Q_OBJECT
 
 private slots:
     void initTestCase();
-    void cleanupTestCase();
+    void init();
+    void cleanup();
+    void window_greeter_is_the_singleton();
     void default_label_matches_greeter();
     void clicking_button_updates_output();
+    void lazy_panel_incubates_across_frames();
+    void property_batch_applies_once_per_frame();
+    void binding_profiler_counts_changes();
+    void curses_view_follows_live_tree();
 
 private:
-    QQmlApplicationEngine engine_;
     QQuickWindow *window_ = nullptr;
-    Greeter greeter_;
+    Greeter *greeter_ = nullptr;
 };
 
 void MainQmlTest::initTestCase() {
-    engine_.rootContext()->setContextProperty("greeter", &greeter_);
-    engine_.load(QUrl(QStringLiteral("qrc:/qml/Main.qml")));
-
-    const auto roots = engine_.rootObjects();
-    QVERIFY(!roots.isEmpty());
+    QmlTestFixture &fixture = QmlTestFixture::instance();
+    QVERIFY(fixture.component(QStringLiteral("Sample"), QStringLiteral("Main")));
+    greeter_ = fixture.engine().singletonInstance<Greeter *>("Sample", "Greeter");
+    QVERIFY(greeter_);
+}
 
-    window_ = qobject_cast<QQuickWindow *>(roots.first());
+// Every test case gets its own window from the one compiled Main.
+void MainQmlTest::init() {
+    window_ = qobject_cast<QQuickWindow *>(QmlTestFixture::instance().create(
+        QStringLiteral("Sample"), QStringLiteral("Main"), {{QStringLiteral("visible"), false}}));
     QVERIFY(window_);
-
-    window_->show();
-    QVERIFY(QTest::qWaitForWindowActive(window_));
+    QVERIFY(QmlTestFixture::show(window_));
 }
 
-void MainQmlTest::cleanupTestCase() {
+void MainQmlTest::cleanup() {
     window_ = nullptr;
-    engine_.clearComponentCache();
+    QmlTestFixture::instance().reset();
+}
+
+void MainQmlTest::window_greeter_is_the_singleton() {
+    QCOMPARE(window_->property("greeter").value<Greeter *>(), greeter_);
 }
 
 void MainQmlTest::default_label_matches_greeter() {
     auto greetingText = window_->findChild<QObject *>("greetingText");
     QVERIFY(greetingText);
-    QCOMPARE(greetingText->property("text").toString(), greeter_.message());
+    QCOMPARE(greetingText->property("text").toString(), greeter_->message());
 }
 
 void MainQmlTest::clicking_button_updates_output() {
     auto nameField = window_->findChild<QObject *>("nameField");
     auto helloButton = window_->findChild<QObject *>("helloButton");
-    auto outputLabel = window_->findChild<QObject *>("outputLabel");
+    auto historyView = window_->findChild<QObject *>("historyView");
 
     QVERIFY(nameField);
     QVERIFY(helloButton);
-    QVERIFY(outputLabel);
+    QVERIFY(historyView);
+    QCOMPARE(historyView->property("model").value<QObject *>(), greeter_->history());
+    const int before = greeter_->history()->count();
 
     nameField->setProperty("text", QStringLiteral("Ada"));
 
     const bool invoked = QMetaObject::invokeMethod(helloButton, "click");
     QVERIFY(invoked);
 
-    QTRY_COMPARE(outputLabel->property("text").toString(), QStringLiteral("Hello, Ada!"));
+    QTRY_COMPARE(historyView->property("count").toInt(), before + 1);
+    QCOMPARE(greeter_->history()->at(before), QStringLiteral("Hello, Ada!"));
+}
+
+void MainQmlTest::lazy_panel_incubates_across_frames() {
+    // Its own engine: the incubation controller is per engine.
+    QQmlEngine engine;
+    FrameIncubator incubator(std::chrono::milliseconds(1));
+    engine.setIncubationController(&incubator);
+    QQmlComponent component(&engine);
+    component.setData(R"(
+import QtQuick
+import Sample
+
+Window {
+    width: 200
+    height: 200
+    visible: true
+
+    LazyPanel {
+        objectName: "panel"
+        sourceComponent: Column {
+            Repeater {
+                model: 2000
+                Rectangle {
+                    width: 10
+                    height: 1
+                }
+            }
+        }
+    }
+}
+)",
+                      QUrl());
+    const std::unique_ptr<QObject> root(component.create());
+    auto *window = qobject_cast<QQuickWindow *>(root.get());
+    QVERIFY2(window, qPrintable(component.errorString()));
+    auto *panel = window->findChild<QQuickItem *>(QStringLiteral("panel"));
+    QVERIFY(panel);
+
+    // Nothing is built until the window's frames give it time.
+    QVERIFY(!panel->isVisible());
+    incubator.attach(window);
+    QVERIFY(QTest::qWaitForWindowExposed(window));
+    QTRY_VERIFY(panel->isVisible());
+    QCOMPARE(panel->property("item").value<QQuickItem *>()->childItems().size(), 2001);
+    QVERIFY2(incubator.framesUsed() > 1, qPrintable(QString::number(incubator.framesUsed())));
+}
+
+void MainQmlTest::property_batch_applies_once_per_frame() {
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(R"(
+import QtQuick
+
+Window {
+    width: 100
+    height: 100
+    visible: true
+
+    Item {
+        objectName: "target"
+        property int value: 0
+        property string label: ""
+        property int doubled: value * 2
+        property int doubledChanges: 0
+        onDoubledChanged: ++doubledChanges
+    }
+}
+)",
+                      QUrl());
+    const std::unique_ptr<QObject> root(component.create());
+    auto *window = qobject_cast<QQuickWindow *>(root.get());
+    QVERIFY2(window, qPrintable(component.errorString()));
+    QObject *target = window->findChild<QObject *>(QStringLiteral("target"));
+    QVERIFY(target);
+
+    FramePropertyBatch batch;
+    batch.attach(window);
+    QVERIFY(QTest::qWaitForWindowExposed(window));
+    QVERIFY(!batch.set(target, "missing", 1));
+
+    // A thousand updates to one property are one write, and one binding
+    // evaluation, at the next frame.
+    for (int i = 1; i <= 1000; ++i) {
+        QVERIFY(batch.set(target, "value", i));
+    }
+    QVERIFY(batch.set(target, "label", QStringLiteral("last")));
+    QCOMPARE(batch.pending(), 2);
+    QCOMPARE(batch.coalescedCount(), quint64(999));
+    QCOMPARE(target->property("value").toInt(), 0);
+    QTRY_COMPARE(target->property("doubled").toInt(), 2000);
+    QCOMPARE(target->property("doubledChanges").toInt(), 1);
+    QCOMPARE(target->property("label").toString(), QStringLiteral("last"));
+    QCOMPARE(batch.appliedCount(), quint64(2));
+    QCOMPARE(batch.pending(), 0);
+
+    // From a backend thread.
+    std::thread backend([&batch, target] {
+        for (int i = 0; i < 500; ++i) {
+            batch.set(target, "value", 3000 + i);
+        }
+    });
+    backend.join();
+    QTRY_COMPARE(target->property("value").toInt(), 3499);
+    QCOMPARE(target->property("doubledChanges").toInt(), 2);
+
+    // Without a window, at the next turn of the event loop. greeting,
+    // bound to name, changes once for both sets.
+    QSignalSpy greetings(greeter_, &Greeter::greetingChanged);
+    FramePropertyBatch unattached;
+    QVERIFY(unattached.set(greeter_, "name", QStringLiteral("Gr")));
+    QVERIFY(unattached.set(greeter_, "name", QStringLiteral("Grace")));
+    QTRY_COMPARE(greeter_->greeting(), greeter_->greet(QStringLiteral("Grace")));
+    QCOMPARE(greetings.count(), 1);
+    QCOMPARE(unattached.framesApplied(), 1);
+}
+
+void MainQmlTest::binding_profiler_counts_changes() {
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(R"(
+import QtQuick
+
+Window {
+    width: 100
+    height: 100
+    visible: true
+
+    Item {
+        id: source
+        objectName: "source"
+        property int value: 0
+    }
+    Repeater {
+        model: 3
+        Item { property int doubled: source.value * 2 }
+    }
+    Loader {
+        active: source.value > 3
+        sourceComponent: Item { property int tripled: source.value * 3 }
+    }
+}
+)",
+                      QUrl(QStringLiteral("qrc:/Storm.qml")));
+    const std::unique_ptr<QObject> root(component.create());
+    auto *window = qobject_cast<QQuickWindow *>(root.get());
+    QVERIFY2(window, qPrintable(component.errorString()));
+    QObject *source = window->findChild<QObject *>(QStringLiteral("source"));
+    QVERIFY(source);
+
+    BindingProfiler profiler;
+    profiler.attach(window);
+    QVERIFY(QTest::qWaitForWindowExposed(window));
+    const int framesBefore = profiler.frames();
+    for (int i = 1; i <= 5; ++i) {
+        source->setProperty("value", i);
+    }
+    QTRY_VERIFY(profiler.frames() > framesBefore);
+
+    const auto find = [&profiler](const QString &property) {
+        for (const BindingProfiler::Entry &entry : profiler.entries()) {
+            if (entry.property == property) {
+                return entry;
+            }
+        }
+        return BindingProfiler::Entry{};
+    };
+    const BindingProfiler::Entry value = find(QStringLiteral("value"));
+    QCOMPARE(value.object, QStringLiteral("Storm.qml source (QQuickItem)"));
+    QCOMPARE(value.changes, quint64(5));
+    QCOMPARE(value.maxPerFrame, 5);
+    QCOMPARE(value.framesChanged, 1);
+    // The three delegates add up under one entry.
+    const BindingProfiler::Entry doubled = find(QStringLiteral("doubled"));
+    QCOMPARE(doubled.object, QStringLiteral("Storm.qml (QQuickItem)"));
+    QCOMPARE(doubled.changes, quint64(15));
+    // Loaded at 4, after the profiler was attached; changed once, at 5.
+    QCOMPARE(find(QStringLiteral("tripled")).changes, quint64(1));
+
+    const QJsonArray properties =
+        QJsonDocument::fromJson(profiler.toJson()).object().value(QStringLiteral("properties")).toArray();
+    QVERIFY(!properties.isEmpty());
+    QCOMPARE(properties.first().toObject().value(QStringLiteral("property")).toString(), QStringLiteral("doubled"));
+}
+
+void MainQmlTest::curses_view_follows_live_tree() {
+#ifdef SAMPLE_HAVE_QML_CURSES
+    QmlLiveTree tree(window_);
+    QmlBufferScreen screen(20, 60);
+    QmlCursesFrontend frontend(screen, tree.bridge());
+    tree.bridge().setChangedHandler([&](const std::string &binding) { frontend.invalidateBinding(binding); });
+    const auto shows = [&](const QString &text) {
+        frontend.render(tree.document());
+        return QString::fromStdString(screen.text()).contains(text);
+    };
+
+    QVERIFY2(shows(greeter_->message()), screen.text().c_str());
+    QVERIFY(tree.object("nameField"));
+    QVERIFY(tree.object("helloButton"));
+
+    // A property the engine changes is redrawn without rebuilding the mirror.
+    const size_t rebuilds = tree.rebuildCount();
+    window_->findChild<QObject *>("nameField")->setProperty("text", QStringLiteral("Ada"));
+    QVERIFY2(shows(QStringLiteral("Ada")), screen.text().c_str());
+    QCOMPARE(tree.rebuildCount(), rebuilds);
+
+    // Activating the Button clicks the live one; the new delegate shows up.
+    const QmlNode *button = tree.document().findById("helloButton");
+    QVERIFY(button && button->findScript(QmlAtoms::onClicked));
+    tree.activate("helloButton", *button->findScript(QmlAtoms::onClicked));
+    QTRY_VERIFY2(shows(QStringLiteral("Hello, Ada!")), screen.text().c_str());
+    QVERIFY(tree.rebuildCount() > rebuilds);
+
+    // A destroyed item's name is dropped and free for the next item.
+    QQmlComponent extra(&QmlTestFixture::instance().engine());
+    extra.setData("import QtQuick\nText { objectName: \"extra\"; text: \"Extra\" }\n", QUrl());
+    for (int round = 0; round < 2; ++round) {
+        std::unique_ptr<QQuickItem> item(qobject_cast<QQuickItem *>(extra.create()));
+        QVERIFY2(item, qPrintable(extra.errorString()));
+        item->setParentItem(window_->contentItem());
+        QVERIFY2(shows(QStringLiteral("Extra")), screen.text().c_str());
+        QCOMPARE(tree.object("extra"), item.get());
+        item.reset();
+        QVERIFY(tree.object("extra") == nullptr);
+    }
+#else
+    QSKIP("Built without the curses frontend");
+#endif
 }
 
 QTEST_MAIN(MainQmlTest)
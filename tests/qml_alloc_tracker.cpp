@@ -0,0 +1,110 @@
+#include "qml_alloc_tracker.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local QmlAllocationCounts threadCounts;
+std::atomic<long long> processAllocations{0};
+std::atomic<long long> processBytes{0};
+std::atomic<long long> processDeallocations{0};
+
+void *countedAllocate(std::size_t size) {
+    ++threadCounts.allocations;
+    threadCounts.bytes += static_cast<long long>(size);
+    processAllocations.fetch_add(1, std::memory_order_relaxed);
+    processBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+// Over-allocates from malloc and keeps the block's start just below the
+// aligned pointer, so the same code serves every platform's C library.
+void *countedAllocateAligned(std::size_t size, std::size_t alignment) {
+    ++threadCounts.allocations;
+    threadCounts.bytes += static_cast<long long>(size);
+    processAllocations.fetch_add(1, std::memory_order_relaxed);
+    processBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    void *block = std::malloc(size + alignment + sizeof(void *));
+    if (!block) {
+        return nullptr;
+    }
+    const auto start = reinterpret_cast<std::uintptr_t>(block) + sizeof(void *);
+    void *aligned = reinterpret_cast<void *>((start + alignment - 1) & ~(std::uintptr_t(alignment) - 1));
+    static_cast<void **>(aligned)[-1] = block;
+    return aligned;
+}
+
+void countedFreeAligned(void *ptr) {
+    if (ptr) {
+        ++threadCounts.deallocations;
+        processDeallocations.fetch_add(1, std::memory_order_relaxed);
+        std::free(static_cast<void **>(ptr)[-1]);
+    }
+}
+
+void countedFree(void *ptr) {
+    if (ptr) {
+        ++threadCounts.deallocations;
+        processDeallocations.fetch_add(1, std::memory_order_relaxed);
+        std::free(ptr);
+    }
+}
+
+}  // namespace
+
+QmlAllocationScope::QmlAllocationScope() : start_(threadCounts) {}
+
+QmlAllocationCounts QmlAllocationScope::counts() const {
+    const QmlAllocationCounts now = threadCounts;
+    return {now.allocations - start_.allocations, now.bytes - start_.bytes,
+            now.deallocations - start_.deallocations};
+}
+
+void QmlAllocationScope::reset() {
+    start_ = threadCounts;
+}
+
+QmlAllocationCounts QmlAllocationScope::threadTotals() {
+    return threadCounts;
+}
+
+QmlAllocationCounts QmlAllocationScope::processTotals() {
+    return {processAllocations.load(std::memory_order_relaxed), processBytes.load(std::memory_order_relaxed),
+            processDeallocations.load(std::memory_order_relaxed)};
+}
+
+// The array and nothrow forms default to these, so replacing the plain
+// and aligned pairs counts every allocation made through new. The default
+// std::pmr resource allocates through the aligned form.
+void *operator new(std::size_t size) {
+    if (void *ptr = countedAllocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    countedFree(ptr);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    if (void *ptr = countedAllocateAligned(size, static_cast<std::size_t>(alignment))) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+    countedFreeAligned(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+    countedFreeAligned(ptr);
+}
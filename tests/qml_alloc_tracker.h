@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// Test-only heap accounting. Linking qml_alloc_tracker replaces the global
+// operator new and delete with versions that count, per thread, every
+// allocation and the bytes requested; nothing else changes, so production
+// targets never link it.
+//
+//   QmlAllocationScope scope;
+//   frontend.render(doc);
+//   QCOMPARE(scope.allocations(), 0LL);
+//
+// Counts are per thread so work on other threads, such as QtTest's logger
+// or a parser pool, does not leak into a scope. Use processTotals() to
+// count every thread.
+struct QmlAllocationCounts {
+    long long allocations = 0;
+    long long bytes = 0;
+    long long deallocations = 0;
+};
+
+class QmlAllocationScope {
+public:
+    QmlAllocationScope();
+
+    // Since construction or the last reset(), on the constructing thread.
+    QmlAllocationCounts counts() const;
+    long long allocations() const { return counts().allocations; }
+    long long bytes() const { return counts().bytes; }
+    void reset();
+
+    // Running totals since the process started.
+    static QmlAllocationCounts threadTotals();
+    static QmlAllocationCounts processTotals();
+
+private:
+    QmlAllocationCounts start_;
+};
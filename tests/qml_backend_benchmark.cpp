@@ -0,0 +1,360 @@
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <curses.h>
+
+#include "qml_buffer_screen.h"
+#include "qml_console_screen.h"
+#include "qml_curses_frontend.h"
+#include "qml_parser.h"
+#include "qml_screen_trace.h"
+#include "qml_vt_screen.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#undef MOUSE_MOVED  // curses.h and wincon.h both define it
+#include <io.h>
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+
+constexpr int kRows = 50;
+constexpr int kCols = 120;
+constexpr int kFrames = 200;
+
+// Each backend replays each trace for at least this long;
+// QML_BACKEND_BENCHMARK_MS overrides it.
+std::chrono::milliseconds minimumTime() {
+    const int requested = qEnvironmentVariableIntValue("QML_BACKEND_BENCHMARK_MS");
+    return std::chrono::milliseconds(requested > 0 ? requested : 500);
+}
+
+// CPU time of the whole process, user and kernel; clock() is wall time
+// on Windows.
+std::chrono::nanoseconds cpuTime() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    const auto ticks = [](const FILETIME &time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return std::chrono::nanoseconds((ticks(kernel) + ticks(user)) * 100);
+#else
+    timespec now{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+#endif
+}
+
+// Records kFrames frames of a frontend driven by step(frame) before each.
+std::string record(const std::string &qml, const std::function<std::string(const std::string &)> &resolve,
+                   const std::function<void(QmlCursesFrontend &, int)> &step) {
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    std::string trace;
+    QmlBufferScreen target(kRows, kCols);
+    {
+        QmlRecordingScreen recorder(target, [&trace](std::string_view bytes) { trace.append(bytes); });
+        QmlCursesFrontend frontend(recorder, resolve);
+        for (int frame = 0; frame < kFrames; ++frame) {
+            step(frontend, frame);
+            frontend.render(doc);
+        }
+    }
+    return trace;
+}
+
+// Counts what it is sent and draws nothing, like the tests' mocks.
+class MockScreen final : public ICursesScreen {
+public:
+    MockScreen(int rows, int cols, size_t &bytes) : rows_(rows), cols_(cols), bytes_(bytes) {}
+
+    void clear() override {}
+    void drawText(int, int, const std::string &text) override { bytes_ += text.size(); }
+    void drawRuns(const ScreenRun *runs, size_t count) override {
+        for (size_t i = 0; i < count; ++i) {
+            bytes_ += runs[i].text.size();
+        }
+    }
+    void refresh() override {}
+    int rows() const override { return rows_; }
+    int cols() const override { return cols_; }
+
+private:
+    int rows_;
+    int cols_;
+    size_t &bytes_;
+};
+
+// The rectangles go into a console-sized buffer, as WriteConsoleOutputW
+// would copy them; bytes are the CHAR_INFO cells committed.
+class ConsoleScreen final : public ICursesScreen {
+public:
+    ConsoleScreen(int rows, int cols, size_t &bytes)
+        : console_(static_cast<size_t>(rows * cols)),
+          screen_(rows, cols, [this, &bytes](const QmlConsoleCell *cells, int width, const QmlConsoleRect &rect) {
+              for (int row = rect.top; row <= rect.bottom; ++row) {
+                  std::copy(cells + row * width + rect.left, cells + row * width + rect.right + 1,
+                            console_.begin() + row * width + rect.left);
+              }
+              bytes += static_cast<size_t>((rect.bottom - rect.top + 1) * (rect.right - rect.left + 1)) *
+                       sizeof(QmlConsoleCell);
+          }) {}
+
+    void clear() override { screen_.clear(); }
+    void drawText(int row, int col, const std::string &text) override { screen_.drawText(row, col, text); }
+    void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override {
+        screen_.drawStyledText(row, col, text, attributes);
+    }
+    void drawRuns(const ScreenRun *runs, size_t count) override { screen_.drawRuns(runs, count); }
+    void refresh() override { screen_.refresh(); }
+    int rows() const override { return screen_.rows(); }
+    int cols() const override { return screen_.cols(); }
+
+private:
+    std::vector<QmlConsoleCell> console_;
+    QmlConsoleScreen screen_;
+};
+
+class VtBackend final : public ICursesScreen {
+public:
+    VtBackend(int rows, int cols, size_t &bytes)
+        : screen_(rows, cols, [&bytes](std::string_view frame) { bytes += frame.size(); }) {}
+
+    void clear() override { screen_.clear(); }
+    void drawText(int row, int col, const std::string &text) override { screen_.drawText(row, col, text); }
+    void drawStyledText(int row, int col, const std::string &text, uint32_t attributes) override {
+        screen_.drawStyledText(row, col, text, attributes);
+    }
+    void drawRuns(const ScreenRun *runs, size_t count) override { screen_.drawRuns(runs, count); }
+    void refresh() override { screen_.refresh(); }
+    int rows() const override { return screen_.rows(); }
+    int cols() const override { return screen_.cols(); }
+
+private:
+    VtScreen screen_;
+};
+
+#ifdef _WIN32
+// PDCursesMod's WinCon port draws on the console this runs in; what it
+// writes there is not counted. One session for the whole run, as
+// PDCurses has a single screen.
+class CursesScreen final : public PdcursesScreen {
+public:
+    static constexpr bool kCountsBytes = false;
+
+    static std::unique_ptr<ICursesScreen> make(int rows, int cols, size_t &) {
+        if (!_isatty(_fileno(stdout)) || (stdscr == nullptr && initscr() == nullptr)) {
+            return nullptr;
+        }
+        resize_term(rows, cols);
+        return std::make_unique<CursesScreen>();
+    }
+};
+#else
+// ncurses on a terminal of the trace's size, writing to a temporary file
+// that stands in for the tty; bytes are what it wrote there.
+class CursesScreen final : public PdcursesScreen {
+public:
+    static constexpr bool kCountsBytes = true;
+
+    static std::unique_ptr<ICursesScreen> make(int rows, int cols, size_t &bytes) {
+        FILE *out = std::tmpfile();
+        FILE *in = std::fopen("/dev/null", "r");
+        SCREEN *session = out && in ? newterm("xterm-256color", out, in) : nullptr;
+        if (!session) {
+            if (out) {
+                std::fclose(out);
+            }
+            if (in) {
+                std::fclose(in);
+            }
+            return nullptr;
+        }
+        set_term(session);
+        resizeterm(rows, cols);
+        return std::unique_ptr<ICursesScreen>(new CursesScreen(session, out, in, bytes));
+    }
+
+    ~CursesScreen() override {
+        endwin();
+        std::fflush(out_);
+        bytes_ += static_cast<size_t>(std::ftell(out_));
+        delscreen(session_);
+        std::fclose(out_);
+        std::fclose(in_);
+    }
+
+private:
+    CursesScreen(SCREEN *session, FILE *out, FILE *in, size_t &bytes)
+        : session_(session), out_(out), in_(in), bytes_(bytes) {}
+
+    SCREEN *session_;
+    FILE *out_;
+    FILE *in_;
+    size_t &bytes_;
+};
+#endif
+
+struct Backend {
+    const char *name;
+    // Null where the backend is not available.
+    std::function<std::unique_ptr<ICursesScreen>(int rows, int cols, size_t &bytes)> make;
+    bool countsBytes = true;
+};
+
+template <typename Screen>
+std::unique_ptr<ICursesScreen> makeScreen(int rows, int cols, size_t &bytes) {
+    return std::make_unique<Screen>(rows, cols, bytes);
+}
+
+}  // namespace
+
+// Replays the same frame streams through every ICursesScreen backend and
+// prints one table of frames per second, bytes emitted and CPU time per
+// frame. The streams are recorded here, from a frontend typing, scrolling
+// and repainting everything; traces recorded with `sample_cli --record`
+// are added from QML_SCREEN_TRACES, a list of paths.
+class QmlBackendBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void backend_matrix();
+
+private:
+    struct Trace {
+        std::string name;
+        std::string bytes;
+    };
+
+    std::vector<Trace> traces_;
+};
+
+void QmlBackendBenchmark::initTestCase() {
+    std::string form = "ApplicationWindow {\n    title: \"Form\"\n    Column {\n";
+    for (int i = 0; i < 20; ++i) {
+        form += "        Text { text: \"Field " + std::to_string(i) + "\" }\n";
+    }
+    form += "        Text { text: typed }\n    }\n}\n";
+    std::string typed;
+    traces_.push_back(Trace{"typing", record(form, [&typed](const std::string &) { return typed; },
+                                             [&typed](QmlCursesFrontend &frontend, int frame) {
+                                                 typed.push_back(static_cast<char>('a' + frame % 26));
+                                                 frontend.invalidateBinding("typed");
+                                             })});
+
+    std::string list = "ApplicationWindow {\n    title: \"List\"\n    Column {\n        spacing: 0\n";
+    for (int i = 0; i < kFrames + kRows; ++i) {
+        list += "        Text { text: \"Row " + std::to_string(i) + " of the scrolling list\" }\n";
+    }
+    list += "    }\n}\n";
+    traces_.push_back(Trace{"scrolling", record(list, nullptr, [](QmlCursesFrontend &frontend, int frame) {
+                                                    frontend.setScrollOffset(static_cast<size_t>(frame));
+                                                })});
+
+    std::string grid = "ApplicationWindow {\n    Grid {\n        columns: 6\n";
+    for (int i = 0; i < 6 * (kRows - 2); ++i) {
+        grid += "        Text { text: cell" + std::to_string(i) + " }\n";
+    }
+    grid += "    }\n}\n";
+    int tick = 0;
+    traces_.push_back(Trace{"full repaint",
+                            record(grid,
+                                   [&tick](const std::string &binding) {
+                                       return binding + ':' + std::to_string(tick * 7919 % 100000);
+                                   },
+                                   [&tick](QmlCursesFrontend &frontend, int frame) {
+                                       tick = frame;
+                                       frontend.invalidateAllBindings();
+                                   })});
+
+    const QStringList paths = qEnvironmentVariable("QML_SCREEN_TRACES").split(QDir::listSeparator(), Qt::SkipEmptyParts);
+    for (const QString &path : paths) {
+        QFile file(path);
+        QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(path));
+        const QByteArray bytes = file.readAll();
+        traces_.push_back(Trace{QFileInfo(path).fileName().toStdString(), bytes.toStdString()});
+    }
+}
+
+void QmlBackendBenchmark::backend_matrix() {
+#ifdef _WIN32
+    const char *curses = "PdcursesScreen (PDCursesMod WinCon)";
+#else
+    const char *curses = "PdcursesScreen (ncurses)";
+#endif
+    const Backend backends[] = {
+        {"mock", makeScreen<MockScreen>},
+        {curses, CursesScreen::make, CursesScreen::kCountsBytes},
+        {"VtScreen", makeScreen<VtBackend>},
+        {"QmlConsoleScreen", makeScreen<ConsoleScreen>},
+    };
+
+    std::vector<std::string> table;
+    char line[160];
+    std::snprintf(line, sizeof line, "%-36s %-16s %12s %12s %14s", "backend", "trace", "frames/s", "bytes/frame",
+                  "CPU us/frame");
+    table.emplace_back(line);
+    for (const Trace &trace : traces_) {
+        QmlScreenReplay replay;
+        QVERIFY2(replay.load(trace.bytes), trace.name.c_str());
+        QVERIFY(replay.frames() > 0);
+        for (const Backend &backend : backends) {
+            size_t bytes = 0;
+            size_t frames = 0;
+            const auto cpuStart = cpuTime();
+            const auto start = std::chrono::steady_clock::now();
+            std::chrono::duration<double> elapsed{0};
+            {
+                std::unique_ptr<ICursesScreen> screen = backend.make(replay.rows(), replay.cols(), bytes);
+                if (!screen) {
+                    std::snprintf(line, sizeof line, "%-36s %-16s %12s", backend.name, trace.name.c_str(),
+                                  "unavailable");
+                    table.emplace_back(line);
+                    continue;
+                }
+                do {
+                    replay.play(*screen);
+                    frames += replay.frames();
+                    elapsed = std::chrono::steady_clock::now() - start;
+                } while (elapsed < minimumTime());
+            }  // ncurses counts its output once the session ends
+            const double cpu = std::chrono::duration<double, std::micro>(cpuTime() - cpuStart).count();
+            const double perFrame = static_cast<double>(frames);
+            if (backend.countsBytes) {
+                std::snprintf(line, sizeof line, "%-36s %-16s %12.0f %12.0f %14.2f", backend.name, trace.name.c_str(),
+                              perFrame / elapsed.count(), static_cast<double>(bytes) / perFrame, cpu / perFrame);
+            } else {
+                std::snprintf(line, sizeof line, "%-36s %-16s %12.0f %12s %14.2f", backend.name, trace.name.c_str(),
+                              perFrame / elapsed.count(), "-", cpu / perFrame);
+            }
+            table.emplace_back(line);
+        }
+    }
+#ifdef _WIN32
+    if (stdscr != nullptr) {
+        endwin();
+    }
+#endif
+    for (const std::string &row : table) {
+        qInfo("%s", row.c_str());
+    }
+}
+
+QTEST_GUILESS_MAIN(QmlBackendBenchmark)
+#include "qml_backend_benchmark.moc"
@@ -0,0 +1,638 @@
+#include "qml_bench_harness.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QXmlStreamReader>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "qml_executor.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <pdh.h>
+
+#include <QSettings>
+#endif
+
+namespace {
+
+struct Options {
+    bool stable = false;
+    std::vector<int> cpus;  // the main thread's, then the workers'
+    int warmup = 2;
+    int minRuns = 5;
+    int maxRuns = 30;
+    double ciPercent = 1.0;
+    bool counters = true;
+    QString report;
+};
+
+// QtTest options followed by a value, so the value is not taken for a
+// test function.
+const QStringList kValueOptions{
+    QStringLiteral("-o"),           QStringLiteral("-maxwarnings"),  QStringLiteral("-eventdelay"),
+    QStringLiteral("-keydelay"),    QStringLiteral("-mousedelay"),   QStringLiteral("-iterations"),
+    QStringLiteral("-median"),      QStringLiteral("-minimumvalue"), QStringLiteral("-minimumtotal"),
+    QStringLiteral("-perfcounter"), QStringLiteral("-repeat"),       QStringLiteral("-seed"),
+};
+
+// QtTest's perf_event counter names and the metric its results carry.
+struct Counter {
+    const char *event;
+    const char *metric;
+};
+constexpr Counter kCounters[] = {
+    {"instructions", "Instructions"},
+    {"cache-misses", "CacheMisses"},
+    {"branch-misses", "BranchMisses"},
+};
+
+// Splits argv into the harness's options, QtTest's options and the test
+// functions selected; false with error set if an option is malformed.
+bool parseOptions(int argc, char **argv, Options &options, QStringList &arguments, QStringList &selectors,
+                  QString &error) {
+    bool harnessOption = false;
+    for (int i = 1; i < argc; ++i) {
+        const QString arg = QString::fromLocal8Bit(argv[i]);
+        const auto value = [&](QString &out) {
+            if (i + 1 >= argc) {
+                error = arg + QStringLiteral(" needs a value");
+                return false;
+            }
+            out = QString::fromLocal8Bit(argv[++i]);
+            harnessOption = true;
+            return true;
+        };
+        const auto number = [&](int &out, int minimum) {
+            QString text;
+            if (!value(text)) {
+                return false;
+            }
+            bool ok = false;
+            out = text.toInt(&ok);
+            if (!ok || out < minimum) {
+                error = arg + QStringLiteral(" needs a whole number of at least ") + QString::number(minimum);
+                return false;
+            }
+            return true;
+        };
+        QString text;
+        if (arg == QLatin1String("--stable")) {
+            options.stable = true;
+        } else if (arg == QLatin1String("--cpus")) {
+            if (!value(text) || !QmlExecutor::parseCpuList(text.toStdString(), options.cpus)) {
+                error = QStringLiteral("--cpus needs a CPU list such as 2-5 or 2,4,6");
+                return false;
+            }
+        } else if (arg == QLatin1String("--warmup")) {
+            if (!number(options.warmup, 0)) {
+                return false;
+            }
+        } else if (arg == QLatin1String("--min-runs")) {
+            if (!number(options.minRuns, 2)) {
+                return false;
+            }
+        } else if (arg == QLatin1String("--max-runs")) {
+            if (!number(options.maxRuns, 2)) {
+                return false;
+            }
+        } else if (arg == QLatin1String("--ci")) {
+            if (!value(text)) {
+                return false;
+            }
+            bool ok = false;
+            options.ciPercent = text.toDouble(&ok);
+            if (!ok || options.ciPercent <= 0) {
+                error = QStringLiteral("--ci needs a percentage above 0");
+                return false;
+            }
+        } else if (arg == QLatin1String("--no-counters")) {
+            options.counters = false;
+            harnessOption = true;
+        } else if (arg == QLatin1String("--report")) {
+            if (!value(options.report)) {
+                return false;
+            }
+        } else if (arg.startsWith(QLatin1Char('-'))) {
+            arguments.append(arg);
+            if (kValueOptions.contains(arg) && i + 1 < argc) {
+                arguments.append(QString::fromLocal8Bit(argv[++i]));
+            }
+        } else {
+            selectors.append(arg);
+        }
+    }
+    if (harnessOption && !options.stable) {
+        error = QStringLiteral("--cpus, --warmup, --min-runs, --max-runs, --ci, --no-counters and --report "
+                               "need --stable");
+        return false;
+    }
+    options.maxRuns = std::max(options.maxRuns, options.minRuns);
+    return true;
+}
+
+QString readTrimmed(const QString &path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? QString::fromLocal8Bit(file.readAll()).trimmed() : QString();
+}
+
+// The CPUs this process may run on, in order; empty where that is unknown.
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof set, &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#elif defined(_WIN32)
+    DWORD_PTR process = 0;
+    DWORD_PTR system = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) {
+        for (int cpu = 0; cpu < static_cast<int>(sizeof(DWORD_PTR) * 8); ++cpu) {
+            if (process & (DWORD_PTR(1) << cpu)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+bool pinThisThread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    return sched_setaffinity(0, sizeof one, &one) == 0;
+#elif defined(_WIN32)
+    return cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8) &&
+           SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// The CPU's clock now, in MHz, or 0 where it cannot be read.
+double cpuMHz(int cpu) {
+#if defined(__linux__)
+    bool ok = false;
+    const double khz =
+        readTrimmed(QStringLiteral("/sys/devices/system/cpu/cpu%1/cpufreq/scaling_cur_freq").arg(cpu)).toDouble(&ok);
+    if (ok) {
+        return khz / 1000.0;
+    }
+    // Without cpufreq, as in many VMs: /proc/cpuinfo lists each processor
+    // with its "cpu MHz".
+    const QStringList lines = readTrimmed(QStringLiteral("/proc/cpuinfo")).split(QLatin1Char('\n'));
+    int processor = -1;
+    for (const QString &line : lines) {
+        const QString key = line.section(QLatin1Char(':'), 0, 0).trimmed();
+        const QString value = line.section(QLatin1Char(':'), 1).trimmed();
+        if (key == QLatin1String("processor")) {
+            processor = value.toInt();
+        } else if (key == QLatin1String("cpu MHz") && processor == cpu) {
+            return value.toDouble();
+        }
+    }
+    return 0;
+#elif defined(_WIN32)
+    // The nominal clock scaled by "% Processor Performance", which is a
+    // rate and so needs two samples.
+    PDH_HQUERY query = nullptr;
+    if (cpu < 0 || PdhOpenQueryW(nullptr, 0, &query) != ERROR_SUCCESS) {
+        return 0;
+    }
+    const std::wstring base = L"\\Processor Information(0," + std::to_wstring(cpu) + L")\\";
+    PDH_HCOUNTER frequency = nullptr;
+    PDH_HCOUNTER performance = nullptr;
+    double mhz = 0;
+    if (PdhAddEnglishCounterW(query, (base + L"Processor Frequency").c_str(), 0, &frequency) == ERROR_SUCCESS &&
+        PdhAddEnglishCounterW(query, (base + L"% Processor Performance").c_str(), 0, &performance) ==
+            ERROR_SUCCESS &&
+        PdhCollectQueryData(query) == ERROR_SUCCESS) {
+        Sleep(100);
+        PDH_FMT_COUNTERVALUE nominal;
+        PDH_FMT_COUNTERVALUE percent;
+        if (PdhCollectQueryData(query) == ERROR_SUCCESS &&
+            PdhGetFormattedCounterValue(frequency, PDH_FMT_DOUBLE, nullptr, &nominal) == ERROR_SUCCESS &&
+            PdhGetFormattedCounterValue(performance, PDH_FMT_DOUBLE, nullptr, &percent) == ERROR_SUCCESS) {
+            mhz = nominal.doubleValue * percent.doubleValue / 100.0;
+        }
+    }
+    PdhCloseQuery(query);
+    return mhz;
+#else
+    (void)cpu;
+    return 0;
+#endif
+}
+
+// Why QtTest's perf_event measurer cannot count here, or empty if it can.
+QString countersUnavailable() {
+#if defined(__linux__)
+    perf_event_attr attr{};
+    attr.size = sizeof attr;
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    const long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) {
+        return QStringLiteral("perf_event_open: ") + QString::fromLocal8Bit(std::strerror(errno));
+    }
+    close(static_cast<int>(fd));
+    return QString();
+#else
+    return QStringLiteral("hardware counters need Linux perf_event");
+#endif
+}
+
+QString compiler() {
+#if defined(__clang__)
+    return QStringLiteral("clang " __clang_version__);
+#elif defined(__GNUC__)
+    return QStringLiteral("gcc " __VERSION__);
+#elif defined(_MSC_VER)
+    return QStringLiteral("msvc %1").arg(_MSC_FULL_VER);
+#else
+    return QStringLiteral("unknown");
+#endif
+}
+
+QString cpuModel() {
+#if defined(__linux__)
+    for (const QString &line : readTrimmed(QStringLiteral("/proc/cpuinfo")).split(QLatin1Char('\n'))) {
+        if (line.startsWith(QLatin1String("model name"))) {
+            return line.section(QLatin1Char(':'), 1).trimmed();
+        }
+    }
+#elif defined(_WIN32)
+    const QSettings cpu(QStringLiteral("HKEY_LOCAL_MACHINE\\HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\0"),
+                        QSettings::NativeFormat);
+    return cpu.value(QStringLiteral("ProcessorNameString")).toString().trimmed();
+#endif
+    return QString();
+}
+
+QJsonArray toJson(const std::vector<int> &cpus) {
+    QJsonArray array;
+    for (const int cpu : cpus) {
+        array.append(cpu);
+    }
+    return array;
+}
+
+// What the results depend on besides the code: the machine, its clocks and
+// load, and the build.
+QJsonObject environment(int mainCpu, const std::vector<int> &workerCpus) {
+    QJsonObject env{
+        {QStringLiteral("timestamp"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+        {QStringLiteral("host"), QSysInfo::machineHostName()},
+        {QStringLiteral("os"), QSysInfo::prettyProductName()},
+        {QStringLiteral("kernel"), QSysInfo::kernelType() + QLatin1Char(' ') + QSysInfo::kernelVersion()},
+        {QStringLiteral("architecture"), QSysInfo::currentCpuArchitecture()},
+        {QStringLiteral("cpuModel"), cpuModel()},
+        {QStringLiteral("logicalCpus"), static_cast<int>(std::thread::hardware_concurrency())},
+        {QStringLiteral("mainCpu"), mainCpu},
+        {QStringLiteral("workerCpus"), toJson(workerCpus)},
+        {QStringLiteral("compiler"), compiler()},
+#ifdef NDEBUG
+        {QStringLiteral("assertions"), false},
+#else
+        {QStringLiteral("assertions"), true},
+#endif
+        {QStringLiteral("qt"), QString::fromLatin1(qVersion())},
+    };
+#if defined(__linux__)
+    if (mainCpu >= 0) {
+        const QString cpufreq = QStringLiteral("/sys/devices/system/cpu/cpu%1/cpufreq/").arg(mainCpu);
+        const QString governor = readTrimmed(cpufreq + QStringLiteral("scaling_governor"));
+        if (!governor.isEmpty()) {
+            env.insert(QStringLiteral("governor"), governor);
+            env.insert(QStringLiteral("maxMHz"),
+                       readTrimmed(cpufreq + QStringLiteral("scaling_max_freq")).toDouble() / 1000.0);
+        }
+    }
+    const QString noTurbo = readTrimmed(QStringLiteral("/sys/devices/system/cpu/intel_pstate/no_turbo"));
+    const QString boost = readTrimmed(QStringLiteral("/sys/devices/system/cpu/cpufreq/boost"));
+    if (!noTurbo.isEmpty() || !boost.isEmpty()) {
+        env.insert(QStringLiteral("turbo"),
+                   noTurbo.isEmpty() ? boost == QLatin1String("1") : noTurbo == QLatin1String("0"));
+    }
+    env.insert(QStringLiteral("loadAverage"),
+               readTrimmed(QStringLiteral("/proc/loadavg")).section(QLatin1Char(' '), 0, 0).toDouble());
+#endif
+    return env;
+}
+
+struct Result {
+    QString function;
+    QString tag;
+    QString metric;
+    double value = 0;
+};
+
+// Runs one QtTest pass that logs only to xmlPath and reads back its
+// benchmark results; false if a test failed or the log cannot be read.
+bool runPass(QObject *test, const QString &program, const QStringList &arguments, const QStringList &selectors,
+             const QString &xmlPath, std::vector<Result> &results) {
+    QStringList args{program, QStringLiteral("-o"), xmlPath + QStringLiteral(",xml")};
+    args += arguments;
+    args += selectors;
+    QFile::remove(xmlPath);
+    const int failures = QTest::qExec(test, args);
+
+    QFile file(xmlPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QXmlStreamReader xml(&file);
+    QString function;
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+        const QXmlStreamAttributes attributes = xml.attributes();
+        if (xml.name() == QLatin1String("TestFunction")) {
+            function = attributes.value(QLatin1String("name")).toString();
+        } else if (xml.name() == QLatin1String("BenchmarkResult")) {
+            results.push_back(Result{function, attributes.value(QLatin1String("tag")).toString(),
+                                     attributes.value(QLatin1String("metric")).toString(),
+                                     attributes.value(QLatin1String("value")).toDouble()});
+        }
+    }
+    return failures == 0 && !xml.hasError();
+}
+
+// One benchmark row across the runs.
+struct Samples {
+    QString function;
+    QString tag;
+    QString metric;
+    std::vector<double> values;
+    std::vector<double> mhz;  // the main CPU's clock after each run
+    std::map<QString, double> counters;
+};
+
+double mean(const std::vector<double> &values) {
+    double sum = 0;
+    for (const double value : values) {
+        sum += value;
+    }
+    return values.empty() ? 0 : sum / static_cast<double>(values.size());
+}
+
+double median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0;
+    }
+    const size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    if (values.size() % 2 == 1) {
+        return values[middle];
+    }
+    return (values[middle] + *std::max_element(values.begin(), values.begin() + middle)) / 2.0;
+}
+
+// Half the width of the 95% confidence interval of the mean, from
+// Student's t; infinite for a single sample.
+double confidence95(const std::vector<double> &values) {
+    static const double kT[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    const size_t n = values.size();
+    if (n < 2) {
+        return INFINITY;
+    }
+    const double average = mean(values);
+    double squares = 0;
+    for (const double value : values) {
+        squares += (value - average) * (value - average);
+    }
+    const double deviation = std::sqrt(squares / static_cast<double>(n - 1));
+    const double t = n - 1 <= std::size(kT) ? kT[n - 2] : 1.96;
+    return t * deviation / std::sqrt(static_cast<double>(n));
+}
+
+bool settled(const Samples &samples, const Options &options) {
+    return static_cast<int>(samples.values.size()) >= options.minRuns &&
+           confidence95(samples.values) <= std::abs(mean(samples.values)) * options.ciPercent / 100.0;
+}
+
+QString keyOf(const QString &function, const QString &tag) {
+    return tag.isEmpty() ? function : function + QLatin1Char('/') + tag;
+}
+
+QString selectorOf(const Samples &samples) {
+    return samples.tag.isEmpty() ? samples.function : samples.function + QLatin1Char(':') + samples.tag;
+}
+
+int stableMain(QObject *test, const QString &program, Options options, const QStringList &arguments,
+               const QStringList &selectors) {
+    if (options.cpus.empty()) {
+        options.cpus = allowedCpus();
+        if (options.cpus.size() > 1) {
+            options.cpus.erase(options.cpus.begin());
+        }
+    }
+    const int mainCpu = options.cpus.empty() ? -1 : options.cpus.front();
+    std::vector<int> workerCpus(options.cpus.begin() + (options.cpus.size() > 1 ? 1 : 0), options.cpus.end());
+    if (mainCpu >= 0 && !pinThisThread(mainCpu)) {
+        std::fprintf(stderr, "Could not pin the main thread to CPU %d\n", mainCpu);
+    }
+    QmlExecutor::configure({workerCpus.size(), workerCpus});
+
+    // Progress and the table go to stderr when the report takes stdout.
+    FILE *log = options.report == QLatin1String("-") ? stderr : stdout;
+    const QJsonObject env = environment(mainCpu, workerCpus);
+    const QString governor = env.value(QStringLiteral("governor")).toString();
+    if (!governor.isEmpty() && governor != QLatin1String("performance")) {
+        std::fprintf(log, "CPU %d uses the '%s' governor; 'performance' keeps its clock steadier\n", mainCpu,
+                     qPrintable(governor));
+    }
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        std::fprintf(stderr, "Cannot create a temporary directory for QtTest's results\n");
+        return 1;
+    }
+    const QString xmlPath = dir.filePath(QStringLiteral("pass.xml"));
+    bool passed = true;
+
+    for (int run = 0; run < options.warmup; ++run) {
+        std::fprintf(log, "warmup %d/%d\n", run + 1, options.warmup);
+        std::fflush(log);
+        std::vector<Result> discarded;
+        passed &= runPass(test, program, arguments, selectors, xmlPath, discarded);
+    }
+
+    // Later runs select only the rows whose interval is still too wide.
+    std::map<QString, Samples> rows;
+    QStringList pending = selectors;
+    for (int run = 0; run < options.maxRuns; ++run) {
+        std::vector<Result> results;
+        passed &= runPass(test, program, arguments, pending, xmlPath, results);
+        const double mhz = mainCpu >= 0 ? cpuMHz(mainCpu) : 0;
+        for (const Result &result : results) {
+            Samples &samples = rows[keyOf(result.function, result.tag)];
+            samples.function = result.function;
+            samples.tag = result.tag;
+            samples.metric = result.metric;
+            samples.values.push_back(result.value);
+            if (mhz > 0) {
+                samples.mhz.push_back(mhz);
+            }
+        }
+        pending.clear();
+        for (const auto &row : rows) {
+            if (!settled(row.second, options)) {
+                pending.append(selectorOf(row.second));
+            }
+        }
+        std::fprintf(log, "run %d: %lld of %zu results within %.2g%%\n", run + 1,
+                     static_cast<long long>(rows.size()) - pending.size(), rows.size(), options.ciPercent);
+        std::fflush(log);
+        if (pending.isEmpty()) {
+            break;
+        }
+    }
+
+    const QString unavailable = options.counters ? countersUnavailable() : QStringLiteral("--no-counters");
+    if (unavailable.isEmpty()) {
+        for (const Counter &counter : kCounters) {
+            std::fprintf(log, "counting %s\n", counter.event);
+            std::fflush(log);
+            QStringList counterArguments = arguments;
+            counterArguments << QStringLiteral("-perf") << QStringLiteral("-perfcounter")
+                             << QString::fromLatin1(counter.event);
+            std::vector<Result> results;
+            passed &= runPass(test, program, counterArguments, selectors, xmlPath, results);
+            // Rows that report their own metric ignore the measurer.
+            for (const Result &result : results) {
+                const auto row = rows.find(keyOf(result.function, result.tag));
+                if (row != rows.end() && result.metric == QLatin1String(counter.metric)) {
+                    row->second.counters[result.metric] = result.value;
+                }
+            }
+        }
+    } else {
+        std::fprintf(log, "No hardware counters: %s\n", qPrintable(unavailable));
+    }
+
+    QJsonObject results;
+    for (const auto &row : rows) {
+        const Samples &samples = row.second;
+        const double average = mean(samples.values);
+        const double middle = median(samples.values);
+        std::vector<double> deviations;
+        for (const double value : samples.values) {
+            deviations.push_back(std::abs(value - middle));
+        }
+        const double interval = confidence95(samples.values);
+        QJsonObject counters;
+        QString counterText;
+        for (const auto &counter : samples.counters) {
+            counters.insert(counter.first, counter.second);
+            counterText += QStringLiteral("  %1=%2").arg(counter.first).arg(counter.second, 0, 'g', 6);
+        }
+        QJsonObject result{
+            {QStringLiteral("metric"), samples.metric},
+            {QStringLiteral("mean"), average},
+            {QStringLiteral("ci95"), std::isfinite(interval) ? interval : -1.0},
+            {QStringLiteral("median"), middle},
+            {QStringLiteral("mad"), median(deviations)},
+            {QStringLiteral("runs"), static_cast<int>(samples.values.size())},
+            {QStringLiteral("settled"), settled(samples, options)},
+        };
+        if (!samples.mhz.empty()) {
+            result.insert(QStringLiteral("cpuMHz"), mean(samples.mhz));
+        }
+        if (!counters.isEmpty()) {
+            result.insert(QStringLiteral("counters"), counters);
+        }
+        results.insert(row.first, result);
+
+        const double percent = average != 0 ? interval / std::abs(average) * 100.0 : 0;
+        std::fprintf(log, "%-60s %14.6g ±%5.2f%% %3zu runs%s %s%s\n", qPrintable(row.first), average, percent,
+                     samples.values.size(), settled(samples, options) ? "" : " (unsettled)",
+                     qPrintable(samples.metric), qPrintable(counterText));
+    }
+
+    if (!options.report.isEmpty()) {
+        const QJsonObject settings{
+            {QStringLiteral("warmup"), options.warmup},
+            {QStringLiteral("minRuns"), options.minRuns},
+            {QStringLiteral("maxRuns"), options.maxRuns},
+            {QStringLiteral("ciPercent"), options.ciPercent},
+            {QStringLiteral("counters"), unavailable.isEmpty() ? QJsonValue(true) : QJsonValue(unavailable)},
+        };
+        const QByteArray json = QJsonDocument(QJsonObject{
+                                                  {QStringLiteral("environment"), env},
+                                                  {QStringLiteral("settings"), settings},
+                                                  {QStringLiteral("results"), results},
+                                              })
+                                    .toJson(QJsonDocument::Indented);
+        if (options.report == QLatin1String("-")) {
+            std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+        } else {
+            QFile file(options.report);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+                std::fprintf(stderr, "Cannot write %s\n", qPrintable(options.report));
+                return 1;
+            }
+        }
+    }
+    return passed ? 0 : 1;
+}
+
+}  // namespace
+
+int qmlBenchMain(QObject *testObject, int argc, char **argv) {
+    Options options;
+    QStringList arguments;
+    QStringList selectors;
+    QString error;
+    if (!parseOptions(argc, argv, options, arguments, selectors, error)) {
+        std::fprintf(stderr, "%s\n", qPrintable(error));
+        return 2;
+    }
+    if (!options.stable) {
+        return QTest::qExec(testObject, argc, argv);
+    }
+    return stableMain(testObject, QString::fromLocal8Bit(argv[0]), std::move(options), arguments, selectors);
+}
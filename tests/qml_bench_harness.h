@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QCoreApplication>
+#include <QObject>
+#include <QTest>
+
+// Low-noise runs of a QtTest benchmark executable. QML_BENCH_MAIN replaces
+// QTEST_GUILESS_MAIN; without --stable the executable runs as before. With
+// it, the harness:
+//
+//   - pins the main thread to one CPU and the QmlExecutor workers to others
+//     (--cpus, by default every allowed CPU but the lowest, which takes most
+//     interrupts);
+//   - runs the selected benchmarks --warmup times (default 2) and discards
+//     the results;
+//   - runs them again, at least --min-runs times (default 5), until the 95%
+//     confidence interval of each result's mean is within --ci percent of
+//     it (default 1) or --max-runs is reached (default 30), rerunning only
+//     the rows that have not settled;
+//   - on Linux, runs them once more per hardware counter (instructions,
+//     cache misses, branch misses) with QtTest's perf_event measurer, unless
+//     --no-counters or the kernel refuses;
+//   - prints a table, and with --report writes every result with its
+//     confidence interval, median and MAD, counters and the main CPU's
+//     clock, plus the machine, OS, compiler and CPU governor, as JSON.
+//
+//   ./sample_benchmarks --stable --report stable.json parse_bytes_per_second
+//
+// The harness's options are removed before QtTest sees the rest.
+int qmlBenchMain(QObject *testObject, int argc, char **argv);
+
+#define QML_BENCH_MAIN(TestObject)                    \
+    int main(int argc, char *argv[]) {                \
+        QCoreApplication app(argc, argv);             \
+        TestObject tc;                                \
+        QTEST_SET_MAIN_SOURCE_PATH                    \
+        return qmlBenchMain(&tc, argc, argv);         \
+    }
@@ -0,0 +1,450 @@
+#include <QtTest>
+#include <QResource>
+#include <QScopeGuard>
+#include <QStringListModel>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "qml_buffer_screen.h"
+#include "qml_curses_frontend.h"
+#include "qml_meta_resolver.h"
+#include "qml_notify_bridge.h"
+#include "qml_parser.h"
+#include "qml_project_index.h"
+#include "qml_qt_list_model.h"
+#include "qml_qt_resources.h"
+
+namespace {
+
+struct DrawCall {
+    int row = 0;
+    int col = 0;
+    std::string text;
+};
+
+class MockScreen : public ICursesScreen {
+public:
+    MockScreen(int rows, int cols) : rows_(rows), cols_(cols) {}
+
+    void clear() override { draws.clear(); }
+    void drawText(int row, int col, const std::string &text) override {
+        draws.push_back(DrawCall{row, col, text});
+    }
+    void drawStyledText(int row, int col, const std::string &text, uint32_t) override { drawText(row, col, text); }
+    void refresh() override {}
+    int rows() const override { return rows_; }
+    int cols() const override { return cols_; }
+
+    std::vector<DrawCall> draws;
+
+private:
+    int rows_;
+    int cols_;
+};
+
+}  // namespace
+
+class NotifyingSource : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(QString message READ message WRITE setMessage NOTIFY messageChanged)
+    Q_PROPERTY(QString status READ status WRITE setStatus NOTIFY statusChanged)
+    Q_PROPERTY(QString name READ name CONSTANT)
+
+public:
+    QString message() const { return message_; }
+    void setMessage(const QString &message) {
+        message_ = message;
+        emit messageChanged();
+    }
+    QString status() const { return status_; }
+    void setStatus(const QString &status) {
+        status_ = status;
+        emit statusChanged();
+    }
+    QString name() const { return QStringLiteral("source"); }
+
+    Q_INVOKABLE QString describe(const QString &suffix) const {
+        ++describeCalls;
+        return message_ + suffix;
+    }
+    Q_INVOKABLE void reset() { setStatus(QStringLiteral("reset")); }
+
+    mutable int describeCalls = 0;
+
+signals:
+    void messageChanged();
+    void statusChanged();
+
+private:
+    QString message_ = QStringLiteral("hello");
+    QString status_ = QStringLiteral("idle");
+};
+
+class QmlBindingsTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void invalidates_on_notify();
+    void coalesces_notifies_from_other_threads();
+    void resolves_through_meta_objects();
+    void reevaluates_dependent_bindings();
+    void reuses_utf8_of_unchanged_strings();
+    void runs_handler_scripts();
+    void lists_qt_models();
+    void reads_qml_from_qt_resources();
+};
+
+void QmlBindingsTest::invalidates_on_notify() {
+    const std::string qml = R"(
+ApplicationWindow {
+    title: source.name
+    Column {
+        Label { text: source.message }
+        Label { text: source.status }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    NotifyingSource source;
+    std::vector<std::string> written;
+    const auto writer = [&](std::string_view binding, std::string &value) {
+        written.emplace_back(binding);
+        const QByteArray name = QByteArray(binding.data(), static_cast<int>(binding.size())).mid(7);
+        value = source.property(name.constData()).toString().toStdString();
+    };
+    QmlNotifyBridge bridge(writer);
+    bridge.addObject("source", &source);
+
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, bridge);
+    std::vector<std::string> changed;
+    bridge.setChangedHandler([&](const std::string &binding) {
+        changed.push_back(binding);
+        frontend.invalidateBinding(binding);
+    });
+    frontend.render(doc);
+    QCOMPARE(written.size(), size_t(3));
+    QCOMPARE(bridge.subscriptionCount(), size_t(2));  // name is CONSTANT
+
+    // A frame without notifications resolves nothing.
+    written.clear();
+    frontend.render(doc);
+    QVERIFY(written.empty());
+
+    // Only the binding behind the signal is invalidated and re-resolved.
+    source.setStatus(QStringLiteral("busy"));
+    QCOMPARE(changed, std::vector<std::string>{"source.status"});
+    frontend.render(doc);
+    QCOMPARE(written, std::vector<std::string>{"source.status"});
+    QCOMPARE(screen.draws.back().text, std::string("busy"));
+}
+
+void QmlBindingsTest::coalesces_notifies_from_other_threads() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        Label { text: source.message }
+        Label { text: source.status }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    NotifyingSource source;
+    const auto writer = [&](std::string_view, std::string &value) { value = "x"; };
+    QmlNotifyBridge bridge(writer);
+    bridge.addObject("source", &source);
+
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, bridge);
+    std::vector<std::string> changed;
+    bridge.setChangedHandler([&](const std::string &binding) { changed.push_back(binding); });
+    frontend.render(doc);
+    QCOMPARE(bridge.subscriptionCount(), size_t(2));
+
+    // Emitters on other threads only queue; nothing reaches the handler
+    // until this thread drains.
+    constexpr int kThreads = 4;
+    constexpr int kEmits = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&source] {
+            for (int i = 0; i < kEmits; ++i) {
+                emit source.statusChanged();
+                emit source.messageChanged();
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    QVERIFY(changed.empty());
+
+    // Each binding is reported once however often it changed.
+    QCOMPARE(bridge.drainChanges(), size_t(2));
+    std::sort(changed.begin(), changed.end());
+    QCOMPARE(changed, (std::vector<std::string>{"source.message", "source.status"}));
+    QCOMPARE(bridge.coalescedChangeCount(), uint64_t(2 * kThreads * kEmits - 2));
+
+    // The drain they scheduled finds nothing left.
+    QCoreApplication::processEvents();
+    QCOMPARE(changed.size(), size_t(2));
+
+    // Emitting on the bridge's thread still calls the handler at once.
+    source.setStatus(QStringLiteral("busy"));
+    QCOMPARE(changed.size(), size_t(3));
+}
+
+void QmlBindingsTest::resolves_through_meta_objects() {
+    NotifyingSource source;
+    QmlMetaResolver resolver;
+    resolver.addObject("source", &source);
+
+    std::string value;
+    resolver("source.message", value);
+    QCOMPARE(value, std::string("hello"));
+    resolver(" source . status ", value);
+    QCOMPARE(value, std::string("idle"));
+    resolver("source.describe(\"!\")", value);
+    QCOMPARE(value, std::string("hello!"));
+    resolver("source.describe()", value);  // QString parameters default to empty
+    QCOMPARE(value, std::string("hello"));
+    QCOMPARE(source.describeCalls, 2);
+    resolver("other.message", value);
+    QCOMPARE(value, std::string("other.message"));
+    resolver("source.missing", value);
+    QCOMPARE(value, std::string("source.missing"));
+    QCOMPARE(resolver.expressionCount(), size_t(6));
+
+    // Later reads use the cached accessors and see live values.
+    source.setMessage(QStringLiteral("bye"));
+    resolver("source.message", value);
+    QCOMPARE(value, std::string("bye"));
+    resolver("source.describe(\"?\")", value);
+    QCOMPARE(value, std::string("bye?"));
+    QCOMPARE(resolver.expressionCount(), size_t(7));
+
+    // Names resolve at evaluation, so objects registered later are found.
+    NotifyingSource other;
+    resolver.addObject("other", &other);
+    resolver("other.message", value);
+    QCOMPARE(value, std::string("hello"));
+
+    // Expressions mix literals, calls, concatenation and document ids.
+    const QmlDocument doc = QmlParser().parseString(R"(
+Item {
+    TextField { id: nameField; text: "Ada" }
+}
+)");
+    resolver.setDocument(&doc);
+    resolver("source.describe(\", \" + nameField.text) + '!'", value);
+    QCOMPARE(value, std::string("bye, Ada!"));
+    resolver("source.describe(", value);  // does not compile
+    QCOMPARE(value, std::string("source.describe("));
+}
+
+void QmlBindingsTest::reevaluates_dependent_bindings() {
+    const QmlDocument doc = QmlParser().parseString(R"(
+ApplicationWindow {
+    title: source.name
+    Column {
+        TextField { id: nameField; text: "Ada" }
+        Label { id: greeting; text: source.describe(", " + nameField.text) }
+        Label { id: status; text: source.status }
+    }
+}
+)");
+
+    NotifyingSource source;
+    source.setMessage(QStringLiteral("Hi"));
+    QmlMetaResolver resolver;
+    resolver.addObject("source", &source);
+    resolver.setDocument(&doc);
+
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, resolver);
+    frontend.render(doc);
+    QVERIFY(std::any_of(screen.draws.begin(), screen.draws.end(),
+                        [](const DrawCall &draw) { return draw.text == "Hi, Ada"; }));
+
+    // Typing into the field re-evaluates only the label that reads it.
+    std::vector<std::string> invalidated;
+    const auto invalidate = [&](const std::string &binding) {
+        invalidated.push_back(binding);
+        frontend.invalidateBinding(binding);
+    };
+    resolver.setValue("nameField", "text", "Bob");
+    resolver.setValue("nameField", "text", "Bo");
+    QCOMPARE(resolver.commit(invalidate), size_t(1));
+    QCOMPARE(invalidated, std::vector<std::string>{R"(source.describe(", " + nameField.text))"});
+    std::string value;
+    resolver(invalidated[0], value);
+    QCOMPARE(value, std::string("Hi, Bo"));
+
+    // Outside sources reach their readers the same way.
+    invalidated.clear();
+    source.setStatus(QStringLiteral("busy"));
+    resolver.sourceChanged("source", "status");
+    QCOMPARE(resolver.commit(invalidate), size_t(1));
+    QCOMPARE(invalidated, std::vector<std::string>{"source.status"});
+    QCOMPARE(resolver.commit(invalidate), size_t(0));
+}
+
+void QmlBindingsTest::reuses_utf8_of_unchanged_strings() {
+    NotifyingSource source;
+    source.setMessage(QStringLiteral("Grüße"));
+    QmlMetaResolver resolver;
+    resolver.addObject("source", &source);
+
+    std::string value;
+    resolver("source.message", value);
+    QCOMPARE(value, std::string("Gr\xc3\xbc\xc3\x9f" "e"));
+    QCOMPARE(resolver.utf8Conversions(), size_t(1));
+    for (int i = 0; i < 10; ++i) {
+        resolver("source.message", value);
+    }
+    QCOMPARE(resolver.utf8Conversions(), size_t(1));
+
+    // A new value is converted again.
+    source.setMessage(QStringLiteral("Grüsse"));
+    resolver("source.message", value);
+    QCOMPARE(value, std::string("Gr\xc3\xbcsse"));
+    QCOMPARE(resolver.utf8Conversions(), size_t(2));
+}
+
+void QmlBindingsTest::runs_handler_scripts() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        TextField { id: nameField; text: "Ada" }
+        Label { id: greeting; text: "idle" }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    NotifyingSource source;
+    QmlMetaResolver resolver;
+    resolver.addObject("source", &source);
+    resolver.setDocument(&doc);
+
+    std::vector<std::string> assigned;
+    const auto record = [&](const std::string &id, const std::string &property, const std::string &value) {
+        assigned.push_back(id + "." + property + "=" + value);
+    };
+    QCOMPARE(resolver.run(R"(greeting.text = source.describe(", " + nameField.text))", record), size_t(1));
+    QCOMPARE(assigned, std::vector<std::string>{"greeting.text=hello, Ada"});
+    QCOMPARE(source.describeCalls, 1);
+
+    // Braces, several statements, and '=' or ';' inside strings.
+    assigned.clear();
+    QCOMPARE(resolver.run("{ source.describe('a=b;c'); greeting.text = 'x'\n nameField.text = \"Bob\" }", record),
+             size_t(3));
+    QCOMPARE(assigned, (std::vector<std::string>{"greeting.text=x", "nameField.text=Bob"}));
+    QCOMPARE(source.describeCalls, 2);
+    std::string value;
+    resolver("nameField.text", value);
+    QCOMPARE(value, std::string("Bob"));
+
+    // A void method runs for its effect.
+    QCOMPARE(resolver.run("source.reset()"), size_t(1));
+    QCOMPARE(source.status(), QStringLiteral("reset"));
+}
+
+void QmlBindingsTest::lists_qt_models() {
+    const std::string qml = R"(
+ApplicationWindow {
+    ListView {
+        model: words
+        delegate: Text { text: model.display }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    QStringListModel words({QStringLiteral("alpha"), QStringLiteral("beta")});
+    QmlQtListModel adapter(&words);
+    int changes = 0;
+    adapter.setChangedHandler([&changes] { ++changes; });
+    QmlBufferScreen screen(4, 20);
+    QmlCursesFrontend frontend(screen);
+    frontend.setModel("words", &adapter);
+    frontend.render(doc);
+    QCOMPARE(frontend.itemCount(), size_t(2));
+    QVERIFY(screen.row(0).find("alpha") != std::string::npos);
+    QVERIFY(screen.row(1).find("beta") != std::string::npos);
+
+    // Qt's row signals arrive as the matching list model changes.
+    QVERIFY(words.insertRows(1, 1));
+    QVERIFY(words.setData(words.index(1), QStringLiteral("gamma")));
+    QCOMPARE(changes, 2);
+    frontend.render(doc);
+    QCOMPARE(frontend.itemCount(), size_t(3));
+    QVERIFY(screen.row(1).find("gamma") != std::string::npos);
+    QVERIFY(screen.row(2).find("beta") != std::string::npos);
+
+    QVERIFY(words.moveRows(QModelIndex(), 2, 1, QModelIndex(), 0));
+    QVERIFY(words.removeRows(1, 1));
+    frontend.render(doc);
+    QCOMPARE(frontend.itemCount(), size_t(2));
+    QVERIFY(screen.row(0).find("beta") != std::string::npos);
+    QVERIFY(screen.row(1).find("gamma") != std::string::npos);
+
+    words.setStringList({QStringLiteral("delta")});
+    frontend.render(doc);
+    QCOMPARE(frontend.itemCount(), size_t(1));
+    QVERIFY(screen.row(0).find("delta") != std::string::npos);
+    QVERIFY(screen.row(1).find_first_not_of(' ') == std::string::npos);
+}
+
+void QmlBindingsTest::reads_qml_from_qt_resources() {
+    QmlQtResources::install();
+    const auto restore = qScopeGuard([] { MappedFile::setProvider(nullptr); });
+
+    // tests/resources is compiled in twice: stored under :/plain and zlib
+    // compressed under :/zipped.
+    const QResource plain(QStringLiteral(":/plain/Screen.qml"));
+    const QResource zipped(QStringLiteral(":/zipped/Screen.qml"));
+    QCOMPARE(plain.compressionAlgorithm(), QResource::NoCompression);
+    QVERIFY(zipped.compressionAlgorithm() != QResource::NoCompression);
+
+    MappedFile file;
+    QVERIFY(file.open(":/plain/Screen.qml"));
+    // Read in place: the view is the data compiled into the binary.
+    QCOMPARE(static_cast<const void *>(file.data()), static_cast<const void *>(plain.data()));
+    QVERIFY(file.open("qrc:/zipped/Screen.qml"));
+    QCOMPARE(file.size(), static_cast<size_t>(plain.size()));
+    QVERIFY(file.view() == std::string_view(reinterpret_cast<const char *>(plain.data()), file.size()));
+    QVERIFY(!file.open(":/plain/Missing.qml"));
+    QVERIFY(!file.open(":/plain"));
+
+    QVERIFY(MappedFile::exists(":/zipped/Card.qml"));
+    QVERIFY(!MappedFile::exists("qrc:/zipped/Missing.qml"));
+
+    // Components resolve next to the file, inside the resources.
+    for (const std::string path : {":/plain/Screen.qml", "qrc:/zipped/Screen.qml"}) {
+        QmlProjectIndex project;
+        QVERIFY(file.open(path));
+        const QmlDocument document = project.expand(QmlParser().parseFile(path), file.view(), path);
+        const QmlNode *second = document.findById("second");
+        QVERIFY(second);
+        QCOMPARE(second->type, std::string("Rectangle"));
+        QCOMPARE(second->property("color"), std::string("green"));
+        QCOMPARE(second->children[0].property("text"), std::string("card"));
+        QCOMPARE(project.parseCount(), size_t(1));
+    }
+}
+
+QTEST_GUILESS_MAIN(QmlBindingsTest)
+#include "qml_bindings_test.moc"
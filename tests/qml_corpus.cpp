@@ -0,0 +1,293 @@
+#include "qml_corpus.h"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+using Shape = QmlCorpusOptions::Shape;
+
+constexpr size_t kChunkSize = 64 * 1024;
+// Deeper objects are indented as if at this depth, so deep chains spend
+// their bytes on objects rather than on leading spaces.
+constexpr int kMaxIndent = 32;
+
+constexpr std::string_view kWords[] = {"alpha", "bravo", "status", "ready", "queue", "north", "label", "value",
+                                       "window", "item", "delta", "kiosk", "report", "total", "page", "next"};
+constexpr std::string_view kContainers[] = {"Column", "Row", "Grid"};
+constexpr std::string_view kLeaves[] = {"Text", "Label", "Button"};
+
+template <typename T, size_t N>
+constexpr uint32_t countOf(const T (&)[N]) {
+    return static_cast<uint32_t>(N);
+}
+
+class Writer {
+public:
+    Writer(const QmlCorpusOptions &options, const QmlCorpus::Sink &sink)
+        : options_(options), sink_(sink), rng_(options.seed) {}
+
+    void run() {
+        header();
+        switch (options_.shape) {
+        case Shape::Mixed:
+            tree(30, options_.maxDepth);
+            break;
+        case Shape::DeepNesting:
+            chains();
+            break;
+        case Shape::WideColumn:
+            while (!full()) {
+                leaf(kBodyDepth, chance(20));
+            }
+            break;
+        case Shape::LongLines:
+            while (!full()) {
+                longLine(kBodyDepth);
+            }
+            break;
+        case Shape::ManyIds:
+            tree(100, std::min(options_.maxDepth, 8));
+            break;
+        }
+        line(1, "}");
+        line(0, "}");
+        flush();
+    }
+
+private:
+    // Depth of the objects inside the corpus Column.
+    static constexpr int kBodyDepth = 2;
+
+    uint32_t draw(uint32_t n) { return static_cast<uint32_t>(rng_() % n); }
+    bool chance(uint32_t percent) { return draw(100) < percent; }
+    bool full() const { return flushed_ + buffer_.size() >= options_.bytes; }
+
+    void flush() {
+        if (!buffer_.empty()) {
+            sink_(buffer_);
+            flushed_ += buffer_.size();
+            buffer_.clear();
+        }
+    }
+
+    void begin(int depth) { buffer_.append(static_cast<size_t>(std::min(depth, kMaxIndent)) * 4, ' '); }
+
+    void end() {
+        buffer_ += '\n';
+        if (buffer_.size() >= kChunkSize) {
+            flush();
+        }
+    }
+
+    void line(int depth, std::string_view text) {
+        begin(depth);
+        buffer_ += text;
+        end();
+    }
+
+    void words(uint32_t count) {
+        buffer_ += '"';
+        for (uint32_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                buffer_ += ' ';
+            }
+            buffer_ += kWords[draw(countOf(kWords))];
+        }
+        buffer_ += '"';
+    }
+
+    void id(std::string_view type) {
+        buffer_ += "id: ";
+        buffer_ += static_cast<char>(type[0] - 'A' + 'a');
+        buffer_ += type.substr(1);
+        buffer_ += std::to_string(nextId_++);
+    }
+
+    void open(int depth, std::string_view type, bool withId) {
+        begin(depth);
+        buffer_ += type;
+        buffer_ += " {";
+        end();
+        if (withId) {
+            begin(depth + 1);
+            id(type);
+            end();
+        }
+    }
+
+    void header() {
+        line(0, "ApplicationWindow {");
+        line(1, "id: window");
+        begin(1);
+        buffer_ += "title: \"Corpus ";
+        buffer_ += QmlCorpus::shapeName(options_.shape);
+        buffer_ += " seed " + std::to_string(options_.seed) + "\"";
+        end();
+        line(1, "Column {");
+        line(2, "id: corpus");
+        line(2, "spacing: 1");
+    }
+
+    void leaf(int depth, bool withId) {
+        const std::string_view type = kLeaves[draw(countOf(kLeaves))];
+        if (chance(50)) {
+            // Text { id: text3; text: "queue ready" }
+            begin(depth);
+            buffer_ += type;
+            buffer_ += " { ";
+            if (withId) {
+                id(type);
+                buffer_ += "; ";
+            }
+            buffer_ += "text: ";
+            words(1 + draw(4));
+            buffer_ += " }";
+            end();
+            return;
+        }
+        open(depth, type, withId);
+        begin(depth + 1);
+        buffer_ += "text: ";
+        if (chance(20)) {
+            buffer_ += "model.value" + std::to_string(draw(1000));
+        } else {
+            words(1 + draw(8));
+        }
+        end();
+        if (chance(30)) {
+            begin(depth + 1);
+            buffer_ += "width: " + std::to_string(4 + draw(60));
+            end();
+        }
+        if (type != "Button" && chance(10)) {
+            line(depth + 1, "wrapMode: Text.Wrap");
+        }
+        if (type == "Button" && chance(30)) {
+            begin(depth + 1);
+            buffer_ += "onClicked: console.log(\"clicked " + std::to_string(draw(1000)) + "\")";
+            end();
+        }
+        line(depth, "}");
+    }
+
+    // A random walk that opens and closes containers between leaves.
+    void tree(uint32_t idPercent, int maxDepth) {
+        int open = 0;
+        while (!full()) {
+            const uint32_t step = draw(100);
+            if (step < 12 && open < maxDepth) {
+                this->open(kBodyDepth + open, kContainers[draw(countOf(kContainers))], chance(idPercent));
+                if (chance(50)) {
+                    line(kBodyDepth + open + 1, "spacing: 1");
+                }
+                ++open;
+            } else if (step < 24 && open > 0) {
+                --open;
+                line(kBodyDepth + open, "}");
+            } else {
+                leaf(kBodyDepth + open, chance(idPercent));
+            }
+        }
+        while (open > 0) {
+            --open;
+            line(kBodyDepth + open, "}");
+        }
+    }
+
+    void chains() {
+        const int depth = std::max(options_.maxDepth, 1);
+        while (!full()) {
+            for (int level = 0; level < depth; ++level) {
+                open(kBodyDepth + level, kContainers[static_cast<size_t>(level) % countOf(kContainers)], false);
+                begin(kBodyDepth + level + 1);
+                buffer_ += "width: " + std::to_string(1 + draw(200));
+                end();
+            }
+            leaf(kBodyDepth + depth, false);
+            for (int level = depth - 1; level >= 0; --level) {
+                line(kBodyDepth + level, "}");
+            }
+        }
+    }
+
+    // Text { text: "..."; width: 12; extra0: 4; extra1: "page"; ... }
+    void longLine(int depth) {
+        const std::string_view type = kLeaves[draw(countOf(kLeaves))];
+        begin(depth);
+        buffer_ += type;
+        buffer_ += " { ";
+        if (chance(50)) {
+            id(type);
+            buffer_ += "; ";
+        }
+        buffer_ += "text: ";
+        words(1 + draw(4));
+        const uint32_t extras = 20 + draw(180);
+        for (uint32_t i = 0; i < extras; ++i) {
+            buffer_ += "; extra" + std::to_string(i) + ": ";
+            switch (draw(4)) {
+            case 0:
+                buffer_ += std::to_string(draw(10000));
+                break;
+            case 1:
+                words(1 + draw(3));
+                break;
+            case 2:
+                buffer_ += chance(50) ? "true" : "false";
+                break;
+            default:
+                buffer_ += "model.value" + std::to_string(draw(1000));
+                break;
+            }
+        }
+        buffer_ += " }";
+        end();
+    }
+
+    const QmlCorpusOptions &options_;
+    const QmlCorpus::Sink &sink_;
+    std::mt19937 rng_;
+    std::string buffer_;
+    size_t flushed_ = 0;
+    uint32_t nextId_ = 0;
+};
+
+}  // namespace
+
+std::string QmlCorpus::generate(const QmlCorpusOptions &options) {
+    std::string corpus;
+    corpus.reserve(options.bytes + kChunkSize);
+    generate(options, [&corpus](std::string_view chunk) { corpus += chunk; });
+    return corpus;
+}
+
+void QmlCorpus::generate(const QmlCorpusOptions &options, const Sink &sink) {
+    Writer(options, sink).run();
+}
+
+std::string_view QmlCorpus::shapeName(QmlCorpusOptions::Shape shape) {
+    switch (shape) {
+    case Shape::Mixed:
+        return "mixed";
+    case Shape::DeepNesting:
+        return "deep";
+    case Shape::WideColumn:
+        return "wide";
+    case Shape::LongLines:
+        return "long-lines";
+    case Shape::ManyIds:
+        return "ids";
+    }
+    return {};
+}
+
+bool QmlCorpus::shapeFromName(std::string_view name, QmlCorpusOptions::Shape &shape) {
+    for (const Shape candidate : {Shape::Mixed, Shape::DeepNesting, Shape::WideColumn, Shape::LongLines, Shape::ManyIds}) {
+        if (shapeName(candidate) == name) {
+            shape = candidate;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Seeded generator of synthetic QML in the dialect QmlParser reads, for
+// scaling tests and benchmarks. The same options produce the same bytes on
+// every platform: values are drawn straight from std::mt19937, whose output
+// the standard fixes, rather than through its distributions, which it
+// does not.
+//
+// Every corpus is one ApplicationWindow holding one Column, with the
+// shape's objects inside. The output stops at the first object boundary
+// past the requested size, so it overshoots by at most one object (one
+// chain for DeepNesting).
+struct QmlCorpusOptions {
+    enum class Shape : uint8_t {
+        Mixed,        // nested containers, leaves and handlers, like a real UI
+        DeepNesting,  // chains of containers maxDepth deep, a Text at the bottom
+        WideColumn,   // one Column of Texts, Labels and Buttons
+        LongLines,    // objects with dozens of inline properties on one line
+        ManyIds,      // every object has an id
+    };
+
+    Shape shape = Shape::Mixed;
+    size_t bytes = 1024;
+    uint32_t seed = 1;
+    int maxDepth = 256;  // DeepNesting and Mixed
+};
+
+class QmlCorpus {
+public:
+    // Receives the corpus in order, in chunks of up to about 64 KB.
+    using Sink = std::function<void(std::string_view chunk)>;
+
+    static std::string generate(const QmlCorpusOptions &options);
+    // Streams the corpus instead of holding it, for sizes up to a gigabyte.
+    static void generate(const QmlCorpusOptions &options, const Sink &sink);
+
+    // "mixed", "deep", "wide", "long-lines" and "ids".
+    static std::string_view shapeName(QmlCorpusOptions::Shape shape);
+    static bool shapeFromName(std::string_view name, QmlCorpusOptions::Shape &shape);
+
+    // Never emitted, in any shape: searching for it visits every node, once
+    // it is interned (lookups by an unknown name return straight away).
+    static constexpr std::string_view kAbsentType = "Slider";
+};
@@ -0,0 +1,100 @@
+// Writes a synthetic QML corpus to stdout or a file:
+//
+//   qml_corpus_gen [--shape mixed|deep|wide|long-lines|ids] [--bytes 64M]
+//                  [--seed N] [--depth N] [--out FILE]
+//
+// Sizes take a K, M or G suffix (powers of 1024).
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "qml_corpus.h"
+
+namespace {
+
+bool parseSize(const char *text, size_t &size) {
+    char *end = nullptr;
+    const unsigned long long value = std::strtoull(text, &end, 10);
+    if (end == text) {
+        return false;
+    }
+    unsigned long long scale = 1;
+    if (*end == 'K' || *end == 'k') {
+        scale = 1024ULL;
+    } else if (*end == 'M' || *end == 'm') {
+        scale = 1024ULL * 1024;
+    } else if (*end == 'G' || *end == 'g') {
+        scale = 1024ULL * 1024 * 1024;
+    } else if (*end != '\0') {
+        return false;
+    }
+    if (scale != 1 && end[1] != '\0') {
+        return false;
+    }
+    size = static_cast<size_t>(value * scale);
+    return true;
+}
+
+int usage() {
+    std::fprintf(stderr,
+                 "usage: qml_corpus_gen [--shape mixed|deep|wide|long-lines|ids] [--bytes SIZE] [--seed N]\n"
+                 "                      [--depth N] [--out FILE]\n");
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    QmlCorpusOptions options;
+    const char *outPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return usage();
+        }
+        ++i;
+        if (std::strcmp(arg, "--shape") == 0) {
+            if (!QmlCorpus::shapeFromName(value, options.shape)) {
+                return usage();
+            }
+        } else if (std::strcmp(arg, "--bytes") == 0) {
+            if (!parseSize(value, options.bytes)) {
+                return usage();
+            }
+        } else if (std::strcmp(arg, "--seed") == 0) {
+            options.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--depth") == 0) {
+            options.maxDepth = std::atoi(value);
+            if (options.maxDepth < 1) {
+                return usage();
+            }
+        } else if (std::strcmp(arg, "--out") == 0) {
+            outPath = value;
+        } else {
+            return usage();
+        }
+    }
+
+    FILE *out = outPath ? std::fopen(outPath, "wb") : stdout;
+    if (!out) {
+        std::perror(outPath);
+        return 1;
+    }
+    bool ok = true;
+    QmlCorpus::generate(options, [out, &ok](std::string_view chunk) {
+        ok = ok && std::fwrite(chunk.data(), 1, chunk.size(), out) == chunk.size();
+    });
+    if (outPath) {
+        ok = std::fclose(out) == 0 && ok;
+    } else {
+        ok = std::fflush(out) == 0 && ok;
+    }
+    if (!ok) {
+        std::perror(outPath ? outPath : "stdout");
+        return 1;
+    }
+    return 0;
+}
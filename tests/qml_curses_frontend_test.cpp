@@ -1,6 +1,44 @@
 #include <QtTest>
 
+#include <algorithm>
+#include <atomic>
+#include <curses.h>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "qml_alloc_tracker.h"
+#include "qml_buffer_screen.h"
+#include "qml_cache_budget.h"
+#include "qml_compiled_frame.h"
+#include "qml_compositor.h"
+#include "qml_console_screen.h"
+#include "qml_coroutine.h"
+#include "qml_corpus.h"
 #include "qml_curses_frontend.h"
+#include "qml_executor.h"
+#include "qml_frame_pipeline.h"
+#include "qml_frame_scheduler.h"
+#include "qml_golden.h"
+#include "qml_input_coalescer.h"
+#include "qml_log.h"
+#include "qml_log_ring.h"
+#include "qml_metrics.h"
+#include "qml_remote_screen.h"
+#include "qml_render_compiler.h"
+#include "qml_screen_trace.h"
+#include "qml_session_memory.h"
+#include "qml_telnet.h"
+#include "qml_text_search.h"
+#include "qml_text_width.h"
+#include "qml_trace.h"
+#include "qml_text_wrap.h"
+#include "qml_vt_screen.h"
+#include "SignIn_qml.h"
 
 namespace {
 
@@ -23,13 +61,31 @@ public:
         draws.push_back(DrawCall{row, col, text});
     }
 
+    void drawRuns(const ScreenRun *runs, size_t count) override {
+        ++runBatches;
+        if (!nativeRuns) {
+            ICursesScreen::drawRuns(runs, count);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            draws.push_back(DrawCall{runs[i].row, runs[i].col, std::string(runs[i].text)});
+        }
+    }
+
     void refresh() override { refreshed = true; }
 
     int rows() const override { return rows_; }
     int cols() const override { return cols_; }
 
+    void resize(int rows, int cols) {
+        rows_ = rows;
+        cols_ = cols;
+    }
+
     bool cleared = false;
     bool refreshed = false;
+    bool nativeRuns = true;
+    int runBatches = 0;
     std::vector<DrawCall> draws;
 
 private:
@@ -45,6 +101,64 @@ class QmlCursesFrontendTest : public QObject {
 private slots:
     void centers_title_and_items();
     void resolves_bindings();
+    void updates_only_changed_text();
+    void cell_grid_sends_changed_runs();
+    void cell_grid_finds_a_change_in_any_column();
+    void cell_grid_scrolls_moved_rows();
+    void renders_log_view_tail();
+    void replays_plan_with_fresh_bindings();
+    void caches_resolved_bindings();
+    void resolves_bindings_in_batches();
+    void patches_async_bindings();
+    void prefetches_ahead_of_the_scroll();
+    void virtualizes_long_columns();
+    void vt_screen_emits_deltas();
+    void vt_screen_compresses_within_budget();
+    void console_screen_commits_dirty_rectangles();
+    void writes_bindings_in_place();
+    void lays_out_nested_containers();
+    void resizes_without_remeasuring();
+    void coalesces_frame_requests();
+    void throttles_frames_while_idle();
+    void exports_open_metrics();
+    void merges_worker_metrics();
+    void awaits_resolvers_and_frames();
+    void logs_from_a_writer_thread();
+    void keeps_caches_within_a_budget();
+    void accounts_memory_per_session();
+    void measures_display_width();
+    void wraps_text_with_cached_breaks();
+    void scrolls_rows_from_pad();
+    void finds_text_incrementally();
+    void composites_layers();
+    void skips_identical_frames();
+    void streams_frames_to_viewers();
+    void parses_telnet_negotiation();
+    void renders_to_buffer();
+    void records_and_replays_traces();
+    void reports_frame_stats();
+    void exports_trace_spans();
+    void steady_state_render_does_not_allocate();
+    void instantiates_components_in_view_only();
+    void time_slices_long_frames();
+    void resolves_the_focused_item_first();
+    void repeats_delegates_over_models();
+    void recycles_ops_and_rows();
+    void repaints_a_tab_from_its_cache();
+    void runs_tasks_on_an_executor();
+    void resolves_bindings_on_the_executor();
+    void pipelines_frames_to_the_screen_thread();
+    void measures_input_latency();
+    void edits_fields_and_moves_focus();
+    void coalesces_pasted_and_typed_input();
+    void hit_tests_mouse_presses();
+    void animates_on_a_shared_timeline();
+    void draws_colors_and_bold();
+    void matches_golden_frames();
+    void matches_golden_corpus_frames();
+    void compiled_render_matches_interpreter();
+    void draws_registered_elements();
+    void render_compiler_rejects_dynamic_screens();
 };
 
 void QmlCursesFrontendTest::centers_title_and_items() {
@@ -138,5 +252,3104 @@ ApplicationWindow {
     QCOMPARE(screen.draws[3].row, 4);
 }
 
+void QmlCursesFrontendTest::updates_only_changed_text() {
+    const std::string before = R"(
+ApplicationWindow {
+    title: "Demo"
+    Column {
+        spacing: 1
+        Text { text: "Hello" }
+        Button { text: "Do it" }
+        Label { text: "Done" }
+    }
+}
+)";
+    std::string after = before;
+    after.replace(after.find("Done"), 4, "Ok!!");
+
+    QmlParser parser;
+    const QmlDocument oldDoc = parser.parseString(before);
+    const QmlDocument newDoc = parser.parseString(after);
+
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen);
+    frontend.render(oldDoc);
+    const DrawCall done = screen.draws[3];
+
+    screen.cleared = false;
+    screen.refreshed = false;
+    screen.draws.clear();
+    frontend.update(newDoc, QmlDocumentDiff::compute(oldDoc, newDoc));
+
+    QCOMPARE(screen.cleared, false);
+    QCOMPARE(screen.refreshed, true);
+    QCOMPARE(screen.draws.size(), static_cast<size_t>(1));
+    QCOMPARE(screen.draws[0].text, std::string("Ok!!"));
+    QCOMPARE(screen.draws[0].row, done.row);
+    QCOMPARE(screen.draws[0].col, done.col);
+    QCOMPARE(frontend.cellsWrittenLastFrame(), static_cast<size_t>(4));
+
+    // Re-rendering an identical frame writes nothing.
+    screen.refreshed = false;
+    screen.draws.clear();
+    frontend.render(newDoc);
+    QCOMPARE(screen.refreshed, false);
+    QCOMPARE(frontend.cellsWrittenLastFrame(), static_cast<size_t>(0));
+
+    screen.refreshed = false;
+    screen.draws.clear();
+    frontend.update(newDoc, QmlDocumentDiff());
+    QCOMPARE(screen.refreshed, false);
+    QVERIFY(screen.draws.empty());
+}
+
+void QmlCursesFrontendTest::cell_grid_sends_changed_runs() {
+    MockScreen screen(3, 20);
+    QmlCellGrid grid;
+    grid.resize(screen.rows(), screen.cols());
+    grid.put(0, 2, "[ Hello ]");
+    grid.put(2, 18, "clipped");
+    QCOMPARE(grid.flush(screen), static_cast<size_t>(11));
+    QCOMPARE(screen.cleared, true);
+    QCOMPARE(screen.draws.size(), static_cast<size_t>(2));
+    QCOMPARE(screen.draws[0].text, std::string("[ Hello ]"));  // inner blank kept in the run
+    QCOMPARE(screen.draws[1].text, std::string("cl"));
+
+    // Two changes a short gap apart go out as one run; distant ones do not.
+    screen.cleared = false;
+    screen.draws.clear();
+    grid.put(0, 4, "J");
+    grid.put(0, 8, "!");
+    grid.put(1, 0, "x");
+    grid.put(1, 10, "y");
+    QCOMPARE(grid.flush(screen), static_cast<size_t>(7));
+    QCOMPARE(screen.cleared, false);
+    QCOMPARE(screen.draws.size(), static_cast<size_t>(3));
+    QCOMPARE(screen.draws[0].text, std::string("Jell!"));
+    QCOMPARE(screen.draws[0].col, 4);
+    QCOMPARE(screen.draws[1].text, std::string("x"));
+    QCOMPARE(screen.draws[2].text, std::string("y"));
+    QCOMPARE(screen.runBatches, 2);
+
+    screen.draws.clear();
+    QCOMPARE(grid.flush(screen), static_cast<size_t>(0));
+    QVERIFY(screen.draws.empty());
+    QCOMPARE(screen.runBatches, 2);
+
+    // Screens without a native drawRuns() get one drawText() per run.
+    screen.nativeRuns = false;
+    grid.put(0, 0, "ab");
+    grid.put(2, 0, "cd");
+    QCOMPARE(grid.flush(screen), static_cast<size_t>(4));
+    QCOMPARE(screen.runBatches, 3);
+    QCOMPARE(screen.draws.size(), static_cast<size_t>(2));
+    QCOMPARE(screen.draws[1].text, std::string("cd"));
+    QCOMPARE(screen.draws[1].row, 2);
+}
+
+// The row kernels compare several cells a step; a change is found in any
+// lane and in the columns past the last whole step, glyph or attributes.
+void QmlCursesFrontendTest::cell_grid_finds_a_change_in_any_column() {
+    constexpr int kCols = 37;
+    MockScreen screen(2, kCols);
+    QmlCellGrid grid;
+    grid.resize(screen.rows(), screen.cols());
+    grid.flush(screen);
+    for (int col = 0; col < kCols; ++col) {
+        screen.draws.clear();
+        grid.put(0, col, "#");
+        grid.set(1, col, QmlCell{' ', 1});
+        QCOMPARE(grid.flush(screen), static_cast<size_t>(2));
+        QCOMPARE(screen.draws.size(), static_cast<size_t>(2));
+        QCOMPARE(screen.draws[0].col, col);
+        QCOMPARE(screen.draws[1].row, 1);
+        QCOMPARE(screen.draws[1].col, col);
+    }
+}
+
+void QmlCursesFrontendTest::cell_grid_scrolls_moved_rows() {
+    // A header, a six-line log pane and a footer.
+    const auto compose = [](QmlCellGrid &grid, int firstLine) {
+        grid.clear();
+        grid.put(0, 0, "== tail ==");
+        for (int row = 1; row <= 6; ++row) {
+            grid.put(row, 0, "line " + std::to_string(firstLine + row - 1) + " of the log");
+        }
+        grid.put(7, 0, "-- footer --");
+    };
+    QmlBufferScreen buffer(8, 30);
+    QmlCellGrid grid;
+    grid.resize(8, 30);
+    compose(grid, 1);
+    grid.flush(buffer);
+
+    compose(grid, 2);  // one line appended
+    grid.flush(buffer);
+    QCOMPARE(grid.scrollCount(), size_t(1));
+    QCOMPARE(grid.runsLastFlush(), size_t(1));
+    QCOMPARE(buffer.row(6), std::string("line 7 of the log"));
+    QCOMPARE(buffer.row(1), std::string("line 2 of the log"));
+    QCOMPARE(buffer.row(7), std::string("-- footer --"));
+
+    compose(grid, 1);  // and scrolled back
+    grid.flush(buffer);
+    QCOMPARE(grid.scrollCount(), size_t(2));
+    QCOMPARE(grid.runsLastFlush(), size_t(1));
+    QCOMPARE(buffer.row(1), std::string("line 1 of the log"));
+    QCOMPARE(buffer.row(6), std::string("line 6 of the log"));
+
+    // On a terminal: a scrolling region, one scroll and the new line.
+    std::string out;
+    VtScreen vt(8, 30, [&out](std::string_view bytes) { out.append(bytes); });
+    vt.setSynchronizedOutput(false);
+    QmlCellGrid terminal;
+    terminal.resize(8, 30);
+    compose(terminal, 1);
+    terminal.flush(vt);
+    vt.refresh();
+    out.clear();
+    compose(terminal, 2);
+    terminal.flush(vt);
+    vt.refresh();
+    QCOMPARE(out, std::string("\x1b[2;7r\x1b[S\x1b[r\x1b[7Hline 7 of the log"));
+
+    // Screens that cannot scroll get the moved rows redrawn.
+    MockScreen screen(8, 30);
+    QmlCellGrid plain;
+    plain.resize(8, 30);
+    compose(plain, 1);
+    plain.flush(screen);
+    compose(plain, 2);
+    plain.flush(screen);
+    QCOMPARE(plain.scrollCount(), size_t(0));
+    QCOMPARE(plain.runsLastFlush(), size_t(6));
+}
+
+void QmlCursesFrontendTest::renders_log_view_tail() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        spacing: 0
+        Text { text: "== build ==" }
+        LogView { model: buildLog; height: 4; width: 20 }
+        Text { text: "-- end --" }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    // Appends from several threads; a frame is requested once per batch.
+    QmlLogRing ring(16, 12);
+    std::atomic<int> wakes{0};
+    ring.setAppendedHandler([&wakes] { ++wakes; });
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < 4; ++producer) {
+        producers.emplace_back([&ring, producer] {
+            for (int line = 0; line < 100; ++line) {
+                ring.append("p" + std::to_string(producer) + " line " + std::to_string(line));
+            }
+        });
+    }
+    for (std::thread &producer : producers) {
+        producer.join();
+    }
+    QCOMPARE(ring.appended(), uint64_t(400));
+    QCOMPARE(ring.dropped(), uint64_t(0));
+    QCOMPARE(wakes.load(), 1);
+
+    QmlBufferScreen screen(6, 20);
+    QmlCursesFrontend frontend(screen, [](const std::string &) { return std::string(); });
+    frontend.setLogRing("buildLog", &ring);
+    ring.append("first");
+    ring.append("second line cut short");  // at lineBytes
+    frontend.render(doc);
+    QCOMPARE(screen.row(3), std::string("first"));
+    QCOMPARE(screen.row(4), std::string("second line"));
+    QCOMPARE(screen.row(5), std::string("     -- end --"));
+
+    // The tail moves up a line: the terminal scrolls the pane rather than
+    // redrawing it.
+    std::string out;
+    VtScreen terminal(6, 20, [&out](std::string_view bytes) { out.append(bytes); });
+    terminal.setSynchronizedOutput(false);
+    QmlCursesFrontend remote(terminal, [](const std::string &) { return std::string(); });
+    remote.setLogRing("buildLog", &ring);
+    remote.render(doc);
+    out.clear();
+    ring.rearm();
+    ring.append("third");
+    remote.render(doc);
+    QCOMPARE(out, std::string("\x1b[2;5r\x1b[S\x1b[r\x1b[5Hthird"));
+    frontend.render(doc);
+    QCOMPARE(screen.row(3), std::string("second line"));
+    QCOMPARE(screen.row(4), std::string("third"));
+
+    // While lines are pinned a full ring drops new ones rather than
+    // overwrite them.
+    QCOMPARE(ring.pin(4), size_t(4));
+    for (int line = 0; line < 16; ++line) {
+        ring.append("overflow");
+    }
+    QVERIFY(ring.dropped() > 0);
+    QCOMPARE(ring.line(3), std::string_view("third"));
+    ring.unpin();
+    QVERIFY(ring.append("after"));
+
+    frontend.setLogRing("buildLog", nullptr);
+    remote.setLogRing("buildLog", nullptr);
+}
+
+void QmlCursesFrontendTest::replays_plan_with_fresh_bindings() {
+    const std::string qml = R"(
+ApplicationWindow {
+    title: "Plan"
+    Column {
+        Text { text: greeter.message }
+        Label { text: "Static" }
+    }
+}
+)";
+
+    QmlParser parser;
+    QmlDocument doc = parser.parseString(qml);
+
+    std::string message = "first";
+    int resolverCalls = 0;
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, [&](const std::string &binding) {
+        ++resolverCalls;
+        return binding == "greeter.message" ? message : std::string();
+    });
+    frontend.render(doc);
+    QCOMPARE(screen.draws[1].text, std::string("first"));
+    QCOMPARE(resolverCalls, 1);  // literals never reach the resolver
+
+    // The plan keeps the binding, not its value.
+    message = "second";
+    frontend.invalidateBinding("greeter.message");
+    screen.draws.clear();
+    frontend.render(doc);
+    QCOMPARE(resolverCalls, 2);
+    QCOMPARE(screen.draws.size(), static_cast<size_t>(1));
+    QCOMPARE(screen.draws[0].text, std::string("second"));
+
+    // The document itself is only read again once the plan is invalidated.
+    doc.roots.front().setProperty(QmlAtoms::title, "Edited");
+    screen.draws.clear();
+    frontend.render(doc);
+    QVERIFY(screen.draws.empty());
+    frontend.invalidatePlan();
+    frontend.render(doc);
+    QCOMPARE(screen.draws.size(), static_cast<size_t>(1));
+    QCOMPARE(screen.draws[0].text, std::string("Edited"));
+}
+
+void QmlCursesFrontendTest::caches_resolved_bindings() {
+    const std::string qml = R"(
+ApplicationWindow {
+    title: window.title
+    Column {
+        Text { text: greeter.message }
+        Label { text: greeter.message }
+        Button { text: actionLabel }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    std::vector<std::string> calls;
+    uint64_t version = 7;
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, [&calls](const std::string &binding) {
+        calls.push_back(binding);
+        return binding + "!";
+    });
+    frontend.render(doc);
+    QCOMPARE(calls.size(), static_cast<size_t>(3));  // each distinct binding once
+
+    frontend.render(doc);
+    frontend.update(doc, QmlDocumentDiff{{QmlChange{}}});
+    QCOMPARE(calls.size(), static_cast<size_t>(3));
+
+    frontend.invalidateBinding("actionLabel");
+    frontend.render(doc);
+    QCOMPARE(calls.size(), static_cast<size_t>(4));
+    QCOMPARE(calls.back(), std::string("actionLabel"));
+
+    frontend.setBindingVersion([&version] { return version; });
+    frontend.render(doc);
+    QCOMPARE(calls.size(), static_cast<size_t>(7));
+    frontend.render(doc);
+    QCOMPARE(calls.size(), static_cast<size_t>(7));
+    ++version;
+    frontend.render(doc);
+    QCOMPARE(calls.size(), static_cast<size_t>(10));
+}
+
+void QmlCursesFrontendTest::resolves_bindings_in_batches() {
+    const std::string qml = R"(
+ApplicationWindow {
+    title: window.title
+    Column {
+        Text { text: greeter.message }
+        Label { text: greeter.message }
+        TextField { placeholderText: nameField.hint }
+        Button { text: actionLabel }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    std::vector<std::vector<std::string>> batches;
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, [&batches](const std::vector<std::string> &bindings) {
+        batches.push_back(bindings);
+        std::vector<std::string> values;
+        for (const auto &binding : bindings) {
+            values.push_back(binding + "!");
+        }
+        values.pop_back();  // short results read as unresolved
+        return values;
+    });
+    frontend.render(doc);
+
+    QCOMPARE(batches.size(), static_cast<size_t>(2));
+    const std::vector<std::string> first{"window.title", "greeter.message", "actionLabel"};
+    QCOMPARE(batches[0], first);
+    QCOMPARE(batches[1], std::vector<std::string>{"nameField.hint"});
+    QCOMPARE(screen.draws[0].text, std::string("window.title!"));
+    QCOMPARE(screen.draws[3].text, std::string("[ nameField.hint ]"));
+    QCOMPARE(screen.draws[4].text, std::string("[ actionLabel ]"));
+
+    frontend.render(doc);
+    QCOMPARE(batches.size(), static_cast<size_t>(2));
+}
+
+void QmlCursesFrontendTest::patches_async_bindings() {
+    const std::string qml = R"(
+ApplicationWindow {
+    title: window.title
+    Column {
+        Text { text: greeter.message }
+        Label { text: "Ready" }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    std::vector<std::vector<std::string>> requests;
+    std::vector<BindingsReady> callbacks;
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, [&](const std::vector<std::string> &bindings, BindingsReady done) {
+        requests.push_back(bindings);
+        callbacks.push_back(std::move(done));
+    });
+    int notified = 0;
+    frontend.setBindingsReadyNotifier([&notified] { ++notified; });
+
+    frontend.render(doc);
+    QCOMPARE(requests.size(), static_cast<size_t>(1));
+    QCOMPARE(requests[0], (std::vector<std::string>{"window.title", "greeter.message"}));
+    QCOMPARE(frontend.pendingBindingCount(), static_cast<size_t>(2));
+    QCOMPARE(screen.draws[0].text, std::string("..."));
+    QCOMPARE(screen.draws[1].text, std::string("..."));
+    QCOMPARE(screen.draws[2].text, std::string("Ready"));
+
+    // In-flight bindings are not requested again.
+    frontend.render(doc);
+    QCOMPARE(requests.size(), static_cast<size_t>(1));
+    QVERIFY(!frontend.applyResolvedBindings());
+
+    std::thread worker([&callbacks] { callbacks[0]({"Demo", "Hi"}); });
+    worker.join();
+    QCOMPARE(notified, 1);
+
+    screen.draws.clear();
+    screen.cleared = false;
+    QVERIFY(frontend.applyResolvedBindings());
+    QVERIFY(!screen.cleared);
+    QCOMPARE(frontend.pendingBindingCount(), static_cast<size_t>(0));
+    QCOMPARE(screen.draws.size(), static_cast<size_t>(2));
+    QCOMPARE(screen.draws[0].text, std::string("Demo"));
+    QCOMPARE(screen.draws[1].text, std::string("Hi "));
+
+    // Values that arrive after the cache was dropped are stale.
+    frontend.invalidateAllBindings();
+    frontend.render(doc);
+    QCOMPARE(requests.size(), static_cast<size_t>(2));
+    callbacks[0]({"Old", "Old"});
+    QVERIFY(!frontend.applyResolvedBindings());
+    callbacks[1]({"New", "Hey"});
+    QVERIFY(frontend.applyResolvedBindings());
+    QVERIFY(frontend.cellsWrittenLastFrame() > 0);
+}
+
+void QmlCursesFrontendTest::prefetches_ahead_of_the_scroll() {
+    std::string qml = "ApplicationWindow {\n    title: \"List\"\n    Column {\n        spacing: 0\n";
+    for (int i = 0; i < 200; ++i) {
+        qml += "        Text { text: item" + std::to_string(i) + " }\n";
+    }
+    qml += "    }\n}\n";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    std::vector<std::vector<std::string>> requests;
+    std::vector<BindingsReady> callbacks;
+    MockScreen screen(10, 40);
+    QmlCursesFrontend frontend(screen, [&](const std::vector<std::string> &bindings, BindingsReady done) {
+        requests.push_back(bindings);
+        callbacks.push_back(std::move(done));
+    });
+    std::vector<std::string> cancelled;
+    frontend.setPrefetch(3, 8, [&cancelled](const std::vector<std::string> &bindings) { cancelled = bindings; });
+
+    // Standing still, only the window is requested: 8 items and 4 below.
+    frontend.render(doc);
+    QCOMPARE(requests.size(), size_t(1));
+    QCOMPARE(requests[0].size(), size_t(12));
+
+    // Two items a frame: the next three frames' items past the overscan.
+    frontend.scrollBy(2);
+    frontend.render(doc);
+    QCOMPARE(frontend.scrollVelocity(), 2L);
+    QCOMPARE(requests.size(), size_t(3));
+    QCOMPARE(requests[1], (std::vector<std::string>{"item12", "item13"}));
+    QCOMPARE(requests[2], (std::vector<std::string>{"item14", "item15", "item16", "item17", "item18", "item19"}));
+    QCOMPARE(frontend.prefetchCount(), size_t(6));
+
+    // At ten a frame the budget caps it.
+    frontend.scrollBy(10);
+    frontend.render(doc);
+    QCOMPARE(requests.back().size(), size_t(8));
+    QCOMPARE(requests.back().front(), std::string("item24"));
+    QCOMPARE(frontend.prefetchCount(), size_t(14));
+
+    // Turning around cancels what is in flight below the window, and its
+    // values are dropped; what the window has come to stays requested.
+    const size_t pending = frontend.pendingBindingCount();
+    frontend.scrollBy(-1);
+    frontend.render(doc);
+    QCOMPARE(frontend.scrollVelocity(), -1L);
+    QCOMPARE(cancelled, requests[4]);
+    QCOMPARE(frontend.prefetchCancelCount(), size_t(8));
+    QCOMPARE(frontend.pendingBindingCount(), pending - 8);
+    QCOMPARE(requests.size(), size_t(5));
+    callbacks[4](std::vector<std::string>(8, "late"));
+    QVERIFY(!frontend.applyResolvedBindings());
+    callbacks[2](std::vector<std::string>(6, "v"));
+    QVERIFY(frontend.applyResolvedBindings());
+
+    // Once scrolling stops the velocity decays and nothing more is asked.
+    const size_t before = requests.size();
+    frontend.render(doc);
+    frontend.render(doc);
+    QCOMPARE(frontend.scrollVelocity(), 0L);
+    QCOMPARE(requests.size(), before);
+}
+
+void QmlCursesFrontendTest::virtualizes_long_columns() {
+    std::string qml = "ApplicationWindow {\n    title: \"List\"\n    Column {\n        spacing: 0\n";
+    for (int i = 0; i < 50000; ++i) {
+        qml += "        Text { text: item" + std::to_string(i) + " }\n";
+    }
+    qml += "    }\n}\n";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    std::vector<std::string> resolved;
+    MockScreen screen(10, 40);
+    QmlCursesFrontend frontend(screen, [&resolved](const std::vector<std::string> &bindings) {
+        resolved.insert(resolved.end(), bindings.begin(), bindings.end());
+        return bindings;
+    });
+    frontend.setOverscan(2);
+    frontend.render(doc);
+
+    QCOMPARE(frontend.itemCount(), static_cast<size_t>(50000));
+    QCOMPARE(frontend.itemsInView(), static_cast<size_t>(8));
+    QCOMPARE(resolved.size(), static_cast<size_t>(10));
+    QCOMPARE(resolved.back(), std::string("item9"));
+    QCOMPARE(screen.draws.back().row, 9);
+    QCOMPARE(screen.draws.back().text, std::string("item7"));
+
+    resolved.clear();
+    frontend.setScrollOffset(1000);
+    frontend.render(doc);
+    QCOMPARE(resolved.size(), static_cast<size_t>(12));
+    QCOMPARE(resolved.front(), std::string("item1000"));  // in view before the overscan
+    QCOMPARE(resolved.back(), std::string("item1009"));
+    QVERIFY(std::any_of(screen.draws.begin(), screen.draws.end(),
+                        [](const DrawCall &draw) { return draw.row == 2 && draw.text.find("1000") != std::string::npos; }));
+
+    // The offset survives re-rendering and is clamped to the last page.
+    frontend.scrollBy(100000);
+    frontend.render(doc);
+    QCOMPARE(frontend.scrollOffset(), static_cast<size_t>(49992));
+    frontend.scrollBy(-100000);
+    QCOMPARE(frontend.scrollOffset(), static_cast<size_t>(0));
+}
+
+void QmlCursesFrontendTest::vt_screen_emits_deltas() {
+    std::string output;
+    VtScreen vt(5, 20, [&output](std::string_view bytes) { output.append(bytes); });
+
+    vt.drawText(1, 2, "ab");
+    vt.drawText(1, 6, "cd");
+    vt.drawStyledText(1, 0, "x", A_BOLD);
+    vt.drawText(3, 0, "yz");
+    vt.refresh();
+    QCOMPARE(output, std::string("\x1b[?2026h\x1b[2;3Hab\x1b[2Ccd\r\x1b[1mx\x1b[4H\x1b[0myz\x1b[?2026l"));
+    QCOMPARE(vt.bytesLastFrame(), output.size());
+
+    output.clear();
+    vt.refresh();
+    QVERIFY(output.empty());
+
+    vt.setSynchronizedOutput(false);
+    vt.drawText(2, 18, "long text");
+    vt.refresh();
+    QCOMPARE(output, std::string("\x1b[3;19Hlo"));
+
+    // Driven by the frontend, an unchanged frame writes nothing at all.
+    const std::string qml = R"(
+ApplicationWindow {
+    title: "Demo"
+    Column {
+        Text { text: "Hello" }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QmlCursesFrontend frontend(vt);
+    frontend.render(doc);
+    QVERIFY(vt.bytesLastFrame() > 0);
+    output.clear();
+    frontend.render(doc);
+    QVERIFY(output.empty());
+}
+
+void QmlCursesFrontendTest::vt_screen_compresses_within_budget() {
+    std::string output;
+    VtScreen vt(3, 20, [&output](std::string_view bytes) { output.append(bytes); });
+    vt.setSynchronizedOutput(false);
+    vt.setBandwidthBudget(1000);
+
+    vt.drawText(0, 0, "==========aaab");
+    vt.drawText(1, 0, "title               ");
+    vt.drawStyledText(2, 14, "x     ", A_BOLD);
+    vt.refresh();
+    // Repeats become REP, and unstyled blanks ending a row become EL;
+    // styled blanks stay, since EL would erase their style.
+    QCOMPARE(output, std::string("\x1b[1H=\x1b[9baaab\x1b[2Htitle\x1b[K\x1b[3;15H\x1b[1mx     "));
+    QCOMPARE(vt.frameDelay(), std::chrono::microseconds(output.size() * 1000));
+    QCOMPARE(vt.bytesPerSecond(), output.size());
+
+    // After EL the cursor is known, so the next run moves relative to it.
+    output.clear();
+    vt.drawText(1, 7, "!");
+    vt.refresh();
+    QCOMPARE(output, std::string("\x1b[2;8H\x1b[0m!"));
+    vt.refresh();
+    QCOMPARE(vt.frameDelay(), std::chrono::microseconds(0));
+}
+
+void QmlCursesFrontendTest::console_screen_commits_dirty_rectangles() {
+    std::vector<QmlConsoleRect> commits;
+    std::u16string committed;
+    QmlConsoleScreen console(6, 20, [&](const QmlConsoleCell *cells, int cols, const QmlConsoleRect &rect) {
+        commits.push_back(rect);
+        for (int col = rect.left; col <= rect.right; ++col) {
+            committed.push_back(cells[rect.top * cols + col].character);
+        }
+    });
+
+    // The first frame writes every cell, as one rectangle.
+    console.drawText(0, 0, "Hello");
+    console.refresh();
+    QCOMPARE(commits.size(), size_t(1));
+    QCOMPARE(std::make_pair(commits[0].top, commits[0].bottom), std::make_pair(0, 5));
+    QCOMPARE(std::make_pair(commits[0].left, commits[0].right), std::make_pair(0, 19));
+    QCOMPARE(console.commitsLastFrame(), size_t(1));
+
+    // Adjacent changed rows merge; rows apart are committed apart, and
+    // cells drawn with what they already hold are not committed at all.
+    commits.clear();
+    committed.clear();
+    console.drawText(0, 0, "Hello");
+    console.drawText(2, 3, "ab");
+    console.drawStyledText(3, 8, "c", A_BOLD | A_UNDERLINE);
+    console.drawText(5, 18, "xyz");
+    console.refresh();
+    QCOMPARE(commits.size(), size_t(2));
+    QCOMPARE(std::make_pair(commits[0].top, commits[0].bottom), std::make_pair(2, 3));
+    QCOMPARE(std::make_pair(commits[0].left, commits[0].right), std::make_pair(3, 8));
+    QCOMPARE(std::make_pair(commits[1].left, commits[1].right), std::make_pair(18, 19));
+    QCOMPARE(committed.substr(0, 6), std::u16string(u"ab    "));
+    QCOMPARE(console.cell(3, 8).attributes, uint16_t(0x07 | 0x08 | 0x8000));
+    console.refresh();
+    QCOMPARE(console.commitsLastFrame(), size_t(0));
+
+    // Colours come from the pair, with the console's own where a side is
+    // the default; wide characters take a leading and a trailing cell.
+    const uint32_t redOnBlue = QmlColorPairs::global().attributes(1, 4);
+    QCOMPARE(console.consoleAttributes(redOnBlue), uint16_t(0x04 | 0x10));
+    QCOMPARE(console.consoleAttributes(QmlColorPairs::global().attributes(QmlColorPairs::kDefault, 9)),
+             uint16_t(0x07 | 0xc0));
+    console.drawStyledText(4, 0, "\xe4\xb8\xad!", A_REVERSE);
+    QCOMPARE(console.cell(4, 0).character, u'\u4e2d');
+    QCOMPARE(console.cell(4, 0).attributes, uint16_t(0x07 | 0x4000 | 0x0100));
+    QCOMPARE(console.cell(4, 1).attributes, uint16_t(0x07 | 0x4000 | 0x0200));
+    QCOMPARE(console.cell(4, 2).character, u'!');
+
+    // Driven by the frontend, an unchanged frame commits nothing.
+    QmlParser parser;
+    const QmlDocument doc =
+        parser.parseString("ApplicationWindow {\n    Column {\n        Text { text: \"Hi\" }\n    }\n}\n");
+    QmlCursesFrontend frontend(console);
+    frontend.render(doc);
+    QVERIFY(console.commitsLastFrame() > 0);
+    commits.clear();
+    frontend.render(doc);
+    QVERIFY(commits.empty());
+}
+
+void QmlCursesFrontendTest::writes_bindings_in_place() {
+    const std::string qml = R"(
+ApplicationWindow {
+    title: window.title
+    Column {
+        Text { text: greeter.message }
+        Label { text: greeter.message }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    std::vector<std::string> written;
+    int tick = 0;
+    const auto writer = [&](std::string_view binding, std::string &value) {
+        QVERIFY(value.empty());
+        written.emplace_back(binding);
+        value = std::string(binding) + "#" + std::to_string(tick);
+    };
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, writer);
+    frontend.render(doc);
+    QCOMPARE(written, (std::vector<std::string>{"window.title", "greeter.message"}));
+    QCOMPARE(screen.draws[0].text, std::string("window.title#0"));
+    QCOMPARE(screen.draws[1].text, std::string("greeter.message#0"));
+
+    // Only the invalidated binding is written again.
+    written.clear();
+    tick = 1;
+    frontend.invalidateBinding("greeter.message");
+    frontend.render(doc);
+    QCOMPARE(written, std::vector<std::string>{"greeter.message"});
+    QCOMPARE(screen.draws.back().text, std::string("1"));
+
+    // The statically dispatched frontend takes the same writer by value.
+    MockScreen other(20, 40);
+    BasicQmlCursesFrontend<MockScreen, decltype(writer)> direct(other, writer);
+    direct.render(doc);
+    QCOMPARE(other.draws[1].text, std::string("greeter.message#1"));
+}
+
+void QmlCursesFrontendTest::lays_out_nested_containers() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        anchors.centerIn: parent
+        spacing: 0
+        Row {
+            spacing: 2
+            Text { text: "ab" }
+            Button { text: "go" }
+        }
+        Grid {
+            columns: 2
+            spacing: 1
+            Text { text: "a" }
+            Text { text: "bbb" }
+            Text { text: "cc" }
+            Label { text: cell }
+        }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    std::string cell = "d";
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, [&cell](const std::string &) { return cell; });
+    frontend.render(doc);
+
+    // Row is 10 wide and the 2x2 grid 6 wide (columns of 2 and 3 plus one
+    // spacing). Four rows in total are centred in 20, from row 8.
+    QCOMPARE(frontend.itemCount(), static_cast<size_t>(2));
+    QCOMPARE(screen.draws.size(), static_cast<size_t>(3));
+    QCOMPARE(screen.draws[0].row, 8);
+    QCOMPARE(screen.draws[0].col, 15);
+    QCOMPARE(screen.draws[0].text, std::string("ab  [ go ]"));
+    QCOMPARE(screen.draws[1].row, 9);
+    QCOMPARE(screen.draws[1].col, 17);
+    QCOMPARE(screen.draws[1].text, std::string("a  bbb"));
+    QCOMPARE(screen.draws[2].row, 11);
+    QCOMPARE(screen.draws[2].text, std::string("cc d"));
+    QCOMPARE(frontend.layoutMeasureCount(), static_cast<size_t>(2));
+
+    // Nothing changed, so nothing is re-measured.
+    frontend.render(doc);
+    QCOMPARE(frontend.layoutMeasureCount(), static_cast<size_t>(2));
+
+    // A wider cell re-measures the grid alone.
+    screen.draws.clear();
+    cell = "dddd";
+    frontend.invalidateBinding("cell");
+    frontend.render(doc);
+    QCOMPARE(frontend.layoutMeasureCount(), static_cast<size_t>(3));
+    QVERIFY(std::any_of(screen.draws.begin(), screen.draws.end(),
+                        [](const DrawCall &draw) { return draw.row == 11 && draw.text.find("dddd") != std::string::npos; }));
+}
+
+void QmlCursesFrontendTest::resizes_without_remeasuring() {
+    const std::string qml = R"(
+ApplicationWindow {
+    title: window.title
+    Column {
+        Row {
+            Text { text: greeter.message }
+            Button { text: "Go" }
+        }
+        Label { text: "Done" }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    int resolverCalls = 0;
+    MockScreen screen(20, 40);
+    QmlCursesFrontend frontend(screen, [&resolverCalls](const std::string &binding) {
+        ++resolverCalls;
+        return binding == "window.title" ? std::string("Demo") : std::string("Hi");
+    });
+    frontend.render(doc);
+    const size_t measured = frontend.layoutMeasureCount();
+    QCOMPARE(resolverCalls, 2);
+    QCOMPARE(screen.draws[0].col, 18);
+
+    screen.resize(10, 60);
+    screen.cleared = false;
+    frontend.render(doc);
+    QVERIFY(screen.cleared);  // the terminal's contents are unknown after a resize
+    QCOMPARE(resolverCalls, 2);
+    QCOMPARE(frontend.layoutMeasureCount(), measured);
+    QCOMPARE(screen.draws[0].text, std::string("Demo"));
+    QCOMPARE(screen.draws[0].col, 28);  // (60 - 4) / 2
+    QCOMPARE(screen.draws[1].text, std::string("Hi [ Go ]"));
+    QCOMPARE(screen.draws[1].col, 25);  // (60 - 9) / 2
+}
+
+void QmlCursesFrontendTest::coalesces_frame_requests() {
+    const char *qml = R"(
+ApplicationWindow {
+    Column {
+        Label { text: greeter.message }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    int counter = 0;
+    MockScreen screen(10, 40);
+    QmlCursesFrontend frontend(screen, [&counter](const std::string &) { return std::to_string(counter); });
+
+    using namespace std::chrono_literals;
+    std::vector<std::chrono::microseconds> wakes;
+    int frames = 0;
+    QmlFrameScheduler scheduler(
+        [&] {
+            ++frames;
+            frontend.render(doc);
+        },
+        [&wakes](std::chrono::microseconds delay) { wakes.push_back(delay); });
+    scheduler.setFrameRate(10);
+    QCOMPARE(scheduler.interval(), std::chrono::microseconds(100ms));
+
+    const auto start = QmlFrameScheduler::Clock::time_point() + 1s;
+    for (int i = 0; i < 1000; ++i) {
+        ++counter;
+        frontend.invalidateBinding("greeter.message");
+        scheduler.requestFrame(start);
+    }
+    QCOMPARE(wakes.size(), size_t(1));
+    QCOMPARE(wakes[0], std::chrono::microseconds(0));
+    scheduler.tick(start);
+    QCOMPARE(frames, 1);
+    QCOMPARE(scheduler.framesCommitted(), uint64_t(1));
+    QCOMPARE(scheduler.requestsCoalesced(), uint64_t(999));
+    QCOMPARE(screen.draws.back().text, std::string("1000"));
+
+    // The next update waits out the rest of the interval.
+    scheduler.requestFrame(start + 40ms);
+    QCOMPARE(wakes.size(), size_t(2));
+    QCOMPARE(wakes[1], std::chrono::microseconds(60ms));
+    scheduler.tick(start + 50ms);  // early wake-up re-arms
+    QCOMPARE(frames, 1);
+    QCOMPARE(wakes.size(), size_t(3));
+    QCOMPARE(wakes[2], std::chrono::microseconds(50ms));
+
+    // Waking 2.5 intervals late misses two frame deadlines.
+    scheduler.tick(start + 350ms);
+    QCOMPARE(frames, 2);
+    QCOMPARE(scheduler.droppedFrames(), uint64_t(2));
+
+    scheduler.tick(start + 500ms);  // nothing pending
+    QCOMPARE(frames, 2);
+    QVERIFY(!scheduler.framePending());
+}
+
+void QmlCursesFrontendTest::throttles_frames_while_idle() {
+    using namespace std::chrono_literals;
+    using std::chrono::microseconds;
+    std::vector<microseconds> wakes;
+    int frames = 0;
+    QmlFrameScheduler scheduler([&frames] { ++frames; },
+                                [&wakes](microseconds delay) { wakes.push_back(delay); });
+    scheduler.setFrameRate(50);
+    scheduler.setIdleFrameRate(2, 1s);
+    const auto start = QmlFrameScheduler::Clock::time_point() + 1s;
+
+    // The first frame counts as input; a second later the UI is idle and
+    // frames wait out the idle interval.
+    scheduler.requestFrame(start);
+    scheduler.tick(start);
+    QVERIFY(!scheduler.idle(start + 999ms));
+    QCOMPARE(scheduler.currentInterval(start + 500ms), microseconds(20ms));
+    QVERIFY(scheduler.idle(start + 1s));
+    scheduler.requestFrame(start + 1200ms);
+    QCOMPARE(wakes.back(), microseconds(0));  // the last frame was long ago
+    scheduler.tick(start + 1200ms);
+    scheduler.requestFrame(start + 1300ms);
+    QCOMPARE(wakes.back(), microseconds(400ms));
+    QCOMPARE(frames, 2);
+
+    // Input brings the pending frame forward to the full rate.
+    scheduler.noteInput(start + 1310ms);
+    QCOMPARE(wakes.back(), microseconds(0));
+    scheduler.tick(start + 1310ms);
+    QCOMPARE(frames, 3);
+    scheduler.requestFrame(start + 1315ms);
+    QCOMPARE(wakes.back(), microseconds(15ms));
+    scheduler.tick(start + 1330ms);
+    QCOMPARE(frames, 4);
+
+    // Losing focus throttles at once, and regaining it counts as input.
+    scheduler.setFocused(false, start + 1400ms);
+    QVERIFY(scheduler.idle(start + 1400ms));
+    scheduler.requestFrame(start + 1400ms);
+    QCOMPARE(wakes.back(), microseconds(430ms));
+    scheduler.setFocused(true, start + 1410ms);
+    QVERIFY(!scheduler.idle(start + 1410ms));
+    QCOMPARE(wakes.back(), microseconds(0));
+
+    // The terminal's focus reports arrive as events.
+    QmlInputCoalescer coalescer;
+    const std::vector<int> report{27, '[', 'O', 'a', 27, '['};
+    coalescer.feed(report);
+    coalescer.feed(std::vector<int>{'I'});
+    std::vector<QmlInputCoalescer::Event> events;
+    coalescer.drain([&events](const QmlInputCoalescer::Event &event) { events.push_back(event); });
+    QCOMPARE(events.size(), size_t(3));
+    QVERIFY(events[0].kind == QmlInputCoalescer::Event::Kind::Focus && events[0].key == 0);
+    QCOMPARE(events[1].text, std::string("a"));
+    QVERIFY(events[2].kind == QmlInputCoalescer::Event::Kind::Focus && events[2].key == 1);
+
+    // Throttling is off at a rate of 0.
+    scheduler.setIdleFrameRate(0);
+    scheduler.setFocused(false, start + 2s);
+    QVERIFY(!scheduler.idle(start + 10s));
+}
+
+void QmlCursesFrontendTest::exports_open_metrics() {
+    using namespace std::chrono_literals;
+    QmlLatencyHistogram frames;
+    frames.record(3ms);
+    frames.record(4ms);
+    frames.record(80ms);
+    QCOMPARE(frames.countAtMost(2ms), uint64_t(0));
+    QCOMPARE(frames.countAtMost(5ms), uint64_t(2));
+    QCOMPARE(frames.countAtMost(1s), uint64_t(3));
+    QCOMPARE(frames.sum().count(), 0.087);
+
+    QmlMetricsText text;
+    text.family("qml_frame_seconds", QmlMetricsText::Type::Histogram, "Time to commit a frame.", "seconds");
+    text.histogram(frames, QmlMetricsText::label("view", "80x24"));
+    text.family("qml_sessions", QmlMetricsText::Type::Gauge, "Connected sessions.");
+    text.gauge(2);
+    text.family("qml_ast_cache_hits", QmlMetricsText::Type::Counter, "Loads answered by the cache.");
+    text.counter(7, QmlMetricsText::label("document", "a \"b\"\\c\n"));
+    const std::string &exposition = text.finish();
+
+    QVERIFY(exposition.rfind("# TYPE qml_frame_seconds histogram\n"
+                             "# UNIT qml_frame_seconds seconds\n"
+                             "# HELP qml_frame_seconds Time to commit a frame.\n"
+                             "qml_frame_seconds_bucket{view=\"80x24\",le=\"1e-05\"} 0\n",
+                             0) == 0);
+    QVERIFY(exposition.find("qml_frame_seconds_bucket{view=\"80x24\",le=\"0.0025\"} 0\n") != std::string::npos);
+    QVERIFY(exposition.find("qml_frame_seconds_bucket{view=\"80x24\",le=\"0.005\"} 2\n") != std::string::npos);
+    QVERIFY(exposition.find("qml_frame_seconds_bucket{view=\"80x24\",le=\"0.1\"} 3\n") != std::string::npos);
+    QVERIFY(exposition.find("qml_frame_seconds_bucket{view=\"80x24\",le=\"+Inf\"} 3\n"
+                            "qml_frame_seconds_count{view=\"80x24\"} 3\n"
+                            "qml_frame_seconds_sum{view=\"80x24\"} 0.087\n") != std::string::npos);
+    QVERIFY(exposition.find("# TYPE qml_sessions gauge\n# HELP qml_sessions Connected sessions.\n"
+                            "qml_sessions 2\n") != std::string::npos);
+    QVERIFY(exposition.find("qml_ast_cache_hits_total{document=\"a \\\"b\\\"\\\\c\\n\"} 7\n") != std::string::npos);
+    QVERIFY(exposition.size() > 6 && exposition.compare(exposition.size() - 6, 6, "# EOF\n") == 0);
+}
+
+void QmlCursesFrontendTest::merges_worker_metrics() {
+    using namespace std::chrono_literals;
+    QmlLatencyHistogram frames;
+    frames.record(3ms);
+    std::string workers[2];
+    for (int i = 0; i < 2; ++i) {
+        QmlMetricsText text;
+        text.family("qml_sessions", QmlMetricsText::Type::Gauge, "Connected sessions.");
+        text.gauge(i + 1);
+        if (i == 1) {
+            text.family("qml_views", QmlMetricsText::Type::Gauge, "Views rendered.");
+            text.gauge(1);
+        }
+        text.family("qml_frame_seconds", QmlMetricsText::Type::Histogram, "Time to commit a frame.", "seconds");
+        text.histogram(frames, QmlMetricsText::label("view", "80x24"));
+        workers[i] = text.finish();
+    }
+
+    QmlMetricsMerger merger;
+    merger.add(workers[0], QmlMetricsText::label("worker", "0"));
+    merger.add(workers[1], QmlMetricsText::label("worker", "1"));
+    QmlMetricsText text;
+    text.family("qml_workers", QmlMetricsText::Type::Gauge, "Worker processes running.");
+    text.gauge(2);
+    merger.appendTo(text);
+    const std::string &exposition = text.finish();
+
+    QVERIFY(exposition.rfind("# TYPE qml_workers gauge\n# HELP qml_workers Worker processes running.\nqml_workers 2\n"
+                             "# TYPE qml_sessions gauge\n# HELP qml_sessions Connected sessions.\n"
+                             "qml_sessions{worker=\"0\"} 1\nqml_sessions{worker=\"1\"} 2\n"
+                             "# TYPE qml_frame_seconds histogram\n",
+                             0) == 0);
+    const size_t first = exposition.find("qml_frame_seconds_count{worker=\"0\",view=\"80x24\"} 1\n");
+    const size_t second = exposition.find("qml_frame_seconds_bucket{worker=\"1\",view=\"80x24\",le=\"1e-05\"} 0\n");
+    QVERIFY(first != std::string::npos && second != std::string::npos && first < second);
+    QVERIFY(exposition.find("# TYPE qml_views gauge\n# HELP qml_views Views rendered.\nqml_views{worker=\"1\"} 1\n") !=
+            std::string::npos);
+    size_t types = 0;
+    for (size_t at = exposition.find("# TYPE "); at != std::string::npos; at = exposition.find("# TYPE ", at + 1)) {
+        ++types;
+    }
+    QCOMPARE(types, static_cast<size_t>(4));
+    QVERIFY(exposition.size() > 6 && exposition.compare(exposition.size() - 6, 6, "# EOF\n") == 0);
+}
+
+#if defined(QML_COROUTINES)
+namespace {
+
+QmlTask<std::string> resolveOne(const AsyncBindingResolver &resolver, std::string binding) {
+    std::vector<std::string> bindings(1, std::move(binding));
+    std::vector<std::string> values = co_await qmlResolveBindings(resolver, std::move(bindings));
+    co_return values.empty() ? std::string() : values[0];
+}
+
+QmlTask<> resolveThenWait(const AsyncBindingResolver &resolver, QmlFrameSignal &frames, std::vector<std::string> &log) {
+    log.push_back(co_await resolveOne(resolver, "greeter.name"));
+    const uint64_t frame = co_await frames.next();
+    log.push_back("frame " + std::to_string(frame));
+    std::vector<std::string> bindings = {"a", "b"};
+    std::vector<std::string> values = co_await qmlResolveBindings(resolver, std::move(bindings));
+    log.insert(log.end(), values.begin(), values.end());
+}
+
+}  // namespace
+#endif
+
+void QmlCursesFrontendTest::awaits_resolvers_and_frames() {
+#if defined(QML_COROUTINES)
+    std::vector<BindingsReady> inFlight;
+    std::vector<std::string> asked;
+    const AsyncBindingResolver resolver = [&](const std::vector<std::string> &bindings, BindingsReady done) {
+        asked.insert(asked.end(), bindings.begin(), bindings.end());
+        inFlight.push_back(std::move(done));
+    };
+    QmlFrameSignal frames;
+    std::vector<std::string> log;
+    resolveThenWait(resolver, frames, log).start();
+    QCOMPARE(asked, std::vector<std::string>{"greeter.name"});
+    QVERIFY(log.empty());
+
+    frames.notify();  // nobody waits yet
+    std::exchange(inFlight, {})[0]({"Ada"});
+    QCOMPARE(log, std::vector<std::string>{"Ada"});
+    QCOMPARE(frames.waiting(), size_t(1));
+
+    frames.notify();
+    QCOMPARE(asked.size(), size_t(3));
+    std::exchange(inFlight, {})[0]({"1", "2"});
+    QCOMPARE(log, (std::vector<std::string>{"Ada", "frame 2", "1", "2"}));
+    QCOMPARE(frames.waiting(), size_t(0));
+
+    // Resumed from another thread, then hopped back through post.
+    std::vector<std::function<void()>> posted;
+    std::thread::id resumedOn;
+    auto hop = [&]() -> QmlTask<> {
+        std::vector<std::string> bindings(1, "c");
+        co_await qmlResolveBindings(resolver, std::move(bindings),
+                                    [&](std::function<void()> run) { posted.push_back(std::move(run)); });
+        resumedOn = std::this_thread::get_id();
+    };
+    hop().start();
+    std::thread([done = std::exchange(inFlight, {})[0]] { done({"3"}); }).join();
+    QCOMPARE(posted.size(), size_t(1));
+    posted[0]();
+    QCOMPARE(resumedOn, std::this_thread::get_id());
+#else
+    QSKIP("Coroutines need a C++20 build (SAMPLE_CXX20)");
+#endif
+}
+
+void QmlCursesFrontendTest::logs_from_a_writer_thread() {
+    QCOMPARE(QmlLog::format("{} of {} at {}: {} {}", 3, 4u, 0.5, std::string("done"), true),
+             std::string("3 of 4 at 0.5: done true"));
+    QCOMPARE(QmlLog::format("{} {}", 'x'), std::string("x {}"));
+    const std::string longText(QmlLog::kTextBytes + 10, 'a');
+    QCOMPARE(QmlLog::format("{}|{}", longText, "b"), std::string(QmlLog::kTextBytes, 'a') + "|");
+
+    QVERIFY(!QmlLog::enabled(QmlLogLevel::Error));
+    QmlLog::error("not recorded");
+    std::mutex mutex;
+    std::string text;
+    std::thread::id writer;
+    QmlLog::start(
+        [&](std::string_view batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            text.append(batch);
+            writer = std::this_thread::get_id();
+        },
+        QmlLogLevel::Info, std::chrono::hours(1));
+    QVERIFY(QmlLog::enabled(QmlLogLevel::Info) && !QmlLog::enabled(QmlLogLevel::Debug));
+    QmlLog::debug("below the level");
+    QmlLog::info("first {}", 1);
+    std::thread worker([] { QmlLog::warning("from a worker, {}", "with text"); });
+    worker.join();
+    QmlLog::info("last {}", 2);
+    QmlLog::flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        QCOMPARE(writer, std::this_thread::get_id());
+        // In time order across threads, each thread named.
+        const size_t first = text.find(" info t");
+        const size_t fromWorker = text.find(" warning t");
+        const size_t last = text.find("last 2\n");
+        QVERIFY(first != std::string::npos && fromWorker > first && last > fromWorker && last != std::string::npos);
+        QVERIFY(text.find(": first 1\n") != std::string::npos);
+        QVERIFY(text.find(": from a worker, with text\n") != std::string::npos);
+        QVERIFY(text.find("below the level") == std::string::npos);
+        QVERIFY(text.find("not recorded") == std::string::npos);
+        text.clear();
+    }
+
+    // Threads that have exited hand their buffers on once drained.
+    const size_t buffers = QmlLog::bufferCount();
+    for (int i = 0; i < 8; ++i) {
+        std::thread([i] { QmlLog::info("short-lived {}", i); }).join();
+        QmlLog::flush();
+    }
+    QCOMPARE(QmlLog::bufferCount(), buffers);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        QVERIFY(text.find(": short-lived 7\n") != std::string::npos);
+        text.clear();
+    }
+
+    // A full buffer drops records rather than wait, and says so.
+    const uint64_t dropped = QmlLog::dropped();
+    for (size_t i = 0; i < QmlLog::kCapacity + 5; ++i) {
+        QmlLog::info("record {}", i);
+    }
+    QCOMPARE(QmlLog::dropped(), dropped + 5);
+    QmlLog::stop();
+    QVERIFY(!QmlLog::enabled(QmlLogLevel::Error));
+    QCOMPARE(static_cast<size_t>(std::count(text.begin(), text.end(), '\n')), QmlLog::kCapacity + 1);
+    QVERIFY(text.find(": 5 log records dropped; the buffer was full\n") != std::string::npos);
+}
+
+void QmlCursesFrontendTest::keeps_caches_within_a_budget() {
+    // Stand-ins for a cheap cache and one four times dearer per byte.
+    size_t cheap = 6000;
+    size_t dear = 4000;
+    const auto evictFrom = [](size_t &cache) {
+        return [&cache](size_t bytes) {
+            const size_t freed = std::min(bytes, cache);
+            cache -= freed;
+            return freed;
+        };
+    };
+    QmlCacheBudget budget(5000);
+    budget.attach("cheap", 1.0, [&cheap] { return cheap; }, evictFrom(cheap));
+    const int dearId = budget.attach("dear", 4.0, [&dear] { return dear; }, evictFrom(dear));
+    QCOMPARE(budget.used(), size_t(10000));
+    // The cheap cache holds the most bytes per unit of cost, so it goes first.
+    QCOMPARE(budget.enforce(), size_t(5000));
+    QCOMPARE(cheap, size_t(1000));
+    QCOMPARE(dear, size_t(4000));
+    QCOMPARE(budget.enforce(), size_t(0));
+    // Moderate pressure trims to half the limit, critical pressure to nothing.
+    QCOMPARE(budget.relieve(QmlCacheBudget::Pressure::Moderate), size_t(2500));
+    QCOMPARE(cheap, size_t(0));
+    QCOMPARE(dear, size_t(2500));
+    QCOMPARE(budget.relieve(QmlCacheBudget::Pressure::Critical), size_t(2500));
+    QCOMPARE(budget.used(), size_t(0));
+
+    QmlMetricsText text;
+    budget.appendMetrics(text);
+    const std::string exposition = text.finish();
+    QVERIFY(exposition.find("qml_cache_limit_bytes 5000\n") != std::string::npos);
+    QVERIFY(exposition.find("qml_cache_evicted_bytes_total{cache=\"cheap\"} 6000\n") != std::string::npos);
+    QVERIFY(exposition.find("qml_cache_evicted_bytes_total{cache=\"dear\"} 4000\n") != std::string::npos);
+    budget.detach(dearId);
+    dear = 100;
+    QCOMPARE(budget.used(), size_t(0));
+
+    // The frontend's binding cache gives up stale entries first, then the
+    // rest, which the next frame resolves again.
+    const QmlDocument doc = QmlParser().parseString(R"(
+ApplicationWindow {
+    Column {
+        Text { text: greeter.message }
+        Text { text: a.binding.name.longer.than.the.inline.buffer }
+    }
+}
+)");
+    size_t resolves = 0;
+    MockScreen screen(10, 60);
+    QmlCursesFrontend frontend(screen, [&resolves](const std::string &binding) {
+        ++resolves;
+        return binding + " resolved to a value that is stored on the heap";
+    });
+    frontend.render(doc);
+    QCOMPARE(resolves, size_t(2));
+    const size_t bindingBytes = frontend.bindingCacheBytes();
+    frontend.invalidateBinding("greeter.message");
+    const size_t freed = frontend.evictBindings(1);
+    QVERIFY(freed > 0);
+    QCOMPARE(frontend.bindingCacheBytes(), bindingBytes - freed);
+    frontend.render(doc);
+    QCOMPARE(resolves, size_t(3));
+    budget.attach(
+        "bindings", 2.0, [&frontend] { return frontend.bindingCacheBytes(); },
+        [&frontend](size_t bytes) { return frontend.evictBindings(bytes); });
+    QVERIFY(budget.relieve(QmlCacheBudget::Pressure::Critical) > 0);
+    frontend.render(doc);
+    QCOMPARE(resolves, size_t(5));
+}
+
+void QmlCursesFrontendTest::accounts_memory_per_session() {
+    // Two sessions showing one view, whose bytes they split.
+    size_t view = 4000;
+    size_t sessionA = 1000;
+    size_t sessionB = 9000;
+    QmlSessionMemory memory(5000);
+    const auto evictView = [&view](size_t share) {
+        const size_t freed = std::min(share * 2, view);
+        view -= freed;
+        return freed / 2;
+    };
+    memory.add(1, [&sessionA] { return sessionA; }, [&view] { return view / 2; }, evictView);
+    memory.add(2, [&sessionB] { return sessionB; }, [&view] { return view / 2; }, evictView);
+    QCOMPARE(memory.usage(1).total(), size_t(3000));
+    QCOMPARE(memory.used(), size_t(14000));
+    // The view's caches go first; what session 2 holds alone still keeps it over.
+    QCOMPARE(memory.enforce(), std::vector<uint64_t>{2});
+    QCOMPARE(view, size_t(0));
+    memory.remove(2);
+    QCOMPARE(memory.sessionCount(), size_t(1));
+    QVERIFY(memory.enforce().empty());
+    memory.setLimit(0);
+    sessionA = 1 << 30;
+    QVERIFY(memory.enforce().empty());
+
+    QmlMetricsText text;
+    memory.appendMetrics(text);
+    const std::string exposition = text.finish();
+    QVERIFY(exposition.find("qml_session_bytes{session=\"1\",kind=\"own\"} 1073741824\n") != std::string::npos);
+    QVERIFY(exposition.find("qml_session_bytes{session=\"1\",kind=\"shared\"} 0\n") != std::string::npos);
+    QVERIFY(exposition.find("qml_session_evicted_bytes_total 2000\n") != std::string::npos);
+    QVERIFY(exposition.find("qml_session_limit_disconnects_total 1\n") != std::string::npos);
+
+    // A session's own share of a server: its damage buffer and terminal.
+    QmlCellGrid grid;
+    grid.resize(24, 80);
+    QVERIFY(grid.byteSize() >= 2 * 24 * 80 * sizeof(QmlCell));
+    QmlBufferScreen screen(24, 80);
+    QCOMPARE(screen.byteSize(), 24 * 80 * sizeof(QmlCell));
+}
+
+void QmlCursesFrontendTest::measures_display_width() {
+    QCOMPARE(QmlTextWidth::of(""), 0);
+    QCOMPARE(QmlTextWidth::of("h\xc3\xa9llo"), 5);           // precomposed e-acute
+    QCOMPARE(QmlTextWidth::of("e\xcc\x81"), 1);              // e + combining acute
+    QCOMPARE(QmlTextWidth::of("\xe6\x97\xa5\xe6\x9c\xac"), 4);  // two CJK ideographs
+    QCOMPARE(QmlTextWidth::of("\xf0\x9f\x98\x80"), 2);         // emoji
+    QCOMPARE(QmlTextWidth::of("a\tb\x7f"), 2);
+    QCOMPARE(QmlTextWidth::of("\xff"), 1);                    // malformed byte
+    // Long enough for the vector kernel, with a wide character at the end.
+    const std::string ascii(70, 'x');
+    QCOMPARE(QmlTextWidth::of(ascii), 70);
+    QCOMPARE(QmlTextWidth::of(ascii + "\xe6\x97\xa5"), 72);
+
+    int width = 0;
+    QCOMPARE(QmlTextWidth::fit("a\xe6\x97\xa5" "b", 2, width), size_t(1));  // the ideograph does not fit
+    QCOMPARE(width, 1);
+    QCOMPARE(QmlTextWidth::fit("ae\xcc\x81", 2, width), size_t(4));  // keeps the trailing mark
+    QCOMPARE(width, 2);
+
+    // Titles and labels are centred by display width, not byte length.
+    const std::string qml = R"(
+ApplicationWindow {
+    title: "日本"
+    Column {
+        Button { text: "café" }
+    }
+}
+)";
+    QmlParser parser;
+    auto doc = parser.parseString(qml);
+    MockScreen screen(10, 20);
+    QmlCursesFrontend frontend(screen);
+    frontend.render(doc);
+
+    QCOMPARE(screen.draws.size(), size_t(2));
+    QCOMPARE(screen.draws[0].text, std::string("\xe6\x97\xa5\xe6\x9c\xac"));
+    QCOMPARE(screen.draws[0].col, 8);  // (20 - 4) / 2
+    QCOMPARE(screen.draws[1].text, std::string("[ caf\xc3\xa9 ]"));
+    QCOMPARE(screen.draws[1].col, 6);  // (20 - 8) / 2
+
+    // A wide character cut by the right edge becomes a blank cell.
+    MockScreen narrow(1, 4);
+    QmlCellGrid grid;
+    grid.resize(narrow.rows(), narrow.cols());
+    QCOMPARE(grid.put(0, 1, "\xe6\x97\xa5\xe6\x9c\xac"), 4);
+    QCOMPARE(grid.flush(narrow), size_t(2));
+    QCOMPARE(narrow.draws.size(), size_t(1));
+    QCOMPARE(narrow.draws[0].col, 1);
+    QCOMPARE(narrow.draws[0].text, std::string("\xe6\x97\xa5"));
+    QCOMPARE(grid.at(0, 3).glyph, uint32_t(' '));
+
+    // Overwriting half of a wide character blanks the other half.
+    narrow.draws.clear();
+    grid.put(0, 2, "x");
+    QCOMPARE(grid.flush(narrow), size_t(2));
+    QCOMPARE(narrow.draws.size(), size_t(1));
+    QCOMPARE(narrow.draws[0].col, 1);
+    QCOMPARE(narrow.draws[0].text, std::string(" x"));
+}
+
+void QmlCursesFrontendTest::wraps_text_with_cached_breaks() {
+    const auto texts = [](const std::vector<QmlTextWrap::Line> &lines) {
+        std::vector<std::string> out;
+        for (const auto &line : lines) {
+            out.emplace_back(line.text);
+        }
+        return out;
+    };
+    using Lines = std::vector<std::string>;
+
+    QmlTextWrap wrap;
+    QCOMPARE(texts(wrap.wrap("the quick brown fox", 10)), (Lines{"the quick", "brown fox"}));
+    QCOMPARE(wrap.widest(), 9);
+    QCOMPARE(texts(wrap.wrap("the quick brown fox", 10)), (Lines{"the quick", "brown fox"}));
+    QCOMPARE(wrap.scans(), size_t(1));
+    QCOMPARE(wrap.fits(), size_t(1));
+    // A new width re-fits the cached words without rescanning.
+    QCOMPARE(texts(wrap.wrap("the quick brown fox", 16)), (Lines{"the quick brown", "fox"}));
+    QCOMPARE(wrap.scans(), size_t(1));
+    QCOMPARE(wrap.fits(), size_t(2));
+
+    // Newlines always break; overlong words are split by Wrap only.
+    QCOMPARE(texts(wrap.wrap("ab\n\n  abcdefghijkl", 5)), (Lines{"ab", "", "  abc", "defgh", "ijkl"}));
+    QCOMPARE(wrap.scans(), size_t(2));
+    QmlTextWrap words(QmlTextWrap::Mode::WordWrap);
+    QCOMPARE(texts(words.wrap("a abcdefgh b", 4)), (Lines{"a", "abcdefgh", "b"}));
+    QmlTextWrap anywhere(QmlTextWrap::Mode::WrapAnywhere);
+    QCOMPARE(texts(anywhere.wrap("ab cdef", 4)), (Lines{"ab c", "def"}));
+    // Wide characters are never cut in half.
+    QCOMPARE(texts(anywhere.wrap("\xe6\x97\xa5\xe6\x97\xa5\xe6\x97\xa5", 5)),
+             (Lines{"\xe6\x97\xa5\xe6\x97\xa5", "\xe6\x97\xa5"}));
+    QCOMPARE(QmlTextWrap::modeFor("Text.Wrap"), QmlTextWrap::Mode::Wrap);
+    QCOMPARE(QmlTextWrap::modeFor("Text.WordWrap"), QmlTextWrap::Mode::WordWrap);
+    QCOMPARE(QmlTextWrap::modeFor("Text.NoWrap"), QmlTextWrap::Mode::NoWrap);
+
+    // The frontend wraps at the screen width and moves later items down.
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        spacing: 0
+        Label { text: "one two three four"; wrapMode: Text.Wrap }
+        Button { text: "Ok" }
+    }
+}
+)";
+    QmlParser parser;
+    auto doc = parser.parseString(qml);
+    MockScreen screen(10, 10);
+    QmlCursesFrontend frontend(screen);
+    frontend.render(doc);
+
+    QCOMPARE(screen.draws.size(), size_t(3));
+    QCOMPARE(screen.draws[0].text, std::string("one two"));
+    QCOMPARE(screen.draws[0].row, 0);
+    QCOMPARE(screen.draws[0].col, 0);  // lines are left-aligned in the label
+    QCOMPARE(screen.draws[1].text, std::string("three four"));
+    QCOMPARE(screen.draws[1].row, 1);
+    QCOMPARE(screen.draws[1].col, 0);
+    QCOMPARE(screen.draws[2].text, std::string("[ Ok ]"));
+    QCOMPARE(screen.draws[2].row, 2);
+
+    // A wider screen re-wraps onto one line and pulls the button up.
+    screen.resize(10, 30);
+    frontend.render(doc);
+    QCOMPARE(screen.draws.size(), size_t(2));
+    QCOMPARE(screen.draws[0].text, std::string("one two three four"));
+    QCOMPARE(screen.draws[1].row, 1);
+}
+
+void QmlCursesFrontendTest::scrolls_rows_from_pad() {
+    std::string qml = "ApplicationWindow {\n    title: \"Report\"\n    Column {\n        spacing: 0\n";
+    for (int i = 0; i < 40; ++i) {
+        qml += "        Text { text: \"line " + std::to_string(i) + "\" }\n";
+    }
+    qml += "        Text { text: status.text }\n    }\n}\n";
+
+    QmlParser parser;
+    auto doc = parser.parseString(qml);
+    MockScreen screen(10, 20);
+    int resolves = 0;
+    QmlCursesFrontend frontend(screen, [&resolves](const std::string &) {
+        ++resolves;
+        return std::string("done");
+    });
+    frontend.setScrollMode(QmlCursesFrontend::ScrollMode::Rows);
+    frontend.render(doc);
+
+    QCOMPARE(frontend.padComposeCount(), size_t(1));
+    QCOMPARE(frontend.contentRows(), 41);
+    QCOMPARE(resolves, 1);
+    QCOMPARE(screen.draws.size(), size_t(9));  // title and rows 2..9
+    QCOMPARE(screen.draws[0].text, std::string("Report"));
+    QCOMPARE(screen.draws[1].text, std::string("line 0"));
+    QCOMPARE(screen.draws[1].row, 2);
+
+    // Scrolling copies rows out of the pad; nothing is resolved or laid out.
+    const size_t measures = frontend.layoutMeasureCount();
+    screen.draws.clear();
+    frontend.scrollRowsBy(30);
+    frontend.render(doc);
+    QCOMPARE(frontend.padComposeCount(), size_t(1));
+    QCOMPARE(frontend.layoutMeasureCount(), measures);
+    QCOMPARE(resolves, 1);
+    QCOMPARE(screen.draws.front().row, 2);
+    QCOMPARE(screen.draws.front().text, std::string("30"));  // "line " is unchanged
+
+    // Past the end the offset is clamped so the last row sits at the bottom.
+    screen.draws.clear();
+    frontend.scrollRowsBy(100);
+    frontend.render(doc);
+    QCOMPARE(frontend.scrollRow(), 33);
+    QCOMPARE(screen.draws.back().row, 9);
+    QVERIFY(screen.draws.back().text.find("done") != std::string::npos);
+
+    // A changed binding recomposes the pad.
+    frontend.invalidateBinding("status.text");
+    frontend.render(doc);
+    QCOMPARE(frontend.padComposeCount(), size_t(2));
+    QCOMPARE(resolves, 2);
+    QCOMPARE(frontend.scrollRow(), 33);
+}
+
+void QmlCursesFrontendTest::finds_text_incrementally() {
+    QmlTextSearch search;
+    search.resize(1000);
+    for (size_t line = 0; line < 1000; ++line) {
+        search.setLine(line, line % 10 == 0 ? "job " + std::to_string(line) + " ERROR: disk full"
+                                            : "job " + std::to_string(line) + " erased the cache");
+    }
+    QCOMPARE(search.find("er").size(), size_t(1000));
+    QCOMPARE(search.linesScanned(), size_t(1000));
+    // Longer queries only look at the lines the shorter one matched.
+    QCOMPARE(search.find("err").size(), size_t(100));
+    QCOMPARE(search.find("error").size(), size_t(100));
+    QCOMPARE(search.linesScanned(), size_t(100));
+    QCOMPARE(search.matches()[1].line, size_t(10));
+    QCOMPARE(search.matches()[1].offset, size_t(7));
+    // A changed line is looked at again, and an unchanged one is not
+    // re-indexed.
+    const size_t indexed = search.linesIndexed();
+    QVERIFY(!search.setLine(20, "job 20 ERROR: disk full"));
+    QVERIFY(search.setLine(21, "job 21 error: error"));
+    QCOMPARE(search.linesIndexed(), indexed + 1);
+    QCOMPARE(search.find("error").size(), size_t(102));
+    QCOMPARE(search.linesScanned(), size_t(101));
+    // Anything else scans every line whose signature fits.
+    QCOMPARE(search.find("cache").size(), size_t(899));
+    QVERIFY(search.find("").empty());
+
+    std::string qml = "ApplicationWindow {\n    title: \"Log\"\n    Column {\n        spacing: 0\n";
+    for (int i = 0; i < 40; ++i) {
+        qml += "        Text { text: \"step " + std::to_string(i) + (i == 25 || i == 31 ? " failed\" }\n" : " ok\" }\n");
+    }
+    qml += "    }\n}\n";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QmlBufferScreen screen(10, 24);
+    QmlCursesFrontend frontend(screen);
+    frontend.setScrollMode(QmlCursesFrontend::ScrollMode::Rows);
+    frontend.render(doc);
+
+    QVERIFY(frontend.handleKey(QmlCursesFrontend::kFindKey));
+    for (const char key : std::string("FAIL")) {
+        QVERIFY(frontend.handleKey(key));
+    }
+    frontend.render(doc);
+    QCOMPARE(frontend.searchQuery(), std::string("FAIL"));
+    QCOMPARE(frontend.searchMatchCount(), size_t(2));
+    QCOMPARE(frontend.searchMatchIndex(), size_t(0));
+    // The first match was scrolled into view; only the pad's rows are
+    // searched, and the current match is bold as well.
+    QCOMPARE(frontend.padComposeCount(), size_t(1));
+    QCOMPARE(frontend.scrollRow(), 22);
+    QCOMPARE(screen.row(5), std::string("     step 25 failed"));
+    QCOMPARE(screen.row(9), std::string(" Find: FAIL  1 of 2"));
+    QVERIFY(screen.ansi().find("step 25 \x1b[0;1;7mfail\x1b[0med") != std::string::npos);
+
+    // Enter steps to the next match; Escape closes the search.
+    QVERIFY(frontend.handleKey('\n'));
+    frontend.render(doc);
+    QCOMPARE(frontend.searchMatchIndex(), size_t(1));
+    QCOMPARE(frontend.scrollRow(), 28);
+    QVERIFY(screen.ansi().find("step 31 \x1b[0;1;7mfail\x1b[0med") != std::string::npos);
+    QVERIFY(frontend.handleKey(KEY_BACKSPACE));
+    QVERIFY(frontend.handleKey(27));
+    QVERIFY(!frontend.searching());
+    frontend.render(doc);
+    QCOMPARE(screen.row(5), std::string("     step 31 failed"));
+    QVERIFY(screen.ansi().find("\x1b[0;") == std::string::npos);
+}
+
+void QmlCursesFrontendTest::composites_layers() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        Text { text: "aaaaaaaaaa" }
+        Text { text: status.text }
+    }
+}
+)";
+    QmlParser parser;
+    auto doc = parser.parseString(qml);
+    MockScreen screen(4, 20);
+    QmlCompositor compositor;
+    QmlCompositor::Surface &main = compositor.addLayer(0, 0, 0, 4, 20);
+    std::string status = "bbbbbbbbbb";
+    int renders = 0;
+    QmlCursesFrontend frontend(main, [&](const std::string &) {
+        ++renders;
+        return status;
+    });
+    frontend.render(doc);
+    compositor.commit(screen);
+    QCOMPARE(screen.draws.size(), size_t(2));
+    QCOMPARE(screen.draws[0].text, std::string("aaaaaaaaaa"));
+    QCOMPARE(screen.draws[0].col, 5);
+
+    // A dialog over the middle is composed from the retained cells; the
+    // document underneath is not rendered again.
+    screen.draws.clear();
+    QmlCompositor::Surface &dialog = compositor.addLayer(1, 2, 8, 1, 4);
+    dialog.drawText(0, 0, "OK?");
+    QCOMPARE(compositor.commit(screen), size_t(4));
+    QCOMPARE(renders, 1);
+    QCOMPARE(screen.draws.size(), size_t(1));
+    QCOMPARE(screen.draws[0].text, std::string("OK? "));
+    QCOMPARE(screen.draws[0].row, 2);
+    QCOMPARE(screen.draws[0].col, 8);
+
+    // Changes under the dialog are culled; the rest goes out in one batch.
+    screen.draws.clear();
+    const int batches = screen.runBatches;
+    status = "cccccccccc";
+    frontend.invalidateBinding("status.text");
+    frontend.render(doc);
+    compositor.commit(screen);
+    QCOMPARE(compositor.cellsOccluded(), size_t(4));
+    QCOMPARE(screen.runBatches, batches + 1);
+    QCOMPARE(screen.draws.size(), size_t(2));
+    QCOMPARE(screen.draws[0].text, std::string("ccc"));
+    QCOMPARE(screen.draws[1].text, std::string("ccc"));
+
+    // Closing the dialog uncovers the new text without another render.
+    screen.draws.clear();
+    compositor.removeLayer(dialog);
+    QCOMPARE(compositor.commit(screen), size_t(4));
+    QCOMPARE(renders, 2);
+    QCOMPARE(screen.draws[0].text, std::string("cccc"));
+    QCOMPARE(screen.draws[0].col, 8);
+}
+
+void QmlCursesFrontendTest::skips_identical_frames() {
+    const std::string qml = R"(
+ApplicationWindow {
+    title: "Wall"
+    Column {
+        Text { text: load.text }
+    }
+}
+)";
+    QmlParser parser;
+    auto doc = parser.parseString(qml);
+    MockScreen screen(6, 20);
+    std::string load = "12%";
+    QmlCursesFrontend frontend(screen, [&load](const std::string &) { return load; });
+    frontend.render(doc);
+    QCOMPARE(frontend.frameCount(), size_t(1));
+    QCOMPARE(frontend.identicalFrameCount(), size_t(0));
+
+    // Same cells: no draw calls and no refresh.
+    screen.refreshed = false;
+    screen.draws.clear();
+    frontend.invalidateBinding("load.text");
+    frontend.render(doc);
+    frontend.render(doc);
+    QVERIFY(!screen.refreshed);
+    QVERIFY(screen.draws.empty());
+    QCOMPARE(frontend.identicalFrameCount(), size_t(2));
+
+    load = "13%";
+    frontend.invalidateBinding("load.text");
+    frontend.render(doc);
+    QVERIFY(screen.refreshed);
+    QCOMPARE(screen.draws.size(), size_t(1));
+    QCOMPARE(screen.draws[0].text, std::string("3"));
+    QCOMPARE(frontend.frameCount(), size_t(4));
+    QCOMPARE(frontend.identicalFrameRate(), 0.5);
+}
+
+namespace {
+
+// Screen that keeps its cells, so a test can read back what a decoded
+// stream left on it.
+class CellScreen : public ICursesScreen {
+public:
+    CellScreen(int rows, int cols) { cells_.resize(rows, cols); }
+
+    void clear() override { cells_.clear(); }
+    void drawText(int row, int col, const std::string &text) override { cells_.put(row, col, text); }
+    void refresh() override { ++refreshes; }
+    int rows() const override { return cells_.rows(); }
+    int cols() const override { return cells_.cols(); }
+
+    std::string text(int row) const {
+        std::string out;
+        for (int col = 0; col < cells_.cols(); ++col) {
+            for (uint32_t glyph = cells_.row(row)[col].glyph; glyph != 0; glyph >>= 8) {
+                out.push_back(static_cast<char>(glyph & 0xFF));
+            }
+        }
+        return out.substr(0, out.find_last_not_of(' ') + 1);
+    }
+
+    int refreshes = 0;
+
+private:
+    QmlCellPad cells_;
+};
+
+}  // namespace
+
+void QmlCursesFrontendTest::streams_frames_to_viewers() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        Text { text: "Status" }
+        Text { text: job.state }
+    }
+}
+)";
+    QmlParser parser;
+    auto doc = parser.parseString(qml);
+    QmlRemoteScreen remote(3, 12);
+    std::string state = "idle";
+    QmlCursesFrontend frontend(remote, [&state](const std::string &) { return state; });
+    frontend.render(doc);
+
+    // Two viewers, one of which stalls for a while. Both are fed from the
+    // same encoded frames; nothing is rendered per viewer.
+    CellScreen fastScreen(3, 12);
+    CellScreen slowScreen(3, 12);
+    QmlRemoteDecoder fast(fastScreen);
+    QmlRemoteDecoder slow(slowScreen);
+    bool slowBusy = false;
+    remote.addViewer([&fast](std::string_view bytes) {
+        // Arrives split, as from a socket.
+        return fast.feed(bytes.substr(0, 3)) && fast.feed(bytes.substr(3));
+    });
+    const QmlRemoteScreen::ViewerId slowId = remote.addViewer([&](std::string_view bytes) {
+        return !slowBusy && slow.feed(bytes);
+    });
+    QCOMPARE(fastScreen.text(0), std::string("   Status"));
+    QCOMPARE(fastScreen.text(2), std::string("    idle"));
+    QCOMPARE(fast.keyframesApplied(), size_t(1));
+
+    slowBusy = true;
+    for (const char *next : {"busy", "done"}) {
+        state = next;
+        frontend.invalidateBinding("job.state");
+        frontend.render(doc);
+    }
+    QCOMPARE(fastScreen.text(2), std::string("    done"));
+    QCOMPARE(fast.framesApplied(), size_t(3));
+    QCOMPARE(slowScreen.text(2), std::string("    idle"));
+    QCOMPARE(remote.framesDropped(), size_t(2));
+
+    // Once the link drains, one keyframe brings the viewer up to date.
+    slowBusy = false;
+    remote.viewerReady(slowId);
+    QCOMPARE(slowScreen.text(0), std::string("   Status"));
+    QCOMPARE(slowScreen.text(2), std::string("    done"));
+    QCOMPARE(slow.framesApplied(), size_t(2));
+    QCOMPARE(slow.keyframesApplied(), size_t(2));
+    QCOMPARE(slow.cols(), 12);
+
+    QmlRemoteDecoder broken(fastScreen);
+    QVERIFY(!broken.feed("XRS1"));
+}
+
+void QmlCursesFrontendTest::parses_telnet_negotiation() {
+    QCOMPARE(QmlTelnetParser::negotiation(), std::string_view("\xff\xfb\x01\xff\xfb\x03\xff\xfd\x1f"));
+
+    QmlTelnetParser telnet;
+    std::string data;
+    // Replies to the negotiation, then keys with an escaped 0xFF.
+    QVERIFY(!telnet.feed(std::string_view("\xff\xfd\x01\xff\xfd\x03" "ab\xff\xff" "c", 11), data));
+    QCOMPARE(data, std::string("ab\xff" "c"));
+    QCOMPARE(telnet.rows(), 0);
+
+    // NAWS 132x40, split mid-subnegotiation; a 0xFF in the size is doubled.
+    data.clear();
+    QVERIFY(!telnet.feed(std::string_view("\xff\xfa\x1f\x00", 4), data));
+    QVERIFY(telnet.feed(std::string_view("\x84\x00\x28\xff\xf0" "q", 6), data));
+    QCOMPARE(telnet.cols(), 132);
+    QCOMPARE(telnet.rows(), 40);
+    QCOMPARE(data, std::string("q"));
+    QVERIFY(telnet.feed(std::string_view("\xff\xfa\x1f\x00\xff\xff\x00\x18\xff\xf0", 10), data));
+    QCOMPARE(telnet.cols(), 255);
+    QCOMPARE(telnet.rows(), 24);
+    // The same size again is not a change.
+    QVERIFY(!telnet.feed(std::string_view("\xff\xfa\x1f\x00\xff\xff\x00\x18\xff\xf0", 10), data));
+}
+
+void QmlCursesFrontendTest::renders_to_buffer() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        Text { text: "Report" }
+        Text { text: job.state }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QmlBufferScreen screen(3, 12);
+    QmlCursesFrontend frontend(screen, [](const std::string &) { return std::string("ok"); });
+    frontend.render(doc);
+    QCOMPARE(screen.text(), std::string("   Report\n\n     ok\n"));
+    QCOMPARE(screen.row(2), std::string("     ok"));
+    QCOMPARE(screen.refreshes(), size_t(1));
+
+    // ANSI output styles cells, keeps styled blanks and resets each line.
+    screen.drawStyledText(1, 2, "ab", A_BOLD);
+    screen.drawStyledText(1, 4, "  ", A_REVERSE);
+    QCOMPARE(screen.ansi(), std::string("   Report\n  \x1b[0;1mab\x1b[0;7m  \x1b[0m\n     ok\n"));
+    QCOMPARE(screen.row(1), std::string("  ab"));
+}
+
+void QmlCursesFrontendTest::records_and_replays_traces() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        Text { text: "Jobs" }
+        Text { text: job.state }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QmlBufferScreen live(3, 10);
+    std::string trace;
+    std::vector<std::string> liveFrames;
+    {
+        QmlRecordingScreen recorder(live, [&trace](std::string_view bytes) { trace.append(bytes); });
+        std::string state = "idle";
+        QmlCursesFrontend frontend(recorder, [&state](const std::string &) { return state; });
+        frontend.render(doc);
+        liveFrames.push_back(live.text());
+        state = "running";
+        frontend.invalidateBinding("job.state");
+        frontend.render(doc);
+        liveFrames.push_back(live.text());
+        recorder.drawStyledText(0, 0, "!", A_BOLD);
+        QCOMPARE(recorder.callsRecorded(), size_t(6));
+    }
+
+    QmlScreenReplay replay;
+    QVERIFY(replay.load(trace));
+    QCOMPARE(replay.rows(), 3);
+    QCOMPARE(replay.cols(), 10);
+    QCOMPARE(replay.calls(), size_t(6));  // clear, runs, refresh, runs, refresh, styled text
+    QCOMPARE(replay.frames(), size_t(2));
+
+    QmlBufferScreen replayed(3, 10);
+    std::vector<std::string> frames;
+    replay.play(replayed, [&](size_t frame, std::chrono::microseconds at) {
+        QCOMPARE(frame, frames.size());
+        QVERIFY(at <= replay.duration());
+        frames.push_back(replayed.text());
+    });
+    QCOMPARE(frames, liveFrames);
+    QCOMPARE(replayed.ansi(), live.ansi());
+
+    QVERIFY(!replay.load("QST2"));
+    QVERIFY(!replay.load(trace.substr(0, trace.size() - 2)));
+    QCOMPARE(replay.calls(), size_t(0));
+}
+
+namespace {
+
+uint64_t fakeAllocations = 0;
+uint64_t countFakeAllocations() {
+    return fakeAllocations += 2;  // two "allocations" between samples
+}
+
+}  // namespace
+
+void QmlCursesFrontendTest::reports_frame_stats() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        Text { text: job.name }
+        Text { text: job.state }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QmlBufferScreen screen(4, 20);
+    std::string state = "idle";
+    QmlCursesFrontend frontend(screen, [&state](const std::vector<std::string> &bindings) {
+        std::vector<std::string> values;
+        for (const std::string &binding : bindings) {
+            values.push_back(binding == "job.state" ? state : "build");
+        }
+        return values;
+    });
+
+    // Off by default: nothing is recorded.
+    frontend.render(doc);
+    QCOMPARE(frontend.lastFrameStats().resolverCalls, size_t(0));
+
+    frontend.setStatsEnabled(true);
+    frontend.setAllocationCounter(&countFakeAllocations);
+    state = "running";
+    frontend.invalidateBinding("job.state");
+    frontend.render(doc);
+    const QmlFrameStats &stats = frontend.lastFrameStats();
+    QCOMPARE(stats.resolverCalls, size_t(1));
+    QCOMPARE(stats.bindingsResolved, size_t(1));
+    QCOMPARE(stats.cellsChanged, frontend.cellsWrittenLastFrame());
+    QCOMPARE(stats.runs, size_t(1));
+    QCOMPARE(stats.bytesEmitted, size_t(7));  // "running"
+    QCOMPARE(stats.drawCalls, size_t(2));     // drawRuns and refresh
+    QCOMPARE(stats.allocations, uint64_t(2));
+    QVERIFY(stats.layoutTime.count() >= 0 && stats.drawTime.count() >= 0);
+
+    frontend.render(doc);
+    QCOMPARE(frontend.lastFrameStats().resolverCalls, size_t(0));
+    QCOMPARE(frontend.lastFrameStats().drawCalls, size_t(0));
+
+    // The HUD shows the previous frame, the third, on the bottom row.
+    frontend.setStatsHud(true);
+    frontend.render(doc);
+    QVERIFY(screen.row(3).rfind(" frame 3 ", 0) == 0);
+    QVERIFY(screen.ansi().find("\x1b[0;7m frame") != std::string::npos);
+    QCOMPARE(screen.row(2), std::string("      running"));
+}
+
+void QmlCursesFrontendTest::exports_trace_spans() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        Text { text: job.state }
+    }
+}
+)";
+    QmlParser parser;
+    QmlTrace::clear();
+    {
+        const QmlTraceSpan off("not recorded");
+    }
+    QmlTrace::setEnabled(true);
+    const QmlDocument doc = parser.parseString(qml);
+    MockScreen screen(5, 20);
+    QmlCursesFrontend frontend(screen, [](const std::string &) { return std::string("idle"); });
+    frontend.render(doc);
+    std::thread worker([&parser, &qml] { parser.parseString(qml); });
+    worker.join();
+    QmlTrace::setEnabled(false);
+
+    const std::string json = QmlTrace::chromeJson();
+    QmlTrace::clear();
+    QVERIFY(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0);
+    for (const char *name : {"QmlParser::parseString", "QmlFrontend::render", "resolve bindings", "compose", "draw"}) {
+        QVERIFY2(json.find(std::string("\"name\":\"") + name + "\"") != std::string::npos, name);
+    }
+    QVERIFY(json.find("not recorded") == std::string::npos);
+    QVERIFY(json.find("\"ph\":\"X\"") != std::string::npos);
+    // The worker's parse is on a thread of its own.
+    std::set<std::string> threads;
+    for (size_t at = json.find("\"tid\":"); at != std::string::npos; at = json.find("\"tid\":", at + 1)) {
+        threads.insert(json.substr(at, json.find(',', at) - at));
+    }
+    QCOMPARE(threads.size(), size_t(2));
+    QCOMPARE(QmlTrace::chromeJson().find("\"name\""), std::string::npos);
+}
+
+// Frames after the first, with a BindingWriter and an in-memory screen,
+// rewrite cached buffers and cells in place.
+void QmlCursesFrontendTest::steady_state_render_does_not_allocate() {
+    const QString path = QFINDTESTDATA("../qml/Main.qml");
+    QVERIFY(!path.isEmpty());
+    QmlParser parser;
+    const QmlDocument doc = parser.parseFile(path.toStdString());
+
+    int tick = 0;
+    const auto writer = [&tick](std::string_view, std::string &value) {
+        value.append("Hello ");
+        value.push_back(static_cast<char>('0' + tick % 10));
+    };
+    QmlBufferScreen screen(24, 80);
+    QmlCursesFrontend frontend(screen, writer);
+    frontend.render(doc);
+    frontend.render(doc);
+
+    const QmlAllocationScope scope;
+    for (int i = 0; i < 100; ++i) {
+        ++tick;
+        frontend.invalidateBinding("greeter.message");
+        frontend.render(doc);
+    }
+    QCOMPARE(scope.allocations(), 0LL);
+    QVERIFY(screen.text().find("Hello 0") != std::string::npos);
+
+    // A screen with drawText() alone gets its runs through the default
+    // drawRuns(), which copies each into one reused string; the values are
+    // long enough to leave the small-string buffer.
+    class TextOnlyScreen : public ICursesScreen {
+    public:
+        void clear() override {}
+        void drawText(int, int, const std::string &text) override { drawn += text.size(); }
+        void refresh() override {}
+        int rows() const override { return 24; }
+        int cols() const override { return 80; }
+        size_t drawn = 0;
+    };
+    const auto longWriter = [&tick](std::string_view, std::string &value) {
+        value.assign(40, static_cast<char>('a' + tick % 10));
+    };
+    TextOnlyScreen textOnly;
+    QmlCursesFrontend textFrontend(textOnly, longWriter);
+    textFrontend.render(doc);
+    ++tick;
+    textFrontend.invalidateBinding("greeter.message");
+    textFrontend.render(doc);
+
+    const QmlAllocationScope textScope;
+    for (int i = 0; i < 100; ++i) {
+        ++tick;
+        textFrontend.invalidateBinding("greeter.message");
+        textFrontend.render(doc);
+    }
+    QCOMPARE(textScope.allocations(), 0LL);
+    QVERIFY(textOnly.drawn >= 100 * 40);
+}
+
+void QmlCursesFrontendTest::instantiates_components_in_view_only() {
+    std::string qml = "ApplicationWindow {\n    Column {\n";
+    for (int i = 0; i < 100; ++i) {
+        qml += "        Card { label: \"Card " + std::to_string(i) + "\" }\n";
+    }
+    qml += "        Card {\n            label: \"Hidden\"\n            visible: false\n        }\n    }\n}\n";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    const QmlDocument card = parser.parseString("Column {\n    Text { text: \"card\" }\n}\n");
+
+    std::vector<std::string> made;
+    QmlBufferScreen screen(6, 20);
+    QmlCursesFrontend frontend(screen);
+    frontend.setComponentInstantiator([&](const QmlNode &use, QmlNode &instance) {
+        if (use.type != "Card") {
+            return false;
+        }
+        made.push_back(use.property("label"));
+        instance = card.roots[0];
+        instance.children[0].setProperty(QmlAtoms::text, use.property("label"));
+        return true;
+    });
+
+    // Three cards fit, and four more below are overscan.
+    frontend.render(doc);
+    QCOMPARE(made.size(), size_t(7));
+    QCOMPARE(frontend.componentInstanceCount(), size_t(7));
+    QCOMPARE(frontend.itemCount(), size_t(100));
+    QCOMPARE(screen.row(0), std::string("       Card 0"));
+    QCOMPARE(screen.row(4), std::string("       Card 2"));
+
+    frontend.setScrollOffset(50);
+    frontend.render(doc);
+    QCOMPARE(made.size(), size_t(18));
+    QCOMPARE(screen.row(0), std::string("      Card 50"));
+
+    // A snapshot shares the instances; invisible uses are never made.
+    frontend.setScrollOffset(1000);
+    frontend.render(QmlDocument(doc));
+    QCOMPARE(screen.row(4), std::string("      Card 99"));
+    QVERIFY(std::find(made.begin(), made.end(), "Hidden") == made.end());
+    QCOMPARE(made.size(), size_t(25));
+
+    frontend.invalidateComponents();
+    frontend.render(doc);
+    QCOMPARE(frontend.componentInstanceCount(), size_t(7));
+}
+
+void QmlCursesFrontendTest::time_slices_long_frames() {
+    std::string qml = "ApplicationWindow {\n    Column {\n";
+    for (int i = 0; i < 100; ++i) {
+        qml += "        Text { text: \"Item " + std::to_string(i) + "\" }\n";
+    }
+    qml += "    }\n}\n";
+    const QmlDocument doc = QmlParser().parseString(qml);
+
+    QmlBufferScreen whole(6, 20);
+    QmlCursesFrontend reference(whole);
+    reference.render(doc);
+    QVERIFY(!reference.frameIncomplete());
+
+    // Input always waits, so each frame compiles one batch of items.
+    QmlBufferScreen screen(6, 20);
+    QmlCursesFrontend frontend(screen);
+    size_t polls = 0;
+    frontend.setFrameBudget(std::chrono::seconds(1), [&polls] { return ++polls > 0; });
+    frontend.render(doc);
+    QVERIFY(frontend.frameIncomplete());
+    QVERIFY(frontend.itemCount() < size_t(100));
+    QCOMPARE(polls, size_t(1));
+    QCOMPARE(screen.row(0), whole.row(0));
+
+    int frames = 1;
+    while (frontend.frameIncomplete() && frames < 100) {
+        frontend.render(doc);
+        ++frames;
+    }
+    QVERIFY(!frontend.frameIncomplete());
+    QVERIFY(frames > 2);
+    QCOMPARE(frontend.itemCount(), size_t(100));
+    for (int row = 0; row < 6; ++row) {
+        QCOMPARE(screen.row(row), whole.row(row));
+    }
+
+    // Scrolled past what a partial frame has compiled, the last frame stays.
+    frontend.setScrollOffset(90);
+    frontend.render(doc);
+    const std::string shown = screen.row(0);
+    const QmlDocument copy(doc);
+    frontend.render(copy);
+    QVERIFY(frontend.frameIncomplete());
+    QCOMPARE(screen.row(0), shown);
+    while (frontend.frameIncomplete()) {
+        frontend.render(copy);
+    }
+    reference.setScrollOffset(90);
+    reference.render(doc);
+    QCOMPARE(screen.row(0), whole.row(0));
+
+    // Without a budget a frame is whole again.
+    frontend.setFrameBudget(std::chrono::nanoseconds(0));
+    frontend.render(QmlDocument(doc));
+    QVERIFY(!frontend.frameIncomplete());
+}
+
+void QmlCursesFrontendTest::resolves_the_focused_item_first() {
+    std::string qml = "ApplicationWindow {\n    title: app.title\n    Column {\n";
+    for (int i = 0; i < 20; ++i) {
+        if (i == 6) {
+            qml += "        TextField {\n            text: form.name\n            focus: true\n        }\n";
+        }
+        qml += "        Text { text: feed.v" + std::to_string(i) + " }\n";
+    }
+    qml += "    }\n}\n";
+    const QmlDocument doc = QmlParser().parseString(qml);
+
+    std::vector<std::string> order;
+    auto writer = [&order](std::string_view binding, std::string &value) {
+        order.emplace_back(binding);
+        value.assign(binding);
+    };
+    QmlBufferScreen screen(16, 30);
+    QmlCursesFrontend frontend(screen, BindingWriter(writer));
+    frontend.setScrollOffset(2);
+    frontend.render(doc);
+    const auto at = [&order](const char *binding) {
+        return std::find(order.begin(), order.end(), binding) - order.begin();
+    };
+    // The field, the title, its neighbours outward, then the overscan.
+    QCOMPARE(order.at(0), std::string("form.name"));
+    QCOMPARE(order.at(1), std::string("app.title"));
+    QCOMPARE(order.at(2), std::string("feed.v5"));
+    QCOMPARE(order.at(3), std::string("feed.v6"));
+    QVERIFY(at("feed.v2") < at("feed.v1"));
+    QVERIFY(at("feed.v1") < at("feed.v0"));
+    QVERIFY(at("feed.v0") < static_cast<std::ptrdiff_t>(order.size()));
+
+    // A frame with no time to spare still keeps the field current.
+    order.clear();
+    frontend.setFrameBudget(std::chrono::nanoseconds(1));
+    frontend.invalidateBinding("feed.v3");
+    frontend.invalidateBinding("form.name");
+    frontend.render(doc);
+    QCOMPARE(order, std::vector<std::string>{"form.name"});
+    QVERIFY(frontend.frameIncomplete());
+    frontend.render(doc);
+    QCOMPARE(order.size(), size_t(2));
+    QVERIFY(!frontend.frameIncomplete());
+}
+
+void QmlCursesFrontendTest::repeats_delegates_over_models() {
+    const std::string qml = R"(
+ApplicationWindow {
+    ListView {
+        model: book
+        delegate: Row {
+            Text { text: model.price }
+            Text { text: model.size }
+        }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    QmlBasicListModel book({"price", "size"});
+    for (int i = 0; i < 100; ++i) {
+        book.appendRow({std::to_string(1000 + i), "0010"});
+    }
+    QmlBufferScreen screen(6, 20);
+    QmlCursesFrontend frontend(screen);
+    frontend.setModel("book", &book);
+    frontend.render(doc);
+    QCOMPARE(frontend.itemCount(), size_t(100));
+    QCOMPARE(screen.row(0), std::string("     1000 0010"));
+    QCOMPARE(screen.row(5), std::string("     1005 0010"));
+
+    // A tick re-reads one row and redraws the cells that changed.
+    book.setData(1, "size", "0042");
+    frontend.render(doc);
+    QCOMPARE(frontend.cellsWrittenLastFrame(), size_t(2));
+    QCOMPARE(screen.row(1), std::string("     1001 0042"));
+
+    book.insertRow(0, {"0999", "0001"});
+    frontend.render(doc);
+    QCOMPARE(frontend.itemCount(), size_t(101));
+    QCOMPARE(screen.row(0), std::string("     0999 0001"));
+    QCOMPARE(screen.row(2), std::string("     1001 0042"));
+
+    book.removeRows(0, 2);
+    book.moveRows(0, 1, 2);
+    frontend.render(doc);
+    QCOMPARE(screen.row(0), std::string("     1002 0010"));
+    QCOMPARE(screen.row(2), std::string("     1001 0042"));
+
+    // An order book ticking many times between frames never recompiles.
+    for (int tick = 0; tick < 1000; ++tick) {
+        book.setData(static_cast<size_t>(tick % 50), "size", std::to_string(2000 + tick));
+        if (tick % 10 == 0) {
+            book.insertRow(3, {"1500", "0001"});
+            book.removeRows(4, 1);
+        }
+        if (tick % 3 == 0) {
+            frontend.render(doc);
+        }
+    }
+    frontend.render(doc);
+    QCOMPARE(frontend.planCompileCount(), size_t(1));
+    QCOMPARE(frontend.itemCount(), size_t(99));
+    QCOMPARE(screen.row(0), std::string("     1002 2950"));
+
+    frontend.setModel("book", nullptr);
+    frontend.render(doc);
+    QCOMPARE(frontend.itemCount(), size_t(0));
+}
+
+void QmlCursesFrontendTest::recycles_ops_and_rows() {
+    const char *qml = R"(
+ApplicationWindow {
+    Repeater {
+        model: book
+        delegate: Row {
+            Text { text: model.price }
+            Text { text: model.size }
+        }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    QmlBasicListModel book({"price", "size"});
+    for (int i = 0; i < 20; ++i) {
+        book.appendRow({std::to_string(1000 + i), "0010"});
+    }
+    QmlBufferScreen screen(6, 20);
+    QmlCursesFrontend frontend(screen);
+    frontend.setModel("book", &book);
+    frontend.render(doc);
+    QCOMPARE(frontend.recycledRowCount(), size_t(0));
+    QCOMPARE(frontend.recycledOpCount(), size_t(0));
+
+    // Rows scrolling through the model reuse the removed ones.
+    book.removeRows(0, 5);
+    for (int i = 0; i < 5; ++i) {
+        book.appendRow({std::to_string(2000 + i), "0020"});
+    }
+    frontend.render(doc);
+    QCOMPARE(frontend.recycledRowCount(), size_t(5));
+    QCOMPARE(screen.row(0), std::string("     1005 0010"));
+
+    // A rebuilt plan takes the old one's ops and rows.
+    frontend.invalidatePlan();
+    frontend.render(doc);
+    QCOMPARE(frontend.planCompileCount(), size_t(2));
+    QCOMPARE(frontend.recycledOpCount(), size_t(2));
+    QCOMPARE(frontend.recycledRowCount(), size_t(25));
+    QCOMPARE(screen.row(0), std::string("     1005 0010"));
+    QCOMPARE(frontend.itemCount(), size_t(20));
+
+    // Reused ops carry nothing over into a different document.
+    const QmlDocument form = parser.parseString(R"(
+ApplicationWindow {
+    Column {
+        TextField { placeholderText: "name" }
+        Button { text: "Go" }
+    }
+}
+)");
+    frontend.render(form);
+    QVERIFY(screen.row(0).find("[ name ]") != std::string::npos);
+    const QmlDocument reloaded = parser.parseString(R"(
+ApplicationWindow {
+    Column {
+        TextField { text: "" }
+        Text { text: "done" }
+    }
+}
+)");
+    frontend.render(reloaded);
+    QCOMPARE(frontend.recycledOpCount(), size_t(2 + 2 + 2));
+    QVERIFY(screen.row(0).find("name") == std::string::npos);
+    QVERIFY(screen.row(2).find("done") != std::string::npos);
+
+    // At most capacity objects are kept, so each rebuild reuses one row.
+    frontend.setRecycleCapacity(1);
+    frontend.render(doc);
+    frontend.invalidatePlan();
+    frontend.render(doc);
+    QCOMPARE(frontend.recycledRowCount(), size_t(25 + 2));
+}
+
+void QmlCursesFrontendTest::repaints_a_tab_from_its_cache() {
+    QmlParser parser;
+    const QmlDocument first = parser.parseString(R"(
+ApplicationWindow {
+    title: "First"
+    Column {
+        Text { text: greeter.message }
+    }
+}
+)");
+    const QmlDocument second = parser.parseString(R"(
+ApplicationWindow {
+    title: "Second"
+}
+)");
+
+    // Two tabs share the terminal; each frontend keeps its own plan,
+    // binding cache and grid.
+    int resolverCalls = 0;
+    MockScreen screen(10, 30);
+    QmlCursesFrontend firstTab(screen, [&resolverCalls](const std::string &) {
+        ++resolverCalls;
+        return std::string("hello");
+    });
+    QmlCursesFrontend secondTab(screen, [](const std::string &) { return std::string(); });
+    firstTab.render(first);
+    secondTab.render(second);
+    QCOMPARE(resolverCalls, 1);
+
+    // Without being told, the first tab would think the screen still
+    // shows its frame and send nothing.
+    screen.cleared = false;
+    screen.draws.clear();
+    firstTab.render(first);
+    QVERIFY(screen.draws.empty());
+
+    firstTab.forgetScreen();
+    firstTab.render(first);
+    QVERIFY(screen.cleared);
+    QCOMPARE(screen.draws.size(), static_cast<size_t>(2));
+    QCOMPARE(screen.draws[0].text, std::string("First"));
+    QCOMPARE(screen.draws[1].text, std::string("hello"));
+    QCOMPARE(resolverCalls, 1);
+    QCOMPARE(firstTab.planCompileCount(), static_cast<size_t>(1));
+}
+
+void QmlCursesFrontendTest::runs_tasks_on_an_executor() {
+    std::vector<int> cpus;
+    QVERIFY(QmlExecutor::parseCpuList("0-2,5", cpus));
+    QCOMPARE(cpus, (std::vector<int>{0, 1, 2, 5}));
+    QVERIFY(!QmlExecutor::parseCpuList("3-1", cpus));
+    QVERIFY(!QmlExecutor::parseCpuList("1,", cpus));
+    QVERIFY(!QmlExecutor::parseCpuList("", cpus));
+    QCOMPARE(cpus.size(), size_t(4));
+
+    // While the only worker is busy, tasks queue up and then run highest
+    // priority first, each in the order posted.
+    std::vector<std::string> order;
+    std::atomic<int> events{0};
+    {
+        QmlExecutor executor(QmlExecutor::Options{1, {0}});
+        QCOMPARE(executor.workerCount(), size_t(1));
+        executor.setTaskHook([&events](const QmlExecutor::TaskEvent &event) {
+            if (event.queued <= event.begin && event.begin <= event.end && event.worker == 0) {
+                events.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        executor.post("block", QmlExecutor::Priority::High, [released] { released.wait(); });
+        const auto record = [&order](const char *name) { return [&order, name] { order.push_back(name); }; };
+        executor.post("b1", QmlExecutor::Priority::Background, record("b1"));
+        executor.post("n1", QmlExecutor::Priority::Normal, record("n1"));
+        executor.post("h1", QmlExecutor::Priority::High, record("h1"));
+        executor.post("n2", QmlExecutor::Priority::Normal, record("n2"));
+        std::future<int> answer = executor.submit("answer", QmlExecutor::Priority::Background, [] { return 42; });
+        std::future<void> failure = executor.submit("failure", QmlExecutor::Priority::Background,
+                                                    [] { throw std::runtime_error("failed"); });
+        release.set_value();
+        QCOMPARE(answer.get(), 42);
+        bool threw = false;
+        try {
+            failure.get();
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        QVERIFY(threw);
+    }
+    QCOMPARE(order, (std::vector<std::string>{"h1", "n1", "n2", "b1"}));
+    QCOMPARE(events.load(), 7);
+
+    // Uneven tasks are all run once, whoever ends up running them, and a
+    // task can split its own work on the executor it runs on.
+    QmlExecutor executor(QmlExecutor::Options{3, {}});
+    std::vector<std::atomic<int>> runs(5000);
+    const auto task = [&runs](size_t index) {
+        if (index < 16) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        runs[index].fetch_add(1, std::memory_order_relaxed);
+    };
+    executor.parallelFor("runs", runs.size(), task);
+    executor.submit("nested", QmlExecutor::Priority::Normal, [&] {
+                executor.parallelFor("runs", runs.size() / 2, task, 2);
+            }).get();
+    for (size_t i = 0; i < runs.size(); ++i) {
+        QCOMPARE(runs[i].load(), i < runs.size() / 2 ? 2 : 1);
+    }
+    QVERIFY(executor.stealCount() > 0);
+}
+
+void QmlCursesFrontendTest::resolves_bindings_on_the_executor() {
+    QmlExecutor pool(QmlExecutor::Options{3, {}});
+
+    std::string qml = "ApplicationWindow {\n    Grid {\n        columns: 10\n        spacing: 0\n";
+    for (int i = 0; i < 300; ++i) {
+        qml += "        Text { text: feed.v" + std::to_string(i) + " }\n";
+    }
+    qml += "    }\n}\n";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<int> writes{0};
+    auto writer = [&](std::string_view binding, std::string &value) {
+        value.assign(binding.substr(binding.find('.') + 2));
+        writes.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    };
+    QmlBufferScreen screen(40, 60);
+    QmlCursesFrontend frontend(screen, BindingWriter(writer));
+    frontend.setResolveExecutor(&pool);
+    frontend.render(doc);
+    QCOMPARE(writes.load(), 300);
+    QVERIFY(!threads.empty());
+    QVERIFY(screen.row(0).find("0") != std::string::npos);
+    QVERIFY(screen.row(29).find("299") != std::string::npos);
+
+    // Cached values are not written again; small batches stay serial.
+    frontend.setResolveExecutor(&pool, 10);
+    frontend.render(doc);
+    QCOMPARE(writes.load(), 300);
+    frontend.invalidateBinding("feed.v7");
+    threads.clear();
+    frontend.render(doc);
+    QCOMPARE(writes.load(), 301);
+    QCOMPARE(threads.size(), size_t(1));
+    QVERIFY(threads.count(std::this_thread::get_id()) == 1);
+}
+
+void QmlCursesFrontendTest::pipelines_frames_to_the_screen_thread() {
+    QmlSpscQueue<int> queue(3);
+    QCOMPARE(queue.capacity(), size_t(4));
+    std::thread producer([&queue] {
+        for (int i = 0; i < 10000; ++i) {
+            int value = i;
+            while (!queue.tryPush(std::move(value))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    int expected = 0;
+    for (int value = 0; expected < 10000;) {
+        if (queue.tryPop(value)) {
+            QCOMPARE(value, expected);
+            ++expected;
+        }
+    }
+    producer.join();
+
+    auto doc = std::make_shared<QmlDocument>(QmlParser().parseString(R"(
+ApplicationWindow {
+    title: "Pipeline"
+    Column {
+        Text { text: feed.price }
+    }
+}
+)"));
+    std::atomic<int> price{100};
+    const std::thread::id screenThread = std::this_thread::get_id();
+    std::atomic<bool> resolvedOnWorker{true};
+    QmlFramePipeline pipeline(4, BindingResolver([&](const std::string &) {
+        resolvedOnWorker = resolvedOnWorker && std::this_thread::get_id() != screenThread;
+        return std::to_string(price.load());
+    }));
+    std::atomic<int> ready{0};
+    pipeline.setFrameReadyNotifier([&ready] { ++ready; });
+
+    QmlBufferScreen screen(6, 20);
+    pipeline.setScreenSize(screen.rows(), screen.cols());
+    const auto render = [doc](QmlCursesFrontend &frontend) { frontend.render(*doc); };
+    QVERIFY(pipeline.post(render));
+    pipeline.waitIdle();
+    QCOMPARE(ready.load(), 1);
+    QCOMPARE(screen.row(0), std::string(""));
+    QCOMPARE(pipeline.apply(screen), size_t(1));
+    QCOMPARE(screen.row(0), std::string("      Pipeline"));
+    QCOMPARE(screen.row(2), std::string("        100"));
+    QVERIFY(resolvedOnWorker);
+
+    // While the worker is busy, the screen thread carries on and applies
+    // nothing; the frames of later jobs then arrive with one refresh.
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    QVERIFY(pipeline.post([released](QmlCursesFrontend &) { released.wait(); }));
+    for (int tick = 101; tick <= 102; ++tick) {
+        QVERIFY(pipeline.post([&price, tick, doc](QmlCursesFrontend &frontend) {
+            price = tick;
+            frontend.invalidateAllBindings();
+            frontend.render(*doc);
+        }));
+    }
+    QCOMPARE(pipeline.apply(screen), size_t(0));
+    release.set_value();
+    pipeline.waitIdle();
+    const size_t refreshes = screen.refreshes();
+    QCOMPARE(pipeline.apply(screen), size_t(2));
+    QCOMPARE(screen.refreshes(), refreshes + 1);
+    QCOMPARE(screen.row(2), std::string("        102"));
+}
+
+void QmlCursesFrontendTest::measures_input_latency() {
+    // Percentiles land within a bucket (1/16) above the true sample.
+    QmlLatencyHistogram histogram;
+    QCOMPARE(histogram.percentile(0.99).count(), int64_t(0));
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.record(std::chrono::microseconds(i));
+    }
+    QCOMPARE(histogram.count(), uint64_t(1000));
+    QCOMPARE(histogram.min(), std::chrono::nanoseconds(std::chrono::microseconds(1)));
+    QCOMPARE(histogram.max(), std::chrono::nanoseconds(std::chrono::microseconds(1000)));
+    const auto p50 = histogram.percentile(0.5).count();
+    const auto p99 = histogram.percentile(0.99).count();
+    QVERIFY(p50 >= 500000 && p50 <= 500000 + 500000 / 16);
+    QVERIFY(p99 >= 990000 && p99 <= 1000000);
+    QCOMPARE(histogram.percentile(1.0), histogram.max());
+
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        Text { text: job.state }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    MockScreen screen(5, 20);
+    std::string state = "idle";
+    QmlCursesFrontend frontend(screen, [&state](const std::string &) { return state; });
+    frontend.setStatsEnabled(true);
+    frontend.render(doc);
+    QCOMPARE(frontend.inputLatency().count(), uint64_t(0));
+    QCOMPARE(frontend.lastFrameStats().inputLatency.count(), int64_t(0));
+
+    // The frame after a key measures from the oldest key marked.
+    QmlTrace::clear();
+    QmlTrace::setEnabled(true);
+    const auto now = std::chrono::steady_clock::now();
+    frontend.markInput(now - std::chrono::milliseconds(2));
+    frontend.markInput(now - std::chrono::milliseconds(5));
+    frontend.markInput(now);
+    state = "busy";
+    frontend.invalidateBinding("job.state");
+    frontend.render(doc);
+    QmlTrace::setEnabled(false);
+    QCOMPARE(frontend.inputLatency().count(), uint64_t(1));
+    QVERIFY(frontend.inputLatency().max() >= std::chrono::milliseconds(5));
+    QCOMPARE(frontend.lastFrameStats().inputLatency, frontend.inputLatency().max());
+
+    const std::string json = QmlTrace::chromeJson();
+    QmlTrace::clear();
+    QVERIFY(json.find("\"name\":\"input to refresh\"") != std::string::npos);
+    QVERIFY(json.find("\"name\":\"input latency\",\"cat\":\"qml\",\"ph\":\"C\"") != std::string::npos);
+    QVERIFY(json.find("\"args\":{\"p99 us\":") != std::string::npos);
+
+    // Frames without input record nothing; an identical frame still
+    // answers the key that came before it.
+    frontend.render(doc);
+    QCOMPARE(frontend.inputLatency().count(), uint64_t(1));
+    frontend.markInput();
+    frontend.render(doc);
+    QCOMPARE(frontend.identicalFrameCount(), size_t(2));
+    QCOMPARE(frontend.inputLatency().count(), uint64_t(2));
+    frontend.resetInputLatency();
+    QCOMPARE(frontend.inputLatency().count(), uint64_t(0));
+}
+
+void QmlCursesFrontendTest::edits_fields_and_moves_focus() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        spacing: 0
+        TextField {
+            id: nameField
+            placeholderText: "Your name"
+        }
+        Button {
+            id: go
+            text: "Go"
+            focus: true
+            onClicked: outputLabel.text = greeter.greet(nameField.text)
+        }
+        Label { id: outputLabel; text: "idle" }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QmlBufferScreen screen(3, 20);
+    QmlCursesFrontend frontend(screen);
+    std::vector<std::string> edits;
+    frontend.setTextEditedHandler([&](const std::string &id, const std::string &text) {
+        edits.push_back(id + "=" + text);
+    });
+    std::vector<std::string> actions;
+    frontend.setActionHandler([&](const std::string &id, const QmlScriptBlock &script) {
+        actions.push_back(id + "." + std::string(QmlAtomTable::global().name(script.name)));
+        frontend.setItemText("outputLabel", "Hi, " + *frontend.itemText("nameField"));
+    });
+
+    // The button has focus: true.
+    frontend.render(doc);
+    QCOMPARE(frontend.focusableCount(), size_t(2));
+    QCOMPARE(frontend.focusIndex(), size_t(1));
+    QVERIFY(screen.ansi().find("\x1b[0;7m[ Go ]\x1b[0m") != std::string::npos);
+    QCOMPARE(screen.row(0), std::string("   [ Your name ]"));
+
+    // Tab wraps around to the field; typing keeps its placeholder's width
+    // and repaints only its cells.
+    QVERIFY(frontend.handleKey('\t'));
+    QCOMPARE(frontend.focusIndex(), size_t(0));
+    frontend.render(doc);
+    QVERIFY(screen.ansi().find("\x1b[0;7m[ Your name ]\x1b[0m") != std::string::npos);
+    for (const char key : std::string("Ada")) {
+        QVERIFY(frontend.handleKey(key));
+    }
+    frontend.render(doc);
+    QCOMPARE(screen.row(0), std::string("   [ Ada       ]"));
+    QVERIFY(frontend.cellsWrittenLastFrame() <= 9);
+    QCOMPARE(screen.row(1), std::string("      [ Go ]"));
+    QCOMPARE(edits.back(), std::string("nameField=Ada"));
+
+    // Backspace takes whole UTF-8 characters.
+    QVERIFY(frontend.handleKey(0xc3));
+    QVERIFY(frontend.handleKey(0xa9));
+    QCOMPARE(*frontend.itemText("nameField"), std::string("Ada\xc3\xa9"));
+    QVERIFY(frontend.handleKey(KEY_BACKSPACE));
+    QVERIFY(frontend.handleKey(KEY_BACKSPACE));
+    QCOMPARE(*frontend.itemText("nameField"), std::string("Ad"));
+    QCOMPARE(edits.size(), size_t(7));
+
+    // Enter presses the button; other keys are not for it.
+    QVERIFY(frontend.handleKey('\t'));
+    QVERIFY(!frontend.handleKey('x'));
+    QVERIFY(frontend.handleKey('\n'));
+    QCOMPARE(actions, std::vector<std::string>{"go.onClicked"});
+    frontend.render(doc);
+    QCOMPARE(screen.row(2), std::string("      Hi, Ad"));
+
+    // The text and the focus outlive a rebuild of the plan.
+    QVERIFY(frontend.handleKey(KEY_BTAB));
+    frontend.invalidatePlan();
+    frontend.render(doc);
+    QCOMPARE(frontend.focusIndex(), size_t(0));
+    QCOMPARE(screen.row(0), std::string("   [ Ad        ]"));
+    QCOMPARE(screen.row(2), std::string("      Hi, Ad"));
+}
+
+void QmlCursesFrontendTest::coalesces_pasted_and_typed_input() {
+    using Event = QmlInputCoalescer::Event;
+    const auto keys = [](std::string_view text) { return std::vector<int>(text.begin(), text.end()); };
+    QmlInputCoalescer coalescer;
+    std::vector<Event> events;
+    const auto collect = [&events](const Event &event) { events.push_back(event); };
+
+    // A typed run is one event; keys that are not text pass through.
+    std::vector<int> typed = keys("Ada");
+    typed.push_back(KEY_LEFT);
+    typed.push_back('!');
+    coalescer.feed(typed);
+    QCOMPARE(coalescer.drain(collect), size_t(3));
+    QCOMPARE(events[0].text, std::string("Ada"));
+    QVERIFY(events[1].kind == Event::Kind::Key && events[1].key == KEY_LEFT);
+    QCOMPARE(events[2].text, std::string("!"));
+
+    // A paste is held across reads, its markers included, and becomes one
+    // event; a lone ESC is the Escape key.
+    events.clear();
+    coalescer.feed(keys("\x1b["));
+    coalescer.feed(keys("200~Lovelace,\n"));
+    QVERIFY(coalescer.pasting());
+    QCOMPARE(coalescer.drain(collect), size_t(0));
+    coalescer.feed(keys(" Ada\x1b"));
+    coalescer.feed(keys("[201~\x1b"));
+    QVERIFY(!coalescer.pasting());
+    QCOMPARE(coalescer.drain(collect), size_t(2));
+    QVERIFY(events[0].pasted);
+    QCOMPARE(events[0].text, std::string("Lovelace,\n Ada"));
+    QVERIFY(events[1].kind == Event::Kind::Key && events[1].key == 27);
+
+    // The paste is one edit of the focused field, on one line; nothing
+    // takes text until a field has focus.
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(R"(
+ApplicationWindow {
+    Column {
+        spacing: 0
+        TextField { id: nameField; placeholderText: "Name" }
+        Button { text: "Go" }
+    }
+}
+)");
+    QmlBufferScreen screen(2, 30);
+    QmlCursesFrontend frontend(screen);
+    std::vector<std::string> edits;
+    frontend.setTextEditedHandler([&](const std::string &id, const std::string &text) {
+        edits.push_back(id + "=" + text);
+    });
+    frontend.render(doc);
+    QVERIFY(!frontend.insertText("x"));
+    QVERIFY(frontend.handleKey('\t'));
+    QVERIFY(frontend.insertText(events[0].text));
+    QCOMPARE(edits, std::vector<std::string>{"nameField=Lovelace,  Ada"});
+    frontend.render(doc);
+    QVERIFY(screen.row(0).find("[ Lovelace,  Ada ]") != std::string::npos);
+
+    // Nor does a button take text.
+    QVERIFY(frontend.handleKey('\t'));
+    QVERIFY(!frontend.insertText("x"));
+    QCOMPARE(edits.size(), size_t(1));
+}
+
+void QmlCursesFrontendTest::hit_tests_mouse_presses() {
+    using Action = QmlFrontendCore::MouseAction;
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(R"(
+ApplicationWindow {
+    Column {
+        spacing: 0
+        Label { text: "Sign in" }
+        Row {
+            spacing: 1
+            TextField { id: nameField; placeholderText: "Name" }
+            Button { id: go; text: "Go"; onClicked: done() }
+        }
+    }
+}
+)");
+    QmlBufferScreen screen(4, 20);
+    QmlCursesFrontend frontend(screen);
+    std::vector<std::string> actions;
+    frontend.setActionHandler([&](const std::string &id, const QmlScriptBlock &) { actions.push_back(id); });
+
+    // Nothing is indexed before a frame is drawn.
+    QCOMPARE(frontend.focusableAt(0, 0), QmlFrontendCore::kNoFocus);
+    frontend.render(doc);
+    const size_t fieldCol = screen.row(1).find("[ Name ]");
+    const size_t buttonCol = screen.row(1).find("[ Go ]");
+    QVERIFY(fieldCol != std::string::npos && buttonCol != std::string::npos);
+    const int field = static_cast<int>(fieldCol);
+    const int button = static_cast<int>(buttonCol);
+
+    // Every cell of an item hits it, brackets included; the gap between
+    // them and other items hit nothing.
+    QCOMPARE(frontend.focusableAt(1, field), size_t(0));
+    QCOMPARE(frontend.focusableAt(1, field + 7), size_t(0));
+    QCOMPARE(frontend.focusableAt(1, field + 8), QmlFrontendCore::kNoFocus);
+    QCOMPARE(frontend.focusableAt(1, button), size_t(1));
+    QCOMPARE(frontend.focusableAt(1, button + 5), size_t(1));
+    QCOMPARE(frontend.focusableAt(1, button + 6), QmlFrontendCore::kNoFocus);
+    QCOMPARE(frontend.focusableAt(0, field), QmlFrontendCore::kNoFocus);
+    QCOMPARE(frontend.focusableAt(2, button), QmlFrontendCore::kNoFocus);
+
+    // Pressing the field focuses it; pressing the button also runs it.
+    QVERIFY(!frontend.handleMouse(Action::Press, 0, 0));
+    QVERIFY(frontend.handleMouse(Action::Press, 1, field + 3));
+    QCOMPARE(frontend.focusIndex(), size_t(0));
+    QVERIFY(actions.empty());
+    QVERIFY(frontend.handleMouse(Action::Press, 1, button + 2));
+    QCOMPARE(frontend.focusIndex(), size_t(1));
+    QCOMPARE(actions, std::vector<std::string>{"go"});
+
+    // The wheel scrolls.
+    QVERIFY(frontend.handleMouse(Action::WheelDown, 0, 0));
+    QCOMPARE(frontend.scrollOffset(), size_t(QmlFrontendCore::kWheelStep));
+    QVERIFY(frontend.handleMouse(Action::WheelUp, 0, 0));
+    QCOMPARE(frontend.scrollOffset(), size_t(0));
+}
+
+void QmlCursesFrontendTest::animates_on_a_shared_timeline() {
+    using std::chrono::milliseconds;
+    using Clock = QmlTimeline::Clock;
+
+    // Tracks advance in whole steps from the first start, and the timeline
+    // is armed only while one runs.
+    std::vector<std::chrono::microseconds> wakes;
+    QmlTimeline timeline([&](std::chrono::microseconds delay) { wakes.push_back(delay); });
+    const Clock::time_point t0 = Clock::now();
+    std::vector<double> values;
+    const QmlTimeline::Track fade = timeline.addAnimation(0, 10, milliseconds(500), 1, [&](double value) {
+        values.push_back(value);
+        return true;
+    });
+    int fired = 0;
+    const QmlTimeline::Track once = timeline.addTimer(milliseconds(120), false, [&] { ++fired; });
+    timeline.start(fade, t0);
+    timeline.start(once, t0 + milliseconds(20));
+    QCOMPARE(values, std::vector<double>{0});
+    QCOMPARE(wakes, std::vector<std::chrono::microseconds>{milliseconds(50)});
+    QVERIFY(!timeline.tick(t0 + milliseconds(30)));
+    QVERIFY(timeline.tick(t0 + milliseconds(260)));
+    QCOMPARE(values.back(), 5.0);
+    QCOMPARE(fired, 1);
+    QCOMPARE(timeline.runningCount(), size_t(1));
+    QCOMPARE(wakes.back(), std::chrono::microseconds(milliseconds(40)));
+    QVERIFY(timeline.tick(t0 + milliseconds(600)));
+    QCOMPARE(values.back(), 10.0);
+    QCOMPARE(timeline.stepsTaken(), uint64_t(12));
+    QCOMPARE(timeline.runningCount(), size_t(0));
+    QVERIFY(!timeline.armed());
+    QCOMPARE(wakes.size(), size_t(3));
+    timeline.remove(fade);
+    timeline.remove(once);
+
+    const std::string qml = R"(
+ApplicationWindow {
+    Timer { id: clock; interval: 1000; running: true; onTriggered: status.text = "tick" }
+    Column {
+        spacing: 0
+        Text {
+            id: status
+            text: "Hello"
+            NumberAnimation on opacity { from: 1; to: 0; duration: 1000; loops: Animation.Infinite }
+        }
+        Text { id: ticker; text: "abcd" }
+        BusyIndicator { }
+        TextField { id: field; placeholderText: "name"; focus: true }
+        NumberAnimation { target: ticker; property: "x"; from: 0; to: 4; duration: 2000; running: true }
+    }
+}
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QmlBufferScreen screen(4, 12);
+    auto frontend = std::make_unique<QmlCursesFrontend>(screen);
+    std::vector<std::string> actions;
+    frontend->setActionHandler([&](const std::string &id, const QmlScriptBlock &script) {
+        actions.push_back(id + "." + std::string(QmlAtomTable::global().name(script.name)));
+        frontend->setItemText("status", "tick");
+    });
+    frontend->setTimeline(&timeline);
+
+    // The field shows a cursor on the placeholder's first cell.
+    const Clock::time_point start = Clock::now();
+    frontend->render(doc);
+    QCOMPARE(timeline.runningCount(), size_t(5));  // with the cursor blink
+    QCOMPARE(screen.row(0), std::string("   Hello"));
+    QCOMPARE(screen.row(1), std::string("    abcd"));
+    QCOMPARE(screen.row(2), std::string("     |"));
+    QVERIFY(screen.ansi().find("\x1b[0;7m[ \x1b[0mn\x1b[0;7mame ]") != std::string::npos);
+
+    // Three quarters of the way through a blink: the text is blank, the
+    // marquee has moved on a character, the spinner turned and the cursor
+    // is off. Only those cells are sent.
+    QVERIFY(timeline.tick(start + milliseconds(750)));
+    frontend->render(doc);
+    QCOMPARE(screen.row(0), std::string(""));
+    QCOMPARE(screen.row(1), std::string("    dabc"));
+    QCOMPARE(screen.row(2), std::string("     \\"));
+    QVERIFY(screen.ansi().find("\x1b[0;7m[ name ]") != std::string::npos);
+    QCOMPARE(frontend->cellsWrittenLastFrame(), size_t(11));
+
+    // The Timer fires once through the action handler.
+    QVERIFY(timeline.tick(start + milliseconds(1250)));
+    QCOMPARE(actions, std::vector<std::string>{"clock.onTriggered"});
+    frontend->render(doc);
+    QCOMPARE(screen.row(0), std::string("    tick"));
+    QCOMPARE(screen.row(1), std::string("    cdab"));
+
+    // The marquee ends where it began; the rest runs until it goes away.
+    timeline.tick(start + milliseconds(2250));
+    frontend->render(doc);
+    QCOMPARE(screen.row(1), std::string("    abcd"));
+    QCOMPARE(timeline.runningCount(), size_t(3));
+    frontend.reset();
+    QCOMPARE(timeline.runningCount(), size_t(0));
+    const size_t armed = wakes.size();
+    QVERIFY(!timeline.tick(start + milliseconds(2300)));
+    QCOMPARE(wakes.size(), armed);
+}
+
+void QmlCursesFrontendTest::draws_colors_and_bold() {
+    const std::string qml = R"(
+ApplicationWindow {
+    Column {
+        spacing: 0
+        Text { text: "ok"; color: "green"; font.bold: true }
+        Text { text: "fail"; color: "#ff0000" }
+        Text { text: "warn"; color: "orange" }
+        Text { text: "fail"; color: "red" }
+        Text { text: "plain" }
+    }
+}
+)";
+    QCOMPARE(QmlColorPairs::parse("green"), 2);
+    QCOMPARE(QmlColorPairs::parse("#F00"), 9);
+    QCOMPARE(QmlColorPairs::parse("#00ff0000"), QmlColorPairs::kDefault);
+    QCOMPARE(QmlColorPairs::parse("chartreuse-ish"), QmlColorPairs::kDefault);
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QmlBufferScreen screen(5, 9);
+    QmlCursesFrontend frontend(screen);
+    frontend.setStatsEnabled(true);
+    frontend.render(doc);
+    const std::string ansi = screen.ansi();
+    QVERIFY(ansi.find("   \x1b[0;1;32mok\x1b[0m\n") != std::string::npos);
+    QVERIFY(ansi.find("  \x1b[0;91mfail\x1b[0m\n  \x1b[0;33mwarn\x1b[0m\n  \x1b[0;91mfail\x1b[0m\n") !=
+            std::string::npos);
+    QCOMPARE(screen.row(4), std::string("  plain"));
+
+    // Each colour is one pair however often it is used, and recompiling
+    // allocates none.
+    const uint32_t pairs = QmlColorPairs::global().pairCount();
+    QCOMPARE(QmlColorPairs::global().attributes(9), QmlColorPairs::global().attributes(QmlColorPairs::parse("red")));
+    frontend.invalidatePlan();
+    frontend.render(doc);
+    QCOMPARE(QmlColorPairs::global().pairCount(), pairs);
+
+    // Colour costs no extra runs over the same screen in monochrome.
+    std::string mono = qml;
+    for (const std::string_view drop : {"; color: \"green\"; font.bold: true", "; color: \"#ff0000\"",
+                                        "; color: \"orange\"", "; color: \"red\""}) {
+        mono.erase(mono.find(drop), drop.size());
+    }
+    const QmlDocument monoDoc = parser.parseString(mono);
+    QmlBufferScreen monoScreen(5, 9);
+    QmlCursesFrontend monoFrontend(monoScreen);
+    monoFrontend.setStatsEnabled(true);
+    monoFrontend.render(monoDoc);
+    QCOMPARE(monoScreen.text(), screen.text());
+
+    // A VT screen switches colours only where they change.
+    std::string output;
+    VtScreen vt(5, 9, [&output](std::string_view bytes) { output.append(bytes); });
+    vt.setSynchronizedOutput(false);
+    QmlCursesFrontend vtFrontend(vt);
+    vtFrontend.setStatsEnabled(true);
+    vtFrontend.render(doc);
+    QCOMPARE(vtFrontend.lastFrameStats().runs, monoFrontend.lastFrameStats().runs);
+    QVERIFY(output.find("\x1b[1;32;49mok") != std::string::npos);
+    QVERIFY(output.find("\x1b[0;91;49mfail") != std::string::npos);
+    QVERIFY(output.find("\x1b[33;49mwarn") != std::string::npos);
+}
+
+void QmlCursesFrontendTest::matches_golden_frames() {
+    QmlGoldenSuite suite(QFINDTESTDATA("golden/frontend.golden").toStdString(), true);
+    suite.check("title_and_column", R"(
+ApplicationWindow {
+    title: "Demo"
+    Column {
+        spacing: 1
+        Text { text: "Hello" }
+        Button { text: "Do it" }
+        Text { text: "Done" }
+    }
+}
+)",
+                8, 40);
+    suite.check("row_of_buttons", R"(
+ApplicationWindow {
+    Row {
+        spacing: 2
+        Button { text: "Ok" }
+        Button { text: "Cancel" }
+        Label { text: "ready" }
+    }
+}
+)",
+                3, 40);
+    suite.check("grid", R"(
+ApplicationWindow {
+    Grid {
+        columns: 3
+        spacing: 1
+        Text { text: "a" }
+        Text { text: "bb" }
+        Text { text: "ccc" }
+        Text { text: "dddd" }
+        Text { text: "e" }
+    }
+}
+)",
+                5, 20);
+    suite.check("wrapped_label", R"(
+ApplicationWindow {
+    Column {
+        Label { text: "one two three four five six"; width: 10; wrapMode: Text.Wrap }
+        TextField { text: "typed" }
+    }
+}
+)",
+                8, 24);
+    suite.check("colors_and_bold", R"(
+ApplicationWindow {
+    Column {
+        spacing: 0
+        Text { text: "ok"; color: "green"; font.bold: true }
+        Text { text: "fail"; color: "red" }
+        Text { text: "plain" }
+    }
+}
+)",
+                4, 12);
+    std::ifstream main(QFINDTESTDATA("../qml/Main.qml").toStdString());
+    std::stringstream source;
+    source << main.rdbuf();
+    suite.check("main_qml", source.str(), 16, 60);
+    QVERIFY2(suite.finish(), suite.failures().c_str());
+}
+
+// Thousands of generated layouts, every corpus shape, a hash apiece.
+void QmlCursesFrontendTest::matches_golden_corpus_frames() {
+    QmlGoldenSuite suite(QFINDTESTDATA("golden/corpus.golden").toStdString());
+    using Shape = QmlCorpusOptions::Shape;
+    for (const Shape shape : {Shape::Mixed, Shape::DeepNesting, Shape::WideColumn, Shape::LongLines, Shape::ManyIds}) {
+        for (uint32_t seed = 1; seed <= 400; ++seed) {
+            QmlCorpusOptions options;
+            options.shape = shape;
+            options.seed = seed;
+            options.bytes = 256 + seed % 7 * 128;
+            options.maxDepth = 12;
+            const std::string name = std::string(QmlCorpus::shapeName(shape)) + "-" + std::to_string(seed);
+            suite.check(name, QmlCorpus::generate(options), 12, 48);
+        }
+    }
+    QCOMPARE(suite.checked(), size_t(2000));
+    QVERIFY2(suite.finish(), suite.failures().c_str());
+}
+
+// renderSignIn() is generated from the same file by qml_curses_compile().
+void QmlCursesFrontendTest::compiled_render_matches_interpreter() {
+    QmlParser parser;
+    const QmlDocument doc = parser.parseFile(QFINDTESTDATA("compiled/SignIn.qml").toStdString());
+    std::map<std::string, std::string> values;
+    const auto writer = [&values](std::string_view binding, std::string &value) {
+        const auto it = values.find(std::string(binding));
+        if (it != values.end()) {
+            value = it->second;
+        }
+    };
+    const std::vector<std::map<std::string, std::string>> cases = {
+        {},
+        {{"session.greeting", "Welcome back"}, {"session.user", "alice"}},
+        {{"session.greeting", "Hi"}, {"session.user", "a name wider than the field"}},
+        {{"session.greeting", "日本語の挨拶"}, {"session.user", ""}},
+    };
+    for (const auto &bindings : cases) {
+        values = bindings;
+        for (const auto &[rows, cols] : {std::pair{24, 80}, std::pair{8, 20}, std::pair{40, 33}}) {
+            QmlBufferScreen interpreted(rows, cols);
+            QmlCursesFrontend frontend(interpreted, BindingWriter(writer));
+            frontend.render(doc);
+            QmlBufferScreen compiled(rows, cols);
+            QmlCompiledFrame frame;
+            frame.render(compiled, renderSignIn, writer);
+            QCOMPARE(QString::fromStdString(compiled.ansi()), QString::fromStdString(interpreted.ansi()));
+        }
+    }
+
+    // Later frames send only what changed.
+    values = {{"session.user", "bob"}};
+    QmlBufferScreen screen(24, 80);
+    QmlCompiledFrame frame;
+    frame.render(screen, renderSignIn, writer);
+    QCOMPARE(frame.render(screen, renderSignIn, writer), size_t(0));
+    values["session.user"] = "rob";
+    QCOMPARE(frame.render(screen, renderSignIn, writer), size_t(1));
+}
+
+void QmlCursesFrontendTest::draws_registered_elements() {
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(R"(
+ApplicationWindow {
+    Column {
+        spacing: 0
+        ProgressBar {
+            value: 40
+        }
+        Badge {
+            text: user.name
+            font.bold: true
+        }
+        StatusLight {
+            text: "unregistered"
+        }
+    }
+}
+)");
+    QmlBufferScreen screen(4, 20);
+    QmlCursesFrontend frontend(screen, [](const std::string &binding) {
+        return binding == "user.name" ? std::string("ada") : std::string();
+    });
+    frontend.registerElement("ProgressBar", [](const QmlNode &node) {
+        const int filled = node.intProperty(QmlAtomTable::global().intern("value"), 0) / 10;
+        return QmlFrontendCore::ElementDraw{std::string(filled, '#') + std::string(10 - filled, '.')};
+    });
+    frontend.registerElement("Badge", [](const QmlNode &node) {
+        QmlFrontendCore::ElementDraw draw;
+        draw.text = node.property(QmlAtoms::text);
+        draw.binding = true;
+        draw.framed = true;
+        return draw;
+    });
+    frontend.render(doc);
+    QCOMPARE(screen.row(0), std::string("     ####......"));
+    QCOMPARE(screen.row(1), std::string("      [ ada ]"));
+    QCOMPARE(screen.cells().row(1)[9].attributes, static_cast<uint32_t>(A_BOLD));
+    QCOMPARE(screen.row(2), std::string());
+
+    // Unregistering replans; the type is skipped again.
+    frontend.registerElement("Badge", nullptr);
+    frontend.render(doc);
+    QCOMPARE(screen.row(1), std::string());
+}
+
+void QmlCursesFrontendTest::render_compiler_rejects_dynamic_screens() {
+    QmlParser parser;
+    for (const char *source : {
+             "ApplicationWindow {\n  Column {\n    ListView {\n      model: items\n    }\n  }\n}\n",
+             "ApplicationWindow {\n  Timer {\n    interval: 100\n  }\n  Column {\n  }\n}\n",
+             "ApplicationWindow {\n  Column {\n    Text {\n      wrapMode: Text.WordWrap\n    }\n  }\n}\n",
+             "Item {\n}\n",
+         }) {
+        bool threw = false;
+        try {
+            QmlRenderCompiler::compile(parser.parseString(source), "Screen", "Screen.qml");
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        QVERIFY2(threw, source);
+    }
+    const QmlRenderCompiler::Output output = QmlRenderCompiler::compile(
+        parser.parseString("ApplicationWindow {\n    title: \"Fixed\"\n}\n"), "Screen", "Screen.qml");
+    QVERIFY(output.header.find("void renderScreen(QmlCompiledFrame &frame, BindingWriter resolve);") !=
+            std::string::npos);
+    QVERIFY(output.source.find("constexpr QmlCompiledText text0{\"Fixed\", 5};") != std::string::npos);
+}
+
 QTEST_GUILESS_MAIN(QmlCursesFrontendTest)
 #include "qml_curses_frontend_test.moc"
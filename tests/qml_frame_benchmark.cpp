@@ -0,0 +1,149 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QQmlApplicationEngine>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QtQml/qqmlextensionplugin.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+Q_IMPORT_QML_PLUGIN(SamplePlugin)
+
+namespace {
+
+constexpr double kFrameBudgetMs = 1000.0 / 60.0;
+
+// Rounds of typing a name and clicking hello; QML_FRAME_BENCH_ROUNDS
+// overrides it.
+int rounds() {
+    const int requested = qEnvironmentVariableIntValue("QML_FRAME_BENCH_ROUNDS");
+    return requested > 0 ? requested : 50;
+}
+
+}  // namespace
+
+// Drives Main.qml with synthetic typing and clicks and reports render times
+// per frame, from beforeRendering to frameSwapped, as benchmark results:
+// p50, p95 and p99 in milliseconds and the number of frames over the 60 Hz
+// budget. Runs under the offscreen or minimal QPA, so it fits CI trend
+// tracking (-o results.csv,csv).
+class QmlFrameBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void frame_times_data();
+    void frame_times();
+
+private:
+    void waitForFrame();
+
+    QQmlApplicationEngine engine_;
+    QQuickWindow *window_ = nullptr;
+    QElapsedTimer clock_;
+    std::mutex mutex_;  // the render thread records, this one reads
+    qint64 frameStart_ = 0;
+    std::vector<double> frameMs_;
+};
+
+void QmlFrameBenchmark::initTestCase() {
+    engine_.loadFromModule("Sample", "Main");
+    const auto roots = engine_.rootObjects();
+    QVERIFY(!roots.isEmpty());
+    window_ = qobject_cast<QQuickWindow *>(roots.first());
+    QVERIFY(window_);
+
+    clock_.start();
+    connect(
+        window_, &QQuickWindow::beforeRendering, this,
+        [this] {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            frameStart_ = clock_.nsecsElapsed();
+        },
+        Qt::DirectConnection);
+    connect(
+        window_, &QQuickWindow::frameSwapped, this,
+        [this] {
+            const qint64 now = clock_.nsecsElapsed();
+            const std::lock_guard<std::mutex> lock(mutex_);
+            if (frameStart_ != 0) {
+                frameMs_.push_back(static_cast<double>(now - frameStart_) / 1e6);
+                frameStart_ = 0;
+            }
+        },
+        Qt::DirectConnection);
+
+    window_->show();
+    QVERIFY(QTest::qWaitForWindowExposed(window_));
+    waitForFrame();
+
+    auto *nameField = window_->findChild<QQuickItem *>("nameField");
+    auto *helloButton = window_->findChild<QQuickItem *>("helloButton");
+    QVERIFY(nameField);
+    QVERIFY(helloButton);
+    const QPoint buttonCenter =
+        helloButton->mapToScene(QPointF(helloButton->width() / 2, helloButton->height() / 2)).toPoint();
+
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        frameMs_.clear();  // the first frame builds the scene graph
+    }
+    for (int round = 0, total = rounds(); round < total; ++round) {
+        nameField->forceActiveFocus();
+        nameField->setProperty("text", QString());
+        for (const char key : QByteArrayLiteral("Ada Lovelace")) {
+            QTest::keyClick(window_, key);
+            waitForFrame();
+        }
+        QTest::mouseClick(window_, Qt::LeftButton, Qt::NoModifier, buttonCenter);
+        waitForFrame();
+    }
+    const std::lock_guard<std::mutex> lock(mutex_);
+    QVERIFY(!frameMs_.empty());
+    std::sort(frameMs_.begin(), frameMs_.end());
+}
+
+void QmlFrameBenchmark::cleanupTestCase() {
+    if (window_) {
+        disconnect(window_, nullptr, this, nullptr);
+    }
+    window_ = nullptr;
+}
+
+// Waits for the frame an interaction scheduled, if it renders one.
+void QmlFrameBenchmark::waitForFrame() {
+    const auto frames = [this] {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        return frameMs_.size();
+    };
+    const size_t before = frames();
+    QTest::qWaitFor([&] { return frames() > before; }, 100);
+}
+
+void QmlFrameBenchmark::frame_times_data() {
+    QTest::addColumn<double>("percentile");
+    QTest::newRow("p50") << 0.50;
+    QTest::newRow("p95") << 0.95;
+    QTest::newRow("p99") << 0.99;
+    QTest::newRow("over_budget") << -1.0;
+}
+
+void QmlFrameBenchmark::frame_times() {
+    QFETCH(double, percentile);
+    const std::lock_guard<std::mutex> lock(mutex_);
+    QVERIFY(!frameMs_.empty());
+    if (percentile < 0) {
+        const auto over = std::count_if(frameMs_.begin(), frameMs_.end(), [](double ms) { return ms > kFrameBudgetMs; });
+        qInfo("%zu frames, %lld over %.1f ms", frameMs_.size(), static_cast<long long>(over), kFrameBudgetMs);
+        QTest::setBenchmarkResult(static_cast<qreal>(over), QTest::Events);
+        return;
+    }
+    const size_t rank = std::min(frameMs_.size() - 1, static_cast<size_t>(percentile * (frameMs_.size() - 1) + 0.5));
+    QTest::setBenchmarkResult(frameMs_[rank], QTest::WalltimeMilliseconds);
+}
+
+QTEST_MAIN(QmlFrameBenchmark)
+#include "qml_frame_benchmark.moc"
@@ -0,0 +1,184 @@
+#include "qml_golden.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "qml_ast_cache.h"
+#include "qml_buffer_screen.h"
+#include "qml_parser.h"
+
+namespace {
+
+// Failures past this many list the case name only, so a change that moves
+// every frame still reads in a screenful.
+constexpr size_t kDetailedFailures = 8;
+
+std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream bytes;
+    bytes << in.rdbuf();
+    return bytes.str();
+}
+
+std::vector<std::string_view> lines(std::string_view text) {
+    std::vector<std::string_view> out;
+    while (!text.empty()) {
+        const size_t end = text.find('\n');
+        out.push_back(text.substr(0, end));
+        text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+    }
+    return out;
+}
+
+std::string hex(uint64_t hash) {
+    char digits[17];
+    std::snprintf(digits, sizeof(digits), "%016" PRIx64, hash);
+    return digits;
+}
+
+std::string numbered(std::string_view frame) {
+    std::string out;
+    int row = 0;
+    for (std::string_view line : lines(frame)) {
+        char prefix[16];
+        std::snprintf(prefix, sizeof(prefix), "  %3d |", row++);
+        out += prefix;
+        out += line;
+        out += '\n';
+    }
+    return out;
+}
+
+// Rows of expected and actual that differ, as "-" and "+" pairs.
+std::string rowDiff(std::string_view expected, std::string_view actual) {
+    const std::vector<std::string_view> before = lines(expected);
+    const std::vector<std::string_view> after = lines(actual);
+    std::string out;
+    for (size_t row = 0; row < std::max(before.size(), after.size()); ++row) {
+        const std::string_view was = row < before.size() ? before[row] : std::string_view();
+        const std::string_view is = row < after.size() ? after[row] : std::string_view();
+        if (was == is) {
+            continue;
+        }
+        char prefix[16];
+        std::snprintf(prefix, sizeof(prefix), "  %3zu -|", row);
+        ((out += prefix) += was) += '\n';
+        ((out += "      +|") += is) += '\n';
+    }
+    return out.empty() ? std::string("  (same text; the attributes differ)\n") : out;
+}
+
+}  // namespace
+
+QmlGoldenSuite::QmlGoldenSuite(std::string goldenPath, bool keepFrames) : goldenPath_(std::move(goldenPath)) {
+    const std::string golden = readFile(goldenPath_);
+    for (std::string_view line : lines(golden)) {
+        const size_t space = line.rfind(' ');
+        if (line.empty() || line[0] == '#' || space == std::string_view::npos) {
+            continue;
+        }
+        golden_[std::string(line.substr(0, space))] =
+            std::strtoull(std::string(line.substr(space + 1)).c_str(), nullptr, 16);
+    }
+    if (!keepFrames) {
+        return;
+    }
+    const size_t dot = goldenPath_.rfind('.');
+    framesPath_ = goldenPath_.substr(0, dot) + ".frames";
+    const std::string frames = readFile(framesPath_);
+    std::string *frame = nullptr;
+    for (std::string_view line : lines(frames)) {
+        if (line.substr(0, 3) == "== ") {
+            frame = &frames_[std::string(line.substr(3))];
+        } else if (frame) {
+            (*frame += line) += '\n';
+        }
+    }
+}
+
+bool QmlGoldenSuite::check(const std::string &name, std::string_view qml, int rows, int cols) {
+    QmlParser parser;
+    const QmlDocument document = parser.parseString(qml);
+    QmlBufferScreen screen(rows, cols);
+    QmlCursesFrontend frontend(screen);
+    frontend.render(document);
+    return check(name, screen);
+}
+
+bool QmlGoldenSuite::check(const std::string &name, const QmlBufferScreen &screen) {
+    ++checked_;
+    const uint64_t hash = frameHash(screen);
+    if (updating()) {
+        actualHashes_[name] = hash;
+        if (!framesPath_.empty()) {
+            actualFrames_[name] = screen.text();
+        }
+        return true;
+    }
+    const auto golden = golden_.find(name);
+    if (golden == golden_.end()) {
+        fail(name, "no golden hash; render it with QML_GOLDEN_UPDATE=1", screen.text());
+        return false;
+    }
+    if (golden->second == hash) {
+        frames_.erase(name);  // what is left unvisited is reported by finish()
+        golden_.erase(golden);
+        return true;
+    }
+    std::string detail = "frame " + hex(hash) + ", golden " + hex(golden->second);
+    const auto reference = frames_.find(name);
+    if (reference != frames_.end()) {
+        detail += "\n" + rowDiff(reference->second, screen.text());
+        detail.pop_back();
+    }
+    golden_.erase(golden);
+    fail(name, detail, screen.text());
+    return false;
+}
+
+bool QmlGoldenSuite::finish() {
+    if (updating()) {
+        std::ofstream golden(goldenPath_, std::ios::binary | std::ios::trunc);
+        golden << "# Frame hashes, one case a line; regenerate with QML_GOLDEN_UPDATE=1.\n";
+        for (const auto &[name, hash] : actualHashes_) {
+            golden << name << ' ' << hex(hash) << '\n';
+        }
+        if (!framesPath_.empty()) {
+            std::ofstream frames(framesPath_, std::ios::binary | std::ios::trunc);
+            for (const auto &[name, frame] : actualFrames_) {
+                frames << "== " << name << '\n' << frame;
+            }
+        }
+        return golden.good();
+    }
+    for (const auto &entry : golden_) {
+        failures_ += entry.first + ": golden case was not rendered\n";
+        ++failed_;
+    }
+    golden_.clear();
+    return failed_ == 0;
+}
+
+uint64_t QmlGoldenSuite::frameHash(const QmlBufferScreen &screen) {
+    // ansi() carries the attributes as well as the text.
+    return QmlAstCache::contentHash(screen.ansi());
+}
+
+bool QmlGoldenSuite::updating() {
+    const char *update = std::getenv("QML_GOLDEN_UPDATE");
+    return update && *update && std::string_view(update) != "0";
+}
+
+void QmlGoldenSuite::fail(const std::string &name, const std::string &detail, const std::string &frame) {
+    if (failed_++ < kDetailedFailures) {
+        failures_ += name + ": " + detail + "\n  rendered:\n" + numbered(frame);
+    } else {
+        failures_ += name + "\n";
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+
+class QmlBufferScreen;
+
+// Golden-frame snapshots for the curses frontend. A case renders a
+// document into a QmlBufferScreen and hashes the frame, text and
+// attributes; the suite's golden file holds the expected hash of every
+// case, one "name hash" line each, so thousands of generated layouts cost
+// a few bytes apiece and compare as integers. Only a mismatch costs more:
+// its failure shows the frame as rendered, and where the suite keeps
+// reference frames (a .frames file beside the .golden file), the rows
+// that differ from it.
+//
+// With QML_GOLDEN_UPDATE=1 in the environment, finish() rewrites the files
+// from what was rendered instead of failing. Review the diff before
+// committing it.
+class QmlGoldenSuite {
+public:
+    // goldenPath names "<suite>.golden"; keepFrames also reads and writes
+    // "<suite>.frames". A missing file reads as an empty suite.
+    explicit QmlGoldenSuite(std::string goldenPath, bool keepFrames = false);
+
+    // Parses qml, renders it into a rows x cols QmlBufferScreen and checks
+    // the frame.
+    bool check(const std::string &name, std::string_view qml, int rows, int cols);
+    // Compares the screen's frame with name's golden hash; a mismatch is
+    // added to failures().
+    bool check(const std::string &name, const QmlBufferScreen &screen);
+    // When updating, writes the files; otherwise golden cases no check()
+    // visited are failures too. True if nothing failed.
+    bool finish();
+
+    const std::string &failures() const { return failures_; }
+    size_t checked() const { return checked_; }
+
+    static uint64_t frameHash(const QmlBufferScreen &screen);
+    static bool updating();
+
+private:
+    void fail(const std::string &name, const std::string &detail, const std::string &frame);
+
+    std::string goldenPath_;
+    std::string framesPath_;  // empty unless the suite keeps frames
+    std::map<std::string, uint64_t> golden_;  // sorted, so rewrites are stable
+    std::map<std::string, std::string> frames_;
+    std::map<std::string, uint64_t> actualHashes_;  // while updating
+    std::map<std::string, std::string> actualFrames_;
+    std::string failures_;
+    size_t checked_ = 0;
+    size_t failed_ = 0;
+};
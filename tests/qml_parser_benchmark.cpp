@@ -0,0 +1,1115 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "qml_alloc_tracker.h"
+#include "qml_ast_cache.h"
+#include "qml_bench_harness.h"
+#include "qml_buffer_screen.h"
+#include "qml_compiled_frame.h"
+#include "qml_compressed_document.h"
+#include "qml_console_screen.h"
+#include "qml_corpus.h"
+#include "qml_curses_frontend.h"
+#include "qml_dedup.h"
+#include "qml_export.h"
+#include "qml_index_service.h"
+#include "qml_log.h"
+#include "qml_parser.h"
+#include "qml_selector.h"
+#include "qml_vt_screen.h"
+#include "qml_writer.h"
+#include "SignIn_qml.h"
+
+namespace {
+
+// Largest corpus the scaling benchmarks generate; QML_CORPUS_MAX_BYTES
+// raises or lowers it (up to a gigabyte takes minutes and several GB).
+size_t corpusMaxBytes() {
+    const QByteArray limit = qgetenv("QML_CORPUS_MAX_BYTES");
+    return limit.isEmpty() ? size_t(16) << 20 : static_cast<size_t>(limit.toULongLong());
+}
+
+std::string makeSource(int items) {
+    std::string source =
+        "ApplicationWindow {\n"
+        "    id: window\n"
+        "    title: \"Benchmark window title\"\n"
+        "    Column {\n"
+        "        spacing: 1\n";
+    for (int i = 0; i < items; ++i) {
+        const std::string index = std::to_string(i);
+        source += "        Text {\n";
+        source += "            id: label" + index + "\n";
+        source += "            text: \"Generated label number " + index + "\"\n";
+        source += "        }\n";
+        source += "        Button { id: button" + index + "; text: \"Action " + index + "\" }\n";
+    }
+    source += "    }\n}\n";
+    return source;
+}
+
+// A Column of Texts, each bound to a binding of its own.
+std::string makeBoundSource(int items) {
+    std::string source = "ApplicationWindow {\n    Column {\n";
+    for (int i = 0; i < items; ++i) {
+        source += "        Text { text: model.label" + std::to_string(i) + " }\n";
+    }
+    source += "    }\n}\n";
+    return source;
+}
+
+// A templated screen: the same Row delegate repeated, only the ids differ.
+std::string makeDelegateSource(int items) {
+    std::string source = "ApplicationWindow {\n    Column {\n";
+    for (int i = 0; i < items; ++i) {
+        const std::string index = std::to_string(i);
+        source += "        Row {\n";
+        source += "            Text { id: label" + index + "; text: model.label; width: 24 }\n";
+        source += "            Button { id: button" + index + "; text: \"Open\"; onClicked: open() }\n";
+        source += "        }\n";
+    }
+    source += "    }\n}\n";
+    return source;
+}
+
+// Input dimensions the complexity benchmark grows one at a time; each
+// source holds the others small.
+enum class ScalingAxis {
+    LineLength,         // one binding, an n-term expression
+    NestingDepth,       // n nested Items
+    Siblings,           // a Column of n Texts
+    PropertiesPerNode,  // one Item with n bindings, a line each
+    InlineSegments,     // one Item with n bindings on one line
+};
+
+std::string makeAxisSource(ScalingAxis axis, int n) {
+    std::string source;
+    switch (axis) {
+    case ScalingAxis::LineLength:
+        source = "Item {\n    width: a0";
+        for (int i = 1; i < n; ++i) {
+            source += " + a" + std::to_string(i % 10);
+        }
+        source += "\n}\n";
+        break;
+    case ScalingAxis::NestingDepth:
+        for (int i = 0; i < n; ++i) {
+            source += "Item {\n";
+        }
+        for (int i = 0; i < n; ++i) {
+            source += "}\n";
+        }
+        break;
+    case ScalingAxis::Siblings:
+        source = "Column {\n";
+        for (int i = 0; i < n; ++i) {
+            source += "    Text { text: \"label\" }\n";
+        }
+        source += "}\n";
+        break;
+    case ScalingAxis::PropertiesPerNode:
+        source = "Item {\n";
+        for (int i = 0; i < n; ++i) {
+            source += "    p" + std::to_string(i) + ": " + std::to_string(i) + "\n";
+        }
+        source += "}\n";
+        break;
+    case ScalingAxis::InlineSegments:
+        source = "Item { p0: 0";
+        for (int i = 1; i < n; ++i) {
+            source += "; p" + std::to_string(i) + ": " + std::to_string(i);
+        }
+        source += " }\n";
+        break;
+    }
+    return source;
+}
+
+// Nanoseconds per call of run, the best of three samples of at least 2 ms
+// each, so that small inputs are timed as reliably as large ones.
+template <typename Run>
+double bestNanoseconds(const Run &run) {
+    double best = 0;
+    for (int sample = 0; sample < 3; ++sample) {
+        QElapsedTimer timer;
+        timer.start();
+        qint64 calls = 0;
+        do {
+            run();
+            ++calls;
+        } while (timer.nsecsElapsed() < 2000000);
+        const double perCall = static_cast<double>(timer.nsecsElapsed()) / static_cast<double>(calls);
+        best = sample == 0 ? perCall : std::min(best, perCall);
+    }
+    return best;
+}
+
+// Least-squares slope of log(time) against log(size): about 1 for linear
+// growth, 2 for quadratic.
+double growthExponent(const std::vector<double> &sizes, const std::vector<double> &times) {
+    double meanX = 0;
+    double meanY = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        meanX += std::log(sizes[i]);
+        meanY += std::log(times[i]);
+    }
+    meanX /= static_cast<double>(sizes.size());
+    meanY /= static_cast<double>(sizes.size());
+    double covariance = 0;
+    double variance = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        const double dx = std::log(sizes[i]) - meanX;
+        covariance += dx * (std::log(times[i]) - meanY);
+        variance += dx * dx;
+    }
+    return covariance / variance;
+}
+
+// Concrete screen for comparing static and virtual dispatch; it only
+// counts what it is sent.
+class CountingScreen final : public ICursesScreen {
+public:
+    void clear() override {}
+    void drawText(int, int, const std::string &text) override { cells += text.size(); }
+    void drawRuns(const ScreenRun *runs, size_t count) override {
+        for (size_t i = 0; i < count; ++i) {
+            cells += runs[i].text.size();
+        }
+    }
+    void refresh() override {}
+    int rows() const override { return 50; }
+    int cols() const override { return 120; }
+
+    size_t cells = 0;
+};
+
+std::vector<std::string> echoBindings(const std::vector<std::string> &bindings) {
+    return bindings;
+}
+
+}  // namespace
+
+class QmlParserBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void parse_throughput();
+    void parse_bytes_per_second_data();
+    void parse_bytes_per_second();
+    void parse_allocations_per_line();
+    void parse_arena_throughput();
+    void parse_into_throughput();
+    void parse_flat_throughput();
+    void write_bytes_per_second();
+    void export_bytes_per_second_data();
+    void export_bytes_per_second();
+    void find_by_id_latency();
+    void find_child_by_type_latency_data();
+    void find_child_by_type_latency();
+    void parse_corpus_scaling_data();
+    void parse_corpus_scaling();
+    void find_child_by_type_corpus_data();
+    void find_child_by_type_corpus();
+    void complexity_per_axis_data();
+    void complexity_per_axis();
+    void selector_query_data();
+    void selector_query();
+    void document_memory_per_source_byte_data();
+    void document_memory_per_source_byte();
+    void dedup_templated_screen();
+    void snapshot_and_edit();
+    void parse_files_single_thread();
+    void parse_files_all_cores();
+    void parse_one_file_in_parallel_data();
+    void parse_one_file_in_parallel();
+    void load_from_ast_cache();
+    void compressed_document_restore_data();
+    void compressed_document_restore();
+    void reparse_single_edit();
+    void index_service_query_data();
+    void index_service_query();
+    void vt_frame_bytes();
+    void console_full_frame();
+    void cell_grid_row_diff_data();
+    void cell_grid_row_diff();
+    void frontend_render_type_erased();
+    void frontend_render_static();
+    void render_full_frame();
+    void resolver_dispatch_data();
+    void resolver_dispatch();
+    void render_allocations_per_frame();
+    void compiled_render_data();
+    void compiled_render();
+    void dump_documents();
+    void log_call();
+
+private:
+    void parseFilesBenchmark(unsigned threadCount);
+    template <typename Frontend>
+    void frontendRenderBenchmark(Frontend &frontend, const QmlDocument &document);
+};
+
+void QmlParserBenchmark::parse_throughput() {
+    const std::string source = makeSource(1000);
+    QmlParser parser;
+
+    QBENCHMARK {
+        const QmlDocument doc = parser.parseString(source);
+        QVERIFY(!doc.roots.empty());
+    }
+}
+
+void QmlParserBenchmark::parse_bytes_per_second_data() {
+    QTest::addColumn<int>("items");
+    QTest::newRow("small") << 8;      // about 1 KB
+    QTest::newRow("medium") << 1000;  // about 130 KB
+    QTest::newRow("huge") << 50000;   // about 7 MB
+}
+
+// Throughput as a rate, so sizes can be compared directly: parses for at
+// least a quarter of a second and reports source bytes per second.
+void QmlParserBenchmark::parse_bytes_per_second() {
+    QFETCH(int, items);
+    const std::string source = makeSource(items);
+    QmlParser parser;
+
+    QElapsedTimer timer;
+    long long parses = 0;
+    timer.start();
+    do {
+        const QmlDocument doc = parser.parseString(source);
+        QVERIFY(!doc.roots.empty());
+        ++parses;
+    } while (timer.nsecsElapsed() < 250000000);
+    const double bytesPerSecond =
+        static_cast<double>(source.size()) * static_cast<double>(parses) * 1e9 / static_cast<double>(timer.nsecsElapsed());
+    qInfo("parseString: %zu bytes, %.1f MB/s", source.size(), bytesPerSecond / 1e6);
+    QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+}
+
+void QmlParserBenchmark::parse_allocations_per_line() {
+    const std::string source = makeSource(1000);
+    const auto lines = std::count(source.begin(), source.end(), '\n');
+    QmlParser parser;
+
+    const QmlAllocationScope scope;
+    {
+        const QmlDocument doc = parser.parseString(source);
+        QVERIFY(!doc.roots.empty());
+    }
+    const long long allocations = scope.allocations();
+
+    const double perLine = static_cast<double>(allocations) / static_cast<double>(lines);
+    qInfo("parseString: %lld allocations over %lld lines (%.2f per line)",
+          allocations, static_cast<long long>(lines), perLine);
+    QTest::setBenchmarkResult(perLine, QTest::Events);
+}
+
+// Against parse_throughput: the same source built in a monotonic arena
+// that is released after each parse.
+void QmlParserBenchmark::parse_arena_throughput() {
+    const std::string source = makeSource(1000);
+    QmlParser parser;
+    std::pmr::monotonic_buffer_resource arena;
+
+    QBENCHMARK {
+        {
+            const QmlDocument doc = parser.parseString(source, &arena);
+            QVERIFY(!doc.roots.empty());
+        }
+        arena.release();
+    }
+}
+
+// Against parse_throughput: the same source parsed again into one
+// document, which keeps its buffers from the previous round.
+void QmlParserBenchmark::parse_into_throughput() {
+    const std::string source = makeSource(1000);
+    QmlParser parser;
+    QmlDocument doc;
+    parser.parseInto(doc, source);
+
+    QBENCHMARK {
+        parser.parseInto(doc, source);
+        QVERIFY(!doc.roots.empty());
+    }
+}
+
+void QmlParserBenchmark::parse_flat_throughput() {
+    const std::string source = makeSource(1000);
+    QmlParser parser;
+
+    QBENCHMARK {
+        const QmlFlatDocument doc = parser.parseStringFlat(source);
+        QVERIFY(doc.nodeCount() > 0);
+    }
+}
+
+// Serializes the "huge" source's document through QmlWriter into a sink
+// that only counts, so the rate is the writer's alone. The writer keeps
+// one chunk buffer, whatever the document's size.
+void QmlParserBenchmark::write_bytes_per_second() {
+    const std::string source = makeSource(50000);
+    const QmlDocument doc = QmlParser().parseString(source);
+    size_t written = 0;
+    const auto sink = [&written](std::string_view chunk) { written += chunk.size(); };
+
+    QElapsedTimer timer;
+    long long writes = 0;
+    long long allocations = 0;
+    timer.start();
+    do {
+        const QmlAllocationScope scope;
+        QmlWriter(sink).write(doc, source);
+        allocations = scope.allocations();
+        ++writes;
+    } while (timer.nsecsElapsed() < 250000000);
+    const double bytesPerSecond = static_cast<double>(written) * 1e9 / static_cast<double>(timer.nsecsElapsed());
+    qInfo("QmlWriter: %zu bytes per document, %.1f MB/s, %lld allocations", written / static_cast<size_t>(writes),
+          bytesPerSecond / 1e6, allocations);
+    QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+}
+
+void QmlParserBenchmark::export_bytes_per_second_data() {
+    QTest::addColumn<bool>("messagePack");
+    QTest::newRow("json") << false;
+    QTest::newRow("msgpack") << true;
+}
+
+// As write_bytes_per_second, through QmlExporter: the rate at which the
+// tree is encoded, against the memory bandwidth it should approach.
+void QmlParserBenchmark::export_bytes_per_second() {
+    QFETCH(bool, messagePack);
+    const std::string source = makeSource(50000);
+    const QmlDocument doc = QmlParser().parseString(source);
+    const QmlExporter::Options options{messagePack ? QmlExporter::Format::MessagePack : QmlExporter::Format::Json};
+    size_t written = 0;
+    const auto sink = [&written](std::string_view chunk) { written += chunk.size(); };
+
+    QElapsedTimer timer;
+    long long exports = 0;
+    long long allocations = 0;
+    timer.start();
+    do {
+        const QmlAllocationScope scope;
+        QmlExporter(sink, options).write(doc, source);
+        allocations = scope.allocations();
+        ++exports;
+    } while (timer.nsecsElapsed() < 250000000);
+    const double bytesPerSecond = static_cast<double>(written) * 1e9 / static_cast<double>(timer.nsecsElapsed());
+    qInfo("QmlExporter (%s, %s): %zu bytes per document, %.1f MB/s, %lld allocations",
+          messagePack ? "msgpack" : "json", QmlExporter::kernelName(), written / static_cast<size_t>(exports),
+          bytesPerSecond / 1e6, allocations);
+    QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+}
+
+void QmlParserBenchmark::find_by_id_latency() {
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(makeSource(1000));
+    const std::string lastId = "button999";
+
+    QBENCHMARK {
+        QVERIFY(doc.findById(lastId));
+    }
+}
+
+void QmlParserBenchmark::find_child_by_type_latency_data() {
+    QTest::addColumn<QString>("type");
+    QTest::newRow("first child") << QStringLiteral("Column");
+    QTest::newRow("missing") << QStringLiteral("Slider");  // searches every node
+}
+
+void QmlParserBenchmark::find_child_by_type_latency() {
+    QFETCH(QString, type);
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(makeSource(1000));
+    const QmlNode &root = doc.roots.front();
+    const std::string wanted = type.toStdString();
+    const bool expected = wanted == "Column";
+
+    QBENCHMARK {
+        QCOMPARE(root.findChildByType(wanted) != nullptr, expected);
+    }
+}
+
+void QmlParserBenchmark::parse_corpus_scaling_data() {
+    QTest::addColumn<int>("shape");
+    QTest::addColumn<qulonglong>("bytes");
+    using Shape = QmlCorpusOptions::Shape;
+    for (const Shape shape : {Shape::Mixed, Shape::DeepNesting, Shape::WideColumn, Shape::LongLines, Shape::ManyIds}) {
+        for (size_t bytes = 1024; bytes <= corpusMaxBytes(); bytes *= 16) {
+            const QByteArray name = QByteArray(QmlCorpus::shapeName(shape).data(),
+                                               static_cast<int>(QmlCorpus::shapeName(shape).size())) +
+                                    ' ' + QByteArray::number(static_cast<qulonglong>(bytes >> 10)) + "K";
+            QTest::newRow(name.constData()) << static_cast<int>(shape) << static_cast<qulonglong>(bytes);
+        }
+    }
+}
+
+// Parse time and heap traffic against input size, one row per shape and
+// size, so the rows can be plotted: a line per shape, time and bytes
+// allocated against corpus bytes. Each parse runs once; the larger rows
+// are long enough to time without repeating.
+void QmlParserBenchmark::parse_corpus_scaling() {
+    QFETCH(int, shape);
+    QFETCH(qulonglong, bytes);
+    QmlCorpusOptions options;
+    options.shape = static_cast<QmlCorpusOptions::Shape>(shape);
+    options.bytes = static_cast<size_t>(bytes);
+    const std::string source = QmlCorpus::generate(options);
+    QmlParser parser;
+
+    QElapsedTimer timer;
+    const QmlAllocationScope scope;
+    timer.start();
+    {
+        const QmlDocument doc = parser.parseString(source);
+        QVERIFY(!doc.roots.empty());
+    }
+    const qint64 nsecs = timer.nsecsElapsed();
+    const long long allocated = scope.bytes();
+
+    qInfo("corpus %s: %zu bytes, %.3f ms, %lld bytes allocated (%.2f per source byte)",
+          QTest::currentDataTag(), source.size(), static_cast<double>(nsecs) / 1e6, allocated,
+          static_cast<double>(allocated) / static_cast<double>(source.size()));
+    QTest::setBenchmarkResult(static_cast<double>(nsecs) / 1e6, QTest::WalltimeMilliseconds);
+}
+
+void QmlParserBenchmark::find_child_by_type_corpus_data() {
+    QTest::addColumn<int>("shape");
+    QTest::addColumn<int>("depth");
+    QTest::addColumn<bool>("flat");
+    const int deep = static_cast<int>(QmlCorpusOptions::Shape::DeepNesting);
+    const int wide = static_cast<int>(QmlCorpusOptions::Shape::WideColumn);
+    QTest::newRow("deep 64") << deep << 64 << false;
+    QTest::newRow("deep 64 flat") << deep << 64 << true;
+    QTest::newRow("deep 1024") << deep << 1024 << false;
+    QTest::newRow("deep 1024 flat") << deep << 1024 << true;
+    QTest::newRow("wide") << wide << 1 << false;
+    QTest::newRow("wide flat") << wide << 1 << true;
+}
+
+// Worst cases for the recursive findChildByType: a type no corpus contains,
+// searched through long chains (recursion depth) and through one very
+// wide Column (breadth). The flat rows scan QmlFlatDocument's pre-order
+// node array instead.
+void QmlParserBenchmark::find_child_by_type_corpus() {
+    QFETCH(int, shape);
+    QFETCH(int, depth);
+    QFETCH(bool, flat);
+    QmlCorpusOptions options;
+    options.shape = static_cast<QmlCorpusOptions::Shape>(shape);
+    options.bytes = 1 << 20;
+    options.maxDepth = depth;
+    const std::string source = QmlCorpus::generate(options);
+    QmlParser parser;
+    // Interned, or the lookup would return before walking anything.
+    const QmlAtom wanted = QmlAtomTable::global().intern(QmlCorpus::kAbsentType);
+
+    if (flat) {
+        const QmlFlatDocument doc = parser.parseStringFlat(source);
+        const uint32_t root = doc.roots()[0];
+        QBENCHMARK {
+            QCOMPARE(doc.findChildByType(root, wanted), QmlFlatDocument::npos);
+        }
+        return;
+    }
+    const QmlDocument doc = parser.parseString(source);
+    const QmlNode &root = doc.roots.front();
+    QBENCHMARK {
+        QVERIFY(!root.findChildByType(wanted));
+    }
+}
+
+void QmlParserBenchmark::complexity_per_axis_data() {
+    QTest::addColumn<int>("axis");
+    QTest::addColumn<QString>("operation");
+    const QList<QPair<const char *, ScalingAxis>> axes = {
+        {"line length", ScalingAxis::LineLength},
+        {"nesting depth", ScalingAxis::NestingDepth},
+        {"siblings", ScalingAxis::Siblings},
+        {"properties per node", ScalingAxis::PropertiesPerNode},
+        {"inline segments", ScalingAxis::InlineSegments},
+    };
+    for (const auto &[name, axis] : axes) {
+        QTest::addRow("parse %s", name) << static_cast<int>(axis) << QStringLiteral("parse");
+        QTest::addRow("flat %s", name) << static_cast<int>(axis) << QStringLiteral("flat");
+    }
+    QTest::addRow("findChildByType nesting depth") << static_cast<int>(ScalingAxis::NestingDepth)
+                                                   << QStringLiteral("find");
+    QTest::addRow("findChildByType siblings") << static_cast<int>(ScalingAxis::Siblings) << QStringLiteral("find");
+}
+
+// Guards against hidden O(n^2): times one operation as a single input
+// dimension grows from 1,000 to 16,000, fits the growth exponent and
+// fails if it is clearly above linear. Two axes were quadratic when this
+// was added: each ';' segment rescanned its line's structurals from the
+// start, and each binding searched all the earlier keys of its object.
+void QmlParserBenchmark::complexity_per_axis() {
+    QFETCH(int, axis);
+    QFETCH(QString, operation);
+    QmlParser parser;
+    const QmlAtom wanted = QmlAtomTable::global().intern(QmlCorpus::kAbsentType);
+
+    std::vector<double> sizes;
+    std::vector<double> times;
+    size_t found = 0;  // keeps the work observable
+    for (int n = 1000; n <= 16000; n *= 2) {
+        const std::string source = makeAxisSource(static_cast<ScalingAxis>(axis), n);
+        double nsecs = 0;
+        if (operation == QLatin1String("parse")) {
+            nsecs = bestNanoseconds([&] { found += parser.parseString(source).roots.size(); });
+        } else if (operation == QLatin1String("flat")) {
+            nsecs = bestNanoseconds([&] { found += parser.parseStringFlat(source).nodeCount(); });
+        } else {
+            const QmlDocument doc = parser.parseString(source);
+            nsecs = bestNanoseconds([&] { found += doc.roots.front().findChildByType(wanted) ? 0 : 1; });
+        }
+        sizes.push_back(n);
+        times.push_back(nsecs);
+        qInfo("%s n=%d: %.3f ms", QTest::currentDataTag(), n, nsecs / 1e6);
+    }
+    QVERIFY(found > 0);
+    const double exponent = growthExponent(sizes, times);
+    qInfo("%s: time grows as n^%.2f", QTest::currentDataTag(), exponent);
+    // Linear work still drifts above 1 as the larger inputs fall out of
+    // cache; quadratic work fits close to 2.
+    QVERIFY2(exponent < 1.35, qPrintable(QStringLiteral("superlinear: n^%1").arg(exponent, 0, 'f', 2)));
+}
+
+void QmlParserBenchmark::selector_query_data() {
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("compiled") << false;
+    QTest::newRow("cached") << true;
+}
+
+// "Column > Button[text^=Action]" over 10,000 Buttons. The compiled rows
+// reindex first, so every query misses the cache.
+void QmlParserBenchmark::selector_query() {
+    QFETCH(bool, cached);
+    QmlParser parser;
+    QmlDocument doc = parser.parseString(makeSource(10000));
+    const QmlSelector selector = QmlSelector::compile("Column > Button[text^=Action]");
+
+    QBENCHMARK {
+        if (!cached) {
+            doc.reindex();
+        }
+        QCOMPARE(selector.select(doc).size(), size_t(10000));
+    }
+}
+
+void QmlParserBenchmark::document_memory_per_source_byte_data() {
+    QTest::addColumn<int>("shape");
+    using Shape = QmlCorpusOptions::Shape;
+    for (const Shape shape : {Shape::Mixed, Shape::DeepNesting, Shape::WideColumn, Shape::LongLines, Shape::ManyIds}) {
+        const std::string name(QmlCorpus::shapeName(shape));
+        QTest::newRow(name.c_str()) << static_cast<int>(shape);
+    }
+}
+
+// What a parsed document keeps, per byte of source, broken down by
+// QmlDocument::memoryUsage(); the peak is what parsing allocated in total.
+void QmlParserBenchmark::document_memory_per_source_byte() {
+    QFETCH(int, shape);
+    QmlCorpusOptions options;
+    options.shape = static_cast<QmlCorpusOptions::Shape>(shape);
+    options.bytes = 1 << 20;
+    const std::string source = QmlCorpus::generate(options);
+    QmlParser parser;
+
+    const QmlAllocationScope scope;
+    const QmlDocument doc = parser.parseString(source);
+    const long long parsed = scope.bytes();
+    const QmlMemoryUsage usage = doc.memoryUsage();
+
+    const QmlFlatDocument flat = parser.parseStringFlat(source);
+
+    const auto perByte = [&source](size_t bytes) { return static_cast<double>(bytes) / static_cast<double>(source.size()); };
+    qInfo("%s: %zu nodes, %.2f bytes per source byte (nodes %.2f, child slack %.2f, properties %.2f, scripts %.2f, "
+          "strings %.2f, indices %.2f), %.2f allocated while parsing",
+          QTest::currentDataTag(), usage.nodeCount, perByte(usage.total()), perByte(usage.nodes),
+          perByte(usage.childVectors), perByte(usage.properties), perByte(usage.scripts), perByte(usage.strings),
+          perByte(usage.indices), perByte(static_cast<size_t>(parsed)));
+    qInfo("%s: flat document %.2f bytes per source byte, %.1f bytes per node against %.1f",
+          QTest::currentDataTag(), perByte(flat.byteSize()),
+          static_cast<double>(flat.byteSize()) / static_cast<double>(flat.nodeCount()),
+          static_cast<double>(usage.total()) / static_cast<double>(usage.nodeCount));
+    QTest::setBenchmarkResult(perByte(usage.total()), QTest::BytesAllocated);
+}
+
+// Hash-consing a screen of repeated delegates: build time, and memory kept
+// against the tree it was built from.
+void QmlParserBenchmark::dedup_templated_screen() {
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(makeDelegateSource(10000));
+    const size_t treeBytes = doc.memoryUsage().total();
+
+    size_t dedupedBytes = 0;
+    size_t shapes = 0;
+    QBENCHMARK {
+        const QmlDedupedDocument deduped = QmlDedupedDocument::build(doc);
+        dedupedBytes = deduped.byteSize();
+        shapes = deduped.shapeCount();
+    }
+    qInfo("dedup: %zu shapes, %zu bytes against %zu for the tree (%.1fx smaller)", shapes, dedupedBytes, treeBytes,
+          static_cast<double>(treeBytes) / static_cast<double>(dedupedBytes));
+}
+
+// Taking a snapshot of a large document and changing one property in the
+// working copy: the copy is O(1), and the edit duplicates the node lists
+// on one path, here the root list and a 20000-item Column.
+void QmlParserBenchmark::snapshot_and_edit() {
+    QmlParser parser;
+    QmlDocument doc = parser.parseString(makeSource(10000));
+
+    int tick = 0;
+    QBENCHMARK {
+        const QmlDocument snapshot = doc;
+        doc.roots[0].children[0].children[5000].setProperty(QmlAtoms::text, std::to_string(++tick));
+        QVERIFY(!snapshot.roots.sharesWith(doc.roots));
+    }
+}
+
+void QmlParserBenchmark::parseFilesBenchmark(unsigned threadCount) {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string source = makeSource(200);
+    std::vector<std::string> paths;
+    for (int i = 0; i < 64; ++i) {
+        paths.push_back(dir.filePath(QStringLiteral("Screen%1.qml").arg(i)).toStdString());
+        std::ofstream(paths.back(), std::ios::binary) << source;
+    }
+
+    QmlParser parser;
+    QBENCHMARK {
+        const auto results = parser.parseFiles(paths, threadCount);
+        QCOMPARE(results.size(), paths.size());
+    }
+}
+
+void QmlParserBenchmark::parse_files_single_thread() {
+    parseFilesBenchmark(1);
+}
+
+void QmlParserBenchmark::parse_files_all_cores() {
+    parseFilesBenchmark(0);
+}
+
+void QmlParserBenchmark::parse_one_file_in_parallel_data() {
+    QTest::addColumn<unsigned>("threads");
+    QTest::newRow("one thread") << 1u;  // parseString()
+    QTest::newRow("all cores") << 0u;
+}
+
+// One generated file of about 64 MB, split at the children of its Column.
+void QmlParserBenchmark::parse_one_file_in_parallel() {
+    QFETCH(unsigned, threads);
+    QmlCorpusOptions options;
+    options.shape = QmlCorpusOptions::Shape::WideColumn;
+    options.bytes = 64u << 20;
+    const std::string source = QmlCorpus::generate(options);
+    QmlParser parser;
+
+    QBENCHMARK {
+        const QmlDocument doc = parser.parseStringParallel(source, threads);
+        QVERIFY(!doc.roots.empty());
+    }
+}
+
+void QmlParserBenchmark::load_from_ast_cache() {
+    const std::string source = makeSource(1000);
+    const uint64_t hash = QmlAstCache::contentHash(source);
+    const std::string bytes = QmlAstCache::serialize(QmlParser().parseString(source), hash, source.size());
+
+    QBENCHMARK {
+        QmlDocument doc;
+        QVERIFY(QmlAstCache::deserialize(bytes, hash, source.size(), doc));
+    }
+}
+
+void QmlParserBenchmark::compressed_document_restore_data() {
+    QTest::addColumn<int>("items");
+    QTest::newRow("screen") << 60;
+    QTest::newRow("large") << 1000;
+}
+
+// Showing a compressed tab: a decompression and a load, which for a
+// screen should take a small part of a 16 ms frame.
+void QmlParserBenchmark::compressed_document_restore() {
+    QFETCH(int, items);
+    const QmlDocument document = QmlParser().parseString(makeSource(items));
+    const QmlCompressedDocument compressed(document);
+    qInfo("QmlCompressedDocument: %d items, %zu bytes compressed from %zu (%zu in memory)", items,
+          compressed.byteSize(), compressed.entrySize(), document.memoryUsage().total());
+
+    QBENCHMARK {
+        const QmlDocument restored = compressed.decompress();
+        QVERIFY(!restored.roots.empty());
+    }
+}
+
+// Edit-to-tree latency for a one-word change in a large file; compare with
+// parse_throughput, which reparses the same source from scratch.
+void QmlParserBenchmark::reparse_single_edit() {
+    std::string source = makeSource(1000);
+    QmlParser parser;
+    QmlDocument doc = parser.parseString(source);
+    const size_t offset = source.find("Action 500");
+    QVERIFY(offset != std::string::npos);
+    QmlTextEdit edits[] = {{offset, 6, "Launch"}, {offset, 6, "Action"}};
+
+    size_t next = 0;
+    QBENCHMARK {
+        const QmlTextEdit &edit = edits[next];
+        doc = parser.reparse(std::move(doc), source, edit);
+        source.replace(edit.offset, edit.removedLength, edit.insertedText);
+        next ^= 1;
+    }
+    QVERIFY(doc.findById("button500"));
+}
+
+// One request to a QmlIndexService holding 64 screens, as the index
+// server answers it, protocol text included.
+void QmlParserBenchmark::index_service_query_data() {
+    QTest::addColumn<QString>("request");
+    QTest::newRow("id") << QStringLiteral("id\tbutton150");
+    QTest::newRow("type") << QStringLiteral("type\tButton");
+    QTest::newRow("definition") << QStringLiteral("definition\t%1\t7\t17");
+    QTest::newRow("uses") << QStringLiteral("uses\tGenerated label number 150");
+}
+
+void QmlParserBenchmark::index_service_query() {
+    QFETCH(QString, request);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string source = makeSource(200);
+    for (int i = 0; i < 64; ++i) {
+        std::ofstream(dir.filePath(QStringLiteral("Screen%1.qml").arg(i)).toStdString(), std::ios::binary) << source;
+    }
+    QmlIndexService service;
+    QCOMPARE(service.addDirectory(dir.path().toStdString()), size_t(64));
+    const std::string line = request.arg(dir.filePath(QStringLiteral("Screen0.qml"))).toStdString();
+
+    std::string answer;
+    QBENCHMARK {
+        answer = service.answer(line);
+    }
+    QVERIFY(answer.size() > 1);
+}
+
+// Bytes and time per frame on the VT backend: a full first frame, then
+// frames that change one item. Compare with the curses path in a terminal.
+void QmlParserBenchmark::vt_frame_bytes() {
+    std::string source = makeSource(60);
+    const std::string spacing = "        spacing: 1\n";
+    source.insert(source.find(spacing) + spacing.size(), "        Text { text: counter }\n");
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(source);
+
+    size_t total = 0;
+    VtScreen screen(50, 120, [&total](std::string_view bytes) { total += bytes.size(); });
+    int tick = 0;
+    QmlCursesFrontend frontend(screen, [&tick](const std::string &binding) {
+        return binding == "counter" ? std::to_string(tick) : binding;
+    });
+    frontend.render(doc);
+    qInfo("VtScreen: %zu bytes for the first frame", screen.bytesLastFrame());
+    VtScreen budgeted(50, 120, [](std::string_view) {});
+    budgeted.setBandwidthBudget(4000);
+    QmlCursesFrontend budgetedFrontend(budgeted, [](const std::string &binding) { return binding; });
+    budgetedFrontend.render(doc);
+    qInfo("VtScreen: %zu bytes for the first frame with a bandwidth budget", budgeted.bytesLastFrame());
+
+    total = 0;
+    long long frames = 0;
+    QBENCHMARK {
+        ++tick;
+        frontend.invalidateBinding("counter");
+        frontend.render(doc);
+        ++frames;
+    }
+    qInfo("VtScreen: %.1f bytes per single-item frame", static_cast<double>(total) / static_cast<double>(frames));
+}
+
+// Every cell of a 300x100 console changes each frame: a hundred rows of
+// runs composed into the CHAR_INFO buffer and committed as one rectangle,
+// copied out here as WriteConsoleOutputW would.
+void QmlParserBenchmark::console_full_frame() {
+    constexpr int kRows = 100;
+    constexpr int kCols = 300;
+    std::vector<QmlConsoleCell> console(kRows * kCols);
+    size_t commits = 0;
+    QmlConsoleScreen screen(kRows, kCols, [&](const QmlConsoleCell *cells, int cols, const QmlConsoleRect &rect) {
+        ++commits;
+        for (int row = rect.top; row <= rect.bottom; ++row) {
+            std::copy(cells + row * cols + rect.left, cells + row * cols + rect.right + 1,
+                      console.begin() + row * cols + rect.left);
+        }
+    });
+    const std::string lines[2] = {std::string(kCols, 'a'), std::string(kCols, 'b')};
+    const uint32_t green = QmlColorPairs::global().attributes(2);
+    std::vector<ScreenRun> runs;
+    for (int row = 0; row < kRows; ++row) {
+        runs.push_back(ScreenRun{row, 0, {}, row % 3 == 0 ? green : 0, kCols});
+    }
+
+    int frame = 0;
+    QBENCHMARK {
+        for (ScreenRun &run : runs) {
+            run.text = lines[frame & 1];
+        }
+        screen.drawRuns(runs.data(), runs.size());
+        screen.refresh();
+        ++frame;
+    }
+    QCOMPARE(screen.commitsLastFrame(), size_t(1));
+    qInfo("QmlConsoleScreen: %.2f commits per full frame", static_cast<double>(commits) / frame);
+}
+
+void QmlParserBenchmark::cell_grid_row_diff_data() {
+    QTest::addColumn<int>("cols");
+    QTest::addColumn<int>("rows");
+    QTest::newRow("200x60") << 200 << 60;
+    QTest::newRow("400x120") << 400 << 120;
+}
+
+// The damage tracker alone on a wide terminal: each frame changes one cell
+// in every eighth row, so most rows are compared with the front and found
+// equal. QmlBufferScreen takes the runs without encoding them.
+void QmlParserBenchmark::cell_grid_row_diff() {
+    QFETCH(int, cols);
+    QFETCH(int, rows);
+    QmlBufferScreen screen(rows, cols);
+    QmlCellGrid grid;
+    grid.resize(rows, cols);
+    for (int row = 0; row < rows; ++row) {
+        grid.put(row, 0, std::string(static_cast<size_t>(cols), static_cast<char>('a' + row % 26)));
+    }
+    grid.flush(screen);
+
+    int frame = 0;
+    size_t cells = 0;
+    QBENCHMARK {
+        ++frame;
+        for (int row = frame % 8; row < rows; row += 8) {
+            QmlCell cell = grid.at(row, frame * 7 % cols);
+            cell.attributes ^= 1;  // always a change, however often the cell is picked
+            grid.set(row, frame * 7 % cols, cell);
+        }
+        cells += grid.flush(screen);
+    }
+    qInfo("QmlCellGrid (%s): %dx%d, %.1f cells sent per frame", QmlCellGrid::kernelName(), cols, rows,
+          static_cast<double>(cells) / frame);
+}
+
+// One changed binding per frame, so every frame resolves, composes and
+// flushes; see frontend_render_static for the same work without indirect
+// calls.
+template <typename Frontend>
+void QmlParserBenchmark::frontendRenderBenchmark(Frontend &frontend, const QmlDocument &document) {
+    frontend.render(document);
+    QBENCHMARK {
+        frontend.invalidateBinding("window.title");
+        frontend.render(document);
+    }
+    QVERIFY(frontend.itemCount() > 0);
+}
+
+void QmlParserBenchmark::frontend_render_type_erased() {
+    std::string source = makeSource(60);
+    source.replace(source.find("\"Benchmark window title\""), 24, "window.title");
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(source);
+    CountingScreen screen;
+    QmlCursesFrontend frontend(screen, BatchBindingResolver(echoBindings));
+    frontendRenderBenchmark(frontend, doc);
+}
+
+void QmlParserBenchmark::frontend_render_static() {
+    std::string source = makeSource(60);
+    source.replace(source.find("\"Benchmark window title\""), 24, "window.title");
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(source);
+    CountingScreen screen;
+    BasicQmlCursesFrontend<CountingScreen, decltype(&echoBindings)> frontend(screen, &echoBindings);
+    frontendRenderBenchmark(frontend, doc);
+}
+
+// A first frame every time: compiling the plan, resolving every binding,
+// the full layout and a repaint from a cleared screen. The frontend_render
+// benchmarks measure the incremental frames that follow it.
+void QmlParserBenchmark::render_full_frame() {
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(makeSource(60));
+    CountingScreen screen;
+
+    QBENCHMARK {
+        QmlCursesFrontend frontend(screen, BatchBindingResolver(echoBindings));
+        frontend.render(doc);
+    }
+    QVERIFY(screen.cells > 0);
+}
+
+void QmlParserBenchmark::resolver_dispatch_data() {
+    QTest::addColumn<QString>("resolver");
+    QTest::newRow("per binding") << QStringLiteral("function");
+    QTest::newRow("batch") << QStringLiteral("batch");
+    QTest::newRow("writer") << QStringLiteral("writer");
+}
+
+// Cost of handing 48 distinct bindings, a screenful, to each kind of resolver: every
+// frame drops the cache, so everything is resolved again.
+void QmlParserBenchmark::resolver_dispatch() {
+    QFETCH(QString, resolver);
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(makeBoundSource(48));
+    CountingScreen screen;
+    const auto writer = [](std::string_view binding, std::string &value) { value.assign(binding); };
+
+    std::unique_ptr<QmlCursesFrontend> frontend;
+    if (resolver == QLatin1String("function")) {
+        frontend = std::make_unique<QmlCursesFrontend>(screen, BindingResolver([](const std::string &binding) {
+                                                           return binding;
+                                                       }));
+    } else if (resolver == QLatin1String("batch")) {
+        frontend = std::make_unique<QmlCursesFrontend>(screen, BatchBindingResolver(echoBindings));
+    } else {
+        frontend = std::make_unique<QmlCursesFrontend>(screen, BindingWriter(writer));
+    }
+    frontend->render(doc);
+
+    QBENCHMARK {
+        frontend->invalidateAllBindings();
+        frontend->render(doc);
+    }
+}
+
+// Steady-state frames with a BindingWriter: one binding changes per frame
+// and is rewritten into its cached buffer, so no frame should allocate.
+void QmlParserBenchmark::render_allocations_per_frame() {
+    std::string source = makeSource(60);
+    source.replace(source.find("\"Benchmark window title\""), 24, "window.title");
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(source);
+
+    int tick = 0;
+    const auto writer = [&tick](std::string_view, std::string &value) {
+        value.append("Title ");
+        value.push_back(static_cast<char>('0' + tick % 10));
+    };
+    CountingScreen screen;
+    QmlCursesFrontend frontend(screen, writer);
+    frontend.render(doc);
+    frontend.render(doc);
+
+    constexpr int frames = 1000;
+    const QmlAllocationScope scope;
+    for (int i = 0; i < frames; ++i) {
+        ++tick;
+        frontend.invalidateBinding("window.title");
+        frontend.render(doc);
+    }
+    const long long allocations = scope.allocations();
+
+    qInfo("render: %lld allocations over %d frames", allocations, frames);
+    QTest::setBenchmarkResult(static_cast<double>(allocations) / frames, QTest::Events);
+    QCOMPARE(allocations, 0LL);
+}
+
+void QmlParserBenchmark::compiled_render_data() {
+    QTest::addColumn<bool>("compiled");
+    QTest::newRow("interpreted") << false;
+    QTest::newRow("compiled") << true;
+}
+
+// tests/compiled/SignIn.qml through QmlCursesFrontend::render() and
+// through the renderSignIn() that qml2curses generated from it. Every
+// frame resolves both bindings again and one of them changes.
+void QmlParserBenchmark::compiled_render() {
+    QFETCH(bool, compiled);
+    QmlParser parser;
+    const QmlDocument doc = parser.parseFile(QFINDTESTDATA("compiled/SignIn.qml").toStdString());
+    int tick = 0;
+    const auto writer = [&tick](std::string_view binding, std::string &value) {
+        value.assign(binding);
+        if (binding == "session.user") {
+            value.push_back(static_cast<char>('0' + tick % 10));
+        }
+    };
+    CountingScreen screen;
+
+    if (compiled) {
+        QmlCompiledFrame frame;
+        frame.render(screen, renderSignIn, writer);
+        QBENCHMARK {
+            ++tick;
+            frame.render(screen, renderSignIn, writer);
+        }
+    } else {
+        QmlCursesFrontend frontend(screen, BindingWriter(writer));
+        frontend.render(doc);
+        QBENCHMARK {
+            ++tick;
+            frontend.invalidateAllBindings();
+            frontend.render(doc);
+        }
+    }
+    QVERIFY(screen.cells > 0);
+}
+
+// What sample_cli --dump does per file: parse, render once into memory and
+// read the screen back as text.
+void QmlParserBenchmark::dump_documents() {
+    const std::string source = makeSource(60);
+    QmlParser parser;
+    QmlBufferScreen screen(24, 80);
+
+    QBENCHMARK {
+        const QmlDocument doc = parser.parseString(source);
+        screen.clear();
+        QmlCursesFrontend frontend(screen);
+        frontend.render(doc);
+        QVERIFY(!screen.text().empty());
+    }
+}
+
+// What a log call costs the thread making it. Records are logged in
+// batches that fit the thread's buffer and flushed between them, outside
+// the timing, so no call takes the dropping path and formatting is not
+// counted, as it would run on the writer thread.
+void QmlParserBenchmark::log_call() {
+    QmlLog::start([](std::string_view) {}, QmlLogLevel::Info, std::chrono::hours(1));
+    QmlLog::info("warm up");
+    QmlLog::flush();
+    constexpr size_t kBatch = QmlLog::kCapacity / 2;
+    const std::string path = "qml/Main.qml";
+
+    long long calls = 0;
+    long long nsecs = 0;
+    while (nsecs < 250000000) {
+        QElapsedTimer timer;
+        timer.start();
+        for (size_t i = 0; i < kBatch; ++i) {
+            QmlLog::info("frame {} of {} took {} ms", i, path, 1.5);
+        }
+        nsecs += timer.nsecsElapsed();
+        calls += static_cast<long long>(kBatch);
+        QmlLog::flush();
+    }
+    QmlLog::stop();
+    const double perCall = static_cast<double>(nsecs) / static_cast<double>(calls);
+    qInfo("QmlLog::info: %.1f ns per call, %lld calls", perCall, calls);
+    QCOMPARE(QmlLog::dropped(), uint64_t(0));
+    QTest::setBenchmarkResult(perCall, QTest::WalltimeNanoseconds);
+}
+
+QML_BENCH_MAIN(QmlParserBenchmark)
+#include "qml_parser_benchmark.moc"
@@ -1,6 +1,188 @@
 #include <QtTest>
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory_resource>
+#include <stdexcept>
+#include <thread>
+
+#include "qml_alloc_tracker.h"
+#include "qml_ast_cache.h"
+#include "qml_binding_graph.h"
+#include "qml_bundle.h"
+#include "qml_change_journal.h"
+#include "qml_compressed_document.h"
+#include "qml_corpus.h"
+#include "qml_dedup.h"
+#include "qml_document_handle.h"
+#include "qml_document_transaction.h"
+#include "qml_diff.h"
+#include "qml_export.h"
+#include "qml_expression.h"
+#include "qml_index_service.h"
+#include "qml_lz4.h"
 #include "qml_parser.h"
+#include "qml_project_index.h"
+#include "qml_selector.h"
+#include "qml_structural_scanner.h"
+#include "qml_undo_history.h"
+#include "qml_value_index.h"
+#include "qml_writer.h"
+
+namespace {
+
+class RecordingHandler : public QmlEventHandler {
+public:
+    bool beginObject(std::string_view type) override {
+        events.push_back("begin " + std::string(type));
+        return stopAtType.empty() || type != stopAtType;
+    }
+
+    bool property(std::string_view key, std::string_view value) override {
+        events.push_back(std::string(key) + "=" + std::string(value));
+        return true;
+    }
+
+    bool endObject() override {
+        events.push_back("end");
+        return true;
+    }
+
+    bool bindObject(std::string_view key) override {
+        events.push_back("bind " + std::string(key));
+        return true;
+    }
+
+    std::vector<std::string> events;
+    std::string stopAtType;
+};
+
+bool sameTree(const QmlNode &a, const QmlNode &b) {
+    if (a.type != b.type || a.id != b.id || a.binding != b.binding || a.sourceBegin != b.sourceBegin ||
+        a.sourceEnd != b.sourceEnd || a.properties.size() != b.properties.size() ||
+        a.children.size() != b.children.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.properties.size(); ++i) {
+        if (a.properties[i].key != b.properties[i].key || a.properties[i].value != b.properties[i].value ||
+            a.properties[i].typed.kind != b.properties[i].typed.kind) {
+            return false;
+        }
+    }
+    if (a.scripts.size() != b.scripts.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.scripts.size(); ++i) {
+        if (a.scripts[i].name != b.scripts[i].name || a.scripts[i].bodyBegin != b.scripts[i].bodyBegin ||
+            a.scripts[i].bodyEnd != b.scripts[i].bodyEnd) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.children.size(); ++i) {
+        if (!sameTree(a.children[i], b.children[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sameDocument(const QmlDocument &a, const QmlDocument &b) {
+    if (a.roots.size() != b.roots.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.roots.size(); ++i) {
+        if (!sameTree(a.roots[i], b.roots[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// One object, "greeter", with a message property and greet(name).
+class GreeterHost : public QmlExpressionHost {
+public:
+    bool lookup(QmlAtom name, QmlExpressionValue &out) override {
+        ++lookups;
+        if (QmlAtomTable::global().name(name) != "greeter") {
+            return false;
+        }
+        out.setObject(this);
+        return true;
+    }
+
+    bool member(const void *, uint32_t, QmlAtom name, QmlExpressionValue &out) override {
+        if (QmlAtomTable::global().name(name) != "message") {
+            return false;
+        }
+        out.text = "Hi";
+        out.setString();
+        return true;
+    }
+
+    bool call(const void *, uint32_t, QmlAtom method, const QmlExpressionValue *arguments, size_t count,
+              QmlExpressionValue &out) override {
+        if (QmlAtomTable::global().name(method) != "greet" || count != 1) {
+            return false;
+        }
+        out.text = "Hello, " + arguments[0].text + "!";
+        out.setString();
+        return true;
+    }
+
+    int lookups = 0;
+};
+
+// Resolves id.member reads from a table of current values.
+class ValueTableHost : public QmlExpressionHost {
+public:
+    bool lookup(QmlAtom name, QmlExpressionValue &out) override {
+        out.setObject(nullptr, name);
+        return true;
+    }
+
+    bool member(const void *, uint32_t tag, QmlAtom name, QmlExpressionValue &out) override {
+        const auto it = values.find({tag, name});
+        if (it == values.end()) {
+            return false;
+        }
+        out.text = it->second;
+        out.setString();
+        return true;
+    }
+
+    bool call(const void *, uint32_t, QmlAtom, const QmlExpressionValue *, size_t, QmlExpressionValue &) override {
+        return false;
+    }
+
+    std::map<std::pair<QmlAtom, QmlAtom>, std::string> values;
+};
+
+// Counts what passes through to an upstream resource.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource *upstream) : upstream_(upstream) {}
+
+    int allocations = 0;
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations;
+        return upstream_->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *ptr, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource *upstream_;
+};
+
+}  // namespace
 
 class QmlParserTest : public QObject {
     Q_OBJECT
@@ -8,6 +190,52 @@ class QmlParserTest : public QObject {
 private slots:
     void parses_nested_items();
     void parses_inline_children();
+    void parses_file_from_disk();
+    void parse_file_reports_missing_path();
+    void flat_document_matches_tree();
+    void interns_types_and_keys();
+    void indexes_ids_and_types();
+    void streams_events_without_tree();
+    void feeds_input_in_chunks();
+    void parses_files_in_parallel();
+    void parses_one_input_in_parallel();
+    void recovers_from_malformed_input_with_diagnostics();
+    void stops_at_parse_limits();
+    void lexes_multiline_values_comments_and_inline_objects();
+    void lexes_leading_operators_and_regex_literals();
+    void parses_block_and_object_bindings();
+    void ast_cache_round_trips_and_rejects_stale_entries();
+    void maps_shared_flat_cache_entries();
+    void loads_projects_from_a_bundle();
+    void ignores_structurals_inside_strings();
+    void scans_lines_across_windows();
+    void classifies_property_values();
+    void reparses_edited_ranges();
+    void skips_script_bodies();
+    void diffs_documents();
+    void evaluates_compiled_expressions();
+    void propagates_binding_changes_in_order();
+    void generates_parsable_corpora();
+    void parses_main_qml_within_allocation_budget();
+    void parses_into_a_memory_resource();
+    void parses_into_an_existing_document();
+    void keeps_parse_scratch_between_calls();
+    void walks_documents_without_recursion();
+    void navigates_to_parents_and_siblings();
+    void selects_nodes_with_compiled_selectors();
+    void keeps_undo_steps_as_shared_snapshots();
+    void commits_batched_edits_at_once();
+    void journals_changes_for_incremental_consumers();
+    void writes_documents_back_to_qml();
+    void exports_documents_as_json_and_messagepack();
+    void expands_project_components_once();
+    void reports_document_memory_usage();
+    void compresses_inactive_documents();
+    void shares_identical_subtrees();
+    void snapshots_share_nodes_until_written();
+    void publishes_documents_to_concurrent_readers();
+    void answers_index_queries_from_memory();
+    void finds_property_values_through_the_value_index();
 };
 
 void QmlParserTest::parses_nested_items() {
@@ -81,5 +309,2210 @@ ApplicationWindow {
     QCOMPARE(runButton->property("text"), std::string("Run"));
 }
 
+void QmlParserTest::parses_file_from_disk() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string path = dir.filePath(QStringLiteral("Mapped.qml")).toStdString();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "ApplicationWindow {\r\n    title: \"Mapped\"\r\n    Text { text: \"From disk\" }\r\n}";
+    }
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseFile(path);
+
+    const QmlNode *window = doc.firstRootOfType("ApplicationWindow");
+    QVERIFY(window);
+    QCOMPARE(window->property("title"), std::string("Mapped"));
+    const QmlNode *text = window->findChildByType("Text");
+    QVERIFY(text);
+    QCOMPARE(text->property("text"), std::string("From disk"));
+
+    const std::string emptyPath = dir.filePath(QStringLiteral("Empty.qml")).toStdString();
+    std::ofstream(emptyPath).close();
+    QVERIFY(parser.parseFile(emptyPath).roots.empty());
+}
+
+void QmlParserTest::parse_file_reports_missing_path() {
+    QmlParser parser;
+    bool threw = false;
+    try {
+        parser.parseFile("does/not/exist.qml");
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    QVERIFY(threw);
+}
+
+void QmlParserTest::flat_document_matches_tree() {
+    const std::string qml = R"(
+ApplicationWindow {
+    id: root
+    title: "Flat"
+    Column {
+        spacing: 2
+        Text { id: first; text: "One" }
+        Row {
+            Button { id: nested; text: "Two" }
+        }
+        Label { text: "Three" }
+    }
+    width: 320
+}
+)";
+
+    QmlParser parser;
+    const QmlFlatDocument flat = parser.parseStringFlat(qml);
+
+    QCOMPARE(flat.nodeCount(), static_cast<size_t>(6));
+    QCOMPARE(flat.roots().size(), static_cast<size_t>(1));
+    const uint32_t root = flat.roots()[0];
+    QCOMPARE(flat.type(root), std::string_view("ApplicationWindow"));
+    QCOMPARE(flat.id(root), std::string_view("root"));
+    QCOMPARE(flat.property(root, "width"), std::string_view("320"));
+    QCOMPARE(flat.property(root, "missing", "fallback"), std::string_view("fallback"));
+
+    const uint32_t column = flat.findChildByType(root, "Column");
+    QVERIFY(column != QmlFlatDocument::npos);
+    QCOMPARE(flat.children(column).size(), static_cast<size_t>(3));
+    QCOMPARE(flat.property(column, "spacing"), std::string_view("2"));
+
+    // Pre-order layout: the nested Button comes before the trailing Label.
+    const uint32_t nested = flat.findById("nested");
+    const uint32_t label = flat.findChildByType(column, "Label");
+    QVERIFY(nested != QmlFlatDocument::npos);
+    QVERIFY(label != QmlFlatDocument::npos);
+    QVERIFY(nested < label);
+    QCOMPARE(flat.property(nested, "text"), std::string_view("Two"));
+    QCOMPARE(flat.findChildByType(nested, "Text"), QmlFlatDocument::npos);
+    QCOMPARE(flat.node(root).subtreeEnd, static_cast<uint32_t>(flat.nodeCount()));
+}
+
+void QmlParserTest::interns_types_and_keys() {
+    const std::string qml = R"(
+Column {
+    CustomWidget { customKey: "a"; text: "b" }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument first = parser.parseString(qml);
+    const QmlDocument second = parser.parseString(qml);
+
+    const QmlNode &column = first.roots.front();
+    QCOMPARE(column.typeAtom, static_cast<QmlAtom>(QmlAtoms::Column));
+    // Predefined names resolve through the compile-time perfect hash.
+    static_assert(QmlAtoms::predefined("TextField") == QmlAtoms::TextField, "predefined atoms hash at compile time");
+    QCOMPARE(QmlAtoms::predefined("CustomWidget"), static_cast<QmlAtom>(QmlAtoms::Invalid));
+    for (QmlAtom atom = 1; atom < QmlAtoms::PredefinedCount; ++atom) {
+        QCOMPARE(QmlAtomTable::global().intern(QmlAtoms::kNames[atom]), atom);
+        QCOMPARE(QmlAtomTable::global().name(atom), QmlAtoms::kNames[atom]);
+    }
+
+    const QmlNode &custom = column.children.front();
+    const QmlAtom customType = QmlAtomTable::global().find("CustomWidget");
+    QVERIFY(customType >= QmlAtoms::PredefinedCount);
+    QCOMPARE(custom.typeAtom, customType);
+    QCOMPARE(second.roots.front().children.front().typeAtom, customType);
+    QCOMPARE(QmlAtomTable::global().name(customType), std::string_view("CustomWidget"));
+
+    QCOMPARE(custom.properties.size(), static_cast<size_t>(2));
+    QCOMPARE(custom.properties[1].key, static_cast<QmlAtom>(QmlAtoms::text));
+    QCOMPARE(custom.property(QmlAtomTable::global().find("customKey")), std::string("a"));
+    QCOMPARE(custom.property("customKey"), std::string("a"));
+    QCOMPARE(custom.property("neverInterned", "x"), std::string("x"));
+    QCOMPARE(column.findChildByType("CustomWidget"), &custom);
+}
+
+void QmlParserTest::indexes_ids_and_types() {
+    const std::string qml = R"(
+ApplicationWindow {
+    id: root
+    Column {
+        Text { id: first; text: "One" }
+        Row {
+            Text { id: second; text: "Two" }
+        }
+        Text { id: first; text: "Duplicate" }
+    }
+}
+)";
+
+    QmlParser parser;
+    QmlDocument doc = parser.parseString(qml);
+    QVERIFY(doc.isIndexed());
+
+    const QmlNode *first = doc.findById("first");
+    QVERIFY(first);
+    QCOMPARE(first->property("text"), std::string("One"));  // first match wins
+    QCOMPARE(doc.findById("missing"), static_cast<const QmlNode *>(nullptr));
+
+    const auto texts = doc.nodesOfType(QmlAtoms::Text);
+    QCOMPARE(texts.size(), static_cast<size_t>(3));
+    QCOMPARE(texts[1]->id, std::string("second"));
+    QCOMPARE(doc.firstRootOfType(QmlAtoms::Text), first);
+
+    // Copies share the nodes, and so the index, until one is written.
+    const QmlDocument copy = doc;
+    QVERIFY(copy.findById("second"));
+    QCOMPARE(copy.findById("second"), doc.findById("second"));
+    QCOMPARE(copy.findById("second")->property("text"), std::string("Two"));
+
+    // Direct edits are picked up by reindex().
+    QmlNode extra;
+    extra.setType("Button");
+    extra.setProperty(QmlAtoms::id, "late");
+    doc.roots.push_back(extra);
+    doc.reindex();
+    QVERIFY(doc.findById("late"));
+    QCOMPARE(doc.firstRootOfType(QmlAtoms::Button), doc.findById("late"));
+}
+
+void QmlParserTest::streams_events_without_tree() {
+    const std::string qml = R"(
+ApplicationWindow {
+    title: "Events"
+    Column {
+        Text { id: a; text: "A" }
+        Button { text: "B" }
+    }
+)";
+
+    QmlParser parser;
+    RecordingHandler all;
+    QVERIFY(parser.parseEvents(qml, all));
+    const std::vector<std::string> expected = {
+        "begin ApplicationWindow", "title=Events", "begin Column", "begin Text", "id=a", "text=A", "end",
+        "begin Button", "text=B", "end", "end", "end",  // unterminated objects are closed at end of input
+    };
+    QCOMPARE(all.events, expected);
+
+    RecordingHandler stopping;
+    stopping.stopAtType = "Text";
+    QVERIFY(!parser.parseEvents(qml, stopping));
+    QCOMPARE(stopping.events.back(), std::string("begin Text"));
+    QCOMPARE(stopping.events.size(), static_cast<size_t>(4));
+}
+
+void QmlParserTest::feeds_input_in_chunks() {
+    const std::string qml = R"(import QtQuick 2.15
+ApplicationWindow {
+    title: "Braces { } and ; in a string"
+    function greet(name) {
+        if (name) {
+            return "hi " + name
+        }
+        return ""
+    }
+    Column {
+        Text { id: a; text: "A" }
+        Button {
+            text: "B"
+            onClicked: {
+                a.text = "{"
+            }
+        }
+    }
+    width: ready
+           ? 200
+           : 100
+    Text { id: last; text: "no newline" })";
+
+    QmlParser parser;
+    const QmlDocument whole = parser.parseString(qml);
+    QCOMPARE(whole.roots[0].property("width"), std::string("ready\n           ? 200\n           : 100"));
+    RecordingHandler wholeEvents;
+    QVERIFY(parser.parseEvents(qml, wholeEvents));
+
+    for (size_t chunk : {size_t(1), size_t(3), size_t(7), size_t(64), qml.size()}) {
+        QmlFeedParser tree;
+        RecordingHandler handler;
+        QmlFeedParser events(handler);
+        for (size_t offset = 0; offset < qml.size(); offset += chunk) {
+            const std::string_view bytes = std::string_view(qml).substr(offset, chunk);
+            QVERIFY(tree.feed(bytes));
+            QVERIFY(events.feed(bytes));
+        }
+        QVERIFY(tree.finish());
+        QVERIFY(events.finish());
+        QVERIFY(sameDocument(tree.document(), whole));
+        QVERIFY(tree.document().findById("last"));
+        QCOMPARE(handler.events, wholeEvents.events);
+    }
+
+    // Objects appear as soon as their lines arrive.
+    QmlFeedParser growing;
+    QVERIFY(growing.feed("Column {\n    Text { id: early }\n    Te"));
+    QCOMPARE(growing.document().roots.front().children.size(), static_cast<size_t>(1));
+    QVERIFY(growing.feed("xt { id: later }\n}\n"));
+    QVERIFY(growing.finish());
+    QVERIFY(growing.document().findById("later"));
+
+    RecordingHandler stopping;
+    stopping.stopAtType = "Text";
+    QmlFeedParser stopped(stopping);
+    QVERIFY(!stopped.feed(qml));
+    QVERIFY(!stopped.feed("Item {}\n"));
+    QVERIFY(!stopped.finish());
+}
+
+void QmlParserTest::parses_files_in_parallel() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < 8; ++i) {
+        const std::string path = dir.filePath(QStringLiteral("File%1.qml").arg(i)).toStdString();
+        std::ofstream(path) << "Text {\n    id: file" << i << "\n}\n";
+        paths.push_back(path);
+    }
+    paths.insert(paths.begin() + 3, dir.filePath(QStringLiteral("Missing.qml")).toStdString());
+
+    QmlParser parser;
+    const auto results = parser.parseFiles(paths, 4);
+
+    QCOMPARE(results.size(), paths.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        QCOMPARE(results[i].path, paths[i]);
+    }
+    QVERIFY(!results[3].ok());
+    QVERIFY(results[3].document.roots.empty());
+    QVERIFY(results[0].ok());
+    QVERIFY(results[0].document.findById("file0"));
+    QVERIFY(results[8].document.findById("file7"));
+}
+
+void QmlParserTest::parses_one_input_in_parallel() {
+    using Shape = QmlCorpusOptions::Shape;
+    QmlParser parser;
+    for (const Shape shape : {Shape::Mixed, Shape::DeepNesting, Shape::WideColumn, Shape::LongLines, Shape::ManyIds}) {
+        QmlCorpusOptions options;
+        options.shape = shape;
+        options.bytes = 512 * 1024;
+        const std::string source = QmlCorpus::generate(options);
+        QVERIFY(sameDocument(parser.parseStringParallel(source, 4), parser.parseString(source)));
+    }
+
+    // A property of the Column between its children leaves a chunk with
+    // something other than whole objects, so the parse falls back to one
+    // thread and still keeps it.
+    QmlCorpusOptions options;
+    options.shape = Shape::WideColumn;
+    options.bytes = 512 * 1024;
+    std::string source = QmlCorpus::generate(options);
+    source.insert(source.find('\n', source.size() / 2) + 1, "        spacing: 4\n");
+    const QmlDocument parallel = parser.parseStringParallel(source, 4);
+    QVERIFY(sameDocument(parallel, parser.parseString(source)));
+    QCOMPARE(parallel.roots.front().children.front().property("spacing"), std::string("4"));
+
+    // Too small to split.
+    const std::string small = "Column {\n    Text { id: a }\n    Text { id: b }\n}\n";
+    QVERIFY(sameDocument(parser.parseStringParallel(small, 4), parser.parseString(small)));
+    QVERIFY(parser.parseStringParallel(small, 4).findById("b"));
+}
+
+void QmlParserTest::recovers_from_malformed_input_with_diagnostics() {
+    const std::string qml = R"(import QtQuick 2.15
+stray: 1
+Rectangle {
+    id: root
+    property int count
+    width 80
+    x: 1; : 3
+    {
+        Text { id: lost }
+    }
+    Text { id: kept; text: "ok" }
+    onClicked: {
+        run()
+)";
+
+    QmlParser parser;
+    const QmlParseResult result = parser.parseStringChecked(qml);
+    QVERIFY(result.ok());
+    QVERIFY(!result.clean());
+    QVERIFY(result.document.findById("root"));
+    QVERIFY(!result.document.findById("lost"));
+    QCOMPARE(result.document.findById("kept")->property("text"), std::string("ok"));
+
+    const std::vector<std::pair<size_t, size_t>> positions = {{2, 1}, {3, 1}, {6, 5}, {7, 11}, {8, 5}, {12, 16}};
+    QCOMPARE(result.diagnostics.size(), positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        QCOMPARE(std::make_pair(result.diagnostics[i].line, result.diagnostics[i].column), positions[i]);
+    }
+    QCOMPARE(result.diagnostics[0].message, std::string("property outside any object"));
+    QCOMPARE(result.diagnostics[1].message, std::string("'Rectangle' is never closed"));
+    QCOMPARE(result.diagnostics[5].message, std::string("script body is never closed"));
+
+    // Well-formed input parses as parseString() does, with nothing to report.
+    const QmlParseResult good = parser.parseStringChecked("Item {\n    Text { id: a }\n}\n");
+    QVERIFY(good.clean());
+    QVERIFY(good.document.findById("a"));
+
+    const QmlParseResult missing = parser.parseFileChecked("/nonexistent/Missing.qml");
+    QVERIFY(!missing.ok());
+    QCOMPARE(missing.path, std::string("/nonexistent/Missing.qml"));
+}
+
+void QmlParserTest::stops_at_parse_limits() {
+    const std::string qml = "Item {\n"
+                            "    Row {\n"
+                            "        Column {\n"
+                            "            Text { id: deep }\n"
+                            "        }\n"
+                            "    }\n"
+                            "    Text { id: after; text: \"a fairly long line of text\" }\n"
+                            "}\n";
+    QmlParseLimits limits;
+    limits.maxDepth = 3;
+    const QmlParseResult deep = QmlParser(limits).parseStringChecked(qml);
+    QVERIFY(!deep.ok());
+    QCOMPARE(deep.error, std::string("parse limit: objects nest over 3 deep"));
+    QCOMPARE(deep.diagnostics.size(), size_t(1));
+    QCOMPARE(deep.diagnostics[0].line, size_t(4));
+    QCOMPARE(deep.diagnostics[0].column, size_t(13));
+    // What was parsed before the limit stays, closed; nothing after it is read.
+    QVERIFY(deep.document.roots.front().findChildByType("Column"));
+    QVERIFY(!deep.document.findById("deep"));
+    QVERIFY(!deep.document.findById("after"));
+    QVERIFY(QmlParser(limits).parseStringChecked("Item {\n    Row { Column { } }\n}\n").clean());
+
+    const auto limitOffset = [&qml](const QmlParseLimits &bounds) -> size_t {
+        try {
+            QmlParser(bounds).parseString(qml);
+        } catch (const QmlParseLimitError &error) {
+            return error.offset();
+        }
+        return std::string::npos;
+    };
+    QmlParseLimits objects;
+    objects.maxObjects = 4;
+    QCOMPARE(limitOffset(objects), qml.find("Text { id: after"));
+    QmlParseLimits lines;
+    lines.maxLineLength = 40;
+    QCOMPARE(limitOffset(lines), qml.find("    Text { id: after"));
+    QmlParseLimits bytes;
+    bytes.maxBytes = qml.size() - 1;
+    QCOMPARE(limitOffset(bytes), qml.size() - 1);
+    QCOMPARE(limitOffset(QmlParseLimits()), std::string::npos);
+
+    // A feed is held to them before its lines end.
+    QmlFeedParser feed(nullptr, lines);
+    QVERIFY(feed.feed("Item {\n    text: \""));
+    bool threw = false;
+    try {
+        feed.feed(std::string(64, 'x'));
+    } catch (const QmlParseLimitError &) {
+        threw = true;
+    }
+    QVERIFY(threw);
+    QVERIFY(!feed.feed("\"\n}\n"));
+    QCOMPARE(feed.document().roots.size(), size_t(1));
+}
+
+void QmlParserTest::lexes_multiline_values_comments_and_inline_objects() {
+    const std::string qml = R"(Item {
+    width: Math.max(10,
+                    20) // widest
+    /* a { comment } */ height: 3
+    text: 'a;b'; title: "say \"hi\" }"
+    Column { Text { id: a } Text { id: b } }
+    items: [
+        1, 2
+    ]
+    sum: 1 +
+         2
+    total: (a // first
+            + b) // both
+    // x: 1
+}
+)";
+
+    QmlParser parser;
+    const QmlParseResult result = parser.parseStringChecked(qml);
+    QVERIFY(result.clean());
+    const QmlNode &item = result.document.roots[0];
+    QCOMPARE(item.property("width"), std::string("Math.max(10,\n                    20)"));
+    QCOMPARE(item.property("height"), std::string("3"));
+    QCOMPARE(item.property("text"), std::string("a;b"));
+    QCOMPARE(item.property("title"), std::string(R"(say \"hi\" })"));
+    QCOMPARE(item.property("items"), std::string("[\n        1, 2\n    ]"));
+    QCOMPARE(item.property("sum"), std::string("1 +\n         2"));
+    QCOMPARE(item.property("total"), std::string("(a // first\n            + b)"));
+    QCOMPARE(item.property("x", "none"), std::string("none"));
+
+    QCOMPARE(item.children.size(), size_t(1));
+    QCOMPARE(item.children[0].children.size(), size_t(2));
+    QCOMPARE(item.children[0].children[1].id, std::string("b"));
+}
+
+void QmlParserTest::lexes_leading_operators_and_regex_literals() {
+    const std::string qml = R"(Item {
+    implicitWidth: Math.max(a, b)
+                   + leftPadding
+    color: enabled
+           ? "red"
+           : "blue"
+    border.color: down ? "black" :
+                  "gray"
+    visible: a
+             && !b
+             || c
+    count: items
+        .length
+    pattern: /}[/]\/"/g
+    function strip(s) { return s.replace(/}/g, "") }
+    half: width / 2 / 1
+    exact: /x/
+    height: 3
+}
+)";
+
+    QmlParser parser;
+    const QmlParseResult result = parser.parseStringChecked(qml);
+    QVERIFY(result.clean());
+    const QmlNode &item = result.document.roots[0];
+    QCOMPARE(item.property("implicitWidth"), std::string("Math.max(a, b)\n                   + leftPadding"));
+    QCOMPARE(item.property("color"), std::string("enabled\n           ? \"red\"\n           : \"blue\""));
+    QCOMPARE(item.property("border.color"), std::string("down ? \"black\" :\n                  \"gray\""));
+    QCOMPARE(item.property("visible"), std::string("a\n             && !b\n             || c"));
+    QCOMPARE(item.property("count"), std::string("items\n        .length"));
+    QCOMPARE(item.property("pattern"), std::string(R"(/}[/]\/"/g)"));
+    QCOMPARE(item.scripts.size(), size_t(1));
+    QCOMPARE(item.scripts[0].body(qml), std::string_view(R"({ return s.replace(/}/g, "") })"));
+    QCOMPARE(item.property("half"), std::string("width / 2 / 1"));
+    QCOMPARE(item.property("exact"), std::string("/x/"));
+    QCOMPARE(item.property("height"), std::string("3"));
+    QVERIFY(item.children.empty());
+}
+
+void QmlParserTest::parses_block_and_object_bindings() {
+    const std::string qml = R"(Button {
+    width: { if (wide) return 200; return 100 }
+    color: {
+        if (down)
+            return "dark"
+        return "light"
+    }
+    background: Rectangle { radius: 4 }
+    contentItem: Text {
+        text: "Go"
+    }
+    Component.onCompleted: {
+        print("ready")
+    }
+    Item { id: plain }
+}
+)";
+
+    QmlParser parser;
+    const QmlParseResult result = parser.parseStringChecked(qml);
+    QVERIFY(result.clean());
+    const QmlNode &button = result.document.roots[0];
+    QCOMPARE(button.property("width"), std::string("{ if (wide) return 200; return 100 }"));
+    QCOMPARE(button.findProperty(QmlAtoms::width)->typed.kind, QmlValueKind::Binding);
+    QCOMPARE(button.property("color"),
+             std::string("{\n        if (down)\n            return \"dark\"\n        return \"light\"\n    }"));
+    QCOMPARE(button.scripts.size(), size_t(1));
+    QCOMPARE(QmlAtomTable::global().name(button.scripts[0].name), std::string_view("Component.onCompleted"));
+
+    const QmlAtomTable &atoms = QmlAtomTable::global();
+    QCOMPARE(button.children.size(), size_t(3));
+    QCOMPARE(button.children[0].type, std::string("Rectangle"));
+    QCOMPARE(atoms.name(button.children[0].binding), std::string_view("background"));
+    QCOMPARE(button.children[0].property("radius"), std::string("4"));
+    QCOMPARE(button.children[1].type, std::string("Text"));
+    QCOMPARE(atoms.name(button.children[1].binding), std::string_view("contentItem"));
+    QCOMPARE(button.children[2].binding, QmlAtoms::Invalid);
+
+    // Events name the property before the object, and the writer and the
+    // cache keep it.
+    RecordingHandler handler;
+    QVERIFY(parser.parseEvents(qml, handler));
+    const auto bind = std::find(handler.events.begin(), handler.events.end(), "bind background");
+    QVERIFY(bind != handler.events.end() && *(bind + 1) == "begin Rectangle");
+    const std::string written = QmlWriter::toString(result.document, qml);
+    QVERIFY2(written.find("    background: Rectangle {\n") != std::string::npos, written.c_str());
+    QCOMPARE(parser.parseString(written).roots[0].children[1].binding, button.children[1].binding);
+    const uint64_t hash = QmlAstCache::contentHash(qml);
+    QmlDocument restored;
+    QVERIFY(QmlAstCache::deserialize(QmlAstCache::serialize(result.document, hash, qml.size()), hash, qml.size(),
+                                     restored));
+    QVERIFY(sameTree(restored.roots[0], button));
+}
+
+void QmlParserTest::ast_cache_round_trips_and_rejects_stale_entries() {
+    const std::string qml = R"(
+ApplicationWindow {
+    id: root
+    title: "Cached"
+    Column {
+        spacing: 3
+        Text { id: label; text: "Hello" }
+        Button { text: "Go" }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument original = parser.parseString(qml);
+    const uint64_t hash = QmlAstCache::contentHash(qml);
+    const std::string bytes = QmlAstCache::serialize(original, hash, qml.size());
+
+    QmlDocument restored;
+    QVERIFY(QmlAstCache::deserialize(bytes, hash, qml.size(), restored));
+    QVERIFY(restored.isIndexed());
+    QCOMPARE(restored.roots.size(), static_cast<size_t>(1));
+    QCOMPARE(restored.findById("root")->property(QmlAtoms::title), std::string("Cached"));
+    QCOMPARE(restored.findById("label")->property(QmlAtoms::text), std::string("Hello"));
+    const QmlNode *column = restored.firstRootOfType(QmlAtoms::Column);
+    QVERIFY(column);
+    QCOMPARE(column->children.size(), static_cast<size_t>(2));
+    QCOMPARE(column->children[1].type, std::string("Button"));
+
+    QmlDocument rejected;
+    QVERIFY(!QmlAstCache::deserialize(bytes, hash + 1, qml.size(), rejected));
+    QVERIFY(!QmlAstCache::deserialize(bytes.substr(0, bytes.size() - 1), hash, qml.size(), rejected));
+    std::string corrupt = bytes;
+    corrupt[corrupt.size() - 2] ^= 0x5a;
+    QVERIFY(!QmlAstCache::deserialize(corrupt, hash, qml.size(), rejected));
+    QVERIFY(rejected.roots.empty());
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string path = dir.filePath(QStringLiteral("Cached.qml")).toStdString();
+    std::ofstream(path, std::ios::binary) << qml;
+    const QmlAstCache cache(dir.filePath(QStringLiteral("cache")).toStdString());
+
+    bool hit = true;
+    QVERIFY(cache.loadFile(path, &hit).findById("label"));
+    QVERIFY(!hit);
+    QVERIFY(cache.loadFile(path, &hit).findById("label"));
+    QVERIFY(hit);
+
+    std::ofstream(path, std::ios::binary) << "Text { id: edited }\n";
+    QVERIFY(cache.loadFile(path, &hit).findById("edited"));
+    QVERIFY(!hit);
+}
+
+void QmlParserTest::maps_shared_flat_cache_entries() {
+    const std::string qml = R"(
+Column {
+    id: root
+    SharedGauge { id: gauge; level: "7"; Text { text: "Inside" } }
+    Text { id: label; text: "Hello" }
+}
+Item {}
+)";
+
+    QmlParser parser;
+    const QmlFlatDocument flat = parser.parseStringFlat(qml);
+    const uint64_t hash = QmlAstCache::contentHash(qml);
+    const std::string bytes = QmlAstCache::serializeFlat(flat, hash, qml.size());
+
+    // The entry is used in place: the document points into bytes.
+    QmlFlatDocument mapped;
+    QVERIFY(QmlAstCache::mapFlat(bytes, hash, qml.size(), mapped));
+    QCOMPARE(mapped.nodeCount(), flat.nodeCount());
+    QCOMPARE(mapped.roots().size(), static_cast<size_t>(2));
+    const uint32_t gauge = mapped.findById("gauge");
+    QVERIFY(gauge != QmlFlatDocument::npos);
+    QVERIFY(mapped.id(gauge).data() >= bytes.data() && mapped.id(gauge).data() < bytes.data() + bytes.size());
+    QCOMPARE(mapped.type(gauge), std::string_view("SharedGauge"));
+    QCOMPARE(mapped.typeAtom(gauge), QmlAtomTable::global().find("SharedGauge"));
+    QCOMPARE(mapped.property(gauge, "level"), flat.property(flat.findById("gauge"), "level"));
+    QCOMPARE(mapped.findChildByType(mapped.roots()[0], "SharedGauge"), gauge);
+    QCOMPARE(mapped.property(mapped.findChildByType(gauge, QmlAtoms::Text), QmlAtoms::text),
+             std::string_view("Inside"));
+    QCOMPARE(mapped.firstRootOfType(QmlAtoms::Item), flat.firstRootOfType(QmlAtoms::Item));
+
+    QmlFlatDocument rejected;
+    QVERIFY(!QmlAstCache::mapFlat(bytes, hash + 1, qml.size(), rejected));
+    QVERIFY(!QmlAstCache::mapFlat(bytes.substr(0, bytes.size() - 1), hash, qml.size(), rejected));
+    std::string corrupt = bytes;
+    corrupt[corrupt.size() - 2] ^= 0x5a;
+    QVERIFY(!QmlAstCache::mapFlat(corrupt, hash, qml.size(), rejected));
+    QCOMPARE(rejected.nodeCount(), static_cast<size_t>(0));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string path = dir.filePath(QStringLiteral("Shared.qml")).toStdString();
+    std::ofstream(path, std::ios::binary) << qml;
+    const QmlAstCache cache(dir.filePath(QStringLiteral("cache")).toStdString());
+
+    bool hit = true;
+    QCOMPARE(cache.loadFlatFile(path, &hit).findById("label"), flat.findById("label"));
+    QVERIFY(!hit);
+    QCOMPARE(cache.loadFlatFile(path, &hit).findById("label"), flat.findById("label"));
+    QVERIFY(hit);
+}
+
+void QmlParserTest::loads_projects_from_a_bundle() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkpath(QStringLiteral("qml/widgets")));
+    const auto write = [&dir](const QString &name, const std::string &text) {
+        std::ofstream(dir.filePath(QStringLiteral("qml/") + name).toStdString(), std::ios::binary) << text;
+    };
+    const std::string screen = "import \"widgets\" as W\nColumn {\n    Card { id: card }\n    W.Badge {}\n}\n";
+    write(QStringLiteral("Screen.qml"), screen);
+    write(QStringLiteral("Card.qml"), "Text {\n    text: \"Card\"\n}\n");
+    write(QStringLiteral("widgets/Badge.qml"), "Text {\n    text: \"New\"\n}\n");
+    write(QStringLiteral("notes.txt"), "not QML");
+    const std::string path = dir.filePath(QStringLiteral("app.qmlb")).toStdString();
+    QmlBundle::write(dir.filePath(QStringLiteral("qml")).toStdString(), path);
+    // Nothing is read from the loose files from here on.
+    QVERIFY(QDir(dir.filePath(QStringLiteral("qml"))).removeRecursively());
+
+    QmlBundle bundle;
+    QVERIFY(bundle.open(path));
+    QCOMPARE(bundle.memberCount(), size_t(3));
+    QmlBundle::Member member;
+    QVERIFY(bundle.find("Screen.qml", member));
+    QCOMPARE(member.source, std::string_view(screen));
+    QCOMPARE(reinterpret_cast<uintptr_t>(member.source.data()) % QmlBundle::kPageSize, uintptr_t(0));
+    QVERIFY(bundle.find("widgets/Badge.qml", member));
+    QVERIFY(!bundle.find("notes.txt", member));
+    QVERIFY(!bundle.find("Missing.qml", member));
+
+    // Members read like files in a directory at the bundle's path, so the
+    // project index finds components beside the screen inside it.
+    const std::string screenPath = bundle.mountPoint() + "/Screen.qml";
+    bool precompiled = false;
+    const QmlDocument document = bundle.load(screenPath, &precompiled);
+    QVERIFY(precompiled);
+    QVERIFY(document.findById("card"));
+    bundle.install();
+    QVERIFY(MappedFile::exists(bundle.mountPoint() + "/./widgets/Badge.qml"));
+    QVERIFY(!MappedFile::exists(bundle.mountPoint() + "/Missing.qml"));
+    QCOMPARE(QmlParser().parseFile(bundle.mountPoint() + "/Card.qml").roots[0].property("text"),
+             std::string("Card"));
+    QmlProjectIndex project;
+    const QmlDocument expanded = project.expand(document, screen, screenPath);
+    QCOMPARE(expanded.findById("card")->property("text"), std::string("Card"));
+    QCOMPARE(expanded.roots[0].children[1].property("text"), std::string("New"));
+
+    // A damaged index is refused as a whole.
+    std::string bytes;
+    {
+        MappedFile file;
+        QVERIFY(file.open(path));
+        bytes.assign(file.view());
+    }
+    bytes[40] ^= 0x5a;
+    const std::string damaged = dir.filePath(QStringLiteral("damaged.qmlb")).toStdString();
+    std::ofstream(damaged, std::ios::binary) << bytes;
+    QmlBundle refused;
+    QVERIFY(!refused.open(damaged));
+    QVERIFY(!refused.isOpen());
+    QVERIFY(!refused.open(dir.filePath(QStringLiteral("missing.qmlb")).toStdString()));
+}
+
+void QmlParserTest::ignores_structurals_inside_strings() {
+    const std::string qml = R"(
+Column {
+    Text { id: braces; text: "a; b {c}" }
+    Label { text: "say \"x: y;\" }"; id: escaped }
+    Button {
+        text: "Run: {now}"
+    }
+}
+)";
+
+    QmlParser parser;
+    QmlDocument doc = parser.parseString(qml);
+
+    const QmlNode *column = doc.firstRootOfType("Column");
+    QVERIFY(column);
+    QCOMPARE(column->children.size(), static_cast<size_t>(3));
+    QCOMPARE(doc.findById("braces")->property("text"), std::string("a; b {c}"));
+    QCOMPARE(doc.findById("escaped")->property("text"), std::string(R"(say \"x: y;\" })"));
+    QCOMPARE(column->children[2].property("text"), std::string("Run: {now}"));
+}
+
+void QmlParserTest::scans_lines_across_windows() {
+    std::string qml = "Column {\n";
+    const int items = 2000;
+    for (int i = 0; i < items; ++i) {
+        qml += "    Text { id: t" + std::to_string(i) + "; text: \"{" + std::to_string(i) + "}\" }\n";
+    }
+    qml += "}";
+
+    QmlStructuralScanner scanner(qml);
+    QmlScannedLine line;
+    size_t lines = 0;
+    size_t structurals = 0;
+    while (scanner.nextLine(line)) {
+        QCOMPARE(line.text, std::string_view(qml).substr(line.offset, line.text.size()));
+        for (const size_t *it = line.structuralsBegin; it != line.structuralsEnd; ++it) {
+            QVERIFY(*it >= line.offset && *it < line.offset + line.text.size());
+        }
+        structurals += static_cast<size_t>(line.structuralsEnd - line.structuralsBegin);
+        ++lines;
+    }
+    QCOMPARE(lines, static_cast<size_t>(items + 2));
+    QCOMPARE(structurals, static_cast<size_t>(2 + items * 5));
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QCOMPARE(doc.roots.front().children.size(), static_cast<size_t>(items));
+    QCOMPARE(doc.findById("t1999")->property("text"), std::string("{1999}"));
+}
+
+void QmlParserTest::classifies_property_values() {
+    const std::string qml = R"(
+Text {
+    text: "42"
+    width: 400
+    height: -2.5
+    visible: true
+    wrapMode: Text.Wrap
+    font.pixelSize: greeter.size
+    opacity: .5e1
+    x: 99999999999
+    y: nan
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    const QmlNode &text = doc.roots.front();
+
+    const auto kindOf = [&text](const std::string &key) {
+        return text.findProperty(QmlAtomTable::global().find(key))->typed.kind;
+    };
+    QCOMPARE(kindOf("text"), QmlValueKind::String);
+    QCOMPARE(kindOf("width"), QmlValueKind::Int);
+    QCOMPARE(kindOf("height"), QmlValueKind::Real);
+    QCOMPARE(kindOf("visible"), QmlValueKind::Bool);
+    QCOMPARE(kindOf("wrapMode"), QmlValueKind::Enum);
+    QCOMPARE(kindOf("font.pixelSize"), QmlValueKind::Binding);
+    QCOMPARE(kindOf("opacity"), QmlValueKind::Real);
+    QCOMPARE(kindOf("y"), QmlValueKind::Binding);
+
+    QCOMPARE(text.intProperty(QmlAtoms::text, -1), -1);
+    QCOMPARE(text.intProperty(QmlAtoms::width, -1), 400);
+    QCOMPARE(text.realProperty(QmlAtoms::width), 400.0);
+    QCOMPARE(text.realProperty(QmlAtoms::height), -2.5);
+    QCOMPARE(text.intProperty(QmlAtoms::height, -1), -1);
+    QCOMPARE(text.boolProperty(QmlAtoms::visible), true);
+    QCOMPARE(text.intProperty(QmlAtomTable::global().find("x"), -1), -1);  // out of int range
+    QCOMPARE(text.property(QmlAtoms::text), std::string("42"));
+
+    QmlDocument restored;
+    const uint64_t hash = QmlAstCache::contentHash(qml);
+    QVERIFY(QmlAstCache::deserialize(QmlAstCache::serialize(doc, hash, qml.size()), hash, qml.size(), restored));
+    QCOMPARE(restored.roots.front().findProperty(QmlAtoms::text)->typed.kind, QmlValueKind::String);
+    QCOMPARE(restored.roots.front().intProperty(QmlAtoms::width, -1), 400);
+    QCOMPARE(restored.roots.front().realProperty(QmlAtoms::height), -2.5);
+}
+
+void QmlParserTest::reparses_edited_ranges() {
+    const std::string qml = R"(ApplicationWindow {
+    id: root
+    background: Rectangle {
+        color: "red"
+    }
+    Column {
+        spacing: 2
+        Text { id: first; text: "One" }
+        Button {
+            id: go
+            text: "Go"
+            z: 1; Text { text: "hi" }
+            Text { text: "end" }; opacity: 0.5
+        }
+    }
+    Label { text: "Tail" }
+}
+)";
+
+    struct Case {
+        std::string find;
+        size_t removed;
+        std::string inserted;
+    };
+    const Case cases[] = {
+        {"\"Go\"", 4, "\"Stop\""},                            // inside one object
+        {"\"One\"", 5, "\"Uno\"; width: 3"},                  // inline object
+        {"            text: \"Go\"\n", 0, "            Row { id: added }\n"},  // new child
+        {"        Button {", 0, "        }\n"},                    // closes the parent early
+        {"Label", 0, "Rectangle {\n"},                            // unbalanced opening
+        {"ApplicationWindow {", 0, "\n"},                          // outside every object
+        {"spacing: 2\n", 11, ""},                                 // removal
+        {"\"red\"", 5, "\"blue\""},                               // object-valued property
+        {"background", 10, "header"},                              // renamed binding
+        {"\"hi\"", 4, "\"ho\""},                                   // parent's statement before it
+        {"\"end\"", 5, "\"last\""},                                // parent's statement after it
+    };
+
+    QmlParser parser;
+    for (const Case &edit : cases) {
+        const size_t offset = qml.find(edit.find);
+        QVERIFY(offset != std::string::npos);
+        std::string edited = qml;
+        edited.replace(offset, edit.removed, edit.inserted);
+
+        const QmlDocument incremental =
+            parser.reparse(parser.parseString(qml), qml, QmlTextEdit{offset, edit.removed, edit.inserted});
+        const QmlDocument full = parser.parseString(edited);
+        QVERIFY(sameDocument(incremental, full));
+        QVERIFY(incremental.isIndexed());
+        QCOMPARE(incremental.findById("root") != nullptr, full.findById("root") != nullptr);
+    }
+
+    const QmlDocument edited = parser.reparse(parser.parseString(qml), qml, QmlTextEdit{qml.find("\"Go\""), 4, "\"Stop\""});
+    QCOMPARE(edited.findById("go")->property(QmlAtoms::text), std::string("Stop"));
+    const QmlDocument recolored =
+        parser.reparse(parser.parseString(qml), qml, QmlTextEdit{qml.find("\"red\""), 5, "\"blue\""});
+    QCOMPARE(QmlAtomTable::global().name(recolored.roots[0].children[0].binding), std::string_view("background"));
+
+    bool threw = false;
+    try {
+        parser.reparse(QmlDocument(), qml, QmlTextEdit{qml.size(), 1, ""});
+    } catch (const std::out_of_range &) {
+        threw = true;
+    }
+    QVERIFY(threw);
+}
+
+void QmlParserTest::skips_script_bodies() {
+    const std::string qml = R"(ApplicationWindow {
+    id: root
+    function greet(name, punctuation) {
+        if (name === "") {
+            return "Hello";
+        }
+        return "Hello " + name + punctuation;
+    }
+    Column {
+        Button {
+            id: go
+            onClicked: outputLabel.text = greeter.greet(nameField.text)
+            onPressed: {
+                var braces = "}";
+                counter.value += 1;
+            }
+            text: "Go"
+        }
+        Button { onClicked: { first(); second() }; text: "Inline" }
+    }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    const QmlAtom onClicked = QmlAtomTable::global().intern("onClicked");
+    const QmlAtom onPressed = QmlAtomTable::global().intern("onPressed");
+
+    const QmlNode *root = doc.findById("root");
+    QVERIFY(root);
+    QCOMPARE(root->children.size(), static_cast<size_t>(1));
+    QCOMPARE(root->scripts.size(), static_cast<size_t>(1));
+    const QmlScriptBlock &greet = root->scripts.front();
+    QCOMPARE(greet.kind, QmlScriptKind::Function);
+    QCOMPARE(QmlAtomTable::global().name(greet.name), std::string_view("greet"));
+    QCOMPARE(greet.parameters, std::string("name, punctuation"));
+    QVERIFY(greet.body(qml).rfind("{\n        if (name", 0) == 0);
+    QCOMPARE(greet.body(qml).back(), '}');
+
+    const QmlNode *go = doc.findById("go");
+    QVERIFY(go);
+    QCOMPARE(go->property(QmlAtoms::text), std::string("Go"));
+    QVERIFY(!go->findProperty(onClicked));
+    QCOMPARE(go->findScript(onClicked)->body(qml), std::string_view("outputLabel.text = greeter.greet(nameField.text)"));
+    const std::string_view pressed = go->findScript(onPressed)->body(qml);
+    QVERIFY(pressed.rfind("{\n                var braces", 0) == 0);
+    QCOMPARE(pressed.back(), '}');
+
+    const QmlNode &inlineButton = doc.roots.front().children.front().children[1];
+    QCOMPARE(inlineButton.property(QmlAtoms::text), std::string("Inline"));
+    QCOMPARE(inlineButton.findScript(onClicked)->body(qml), std::string_view("{ first(); second() }"));
+
+    RecordingHandler handler;
+    QVERIFY(parser.parseEvents(qml, handler));
+    QCOMPARE(std::count(handler.events.begin(), handler.events.end(), std::string("begin Button")), 2);
+    QCOMPARE(std::count(handler.events.begin(), handler.events.end(), std::string("end")), 4);
+
+    QmlDocument restored;
+    const uint64_t hash = QmlAstCache::contentHash(qml);
+    QVERIFY(QmlAstCache::deserialize(QmlAstCache::serialize(doc, hash, qml.size()), hash, qml.size(), restored));
+    QVERIFY(sameDocument(restored, doc));
+    QCOMPARE(restored.findById("root")->scripts.front().parameters, std::string("name, punctuation"));
+
+    const size_t offset = qml.find("counter.value");
+    const QmlDocument edited = parser.reparse(parser.parseString(qml), qml, QmlTextEdit{offset, 0, "}\n"});
+    std::string editedSource = qml;
+    editedSource.insert(offset, "}\n");
+    QVERIFY(sameDocument(edited, parser.parseString(editedSource)));
+}
+
+void QmlParserTest::diffs_documents() {
+    const std::string before = R"(
+Column {
+    spacing: 2
+    Text { id: title; text: "Title" }
+    Label { text: "First" }
+    Label { text: "Second" }
+    Button { id: go; text: "Go" }
+}
+)";
+    const std::string after = R"(
+Column {
+    spacing: 4
+    Button { id: go; text: "Go" }
+    Text { id: title; text: "Title" }
+    Label { text: "First" }
+    TextField { placeholderText: "name" }
+    Label { text: "Second"; visible: false }
+}
+)";
+
+    QmlParser parser;
+    const QmlDocument oldDoc = parser.parseString(before);
+    const QmlDocument newDoc = parser.parseString(after);
+    QVERIFY(QmlDocumentDiff::compute(oldDoc, oldDoc).empty());
+
+    const QmlDocumentDiff diff = QmlDocumentDiff::compute(oldDoc, newDoc);
+    QCOMPARE(diff.changes.size(), static_cast<size_t>(4));
+
+    const QmlChange &spacing = diff.changes[0];
+    QCOMPARE(spacing.kind, QmlChange::Kind::PropertyChanged);
+    QCOMPARE(spacing.property, static_cast<QmlAtom>(QmlAtoms::spacing));
+    QCOMPARE(spacing.oldNode, &oldDoc.roots.front());
+    QCOMPARE(spacing.newNode, &newDoc.roots.front());
+
+    // Reordered ids and same-type siblings still match; the one that left
+    // the others' order is reported as moved.
+    const QmlChange &moved = diff.changes[1];
+    QCOMPARE(moved.kind, QmlChange::Kind::Moved);
+    QCOMPARE(moved.oldNode, &oldDoc.roots.front().children[3]);
+    QCOMPARE(moved.newNode, &newDoc.roots.front().children[0]);
+    QCOMPARE(moved.newParent, &newDoc.roots.front());
+
+    const QmlChange &inserted = diff.changes[2];
+    QCOMPARE(inserted.kind, QmlChange::Kind::Inserted);
+    QCOMPARE(inserted.newNode->typeAtom, static_cast<QmlAtom>(QmlAtoms::TextField));
+    QCOMPARE(inserted.newParent, &newDoc.roots.front());
+
+    const QmlChange &visible = diff.changes[3];
+    QCOMPARE(visible.kind, QmlChange::Kind::PropertyChanged);
+    QCOMPARE(visible.property, static_cast<QmlAtom>(QmlAtoms::visible));
+    QCOMPARE(visible.newNode->property(QmlAtoms::text), std::string("Second"));
+
+    const QmlDocumentDiff reverse = QmlDocumentDiff::compute(newDoc, oldDoc);
+    QCOMPARE(reverse.changes.size(), static_cast<size_t>(4));
+    QCOMPARE(reverse.changes[1].kind, QmlChange::Kind::Removed);
+    QCOMPARE(reverse.changes[1].oldNode->typeAtom, static_cast<QmlAtom>(QmlAtoms::TextField));
+    QCOMPARE(reverse.changes[3].kind, QmlChange::Kind::Moved);
+    QCOMPARE(reverse.changes[3].newNode->id, std::string("go"));
+
+    // A pure reorder is a change too, even with nothing else edited.
+    const QmlDocument ordered = parser.parseString("Column {\n    Text {}\n    Button {}\n}\n");
+    const QmlDocument swapped = parser.parseString("Column {\n    Button {}\n    Text {}\n}\n");
+    const QmlDocumentDiff reordered = QmlDocumentDiff::compute(ordered, swapped);
+    QCOMPARE(reordered.changes.size(), static_cast<size_t>(1));
+    QCOMPARE(reordered.changes[0].kind, QmlChange::Kind::Moved);
+    QCOMPARE(reordered.changes[0].oldNode, &ordered.roots.front().children[1]);
+    QCOMPARE(reordered.changes[0].newNode, &swapped.roots.front().children[0]);
+
+    const QmlDocument retyped = parser.parseString("Column {\n    Label { id: title }\n}\n");
+    const QmlDocumentDiff replaced = QmlDocumentDiff::compute(oldDoc, retyped);
+    QVERIFY(std::any_of(replaced.changes.begin(), replaced.changes.end(), [](const QmlChange &change) {
+        return change.kind == QmlChange::Kind::Inserted && change.newNode->id == "title";
+    }));
+}
+
+void QmlParserTest::evaluates_compiled_expressions() {
+    QmlExpressionProgram program;
+    QmlExpressionVm vm;
+    GreeterHost host;
+    std::string value;
+
+    const uint32_t message = program.compile("greeter.message");
+    QVERIFY(message != QmlExpressionProgram::kInvalid);
+    QVERIFY(vm.evaluate(program, message, host, value));
+    QCOMPARE(value, std::string("Hi"));
+
+    const uint32_t call = program.compile(R"(greeter.greet("Ada" + ', ' + 'Bo\'b') + " " + (greeter.message + 1))");
+    QVERIFY(call != QmlExpressionProgram::kInvalid);
+    QVERIFY(vm.evaluate(program, call, host, value));
+    QCOMPARE(value, std::string("Hello, Ada, Bo'b! Hi1"));
+
+    // The same text compiles once; evaluating it again reuses the code.
+    const size_t instructions = program.instructionCount();
+    QCOMPARE(program.compile("greeter.message"), message);
+    QCOMPARE(program.instructionCount(), instructions);
+    QVERIFY(vm.evaluate(program, message, host, value));
+    QCOMPARE(host.lookups, 4);
+
+    QCOMPARE(program.compile("greeter."), QmlExpressionProgram::kInvalid);
+    QCOMPARE(program.compile("greeter.greet(\"x\""), QmlExpressionProgram::kInvalid);
+    QCOMPARE(program.compile("'open"), QmlExpressionProgram::kInvalid);
+    QCOMPARE(program.instructionCount(), instructions);  // failed compiles leave no code
+    // Failures are remembered, so a binding offered every frame is not reparsed.
+    const std::string translated = R"(qsTr("Sign in to continue to your account"))";
+    QCOMPARE(program.compile(translated), QmlExpressionProgram::kInvalid);
+    {
+        const QmlAllocationScope scope;
+        QCOMPARE(program.compile(translated), QmlExpressionProgram::kInvalid);
+        QCOMPARE(scope.allocations(), 0LL);
+    }
+
+    const uint32_t missing = program.compile("window.title");
+    QVERIFY(!vm.evaluate(program, missing, host, value));
+    const uint32_t object = program.compile("greeter");
+    QVERIFY(!vm.evaluate(program, object, host, value));  // not a string
+    QCOMPARE(program.expressionCount(), size_t(4));
+}
+
+void QmlParserTest::propagates_binding_changes_in_order() {
+    const QmlDocument doc = QmlParser().parseString(R"(
+Item {
+    Label { id: both; text: upper.text + lower.text }
+    TextField { id: nameField; text: "Ada" }
+    Text { id: upper; text: "<" + nameField.text }
+    Text { id: lower; text: nameField.text + ">" }
+    Label { id: other; text: greeter.message }
+}
+)");
+
+    QmlExpressionProgram program;
+    QmlBindingGraph graph;
+    graph.build(doc, program);
+    QCOMPARE(graph.vertexCount(), size_t(4));
+
+    QmlAtomTable &atoms = QmlAtomTable::global();
+    const QmlAtom nameField = atoms.intern("nameField");
+    const QmlAtom greeter = atoms.intern("greeter");
+    const QmlAtom message = atoms.intern("message");
+    ValueTableHost host;
+    host.values[{nameField, QmlAtoms::text}] = "Ada";
+    host.values[{greeter, message}] = "Hi";
+
+    QmlExpressionVm vm;
+    std::vector<std::string> evaluated;
+    const auto reevaluate = [&](uint32_t index) {
+        const QmlBindingGraph::Vertex &vertex = graph.vertex(index);
+        evaluated.push_back(vertex.node->id);
+        std::string value;
+        vm.evaluate(program, vertex.expression, host, value);
+        std::string &current = host.values[{vertex.object, vertex.property}];
+        const bool changed = value != current;
+        current = value;
+        return changed;
+    };
+    for (const uint32_t index : graph.topologicalOrder()) {
+        reevaluate(index);
+    }
+    // "both" comes first in the document but after its inputs in the order.
+    QCOMPARE(evaluated.back(), std::string("both"));
+    QCOMPARE(host.values[std::make_pair(atoms.intern("both"), QmlAtom(QmlAtoms::text))], std::string("<AdaAda>"));
+
+    // Changes are batched, and the diamond's tip is evaluated once.
+    evaluated.clear();
+    host.values[{nameField, QmlAtoms::text}] = "Bo";
+    graph.changed(nameField, QmlAtoms::text);
+    graph.changed(nameField, QmlAtoms::text);
+    QCOMPARE(graph.propagate(reevaluate), size_t(3));
+    QCOMPARE(evaluated.size(), size_t(3));
+    QCOMPARE(evaluated.back(), std::string("both"));
+    QCOMPARE(host.values[std::make_pair(atoms.intern("both"), QmlAtom(QmlAtoms::text))], std::string("<BoBo>"));
+
+    // Outside sources reach only their readers.
+    evaluated.clear();
+    graph.changed(greeter, message);
+    QCOMPARE(graph.propagate(reevaluate), size_t(1));
+    QCOMPARE(evaluated, std::vector<std::string>{"other"});
+
+    // Readers of values that did not change are skipped.
+    evaluated.clear();
+    graph.changed(nameField, QmlAtoms::text);
+    QCOMPARE(graph.propagate(reevaluate), size_t(2));
+    QVERIFY(!graph.hasChanges());
+}
+
+void QmlParserTest::generates_parsable_corpora() {
+    using Shape = QmlCorpusOptions::Shape;
+    QmlParser parser;
+    for (const Shape shape : {Shape::Mixed, Shape::DeepNesting, Shape::WideColumn, Shape::LongLines, Shape::ManyIds}) {
+        QmlCorpusOptions options;
+        options.shape = shape;
+        options.bytes = 64 * 1024;
+        options.maxDepth = 64;
+        const std::string corpus = QmlCorpus::generate(options);
+        QVERIFY(corpus.size() >= options.bytes);
+        QCOMPARE(QmlCorpus::generate(options), corpus);
+
+        // Streaming produces the same bytes.
+        std::string streamed;
+        QmlCorpus::generate(options, [&streamed](std::string_view chunk) { streamed += chunk; });
+        QCOMPARE(streamed, corpus);
+
+        const QmlDocument doc = parser.parseString(corpus);
+        QCOMPARE(doc.roots.size(), size_t(1));
+        QVERIFY(doc.findById("corpus"));
+        QVERIFY(!doc.roots.front().findChildByType(std::string(QmlCorpus::kAbsentType)));
+
+        Shape parsed = Shape::Mixed;
+        QVERIFY(QmlCorpus::shapeFromName(QmlCorpus::shapeName(shape), parsed));
+        QCOMPARE(parsed, shape);
+    }
+
+    QmlCorpusOptions seeded;
+    seeded.seed = 2;
+    QVERIFY(QmlCorpus::generate(seeded) != QmlCorpus::generate(QmlCorpusOptions()));
+}
+
+// Main.qml currently takes 43 allocations; raise the budget only with a
+// reason.
+void QmlParserTest::parses_main_qml_within_allocation_budget() {
+    const QString path = QFINDTESTDATA("../qml/Main.qml");
+    QVERIFY(!path.isEmpty());
+    QmlParser parser;
+    const std::string file = path.toStdString();
+    parser.parseFile(file);  // interns the atoms a first parse adds
+
+    const QmlAllocationScope scope;
+    {
+        const QmlDocument doc = parser.parseFile(file);
+        QVERIFY(doc.findById("historyView"));
+    }
+    QVERIFY2(scope.allocations() <= 48, qPrintable(QString::number(scope.allocations())));
+}
+
+void QmlParserTest::parses_into_a_memory_resource() {
+    const QString path = QFINDTESTDATA("../qml/Main.qml");
+    QVERIFY(!path.isEmpty());
+    QmlParser parser;
+    const std::string file = path.toStdString();
+    parser.parseFile(file);
+
+    QmlAllocationScope scope;
+    { parser.parseFile(file); }
+    const long long onHeap = scope.allocations();
+
+    // Node lists, properties, scripts and the indices all come from the
+    // arena; what is left on the heap is file reading and long strings.
+    CountingResource counting(std::pmr::new_delete_resource());
+    std::pmr::monotonic_buffer_resource arena(&counting);
+    scope.reset();
+    {
+        const QmlDocument doc = parser.parseFile(file, &arena);
+        QCOMPARE(doc.resource(), static_cast<std::pmr::memory_resource *>(&arena));
+        QCOMPARE(doc.roots.resource(), static_cast<std::pmr::memory_resource *>(&arena));
+        QCOMPARE(doc.roots[0].children.resource(), static_cast<std::pmr::memory_resource *>(&arena));
+        QVERIFY(doc.findById("historyView"));
+
+        // A copy detaches onto the default resource, never the arena.
+        QmlDocument copy = doc;
+        QCOMPARE(copy.resource(), std::pmr::get_default_resource());
+        copy.roots[0].setProperty(QmlAtoms::width, "640");
+        QCOMPARE(copy.roots.resource(), std::pmr::get_default_resource());
+        QVERIFY(doc.roots[0].property(QmlAtoms::width) != "640");
+    }
+    const long long withArena = scope.allocations() - counting.allocations;
+    QVERIFY2(withArena < onHeap / 2, qPrintable(QString("%1 of %2").arg(withArena).arg(onHeap)));
+    QVERIFY(counting.allocations > 0);
+}
+
+// Reloading the same shape reuses every node, list, string and index
+// entry; the only allocation left is the line scanner's window buffer.
+void QmlParserTest::parses_into_an_existing_document() {
+    const QString path = QFINDTESTDATA("../qml/Main.qml");
+    QVERIFY(!path.isEmpty());
+    std::ifstream file(path.toStdString(), std::ios::binary);
+    const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    QmlParser parser;
+    QmlDocument doc;
+    parser.parseInto(doc, source);
+    QVERIFY(sameDocument(doc, parser.parseString(source)));
+    QVERIFY(doc.findById("historyView"));
+
+    const QmlAllocationScope scope;
+    parser.parseInto(doc, source);
+    QVERIFY2(scope.allocations() == 0, qPrintable(QString::number(scope.allocations())));
+    QVERIFY(doc.findById("historyView"));
+
+    // Other shapes grow and trim the tree, and snapshots keep theirs.
+    const std::string wide = R"(
+Item {
+    id: root
+    Text { id: label; text: "a"; width: 3 }
+    Row { Button { text: "x"; onClicked: go() } }
+    function f(a, b) { return a }
+}
+Item { id: second }
+)";
+    const std::string narrow = "Column {\n    Text { id: only; text: \"b\" }\n}\n";
+    const QmlDocument snapshot = doc;
+    parser.parseInto(doc, wide);
+    QVERIFY(sameDocument(doc, parser.parseString(wide)));
+    QCOMPARE(doc.roots[0].scripts[0].parameters, std::string("a, b"));
+    parser.parseInto(doc, narrow);
+    QVERIFY(sameDocument(doc, parser.parseString(narrow)));
+    QVERIFY(!doc.findById("root"));
+    QVERIFY(!doc.findById("second"));
+    QVERIFY(doc.findById("only"));
+    QVERIFY(sameDocument(snapshot, parser.parseString(source)));
+
+    parser.parseInto(doc, "");
+    QVERIFY(doc.roots.empty());
+    QVERIFY(!doc.findById("only"));
+}
+
+void QmlParserTest::keeps_parse_scratch_between_calls() {
+    using Shape = QmlCorpusOptions::Shape;
+    QmlParser parser;
+    for (const Shape shape : {Shape::Mixed, Shape::DeepNesting, Shape::LongLines}) {
+        QmlCorpusOptions options;
+        options.shape = shape;
+        options.bytes = 256 * 1024;
+        const std::string source = QmlCorpus::generate(options);
+        QmlDocument doc;
+        parser.parseInto(doc, source);
+
+        QmlAllocationScope scope;
+        parser.parseInto(doc, source);
+        const long long allocations = scope.allocations();
+        QVERIFY2(allocations == 0, qPrintable(QString::number(allocations)));
+        QVERIFY(sameDocument(doc, parser.parseString(source)));
+    }
+
+    // A parse that finds the scratch taken, here one started from a
+    // handler of another, works in buffers of its own.
+    struct Nested : QmlEventHandler {
+        const QmlParser &parser;
+        size_t found = 0;
+        explicit Nested(const QmlParser &parser) : parser(parser) {}
+        bool beginObject(std::string_view) override {
+            found += parser.parseString("Item {\n    Text { id: inner }\n}\n").findById("inner") != nullptr;
+            return true;
+        }
+        bool property(std::string_view, std::string_view) override { return true; }
+        bool endObject() override { return true; }
+    } nested(parser);
+    QVERIFY(parser.parseEvents("Column {\n    Text { id: outer; width: 2 }\n}\n", nested));
+    QCOMPARE(nested.found, size_t(2));
+}
+
+void QmlParserTest::walks_documents_without_recursion() {
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(R"(
+Item {
+    id: a
+    Row {
+        id: b
+        Text { id: c }
+        Column {
+            id: d
+            Text { id: e }
+        }
+    }
+    Text { id: f }
+}
+Item {
+    id: g
+    Text { id: h }
+}
+)");
+    std::string order;
+    for (const QmlNode &node : doc.nodes()) {
+        order += node.id;
+    }
+    QCOMPARE(order, std::string("abcdefgh"));
+    order.clear();
+    for (const QmlNode &node : doc.roots[0].descendants()) {
+        order += node.id;
+    }
+    QCOMPARE(order, std::string("bcdef"));
+
+    // Skipped children are neither entered nor left; a skipped node is
+    // left right away.
+    std::string entered;
+    std::string left;
+    QVERIFY(doc.walk(
+        [&entered](const QmlNode &node) {
+            entered += node.id;
+            return node.id == "d" ? QmlVisit::SkipChildren : QmlVisit::Continue;
+        },
+        [&left](const QmlNode &node) { left += node.id; }));
+    QCOMPARE(entered, std::string("abcdfgh"));
+    QCOMPARE(left, std::string("cdbfahg"));
+
+    entered.clear();
+    QVERIFY(!doc.walk([&entered](const QmlNode &node) {
+        entered += node.id;
+        return node.id == "e" ? QmlVisit::Stop : QmlVisit::Continue;
+    }));
+    QCOMPARE(entered, std::string("abcde"));
+
+    std::string skipped;
+    for (QmlNodeIterator it = doc.nodes().begin(); it != doc.nodes().end();) {
+        skipped += it->id + std::to_string(it.depth());
+        if (it->id == "b") {
+            it.skipChildren();
+        } else {
+            ++it;
+        }
+    }
+    QCOMPARE(skipped, std::string("a0b1f1g0h1"));
+
+    const std::vector<const QmlNode *> texts = doc.roots[0].findChildrenByType(QmlAtoms::Text);
+    QCOMPARE(texts.size(), size_t(3));
+    QCOMPARE(texts[1]->id, std::string("e"));
+    QVERIFY(QmlDocument().nodes().begin() == QmlDocument().nodes().end());
+
+    // Nesting far deeper than a small stack could recurse through.
+    const int depth = 4096;
+    std::string deep;
+    for (int i = 0; i < depth; ++i) {
+        deep += "Item {\n";
+    }
+    deep += "Text { id: bottom }\n";
+    for (int i = 0; i < depth; ++i) {
+        deep += "}\n";
+    }
+    const QmlDocument nested = parser.parseString(deep);
+    const QmlNode *bottom = nullptr;
+    size_t visited = 0;
+    std::unique_ptr<QThread> thread(QThread::create([&] {
+        bottom = nested.roots[0].findChildById("bottom");
+        nested.walk([&visited](const QmlNode &) {
+            ++visited;
+            return QmlVisit::Continue;
+        });
+    }));
+    thread->setStackSize(64 * 1024);
+    thread->start();
+    QVERIFY(thread->wait());
+    QVERIFY(bottom);
+    QCOMPARE(visited, size_t(depth + 1));
+}
+
+void QmlParserTest::navigates_to_parents_and_siblings() {
+    const std::string source = R"(
+ApplicationWindow {
+    id: window
+    Column {
+        id: column
+        Text { id: first }
+        Row {
+            id: row
+            Label { id: label }
+        }
+        Text { id: last }
+    }
+}
+Item { id: other }
+)";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(source);
+    const QmlNode &label = *doc.findById("label");
+    QCOMPARE(doc.parentOf(label), doc.findById("row"));
+    QCOMPARE(doc.enclosingOfType(label, QmlAtoms::Column), doc.findById("column"));
+    QCOMPARE(doc.enclosingOfType(label, QmlAtoms::ApplicationWindow), doc.findById("window"));
+    QVERIFY(!doc.enclosingOfType(label, QmlAtoms::Grid));
+
+    QCOMPARE(doc.nextSiblingOf(*doc.findById("first")), doc.findById("row"));
+    QCOMPARE(doc.nextSiblingOf(*doc.findById("row")), doc.findById("last"));
+    QVERIFY(!doc.nextSiblingOf(*doc.findById("last")));
+    QCOMPARE(doc.previousSiblingOf(*doc.findById("last")), doc.findById("row"));
+    QVERIFY(!doc.previousSiblingOf(*doc.findById("first")));
+
+    // Roots are siblings with no parent; foreign nodes have neither.
+    QVERIFY(!doc.parentOf(*doc.findById("window")));
+    QCOMPARE(doc.nextSiblingOf(*doc.findById("window")), doc.findById("other"));
+    const QmlNode stranger;
+    QVERIFY(!doc.parentOf(stranger));
+    QVERIFY(!doc.nextSiblingOf(stranger));
+
+    // The same answers without an index, and after parsing into the
+    // document again.
+    QmlDocument unindexed;
+    unindexed.roots = doc.roots;
+    QVERIFY(!unindexed.isIndexed());
+    const QmlNode &row = std::as_const(unindexed).roots[0].children[0].children[1];
+    QCOMPARE(unindexed.parentOf(row.children[0]), &row);
+    QCOMPARE(unindexed.previousSiblingOf(row), &std::as_const(unindexed).roots[0].children[0].children[0]);
+
+    QmlDocument reused = parser.parseString(source);
+    QVERIFY(reused.parentOf(*reused.findById("label")));
+    parser.parseInto(reused, "Item {\n    id: outer\n    Text { id: inner }\n}\n");
+    QCOMPARE(reused.parentOf(*reused.findById("inner")), reused.findById("outer"));
+}
+
+void QmlParserTest::selects_nodes_with_compiled_selectors() {
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(R"(
+ApplicationWindow {
+    id: window
+    Column {
+        Button { id: bound; text: greeter.message }
+        Row {
+            Button { id: called; text: greeter.greet(name.text) }
+            Button { id: plain; text: "Plain" }
+        }
+    }
+    Button { id: outside; text: greeter.message }
+}
+)");
+    const auto ids = [&doc](const char *text) {
+        const QmlSelector selector = QmlSelector::compile(text);
+        std::string result;
+        for (const QmlNode *node : selector.select(doc)) {
+            result += (result.empty() ? "" : " ") + node->id;
+        }
+        return result;
+    };
+    QCOMPARE(ids("Button"), std::string("bound called plain outside"));
+    QCOMPARE(ids("Column Button"), std::string("bound called plain"));
+    QCOMPARE(ids("Column > Button"), std::string("bound"));
+    QCOMPARE(ids("Column Button[text^=greeter.]"), std::string("bound called"));
+    QCOMPARE(ids("Row>Button[text=\"Plain\"]"), std::string("plain"));
+    QCOMPARE(ids("Button[text*='greet(']"), std::string("called"));
+    QCOMPARE(ids("ApplicationWindow > Button[text]"), std::string("outside"));
+    QCOMPARE(ids("Row #plain"), std::string("plain"));
+    QCOMPARE(ids("* > Row > *"), std::string("called plain"));
+    QCOMPARE(ids("Row Column Button"), std::string());
+
+    for (const char *invalid : {"", "Button[", "#", "Column >", "Button[text=\"open]", "Row,Column"}) {
+        QVERIFY2(!QmlSelector::compile(invalid).isValid(), invalid);
+    }
+
+    // Results are kept until the document is reindexed.
+    const QmlSelector selector = QmlSelector::compile("Button[text^=greeter]");
+    const std::vector<const QmlNode *> *results = &selector.select(doc);
+    QCOMPARE(results->size(), size_t(3));
+    QVERIFY(&selector.select(doc) == results);
+    QCOMPARE(selector.first(doc), doc.findById("bound"));
+    QVERIFY(selector.matches(doc, *doc.findById("outside")));
+    QVERIFY(!selector.matches(doc, *doc.findById("plain")));
+
+    QmlDocument edited = doc;
+    edited.roots[0].children[0].children[0].setProperty(QmlAtoms::text, "Static");
+    edited.reindex();
+    QVERIFY(edited.revision() != doc.revision());
+    QCOMPARE(selector.select(edited).size(), size_t(2));
+    QCOMPARE(selector.select(doc).size(), size_t(3));
+}
+
+void QmlParserTest::keeps_undo_steps_as_shared_snapshots() {
+    std::string source = "ApplicationWindow {\n    id: window\n";
+    for (int column = 0; column < 20; ++column) {
+        source += "    Column {\n";
+        for (int row = 0; row < 20; ++row) {
+            source += "        Text { id: t" + std::to_string(column) + "_" + std::to_string(row) + "; text: \"Label\" }\n";
+        }
+        source += "    }\n";
+    }
+    source += "}\n";
+    QmlParser parser;
+    QmlUndoHistory history(parser.parseString(source));
+    const size_t initialBytes = history.retainedBytes();
+
+    const auto edit = [&history](size_t column, size_t row, const std::string &text) {
+        QmlDocument next = history.current();
+        next.roots[0].children[column].children[row].setProperty(QmlAtoms::text, text);
+        next.reindex();
+        history.commit(std::move(next));
+    };
+    for (size_t step = 0; step < 50; ++step) {
+        edit(step % 20, step % 7, "Edit " + std::to_string(step));
+    }
+    QCOMPARE(history.size(), size_t(51));
+    // Each step holds the lists on one path: a tenth of the document at
+    // most here, where the whole document would be a full copy.
+    QVERIFY2(history.retainedBytes() - initialBytes < 50 * initialBytes / 10,
+             qPrintable(QString("%1 over %2").arg(history.retainedBytes()).arg(initialBytes)));
+
+    // Adjacent steps diff to just their edit; older steps are unindexed.
+    const QmlDocumentDiff diff = QmlDocumentDiff::compute(history.step(49), history.step(50));
+    QCOMPARE(diff.changes.size(), size_t(1));
+    QCOMPARE(diff.changes[0].kind, QmlChange::Kind::PropertyChanged);
+    QVERIFY(!history.step(49).isIndexed());
+
+    QCOMPARE(history.current().findById("t9_0")->property("text"), std::string("Edit 49"));
+    QCOMPARE(history.undo().findById("t9_0")->property("text"), std::string("Label"));
+    QVERIFY(history.current().isIndexed());
+    QCOMPARE(history.redo().findById("t9_0")->property("text"), std::string("Edit 49"));
+    while (history.canUndo()) {
+        history.undo();
+    }
+    QCOMPARE(history.current().findById("t9_0")->property("text"), std::string("Label"));
+
+    // Committing after an undo drops the redo steps.
+    edit(0, 0, "Fresh");
+    QCOMPARE(history.size(), size_t(2));
+    QVERIFY(!history.canRedo());
+
+    QmlUndoHistory limited(parser.parseString(source), 3);
+    for (int step = 0; step < 5; ++step) {
+        QmlDocument next = limited.current();
+        next.roots[0].setProperty(QmlAtoms::title, std::to_string(step));
+        limited.commit(std::move(next));
+    }
+    QCOMPARE(limited.size(), size_t(3));
+    QCOMPARE(limited.step(0).roots[0].property("title"), std::string("2"));
+}
+
+void QmlParserTest::commits_batched_edits_at_once() {
+    std::string source = "ApplicationWindow {\n    Column {\n        id: toolbar\n";
+    for (int i = 0; i < 40; ++i) {
+        source += "        Button { id: b" + std::to_string(i) + "; text: \"Go\" }\n";
+    }
+    source += "    }\n    Text { id: status; text: \"Ready\" }\n}\n";
+    QmlDocument doc = QmlParser().parseString(source);
+    const uint64_t revision = doc.revision();
+
+    QmlDocumentTransaction transaction(doc);
+    for (const QmlNode *button : doc.nodesOfType(QmlAtoms::Button)) {
+        transaction.setProperty(QmlDocumentTransaction::pathOf(doc, *button), QmlAtoms::x, "12");
+    }
+    QmlNode label;
+    label.setType("Text");
+    label.id = "hint";
+    transaction.insert({0}, 1, std::move(label));
+    transaction.remove({0, 2});
+    QCOMPARE(transaction.size(), size_t(42));
+    // Nothing reaches the document before the commit.
+    QCOMPARE(doc.revision(), revision);
+    QVERIFY(doc.findById("b0")->findProperty(QmlAtoms::x) == nullptr);
+    QCOMPARE(transaction.staged().findById("hint")->type, std::string("Text"));
+
+    const QmlDocumentDiff diff = transaction.commit();
+    QVERIFY(doc.revision() != revision);
+    QVERIFY(transaction.empty());
+    size_t changed = 0;
+    size_t inserted = 0;
+    size_t removed = 0;
+    for (const QmlChange &change : diff.changes) {
+        changed += change.kind == QmlChange::Kind::PropertyChanged;
+        inserted += change.kind == QmlChange::Kind::Inserted;
+        removed += change.kind == QmlChange::Kind::Removed;
+    }
+    QCOMPARE(changed, size_t(40));
+    QCOMPARE(inserted, size_t(1));
+    QCOMPARE(removed, size_t(1));
+    QCOMPARE(doc.findById("b39")->property("x"), std::string("12"));
+    QCOMPARE(doc.findById("hint"), &std::as_const(doc).roots[0].children[1]);
+    QVERIFY(doc.findById("status") == nullptr);
+    QCOMPARE(transaction.before().findById("status")->property("text"), std::string("Ready"));
+    QVERIFY(transaction.commit().empty());
+
+    // A bad path fails that edit alone; rollback() and unwinding drop the rest.
+    const uint64_t committed = doc.revision();
+    transaction.setProperty({0, 0, 3}, QmlAtoms::text, "Stop");
+    bool threw = false;
+    try {
+        transaction.setProperty({0, 0, 40}, QmlAtoms::text, "Stop");
+    } catch (const std::out_of_range &) {
+        threw = true;
+    }
+    QVERIFY(threw);
+    QCOMPARE(transaction.size(), size_t(1));
+    transaction.rollback();
+    QVERIFY(transaction.commit().empty());
+    try {
+        QmlDocumentTransaction scoped(doc);
+        scoped.remove({0, 0});
+        scoped.remove({0, 5});
+    } catch (const std::out_of_range &) {
+    }
+    QCOMPARE(doc.revision(), committed);
+    QCOMPARE(doc.findById("b3")->property("text"), std::string("Go"));
+    QCOMPARE(std::as_const(doc).roots[0].children.size(), size_t(2));
+
+    // Moving a node is a remove and an insert, and commits as a move.
+    QmlNode toolbar = std::as_const(doc).roots[0].children[0];
+    transaction.remove({0, 0});
+    transaction.insert({0}, 1, std::move(toolbar));
+    const QmlDocumentDiff moved = transaction.commit();
+    QCOMPARE(moved.changes.size(), size_t(1));
+    QCOMPARE(moved.changes[0].kind, QmlChange::Kind::Moved);
+    QCOMPARE(doc.findById("toolbar"), &std::as_const(doc).roots[0].children[1]);
+    QCOMPARE(doc.findById("hint"), &std::as_const(doc).roots[0].children[0]);
+}
+
+void QmlParserTest::journals_changes_for_incremental_consumers() {
+    QmlDocument doc = QmlParser().parseString("Column {\n"
+                                              "    Text { id: first; text: \"A\" }\n"
+                                              "    Text { id: second; text: \"B\" }\n"
+                                              "}\n");
+    QmlChangeJournal journal;
+    QmlDocumentTransaction transaction(doc, &journal);
+    transaction.setProperty({0, 0}, QmlAtoms::text, "Unseen");
+    transaction.commit();
+    // Nobody subscribed, so nothing was kept.
+    QCOMPARE(journal.revision(), uint64_t(1));
+    QCOMPARE(journal.size(), size_t(0));
+
+    const size_t renderer = journal.subscribe();
+    const size_t index = journal.subscribe();
+    transaction.setProperty({0, 1}, QmlAtoms::text, "C");
+    transaction.commit();
+    transaction.remove({0, 0});
+    QmlNode added;
+    added.setType("Button");
+    transaction.insert({0}, 1, std::move(added));
+    transaction.commit();
+    QCOMPARE(journal.revision(), uint64_t(3));
+
+    std::vector<QmlJournalChange> seen;
+    QVERIFY(journal.changesSince(journal.acknowledged(renderer),
+                                 [&seen](const QmlJournalChange &change) { seen.push_back(change); }));
+    QCOMPARE(seen.size(), size_t(3));
+    QCOMPARE(seen[0].revision, uint64_t(2));
+    QCOMPARE(seen[0].kind, QmlChange::Kind::PropertyChanged);
+    QCOMPARE(seen[0].property, static_cast<QmlAtom>(QmlAtoms::text));
+    QCOMPARE(seen[0].path, QmlNodePath({0, 1}));
+    for (const QmlJournalChange &change : std::vector<QmlJournalChange>(seen.begin() + 1, seen.end())) {
+        QCOMPARE(change.revision, uint64_t(3));
+        if (change.kind == QmlChange::Kind::Removed) {
+            QCOMPARE(change.path, QmlNodePath({0, 0}));
+        } else {
+            QCOMPARE(change.kind, QmlChange::Kind::Inserted);
+            QCOMPARE(change.resolve(doc)->type, std::string("Button"));
+        }
+    }
+
+    // Entries stay until the slower consumer has seen them too.
+    journal.acknowledge(renderer, journal.revision());
+    QCOMPARE(journal.size(), size_t(3));
+    journal.acknowledge(index, 2);
+    QCOMPARE(journal.size(), size_t(2));
+    QVERIFY(!journal.changesSince(1, [](const QmlJournalChange &) {}));
+    size_t pending = 0;
+    QVERIFY(journal.changesSince(journal.acknowledged(index), [&pending](const QmlJournalChange &) { ++pending; }));
+    QCOMPARE(pending, size_t(2));
+    journal.unsubscribe(index);
+    QCOMPARE(journal.size(), size_t(0));
+    pending = 0;
+    QVERIFY(journal.changesSince(journal.revision(), [&pending](const QmlJournalChange &) { ++pending; }));
+    QCOMPARE(pending, size_t(0));
+}
+
+void QmlParserTest::writes_documents_back_to_qml() {
+    // Property values and scripts compared by content: the written text
+    // puts everything at other offsets.
+    const auto sameContent = [](const QmlDocument &a, std::string_view aSource, const QmlDocument &b,
+                                std::string_view bSource) {
+        QmlNodeIterator left = a.nodes().begin();
+        QmlNodeIterator right = b.nodes().begin();
+        for (; left != a.nodes().end() && right != b.nodes().end(); ++left, ++right) {
+            if (left->type != right->type || left->id != right->id || left->binding != right->binding ||
+                left.depth() != right.depth() ||
+                left->properties.size() != right->properties.size() || left->scripts.size() != right->scripts.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < left->properties.size(); ++i) {
+                const QmlProperty &l = left->properties[i];
+                const QmlProperty &r = right->properties[i];
+                if (l.key != r.key || l.value != r.value || l.typed.kind != r.typed.kind) {
+                    return false;
+                }
+            }
+            for (size_t i = 0; i < left->scripts.size(); ++i) {
+                if (left->scripts[i].name != right->scripts[i].name ||
+                    left->scripts[i].body(aSource) != right->scripts[i].body(bSource)) {
+                    return false;
+                }
+            }
+        }
+        return left == a.nodes().end() && right == b.nodes().end();
+    };
+
+    const std::string qml = "ApplicationWindow {\n"
+                            "    title: 'Say \"hi\"'\n"
+                            "    width: 640; visible: true\n"
+                            "    Column {\n"
+                            "        anchors.centerIn: parent\n"
+                            "        Text { id: label; text: \"It's \\\"here\\\"\"; wrapMode: Text.Wrap }\n"
+                            "        Button {\n"
+                            "            text: greeter.message\n"
+                            "            onClicked: { label.text = \"Clicked\" }\n"
+                            "            function reset(value) { return value + 1 }\n"
+                            "        }\n"
+                            "    }\n"
+                            "}\n";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    const std::string written = QmlWriter::toString(doc, qml);
+    QVERIFY2(sameContent(doc, qml, parser.parseString(written), written), written.c_str());
+    QVERIFY(written.find("    title: 'Say \"hi\"'\n") != std::string::npos);
+    QVERIFY(written.find("            onClicked: { label.text = \"Clicked\" }\n") != std::string::npos);
+
+    // A subtree on its own, and a node built in code with only its id field set.
+    QCOMPARE(QmlWriter::toString(*doc.findById("label")),
+             std::string("Text {\n    id: label\n    text: \"It's \\\"here\\\"\"\n    wrapMode: Text.Wrap\n}\n"));
+    QmlNode built;
+    built.setType("Label");
+    built.id = "note";
+    built.setProperty(QmlAtoms::text, "Saved");
+    QCOMPARE(QmlWriter::toString(built), std::string("Label {\n    id: note\n    text: \"Saved\"\n}\n"));
+
+    // Small chunks only change how the output is cut up.
+    std::string corpus = QmlCorpus::generate({QmlCorpusOptions::Shape::Mixed, 256 * 1024, 7});
+    const QmlDocument large = parser.parseString(corpus);
+    std::string chunked;
+    size_t chunks = 0;
+    size_t largest = 0;
+    const auto sink = [&](std::string_view chunk) {
+        chunked.append(chunk);
+        ++chunks;
+        largest = std::max(largest, chunk.size());
+    };
+    QmlWriter::Options options;
+    options.chunkSize = 4096;
+    uint64_t bytesWritten = 0;
+    {
+        QmlWriter writer(sink, options);
+        writer.write(large, corpus);
+        bytesWritten = writer.bytesWritten();
+    }
+    QCOMPARE(bytesWritten, uint64_t(chunked.size()));
+    QCOMPARE(chunked, QmlWriter::toString(large, corpus));
+    QVERIFY(chunks > chunked.size() / 4096);
+    QVERIFY(largest <= 4096);
+    QVERIFY(sameContent(large, corpus, parser.parseString(chunked), chunked));
+}
+
+void QmlParserTest::exports_documents_as_json_and_messagepack() {
+    const std::string qml = "Text {\n"
+                            "    width: 640; opacity: 0.5; visible: true\n"
+                            "    text: \"Say \\\"hi\\\"\"\n"
+                            "    onClicked: { go() }\n"
+                            "    Item {}\n"
+                            "}\n";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    QCOMPARE(QmlExporter::toString(doc, qml),
+             std::string(R"({"roots":[{"type":"Text","id":"","sourceRange":[0,111],"properties":[)"
+                         R"({"name":"width","kind":"int","value":640},{"name":"opacity","kind":"real","value":0.5},)"
+                         R"({"name":"visible","kind":"bool","value":true},)"
+                         R"({"name":"text","kind":"string","value":"Say \\\"hi\\\""}],)"
+                         R"("scripts":[{"kind":"handler","name":"onClicked","body":"{ go() }"}],"children":[)"
+                         R"({"type":"Item","id":"","sourceRange":[98,109],"properties":[],"scripts":[],"children":[]})"
+                         R"(]}]})"));
+
+    // The same tree as MessagePack; without the source, scripts have no body.
+    QmlNode built;
+    built.setType("Item");
+    built.properties.push_back(QmlProperty{QmlAtoms::width, "300", QmlValue::classify("300")});
+    const char packed[] = "\x86\xa4type\xa4Item\xa2id\xa0\xabsourceRange\x92\x00\x00"
+                          "\xaaproperties\x91\x83\xa4name\xa5width\xa4kind\xa3int\xa5value\xcd\x01\x2c"
+                          "\xa7scripts\x90\xa8" "children\x90";
+    QCOMPARE(QmlExporter::toString(built, {}, QmlExporter::Format::MessagePack),
+             std::string(packed, sizeof packed - 1));
+
+    // Escapes land wherever the kernel's blocks split the text.
+    std::string text;
+    std::string escaped;
+    for (int i = 0; i < 200; ++i) {
+        const char ch = i % 37 == 0 ? '"' : i % 41 == 0 ? '\\' : i % 53 == 0 ? '\x01' : i % 59 == 0 ? '\n'
+                                                                                                : char('a' + i % 26);
+        text.push_back(ch);
+        escaped += ch == '"' ? "\\\"" : ch == '\\' ? "\\\\" : ch == '\x01' ? "\\u0001" : ch == '\n' ? "\\n"
+                                                                                                  : std::string(1, ch);
+    }
+    QmlNode label;
+    label.setType("Label");
+    label.setProperty(QmlAtoms::text, text);
+    QVERIFY2(QmlExporter::toString(label).find("\"value\":\"" + escaped + "\"}") != std::string::npos,
+             QmlExporter::kernelName());
+
+    // Small chunks only change how the output is cut up.
+    const std::string corpus = QmlCorpus::generate({QmlCorpusOptions::Shape::Mixed, 256 * 1024, 7});
+    const QmlDocument large = parser.parseString(corpus);
+    for (const QmlExporter::Format format : {QmlExporter::Format::Json, QmlExporter::Format::MessagePack}) {
+        std::string chunked;
+        size_t largest = 0;
+        const auto sink = [&](std::string_view chunk) {
+            chunked.append(chunk);
+            largest = std::max(largest, chunk.size());
+        };
+        uint64_t bytesWritten = 0;
+        {
+            QmlExporter exporter(sink, {format, 4096});
+            exporter.write(large, corpus);
+            bytesWritten = exporter.bytesWritten();
+        }
+        QCOMPARE(bytesWritten, uint64_t(chunked.size()));
+        QCOMPARE(chunked, QmlExporter::toString(large, corpus, format));
+        QVERIFY(largest <= 4096);
+    }
+}
+
+void QmlParserTest::expands_project_components_once() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkdir(QStringLiteral("widgets")));
+    const auto write = [&dir](const QString &name, const std::string &text) {
+        const std::string path = dir.filePath(name).toStdString();
+        std::ofstream(path, std::ios::binary) << text;
+        return path;
+    };
+    write(QStringLiteral("widgets/Badge.qml"), "Text {\n    text: \"New\"\n}\n");
+    const std::string card = write(QStringLiteral("MyCard.qml"),
+                                   "import QtQuick 2.15\n"
+                                   "import \"widgets\" as W\n"
+                                   "Rectangle {\n"
+                                   "    color: \"blue\"\n"
+                                   "    Column {\n"
+                                   "        W.Badge {\n"
+                                   "            color: \"red\"\n"
+                                   "        }\n"
+                                   "    }\n"
+                                   "}\n");
+    write(QStringLiteral("Loop.qml"), "Item {\n    Loop {\n    }\n}\n");
+    std::string source = "import QtQuick 2.15\nColumn {\n";
+    for (int i = 0; i < 200; ++i) {
+        source += "    MyCard {\n        id: card" + std::to_string(i) + "\n        color: \"c" + std::to_string(i) +
+                  "\"\n    }\n";
+    }
+    source += "    Loop {\n    }\n    Unknown {\n    }\n}\n";
+    const std::string screen = write(QStringLiteral("Screen.qml"), source);
+
+    QmlProjectIndex project;
+    const QmlDocument document = project.expand(QmlParser().parseString(source), source, screen);
+    QCOMPARE(project.parseCount(), size_t(3));
+
+    const QmlNode *instance = document.findById("card7");
+    QVERIFY(instance);
+    QCOMPARE(instance->type, std::string("Rectangle"));
+    QCOMPARE(instance->property("color"), std::string("c7"));
+    const QmlNode &badge = instance->children[0].children[0];
+    QCOMPARE(badge.type, std::string("Text"));
+    QCOMPARE(badge.property("text"), std::string("New"));
+    QCOMPARE(badge.property("color"), std::string("red"));
+    // Instances share the component's subtree rather than copying it.
+    QVERIFY(instance->children.sharesWith(document.findById("card8")->children));
+    // A component used inside itself stops expanding where it recurs.
+    const QmlNode &loop = document.roots[0].children[200];
+    QCOMPARE(loop.type, std::string("Item"));
+    QCOMPARE(loop.children[0].type, std::string("Loop"));
+    QCOMPARE(document.roots[0].children[201].type, std::string("Unknown"));
+    QCOMPARE(project.dependenciesOf(screen).size(), size_t(3));
+
+    // Changing the badge drops it and the card built on it, not Loop.
+    write(QStringLiteral("widgets/Badge.qml"), "Text {\n    text: \"Sale\"\n}\n");
+    QCOMPARE(project.invalidate(dir.filePath(QStringLiteral("widgets")).toStdString()), size_t(2));
+    const QmlDocument reloaded = project.expand(QmlParser().parseString(source), source, screen);
+    QCOMPARE(project.parseCount(), size_t(5));
+    QCOMPARE(reloaded.findById("card0")->children[0].children[0].property("text"), std::string("Sale"));
+    QCOMPARE(project.invalidate(card), size_t(1));
+
+    // Lazy callers instantiate one use at a time.
+    const QmlDocument unexpanded = QmlParser().parseString(source);
+    QmlNode lazy;
+    QVERIFY(project.instantiate(unexpanded.roots[0].children[3], screen, lazy));
+    QCOMPARE(lazy.property("color"), std::string("c3"));
+    QCOMPARE(project.parseCount(), size_t(6));
+    QVERIFY(!project.instantiate(unexpanded.roots[0].children[201], screen, lazy));
+
+    // Evicting drops the least recently used component, Loop, which is
+    // parsed again when next used.
+    const size_t cached = project.byteSize();
+    QCOMPARE(project.componentCount(), size_t(3));
+    const size_t evicted = project.evict(1);
+    QVERIFY(evicted > 0 && evicted < cached);
+    QCOMPARE(project.componentCount(), size_t(2));
+    QCOMPARE(project.byteSize(), cached - evicted);
+    QVERIFY(project.instantiate(unexpanded.roots[0].children[200], screen, lazy));
+    QCOMPARE(project.parseCount(), size_t(7));
+    project.evict(cached * 2);
+    QCOMPARE(project.componentCount(), size_t(0));
+    QCOMPARE(project.byteSize(), size_t(0));
+
+    const std::vector<QmlImport> imports =
+        QmlProjectIndex::imports("import QtQuick.Controls 2.15 as QQC\nimport \"../shared\" as S;\nimportant: 1\n");
+    QCOMPARE(imports.size(), size_t(2));
+    QCOMPARE(imports[0].uri, std::string("QtQuick.Controls"));
+    QCOMPARE(imports[0].version, std::string("2.15"));
+    QCOMPARE(imports[0].qualifier, std::string("QQC"));
+    QVERIFY(!imports[0].local);
+    QCOMPARE(imports[1].uri, std::string("../shared"));
+    QCOMPARE(imports[1].qualifier, std::string("S"));
+    QVERIFY(imports[1].local);
+}
+
+void QmlParserTest::reports_document_memory_usage() {
+    const std::string longText(200, 'x');
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString("ApplicationWindow {\n"
+                                               "    Column {\n"
+                                               "        Text { id: a; text: \"" + longText + "\" }\n"
+                                               "        Button { text: \"Go\"; onClicked: run() }\n"
+                                               "    }\n"
+                                               "}\n");
+    const QmlMemoryUsage usage = doc.memoryUsage();
+    QCOMPARE(usage.nodeCount, size_t(4));
+    QCOMPARE(usage.nodes, 4 * sizeof(QmlNode));
+    QVERIFY(usage.properties >= 2 * sizeof(QmlProperty));
+    QVERIFY(usage.scripts >= sizeof(QmlScriptBlock));
+    QVERIFY(usage.strings > longText.size());  // short strings stay inline
+    QVERIFY(usage.indices > 0);
+    QCOMPARE(usage.total(), usage.nodes + usage.childVectors + usage.properties + usage.scripts + usage.strings +
+                                usage.indices + usage.document);
+
+    QCOMPARE(QmlDocument().memoryUsage().nodes, size_t(0));
+}
+
+void QmlParserTest::compresses_inactive_documents() {
+    std::string incompressible(5000, '\0');
+    uint32_t seed = 1;
+    for (char &c : incompressible) {
+        seed = seed * 1103515245u + 12345u;
+        c = static_cast<char>(seed >> 24);
+    }
+    const std::string inputs[] = {"", "a", "abcdefghijkl", "abcdabcdabcdabcdabcd", std::string(70000, 'x'),
+                                  incompressible};
+    for (const std::string &input : inputs) {
+        const std::string block = QmlLz4::compress(input);
+        QVERIFY(block.size() <= QmlLz4::bound(input.size()));
+        std::string output;
+        QVERIFY(QmlLz4::decompress(block, input.size(), output));
+        QVERIFY(output == input);
+        QVERIFY(!QmlLz4::decompress(block, input.size() + 1, output));
+    }
+    QVERIFY(QmlLz4::compress(std::string(70000, 'x')).size() < 400);
+
+    std::string qml = "ApplicationWindow {\n    Column {\n";
+    for (int i = 0; i < 40; ++i) {
+        qml += "        Button { id: b" + std::to_string(i) + "; text: \"Item\"; onClicked: open(" + std::to_string(i) +
+               ") }\n";
+    }
+    qml += "    }\n}\n";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+    const QmlCompressedDocument compressed(doc);
+    QVERIFY(!compressed.empty());
+    QVERIFY(compressed.byteSize() < doc.memoryUsage().total() / 4);
+    const QmlDocument restored = compressed.decompress();
+    QCOMPARE(QmlWriter::toString(restored), QmlWriter::toString(doc));
+    QVERIFY(restored.revision() != doc.revision());
+    QVERIFY(QmlCompressedDocument().empty());
+}
+
+void QmlParserTest::shares_identical_subtrees() {
+    std::string qml = "ApplicationWindow {\n    Column {\n";
+    for (int i = 0; i < 50; ++i) {
+        const std::string index = std::to_string(i);
+        qml += "        Row {\n";
+        qml += "            Text { id: label" + index + "; text: model.label; width: 12 }\n";
+        qml += "            Button { id: button" + index + "; text: \"Open\"; onClicked: open() }\n";
+        qml += "        }\n";
+    }
+    qml += "        Text { id: footer; text: \"Done\" }\n    }\n}\n";
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(qml);
+
+    const QmlDedupedDocument deduped = QmlDedupedDocument::build(doc);
+    QCOMPARE(deduped.nodeCount(), size_t(153));
+    // ApplicationWindow, Column, Row, Text, Button and the footer Text.
+    QCOMPARE(deduped.shapeCount(), size_t(6));
+    QCOMPARE(deduped.children(deduped.roots()[0]).size(), size_t(1));
+
+    // Ids come from the side table, by pre-order index.
+    QCOMPARE(deduped.id(3), std::string_view("label0"));
+    QCOMPARE(deduped.findById("button49"), uint32_t(2 + 49 * 3 + 2));
+    QCOMPARE(deduped.findById("missing"), QmlDedupedDocument::npos);
+
+    const QmlDocument expanded = deduped.expand();
+    QVERIFY(QmlDocumentDiff::compute(doc, expanded).empty());
+    const QmlNode *button = expanded.findById("button7");
+    QVERIFY(button);
+    QCOMPARE(button->property(QmlAtoms::id), std::string("button7"));
+    QCOMPARE(button->scripts.size(), size_t(1));
+    QVERIFY(deduped.byteSize() < doc.memoryUsage().total() / 4);
+}
+
+void QmlParserTest::snapshots_share_nodes_until_written() {
+    QmlParser parser;
+    const QmlDocument doc = parser.parseString(R"(
+ApplicationWindow {
+    Column {
+        Text { id: first; text: "One" }
+        Row {
+            Label { id: inner; text: "Two" }
+        }
+    }
+    Column { id: side; Text { text: "Three" } }
+}
+)");
+
+    // A copy shares the tree and its indices.
+    QmlDocument copy = doc;
+    QVERIFY(copy.roots.sharesWith(doc.roots));
+    QCOMPARE(copy.findById("inner"), doc.findById("inner"));
+
+    // A reader keeps its snapshot while the copy is edited.
+    bool readerSawOriginal = true;
+    std::thread reader([snapshot = doc, &readerSawOriginal]() {
+        for (int i = 0; i < 1000; ++i) {
+            readerSawOriginal = readerSawOriginal && snapshot.findById("first")->property("text") == "One";
+        }
+    });
+    copy.roots[0].children[0].children[0].setProperty(QmlAtoms::text, "Changed");
+    copy.reindex();
+    reader.join();
+    QVERIFY(readerSawOriginal);
+    QCOMPARE(doc.findById("first")->property("text"), std::string("One"));
+    QCOMPARE(copy.findById("first")->property("text"), std::string("Changed"));
+
+    // Only the lists on the path to the edit were copied.
+    const QmlDocument &edited = copy;
+    QVERIFY(!edited.roots.sharesWith(doc.roots));
+    QVERIFY(!edited.roots[0].children[0].children.sharesWith(doc.roots[0].children[0].children));
+    QVERIFY(edited.roots[0].children[0].children[1].children.sharesWith(doc.roots[0].children[0].children[1].children));
+    QVERIFY(edited.roots[0].children[1].children.sharesWith(doc.roots[0].children[1].children));
+    QCOMPARE(QmlDocumentDiff::compute(doc, copy).changes.size(), size_t(1));
+}
+
+void QmlParserTest::publishes_documents_to_concurrent_readers() {
+    const auto source = [](int version) {
+        return "ApplicationWindow { id: window; title: \"" + std::to_string(version) + "\" }\n";
+    };
+    QmlParser parser;
+    QmlDocumentHandle handle(parser.parseString(source(0)));
+    QCOMPARE(handle.version(), uint64_t(1));
+
+    // Every read sees one whole version, and versions only move forward.
+    std::atomic<bool> done{false};
+    std::atomic<int> inconsistent{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+            while (!done.load()) {
+                const auto guard = handle.read();
+                const QmlNode *window = guard->findById("window");
+                if (guard.version() < last || !window ||
+                    window->property("title") != std::to_string(guard.version() - 1)) {
+                    ++inconsistent;
+                }
+                last = guard.version();
+            }
+        });
+    }
+    for (int i = 1; i <= 200; ++i) {
+        QCOMPARE(handle.publish(parser.parseString(source(i))), uint64_t(i + 1));
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    QCOMPARE(inconsistent.load(), 0);
+
+    // A held version survives a publish and is freed after its reader.
+    {
+        const auto guard = handle.read();
+        handle.publish(parser.parseString(source(201)));
+        QCOMPARE(handle.retiredCount(), size_t(1));
+        QCOMPARE(guard->findById("window")->property("title"), std::string("200"));
+    }
+    QCOMPARE(handle.retiredCount(), size_t(0));
+
+    // Snapshots outlive the version they were taken from.
+    const QmlDocument snapshot = handle.snapshot();
+    handle.publish(QmlDocument());
+    QCOMPARE(snapshot.findById("window")->property("title"), std::string("201"));
+    QVERIFY(!handle.read()->findById("window"));
+}
+
+void QmlParserTest::answers_index_queries_from_memory() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkdir(QStringLiteral("widgets")));
+    const auto write = [&dir](const QString &name, const std::string &text) {
+        const std::string path = dir.filePath(name).toStdString();
+        std::ofstream(path, std::ios::binary) << text;
+        return path;
+    };
+    const std::string badge = write(QStringLiteral("widgets/Badge.qml"), "Text {\n    id: label\n}\n");
+    const std::string main = write(QStringLiteral("Main.qml"),
+                                   "import \"widgets\"\n"
+                                   "Column {\n"
+                                   "    id: root\n"
+                                   "    TextField { id: name }\n"
+                                   "    Badge {\n"
+                                   "        text: name.text\n"
+                                   "    }\n"
+                                   "}\n");
+    write(QStringLiteral("notes.txt"), "Column {\n}\n");
+
+    QmlIndexService service;
+    QCOMPARE(service.addDirectory(dir.path().toStdString()), size_t(2));
+
+    const std::vector<QmlIndexMatch> roots = service.findId("root");
+    QCOMPARE(roots.size(), size_t(1));
+    QCOMPARE(roots[0].path, main);
+    QCOMPARE(std::make_pair(roots[0].line, roots[0].column), std::make_pair(size_t(2), size_t(1)));
+    QCOMPARE(roots[0].text, std::string("Column"));
+    QCOMPARE(service.findType("Text").size(), size_t(1));
+
+    // "name" in name.text is the TextField; Badge is widgets/Badge.qml.
+    const std::vector<QmlIndexMatch> field = service.definition(main, 6, 21);
+    QCOMPARE(field.size(), size_t(1));
+    QCOMPARE(std::make_pair(field[0].line, field[0].column), std::make_pair(size_t(4), size_t(5)));
+    QCOMPARE(service.definition(main, 6, 16)[0].text, std::string("id name"));
+    const std::vector<QmlIndexMatch> component = service.definition(main, 5, 7);
+    QCOMPARE(component.size(), size_t(1));
+    QCOMPARE(component[0].path, badge);
+    QCOMPARE(component[0].text, std::string("component Badge"));
+    QVERIFY(service.definition(main, 3, 5).empty());
+
+    QCOMPARE(service.answer("bindings\t" + main + "\troot"), main + "\t2\t1\tid: root\n\n");
+    QCOMPARE(service.answer("definition\t" + main + "\tsix\t1").rfind("error\t", 0), size_t(0));
+
+    // Edits are reparsed in place; deleted files are dropped.
+    write(QStringLiteral("Main.qml"), "Column {\n    id: top\n}\n");
+    QVERIFY(service.update(main));
+    QVERIFY(service.findId("root").empty());
+    QCOMPARE(service.findId("top").size(), size_t(1));
+    QVERIFY(QFile::remove(QString::fromStdString(badge)));
+    QCOMPARE(service.refreshDirectory(dir.path().toStdString()), size_t(1));
+    QCOMPARE(service.files(), std::vector<std::string>{main});
+}
+
+void QmlParserTest::finds_property_values_through_the_value_index() {
+    QCOMPARE(QmlValueIndex::tokenize("root.greeter.message + \"Say hello\""),
+             (std::vector<std::string_view>{"Say", "greeter", "greeter.message", "hello", "message", "root",
+                                            "root.greeter", "root.greeter.message"}));
+
+    QmlIndexService service;
+    service.update("/project/Main.qml", "Column {\n"
+                                        "    Text { text: greeter.message }\n"
+                                        "    Text { text: \"Say hello\"; color: greeter.messages }\n"
+                                        "}\n");
+    service.update("/project/Other.qml", "Row {\n    Label { text: \"hello, Say\" }\n}\n");
+
+    const std::vector<QmlIndexMatch> message = service.uses("greeter.message");
+    QCOMPARE(message.size(), size_t(1));
+    QCOMPARE(std::make_pair(message[0].line, message[0].column), std::make_pair(size_t(2), size_t(5)));
+    QCOMPARE(message[0].text, std::string("text: greeter.message"));
+    // Both files hold both words; only one holds the text.
+    QCOMPARE(service.values().find("Say hello").size(), size_t(2));
+    QCOMPARE(service.answer("uses\tSay hello"), std::string("/project/Main.qml\t3\t5\ttext: Say hello\n\n"));
+
+    // Updates replace a file's postings; the index reloads from its bytes.
+    service.update("/project/Main.qml", "Column {\n    Text { text: \"Goodbye\" }\n}\n");
+    QVERIFY(service.uses("greeter.message").empty());
+    QCOMPARE(service.uses("Goodbye").size(), size_t(1));
+    service.remove("/project/Other.qml");
+    QVERIFY(service.values().find("Say").empty());
+
+    const std::string bytes = service.values().serialize();
+    QmlValueIndex loaded;
+    QVERIFY(loaded.deserialize(bytes));
+    QCOMPARE(loaded.fileCount(), size_t(1));
+    QCOMPARE(loaded.sourceHash("/project/Main.qml"), service.values().sourceHash("/project/Main.qml"));
+    const std::vector<QmlValueHit> hits = loaded.find("Goodbye");
+    QCOMPARE(hits.size(), size_t(1));
+    QCOMPARE(hits[0].node, uint32_t(1));
+    QCOMPARE(QmlAtomTable::global().name(hits[0].key), std::string_view("text"));
+    QVERIFY(!loaded.deserialize(bytes.substr(0, bytes.size() - 1)));
+}
+
 QTEST_GUILESS_MAIN(QmlParserTest)
 #include "qml_parser_test.moc"
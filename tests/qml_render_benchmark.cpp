@@ -0,0 +1,144 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQuickItem>
+#include <QQuickRenderControl>
+#include <QQuickRenderTarget>
+#include <QQuickWindow>
+#include <QtQml/qqmlextensionplugin.h>
+#include <rhi/qrhi.h>
+
+#if QT_CONFIG(vulkan)
+#include <QVulkanInstance>
+#endif
+
+#include <memory>
+
+Q_IMPORT_QML_PLUGIN(SamplePlugin)
+
+namespace {
+
+// Frames per backend; QML_RENDER_FRAMES overrides it.
+int frameCount() {
+    const int requested = qEnvironmentVariableIntValue("QML_RENDER_FRAMES");
+    return requested > 0 ? requested : 500;
+}
+
+}  // namespace
+
+// Renders Main.qml through QQuickRenderControl into an offscreen RHI
+// texture, so the scene graph's throughput is measured with no window
+// system and no vsync in the way. Each frame types one more character
+// into nameField, so every frame polishes, syncs and renders a change.
+// Frames end with QRhi's offscreen frame, which waits for the GPU, so the
+// result is frames per second the whole pipeline sustains. Backends the
+// platform lacks are skipped; "null" renders nothing and isolates the CPU
+// side.
+class QmlRenderBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void render_frames_data();
+    void render_frames();
+};
+
+void QmlRenderBenchmark::render_frames_data() {
+    QTest::addColumn<QSGRendererInterface::GraphicsApi>("api");
+    QTest::newRow("null") << QSGRendererInterface::Null;
+    QTest::newRow("opengl") << QSGRendererInterface::OpenGL;
+    QTest::newRow("vulkan") << QSGRendererInterface::Vulkan;
+    QTest::newRow("d3d11") << QSGRendererInterface::Direct3D11;
+    QTest::newRow("metal") << QSGRendererInterface::Metal;
+}
+
+void QmlRenderBenchmark::render_frames() {
+    QFETCH(QSGRendererInterface::GraphicsApi, api);
+    QQuickWindow::setGraphicsApi(api);
+
+#if QT_CONFIG(vulkan)
+    QVulkanInstance vulkan;  // outlives the window
+#endif
+    QQuickRenderControl renderControl;
+    QQuickWindow window(&renderControl);
+#if QT_CONFIG(vulkan)
+    if (api == QSGRendererInterface::Vulkan) {
+        if (!vulkan.create()) {
+            QSKIP("No Vulkan instance");
+        }
+        window.setVulkanInstance(&vulkan);
+    }
+#else
+    if (api == QSGRendererInterface::Vulkan) {
+        QSKIP("Qt was built without Vulkan");
+    }
+#endif
+    if (!renderControl.initialize()) {
+        QSKIP("Backend not available here");
+    }
+
+    // Main.qml's root is an ApplicationWindow; its items move into the
+    // render-controlled window, and the original is never shown.
+    QQmlEngine engine;
+    QQmlComponent component(&engine, QStringLiteral("Sample"), QStringLiteral("Main"));
+    const std::unique_ptr<QObject> root(component.createWithInitialProperties({{QStringLiteral("visible"), false}}));
+    auto *mainWindow = qobject_cast<QQuickWindow *>(root.get());
+    QVERIFY2(mainWindow, qPrintable(component.errorString()));
+    const QSize size = mainWindow->size();
+    window.resize(size);
+    window.contentItem()->setSize(size);
+    const QList<QQuickItem *> items = mainWindow->contentItem()->childItems();
+    for (QQuickItem *item : items) {
+        item->setParentItem(window.contentItem());
+    }
+    auto *nameField = window.contentItem()->findChild<QQuickItem *>(QStringLiteral("nameField"));
+    QVERIFY(nameField);
+
+    QRhi *rhi = renderControl.rhi();
+    QVERIFY(rhi);
+    const std::unique_ptr<QRhiTexture> texture(
+        rhi->newTexture(QRhiTexture::RGBA8, size, 1, QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource));
+    QVERIFY(texture->create());
+    const std::unique_ptr<QRhiRenderBuffer> depthStencil(
+        rhi->newRenderBuffer(QRhiRenderBuffer::DepthStencil, size, 1));
+    QVERIFY(depthStencil->create());
+    QRhiTextureRenderTargetDescription description{QRhiColorAttachment(texture.get())};
+    description.setDepthStencilBuffer(depthStencil.get());
+    const std::unique_ptr<QRhiTextureRenderTarget> target(rhi->newTextureRenderTarget(description));
+    const std::unique_ptr<QRhiRenderPassDescriptor> renderPass(target->newCompatibleRenderPassDescriptor());
+    target->setRenderPassDescriptor(renderPass.get());
+    QVERIFY(target->create());
+    window.setRenderTarget(QQuickRenderTarget::fromRhiRenderTarget(target.get()));
+
+    QString typed;
+    const auto renderFrame = [&] {
+        typed += QLatin1Char(typed.size() % 8 == 7 ? ' ' : char('a' + typed.size() % 26));
+        if (typed.size() > 40) {
+            typed.clear();
+        }
+        nameField->setProperty("text", typed);
+        renderControl.polishItems();
+        renderControl.beginFrame();
+        renderControl.sync();
+        renderControl.render();
+        renderControl.endFrame();
+    };
+    renderFrame();  // builds the scene graph and pipelines
+
+    const int frames = frameCount();
+    QElapsedTimer clock;
+    clock.start();
+    for (int frame = 0; frame < frames; ++frame) {
+        renderFrame();
+    }
+    const double seconds = static_cast<double>(clock.nsecsElapsed()) / 1e9;
+    qInfo("%s: %d frames in %.3f s", rhi->backendName(), frames, seconds);
+    QTest::setBenchmarkResult(frames / seconds, QTest::FramesPerSecond);
+
+    // Release the scene graph while the texture it renders into exists.
+    renderControl.invalidate();
+    window.setRenderTarget(QQuickRenderTarget());
+}
+
+QTEST_MAIN(QmlRenderBenchmark)
+#include "qml_render_benchmark.moc"
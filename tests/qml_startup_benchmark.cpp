@@ -0,0 +1,69 @@
+#include <QtTest>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QTemporaryDir>
+#include <QtQml/qqmlextensionplugin.h>
+
+#include <memory>
+
+Q_IMPORT_QML_PLUGIN(SamplePlugin)
+
+// Time to first window for Main.qml: from the Sample module, whose QML was
+// compiled at build time, and from a source copy the engine must parse and
+// compile itself. Each iteration uses a fresh engine, as a launch would.
+class QmlStartupBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void load_compiled_module();
+    void load_from_source();
+
+private:
+    void create(QQmlComponent &component);
+
+    QTemporaryDir dir_;
+    QUrl sourceUrl_;
+};
+
+void QmlStartupBenchmark::initTestCase() {
+    // Keep compiled-in units but skip the .qmlc disk cache, or every
+    // source load after the first would be a cache hit.
+    qputenv("QML_DISK_CACHE", "aot");
+
+    QFile main(QFINDTESTDATA("../qml/Main.qml"));
+    QVERIFY(main.open(QIODevice::ReadOnly));
+    QByteArray source = main.readAll();
+    // Outside the module, the Greeter singleton has to be imported.
+    source.prepend("import Sample\n");
+
+    QVERIFY(dir_.isValid());
+    QFile copy(dir_.filePath(QStringLiteral("Main.qml")));
+    QVERIFY(copy.open(QIODevice::WriteOnly));
+    QCOMPARE(copy.write(source), qint64(source.size()));
+    sourceUrl_ = QUrl::fromLocalFile(copy.fileName());
+}
+
+void QmlStartupBenchmark::create(QQmlComponent &component) {
+    const std::unique_ptr<QObject> window(component.create());
+    QVERIFY2(window, qPrintable(component.errorString()));
+}
+
+void QmlStartupBenchmark::load_compiled_module() {
+    QBENCHMARK {
+        QQmlEngine engine;
+        QQmlComponent component(&engine, QStringLiteral("Sample"), QStringLiteral("Main"));
+        create(component);
+    }
+}
+
+void QmlStartupBenchmark::load_from_source() {
+    QBENCHMARK {
+        QQmlEngine engine;
+        QQmlComponent component(&engine, sourceUrl_);
+        create(component);
+    }
+}
+
+QTEST_MAIN(QmlStartupBenchmark)
+#include "qml_startup_benchmark.moc"
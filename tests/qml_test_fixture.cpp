@@ -0,0 +1,76 @@
+#include "qml_test_fixture.h"
+
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QQmlComponent>
+#include <QQuickWindow>
+#include <QTest>
+
+namespace {
+
+QmlTestFixture *fixture = nullptr;
+
+}  // namespace
+
+QmlTestFixture &QmlTestFixture::instance() {
+    if (!fixture) {
+        fixture = new QmlTestFixture;
+        // Post routines run while the application still exists, as the
+        // engine's destruction needs.
+        qAddPostRoutine([] {
+            delete fixture;
+            fixture = nullptr;
+        });
+    }
+    return *fixture;
+}
+
+QQmlComponent *QmlTestFixture::component(const QString &uri, const QString &typeName) {
+    const QString key = uri + QLatin1Char('/') + typeName;
+    if (QQmlComponent *cached = components_.value(key)) {
+        return cached;
+    }
+    auto *component = new QQmlComponent(&engine_, uri, typeName, &engine_);
+    if (component->isError()) {
+        qWarning("%s", qPrintable(component->errorString()));
+        delete component;
+        return nullptr;
+    }
+    components_.insert(key, component);
+    return component;
+}
+
+QObject *QmlTestFixture::create(const QString &uri, const QString &typeName, const QVariantMap &properties) {
+    QQmlComponent *type = component(uri, typeName);
+    if (!type) {
+        return nullptr;
+    }
+    QObject *object = type->createWithInitialProperties(properties);
+    if (!object) {
+        qWarning("%s", qPrintable(type->errorString()));
+        return nullptr;
+    }
+    created_.emplace_back(object);
+    return object;
+}
+
+void QmlTestFixture::reset() {
+    for (const QPointer<QObject> &object : created_) {
+        delete object.data();
+    }
+    created_.clear();
+    // Let deleteLater()s from the destroyed items run now rather than
+    // pile up over the test cases.
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    engine_.collectGarbage();
+}
+
+bool QmlTestFixture::show(QQuickWindow *window) {
+    window->show();
+    return isOffscreen() ? QTest::qWaitForWindowExposed(window) : QTest::qWaitForWindowActive(window);
+}
+
+bool QmlTestFixture::isOffscreen() {
+    const QString platform = QGuiApplication::platformName();
+    return platform == QLatin1String("offscreen") || platform == QLatin1String("minimal");
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QHash>
+#include <QPointer>
+#include <QQmlEngine>
+#include <QString>
+#include <QVariantMap>
+#include <vector>
+
+class QQmlComponent;
+class QQuickWindow;
+
+// One QML engine for a whole test binary, so test cases share its imports,
+// type registrations and compiled components instead of paying for them
+// each time. Test cases create what they need with create() and call
+// reset() in cleanup(), which destroys those objects but keeps the engine
+// warm. Singletons live as long as the engine, so tests must not assume
+// a fresh one.
+//
+// Under the offscreen or minimal QPA (ctest sets offscreen for
+// qml_view_tests) show() waits only for exposure; no window manager has to
+// activate anything.
+class QmlTestFixture {
+public:
+    // Created on first use, after the QGuiApplication; destroyed with it.
+    static QmlTestFixture &instance();
+
+    QQmlEngine &engine() { return engine_; }
+
+    // uri's typeName, compiled on the first call and cached after. Null,
+    // with a warning, if it does not compile.
+    QQmlComponent *component(const QString &uri, const QString &typeName);
+    // A new instance of uri's typeName with properties set first, e.g.
+    // {"visible", false} to show a window later. Owned by the fixture until
+    // reset().
+    QObject *create(const QString &uri, const QString &typeName, const QVariantMap &properties = {});
+    // Destroys everything create() made since the last reset.
+    void reset();
+
+    // Shows window and waits until input can be sent to it.
+    static bool show(QQuickWindow *window);
+    static bool isOffscreen();
+
+private:
+    QmlTestFixture() = default;
+
+    QQmlEngine engine_;
+    QHash<QString, QQmlComponent *> components_;  // children of engine_
+    std::vector<QPointer<QObject>> created_;
+};
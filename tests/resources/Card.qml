@@ -0,0 +1,6 @@
+Rectangle {
+    color: "blue"
+    Text {
+        text: "card"
+    }
+}
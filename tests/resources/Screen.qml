@@ -0,0 +1,17 @@
+Column {
+    id: column
+    Card {
+        id: first
+        color: "red"
+    }
+    Card {
+        id: second
+        color: "green"
+    }
+    Text {
+        text: "Compressed resources are inflated on each read"
+    }
+    Text {
+        text: "Uncompressed resources are parsed in place"
+    }
+}
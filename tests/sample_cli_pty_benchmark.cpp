@@ -0,0 +1,457 @@
+#include <QtTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#if defined(Q_OS_MACOS)
+#include <util.h>
+#elif defined(Q_OS_FREEBSD)
+#include <libutil.h>
+#else
+#include <pty.h>
+#endif
+#endif
+
+namespace {
+
+constexpr int kColumns = 80;
+constexpr int kRows = 24;
+constexpr int kStartups = 5;
+constexpr int kOutputTimeoutMs = 3000;
+// Output that pauses this long is taken to be one whole update.
+constexpr int kQuietMs = 25;
+
+// Digits only: the letters and punctuation of the DEC line-drawing set may
+// turn up as text wherever a frame is drawn.
+constexpr char kTypedKeys[] = "123456789";
+constexpr char kBackspace = 0x7f;
+constexpr char kEscape = 0x1b;
+
+// Rounds of typing a digit and erasing it; SAMPLE_CLI_PTY_ROUNDS overrides it.
+int rounds() {
+    const int requested = qEnvironmentVariableIntValue("SAMPLE_CLI_PTY_ROUNDS");
+    return requested > 0 ? requested : 100;
+}
+
+QString sampleCliPath() {
+    const QString overridden = qEnvironmentVariable("SAMPLE_CLI");
+    return !overridden.isEmpty() ? overridden : QStringLiteral(SAMPLE_CLI_PATH);
+}
+
+const char kDocument[] = R"(ApplicationWindow {
+    title: "PTY benchmark"
+    Column {
+        Text { text: "Type digits below" }
+        TextField { focus: true; placeholderText: "digits" }
+    }
+}
+)";
+
+// The text a terminal would show from an output stream, in arrival order:
+// control characters and escape sequences (CSI, OSC, DCS and the rest) are
+// dropped, across chunk boundaries.
+class VtText {
+public:
+    void feed(const std::string &bytes) {
+        for (const char ch : bytes) {
+            const auto byte = static_cast<unsigned char>(ch);
+            switch (state_) {
+            case State::Text:
+                if (byte == 0x1b) {
+                    state_ = State::Escape;
+                } else if (byte >= 0x20 && byte != 0x7f) {
+                    text_.push_back(ch);
+                }
+                break;
+            case State::Escape:
+                if (byte == '[') {
+                    state_ = State::Csi;
+                } else if (byte == ']' || byte == 'P' || byte == '_' || byte == '^') {
+                    state_ = State::String;
+                } else if (byte < 0x20 || byte > 0x2f) {  // past any intermediates
+                    state_ = State::Text;
+                }
+                break;
+            case State::Csi:
+                if (byte >= 0x40 && byte <= 0x7e) {
+                    state_ = State::Text;
+                }
+                break;
+            case State::String:
+                if (byte == 0x07) {
+                    state_ = State::Text;
+                } else if (byte == 0x1b) {
+                    state_ = State::StringEscape;
+                }
+                break;
+            case State::StringEscape:
+                state_ = byte == '\\' ? State::Text : State::String;
+                break;
+            }
+        }
+    }
+
+    const std::string &text() const { return text_; }
+
+private:
+    enum class State { Text, Escape, Csi, String, StringEscape };
+
+    State state_ = State::Text;
+    std::string text_;
+};
+
+// A child process on a pseudo-terminal of its own: forkpty() on POSIX,
+// ConPTY on Windows. read() returns what arrives within a timeout, empty
+// when nothing did or the child has gone.
+class PtyProcess {
+public:
+    PtyProcess() = default;
+    PtyProcess(const PtyProcess &) = delete;
+    PtyProcess &operator=(const PtyProcess &) = delete;
+    ~PtyProcess() { finish(0); }
+
+    bool start(const QString &program, const QStringList &arguments);
+    bool write(const std::string &bytes);
+    std::string read(int timeoutMs);
+    // Waits up to graceMs for the child to exit and kills it after that;
+    // true if it exited by itself.
+    bool finish(int graceMs);
+
+private:
+#if defined(Q_OS_WIN)
+    HANDLE input_ = INVALID_HANDLE_VALUE;
+    HANDLE output_ = INVALID_HANDLE_VALUE;
+    HPCON console_ = nullptr;
+    HANDLE process_ = nullptr;
+#else
+    int master_ = -1;
+    pid_t pid_ = -1;
+#endif
+};
+
+#if defined(Q_OS_WIN)
+
+bool PtyProcess::start(const QString &program, const QStringList &arguments) {
+    HANDLE inputRead = INVALID_HANDLE_VALUE;
+    HANDLE outputWrite = INVALID_HANDLE_VALUE;
+    if (!CreatePipe(&inputRead, &input_, nullptr, 0) || !CreatePipe(&output_, &outputWrite, nullptr, 0)) {
+        return false;
+    }
+    const HRESULT created =
+        CreatePseudoConsole(COORD{kColumns, kRows}, inputRead, outputWrite, 0, &console_);
+    // The pseudo-console holds its own copies.
+    CloseHandle(inputRead);
+    CloseHandle(outputWrite);
+    if (FAILED(created)) {
+        console_ = nullptr;
+        return false;
+    }
+
+    SIZE_T attributeBytes = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeBytes);
+    std::vector<char> attributes(attributeBytes);
+    STARTUPINFOEXW startup{};
+    startup.StartupInfo.cb = sizeof startup;
+    startup.lpAttributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributes.data());
+    if (!InitializeProcThreadAttributeList(startup.lpAttributeList, 1, 0, &attributeBytes) ||
+        !UpdateProcThreadAttribute(startup.lpAttributeList, 0, PROC_THREAD_ATTRIBUTE_PSEUDOCONSOLE, console_,
+                                   sizeof console_, nullptr, nullptr)) {
+        return false;
+    }
+    QStringList quoted;
+    for (const QString &argument : QStringList{QDir::toNativeSeparators(program)} + arguments) {
+        quoted << QLatin1Char('"') + argument + QLatin1Char('"');
+    }
+    std::wstring commandLine = quoted.join(QLatin1Char(' ')).toStdWString();
+    PROCESS_INFORMATION process{};
+    const BOOL started = CreateProcessW(nullptr, commandLine.data(), nullptr, nullptr, FALSE,
+                                        EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &startup.StartupInfo, &process);
+    DeleteProcThreadAttributeList(startup.lpAttributeList);
+    if (!started) {
+        return false;
+    }
+    CloseHandle(process.hThread);
+    process_ = process.hProcess;
+    return true;
+}
+
+bool PtyProcess::write(const std::string &bytes) {
+    DWORD written = 0;
+    return WriteFile(input_, bytes.data(), static_cast<DWORD>(bytes.size()), &written, nullptr) &&
+           written == bytes.size();
+}
+
+std::string PtyProcess::read(int timeoutMs) {
+    // Anonymous pipes cannot be waited on, so this polls.
+    QElapsedTimer clock;
+    clock.start();
+    DWORD available = 0;
+    while (PeekNamedPipe(output_, nullptr, 0, nullptr, &available, nullptr) && available == 0) {
+        if (clock.elapsed() >= timeoutMs) {
+            return {};
+        }
+        Sleep(1);
+    }
+    std::string bytes(available, '\0');
+    DWORD got = 0;
+    if (available == 0 || !ReadFile(output_, bytes.data(), available, &got, nullptr)) {
+        return {};
+    }
+    bytes.resize(got);
+    return bytes;
+}
+
+bool PtyProcess::finish(int graceMs) {
+    bool exited = true;
+    if (process_ != nullptr) {
+        exited = WaitForSingleObject(process_, static_cast<DWORD>(graceMs)) == WAIT_OBJECT_0;
+        if (!exited) {
+            TerminateProcess(process_, 1);
+            WaitForSingleObject(process_, INFINITE);
+        }
+        CloseHandle(process_);
+        process_ = nullptr;
+    }
+    // Closing the output first keeps ClosePseudoConsole() from waiting for
+    // it to be drained.
+    for (HANDLE *pipe : {&output_, &input_}) {
+        if (*pipe != INVALID_HANDLE_VALUE) {
+            CloseHandle(*pipe);
+            *pipe = INVALID_HANDLE_VALUE;
+        }
+    }
+    if (console_ != nullptr) {
+        ClosePseudoConsole(console_);
+        console_ = nullptr;
+    }
+    return exited;
+}
+
+#else
+
+bool PtyProcess::start(const QString &program, const QStringList &arguments) {
+    // Everything the child needs is built before fork().
+    std::vector<QByteArray> encoded{QFile::encodeName(program)};
+    for (const QString &argument : arguments) {
+        encoded.push_back(argument.toLocal8Bit());
+    }
+    std::vector<char *> argv;
+    for (QByteArray &argument : encoded) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    winsize size{};
+    size.ws_col = kColumns;
+    size.ws_row = kRows;
+    pid_ = forkpty(&master_, nullptr, nullptr, &size);
+    if (pid_ == 0) {
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    return pid_ > 0;
+}
+
+bool PtyProcess::write(const std::string &bytes) {
+    return ::write(master_, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size());
+}
+
+std::string PtyProcess::read(int timeoutMs) {
+    pollfd ready{master_, POLLIN, 0};
+    if (poll(&ready, 1, timeoutMs) <= 0) {
+        return {};
+    }
+    char buffer[65536];
+    // Linux fails with EIO once the child has closed the terminal.
+    const ssize_t got = ::read(master_, buffer, sizeof buffer);
+    return got > 0 ? std::string(buffer, static_cast<size_t>(got)) : std::string();
+}
+
+bool PtyProcess::finish(int graceMs) {
+    bool exited = true;
+    if (pid_ > 0) {
+        QElapsedTimer clock;
+        clock.start();
+        int status = 0;
+        while (waitpid(pid_, &status, WNOHANG) == 0) {
+            if (clock.elapsed() >= graceMs) {
+                kill(pid_, SIGKILL);
+                waitpid(pid_, &status, 0);
+                exited = false;
+                break;
+            }
+            // Drained, so a child writing its last frame is not held up.
+            read(10);
+        }
+        pid_ = -1;
+    }
+    if (master_ >= 0) {
+        close(master_);
+        master_ = -1;
+    }
+    return exited;
+}
+
+#endif
+
+double percentileOf(std::vector<double> sorted, double percentile) {
+    std::sort(sorted.begin(), sorted.end());
+    const size_t rank = std::min(sorted.size() - 1, static_cast<size_t>(percentile * (sorted.size() - 1) + 0.5));
+    return sorted[rank];
+}
+
+}  // namespace
+
+// Runs the real sample_cli on a pseudo-terminal, so the whole curses output
+// path is measured: terminfo, ncurses' screen diffing and the terminal
+// write. Reports, as benchmark results, the time from spawn to the first
+// complete frame (the median of kStartups runs), the time from a keystroke
+// to the first output showing it (p50, p95 and p99) and the bytes written
+// per update. The binary is the one built beside this benchmark, or
+// SAMPLE_CLI.
+class SampleCliPtyBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void first_frame();
+    void keystroke_latency_data();
+    void keystroke_latency();
+    void bytes_per_update_data();
+    void bytes_per_update();
+
+private:
+    bool start(PtyProcess &process);
+    // Reads until the text shown since the call contains needle; the bytes
+    // read, or empty on a timeout.
+    std::string readUntil(PtyProcess &process, const std::string &needle);
+    // Reads until the output pauses; the number of bytes.
+    size_t drain(PtyProcess &process);
+
+    QTemporaryDir dir_;
+    QString documentPath_;
+    std::vector<double> firstFrameMs_;
+    std::vector<double> latencyMs_;
+    std::vector<double> updateBytes_;
+};
+
+void SampleCliPtyBenchmark::initTestCase() {
+    QVERIFY2(QFileInfo::exists(sampleCliPath()), qPrintable(sampleCliPath() + QStringLiteral(" does not exist")));
+    QVERIFY(dir_.isValid());
+    documentPath_ = dir_.filePath(QStringLiteral("PtyBenchmark.qml"));
+    QFile document(documentPath_);
+    QVERIFY(document.open(QIODevice::WriteOnly));
+    document.write(kDocument);
+    document.close();
+    // forkpty() children inherit it; ConPTY always speaks VT.
+    qputenv("TERM", "xterm-256color");
+
+    // The status line is drawn last, so it marks a complete first frame.
+    const std::string statusLine = "Esc exits";
+    for (int run = 0; run < kStartups; ++run) {
+        PtyProcess process;
+        QElapsedTimer clock;
+        clock.start();
+        QVERIFY(start(process));
+        QVERIFY2(!readUntil(process, statusLine).empty(), "no first frame");
+        firstFrameMs_.push_back(static_cast<double>(clock.nsecsElapsed()) / 1e6);
+        process.finish(0);  // Esc would wait out ncurses' ESCDELAY
+    }
+
+    PtyProcess process;
+    QVERIFY(start(process));
+    QVERIFY2(!readUntil(process, statusLine).empty(), "no first frame");
+    drain(process);
+    for (int round = 0, total = rounds(); round < total; ++round) {
+        const char key = kTypedKeys[round % (sizeof kTypedKeys - 1)];
+        QElapsedTimer clock;
+        clock.start();
+        QVERIFY(process.write(std::string(1, key)));
+        const std::string shown = readUntil(process, std::string(1, key));
+        QVERIFY2(!shown.empty(), "a typed key never showed");
+        latencyMs_.push_back(static_cast<double>(clock.nsecsElapsed()) / 1e6);
+        updateBytes_.push_back(static_cast<double>(shown.size() + drain(process)));
+
+        QVERIFY(process.write(std::string(1, kBackspace)));
+        const size_t erased = drain(process);
+        QVERIFY2(erased > 0, "Backspace drew nothing");
+        updateBytes_.push_back(static_cast<double>(erased));
+    }
+    QVERIFY(process.write(std::string(1, kEscape)));
+    QVERIFY2(process.finish(kOutputTimeoutMs), "sample_cli did not exit on Esc");
+}
+
+bool SampleCliPtyBenchmark::start(PtyProcess &process) {
+    return process.start(sampleCliPath(), {documentPath_});
+}
+
+std::string SampleCliPtyBenchmark::readUntil(PtyProcess &process, const std::string &needle) {
+    VtText shown;
+    std::string bytes;
+    QElapsedTimer clock;
+    clock.start();
+    while (shown.text().find(needle) == std::string::npos) {
+        const qint64 left = kOutputTimeoutMs - clock.elapsed();
+        const std::string chunk = left > 0 ? process.read(static_cast<int>(left)) : std::string();
+        if (chunk.empty()) {
+            return {};
+        }
+        shown.feed(chunk);
+        bytes += chunk;
+    }
+    return bytes;
+}
+
+size_t SampleCliPtyBenchmark::drain(PtyProcess &process) {
+    size_t bytes = 0;
+    for (std::string chunk = process.read(kQuietMs); !chunk.empty(); chunk = process.read(kQuietMs)) {
+        bytes += chunk.size();
+    }
+    return bytes;
+}
+
+void SampleCliPtyBenchmark::first_frame() {
+    const double median = percentileOf(firstFrameMs_, 0.5);
+    qInfo("first frame after %.1f ms (median of %d starts)", median, kStartups);
+    QTest::setBenchmarkResult(median, QTest::WalltimeMilliseconds);
+}
+
+void SampleCliPtyBenchmark::keystroke_latency_data() {
+    QTest::addColumn<double>("percentile");
+    QTest::newRow("p50") << 0.50;
+    QTest::newRow("p95") << 0.95;
+    QTest::newRow("p99") << 0.99;
+}
+
+void SampleCliPtyBenchmark::keystroke_latency() {
+    QFETCH(double, percentile);
+    QTest::setBenchmarkResult(percentileOf(latencyMs_, percentile), QTest::WalltimeMilliseconds);
+}
+
+void SampleCliPtyBenchmark::bytes_per_update_data() {
+    QTest::addColumn<double>("percentile");
+    QTest::newRow("p50") << 0.50;
+    QTest::newRow("max") << 1.0;
+}
+
+void SampleCliPtyBenchmark::bytes_per_update() {
+    QFETCH(double, percentile);
+    QTest::setBenchmarkResult(percentileOf(updateBytes_, percentile), QTest::BytesAllocated);
+}
+
+QTEST_GUILESS_MAIN(SampleCliPtyBenchmark)
+#include "sample_cli_pty_benchmark.moc"
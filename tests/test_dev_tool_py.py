@@ -1,11 +1,40 @@
+import hashlib
+import io
+import json
+import os
+import socket
+import subprocess
 import tempfile
+import threading
+import types
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
 from pathlib import Path
 from unittest import TestCase, mock
 
 import dev_tool
+from python.dev_tool import bench
+from python.dev_tool import build_times
+from python.dev_tool import impacted
+from python.dev_tool import profile
+from python.dev_tool import probe_cache
+from python.dev_tool import project
+from python.dev_tool import qml
+from python.dev_tool import qt
+from python.dev_tool import startup
+from python.dev_tool import utils
+from python.dev_tool.project import run_tests
+from python.download_qt6 import downloader
+from python.download_qt6.archive_cache import ArchiveCache, CachingMirror
 
 
 class DevToolCLITests(TestCase):
+    def setUp(self) -> None:
+        # Keep probe results from the real settings directory out of the tests.
+        no_probe_cache = mock.patch.dict("os.environ", {"DEV_TOOL_NO_PROBE_CACHE": "1"})
+        no_probe_cache.start()
+        self.addCleanup(no_probe_cache.stop)
+
     def test_default_no_args_uses_menu_when_tty(self) -> None:
         with tempfile.TemporaryDirectory() as tmp:
             tmp_path = Path(tmp)
@@ -69,3 +98,662 @@ class DevToolCLITests(TestCase):
             mock.patch("dev_tool.resolve_qt_prefix", return_value=Path("/qt")):
             result = dev_tool.main(["verify"])
         self.assertEqual(result, 0)
+
+    def test_run_tests_is_parallel_by_default(self) -> None:
+        with mock.patch("python.dev_tool.project.run_command") as run_cmd:
+            run_tests(Path("build"), None, "Debug", None, [])
+            run_tests(Path("build"), None, "Debug", None, ["-j2"])
+
+        default_ctest = run_cmd.call_args_list[0].args[0]
+        self.assertEqual(default_ctest[:3], ["ctest", "--test-dir", "build"])
+        self.assertIn("--parallel", default_ctest)
+        explicit_ctest = run_cmd.call_args_list[1].args[0]
+        self.assertNotIn("--parallel", explicit_ctest)
+        self.assertEqual(explicit_ctest[-1], "-j2")
+
+    def test_bench_parses_qtest_xml(self) -> None:
+        xml = """<?xml version="1.0" encoding="UTF-8"?>
+<TestCase name="QmlParserBenchmark">
+<TestFunction name="parse_throughput">
+<BenchmarkResult metric="BytesPerSecond" tag="small" value="1.5e+08" iterations="16" />
+<BenchmarkResult metric="BytesPerSecond" tag="huge" value="2.5e+08" iterations="1" />
+</TestFunction>
+<TestFunction name="find_by_id">
+<BenchmarkResult metric="WalltimeMilliseconds" tag="" value="0.25" iterations="64" />
+</TestFunction>
+</TestCase>"""
+        self.assertEqual(
+            bench.parse_benchmark_xml(xml),
+            {
+                "parse_throughput/small": ("BytesPerSecond", 1.5e8),
+                "parse_throughput/huge": ("BytesPerSecond", 2.5e8),
+                "find_by_id": ("WalltimeMilliseconds", 0.25),
+            },
+        )
+        self.assertEqual(bench.summarize([10.0, 11.0, 9.0, 30.0, 10.0]), {"median": 10.0, "mad": 1.0, "runs": 5})
+
+    def test_bench_reports_regressions_past_threshold_and_noise(self) -> None:
+        def results(**entries: tuple[str, float, float]) -> dict:
+            return {
+                "results": {
+                    key: {"metric": metric, "median": median, "mad": mad, "runs": 5}
+                    for key, (metric, median, mad) in entries.items()
+                }
+            }
+
+        baseline = results(
+            slower=("WalltimeMilliseconds", 10.0, 0.1),
+            noisy=("WalltimeMilliseconds", 10.0, 1.0),
+            small=("WalltimeMilliseconds", 10.0, 0.01),
+            throughput=("BytesPerSecond", 100.0, 1.0),
+            faster=("WalltimeMilliseconds", 10.0, 0.1),
+        )
+        current = results(
+            slower=("WalltimeMilliseconds", 12.0, 0.1),
+            noisy=("WalltimeMilliseconds", 12.0, 1.0),  # within 3 sigma of its jitter
+            small=("WalltimeMilliseconds", 10.3, 0.01),  # under the 5% threshold
+            throughput=("BytesPerSecond", 80.0, 1.0),
+            faster=("WalltimeMilliseconds", 5.0, 0.1),
+            added=("WalltimeMilliseconds", 1.0, 0.1),
+        )
+        regressions = bench.compare(current, baseline, threshold_percent=5.0)
+        self.assertEqual([regression.key for regression in regressions], ["slower", "throughput"])
+
+    def test_bench_stores_results_and_fails_on_regression(self) -> None:
+        def run(medians: dict[str, float]) -> dict:
+            return {
+                "results": {
+                    key: {"metric": "WalltimeMilliseconds", "median": median, "mad": 0.0, "runs": 3}
+                    for key, median in medians.items()
+                }
+            }
+
+        with tempfile.TemporaryDirectory() as tmp:
+            results_dir = Path(tmp)
+            exe = results_dir / "sample_benchmarks"
+            with mock.patch.object(bench, "machine_id", return_value="box"), \
+                mock.patch.object(bench, "commit_id", side_effect=["aaa", "bbb", "ccc"]), \
+                mock.patch.object(bench, "run_benchmarks", side_effect=[
+                    run({"parse": 1.0}), run({"parse": 1.02}), run({"parse": 2.0})
+                ]):
+                first = bench.bench(exe, results_dir, results_dir, 3, 5.0, None, True, [])
+                steady = bench.bench(exe, results_dir, results_dir, 3, 5.0, None, False, [])
+                slower = bench.bench(exe, results_dir, results_dir, 3, 5.0, "aaa", False, [])
+
+            self.assertEqual((first, steady, slower), (0, 0, 1))
+            stored = json.loads((results_dir / "box" / "ccc.json").read_text(encoding="utf-8"))
+            self.assertEqual(stored["commit"], "ccc")
+            self.assertEqual(stored["results"]["parse"]["median"], 2.0)
+            self.assertTrue((results_dir / "box" / "baseline.json").is_file())
+
+    def test_bench_stable_reads_the_benchmark_report(self) -> None:
+        report = {
+            "environment": {"host": "box", "mainCpu": 3},
+            "results": {"parse": {"metric": "WalltimeMilliseconds", "mean": 1.0, "ci95": 0.01,
+                                  "median": 1.0, "mad": 0.0, "runs": 6}},
+        }
+        launched: list[list[str]] = []
+
+        def fake_run(command: list[str], check: bool) -> None:
+            launched.append(command)
+            Path(command[command.index("--report") + 1]).write_text(json.dumps(report), encoding="utf-8")
+
+        with tempfile.TemporaryDirectory() as tmp:
+            results_dir = Path(tmp)
+            exe = results_dir / "sample_benchmarks"
+            with mock.patch.object(bench, "machine_id", return_value="box"), \
+                mock.patch.object(bench, "commit_id", return_value="aaa"), \
+                mock.patch.object(bench.subprocess, "run", side_effect=fake_run):
+                status = bench.bench(exe, results_dir, results_dir, 5, 5.0, None, False, ["parse"], stable=True)
+
+            self.assertEqual(status, 0)
+            self.assertEqual(launched, [[str(exe), "--stable", "--report", launched[0][3], "parse"]])
+            stored = json.loads((results_dir / "box" / "aaa.json").read_text(encoding="utf-8"))
+            self.assertTrue(stored["stable"])
+            self.assertEqual(stored["environment"]["mainCpu"], 3)
+            self.assertEqual(stored["results"]["parse"]["runs"], 6)
+
+    def test_bench_startup_runs_cold_and_warm(self) -> None:
+        launches: list[tuple[list[str], dict[str, str], bool]] = []
+
+        def fake_launch(command: list[str], env: dict[str, str], terminal: bool) -> None:
+            launches.append((command, env, terminal))
+            ms = 100.0 * len(launches)
+            report = {"unit": "ms", "phases": [{"phase": "load", "ms": ms / 2}, {"phase": "firstFrame", "ms": ms}]}
+            Path(command[command.index("--startup-timing") + 1]).write_text(json.dumps(report), encoding="utf-8")
+
+        with mock.patch.object(startup, "launch", side_effect=fake_launch), \
+            mock.patch("sys.stdout", new=io.StringIO()) as out:
+            cold = startup.run_startup("sample_cli", Path("sample_cli"), 2, "cold", ["Main.qml"])
+            warm = startup.run_startup("sample_app", Path("sample_app"), 2, "warm", [])
+            startup.bench_startup({}, 1, None, [])
+
+        self.assertEqual([run["firstFrame"] for run in cold], [100.0, 200.0])
+        # The warm priming run is not reported.
+        self.assertEqual([run["firstFrame"] for run in warm], [400.0, 500.0])
+        cli_dirs = [command[command.index("--cache-dir") + 1] for command, _, _ in launches[:2]]
+        app_dirs = [command[command.index("--pipeline-cache-dir") + 1] for command, _, _ in launches[2:]]
+        self.assertNotEqual(cli_dirs[0], cli_dirs[1])
+        self.assertEqual(len(set(app_dirs)), 1)
+        self.assertEqual(launches[0][0][-1], "Main.qml")
+        self.assertTrue(launches[0][2])
+        self.assertFalse(launches[2][2])
+        self.assertIn("QML_DISK_CACHE_PATH", launches[2][1])
+        self.assertIn("target", out.getvalue())
+
+        report = startup.format_startup_report([("sample_cli", "cold", cold)])
+        self.assertEqual([line.split()[2] for line in report.splitlines()[1:]], ["load", "firstFrame"])
+        self.assertEqual(
+            startup.summarize_startup([100.0, 200.0]),
+            {"mean": 150.0, "median": 150.0, "stdev": 70.71067811865476, "min": 100.0, "max": 200.0},
+        )
+
+    def test_configure_is_skipped_while_inputs_are_unchanged(self) -> None:
+        def fake_configure(cmd: list[str]) -> None:
+            build_dir = Path(cmd[cmd.index("-B") + 1])
+            (build_dir / "CMakeCache.txt").write_text("\n".join(cmd), encoding="utf-8")
+
+        with tempfile.TemporaryDirectory() as tmp:
+            build_dir = Path(tmp) / "build"
+            lists = Path(tmp) / "CMakeLists.txt"
+            lists.write_text("project(a)\n", encoding="utf-8")
+            with mock.patch.object(project, "configure_inputs", return_value=[lists]), \
+                mock.patch("python.dev_tool.project.run_command", side_effect=fake_configure) as run_cmd:
+                def configure() -> None:
+                    project.configure_project(build_dir, "Ninja", "Debug", Path("/qt"))
+
+                configure()
+                configure()
+                self.assertEqual(run_cmd.call_count, 1)
+
+                lists.write_text("project(b)\n", encoding="utf-8")
+                configure()
+                self.assertEqual(run_cmd.call_count, 2)
+
+                project.configure_project(build_dir, "Ninja", "Release", Path("/qt"))
+                self.assertEqual(run_cmd.call_count, 3)
+
+                project.configure_project(build_dir, "Ninja", "Release", Path("/qt"), reconfigure=True)
+                self.assertEqual(run_cmd.call_count, 4)
+
+    def test_configure_wires_in_compiler_cache_and_fast_linker(self) -> None:
+        programs = {"sccache": "/usr/bin/sccache", "ld.lld": "/usr/bin/ld.lld"}
+        with mock.patch.object(project.shutil, "which", side_effect=programs.get), \
+            mock.patch.object(project, "get_setting", return_value="auto"), \
+            mock.patch.object(project.sys, "platform", "linux"):
+            self.assertEqual(
+                project.build_speed_entries(),
+                [
+                    "-DCMAKE_C_COMPILER_LAUNCHER=/usr/bin/sccache",
+                    "-DCMAKE_CXX_COMPILER_LAUNCHER=/usr/bin/sccache",
+                    "-DSAMPLE_LINKER=lld",
+                ],
+            )
+        with mock.patch.object(project, "get_setting", return_value="none"):
+            self.assertEqual(project.build_speed_entries(), [])
+
+        with tempfile.TemporaryDirectory() as tmp:
+            build_dir = Path(tmp)
+            (build_dir / "CMakeCache.txt").write_text(
+                "CMAKE_CXX_COMPILER_LAUNCHER:FILEPATH=/usr/bin/sccache\n", encoding="utf-8"
+            )
+            stats = subprocess.CompletedProcess([], 0, stdout="Cache hits 12\n")
+            with mock.patch("python.dev_tool.project.run_command"), \
+                mock.patch.object(project.subprocess, "run", return_value=stats) as run, \
+                mock.patch("sys.stdout", new_callable=io.StringIO) as out:
+                project.build_targets(build_dir, "Ninja", "Debug", ["sample_cli"], None)
+            self.assertEqual(run.call_args.args[0], ["/usr/bin/sccache", "--show-stats"])
+            self.assertIn("sccache statistics:\nCache hits 12", out.getvalue())
+
+    def test_probe_results_are_cached_until_path_or_watched_files_change(self) -> None:
+        with tempfile.TemporaryDirectory() as tmp:
+            tool = Path(tmp) / "tool"
+            tool.write_text("v1", encoding="utf-8")
+            probe = mock.Mock(side_effect=["first", "second", "third", "fourth"])
+            with mock.patch.object(probe_cache, "_config_dir", return_value=Path(tmp) / "config"), \
+                mock.patch.dict("os.environ", {"PATH": "/a", "DEV_TOOL_NO_PROBE_CACHE": ""}):
+                def lookup() -> str:
+                    return probe_cache.cached_probe("tool", ["arg"], probe, lambda _: [tool])
+
+                self.assertEqual((lookup(), lookup()), ("first", "first"))
+
+                stat = tool.stat()
+                os.utime(tool, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+                self.assertEqual((lookup(), lookup()), ("second", "second"))
+
+                with mock.patch.dict("os.environ", {"PATH": "/b"}):
+                    self.assertEqual(lookup(), "third")
+
+                probe_cache.clear()
+                self.assertEqual(lookup(), "fourth")
+                self.assertEqual(probe.call_count, 4)
+
+    def test_qt_prefix_scan_is_cached_until_a_qt_is_added(self) -> None:
+        with tempfile.TemporaryDirectory() as tmp:
+            root = Path(tmp)
+            (root / "third_party" / "qt6" / "6.5.0" / "gcc_64" / "lib" / "cmake" / "Qt6").mkdir(parents=True)
+            with mock.patch.object(probe_cache, "_config_dir", return_value=root / "config"), \
+                mock.patch.object(qt, "ROOT", root), \
+                mock.patch.object(qt, "_scan_qt_prefixes", wraps=qt._scan_qt_prefixes) as scan, \
+                mock.patch.dict("os.environ", {"DEV_TOOL_NO_PROBE_CACHE": ""}):
+                first = qt.autodetect_qt_prefix()
+                self.assertEqual(qt.autodetect_qt_prefix(), first)
+                self.assertEqual(first.name, "gcc_64")
+                self.assertEqual(scan.call_count, 1)
+
+                newer = root / "third_party" / "qt6" / "6.8.0" / "gcc_64"
+                (newer / "lib" / "cmake" / "Qt6").mkdir(parents=True)
+                self.assertEqual(qt.autodetect_qt_prefix(), newer)
+                self.assertEqual(scan.call_count, 2)
+
+    def test_qml_file_listings_are_cached_per_directory_mtime(self) -> None:
+        with tempfile.TemporaryDirectory() as tmp:
+            root = Path(tmp) / "src"
+            (root / "ui" / "screens").mkdir(parents=True)
+            (root / "build").mkdir()
+            (root / "ui" / "Main.qml").write_text("Item {}", encoding="utf-8")
+            (root / "build" / "Gen.qml").write_text("Item {}", encoding="utf-8")
+            # Listings of directories changed in the last moments are not trusted yet.
+            for directory in (root, root / "ui", root / "ui" / "screens"):
+                os.utime(directory, ns=(0, directory.stat().st_mtime_ns - 10_000_000_000))
+            with mock.patch.object(probe_cache, "_config_dir", return_value=Path(tmp) / "config"), \
+                mock.patch.object(qml, "_scan_qml_dir", wraps=qml._scan_qml_dir) as scan, \
+                mock.patch.dict("os.environ", {"DEV_TOOL_NO_PROBE_CACHE": ""}):
+                self.assertEqual(qml.find_qml_files(root), [root / "ui" / "Main.qml"])
+                self.assertEqual(scan.call_count, 3)
+                self.assertEqual(qml.find_qml_files(root), [root / "ui" / "Main.qml"])
+                self.assertEqual(scan.call_count, 3)
+
+                # Only the directory that gained an entry is listed again.
+                (root / "ui" / "screens" / "Settings.qml").write_text("Item {}", encoding="utf-8")
+                self.assertEqual(
+                    qml.find_qml_files(root), [root / "ui" / "Main.qml", root / "ui" / "screens" / "Settings.qml"]
+                )
+                self.assertEqual(scan.call_count, 4)
+
+    def test_target_listing_is_cached_until_the_build_system_is_regenerated(self) -> None:
+        with tempfile.TemporaryDirectory() as tmp:
+            build_dir = Path(tmp) / "build"
+            build_dir.mkdir()
+            ninja_file = build_dir / "build.ninja"
+            ninja_file.write_text("", encoding="utf-8")
+            with mock.patch.object(probe_cache, "_config_dir", return_value=Path(tmp) / "config"), \
+                mock.patch.object(project.shutil, "which", return_value="/usr/bin/ninja"), \
+                mock.patch.object(project.subprocess, "check_output",
+                                  side_effect=["sample_app: phony\n", "sample_cli: phony\n"]) as listing, \
+                mock.patch.dict("os.environ", {"DEV_TOOL_NO_PROBE_CACHE": ""}):
+                self.assertEqual(project.list_targets_with_ninja(build_dir), ["sample_app"])
+                self.assertEqual(project.list_targets_with_ninja(build_dir), ["sample_app"])
+                self.assertEqual(listing.call_count, 1)
+
+                stat = ninja_file.stat()
+                os.utime(ninja_file, ns=(stat.st_atime_ns, stat.st_mtime_ns + 1_000_000_000))
+                self.assertEqual(project.list_targets_with_ninja(build_dir), ["sample_cli"])
+                self.assertEqual(listing.call_count, 2)
+
+    def test_qt_version_detection_probes_concurrently_and_caches_listings(self) -> None:
+        archs = {"6.9.0": "", "6.8.1": "linux_gcc_64 wasm_singlethread", "6.8.0": "linux_gcc_64"}
+
+        def aqt(cmd, **_kwargs) -> str:
+            if "--arch" in cmd:
+                output = archs[cmd[cmd.index("--arch") + 1]]
+                if not output:
+                    raise subprocess.CalledProcessError(1, cmd)
+                return output
+            return "6.8.0 6.8.1\n6.9.0\n"
+
+        with tempfile.TemporaryDirectory() as tmp:
+            cache_path = Path(tmp) / "aqt-list.json"
+
+            def detect(ttl: float) -> str:
+                return downloader.detect_latest_qt_version(
+                    host="linux", target="desktop", base_url=None, timeout=None, compiler="linux_gcc_64",
+                    list_cache=downloader.AqtListCache(cache_path, ttl),
+                )
+
+            with mock.patch.object(downloader.importlib.util, "find_spec", return_value=object()), \
+                mock.patch.object(downloader.subprocess, "check_output", side_effect=aqt) as listing:
+                self.assertEqual(detect(3600), "6.8.1")
+                calls = listing.call_count
+                self.assertEqual(detect(3600), "6.8.1")
+                self.assertEqual(listing.call_count, calls)
+
+                # Expired but unreachable: the cached answers still serve.
+                listing.side_effect = subprocess.TimeoutExpired("aqt", 1)
+                self.assertEqual(detect(0), "6.8.1")
+
+    def test_fetches_revalidate_cached_pages_over_one_connection(self) -> None:
+        page = b'<a href="6.8/">6.8/</a>'
+        connections: list[int] = []
+        conditional: list[str] = []
+
+        class Upstream(BaseHTTPRequestHandler):
+            protocol_version = "HTTP/1.1"
+
+            def log_message(self, *args) -> None:
+                pass
+
+            def setup(self) -> None:
+                super().setup()
+                connections.append(1)
+
+            def do_GET(self) -> None:
+                conditional.append(self.headers.get("If-None-Match", ""))
+                if self.headers.get("If-None-Match") == '"v1"':
+                    self.send_response(304)
+                    self.send_header("Content-Length", "0")
+                    self.end_headers()
+                    return
+                self.send_response(200)
+                self.send_header("ETag", '"v1"')
+                self.send_header("Content-Length", str(len(page)))
+                self.end_headers()
+                self.wfile.write(page)
+
+        upstream = ThreadingHTTPServer(("127.0.0.1", 0), Upstream)
+        upstream.block_on_close = False  # the kept-alive connection stays open
+        threading.Thread(target=upstream.serve_forever, daemon=True).start()
+        self.addCleanup(upstream.server_close)
+        self.addCleanup(upstream.shutdown)
+
+        url = f"http://127.0.0.1:{upstream.server_address[1]}/official_releases/qt/"
+        with tempfile.TemporaryDirectory() as tmp, \
+            mock.patch.object(probe_cache, "_config_dir", return_value=Path(tmp)):
+            self.assertEqual(utils._fetch_url(url), (page.decode(), None))
+            self.assertEqual(utils._fetch_url(url), (page.decode(), None))
+        self.assertEqual(conditional, ["", '"v1"'])
+        self.assertEqual(len(connections), 1)
+
+    def test_archive_cache_resumes_verifies_and_serves_from_cache(self) -> None:
+        archive = bytes(range(256)) * 64
+        digest = hashlib.sha256(archive).hexdigest()
+        files = {"/qt/a.7z": archive, "/qt/a.7z.sha256": f"{digest}  a.7z\n".encode()}
+        requests: list[tuple[str, str]] = []
+
+        class Upstream(BaseHTTPRequestHandler):
+            def log_message(self, *args) -> None:
+                pass
+
+            def do_GET(self) -> None:
+                body = files.get(self.path)
+                requests.append((self.path, self.headers.get("Range", "")))
+                if body is None:
+                    self.send_response(404)
+                    self.send_header("Content-Length", "0")
+                    self.end_headers()
+                    return
+                start = int(self.headers["Range"][6:-1]) if self.headers.get("Range") else 0
+                self.send_response(206 if start else 200)
+                self.send_header("Content-Length", str(len(body) - start))
+                self.end_headers()
+                self.wfile.write(body[start:])
+
+        upstream = ThreadingHTTPServer(("127.0.0.1", 0), Upstream)
+        threading.Thread(target=upstream.serve_forever, daemon=True).start()
+        self.addCleanup(upstream.server_close)
+        self.addCleanup(upstream.shutdown)
+
+        with tempfile.TemporaryDirectory() as tmp:
+            cache = ArchiveCache(Path(tmp), f"http://127.0.0.1:{upstream.server_address[1]}")
+            self.assertEqual(cache.expected_digest("/qt/a.7z"), digest)
+
+            partial = cache.partial_path(digest)
+            partial.parent.mkdir(parents=True)
+            partial.write_bytes(archive[:1000])
+            served = io.BytesIO()
+            blob = cache.fetch(digest, "/qt/a.7z", served)
+            self.assertEqual(served.getvalue(), archive)
+            self.assertEqual(blob.read_bytes(), archive)
+            self.assertIn(("/qt/a.7z", "bytes=1000-"), requests)
+            self.assertFalse(partial.exists())
+
+            requests.clear()
+            with CachingMirror(cache) as mirror:
+                with urllib.request.urlopen(mirror.url + "/qt/a.7z") as response:
+                    self.assertEqual(response.read(), archive)
+            self.assertEqual(requests, [])
+
+            blob.unlink()
+            partial.write_bytes(b"corrupt")
+            with self.assertRaises(ValueError):
+                cache.fetch(digest, "/qt/a.7z")
+            self.assertFalse(partial.exists())
+
+    def test_build_times_builds_each_variant_in_its_own_directory(self) -> None:
+        configured: list[tuple[Path, list[str]]] = []
+        with tempfile.TemporaryDirectory() as tmp:
+            source = Path(tmp) / "a.cpp"
+            source.write_text("", encoding="utf-8")
+            os.utime(source, (0, 0))
+            with mock.patch.object(build_times, "run_command") as run_cmd:
+                results = build_times.build_times(
+                    Path(tmp) / "build",
+                    ["plain", "pch+unity"],
+                    lambda directory, entries: configured.append((directory, list(entries))),
+                    lambda directory: ["cmake", "--build", str(directory)],
+                    [source],
+                )
+
+            self.assertEqual(
+                configured,
+                [
+                    (Path(tmp) / "build-plain", []),
+                    (Path(tmp) / "build-pch-unity", ["-DSAMPLE_PRECOMPILED_HEADERS=ON", "-DSAMPLE_UNITY_BUILD=ON"]),
+                ],
+            )
+            self.assertEqual(list(results), ["plain", "pch+unity"])
+            # Per variant: clean, clean build, incremental build.
+            self.assertEqual(run_cmd.call_count, 6)
+            self.assertEqual(run_cmd.call_args_list[0].args[0][-2:], ["--target", "clean"])
+            self.assertGreater(source.stat().st_mtime, 0)
+
+    def test_impacted_tests_follow_the_target_graph(self) -> None:
+        targets = {
+            "sample_support": (["src/greeter.cpp", "src/greeter.h"], []),
+            "sample_tests": (["tests/greeter_test.cpp"], ["sample_support"]),
+            "qml_view_tests": (["tests/main_qml_test.cpp"], ["sample_support"]),
+            "qml_curses": (["src/qml_parser.cpp"], []),
+            "qml_parser_tests": (["tests/qml_parser_test.cpp"], ["qml_curses"]),
+            "sample_app": (["src/main.cpp"], ["sample_support"]),
+        }
+        ctest_listing = json.dumps({"tests": [
+            {"name": "sample_tests.greets", "properties": [{"name": "LABELS", "value": ["sample_tests"]}]},
+            {"name": "qml_view_tests.shows", "properties": [{"name": "LABELS", "value": ["qml_view_tests", "gui"]}]},
+            {"name": "qml_parser_tests_NOT_BUILT", "properties": []},
+        ]})
+        with tempfile.TemporaryDirectory() as tmp:
+            build_dir = Path(tmp)
+            reply = build_dir / impacted.CODEMODEL_REPLY
+            reply.mkdir(parents=True)
+            entries = []
+            for name, (sources, dependencies) in targets.items():
+                (reply / f"target-{name}.json").write_text(json.dumps({
+                    "name": name,
+                    "sources": [{"path": path} for path in sources] + [{"path": str(build_dir / "moc.cpp")}],
+                    "dependencies": [{"id": f"{dependency}::@1"} for dependency in dependencies],
+                }), encoding="utf-8")
+                entries.append({"name": name, "id": f"{name}::@1", "jsonFile": f"target-{name}.json"})
+            (reply / "codemodel-v2-1.json").write_text(
+                json.dumps({"configurations": [{"name": "Debug", "targets": entries}]}), encoding="utf-8"
+            )
+            (reply / "index-1.json").write_text(
+                json.dumps({"objects": [{"kind": "codemodel", "jsonFile": "codemodel-v2-1.json"}]}), encoding="utf-8"
+            )
+
+            def select(changed: list[str]):
+                with mock.patch.object(impacted, "changed_files", return_value=changed), \
+                    mock.patch.object(impacted.subprocess, "check_output", return_value=ctest_listing):
+                    return impacted.select_impacted_tests(build_dir, build_dir, "HEAD", "Debug")
+
+            self.assertEqual(select(["src/greeter.cpp"]), ["qml_view_tests", "sample_tests"])
+            self.assertEqual(select(["src/qml_parser.cpp", "README.md"]), ["qml_parser_tests"])
+            self.assertEqual(select(["tests/greeter_test.cpp"]), ["sample_tests"])
+            self.assertEqual(select(["src/main.cpp", "python/dev_tool/cli.py"]), [])
+            self.assertIsNone(select(["src/greeter.cpp", "CMakeLists.txt"]))
+            self.assertIsNone(select(["cmake/QtTestDiscovery.cmake"]))
+            self.assertIsNone(select(["tests/golden/frames.txt"]))
+        self.assertEqual(impacted.label_regex(["sample_tests", "qml_view_tests"]), "^(qml_view_tests|sample_tests)$")
+
+    def test_profile_folds_perf_samples_into_a_flame_graph(self) -> None:
+        script = (
+            "sample_cli  4242 100.000001:    1001001 cpu-clock:u: \n"
+            "\t    55d0c1a2b3c4 QmlParser::parseString+0x1f (/build-profile/sample_cli)\n"
+            "\t    55d0c1a2b000 main+0x20 (/build-profile/sample_cli)\n"
+            "\t    7f0000000000 [unknown] (/usr/lib/libc.so.6)\n"
+            "\n"
+            "sample_cli  4242 100.001002:    1001001 cpu-clock:u: \n"
+            "\t    55d0c1a2b3c4 QmlParser::parseString+0x1f (/build-profile/sample_cli)\n"
+            "\t    55d0c1a2b000 main+0x20 (/build-profile/sample_cli)\n"
+            "\t    7f0000000000 [unknown] (/usr/lib/libc.so.6)\n"
+            "\n"
+            "QThreadPool Thr  4243 100.002003:    1001001 cpu-clock:u: \n"
+            "\t    55d0c1a2c000 QmlFrontend::render+0x8 (/build-profile/sample_cli)\n"
+        )
+        stacks = profile.collapse_perf_script(script)
+        self.assertEqual(stacks, {
+            "sample_cli;[libc.so.6];main;QmlParser::parseString": 2,
+            "QThreadPool Thr;QmlFrontend::render": 1,
+        })
+
+        svg = profile.render_flamegraph(stacks, "sample_cli --dump 80x24 <Main>.qml")
+        self.assertTrue(svg.startswith("<svg "))
+        self.assertIn("(3 samples)", svg)
+        self.assertIn("&lt;Main&gt;", svg)
+        self.assertIn("<title>main (2 samples, 66.67%)</title>", svg)
+        self.assertIn("<title>QmlFrontend::render (1 samples, 33.33%)</title>", svg)
+
+        xctrace = (
+            "<trace-query-result><node><row><thread id=\"1\" fmt=\"Main Thread\"/>"
+            "<backtrace id=\"2\"><frame id=\"3\" name=\"parseString\"/><frame id=\"4\" name=\"main\"/></backtrace>"
+            "</row><row><thread ref=\"1\"/><backtrace ref=\"2\"/></row></node></trace-query-result>"
+        )
+        self.assertEqual(profile.collapse_xctrace(xctrace), {"Main Thread;main;parseString": 2})
+
+    def test_profile_records_under_the_platform_profiler(self) -> None:
+        exe = Path("build-profile/sample_cli")
+        with tempfile.TemporaryDirectory() as tmp:
+            output = Path(tmp)
+            perf = profile.record_commands("Linux", exe, ["--dump", "80x24"], output / "a.perf.data", 999)
+            self.assertEqual(perf[0][:3], ["perf", "record", "-F"])
+            self.assertEqual(perf[0][-4:], ["--", str(exe), "--dump", "80x24"])
+            self.assertEqual(profile.profile_build_dir(Path("/src/build")), Path("/src/build-profile"))
+
+            script = "sample_cli  1 1.0: 1 cpu-clock:u: \n\t 1 main+0x1 (/x)\n"
+            with mock.patch.object(profile.shutil, "which", return_value="/usr/bin/perf"), \
+                mock.patch.object(profile, "run_command") as run_cmd, \
+                mock.patch.object(profile.subprocess, "run",
+                                  return_value=types.SimpleNamespace(stdout=script)) as perf_script:
+                svg_path = profile.profile(exe, ["--dump", "80x24"], output, system="Linux")
+            self.assertEqual(run_cmd.call_count, 1)
+            self.assertEqual(perf_script.call_args.args[0][:2], ["perf", "script"])
+            self.assertTrue(svg_path.name.startswith("sample_cli-") and svg_path.suffix == ".svg")
+            self.assertIn("main", svg_path.read_text(encoding="utf-8"))
+            self.assertEqual(svg_path.with_suffix(".folded").read_text(encoding="utf-8"), "sample_cli;main 1\n")
+
+            # WPR keeps recording machine-wide until stopped, so a failed run still stops it.
+            with mock.patch.object(profile.shutil, "which", return_value="wpr.exe"), \
+                mock.patch.object(profile, "run_command",
+                                  side_effect=[None, subprocess.CalledProcessError(1, "x"), None]) as run_cmd:
+                with self.assertRaises(subprocess.CalledProcessError):
+                    profile.profile(exe, [], output, system="Windows")
+            self.assertEqual(run_cmd.call_args.args[0][:2], ["wpr", "-stop"])
+
+    def test_pgo_build_trains_then_rebuilds_with_profiles(self) -> None:
+        with mock.patch.object(project, "configure_project", return_value="Ninja") as configure, \
+            mock.patch.object(project, "build_targets") as build:
+            project.build_with_pgo(Path("build-pgo"), "Ninja", "Release", None, None, lto=False)
+
+        stages = [call.kwargs["cache_entries"] for call in configure.call_args_list]
+        self.assertEqual(stages, [
+            ["-DSAMPLE_LTO=OFF", "-DSAMPLE_PGO=GENERATE"],
+            ["-DSAMPLE_LTO=OFF", "-DSAMPLE_PGO=USE"],
+        ])
+        self.assertEqual([call.args[3] for call in build.call_args_list], [["pgo_train"], []])
+
+    def test_qml_index_tallies_each_parsed_file(self) -> None:
+        def node(type_: str, id_: str = "") -> types.SimpleNamespace:
+            return types.SimpleNamespace(type=type_, id=id_)
+
+        document = types.SimpleNamespace(nodes=lambda: [node("Item", "root"), node("Text"), node("Text", "label")])
+        native = types.SimpleNamespace(parse_files=mock.Mock(return_value=[
+            ("/p/Main.qml", document, None),
+            ("/p/Gone.qml", None, "Failed to open QML file: /p/Gone.qml"),
+        ]))
+
+        entries = qml.index_qml_files(native, [Path("/p/Main.qml"), Path("/p/Gone.qml")], threads=2)
+
+        native.parse_files.assert_called_once_with(["/p/Main.qml", "/p/Gone.qml"], 2)
+        self.assertEqual((entries[0].objects, entries[0].ids), (3, ["root", "label"]))
+        self.assertEqual(entries[0].types, {"Text": 2, "Item": 1})
+        self.assertEqual(entries[1].error, "Failed to open QML file: /p/Gone.qml")
+        report = qml.format_qml_index(entries, Path("/p"))
+        self.assertIn("Main.qml: 3 objects, 2 ids", report)
+        self.assertIn("2 files (1 failed), 3 objects, 2 ids", report)
+        self.assertIn("Most used types: Text 2, Item 1", report)
+
+    def test_qml_query_reads_answers_from_the_index_server(self) -> None:
+        if os.name == "nt":
+            self.skipTest("the fake server below is a Unix domain socket")
+        answers = [
+            [b"/p/Main.qml\t2\t1\tid: root\n", b"/p/Main.qml\t4\t5\ttext: a\\tb\n\n"],
+            [b"error\tunknown request: nope\n\n"],
+        ]
+        requests: list[bytes] = []
+        with tempfile.TemporaryDirectory() as tmp:
+            address = os.path.join(tmp, "index")
+            listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            listener.bind(address)
+            listener.listen()
+
+            def serve() -> None:
+                for chunks in answers:
+                    connection, _ = listener.accept()
+                    with connection:
+                        requests.append(connection.recv(4096))
+                        for chunk in chunks:  # an answer may arrive in pieces
+                            connection.sendall(chunk)
+
+            server = threading.Thread(target=serve)
+            server.start()
+            try:
+                matches = qml.query_index_server(address, ["bindings", "/p/Main.qml"])
+                with self.assertRaisesRegex(RuntimeError, "unknown request: nope"):
+                    qml.query_index_server(address, ["nope"])
+            finally:
+                server.join()
+                listener.close()
+
+        self.assertEqual(requests, [b"bindings\t/p/Main.qml\n", b"nope\n"])
+        self.assertEqual(matches, [
+            qml.QmlIndexMatch("/p/Main.qml", 2, 1, "id: root"),
+            qml.QmlIndexMatch("/p/Main.qml", 4, 5, "text: a\tb"),
+        ])
+        self.assertEqual(qml.format_index_matches(matches, Path("/p")).splitlines()[0], "Main.qml:2:1: id: root")
+
+    def test_native_parser_extension_parses_and_navigates(self) -> None:
+        native = qml.load_native_parser(dev_tool.DEFAULT_BUILD_DIR)
+        if native is None:
+            self.skipTest("sample_qml is not built; configure with -DSAMPLE_PYTHON_BINDINGS=ON")
+        document = native.parse_string(
+            "Item {\n    id: root\n    width: 10\n"
+            "    Text { id: label; text: \"hi\"; opacity: 0.5\n        onClicked: go()\n    }\n}\n"
+        )
+        label = document.find_by_id("label")
+        self.assertEqual([n.type for n in document.nodes()], ["Item", "Text"])
+        self.assertEqual([n.id for n in document.nodes_of_type("Text")], ["label"])
+        self.assertEqual(label.properties["text"], "hi")
+        self.assertEqual((label.value("opacity"), label.value("missing", 7)), (0.5, 7))
+        self.assertEqual(document.parent_of(label).id, "root")
+        self.assertIsNone(document.parent_of(document.roots[0]))
+        self.assertEqual(label.scripts, [("handler", "onClicked")])
+
+        with tempfile.TemporaryDirectory() as tmp:
+            good = Path(tmp) / "Good.qml"
+            good.write_text("Item {\n    Rectangle {\n    }\n}\n", encoding="utf-8")
+            results = native.parse_files([good, Path(tmp) / "Missing.qml"], threads=2)
+        self.assertEqual([r[0] for r in results], [str(good), str(Path(tmp) / "Missing.qml")])
+        self.assertEqual(len(results[0][1].nodes()), 2)
+        self.assertIsNone(results[1][1])
+        self.assertIn("Missing.qml", results[1][2])
+        with self.assertRaises(OSError):
+            native.parse_file(str(Path(tmp) / "Missing.qml"))